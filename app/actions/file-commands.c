@@ -249,11 +249,19 @@ file_save_cmd_callback (GtkAction *action,
 
           if (uri && save_proc)
             {
-              saved = file_save_dialog_save_image (GIMP_PROGRESS (display),
-                                                   gimp, image, uri,
-                                                   save_proc,
-                                                   GIMP_RUN_WITH_LAST_VALS,
-                                                   TRUE, FALSE, FALSE, TRUE);
+              /*  closing needs the save to be done, plain saves
+               *  can go on in the background
+               */
+              if (save_mode == GIMP_SAVE_MODE_SAVE)
+                saved = file_save_dialog_save_image_async (GIMP_PROGRESS (display),
+                                                           gimp, image, uri,
+                                                           save_proc);
+              else
+                saved = file_save_dialog_save_image (GIMP_PROGRESS (display),
+                                                     gimp, image, uri,
+                                                     save_proc,
+                                                     GIMP_RUN_WITH_LAST_VALS,
+                                                     TRUE, FALSE, FALSE, TRUE);
               break;
             }
 
@@ -27,7 +27,9 @@
 
 #include "core/gimp.h"
 #include "core/gimpchannel.h"
+#include "core/gimpcontext.h"
 #include "core/gimpimage.h"
+#include "core/gimpprogress.h"
 #include "core/gimpselection.h"
 #include "core/gimpstrokeoptions.h"
 
@@ -411,9 +413,11 @@ select_feather_callback (GtkWidget *widget,
                          GimpUnit   unit,
                          gpointer   data)
 {
-  GimpImage *image = GIMP_IMAGE (data);
-  gdouble    radius_x;
-  gdouble    radius_y;
+  GimpImage    *image    = GIMP_IMAGE (data);
+  GimpDisplay  *display;
+  GimpProgress *progress = NULL;
+  gdouble       radius_x;
+  gdouble       radius_y;
 
   radius_x = radius_y = select_feather_radius = size;
 
@@ -434,7 +438,14 @@ select_feather_callback (GtkWidget *widget,
         radius_x *= factor;
     }
 
-  gimp_channel_feather (gimp_image_get_mask (image), radius_x, radius_y, TRUE);
+  display = gimp_context_get_display (gimp_get_user_context (image->gimp));
+
+  /*  show the progress, and let it be cancelled, on the image's display  */
+  if (display && gimp_display_get_image (display) == image)
+    progress = GIMP_PROGRESS (display);
+
+  gimp_channel_feather (gimp_image_get_mask (image), radius_x, radius_y,
+                        progress, TRUE);
   gimp_image_flush (image);
 }
 
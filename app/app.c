@@ -47,6 +47,7 @@
 #include "gegl/gimp-gegl.h"
 
 #include "core/gimp.h"
+#include "core/gimp-parallel.h"
 #include "core/gimp-user-install.h"
 
 #include "file/file-open.h"
@@ -63,6 +64,7 @@
 #include "units.h"
 #include "language.h"
 #include "gimp-debug.h"
+#include "gimp-trace.h"
 
 #include "gimp-intl.h"
 
@@ -127,6 +129,8 @@ app_run (const gchar         *full_prog_name,
          const gchar         *session_name,
          const gchar         *batch_interpreter,
          const gchar        **batch_commands,
+         const gchar         *batch_procedure,
+         gint                 batch_jobs,
          gboolean             as_new,
          gboolean             no_interface,
          gboolean             no_data,
@@ -146,7 +150,8 @@ app_run (const gchar         *full_prog_name,
   GMainLoop          *run_loop;
   gchar              *default_folder = NULL;
 
-  if (filenames && filenames[0] && ! filenames[1] &&
+  if (! batch_procedure &&
+      filenames && filenames[0] && ! filenames[1] &&
       g_file_test (filenames[0], G_FILE_TEST_IS_DIR))
     {
       if (g_path_is_absolute (filenames[0]))
@@ -213,6 +218,7 @@ app_run (const gchar         *full_prog_name,
 
   /*  initialize lowlevel stuff  */
   gimp_gegl_init (gimp);
+  gimp_parallel_init (gimp);
 
 #ifndef GIMP_CONSOLE_COMPILATION
   if (! no_interface)
@@ -242,18 +248,14 @@ app_run (const gchar         *full_prog_name,
                           G_CALLBACK (app_exit_after_callback),
                           &run_loop);
 
-  /*  Load the images given on the command-line.
+  /*  Load the images given on the command-line, unless they are
+   *  processed by the batch procedure
    */
-  if (filenames)
-    {
-      gint i;
+  if (filenames && ! batch_procedure && run_loop)
+    file_open_from_command_line_multiple (gimp, filenames, as_new);
 
-      for (i = 0; filenames[i] != NULL; i++)
-        {
-          if (run_loop)
-            file_open_from_command_line (gimp, filenames[i], as_new);
-        }
-    }
+  if (run_loop)
+    batch_run_files (gimp, batch_procedure, filenames, batch_jobs);
 
   if (run_loop)
     batch_run (gimp, batch_interpreter, batch_commands);
@@ -267,6 +269,11 @@ app_run (const gchar         *full_prog_name,
 
   g_main_loop_unref (loop);
 
+  gimp_parallel_exit (gimp);
+  gimp_gegl_exit (gimp);
+
+  gimp_trace_exit ();
+
   g_object_unref (gimp);
 
   gimp_debug_instances ();
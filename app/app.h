@@ -37,6 +37,8 @@ void  app_run       (const gchar         *full_prog_name,
                      const gchar         *session_name,
                      const gchar         *batch_interpreter,
                      const gchar        **batch_commands,
+                     const gchar         *batch_procedure,
+                     gint                 batch_jobs,
                      gboolean             as_new,
                      gboolean             no_interface,
                      gboolean             no_data,
@@ -25,28 +25,89 @@
 #include "libgimpbase/gimpbase.h"
 
 #include "core/core-types.h"
+#include "plug-in/plug-in-types.h"
+
+#include "config/gimpgeglconfig.h"
 
 #include "core/gimp.h"
+#include "core/gimp-gui.h"
+#include "core/gimp-parallel.h"
 #include "core/gimpparamspecs.h"
 
 #include "batch.h"
 
 #include "pdb/gimppdb.h"
+#include "pdb/gimppdbcontext.h"
 #include "pdb/gimpprocedure.h"
 
+#include "plug-in/gimpplugin.h"
+#include "plug-in/gimppluginmanager.h"
+#include "plug-in/gimppluginprocedure.h"
+
 #include "gimp-intl.h"
 
 
 #define BATCH_DEFAULT_EVAL_PROC   "plug-in-script-fu-eval"
 
 
-static void  batch_exit_after_callback (Gimp          *gimp) G_GNUC_NORETURN;
+typedef struct _BatchItem  BatchItem;
+typedef struct _BatchQueue BatchQueue;
 
-static void  batch_run_cmd             (Gimp          *gimp,
-                                        const gchar   *proc_name,
-                                        GimpProcedure *procedure,
-                                        GimpRunMode    run_mode,
-                                        const gchar   *cmd);
+struct _BatchItem
+{
+  const gchar *filename;
+  GimpContext *context;
+  gint64       start_time;
+};
+
+struct _BatchQueue
+{
+  Gimp          *gimp;
+  const gchar   *proc_name;
+  GimpProcedure *procedure;
+  gboolean       async;
+
+  const gchar  **filenames;
+  gint           next;
+  gint           n_jobs;
+
+  GList         *running;
+  gint           n_failed;
+
+  guint          idle_id;
+  GMainLoop     *loop;
+};
+
+
+static void             batch_exit_after_callback (Gimp              *gimp) G_GNUC_NORETURN;
+
+static GimpValueArray * batch_get_arguments       (GimpProcedure     *procedure,
+                                                   GimpRunMode        run_mode,
+                                                   const gchar       *string);
+static void             batch_run_cmd             (Gimp              *gimp,
+                                                   const gchar       *proc_name,
+                                                   GimpProcedure     *procedure,
+                                                   GimpRunMode        run_mode,
+                                                   const gchar       *cmd);
+
+static void             batch_queue_dispatch      (BatchQueue        *queue);
+static gboolean         batch_queue_idle          (BatchQueue        *queue);
+static gboolean         batch_queue_has_memory    (BatchQueue        *queue);
+static void             batch_queue_start         (BatchQueue        *queue,
+                                                   const gchar       *filename);
+static BatchItem      * batch_queue_find_item     (BatchQueue        *queue,
+                                                   GimpContext       *context);
+static void             batch_queue_item_done     (BatchQueue        *queue,
+                                                   BatchItem         *item,
+                                                   GimpPDBStatusType  status,
+                                                   const GError      *error);
+
+static void             batch_plug_in_returned    (GimpPlugInManager *manager,
+                                                   GimpPlugIn        *plug_in,
+                                                   BatchQueue        *queue);
+static void             batch_plug_in_closed      (GimpPlugInManager *manager,
+                                                   GimpPlugIn        *plug_in,
+                                                   BatchQueue        *queue);
 
 
 void
@@ -116,6 +177,100 @@ batch_run (Gimp         *gimp,
   g_signal_handler_disconnect (gimp, exit_id);
 }
 
+/*  Runs @batch_procedure once for each of @filenames, passing the
+ *  filename as its first string argument.  Plug-in procedures run in
+ *  their own processes, so up to @batch_jobs of them run at the same
+ *  time.  All other procedures run one file after the other.
+ */
+void
+batch_run_files (Gimp         *gimp,
+                 const gchar  *batch_procedure,
+                 const gchar **filenames,
+                 gint          batch_jobs)
+{
+  GimpProcedure *procedure;
+  BatchQueue     queue = { 0, };
+  gint64         start_time;
+  gulong         exit_id;
+  gint           n_files;
+
+  if (! batch_procedure || ! filenames || ! filenames[0])
+    return;
+
+  procedure = gimp_pdb_lookup_procedure (gimp->pdb, batch_procedure);
+
+  if (! procedure)
+    {
+      g_message (_("The batch procedure '%s' is not available. "
+                   "Batch mode disabled."), batch_procedure);
+      return;
+    }
+
+  exit_id = g_signal_connect_after (gimp, "exit",
+                                    G_CALLBACK (batch_exit_after_callback),
+                                    NULL);
+
+  queue.gimp      = gimp;
+  queue.proc_name = batch_procedure;
+  queue.procedure = procedure;
+  queue.async     = (GIMP_IS_PLUG_IN_PROCEDURE (procedure) &&
+                     procedure->proc_type == GIMP_PLUGIN);
+  queue.filenames = filenames;
+  queue.n_jobs    = batch_jobs > 0 ? batch_jobs : gimp_parallel_get_n_threads ();
+
+  if (! queue.async)
+    queue.n_jobs = 1;
+
+  start_time = g_get_monotonic_time ();
+
+  if (queue.async)
+    {
+      GimpPlugInManager *manager = gimp->plug_in_manager;
+      gulong             returned_id;
+      gulong             closed_id;
+
+      returned_id = g_signal_connect (manager, "plug-in-returned",
+                                      G_CALLBACK (batch_plug_in_returned),
+                                      &queue);
+      closed_id   = g_signal_connect (manager, "plug-in-closed",
+                                      G_CALLBACK (batch_plug_in_closed),
+                                      &queue);
+
+      queue.loop = g_main_loop_new (NULL, FALSE);
+
+      batch_queue_dispatch (&queue);
+
+      if (queue.running)
+        {
+          gimp_threads_leave (gimp);
+          g_main_loop_run (queue.loop);
+          gimp_threads_enter (gimp);
+        }
+
+      g_main_loop_unref (queue.loop);
+      queue.loop = NULL;
+
+      g_signal_handler_disconnect (manager, returned_id);
+      g_signal_handler_disconnect (manager, closed_id);
+    }
+  else
+    {
+      batch_queue_dispatch (&queue);
+    }
+
+  if (queue.idle_id)
+    g_source_remove (queue.idle_id);
+
+  n_files = g_strv_length ((gchar **) filenames);
+
+  g_printerr ("batch procedure processed %d files in %.2f seconds, "
+              "%d failed\n",
+              n_files, (g_get_monotonic_time () - start_time) / 1000000.0,
+              queue.n_failed);
+
+  g_signal_handler_disconnect (gimp, exit_id);
+}
+
 
 /*
  * The purpose of this handler is to exit GIMP cleanly when the batch
@@ -134,17 +289,13 @@ batch_exit_after_callback (Gimp *gimp)
   exit (EXIT_SUCCESS);
 }
 
-static void
-batch_run_cmd (Gimp          *gimp,
-               const gchar   *proc_name,
-               GimpProcedure *procedure,
-               GimpRunMode    run_mode,
-               const gchar   *cmd)
+static GimpValueArray *
+batch_get_arguments (GimpProcedure *procedure,
+                     GimpRunMode    run_mode,
+                     const gchar   *string)
 {
   GimpValueArray *args;
-  GimpValueArray *return_vals;
-  GError         *error = NULL;
-  gint            i     = 0;
+  gint            i = 0;
 
   args = gimp_procedure_get_arguments (procedure);
 
@@ -154,7 +305,23 @@ batch_run_cmd (Gimp          *gimp,
 
   if (procedure->num_args > i &&
       GIMP_IS_PARAM_SPEC_STRING (procedure->args[i]))
-    g_value_set_static_string (gimp_value_array_index (args, i++), cmd);
+    g_value_set_static_string (gimp_value_array_index (args, i++), string);
+
+  return args;
+}
+
+static void
+batch_run_cmd (Gimp          *gimp,
+               const gchar   *proc_name,
+               GimpProcedure *procedure,
+               GimpRunMode    run_mode,
+               const gchar   *cmd)
+{
+  GimpValueArray *args;
+  GimpValueArray *return_vals;
+  GError         *error = NULL;
+
+  args = batch_get_arguments (procedure, run_mode, cmd);
 
   return_vals =
     gimp_pdb_execute_procedure_by_name_args (gimp->pdb,
@@ -201,3 +368,217 @@ batch_run_cmd (Gimp          *gimp,
 
   return;
 }
+
+static void
+batch_queue_dispatch (BatchQueue *queue)
+{
+  while (queue->filenames[queue->next] &&
+         g_list_length (queue->running) < queue->n_jobs)
+    {
+      /*  always keep one item running, but don't start more while
+       *  the open images already fill the tile cache
+       */
+      if (queue->running && ! batch_queue_has_memory (queue))
+        break;
+
+      batch_queue_start (queue, queue->filenames[queue->next++]);
+    }
+
+  if (! queue->running && ! queue->filenames[queue->next] &&
+      queue->loop && g_main_loop_is_running (queue->loop))
+    {
+      g_main_loop_quit (queue->loop);
+    }
+}
+
+static gboolean
+batch_queue_idle (BatchQueue *queue)
+{
+  queue->idle_id = 0;
+
+  batch_queue_dispatch (queue);
+
+  return FALSE;
+}
+
+static gboolean
+batch_queue_has_memory (BatchQueue *queue)
+{
+  GimpGeglConfig *config = GIMP_GEGL_CONFIG (queue->gimp->config);
+  GList          *list;
+  gint64          memsize = 0;
+
+  for (list = gimp_get_image_iter (queue->gimp);
+       list;
+       list = g_list_next (list))
+    {
+      memsize += gimp_object_get_memsize (list->data, NULL);
+    }
+
+  return memsize < config->tile_cache_size;
+}
+
+static void
+batch_queue_start (BatchQueue  *queue,
+                   const gchar *filename)
+{
+  Gimp           *gimp = queue->gimp;
+  BatchItem      *item;
+  GimpValueArray *args;
+  GError         *error = NULL;
+
+  item = g_slice_new0 (BatchItem);
+
+  /*  every item gets its own context, which also tells the plug-ins
+   *  running them apart
+   */
+  item->filename   = filename;
+  item->context    = gimp_pdb_context_new (gimp, gimp_get_user_context (gimp),
+                                           TRUE);
+  item->start_time = g_get_monotonic_time ();
+
+  queue->running = g_list_append (queue->running, item);
+
+  args = batch_get_arguments (queue->procedure, GIMP_RUN_NONINTERACTIVE,
+                              filename);
+
+  if (queue->async)
+    {
+      GSList *list;
+
+      gimp_procedure_execute_async (queue->procedure, gimp, item->context,
+                                    NULL, args, NULL, &error);
+
+      for (list = gimp->plug_in_manager->open_plug_ins;
+           list;
+           list = g_slist_next (list))
+        {
+          GimpPlugIn *plug_in = list->data;
+
+          if (plug_in->main_proc_frame.main_context == item->context)
+            break;
+        }
+
+      /*  the plug-in could not be started  */
+      if (! list)
+        batch_queue_item_done (queue, item,
+                               error ?
+                               GIMP_PDB_CALLING_ERROR :
+                               GIMP_PDB_EXECUTION_ERROR,
+                               error);
+    }
+  else
+    {
+      GimpValueArray *return_vals;
+
+      return_vals =
+        gimp_pdb_execute_procedure_by_name_args (gimp->pdb, item->context,
+                                                 NULL, &error,
+                                                 queue->proc_name, args);
+
+      batch_queue_item_done (queue, item,
+                             g_value_get_enum (gimp_value_array_index (return_vals, 0)),
+                             error);
+
+      gimp_value_array_unref (return_vals);
+    }
+
+  gimp_value_array_unref (args);
+
+  if (error)
+    g_error_free (error);
+}
+
+static BatchItem *
+batch_queue_find_item (BatchQueue  *queue,
+                       GimpContext *context)
+{
+  GList *list;
+
+  for (list = queue->running; list; list = g_list_next (list))
+    {
+      BatchItem *item = list->data;
+
+      if (item->context == context)
+        return item;
+    }
+
+  return NULL;
+}
+
+static void
+batch_queue_item_done (BatchQueue        *queue,
+                       BatchItem         *item,
+                       GimpPDBStatusType  status,
+                       const GError      *error)
+{
+  gdouble seconds = (g_get_monotonic_time () - item->start_time) / 1000000.0;
+
+  switch (status)
+    {
+    case GIMP_PDB_SUCCESS:
+      g_printerr ("batch item '%s' executed successfully in %.2f seconds\n",
+                  item->filename, seconds);
+      break;
+
+    default:
+      if (error)
+        g_printerr ("batch item '%s' failed after %.2f seconds:\n%s\n",
+                    item->filename, seconds, error->message);
+      else
+        g_printerr ("batch item '%s' failed after %.2f seconds\n",
+                    item->filename, seconds);
+
+      queue->n_failed++;
+      break;
+    }
+
+  queue->running = g_list_remove (queue->running, item);
+
+  g_object_unref (item->context);
+  g_slice_free (BatchItem, item);
+
+  /*  don't start the next item from within the plug-in's message
+   *  handling
+   */
+  if (! queue->idle_id)
+    queue->idle_id = g_idle_add ((GSourceFunc) batch_queue_idle, queue);
+}
+
+static void
+batch_plug_in_returned (GimpPlugInManager *manager,
+                        GimpPlugIn        *plug_in,
+                        BatchQueue        *queue)
+{
+  GimpPlugInProcFrame *proc_frame = &plug_in->main_proc_frame;
+  GimpPDBStatusType    status     = GIMP_PDB_EXECUTION_ERROR;
+  BatchItem           *item;
+
+  item = batch_queue_find_item (queue, proc_frame->main_context);
+
+  if (! item)
+    return;
+
+  if (proc_frame->return_vals &&
+      gimp_value_array_length (proc_frame->return_vals) > 0)
+    {
+      status = g_value_get_enum (gimp_value_array_index (proc_frame->return_vals,
+                                                         0));
+    }
+
+  batch_queue_item_done (queue, item, status, NULL);
+}
+
+static void
+batch_plug_in_closed (GimpPlugInManager *manager,
+                      GimpPlugIn        *plug_in,
+                      BatchQueue        *queue)
+{
+  BatchItem *item;
+
+  /*  the plug-in went away without returning  */
+  item = batch_queue_find_item (queue, plug_in->main_proc_frame.main_context);
+
+  if (item)
+    batch_queue_item_done (queue, item, GIMP_PDB_EXECUTION_ERROR, NULL);
+}
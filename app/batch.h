@@ -23,9 +23,13 @@
 #endif
 
 
-void   batch_run (Gimp         *gimp,
-                  const gchar  *batch_interpreter,
-                  const gchar **batch_commands);
+void   batch_run       (Gimp         *gimp,
+                        const gchar  *batch_interpreter,
+                        const gchar **batch_commands);
+void   batch_run_files (Gimp         *gimp,
+                        const gchar  *batch_procedure,
+                        const gchar **filenames,
+                        gint          batch_jobs);
 
 
 #endif /* __BATCH_H__ */
@@ -103,6 +103,7 @@ enum
   PROP_COLOR_PROFILE_POLICY,
   PROP_SAVE_DOCUMENT_HISTORY,
   PROP_QUICK_MASK_COLOR,
+  PROP_LAZY_DATA_LOADING,
 
   /* ignored, only for backward compatibility: */
   PROP_INSTALL_COLORMAP,
@@ -448,6 +449,12 @@ gimp_core_config_class_init (GimpCoreConfigClass *klass)
                                 "quick-mask-color", QUICK_MASK_COLOR_BLURB,
                                 TRUE, &red,
                                 GIMP_PARAM_STATIC_STRINGS);
+  GIMP_CONFIG_INSTALL_PROP_BOOLEAN (object_class, PROP_LAZY_DATA_LOADING,
+                                    "lazy-data-loading",
+                                    LAZY_DATA_LOADING_BLURB,
+                                    TRUE,
+                                    GIMP_PARAM_STATIC_STRINGS |
+                                    GIMP_CONFIG_PARAM_RESTART);
 
   /*  only for backward compatibility:  */
   GIMP_CONFIG_INSTALL_PROP_BOOLEAN (object_class, PROP_INSTALL_COLORMAP,
@@ -721,6 +728,9 @@ gimp_core_config_set_property (GObject      *object,
     case PROP_QUICK_MASK_COLOR:
       gimp_value_get_rgb (value, &core_config->quick_mask_color);
       break;
+    case PROP_LAZY_DATA_LOADING:
+      core_config->lazy_data_loading = g_value_get_boolean (value);
+      break;
 
     case PROP_INSTALL_COLORMAP:
     case PROP_MIN_COLORS:
@@ -890,6 +900,9 @@ gimp_core_config_get_property (GObject    *object,
     case PROP_QUICK_MASK_COLOR:
       gimp_value_set_rgb (value, &core_config->quick_mask_color);
       break;
+    case PROP_LAZY_DATA_LOADING:
+      g_value_set_boolean (value, core_config->lazy_data_loading);
+      break;
 
     case PROP_INSTALL_COLORMAP:
     case PROP_MIN_COLORS:
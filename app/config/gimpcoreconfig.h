@@ -88,6 +88,7 @@ struct _GimpCoreConfig
   GimpColorProfilePolicy  color_profile_policy;
   gboolean                save_document_history;
   GimpRGB                 quick_mask_color;
+  gboolean                lazy_data_loading;
 };
 
 struct _GimpCoreConfigClass
@@ -41,6 +41,7 @@
 #define DEFAULT_MONITOR_RESOLUTION   96.0
 #define DEFAULT_MARCHING_ANTS_SPEED  200
 #define DEFAULT_USE_EVENT_HISTORY    FALSE
+#define DEFAULT_ACCELERATED_CANVAS   TRUE
 
 enum
 {
@@ -74,6 +75,7 @@ enum
   PROP_SPACE_BAR_ACTION,
   PROP_ZOOM_QUALITY,
   PROP_USE_EVENT_HISTORY,
+  PROP_ACCELERATED_CANVAS,
 
   /* ignored, only for backward compatibility: */
   PROP_CONFIRM_ON_CLOSE,
@@ -263,6 +265,12 @@ gimp_display_config_class_init (GimpDisplayConfigClass *klass)
                                     DEFAULT_USE_EVENT_HISTORY,
                                     GIMP_PARAM_STATIC_STRINGS);
 
+  GIMP_CONFIG_INSTALL_PROP_BOOLEAN (object_class, PROP_ACCELERATED_CANVAS,
+                                    "accelerated-canvas",
+                                    ACCELERATED_CANVAS_BLURB,
+                                    DEFAULT_ACCELERATED_CANVAS,
+                                    GIMP_PARAM_STATIC_STRINGS);
+
   /*  only for backward compatibility:  */
   GIMP_CONFIG_INSTALL_PROP_BOOLEAN (object_class, PROP_CONFIRM_ON_CLOSE,
                                     "confirm-on-close", NULL,
@@ -415,6 +423,9 @@ gimp_display_config_set_property (GObject      *object,
     case PROP_USE_EVENT_HISTORY:
       display_config->use_event_history = g_value_get_boolean (value);
       break;
+    case PROP_ACCELERATED_CANVAS:
+      display_config->accelerated_canvas = g_value_get_boolean (value);
+      break;
 
     case PROP_CONFIRM_ON_CLOSE:
     case PROP_XOR_COLOR:
@@ -524,6 +535,9 @@ gimp_display_config_get_property (GObject    *object,
     case PROP_USE_EVENT_HISTORY:
       g_value_set_boolean (value, display_config->use_event_history);
       break;
+    case PROP_ACCELERATED_CANVAS:
+      g_value_set_boolean (value, display_config->accelerated_canvas);
+      break;
 
     case PROP_CONFIRM_ON_CLOSE:
     case PROP_XOR_COLOR:
@@ -70,6 +70,7 @@ struct _GimpDisplayConfig
   GimpSpaceBarAction  space_bar_action;
   GimpZoomQuality     zoom_quality;
   gboolean            use_event_history;
+  gboolean            accelerated_canvas;
 };
 
 struct _GimpDisplayConfigClass
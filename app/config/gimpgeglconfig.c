@@ -49,8 +49,11 @@ enum
   PROP_0,
   PROP_TEMP_PATH,
   PROP_SWAP_PATH,
+  PROP_SWAP_COMPRESSION,
   PROP_NUM_PROCESSORS,
+  PROP_NUM_PROCESSORS_AUTO,
   PROP_TILE_CACHE_SIZE,
+  PROP_TILE_CACHE_SIZE_AUTO,
   PROP_USE_OPENCL,
 
   /* ignored, only for backward compatibility: */
@@ -128,6 +131,11 @@ gimp_gegl_config_class_init (GimpGeglConfigClass *klass)
                                  "${gimp_dir}",
                                  GIMP_PARAM_STATIC_STRINGS |
                                  GIMP_CONFIG_PARAM_RESTART);
+  GIMP_CONFIG_INSTALL_PROP_BOOLEAN (object_class, PROP_SWAP_COMPRESSION,
+                                    "swap-compression",
+                                    SWAP_COMPRESSION_BLURB,
+                                    TRUE,
+                                    GIMP_PARAM_STATIC_STRINGS);
 
   num_processors = g_get_num_processors ();
 
@@ -142,6 +150,12 @@ gimp_gegl_config_class_init (GimpGeglConfigClass *klass)
                                  1, GIMP_MAX_NUM_THREADS, num_processors,
                                  GIMP_PARAM_STATIC_STRINGS);
 
+  GIMP_CONFIG_INSTALL_PROP_BOOLEAN (object_class, PROP_NUM_PROCESSORS_AUTO,
+                                    "num-processors-auto",
+                                    NUM_PROCESSORS_AUTO_BLURB,
+                                    TRUE,
+                                    GIMP_PARAM_STATIC_STRINGS);
+
   memory_size = gimp_get_physical_memory_size ();
 
   /* limit to the amount one process can handle */
@@ -159,6 +173,12 @@ gimp_gegl_config_class_init (GimpGeglConfigClass *klass)
                                     GIMP_PARAM_STATIC_STRINGS |
                                     GIMP_CONFIG_PARAM_CONFIRM);
 
+  GIMP_CONFIG_INSTALL_PROP_BOOLEAN (object_class, PROP_TILE_CACHE_SIZE_AUTO,
+                                    "tile-cache-size-auto",
+                                    TILE_CACHE_SIZE_AUTO_BLURB,
+                                    TRUE,
+                                    GIMP_PARAM_STATIC_STRINGS);
+
   GIMP_CONFIG_INSTALL_PROP_BOOLEAN (object_class, PROP_USE_OPENCL,
                                     "use-opencl", USE_OPENCL_BLURB,
                                     TRUE,
@@ -209,12 +229,21 @@ gimp_gegl_config_set_property (GObject      *object,
       g_free (gegl_config->swap_path);
       gegl_config->swap_path = g_value_dup_string (value);
       break;
+    case PROP_SWAP_COMPRESSION:
+      gegl_config->swap_compression = g_value_get_boolean (value);
+      break;
     case PROP_NUM_PROCESSORS:
       gegl_config->num_processors = g_value_get_uint (value);
       break;
+    case PROP_NUM_PROCESSORS_AUTO:
+      gegl_config->num_processors_auto = g_value_get_boolean (value);
+      break;
     case PROP_TILE_CACHE_SIZE:
       gegl_config->tile_cache_size = g_value_get_uint64 (value);
       break;
+    case PROP_TILE_CACHE_SIZE_AUTO:
+      gegl_config->tile_cache_size_auto = g_value_get_boolean (value);
+      break;
     case PROP_USE_OPENCL:
       gegl_config->use_opencl = g_value_get_boolean (value);
       break;
@@ -245,12 +274,21 @@ gimp_gegl_config_get_property (GObject    *object,
     case PROP_SWAP_PATH:
       g_value_set_string (value, gegl_config->swap_path);
       break;
+    case PROP_SWAP_COMPRESSION:
+      g_value_set_boolean (value, gegl_config->swap_compression);
+      break;
     case PROP_NUM_PROCESSORS:
       g_value_set_uint (value, gegl_config->num_processors);
       break;
+    case PROP_NUM_PROCESSORS_AUTO:
+      g_value_set_boolean (value, gegl_config->num_processors_auto);
+      break;
     case PROP_TILE_CACHE_SIZE:
       g_value_set_uint64 (value, gegl_config->tile_cache_size);
       break;
+    case PROP_TILE_CACHE_SIZE_AUTO:
+      g_value_set_boolean (value, gegl_config->tile_cache_size_auto);
+      break;
     case PROP_USE_OPENCL:
       g_value_set_boolean (value, gegl_config->use_opencl);
       break;
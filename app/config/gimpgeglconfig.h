@@ -37,8 +37,11 @@ struct _GimpGeglConfig
 
   gchar    *temp_path;
   gchar    *swap_path;
+  gboolean  swap_compression;
   guint     num_processors;
+  gboolean  num_processors_auto;
   guint64   tile_cache_size;
+  gboolean  tile_cache_size_auto;
   gboolean  use_opencl;
 };
 
@@ -245,6 +245,10 @@ N_("Sets the size of the navigation preview available in the lower right " \
 #define NUM_PROCESSORS_BLURB \
 N_("Sets how many processors GIMP should try to use simultaneously.")
 
+#define NUM_PROCESSORS_AUTO_BLURB \
+N_("When enabled, GIMP uses all processors which are online instead of " \
+   "the number of processors set in num-processors.")
+
 #define PALETTE_PATH_BLURB \
 "Sets the palette search path."
 
@@ -271,6 +275,11 @@ N_("When enabled, the X server is queried for the mouse's current position " \
 #define PLUGINRC_PATH_BLURB \
 "Sets the pluginrc search path."
 
+#define LAZY_DATA_LOADING_BLURB \
+N_("When enabled, brushes and patterns are only fully loaded when they " \
+   "are first used.  An index of the data folders is kept to speed up " \
+   "startup.")
+
 #define LAYER_PREVIEWS_BLURB \
 N_("Sets whether GIMP should create previews of layers and channels. " \
    "Previews in the layers and channels dialog are nice to have but they " \
@@ -372,6 +381,10 @@ N_("Hide docks and other windows, leaving only image windows.")
 #define SPACE_BAR_ACTION_BLURB \
 N_("What to do when the space bar is pressed in the image window.")
 
+#define SWAP_COMPRESSION_BLURB \
+N_("When enabled, tiles are compressed with a fast codec before they are " \
+   "written to the swap file.  This needs GEGL 0.4.14 or newer.")
+
 #define SWAP_PATH_BLURB \
 N_("Sets the swap file location. GIMP uses a tile based memory allocation " \
    "scheme. The swap file is used to quickly and easily swap tiles out to " \
@@ -419,6 +432,10 @@ N_("When the amount of pixel data exceeds this limit, GIMP will start to " \
    "work on images that wouldn't fit into memory otherwise.  If you have a " \
    "lot of RAM, you may want to set this to a higher value.")
 
+#define TILE_CACHE_SIZE_AUTO_BLURB \
+N_("When enabled, GIMP sizes the tile cache from the installed and the " \
+   "currently available amount of memory, and adjusts it while running.")
+
 #define TOOLBOX_COLOR_AREA_BLURB \
 N_("Show the current foreground and background colors in the toolbox.")
 
@@ -474,4 +491,9 @@ N_("When enabled, uses OpenCL for some operations.")
 "Bugs in event history buffer are frequent so in case of cursor " \
 "offset problems turning it off helps."
 
+#define ACCELERATED_CANVAS_BLURB \
+"When enabled, the rendered image is kept in surfaces of the windowing " \
+"system, so scrolling and compositing the canvas can be done by the " \
+"graphics hardware.  Turn this off if the canvas shows drawing problems."
+
 #endif  /* __GIMP_RC_BLURBS_H__ */
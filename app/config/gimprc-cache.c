@@ -0,0 +1,373 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995-1997 Spencer Kimball and Peter Mattis
+ *
+ * Snapshot of the rc files read at startup.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <sys/types.h>
+
+#include <glib-object.h>
+#include <glib/gstdio.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpconfig/gimpconfig.h"
+
+#ifdef G_OS_WIN32
+#include "libgimpbase/gimpwin32-io.h"
+#endif
+
+#include "config-types.h"
+
+#include "gimprc-cache.h"
+
+
+/*  The snapshot keeps the contents of the rc files GIMP reads at
+ *  startup (sessionrc, menurc, toolrc, devicerc) in a single file,
+ *  together with each file's mtime and size. A file whose stat
+ *  matches its entry is parsed from the snapshot instead of being
+ *  opened on its own; everything else goes to the text file, which
+ *  always stays the source of truth.
+ *
+ *  The snapshot is loaded with one read the first time a file is
+ *  looked up, and rewritten by gimp_rc_cache_save() after the rc
+ *  files have been saved on exit.
+ */
+
+#define RC_CACHE_NAME    "rccache"
+#define RC_CACHE_VERSION 1
+#define RC_CACHE_TYPE    "(ua(sxxay))"
+#define RC_ENTRY_TYPE    "(sxxay)"
+
+
+static void       gimp_rc_cache_load  (void);
+static GVariant * gimp_rc_cache_lookup (const gchar *filename,
+                                        gint64       mtime,
+                                        gint64       size);
+static gboolean   gimp_rc_cache_stat   (const gchar *filename,
+                                        gint64      *mtime,
+                                        gint64      *size);
+
+
+static gboolean    rc_cache_loaded = FALSE;
+static GVariant   *rc_cache        = NULL;
+static GHashTable *rc_cache_files  = NULL;
+
+
+/*  public functions  */
+
+/**
+ * gimp_rc_cache_get_contents:
+ * @filename: an rc file
+ * @length:   returns the length of the contents
+ *
+ * Return value: the snapshotted contents of @filename, or %NULL if
+ *               the file changed since the snapshot was taken. The
+ *               contents are not nul-terminated and stay valid
+ *               until gimp_rc_cache_save() is called.
+ **/
+const gchar *
+gimp_rc_cache_get_contents (const gchar *filename,
+                            gsize       *length)
+{
+  GVariant    *entry;
+  GVariant    *contents;
+  const gchar *data;
+  gint64       mtime;
+  gint64       size;
+
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (length != NULL, NULL);
+
+  gimp_rc_cache_load ();
+
+  /*  remember the file, so the next snapshot includes it  */
+  g_hash_table_add (rc_cache_files, g_strdup (filename));
+
+  if (! gimp_rc_cache_stat (filename, &mtime, &size))
+    return NULL;
+
+  entry = gimp_rc_cache_lookup (filename, mtime, size);
+
+  if (! entry)
+    return NULL;
+
+  contents = g_variant_get_child_value (entry, 3);
+  data     = g_variant_get_fixed_array (contents, length, sizeof (gchar));
+
+  /*  the data belongs to rc_cache, which outlives both references  */
+  g_variant_unref (contents);
+  g_variant_unref (entry);
+
+  return data;
+}
+
+/**
+ * gimp_rc_cache_scanner_new:
+ * @filename: an rc file
+ * @error:    return location for an error
+ *
+ * Works like gimp_scanner_new_file(), but takes the contents from
+ * the snapshot if @filename didn't change.
+ *
+ * Return value: a #GScanner, free it with gimp_scanner_destroy().
+ **/
+GScanner *
+gimp_rc_cache_scanner_new (const gchar  *filename,
+                           GError      **error)
+{
+  const gchar *contents;
+  gsize        length;
+
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  contents = gimp_rc_cache_get_contents (filename, &length);
+
+  if (contents)
+    return gimp_scanner_new_string (contents, length, error);
+
+  return gimp_scanner_new_file (filename, error);
+}
+
+/**
+ * gimp_rc_cache_deserialize:
+ * @config:   a #GimpConfig
+ * @filename: the rc file to deserialize @config from
+ * @data:     client data
+ * @error:    return location for an error
+ *
+ * Works like gimp_config_deserialize_file(), but takes the contents
+ * from the snapshot if @filename didn't change.
+ *
+ * Return value: %TRUE if deserialization succeeded.
+ **/
+gboolean
+gimp_rc_cache_deserialize (GimpConfig   *config,
+                           const gchar  *filename,
+                           gpointer      data,
+                           GError      **error)
+{
+  const gchar *contents;
+  gsize        length;
+
+  g_return_val_if_fail (GIMP_IS_CONFIG (config), FALSE);
+  g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  contents = gimp_rc_cache_get_contents (filename, &length);
+
+  if (! contents)
+    return gimp_config_deserialize_file (config, filename, data, error);
+
+  if (! gimp_config_deserialize_string (config, contents, length,
+                                        data, error))
+    {
+      /*  the snapshot's scanner has no name, add the filename  */
+      if (error && *error)
+        g_prefix_error (error, "%s: ", gimp_filename_to_utf8 (filename));
+
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+/**
+ * gimp_rc_cache_save:
+ *
+ * Writes a new snapshot of all rc files looked up since startup,
+ * unless none of them changed. Call this after the rc files have
+ * been written on exit.
+ **/
+void
+gimp_rc_cache_save (void)
+{
+  GVariantBuilder  builder;
+  GHashTableIter   iter;
+  gpointer         key;
+  gboolean         changed = FALSE;
+  gchar           *cache_filename;
+  GVariant        *cache;
+
+  if (! rc_cache_loaded)
+    return;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a" RC_ENTRY_TYPE));
+
+  g_hash_table_iter_init (&iter, rc_cache_files);
+
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      const gchar *filename = key;
+      GVariant    *entry;
+      gchar       *contents;
+      gsize        length;
+      gint64       mtime;
+      gint64       size;
+
+      if (! gimp_rc_cache_stat (filename, &mtime, &size))
+        {
+          changed = TRUE;
+          continue;
+        }
+
+      entry = gimp_rc_cache_lookup (filename, mtime, size);
+
+      if (entry)
+        {
+          g_variant_builder_add_value (&builder, entry);
+          g_variant_unref (entry);
+          continue;
+        }
+
+      changed = TRUE;
+
+      if (! g_file_get_contents (filename, &contents, &length, NULL))
+        continue;
+
+      /*  don't snapshot a file that is being written right now  */
+      if (length == size)
+        {
+          GVariant *bytes;
+
+          bytes = g_variant_new_fixed_array (G_VARIANT_TYPE_BYTE,
+                                             contents, length,
+                                             sizeof (gchar));
+
+          g_variant_builder_add (&builder, "(sxx@ay)",
+                                 filename, mtime, size, bytes);
+        }
+
+      g_free (contents);
+    }
+
+  cache = g_variant_ref_sink (g_variant_new (RC_CACHE_TYPE,
+                                             RC_CACHE_VERSION, &builder));
+
+  cache_filename = gimp_personal_rc_file (RC_CACHE_NAME);
+
+  /*  failing to write the snapshot only costs the next startup time  */
+  if (changed)
+    g_file_set_contents (cache_filename,
+                         g_variant_get_data (cache),
+                         g_variant_get_size (cache),
+                         NULL);
+
+  g_free (cache_filename);
+  g_variant_unref (cache);
+
+  g_clear_pointer (&rc_cache, g_variant_unref);
+  g_clear_pointer (&rc_cache_files, g_hash_table_unref);
+
+  rc_cache_loaded = FALSE;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_rc_cache_load (void)
+{
+  gchar *cache_filename;
+  gchar *data;
+  gsize  length;
+
+  if (rc_cache_loaded)
+    return;
+
+  rc_cache_loaded = TRUE;
+  rc_cache_files  = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free, NULL);
+
+  cache_filename = gimp_personal_rc_file (RC_CACHE_NAME);
+
+  if (g_file_get_contents (cache_filename, &data, &length, NULL))
+    {
+      GVariant *cache;
+      guint32   version;
+
+      cache = g_variant_new_from_data (G_VARIANT_TYPE (RC_CACHE_TYPE),
+                                       data, length, FALSE,
+                                       (GDestroyNotify) g_free, data);
+
+      g_variant_get_child (cache, 0, "u", &version);
+
+      if (version == RC_CACHE_VERSION)
+        rc_cache = g_variant_get_child_value (cache, 1);
+
+      g_variant_unref (cache);
+    }
+
+  g_free (cache_filename);
+}
+
+static GVariant *
+gimp_rc_cache_lookup (const gchar *filename,
+                      gint64       mtime,
+                      gint64       size)
+{
+  gsize n_entries;
+  gsize i;
+
+  if (! rc_cache)
+    return NULL;
+
+  n_entries = g_variant_n_children (rc_cache);
+
+  for (i = 0; i < n_entries; i++)
+    {
+      GVariant    *entry = g_variant_get_child_value (rc_cache, i);
+      const gchar *entry_filename;
+      gint64       entry_mtime;
+      gint64       entry_size;
+
+      g_variant_get (entry, "(&sxx@ay)",
+                     &entry_filename, &entry_mtime, &entry_size, NULL);
+
+      if (! strcmp (entry_filename, filename))
+        {
+          if (entry_mtime == mtime && entry_size == size)
+            return entry;
+
+          g_variant_unref (entry);
+
+          return NULL;
+        }
+
+      g_variant_unref (entry);
+    }
+
+  return NULL;
+}
+
+static gboolean
+gimp_rc_cache_stat (const gchar *filename,
+                    gint64      *mtime,
+                    gint64      *size)
+{
+  GStatBuf buf;
+
+  if (g_stat (filename, &buf) != 0 || ! S_ISREG (buf.st_mode))
+    return FALSE;
+
+  *mtime = buf.st_mtime;
+  *size  = buf.st_size;
+
+  return TRUE;
+}
@@ -202,8 +202,10 @@ typedef struct _GimpBoundSeg        GimpBoundSeg;
 typedef struct _GimpCoords          GimpCoords;
 typedef struct _GimpGradientSegment GimpGradientSegment;
 typedef struct _GimpPaletteEntry    GimpPaletteEntry;
+typedef struct _GimpPreviewRequest  GimpPreviewRequest;
 typedef struct _GimpSamplePoint     GimpSamplePoint;
 typedef struct _GimpScanConvert     GimpScanConvert;
+typedef struct _GimpStartup         GimpStartup;
 typedef struct _GimpTempBuf         GimpTempBuf;
 typedef         guint32             GimpTattoo;
 
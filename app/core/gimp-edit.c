@@ -29,6 +29,7 @@
 #include "core-types.h"
 
 #include "gegl/gimp-gegl-utils.h"
+#include "gegl/gimpcompressedbuffer.h"
 
 #include "gimp.h"
 #include "gimp-edit.h"
@@ -573,8 +574,8 @@ gimp_edit_fade (GimpImage   *image,
 
       gimp_drawable_apply_buffer (drawable, buffer,
                                   GEGL_RECTANGLE (0, 0,
-                                                  gegl_buffer_get_width (undo->buffer),
-                                                  gegl_buffer_get_height (undo->buffer)),
+                                                  gimp_compressed_buffer_get_width (undo->buffer),
+                                                  gimp_compressed_buffer_get_height (undo->buffer)),
                                   TRUE,
                                   gimp_object_get_name (undo),
                                   gimp_context_get_opacity (context),
@@ -0,0 +1,391 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-parallel.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "config/gimpgeglconfig.h"
+
+#include "gimp.h"
+#include "gimp-parallel.h"
+
+
+#define GIMP_PARALLEL_MAX_THREADS 64
+
+
+typedef struct
+{
+  GimpParallelDistributeFunc  func;
+  gint                        n;
+  gpointer                    user_data;
+
+  gint                        remaining;
+  GMutex                      mutex;
+  GCond                       cond;
+} GimpParallelTask;
+
+typedef struct
+{
+  GimpParallelTask *task;
+  gint              i;
+} GimpParallelTaskItem;
+
+typedef struct
+{
+  GimpParallelDistributeRangeFunc  func;
+  gsize                            size;
+  gpointer                         user_data;
+} GimpParallelDistributeRangeData;
+
+typedef struct
+{
+  GimpParallelDistributeAreaFunc  func;
+  const GeglRectangle            *area;
+  gpointer                        user_data;
+} GimpParallelDistributeAreaData;
+
+
+/*  local function prototypes  */
+
+static void   gimp_parallel_notify_num_processors (GimpGeglConfig       *config);
+static void   gimp_parallel_set_n_threads         (gint                  n_threads);
+
+static void   gimp_parallel_thread_func           (GimpParallelTaskItem *item,
+                                                   gpointer              data);
+
+static void   gimp_parallel_distribute_range_func (gint                  i,
+                                                   gint                  n,
+                                                   GimpParallelDistributeRangeData *data);
+static void   gimp_parallel_distribute_area_func  (gint                  i,
+                                                   gint                  n,
+                                                   GimpParallelDistributeAreaData  *data);
+
+
+/*  local variables  */
+
+static GThreadPool *gimp_parallel_pool      = NULL;
+static gint         gimp_parallel_n_threads = 1;
+
+/*  set for threads which are currently running parallel work, so that
+ *  nested distribute calls run serially instead of deadlocking the pool
+ */
+static GPrivate     gimp_parallel_busy;
+
+
+/*  public functions  */
+
+void
+gimp_parallel_init (Gimp *gimp)
+{
+  GimpGeglConfig *config;
+
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  config = GIMP_GEGL_CONFIG (gimp->config);
+
+  g_signal_connect (config, "notify::num-processors",
+                    G_CALLBACK (gimp_parallel_notify_num_processors),
+                    NULL);
+
+  gimp_parallel_notify_num_processors (config);
+}
+
+void
+gimp_parallel_exit (Gimp *gimp)
+{
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  g_signal_handlers_disconnect_by_func (gimp->config,
+                                        gimp_parallel_notify_num_processors,
+                                        NULL);
+
+  /*  wait for all pending work before shutting down  */
+  if (gimp_parallel_pool)
+    {
+      g_thread_pool_free (gimp_parallel_pool, FALSE, TRUE);
+      gimp_parallel_pool = NULL;
+    }
+
+  g_atomic_int_set (&gimp_parallel_n_threads, 1);
+}
+
+gint
+gimp_parallel_get_n_threads (void)
+{
+  return g_atomic_int_get (&gimp_parallel_n_threads);
+}
+
+/**
+ * gimp_parallel_distribute:
+ * @max_n:     the maximal number of parts, or -1 for the number of threads
+ * @func:      the function to call for each part
+ * @user_data: data to pass to @func
+ *
+ * Calls @func @n times, with @i ranging from 0 to @n - 1, where @n is
+ * the number of threads configured by the "num-processors" gimprc
+ * setting, but never more than @max_n.  The calls are distributed
+ * over the worker threads, and this function returns only after all
+ * of them are finished.
+ *
+ * The calling thread participates in the work.  Calling this function
+ * from within @func runs the nested work serially.
+ **/
+void
+gimp_parallel_distribute (gint                       max_n,
+                          GimpParallelDistributeFunc func,
+                          gpointer                   user_data)
+{
+  GimpParallelTask     task;
+  GimpParallelTaskItem items[GIMP_PARALLEL_MAX_THREADS];
+  gint                 n;
+  gint                 i;
+
+  g_return_if_fail (func != NULL);
+
+  if (max_n == 0)
+    return;
+
+  n = gimp_parallel_get_n_threads ();
+
+  if (max_n > 0)
+    n = MIN (n, max_n);
+
+  if (n == 1 || ! gimp_parallel_pool || g_private_get (&gimp_parallel_busy))
+    {
+      func (0, 1, user_data);
+
+      return;
+    }
+
+  task.func      = func;
+  task.n         = n;
+  task.user_data = user_data;
+  task.remaining = n - 1;
+
+  g_mutex_init (&task.mutex);
+  g_cond_init (&task.cond);
+
+  for (i = 1; i < n; i++)
+    {
+      items[i].task = &task;
+      items[i].i    = i;
+
+      g_thread_pool_push (gimp_parallel_pool, &items[i], NULL);
+    }
+
+  g_private_set (&gimp_parallel_busy, GINT_TO_POINTER (TRUE));
+
+  func (0, n, user_data);
+
+  g_private_set (&gimp_parallel_busy, NULL);
+
+  g_mutex_lock (&task.mutex);
+
+  while (task.remaining > 0)
+    g_cond_wait (&task.cond, &task.mutex);
+
+  g_mutex_unlock (&task.mutex);
+
+  g_cond_clear (&task.cond);
+  g_mutex_clear (&task.mutex);
+}
+
+/**
+ * gimp_parallel_distribute_range:
+ * @size:         the size of the range
+ * @min_sub_size: the minimal size of each sub-range, or 0
+ * @func:         the function to call for each sub-range
+ * @user_data:    data to pass to @func
+ *
+ * Splits the range [0, @size) into consecutive sub-ranges of at least
+ * @min_sub_size, and processes them in parallel using
+ * gimp_parallel_distribute().
+ **/
+void
+gimp_parallel_distribute_range (gsize                           size,
+                                gsize                           min_sub_size,
+                                GimpParallelDistributeRangeFunc func,
+                                gpointer                        user_data)
+{
+  GimpParallelDistributeRangeData data;
+  gsize                           n = size;
+
+  g_return_if_fail (func != NULL);
+
+  if (size == 0)
+    return;
+
+  if (min_sub_size > 1)
+    n /= min_sub_size;
+
+  n = CLAMP (n, 1, GIMP_PARALLEL_MAX_THREADS);
+
+  data.func      = func;
+  data.size      = size;
+  data.user_data = user_data;
+
+  gimp_parallel_distribute (n,
+                            (GimpParallelDistributeFunc)
+                            gimp_parallel_distribute_range_func,
+                            &data);
+}
+
+/**
+ * gimp_parallel_distribute_area:
+ * @area:         the area to process
+ * @min_sub_area: the minimal number of pixels of each sub-area, or 0
+ * @func:         the function to call for each sub-area
+ * @user_data:    data to pass to @func
+ *
+ * Splits @area into stripes of at least @min_sub_area pixels, cut
+ * across its longer dimension, and processes them in parallel using
+ * gimp_parallel_distribute().
+ **/
+void
+gimp_parallel_distribute_area (const GeglRectangle            *area,
+                               gsize                           min_sub_area,
+                               GimpParallelDistributeAreaFunc  func,
+                               gpointer                        user_data)
+{
+  GimpParallelDistributeAreaData data;
+  gsize                          n;
+
+  g_return_if_fail (area != NULL);
+  g_return_if_fail (func != NULL);
+
+  if (area->width <= 0 || area->height <= 0)
+    return;
+
+  n = (gsize) area->width * (gsize) area->height;
+
+  if (min_sub_area > 1)
+    n /= min_sub_area;
+
+  n = CLAMP (n, 1, GIMP_PARALLEL_MAX_THREADS);
+  n = MIN (n, MAX (area->width, area->height));
+
+  data.func      = func;
+  data.area      = area;
+  data.user_data = user_data;
+
+  gimp_parallel_distribute (n,
+                            (GimpParallelDistributeFunc)
+                            gimp_parallel_distribute_area_func,
+                            &data);
+}
+
+
+/*  private functions  */
+
+static void
+gimp_parallel_notify_num_processors (GimpGeglConfig *config)
+{
+  gimp_parallel_set_n_threads (config->num_processors);
+}
+
+static void
+gimp_parallel_set_n_threads (gint n_threads)
+{
+  n_threads = CLAMP (n_threads, 1, GIMP_PARALLEL_MAX_THREADS);
+
+  if (n_threads > 1)
+    {
+      /*  the calling thread always participates, so the pool only
+       *  needs n_threads - 1 workers
+       */
+      if (! gimp_parallel_pool)
+        {
+          gimp_parallel_pool =
+            g_thread_pool_new ((GFunc) gimp_parallel_thread_func, NULL,
+                               n_threads - 1, FALSE, NULL);
+        }
+      else
+        {
+          g_thread_pool_set_max_threads (gimp_parallel_pool,
+                                         n_threads - 1, NULL);
+        }
+    }
+
+  g_atomic_int_set (&gimp_parallel_n_threads, n_threads);
+}
+
+static void
+gimp_parallel_thread_func (GimpParallelTaskItem *item,
+                           gpointer              data)
+{
+  GimpParallelTask *task = item->task;
+
+  g_private_set (&gimp_parallel_busy, GINT_TO_POINTER (TRUE));
+
+  task->func (item->i, task->n, task->user_data);
+
+  g_private_set (&gimp_parallel_busy, NULL);
+
+  g_mutex_lock (&task->mutex);
+
+  if (--task->remaining == 0)
+    g_cond_signal (&task->cond);
+
+  g_mutex_unlock (&task->mutex);
+}
+
+static void
+gimp_parallel_distribute_range_func (gint                             i,
+                                     gint                             n,
+                                     GimpParallelDistributeRangeData *data)
+{
+  gsize offset;
+  gsize end;
+
+  offset = data->size * i       / n;
+  end    = data->size * (i + 1) / n;
+
+  if (end > offset)
+    data->func (offset, end - offset, data->user_data);
+}
+
+static void
+gimp_parallel_distribute_area_func (gint                            i,
+                                    gint                            n,
+                                    GimpParallelDistributeAreaData *data)
+{
+  const GeglRectangle *area = data->area;
+  GeglRectangle        sub_area;
+
+  if (area->width >= area->height)
+    {
+      gint x1 = area->x + (gint) ((gint64) area->width * i       / n);
+      gint x2 = area->x + (gint) ((gint64) area->width * (i + 1) / n);
+
+      gegl_rectangle_set (&sub_area, x1, area->y, x2 - x1, area->height);
+    }
+  else
+    {
+      gint y1 = area->y + (gint) ((gint64) area->height * i       / n);
+      gint y2 = area->y + (gint) ((gint64) area->height * (i + 1) / n);
+
+      gegl_rectangle_set (&sub_area, area->x, y1, area->width, y2 - y1);
+    }
+
+  if (! gegl_rectangle_is_empty (&sub_area))
+    data->func (&sub_area, data->user_data);
+}
@@ -0,0 +1,470 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-startup.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdarg.h>
+#include <string.h>
+
+#include <gegl.h>
+
+#include "core-types.h"
+
+#include "gimp.h"
+#include "gimp-parallel.h"
+#include "gimp-startup.h"
+
+
+typedef enum
+{
+  TASK_WAITING,
+  TASK_RUNNING,
+  TASK_DONE
+} GimpStartupTaskState;
+
+typedef struct _GimpStartupTask GimpStartupTask;
+
+struct _GimpStartupTask
+{
+  GimpStartup           *startup;
+
+  gchar                 *name;
+  gchar                 *status;
+  gboolean               required;
+
+  GimpStartupThreadFunc  thread_func;
+  GimpStartupMainFunc    main_func;
+  gpointer               user_data;
+
+  GList                 *dependencies;
+
+  GimpStartupTaskState   state;
+  gpointer               result;
+};
+
+struct _GimpStartup
+{
+  volatile gint  ref_count;
+
+  Gimp          *gimp;
+
+  GList         *tasks;
+
+  gint           n_tasks;
+  gint           n_done;
+  gint           n_required;
+  gint           n_required_done;
+
+  GThreadPool   *pool;
+  GAsyncQueue   *done_queue;
+
+  /*  set when gimp_startup_run() has returned  */
+  volatile gint  background;
+  gboolean       finished;
+};
+
+
+/*  local function prototypes  */
+
+static GimpStartup     * gimp_startup_ref          (GimpStartup     *startup);
+static void              gimp_startup_unref        (GimpStartup     *startup);
+
+static GimpStartupTask * gimp_startup_find_task    (GimpStartup     *startup,
+                                                    const gchar     *name);
+static void              gimp_startup_require      (GimpStartupTask *task);
+static GimpStartupTask * gimp_startup_dispatch     (GimpStartup     *startup,
+                                                    gboolean         background);
+static void              gimp_startup_run_main     (GimpStartup     *startup,
+                                                    GimpStartupTask *task);
+static void              gimp_startup_done         (GimpStartup     *startup);
+
+static void              gimp_startup_thread_func  (GimpStartupTask *task,
+                                                    GimpStartup     *startup);
+static gboolean          gimp_startup_idle         (GimpStartup     *startup);
+
+
+/*  public functions  */
+
+GimpStartup *
+gimp_startup_new (Gimp *gimp)
+{
+  GimpStartup *startup;
+
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), NULL);
+  g_return_val_if_fail (gimp->startup == NULL, NULL);
+
+  startup = g_slice_new0 (GimpStartup);
+
+  startup->ref_count  = 1;
+  startup->gimp       = gimp;
+  startup->done_queue = g_async_queue_new ();
+  startup->pool       = g_thread_pool_new ((GFunc) gimp_startup_thread_func,
+                                           startup,
+                                           gimp_parallel_get_n_threads (),
+                                           FALSE, NULL);
+
+  return startup;
+}
+
+/**
+ * gimp_startup_add_task:
+ * @startup:          a #GimpStartup
+ * @name:             the task's name, used for dependencies
+ * @status:           the text to show while the task is running
+ * @required:         whether the task must be done before
+ *                    gimp_startup_run() returns
+ * @thread_func:      the part of the task that runs in a worker thread,
+ *                    or %NULL
+ * @main_func:        the part of the task that runs in the main thread
+ *                    after @thread_func, or %NULL
+ * @user_data:        data to pass to @thread_func and @main_func
+ * @first_dependency: the name of the first task that must be done
+ *                    before this one can start, followed by more names
+ *                    and %NULL
+ *
+ * Adds a task.  Dependencies on tasks that were not added before are
+ * ignored, which also keeps the dependencies free of cycles.  All
+ * dependencies of a required task become required too.
+ **/
+void
+gimp_startup_add_task (GimpStartup           *startup,
+                       const gchar           *name,
+                       const gchar           *status,
+                       gboolean               required,
+                       GimpStartupThreadFunc  thread_func,
+                       GimpStartupMainFunc    main_func,
+                       gpointer               user_data,
+                       const gchar           *first_dependency,
+                       ...)
+{
+  GimpStartupTask *task;
+  const gchar     *dependency;
+  va_list          args;
+
+  g_return_if_fail (startup != NULL);
+  g_return_if_fail (name != NULL);
+  g_return_if_fail (thread_func != NULL || main_func != NULL);
+  g_return_if_fail (gimp_startup_find_task (startup, name) == NULL);
+
+  task = g_slice_new0 (GimpStartupTask);
+
+  task->startup     = startup;
+  task->name        = g_strdup (name);
+  task->status      = g_strdup (status);
+  task->thread_func = thread_func;
+  task->main_func   = main_func;
+  task->user_data   = user_data;
+  task->state       = TASK_WAITING;
+
+  va_start (args, first_dependency);
+
+  for (dependency = first_dependency;
+       dependency;
+       dependency = va_arg (args, const gchar *))
+    {
+      GimpStartupTask *dep = gimp_startup_find_task (startup, dependency);
+
+      if (dep)
+        task->dependencies = g_list_prepend (task->dependencies, dep);
+    }
+
+  va_end (args);
+
+  startup->tasks = g_list_append (startup->tasks, task);
+  startup->n_tasks++;
+
+  if (required)
+    gimp_startup_require (task);
+}
+
+/**
+ * gimp_startup_run:
+ * @startup:         a #GimpStartup
+ * @status_callback: the callback to report progress to
+ *
+ * Runs the tasks until all required tasks are done.  The remaining
+ * tasks keep running in the background, their main parts are run from
+ * idle handlers.  @startup is freed when all tasks are done, until
+ * then it is available as gimp->startup.
+ **/
+void
+gimp_startup_run (GimpStartup        *startup,
+                  GimpInitStatusFunc  status_callback)
+{
+  g_return_if_fail (startup != NULL);
+  g_return_if_fail (status_callback != NULL);
+
+  startup->gimp->startup = startup;
+
+  while (startup->n_required_done < startup->n_required)
+    {
+      GimpStartupTask *task;
+
+      task = gimp_startup_dispatch (startup, FALSE);
+
+      if (! task)
+        task = g_async_queue_try_pop (startup->done_queue);
+
+      if (! task)
+        {
+          GList *list;
+
+          for (list = startup->tasks; list; list = g_list_next (list))
+            {
+              GimpStartupTask *running = list->data;
+
+              if (running->required && running->state == TASK_RUNNING)
+                {
+                  status_callback (NULL, running->status,
+                                   (gdouble) startup->n_required_done /
+                                   (gdouble) startup->n_required);
+                  break;
+                }
+            }
+
+          task = g_async_queue_pop (startup->done_queue);
+        }
+
+      if (task->required)
+        status_callback (NULL, task->status,
+                         (gdouble) startup->n_required_done /
+                         (gdouble) startup->n_required);
+
+      gimp_startup_run_main (startup, task);
+    }
+
+  g_atomic_int_set (&startup->background, TRUE);
+
+  /*  pick up the tasks that finished while we were busy  */
+  g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                   (GSourceFunc) gimp_startup_idle,
+                   gimp_startup_ref (startup),
+                   (GDestroyNotify) gimp_startup_unref);
+}
+
+/**
+ * gimp_startup_finish:
+ * @startup: a #GimpStartup
+ *
+ * Blocks until all tasks are done, for example before exiting.
+ **/
+void
+gimp_startup_finish (GimpStartup *startup)
+{
+  g_return_if_fail (startup != NULL);
+
+  while (startup->n_done < startup->n_tasks)
+    {
+      GimpStartupTask *task = gimp_startup_dispatch (startup, TRUE);
+
+      if (! task)
+        task = g_async_queue_pop (startup->done_queue);
+
+      gimp_startup_run_main (startup, task);
+    }
+
+  gimp_startup_done (startup);
+}
+
+
+/*  private functions  */
+
+static GimpStartup *
+gimp_startup_ref (GimpStartup *startup)
+{
+  g_atomic_int_inc (&startup->ref_count);
+
+  return startup;
+}
+
+static void
+gimp_startup_unref (GimpStartup *startup)
+{
+  if (g_atomic_int_dec_and_test (&startup->ref_count))
+    {
+      GList *list;
+
+      for (list = startup->tasks; list; list = g_list_next (list))
+        {
+          GimpStartupTask *task = list->data;
+
+          g_list_free (task->dependencies);
+          g_free (task->name);
+          g_free (task->status);
+
+          g_slice_free (GimpStartupTask, task);
+        }
+
+      g_list_free (startup->tasks);
+
+      g_async_queue_unref (startup->done_queue);
+
+      g_slice_free (GimpStartup, startup);
+    }
+}
+
+static GimpStartupTask *
+gimp_startup_find_task (GimpStartup *startup,
+                        const gchar *name)
+{
+  GList *list;
+
+  for (list = startup->tasks; list; list = g_list_next (list))
+    {
+      GimpStartupTask *task = list->data;
+
+      if (! strcmp (task->name, name))
+        return task;
+    }
+
+  return NULL;
+}
+
+static void
+gimp_startup_require (GimpStartupTask *task)
+{
+  GList *list;
+
+  if (task->required)
+    return;
+
+  task->required = TRUE;
+  task->startup->n_required++;
+
+  for (list = task->dependencies; list; list = g_list_next (list))
+    gimp_startup_require (list->data);
+}
+
+/*  Starts the thread parts of all tasks whose dependencies are done,
+ *  and returns a task whose main part can run without a thread part.
+ *  Unless in @background, only required tasks are returned.
+ */
+static GimpStartupTask *
+gimp_startup_dispatch (GimpStartup *startup,
+                       gboolean     background)
+{
+  GList *list;
+
+  for (list = startup->tasks; list; list = g_list_next (list))
+    {
+      GimpStartupTask *task = list->data;
+      GList           *deps;
+
+      if (task->state != TASK_WAITING)
+        continue;
+
+      for (deps = task->dependencies; deps; deps = g_list_next (deps))
+        {
+          GimpStartupTask *dep = deps->data;
+
+          if (dep->state != TASK_DONE)
+            break;
+        }
+
+      if (deps)
+        continue;
+
+      if (task->thread_func)
+        {
+          task->state = TASK_RUNNING;
+
+          g_thread_pool_push (startup->pool, task, NULL);
+        }
+      else if (background || task->required)
+        {
+          task->state = TASK_RUNNING;
+
+          return task;
+        }
+    }
+
+  return NULL;
+}
+
+static void
+gimp_startup_run_main (GimpStartup     *startup,
+                       GimpStartupTask *task)
+{
+  if (startup->gimp->be_verbose)
+    g_print ("Startup task '%s' done\n", task->name);
+
+  if (task->main_func)
+    task->main_func (startup->gimp, task->result, task->user_data);
+
+  task->state  = TASK_DONE;
+  task->result = NULL;
+
+  startup->n_done++;
+
+  if (task->required)
+    startup->n_required_done++;
+}
+
+static void
+gimp_startup_done (GimpStartup *startup)
+{
+  if (startup->finished)
+    return;
+
+  startup->finished = TRUE;
+
+  /*  all tasks are done, so this doesn't block  */
+  g_thread_pool_free (startup->pool, FALSE, TRUE);
+  startup->pool = NULL;
+
+  if (startup->gimp->startup == startup)
+    startup->gimp->startup = NULL;
+
+  gimp_startup_unref (startup);
+}
+
+static void
+gimp_startup_thread_func (GimpStartupTask *task,
+                          GimpStartup     *startup)
+{
+  task->result = task->thread_func (startup->gimp, task->user_data);
+
+  g_async_queue_push (startup->done_queue, task);
+
+  if (g_atomic_int_get (&startup->background))
+    g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
+                     (GSourceFunc) gimp_startup_idle,
+                     gimp_startup_ref (startup),
+                     (GDestroyNotify) gimp_startup_unref);
+}
+
+static gboolean
+gimp_startup_idle (GimpStartup *startup)
+{
+  GimpStartupTask *task;
+
+  if (startup->finished)
+    return FALSE;
+
+  while ((task = g_async_queue_try_pop (startup->done_queue)) ||
+         (task = gimp_startup_dispatch (startup, TRUE)))
+    {
+      gimp_startup_run_main (startup, task);
+    }
+
+  if (startup->n_done == startup->n_tasks)
+    gimp_startup_done (startup);
+
+  return FALSE;
+}
@@ -0,0 +1,53 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-startup.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_STARTUP_H__
+#define __GIMP_STARTUP_H__
+
+
+/*  A startup task has an optional part that runs in a worker thread,
+ *  and must not touch any shared state, and an optional part that
+ *  runs in the main thread afterwards and gets the thread part's
+ *  result.
+ */
+typedef gpointer (* GimpStartupThreadFunc) (Gimp     *gimp,
+                                            gpointer  user_data);
+typedef void     (* GimpStartupMainFunc)   (Gimp     *gimp,
+                                            gpointer  result,
+                                            gpointer  user_data);
+
+
+GimpStartup * gimp_startup_new      (Gimp                  *gimp);
+
+void          gimp_startup_add_task (GimpStartup           *startup,
+                                     const gchar           *name,
+                                     const gchar           *status,
+                                     gboolean               required,
+                                     GimpStartupThreadFunc  thread_func,
+                                     GimpStartupMainFunc    main_func,
+                                     gpointer               user_data,
+                                     const gchar           *first_dependency,
+                                     ...) G_GNUC_NULL_TERMINATED;
+
+void          gimp_startup_run      (GimpStartup           *startup,
+                                     GimpInitStatusFunc     status_callback);
+void          gimp_startup_finish   (GimpStartup           *startup);
+
+
+#endif /* __GIMP_STARTUP_H__ */
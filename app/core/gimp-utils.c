@@ -359,6 +359,61 @@ gimp_get_physical_memory_size (void)
   return 0;
 }
 
+/**
+ * gimp_get_available_memory_size:
+ *
+ * Returns: The amount of physical memory which can be allocated
+ * without swapping, including memory that the system would reclaim
+ * from its caches, or 0 if it can't be determined.
+ **/
+guint64
+gimp_get_available_memory_size (void)
+{
+#ifdef __linux__
+  gchar   *contents;
+  guint64  available = 0;
+
+  if (g_file_get_contents ("/proc/meminfo", &contents, NULL, NULL))
+    {
+      const gchar *line = strstr (contents, "MemAvailable:");
+
+      /*  kernels before 3.14 don't have MemAvailable  */
+      if (! line)
+        line = strstr (contents, "MemFree:");
+
+      if (line)
+        {
+          line = strchr (line, ':') + 1;
+
+          available = g_ascii_strtoull (line, NULL, 10) * 1024;
+        }
+
+      g_free (contents);
+    }
+
+  return available;
+#endif
+
+#ifdef G_OS_WIN32
+# if defined(_MSC_VER) && (_MSC_VER <= 1200)
+  MEMORYSTATUS memory_status;
+  memory_status.dwLength = sizeof (memory_status);
+
+  GlobalMemoryStatus (&memory_status);
+  return memory_status.dwAvailPhys;
+# else
+  MEMORYSTATUSEX memory_status;
+
+  memory_status.dwLength = sizeof (memory_status);
+
+  if (GlobalMemoryStatusEx (&memory_status))
+    return memory_status.ullAvailPhys;
+# endif
+#endif
+
+  return 0;
+}
+
 /**
  * gimp_get_backtrace:
  *
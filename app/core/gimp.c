@@ -46,6 +46,7 @@
 #include "gimp-gradients.h"
 #include "gimp-modules.h"
 #include "gimp-parasites.h"
+#include "gimp-startup.h"
 #include "gimp-templates.h"
 #include "gimp-units.h"
 #include "gimp-utils.h"
@@ -106,6 +107,32 @@ static void      gimp_real_restore         (Gimp              *gimp,
 static gboolean  gimp_real_exit            (Gimp              *gimp,
                                             gboolean           force);
 
+static void      gimp_restore_add_data_task  (Gimp            *gimp,
+                                              GimpStartup     *startup,
+                                              const gchar     *name,
+                                              const gchar     *status,
+                                              GimpDataFactory *factory,
+                                              gboolean         use_thread);
+static gpointer  gimp_restore_data_thread    (Gimp            *gimp,
+                                              gpointer         user_data);
+static void      gimp_restore_data_main      (Gimp            *gimp,
+                                              gpointer         result,
+                                              gpointer         user_data);
+static void      gimp_restore_parasites      (Gimp            *gimp,
+                                              gpointer         result,
+                                              gpointer         user_data);
+static void      gimp_restore_templates      (Gimp            *gimp,
+                                              gpointer         result,
+                                              gpointer         user_data);
+static void      gimp_restore_modules        (Gimp            *gimp,
+                                              gpointer         result,
+                                              gpointer         user_data);
+static gpointer  gimp_restore_tag_cache_load (Gimp            *gimp,
+                                              gpointer         user_data);
+static void      gimp_restore_tags           (Gimp            *gimp,
+                                              gpointer         result,
+                                              gpointer         user_data);
+
 static void      gimp_global_config_notify (GObject           *global_config,
                                             GParamSpec        *param_spec,
                                             GObject           *edit_config);
@@ -204,6 +231,7 @@ gimp_init (Gimp *gimp)
   gimp->pdb_compat_mode  = GIMP_PDB_COMPAT_OFF;
 
   gimp->restored         = FALSE;
+  gimp->startup          = NULL;
 
   gimp_gui_init (gimp);
 
@@ -557,41 +585,41 @@ gimp_real_initialize (Gimp               *gimp,
 {
   static const GimpDataFactoryLoaderEntry brush_loader_entries[] =
   {
-    { gimp_brush_load,           GIMP_BRUSH_FILE_EXTENSION,           FALSE },
-    { gimp_brush_load,           GIMP_BRUSH_PIXMAP_FILE_EXTENSION,    FALSE },
-    { gimp_brush_load_abr,       GIMP_BRUSH_PS_FILE_EXTENSION,        FALSE },
-    { gimp_brush_load_abr,       GIMP_BRUSH_PSP_FILE_EXTENSION,       FALSE },
-    { gimp_brush_generated_load, GIMP_BRUSH_GENERATED_FILE_EXTENSION, TRUE  },
-    { gimp_brush_pipe_load,      GIMP_BRUSH_PIPE_FILE_EXTENSION,      FALSE }
+    { gimp_brush_load,           GIMP_BRUSH_FILE_EXTENSION,           FALSE, TRUE,  gimp_brush_load_header },
+    { gimp_brush_load,           GIMP_BRUSH_PIXMAP_FILE_EXTENSION,    FALSE, TRUE,  gimp_brush_load_header },
+    { gimp_brush_load_abr,       GIMP_BRUSH_PS_FILE_EXTENSION,        FALSE, TRUE,  NULL },
+    { gimp_brush_load_abr,       GIMP_BRUSH_PSP_FILE_EXTENSION,       FALSE, TRUE,  NULL },
+    { gimp_brush_generated_load, GIMP_BRUSH_GENERATED_FILE_EXTENSION, TRUE,  FALSE, NULL },
+    { gimp_brush_pipe_load,      GIMP_BRUSH_PIPE_FILE_EXTENSION,      FALSE, FALSE, NULL }
   };
 
   static const GimpDataFactoryLoaderEntry dynamics_loader_entries[] =
   {
-    { gimp_dynamics_load,        GIMP_DYNAMICS_FILE_EXTENSION,        TRUE  }
+    { gimp_dynamics_load,        GIMP_DYNAMICS_FILE_EXTENSION,        TRUE,  FALSE, NULL }
   };
 
   static const GimpDataFactoryLoaderEntry pattern_loader_entries[] =
   {
-    { gimp_pattern_load,         GIMP_PATTERN_FILE_EXTENSION,         FALSE },
-    { gimp_pattern_load_pixbuf,  NULL,                                FALSE }
+    { gimp_pattern_load,         GIMP_PATTERN_FILE_EXTENSION,         FALSE, TRUE,  gimp_pattern_load_header },
+    { gimp_pattern_load_pixbuf,  NULL,                                FALSE, TRUE,  NULL }
   };
 
   static const GimpDataFactoryLoaderEntry gradient_loader_entries[] =
   {
-    { gimp_gradient_load,        GIMP_GRADIENT_FILE_EXTENSION,        TRUE  },
-    { gimp_gradient_load_svg,    GIMP_GRADIENT_SVG_FILE_EXTENSION,    FALSE },
-    { gimp_gradient_load,        NULL /* legacy loader */,            TRUE  }
+    { gimp_gradient_load,        GIMP_GRADIENT_FILE_EXTENSION,        TRUE,  FALSE, NULL },
+    { gimp_gradient_load_svg,    GIMP_GRADIENT_SVG_FILE_EXTENSION,    FALSE, FALSE, NULL },
+    { gimp_gradient_load,        NULL /* legacy loader */,            TRUE,  FALSE, NULL }
   };
 
   static const GimpDataFactoryLoaderEntry palette_loader_entries[] =
   {
-    { gimp_palette_load,         GIMP_PALETTE_FILE_EXTENSION,         TRUE  },
-    { gimp_palette_load,         NULL /* legacy loader */,            TRUE  }
+    { gimp_palette_load,         GIMP_PALETTE_FILE_EXTENSION,         TRUE,  FALSE, NULL },
+    { gimp_palette_load,         NULL /* legacy loader */,            TRUE,  FALSE, NULL }
   };
 
   static const GimpDataFactoryLoaderEntry tool_preset_loader_entries[] =
   {
-    { gimp_tool_preset_load,     GIMP_TOOL_PRESET_FILE_EXTENSION,     TRUE  }
+    { gimp_tool_preset_load,     GIMP_TOOL_PRESET_FILE_EXTENSION,     TRUE,  FALSE, NULL }
   };
 
   GimpData *clipboard_brush;
@@ -730,6 +758,10 @@ gimp_real_exit (Gimp     *gimp,
   if (gimp->be_verbose)
     g_print ("EXIT: %s\n", G_STRFUNC);
 
+  /*  let the startup tasks that are still running finish first  */
+  if (gimp->startup)
+    gimp_startup_finish (gimp->startup);
+
   gimp_plug_in_manager_exit (gimp->plug_in_manager);
   gimp_modules_unload (gimp);
 
@@ -931,6 +963,113 @@ gimp_load_config (Gimp        *gimp,
                            gimp->config, 0);
 }
 
+static void
+gimp_restore_add_data_task (Gimp            *gimp,
+                            GimpStartup     *startup,
+                            const gchar     *name,
+                            const gchar     *status,
+                            GimpDataFactory *factory,
+                            gboolean         use_thread)
+{
+  if (use_thread)
+    {
+      GimpDataFactoryLoad *load;
+
+      load = gimp_data_factory_data_init_begin (factory, gimp->user_context,
+                                                gimp->no_data);
+
+      gimp_startup_add_task (startup, name, status, TRUE,
+                             gimp_restore_data_thread,
+                             gimp_restore_data_main,
+                             load,
+                             NULL);
+    }
+  else
+    {
+      gimp_startup_add_task (startup, name, status, TRUE,
+                             NULL,
+                             gimp_restore_data_main,
+                             factory,
+                             NULL);
+    }
+}
+
+static gpointer
+gimp_restore_data_thread (Gimp     *gimp,
+                          gpointer  user_data)
+{
+  gimp_data_factory_data_init_load (user_data);
+
+  return user_data;
+}
+
+static void
+gimp_restore_data_main (Gimp     *gimp,
+                        gpointer  result,
+                        gpointer  user_data)
+{
+  if (result)
+    gimp_data_factory_data_init_finish (result);
+  else
+    gimp_data_factory_data_init (user_data, gimp->user_context,
+                                 gimp->no_data);
+}
+
+static void
+gimp_restore_parasites (Gimp     *gimp,
+                        gpointer  result,
+                        gpointer  user_data)
+{
+  gimp_parasiterc_load (gimp);
+}
+
+static void
+gimp_restore_templates (Gimp     *gimp,
+                        gpointer  result,
+                        gpointer  user_data)
+{
+  gimp_templates_load (gimp);
+}
+
+static void
+gimp_restore_modules (Gimp     *gimp,
+                      gpointer  result,
+                      gpointer  user_data)
+{
+  gimp_modules_load (gimp);
+}
+
+static gpointer
+gimp_restore_tag_cache_load (Gimp     *gimp,
+                             gpointer  user_data)
+{
+  /*  only fills the cache's records, which nobody looks at before
+   *  the containers are added
+   */
+  gimp_tag_cache_load (gimp->tag_cache);
+
+  return NULL;
+}
+
+static void
+gimp_restore_tags (Gimp     *gimp,
+                   gpointer  result,
+                   gpointer  user_data)
+{
+  gimp_tag_cache_add_container (gimp->tag_cache,
+                                gimp_data_factory_get_container (gimp->brush_factory));
+  gimp_tag_cache_add_container (gimp->tag_cache,
+                                gimp_data_factory_get_container (gimp->dynamics_factory));
+  gimp_tag_cache_add_container (gimp->tag_cache,
+                                gimp_data_factory_get_container (gimp->pattern_factory));
+  gimp_tag_cache_add_container (gimp->tag_cache,
+                                gimp_data_factory_get_container (gimp->gradient_factory));
+  gimp_tag_cache_add_container (gimp->tag_cache,
+                                gimp_data_factory_get_container (gimp->palette_factory));
+  gimp_tag_cache_add_container (gimp->tag_cache,
+                                gimp_data_factory_get_container (gimp->tool_preset_factory));
+}
+
 void
 gimp_initialize (Gimp               *gimp,
                  GimpInitStatusFunc  status_callback)
@@ -949,77 +1088,82 @@ void
 gimp_restore (Gimp               *gimp,
               GimpInitStatusFunc  status_callback)
 {
+  GimpStartup *startup;
+
   g_return_if_fail (GIMP_IS_GIMP (gimp));
   g_return_if_fail (status_callback != NULL);
 
   if (gimp->be_verbose)
     g_print ("INIT: %s\n", G_STRFUNC);
 
-  /*  initialize  the global parasite table  */
   status_callback (_("Looking for data files"), _("Parasites"), 0.0);
-  gimp_parasiterc_load (gimp);
 
-  /*  initialize the list of gimp brushes    */
-  status_callback (NULL, _("Brushes"), 0.1);
-  gimp_data_factory_data_init (gimp->brush_factory, gimp->user_context,
-                               gimp->no_data);
-
-  /*  initialize the list of gimp dynamics   */
-  status_callback (NULL, _("Dynamics"), 0.2);
-  gimp_data_factory_data_init (gimp->dynamics_factory, gimp->user_context,
-                               gimp->no_data);
-
-  /*  initialize the list of gimp patterns   */
-  status_callback (NULL, _("Patterns"), 0.3);
-  gimp_data_factory_data_init (gimp->pattern_factory, gimp->user_context,
-                               gimp->no_data);
-
-  /*  initialize the list of gimp palettes   */
-  status_callback (NULL, _("Palettes"), 0.4);
-  gimp_data_factory_data_init (gimp->palette_factory, gimp->user_context,
-                               gimp->no_data);
-
-  /*  initialize the list of gimp gradients  */
-  status_callback (NULL, _("Gradients"), 0.5);
-  gimp_data_factory_data_init (gimp->gradient_factory, gimp->user_context,
-                               gimp->no_data);
-
-  /*  initialize the list of fonts  */
-  status_callback (NULL, _("Fonts (this may take a while)"), 0.6);
+  startup = gimp_startup_new (gimp);
+
+  /*  initialize  the global parasite table  */
+  gimp_startup_add_task (startup, "parasites", _("Parasites"), TRUE,
+                         NULL, gimp_restore_parasites, NULL,
+                         NULL);
+
+  /*  initialize the lists of gimp brushes, dynamics, patterns and
+   *  gradients, their files are read and decoded in worker threads
+   */
+  gimp_restore_add_data_task (gimp, startup, "brushes", _("Brushes"),
+                              gimp->brush_factory, TRUE);
+  gimp_restore_add_data_task (gimp, startup, "dynamics", _("Dynamics"),
+                              gimp->dynamics_factory, TRUE);
+  gimp_restore_add_data_task (gimp, startup, "patterns", _("Patterns"),
+                              gimp->pattern_factory, TRUE);
+  gimp_restore_add_data_task (gimp, startup, "gradients", _("Gradients"),
+                              gimp->gradient_factory, TRUE);
+
+  /*  the palette loaders report problems using g_message(), which
+   *  must not be called from a thread
+   */
+  gimp_restore_add_data_task (gimp, startup, "palettes", _("Palettes"),
+                              gimp->palette_factory, FALSE);
+
+  /*  initialize the list of fonts, let them load while the UI comes
+   *  up, unless there is no UI that could wait for them
+   */
   if (! gimp->no_fonts)
-    gimp_fonts_load (gimp);
+    gimp_fonts_add_startup_task (gimp, startup, gimp->no_interface);
 
-  /*  initialize the list of gimp tool presets if we have a GUI  */
+  /*  initialize the list of gimp tool presets if we have a GUI,
+   *  loading them uses the tool options
+   */
   if (! gimp->no_interface)
-    {
-      status_callback (NULL, _("Tool Presets"), 0.65);
-      gimp_data_factory_data_init (gimp->tool_preset_factory, gimp->user_context,
-                                   gimp->no_data);
-    }
+    gimp_restore_add_data_task (gimp, startup, "tool-presets",
+                                _("Tool Presets"),
+                                gimp->tool_preset_factory, FALSE);
 
   /*  initialize the template list  */
-  status_callback (NULL, _("Templates"), 0.7);
-  gimp_templates_load (gimp);
+  gimp_startup_add_task (startup, "templates", _("Templates"), TRUE,
+                         NULL, gimp_restore_templates, NULL,
+                         NULL);
 
   /*  initialize the module list  */
-  status_callback (NULL, _("Modules"), 0.8);
-  gimp_modules_load (gimp);
+  gimp_startup_add_task (startup, "modules", _("Modules"), TRUE,
+                         NULL, gimp_restore_modules, NULL,
+                         NULL);
 
   /* update tag cache */
-  status_callback (NULL, _("Updating tag cache"), 0.9);
-  gimp_tag_cache_load (gimp->tag_cache);
-  gimp_tag_cache_add_container (gimp->tag_cache,
-                                gimp_data_factory_get_container (gimp->brush_factory));
-  gimp_tag_cache_add_container (gimp->tag_cache,
-                                gimp_data_factory_get_container (gimp->dynamics_factory));
-  gimp_tag_cache_add_container (gimp->tag_cache,
-                                gimp_data_factory_get_container (gimp->pattern_factory));
-  gimp_tag_cache_add_container (gimp->tag_cache,
-                                gimp_data_factory_get_container (gimp->gradient_factory));
-  gimp_tag_cache_add_container (gimp->tag_cache,
-                                gimp_data_factory_get_container (gimp->palette_factory));
-  gimp_tag_cache_add_container (gimp->tag_cache,
-                                gimp_data_factory_get_container (gimp->tool_preset_factory));
+  gimp_startup_add_task (startup, "tag-cache-load", _("Updating tag cache"),
+                         TRUE,
+                         gimp_restore_tag_cache_load, NULL, NULL,
+                         NULL);
+  gimp_startup_add_task (startup, "tags", _("Updating tag cache"), TRUE,
+                         NULL, gimp_restore_tags, NULL,
+                         "tag-cache-load",
+                         "brushes",
+                         "dynamics",
+                         "patterns",
+                         "gradients",
+                         "palettes",
+                         "tool-presets",
+                         NULL);
+
+  gimp_startup_run (startup, status_callback);
 
   g_signal_emit (gimp, gimp_signals[RESTORE], 0, status_callback);
 }
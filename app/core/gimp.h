@@ -58,6 +58,9 @@ struct _Gimp
   GimpGui                 gui;         /* gui vtable */
 
   gboolean                restored;    /* becomes TRUE in gimp_restore() */
+  GimpStartup            *startup;     /* tasks still running after
+                                        * gimp_restore()
+                                        */
 
   gint                    busy;
   guint                   busy_idle_id;
@@ -26,12 +26,16 @@
 
 #include "core-types.h"
 
+#include "gimp-parallel.h"
 #include "gimpboundary.h"
 
 
 /* GimpBoundSeg array growth parameter */
 #define MAX_SEGS_INC  2048
 
+/* the minimal number of pixels each thread scans for a boundary */
+#define MIN_PARALLEL_SUB_AREA (256 * 256)
+
 
 typedef struct _GimpBoundary GimpBoundary;
 
@@ -44,14 +48,53 @@ struct _GimpBoundary
 
   /*  The array of vertical segments  */
   gint         *vert_segs;
-
-  /*  The empty segment arrays */
-  gint         *empty_segs_n;
-  gint         *empty_segs_c;
-  gint         *empty_segs_l;
-  gint          max_empty_segs;
 };
 
+/*  A horizontal segment found by a band of generate_boundary(), the
+ *  vertical segments are added when the bands are joined
+ */
+typedef struct
+{
+  gint     x1;
+  gint     x2;
+  gint     y;
+  gboolean open;
+} GimpBoundaryHorizSeg;
+
+typedef struct
+{
+  GeglBuffer          *buffer;
+  const GeglRectangle *region;
+  const Babl          *format;
+  GimpBoundaryType     type;
+  gint                 x1;
+  gint                 y1;
+  gint                 x2;
+  gint                 y2;
+  gfloat               threshold;
+
+  gint                 start;
+  gint                 end;
+
+  GArray             **bands;    /*  the GimpBoundaryHorizSegs of each band  */
+} GimpBoundaryGenerateData;
+
+/*  maps a point to the segments that start or end there  */
+typedef struct
+{
+  gint x;
+  gint y;
+  gint head;                     /*  first endpoint index, or -1  */
+} GimpBoundaryPoint;
+
+typedef struct
+{
+  const GimpBoundSeg *segs;
+  GimpBoundaryPoint  *points;
+  guint               mask;
+  gint               *next;      /*  the next endpoint at the same point  */
+} GimpBoundaryPoints;
+
 
 /*  local function prototypes  */
 
@@ -84,7 +127,7 @@ static void           process_horiz_seg        (GimpBoundary        *boundary,
                                                 gint                 x2,
                                                 gint                 y2,
                                                 gboolean             open);
-static void           make_horiz_segs          (GimpBoundary        *boundary,
+static void           make_horiz_segs          (GArray              *horiz_segs,
                                                 gint                 start,
                                                 gint                 end,
                                                 gint                 scanline,
@@ -100,27 +143,17 @@ static GimpBoundary * generate_boundary        (GeglBuffer          *buffer,
                                                 gint                 x2,
                                                 gint                 y2,
                                                 gfloat               threshold);
-
-static gint       cmp_segptr_xy1_addr     (const GimpBoundSeg **seg_ptr_a,
-                                           const GimpBoundSeg **seg_ptr_b);
-static gint       cmp_segptr_xy2_addr     (const GimpBoundSeg **seg_ptr_a,
-                                           const GimpBoundSeg **seg_ptr_b);
-
-static gint       cmp_segptr_xy1          (const GimpBoundSeg **seg_ptr_a,
-                                           const GimpBoundSeg **seg_ptr_b);
-static gint       cmp_segptr_xy2          (const GimpBoundSeg **seg_ptr_a,
-                                           const GimpBoundSeg **seg_ptr_b);
-
-static const GimpBoundSeg * find_segment  (const GimpBoundSeg **segs_by_xy1,
-                                           const GimpBoundSeg **segs_by_xy2,
-                                           gint                 num_segs,
-                                           gint                 x,
-                                           gint                 y);
-
-static const GimpBoundSeg * find_segment_with_func (const GimpBoundSeg **segs,
-                                                    gint                 num_segs,
-                                                    const GimpBoundSeg  *search_seg,
-                                                    GCompareFunc         cmp_func);
+static void           generate_boundary_band   (gint                      i,
+                                                gint                      n,
+                                                GimpBoundaryGenerateData *data);
+
+static void           points_init              (GimpBoundaryPoints  *points,
+                                                const GimpBoundSeg  *segs,
+                                                gint                 num_segs);
+static void           points_free              (GimpBoundaryPoints  *points);
+static const GimpBoundSeg * find_segment       (GimpBoundaryPoints  *points,
+                                                gint                 x,
+                                                gint                 y);
 
 static void       simplify_subdivide  (const GimpBoundSeg  *segs,
                                        gint                 start_idx,
@@ -209,12 +242,11 @@ gimp_boundary_sort (const GimpBoundSeg *segs,
                     gint                num_segs,
                     gint               *num_groups)
 {
-  GimpBoundary        *boundary;
-  const GimpBoundSeg **segs_ptrs_by_xy1;
-  const GimpBoundSeg **segs_ptrs_by_xy2;
-  gint                 index;
-  gint                 x, y;
-  gint                 startx, starty;
+  GimpBoundary       *boundary;
+  GimpBoundaryPoints  points;
+  gint                index;
+  gint                x, y;
+  gint                startx, starty;
 
   g_return_val_if_fail ((segs == NULL && num_segs == 0) ||
                         (segs != NULL && num_segs >  0), NULL);
@@ -225,20 +257,8 @@ gimp_boundary_sort (const GimpBoundSeg *segs,
   if (num_segs == 0)
     return NULL;
 
-  /* prepare arrays with GimpBoundSeg pointers sorted by xy1 and xy2 accordingly */
-  segs_ptrs_by_xy1 = g_new (const GimpBoundSeg *, num_segs);
-  segs_ptrs_by_xy2 = g_new (const GimpBoundSeg *, num_segs);
-
-  for (index = 0; index < num_segs; index++)
-    {
-      segs_ptrs_by_xy1[index] = segs + index;
-      segs_ptrs_by_xy2[index] = segs + index;
-    }
-
-  qsort (segs_ptrs_by_xy1, num_segs, sizeof (GimpBoundSeg *),
-         (GCompareFunc) cmp_segptr_xy1_addr);
-  qsort (segs_ptrs_by_xy2, num_segs, sizeof (GimpBoundSeg *),
-         (GCompareFunc) cmp_segptr_xy2_addr);
+  /* hash the segments by their end points */
+  points_init (&points, segs, num_segs);
 
   for (index = 0; index < num_segs; index++)
     ((GimpBoundSeg *) segs)[index].visited = FALSE;
@@ -264,8 +284,7 @@ gimp_boundary_sort (const GimpBoundSeg *segs,
       x = segs[index].x2;
       y = segs[index].y2;
 
-      while ((cur_seg = find_segment (segs_ptrs_by_xy1, segs_ptrs_by_xy2,
-                                      num_segs, x, y)) != NULL)
+      while ((cur_seg = find_segment (&points, x, y)) != NULL)
         {
           /*  make sure ordering is correct  */
           if (x == cur_seg->x1 && y == cur_seg->y1)
@@ -298,8 +317,7 @@ gimp_boundary_sort (const GimpBoundSeg *segs,
       gimp_boundary_add_seg (boundary, -1, -1, -1, -1, 0);
   }
 
-  g_free (segs_ptrs_by_xy1);
-  g_free (segs_ptrs_by_xy2);
+  points_free (&points);
 
   return gimp_boundary_free (boundary, FALSE);
 }
@@ -422,15 +440,6 @@ gimp_boundary_new (const GeglRectangle *region)
 
       for (i = 0; i <= (region->width + region->x); i++)
         boundary->vert_segs[i] = -1;
-
-      /*  find the maximum possible number of empty segments
-       *  given the current mask
-       */
-      boundary->max_empty_segs = region->width + 3;
-
-      boundary->empty_segs_n = g_new (gint, boundary->max_empty_segs);
-      boundary->empty_segs_c = g_new (gint, boundary->max_empty_segs);
-      boundary->empty_segs_l = g_new (gint, boundary->max_empty_segs);
     }
 
   return boundary;
@@ -448,9 +457,6 @@ gimp_boundary_free (GimpBoundary *boundary,
     segs = boundary->segs;
 
   g_free (boundary->vert_segs);
-  g_free (boundary->empty_segs_n);
-  g_free (boundary->empty_segs_c);
-  g_free (boundary->empty_segs_l);
 
   g_slice_free (GimpBoundary, boundary);
 
@@ -626,14 +632,26 @@ process_horiz_seg (GimpBoundary *boundary,
   gimp_boundary_add_seg (boundary, x1, y1, x2, y2, open);
 }
 
+static inline void
+add_horiz_seg (GArray   *horiz_segs,
+               gint      x1,
+               gint      x2,
+               gint      y,
+               gboolean  open)
+{
+  GimpBoundaryHorizSeg seg = { x1, x2, y, open };
+
+  g_array_append_val (horiz_segs, seg);
+}
+
 static void
-make_horiz_segs (GimpBoundary *boundary,
-                 gint          start,
-                 gint          end,
-                 gint          scanline,
-                 gint          empty[],
-                 gint          num_empty,
-                 gint          top)
+make_horiz_segs (GArray *horiz_segs,
+                 gint    start,
+                 gint    end,
+                 gint    scanline,
+                 gint    empty[],
+                 gint    num_empty,
+                 gint    top)
 {
   gint empty_index;
   gint e_s, e_e;    /* empty segment start and end values */
@@ -645,19 +663,24 @@ make_horiz_segs (GimpBoundary *boundary,
 
       if (e_s <= start && e_e >= end)
         {
-          process_horiz_seg (boundary,
-                             start, scanline, end, scanline, top);
+          add_horiz_seg (horiz_segs,
+                         start, end, scanline, top);
         }
       else if ((e_s > start && e_s < end) ||
                (e_e < end && e_e > start))
         {
-          process_horiz_seg (boundary,
-                             MAX (e_s, start), scanline,
-                             MIN (e_e, end), scanline, top);
+          add_horiz_seg (horiz_segs,
+                         MAX (e_s, start), MIN (e_e, end), scanline, top);
         }
     }
 }
 
+/*  Scanning the mask is split into horizontal bands that are processed
+ *  in parallel.  Each band only collects its horizontal segments; the
+ *  vertical segments that connect them are added by replaying the
+ *  bands in order, so the result is the same as scanning the whole
+ *  mask at once.
+ */
 static GimpBoundary *
 generate_boundary (GeglBuffer          *buffer,
                    const GeglRectangle *region,
@@ -669,267 +692,282 @@ generate_boundary (GeglBuffer          *buffer,
                    gint                 y2,
                    gfloat               threshold)
 {
-  GimpBoundary  *boundary;
-  GeglRectangle  line_rect = { 0, };
-  gfloat        *line_data;
-  gint           scanline;
-  gint           i;
-  gint           start, end;
-  gint          *tmp_segs;
-
-  gint          num_empty_n = 0;
-  gint          num_empty_c = 0;
-  gint          num_empty_l = 0;
+  GimpBoundary             *boundary;
+  GimpBoundaryGenerateData  data;
+  gint                      n_bands;
+  gint                      i;
 
   boundary = gimp_boundary_new (region);
 
-  line_rect.width  = gegl_buffer_get_width (buffer);
-  line_rect.height = 1;
-
-  line_data = g_alloca (sizeof (gfloat) * line_rect.width);
-
-  start = 0;
-  end   = 0;
+  data.buffer    = buffer;
+  data.region    = region;
+  data.format    = format;
+  data.type      = type;
+  data.x1        = x1;
+  data.y1        = y1;
+  data.x2        = x2;
+  data.y2        = y2;
+  data.threshold = threshold;
+  data.start     = 0;
+  data.end       = 0;
 
   if (type == GIMP_BOUNDARY_WITHIN_BOUNDS)
     {
-      start = y1;
-      end   = y2;
+      data.start = y1;
+      data.end   = y2;
     }
   else if (type == GIMP_BOUNDARY_IGNORE_BOUNDS)
     {
-      start = region->y;
-      end   = region->y + region->height;
+      data.start = region->y;
+      data.end   = region->y + region->height;
     }
 
-  /*  Find the empty segments for the previous and current scanlines  */
-  find_empty_segs (region, NULL,
-                   start - 1, boundary->empty_segs_l,
-                   boundary->max_empty_segs, &num_empty_l,
-                   type, x1, y1, x2, y2,
-                   threshold);
-
-  line_rect.y = start;
-  gegl_buffer_get (buffer, &line_rect, 1.0, format,
-                   line_data, GEGL_AUTO_ROWSTRIDE,
-                   GEGL_ABYSS_NONE);
+  n_bands = ((gint64) MAX (data.end - data.start, 0) *
+             gegl_buffer_get_width (buffer) / MIN_PARALLEL_SUB_AREA);
+  n_bands = CLAMP (n_bands, 1, MIN (gimp_parallel_get_n_threads (),
+                                    MAX (data.end - data.start, 1)));
 
-  find_empty_segs (region, line_data,
-                   start, boundary->empty_segs_c,
-                   boundary->max_empty_segs, &num_empty_c,
-                   type, x1, y1, x2, y2,
-                   threshold);
+  data.bands = g_new0 (GArray *, n_bands);
 
-  for (scanline = start; scanline < end; scanline++)
+  gimp_parallel_distribute (n_bands,
+                            (GimpParallelDistributeFunc) generate_boundary_band,
+                            &data);
+
+  for (i = 0; i < n_bands; i++)
     {
-      /*  find the empty segment list for the next scanline  */
-      line_rect.y = scanline + 1;
-      if (scanline + 1 == end)
-        line_data = NULL;
-      else
-        gegl_buffer_get (buffer, &line_rect, 1.0, format,
-                         line_data, GEGL_AUTO_ROWSTRIDE,
-                         GEGL_ABYSS_NONE);
+      GArray *horiz_segs = data.bands[i];
+      guint   j;
 
-      find_empty_segs (region, line_data,
-                       scanline + 1, boundary->empty_segs_n,
-                       boundary->max_empty_segs, &num_empty_n,
-                       type, x1, y1, x2, y2,
-                       threshold);
+      if (! horiz_segs)
+        continue;
 
-      /*  process the segments on the current scanline  */
-      for (i = 1; i < num_empty_c - 1; i += 2)
+      for (j = 0; j < horiz_segs->len; j++)
         {
-          make_horiz_segs (boundary,
-                           boundary->empty_segs_c [i],
-                           boundary->empty_segs_c [i+1],
-                           scanline,
-                           boundary->empty_segs_l, num_empty_l, 1);
-          make_horiz_segs (boundary,
-                           boundary->empty_segs_c [i],
-                           boundary->empty_segs_c [i+1],
-                           scanline + 1,
-                           boundary->empty_segs_n, num_empty_n, 0);
+          const GimpBoundaryHorizSeg *seg;
+
+          seg = &g_array_index (horiz_segs, GimpBoundaryHorizSeg, j);
+
+          process_horiz_seg (boundary,
+                             seg->x1, seg->y, seg->x2, seg->y, seg->open);
         }
 
-      /*  get the next scanline of empty segments, swap others  */
-      tmp_segs               = boundary->empty_segs_l;
-      boundary->empty_segs_l = boundary->empty_segs_c;
-      num_empty_l            = num_empty_c;
-      boundary->empty_segs_c = boundary->empty_segs_n;
-      num_empty_c            = num_empty_n;
-      boundary->empty_segs_n = tmp_segs;
+      g_array_free (horiz_segs, TRUE);
     }
 
+  g_free (data.bands);
+
   return boundary;
 }
 
-/*  sorting utility functions  */
-
-static inline gint
-cmp_xy (const gint ax,
-        const gint ay,
-        const gint bx,
-        const gint by)
+static const gfloat *
+generate_boundary_get_line (GimpBoundaryGenerateData *data,
+                            gint                      scanline,
+                            gfloat                   *line_data)
 {
-  if (ay < by)
-    {
-      return -1;
-    }
-  else if (ay > by)
-    {
-      return 1;
-    }
-  else if (ax < bx)
-    {
-      return -1;
-    }
-  else if (ax > bx)
-    {
-      return 1;
-    }
-  else
-    {
-      return 0;
-    }
-}
-
+  GeglRectangle line_rect;
 
-/*
- * Compares (x1, y1) pairs in specified segments, using their addresses if
- * (x1, y1) pairs are equal.
- */
-static gint
-cmp_segptr_xy1_addr (const GimpBoundSeg **seg_ptr_a,
-                     const GimpBoundSeg **seg_ptr_b)
-{
-  const GimpBoundSeg *seg_a = *seg_ptr_a;
-  const GimpBoundSeg *seg_b = *seg_ptr_b;
+  /*  lines outside the scanned range are never looked at  */
+  if (scanline < data->start || scanline >= data->end)
+    return NULL;
 
-  gint result = cmp_xy (seg_a->x1, seg_a->y1, seg_b->x1, seg_b->y1);
+  line_rect.x      = 0;
+  line_rect.y      = scanline;
+  line_rect.width  = gegl_buffer_get_width (data->buffer);
+  line_rect.height = 1;
 
-  if (result == 0)
-    {
-      if (seg_a < seg_b)
-        result = -1;
-      else if (seg_a > seg_b)
-        result = 1;
-    }
+  gegl_buffer_get (data->buffer, &line_rect, 1.0, data->format,
+                   line_data, GEGL_AUTO_ROWSTRIDE,
+                   GEGL_ABYSS_NONE);
 
-  return result;
+  return line_data;
 }
 
-/*
- * Compares (x2, y2) pairs in specified segments, using their addresses if
- * (x2, y2) pairs are equal.
- */
-static gint
-cmp_segptr_xy2_addr (const GimpBoundSeg **seg_ptr_a,
-                     const GimpBoundSeg **seg_ptr_b)
+static void
+generate_boundary_band (gint                      i,
+                        gint                      n,
+                        GimpBoundaryGenerateData *data)
 {
-  const GimpBoundSeg *seg_a = *seg_ptr_a;
-  const GimpBoundSeg *seg_b = *seg_ptr_b;
+  const GeglRectangle *region = data->region;
+  GArray              *horiz_segs;
+  gfloat              *line_data;
+  gint                *empty_segs_n;
+  gint                *empty_segs_c;
+  gint                *empty_segs_l;
+  gint                *tmp_segs;
+  gint                 max_empty_segs;
+  gint                 num_empty_n = 0;
+  gint                 num_empty_c = 0;
+  gint                 num_empty_l = 0;
+  gint                 start;
+  gint                 end;
+  gint                 scanline;
+  gint                 j;
+
+  start = data->start + (gint64) (data->end - data->start) * i       / n;
+  end   = data->start + (gint64) (data->end - data->start) * (i + 1) / n;
+
+  horiz_segs = g_array_new (FALSE, FALSE, sizeof (GimpBoundaryHorizSeg));
+
+  line_data = g_new (gfloat, gegl_buffer_get_width (data->buffer));
+
+  /*  find the maximum possible number of empty segments
+   *  given the current mask
+   */
+  max_empty_segs = region->width + 3;
+
+  empty_segs_n = g_new (gint, max_empty_segs);
+  empty_segs_c = g_new (gint, max_empty_segs);
+  empty_segs_l = g_new (gint, max_empty_segs);
 
-  gint result = cmp_xy (seg_a->x2, seg_a->y2, seg_b->x2, seg_b->y2);
+  /*  Find the empty segments for the previous and current scanlines  */
+  find_empty_segs (region,
+                   generate_boundary_get_line (data, start - 1, line_data),
+                   start - 1, empty_segs_l,
+                   max_empty_segs, &num_empty_l,
+                   data->type, data->x1, data->y1, data->x2, data->y2,
+                   data->threshold);
+
+  find_empty_segs (region,
+                   generate_boundary_get_line (data, start, line_data),
+                   start, empty_segs_c,
+                   max_empty_segs, &num_empty_c,
+                   data->type, data->x1, data->y1, data->x2, data->y2,
+                   data->threshold);
 
-  if (result == 0)
+  for (scanline = start; scanline < end; scanline++)
     {
-      if (seg_a < seg_b)
-        result = -1;
-      else if (seg_a > seg_b)
-        result = 1;
+      /*  find the empty segment list for the next scanline  */
+      find_empty_segs (region,
+                       generate_boundary_get_line (data, scanline + 1,
+                                                   line_data),
+                       scanline + 1, empty_segs_n,
+                       max_empty_segs, &num_empty_n,
+                       data->type, data->x1, data->y1, data->x2, data->y2,
+                       data->threshold);
+
+      /*  process the segments on the current scanline  */
+      for (j = 1; j < num_empty_c - 1; j += 2)
+        {
+          make_horiz_segs (horiz_segs,
+                           empty_segs_c [j],
+                           empty_segs_c [j+1],
+                           scanline,
+                           empty_segs_l, num_empty_l, 1);
+          make_horiz_segs (horiz_segs,
+                           empty_segs_c [j],
+                           empty_segs_c [j+1],
+                           scanline + 1,
+                           empty_segs_n, num_empty_n, 0);
+        }
+
+      /*  get the next scanline of empty segments, swap others  */
+      tmp_segs     = empty_segs_l;
+      empty_segs_l = empty_segs_c;
+      num_empty_l  = num_empty_c;
+      empty_segs_c = empty_segs_n;
+      num_empty_c  = num_empty_n;
+      empty_segs_n = tmp_segs;
     }
 
-  return result;
+  g_free (empty_segs_n);
+  g_free (empty_segs_c);
+  g_free (empty_segs_l);
+  g_free (line_data);
+
+  data->bands[i] = horiz_segs;
 }
 
+/*  sorting utility functions  */
 
-/*
- * Compares (x1, y1) pairs in specified segments.
- */
-static gint
-cmp_segptr_xy1 (const GimpBoundSeg **seg_ptr_a,
-                const GimpBoundSeg **seg_ptr_b)
+static inline GimpBoundaryPoint *
+points_lookup (GimpBoundaryPoints *points,
+               gint                x,
+               gint                y)
 {
-  const GimpBoundSeg *seg_a = *seg_ptr_a, *seg_b = *seg_ptr_b;
+  guint hash = ((guint) x * 73856093u) ^ ((guint) y * 19349663u);
 
-  return cmp_xy (seg_a->x1, seg_a->y1, seg_b->x1, seg_b->y1);
-}
+  /*  linear probing, the table is at most half full  */
+  while (TRUE)
+    {
+      GimpBoundaryPoint *point = &points->points[hash & points->mask];
 
-/*
- * Compares (x2, y2) pairs in specified segments.
- */
-static gint
-cmp_segptr_xy2 (const GimpBoundSeg **seg_ptr_a,
-                const GimpBoundSeg **seg_ptr_b)
-{
-  const GimpBoundSeg *seg_a = *seg_ptr_a;
-  const GimpBoundSeg *seg_b = *seg_ptr_b;
+      if (point->head < 0 || (point->x == x && point->y == y))
+        return point;
 
-  return cmp_xy (seg_a->x2, seg_a->y2, seg_b->x2, seg_b->y2);
+      hash++;
+    }
 }
 
-
-static const GimpBoundSeg *
-find_segment (const GimpBoundSeg **segs_by_xy1,
-              const GimpBoundSeg **segs_by_xy2,
-              gint                 num_segs,
-              gint                 x,
-              gint                 y)
+static void
+points_init (GimpBoundaryPoints *points,
+             const GimpBoundSeg *segs,
+             gint                num_segs)
 {
-  const GimpBoundSeg *segptr_xy1;
-  const GimpBoundSeg *segptr_xy2;
-  GimpBoundSeg        search_seg;
-
-  search_seg.x1 = search_seg.x2 = x;
-  search_seg.y1 = search_seg.y2 = y;
-
-  segptr_xy1 = find_segment_with_func (segs_by_xy1, num_segs, &search_seg,
-                                       (GCompareFunc) cmp_segptr_xy1);
-  segptr_xy2 = find_segment_with_func (segs_by_xy2, num_segs, &search_seg,
-                                       (GCompareFunc) cmp_segptr_xy2);
-
-  /* return segment with smaller address */
-  if (segptr_xy1 != NULL && segptr_xy2 != NULL)
-    return MIN(segptr_xy1, segptr_xy2);
-  else if (segptr_xy1 != NULL)
-    return segptr_xy1;
-  else if (segptr_xy2 != NULL)
-    return segptr_xy2;
+  guint size = 1;
+  guint i;
+  gint  e;
+
+  while (size < 4 * (guint) num_segs)
+    size <<= 1;
+
+  points->segs   = segs;
+  points->points = g_new (GimpBoundaryPoint, size);
+  points->mask   = size - 1;
+  points->next   = g_new (gint, 2 * num_segs);
+
+  for (i = 0; i < size; i++)
+    points->points[i].head = -1;
+
+  /*  endpoint e is (x1, y1) of segment e / 2 if e is even, and (x2, y2)
+   *  otherwise.  Prepending in reverse order keeps each point's list
+   *  sorted by segment address, which find_segment() relies on.
+   */
+  for (e = 2 * num_segs - 1; e >= 0; e--)
+    {
+      const GimpBoundSeg *seg = segs + e / 2;
+      gint                x   = (e & 1) ? seg->x2 : seg->x1;
+      gint                y   = (e & 1) ? seg->y2 : seg->y1;
+      GimpBoundaryPoint  *point;
 
-  return NULL;
+      point = points_lookup (points, x, y);
+
+      points->next[e] = point->head;
+
+      point->x    = x;
+      point->y    = y;
+      point->head = e;
+    }
 }
 
+static void
+points_free (GimpBoundaryPoints *points)
+{
+  g_free (points->points);
+  g_free (points->next);
+}
 
+/*  Returns the non-visited segment with the smallest address that
+ *  starts or ends at (x, y).
+ */
 static const GimpBoundSeg *
-find_segment_with_func (const GimpBoundSeg **segs,
-                        gint                 num_segs,
-                        const GimpBoundSeg  *search_seg,
-                        GCompareFunc         cmp_func)
+find_segment (GimpBoundaryPoints *points,
+              gint                x,
+              gint                y)
 {
-  const GimpBoundSeg **seg;
-  const GimpBoundSeg *found_seg = NULL;
+  GimpBoundaryPoint *point = points_lookup (points, x, y);
+  gint               e;
 
-  seg = bsearch (&search_seg, segs, num_segs, sizeof (GimpBoundSeg *), cmp_func);
+  /*  drop visited segments from the front of the list  */
+  while (point->head >= 0 && points->segs[point->head / 2].visited)
+    point->head = points->next[point->head];
 
-  if (seg != NULL)
+  for (e = point->head; e >= 0; e = points->next[e])
     {
-      /* find first matching segment */
-      while (seg > segs && cmp_func (seg - 1, &search_seg) == 0)
-        seg--;
-
-      /* find first non-visited segment */
-      while (seg != segs + num_segs && cmp_func (seg, &search_seg) == 0)
-        if (!(*seg)->visited)
-          {
-            found_seg = *seg;
-            break;
-          }
-        else
-          seg++;
+      if (! points->segs[e / 2].visited)
+        return points->segs + e / 2;
     }
 
-    return found_seg;
+  return NULL;
 }
 
 
@@ -86,6 +86,16 @@ struct _AbrSampledBrushHeader
 
 /*  local function prototypes  */
 
+static GList     * gimp_brush_load_file          (GimpContext  *context,
+                                                  const gchar  *filename,
+                                                  gboolean      header_only,
+                                                  GError      **error);
+static GimpBrush * gimp_brush_load_brush_real    (GimpContext  *context,
+                                                  gint          fd,
+                                                  const gchar  *filename,
+                                                  gboolean      header_only,
+                                                  GError      **error);
+
 static GList     * gimp_brush_load_abr_v12       (FILE         *file,
                                                   AbrHeader    *abr_hdr,
                                                   const gchar  *filename,
@@ -127,13 +137,123 @@ gimp_brush_load (GimpContext  *context,
                  const gchar  *filename,
                  GError      **error)
 {
-  GimpBrush *brush;
-  gint       fd;
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (g_path_is_absolute (filename), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  return gimp_brush_load_file (context, filename, FALSE, error);
+}
 
+/*  Only reads the brush header and name, the returned brush has no
+ *  mask and must be completed using gimp_brush_load() before use.
+ */
+GList *
+gimp_brush_load_header (GimpContext  *context,
+                        const gchar  *filename,
+                        GError      **error)
+{
   g_return_val_if_fail (filename != NULL, NULL);
   g_return_val_if_fail (g_path_is_absolute (filename), NULL);
   g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
+  return gimp_brush_load_file (context, filename, TRUE, error);
+}
+
+GimpBrush *
+gimp_brush_load_brush (GimpContext  *context,
+                       gint          fd,
+                       const gchar  *filename,
+                       GError      **error)
+{
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (fd != -1, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  return gimp_brush_load_brush_real (context, fd, filename, FALSE, error);
+}
+
+/*  Like gimp_brush_load_brush(), but only reads the header and name
+ *  and skips the brush data, leaving @fd at the start of whatever
+ *  follows the brush.
+ */
+GimpBrush *
+gimp_brush_load_brush_header (GimpContext  *context,
+                              gint          fd,
+                              const gchar  *filename,
+                              GError      **error)
+{
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (fd != -1, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  return gimp_brush_load_brush_real (context, fd, filename, TRUE, error);
+}
+
+GList *
+gimp_brush_load_abr (GimpContext  *context,
+                     const gchar  *filename,
+                     GError      **error)
+{
+  FILE      *file;
+  AbrHeader  abr_hdr;
+  GList     *brush_list = NULL;
+
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (g_path_is_absolute (filename), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  file = g_fopen (filename, "rb");
+
+  if (! file)
+    {
+      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_OPEN,
+                   _("Could not open '%s' for reading: %s"),
+                   gimp_filename_to_utf8 (filename), g_strerror (errno));
+      return NULL;
+    }
+
+  abr_hdr.version = abr_read_short (file);
+  abr_hdr.count   = abr_read_short (file); /* sub-version for ABR v6 */
+
+  if (abr_supported (&abr_hdr, filename, error))
+    {
+      switch (abr_hdr.version)
+        {
+        case 1:
+        case 2:
+          brush_list = gimp_brush_load_abr_v12 (file, &abr_hdr,
+                                                filename, error);
+          break;
+
+        case 6:
+          brush_list = gimp_brush_load_abr_v6 (file, &abr_hdr,
+                                               filename, error);
+        }
+    }
+
+  fclose (file);
+
+  if (! brush_list && (error && ! *error))
+    g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                 _("Fatal parse error in brush file '%s': "
+                   "unable to decode abr format version %d."),
+                 gimp_filename_to_utf8 (filename), abr_hdr.version);
+
+  return g_list_reverse (brush_list);
+}
+
+
+/*  private functions  */
+
+static GList *
+gimp_brush_load_file (GimpContext  *context,
+                      const gchar  *filename,
+                      gboolean      header_only,
+                      GError      **error)
+{
+  GimpBrush *brush;
+  gint       fd;
+
   fd = g_open (filename, O_RDONLY | _O_BINARY, 0);
   if (fd == -1)
     {
@@ -143,7 +263,8 @@ gimp_brush_load (GimpContext  *context,
       return NULL;
     }
 
-  brush = gimp_brush_load_brush (context, fd, filename, error);
+  brush = gimp_brush_load_brush_real (context, fd, filename, header_only,
+                                      error);
 
   close (fd);
 
@@ -153,11 +274,12 @@ gimp_brush_load (GimpContext  *context,
   return g_list_prepend (NULL, brush);
 }
 
-GimpBrush *
-gimp_brush_load_brush (GimpContext  *context,
-                       gint          fd,
-                       const gchar  *filename,
-                       GError      **error)
+static GimpBrush *
+gimp_brush_load_brush_real (GimpContext  *context,
+                            gint          fd,
+                            const gchar  *filename,
+                            gboolean      header_only,
+                            GError      **error)
 {
   GimpBrush   *brush;
   gint         bn_size;
@@ -168,10 +290,6 @@ gimp_brush_load_brush (GimpContext  *context,
   gssize       i, size;
   gboolean     success = TRUE;
 
-  g_return_val_if_fail (filename != NULL, NULL);
-  g_return_val_if_fail (fd != -1, NULL);
-  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
-
   /*  Read in the header size  */
   if (read (fd, &header, sizeof (header)) != sizeof (header))
     {
@@ -292,6 +410,19 @@ gimp_brush_load_brush (GimpContext  *context,
                         NULL);
   g_free (name);
 
+  if (header_only)
+    {
+      brush->spacing  = header.spacing;
+      brush->x_axis.x = header.width  / 2.0;
+      brush->y_axis.y = header.height / 2.0;
+
+      /*  skip the data, in case more brushes follow  */
+      lseek (fd, (off_t) header.width * header.height * header.bytes,
+             SEEK_CUR);
+
+      return brush;
+    }
+
   brush->mask = gimp_temp_buf_new (header.width, header.height,
                                    babl_format ("Y u8"));
 
@@ -405,62 +536,6 @@ gimp_brush_load_brush (GimpContext  *context,
   return brush;
 }
 
-GList *
-gimp_brush_load_abr (GimpContext  *context,
-                     const gchar  *filename,
-                     GError      **error)
-{
-  FILE      *file;
-  AbrHeader  abr_hdr;
-  GList     *brush_list = NULL;
-
-  g_return_val_if_fail (filename != NULL, NULL);
-  g_return_val_if_fail (g_path_is_absolute (filename), NULL);
-  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
-
-  file = g_fopen (filename, "rb");
-
-  if (! file)
-    {
-      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_OPEN,
-                   _("Could not open '%s' for reading: %s"),
-                   gimp_filename_to_utf8 (filename), g_strerror (errno));
-      return NULL;
-    }
-
-  abr_hdr.version = abr_read_short (file);
-  abr_hdr.count   = abr_read_short (file); /* sub-version for ABR v6 */
-
-  if (abr_supported (&abr_hdr, filename, error))
-    {
-      switch (abr_hdr.version)
-        {
-        case 1:
-        case 2:
-          brush_list = gimp_brush_load_abr_v12 (file, &abr_hdr,
-                                                filename, error);
-          break;
-
-        case 6:
-          brush_list = gimp_brush_load_abr_v6 (file, &abr_hdr,
-                                               filename, error);
-        }
-    }
-
-  fclose (file);
-
-  if (! brush_list && (error && ! *error))
-    g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
-                 _("Fatal parse error in brush file '%s': "
-                   "unable to decode abr format version %d."),
-                 gimp_filename_to_utf8 (filename), abr_hdr.version);
-
-  return g_list_reverse (brush_list);
-}
-
-
-/*  private functions  */
-
 static GList *
 gimp_brush_load_abr_v12 (FILE         *file,
                          AbrHeader    *abr_hdr,
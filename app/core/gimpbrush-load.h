@@ -28,10 +28,18 @@
 GList     * gimp_brush_load        (GimpContext  *context,
                                     const gchar  *filename,
                                     GError      **error);
+GList     * gimp_brush_load_header (GimpContext  *context,
+                                    const gchar  *filename,
+                                    GError      **error);
 GimpBrush * gimp_brush_load_brush  (GimpContext  *context,
                                     gint          fd,
                                     const gchar  *filename,
                                     GError      **error);
+GimpBrush * gimp_brush_load_brush_header
+                                   (GimpContext  *context,
+                                    gint          fd,
+                                    const gchar  *filename,
+                                    GError      **error);
 
 GList     * gimp_brush_load_abr    (GimpContext  *context,
                                     const gchar  *filename,
@@ -34,6 +34,10 @@
 
 #define MAX_BLUR_KERNEL 15
 
+/*  kernels at least this large are approximated by running box blurs  */
+#define MIN_BOX_BLUR_KERNEL 7
+#define N_BOX_BLUR_PASSES   3
+
 
 /*  local function prototypes  */
 
@@ -51,6 +55,10 @@ static void    gimp_brush_transform_fill_blur_kernel (gfloat            *arr,
 static gint    gimp_brush_transform_blur_kernel_size (gint               height,
                                                       gint               width,
                                                       gdouble            hardness);
+static void    gimp_brush_transform_blur             (GimpTempBuf       *buf,
+                                                      gdouble            hardness);
+static void    gimp_brush_transform_box_blur         (GimpTempBuf       *buf,
+                                                      gint               radius);
 
 
 /*  public functions  */
@@ -328,42 +336,7 @@ gimp_brush_real_transform_mask (GimpBrush *brush,
     } /* end for y */
 
   if (hardness < 1.0)
-    {
-      GimpTempBuf *blur_src;
-      GeglBuffer  *src_buffer;
-      GeglBuffer  *dest_buffer;
-      gint         kernel_size =
-        gimp_brush_transform_blur_kernel_size (gimp_temp_buf_get_height (result),
-                                               gimp_temp_buf_get_width  (result),
-                                               hardness);
-      gint         kernel_len  = kernel_size * kernel_size;
-      gfloat       blur_kernel[kernel_len];
-
-      gimp_brush_transform_fill_blur_kernel (blur_kernel, kernel_len);
-
-      blur_src = gimp_temp_buf_copy (result);
-
-      src_buffer  = gimp_temp_buf_create_buffer (blur_src);
-      dest_buffer = gimp_temp_buf_create_buffer (result);
-
-      gimp_temp_buf_unref (blur_src);
-
-      gimp_gegl_convolve (src_buffer,
-                          GEGL_RECTANGLE (0, 0,
-                                          gimp_temp_buf_get_width  (blur_src),
-                                          gimp_temp_buf_get_height (blur_src)),
-                          dest_buffer,
-                          GEGL_RECTANGLE (0, 0,
-                                          gimp_temp_buf_get_width  (result),
-                                          gimp_temp_buf_get_height (result)),
-                          blur_kernel, kernel_size,
-                          gimp_brush_transform_array_sum (blur_kernel,
-                                                          kernel_len),
-                          GIMP_NORMAL_CONVOL, FALSE);
-
-      g_object_unref (src_buffer);
-      g_object_unref (dest_buffer);
-    }
+    gimp_brush_transform_blur (result, hardness);
 
   return result;
 }
@@ -632,42 +605,7 @@ gimp_brush_real_transform_pixmap (GimpBrush *brush,
     } /* end for y */
 
   if (hardness < 1.0)
-    {
-      GimpTempBuf *blur_src;
-      GeglBuffer  *src_buffer;
-      GeglBuffer  *dest_buffer;
-      gint         kernel_size =
-        gimp_brush_transform_blur_kernel_size (gimp_temp_buf_get_height (result),
-                                               gimp_temp_buf_get_width  (result),
-                                               hardness);
-      gint         kernel_len  = kernel_size * kernel_size;
-      gfloat       blur_kernel[kernel_len];
-
-      gimp_brush_transform_fill_blur_kernel (blur_kernel, kernel_len);
-
-      blur_src = gimp_temp_buf_copy (result);
-
-      src_buffer  = gimp_temp_buf_create_buffer (blur_src);
-      dest_buffer = gimp_temp_buf_create_buffer (result);
-
-      gimp_temp_buf_unref (blur_src);
-
-      gimp_gegl_convolve (src_buffer,
-                          GEGL_RECTANGLE (0, 0,
-                                          gimp_temp_buf_get_width  (blur_src),
-                                          gimp_temp_buf_get_height (blur_src)),
-                          dest_buffer,
-                          GEGL_RECTANGLE (0, 0,
-                                          gimp_temp_buf_get_width  (result),
-                                          gimp_temp_buf_get_height (result)),
-                          blur_kernel, kernel_size,
-                          gimp_brush_transform_array_sum (blur_kernel,
-                                                          kernel_len),
-                          GIMP_NORMAL_CONVOL, FALSE);
-
-      g_object_unref (src_buffer);
-      g_object_unref (dest_buffer);
-    }
+    gimp_brush_transform_blur (result, hardness);
 
   return result;
 }
@@ -787,3 +725,120 @@ gimp_brush_transform_blur_kernel_size (gint    height,
 
   return kernel_size;
 }
+
+static void
+gimp_brush_transform_blur (GimpTempBuf *buf,
+                           gdouble      hardness)
+{
+  gint kernel_size =
+    gimp_brush_transform_blur_kernel_size (gimp_temp_buf_get_height (buf),
+                                           gimp_temp_buf_get_width  (buf),
+                                           hardness);
+
+  if (kernel_size >= MIN_BOX_BLUR_KERNEL)
+    {
+      /*  a cascade of box blurs covering the same extent as the kernel,
+       *  every pass costs the same regardless of the radius
+       */
+      gimp_brush_transform_box_blur (buf,
+                                     (kernel_size - 1) /
+                                     (2 * N_BOX_BLUR_PASSES));
+    }
+  else
+    {
+      GimpTempBuf *blur_src;
+      GeglBuffer  *src_buffer;
+      GeglBuffer  *dest_buffer;
+      gint         kernel_len  = kernel_size * kernel_size;
+      gfloat       blur_kernel[kernel_len];
+
+      gimp_brush_transform_fill_blur_kernel (blur_kernel, kernel_len);
+
+      blur_src = gimp_temp_buf_copy (buf);
+
+      src_buffer  = gimp_temp_buf_create_buffer (blur_src);
+      dest_buffer = gimp_temp_buf_create_buffer (buf);
+
+      gimp_temp_buf_unref (blur_src);
+
+      gimp_gegl_convolve (src_buffer,
+                          GEGL_RECTANGLE (0, 0,
+                                          gimp_temp_buf_get_width  (blur_src),
+                                          gimp_temp_buf_get_height (blur_src)),
+                          dest_buffer,
+                          GEGL_RECTANGLE (0, 0,
+                                          gimp_temp_buf_get_width  (buf),
+                                          gimp_temp_buf_get_height (buf)),
+                          blur_kernel, kernel_size,
+                          gimp_brush_transform_array_sum (blur_kernel,
+                                                          kernel_len),
+                          GIMP_NORMAL_CONVOL, FALSE);
+
+      g_object_unref (src_buffer);
+      g_object_unref (dest_buffer);
+    }
+}
+
+/*  separable running-sum box blur of an 8 bit buffer, applied
+ *  N_BOX_BLUR_PASSES times along both axes, with the edge pixels
+ *  extended
+ */
+static void
+gimp_brush_transform_box_blur (GimpTempBuf *buf,
+                               gint         radius)
+{
+  const gint  width      = gimp_temp_buf_get_width  (buf);
+  const gint  height     = gimp_temp_buf_get_height (buf);
+  const gint  components = babl_format_get_n_components (gimp_temp_buf_get_format (buf));
+  const gint  window     = 2 * radius + 1;
+  guchar     *data       = gimp_temp_buf_get_data (buf);
+  guchar     *line       = g_new (guchar, MAX (width, height) * components);
+  gint        pass;
+
+  g_return_if_fail (babl_format_get_bytes_per_pixel (gimp_temp_buf_get_format (buf)) ==
+                    components);
+
+  for (pass = 0; pass < 2 * N_BOX_BLUR_PASSES; pass++)
+    {
+      /*  even passes run along rows, odd passes along columns  */
+      const gboolean vertical  = (pass & 1);
+      const gint     length    = vertical ? height : width;
+      const gint     n_lines   = vertical ? width  : height;
+      const gint     step      = vertical ? width * components : components;
+      const gint     line_step = vertical ? components : width * components;
+      gint           l;
+
+      for (l = 0; l < n_lines; l++)
+        {
+          guchar *p = data + l * line_step;
+          gint    c;
+
+          for (c = 0; c < components; c++)
+            {
+              gint i;
+
+              for (i = 0; i < length; i++)
+                line[i * components + c] = p[i * step + c];
+            }
+
+          for (c = 0; c < components; c++)
+            {
+              guint sum = 0;
+              gint  i;
+
+              for (i = -radius; i <= radius; i++)
+                sum += line[CLAMP (i, 0, length - 1) * components + c];
+
+              for (i = 0; i < length; i++)
+                {
+                  p[i * step + c] = (sum + window / 2) / window;
+
+                  sum += line[MIN (i + radius + 1, length - 1) * components + c];
+                  sum -= line[MAX (i - radius,     0)          * components + c];
+                }
+            }
+        }
+    }
+
+  g_free (line);
+}
@@ -79,6 +79,8 @@ static gchar       * gimp_brush_get_description       (GimpViewable         *vie
 
 static void          gimp_brush_dirty                 (GimpData             *data);
 static const gchar * gimp_brush_get_extension         (GimpData             *data);
+static void          gimp_brush_copy                  (GimpData             *data,
+                                                       GimpData             *src_data);
 
 static void          gimp_brush_real_begin_use        (GimpBrush            *brush);
 static void          gimp_brush_real_end_use          (GimpBrush            *brush);
@@ -131,6 +133,7 @@ gimp_brush_class_init (GimpBrushClass *klass)
 
   data_class->dirty                = gimp_brush_dirty;
   data_class->get_extension        = gimp_brush_get_extension;
+  data_class->copy                 = gimp_brush_copy;
 
   klass->begin_use                 = gimp_brush_real_begin_use;
   klass->end_use                   = gimp_brush_real_end_use;
@@ -268,6 +271,8 @@ gimp_brush_get_size (GimpViewable *viewable,
 {
   GimpBrush *brush = GIMP_BRUSH (viewable);
 
+  gimp_data_ensure_loaded (GIMP_DATA (brush));
+
   *width  = gimp_temp_buf_get_width  (brush->mask);
   *height = gimp_temp_buf_get_height (brush->mask);
 
@@ -291,6 +296,8 @@ gimp_brush_get_new_preview (GimpViewable *viewable,
   gint               x, y;
   gboolean           scaled = FALSE;
 
+  gimp_data_ensure_loaded (GIMP_DATA (brush));
+
   mask_buf   = brush->mask;
   pixmap_buf = brush->pixmap;
 
@@ -383,6 +390,8 @@ gimp_brush_get_description (GimpViewable  *viewable,
 {
   GimpBrush *brush = GIMP_BRUSH (viewable);
 
+  gimp_data_ensure_loaded (GIMP_DATA (brush));
+
   return g_strdup_printf ("%s (%d × %d)",
                           gimp_object_get_name (brush),
                           gimp_temp_buf_get_width  (brush->mask),
@@ -412,6 +421,37 @@ gimp_brush_get_extension (GimpData *data)
   return GIMP_BRUSH_FILE_EXTENSION;
 }
 
+static void
+gimp_brush_copy (GimpData *data,
+                 GimpData *src_data)
+{
+  GimpBrush *brush     = GIMP_BRUSH (data);
+  GimpBrush *src_brush = GIMP_BRUSH (src_data);
+
+  if (brush->mask)
+    gimp_temp_buf_unref (brush->mask);
+
+  brush->mask = src_brush->mask ? gimp_temp_buf_copy (src_brush->mask) : NULL;
+
+  if (brush->pixmap)
+    gimp_temp_buf_unref (brush->pixmap);
+
+  brush->pixmap = src_brush->pixmap ? gimp_temp_buf_copy (src_brush->pixmap) : NULL;
+
+  brush->spacing = src_brush->spacing;
+  brush->x_axis  = src_brush->x_axis;
+  brush->y_axis  = src_brush->y_axis;
+
+  if (brush->mask_cache)
+    gimp_brush_cache_clear (brush->mask_cache);
+
+  if (brush->pixmap_cache)
+    gimp_brush_cache_clear (brush->pixmap_cache);
+
+  if (brush->boundary_cache)
+    gimp_brush_cache_clear (brush->boundary_cache);
+}
+
 static void
 gimp_brush_real_begin_use (GimpBrush *brush)
 {
@@ -518,6 +558,8 @@ gimp_brush_begin_use (GimpBrush *brush)
 {
   g_return_if_fail (GIMP_IS_BRUSH (brush));
 
+  gimp_data_ensure_loaded (GIMP_DATA (brush));
+
   brush->use_count++;
 
   if (brush->use_count == 1)
@@ -577,6 +619,8 @@ gimp_brush_transform_size (GimpBrush     *brush,
   g_return_if_fail (width != NULL);
   g_return_if_fail (height != NULL);
 
+  gimp_data_ensure_loaded (GIMP_DATA (brush));
+
   if (scale        == 1.0 &&
       aspect_ratio == 0.0 &&
       ((angle == 0.0) || (angle == 0.5) || (angle == 1.0)))
@@ -747,6 +791,8 @@ gimp_brush_get_mask (const GimpBrush *brush)
   g_return_val_if_fail (brush != NULL, NULL);
   g_return_val_if_fail (GIMP_IS_BRUSH (brush), NULL);
 
+  gimp_data_ensure_loaded ((GimpData *) brush);
+
   return brush->mask;
 }
 
@@ -756,6 +802,8 @@ gimp_brush_get_pixmap (const GimpBrush *brush)
   g_return_val_if_fail (brush != NULL, NULL);
   g_return_val_if_fail (GIMP_IS_BRUSH (brush), NULL);
 
+  gimp_data_ensure_loaded ((GimpData *) brush);
+
   return brush->pixmap;
 }
 
@@ -764,6 +812,8 @@ gimp_brush_get_spacing (const GimpBrush *brush)
 {
   g_return_val_if_fail (GIMP_IS_BRUSH (brush), 0);
 
+  gimp_data_ensure_loaded ((GimpData *) brush);
+
   return brush->spacing;
 }
 
@@ -22,6 +22,8 @@
 
 #include <gegl.h>
 
+#include "libgimpmath/gimpmath.h"
+
 #include "core-types.h"
 
 #include "gimpbrushcache.h"
@@ -30,6 +32,33 @@
 #include "gimp-intl.h"
 
 
+/*  the number of transformed brushes kept around; dynamics usually
+ *  cycle through a small set of quantized transforms
+ */
+#define GIMP_BRUSH_CACHE_MAX_UNITS 16
+
+/*  the steps the transform parameters are quantized to  */
+#define GIMP_BRUSH_CACHE_SCALE_STEPS    256.0  /* per octave        */
+#define GIMP_BRUSH_CACHE_ASPECT_STEPS   64.0   /* per aspect unit   */
+#define GIMP_BRUSH_CACHE_ANGLE_STEPS    1024.0 /* per full rotation */
+#define GIMP_BRUSH_CACHE_HARDNESS_STEPS 256.0
+
+
+typedef struct _GimpBrushCacheUnit GimpBrushCacheUnit;
+
+struct _GimpBrushCacheUnit
+{
+  gpointer  data;
+
+  gint      width;
+  gint      height;
+  gint      scale;
+  gint      aspect_ratio;
+  gint      angle;
+  gint      hardness;
+};
+
+
 enum
 {
   PROP_0,
@@ -48,6 +77,16 @@ static void   gimp_brush_cache_get_property (GObject      *object,
                                              GValue       *value,
                                              GParamSpec   *pspec);
 
+static void   gimp_brush_cache_quantize     (GimpBrushCacheUnit *unit,
+                                             gint                width,
+                                             gint                height,
+                                             gdouble             scale,
+                                             gdouble             aspect_ratio,
+                                             gdouble             angle,
+                                             gdouble             hardness);
+static void   gimp_brush_cache_unit_free    (GimpBrushCache     *cache,
+                                             GimpBrushCacheUnit *unit);
+
 
 G_DEFINE_TYPE (GimpBrushCache, gimp_brush_cache, GIMP_TYPE_OBJECT)
 
@@ -91,11 +130,7 @@ gimp_brush_cache_finalize (GObject *object)
 {
   GimpBrushCache *cache = GIMP_BRUSH_CACHE (object);
 
-  if (cache->last_data)
-    {
-      cache->data_destroy (cache->last_data);
-      cache->last_data = NULL;
-    }
+  gimp_brush_cache_clear (cache);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -167,11 +202,21 @@ gimp_brush_cache_clear (GimpBrushCache *cache)
 {
   g_return_if_fail (GIMP_IS_BRUSH_CACHE (cache));
 
-  if (cache->last_data)
+  if (cache->n_hits || cache->n_misses)
+    GIMP_LOG (BRUSH_CACHE, "%p: %u hits, %u misses, %d cached",
+              cache, cache->n_hits, cache->n_misses, cache->n_cached_units);
+
+  while (cache->cached_units)
     {
-      cache->data_destroy (cache->last_data);
-      cache->last_data = NULL;
+      gimp_brush_cache_unit_free (cache, cache->cached_units->data);
+
+      cache->cached_units = g_list_delete_link (cache->cached_units,
+                                                cache->cached_units);
     }
+
+  cache->n_cached_units = 0;
+  cache->n_hits         = 0;
+  cache->n_misses       = 0;
 }
 
 gconstpointer
@@ -183,22 +228,46 @@ gimp_brush_cache_get (GimpBrushCache *cache,
                       gdouble         angle,
                       gdouble         hardness)
 {
+  GimpBrushCacheUnit  key;
+  GList              *list;
+
   g_return_val_if_fail (GIMP_IS_BRUSH_CACHE (cache), NULL);
 
-  if (cache->last_data                         &&
-      cache->last_width        == width        &&
-      cache->last_height       == height       &&
-      cache->last_scale        == scale        &&
-      cache->last_aspect_ratio == aspect_ratio &&
-      cache->last_angle        == angle        &&
-      cache->last_hardness     == hardness)
-    {
-      if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
-        g_printerr ("%c", cache->debug_hit);
+  gimp_brush_cache_quantize (&key, width, height,
+                             scale, aspect_ratio, angle, hardness);
 
-      return (gconstpointer) cache->last_data;
+  for (list = cache->cached_units; list; list = g_list_next (list))
+    {
+      GimpBrushCacheUnit *unit = list->data;
+
+      if (unit->width        == key.width        &&
+          unit->height       == key.height       &&
+          unit->scale        == key.scale        &&
+          unit->aspect_ratio == key.aspect_ratio &&
+          unit->angle        == key.angle        &&
+          unit->hardness     == key.hardness)
+        {
+          /*  move the unit to the front, so the list stays in
+           *  most-recently-used order
+           */
+          if (list != cache->cached_units)
+            {
+              cache->cached_units = g_list_remove_link (cache->cached_units,
+                                                        list);
+              cache->cached_units = g_list_concat (list, cache->cached_units);
+            }
+
+          cache->n_hits++;
+
+          if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
+            g_printerr ("%c", cache->debug_hit);
+
+          return (gconstpointer) unit->data;
+        }
     }
 
+  cache->n_misses++;
+
   if (gimp_log_flags & GIMP_LOG_BRUSH_CACHE)
     g_printerr ("%c", cache->debug_miss);
 
@@ -215,20 +284,74 @@ gimp_brush_cache_add (GimpBrushCache *cache,
                       gdouble         angle,
                       gdouble         hardness)
 {
+  GimpBrushCacheUnit *unit;
+  GList              *list;
+
   g_return_if_fail (GIMP_IS_BRUSH_CACHE (cache));
   g_return_if_fail (data != NULL);
 
-  if (data == cache->last_data)
-    return;
+  for (list = cache->cached_units; list; list = g_list_next (list))
+    {
+      unit = list->data;
+
+      if (unit->data == data)
+        return;
+    }
+
+  if (cache->n_cached_units == GIMP_BRUSH_CACHE_MAX_UNITS)
+    {
+      list = g_list_last (cache->cached_units);
+
+      gimp_brush_cache_unit_free (cache, list->data);
+
+      cache->cached_units = g_list_delete_link (cache->cached_units, list);
+      cache->n_cached_units--;
+    }
+
+  unit = g_slice_new (GimpBrushCacheUnit);
+
+  unit->data = data;
+
+  gimp_brush_cache_quantize (unit, width, height,
+                             scale, aspect_ratio, angle, hardness);
 
-  if (cache->last_data)
-    cache->data_destroy (cache->last_data);
+  cache->cached_units = g_list_prepend (cache->cached_units, unit);
+  cache->n_cached_units++;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_brush_cache_quantize (GimpBrushCacheUnit *unit,
+                           gint                width,
+                           gint                height,
+                           gdouble             scale,
+                           gdouble             aspect_ratio,
+                           gdouble             angle,
+                           gdouble             hardness)
+{
+  /*  the mask size is matched exactly, the rest is rounded to steps
+   *  below which the transformed brushes are indistinguishable
+   */
+  unit->width        = width;
+  unit->height       = height;
+  unit->scale        = RINT (log (MAX (scale, 1e-6)) / G_LN2 *
+                             GIMP_BRUSH_CACHE_SCALE_STEPS);
+  unit->aspect_ratio = RINT (aspect_ratio * GIMP_BRUSH_CACHE_ASPECT_STEPS);
+  unit->angle        = RINT ((angle - floor (angle)) *
+                             GIMP_BRUSH_CACHE_ANGLE_STEPS);
+  unit->hardness     = RINT (hardness * GIMP_BRUSH_CACHE_HARDNESS_STEPS);
+
+  if (unit->angle == (gint) GIMP_BRUSH_CACHE_ANGLE_STEPS)
+    unit->angle = 0;
+}
+
+static void
+gimp_brush_cache_unit_free (GimpBrushCache     *cache,
+                            GimpBrushCacheUnit *unit)
+{
+  cache->data_destroy (unit->data);
 
-  cache->last_data         = data;
-  cache->last_width        = width;
-  cache->last_height       = height;
-  cache->last_scale        = scale;
-  cache->last_aspect_ratio = aspect_ratio;
-  cache->last_angle        = angle;
-  cache->last_hardness     = hardness;
+  g_slice_free (GimpBrushCacheUnit, unit);
 }
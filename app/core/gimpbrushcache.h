@@ -41,13 +41,11 @@ struct _GimpBrushCache
 
   GDestroyNotify  data_destroy;
 
-  gpointer        last_data;
-  gint            last_width;
-  gint            last_height;
-  gdouble         last_scale;
-  gdouble         last_aspect_ratio;
-  gdouble         last_angle;
-  gdouble         last_hardness;
+  GList          *cached_units;
+  gint            n_cached_units;
+
+  guint           n_hits;
+  guint           n_misses;
 
   gchar           debug_hit;
   gchar           debug_miss;
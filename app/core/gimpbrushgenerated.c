@@ -26,6 +26,7 @@
 
 #include "core-types.h"
 
+#include "gimp-parallel.h"
 #include "gimpbrushgenerated.h"
 #include "gimpbrushgenerated-load.h"
 #include "gimpbrushgenerated-save.h"
@@ -36,6 +37,27 @@
 
 #define OVERSAMPLING 4
 
+/*  the minimal number of pixels each thread rasterizes  */
+#define MIN_PARALLEL_SUB_AREA (64 * 64)
+
+
+typedef struct
+{
+  GimpBrushGeneratedShape  shape;
+  gdouble                  radius;
+  gint                     spikes;
+  gdouble                  aspect_ratio;
+  gdouble                  s;
+  gdouble                  c;
+  const gdouble           *spike_cos;
+  const gdouble           *spike_sin;
+  const guchar            *lookup;
+  guchar                  *centerp;
+  gint                     mask_width;
+  gint                     half_width;
+  gint                     first_row;
+} GimpBrushGeneratedCalcData;
+
 
 enum
 {
@@ -85,6 +107,9 @@ static GimpTempBuf * gimp_brush_generated_calc          (GimpBrushGenerated
                                                          gfloat                   angle,
                                                          GimpVector2             *xaxis,
                                                          GimpVector2             *yaxis);
+static void          gimp_brush_generated_calc_rows     (gsize                    offset,
+                                                         gsize                    size,
+                                                         GimpBrushGeneratedCalcData *data);
 static void          gimp_brush_generated_get_half_size (GimpBrushGenerated      *gbrush,
                                                          GimpBrushGeneratedShape  shape,
                                                          gfloat                   radius,
@@ -449,81 +474,60 @@ gimp_brush_generated_calc_lut (gdouble radius,
   return lookup;
 }
 
-static GimpTempBuf *
-gimp_brush_generated_calc (GimpBrushGenerated      *brush,
-                           GimpBrushGeneratedShape  shape,
-                           gfloat                   radius,
-                           gint                     spikes,
-                           gfloat                   hardness,
-                           gfloat                   aspect_ratio,
-                           gfloat                   angle,
-                           GimpVector2             *xaxis,
-                           GimpVector2             *yaxis)
+static void
+gimp_brush_generated_calc_rows (gsize                       offset,
+                                gsize                       size,
+                                GimpBrushGeneratedCalcData *data)
 {
-  guchar      *centerp;
-  guchar      *lookup;
-  guchar       a;
-  gint         half_width  = 0;
-  gint         half_height = 0;
-  gint         x, y;
-  gdouble      c, s, cs, ss;
-  GimpVector2  x_axis;
-  GimpVector2  y_axis;
-  GimpTempBuf *mask;
-  gint         mask_width;
-
-  gimp_brush_generated_get_half_size (brush,
-                                      shape,
-                                      radius,
-                                      spikes,
-                                      hardness,
-                                      aspect_ratio,
-                                      angle,
-                                      &half_width, &half_height,
-                                      &s, &c, &x_axis, &y_axis);
-
-  mask = gimp_temp_buf_new (half_width  * 2 + 1,
-                            half_height * 2 + 1,
-                            babl_format ("Y u8"));
-
-  mask_width = gimp_temp_buf_get_width (mask);
-
-  centerp = gimp_temp_buf_get_data (mask) +
-            half_height * mask_width + half_width;
-
-  lookup = gimp_brush_generated_calc_lut (radius, hardness);
-
-  cs = cos (- 2 * G_PI / spikes);
-  ss = sin (- 2 * G_PI / spikes);
-
-  /* for an even number of spikes compute one half and mirror it */
-  for (y = ((spikes % 2) ? -half_height : 0); y <= half_height; y++)
+  const gdouble  radius     = data->radius;
+  const gint     spikes     = data->spikes;
+  const gdouble  c          = data->c;
+  const gdouble  s          = data->s;
+  const gint     mask_width = data->mask_width;
+  const gint     half_width = data->half_width;
+  guchar        *centerp    = data->centerp;
+  gint           y;
+
+  for (y = data->first_row + offset;
+       y < data->first_row + (gint) (offset + size);
+       y++)
     {
-      for (x = -half_width; x <= half_width; x++)
+      /*  step tx and the unmirrored ty incrementally along the row  */
+      gdouble row_tx = c * -half_width - s * y;
+      gdouble row_ty = s * -half_width + c * y;
+      gint    x;
+
+      for (x = -half_width; x <= half_width; x++, row_tx += c, row_ty += s)
         {
           gdouble d  = 0;
-          gdouble tx = c * x - s * y;
-          gdouble ty = fabs (s * x + c * y);
+          gdouble tx = row_tx;
+          gdouble ty = fabs (row_ty);
+          guchar  a;
 
           if (spikes > 2)
             {
               gdouble angle = atan2 (ty, tx);
 
-              while (angle > G_PI / spikes)
+              /*  rotate into the first spike's sector in one step,
+               *  instead of one spike at a time
+               */
+              if (angle > G_PI / spikes)
                 {
+                  gint    n  = ceil ((angle - G_PI / spikes) /
+                                     (2 * G_PI / spikes));
                   gdouble sx = tx;
                   gdouble sy = ty;
 
-                  tx = cs * sx - ss * sy;
-                  ty = ss * sx + cs * sy;
+                  n = MIN (n, spikes);
 
-                  angle -= 2 * G_PI / spikes;
+                  tx = data->spike_cos[n] * sx - data->spike_sin[n] * sy;
+                  ty = data->spike_sin[n] * sx + data->spike_cos[n] * sy;
                 }
             }
 
-          ty *= aspect_ratio;
+          ty *= data->aspect_ratio;
 
-          switch (shape)
+          switch (data->shape)
             {
             case GIMP_BRUSH_GENERATED_CIRCLE:
               d = sqrt (SQR (tx) + SQR (ty));
@@ -537,7 +541,7 @@ gimp_brush_generated_calc (GimpBrushGenerated      *brush,
             }
 
           if (d < radius + 1)
-            a = lookup[(gint) RINT (d * OVERSAMPLING)];
+            a = data->lookup[(gint) RINT (d * OVERSAMPLING)];
           else
             a = 0;
 
@@ -547,7 +551,90 @@ gimp_brush_generated_calc (GimpBrushGenerated      *brush,
             centerp[-1 * y * mask_width - x] = a;
         }
     }
+}
+
+static GimpTempBuf *
+gimp_brush_generated_calc (GimpBrushGenerated      *brush,
+                           GimpBrushGeneratedShape  shape,
+                           gfloat                   radius,
+                           gint                     spikes,
+                           gfloat                   hardness,
+                           gfloat                   aspect_ratio,
+                           gfloat                   angle,
+                           GimpVector2             *xaxis,
+                           GimpVector2             *yaxis)
+{
+  GimpBrushGeneratedCalcData  data;
+  guchar                     *lookup;
+  gdouble                    *spike_cos;
+  gdouble                    *spike_sin;
+  gint                        half_width  = 0;
+  gint                        half_height = 0;
+  gint                        n_rows;
+  gint                        i;
+  gdouble                     c, s;
+  GimpVector2                 x_axis;
+  GimpVector2                 y_axis;
+  GimpTempBuf                *mask;
+  gint                        mask_width;
 
+  gimp_brush_generated_get_half_size (brush,
+                                      shape,
+                                      radius,
+                                      spikes,
+                                      hardness,
+                                      aspect_ratio,
+                                      angle,
+                                      &half_width, &half_height,
+                                      &s, &c, &x_axis, &y_axis);
+
+  mask = gimp_temp_buf_new (half_width  * 2 + 1,
+                            half_height * 2 + 1,
+                            babl_format ("Y u8"));
+
+  mask_width = gimp_temp_buf_get_width (mask);
+
+  lookup = gimp_brush_generated_calc_lut (radius, hardness);
+
+  /*  the rotations by n spikes, for n = 0 ... spikes  */
+  spike_cos = g_new (gdouble, spikes + 1);
+  spike_sin = g_new (gdouble, spikes + 1);
+
+  for (i = 0; i <= spikes; i++)
+    {
+      spike_cos[i] = cos (- 2 * G_PI * i / spikes);
+      spike_sin[i] = sin (- 2 * G_PI * i / spikes);
+    }
+
+  data.shape        = shape;
+  data.radius       = radius;
+  data.spikes       = spikes;
+  data.aspect_ratio = aspect_ratio;
+  data.s            = s;
+  data.c            = c;
+  data.spike_cos    = spike_cos;
+  data.spike_sin    = spike_sin;
+  data.lookup       = lookup;
+  data.centerp      = gimp_temp_buf_get_data (mask) +
+                      half_height * mask_width + half_width;
+  data.mask_width   = mask_width;
+  data.half_width   = half_width;
+
+  /* for an even number of spikes compute one half and mirror it */
+  data.first_row = (spikes % 2) ? -half_height : 0;
+  n_rows         = half_height - data.first_row + 1;
+
+  /*  every row, and its mirrored counterpart, is written by exactly
+   *  one thread
+   */
+  gimp_parallel_distribute_range (n_rows,
+                                  MAX (1, MIN_PARALLEL_SUB_AREA / mask_width),
+                                  (GimpParallelDistributeRangeFunc)
+                                  gimp_brush_generated_calc_rows,
+                                  &data);
+
+  g_free (spike_sin);
+  g_free (spike_cos);
   g_free (lookup);
 
   if (xaxis)
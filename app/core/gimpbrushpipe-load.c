@@ -23,6 +23,7 @@
 #include <errno.h>
 
 #include <sys/types.h>
+#include <sys/stat.h>
 
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
@@ -66,6 +67,7 @@ gimp_brush_pipe_load (GimpContext  *context,
   GString           *buffer;
   gchar              c;
   gint               fd;
+  struct stat        st;
 
   g_return_val_if_fail (filename != NULL, NULL);
   g_return_val_if_fail (g_path_is_absolute (filename), NULL);
@@ -205,18 +207,24 @@ gimp_brush_pipe_load (GimpContext  *context,
   g_assert (pipe->stride[pipe->dimension-1] == 1);
 
   pipe->brushes = g_new0 (GimpBrush *, num_of_brushes);
+  pipe->offsets = g_new0 (goffset, num_of_brushes);
+  pipe->stamps  = g_new0 (guint, num_of_brushes);
 
+  /*  only the first brush is loaded now, the others are loaded by
+   *  gimp_brush_pipe_get_brush() when they are first selected
+   */
   while (pipe->n_brushes < num_of_brushes)
     {
-      pipe->brushes[pipe->n_brushes] = gimp_brush_load_brush (context,
-                                                              fd, filename, NULL);
+      GimpBrush *brush;
 
-      if (pipe->brushes[pipe->n_brushes])
-        {
-          gimp_object_set_name (GIMP_OBJECT (pipe->brushes[pipe->n_brushes]),
-                                NULL);
-        }
+      pipe->offsets[pipe->n_brushes] = lseek (fd, 0, SEEK_CUR);
+
+      if (pipe->n_brushes == 0)
+        brush = gimp_brush_load_brush (context, fd, filename, NULL);
       else
+        brush = gimp_brush_load_brush_header (context, fd, filename, NULL);
+
+      if (! brush)
         {
           g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
                        _("Fatal parse error in brush file '%s': "
@@ -227,9 +235,32 @@ gimp_brush_pipe_load (GimpContext  *context,
           return NULL;
         }
 
+      if (pipe->n_brushes == 0)
+        {
+          gimp_object_set_name (GIMP_OBJECT (brush), NULL);
+
+          pipe->brushes[0] = brush;
+        }
+      else
+        {
+          g_object_unref (brush);
+        }
+
       pipe->n_brushes++;
     }
 
+  /*  the skipped brushes must all be there  */
+  if (fstat (fd, &st) == 0 && lseek (fd, 0, SEEK_CUR) > st.st_size)
+    {
+      g_set_error (error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                   _("Fatal parse error in brush file '%s': "
+                     "File appears truncated."),
+                   gimp_filename_to_utf8 (filename));
+      close (fd);
+      g_object_unref (pipe);
+      return NULL;
+    }
+
   close (fd);
 
   /* Current brush is the first one. */
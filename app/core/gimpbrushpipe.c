@@ -18,16 +18,42 @@
 
 #include "config.h"
 
+#include <errno.h>
+
+#include <sys/types.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <fcntl.h>
+
+#ifndef _O_BINARY
+#define _O_BINARY 0
+#endif
+
 #include <gegl.h>
+#include <glib/gstdio.h>
+
+#ifdef G_OS_WIN32
+#include <io.h>
+#endif
 
+#include "libgimpbase/gimpbase.h"
 #include "libgimpmath/gimpmath.h"
 
 #include "core-types.h"
 
+#include "gimpbrush-load.h"
 #include "gimpbrushpipe.h"
 #include "gimpbrushpipe-load.h"
 
 
+/*  the number of loaded brushes a pipe keeps when it isn't used,
+ *  the least recently selected ones are unloaded first
+ */
+#define MAX_LOADED_BRUSHES 32
+
+
 static void        gimp_brush_pipe_finalize         (GObject          *object);
 
 static gint64      gimp_brush_pipe_get_memsize      (GimpObject       *object,
@@ -49,6 +75,10 @@ static gboolean    gimp_brush_pipe_want_null_motion (GimpBrush        *brush,
                                                      const GimpCoords *last_coords,
                                                      const GimpCoords *current_coords);
 
+static GimpBrush * gimp_brush_pipe_load_brush       (GimpBrushPipe    *pipe,
+                                                     gint              index);
+static void        gimp_brush_pipe_unload_brushes   (GimpBrushPipe    *pipe);
+
 
 G_DEFINE_TYPE (GimpBrushPipe, gimp_brush_pipe, GIMP_TYPE_BRUSH);
 
@@ -84,6 +114,9 @@ gimp_brush_pipe_init (GimpBrushPipe *pipe)
   pipe->stride    = NULL;
   pipe->n_brushes = 0;
   pipe->brushes   = NULL;
+  pipe->offsets   = NULL;
+  pipe->stamps    = NULL;
+  pipe->stamp     = 0;
   pipe->select    = NULL;
   pipe->index     = NULL;
 }
@@ -116,6 +149,17 @@ gimp_brush_pipe_finalize (GObject *object)
       pipe->brushes = NULL;
     }
 
+  if (pipe->offsets)
+    {
+      g_free (pipe->offsets);
+      pipe->offsets = NULL;
+    }
+  if (pipe->stamps)
+    {
+      g_free (pipe->stamps);
+      pipe->stamps = NULL;
+    }
+
   if (pipe->select)
     {
       g_free (pipe->select);
@@ -145,9 +189,14 @@ gimp_brush_pipe_get_memsize (GimpObject *object,
                                 sizeof (gint) /* stride */ +
                                 sizeof (PipeSelectModes));
 
+  memsize += pipe->n_brushes * (sizeof (GimpBrush *) +
+                                sizeof (goffset) +
+                                sizeof (guint));
+
   for (i = 0; i < pipe->n_brushes; i++)
-    memsize += gimp_object_get_memsize (GIMP_OBJECT (pipe->brushes[i]),
-                                        gui_size);
+    if (pipe->brushes[i])
+      memsize += gimp_object_get_memsize (GIMP_OBJECT (pipe->brushes[i]),
+                                          gui_size);
 
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
@@ -190,6 +239,12 @@ gimp_brush_pipe_end_use (GimpBrush *brush)
       gimp_brush_end_use (pipe->brushes[i]);
 }
 
+  /*  brushes aren't unloaded while the pipe is used, because the
+   *  paint core caches things by the address of their masks
+   */
+  gimp_brush_pipe_unload_brushes (pipe);
+}
+
 static GimpBrush *
 gimp_brush_pipe_select_brush (GimpBrush        *brush,
                               const GimpCoords *last_coords,
@@ -255,7 +310,7 @@ gimp_brush_pipe_select_brush (GimpBrush        *brush,
   /* Make sure is inside bounds */
   brushix = CLAMP (brushix, 0, pipe->n_brushes - 1);
 
-  pipe->current = pipe->brushes[brushix];
+  pipe->current = gimp_brush_pipe_get_brush (pipe, brushix);
 
   return GIMP_BRUSH (pipe->current);
 }
@@ -277,3 +332,122 @@ gimp_brush_pipe_want_null_motion (GimpBrush        *brush,
 
   return TRUE;
 }
+
+
+/*  public functions  */
+
+/**
+ * gimp_brush_pipe_get_brush:
+ * @pipe:  a #GimpBrushPipe
+ * @index: the index of a brush in @pipe
+ *
+ * Loads the brush from the pipe's file, if it isn't loaded yet. If
+ * the brush can't be loaded, the first brush is returned instead.
+ *
+ * Return value: the brush at @index, owned by @pipe.
+ **/
+GimpBrush *
+gimp_brush_pipe_get_brush (GimpBrushPipe *pipe,
+                           gint           index)
+{
+  g_return_val_if_fail (GIMP_IS_BRUSH_PIPE (pipe), NULL);
+  g_return_val_if_fail (index >= 0 && index < pipe->n_brushes, NULL);
+
+  pipe->stamps[index] = ++pipe->stamp;
+
+  if (! pipe->brushes[index])
+    {
+      pipe->brushes[index] = gimp_brush_pipe_load_brush (pipe, index);
+
+      if (! pipe->brushes[index])
+        return pipe->brushes[0];
+
+      if (GIMP_BRUSH (pipe)->use_count > 0)
+        gimp_brush_begin_use (pipe->brushes[index]);
+      else
+        gimp_brush_pipe_unload_brushes (pipe);
+    }
+
+  return pipe->brushes[index];
+}
+
+
+/*  private functions  */
+
+static GimpBrush *
+gimp_brush_pipe_load_brush (GimpBrushPipe *pipe,
+                            gint           index)
+{
+  const gchar *filename = gimp_data_get_filename (GIMP_DATA (pipe));
+  GimpBrush   *brush    = NULL;
+  GError      *error    = NULL;
+  gint         fd;
+
+  if (! filename)
+    return NULL;
+
+  fd = g_open (filename, O_RDONLY | _O_BINARY, 0);
+
+  if (fd == -1)
+    {
+      g_printerr ("Could not open '%s' for reading: %s\n",
+                  gimp_filename_to_utf8 (filename), g_strerror (errno));
+      return NULL;
+    }
+
+  if (lseek (fd, pipe->offsets[index], SEEK_SET) == pipe->offsets[index])
+    brush = gimp_brush_load_brush (NULL, fd, filename, &error);
+
+  close (fd);
+
+  if (! brush)
+    {
+      if (error)
+        {
+          g_printerr ("%s\n", error->message);
+          g_clear_error (&error);
+        }
+
+      return NULL;
+    }
+
+  gimp_object_set_name (GIMP_OBJECT (brush), NULL);
+
+  return brush;
+}
+
+/*  unloads the least recently selected brushes, but never the first
+ *  one, whose mask is shared with the pipe, or the current one
+ */
+static void
+gimp_brush_pipe_unload_brushes (GimpBrushPipe *pipe)
+{
+  gint n_loaded = 0;
+  gint i;
+
+  for (i = 0; i < pipe->n_brushes; i++)
+    if (pipe->brushes[i])
+      n_loaded++;
+
+  while (n_loaded > MAX_LOADED_BRUSHES)
+    {
+      gint oldest = -1;
+
+      for (i = 1; i < pipe->n_brushes; i++)
+        {
+          if (pipe->brushes[i] && pipe->brushes[i] != pipe->current &&
+              (oldest == -1 || pipe->stamps[i] < pipe->stamps[oldest]))
+            {
+              oldest = i;
+            }
+        }
+
+      if (oldest == -1)
+        break;
+
+      g_object_unref (pipe->brushes[oldest]);
+      pipe->brushes[oldest] = NULL;
+
+      n_loaded--;
+    }
+}
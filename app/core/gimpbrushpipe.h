@@ -59,7 +59,10 @@ struct _GimpBrushPipe
 
   gint              n_brushes;  /* Might be less than the product of the
                                  * ranks in some odd special case */
-  GimpBrush       **brushes;
+  GimpBrush       **brushes;    /* NULL for brushes that aren't loaded */
+  goffset          *offsets;    /* File offset of each brush */
+  guint            *stamps;     /* When each brush was last selected */
+  guint             stamp;
   GimpBrush        *current;    /* Currently selected brush */
 };
 
@@ -69,7 +72,10 @@ struct _GimpBrushPipeClass
 };
 
 
-GType   gimp_brush_pipe_get_type (void) G_GNUC_CONST;
+GType       gimp_brush_pipe_get_type  (void) G_GNUC_CONST;
+
+GimpBrush * gimp_brush_pipe_get_brush (GimpBrushPipe *pipe,
+                                       gint           index);
 
 
 #endif  /* __GIMP_BRUSH_PIPE_H__ */
@@ -77,7 +77,7 @@ gimp_channel_combine_rect (GimpChannel    *mask,
     }
   else
     {
-      mask->bounds_known = FALSE;
+      gimp_channel_invalidate_bounds (mask, GEGL_RECTANGLE (x, y, w, h));
     }
 
   mask->x1 = CLAMP (mask->x1, 0, gimp_item_get_width  (GIMP_ITEM (mask)));
@@ -187,7 +187,7 @@ gimp_channel_combine_ellipse_rect (GimpChannel    *mask,
     }
   else
     {
-      mask->bounds_known = FALSE;
+      gimp_channel_invalidate_bounds (mask, GEGL_RECTANGLE (x, y, w, h));
     }
 
   gimp_drawable_update (GIMP_DRAWABLE (mask), x, y, w, h);
@@ -238,7 +238,7 @@ gimp_channel_combine_buffer (GimpChannel    *mask,
                             gimp_item_get_height (GIMP_ITEM (mask)),
                             &x, &y, &w, &h);
 
-  mask->bounds_known = FALSE;
+  gimp_channel_invalidate_bounds (mask, GEGL_RECTANGLE (x, y, w, h));
 
   gimp_drawable_update (GIMP_DRAWABLE (mask), x, y, w, h);
 }
@@ -467,6 +467,7 @@ gimp_channel_select_component (GimpChannel     *channel,
     gimp_channel_feather (add_on,
                           feather_radius_x,
                           feather_radius_y,
+                          NULL,
                           FALSE /* no undo */);
 
   gimp_enum_get_value (GIMP_TYPE_CHANNEL_TYPE, component,
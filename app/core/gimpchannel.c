@@ -31,6 +31,7 @@
 #include "paint/gimppaintoptions.h"
 
 #include "gegl/gimp-gegl-apply-operation.h"
+#include "gegl/gimp-gegl-loops.h"
 #include "gegl/gimp-gegl-mask.h"
 #include "gegl/gimp-gegl-utils.h"
 
@@ -50,6 +51,7 @@
 #include "gimpmarshal.h"
 #include "gimppaintinfo.h"
 #include "gimppickable.h"
+#include "gimpprogress.h"
 #include "gimpstrokeoptions.h"
 
 #include "gimp-intl.h"
@@ -195,6 +197,7 @@ static gboolean   gimp_channel_real_is_empty (GimpChannel         *channel);
 static void       gimp_channel_real_feather  (GimpChannel         *channel,
                                               gdouble              radius_x,
                                               gdouble              radius_y,
+                                              GimpProgress        *progress,
                                               gboolean             push_undo);
 static void       gimp_channel_real_sharpen  (GimpChannel         *channel,
                                               gboolean             push_undo);
@@ -339,6 +342,8 @@ gimp_channel_init (GimpChannel *channel)
   channel->y1             = 0;
   channel->x2             = 0;
   channel->y2             = 0;
+
+  channel->bounds_hint_known = FALSE;
 }
 
 static void
@@ -872,8 +877,8 @@ gimp_channel_convert_type (GimpDrawable      *drawable,
 
   if (mask_dither_type == 0)
     {
-      gegl_buffer_copy (gimp_drawable_get_buffer (drawable), NULL,
-                        dest_buffer, NULL);
+      gimp_gegl_copy (gimp_drawable_get_buffer (drawable), NULL,
+                      dest_buffer, NULL);
     }
   else
     {
@@ -934,7 +939,7 @@ gimp_channel_apply_buffer (GimpDrawable         *drawable,
                                                     base_buffer,
                                                     base_x, base_y);
 
-  GIMP_CHANNEL (drawable)->bounds_known = FALSE;
+  gimp_channel_invalidate_bounds (GIMP_CHANNEL (drawable), NULL);
 }
 
 static void
@@ -958,7 +963,7 @@ gimp_channel_replace_buffer (GimpDrawable        *drawable,
                                                       mask, mask_region,
                                                       x, y);
 
-  GIMP_CHANNEL (drawable)->bounds_known = FALSE;
+  gimp_channel_invalidate_bounds (GIMP_CHANNEL (drawable), NULL);
 }
 
 static void
@@ -974,7 +979,7 @@ gimp_channel_set_buffer (GimpDrawable *drawable,
                                                   buffer,
                                                   offset_x, offset_y);
 
-  GIMP_CHANNEL (drawable)->bounds_known = FALSE;
+  gimp_channel_invalidate_bounds (GIMP_CHANNEL (drawable), NULL);
 }
 
 static void
@@ -987,7 +992,10 @@ gimp_channel_swap_pixels (GimpDrawable *drawable,
 
   GIMP_DRAWABLE_CLASS (parent_class)->swap_pixels (drawable, buffer, x, y);
 
-  GIMP_CHANNEL (drawable)->bounds_known = FALSE;
+  gimp_channel_invalidate_bounds (GIMP_CHANNEL (drawable),
+                                  GEGL_RECTANGLE (x, y,
+                                                  gegl_buffer_get_width  (buffer),
+                                                  gegl_buffer_get_height (buffer)));
 }
 
 static gdouble
@@ -1110,14 +1118,23 @@ gimp_channel_real_bounds (GimpChannel *channel,
 
   buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
 
-  channel->empty = ! gimp_gegl_mask_bounds (buffer, x1, y1, x2, y2);
+  /*  only the area that was changed since the bounds were last known
+   *  can have grown the bounds, so there is no need to look elsewhere
+   */
+  if (channel->bounds_hint_known)
+    channel->empty = ! gimp_gegl_mask_area_bounds (buffer,
+                                                   &channel->bounds_hint,
+                                                   x1, y1, x2, y2);
+  else
+    channel->empty = ! gimp_gegl_mask_bounds (buffer, x1, y1, x2, y2);
 
   channel->x1 = *x1;
   channel->y1 = *y1;
   channel->x2 = *x2;
   channel->y2 = *y2;
 
-  channel->bounds_known = TRUE;
+  channel->bounds_known      = TRUE;
+  channel->bounds_hint_known = FALSE;
 
   return ! channel->empty;
 }
@@ -1130,6 +1147,14 @@ gimp_channel_real_is_empty (GimpChannel *channel)
   if (channel->bounds_known)
     return channel->empty;
 
+  /*  cheaper than scanning the whole mask  */
+  if (channel->bounds_hint_known)
+    {
+      gint x1, y1, x2, y2;
+
+      return ! gimp_channel_bounds (channel, &x1, &y1, &x2, &y2);
+    }
+
   buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (channel));
 
   if (! gimp_gegl_mask_is_empty (buffer))
@@ -1157,26 +1182,41 @@ gimp_channel_real_is_empty (GimpChannel *channel)
 }
 
 static void
-gimp_channel_real_feather (GimpChannel *channel,
-                           gdouble      radius_x,
-                           gdouble      radius_y,
-                           gboolean     push_undo)
-{
-  GimpDrawable *drawable = GIMP_DRAWABLE (channel);
+gimp_channel_real_feather (GimpChannel  *channel,
+                           gdouble       radius_x,
+                           gdouble       radius_y,
+                           GimpProgress *progress,
+                           gboolean      push_undo)
+{
+  GimpDrawable *drawable  = GIMP_DRAWABLE (channel);
+  const gchar  *undo_desc = GIMP_CHANNEL_GET_CLASS (channel)->feather_desc;
+  GeglBuffer   *src_buffer;
+  GeglBuffer   *buffer;
+
+  src_buffer = gimp_drawable_get_buffer (drawable);
+
+  /*  feather into a buffer of its own first, so nothing changes, and
+   *  no undo step is pushed, when the progress gets cancelled
+   */
+  buffer = gegl_buffer_new (gegl_buffer_get_extent (src_buffer),
+                            babl_format ("Y float"));
+
+  if (! gimp_gegl_apply_feather (src_buffer, progress, undo_desc, buffer,
+                                 radius_x, radius_y))
+    {
+      g_object_unref (buffer);
+      return;
+    }
 
   if (push_undo)
-    gimp_channel_push_undo (channel,
-                            GIMP_CHANNEL_GET_CLASS (channel)->feather_desc);
+    gimp_channel_push_undo (channel, undo_desc);
   else
     gimp_drawable_invalidate_boundary (drawable);
 
-  gimp_gegl_apply_feather (gimp_drawable_get_buffer (drawable),
-                           NULL, NULL,
-                           gimp_drawable_get_buffer (drawable),
-                           radius_x,
-                           radius_y);
+  gimp_gegl_copy (buffer, NULL, src_buffer, NULL);
+  g_object_unref (buffer);
 
-  channel->bounds_known = FALSE;
+  gimp_channel_invalidate_bounds (channel, NULL);
 
   gimp_drawable_update (GIMP_DRAWABLE (channel), 0, 0,
                         gimp_item_get_width  (GIMP_ITEM (channel)),
@@ -1200,7 +1240,7 @@ gimp_channel_real_sharpen (GimpChannel *channel,
                              gimp_drawable_get_buffer (drawable),
                              0.5);
 
-  channel->bounds_known = FALSE;
+  gimp_channel_invalidate_bounds (channel, NULL);
 
   gimp_drawable_update (GIMP_DRAWABLE (channel), 0, 0,
                         gimp_item_get_width  (GIMP_ITEM (channel)),
@@ -1303,7 +1343,7 @@ gimp_channel_real_invert (GimpChannel *channel,
                                      NULL, NULL,
                                      gimp_drawable_get_buffer (drawable));
 
-      channel->bounds_known = FALSE;
+      gimp_channel_invalidate_bounds (channel, NULL);
 
       gimp_drawable_update (GIMP_DRAWABLE (channel), 0, 0,
                             gimp_item_get_width  (GIMP_ITEM (channel)),
@@ -1373,7 +1413,7 @@ gimp_channel_real_border (GimpChannel *channel,
 
   g_object_unref (border);
 
-  channel->bounds_known = FALSE;
+  gimp_channel_invalidate_bounds (channel, NULL);
 
   gimp_drawable_update (GIMP_DRAWABLE (channel), 0, 0,
                         gimp_item_get_width  (GIMP_ITEM (channel)),
@@ -1447,7 +1487,7 @@ gimp_channel_real_grow (GimpChannel *channel,
 
   g_object_unref (grow);
 
-  channel->bounds_known = FALSE;
+  gimp_channel_invalidate_bounds (channel, NULL);
 
   gimp_drawable_update (GIMP_DRAWABLE (channel), 0, 0,
                         gimp_item_get_width  (GIMP_ITEM (channel)),
@@ -1512,7 +1552,7 @@ gimp_channel_real_shrink (GimpChannel *channel,
 
   g_object_unref (shrink);
 
-  channel->bounds_known = FALSE;
+  gimp_channel_invalidate_bounds (channel, NULL);
 
   gimp_drawable_update (GIMP_DRAWABLE (channel), 0, 0,
                         gimp_item_get_width  (GIMP_ITEM (channel)),
@@ -1605,7 +1645,7 @@ gimp_channel_new_from_alpha (GimpImage     *image,
                     dest_buffer, NULL);
   gegl_buffer_set_format (dest_buffer, NULL);
 
-  channel->bounds_known = FALSE;
+  gimp_channel_invalidate_bounds (channel, NULL);
 
   return channel;
 }
@@ -1902,19 +1942,69 @@ gimp_channel_is_empty (GimpChannel *channel)
   return GIMP_CHANNEL_GET_CLASS (channel)->is_empty (channel);
 }
 
+/**
+ * gimp_channel_invalidate_bounds:
+ * @channel: a #GimpChannel
+ * @area:    the area that was changed, or %NULL if unknown
+ *
+ * Marks the channel's bounds as unknown after its pixels were
+ * changed.  If @area is given, the new bounds are later searched
+ * only in @area and the previously known bounds, instead of in the
+ * whole channel.
+ **/
 void
-gimp_channel_feather (GimpChannel *channel,
-                      gdouble      radius_x,
-                      gdouble      radius_y,
-                      gboolean     push_undo)
+gimp_channel_invalidate_bounds (GimpChannel         *channel,
+                                const GeglRectangle *area)
+{
+  g_return_if_fail (GIMP_IS_CHANNEL (channel));
+
+  if (area && channel->bounds_known)
+    {
+      if (channel->empty)
+        {
+          channel->bounds_hint = *area;
+        }
+      else
+        {
+          GeglRectangle bounds = { channel->x1,
+                                   channel->y1,
+                                   channel->x2 - channel->x1,
+                                   channel->y2 - channel->y1 };
+
+          gegl_rectangle_bounding_box (&channel->bounds_hint, &bounds, area);
+        }
+
+      channel->bounds_hint_known = TRUE;
+    }
+  else if (area && channel->bounds_hint_known)
+    {
+      GeglRectangle hint = channel->bounds_hint;
+
+      gegl_rectangle_bounding_box (&channel->bounds_hint, &hint, area);
+    }
+  else
+    {
+      channel->bounds_hint_known = FALSE;
+    }
+
+  channel->bounds_known = FALSE;
+}
+
+void
+gimp_channel_feather (GimpChannel  *channel,
+                      gdouble       radius_x,
+                      gdouble       radius_y,
+                      GimpProgress *progress,
+                      gboolean      push_undo)
 {
   g_return_if_fail (GIMP_IS_CHANNEL (channel));
+  g_return_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress));
 
   if (! gimp_item_is_attached (GIMP_ITEM (channel)))
     push_undo = FALSE;
 
   GIMP_CHANNEL_GET_CLASS (channel)->feather (channel, radius_x, radius_y,
-                                             push_undo);
+                                             progress, push_undo);
 }
 
 void
@@ -53,6 +53,8 @@ struct _GimpChannel
   gboolean      bounds_known;      /*  recalculate the bounds?        */
   gint          x1, y1;            /*  coordinates for bounding box   */
   gint          x2, y2;            /*  lower right hand coordinate    */
+  gboolean      bounds_hint_known; /*  is bounds_hint valid?          */
+  GeglRectangle bounds_hint;       /*  area to search for the bounds  */
 };
 
 struct _GimpChannelClass
@@ -82,6 +84,7 @@ struct _GimpChannelClass
   void     (* feather)       (GimpChannel         *channel,
                               gdouble              radius_x,
                               gdouble              radius_y,
+                              GimpProgress        *progress,
                               gboolean             push_undo);
   void     (* sharpen)       (GimpChannel         *channel,
                               gboolean             push_undo);
@@ -183,10 +186,13 @@ gboolean      gimp_channel_bounds             (GimpChannel         *mask,
                                                gint                *x2,
                                                gint                *y2);
 gboolean      gimp_channel_is_empty           (GimpChannel         *mask);
+void          gimp_channel_invalidate_bounds  (GimpChannel         *mask,
+                                               const GeglRectangle *area);
 
 void          gimp_channel_feather            (GimpChannel         *mask,
                                                gdouble              radius_x,
                                                gdouble              radius_y,
+                                               GimpProgress        *progress,
                                                gboolean             push_undo);
 void          gimp_channel_sharpen            (GimpChannel         *mask,
                                                gboolean             push_undo);
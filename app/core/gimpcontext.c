@@ -2594,6 +2594,12 @@ gimp_context_real_set_brush (GimpContext *context,
   if (context->brush == brush)
     return;
 
+  /*  lazily loaded brushes are completed when they become active,
+   *  so everything using the context's brush sees the full data
+   */
+  if (brush)
+    gimp_data_ensure_loaded (GIMP_DATA (brush));
+
   if (context->brush_name &&
       brush != GIMP_BRUSH (gimp_brush_get_standard (context)))
     {
@@ -2832,6 +2838,10 @@ gimp_context_real_set_pattern (GimpContext *context,
   if (context->pattern == pattern)
     return;
 
+  /*  see gimp_context_real_set_brush()  */
+  if (pattern)
+    gimp_data_ensure_loaded (GIMP_DATA (pattern));
+
   if (context->pattern_name &&
       pattern != GIMP_PATTERN (gimp_pattern_get_standard (context)))
     {
@@ -82,6 +82,12 @@ struct _GimpDataPrivate
   gchar  *identifier;
 
   GList  *tags;
+
+  /* Set while only the name of the data has been loaded, the rest
+   * is loaded by lazy_load_func on first use.
+   */
+  GimpDataLazyLoadFunc  lazy_load_func;
+  gpointer              lazy_load_data;
 };
 
 #define GIMP_DATA_GET_PRIVATE(data) \
@@ -191,6 +197,7 @@ gimp_data_class_init (GimpDataClass *klass)
   klass->save                     = NULL;
   klass->get_extension            = NULL;
   klass->duplicate                = NULL;
+  klass->copy                     = NULL;
 
   g_object_class_install_property (object_class, PROP_FILENAME,
                                    g_param_spec_string ("filename", NULL, NULL,
@@ -1019,6 +1026,8 @@ gimp_data_duplicate (GimpData *data)
 {
   g_return_val_if_fail (GIMP_IS_DATA (data), NULL);
 
+  gimp_data_ensure_loaded (data);
+
   if (GIMP_DATA_GET_CLASS (data)->duplicate)
     {
       GimpData        *new     = GIMP_DATA_GET_CLASS (data)->duplicate (data);
@@ -1042,6 +1051,108 @@ gimp_data_duplicate (GimpData *data)
   return NULL;
 }
 
+/**
+ * gimp_data_copy:
+ * @data:     a #GimpData object
+ * @src_data: the #GimpData to copy from
+ *
+ * Replaces the contents of @data with a copy of the contents of
+ * @src_data, which must be of the same type as @data or of a type
+ * derived from it.  Like with gimp_data_duplicate(), only the object
+ * data is copied, @data keeps its name, file name and tags.  @data is
+ * not marked as dirty.
+ **/
+void
+gimp_data_copy (GimpData *data,
+                GimpData *src_data)
+{
+  g_return_if_fail (GIMP_IS_DATA (data));
+  g_return_if_fail (GIMP_IS_DATA (src_data));
+  g_return_if_fail (g_type_is_a (G_TYPE_FROM_INSTANCE (src_data),
+                                 G_TYPE_FROM_INSTANCE (data)));
+
+  if (GIMP_DATA_GET_CLASS (data)->copy)
+    GIMP_DATA_GET_CLASS (data)->copy (data, src_data);
+}
+
+/**
+ * gimp_data_set_lazy_load:
+ * @data:      a #GimpData object
+ * @load_func: the function that loads the complete data
+ * @user_data: data to pass to @load_func
+ *
+ * Marks @data as only partially loaded.  The first call to
+ * gimp_data_ensure_loaded() calls @load_func and copies the returned,
+ * fully loaded data into @data using gimp_data_copy().  This is used
+ * to defer decoding large data files until they are actually used.
+ **/
+void
+gimp_data_set_lazy_load (GimpData             *data,
+                         GimpDataLazyLoadFunc  load_func,
+                         gpointer              user_data)
+{
+  GimpDataPrivate *private;
+
+  g_return_if_fail (GIMP_IS_DATA (data));
+  g_return_if_fail (load_func == NULL || GIMP_DATA_GET_CLASS (data)->copy);
+
+  private = GIMP_DATA_GET_PRIVATE (data);
+
+  private->lazy_load_func = load_func;
+  private->lazy_load_data = user_data;
+}
+
+gboolean
+gimp_data_is_lazy (GimpData *data)
+{
+  GimpDataPrivate *private;
+
+  g_return_val_if_fail (GIMP_IS_DATA (data), FALSE);
+
+  private = GIMP_DATA_GET_PRIVATE (data);
+
+  return private->lazy_load_func != NULL;
+}
+
+/**
+ * gimp_data_ensure_loaded:
+ * @data: a #GimpData object
+ *
+ * Completes loading @data if it was set up with
+ * gimp_data_set_lazy_load().  Does nothing for data that is already
+ * complete, so it is cheap to call this before every access to the
+ * contents of @data.
+ **/
+void
+gimp_data_ensure_loaded (GimpData *data)
+{
+  GimpDataPrivate      *private;
+  GimpDataLazyLoadFunc  load_func;
+  GimpData             *src_data;
+
+  g_return_if_fail (GIMP_IS_DATA (data));
+
+  private = GIMP_DATA_GET_PRIVATE (data);
+
+  if (G_LIKELY (! private->lazy_load_func))
+    return;
+
+  /*  clear the loader first, the copy below may end up calling
+   *  back into accessors that ensure the data is loaded
+   */
+  load_func = private->lazy_load_func;
+  private->lazy_load_func = NULL;
+
+  src_data = load_func (data, private->lazy_load_data);
+  private->lazy_load_data = NULL;
+
+  if (src_data)
+    {
+      gimp_data_copy (data, src_data);
+      g_object_unref (src_data);
+    }
+}
+
 /**
  * gimp_data_make_internal:
  * @data: a #GimpData object.
@@ -44,6 +44,9 @@ typedef enum
 
 typedef struct _GimpDataClass GimpDataClass;
 
+typedef GimpData * (* GimpDataLazyLoadFunc) (GimpData *data,
+                                             gpointer  user_data);
+
 struct _GimpData
 {
   GimpViewable  parent_instance;
@@ -61,6 +64,8 @@ struct _GimpDataClass
                                    GError   **error);
   const gchar * (* get_extension) (GimpData  *data);
   GimpData    * (* duplicate)     (GimpData  *data);
+  void          (* copy)          (GimpData  *data,
+                                   GimpData  *src_data);
 };
 
 
@@ -103,6 +108,14 @@ void          gimp_data_set_mtime        (GimpData     *data,
 gint64        gimp_data_get_mtime        (GimpData     *data);
 
 GimpData    * gimp_data_duplicate        (GimpData     *data);
+void          gimp_data_copy             (GimpData     *data,
+                                          GimpData     *src_data);
+
+void          gimp_data_set_lazy_load    (GimpData             *data,
+                                          GimpDataLazyLoadFunc  load_func,
+                                          gpointer              user_data);
+gboolean      gimp_data_is_lazy          (GimpData     *data);
+void          gimp_data_ensure_loaded    (GimpData     *data);
 
 void          gimp_data_make_internal    (GimpData     *data,
                                           const gchar  *identifier);
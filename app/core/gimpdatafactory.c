@@ -31,16 +31,22 @@
 
 #include "core-types.h"
 
+#include "config/gimpcoreconfig.h"
+
 #include "gimp.h"
 #include "gimpcontext.h"
 #include "gimpdata.h"
 #include "gimpdatafactory.h"
+#include "gimpdataindex.h"
 #include "gimplist.h"
 
 #include "gimp-intl.h"
 
 
-#define WRITABLE_PATH_KEY "gimp-data-factory-writable-path"
+/* The position of a data object among the objects loaded from its
+ * file, used to find it again when it is loaded lazily
+ */
+#define LAZY_POSITION_KEY "gimp-data-factory-lazy-position"
 
 /* Data files that have this string in their path are considered
  * obsolete and are only kept around for backwards compatibility
@@ -70,12 +76,46 @@ struct _GimpDataFactoryPriv
   GimpDataGetStandardFunc           data_get_standard_func;
 };
 
+/*  A data file that was read by gimp_data_factory_load_files(), its
+ *  objects are added to the containers by gimp_data_factory_load_add()
+ */
+typedef struct
+{
+  gchar                            *filename;
+  gint64                            mtime;
+  gchar                            *top_directory;
+  const GimpDataFactoryLoaderEntry *loader;
+  GList                            *data_list;
+  GError                           *error;
 
-static void    gimp_data_factory_finalize     (GObject              *object);
+  gboolean                          cached;
+  gboolean                          stubs;
+  gboolean                          obsolete;
+  gboolean                          writable;
+  gboolean                          deletable;
+} GimpDataLoadFile;
 
-static void    gimp_data_factory_data_load    (GimpDataFactory      *factory,
-                                               GimpContext          *context,
-                                               GHashTable           *cache);
+struct _GimpDataFactoryLoad
+{
+  GimpDataFactory *factory;
+  GimpContext     *context;
+  GHashTable      *cache;
+  const gchar     *top_directory;
+
+  gchar           *path;
+  GList           *writable_list;
+  gboolean         lazy;
+
+  GQueue           files;
+
+  /*  only set in lazy mode, while loading the files  */
+  GHashTable      *index;
+  GHashTable      *new_index;
+  gboolean         index_dirty;
+};
+
+
+static void    gimp_data_factory_finalize     (GObject              *object);
 
 static gint64  gimp_data_factory_get_memsize  (GimpObject           *object,
                                                gint64               *gui_size);
@@ -83,12 +123,43 @@ static gint64  gimp_data_factory_get_memsize  (GimpObject           *object,
 static gchar * gimp_data_factory_get_save_dir (GimpDataFactory      *factory,
                                                GError              **error);
 
+static GimpDataFactoryLoad *
+               gimp_data_factory_load_new     (GimpDataFactory      *factory,
+                                               GimpContext          *context,
+                                               GHashTable           *cache,
+                                               gboolean              no_data);
+static void    gimp_data_factory_load_files   (GimpDataFactoryLoad  *load);
+static void    gimp_data_factory_load_add     (GimpDataFactoryLoad  *load);
+
 static void    gimp_data_factory_load_data  (const GimpDatafileData *file_data,
                                              gpointer                data);
 
 static void    gimp_data_factory_load_data_recursive (const GimpDatafileData *file_data,
                                                       gpointer                data);
 
+static GList * gimp_data_factory_load_stubs (GimpDataFactoryLoad              *load,
+                                             const GimpDataFactoryLoaderEntry *loader,
+                                             const GimpDatafileData           *file_data,
+                                             gboolean                         *stubs,
+                                             GError                          **error);
+static void    gimp_data_factory_index_add  (GimpDataFactoryLoad              *load,
+                                             const gchar                      *filename,
+                                             gint64                            mtime,
+                                             GList                            *data_list);
+static gint    gimp_data_factory_position_compare
+                                            (GimpData                         *data1,
+                                             GimpData                         *data2);
+
+static const GimpDataFactoryLoaderEntry *
+               gimp_data_factory_get_loader   (GimpDataFactory      *factory,
+                                               const gchar          *filename);
+static gboolean gimp_data_factory_has_lazy_loaders
+                                              (GimpDataFactory      *factory);
+static gchar * gimp_data_factory_get_index_file
+                                              (GimpDataFactory      *factory);
+static GimpData * gimp_data_factory_load_lazy (GimpData             *data,
+                                               gpointer              user_data);
+
 G_DEFINE_TYPE (GimpDataFactory, gimp_data_factory, GIMP_TYPE_OBJECT)
 
 #define parent_class gimp_data_factory_parent_class
@@ -219,27 +290,70 @@ gimp_data_factory_data_init (GimpDataFactory *factory,
                              GimpContext     *context,
                              gboolean         no_data)
 {
+  GimpDataFactoryLoad *load;
+
   g_return_if_fail (GIMP_IS_DATA_FACTORY (factory));
   g_return_if_fail (GIMP_IS_CONTEXT (context));
 
-  /*  Freeze and thaw the container even if no_data,
-   *  this creates the standard data that serves as fallback.
-   */
-  gimp_container_freeze (factory->priv->container);
+  load = gimp_data_factory_data_init_begin (factory, context, no_data);
 
-  if (! no_data)
-    {
-      if (factory->priv->gimp->be_verbose)
-        {
-          const gchar *name = gimp_object_get_name (factory);
+  gimp_data_factory_data_init_load (load);
+  gimp_data_factory_data_init_finish (load);
+}
 
-          g_print ("Loading '%s' data\n", name ? name : "???");
-        }
+/**
+ * gimp_data_factory_data_init_begin:
+ * @factory: a #GimpDataFactory
+ * @context: the #GimpContext to pass to the loaders
+ * @no_data: whether to only create the standard data
+ *
+ * Starts loading the factory's data in three steps, so the files can
+ * be read and decoded in a thread: gimp_data_factory_data_init_begin()
+ * and gimp_data_factory_data_init_finish() must be called from the
+ * main thread, gimp_data_factory_data_init_load() may be called from
+ * any thread in between.  The factory's container is not touched
+ * before gimp_data_factory_data_init_finish().
+ *
+ * Note that some loaders report problems using g_message(), their
+ * factories must be loaded completely on the main thread.
+ *
+ * Return value: the load to pass to the other two functions.
+ **/
+GimpDataFactoryLoad *
+gimp_data_factory_data_init_begin (GimpDataFactory *factory,
+                                   GimpContext     *context,
+                                   gboolean         no_data)
+{
+  g_return_val_if_fail (GIMP_IS_DATA_FACTORY (factory), NULL);
+  g_return_val_if_fail (GIMP_IS_CONTEXT (context), NULL);
 
-      gimp_data_factory_data_load (factory, context, NULL);
+  if (! no_data && factory->priv->gimp->be_verbose)
+    {
+      const gchar *name = gimp_object_get_name (factory);
+
+      g_print ("Loading '%s' data\n", name ? name : "???");
     }
 
-  gimp_container_thaw (factory->priv->container);
+  return gimp_data_factory_load_new (factory, context, NULL, no_data);
+}
+
+void
+gimp_data_factory_data_init_load (GimpDataFactoryLoad *load)
+{
+  g_return_if_fail (load != NULL);
+
+  gimp_data_factory_load_files (load);
+}
+
+void
+gimp_data_factory_data_init_finish (GimpDataFactoryLoad *load)
+{
+  g_return_if_fail (load != NULL);
+
+  /*  This freezes and thaws the container even if no_data,
+   *  this creates the standard data that serves as fallback.
+   */
+  gimp_data_factory_load_add (load);
 }
 
 static void
@@ -304,77 +418,12 @@ gimp_data_factory_data_foreach (GimpDataFactory     *factory,
     }
 }
 
-typedef struct
-{
-  GimpDataFactory *factory;
-  GimpContext     *context;
-  GHashTable      *cache;
-  const gchar     *top_directory;
-} GimpDataLoadContext;
-
-static void
-gimp_data_factory_data_load (GimpDataFactory *factory,
-                             GimpContext     *context,
-                             GHashTable      *cache)
-{
-  gchar *path;
-  gchar *writable_path;
-
-  g_object_get (factory->priv->gimp->config,
-                factory->priv->path_property_name,     &path,
-                factory->priv->writable_property_name, &writable_path,
-                NULL);
-
-  if (path && strlen (path))
-    {
-      GList               *writable_list = NULL;
-      gchar               *tmp;
-      GimpDataLoadContext  load_context = { 0, };
-
-      load_context.factory = factory;
-      load_context.context = context;
-      load_context.cache   = cache;
-
-      tmp = gimp_config_path_expand (path, TRUE, NULL);
-      g_free (path);
-      path = tmp;
-
-      if (writable_path)
-        {
-          tmp = gimp_config_path_expand (writable_path, TRUE, NULL);
-          g_free (writable_path);
-          writable_path = tmp;
-
-          writable_list = gimp_path_parse (writable_path, 256, TRUE, NULL);
-
-          g_object_set_data (G_OBJECT (factory),
-                             WRITABLE_PATH_KEY, writable_list);
-        }
-
-      gimp_datafiles_read_directories (path, G_FILE_TEST_IS_REGULAR,
-                                       gimp_data_factory_load_data,
-                                       &load_context);
-
-      gimp_datafiles_read_directories (path, G_FILE_TEST_IS_DIR,
-                                       gimp_data_factory_load_data_recursive,
-                                       &load_context);
-
-      if (writable_path)
-        {
-          gimp_path_free (writable_list);
-          g_object_set_data (G_OBJECT (factory), WRITABLE_PATH_KEY, NULL);
-        }
-    }
-
-  g_free (path);
-  g_free (writable_path);
-}
-
 void
 gimp_data_factory_data_refresh (GimpDataFactory *factory,
                                 GimpContext     *context)
 {
-  GHashTable *cache;
+  GimpDataFactoryLoad *load;
+  GHashTable          *cache;
 
   g_return_if_fail (GIMP_IS_DATA_FACTORY (factory));
   g_return_if_fail (GIMP_IS_CONTEXT (context));
@@ -397,7 +446,10 @@ gimp_data_factory_data_refresh (GimpDataFactory *factory,
    *  objects remaining there will be those that are not present on
    *  the disk (that have to be destroyed)
    */
-  gimp_data_factory_data_load (factory, context, cache);
+  load = gimp_data_factory_load_new (factory, context, cache, FALSE);
+
+  gimp_data_factory_load_files (load);
+  gimp_data_factory_load_add (load);
 
   /*  Now all the data is loaded. Free what remains in the cache  */
   g_hash_table_foreach_remove (cache,
@@ -787,6 +839,189 @@ gimp_data_factory_get_save_dir (GimpDataFactory  *factory,
   return writable_dir;
 }
 
+static GimpDataFactoryLoad *
+gimp_data_factory_load_new (GimpDataFactory *factory,
+                            GimpContext     *context,
+                            GHashTable      *cache,
+                            gboolean         no_data)
+{
+  GimpDataFactoryLoad *load;
+  gchar               *path;
+  gchar               *writable_path;
+
+  load = g_slice_new0 (GimpDataFactoryLoad);
+
+  load->factory = g_object_ref (factory);
+  load->context = g_object_ref (context);
+  load->cache   = cache;
+
+  g_queue_init (&load->files);
+
+  if (no_data)
+    return load;
+
+  g_object_get (factory->priv->gimp->config,
+                factory->priv->path_property_name,     &path,
+                factory->priv->writable_property_name, &writable_path,
+                NULL);
+
+  if (path && strlen (path))
+    {
+      load->path = gimp_config_path_expand (path, TRUE, NULL);
+
+      if (writable_path)
+        {
+          gchar *tmp = gimp_config_path_expand (writable_path, TRUE, NULL);
+
+          load->writable_list = gimp_path_parse (tmp, 256, TRUE, NULL);
+          g_free (tmp);
+        }
+
+      load->lazy = (factory->priv->gimp->config->lazy_data_loading &&
+                    gimp_data_factory_has_lazy_loaders (factory));
+    }
+
+  g_free (path);
+  g_free (writable_path);
+
+  return load;
+}
+
+/*  doesn't touch the factory's containers and may run in any thread  */
+static void
+gimp_data_factory_load_files (GimpDataFactoryLoad *load)
+{
+  if (! load->path)
+    return;
+
+  if (load->lazy)
+    {
+      gchar *index_file = gimp_data_factory_get_index_file (load->factory);
+
+      /*  a missing or broken index is simply rebuilt  */
+      load->index = gimp_data_index_read (index_file, NULL);
+
+      if (! load->index)
+        load->index = gimp_data_index_new ();
+
+      load->new_index = gimp_data_index_new ();
+
+      g_free (index_file);
+    }
+
+  gimp_datafiles_read_directories (load->path, G_FILE_TEST_IS_REGULAR,
+                                   gimp_data_factory_load_data,
+                                   load);
+
+  gimp_datafiles_read_directories (load->path, G_FILE_TEST_IS_DIR,
+                                   gimp_data_factory_load_data_recursive,
+                                   load);
+
+  if (load->new_index)
+    {
+      if (load->index_dirty ||
+          g_hash_table_size (load->index) !=
+          g_hash_table_size (load->new_index))
+        {
+          gchar  *index_file = gimp_data_factory_get_index_file (load->factory);
+          GError *error      = NULL;
+
+          if (! gimp_data_index_write (load->new_index, index_file, &error))
+            {
+              if (load->factory->priv->gimp->be_verbose)
+                g_printerr ("%s\n", error->message);
+
+              g_clear_error (&error);
+            }
+
+          g_free (index_file);
+        }
+
+      g_hash_table_unref (load->index);
+      g_hash_table_unref (load->new_index);
+
+      load->index     = NULL;
+      load->new_index = NULL;
+    }
+}
+
+/*  adds the loaded data to the containers and frees the load  */
+static void
+gimp_data_factory_load_add (GimpDataFactoryLoad *load)
+{
+  GimpDataFactory  *factory = load->factory;
+  GimpDataLoadFile *file;
+
+  gimp_container_freeze (factory->priv->container);
+
+  while ((file = g_queue_pop_head (&load->files)))
+    {
+      GList *list;
+
+      for (list = file->data_list; list; list = g_list_next (list))
+        {
+          GimpData *data = list->data;
+
+          /*  unchanged data from gimp_data_factory_data_refresh()  */
+          if (file->cached)
+            {
+              gimp_container_add (factory->priv->container,
+                                  GIMP_OBJECT (data));
+              continue;
+            }
+
+          gimp_data_set_filename (data, file->filename,
+                                  file->writable, file->deletable);
+          gimp_data_set_mtime (data, file->mtime);
+
+          if (file->stubs)
+            gimp_data_set_lazy_load (data,
+                                     gimp_data_factory_load_lazy, factory);
+
+          gimp_data_clean (data);
+
+          if (file->obsolete)
+            {
+              gimp_container_add (factory->priv->container_obsolete,
+                                  GIMP_OBJECT (data));
+            }
+          else
+            {
+              gimp_data_set_folder_tags (data, file->top_directory);
+
+              gimp_container_add (factory->priv->container,
+                                  GIMP_OBJECT (data));
+            }
+
+          g_object_unref (data);
+        }
+
+      if (G_UNLIKELY (file->error))
+        {
+          gimp_message (factory->priv->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        _("Failed to load data:\n\n%s"),
+                        file->error->message);
+          g_clear_error (&file->error);
+        }
+
+      g_list_free (file->data_list);
+      g_free (file->filename);
+      g_free (file->top_directory);
+
+      g_slice_free (GimpDataLoadFile, file);
+    }
+
+  gimp_container_thaw (factory->priv->container);
+
+  gimp_path_free (load->writable_list);
+  g_free (load->path);
+
+  g_object_unref (load->context);
+  g_object_unref (load->factory);
+
+  g_slice_free (GimpDataFactoryLoad, load);
+}
+
 static gboolean
 gimp_data_factory_is_dir_writable (const gchar *dirname,
                                    GList       *writable_path)
@@ -806,7 +1041,7 @@ static void
 gimp_data_factory_load_data_recursive (const GimpDatafileData *file_data,
                                        gpointer                data)
 {
-  GimpDataLoadContext *context = data;
+  GimpDataFactoryLoad *load    = data;
   gboolean             top_set = FALSE;
 
   /*  When processing subdirectories, set the top_directory if it's
@@ -815,55 +1050,111 @@ gimp_data_factory_load_data_recursive (const GimpDatafileData *file_data,
    *  toplevel directory itself, and pass the toplevel directory when
    *  processing any folder inside.
    */
-  if (! context->top_directory)
+  if (! load->top_directory)
     {
-      context->top_directory = file_data->dirname;
+      load->top_directory = file_data->dirname;
       top_set = TRUE;
     }
 
   gimp_datafiles_read_directories (file_data->filename, G_FILE_TEST_IS_REGULAR,
-                                   gimp_data_factory_load_data, context);
+                                   gimp_data_factory_load_data, load);
 
   gimp_datafiles_read_directories (file_data->filename, G_FILE_TEST_IS_DIR,
                                    gimp_data_factory_load_data_recursive,
-                                   context);
+                                   load);
 
   /*  Unset, the string is only valid within this function, and will
    *  be set again for the next subdirectory.
    */
   if (top_set)
-    context->top_directory = NULL;
+    load->top_directory = NULL;
+}
+
+static GList *
+gimp_data_factory_load_stubs (GimpDataFactoryLoad              *load,
+                              const GimpDataFactoryLoaderEntry *loader,
+                              const GimpDatafileData           *file_data,
+                              gboolean                         *stubs,
+                              GError                          **error)
+{
+  GimpDataFactory    *factory   = load->factory;
+  GimpDataIndexEntry *entry;
+  GList              *data_list = NULL;
+
+  entry = g_hash_table_lookup (load->index, file_data->filename);
+
+  if (entry && entry->mtime == file_data->mtime)
+    {
+      GType  data_type;
+      GList *list;
+
+      data_type = gimp_container_get_children_type (factory->priv->container);
+
+      for (list = entry->items; list; list = g_list_next (list))
+        {
+          GimpDataIndexItem *item = list->data;
+          GType              type = g_type_from_name (item->type_name);
+
+          if (! g_type_is_a (type, data_type))
+            {
+              g_list_free_full (data_list, (GDestroyNotify) g_object_unref);
+              data_list = NULL;
+              break;
+            }
+
+          data_list = g_list_prepend (data_list,
+                                      g_object_new (type,
+                                                    "name",      item->name,
+                                                    "mime-type", item->mime_type,
+                                                    NULL));
+        }
+
+      data_list = g_list_reverse (data_list);
+    }
+
+  if (! data_list)
+    {
+      load->index_dirty = TRUE;
+
+      if (loader->load_header_func)
+        data_list = loader->load_header_func (load->context,
+                                              file_data->filename, error);
+    }
+
+  if (data_list)
+    {
+      *stubs = TRUE;
+
+      return data_list;
+    }
+
+  *stubs = FALSE;
+
+  if (*error)
+    return NULL;
+
+  /*  no header loader, decode the file once so it gets indexed  */
+  return loader->load_func (load->context, file_data->filename, error);
 }
 
 static void
 gimp_data_factory_load_data (const GimpDatafileData *file_data,
                              gpointer                data)
 {
-  GimpDataLoadContext              *context = data;
-  GimpDataFactory                  *factory = context->factory;
-  GHashTable                       *cache   = context->cache;
-  const GimpDataFactoryLoaderEntry *loader  = NULL;
+  GimpDataFactoryLoad              *load    = data;
+  GimpDataFactory                  *factory = load->factory;
+  GHashTable                       *cache   = load->cache;
+  const GimpDataFactoryLoaderEntry *loader;
+  GimpDataLoadFile                 *file;
   GError                           *error   = NULL;
   GList                            *data_list;
-  gint                              i;
-
-  for (i = 0; i < factory->priv->n_loader_entries; i++)
-    {
-      loader = &factory->priv->loader_entries[i];
+  gboolean                          stubs   = FALSE;
 
-      /* a loder matches if its extension matches, or if it doesn't
-       * have an extension, which is the case for the fallback loader,
-       * which must be last in the loader array
-       */
-      if (! loader->extension ||
-          gimp_datafiles_check_extension (file_data->filename,
-                                          loader->extension))
-        goto insert;
-    }
+  loader = gimp_data_factory_get_loader (factory, file_data->filename);
 
-  return;
+  if (! loader)
+    return;
 
- insert:
   if (cache)
     {
       GList *cached_data;
@@ -874,75 +1165,230 @@ gimp_data_factory_load_data (const GimpDatafileData *file_data,
           gimp_data_get_mtime (cached_data->data) != 0 &&
           gimp_data_get_mtime (cached_data->data) == file_data->mtime)
         {
-          GList *list;
+          if (load->new_index && loader->lazy)
+            gimp_data_factory_index_add (load, file_data->filename,
+                                         file_data->mtime, cached_data);
+
+          /*  the cache keeps its references  */
+          file = g_slice_new0 (GimpDataLoadFile);
+
+          file->data_list = g_list_copy (cached_data);
+          file->cached    = TRUE;
 
-          for (list = cached_data; list; list = g_list_next (list))
-            gimp_container_add (factory->priv->container, list->data);
+          g_queue_push_tail (&load->files, file);
 
           return;
         }
     }
 
-  data_list = loader->load_func (context->context, file_data->filename, &error);
+  if (load->index && loader->lazy)
+    data_list = gimp_data_factory_load_stubs (load, loader, file_data,
+                                              &stubs, &error);
+  else
+    data_list = loader->load_func (load->context, file_data->filename,
+                                   &error);
+
+  if (! data_list && ! error)
+    return;
+
+  file = g_slice_new0 (GimpDataLoadFile);
+
+  file->filename      = g_strdup (file_data->filename);
+  file->mtime         = file_data->mtime;
+  file->top_directory = g_strdup (load->top_directory);
+  file->loader        = loader;
+  file->data_list     = data_list;
+  file->error         = error;
+  file->stubs         = stubs;
 
   if (G_LIKELY (data_list))
     {
-      GList    *list;
-      gboolean  obsolete;
-      gboolean  writable  = FALSE;
-      gboolean  deletable = FALSE;
-
-      obsolete = (strstr (file_data->dirname,
-                          GIMP_OBSOLETE_DATA_DIR_NAME) != 0);
+      file->obsolete = (strstr (file_data->dirname,
+                                GIMP_OBSOLETE_DATA_DIR_NAME) != 0);
 
       /* obsolete files are immutable, don't check their writability */
-      if (! obsolete)
+      if (! file->obsolete)
         {
-          GList *writable_list;
+          file->deletable =
+            (g_list_length (data_list) == 1 &&
+             gimp_data_factory_is_dir_writable (file_data->dirname,
+                                                load->writable_list));
+
+          file->writable = (file->deletable && loader->writable);
+        }
 
-          writable_list = g_object_get_data (G_OBJECT (factory),
-                                             WRITABLE_PATH_KEY);
+      if (loader->lazy)
+        {
+          GList *list;
+          gint   position = 0;
 
-          deletable = (g_list_length (data_list) == 1 &&
-                       gimp_data_factory_is_dir_writable (file_data->dirname,
-                                                          writable_list));
+          for (list = data_list; list; list = g_list_next (list))
+            g_object_set_data (list->data, LAZY_POSITION_KEY,
+                               GINT_TO_POINTER (position++));
 
-          writable = (deletable && loader->writable);
+          if (load->new_index)
+            gimp_data_factory_index_add (load, file_data->filename,
+                                         file_data->mtime, data_list);
         }
+    }
 
-      for (list = data_list; list; list = g_list_next (list))
-        {
-          GimpData *data = list->data;
+  g_queue_push_tail (&load->files, file);
+}
 
-          gimp_data_set_filename (data, file_data->filename,
-                                  writable, deletable);
-          gimp_data_set_mtime (data, file_data->mtime);
+static void
+gimp_data_factory_index_add (GimpDataFactoryLoad *load,
+                             const gchar         *filename,
+                             gint64               mtime,
+                             GList               *data_list)
+{
+  GimpDataIndexEntry *entry;
+  GList              *list;
 
-          gimp_data_clean (data);
+  entry = gimp_data_index_entry_new (filename, mtime);
 
-          if (obsolete)
-            {
-              gimp_container_add (factory->priv->container_obsolete,
-                                  GIMP_OBJECT (data));
-            }
-          else
-            {
-              gimp_data_set_folder_tags (data, context->top_directory);
+  /*  cached data lists are not in file order  */
+  data_list = g_list_sort (g_list_copy (data_list),
+                           (GCompareFunc) gimp_data_factory_position_compare);
 
-              gimp_container_add (factory->priv->container,
-                                  GIMP_OBJECT (data));
-            }
+  for (list = data_list; list; list = g_list_next (list))
+    {
+      GimpData *data = list->data;
 
-          g_object_unref (data);
-        }
+      gimp_data_index_entry_add (entry,
+                                 G_OBJECT_TYPE_NAME (data),
+                                 gimp_data_get_mime_type (data),
+                                 gimp_object_get_name (data));
+    }
+
+  g_list_free (data_list);
+
+  g_hash_table_replace (load->new_index, entry->filename, entry);
+}
+
+static gint
+gimp_data_factory_position_compare (GimpData *data1,
+                                    GimpData *data2)
+{
+  gint position1 = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (data1),
+                                                       LAZY_POSITION_KEY));
+  gint position2 = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (data2),
+                                                       LAZY_POSITION_KEY));
+
+  return position1 - position2;
+}
+
+static const GimpDataFactoryLoaderEntry *
+gimp_data_factory_get_loader (GimpDataFactory *factory,
+                              const gchar     *filename)
+{
+  gint i;
+
+  for (i = 0; i < factory->priv->n_loader_entries; i++)
+    {
+      const GimpDataFactoryLoaderEntry *loader;
+
+      loader = &factory->priv->loader_entries[i];
+
+      /* a loder matches if its extension matches, or if it doesn't
+       * have an extension, which is the case for the fallback loader,
+       * which must be last in the loader array
+       */
+      if (! loader->extension ||
+          gimp_datafiles_check_extension (filename, loader->extension))
+        return loader;
+    }
+
+  return NULL;
+}
+
+static gboolean
+gimp_data_factory_has_lazy_loaders (GimpDataFactory *factory)
+{
+  gint i;
+
+  for (i = 0; i < factory->priv->n_loader_entries; i++)
+    {
+      if (factory->priv->loader_entries[i].lazy)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static gchar *
+gimp_data_factory_get_index_file (GimpDataFactory *factory)
+{
+  const gchar *property_name = factory->priv->path_property_name;
+  gchar       *basename;
+  gchar       *filename;
+
+  /*  "brush-path" -> "brushindex"  */
+  if (g_str_has_suffix (property_name, "-path"))
+    basename = g_strdup_printf ("%.*sindex",
+                                (gint) (strlen (property_name) -
+                                        strlen ("-path")),
+                                property_name);
+  else
+    basename = g_strconcat (property_name, "index", NULL);
+
+  filename = gimp_personal_rc_file (basename);
+  g_free (basename);
+
+  return filename;
+}
+
+static GimpData *
+gimp_data_factory_load_lazy (GimpData *data,
+                             gpointer  user_data)
+{
+  GimpDataFactory                  *factory  = GIMP_DATA_FACTORY (user_data);
+  const gchar                      *filename = gimp_data_get_filename (data);
+  const GimpDataFactoryLoaderEntry *loader;
+  GimpContext                      *context;
+  GimpData                         *src_data = NULL;
+  GError                           *error    = NULL;
+
+  context = gimp_get_user_context (factory->priv->gimp);
+  loader  = gimp_data_factory_get_loader (factory, filename);
+
+  if (loader)
+    {
+      GList *data_list;
+      gint   position;
+
+      position = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (data),
+                                                     LAZY_POSITION_KEY));
+
+      data_list = loader->load_func (context, filename, &error);
+
+      src_data = g_list_nth_data (data_list, position);
+
+      if (src_data &&
+          G_TYPE_FROM_INSTANCE (src_data) == G_TYPE_FROM_INSTANCE (data))
+        g_object_ref (src_data);
+      else
+        src_data = NULL;
 
-      g_list_free (data_list);
+      g_list_free_full (data_list, (GDestroyNotify) g_object_unref);
     }
 
-  if (G_UNLIKELY (error))
+  if (! src_data)
     {
+      if (! error)
+        g_set_error (&error, GIMP_DATA_ERROR, GIMP_DATA_ERROR_READ,
+                     _("Could not find '%s' in '%s'. "
+                       "The file has changed since GIMP was started."),
+                     gimp_object_get_name (data),
+                     gimp_filename_to_utf8 (filename));
+
       gimp_message (factory->priv->gimp, NULL, GIMP_MESSAGE_ERROR,
                     _("Failed to load data:\n\n%s"), error->message);
       g_clear_error (&error);
+
+      /*  fall back to the standard data, so the object stays usable  */
+      if (factory->priv->data_get_standard_func)
+        src_data = g_object_ref (factory->priv->data_get_standard_func (context));
     }
+
+  return src_data;
 }
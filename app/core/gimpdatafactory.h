@@ -34,12 +34,19 @@ typedef GimpData * (* GimpDataGetStandardFunc) (GimpContext  *context);
 
 
 typedef struct _GimpDataFactoryLoaderEntry GimpDataFactoryLoaderEntry;
+typedef struct _GimpDataFactoryLoad        GimpDataFactoryLoad;
 
 struct _GimpDataFactoryLoaderEntry
 {
   GimpDataLoadFunc  load_func;
   const gchar      *extension;
   gboolean          writable;
+
+  /*  if lazy is set, the data's contents are only loaded on first use,
+   *  using load_header_func (if any) or the data index at startup
+   */
+  gboolean          lazy;
+  GimpDataLoadFunc  load_header_func;
 };
 
 
@@ -81,6 +88,12 @@ GimpDataFactory * gimp_data_factory_new      (Gimp                             *
 void            gimp_data_factory_data_init         (GimpDataFactory  *factory,
                                                      GimpContext      *context,
                                                      gboolean          no_data);
+GimpDataFactoryLoad *
+                gimp_data_factory_data_init_begin   (GimpDataFactory  *factory,
+                                                     GimpContext      *context,
+                                                     gboolean          no_data);
+void            gimp_data_factory_data_init_load    (GimpDataFactoryLoad *load);
+void            gimp_data_factory_data_init_finish  (GimpDataFactoryLoad *load);
 void            gimp_data_factory_data_refresh      (GimpDataFactory  *factory,
                                                      GimpContext      *context);
 void            gimp_data_factory_data_save         (GimpDataFactory  *factory);
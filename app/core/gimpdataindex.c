@@ -0,0 +1,422 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpdataindex.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <glib-object.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpconfig/gimpconfig.h"
+
+#include "core-types.h"
+
+#include "gimpdataindex.h"
+
+#include "gimp-intl.h"
+
+
+#define DATA_INDEX_FILE_VERSION 1
+
+
+enum
+{
+  FILE_VERSION = 1,
+  DATA_FILE,
+  DATA
+};
+
+
+static GTokenType gimp_data_index_entry_deserialize (GScanner                 *scanner,
+                                                     GHashTable               *index);
+static GTokenType gimp_data_index_item_deserialize  (GScanner                 *scanner,
+                                                     GimpDataIndexEntry       *entry);
+static gint       gimp_data_index_entry_compare     (const GimpDataIndexEntry *a,
+                                                     const GimpDataIndexEntry *b);
+
+
+/*  public functions  */
+
+GimpDataIndexEntry *
+gimp_data_index_entry_new (const gchar *filename,
+                           gint64       mtime)
+{
+  GimpDataIndexEntry *entry;
+
+  g_return_val_if_fail (filename != NULL, NULL);
+
+  entry = g_slice_new0 (GimpDataIndexEntry);
+
+  entry->filename = g_strdup (filename);
+  entry->mtime    = mtime;
+
+  return entry;
+}
+
+void
+gimp_data_index_entry_add (GimpDataIndexEntry *entry,
+                           const gchar        *type_name,
+                           const gchar        *mime_type,
+                           const gchar        *name)
+{
+  GimpDataIndexItem *item;
+
+  g_return_if_fail (entry != NULL);
+  g_return_if_fail (type_name != NULL);
+  g_return_if_fail (name != NULL);
+
+  item = g_slice_new0 (GimpDataIndexItem);
+
+  item->type_name = g_strdup (type_name);
+  item->mime_type = g_strdup (mime_type);
+  item->name      = g_strdup (name);
+
+  entry->items = g_list_append (entry->items, item);
+}
+
+void
+gimp_data_index_entry_free (GimpDataIndexEntry *entry)
+{
+  GList *list;
+
+  g_return_if_fail (entry != NULL);
+
+  for (list = entry->items; list; list = g_list_next (list))
+    {
+      GimpDataIndexItem *item = list->data;
+
+      g_free (item->type_name);
+      g_free (item->mime_type);
+      g_free (item->name);
+
+      g_slice_free (GimpDataIndexItem, item);
+    }
+
+  g_list_free (entry->items);
+  g_free (entry->filename);
+
+  g_slice_free (GimpDataIndexEntry, entry);
+}
+
+/**
+ * gimp_data_index_new:
+ *
+ * Returns: a new, empty #GHashTable that maps file names to the
+ *          #GimpDataIndexEntry of the file.  The hash table owns the
+ *          entries.
+ **/
+GHashTable *
+gimp_data_index_new (void)
+{
+  return g_hash_table_new_full (g_str_hash, g_str_equal,
+                                NULL,
+                                (GDestroyNotify) gimp_data_index_entry_free);
+}
+
+GHashTable *
+gimp_data_index_read (const gchar  *filename,
+                      GError      **error)
+{
+  GScanner   *scanner;
+  GHashTable *index;
+  gint        file_version = DATA_INDEX_FILE_VERSION;
+  GTokenType  token;
+
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  scanner = gimp_scanner_new_file (filename, error);
+
+  if (! scanner)
+    return NULL;
+
+  index = gimp_data_index_new ();
+
+  g_scanner_scope_add_symbol (scanner, 0,
+                              "file-version", GINT_TO_POINTER (FILE_VERSION));
+  g_scanner_scope_add_symbol (scanner, 0,
+                              "data-file", GINT_TO_POINTER (DATA_FILE));
+
+  g_scanner_scope_add_symbol (scanner, DATA_FILE,
+                              "data", GINT_TO_POINTER (DATA));
+
+  token = G_TOKEN_LEFT_PAREN;
+
+  while (file_version == DATA_INDEX_FILE_VERSION &&
+         g_scanner_peek_next_token (scanner) == token)
+    {
+      token = g_scanner_get_next_token (scanner);
+
+      switch (token)
+        {
+        case G_TOKEN_LEFT_PAREN:
+          token = G_TOKEN_SYMBOL;
+          break;
+
+        case G_TOKEN_SYMBOL:
+          switch (GPOINTER_TO_INT (scanner->value.v_symbol))
+            {
+            case FILE_VERSION:
+              token = G_TOKEN_INT;
+              if (gimp_scanner_parse_int (scanner, &file_version))
+                token = G_TOKEN_RIGHT_PAREN;
+              break;
+
+            case DATA_FILE:
+              g_scanner_set_scope (scanner, DATA_FILE);
+              token = gimp_data_index_entry_deserialize (scanner, index);
+              g_scanner_set_scope (scanner, 0);
+              break;
+
+            default:
+              break;
+            }
+          break;
+
+        case G_TOKEN_RIGHT_PAREN:
+          token = G_TOKEN_LEFT_PAREN;
+          break;
+
+        default: /* do nothing */
+          break;
+        }
+    }
+
+  if (file_version != DATA_INDEX_FILE_VERSION ||
+      token        != G_TOKEN_LEFT_PAREN)
+    {
+      if (file_version != DATA_INDEX_FILE_VERSION)
+        {
+          g_set_error (error,
+                       GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_VERSION,
+                       _("Skipping '%s': wrong data index file format version."),
+                       gimp_filename_to_utf8 (filename));
+        }
+      else
+        {
+          g_scanner_get_next_token (scanner);
+          g_scanner_unexp_token (scanner, token, NULL, NULL, NULL,
+                                 _("fatal parse error"), TRUE);
+        }
+
+      g_hash_table_unref (index);
+      index = NULL;
+    }
+
+  gimp_scanner_destroy (scanner);
+
+  return index;
+}
+
+gboolean
+gimp_data_index_write (GHashTable   *index,
+                       const gchar  *filename,
+                       GError      **error)
+{
+  GimpConfigWriter *writer;
+  GList            *entries;
+  GList            *list;
+
+  g_return_val_if_fail (index != NULL, FALSE);
+  g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  writer = gimp_config_writer_new_file (filename,
+                                        FALSE,
+                                        "GIMP data index\n\n"
+                                        "This file can safely be removed and "
+                                        "will be automatically regenerated by "
+                                        "loading the data files.",
+                                        error);
+  if (! writer)
+    return FALSE;
+
+  gimp_config_writer_open (writer, "file-version");
+  gimp_config_writer_printf (writer, "%d", DATA_INDEX_FILE_VERSION);
+  gimp_config_writer_close (writer);
+
+  gimp_config_writer_linefeed (writer);
+
+  /*  sort the entries so the file doesn't change needlessly  */
+  entries = g_list_sort (g_hash_table_get_values (index),
+                         (GCompareFunc) gimp_data_index_entry_compare);
+
+  for (list = entries; list; list = g_list_next (list))
+    {
+      GimpDataIndexEntry *entry = list->data;
+      GList              *items;
+      gchar              *utf8;
+
+      utf8 = g_filename_to_utf8 (entry->filename, -1, NULL, NULL, NULL);
+
+      if (! utf8)
+        continue;
+
+      gimp_config_writer_open (writer, "data-file");
+      gimp_config_writer_string (writer, utf8);
+      gimp_config_writer_printf (writer, "%"G_GINT64_FORMAT, entry->mtime);
+
+      g_free (utf8);
+
+      for (items = entry->items; items; items = g_list_next (items))
+        {
+          GimpDataIndexItem *item = items->data;
+
+          gimp_config_writer_open (writer, "data");
+          gimp_config_writer_string (writer, item->type_name);
+          gimp_config_writer_string (writer,
+                                     item->mime_type ? item->mime_type : "");
+          gimp_config_writer_string (writer, item->name);
+          gimp_config_writer_close (writer);
+        }
+
+      gimp_config_writer_close (writer);
+    }
+
+  g_list_free (entries);
+
+  return gimp_config_writer_finish (writer, "end of data index", error);
+}
+
+
+/*  private functions  */
+
+static GTokenType
+gimp_data_index_entry_deserialize (GScanner   *scanner,
+                                   GHashTable *index)
+{
+  GimpDataIndexEntry *entry;
+  gchar              *utf8;
+  gchar              *filename;
+  gint64              mtime;
+  GTokenType          token;
+
+  if (! gimp_scanner_parse_string (scanner, &utf8))
+    return G_TOKEN_STRING;
+
+  filename = g_filename_from_utf8 (utf8, -1, NULL, NULL, NULL);
+  g_free (utf8);
+
+  if (! filename)
+    return G_TOKEN_STRING;
+
+  if (! gimp_scanner_parse_int64 (scanner, &mtime))
+    {
+      g_free (filename);
+      return G_TOKEN_INT;
+    }
+
+  entry = gimp_data_index_entry_new (filename, mtime);
+  g_free (filename);
+
+  token = G_TOKEN_LEFT_PAREN;
+
+  while (g_scanner_peek_next_token (scanner) == token)
+    {
+      token = g_scanner_get_next_token (scanner);
+
+      switch (token)
+        {
+        case G_TOKEN_LEFT_PAREN:
+          token = G_TOKEN_SYMBOL;
+          break;
+
+        case G_TOKEN_SYMBOL:
+          switch (GPOINTER_TO_INT (scanner->value.v_symbol))
+            {
+            case DATA:
+              token = gimp_data_index_item_deserialize (scanner, entry);
+              break;
+
+            default:
+              break;
+            }
+          break;
+
+        case G_TOKEN_RIGHT_PAREN:
+          token = G_TOKEN_LEFT_PAREN;
+          break;
+
+        default:
+          break;
+        }
+    }
+
+  if (token == G_TOKEN_LEFT_PAREN)
+    {
+      token = G_TOKEN_RIGHT_PAREN;
+
+      if (gimp_scanner_parse_token (scanner, token))
+        {
+          g_hash_table_replace (index, entry->filename, entry);
+
+          return G_TOKEN_LEFT_PAREN;
+        }
+    }
+
+  gimp_data_index_entry_free (entry);
+
+  return token;
+}
+
+static GTokenType
+gimp_data_index_item_deserialize (GScanner           *scanner,
+                                  GimpDataIndexEntry *entry)
+{
+  gchar *type_name;
+  gchar *mime_type;
+  gchar *name;
+
+  if (! gimp_scanner_parse_string (scanner, &type_name))
+    return G_TOKEN_STRING;
+
+  if (! gimp_scanner_parse_string (scanner, &mime_type))
+    {
+      g_free (type_name);
+      return G_TOKEN_STRING;
+    }
+
+  if (! gimp_scanner_parse_string (scanner, &name))
+    {
+      g_free (type_name);
+      g_free (mime_type);
+      return G_TOKEN_STRING;
+    }
+
+  gimp_data_index_entry_add (entry, type_name,
+                             strlen (mime_type) ? mime_type : NULL,
+                             name);
+
+  g_free (type_name);
+  g_free (mime_type);
+  g_free (name);
+
+  if (! gimp_scanner_parse_token (scanner, G_TOKEN_RIGHT_PAREN))
+    return G_TOKEN_RIGHT_PAREN;
+
+  return G_TOKEN_LEFT_PAREN;
+}
+
+static gint
+gimp_data_index_entry_compare (const GimpDataIndexEntry *a,
+                               const GimpDataIndexEntry *b)
+{
+  return strcmp (a->filename, b->filename);
+}
@@ -0,0 +1,63 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpdataindex.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_DATA_INDEX_H__
+#define __GIMP_DATA_INDEX_H__
+
+
+/*  The data index remembers which data objects a data file contained
+ *  when it was last loaded, so GimpDataFactory can create lazily
+ *  loaded data objects without opening unchanged files.
+ */
+
+typedef struct _GimpDataIndexItem  GimpDataIndexItem;
+typedef struct _GimpDataIndexEntry GimpDataIndexEntry;
+
+struct _GimpDataIndexItem
+{
+  gchar *type_name;
+  gchar *mime_type;
+  gchar *name;
+};
+
+struct _GimpDataIndexEntry
+{
+  gchar  *filename;
+  gint64  mtime;
+  GList  *items;     /*  GimpDataIndexItems, in file order  */
+};
+
+
+GimpDataIndexEntry * gimp_data_index_entry_new  (const gchar         *filename,
+                                                 gint64               mtime);
+void                 gimp_data_index_entry_add  (GimpDataIndexEntry  *entry,
+                                                 const gchar         *type_name,
+                                                 const gchar         *mime_type,
+                                                 const gchar         *name);
+void                 gimp_data_index_entry_free (GimpDataIndexEntry  *entry);
+
+GHashTable         * gimp_data_index_new        (void);
+GHashTable         * gimp_data_index_read       (const gchar         *filename,
+                                                 GError             **error);
+gboolean             gimp_data_index_write      (GHashTable          *index,
+                                                 const gchar         *filename,
+                                                 GError             **error);
+
+
+#endif /* __GIMP_DATA_INDEX_H__ */
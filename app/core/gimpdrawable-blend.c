@@ -30,10 +30,10 @@
 
 #include "core-types.h"
 
-#include "gegl/gimp-gegl-apply-operation.h"
-#include "gegl/gimp-gegl-utils.h"
+#include "gegl/gimp-gegl-loops.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimp-utils.h"
 #include "gimpchannel.h"
 #include "gimpcontext.h"
@@ -45,7 +45,11 @@
 #include "gimp-intl.h"
 
 
-//#define USE_GRADIENT_CACHE 1
+#define GRADIENT_CACHE_MIN_SIZE 256
+#define GRADIENT_CACHE_MAX_SIZE 65536
+
+#define MIN_PARALLEL_SUB_AREA   (64 * 64)
+#define PROGRESS_STRIP_HEIGHT   256
 
 
 typedef struct
@@ -53,10 +57,8 @@ typedef struct
   GimpGradient     *gradient;
   GimpContext      *context;
   gboolean          reverse;
-#ifdef USE_GRADIENT_CACHE
   GimpRGB          *gradient_cache;
   gint              gradient_cache_size;
-#endif
   gdouble           offset;
   gdouble           sx, sy;
   GimpBlendMode     blend_mode;
@@ -65,7 +67,6 @@ typedef struct
   gdouble           dist;
   gdouble           vec[2];
   GimpRepeatMode    repeat;
-  GRand            *seed;
   GeglBuffer       *dist_buffer;
 } RenderBlendData;
 
@@ -77,6 +78,14 @@ typedef struct
   GRand         *dither_rand;
 } PutPixelData;
 
+typedef struct
+{
+  RenderBlendData *rbd;
+  GeglBuffer      *buffer;
+  gboolean         dither;
+  guint32          seed;
+} FillRegionData;
+
 
 /*  local function prototypes  */
 
@@ -131,15 +140,38 @@ static GeglBuffer * gradient_precalc_shapeburst (GimpImage           *image,
                                                  gdouble              dist,
                                                  GimpProgress        *progress);
 
+static gdouble  gradient_calc_factor        (RenderBlendData     *rbd,
+                                             gdouble              x,
+                                             gdouble              y);
+static void     gradient_calc_row_factors   (RenderBlendData     *rbd,
+                                             gint                 x,
+                                             gint                 y,
+                                             gint                 width,
+                                             gdouble             *factors);
+static gdouble  gradient_repeat_factor      (GimpRepeatMode       repeat,
+                                             gdouble              factor);
+static void     gradient_get_color          (RenderBlendData     *rbd,
+                                             gdouble              factor,
+                                             GimpRGB             *color);
+
 static void     gradient_render_pixel       (gdouble              x,
                                              gdouble              y,
                                              GimpRGB             *color,
                                              gpointer             render_data);
+static void     gradient_render_row         (RenderBlendData     *rbd,
+                                             gint                 x,
+                                             gint                 y,
+                                             gint                 width,
+                                             gdouble             *factors,
+                                             gfloat              *dest,
+                                             GRand               *dither_rand);
 static void     gradient_put_pixel          (gint                 x,
                                              gint                 y,
                                              GimpRGB             *color,
                                              gpointer             put_pixel_data);
 
+static void     gradient_fill_region_area   (const GeglRectangle *area,
+                                             FillRegionData      *data);
 static void     gradient_fill_region        (GimpImage           *image,
                                              GimpDrawable        *drawable,
                                              GimpContext         *context,
@@ -539,8 +571,6 @@ gradient_precalc_shapeburst (GimpImage           *image,
   GimpChannel *mask;
   GeglBuffer  *dist_buffer;
   GeglBuffer  *temp_buffer;
-  GeglNode    *shapeburst;
-  gdouble      max;
   gfloat       max_iteration;
 
   gimp_progress_set_text (progress, _("Calculating distance map"));
@@ -550,10 +580,7 @@ gradient_precalc_shapeburst (GimpImage           *image,
                                                  region->width, region->height),
                                  babl_format ("Y float"));
 
-  /*  allocate the selection mask copy
-   *  XXX: its format should be the same of gimp:shapeburst input buffer
-   *       porting the op to 'float' should be reflected here as well
-   */
+  /*  allocate the selection mask copy  */
   temp_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
                                                  region->width, region->height),
                                  babl_format ("Y u8"));
@@ -603,21 +630,7 @@ gradient_precalc_shapeburst (GimpImage           *image,
         }
     }
 
-  shapeburst = gegl_node_new_child (NULL,
-                                    "operation", "gimp:shapeburst",
-                                    NULL);
-
-  gimp_gegl_progress_connect (shapeburst, progress, NULL);
-
-  gimp_gegl_apply_operation (temp_buffer, NULL, NULL,
-                             shapeburst,
-                             dist_buffer, NULL);
-
-  gegl_node_get (shapeburst, "max-iterations", &max, NULL);
-
-  g_object_unref (shapeburst);
-
-  max_iteration = max;
+  max_iteration = gimp_gegl_distance_transform (temp_buffer, dist_buffer);
 
   g_object_unref (temp_buffer);
 
@@ -642,86 +655,187 @@ gradient_precalc_shapeburst (GimpImage           *image,
 }
 
 
-static void
-gradient_render_pixel (gdouble   x,
-                       gdouble   y,
-                       GimpRGB  *color,
-                       gpointer  render_data)
+static gdouble
+gradient_calc_factor (RenderBlendData *rbd,
+                      gdouble          x,
+                      gdouble          y)
 {
-  RenderBlendData *rbd = render_data;
-  gdouble          factor;
-
-  /* Calculate blending factor */
-
   switch (rbd->gradient_type)
     {
     case GIMP_GRADIENT_LINEAR:
-      factor = gradient_calc_linear_factor (rbd->dist,
+      return gradient_calc_linear_factor (rbd->dist,
+                                          rbd->vec, rbd->offset,
+                                          x - rbd->sx, y - rbd->sy);
+
+    case GIMP_GRADIENT_BILINEAR:
+      return gradient_calc_bilinear_factor (rbd->dist,
                                             rbd->vec, rbd->offset,
                                             x - rbd->sx, y - rbd->sy);
+
+    case GIMP_GRADIENT_RADIAL:
+      return gradient_calc_radial_factor (rbd->dist,
+                                          rbd->offset,
+                                          x - rbd->sx, y - rbd->sy);
+
+    case GIMP_GRADIENT_SQUARE:
+      return gradient_calc_square_factor (rbd->dist, rbd->offset,
+                                          x - rbd->sx, y - rbd->sy);
+
+    case GIMP_GRADIENT_CONICAL_SYMMETRIC:
+      return gradient_calc_conical_sym_factor (rbd->dist,
+                                               rbd->vec, rbd->offset,
+                                               x - rbd->sx, y - rbd->sy);
+
+    case GIMP_GRADIENT_CONICAL_ASYMMETRIC:
+      return gradient_calc_conical_asym_factor (rbd->dist,
+                                                rbd->vec, rbd->offset,
+                                                x - rbd->sx, y - rbd->sy);
+
+    case GIMP_GRADIENT_SHAPEBURST_ANGULAR:
+      return gradient_calc_shapeburst_angular_factor (rbd->dist_buffer, x, y);
+
+    case GIMP_GRADIENT_SHAPEBURST_SPHERICAL:
+      return gradient_calc_shapeburst_spherical_factor (rbd->dist_buffer, x, y);
+
+    case GIMP_GRADIENT_SHAPEBURST_DIMPLED:
+      return gradient_calc_shapeburst_dimpled_factor (rbd->dist_buffer, x, y);
+
+    case GIMP_GRADIENT_SPIRAL_CLOCKWISE:
+      return gradient_calc_spiral_factor (rbd->dist,
+                                          rbd->vec, rbd->offset,
+                                          x - rbd->sx, y - rbd->sy, TRUE);
+
+    case GIMP_GRADIENT_SPIRAL_ANTICLOCKWISE:
+      return gradient_calc_spiral_factor (rbd->dist,
+                                          rbd->vec, rbd->offset,
+                                          x - rbd->sx, y - rbd->sy, FALSE);
+
+    default:
+      g_assert_not_reached ();
+      return 0.0;
+    }
+}
+
+/*  Calculates the blending factors of a row of pixels, with the
+ *  gradient type switch out of the pixel loop.  The shapeburst
+ *  distances are read for the whole row at once.
+ */
+static void
+gradient_calc_row_factors (RenderBlendData *rbd,
+                           gint             x,
+                           gint             y,
+                           gint             width,
+                           gdouble         *factors)
+{
+  gdouble ry = y - rbd->sy;
+  gint    i;
+
+#define ROW_FACTORS(expr)                                    \
+  G_STMT_START                                               \
+    {                                                        \
+      for (i = 0; i < width; i++)                            \
+        {                                                    \
+          gdouble rx = x + i - rbd->sx;                      \
+                                                             \
+          factors[i] = (expr);                               \
+        }                                                    \
+    }                                                        \
+  G_STMT_END
+
+  switch (rbd->gradient_type)
+    {
+    case GIMP_GRADIENT_LINEAR:
+      ROW_FACTORS (gradient_calc_linear_factor (rbd->dist,
+                                                rbd->vec, rbd->offset,
+                                                rx, ry));
       break;
 
     case GIMP_GRADIENT_BILINEAR:
-      factor = gradient_calc_bilinear_factor (rbd->dist,
-                                              rbd->vec, rbd->offset,
-                                              x - rbd->sx, y - rbd->sy);
+      ROW_FACTORS (gradient_calc_bilinear_factor (rbd->dist,
+                                                  rbd->vec, rbd->offset,
+                                                  rx, ry));
       break;
 
     case GIMP_GRADIENT_RADIAL:
-      factor = gradient_calc_radial_factor (rbd->dist,
-                                            rbd->offset,
-                                            x - rbd->sx, y - rbd->sy);
+      ROW_FACTORS (gradient_calc_radial_factor (rbd->dist, rbd->offset,
+                                                rx, ry));
       break;
 
     case GIMP_GRADIENT_SQUARE:
-      factor = gradient_calc_square_factor (rbd->dist, rbd->offset,
-                                            x - rbd->sx, y - rbd->sy);
+      ROW_FACTORS (gradient_calc_square_factor (rbd->dist, rbd->offset,
+                                                rx, ry));
       break;
 
     case GIMP_GRADIENT_CONICAL_SYMMETRIC:
-      factor = gradient_calc_conical_sym_factor (rbd->dist,
-                                                 rbd->vec, rbd->offset,
-                                                 x - rbd->sx, y - rbd->sy);
+      ROW_FACTORS (gradient_calc_conical_sym_factor (rbd->dist,
+                                                     rbd->vec, rbd->offset,
+                                                     rx, ry));
       break;
 
     case GIMP_GRADIENT_CONICAL_ASYMMETRIC:
-      factor = gradient_calc_conical_asym_factor (rbd->dist,
-                                                  rbd->vec, rbd->offset,
-                                                  x - rbd->sx, y - rbd->sy);
+      ROW_FACTORS (gradient_calc_conical_asym_factor (rbd->dist,
+                                                      rbd->vec, rbd->offset,
+                                                      rx, ry));
       break;
 
-    case GIMP_GRADIENT_SHAPEBURST_ANGULAR:
-      factor = gradient_calc_shapeburst_angular_factor (rbd->dist_buffer, x, y);
+    case GIMP_GRADIENT_SPIRAL_CLOCKWISE:
+      ROW_FACTORS (gradient_calc_spiral_factor (rbd->dist,
+                                                rbd->vec, rbd->offset,
+                                                rx, ry, TRUE));
       break;
 
-    case GIMP_GRADIENT_SHAPEBURST_SPHERICAL:
-      factor = gradient_calc_shapeburst_spherical_factor (rbd->dist_buffer, x, y);
+    case GIMP_GRADIENT_SPIRAL_ANTICLOCKWISE:
+      ROW_FACTORS (gradient_calc_spiral_factor (rbd->dist,
+                                                rbd->vec, rbd->offset,
+                                                rx, ry, FALSE));
       break;
 
+    case GIMP_GRADIENT_SHAPEBURST_ANGULAR:
+    case GIMP_GRADIENT_SHAPEBURST_SPHERICAL:
     case GIMP_GRADIENT_SHAPEBURST_DIMPLED:
-      factor = gradient_calc_shapeburst_dimpled_factor (rbd->dist_buffer, x, y);
-      break;
-
-    case GIMP_GRADIENT_SPIRAL_CLOCKWISE:
-      factor = gradient_calc_spiral_factor (rbd->dist,
-                                            rbd->vec, rbd->offset,
-                                            x - rbd->sx, y - rbd->sy, TRUE);
-      break;
-
-    case GIMP_GRADIENT_SPIRAL_ANTICLOCKWISE:
-      factor = gradient_calc_spiral_factor (rbd->dist,
-                                            rbd->vec, rbd->offset,
-                                            x - rbd->sx, y - rbd->sy, FALSE);
+      {
+        gfloat *values = g_new (gfloat, width);
+
+        gegl_buffer_get (rbd->dist_buffer,
+                         GEGL_RECTANGLE (x, y, width, 1), 1.0,
+                         babl_format ("Y float"), values,
+                         GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
+
+        for (i = 0; i < width; i++)
+          {
+            switch (rbd->gradient_type)
+              {
+              case GIMP_GRADIENT_SHAPEBURST_ANGULAR:
+                factors[i] = 1.0 - values[i];
+                break;
+
+              case GIMP_GRADIENT_SHAPEBURST_SPHERICAL:
+                factors[i] = 1.0 - sin (0.5 * G_PI * values[i]);
+                break;
+
+              default:
+                factors[i] = cos (0.5 * G_PI * values[i]);
+                break;
+              }
+          }
+
+        g_free (values);
+      }
       break;
 
     default:
       g_assert_not_reached ();
-      return;
+      break;
     }
 
-  /* Adjust for repeat */
+#undef ROW_FACTORS
+}
 
-  switch (rbd->repeat)
+static gdouble
+gradient_repeat_factor (GimpRepeatMode repeat,
+                        gdouble        factor)
+{
+  switch (repeat)
     {
     case GIMP_REPEAT_NONE:
       factor = CLAMP (factor, 0.0, 1.0);
@@ -747,16 +861,18 @@ gradient_render_pixel (gdouble   x,
       break;
     }
 
-  /* Blend the colors */
+  return factor;
+}
 
+static void
+gradient_get_color (RenderBlendData *rbd,
+                    gdouble          factor,
+                    GimpRGB         *color)
+{
   if (rbd->blend_mode == GIMP_CUSTOM_MODE)
     {
-#ifdef USE_GRADIENT_CACHE
-      *color = rbd->gradient_cache[(gint) (factor * (rbd->gradient_cache_size - 1))];
-#else
-      gimp_gradient_get_color_at (rbd->gradient, rbd->context, NULL,
-                                  factor, rbd->reverse, color);
-#endif
+      *color = rbd->gradient_cache[RINT (factor *
+                                         (rbd->gradient_cache_size - 1))];
     }
   else
     {
@@ -779,6 +895,61 @@ gradient_render_pixel (gdouble   x,
     }
 }
 
+static void
+gradient_render_pixel (gdouble   x,
+                       gdouble   y,
+                       GimpRGB  *color,
+                       gpointer  render_data)
+{
+  RenderBlendData *rbd = render_data;
+  gdouble          factor;
+
+  factor = gradient_calc_factor (rbd, x, y);
+  factor = gradient_repeat_factor (rbd->repeat, factor);
+
+  gradient_get_color (rbd, factor, color);
+}
+
+static void
+gradient_render_row (RenderBlendData *rbd,
+                     gint             x,
+                     gint             y,
+                     gint             width,
+                     gdouble         *factors,
+                     gfloat          *dest,
+                     GRand           *dither_rand)
+{
+  gint i;
+
+  gradient_calc_row_factors (rbd, x, y, width, factors);
+
+  for (i = 0; i < width; i++)
+    {
+      GimpRGB color = { 0.0, 0.0, 0.0, 1.0 };
+
+      gradient_get_color (rbd,
+                          gradient_repeat_factor (rbd->repeat, factors[i]),
+                          &color);
+
+      if (dither_rand)
+        {
+          gint r = g_rand_int (dither_rand);
+
+          *dest++ = color.r + (gdouble) (r & 0xff) / 256.0 / 256.0; r >>= 8;
+          *dest++ = color.g + (gdouble) (r & 0xff) / 256.0 / 256.0; r >>= 8;
+          *dest++ = color.b + (gdouble) (r & 0xff) / 256.0 / 256.0; r >>= 8;
+          *dest++ = color.a + (gdouble) (r & 0xff) / 256.0 / 256.0;
+        }
+      else
+        {
+          *dest++ = color.r;
+          *dest++ = color.g;
+          *dest++ = color.b;
+          *dest++ = color.a;
+        }
+    }
+}
+
 static void
 gradient_put_pixel (gint      x,
                     gint      y,
@@ -813,6 +984,49 @@ gradient_put_pixel (gint      x,
                      GEGL_AUTO_ROWSTRIDE);
 }
 
+static void
+gradient_fill_region_area (const GeglRectangle *area,
+                           FillRegionData      *data)
+{
+  GeglBufferIterator *iter;
+  GeglRectangle      *roi;
+  GRand              *dither_rand = NULL;
+  gdouble            *factors;
+
+  iter = gegl_buffer_iterator_new (data->buffer, area, 0,
+                                   babl_format ("R'G'B'A float"),
+                                   GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
+  roi = &iter->roi[0];
+
+  /*  a seed of its own for each area, so the dither noise doesn't
+   *  depend on which thread renders it
+   */
+  if (data->dither)
+    dither_rand = g_rand_new_with_seed (data->seed ^
+                                        (area->y * 65599 + area->x));
+
+  factors = g_new (gdouble, area->width);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gfloat *dest = iter->data[0];
+      gint    y;
+
+      for (y = roi->y; y < roi->y + roi->height; y++)
+        {
+          gradient_render_row (data->rbd, roi->x, y, roi->width,
+                               factors, dest, dither_rand);
+
+          dest += 4 * roi->width;
+        }
+    }
+
+  g_free (factors);
+
+  if (dither_rand)
+    g_rand_free (dither_rand);
+}
+
 static void
 gradient_fill_region (GimpImage           *image,
                       GimpDrawable        *drawable,
@@ -842,23 +1056,6 @@ gradient_fill_region (GimpImage           *image,
   rbd.context  = context;
   rbd.reverse  = reverse;
 
-#ifdef USE_GRADIENT_CACHE
-  {
-    gint i;
-
-    rbd.gradient_cache_size = ceil (sqrt (SQR (sx - ex) + SQR (sy - ey)));
-    rbd.gradient_cache      = g_new0 (GimpRGB, rbd.gradient_cache_size);
-
-    for (i = 0; i < rbd.gradient_cache_size; i++)
-      {
-        gdouble factor = (gdouble) i / (gdouble) (rbd.gradient_cache_size - 1);
-
-        gimp_gradient_get_color_at (rbd.gradient, rbd.context, NULL,
-                                    factor, rbd.reverse,
-                                    rbd.gradient_cache + i);
-      }
-  }
-#endif
 
   if (gimp_gradient_has_fg_bg_segments (rbd.gradient))
     rbd.gradient = gimp_gradient_flatten (rbd.gradient, context);
@@ -954,6 +1151,31 @@ gradient_fill_region (GimpImage           *image,
   rbd.gradient_type = gradient_type;
   rbd.repeat        = repeat;
 
+  /* Cache the gradient's colors, so rendering doesn't have to look
+   * up the segment of each pixel.  One entry per pixel of the
+   * gradient's length is enough for it to look the same.
+   */
+
+  if (blend_mode == GIMP_CUSTOM_MODE)
+    {
+      gint i;
+
+      rbd.gradient_cache_size = CLAMP (ceil (rbd.dist) + 1,
+                                       GRADIENT_CACHE_MIN_SIZE,
+                                       GRADIENT_CACHE_MAX_SIZE);
+      rbd.gradient_cache      = g_new0 (GimpRGB, rbd.gradient_cache_size);
+
+      for (i = 0; i < rbd.gradient_cache_size; i++)
+        {
+          gdouble factor = ((gdouble) i /
+                            (gdouble) (rbd.gradient_cache_size - 1));
+
+          gimp_gradient_get_color_at (rbd.gradient, rbd.context, NULL,
+                                      factor, rbd.reverse,
+                                      rbd.gradient_cache + i);
+        }
+    }
+
   /* Render the gradient! */
 
   if (supersample)
@@ -965,91 +1187,54 @@ gradient_fill_region (GimpImage           *image,
       ppd.width       = buffer_region->width;
       ppd.dither_rand = g_rand_new ();
 
-      gimp_adaptive_supersample_area (0, 0,
-                                      (buffer_region->width  - 1),
-                                      (buffer_region->height - 1),
-                                      max_depth, threshold,
-                                      gradient_render_pixel, &rbd,
-                                      gradient_put_pixel, &ppd,
-                                      progress ?
-                                      gimp_progress_update_and_flush : NULL,
-                                      progress);
+      gimp_adaptive_supersample_area_parallel (0, 0,
+                                               (buffer_region->width  - 1),
+                                               (buffer_region->height - 1),
+                                               max_depth, threshold,
+                                               gradient_render_pixel, &rbd,
+                                               gradient_put_pixel, &ppd,
+                                               progress ?
+                                               gimp_progress_update_and_flush :
+                                               NULL,
+                                               progress);
 
       g_rand_free (ppd.dither_rand);
       g_free (ppd.row_data);
     }
   else
     {
-      GeglBufferIterator *iter;
-      GeglRectangle      *roi;
-      gint                total = buffer_region->width * buffer_region->height;
-      gint                done  = 0;
-
-      iter = gegl_buffer_iterator_new (buffer, buffer_region, 0,
-                                       babl_format ("R'G'B'A float"),
-                                       GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
-      roi = &iter->roi[0];
+      FillRegionData data;
+      GeglRectangle  strip = *buffer_region;
+
+      data.rbd    = &rbd;
+      data.buffer = buffer;
+      data.dither = dither;
+      data.seed   = g_random_int ();
+
+      /*  render in parallel, in strips so the progress can be updated
+       *  from this thread in between
+       */
+      while (strip.y < buffer_region->y + buffer_region->height)
+        {
+          strip.height = MIN (PROGRESS_STRIP_HEIGHT,
+                              buffer_region->y + buffer_region->height -
+                              strip.y);
 
-      if (dither)
-        rbd.seed = g_rand_new ();
+          gimp_parallel_distribute_area (&strip, MIN_PARALLEL_SUB_AREA,
+                                         (GimpParallelDistributeAreaFunc)
+                                         gradient_fill_region_area,
+                                         &data);
 
-      while (gegl_buffer_iterator_next (iter))
-        {
-          gfloat *dest = iter->data[0];
-          gint    endx  = roi->x + roi->width;
-          gint    endy  = roi->y + roi->height;
-          gint    x, y;
-
-          if (rbd.seed)
-            {
-              GRand *dither_rand = g_rand_new_with_seed (g_rand_int (rbd.seed));
-
-              for (y = roi->y; y < endy; y++)
-                for (x = roi->x; x < endx; x++)
-                  {
-                    GimpRGB  color = { 0.0, 0.0, 0.0, 1.0 };
-                    gint     i = g_rand_int (dither_rand);
-
-                    gradient_render_pixel (x, y, &color, &rbd);
-
-                    *dest++ = color.r + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
-                    *dest++ = color.g + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
-                    *dest++ = color.b + (gdouble) (i & 0xff) / 256.0 / 256.0; i >>= 8;
-                    *dest++ = color.a + (gdouble) (i & 0xff) / 256.0 / 256.0;
-                  }
-
-              g_rand_free (dither_rand);
-            }
-          else
-            {
-              for (y = roi->y; y < endy; y++)
-                for (x = roi->x; x < endx; x++)
-                  {
-                    GimpRGB  color = { 0.0, 0.0, 0.0, 1.0 };
-
-                    gradient_render_pixel (x, y, &color, &rbd);
-
-                    *dest++ = color.r;
-                    *dest++ = color.g;
-                    *dest++ = color.b;
-                    *dest++ = color.a;
-                  }
-            }
-
-          done += roi->width * roi->height;
+          strip.y += strip.height;
 
           if (progress)
             gimp_progress_set_value (progress,
-                                     (gdouble) done / (gdouble) total);
+                                     (gdouble) (strip.y - buffer_region->y) /
+                                     (gdouble) buffer_region->height);
         }
-
-      if (dither)
-        g_rand_free (rbd.seed);
     }
 
-#ifdef USE_GRADIENT_CACHE
   g_free (rbd.gradient_cache);
-#endif
 
   g_object_unref (rbd.gradient);
 
@@ -30,6 +30,7 @@
 #include "gegl/gimp-gegl-apply-operation.h"
 #include "gegl/gimp-gegl-mask.h"
 #include "gegl/gimp-gegl-mask-combine.h"
+#include "gegl/gimp-gegl-nodes.h"
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
@@ -230,9 +231,28 @@ gimp_drawable_bucket_fill_internal (GimpDrawable        *drawable,
     case GIMP_BG_BUCKET_FILL:
       {
         GeglColor *gegl_color = gimp_gegl_color_new (color);
-
-        gegl_buffer_set_color (buffer, NULL, gegl_color);
+        GeglNode  *node;
+        GeglNode  *color_node;
+
+        /*  write the color and apply the mask in one pass, instead
+         *  of filling the buffer first and masking it afterwards
+         */
+        node = gimp_gegl_create_apply_opacity_node (mask_buffer,
+                                                    -mask_offset_x,
+                                                    -mask_offset_y,
+                                                    1.0);
+
+        color_node = gegl_node_new_child (node,
+                                          "operation", "gegl:color",
+                                          "value",     gegl_color,
+                                          NULL);
         g_object_unref (gegl_color);
+
+        gegl_node_connect_to (color_node, "output",
+                              node,       "input");
+
+        gimp_gegl_apply_operation (NULL, NULL, NULL, node, buffer, NULL);
+        g_object_unref (node);
       }
       break;
 
@@ -242,15 +262,16 @@ gimp_drawable_bucket_fill_internal (GimpDrawable        *drawable,
 
         gegl_buffer_set_pattern (buffer, NULL, pattern_buffer, -x1, -y1);
         g_object_unref (pattern_buffer);
+
+        gimp_gegl_apply_opacity (buffer, NULL, NULL, buffer,
+                                 mask_buffer,
+                                 -mask_offset_x,
+                                 -mask_offset_y,
+                                 1.0);
       }
       break;
     }
 
-  gimp_gegl_apply_opacity (buffer, NULL, NULL, buffer,
-                           mask_buffer,
-                           -mask_offset_x,
-                           -mask_offset_y,
-                           1.0);
   g_object_unref (mask_buffer);
 
   /*  Apply it to the image  */
@@ -25,12 +25,78 @@
 
 #include "gegl/gimp-gegl-nodes.h"
 
+#include "gimp-parallel.h"
 #include "gimpchannel.h"
 #include "gimpdrawable-histogram.h"
 #include "gimphistogram.h"
 #include "gimpimage.h"
 
 
+/*  The histogram of a drawable is kept as partial histograms of
+ *  CHUNK_SIZE x CHUNK_SIZE chunks, so only the chunks that were
+ *  updated since the last call have to be binned again. With a
+ *  selection, the chunks are binned through the selection mask, and
+ *  updates of the mask mark chunks dirty too.
+ */
+#define CHUNK_SIZE 256
+#define CACHE_KEY  "gimp-drawable-histogram-cache"
+
+
+typedef struct
+{
+  GeglBuffer     *buffer;         /*  weak pointer  */
+  const Babl     *format;
+  gint            width;
+  gint            height;
+  gboolean        gamma_correct;
+
+  GimpChannel    *mask;           /*  weak pointer, NULL if not masked  */
+  gulong          mask_update_id;
+  gint            mask_off_x;
+  gint            mask_off_y;
+
+  gint            n_chunks_x;
+  gint            n_chunks_y;
+  GimpHistogram **chunks;         /*  NULL if the chunk is dirty  */
+
+  gint           *dirty;          /*  the chunks to compute  */
+  gint            n_dirty;
+} HistogramCache;
+
+
+static void   gimp_drawable_histogram_cached  (GimpDrawable   *drawable,
+                                               GimpHistogram  *histogram,
+                                               GimpChannel    *mask,
+                                               gint            x,
+                                               gint            y,
+                                               gint            width,
+                                               gint            height);
+static void   histogram_cache_free            (HistogramCache *cache);
+static void   histogram_cache_reset           (HistogramCache *cache,
+                                               GeglBuffer     *buffer,
+                                               gboolean        gamma_correct,
+                                               GimpChannel    *mask,
+                                               gint            mask_off_x,
+                                               gint            mask_off_y);
+static void   histogram_cache_update          (GimpDrawable   *drawable,
+                                               gint            x,
+                                               gint            y,
+                                               gint            width,
+                                               gint            height,
+                                               HistogramCache *cache);
+static void   histogram_cache_mask_update     (GimpDrawable   *mask,
+                                               gint            x,
+                                               gint            y,
+                                               gint            width,
+                                               gint            height,
+                                               HistogramCache *cache);
+static void   histogram_cache_compute         (gint            i,
+                                               gint            n,
+                                               HistogramCache *cache);
+
+
+/*  public functions  */
+
 void
 gimp_drawable_calculate_histogram (GimpDrawable  *drawable,
                                    GimpHistogram *histogram)
@@ -98,25 +164,283 @@ gimp_drawable_calculate_histogram (GimpDrawable  *drawable,
     }
   else
     {
-      if (! gimp_channel_is_empty (mask))
+      if (gimp_channel_is_empty (mask))
+        mask = NULL;
+
+      gimp_drawable_histogram_cached (drawable, histogram, mask,
+                                      x, y, width, height);
+    }
+}
+
+
+/*  private functions  */
+
+static void
+gimp_drawable_histogram_cached (GimpDrawable  *drawable,
+                                GimpHistogram *histogram,
+                                GimpChannel   *mask,
+                                gint           x,
+                                gint           y,
+                                gint           width,
+                                gint           height)
+{
+  HistogramCache  *cache;
+  GeglBuffer      *buffer        = gimp_drawable_get_buffer (drawable);
+  gboolean         gamma_correct = gimp_histogram_get_gamma_correct (histogram);
+  GimpHistogram  **parts;
+  gint             off_x         = 0;
+  gint             off_y         = 0;
+  gint             cx1, cy1, cx2, cy2;
+  gint             cx, cy;
+  gint             n_parts;
+
+  cache = g_object_get_data (G_OBJECT (drawable), CACHE_KEY);
+
+  if (! cache)
+    {
+      cache = g_slice_new0 (HistogramCache);
+
+      g_object_set_data_full (G_OBJECT (drawable), CACHE_KEY, cache,
+                              (GDestroyNotify) histogram_cache_free);
+
+      g_signal_connect (drawable, "update",
+                        G_CALLBACK (histogram_cache_update),
+                        cache);
+    }
+
+  if (mask)
+    gimp_item_get_offset (GIMP_ITEM (drawable), &off_x, &off_y);
+
+  if (cache->buffer        != buffer                              ||
+      cache->format        != gegl_buffer_get_format (buffer)     ||
+      cache->width         != gegl_buffer_get_width (buffer)      ||
+      cache->height        != gegl_buffer_get_height (buffer)     ||
+      cache->gamma_correct != gamma_correct                       ||
+      cache->mask          != mask                                ||
+      cache->mask_off_x    != off_x                               ||
+      cache->mask_off_y    != off_y)
+    {
+      histogram_cache_reset (cache, buffer, gamma_correct,
+                             mask, off_x, off_y);
+    }
+
+  /*  only the chunks touching the selection's bounds contribute  */
+  cx1 = x / CHUNK_SIZE;
+  cy1 = y / CHUNK_SIZE;
+  cx2 = (x + width  + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  cy2 = (y + height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+  parts   = g_new (GimpHistogram *, (cx2 - cx1) * (cy2 - cy1));
+  n_parts = 0;
+
+  cache->n_dirty = 0;
+
+  for (cy = cy1; cy < cy2; cy++)
+    for (cx = cx1; cx < cx2; cx++)
+      {
+        gint i = cy * cache->n_chunks_x + cx;
+
+        if (! cache->chunks[i])
+          cache->dirty[cache->n_dirty++] = i;
+      }
+
+  if (cache->n_dirty > 0)
+    gimp_parallel_distribute (cache->n_dirty,
+                              (GimpParallelDistributeFunc)
+                              histogram_cache_compute,
+                              cache);
+
+  for (cy = cy1; cy < cy2; cy++)
+    for (cx = cx1; cx < cx2; cx++)
+      parts[n_parts++] = cache->chunks[cy * cache->n_chunks_x + cx];
+
+  gimp_histogram_sum (histogram, parts, n_parts);
+
+  g_free (parts);
+}
+
+static void
+histogram_cache_free (HistogramCache *cache)
+{
+  histogram_cache_reset (cache, NULL, FALSE, NULL, 0, 0);
+
+  g_slice_free (HistogramCache, cache);
+}
+
+static void
+histogram_cache_reset (HistogramCache *cache,
+                       GeglBuffer     *buffer,
+                       gboolean        gamma_correct,
+                       GimpChannel    *mask,
+                       gint            mask_off_x,
+                       gint            mask_off_y)
+{
+  gint i;
+
+  for (i = 0; i < cache->n_chunks_x * cache->n_chunks_y; i++)
+    {
+      if (cache->chunks[i])
+        g_object_unref (cache->chunks[i]);
+    }
+
+  g_free (cache->chunks);
+  g_free (cache->dirty);
+
+  if (cache->buffer)
+    g_object_remove_weak_pointer (G_OBJECT (cache->buffer),
+                                  (gpointer) &cache->buffer);
+
+  if (cache->mask)
+    {
+      g_signal_handler_disconnect (cache->mask, cache->mask_update_id);
+      g_object_remove_weak_pointer (G_OBJECT (cache->mask),
+                                    (gpointer) &cache->mask);
+    }
+
+  cache->buffer        = buffer;
+  cache->format        = NULL;
+  cache->width         = 0;
+  cache->height        = 0;
+  cache->gamma_correct = gamma_correct;
+  cache->mask          = mask;
+  cache->mask_off_x    = mask_off_x;
+  cache->mask_off_y    = mask_off_y;
+  cache->n_chunks_x    = 0;
+  cache->n_chunks_y    = 0;
+  cache->chunks        = NULL;
+  cache->dirty         = NULL;
+  cache->n_dirty       = 0;
+
+  if (buffer)
+    {
+      g_object_add_weak_pointer (G_OBJECT (buffer),
+                                 (gpointer) &cache->buffer);
+
+      cache->format     = gegl_buffer_get_format (buffer);
+      cache->width      = gegl_buffer_get_width (buffer);
+      cache->height     = gegl_buffer_get_height (buffer);
+      cache->n_chunks_x = (cache->width  + CHUNK_SIZE - 1) / CHUNK_SIZE;
+      cache->n_chunks_y = (cache->height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+      cache->chunks = g_new0 (GimpHistogram *,
+                              cache->n_chunks_x * cache->n_chunks_y);
+      cache->dirty  = g_new (gint, cache->n_chunks_x * cache->n_chunks_y);
+    }
+
+  if (mask)
+    {
+      g_object_add_weak_pointer (G_OBJECT (mask),
+                                 (gpointer) &cache->mask);
+
+      cache->mask_update_id =
+        g_signal_connect (mask, "update",
+                          G_CALLBACK (histogram_cache_mask_update),
+                          cache);
+    }
+}
+
+static void
+histogram_cache_update (GimpDrawable   *drawable,
+                        gint            x,
+                        gint            y,
+                        gint            width,
+                        gint            height,
+                        HistogramCache *cache)
+{
+  gint x1, y1, x2, y2;
+  gint cx, cy;
+
+  if (! cache->chunks || width <= 0 || height <= 0)
+    return;
+
+  x1 = CLAMP (x,          0, cache->width)  / CHUNK_SIZE;
+  y1 = CLAMP (y,          0, cache->height) / CHUNK_SIZE;
+  x2 = CLAMP (x + width,  0, cache->width);
+  y2 = CLAMP (y + height, 0, cache->height);
+
+  x2 = (x2 + CHUNK_SIZE - 1) / CHUNK_SIZE;
+  y2 = (y2 + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+  for (cy = y1; cy < y2; cy++)
+    for (cx = x1; cx < x2; cx++)
+      {
+        GimpHistogram **chunk = &cache->chunks[cy * cache->n_chunks_x + cx];
+
+        if (*chunk)
+          {
+            g_object_unref (*chunk);
+            *chunk = NULL;
+          }
+      }
+}
+
+static void
+histogram_cache_mask_update (GimpDrawable   *mask,
+                             gint            x,
+                             gint            y,
+                             gint            width,
+                             gint            height,
+                             HistogramCache *cache)
+{
+  histogram_cache_update (NULL,
+                          x - cache->mask_off_x,
+                          y - cache->mask_off_y,
+                          width, height,
+                          cache);
+}
+
+/*  runs in the threads of gimp_parallel_distribute(), the calls to
+ *  gimp_histogram_calculate() in it are not split any further
+ */
+static void
+histogram_cache_compute (gint            i,
+                         gint            n,
+                         HistogramCache *cache)
+{
+  gint j;
+
+  for (j = i; j < cache->n_dirty; j += n)
+    {
+      gint           index = cache->dirty[j];
+      gint           x     = (index % cache->n_chunks_x) * CHUNK_SIZE;
+      gint           y     = (index / cache->n_chunks_x) * CHUNK_SIZE;
+      GimpHistogram *chunk = gimp_histogram_new (cache->gamma_correct);
+      GeglRectangle  rect  = { x, y,
+                               MIN (CHUNK_SIZE, cache->width  - x),
+                               MIN (CHUNK_SIZE, cache->height - y) };
+
+      if (cache->mask)
         {
-          gint off_x, off_y;
+          GimpItem      *mask = GIMP_ITEM (cache->mask);
+          GeglRectangle  image_rect;
 
-          gimp_item_get_offset (GIMP_ITEM (drawable), &off_x, &off_y);
+          image_rect.x      = -cache->mask_off_x;
+          image_rect.y      = -cache->mask_off_y;
+          image_rect.width  = gimp_item_get_width  (mask);
+          image_rect.height = gimp_item_get_height (mask);
+
+          /*  only bin the part of the chunk inside the image, the
+           *  chunk stays empty if there is none
+           */
+          if (gegl_rectangle_intersect (&rect, &rect, &image_rect))
+            {
+              GeglBuffer *mask_buffer;
 
-          gimp_histogram_calculate (histogram,
-                                    gimp_drawable_get_buffer (drawable),
-                                    GEGL_RECTANGLE (x, y, width, height),
-                                    gimp_drawable_get_buffer (GIMP_DRAWABLE (mask)),
-                                    GEGL_RECTANGLE (x + off_x, y + off_y,
-                                                    width, height));
+              mask_buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (mask));
+
+              gimp_histogram_calculate (chunk, cache->buffer, &rect,
+                                        mask_buffer,
+                                        GEGL_RECTANGLE (rect.x + cache->mask_off_x,
+                                                        rect.y + cache->mask_off_y,
+                                                        rect.width,
+                                                        rect.height));
+            }
         }
       else
         {
-          gimp_histogram_calculate (histogram,
-                                    gimp_drawable_get_buffer (drawable),
-                                    GEGL_RECTANGLE (x, y, width, height),
-                                    NULL, NULL);
+          gimp_histogram_calculate (chunk, cache->buffer, &rect, NULL, NULL);
         }
+
+      cache->chunks[index] = chunk;
     }
 }
@@ -55,6 +55,7 @@ gimp_drawable_offset (GimpDrawable   *drawable,
   gint           width, height;
   gint           src_x, src_y;
   gint           dest_x, dest_y;
+  gint           shift_x, shift_y;
 
   g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
   g_return_if_fail (GIMP_IS_CONTEXT (context));
@@ -86,24 +87,6 @@ gimp_drawable_offset (GimpDrawable   *drawable,
 
   src_buffer = gimp_drawable_get_buffer (drawable);
 
-  new_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height),
-                                gimp_drawable_get_format (drawable));
-
-  if (! wrap_around)
-    {
-      if (fill_type == GIMP_OFFSET_BACKGROUND)
-        {
-          GimpRGB    bg;
-          GeglColor *color;
-
-          gimp_context_get_background (context, &bg);
-
-          color = gimp_gegl_color_new (&bg);
-          gegl_buffer_set_color (new_buffer, NULL, color);
-          g_object_unref (color);
-        }
-    }
-
   if (offset_x >= 0)
     {
       src_x = 0;
@@ -130,6 +113,40 @@ gimp_drawable_offset (GimpDrawable   *drawable,
       height = CLAMP ((height + offset_y), 0, height);
     }
 
+  /*  Shift the new buffer's tile grid onto the one of the source
+   *  buffer, so the center region shares its tiles copy-on-write
+   *  with the source instead of being copied
+   */
+  g_object_get (src_buffer,
+                "shift-x", &shift_x,
+                "shift-y", &shift_y,
+                NULL);
+
+  new_buffer = g_object_new (GEGL_TYPE_BUFFER,
+                             "format",  gimp_drawable_get_format (drawable),
+                             "x",       0,
+                             "y",       0,
+                             "width",   gimp_item_get_width  (item),
+                             "height",  gimp_item_get_height (item),
+                             "shift-x", shift_x + src_x - dest_x,
+                             "shift-y", shift_y + src_y - dest_y,
+                             NULL);
+
+  if (! wrap_around)
+    {
+      if (fill_type == GIMP_OFFSET_BACKGROUND)
+        {
+          GimpRGB    bg;
+          GeglColor *color;
+
+          gimp_context_get_background (context, &bg);
+
+          color = gimp_gegl_color_new (&bg);
+          gegl_buffer_set_color (new_buffer, NULL, color);
+          g_object_unref (color);
+        }
+    }
+
   /*  Copy the center region  */
   if (width && height)
     {
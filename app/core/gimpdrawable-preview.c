@@ -28,12 +28,66 @@
 #include "config/gimpcoreconfig.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimpchannel.h"
 #include "gimpimage.h"
 #include "gimpdrawable-preview.h"
 #include "gimpdrawable-private.h"
 #include "gimplayer.h"
 #include "gimptempbuf.h"
+#include "gimpviewable.h"
+
+
+struct _GimpPreviewRequest
+{
+  volatile gint           ref_count;
+  volatile gint           cancelled;
+
+  GeglBuffer             *buffer;
+  gdouble                 buffer_scale;
+  gint                    src_x;
+  gint                    src_y;
+  gint                    src_width;
+  gint                    src_height;
+  gint                    dest_width;
+  gint                    dest_height;
+  const Babl             *format;
+
+  GimpTempBuf            *preview;
+
+  GimpPreviewRequestFunc  callback;
+  gpointer                user_data;
+};
+
+
+/*  local function prototypes  */
+
+static GimpTempBuf * gimp_drawable_preview_render      (GeglBuffer         *buffer,
+                                                        gdouble             buffer_scale,
+                                                        gint                src_x,
+                                                        gint                src_y,
+                                                        gint                src_width,
+                                                        gint                src_height,
+                                                        gint                dest_width,
+                                                        gint                dest_height,
+                                                        const Babl         *format);
+static GeglBuffer  * gimp_drawable_preview_snapshot    (GeglBuffer         *buffer,
+                                                        gint                src_x,
+                                                        gint                src_y,
+                                                        gint                src_width,
+                                                        gint                src_height,
+                                                        gint                dest_width,
+                                                        gint                dest_height,
+                                                        const Babl         *format,
+                                                        gdouble            *level_scale);
+
+static void          gimp_preview_request_unref        (GimpPreviewRequest *request);
+static void          gimp_drawable_preview_thread_func (GimpPreviewRequest *request,
+                                                        gpointer            data);
+static gboolean      gimp_drawable_preview_idle        (GimpPreviewRequest *request);
+
+
+static GThreadPool *preview_pool = NULL;
 
 
 /*  public functions  */
@@ -93,9 +147,6 @@ gimp_drawable_get_sub_preview (GimpDrawable *drawable,
 {
   GimpItem    *item;
   GimpImage   *image;
-  GeglBuffer  *buffer;
-  GimpTempBuf *preview;
-  gdouble      scale;
 
   g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
   g_return_val_if_fail (src_x >= 0, NULL);
@@ -112,23 +163,277 @@ gimp_drawable_get_sub_preview (GimpDrawable *drawable,
 
   image = gimp_item_get_image (item);
 
+  if (! image->gimp->config->layer_previews)
+    return NULL;
+
+  return gimp_drawable_preview_render (gimp_drawable_get_buffer (drawable),
+                                       1.0,
+                                       src_x, src_y, src_width, src_height,
+                                       dest_width, dest_height,
+                                       gimp_drawable_get_preview_format (drawable));
+}
+
+/**
+ * gimp_drawable_get_sub_preview_async:
+ * @drawable:    a #GimpDrawable
+ * @src_x:       see gimp_drawable_get_sub_preview()
+ * @src_y:       see gimp_drawable_get_sub_preview()
+ * @src_width:   see gimp_drawable_get_sub_preview()
+ * @src_height:  see gimp_drawable_get_sub_preview()
+ * @dest_width:  see gimp_drawable_get_sub_preview()
+ * @dest_height: see gimp_drawable_get_sub_preview()
+ * @callback:    the function to call with the finished preview
+ * @user_data:   data to pass to @callback
+ *
+ * Like gimp_drawable_get_sub_preview(), but renders the preview in a
+ * worker thread, from a low-resolution snapshot of the drawable's
+ * buffer which is taken right away.
+ * @callback is called from an idle handler in the main thread, the
+ * preview it gets is only valid during the call.
+ *
+ * The returned request is owned by the caller until @callback is
+ * called, until then it can be given up with
+ * gimp_preview_request_cancel(), which guarantees that
+ * @callback is not called.
+ *
+ * Returns: the request, or %NULL if layer previews are disabled.
+ **/
+GimpPreviewRequest *
+gimp_drawable_get_sub_preview_async (GimpDrawable           *drawable,
+                                     gint                    src_x,
+                                     gint                    src_y,
+                                     gint                    src_width,
+                                     gint                    src_height,
+                                     gint                    dest_width,
+                                     gint                    dest_height,
+                                     GimpPreviewRequestFunc  callback,
+                                     gpointer                user_data)
+{
+  GimpItem           *item;
+  GimpImage          *image;
+  GeglBuffer         *buffer;
+  GimpPreviewRequest *request;
+
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
+  g_return_val_if_fail (src_x >= 0, NULL);
+  g_return_val_if_fail (src_y >= 0, NULL);
+  g_return_val_if_fail (src_width  > 0, NULL);
+  g_return_val_if_fail (src_height > 0, NULL);
+  g_return_val_if_fail (dest_width  > 0, NULL);
+  g_return_val_if_fail (dest_height > 0, NULL);
+  g_return_val_if_fail (callback != NULL, NULL);
+
+  item = GIMP_ITEM (drawable);
+
+  g_return_val_if_fail ((src_x + src_width)  <= gimp_item_get_width  (item), NULL);
+  g_return_val_if_fail ((src_y + src_height) <= gimp_item_get_height (item), NULL);
+
+  image = gimp_item_get_image (item);
+
   if (! image->gimp->config->layer_previews)
     return NULL;
 
   buffer = gimp_drawable_get_buffer (drawable);
 
-  preview = gimp_temp_buf_new (dest_width, dest_height,
-                               gimp_drawable_get_preview_format (drawable));
+  if (! preview_pool)
+    preview_pool = g_thread_pool_new ((GFunc) gimp_drawable_preview_thread_func,
+                                      NULL,
+                                      gimp_parallel_get_n_threads (),
+                                      FALSE, NULL);
+
+  request = g_slice_new0 (GimpPreviewRequest);
+
+  /*  one reference for the caller, one for the worker  */
+  request->ref_count   = 2;
+  request->src_x       = src_x;
+  request->src_y       = src_y;
+  request->src_width   = src_width;
+  request->src_height  = src_height;
+  request->dest_width  = dest_width;
+  request->dest_height = dest_height;
+  request->format      = gimp_drawable_get_preview_format (drawable);
+  request->callback    = callback;
+  request->user_data   = user_data;
+
+  /*  the drawable may be painted on while the worker runs, and the
+   *  tiles of layer groups are rendered on demand by the main
+   *  thread's graph, so copy the mipmap level the preview is made
+   *  from here, and only leave the final scaling to the worker
+   */
+  request->buffer = gimp_drawable_preview_snapshot (buffer,
+                                                    src_x, src_y,
+                                                    src_width, src_height,
+                                                    dest_width, dest_height,
+                                                    request->format,
+                                                    &request->buffer_scale);
 
-  scale = MIN ((gdouble) dest_width  / (gdouble) gegl_buffer_get_width  (buffer),
-               (gdouble) dest_height / (gdouble) gegl_buffer_get_height (buffer));
+  g_thread_pool_push (preview_pool, request, NULL);
+
+  return request;
+}
+
+void
+gimp_preview_request_cancel (GimpPreviewRequest *request)
+{
+  g_return_if_fail (request != NULL);
+
+  g_atomic_int_set (&request->cancelled, TRUE);
+
+  gimp_preview_request_unref (request);
+}
+
+
+/*  private functions  */
+
+/*  scales the source area to the preview size, the rectangle passed
+ *  to gegl_buffer_get() is in scaled coordinates.  GEGL reads the
+ *  mipmap level closest to the scale, so the cost depends on the
+ *  preview's size, not on the size of the source area.  @buffer is
+ *  @buffer_scale times the size of the drawable
+ */
+static GimpTempBuf *
+gimp_drawable_preview_render (GeglBuffer *buffer,
+                              gdouble     buffer_scale,
+                              gint        src_x,
+                              gint        src_y,
+                              gint        src_width,
+                              gint        src_height,
+                              gint        dest_width,
+                              gint        dest_height,
+                              const Babl *format)
+{
+  GimpTempBuf *preview;
+  gdouble      scale;
+
+  scale = MIN ((gdouble) dest_width  / (gdouble) src_width,
+               (gdouble) dest_height / (gdouble) src_height);
+
+  preview = gimp_temp_buf_new (dest_width, dest_height, format);
 
   gegl_buffer_get (buffer,
-                   GEGL_RECTANGLE (src_x, src_y, dest_width, dest_height),
-                   scale,
+                   GEGL_RECTANGLE (floor (src_x * scale),
+                                   floor (src_y * scale),
+                                   dest_width, dest_height),
+                   scale / buffer_scale,
                    gimp_temp_buf_get_format (preview),
                    gimp_temp_buf_get_data (preview),
                    GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
   return preview;
 }
+
+/*  copies the source area from the smallest mipmap level of @buffer
+ *  that is still at least as large as the preview.  GEGL keeps the
+ *  levels around and only recomputes the tiles that changed, so this
+ *  costs a few tile reads.  The copy keeps the level's coordinates,
+ *  its scale is returned in @level_scale
+ */
+static GeglBuffer *
+gimp_drawable_preview_snapshot (GeglBuffer *buffer,
+                                gint        src_x,
+                                gint        src_y,
+                                gint        src_width,
+                                gint        src_height,
+                                gint        dest_width,
+                                gint        dest_height,
+                                const Babl *format,
+                                gdouble    *level_scale)
+{
+  GeglBuffer    *snapshot;
+  GeglRectangle  rect;
+  gdouble        scale;
+  gpointer       data;
+  gint           x1, y1, x2, y2;
+
+  scale = MIN ((gdouble) dest_width  / (gdouble) src_width,
+               (gdouble) dest_height / (gdouble) src_height);
+
+  *level_scale = 1.0;
+
+  while (*level_scale * 0.5 >= scale)
+    *level_scale *= 0.5;
+
+  /*  a little margin for the final scaling's rounding  */
+  x1 = floor (src_x * *level_scale) - 2;
+  y1 = floor (src_y * *level_scale) - 2;
+  x2 = ceil ((src_x + src_width)  * *level_scale) + 2;
+  y2 = ceil ((src_y + src_height) * *level_scale) + 2;
+
+  gegl_rectangle_set (&rect, x1, y1, x2 - x1, y2 - y1);
+
+  data = g_malloc (rect.width * rect.height *
+                   babl_format_get_bytes_per_pixel (format));
+
+  gegl_buffer_get (buffer, &rect, *level_scale,
+                   format, data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  snapshot = gegl_buffer_new (&rect, format);
+
+  gegl_buffer_set (snapshot, &rect, 0,
+                   format, data,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  g_free (data);
+
+  return snapshot;
+}
+
+static void
+gimp_preview_request_unref (GimpPreviewRequest *request)
+{
+  if (g_atomic_int_dec_and_test (&request->ref_count))
+    {
+      if (request->buffer)
+        g_object_unref (request->buffer);
+
+      if (request->preview)
+        gimp_temp_buf_unref (request->preview);
+
+      g_slice_free (GimpPreviewRequest, request);
+    }
+}
+
+static void
+gimp_drawable_preview_thread_func (GimpPreviewRequest *request,
+                                   gpointer            data)
+{
+  /*  skip requests that went stale while they were queued  */
+  if (g_atomic_int_get (&request->cancelled))
+    {
+      gimp_preview_request_unref (request);
+      return;
+    }
+
+  request->preview = gimp_drawable_preview_render (request->buffer,
+                                                   request->buffer_scale,
+                                                   request->src_x,
+                                                   request->src_y,
+                                                   request->src_width,
+                                                   request->src_height,
+                                                   request->dest_width,
+                                                   request->dest_height,
+                                                   request->format);
+
+  g_idle_add_full (GIMP_VIEWABLE_PRIORITY_IDLE,
+                   (GSourceFunc) gimp_drawable_preview_idle,
+                   request,
+                   (GDestroyNotify) gimp_preview_request_unref);
+}
+
+static gboolean
+gimp_drawable_preview_idle (GimpPreviewRequest *request)
+{
+  /*  the flag is only set from the main thread, so it can't change
+   *  between the check and the call
+   */
+  if (! g_atomic_int_get (&request->cancelled))
+    {
+      request->callback (request->preview, request->user_data);
+
+      /*  drop the caller's reference  */
+      gimp_preview_request_unref (request);
+    }
+
+  return FALSE;
+}
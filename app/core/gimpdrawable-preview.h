@@ -19,6 +19,10 @@
 #define __GIMP_DRAWABLE__PREVIEW_H__
 
 
+typedef void (* GimpPreviewRequestFunc) (GimpTempBuf *preview,
+                                         gpointer     user_data);
+
+
 /*
  *  virtual function of GimpDrawable -- dont't call directly
  */
@@ -39,5 +43,18 @@ GimpTempBuf * gimp_drawable_get_sub_preview    (GimpDrawable *drawable,
                                                 gint          dest_width,
                                                 gint          dest_height);
 
+GimpPreviewRequest * gimp_drawable_get_sub_preview_async
+                                          (GimpDrawable           *drawable,
+                                           gint                    src_x,
+                                           gint                    src_y,
+                                           gint                    src_width,
+                                           gint                    src_height,
+                                           gint                    dest_width,
+                                           gint                    dest_height,
+                                           GimpPreviewRequestFunc  callback,
+                                           gpointer                user_data);
+void                 gimp_preview_request_cancel
+                                          (GimpPreviewRequest     *request);
+
 
 #endif /* __GIMP_DRAWABLE__PREVIEW_H__ */
@@ -34,6 +34,7 @@
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimp-transform-resize.h"
 #include "gimpchannel.h"
 #include "gimpcontext.h"
@@ -61,6 +62,29 @@
 #endif
 
 
+#define MIN_PARALLEL_SUB_AREA (64 * 64)
+
+
+/*  flips and rotations by multiples of 90 degrees only move pixels, so
+ *  they are done by reading a source block for each tile of the new
+ *  buffer and remapping its pixels. @flip_type is
+ *  GIMP_ORIENTATION_UNKNOWN for rotations.
+ */
+typedef struct
+{
+  GeglBuffer          *orig_buffer;
+  GeglBuffer          *new_buffer;
+  GimpOrientationType  flip_type;
+  GimpRotationType     rotate_type;
+  GeglRectangle        src_rect;
+  GeglRectangle        dest_rect;
+  gint                 tile_width;
+  gint                 tile_height;
+  gint                 bpp;
+} RemapData;
+
+
+
 /*  public functions  */
 
 GeglBuffer *
@@ -135,6 +159,240 @@ gimp_drawable_transform_buffer_affine (GimpDrawable           *drawable,
   return new_buffer;
 }
 
+static void
+gimp_drawable_transform_remap_init (RemapData  *data,
+                                    GeglBuffer *orig_buffer,
+                                    GeglBuffer *new_buffer,
+                                    gint        orig_x,
+                                    gint        orig_y,
+                                    gint        orig_width,
+                                    gint        orig_height,
+                                    gint        new_x,
+                                    gint        new_y,
+                                    gint        new_width,
+                                    gint        new_height)
+{
+  data->orig_buffer = orig_buffer;
+  data->new_buffer  = new_buffer;
+  data->flip_type   = GIMP_ORIENTATION_UNKNOWN;
+  data->rotate_type = GIMP_ROTATE_90;
+  data->src_rect    = *GEGL_RECTANGLE (orig_x, orig_y,
+                                       orig_width, orig_height);
+  data->dest_rect   = *GEGL_RECTANGLE (new_x, new_y,
+                                       new_width, new_height);
+  data->bpp         = babl_format_get_bytes_per_pixel (
+                        gegl_buffer_get_format (orig_buffer));
+
+  g_object_get (new_buffer,
+                "tile-width",  &data->tile_width,
+                "tile-height", &data->tile_height,
+                NULL);
+}
+
+/*  a pixel of RGBA float or RGBA u32  */
+typedef struct { guint64 lo, hi; } Pixel128;
+
+#define REMAP_BLOCK(type)                                               \
+  for (v = 0; v < height; v++)                                          \
+    {                                                                   \
+      const guchar *s = src + src_start + v * src_dv;                   \
+      type         *d = (type *) (dest + v * width * bpp);              \
+                                                                        \
+      for (u = 0; u < width; u++)                                       \
+        {                                                               \
+          d[u] = *(const type *) s;                                     \
+          s += src_du;                                                  \
+        }                                                               \
+    }
+
+/*  copies a @width x @height block of pixels to @dest, taking pixel
+ *  (u, v) from @src + @src_start + u * @src_du + v * @src_dv.  The
+ *  copies have the pixel size as type, so the compiler can unroll and
+ *  vectorize them instead of calling memcpy() for every pixel.
+ */
+static void
+gimp_drawable_transform_remap_block (guchar       *dest,
+                                     const guchar *src,
+                                     gint          width,
+                                     gint          height,
+                                     gint          bpp,
+                                     gint          src_start,
+                                     gint          src_du,
+                                     gint          src_dv)
+{
+  gint u, v;
+
+  /*  vertical flips keep the rows intact  */
+  if (src_du == bpp)
+    {
+      for (v = 0; v < height; v++)
+        memcpy (dest + v * width * bpp,
+                src + src_start + v * src_dv,
+                width * bpp);
+
+      return;
+    }
+
+  switch (bpp)
+    {
+    case 1:
+      REMAP_BLOCK (guint8);
+      break;
+
+    case 2:
+      REMAP_BLOCK (guint16);
+      break;
+
+    case 4:
+      REMAP_BLOCK (guint32);
+      break;
+
+    case 8:
+      REMAP_BLOCK (guint64);
+      break;
+
+    case 16:
+      REMAP_BLOCK (Pixel128);
+      break;
+
+    default:
+      for (v = 0; v < height; v++)
+        {
+          const guchar *s = src + src_start + v * src_dv;
+          guchar       *d = dest + v * width * bpp;
+
+          for (u = 0; u < width; u++)
+            {
+              memcpy (d, s, bpp);
+
+              s += src_du;
+              d += bpp;
+            }
+        }
+      break;
+    }
+}
+
+#undef REMAP_BLOCK
+
+/*  remaps the part of the source that ends up in @area of the new
+ *  buffer, one tile of the new buffer at a time, so each block is
+ *  read and written in one go and stays in the cache while it is
+ *  transposed
+ */
+static void
+gimp_drawable_transform_remap_area (const GeglRectangle *area,
+                                    RemapData           *data)
+{
+  const GeglRectangle *src_rect  = &data->src_rect;
+  const GeglRectangle *dest_rect = &data->dest_rect;
+  guchar              *src;
+  guchar              *dest;
+  gint                 bpp = data->bpp;
+  gint                 x, y;
+
+  src  = g_new (guchar, data->tile_width * data->tile_height * bpp);
+  dest = g_new (guchar, data->tile_width * data->tile_height * bpp);
+
+  for (y = area->y; y < area->y + area->height; )
+    {
+      gint ah = MIN (area->y + area->height,
+                     (y / data->tile_height + 1) * data->tile_height) - y;
+
+      for (x = area->x; x < area->x + area->width; )
+        {
+          GeglRectangle src_area;
+          gint          aw = MIN (area->x + area->width,
+                                  (x / data->tile_width + 1) *
+                                  data->tile_width) - x;
+          gint          ax = x - dest_rect->x;
+          gint          ay = y - dest_rect->y;
+          gint          start, du, dv;
+
+          if (data->flip_type == GIMP_ORIENTATION_HORIZONTAL)
+            {
+              src_area.x      = src_rect->x + src_rect->width - ax - aw;
+              src_area.y      = src_rect->y + ay;
+              src_area.width  = aw;
+              src_area.height = ah;
+
+              start = (aw - 1) * bpp;
+              du    = -bpp;
+              dv    = aw * bpp;
+            }
+          else if (data->flip_type == GIMP_ORIENTATION_VERTICAL)
+            {
+              src_area.x      = src_rect->x + ax;
+              src_area.y      = src_rect->y + src_rect->height - ay - ah;
+              src_area.width  = aw;
+              src_area.height = ah;
+
+              start = (ah - 1) * aw * bpp;
+              du    = bpp;
+              dv    = -aw * bpp;
+            }
+          else
+            {
+              switch (data->rotate_type)
+                {
+                case GIMP_ROTATE_90:
+                  src_area.x      = src_rect->x + ay;
+                  src_area.y      = src_rect->y + src_rect->height - ax - aw;
+                  src_area.width  = ah;
+                  src_area.height = aw;
+
+                  start = (aw - 1) * ah * bpp;
+                  du    = -ah * bpp;
+                  dv    = bpp;
+                  break;
+
+                case GIMP_ROTATE_180:
+                  src_area.x      = src_rect->x + src_rect->width  - ax - aw;
+                  src_area.y      = src_rect->y + src_rect->height - ay - ah;
+                  src_area.width  = aw;
+                  src_area.height = ah;
+
+                  start = ((ah - 1) * aw + aw - 1) * bpp;
+                  du    = -bpp;
+                  dv    = -aw * bpp;
+                  break;
+
+                case GIMP_ROTATE_270:
+                  src_area.x      = src_rect->x + src_rect->width - ay - ah;
+                  src_area.y      = src_rect->y + ax;
+                  src_area.width  = ah;
+                  src_area.height = aw;
+
+                  start = (ah - 1) * bpp;
+                  du    = ah * bpp;
+                  dv    = -bpp;
+                  break;
+
+                default:
+                  g_assert_not_reached ();
+                }
+            }
+
+          gegl_buffer_get (data->orig_buffer, &src_area, 1.0, NULL, src,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          gimp_drawable_transform_remap_block (dest, src, aw, ah, bpp,
+                                               start, du, dv);
+
+          gegl_buffer_set (data->new_buffer,
+                           GEGL_RECTANGLE (x, y, aw, ah), 0, NULL, dest,
+                           GEGL_AUTO_ROWSTRIDE);
+
+          x += aw;
+        }
+
+      y += ah;
+    }
+
+  g_free (src);
+  g_free (dest);
+}
+
 GeglBuffer *
 gimp_drawable_transform_buffer_flip (GimpDrawable        *drawable,
                                      GimpContext         *context,
@@ -148,13 +406,11 @@ gimp_drawable_transform_buffer_flip (GimpDrawable        *drawable,
                                      gint                *new_offset_y)
 {
   GeglBuffer    *new_buffer;
-  GeglRectangle  src_rect;
-  GeglRectangle  dest_rect;
+  RemapData      data;
   gint           orig_x, orig_y;
   gint           orig_width, orig_height;
   gint           new_x, new_y;
   gint           new_width, new_height;
-  gint           i;
 
   g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
   g_return_val_if_fail (gimp_item_is_attached (GIMP_ITEM (drawable)), NULL);
@@ -235,56 +491,21 @@ gimp_drawable_transform_buffer_flip (GimpDrawable        *drawable,
       new_y  = 0;
     }
 
-  if (new_width == 0 && new_height == 0)
+  if (new_width < 1 || new_height < 1)
     return new_buffer;
 
-  switch (flip_type)
-    {
-    case GIMP_ORIENTATION_HORIZONTAL:
-      src_rect.x      = orig_x;
-      src_rect.y      = orig_y;
-      src_rect.width  = 1;
-      src_rect.height = orig_height;
-
-      dest_rect.x      = new_x + new_width - 1;
-      dest_rect.y      = new_y;
-      dest_rect.width  = 1;
-      dest_rect.height = new_height;
-
-      for (i = 0; i < orig_width; i++)
-        {
-          src_rect.x  = i + orig_x;
-          dest_rect.x = new_x + new_width - i - 1;
-
-          gegl_buffer_copy (orig_buffer, &src_rect,
-                            new_buffer, &dest_rect);
-        }
-      break;
-
-    case GIMP_ORIENTATION_VERTICAL:
-      src_rect.x      = orig_x;
-      src_rect.y      = orig_y;
-      src_rect.width  = orig_width;
-      src_rect.height = 1;
+  gimp_drawable_transform_remap_init (&data, orig_buffer, new_buffer,
+                                      orig_x, orig_y,
+                                      orig_width, orig_height,
+                                      new_x, new_y,
+                                      new_width, new_height);
 
-      dest_rect.x      = new_x;
-      dest_rect.y      = new_y + new_height - 1;
-      dest_rect.width  = new_width;
-      dest_rect.height = 1;
+  data.flip_type = flip_type;
 
-      for (i = 0; i < orig_height; i++)
-        {
-          src_rect.y  = i + orig_y;
-          dest_rect.y = new_y + new_height - i - 1;
-
-          gegl_buffer_copy (orig_buffer, &src_rect,
-                            new_buffer, &dest_rect);
-        }
-      break;
-
-    case GIMP_ORIENTATION_UNKNOWN:
-      break;
-    }
+  gimp_parallel_distribute_area (&data.dest_rect, MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 gimp_drawable_transform_remap_area,
+                                 &data);
 
   return new_buffer;
 }
@@ -337,11 +558,9 @@ gimp_drawable_transform_buffer_rotate (GimpDrawable     *drawable,
                                        gint             *new_offset_y)
 {
   GeglBuffer    *new_buffer;
-  GeglRectangle  src_rect;
-  GeglRectangle  dest_rect;
+  RemapData      data;
   gint           orig_x, orig_y;
   gint           orig_width, orig_height;
-  gint           orig_bpp;
   gint           new_x, new_y;
   gint           new_width, new_height;
 
@@ -354,7 +573,6 @@ gimp_drawable_transform_buffer_rotate (GimpDrawable     *drawable,
   orig_y      = orig_offset_y;
   orig_width  = gegl_buffer_get_width (orig_buffer);
   orig_height = gegl_buffer_get_height (orig_buffer);
-  orig_bpp    = babl_format_get_bytes_per_pixel (gegl_buffer_get_format (orig_buffer));
 
   switch (rotate_type)
     {
@@ -492,116 +710,18 @@ gimp_drawable_transform_buffer_rotate (GimpDrawable     *drawable,
   if (new_width < 1 || new_height < 1)
     return new_buffer;
 
-  src_rect.x      = orig_x;
-  src_rect.y      = orig_y;
-  src_rect.width  = orig_width;
-  src_rect.height = orig_height;
-
-  dest_rect.x      = new_x;
-  dest_rect.y      = new_y;
-  dest_rect.width  = new_width;
-  dest_rect.height = new_height;
-
-  switch (rotate_type)
-    {
-    case GIMP_ROTATE_90:
-      {
-        guchar *buf = g_new (guchar, new_height * orig_bpp);
-        gint    i;
-
-        g_assert (new_height == orig_width);
-
-        src_rect.y      = orig_y + orig_height - 1;
-        src_rect.height = 1;
-
-        dest_rect.x     = new_x;
-        dest_rect.width = 1;
-
-        for (i = 0; i < orig_height; i++)
-          {
-            src_rect.y  = orig_y + orig_height - 1 - i;
-            dest_rect.x = new_x + i;
-
-            gegl_buffer_get (orig_buffer, &src_rect, 1.0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-            gegl_buffer_set (new_buffer, &dest_rect, 0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE);
-          }
-
-        g_free (buf);
-      }
-      break;
-
-    case GIMP_ROTATE_180:
-      {
-        guchar *buf = g_new (guchar, new_width * orig_bpp);
-        gint    i, j, k;
-
-        g_assert (new_width == orig_width);
-
-        src_rect.y      = orig_y + orig_height - 1;
-        src_rect.height = 1;
-
-        dest_rect.y      = new_y;
-        dest_rect.height = 1;
+  gimp_drawable_transform_remap_init (&data, orig_buffer, new_buffer,
+                                      orig_x, orig_y,
+                                      orig_width, orig_height,
+                                      new_x, new_y,
+                                      new_width, new_height);
 
-        for (i = 0; i < orig_height; i++)
-          {
-            src_rect.y  = orig_y + orig_height - 1 - i;
-            dest_rect.y = new_y + i;
+  data.rotate_type = rotate_type;
 
-            gegl_buffer_get (orig_buffer, &src_rect, 1.0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-
-            for (j = 0; j < orig_width / 2; j++)
-              {
-                guchar *left  = buf + j * orig_bpp;
-                guchar *right = buf + (orig_width - 1 - j) * orig_bpp;
-
-                for (k = 0; k < orig_bpp; k++)
-                  {
-                    guchar tmp = left[k];
-                    left[k]    = right[k];
-                    right[k]   = tmp;
-                  }
-              }
-
-            gegl_buffer_set (new_buffer, &dest_rect, 0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE);
-          }
-
-        g_free (buf);
-      }
-      break;
-
-    case GIMP_ROTATE_270:
-      {
-        guchar *buf = g_new (guchar, new_width * orig_bpp);
-        gint    i;
-
-        g_assert (new_width == orig_height);
-
-        src_rect.x     = orig_x + orig_width - 1;
-        src_rect.width = 1;
-
-        dest_rect.y      = new_y;
-        dest_rect.height = 1;
-
-        for (i = 0; i < orig_width; i++)
-          {
-            src_rect.x  = orig_x + orig_width - 1 - i;
-            dest_rect.y = new_y + i;
-
-            gegl_buffer_get (orig_buffer, &src_rect, 1.0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-            gegl_buffer_set (new_buffer, &dest_rect, 0, NULL, buf,
-                             GEGL_AUTO_ROWSTRIDE);
-          }
-
-        g_free (buf);
-      }
-      break;
-    }
+  gimp_parallel_distribute_area (&data.dest_rect, MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 gimp_drawable_transform_remap_area,
+                                 &data);
 
   return new_buffer;
 }
@@ -23,6 +23,8 @@
 
 #include "core-types.h"
 
+#include "gegl/gimpcompressedbuffer.h"
+
 #include "gimp-utils.h"
 #include "gimpimage.h"
 #include "gimpdrawable.h"
@@ -125,7 +127,12 @@ gimp_drawable_undo_set_property (GObject      *object,
   switch (property_id)
     {
     case PROP_BUFFER:
-      drawable_undo->buffer = g_value_dup_object (value);
+      /*  keep only a compressed copy of the pixels, they are needed
+       *  again only when the undo is popped
+       */
+      if (g_value_get_object (value))
+        drawable_undo->buffer =
+          gimp_compressed_buffer_new (g_value_get_object (value));
       break;
     case PROP_X:
       drawable_undo->x = g_value_get_int (value);
@@ -151,7 +158,8 @@ gimp_drawable_undo_get_property (GObject    *object,
   switch (property_id)
     {
     case PROP_BUFFER:
-      g_value_set_object (value, drawable_undo->buffer);
+      g_value_take_object (value,
+                           gimp_compressed_buffer_decompress (drawable_undo->buffer));
       break;
     case PROP_X:
       g_value_set_int (value, drawable_undo->x);
@@ -173,7 +181,7 @@ gimp_drawable_undo_get_memsize (GimpObject *object,
   GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (object);
   gint64            memsize       = 0;
 
-  memsize += gimp_gegl_buffer_get_memsize (drawable_undo->buffer);
+  memsize += gimp_compressed_buffer_get_memsize (drawable_undo->buffer);
 
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
@@ -185,13 +193,22 @@ gimp_drawable_undo_pop (GimpUndo            *undo,
                         GimpUndoAccumulator *accum)
 {
   GimpDrawableUndo *drawable_undo = GIMP_DRAWABLE_UNDO (undo);
+  GeglBuffer       *buffer;
 
   GIMP_UNDO_CLASS (parent_class)->pop (undo, undo_mode, accum);
 
+  buffer = gimp_compressed_buffer_decompress (drawable_undo->buffer);
+
   gimp_drawable_swap_pixels (GIMP_DRAWABLE (GIMP_ITEM_UNDO (undo)->item),
-                             drawable_undo->buffer,
+                             buffer,
                              drawable_undo->x,
                              drawable_undo->y);
+
+  /*  the buffer now holds the pixels that were swapped out  */
+  gimp_compressed_buffer_free (drawable_undo->buffer);
+  drawable_undo->buffer = gimp_compressed_buffer_new (buffer);
+
+  g_object_unref (buffer);
 }
 
 static void
@@ -202,7 +219,7 @@ gimp_drawable_undo_free (GimpUndo     *undo,
 
   if (drawable_undo->buffer)
     {
-      g_object_unref (drawable_undo->buffer);
+      gimp_compressed_buffer_free (drawable_undo->buffer);
       drawable_undo->buffer = NULL;
     }
 
@@ -36,9 +36,9 @@ struct _GimpDrawableUndo
 {
   GimpItemUndo  parent_instance;
 
-  GeglBuffer   *buffer;
-  gint          x;
-  gint          y;
+  GimpCompressedBuffer *buffer;
+  gint                  x;
+  gint                  y;
 
   /* stuff for "Fade" */
   GeglBuffer           *applied_buffer;
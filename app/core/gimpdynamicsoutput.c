@@ -66,6 +66,24 @@ enum
 };
 
 
+/*  the curves are sampled into tables, so evaluating a dab doesn't
+ *  call into GimpCurve for every input of every output
+ */
+#define CURVE_LUT_SIZE 256
+
+typedef enum
+{
+  CURVE_PRESSURE,
+  CURVE_VELOCITY,
+  CURVE_DIRECTION,
+  CURVE_TILT,
+  CURVE_WHEEL,
+  CURVE_RANDOM,
+  CURVE_FADE,
+  N_CURVES
+} DynamicsCurve;
+
+
 typedef struct _GimpDynamicsOutputPrivate GimpDynamicsOutputPrivate;
 
 struct _GimpDynamicsOutputPrivate
@@ -87,6 +105,9 @@ struct _GimpDynamicsOutputPrivate
   GimpCurve              *wheel_curve;
   GimpCurve              *random_curve;
   GimpCurve              *fade_curve;
+
+  gfloat                 *luts[N_CURVES];
+  guint                   luts_dirty;  /*  a bit per curve  */
 };
 
 #define GET_PRIVATE(output) \
@@ -113,6 +134,14 @@ static GimpCurve *
 static void   gimp_dynamics_output_curve_dirty  (GimpCurve          *curve,
                                                  GimpDynamicsOutput *output);
 
+static GimpCurve *
+              gimp_dynamics_output_get_curve    (GimpDynamicsOutputPrivate *private,
+                                                 DynamicsCurve              curve);
+static inline gdouble
+              gimp_dynamics_output_map_value    (GimpDynamicsOutputPrivate *private,
+                                                 DynamicsCurve              curve,
+                                                 gdouble                    value);
+
 
 G_DEFINE_TYPE_WITH_CODE (GimpDynamicsOutput, gimp_dynamics_output,
                          GIMP_TYPE_OBJECT,
@@ -231,12 +260,15 @@ gimp_dynamics_output_init (GimpDynamicsOutput *output)
                                                                 "random-curve");
   private->fade_curve      = gimp_dynamics_output_create_curve (output,
                                                                 "fade-curve");
+
+  private->luts_dirty = (1 << N_CURVES) - 1;
 }
 
 static void
 gimp_dynamics_output_finalize (GObject *object)
 {
   GimpDynamicsOutputPrivate *private = GET_PRIVATE (object);
+  gint                       i;
 
   g_object_unref (private->pressure_curve);
   g_object_unref (private->velocity_curve);
@@ -246,6 +278,9 @@ gimp_dynamics_output_finalize (GObject *object)
   g_object_unref (private->random_curve);
   g_object_unref (private->fade_curve);
 
+  for (i = 0; i < N_CURVES; i++)
+    g_free (private->luts[i]);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -450,30 +485,32 @@ gimp_dynamics_output_get_linear_value (GimpDynamicsOutput *output,
 
   if (private->use_pressure)
     {
-      total += gimp_curve_map_value (private->pressure_curve,
-                                     coords->pressure);
+      total += gimp_dynamics_output_map_value (private, CURVE_PRESSURE,
+                                               coords->pressure);
       factors++;
     }
 
   if (private->use_velocity)
     {
-      total += gimp_curve_map_value (private->velocity_curve,
-                                    (1.0 - coords->velocity));
+      total += gimp_dynamics_output_map_value (private, CURVE_VELOCITY,
+                                               1.0 - coords->velocity);
       factors++;
     }
 
   if (private->use_direction)
     {
-      total += gimp_curve_map_value (private->direction_curve,
-                                     fmod (coords->direction + 0.5, 1));
+      gdouble direction = fmod (coords->direction + 0.5, 1);
+
+      total += gimp_dynamics_output_map_value (private, CURVE_DIRECTION,
+                                               direction);
       factors++;
     }
 
   if (private->use_tilt)
     {
-      total += gimp_curve_map_value (private->tilt_curve,
-                                     (1.0 - sqrt (SQR (coords->xtilt) +
-                                      SQR (coords->ytilt))));
+      gdouble tilt = 1.0 - sqrt (SQR (coords->xtilt) + SQR (coords->ytilt));
+
+      total += gimp_dynamics_output_map_value (private, CURVE_TILT, tilt);
       factors++;
     }
 
@@ -483,20 +520,21 @@ gimp_dynamics_output_get_linear_value (GimpDynamicsOutput *output,
 
       wheel = coords->wheel;
 
-      total += gimp_curve_map_value (private->wheel_curve, wheel);
+      total += gimp_dynamics_output_map_value (private, CURVE_WHEEL, wheel);
       factors++;
     }
 
   if (private->use_random)
     {
-      total += gimp_curve_map_value (private->random_curve,
-                                     g_random_double_range (0.0, 1.0));
+      gdouble random = g_random_double_range (0.0, 1.0);
+
+      total += gimp_dynamics_output_map_value (private, CURVE_RANDOM, random);
       factors++;
     }
 
   if (private->use_fade)
     {
-      total += gimp_curve_map_value (private->fade_curve, fade_point);
+      total += gimp_dynamics_output_map_value (private, CURVE_FADE, fade_point);
 
       factors++;
     }
@@ -525,22 +563,22 @@ gimp_dynamics_output_get_angular_value (GimpDynamicsOutput *output,
 
   if (private->use_pressure)
     {
-      total += gimp_curve_map_value (private->pressure_curve,
-                                     coords->pressure);
+      total += gimp_dynamics_output_map_value (private, CURVE_PRESSURE,
+                                               coords->pressure);
       factors++;
     }
 
   if (private->use_velocity)
     {
-      total += gimp_curve_map_value (private->velocity_curve,
-                                    (1.0 - coords->velocity));
+      total += gimp_dynamics_output_map_value (private, CURVE_VELOCITY,
+                                               1.0 - coords->velocity);
       factors++;
     }
 
   if (private->use_direction)
     {
-      total += gimp_curve_map_value (private->direction_curve,
-                                     coords->direction);
+      total += gimp_dynamics_output_map_value (private, CURVE_DIRECTION,
+                                               coords->direction);
       factors++;
     }
 
@@ -579,7 +617,7 @@ gimp_dynamics_output_get_angular_value (GimpDynamicsOutput *output,
       while (tilt < 0.0)
         tilt += 1.0;
 
-      total += gimp_curve_map_value (private->tilt_curve, tilt);
+      total += gimp_dynamics_output_map_value (private, CURVE_TILT, tilt);
       factors++;
     }
 
@@ -587,20 +625,21 @@ gimp_dynamics_output_get_angular_value (GimpDynamicsOutput *output,
     {
       gdouble angle = 1.0 - fmod(0.5 + coords->wheel, 1);
 
-      total += gimp_curve_map_value (private->wheel_curve, angle);
+      total += gimp_dynamics_output_map_value (private, CURVE_WHEEL, angle);
       factors++;
     }
 
   if (private->use_random)
     {
-      total += gimp_curve_map_value (private->random_curve,
-                                     g_random_double_range (0.0, 1.0));
+      gdouble random = g_random_double_range (0.0, 1.0);
+
+      total += gimp_dynamics_output_map_value (private, CURVE_RANDOM, random);
       factors++;
     }
 
   if (private->use_fade)
     {
-      total += gimp_curve_map_value (private->fade_curve, fade_point);
+      total += gimp_dynamics_output_map_value (private, CURVE_FADE, fade_point);
 
       factors++;
     }
@@ -630,22 +669,24 @@ gimp_dynamics_output_get_aspect_value (GimpDynamicsOutput *output,
 
   if (private->use_pressure)
     {
-      total += gimp_curve_map_value (private->pressure_curve,
-                                     coords->pressure);
+      total += gimp_dynamics_output_map_value (private, CURVE_PRESSURE,
+                                               coords->pressure);
       factors++;
     }
 
   if (private->use_velocity)
     {
-      total += gimp_curve_map_value (private->velocity_curve,
-                                     coords->velocity);
+      total += gimp_dynamics_output_map_value (private, CURVE_VELOCITY,
+                                               coords->velocity);
       factors++;
     }
 
   if (private->use_direction)
     {
-      gdouble direction = gimp_curve_map_value (private->direction_curve,
-                                                coords->direction);
+      gdouble direction;
+
+      direction = gimp_dynamics_output_map_value (private, CURVE_DIRECTION,
+                                                  coords->direction);
 
       if (((direction > 0.875) && (direction <= 1.0)) ||
           ((direction > 0.0) && (direction < 0.125))  ||
@@ -660,8 +701,8 @@ gimp_dynamics_output_get_aspect_value (GimpDynamicsOutput *output,
     {
       gdouble tilt_value =  MAX (fabs (coords->xtilt), fabs (coords->ytilt));
 
-      tilt_value = gimp_curve_map_value (private->tilt_curve,
-                                         tilt_value);
+      tilt_value = gimp_dynamics_output_map_value (private, CURVE_TILT,
+                                                   tilt_value);
 
       total += tilt_value;
 
@@ -670,8 +711,10 @@ gimp_dynamics_output_get_aspect_value (GimpDynamicsOutput *output,
 
   if (private->use_wheel)
     {
-      gdouble wheel = gimp_curve_map_value (private->wheel_curve,
-                                            coords->wheel);
+      gdouble wheel;
+
+      wheel = gimp_dynamics_output_map_value (private, CURVE_WHEEL,
+                                              coords->wheel);
 
       if (((wheel > 0.875) && (wheel <= 1.0)) ||
           ((wheel > 0.0) && (wheel < 0.125))  ||
@@ -685,8 +728,10 @@ gimp_dynamics_output_get_aspect_value (GimpDynamicsOutput *output,
 
   if (private->use_random)
     {
-      gdouble random = gimp_curve_map_value (private->random_curve,
-                                             g_random_double_range (0.0, 1.0));
+      gdouble random;
+
+      random = g_random_double_range (0.0, 1.0);
+      random = gimp_dynamics_output_map_value (private, CURVE_RANDOM, random);
 
       total += random;
       factors++;
@@ -694,7 +739,7 @@ gimp_dynamics_output_get_aspect_value (GimpDynamicsOutput *output,
 
   if (private->use_fade)
     {
-      total += gimp_curve_map_value (private->fade_curve, fade_point);
+      total += gimp_dynamics_output_map_value (private, CURVE_FADE, fade_point);
 
       factors++;
     }
@@ -741,5 +786,86 @@ static void
 gimp_dynamics_output_curve_dirty (GimpCurve          *curve,
                                   GimpDynamicsOutput *output)
 {
+  GimpDynamicsOutputPrivate *private = GET_PRIVATE (output);
+  gint                       i;
+
+  for (i = 0; i < N_CURVES; i++)
+    {
+      if (gimp_dynamics_output_get_curve (private, i) == curve)
+        private->luts_dirty |= 1 << i;
+    }
+
   g_object_notify (G_OBJECT (output), gimp_object_get_name (curve));
 }
+
+static GimpCurve *
+gimp_dynamics_output_get_curve (GimpDynamicsOutputPrivate *private,
+                                DynamicsCurve              curve)
+{
+  switch (curve)
+    {
+    case CURVE_PRESSURE:  return private->pressure_curve;
+    case CURVE_VELOCITY:  return private->velocity_curve;
+    case CURVE_DIRECTION: return private->direction_curve;
+    case CURVE_TILT:      return private->tilt_curve;
+    case CURVE_WHEEL:     return private->wheel_curve;
+    case CURVE_RANDOM:    return private->random_curve;
+    case CURVE_FADE:      return private->fade_curve;
+
+    default:
+      g_return_val_if_reached (NULL);
+    }
+}
+
+/*  Same as gimp_curve_map_value(), but looks up the curve in a table.
+ *  The table is built by the first dab after the curve changed, which
+ *  is usually the first dab of a stroke.
+ */
+static inline gdouble
+gimp_dynamics_output_map_value (GimpDynamicsOutputPrivate *private,
+                                DynamicsCurve              curve,
+                                gdouble                    value)
+{
+  const gfloat *lut;
+
+  if (private->luts_dirty & (1 << curve))
+    {
+      GimpCurve *gimp_curve = gimp_dynamics_output_get_curve (private, curve);
+      gint       i;
+
+      if (! private->luts[curve])
+        private->luts[curve] = g_new (gfloat, CURVE_LUT_SIZE);
+
+      for (i = 0; i < CURVE_LUT_SIZE; i++)
+        private->luts[curve][i] =
+          gimp_curve_map_value (gimp_curve,
+                                (gdouble) i / (CURVE_LUT_SIZE - 1));
+
+      private->luts_dirty &= ~(1 << curve);
+    }
+
+  lut = private->luts[curve];
+
+  /*  like gimp_curve_map_value(), this keeps NaN away from the
+   *  interpolation
+   */
+  if (value > 0.0 && value < 1.0)
+    {
+      gdouble f;
+      gint    index;
+
+      value = value * (CURVE_LUT_SIZE - 1);
+      index = (gint) value;
+      f     = value - index;
+
+      return (1.0 - f) * lut[index] + f * lut[index + 1];
+    }
+  else if (value >= 1.0)
+    {
+      return lut[CURVE_LUT_SIZE - 1];
+    }
+  else
+    {
+      return lut[0];
+    }
+}
@@ -46,6 +46,11 @@ static void   gimp_filter_stack_add_node    (GimpFilterStack *stack,
 static void   gimp_filter_stack_remove_node (GimpFilterStack *stack,
                                              GimpFilter      *filter);
 
+static GeglNode * gimp_filter_stack_get_input_node (GimpFilterStack *stack,
+                                                    GimpFilter      *filter);
+static void   gimp_filter_stack_add_cache    (GimpFilterStack *stack);
+static void   gimp_filter_stack_remove_cache (GimpFilterStack *stack);
+
 
 G_DEFINE_TYPE (GimpFilterStack, gimp_filter_stack, GIMP_TYPE_LIST);
 
@@ -87,6 +92,9 @@ gimp_filter_stack_finalize (GObject *object)
 {
   GimpFilterStack *stack = GIMP_FILTER_STACK (object);
 
+  stack->cached_filter = NULL;
+  stack->cache_node    = NULL;
+
   if (stack->graph)
     {
       g_object_unref (stack->graph);
@@ -119,6 +127,9 @@ gimp_filter_stack_remove (GimpContainer *container,
 {
   GimpFilterStack *stack = GIMP_FILTER_STACK (container);
 
+  if (GIMP_FILTER (object) == stack->cached_filter)
+    gimp_filter_stack_set_cached_filter (stack, NULL);
+
   if (stack->graph)
     {
       GimpFilter *filter = GIMP_FILTER (object);
@@ -138,6 +149,12 @@ gimp_filter_stack_reorder (GimpContainer *container,
   GimpFilterStack *stack  = GIMP_FILTER_STACK (container);
   GimpFilter      *filter = GIMP_FILTER (object);
 
+  /*  the cached composite is invalid after reordering anyway, so
+   *  simply drop it and create a new one afterwards
+   */
+  if (stack->cache_node)
+    gimp_filter_stack_remove_cache (stack);
+
   if (stack->graph)
     gimp_filter_stack_remove_node (stack, filter);
 
@@ -145,6 +162,9 @@ gimp_filter_stack_reorder (GimpContainer *container,
 
   if (stack->graph)
     gimp_filter_stack_add_node (stack, filter);
+
+  if (stack->graph && stack->cached_filter)
+    gimp_filter_stack_add_cache (stack);
 }
 
 
@@ -226,9 +246,53 @@ gimp_filter_stack_get_graph (GimpFilterStack *stack)
                             output, "input");
     }
 
+  if (stack->cached_filter)
+    gimp_filter_stack_add_cache (stack);
+
   return stack->graph;
 }
 
+/**
+ * gimp_filter_stack_set_cached_filter:
+ * @stack:  a #GimpFilterStack
+ * @filter: a filter in @stack, or %NULL
+ *
+ * Makes @stack cache the composite of everything below @filter, so
+ * changes to @filter itself (like painting on the active layer) don't
+ * cause the filters below it to be processed again.  The cache is
+ * invalidated by GEGL when anything below @filter changes, and it is
+ * dropped when @filter is removed from @stack.
+ **/
+void
+gimp_filter_stack_set_cached_filter (GimpFilterStack *stack,
+                                     GimpFilter      *filter)
+{
+  g_return_if_fail (GIMP_IS_FILTER_STACK (stack));
+  g_return_if_fail (filter == NULL || GIMP_IS_FILTER (filter));
+  g_return_if_fail (filter == NULL ||
+                    gimp_container_have (GIMP_CONTAINER (stack),
+                                         GIMP_OBJECT (filter)));
+
+  if (filter == stack->cached_filter)
+    return;
+
+  if (stack->cache_node)
+    gimp_filter_stack_remove_cache (stack);
+
+  stack->cached_filter = filter;
+
+  if (stack->graph && stack->cached_filter)
+    gimp_filter_stack_add_cache (stack);
+}
+
+GimpFilter *
+gimp_filter_stack_get_cached_filter (GimpFilterStack *stack)
+{
+  g_return_val_if_fail (GIMP_IS_FILTER_STACK (stack), NULL);
+
+  return stack->cached_filter;
+}
+
 
 /*  private functions  */
 
@@ -257,7 +321,7 @@ gimp_filter_stack_add_node (GimpFilterStack *stack,
       filter_above = (GimpFilter *)
         gimp_container_get_child_by_index (GIMP_CONTAINER (stack), index - 1);
 
-      node_above = gimp_filter_get_node (filter_above);
+      node_above = gimp_filter_stack_get_input_node (stack, filter_above);
     }
 
   gegl_node_connect_to (node,       "output",
@@ -281,7 +345,8 @@ gimp_filter_stack_add_node (GimpFilterStack *stack,
     }
 
   gegl_node_connect_to (node_below, "output",
-                        node,       "input");
+                        gimp_filter_stack_get_input_node (stack, filter),
+                        "input");
 }
 
 static void
@@ -297,7 +362,8 @@ gimp_filter_stack_remove_node (GimpFilterStack *stack,
 
   node = gimp_filter_get_node (filter);
 
-  gegl_node_disconnect (node, "input");
+  gegl_node_disconnect (gimp_filter_stack_get_input_node (stack, filter),
+                        "input");
 
   index = gimp_container_get_child_index (GIMP_CONTAINER (stack),
                                           GIMP_OBJECT (filter));
@@ -311,7 +377,7 @@ gimp_filter_stack_remove_node (GimpFilterStack *stack,
       filter_above = (GimpFilter *)
         gimp_container_get_child_by_index (GIMP_CONTAINER (stack), index - 1);
 
-      node_above = gimp_filter_get_node (filter_above);
+      node_above = gimp_filter_stack_get_input_node (stack, filter_above);
     }
 
   filter_below = (GimpFilter *)
@@ -334,3 +400,67 @@ gimp_filter_stack_remove_node (GimpFilterStack *stack,
   gegl_node_connect_to (node_below, "output",
                         node_above, "input");
 }
+
+/*  returns the node whose "input" pad is fed by the filters below
+ *  @filter, which is the cache node for the cached filter
+ */
+static GeglNode *
+gimp_filter_stack_get_input_node (GimpFilterStack *stack,
+                                  GimpFilter      *filter)
+{
+  if (filter == stack->cached_filter && stack->cache_node)
+    return stack->cache_node;
+
+  return gimp_filter_get_node (filter);
+}
+
+static void
+gimp_filter_stack_add_cache (GimpFilterStack *stack)
+{
+  GeglNode *node;
+  GeglNode *producer;
+  gchar    *producer_pad = NULL;
+
+  g_return_if_fail (stack->cache_node == NULL);
+
+  node     = gimp_filter_get_node (stack->cached_filter);
+  producer = gegl_node_get_producer (node, "input", &producer_pad);
+
+  stack->cache_node = gegl_node_new_child (stack->graph,
+                                           "operation", "gegl:cache",
+                                           NULL);
+
+  if (producer)
+    gegl_node_connect_to (producer,          producer_pad,
+                          stack->cache_node, "input");
+
+  gegl_node_connect_to (stack->cache_node, "output",
+                        node,              "input");
+
+  g_free (producer_pad);
+}
+
+static void
+gimp_filter_stack_remove_cache (GimpFilterStack *stack)
+{
+  GeglNode *node;
+  GeglNode *producer;
+  gchar    *producer_pad = NULL;
+
+  g_return_if_fail (stack->cache_node != NULL);
+
+  node     = gimp_filter_get_node (stack->cached_filter);
+  producer = gegl_node_get_producer (stack->cache_node, "input",
+                                     &producer_pad);
+
+  if (producer)
+    gegl_node_connect_to (producer, producer_pad,
+                          node,     "input");
+  else
+    gegl_node_disconnect (node, "input");
+
+  g_free (producer_pad);
+
+  gegl_node_remove_child (stack->graph, stack->cache_node);
+  stack->cache_node = NULL;
+}
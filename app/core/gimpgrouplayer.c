@@ -51,6 +51,10 @@ struct _GimpGroupLayerPrivate
   gint            suspend_resize;
   gboolean        expanded;
 
+  /*  updates deferred while the image's group updates are suspended  */
+  gboolean        pending_resize;
+  gboolean        pending_invalidate;
+
   /*  hackish temp states to make the projection/tiles stuff work  */
   const Babl     *convert_format;
   gboolean        reallocate_projection;
@@ -159,6 +163,7 @@ static void            gimp_group_layer_child_move   (GimpLayer       *child,
 static void            gimp_group_layer_child_resize (GimpLayer       *child,
                                                       GimpGroupLayer  *group);
 
+static gboolean        gimp_group_layer_deferring    (GimpGroupLayer  *group);
 static void            gimp_group_layer_update       (GimpGroupLayer  *group);
 static void            gimp_group_layer_update_size  (GimpGroupLayer  *group);
 
@@ -1058,8 +1063,41 @@ gimp_group_layer_resume_resize (GimpGroupLayer *group,
 
   if (private->suspend_resize == 0)
     {
+      gimp_group_layer_update (group);
+    }
+}
+
+/*  called by gimp_image_resume_group_updates() for each group layer  */
+void
+gimp_group_layer_flush_updates (GimpGroupLayer *group)
+{
+  GimpGroupLayerPrivate *private;
+
+  g_return_if_fail (GIMP_IS_GROUP_LAYER (group));
+
+  private = GET_PRIVATE (group);
+
+  if (private->pending_resize && private->suspend_resize == 0)
+    {
+      private->pending_resize = FALSE;
+
       gimp_group_layer_update_size (group);
     }
+
+  if (private->pending_invalidate)
+    {
+      GimpItem *item = GIMP_ITEM (group);
+
+      private->pending_invalidate = FALSE;
+
+      gimp_projectable_invalidate (GIMP_PROJECTABLE (group),
+                                   gimp_item_get_offset_x (item),
+                                   gimp_item_get_offset_y (item),
+                                   gimp_item_get_width  (item),
+                                   gimp_item_get_height (item));
+
+      gimp_pickable_flush (GIMP_PICKABLE (private->projection));
+    }
 }
 
 
@@ -1096,12 +1134,29 @@ gimp_group_layer_child_resize (GimpLayer      *child,
   gimp_group_layer_update (group);
 }
 
+/*  while the image's group updates are suspended, attached groups
+ *  only remember that they have to update
+ */
+static gboolean
+gimp_group_layer_deferring (GimpGroupLayer *group)
+{
+  GimpItem *item = GIMP_ITEM (group);
+
+  return (gimp_item_is_attached (item) &&
+          gimp_image_get_group_updates_suspended (gimp_item_get_image (item)));
+}
+
 static void
 gimp_group_layer_update (GimpGroupLayer *group)
 {
-  if (GET_PRIVATE (group)->suspend_resize == 0)
+  GimpGroupLayerPrivate *private = GET_PRIVATE (group);
+
+  if (private->suspend_resize == 0)
     {
-      gimp_group_layer_update_size (group);
+      if (gimp_group_layer_deferring (group))
+        private->pending_resize = TRUE;
+      else
+        gimp_group_layer_update_size (group);
     }
 }
 
@@ -1215,6 +1270,12 @@ gimp_group_layer_stack_update (GimpDrawableStack *stack,
               x, y, width, height);
 #endif
 
+  if (gimp_group_layer_deferring (group))
+    {
+      GET_PRIVATE (group)->pending_invalidate = TRUE;
+      return;
+    }
+
   /*  the layer stack's update signal speaks in image coordinates,
    *  pass to the projection as-is.
    */
@@ -57,5 +57,7 @@ void             gimp_group_layer_suspend_resize (GimpGroupLayer *group,
 void             gimp_group_layer_resume_resize  (GimpGroupLayer *group,
                                                   gboolean        push_undo);
 
+void             gimp_group_layer_flush_updates  (GimpGroupLayer *group);
+
 
 #endif /* __GIMP_GROUP_LAYER_H__ */
@@ -29,9 +29,14 @@
 
 #include "gegl/gimp-babl.h"
 
+#include "gimp-parallel.h"
 #include "gimphistogram.h"
 
 
+/*  the minimal number of pixels each thread bins  */
+#define MIN_PARALLEL_SUB_AREA (128 * 128)
+
+
 enum
 {
   PROP_0,
@@ -48,25 +53,40 @@ struct _GimpHistogramPrivate
   gdouble *values;
 };
 
+typedef struct
+{
+  GimpHistogram       *histogram;
+  GeglBuffer          *buffer;
+  const GeglRectangle *buffer_rect;
+  GeglBuffer          *mask;
+  const GeglRectangle *mask_rect;
+  const Babl          *format;
+  gint                 n_components;
+
+  GMutex               mutex;
+} GimpHistogramCalculateData;
+
 
 /*  local function prototypes  */
 
-static void     gimp_histogram_finalize     (GObject       *object);
-static void     gimp_histogram_set_property (GObject       *object,
-                                             guint          property_id,
-                                             const GValue  *value,
-                                             GParamSpec    *pspec);
-static void     gimp_histogram_get_property (GObject       *object,
-                                             guint          property_id,
-                                             GValue        *value,
-                                             GParamSpec    *pspec);
+static void    gimp_histogram_finalize       (GObject                    *object);
+static void    gimp_histogram_set_property   (GObject                    *object,
+                                              guint                       property_id,
+                                              const GValue               *value,
+                                              GParamSpec                 *pspec);
+static void    gimp_histogram_get_property   (GObject                    *object,
+                                              guint                       property_id,
+                                              GValue                     *value,
+                                              GParamSpec                 *pspec);
 
-static gint64   gimp_histogram_get_memsize  (GimpObject    *object,
-                                             gint64        *gui_size);
+static gint64  gimp_histogram_get_memsize    (GimpObject                 *object,
+                                              gint64                     *gui_size);
 
-static void     gimp_histogram_alloc_values (GimpHistogram *histogram,
-                                             gint           n_components,
-                                             gint           n_bins);
+static void    gimp_histogram_calculate_area (const GeglRectangle        *area,
+                                              GimpHistogramCalculateData *info);
+static void    gimp_histogram_alloc_values   (GimpHistogram              *histogram,
+                                              gint                        n_components,
+                                              gint                        n_bins);
 
 
 G_DEFINE_TYPE (GimpHistogram, gimp_histogram, GIMP_TYPE_OBJECT)
@@ -195,6 +215,14 @@ gimp_histogram_new (gboolean gamma_correct)
   return histogram;
 }
 
+gboolean
+gimp_histogram_get_gamma_correct (GimpHistogram *histogram)
+{
+  g_return_val_if_fail (GIMP_IS_HISTOGRAM (histogram), FALSE);
+
+  return histogram->priv->gamma_correct;
+}
+
 /**
  * gimp_histogram_duplicate:
  * @histogram: a %GimpHistogram
@@ -230,11 +258,11 @@ gimp_histogram_calculate (GimpHistogram       *histogram,
                           GeglBuffer          *mask,
                           const GeglRectangle *mask_rect)
 {
-  GimpHistogramPrivate *priv;
-  GeglBufferIterator   *iter;
-  const Babl           *format;
-  gint                  n_components;
-  gint                  n_bins;
+  GimpHistogramPrivate       *priv;
+  GimpHistogramCalculateData  data;
+  const Babl                 *format;
+  gint                        n_components;
+  gint                        n_bins;
 
   g_return_if_fail (GIMP_IS_HISTOGRAM (histogram));
   g_return_if_fail (GEGL_IS_BUFFER (buffer));
@@ -316,164 +344,93 @@ gimp_histogram_calculate (GimpHistogram       *histogram,
 
   gimp_histogram_alloc_values (histogram, n_components, n_bins);
 
-  iter = gegl_buffer_iterator_new (buffer, buffer_rect, 0, format,
-                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
-
-  if (mask)
-    gegl_buffer_iterator_add (iter, mask, mask_rect, 0,
-                              babl_format ("Y float"),
-                              GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+  data.histogram    = histogram;
+  data.buffer       = buffer;
+  data.buffer_rect  = buffer_rect;
+  data.mask         = mask;
+  data.mask_rect    = mask_rect;
+  data.format       = format;
+  data.n_components = n_components;
 
-#define VALUE(c,i) (priv->values[(c) * priv->n_bins + \
-                                 (gint) (CLAMP ((i), 0.0, 1.0) * \
-                                         (priv->n_bins - 0.0001))])
+  g_mutex_init (&data.mutex);
 
-  while (gegl_buffer_iterator_next (iter))
-    {
-      const gfloat *data = iter->data[0];
-      gfloat        max;
+  gimp_parallel_distribute_area (buffer_rect, MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 gimp_histogram_calculate_area,
+                                 &data);
 
-      if (mask)
-        {
-          const gfloat *mask_data = iter->data[1];
-
-          switch (n_components)
-            {
-            case 1:
-              while (iter->length--)
-                {
-                  const gdouble masked = *mask_data;
-
-                  VALUE (0, data[0]) += masked;
-
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-
-            case 2:
-              while (iter->length--)
-                {
-                  const gdouble masked = *mask_data;
-                  const gdouble weight = data[1];
+  g_mutex_clear (&data.mutex);
 
-                  VALUE (0, data[0]) += weight * masked;
-                  VALUE (1, data[1]) += masked;
-
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-
-            case 3: /* calculate separate value values */
-              while (iter->length--)
-                {
-                  const gdouble masked = *mask_data;
-
-                  VALUE (1, data[0]) += masked;
-                  VALUE (2, data[1]) += masked;
-                  VALUE (3, data[2]) += masked;
-
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
-
-                  VALUE (0, max) += masked;
-
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-
-            case 4: /* calculate separate value values */
-              while (iter->length--)
-                {
-                  const gdouble masked = *mask_data;
-                  const gdouble weight = data[3];
-
-                  VALUE (1, data[0]) += weight * masked;
-                  VALUE (2, data[1]) += weight * masked;
-                  VALUE (3, data[2]) += weight * masked;
-                  VALUE (4, data[3]) += masked;
-
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
-
-                  VALUE (0, max) += weight * masked;
+  g_object_notify (G_OBJECT (histogram), "values");
 
-                  data += n_components;
-                  mask_data += 1;
-                }
-              break;
-            }
-        }
-      else /* no mask */
-        {
-          switch (n_components)
-            {
-            case 1:
-              while (iter->length--)
-                {
-                  VALUE (0, data[0]) += 1.0;
+  g_object_thaw_notify (G_OBJECT (histogram));
+}
 
-                  data += n_components;
-                }
-              break;
+/**
+ * gimp_histogram_sum:
+ * @histogram: a #GimpHistogram
+ * @parts:     histograms of disjoint parts of the same buffer
+ * @n_parts:   the number of @parts
+ *
+ * Sets the values of @histogram to the sum of the values of @parts.
+ * Parts without values are skipped, all others must have the same
+ * number of channels and bins.
+ **/
+void
+gimp_histogram_sum (GimpHistogram  *histogram,
+                    GimpHistogram **parts,
+                    gint            n_parts)
+{
+  GimpHistogramPrivate *priv;
+  GimpHistogram        *first = NULL;
+  gint                  n_values;
+  gint                  i;
 
-            case 2:
-              while (iter->length--)
-                {
-                  const gdouble weight = data[1];
+  g_return_if_fail (GIMP_IS_HISTOGRAM (histogram));
+  g_return_if_fail (parts != NULL || n_parts == 0);
 
-                  VALUE (0, data[0]) += weight;
-                  VALUE (1, data[1]) += 1.0;
+  priv = histogram->priv;
 
-                  data += n_components;
-                }
-              break;
+  for (i = 0; i < n_parts && ! first; i++)
+    {
+      if (parts[i] && parts[i]->priv->values)
+        first = parts[i];
+    }
 
-            case 3: /* calculate separate value values */
-              while (iter->length--)
-                {
-                  VALUE (1, data[0]) += 1.0;
-                  VALUE (2, data[1]) += 1.0;
-                  VALUE (3, data[2]) += 1.0;
+  if (! first)
+    {
+      gimp_histogram_clear_values (histogram);
+      return;
+    }
 
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
+  g_object_freeze_notify (G_OBJECT (histogram));
 
-                  VALUE (0, max) += 1.0;
+  gimp_histogram_alloc_values (histogram,
+                               first->priv->n_channels - 1,
+                               first->priv->n_bins);
 
-                  data += n_components;
-                }
-              break;
+  n_values = priv->n_channels * priv->n_bins;
 
-            case 4: /* calculate separate value values */
-              while (iter->length--)
-                {
-                  const gdouble weight = data[3];
+  for (i = 0; i < n_parts; i++)
+    {
+      GimpHistogramPrivate *part;
+      gint                  j;
 
-                  VALUE (1, data[0]) += weight;
-                  VALUE (2, data[1]) += weight;
-                  VALUE (3, data[2]) += weight;
-                  VALUE (4, data[3]) += 1.0;
+      if (! parts[i] || ! parts[i]->priv->values)
+        continue;
 
-                  max = MAX (data[0], data[1]);
-                  max = MAX (data[2], max);
+      part = parts[i]->priv;
 
-                  VALUE (0, max) += weight;
+      g_return_if_fail (part->n_channels == priv->n_channels &&
+                        part->n_bins     == priv->n_bins);
 
-                  data += n_components;
-                }
-              break;
-            }
-        }
+      for (j = 0; j < n_values; j++)
+        priv->values[j] += part->values[j];
     }
 
   g_object_notify (G_OBJECT (histogram), "values");
 
   g_object_thaw_notify (G_OBJECT (histogram));
-
-#undef VALUE
 }
 
 void
@@ -914,6 +871,194 @@ gimp_histogram_get_std_dev (GimpHistogram        *histogram,
 
 /*  private functions  */
 
+static void
+gimp_histogram_calculate_area (const GeglRectangle        *area,
+                               GimpHistogramCalculateData *info)
+{
+  GimpHistogramPrivate *priv         = info->histogram->priv;
+  gint                  n_components = info->n_components;
+  gint                  n_bins       = priv->n_bins;
+  gint                  n_values     = priv->n_channels * n_bins;
+  GeglBufferIterator   *iter;
+  GeglBuffer           *mask         = info->mask;
+  gdouble              *values;
+  gint                  i;
+
+  /*  each thread bins into its own values, they are added up below  */
+  values = g_new0 (gdouble, n_values);
+
+  iter = gegl_buffer_iterator_new (info->buffer, area, 0, info->format,
+                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+
+  if (mask)
+    {
+      GeglRectangle mask_area = *area;
+
+      mask_area.x += info->mask_rect->x - info->buffer_rect->x;
+      mask_area.y += info->mask_rect->y - info->buffer_rect->y;
+
+      gegl_buffer_iterator_add (iter, mask, &mask_area, 0,
+                                babl_format ("Y float"),
+                                GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+    }
+
+#define VALUE(c,i) (values[(c) * n_bins + \
+                           (gint) (CLAMP ((i), 0.0, 1.0) * \
+                                   (n_bins - 0.0001))])
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const gfloat *data = iter->data[0];
+      gfloat        max;
+
+      if (mask)
+        {
+          const gfloat *mask_data = iter->data[1];
+
+          switch (n_components)
+            {
+            case 1:
+              while (iter->length--)
+                {
+                  const gdouble masked = *mask_data;
+
+                  VALUE (0, data[0]) += masked;
+
+                  data += n_components;
+                  mask_data += 1;
+                }
+              break;
+
+            case 2:
+              while (iter->length--)
+                {
+                  const gdouble masked = *mask_data;
+                  const gdouble weight = data[1];
+
+                  VALUE (0, data[0]) += weight * masked;
+                  VALUE (1, data[1]) += masked;
+
+                  data += n_components;
+                  mask_data += 1;
+                }
+              break;
+
+            case 3: /* calculate separate value values */
+              while (iter->length--)
+                {
+                  const gdouble masked = *mask_data;
+
+                  VALUE (1, data[0]) += masked;
+                  VALUE (2, data[1]) += masked;
+                  VALUE (3, data[2]) += masked;
+
+                  max = MAX (data[0], data[1]);
+                  max = MAX (data[2], max);
+
+                  VALUE (0, max) += masked;
+
+                  data += n_components;
+                  mask_data += 1;
+                }
+              break;
+
+            case 4: /* calculate separate value values */
+              while (iter->length--)
+                {
+                  const gdouble masked = *mask_data;
+                  const gdouble weight = data[3];
+
+                  VALUE (1, data[0]) += weight * masked;
+                  VALUE (2, data[1]) += weight * masked;
+                  VALUE (3, data[2]) += weight * masked;
+                  VALUE (4, data[3]) += masked;
+
+                  max = MAX (data[0], data[1]);
+                  max = MAX (data[2], max);
+
+                  VALUE (0, max) += weight * masked;
+
+                  data += n_components;
+                  mask_data += 1;
+                }
+              break;
+            }
+        }
+      else /* no mask */
+        {
+          switch (n_components)
+            {
+            case 1:
+              while (iter->length--)
+                {
+                  VALUE (0, data[0]) += 1.0;
+
+                  data += n_components;
+                }
+              break;
+
+            case 2:
+              while (iter->length--)
+                {
+                  const gdouble weight = data[1];
+
+                  VALUE (0, data[0]) += weight;
+                  VALUE (1, data[1]) += 1.0;
+
+                  data += n_components;
+                }
+              break;
+
+            case 3: /* calculate separate value values */
+              while (iter->length--)
+                {
+                  VALUE (1, data[0]) += 1.0;
+                  VALUE (2, data[1]) += 1.0;
+                  VALUE (3, data[2]) += 1.0;
+
+                  max = MAX (data[0], data[1]);
+                  max = MAX (data[2], max);
+
+                  VALUE (0, max) += 1.0;
+
+                  data += n_components;
+                }
+              break;
+
+            case 4: /* calculate separate value values */
+              while (iter->length--)
+                {
+                  const gdouble weight = data[3];
+
+                  VALUE (1, data[0]) += weight;
+                  VALUE (2, data[1]) += weight;
+                  VALUE (3, data[2]) += weight;
+                  VALUE (4, data[3]) += 1.0;
+
+                  max = MAX (data[0], data[1]);
+                  max = MAX (data[2], max);
+
+                  VALUE (0, max) += weight;
+
+                  data += n_components;
+                }
+              break;
+            }
+        }
+    }
+
+#undef VALUE
+
+  g_mutex_lock (&info->mutex);
+
+  for (i = 0; i < n_values; i++)
+    priv->values[i] += values[i];
+
+  g_mutex_unlock (&info->mutex);
+
+  g_free (values);
+}
+
 static void
 gimp_histogram_alloc_values (GimpHistogram *histogram,
                              gint           n_components,
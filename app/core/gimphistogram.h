@@ -48,50 +48,55 @@ struct _GimpHistogramClass
 };
 
 
-GType           gimp_histogram_get_type      (void) G_GNUC_CONST;
-
-GimpHistogram * gimp_histogram_new           (gboolean              gamma_correct);
-
-GimpHistogram * gimp_histogram_duplicate     (GimpHistogram        *histogram);
-
-void            gimp_histogram_calculate     (GimpHistogram        *histogram,
-                                              GeglBuffer           *buffer,
-                                              const GeglRectangle  *buffer_rect,
-                                              GeglBuffer           *mask,
-                                              const GeglRectangle  *mask_rect);
-
-void            gimp_histogram_clear_values  (GimpHistogram        *histogram);
-
-gdouble         gimp_histogram_get_maximum   (GimpHistogram        *histogram,
-                                              GimpHistogramChannel  channel);
-gdouble         gimp_histogram_get_count     (GimpHistogram        *histogram,
-                                              GimpHistogramChannel  channel,
-                                              gint                  start,
-                                              gint                  end);
-gdouble         gimp_histogram_get_mean      (GimpHistogram        *histogram,
-                                              GimpHistogramChannel  channel,
-                                              gint                  start,
-                                              gint                  end);
-gdouble         gimp_histogram_get_median    (GimpHistogram        *histogram,
-                                              GimpHistogramChannel  channel,
-                                              gint                  start,
-                                              gint                  end);
-gdouble         gimp_histogram_get_std_dev   (GimpHistogram        *histogram,
-                                              GimpHistogramChannel  channel,
-                                              gint                  start,
-                                              gint                  end);
-gdouble         gimp_histogram_get_threshold (GimpHistogram        *histogram,
-                                              GimpHistogramChannel  channel,
-                                              gint                  start,
-                                              gint                  end);
-gdouble         gimp_histogram_get_value     (GimpHistogram        *histogram,
-                                              GimpHistogramChannel  channel,
-                                              gint                  bin);
-gdouble         gimp_histogram_get_component (GimpHistogram        *histogram,
-                                              gint                  component,
-                                              gint                  bin);
-gint            gimp_histogram_n_channels    (GimpHistogram        *histogram);
-gint            gimp_histogram_n_bins        (GimpHistogram        *histogram);
+GType           gimp_histogram_get_type          (void) G_GNUC_CONST;
+
+GimpHistogram * gimp_histogram_new               (gboolean              gamma_correct);
+
+gboolean        gimp_histogram_get_gamma_correct (GimpHistogram        *histogram);
+
+GimpHistogram * gimp_histogram_duplicate         (GimpHistogram        *histogram);
+
+void            gimp_histogram_calculate         (GimpHistogram        *histogram,
+                                                  GeglBuffer           *buffer,
+                                                  const GeglRectangle  *buffer_rect,
+                                                  GeglBuffer           *mask,
+                                                  const GeglRectangle  *mask_rect);
+
+void            gimp_histogram_sum               (GimpHistogram        *histogram,
+                                                  GimpHistogram       **parts,
+                                                  gint                  n_parts);
+void            gimp_histogram_clear_values      (GimpHistogram        *histogram);
+
+gdouble         gimp_histogram_get_maximum       (GimpHistogram        *histogram,
+                                                  GimpHistogramChannel  channel);
+gdouble         gimp_histogram_get_count         (GimpHistogram        *histogram,
+                                                  GimpHistogramChannel  channel,
+                                                  gint                  start,
+                                                  gint                  end);
+gdouble         gimp_histogram_get_mean          (GimpHistogram        *histogram,
+                                                  GimpHistogramChannel  channel,
+                                                  gint                  start,
+                                                  gint                  end);
+gdouble         gimp_histogram_get_median        (GimpHistogram        *histogram,
+                                                  GimpHistogramChannel  channel,
+                                                  gint                  start,
+                                                  gint                  end);
+gdouble         gimp_histogram_get_std_dev       (GimpHistogram        *histogram,
+                                                  GimpHistogramChannel  channel,
+                                                  gint                  start,
+                                                  gint                  end);
+gdouble         gimp_histogram_get_threshold     (GimpHistogram        *histogram,
+                                                  GimpHistogramChannel  channel,
+                                                  gint                  start,
+                                                  gint                  end);
+gdouble         gimp_histogram_get_value         (GimpHistogram        *histogram,
+                                                  GimpHistogramChannel  channel,
+                                                  gint                  bin);
+gdouble         gimp_histogram_get_component     (GimpHistogram        *histogram,
+                                                  gint                  component,
+                                                  gint                  bin);
+gint            gimp_histogram_n_channels        (GimpHistogram        *histogram);
+gint            gimp_histogram_n_bins            (GimpHistogram        *histogram);
 
 
 #endif /* __GIMP_HISTOGRAM_H__ */
@@ -30,10 +30,105 @@
 
 #include "gegl/gimp-babl.h"
 
+#include "gimp-parallel.h"
 #include "gimpdrawable.h"
 #include "gimpimage.h"
 #include "gimpimage-contiguous-region.h"
 #include "gimppickable.h"
+#include "gimpprogress.h"
+
+
+/*  the number of rows whose pixel differences are computed at once  */
+#define BAND_HEIGHT           64
+
+/*  the minimal number of pixels each thread compares  */
+#define MIN_PARALLEL_SUB_AREA (64 * 64)
+
+
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  const Babl          *format;
+  gint                 n_components;
+  gboolean             has_alpha;
+  gboolean             select_transparent;
+  GimpSelectCriterion  select_criterion;
+  gboolean             antialias;
+  gfloat               threshold;
+  const gfloat        *col;
+
+  gint                 width;
+  gint                 height;
+
+  /*  the pixel differences of each band, or NULL if not computed yet.
+   *  Pixels that are part of the region are negated.
+   */
+  gfloat             **bands;
+  gint                 n_bands;
+  gint                 n_bands_done;
+
+  GimpProgress        *progress;
+  gboolean             cancelled;
+} ContiguousRegion;
+
+typedef struct
+{
+  ContiguousRegion *region;
+  gint              y;
+  gfloat           *diff;
+} ContiguousBand;
+
+typedef struct
+{
+  gint y;
+  gint x1;
+  gint x2;
+} ContiguousSpan;
+
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  GeglBuffer          *dest_buffer;
+  const Babl          *format;
+  gint                 n_components;
+  gboolean             has_alpha;
+  gboolean             select_transparent;
+  GimpSelectCriterion  select_criterion;
+  const gfloat        *col;
+} ContiguousDistance;
+
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  GeglBuffer          *dest_buffer;
+  gboolean             antialias;
+  gfloat               threshold;
+} ContiguousThreshold;
+
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  const Babl          *format;
+  gint                 n_components;
+  gboolean             has_alpha;
+  gboolean             select_transparent;
+  GimpSelectCriterion  select_criterion;
+  const gfloat        *col;
+
+  gint                 width;
+  gint                 height;
+
+  gfloat              *dist;     /*  each pixel's distance to col  */
+  gfloat              *level;    /*  the lowest maximal distance on a
+                                  *  path from the seed to the pixel
+                                  */
+} ContiguousLevels;
+
+typedef struct
+{
+  gfloat key;
+  gint   index;
+} ContiguousHeapItem;
 
 
 /*  local function prototypes  */
@@ -42,41 +137,59 @@ static const Babl * choose_format         (GeglBuffer          *buffer,
                                            GimpSelectCriterion  select_criterion,
                                            gint                *n_components,
                                            gboolean            *has_alpha);
-static gfloat   pixel_difference          (const gfloat        *col1,
-                                           const gfloat        *col2,
+static void     pixel_difference_row      (const gfloat        *col,
+                                           const gfloat        *src,
+                                           gfloat              *dest,
+                                           gint                 n_pixels,
                                            gboolean             antialias,
                                            gfloat               threshold,
                                            gint                 n_components,
                                            gboolean             has_alpha,
                                            gboolean             select_transparent,
                                            GimpSelectCriterion  select_criterion);
-static gboolean find_contiguous_segment   (const gfloat        *col,
-                                           GeglBuffer          *src_buffer,
-                                           GeglBuffer          *mask_buffer,
-                                           const Babl          *src_format,
+static void     pixel_distance_row        (const gfloat        *col,
+                                           const gfloat        *src,
+                                           gfloat              *dest,
+                                           gint                 n_pixels,
                                            gint                 n_components,
                                            gboolean             has_alpha,
-                                           gint                 width,
                                            gboolean             select_transparent,
-                                           GimpSelectCriterion  select_criterion,
+                                           GimpSelectCriterion  select_criterion);
+static void     pixel_threshold_row       (const gfloat        *src,
+                                           gfloat              *dest,
+                                           gint                 n_pixels,
                                            gboolean             antialias,
-                                           gfloat               threshold,
-                                           gint                 initial_x,
-                                           gint                 initial_y,
-                                           gint                *start,
-                                           gint                *end);
-static void find_contiguous_region_helper (GeglBuffer          *src_buffer,
-                                           GeglBuffer          *mask_buffer,
-                                           const Babl          *format,
-                                           gint                 n_components,
-                                           gboolean             has_alpha,
-                                           gboolean             select_transparent,
-                                           GimpSelectCriterion  select_criterion,
+                                           gfloat               threshold);
+
+static void     contiguous_distance_area  (const GeglRectangle *area,
+                                           ContiguousDistance  *data);
+static void     contiguous_threshold_area (const GeglRectangle *area,
+                                           ContiguousThreshold *data);
+static void     contiguous_threshold      (GeglBuffer          *src_buffer,
+                                           GeglBuffer          *dest_buffer,
                                            gboolean             antialias,
-                                           gfloat               threshold,
+                                           gfloat               threshold);
+
+static void     contiguous_levels_rows    (gsize                offset,
+                                           gsize                size,
+                                           ContiguousLevels    *levels);
+static void     contiguous_levels_flood   (ContiguousLevels    *levels,
+                                           gint                 x,
+                                           gint                 y);
+static void     contiguous_levels_threshold_area
+                                          (const GeglRectangle *area,
+                                           ContiguousThreshold *data);
+
+static void     contiguous_band_compute   (gsize                offset,
+                                           gsize                size,
+                                           ContiguousBand      *band);
+static gfloat * contiguous_region_get_row (ContiguousRegion    *region,
+                                           gint                 y);
+static void     contiguous_region_cancel  (GimpProgress        *progress,
+                                           ContiguousRegion    *region);
+static void     find_contiguous_region    (ContiguousRegion    *region,
                                            gint                 x,
-                                           gint                 y,
-                                           const gfloat        *col);
+                                           gint                 y);
 
 
 /*  public functions  */
@@ -92,16 +205,46 @@ gimp_image_contiguous_region_by_seed (GimpImage           *image,
                                       gint                 x,
                                       gint                 y)
 {
-  GimpPickable *pickable;
-  GeglBuffer   *src_buffer;
-  GeglBuffer   *mask_buffer;
-  const Babl   *format;
-  gint          n_components;
-  gboolean      has_alpha;
-  gfloat        start_col[MAX_CHANNELS];
+  return gimp_image_contiguous_region_by_seed_with_progress (image, drawable,
+                                                             sample_merged,
+                                                             antialias,
+                                                             threshold,
+                                                             select_transparent,
+                                                             select_criterion,
+                                                             x, y, NULL);
+}
+
+/**
+ * gimp_image_contiguous_region_by_seed_with_progress:
+ * @progress: a #GimpProgress to report to, or %NULL
+ *
+ * Like gimp_image_contiguous_region_by_seed(), but reports its
+ * progress to @progress and stops when @progress is canceled.
+ *
+ * Returns: the region's mask, or %NULL if it was canceled.
+ **/
+GeglBuffer *
+gimp_image_contiguous_region_by_seed_with_progress (GimpImage           *image,
+                                                    GimpDrawable        *drawable,
+                                                    gboolean             sample_merged,
+                                                    gboolean             antialias,
+                                                    gfloat               threshold,
+                                                    gboolean             select_transparent,
+                                                    GimpSelectCriterion  select_criterion,
+                                                    gint                 x,
+                                                    gint                 y,
+                                                    GimpProgress        *progress)
+{
+  GimpPickable     *pickable;
+  GeglBuffer       *src_buffer;
+  GeglBuffer       *mask_buffer;
+  ContiguousRegion  region;
+  gfloat            start_col[MAX_CHANNELS];
+  gint              i;
 
   g_return_val_if_fail (GIMP_IS_IMAGE (image), NULL);
   g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), NULL);
 
   if (sample_merged)
     pickable = GIMP_PICKABLE (gimp_image_get_projection (image));
@@ -112,20 +255,44 @@ gimp_image_contiguous_region_by_seed (GimpImage           *image,
 
   src_buffer = gimp_pickable_get_buffer (pickable);
 
-  format = choose_format (src_buffer, select_criterion,
-                          &n_components, &has_alpha);
+  mask_buffer = gegl_buffer_new (gegl_buffer_get_extent (src_buffer),
+                                 babl_format ("Y float"));
+
+  if (x <  0                                 ||
+      y <  0                                 ||
+      x >= gegl_buffer_get_width (src_buffer) ||
+      y >= gegl_buffer_get_height (src_buffer))
+    {
+      return mask_buffer;
+    }
 
-  gegl_buffer_sample (src_buffer, x, y, NULL, start_col, format,
+  region.src_buffer       = src_buffer;
+  region.select_criterion = select_criterion;
+  region.antialias        = antialias;
+  region.threshold        = threshold;
+  region.col              = start_col;
+  region.width            = gegl_buffer_get_width (src_buffer);
+  region.height           = gegl_buffer_get_height (src_buffer);
+  region.n_bands          = (region.height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+  region.n_bands_done     = 0;
+  region.bands            = g_new0 (gfloat *, region.n_bands);
+  region.progress         = progress;
+  region.cancelled        = FALSE;
+
+  region.format = choose_format (src_buffer, select_criterion,
+                                 &region.n_components, &region.has_alpha);
+
+  gegl_buffer_sample (src_buffer, x, y, NULL, start_col, region.format,
                       GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
 
-  if (has_alpha)
+  if (region.has_alpha)
     {
       if (select_transparent)
         {
           /*  don't select transparent regions if the start pixel isn't
            *  fully transparent
            */
-          if (start_col[n_components - 1] > 0)
+          if (start_col[region.n_components - 1] > 0)
             select_transparent = FALSE;
         }
     }
@@ -134,14 +301,227 @@ gimp_image_contiguous_region_by_seed (GimpImage           *image,
       select_transparent = FALSE;
     }
 
-  mask_buffer = gegl_buffer_new (gegl_buffer_get_extent (src_buffer),
+  region.select_transparent = select_transparent;
+
+  if (progress)
+    g_signal_connect (progress, "cancel",
+                      G_CALLBACK (contiguous_region_cancel),
+                      &region);
+
+  find_contiguous_region (&region, x, y);
+
+  if (progress)
+    g_signal_handlers_disconnect_by_func (progress,
+                                          contiguous_region_cancel,
+                                          &region);
+
+  for (i = 0; i < region.n_bands; i++)
+    {
+      gfloat *band = region.bands[i];
+
+      if (band && ! region.cancelled)
+        {
+          gint y1     = i * BAND_HEIGHT;
+          gint height = MIN (BAND_HEIGHT, region.height - y1);
+          gint j;
+
+          /*  only the pixels that were reached are part of the region  */
+          for (j = 0; j < region.width * height; j++)
+            band[j] = MAX (-band[j], 0.0);
+
+          gegl_buffer_set (mask_buffer,
+                           GEGL_RECTANGLE (0, y1, region.width, height),
+                           0, babl_format ("Y float"), band,
+                           GEGL_AUTO_ROWSTRIDE);
+        }
+
+      g_free (band);
+    }
+
+  g_free (region.bands);
+
+  if (region.cancelled)
+    {
+      g_object_unref (mask_buffer);
+
+      return NULL;
+    }
+
+  return mask_buffer;
+}
+
+/**
+ * gimp_image_contiguous_region_levels_by_seed:
+ * @image:              a #GimpImage
+ * @drawable:           the drawable to sample
+ * @sample_merged:      whether to sample the projection instead
+ * @select_transparent: whether transparent pixels can be selected
+ * @select_criterion:   what to compare the pixels by
+ * @x:                  the seed's x coordinate
+ * @y:                  the seed's y coordinate
+ *
+ * Computes, for every pixel, how far it is from the seed's color and
+ * the lowest threshold at which it is connected to the seed.  The
+ * levels are found with a priority flood fill that always continues at
+ * the pixel that can be reached with the lowest threshold.  The result
+ * can be turned into the mask of any threshold with
+ * gimp_image_contiguous_region_by_levels(), which gives the same mask
+ * as gimp_image_contiguous_region_by_seed() but is much cheaper.
+ *
+ * Returns: a two-component float buffer.  The first component is the
+ *          pixel's distance to the seed color, the second one is the
+ *          largest distance on the best path from the seed to the
+ *          pixel, or %G_MAXFLOAT if it can never be reached.
+ **/
+GeglBuffer *
+gimp_image_contiguous_region_levels_by_seed (GimpImage           *image,
+                                             GimpDrawable        *drawable,
+                                             gboolean             sample_merged,
+                                             gboolean             select_transparent,
+                                             GimpSelectCriterion  select_criterion,
+                                             gint                 x,
+                                             gint                 y)
+{
+  GimpPickable     *pickable;
+  GeglBuffer       *levels_buffer;
+  ContiguousLevels  levels;
+  gfloat            start_col[MAX_CHANNELS];
+  gfloat           *row;
+  gint              y1;
+
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), NULL);
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
+
+  if (sample_merged)
+    pickable = GIMP_PICKABLE (gimp_image_get_projection (image));
+  else
+    pickable = GIMP_PICKABLE (drawable);
+
+  gimp_pickable_flush (pickable);
+
+  levels.src_buffer       = gimp_pickable_get_buffer (pickable);
+  levels.select_criterion = select_criterion;
+  levels.col              = start_col;
+  levels.width            = gegl_buffer_get_width (levels.src_buffer);
+  levels.height           = gegl_buffer_get_height (levels.src_buffer);
+
+  levels.format = choose_format (levels.src_buffer, select_criterion,
+                                 &levels.n_components, &levels.has_alpha);
+
+  levels_buffer = gegl_buffer_new (gegl_buffer_get_extent (levels.src_buffer),
+                                   babl_format ("YA float"));
+
+  if (x <  0            ||
+      y <  0            ||
+      x >= levels.width ||
+      y >= levels.height)
+    {
+      /*  nothing can be reached  */
+      gfloat     unreachable[2] = { G_MAXFLOAT, G_MAXFLOAT };
+      GeglColor *color;
+
+      color = gegl_color_new (NULL);
+      gegl_color_set_pixel (color, babl_format ("YA float"), unreachable);
+      gegl_buffer_set_color (levels_buffer, NULL, color);
+      g_object_unref (color);
+
+      return levels_buffer;
+    }
+
+  gegl_buffer_sample (levels.src_buffer, x, y, NULL, start_col, levels.format,
+                      GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+
+  if (levels.has_alpha)
+    {
+      if (select_transparent)
+        {
+          /*  don't select transparent regions if the start pixel isn't
+           *  fully transparent
+           */
+          if (start_col[levels.n_components - 1] > 0)
+            select_transparent = FALSE;
+        }
+    }
+  else
+    {
+      select_transparent = FALSE;
+    }
+
+  levels.select_transparent = select_transparent;
+
+  levels.dist  = g_new (gfloat, (gsize) levels.width * levels.height);
+  levels.level = g_new (gfloat, (gsize) levels.width * levels.height);
+
+  gimp_parallel_distribute_range (levels.height,
+                                  MAX (MIN_PARALLEL_SUB_AREA /
+                                       levels.width, 1),
+                                  (GimpParallelDistributeRangeFunc)
+                                  contiguous_levels_rows,
+                                  &levels);
+
+  contiguous_levels_flood (&levels, x, y);
+
+  /*  interleave the two maps a band at a time  */
+  row = g_new (gfloat, 2 * levels.width * BAND_HEIGHT);
+
+  for (y1 = 0; y1 < levels.height; y1 += BAND_HEIGHT)
+    {
+      gint   height = MIN (BAND_HEIGHT, levels.height - y1);
+      gsize  offset = (gsize) y1 * levels.width;
+      gint   i;
+
+      for (i = 0; i < levels.width * height; i++)
+        {
+          row[2 * i]     = levels.dist[offset + i];
+          row[2 * i + 1] = levels.level[offset + i];
+        }
+
+      gegl_buffer_set (levels_buffer,
+                       GEGL_RECTANGLE (0, y1, levels.width, height),
+                       0, babl_format ("YA float"), row,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_free (row);
+  g_free (levels.dist);
+  g_free (levels.level);
+
+  return levels_buffer;
+}
+
+/**
+ * gimp_image_contiguous_region_by_levels:
+ * @levels_buffer: a buffer returned by
+ *                 gimp_image_contiguous_region_levels_by_seed()
+ * @antialias:     whether to antialias the mask
+ * @threshold:     the threshold to select with
+ *
+ * Returns: the same mask gimp_image_contiguous_region_by_seed() returns
+ *          for the seed @levels_buffer was computed for.
+ **/
+GeglBuffer *
+gimp_image_contiguous_region_by_levels (GeglBuffer *levels_buffer,
+                                        gboolean    antialias,
+                                        gfloat      threshold)
+{
+  ContiguousThreshold  data;
+  GeglBuffer          *mask_buffer;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (levels_buffer), NULL);
+
+  mask_buffer = gegl_buffer_new (gegl_buffer_get_extent (levels_buffer),
                                  babl_format ("Y float"));
 
-  find_contiguous_region_helper (src_buffer, mask_buffer,
-                                 format, n_components, has_alpha,
-                                 select_transparent, select_criterion,
-                                 antialias, threshold,
-                                 x, y, start_col);
+  data.src_buffer  = levels_buffer;
+  data.dest_buffer = mask_buffer;
+  data.antialias   = antialias;
+  data.threshold   = threshold;
+
+  gimp_parallel_distribute_area (gegl_buffer_get_extent (mask_buffer),
+                                 MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 contiguous_levels_threshold_area,
+                                 &data);
 
   return mask_buffer;
 }
@@ -162,13 +542,52 @@ gimp_image_contiguous_region_by_color (GimpImage            *image,
    *  fuzzy_select.  Modify the image's mask to reflect the
    *  additional selection
    */
-  GeglBufferIterator *iter;
+  GeglBuffer *mask_buffer;
+
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), NULL);
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
+  g_return_val_if_fail (color != NULL, NULL);
+
+  mask_buffer = gimp_image_contiguous_region_distance_by_color (image,
+                                                                drawable,
+                                                                sample_merged,
+                                                                select_transparent,
+                                                                select_criterion,
+                                                                color);
+
+  contiguous_threshold (mask_buffer, mask_buffer, antialias, threshold);
+
+  return mask_buffer;
+}
+
+/**
+ * gimp_image_contiguous_region_distance_by_color:
+ * @image:              a #GimpImage
+ * @drawable:           the drawable to sample
+ * @sample_merged:      whether to sample the projection instead
+ * @select_transparent: whether transparent pixels can be selected
+ * @select_criterion:   what to compare the pixels by
+ * @color:              the color to compare the pixels to
+ *
+ * Computes how much each pixel differs from @color.  The result can
+ * be turned into a selection mask for any threshold with
+ * gimp_image_contiguous_region_by_distance(), which is much cheaper
+ * than calling gimp_image_contiguous_region_by_color() again.
+ *
+ * Returns: a "Y float" buffer of the distances.  Pixels that can never
+ *          be selected have a distance of %G_MAXFLOAT.
+ **/
+GeglBuffer *
+gimp_image_contiguous_region_distance_by_color (GimpImage           *image,
+                                                GimpDrawable        *drawable,
+                                                gboolean             sample_merged,
+                                                gboolean             select_transparent,
+                                                GimpSelectCriterion  select_criterion,
+                                                const GimpRGB       *color)
+{
+  ContiguousDistance  data;
   GimpPickable       *pickable;
-  GeglBuffer         *src_buffer;
-  GeglBuffer         *mask_buffer;
-  const Babl         *format;
-  gint                n_components;
-  gboolean            has_alpha;
+  GeglBuffer         *distance_buffer;
   gfloat              start_col[MAX_CHANNELS];
 
   g_return_val_if_fail (GIMP_IS_IMAGE (image), NULL);
@@ -182,20 +601,22 @@ gimp_image_contiguous_region_by_color (GimpImage            *image,
 
   gimp_pickable_flush (pickable);
 
-  src_buffer = gimp_pickable_get_buffer (pickable);
+  data.src_buffer       = gimp_pickable_get_buffer (pickable);
+  data.select_criterion = select_criterion;
+  data.col              = start_col;
 
-  format = choose_format (src_buffer, select_criterion,
-                          &n_components, &has_alpha);
+  data.format = choose_format (data.src_buffer, select_criterion,
+                               &data.n_components, &data.has_alpha);
 
-  gimp_rgba_get_pixel (color, format, start_col);
+  gimp_rgba_get_pixel (color, data.format, start_col);
 
-  if (has_alpha)
+  if (data.has_alpha)
     {
       if (select_transparent)
         {
           /*  don't select transparancy if "color" isn't fully transparent
            */
-          if (start_col[n_components - 1] > 0.0)
+          if (start_col[data.n_components - 1] > 0.0)
             select_transparent = FALSE;
         }
     }
@@ -204,37 +625,45 @@ gimp_image_contiguous_region_by_color (GimpImage            *image,
       select_transparent = FALSE;
     }
 
-  mask_buffer = gegl_buffer_new (gegl_buffer_get_extent (src_buffer),
-                                 babl_format ("Y float"));
+  data.select_transparent = select_transparent;
 
-  iter = gegl_buffer_iterator_new (src_buffer,
-                                   NULL, 0, format,
-                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+  distance_buffer = gegl_buffer_new (gegl_buffer_get_extent (data.src_buffer),
+                                     babl_format ("Y float"));
 
-  gegl_buffer_iterator_add (iter, mask_buffer,
-                            NULL, 0, babl_format ("Y float"),
-                            GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
+  data.dest_buffer = distance_buffer;
 
-  while (gegl_buffer_iterator_next (iter))
-    {
-      const gfloat *src  = iter->data[0];
-      gfloat       *dest = iter->data[1];
+  gimp_parallel_distribute_area (gegl_buffer_get_extent (data.src_buffer),
+                                 MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 contiguous_distance_area,
+                                 &data);
 
-      while (iter->length--)
-        {
-          /*  Find how closely the colors match  */
-          *dest = pixel_difference (start_col, src,
-                                    antialias,
-                                    threshold,
-                                    n_components,
-                                    has_alpha,
-                                    select_transparent,
-                                    select_criterion);
-
-          src  += n_components;
-          dest += 1;
-        }
-    }
+  return distance_buffer;
+}
+
+/**
+ * gimp_image_contiguous_region_by_distance:
+ * @distance_buffer: a buffer returned by
+ *                   gimp_image_contiguous_region_distance_by_color()
+ * @antialias:       whether to antialias the mask
+ * @threshold:       the maximal distance of selected pixels
+ *
+ * Returns: the same mask gimp_image_contiguous_region_by_color()
+ *          returns for the color @distance_buffer was computed for.
+ **/
+GeglBuffer *
+gimp_image_contiguous_region_by_distance (GeglBuffer *distance_buffer,
+                                          gboolean    antialias,
+                                          gfloat      threshold)
+{
+  GeglBuffer *mask_buffer;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (distance_buffer), NULL);
+
+  mask_buffer = gegl_buffer_new (gegl_buffer_get_extent (distance_buffer),
+                                 babl_format ("Y float"));
+
+  contiguous_threshold (distance_buffer, mask_buffer, antialias, threshold);
 
   return mask_buffer;
 }
@@ -285,248 +714,558 @@ choose_format (GeglBuffer          *buffer,
   return format;
 }
 
-static gfloat
-pixel_difference (const gfloat        *col1,
-                  const gfloat        *col2,
-                  gboolean             antialias,
-                  gfloat               threshold,
-                  gint                 n_components,
-                  gboolean             has_alpha,
-                  gboolean             select_transparent,
-                  GimpSelectCriterion  select_criterion)
+/*  Computes the difference of @n_pixels pixels to @col.  The criterion
+ *  is only looked at once per row, so the loops are simple enough to be
+ *  vectorized by the compiler.
+ */
+static void
+pixel_difference_row (const gfloat        *col,
+                      const gfloat        *src,
+                      gfloat              *dest,
+                      gint                 n_pixels,
+                      gboolean             antialias,
+                      gfloat               threshold,
+                      gint                 n_components,
+                      gboolean             has_alpha,
+                      gboolean             select_transparent,
+                      GimpSelectCriterion  select_criterion)
 {
-  gfloat max = 0.0;
+  pixel_distance_row (col, src, dest, n_pixels,
+                      n_components, has_alpha,
+                      select_transparent, select_criterion);
 
-  /*  if there is an alpha channel, never select transparent regions  */
-  if (! select_transparent && has_alpha && col2[n_components - 1] == 0.0)
-    return 0.0;
+  pixel_threshold_row (dest, dest, n_pixels, antialias, threshold);
+}
+
+static void
+pixel_distance_row (const gfloat        *col,
+                    const gfloat        *src,
+                    gfloat              *dest,
+                    gint                 n_pixels,
+                    gint                 n_components,
+                    gboolean             has_alpha,
+                    gboolean             select_transparent,
+                    GimpSelectCriterion  select_criterion)
+{
+  gint i;
 
   if (select_transparent && has_alpha)
     {
-      max = fabs (col1[n_components - 1] - col2[n_components - 1]);
+      gint a = n_components - 1;
+
+      for (i = 0; i < n_pixels; i++)
+        dest[i] = fabs (col[a] - src[i * n_components + a]);
     }
   else
     {
-      gfloat diff;
-      gint   b;
-
-      if (has_alpha)
-        n_components--;
+      gint n_colors = has_alpha ? n_components - 1 : n_components;
+      gint c;
 
       switch (select_criterion)
         {
         case GIMP_SELECT_CRITERION_COMPOSITE:
-          for (b = 0; b < n_components; b++)
+          for (i = 0; i < n_pixels; i++)
             {
-              diff = fabs (col1[b] - col2[b]);
-              if (diff > max)
-                max = diff;
-            }
-          break;
+              const gfloat *s   = src + i * n_components;
+              gfloat        max = 0.0;
+              gint          b;
 
-        case GIMP_SELECT_CRITERION_R:
-          max = fabs (col1[0] - col2[0]);
-          break;
+              for (b = 0; b < n_colors; b++)
+                {
+                  gfloat diff = fabs (col[b] - s[b]);
 
-        case GIMP_SELECT_CRITERION_G:
-          max = fabs (col1[1] - col2[1]);
-          break;
+                  if (diff > max)
+                    max = diff;
+                }
 
-        case GIMP_SELECT_CRITERION_B:
-          max = fabs (col1[2] - col2[2]);
+              dest[i] = max;
+            }
           break;
 
         case GIMP_SELECT_CRITERION_H:
-          {
-            /* wrap around candidates for the actual distance */
-            gfloat dist1 = fabs (col1[0] - col2[0]);
-            gfloat dist2 = fabs (col1[0] - 1.0 - col2[0]);
-            gfloat dist3 = fabs (col1[0] - col2[0] + 1.0);
-
-            max = MIN (dist1, dist2);
-            if (max > dist3)
-              max = dist3;
-          }
+          for (i = 0; i < n_pixels; i++)
+            {
+              const gfloat *s = src + i * n_components;
+
+              /* wrap around candidates for the actual distance */
+              gfloat dist1 = fabs (col[0] - s[0]);
+              gfloat dist2 = fabs (col[0] - 1.0 - s[0]);
+              gfloat dist3 = fabs (col[0] - s[0] + 1.0);
+              gfloat max   = MIN (dist1, dist2);
+
+              dest[i] = MIN (max, dist3);
+            }
           break;
 
+        case GIMP_SELECT_CRITERION_R:
         case GIMP_SELECT_CRITERION_S:
-          max = fabs (col1[1] - col2[1]);
+          c = (select_criterion == GIMP_SELECT_CRITERION_R) ? 0 : 1;
+
+          for (i = 0; i < n_pixels; i++)
+            dest[i] = fabs (col[c] - src[i * n_components + c]);
           break;
 
+        case GIMP_SELECT_CRITERION_G:
+        case GIMP_SELECT_CRITERION_B:
         case GIMP_SELECT_CRITERION_V:
-          max = fabs (col1[2] - col2[2]);
+          c = (select_criterion == GIMP_SELECT_CRITERION_G) ? 1 : 2;
+
+          for (i = 0; i < n_pixels; i++)
+            dest[i] = fabs (col[c] - src[i * n_components + c]);
           break;
         }
     }
 
+  /*  if there is an alpha channel, never select transparent regions  */
+  if (! select_transparent && has_alpha)
+    {
+      gint a = n_components - 1;
+
+      for (i = 0; i < n_pixels; i++)
+        {
+          if (src[i * n_components + a] == 0.0)
+            dest[i] = G_MAXFLOAT;
+        }
+    }
+}
+
+static void
+pixel_threshold_row (const gfloat *src,
+                     gfloat       *dest,
+                     gint          n_pixels,
+                     gboolean      antialias,
+                     gfloat        threshold)
+{
+  gint i;
+
   if (antialias && threshold > 0.0)
     {
-      gfloat aa = 1.5 - (max / threshold);
+      for (i = 0; i < n_pixels; i++)
+        {
+          gfloat aa = 1.5 - (src[i] / threshold);
+
+          if (aa <= 0.0)
+            dest[i] = 0.0;
+          else if (aa < 0.5)
+            dest[i] = aa * 2.0;
+          else
+            dest[i] = 1.0;
+        }
+    }
+  else
+    {
+      for (i = 0; i < n_pixels; i++)
+        dest[i] = (src[i] > threshold) ? 0.0 : 1.0;
+    }
+}
 
-      if (aa <= 0.0)
-        return 0.0;
-      else if (aa < 0.5)
-        return aa * 2.0;
-      else
-        return 1.0;
+static void
+contiguous_distance_area (const GeglRectangle *area,
+                          ContiguousDistance  *data)
+{
+  GeglBufferIterator *iter;
+
+  iter = gegl_buffer_iterator_new (data->src_buffer, area, 0, data->format,
+                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+
+  gegl_buffer_iterator_add (iter, data->dest_buffer,
+                            area, 0, babl_format ("Y float"),
+                            GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const gfloat *src  = iter->data[0];
+      gfloat       *dest = iter->data[1];
+
+      pixel_distance_row (data->col, src, dest, iter->length,
+                          data->n_components,
+                          data->has_alpha,
+                          data->select_transparent,
+                          data->select_criterion);
+    }
+}
+
+static void
+contiguous_threshold_area (const GeglRectangle *area,
+                           ContiguousThreshold *data)
+{
+  GeglBufferIterator *iter;
+
+  if (data->src_buffer == data->dest_buffer)
+    {
+      iter = gegl_buffer_iterator_new (data->dest_buffer, area, 0,
+                                       babl_format ("Y float"),
+                                       GEGL_BUFFER_READWRITE, GEGL_ABYSS_NONE);
     }
   else
     {
-      if (max > threshold)
-        return 0.0;
-      else
-        return 1.0;
+      iter = gegl_buffer_iterator_new (data->src_buffer, area, 0,
+                                       babl_format ("Y float"),
+                                       GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+
+      gegl_buffer_iterator_add (iter, data->dest_buffer,
+                                area, 0, babl_format ("Y float"),
+                                GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
+    }
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const gfloat *src  = iter->data[0];
+      gfloat       *dest = iter->data[0];
+
+      if (data->src_buffer != data->dest_buffer)
+        dest = iter->data[1];
+
+      pixel_threshold_row (src, dest, iter->length,
+                           data->antialias, data->threshold);
     }
 }
 
-static gboolean
-find_contiguous_segment (const gfloat        *col,
-                         GeglBuffer          *src_buffer,
-                         GeglBuffer          *mask_buffer,
-                         const Babl          *format,
-                         gint                 n_components,
-                         gboolean             has_alpha,
-                         gint                 width,
-                         gboolean             select_transparent,
-                         GimpSelectCriterion  select_criterion,
-                         gboolean             antialias,
-                         gfloat               threshold,
-                         gint                 initial_x,
-                         gint                 initial_y,
-                         gint                *start,
-                         gint                *end)
+/*  the threshold pass is cheap, so it can be repeated while the
+ *  threshold is changed interactively
+ */
+static void
+contiguous_threshold (GeglBuffer *src_buffer,
+                      GeglBuffer *dest_buffer,
+                      gboolean    antialias,
+                      gfloat      threshold)
 {
-  gfloat s[MAX_CHANNELS];
-  gfloat mask_row[width];
-  gfloat diff;
+  ContiguousThreshold data;
+
+  data.src_buffer  = src_buffer;
+  data.dest_buffer = dest_buffer;
+  data.antialias   = antialias;
+  data.threshold   = threshold;
+
+  gimp_parallel_distribute_area (gegl_buffer_get_extent (dest_buffer),
+                                 MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 contiguous_threshold_area,
+                                 &data);
+}
 
-  gegl_buffer_sample (src_buffer, initial_x, initial_y, NULL, s, format,
-                      GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
 
-  diff = pixel_difference (col, s, antialias, threshold,
-                           n_components, has_alpha, select_transparent,
-                           select_criterion);
+static void
+contiguous_levels_rows (gsize             offset,
+                        gsize             size,
+                        ContiguousLevels *levels)
+{
+  gfloat *src;
+  gsize   y;
 
-  /* check the starting pixel */
-  if (! diff)
-    return FALSE;
+  src = g_new (gfloat, levels->width * BAND_HEIGHT * levels->n_components);
 
-  mask_row[initial_x] = diff;
+  for (y = offset; y < offset + size; y += BAND_HEIGHT)
+    {
+      gint height = MIN (BAND_HEIGHT, offset + size - y);
+
+      gegl_buffer_get (levels->src_buffer,
+                       GEGL_RECTANGLE (0, y, levels->width, height),
+                       1.0, levels->format, src,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      pixel_distance_row (levels->col, src,
+                          levels->dist + y * levels->width,
+                          levels->width * height,
+                          levels->n_components,
+                          levels->has_alpha,
+                          levels->select_transparent,
+                          levels->select_criterion);
+    }
+
+  g_free (src);
+}
+
+static inline void
+contiguous_heap_push (GArray *heap,
+                      gfloat  key,
+                      gint    index)
+{
+  ContiguousHeapItem *items;
+  ContiguousHeapItem  item = { key, index };
+  gint                i;
+
+  g_array_set_size (heap, heap->len + 1);
+
+  items = (ContiguousHeapItem *) heap->data;
+
+  for (i = heap->len - 1; i > 0 && items[(i - 1) / 2].key > key; i = (i - 1) / 2)
+    items[i] = items[(i - 1) / 2];
+
+  items[i] = item;
+}
 
-  *start = initial_x - 1;
+static inline ContiguousHeapItem
+contiguous_heap_pop (GArray *heap)
+{
+  ContiguousHeapItem *items = (ContiguousHeapItem *) heap->data;
+  ContiguousHeapItem  top   = items[0];
+  ContiguousHeapItem  last  = items[heap->len - 1];
+  gint                n     = heap->len - 1;
+  gint                i     = 0;
 
-  while (*start >= 0 && diff)
+  while (2 * i + 1 < n)
     {
-      gegl_buffer_sample (src_buffer, *start, initial_y, NULL, s, format,
-                          GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+      gint child = 2 * i + 1;
+
+      if (child + 1 < n && items[child + 1].key < items[child].key)
+        child++;
+
+      if (items[child].key >= last.key)
+        break;
+
+      items[i] = items[child];
+      i = child;
+    }
+
+  items[i] = last;
+
+  g_array_set_size (heap, n);
+
+  return top;
+}
+
+/*  A minimax variant of Dijkstra's algorithm: pixels are taken from the
+ *  heap in order of their level, so the first time a pixel is reached
+ *  it is reached by its best path, and its level is final.
+ */
+static void
+contiguous_levels_flood (ContiguousLevels *levels,
+                         gint              x,
+                         gint              y)
+{
+  GArray *heap;
+  gsize   n_pixels = (gsize) levels->width * levels->height;
+  gsize   i;
+  gint    seed     = y * levels->width + x;
+
+  for (i = 0; i < n_pixels; i++)
+    levels->level[i] = G_MAXFLOAT;
+
+  if (levels->dist[seed] == G_MAXFLOAT)
+    return;
+
+  heap = g_array_new (FALSE, FALSE, sizeof (ContiguousHeapItem));
+
+  levels->level[seed] = levels->dist[seed];
+  contiguous_heap_push (heap, levels->level[seed], seed);
+
+  while (heap->len > 0)
+    {
+      ContiguousHeapItem item = contiguous_heap_pop (heap);
+      gint               px   = item.index % levels->width;
+      gint               py   = item.index / levels->width;
+      gint               neighbors[4];
+      gint               n    = 0;
+      gint               j;
+
+      if (px > 0)                  neighbors[n++] = item.index - 1;
+      if (px + 1 < levels->width)  neighbors[n++] = item.index + 1;
+      if (py > 0)                  neighbors[n++] = item.index - levels->width;
+      if (py + 1 < levels->height) neighbors[n++] = item.index + levels->width;
+
+      for (j = 0; j < n; j++)
+        {
+          gint q = neighbors[j];
+
+          if (levels->level[q] != G_MAXFLOAT ||
+              levels->dist[q]  == G_MAXFLOAT)
+            continue;
+
+          levels->level[q] = MAX (item.key, levels->dist[q]);
+          contiguous_heap_push (heap, levels->level[q], q);
+        }
+    }
+
+  g_array_free (heap, TRUE);
+}
+
+static void
+contiguous_levels_threshold_area (const GeglRectangle *area,
+                                  ContiguousThreshold *data)
+{
+  GeglBufferIterator *iter;
+  gfloat              threshold = data->threshold;
+
+  iter = gegl_buffer_iterator_new (data->src_buffer, area, 0,
+                                   babl_format ("YA float"),
+                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
 
-      diff = pixel_difference (col, s, antialias, threshold,
-                               n_components, has_alpha, select_transparent,
-                               select_criterion);
+  gegl_buffer_iterator_add (iter, data->dest_buffer,
+                            area, 0, babl_format ("Y float"),
+                            GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
 
-      mask_row[*start] = diff;
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const gfloat *src  = iter->data[0];
+      gfloat       *dest = iter->data[1];
+      gint          i;
 
-      if (diff)
-        (*start)--;
+      /*  the same tests as pixel_threshold_row(), the pixel is part of
+       *  the region if its level would pass them
+       */
+      if (data->antialias && threshold > 0.0)
+        {
+          for (i = 0; i < iter->length; i++)
+            {
+              gfloat level = 1.5 - (src[2 * i + 1] / threshold);
+              gfloat aa    = 1.5 - (src[2 * i]     / threshold);
+
+              if (level <= 0.0 || aa <= 0.0)
+                dest[i] = 0.0;
+              else if (aa < 0.5)
+                dest[i] = aa * 2.0;
+              else
+                dest[i] = 1.0;
+            }
+        }
+      else
+        {
+          for (i = 0; i < iter->length; i++)
+            dest[i] = (src[2 * i + 1] > threshold) ? 0.0 : 1.0;
+        }
     }
+}
 
-  diff = 1;
-  *end = initial_x + 1;
+static void
+contiguous_band_compute (gsize           offset,
+                         gsize           size,
+                         ContiguousBand *band)
+{
+  ContiguousRegion *region = band->region;
+  gfloat           *src;
+
+  src = g_new (gfloat, region->width * size * region->n_components);
+
+  gegl_buffer_get (region->src_buffer,
+                   GEGL_RECTANGLE (0, band->y + offset, region->width, size),
+                   1.0, region->format, src,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  pixel_difference_row (region->col, src,
+                        band->diff + offset * region->width,
+                        region->width * size,
+                        region->antialias,
+                        region->threshold,
+                        region->n_components,
+                        region->has_alpha,
+                        region->select_transparent,
+                        region->select_criterion);
+
+  g_free (src);
+}
 
-  while (*end < width && diff)
+/*  Returns row @y of the pixel differences, computing the differences
+ *  of its whole band in parallel when the row is first needed.
+ */
+static gfloat *
+contiguous_region_get_row (ContiguousRegion *region,
+                           gint              y)
+{
+  gint i = y / BAND_HEIGHT;
+
+  if (! region->bands[i])
     {
-      gegl_buffer_sample (src_buffer, *end, initial_y, NULL, s, format,
-                          GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+      ContiguousBand band;
+      gint           height;
+
+      band.region = region;
+      band.y      = i * BAND_HEIGHT;
+      band.diff   = g_new (gfloat, region->width * BAND_HEIGHT);
 
-      diff = pixel_difference (col, s, antialias, threshold,
-                               n_components, has_alpha, select_transparent,
-                               select_criterion);
+      height = MIN (BAND_HEIGHT, region->height - band.y);
 
-      mask_row[*end] = diff;
+      gimp_parallel_distribute_range (height,
+                                      MAX (MIN_PARALLEL_SUB_AREA /
+                                           region->width, 1),
+                                      (GimpParallelDistributeRangeFunc)
+                                      contiguous_band_compute,
+                                      &band);
 
-      if (diff)
-        (*end)++;
+      region->bands[i] = band.diff;
+      region->n_bands_done++;
+
+      if (region->progress)
+        gimp_progress_set_value (region->progress,
+                                 (gdouble) region->n_bands_done /
+                                 (gdouble) region->n_bands);
     }
 
-  gegl_buffer_set (mask_buffer, GEGL_RECTANGLE (*start, initial_y,
-                                                *end - *start, 1),
-                   0, babl_format ("Y float"), &mask_row[*start],
-                   GEGL_AUTO_ROWSTRIDE);
+  return region->bands[i] + (y - i * BAND_HEIGHT) * region->width;
+}
 
-  return TRUE;
+static void
+contiguous_region_cancel (GimpProgress     *progress,
+                          ContiguousRegion *region)
+{
+  region->cancelled = TRUE;
 }
 
+/*  A scanline flood fill: every span popped from the stack is scanned
+ *  for pixels that are part of the region and not reached yet; each run
+ *  of such pixels is marked and its rows above and below are pushed.
+ */
 static void
-find_contiguous_region_helper (GeglBuffer          *src_buffer,
-                               GeglBuffer          *mask_buffer,
-                               const Babl          *format,
-                               gint                 n_components,
-                               gboolean             has_alpha,
-                               gboolean             select_transparent,
-                               GimpSelectCriterion  select_criterion,
-                               gboolean             antialias,
-                               gfloat               threshold,
-                               gint                 x,
-                               gint                 y,
-                               const gfloat        *col)
+find_contiguous_region (ContiguousRegion *region,
+                        gint              x,
+                        gint              y)
 {
-  gint    start, end;
-  gint    new_start, new_end;
-  GQueue *coord_stack;
+  GArray         *stack;
+  ContiguousSpan  span = { y, x, x };
 
-  coord_stack = g_queue_new ();
+  stack = g_array_new (FALSE, FALSE, sizeof (ContiguousSpan));
 
-  /* To avoid excessive memory allocation (y, start, end) tuples are
-   * stored in interleaved format:
-   *
-   * [y1] [start1] [end1] [y2] [start2] [end2]
-   */
-  g_queue_push_tail (coord_stack, GINT_TO_POINTER (y));
-  g_queue_push_tail (coord_stack, GINT_TO_POINTER (x - 1));
-  g_queue_push_tail (coord_stack, GINT_TO_POINTER (x + 1));
+  g_array_append_val (stack, span);
 
-  do
+  while (stack->len > 0 && ! region->cancelled)
     {
-      y     = GPOINTER_TO_INT (g_queue_pop_head (coord_stack));
-      start = GPOINTER_TO_INT (g_queue_pop_head (coord_stack));
-      end   = GPOINTER_TO_INT (g_queue_pop_head (coord_stack));
+      gfloat *row;
+
+      span = g_array_index (stack, ContiguousSpan, stack->len - 1);
+      g_array_set_size (stack, stack->len - 1);
+
+      row = contiguous_region_get_row (region, span.y);
 
-      for (x = start + 1; x < end; x++)
+      for (x = span.x1; x <= span.x2; x++)
         {
-          gfloat val;
+          ContiguousSpan new_span;
+          gint           start;
+          gint           end;
+          gint           i;
 
-          gegl_buffer_sample (mask_buffer, x, y, NULL, &val,
-                              babl_format ("Y float"),
-                              GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
-          if (val != 0.0)
+          if (row[x] <= 0.0)
             continue;
 
-          if (! find_contiguous_segment (col, src_buffer, mask_buffer,
-                                         format,
-                                         n_components,
-                                         has_alpha,
-                                         gegl_buffer_get_width (src_buffer),
-                                         select_transparent, select_criterion,
-                                         antialias, threshold, x, y,
-                                         &new_start, &new_end))
-            continue;
+          start = x;
+          end   = x;
+
+          while (start > 0 && row[start - 1] > 0.0)
+            start--;
 
-          if (y + 1 < gegl_buffer_get_height (src_buffer))
+          while (end + 1 < region->width && row[end + 1] > 0.0)
+            end++;
+
+          for (i = start; i <= end; i++)
+            row[i] = -row[i];
+
+          new_span.x1 = start;
+          new_span.x2 = end;
+
+          if (span.y > 0)
             {
-              g_queue_push_tail (coord_stack, GINT_TO_POINTER (y + 1));
-              g_queue_push_tail (coord_stack, GINT_TO_POINTER (new_start));
-              g_queue_push_tail (coord_stack, GINT_TO_POINTER (new_end));
+              new_span.y = span.y - 1;
+              g_array_append_val (stack, new_span);
             }
 
-          if (y - 1 >= 0)
+          if (span.y + 1 < region->height)
             {
-              g_queue_push_tail (coord_stack, GINT_TO_POINTER (y - 1));
-              g_queue_push_tail (coord_stack, GINT_TO_POINTER (new_start));
-              g_queue_push_tail (coord_stack, GINT_TO_POINTER (new_end));
+              new_span.y = span.y + 1;
+              g_array_append_val (stack, new_span);
             }
+
+          x = end;
         }
     }
-  while (! g_queue_is_empty (coord_stack));
 
-  g_queue_free (coord_stack);
+  g_array_free (stack, TRUE);
 }
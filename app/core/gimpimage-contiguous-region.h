@@ -19,24 +19,54 @@
 #define __GIMP_IMAGE_CONTIGUOUS_REGION_H__
 
 
-GeglBuffer * gimp_image_contiguous_region_by_seed  (GimpImage           *image,
-                                                    GimpDrawable        *drawable,
-                                                    gboolean             sample_merged,
-                                                    gboolean             antialias,
-                                                    gfloat               threshold,
-                                                    gboolean             select_transparent,
-                                                    GimpSelectCriterion  select_criterion,
-                                                    gint                 x,
-                                                    gint                 y);
+GeglBuffer * gimp_image_contiguous_region_by_seed               (GimpImage           *image,
+                                                                 GimpDrawable        *drawable,
+                                                                 gboolean             sample_merged,
+                                                                 gboolean             antialias,
+                                                                 gfloat               threshold,
+                                                                 gboolean             select_transparent,
+                                                                 GimpSelectCriterion  select_criterion,
+                                                                 gint                 x,
+                                                                 gint                 y);
+GeglBuffer * gimp_image_contiguous_region_by_seed_with_progress (GimpImage           *image,
+                                                                 GimpDrawable        *drawable,
+                                                                 gboolean             sample_merged,
+                                                                 gboolean             antialias,
+                                                                 gfloat               threshold,
+                                                                 gboolean             select_transparent,
+                                                                 GimpSelectCriterion  select_criterion,
+                                                                 gint                 x,
+                                                                 gint                 y,
+                                                                 GimpProgress        *progress);
+GeglBuffer * gimp_image_contiguous_region_levels_by_seed        (GimpImage           *image,
+                                                                 GimpDrawable        *drawable,
+                                                                 gboolean             sample_merged,
+                                                                 gboolean             select_transparent,
+                                                                 GimpSelectCriterion  select_criterion,
+                                                                 gint                 x,
+                                                                 gint                 y);
+GeglBuffer * gimp_image_contiguous_region_by_levels             (GeglBuffer          *levels_buffer,
+                                                                 gboolean             antialias,
+                                                                 gfloat               threshold);
 
-GeglBuffer * gimp_image_contiguous_region_by_color (GimpImage           *image,
-                                                    GimpDrawable        *drawable,
-                                                    gboolean             sample_merged,
-                                                    gboolean             antialias,
-                                                    gfloat               threshold,
-                                                    gboolean             select_transparent,
-                                                    GimpSelectCriterion  select_criterion,
-                                                    const GimpRGB       *color);
+GeglBuffer * gimp_image_contiguous_region_by_color              (GimpImage           *image,
+                                                                 GimpDrawable        *drawable,
+                                                                 gboolean             sample_merged,
+                                                                 gboolean             antialias,
+                                                                 gfloat               threshold,
+                                                                 gboolean             select_transparent,
+                                                                 GimpSelectCriterion  select_criterion,
+                                                                 const GimpRGB       *color);
+
+GeglBuffer * gimp_image_contiguous_region_distance_by_color     (GimpImage           *image,
+                                                                 GimpDrawable        *drawable,
+                                                                 gboolean             sample_merged,
+                                                                 gboolean             select_transparent,
+                                                                 GimpSelectCriterion  select_criterion,
+                                                                 const GimpRGB       *color);
+GeglBuffer * gimp_image_contiguous_region_by_distance           (GeglBuffer          *distance_buffer,
+                                                                 gboolean             antialias,
+                                                                 gfloat               threshold);
 
 
 #endif  /*  __GIMP_IMAGE_CONTIGUOUS_REGION_H__ */
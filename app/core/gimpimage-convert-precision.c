@@ -24,6 +24,7 @@
 
 #include "core-types.h"
 
+#include "gegl/gimp-gegl-loops.h"
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimpdrawable.h"
@@ -147,8 +148,8 @@ gimp_image_convert_precision (GimpImage     *image,
                                               gimp_image_get_height (image)),
                               gimp_image_get_mask_format (image));
 
-    gegl_buffer_copy (gimp_drawable_get_buffer (GIMP_DRAWABLE (mask)), NULL,
-                      buffer, NULL);
+    gimp_gegl_copy (gimp_drawable_get_buffer (GIMP_DRAWABLE (mask)), NULL,
+                    buffer, NULL);
 
     gimp_drawable_set_buffer (GIMP_DRAWABLE (mask), FALSE, NULL, buffer);
     g_object_unref (buffer);
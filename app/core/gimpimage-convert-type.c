@@ -144,6 +144,7 @@
 #include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimpcontainer.h"
 #include "gimpdrawable.h"
 #include "gimperror.h"
@@ -187,6 +188,8 @@
 #define G_SCALE 24              /*  scale G (a*) distances by this much  */
 #define B_SCALE 26              /*  and B (b*) by this much              */
 
+#define MIN_PARALLEL_SUB_AREA (128 * 128)
+
 
 typedef struct _Color Color;
 typedef struct _QuantizeObj QuantizeObj;
@@ -468,10 +471,15 @@ struct _QuantizeObj
   Color clin[256];                  /* .. converted back to linear space */
   gulong index_used_count[256];     /* how many times an index was used */
   CFHistogram histogram;            /* holds the histogram               */
+  gboolean inverse_cmap;            /* histogram is the inverse colormap */
 
   gboolean want_alpha_dither;
   int      error_freedom;           /* 0=much bleed, 1=controlled bleed */
 
+  GMutex        mutex;              /* guards the inverse colormap cache
+                                       and index_used_count while the
+                                       second pass runs in threads      */
+
   GimpProgress *progress;
   gint          nth_layer;
   gint          n_layers;
@@ -502,19 +510,58 @@ typedef struct
 
 } box, *boxptr;
 
+/*  the colors found by one band of generate_histogram_rgb(), as long
+ *  as there are no more than the color limit
+ */
+typedef struct
+{
+  guchar   cols[MAXNUMCOLORS][3];
+  gint     n_cols;
+  gboolean overflow;
+} HistogramColors;
+
+typedef struct
+{
+  CFHistogram     *histograms;  /* one per band, histograms[0] is shared  */
+  GeglBuffer      *buffer;
+  const Babl      *format;
+  GeglRectangle    extent;
+  gint             offsetx;
+  gint             offsety;
+  gint             bpp;
+  gboolean         has_alpha;
+  gint             col_limit;
+  gboolean         alpha_dither;
+  HistogramColors *colors;      /* NULL once needs_quantize is set       */
+} HistogramData;
+
+typedef void (* Pass2Area_Func) (QuantizeObj         *quantobj,
+                                 GimpLayer           *layer,
+                                 GeglBuffer          *new_buffer,
+                                 const GeglRectangle *area,
+                                 gulong              *index_used_count);
+
+typedef struct
+{
+  QuantizeObj    *quantobj;
+  GimpLayer      *layer;
+  GeglBuffer     *new_buffer;
+  Pass2Area_Func  func;
+} Pass2Data;
+
 
 static void zero_histogram_gray     (CFHistogram   histogram);
 static void zero_histogram_rgb      (CFHistogram   histogram);
 static void generate_histogram_gray (CFHistogram   hostogram,
                                      GimpLayer    *layer,
                                      gboolean      alpha_dither);
-static void generate_histogram_rgb  (CFHistogram   histogram,
+static void generate_histogram_rgb  (CFHistogram  *histograms,
+                                     gint          n_histograms,
                                      GimpLayer    *layer,
                                      gint          col_limit,
-                                     gboolean      alpha_dither,
-                                     GimpProgress *progress,
-                                     gint          nth_layer,
-                                     gint          n_layers);
+                                     gboolean      alpha_dither);
+static void merge_histograms_rgb    (CFHistogram  *histograms,
+                                     gint          n_histograms);
 
 static QuantizeObj * initialize_median_cut (GimpImageBaseType      old_type,
                                             gint                   num_cols,
@@ -533,6 +580,17 @@ static guchar    found_cols[MAXNUMCOLORS][3];
 static gint      num_found_cols;
 static gboolean  needs_quantize;
 
+/*  The inverse colormap of the last conversion to a palette, reused
+ *  when the next conversion maps to the very same colors, like when a
+ *  batch of images is converted to one custom or web palette.
+ */
+static struct
+{
+  Color       cmap[256];
+  gint        n_colors;
+  CFHistogram histogram;
+} inverse_cmap_cache;
+
 static GimpPalette *theCustomPalette = NULL;
 
 
@@ -752,7 +810,9 @@ gimp_image_convert_type (GimpImage               *image,
   GimpImageBaseType  old_type;
   GList             *all_layers;
   GList             *list;
-  const gchar       *undo_desc = NULL;
+  const gchar       *undo_desc    = NULL;
+  CFHistogram       *histograms   = NULL;
+  gint               n_histograms = 1;
   gint               nth_layer, n_layers;
 
   g_return_val_if_fail (GIMP_IS_IMAGE (image), FALSE);
@@ -855,6 +915,17 @@ gimp_image_convert_type (GimpImage               *image,
           needs_quantize = FALSE;
           num_found_cols = 0;
 
+          /*  The RGB histogram is built in parallel, every thread
+           *  counts into its own histogram, they are all added up
+           *  after the last layer.
+           */
+          if (old_type != GIMP_GRAY)
+            {
+              n_histograms  = gimp_parallel_get_n_threads ();
+              histograms    = g_new0 (CFHistogram, n_histograms);
+              histograms[0] = quantobj->histogram;
+            }
+
           /*  Build the histogram  */
           for (list = all_layers, nth_layer = 0;
                list;
@@ -866,14 +937,25 @@ gimp_image_convert_type (GimpImage               *image,
                 generate_histogram_gray (quantobj->histogram,
                                          layer, alpha_dither);
               else
-                generate_histogram_rgb (quantobj->histogram,
-                                        layer, num_cols, alpha_dither,
-                                        progress, nth_layer, n_layers);
+                generate_histogram_rgb (histograms, n_histograms,
+                                        layer, num_cols, alpha_dither);
 
               /* Note: generate_histogram_rgb may set needs_quantize if
                *  the image contains more colors than the limit specified
                *  by the user.
                */
+
+              if (progress)
+                gimp_progress_set_value (progress,
+                                         (gdouble) (nth_layer + 1) /
+                                         (gdouble) n_layers);
+            }
+
+          if (histograms)
+            {
+              merge_histograms_rgb (histograms, n_histograms);
+
+              g_free (histograms);
             }
         }
 
@@ -1178,208 +1260,287 @@ generate_histogram_gray (CFHistogram  histogram,
 
 
 static void
-generate_histogram_rgb (CFHistogram   histogram,
-                        GimpLayer    *layer,
-                        gint          col_limit,
-                        gboolean      alpha_dither,
-                        GimpProgress *progress,
-                        gint          nth_layer,
-                        gint          n_layers)
+generate_histogram_rgb_band (gint           i,
+                             gint           n,
+                             HistogramData *data)
 {
   GeglBufferIterator *iter;
-  const Babl         *format;
   GeglRectangle      *roi;
-  ColorFreq          *colfreq;
-  gint                nfc_iter;
-  gint                row, col, coledge;
-  gint                offsetx, offsety;
-  glong               layer_size;
-  glong               total_size = 0;
-  gint                count      = 0;
-  gint                bpp;
-  gboolean            has_alpha;
-
-  format = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
-
-  g_return_if_fail (format == babl_format ("R'G'B' u8") ||
-                    format == babl_format ("R'G'B'A u8"));
-
-  bpp       = babl_format_get_bytes_per_pixel (format);
-  has_alpha = babl_format_has_alpha (format);
-
-  gimp_item_get_offset (GIMP_ITEM (layer), &offsetx, &offsety);
-
-  layer_size = (gimp_item_get_width  (GIMP_ITEM (layer)) *
-                gimp_item_get_height (GIMP_ITEM (layer)));
-
-  /*  g_printerr ("col_limit = %d, nfc = %d\n", col_limit, num_found_cols); */
-
-  iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, format,
+  GeglRectangle       band;
+  CFHistogram         histogram = data->histograms[i];
+  HistogramColors    *colors    = NULL;
+  gint                bpp       = data->bpp;
+  gboolean            has_alpha = data->has_alpha;
+
+  if (data->colors)
+    colors = &data->colors[i];
+
+  band.x      = data->extent.x;
+  band.width  = data->extent.width;
+  band.y      = data->extent.y + (gint64) data->extent.height * i / n;
+  band.height = data->extent.y + (gint64) data->extent.height * (i + 1) / n -
+                band.y;
+
+  iter = gegl_buffer_iterator_new (data->buffer, &band, 0, data->format,
                                    GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
   roi = &iter->roi[0];
 
-  if (progress)
-    gimp_progress_set_value (progress, 0.0);
-
   while (gegl_buffer_iterator_next (iter))
     {
-      const guchar *data = iter->data[0];
-
-      total_size += iter->length;
+      const guchar *src    = iter->data[0];
+      gint          length = iter->length;
+      gint          col, row, coledge;
 
-      /* g_printerr (" [%d,%d - %d,%d]", srcPR.x, src_roi->y, offsetx, offsety); */
+      /* if alpha-dithering, we need to be deterministic w.r.t. offsets */
+      col = roi->x + data->offsetx;
+      coledge = col + roi->width;
+      row = roi->y + data->offsety;
 
-      if (needs_quantize)
+      while (length--)
         {
-          if (alpha_dither)
-            {
-              /* if alpha-dithering,
-                 we need to be deterministic w.r.t. offsets */
-
-              col = roi->x + offsetx;
-              coledge = col + roi->width;
-              row = roi->y + offsety;
+          gboolean transparent = FALSE;
 
-              while (iter->length--)
+          if (has_alpha)
+            {
+              if (data->alpha_dither)
                 {
-                  gboolean transparent = FALSE;
-
-                  if (has_alpha &&
-                      data[ALPHA] <
+                  if (src[ALPHA] <
                       DM[col & DM_WIDTHMASK][row & DM_HEIGHTMASK])
                     transparent = TRUE;
+                }
+              else
+                {
+                  if (src[ALPHA] <= 127)
+                    transparent = TRUE;
+                }
+            }
+
+          if (! transparent)
+            {
+              ColorFreq *colfreq;
 
-                  if (! transparent)
+              colfreq = HIST_RGB (histogram,
+                                  src[RED],
+                                  src[GREEN],
+                                  src[BLUE]);
+              (*colfreq)++;
+
+              if (colors && ! colors->overflow)
+                {
+                  gint nfc_iter;
+
+                  for (nfc_iter = 0;
+                       nfc_iter < colors->n_cols;
+                       nfc_iter++)
                     {
-                      colfreq = HIST_RGB (histogram,
-                                          data[RED],
-                                          data[GREEN],
-                                          data[BLUE]);
-                      (*colfreq)++;
+                      if ((src[RED]   == colors->cols[nfc_iter][0]) &&
+                          (src[GREEN] == colors->cols[nfc_iter][1]) &&
+                          (src[BLUE]  == colors->cols[nfc_iter][2]))
+                        goto already_found;
                     }
 
-                  col++;
-                  if (col == coledge)
+                  /* Color was not in the table of existing colors
+                   */
+                  if (colors->n_cols == data->col_limit)
                     {
-                      col = roi->x + offsetx;
-                      row++;
+                      /* This band alone has more colors than
+                       *  are allowed, stop looking.
+                       */
+                      colors->overflow = TRUE;
                     }
-
-                  data += bpp;
-                }
-            }
-          else
-            {
-              while (iter->length--)
-                {
-                  if ((has_alpha && ((data[ALPHA] > 127)))
-                      || (!has_alpha))
+                  else
                     {
-                      colfreq = HIST_RGB (histogram,
-                                          data[RED],
-                                          data[GREEN],
-                                          data[BLUE]);
-                      (*colfreq)++;
+                      colors->cols[colors->n_cols][0] = src[RED];
+                      colors->cols[colors->n_cols][1] = src[GREEN];
+                      colors->cols[colors->n_cols][2] = src[BLUE];
+                      colors->n_cols++;
                     }
-
-                  data += bpp;
                 }
             }
+        already_found:
+
+          col++;
+          if (col == coledge)
+            {
+              col = roi->x + data->offsetx;
+              row++;
+            }
+
+          src += bpp;
         }
-      else
+    }
+}
+
+static void
+generate_histogram_rgb (CFHistogram *histograms,
+                        gint         n_histograms,
+                        GimpLayer   *layer,
+                        gint         col_limit,
+                        gboolean     alpha_dither)
+{
+  HistogramData data;
+  glong         layer_size;
+  gint          n_bands;
+  gint          i;
+
+  data.format = gimp_drawable_get_format (GIMP_DRAWABLE (layer));
+
+  g_return_if_fail (data.format == babl_format ("R'G'B' u8") ||
+                    data.format == babl_format ("R'G'B'A u8"));
+
+  data.histograms   = histograms;
+  data.buffer       = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  data.extent       = *gegl_buffer_get_extent (data.buffer);
+  data.bpp          = babl_format_get_bytes_per_pixel (data.format);
+  data.has_alpha    = babl_format_has_alpha (data.format);
+  data.col_limit    = col_limit;
+  data.alpha_dither = alpha_dither;
+  data.colors       = NULL;
+
+  gimp_item_get_offset (GIMP_ITEM (layer), &data.offsetx, &data.offsety);
+
+  layer_size = (glong) data.extent.width * data.extent.height;
+
+  n_bands = CLAMP (layer_size / MIN_PARALLEL_SUB_AREA, 1, n_histograms);
+  n_bands = MIN (n_bands, MAX (data.extent.height, 1));
+
+  for (i = 1; i < n_bands; i++)
+    {
+      if (! histograms[i])
+        histograms[i] = g_new0 (ColorFreq,
+                                HIST_R_ELEMS * HIST_G_ELEMS * HIST_B_ELEMS);
+    }
+
+  /*  while the colors still fit, every band collects its own, they
+   *  are merged into found_cols in band order afterwards
+   */
+  if (! needs_quantize)
+    {
+      data.colors = g_new (HistogramColors, n_bands);
+
+      for (i = 0; i < n_bands; i++)
         {
-          /* if alpha-dithering, we need to be deterministic w.r.t. offsets */
-          col = roi->x + offsetx;
-          coledge = col + roi->width;
-          row = roi->y + offsety;
+          data.colors[i].n_cols   = 0;
+          data.colors[i].overflow = FALSE;
+        }
+    }
 
-          while (iter->length--)
-            {
-	      gboolean transparent = FALSE;
-
-	      if (has_alpha)
-	        {
-		  if (alpha_dither)
-		    {
-		      if (data[ALPHA] <
-                          DM[col & DM_WIDTHMASK][row & DM_HEIGHTMASK])
-		  	transparent = TRUE;
-		    }
-		  else
-		    {
-		      if (data[ALPHA] <= 127)
-			transparent = TRUE;
-		    }
-		}
-
-	      if (! transparent)
-                {
-                  colfreq = HIST_RGB (histogram,
-                                      data[RED],
-                                      data[GREEN],
-                                      data[BLUE]);
-                  (*colfreq)++;
+  gimp_parallel_distribute (n_bands,
+                            (GimpParallelDistributeFunc)
+                            generate_histogram_rgb_band,
+                            &data);
 
-                  if (!needs_quantize)
-                    {
-                      for (nfc_iter = 0;
-                           nfc_iter < num_found_cols;
-                           nfc_iter++)
-                        {
-                          if ((data[RED]   == found_cols[nfc_iter][0]) &&
-                              (data[GREEN] == found_cols[nfc_iter][1]) &&
-                              (data[BLUE]  == found_cols[nfc_iter][2]))
-                            goto already_found;
-                        }
+  if (data.colors)
+    {
+      /*  gimp_parallel_distribute() may have used fewer bands, the
+       *  unused ones stay empty
+       */
+      for (i = 0; i < n_bands && ! needs_quantize; i++)
+        {
+          HistogramColors *colors = &data.colors[i];
+          gint             j;
 
-                      /* Color was not in the table of
-                       * existing colors
-                       */
+          if (colors->overflow)
+            {
+              needs_quantize = TRUE;
+              break;
+            }
 
-                      num_found_cols++;
+          for (j = 0; j < colors->n_cols; j++)
+            {
+              gint nfc_iter;
 
-                      if (num_found_cols > col_limit)
-                        {
-                          /* There are more colors in the image
-                           *  than were allowed.  We switch to plain
-                           *  histogram calculation with a view to
-                           *  quantizing at a later stage.
-                           */
-                          needs_quantize = TRUE;
-                          /* g_print ("\nmax colors exceeded - needs quantize.\n");*/
-                          goto already_found;
-                        }
-                      else
-                        {
-                          /* Remember the new color we just found.
-                           */
-                          found_cols[num_found_cols-1][0] = data[RED];
-                          found_cols[num_found_cols-1][1] = data[GREEN];
-                          found_cols[num_found_cols-1][2] = data[BLUE];
-                        }
-                    }
+              for (nfc_iter = 0; nfc_iter < num_found_cols; nfc_iter++)
+                {
+                  if ((colors->cols[j][0] == found_cols[nfc_iter][0]) &&
+                      (colors->cols[j][1] == found_cols[nfc_iter][1]) &&
+                      (colors->cols[j][2] == found_cols[nfc_iter][2]))
+                    break;
                 }
-            already_found:
 
-              col++;
-              if (col == coledge)
+              if (nfc_iter < num_found_cols)
+                continue;
+
+              if (num_found_cols == col_limit)
                 {
-                  col = roi->x + offsetx;
-                  row++;
+                  /* There are more colors in the image
+                   *  than were allowed.  We switch to plain
+                   *  histogram calculation with a view to
+                   *  quantizing at a later stage.
+                   */
+                  needs_quantize = TRUE;
+                  break;
                 }
 
-              data += bpp;
+              /* Remember the new color we just found.
+               */
+              found_cols[num_found_cols][0] = colors->cols[j][0];
+              found_cols[num_found_cols][1] = colors->cols[j][1];
+              found_cols[num_found_cols][2] = colors->cols[j][2];
+              num_found_cols++;
             }
         }
 
-      if (progress && (count % 16 == 0))
-        gimp_progress_set_value (progress,
-                                 (nth_layer + ((gdouble) total_size)/
-                                  layer_size) / (gdouble) n_layers);
+      g_free (data.colors);
     }
+}
+
+static void
+merge_histograms_rgb_range (gsize        offset,
+                            gsize        size,
+                            CFHistogram *histograms)
+{
+  CFHistogram histogram = histograms[0] + offset;
+  gint        i;
+
+  for (i = 1; histograms[i]; i++)
+    {
+      const ColorFreq *part = histograms[i] + offset;
+      gsize            j;
 
-/*  g_print ("O: col_limit = %d, nfc = %d\n", col_limit, num_found_cols);*/
+      for (j = 0; j < size; j++)
+        histogram[j] += part[j];
+    }
+}
+
+/*  adds the per-thread histograms into histograms[0] and frees them
+ */
+static void
+merge_histograms_rgb (CFHistogram *histograms,
+                      gint         n_histograms)
+{
+  CFHistogram *parts;
+  gint         n_parts;
+  gint         i;
+
+  for (n_parts = 1; n_parts < n_histograms; n_parts++)
+    {
+      if (! histograms[n_parts])
+        break;
+    }
+
+  if (n_parts == 1)
+    return;
+
+  /*  NULL-terminated copy, the bands are allocated in order  */
+  parts = g_new0 (CFHistogram, n_parts + 1);
+
+  for (i = 0; i < n_parts; i++)
+    parts[i] = histograms[i];
+
+  gimp_parallel_distribute_range (HIST_R_ELEMS * HIST_G_ELEMS * HIST_B_ELEMS,
+                                  HIST_G_ELEMS * HIST_B_ELEMS,
+                                  (GimpParallelDistributeRangeFunc)
+                                  merge_histograms_rgb_range,
+                                  parts);
+
+  for (i = 1; i < n_parts; i++)
+    {
+      g_free (histograms[i]);
+      histograms[i] = NULL;
+    }
+
+  g_free (parts);
 }
 
 
@@ -2820,14 +2981,95 @@ custompal_pass1 (QuantizeObj *quantobj)
   quantobj -> actual_number_of_colors = i;
 }
 
+/*  The second pass functions that don't diffuse errors convert the
+ *  tiles of a layer in parallel.  They share the inverse colormap
+ *  cache, its update boxes are only filled with the mutex held.
+ */
+
+static void
+fill_inverse_cmap_gray_locked (QuantizeObj *quantobj,
+                               CFHistogram  histogram,
+                               int          pixel)
+{
+  g_mutex_lock (&quantobj->mutex);
+
+  /*  another thread may have filled the cell in the meantime  */
+  if (histogram[pixel] == 0)
+    fill_inverse_cmap_gray (quantobj, histogram, pixel);
+
+  g_mutex_unlock (&quantobj->mutex);
+}
+
+static void
+fill_inverse_cmap_rgb_locked (QuantizeObj *quantobj,
+                              CFHistogram  histogram,
+                              int          R,
+                              int          G,
+                              int          B)
+{
+  g_mutex_lock (&quantobj->mutex);
+
+  /*  another thread may have filled the update box in the meantime  */
+  if (*HIST_LIN (histogram, R, G, B) == 0)
+    fill_inverse_cmap_rgb (quantobj, histogram, R, G, B);
+
+  g_mutex_unlock (&quantobj->mutex);
+}
+
+static void
+median_cut_pass2_parallel_area (const GeglRectangle *area,
+                                Pass2Data           *data)
+{
+  QuantizeObj *quantobj = data->quantobj;
+  gulong       index_used_count[256] = { 0, };
+  gint         i;
+
+  data->func (quantobj, data->layer, data->new_buffer,
+              area, index_used_count);
+
+  g_mutex_lock (&quantobj->mutex);
+
+  for (i = 0; i < 256; i++)
+    quantobj->index_used_count[i] += index_used_count[i];
+
+  g_mutex_unlock (&quantobj->mutex);
+}
+
+static void
+median_cut_pass2_parallel (QuantizeObj    *quantobj,
+                           GimpLayer      *layer,
+                           GeglBuffer     *new_buffer,
+                           Pass2Area_Func  func)
+{
+  Pass2Data data;
+
+  data.quantobj   = quantobj;
+  data.layer      = layer;
+  data.new_buffer = new_buffer;
+  data.func       = func;
+
+  gimp_parallel_distribute_area (gegl_buffer_get_extent (new_buffer),
+                                 MIN_PARALLEL_SUB_AREA,
+                                 (GimpParallelDistributeAreaFunc)
+                                 median_cut_pass2_parallel_area,
+                                 &data);
+
+  if (quantobj->progress)
+    gimp_progress_set_value (quantobj->progress,
+                             (gdouble) (quantobj->nth_layer + 1) /
+                             (gdouble) quantobj->n_layers);
+}
+
 /*
  * Map some rows of pixels to the output colormapped representation.
  */
 
 static void
-median_cut_pass2_no_dither_gray (QuantizeObj *quantobj,
-                                 GimpLayer   *layer,
-                                 GeglBuffer  *new_buffer)
+median_cut_pass2_no_dither_gray_area (QuantizeObj         *quantobj,
+                                      GimpLayer           *layer,
+                                      GeglBuffer          *new_buffer,
+                                      const GeglRectangle *area,
+                                      gulong              *index_used_count)
 {
   GeglBufferIterator *iter;
   CFHistogram         histogram = quantobj->histogram;
@@ -2838,7 +3080,6 @@ median_cut_pass2_no_dither_gray (QuantizeObj *quantobj,
   gint                src_bpp;
   gint                dest_bpp;
   gint                has_alpha;
-  gulong             *index_used_count = quantobj->index_used_count;
   gboolean            alpha_dither     = quantobj->want_alpha_dither;
   gint                offsetx, offsety;
 
@@ -2853,12 +3094,12 @@ median_cut_pass2_no_dither_gray (QuantizeObj *quantobj,
   has_alpha = babl_format_has_alpha (src_format);
 
   iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, NULL,
+                                   area, 0, NULL,
                                    GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
   src_roi = &iter->roi[0];
 
   gegl_buffer_iterator_add (iter, new_buffer,
-                            NULL, 0, NULL,
+                            area, 0, NULL,
                             GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (iter))
@@ -2881,7 +3122,7 @@ median_cut_pass2_no_dither_gray (QuantizeObj *quantobj,
               /* If we have not seen this color before, find nearest colormap entry */
               /* and update the cache */
               if (*cachep == 0)
-                fill_inverse_cmap_gray (quantobj, histogram, pixel);
+                fill_inverse_cmap_gray_locked (quantobj, histogram, pixel);
 
               if (has_alpha)
                 {
@@ -2925,9 +3166,20 @@ median_cut_pass2_no_dither_gray (QuantizeObj *quantobj,
 }
 
 static void
-median_cut_pass2_fixed_dither_gray (QuantizeObj *quantobj,
-                                    GimpLayer   *layer,
-                                    GeglBuffer  *new_buffer)
+median_cut_pass2_no_dither_gray (QuantizeObj *quantobj,
+                                 GimpLayer   *layer,
+                                 GeglBuffer  *new_buffer)
+{
+  median_cut_pass2_parallel (quantobj, layer, new_buffer,
+                             median_cut_pass2_no_dither_gray_area);
+}
+
+static void
+median_cut_pass2_fixed_dither_gray_area (QuantizeObj         *quantobj,
+                                         GimpLayer           *layer,
+                                         GeglBuffer          *new_buffer,
+                                         const GeglRectangle *area,
+                                         gulong              *index_used_count)
 {
   GeglBufferIterator *iter;
   CFHistogram         histogram = quantobj->histogram;
@@ -2944,7 +3196,6 @@ median_cut_pass2_fixed_dither_gray (QuantizeObj *quantobj,
   gint                err2;
   Color              *color1;
   Color              *color2;
-  gulong             *index_used_count = quantobj->index_used_count;
   gboolean            alpha_dither     = quantobj->want_alpha_dither;
   gint                offsetx, offsety;
 
@@ -2959,12 +3210,12 @@ median_cut_pass2_fixed_dither_gray (QuantizeObj *quantobj,
   has_alpha = babl_format_has_alpha (src_format);
 
   iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, NULL,
+                                   area, 0, NULL,
                                    GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
   src_roi = &iter->roi[0];
 
   gegl_buffer_iterator_add (iter, new_buffer,
-                            NULL, 0, NULL,
+                            area, 0, NULL,
                             GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (iter))
@@ -2990,7 +3241,7 @@ median_cut_pass2_fixed_dither_gray (QuantizeObj *quantobj,
               /* If we have not seen this color before, find nearest colormap entry */
               /* and update the cache */
               if (*cachep == 0)
-                fill_inverse_cmap_gray (quantobj, histogram, pixel);
+                fill_inverse_cmap_gray_locked (quantobj, histogram, pixel);
 
               pixval1 = *cachep - 1;
               color1 = &quantobj->cmap[pixval1];
@@ -3008,7 +3259,7 @@ median_cut_pass2_fixed_dither_gray (QuantizeObj *quantobj,
                          colormap entry and update the cache */
                       if (*cachep == 0)
                         {
-                          fill_inverse_cmap_gray (quantobj, histogram, R);
+                          fill_inverse_cmap_gray_locked (quantobj, histogram, R);
                         }
                       pixval2 = *cachep - 1;
                       RV += re;
@@ -3089,9 +3340,20 @@ median_cut_pass2_fixed_dither_gray (QuantizeObj *quantobj,
 }
 
 static void
-median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
-                                GimpLayer   *layer,
-                                GeglBuffer  *new_buffer)
+median_cut_pass2_fixed_dither_gray (QuantizeObj *quantobj,
+                                    GimpLayer   *layer,
+                                    GeglBuffer  *new_buffer)
+{
+  median_cut_pass2_parallel (quantobj, layer, new_buffer,
+                             median_cut_pass2_fixed_dither_gray_area);
+}
+
+static void
+median_cut_pass2_no_dither_rgb_area (QuantizeObj         *quantobj,
+                                     GimpLayer           *layer,
+                                     GeglBuffer          *new_buffer,
+                                     const GeglRectangle *area,
+                                     gulong              *index_used_count)
 {
   GeglBufferIterator *iter;
   CFHistogram         histogram = quantobj->histogram;
@@ -3109,12 +3371,6 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
   gint                alpha_pix        = ALPHA;
   gboolean            alpha_dither     = quantobj->want_alpha_dither;
   gint                offsetx, offsety;
-  gulong             *index_used_count = quantobj->index_used_count;
-  glong               total_size       = 0;
-  glong               layer_size;
-  gint                count            = 0;
-  gint                nth_layer        = quantobj->nth_layer;
-  gint                n_layers         = quantobj->n_layers;
 
   gimp_item_get_offset (GIMP_ITEM (layer), &offsetx, &offsety);
 
@@ -3136,25 +3392,20 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
     }
 
   iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, NULL,
+                                   area, 0, NULL,
                                    GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
   src_roi = &iter->roi[0];
 
   gegl_buffer_iterator_add (iter, new_buffer,
-                            NULL, 0, NULL,
+                            area, 0, NULL,
                             GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
 
-  layer_size = (gimp_item_get_width  (GIMP_ITEM (layer)) *
-                gimp_item_get_height (GIMP_ITEM (layer)));
-
   while (gegl_buffer_iterator_next (iter))
     {
       const guchar *src  = iter->data[0];
       guchar       *dest = iter->data[1];
       gint          row;
 
-      total_size += src_roi->height * src_roi->width;
-
       for (row = 0; row < src_roi->height; row++)
         {
           gint col;
@@ -3196,7 +3447,7 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
               /* If we have not seen this color before, find nearest
                  colormap entry and update the cache */
               if (*cachep == 0)
-                fill_inverse_cmap_rgb (quantobj, histogram, R, G, B);
+                fill_inverse_cmap_rgb_locked (quantobj, histogram, R, G, B);
 
               /* Now emit the colormap index for this cell, barfbarf */
               index_used_count[dest[INDEXED] = *cachep - 1]++;
@@ -3207,18 +3458,24 @@ median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
               dest += dest_bpp;
             }
         }
-
-      if (quantobj->progress && (count % 16 == 0))
-         gimp_progress_set_value (quantobj->progress,
-                                  (nth_layer + ((gdouble) total_size)/
-                                   layer_size) / (gdouble) n_layers);
     }
 }
 
 static void
-median_cut_pass2_fixed_dither_rgb (QuantizeObj *quantobj,
-                                   GimpLayer   *layer,
-                                   GeglBuffer  *new_buffer)
+median_cut_pass2_no_dither_rgb (QuantizeObj *quantobj,
+                                GimpLayer   *layer,
+                                GeglBuffer  *new_buffer)
+{
+  median_cut_pass2_parallel (quantobj, layer, new_buffer,
+                             median_cut_pass2_no_dither_rgb_area);
+}
+
+static void
+median_cut_pass2_fixed_dither_rgb_area (QuantizeObj         *quantobj,
+                                        GimpLayer           *layer,
+                                        GeglBuffer          *new_buffer,
+                                        const GeglRectangle *area,
+                                        gulong              *index_used_count)
 {
   GeglBufferIterator *iter;
   CFHistogram         histogram = quantobj->histogram;
@@ -3242,12 +3499,6 @@ median_cut_pass2_fixed_dither_rgb (QuantizeObj *quantobj,
   gint                alpha_pix        = ALPHA;
   gboolean            alpha_dither     = quantobj->want_alpha_dither;
   gint                offsetx, offsety;
-  gulong             *index_used_count = quantobj->index_used_count;
-  glong               total_size       = 0;
-  glong               layer_size;
-  gint                count            = 0;
-  gint                nth_layer        = quantobj->nth_layer;
-  gint                n_layers         = quantobj->n_layers;
 
   gimp_item_get_offset (GIMP_ITEM (layer), &offsetx, &offsety);
 
@@ -3269,25 +3520,20 @@ median_cut_pass2_fixed_dither_rgb (QuantizeObj *quantobj,
     }
 
   iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, NULL,
+                                   area, 0, NULL,
                                    GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
   src_roi = &iter->roi[0];
 
   gegl_buffer_iterator_add (iter, new_buffer,
-                            NULL, 0, NULL,
+                            area, 0, NULL,
                             GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
 
-  layer_size = (gimp_item_get_width  (GIMP_ITEM (layer)) *
-                gimp_item_get_height (GIMP_ITEM (layer)));
-
   while (gegl_buffer_iterator_next (iter))
     {
       const guchar *src  = iter->data[0];
       guchar       *dest = iter->data[1];
       gint          row;
 
-      total_size += src_roi->height * src_roi->width;
-
       for (row = 0; row < src_roi->height; row++)
         {
           gint col;
@@ -3331,7 +3577,7 @@ median_cut_pass2_fixed_dither_rgb (QuantizeObj *quantobj,
               /* If we have not seen this color before, find nearest
                  colormap entry and update the cache */
               if (*cachep == 0)
-                fill_inverse_cmap_rgb (quantobj, histogram, R, G, B);
+                fill_inverse_cmap_rgb_locked (quantobj, histogram, R, G, B);
 
               /* We now try to find a color which, when mixed in some fashion
                  with the closest match, yields something closer to the
@@ -3364,7 +3610,8 @@ median_cut_pass2_fixed_dither_rgb (QuantizeObj *quantobj,
                          colormap entry and update the cache */
                       if (*cachep == 0)
                         {
-                          fill_inverse_cmap_rgb (quantobj, histogram, R, G, B);
+                          fill_inverse_cmap_rgb_locked (quantobj, histogram,
+                                                        R, G, B);
                         }
                       pixval2 = *cachep - 1;
                       RV += re;  GV += ge;  BV += be;
@@ -3438,18 +3685,24 @@ median_cut_pass2_fixed_dither_rgb (QuantizeObj *quantobj,
               dest += dest_bpp;
             }
         }
-
-      if (quantobj->progress && (count % 16 == 0))
-        gimp_progress_set_value (quantobj->progress,
-                                 (nth_layer + ((gdouble) total_size)/
-                                  layer_size) / (gdouble) n_layers);
     }
 }
 
 static void
-median_cut_pass2_nodestruct_dither_rgb (QuantizeObj *quantobj,
-                                        GimpLayer   *layer,
-                                        GeglBuffer  *new_buffer)
+median_cut_pass2_fixed_dither_rgb (QuantizeObj *quantobj,
+                                   GimpLayer   *layer,
+                                   GeglBuffer  *new_buffer)
+{
+  median_cut_pass2_parallel (quantobj, layer, new_buffer,
+                             median_cut_pass2_fixed_dither_rgb_area);
+}
+
+static void
+median_cut_pass2_nodestruct_dither_rgb_area (QuantizeObj         *quantobj,
+                                             GimpLayer           *layer,
+                                             GeglBuffer          *new_buffer,
+                                             const GeglRectangle *area,
+                                             gulong              *index_used_count)
 {
   GeglBufferIterator *iter;
   const Babl         *src_format;
@@ -3480,12 +3733,12 @@ median_cut_pass2_nodestruct_dither_rgb (QuantizeObj *quantobj,
   has_alpha = babl_format_has_alpha (src_format);
 
   iter = gegl_buffer_iterator_new (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                                   NULL, 0, NULL,
+                                   area, 0, NULL,
                                    GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
   src_roi = &iter->roi[0];
 
   gegl_buffer_iterator_add (iter, new_buffer,
-                            NULL, 0, NULL,
+                            area, 0, NULL,
                             GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (iter))
@@ -3570,6 +3823,15 @@ median_cut_pass2_nodestruct_dither_rgb (QuantizeObj *quantobj,
     }
 }
 
+static void
+median_cut_pass2_nodestruct_dither_rgb (QuantizeObj *quantobj,
+                                        GimpLayer   *layer,
+                                        GeglBuffer  *new_buffer)
+{
+  median_cut_pass2_parallel (quantobj, layer, new_buffer,
+                             median_cut_pass2_nodestruct_dither_rgb_area);
+}
+
 
 /*
  * Initialize the error-limiting transfer function (lookup table).
@@ -3885,8 +4147,6 @@ median_cut_pass2_rgb_init (QuantizeObj *quantobj)
 {
   int i;
 
-  zero_histogram_rgb (quantobj->histogram);
-
   /* Mark all indices as currently unused */
   memset (quantobj->index_used_count, 0, 256 * sizeof (unsigned long));
 
@@ -3900,6 +4160,26 @@ median_cut_pass2_rgb_init (QuantizeObj *quantobj)
                             &quantobj->clin[i].green,
                             &quantobj->clin[i].blue);
     }
+
+  /* From here on the histogram is the inverse colormap cache, take
+   * over the one of the last conversion if it was for the same colors
+   */
+  if (inverse_cmap_cache.histogram                                   &&
+      inverse_cmap_cache.n_colors == quantobj->actual_number_of_colors &&
+      ! memcmp (inverse_cmap_cache.cmap, quantobj->cmap,
+                quantobj->actual_number_of_colors * sizeof (Color)))
+    {
+      g_free (quantobj->histogram);
+
+      quantobj->histogram = inverse_cmap_cache.histogram;
+      inverse_cmap_cache.histogram = NULL;
+    }
+  else
+    {
+      zero_histogram_rgb (quantobj->histogram);
+    }
+
+  quantobj->inverse_cmap = TRUE;
 }
 
 static void
@@ -4290,7 +4570,23 @@ median_cut_pass2_fs_dither_rgb (QuantizeObj *quantobj,
 static void
 delete_median_cut (QuantizeObj *quantobj)
 {
-  g_free (quantobj->histogram);
+  g_mutex_clear (&quantobj->mutex);
+
+  if (quantobj->inverse_cmap)
+    {
+      /*  keep the inverse colormap for the next conversion  */
+      g_free (inverse_cmap_cache.histogram);
+
+      memcpy (inverse_cmap_cache.cmap, quantobj->cmap,
+              quantobj->actual_number_of_colors * sizeof (Color));
+      inverse_cmap_cache.n_colors  = quantobj->actual_number_of_colors;
+      inverse_cmap_cache.histogram = quantobj->histogram;
+    }
+  else
+    {
+      g_free (quantobj->histogram);
+    }
+
   g_free (quantobj);
 }
 
@@ -4344,10 +4640,13 @@ initialize_median_cut (GimpImageBaseType       type,
     quantobj->histogram = g_new (ColorFreq,
                                  HIST_R_ELEMS * HIST_G_ELEMS * HIST_B_ELEMS);
 
+  quantobj->inverse_cmap             = FALSE;
   quantobj->desired_number_of_colors = num_colors;
   quantobj->want_alpha_dither        = want_alpha_dither;
   quantobj->progress                 = progress;
 
+  g_mutex_init (&quantobj->mutex);
+
   switch (type)
     {
     case GIMP_GRAY:
@@ -46,6 +46,8 @@
 #include "gimplayermask.h"
 #include "gimpmarshal.h"
 #include "gimpparasitelist.h"
+#include "gimppickable.h"
+#include "gimpprojection.h"
 #include "gimpundostack.h"
 
 #include "gimp-intl.h"
@@ -56,6 +58,19 @@ static GimpLayer * gimp_image_merge_layers (GimpImage     *image,
                                             GSList        *merge_list,
                                             GimpContext   *context,
                                             GimpMergeType  merge_type);
+static GimpProjection *
+                   gimp_image_merge_get_projection
+                                           (GimpImage     *image,
+                                            GimpContainer *container,
+                                            GSList        *reverse_list,
+                                            GimpLayer     *parent,
+                                            gboolean       has_background,
+                                            gint           x1,
+                                            gint           y1,
+                                            gint           x2,
+                                            gint           y2,
+                                            gint          *proj_x,
+                                            gint          *proj_y);
 
 
 /*  public functions  */
@@ -414,9 +429,12 @@ gimp_image_merge_layers (GimpImage     *image,
   GimpLayer        *layer;
   GimpLayer        *bottom_layer;
   GimpParasiteList *parasites;
+  GimpProjection   *projection;
+  gboolean          has_background;
   gint              count;
   gint              x1, y1, x2, y2;
   gint              off_x, off_y;
+  gint              proj_x, proj_y;
   gint              position;
   gchar            *name;
   GimpLayer        *parent;
@@ -504,9 +522,21 @@ gimp_image_merge_layers (GimpImage     *image,
 
   name = g_strdup (gimp_object_get_name (layer));
 
-  if (merge_type == GIMP_FLATTEN_IMAGE ||
-      (gimp_drawable_is_indexed (GIMP_DRAWABLE (layer)) &&
-       ! gimp_drawable_has_alpha (GIMP_DRAWABLE (layer))))
+  has_background = (merge_type == GIMP_FLATTEN_IMAGE ||
+                    (gimp_drawable_is_indexed (GIMP_DRAWABLE (layer)) &&
+                     ! gimp_drawable_has_alpha (GIMP_DRAWABLE (layer))));
+
+  /*  If the layers are exactly what the image's or the parent group's
+   *  projection shows, its (mostly already rendered) tiles are the
+   *  merge result, no need to composite the layers again.
+   */
+  projection = gimp_image_merge_get_projection (image, container,
+                                                reverse_list, parent,
+                                                has_background,
+                                                x1, y1, x2, y2,
+                                                &proj_x, &proj_y);
+
+  if (has_background)
     {
       GeglColor *color;
       GimpRGB    bg;
@@ -578,67 +608,118 @@ gimp_image_merge_layers (GimpImage     *image,
   gimp_item_set_parasites (GIMP_ITEM (merge_layer), parasites);
   g_object_unref (parasites);
 
-  for (layers = reverse_list; layers; layers = g_slist_next (layers))
+  if (projection)
     {
-      GeglBuffer           *merge_buffer;
-      GeglBuffer           *layer_buffer;
-      GimpApplicator       *applicator;
-      GimpLayerModeEffects  mode;
-
-      layer = layers->data;
-
-      gimp_item_get_offset (GIMP_ITEM (layer), &off_x, &off_y);
+      GeglBuffer    *merge_buffer;
+      GeglBuffer    *proj_buffer;
+      GeglRectangle  proj_rect = { x1 - proj_x, y1 - proj_y,
+                                   x2 - x1,     y2 - y1 };
 
-      /* DISSOLVE_MODE is special since it is the only mode that does not
-       *  work on the projection with the lower layer, but only locally on
-       *  the layers alpha channel.
+      /*  invalidate the areas that changed since the projection was
+       *  last rendered, they get rendered when the tiles are read
        */
-      mode = gimp_layer_get_mode (layer);
-      if (layer == bottom_layer && mode != GIMP_DISSOLVE_MODE)
-        mode = GIMP_NORMAL_MODE;
+      gimp_pickable_flush (GIMP_PICKABLE (projection));
 
       merge_buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (merge_layer));
-      layer_buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+      proj_buffer  = gimp_pickable_get_buffer (GIMP_PICKABLE (projection));
 
-      applicator =
-        gimp_applicator_new (NULL,
-                             gimp_drawable_get_linear (GIMP_DRAWABLE (layer)));
-
-      if (gimp_layer_get_mask (layer) &&
-          gimp_layer_get_apply_mask (layer))
+      if (has_background)
         {
-          GeglBuffer *mask_buffer;
+          GimpApplicator *applicator;
+
+          applicator =
+            gimp_applicator_new (NULL,
+                                 gimp_drawable_get_linear (GIMP_DRAWABLE (layer)));
+
+          gimp_applicator_set_src_buffer (applicator, merge_buffer);
+          gimp_applicator_set_dest_buffer (applicator, merge_buffer);
+
+          gimp_applicator_set_apply_buffer (applicator, proj_buffer);
+          gimp_applicator_set_apply_offset (applicator,
+                                            - proj_rect.x,
+                                            - proj_rect.y);
 
-          mask_buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer->mask));
+          gimp_applicator_set_mode (applicator,
+                                    GIMP_OPACITY_OPAQUE, GIMP_NORMAL_MODE);
+
+          gimp_applicator_blit (applicator,
+                                GEGL_RECTANGLE (0, 0,
+                                                proj_rect.width,
+                                                proj_rect.height));
 
-          gimp_applicator_set_mask_buffer (applicator, mask_buffer);
-          gimp_applicator_set_mask_offset (applicator,
-                                           - (x1 - off_x),
-                                           - (y1 - off_y));
+          g_object_unref (applicator);
+        }
+      else
+        {
+          gegl_buffer_copy (proj_buffer, &proj_rect,
+                            merge_buffer, GEGL_RECTANGLE (0, 0, 0, 0));
         }
+    }
+  else
+    {
+      for (layers = reverse_list; layers; layers = g_slist_next (layers))
+        {
+          GeglBuffer           *merge_buffer;
+          GeglBuffer           *layer_buffer;
+          GimpApplicator       *applicator;
+          GimpLayerModeEffects  mode;
 
-      gimp_applicator_set_src_buffer (applicator, merge_buffer);
-      gimp_applicator_set_dest_buffer (applicator, merge_buffer);
+          layer = layers->data;
 
-      gimp_applicator_set_apply_buffer (applicator, layer_buffer);
-      gimp_applicator_set_apply_offset (applicator,
-                                        - (x1 - off_x),
-                                        - (y1 - off_y));
+          gimp_item_get_offset (GIMP_ITEM (layer), &off_x, &off_y);
 
-      gimp_applicator_set_mode (applicator,
-                                gimp_layer_get_opacity (layer),
-                                mode);
+          /* DISSOLVE_MODE is special since it is the only mode that does not
+           *  work on the projection with the lower layer, but only locally on
+           *  the layers alpha channel.
+           */
+          mode = gimp_layer_get_mode (layer);
+          if (layer == bottom_layer && mode != GIMP_DISSOLVE_MODE)
+            mode = GIMP_NORMAL_MODE;
 
-      gimp_applicator_blit (applicator,
-                            GEGL_RECTANGLE (0, 0,
-                                            gegl_buffer_get_width  (merge_buffer),
-                                            gegl_buffer_get_height (merge_buffer)));
+          merge_buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (merge_layer));
+          layer_buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
 
-      g_object_unref (applicator);
+          applicator =
+            gimp_applicator_new (NULL,
+                                 gimp_drawable_get_linear (GIMP_DRAWABLE (layer)));
 
-      gimp_image_remove_layer (image, layer, TRUE, NULL);
+          if (gimp_layer_get_mask (layer) &&
+              gimp_layer_get_apply_mask (layer))
+            {
+              GeglBuffer *mask_buffer;
+
+              mask_buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer->mask));
+
+              gimp_applicator_set_mask_buffer (applicator, mask_buffer);
+              gimp_applicator_set_mask_offset (applicator,
+                                               - (x1 - off_x),
+                                               - (y1 - off_y));
+            }
+
+          gimp_applicator_set_src_buffer (applicator, merge_buffer);
+          gimp_applicator_set_dest_buffer (applicator, merge_buffer);
+
+          gimp_applicator_set_apply_buffer (applicator, layer_buffer);
+          gimp_applicator_set_apply_offset (applicator,
+                                            - (x1 - off_x),
+                                            - (y1 - off_y));
+
+          gimp_applicator_set_mode (applicator,
+                                    gimp_layer_get_opacity (layer),
+                                    mode);
+
+          gimp_applicator_blit (applicator,
+                                GEGL_RECTANGLE (0, 0,
+                                                gegl_buffer_get_width  (merge_buffer),
+                                                gegl_buffer_get_height (merge_buffer)));
+
+          g_object_unref (applicator);
+        }
     }
 
+  for (layers = reverse_list; layers; layers = g_slist_next (layers))
+    gimp_image_remove_layer (image, layers->data, TRUE, NULL);
+
   g_slist_free (reverse_list);
 
   gimp_object_take_name (GIMP_OBJECT (merge_layer), name);
@@ -676,3 +757,129 @@ gimp_image_merge_layers (GimpImage     *image,
 
   return merge_layer;
 }
+
+static GimpProjection *
+gimp_image_merge_get_projection (GimpImage     *image,
+                                 GimpContainer *container,
+                                 GSList        *reverse_list,
+                                 GimpLayer     *parent,
+                                 gboolean       has_background,
+                                 gint           x1,
+                                 gint           y1,
+                                 gint           x2,
+                                 gint           y2,
+                                 gint          *proj_x,
+                                 gint          *proj_y)
+{
+  GimpProjection *projection;
+  GimpLayer      *bottom_layer = reverse_list->data;
+  GList          *iter;
+  GList          *list;
+  GSList         *layers       = reverse_list;
+  gboolean        all_normal   = TRUE;
+  gint            proj_width;
+  gint            proj_height;
+
+  /*  the projection of an indexed image is RGB  */
+  if (gimp_image_get_base_type (image) == GIMP_INDEXED)
+    return NULL;
+
+  /*  the merge list must be exactly the visible layers of the container,
+   *  composited the same way the projection composites them
+   */
+  iter = gimp_item_stack_get_item_iter (GIMP_ITEM_STACK (container));
+
+  for (list = g_list_last (iter);
+       list;
+       list = g_list_previous (list))
+    {
+      GimpLayer *layer = list->data;
+
+      if (! gimp_item_get_visible (GIMP_ITEM (layer)))
+        continue;
+
+      if (! layers || layers->data != layer)
+        return NULL;
+
+      if (gimp_layer_is_floating_sel (layer) ||
+          gimp_layer_get_show_mask (layer))
+        return NULL;
+
+      if (layer != bottom_layer &&
+          gimp_layer_get_mode (layer) != GIMP_NORMAL_MODE)
+        all_normal = FALSE;
+
+      layers = g_slist_next (layers);
+    }
+
+  if (layers)
+    return NULL;
+
+  /*  the old code composites the bottom layer in normal mode
+   *  onto the transparent merge layer
+   */
+  if (gimp_layer_get_mode (bottom_layer) != GIMP_NORMAL_MODE &&
+      gimp_layer_get_mode (bottom_layer) != GIMP_DISSOLVE_MODE)
+    return NULL;
+
+  /*  the projection has no background, putting it over one gives the
+   *  same result only if the layers' modes don't see the background
+   *  anyway
+   */
+  if (has_background && ! all_normal)
+    {
+      gint off_x, off_y;
+
+      gimp_item_get_offset (GIMP_ITEM (bottom_layer), &off_x, &off_y);
+
+      if (gimp_drawable_has_alpha (GIMP_DRAWABLE (bottom_layer))       ||
+          gimp_layer_get_mask (bottom_layer)                           ||
+          gimp_layer_get_mode (bottom_layer)    != GIMP_NORMAL_MODE     ||
+          gimp_layer_get_opacity (bottom_layer) != GIMP_OPACITY_OPAQUE  ||
+          off_x > x1                                                   ||
+          off_y > y1                                                   ||
+          off_x + gimp_item_get_width  (GIMP_ITEM (bottom_layer)) < x2 ||
+          off_y + gimp_item_get_height (GIMP_ITEM (bottom_layer)) < y2)
+        return NULL;
+    }
+
+  if (parent)
+    {
+      if (gimp_image_get_group_updates_suspended (image))
+        return NULL;
+
+      projection = gimp_group_layer_get_projection (GIMP_GROUP_LAYER (parent));
+
+      gimp_item_get_offset (GIMP_ITEM (parent), proj_x, proj_y);
+      proj_width  = gimp_item_get_width  (GIMP_ITEM (parent));
+      proj_height = gimp_item_get_height (GIMP_ITEM (parent));
+    }
+  else
+    {
+      GList *channels;
+
+      if (gimp_image_get_visible_mask (image) != GIMP_COMPONENT_ALL)
+        return NULL;
+
+      for (channels = gimp_image_get_channel_iter (image);
+           channels;
+           channels = g_list_next (channels))
+        {
+          if (gimp_item_get_visible (GIMP_ITEM (channels->data)))
+            return NULL;
+        }
+
+      projection = gimp_image_get_projection (image);
+
+      *proj_x     = 0;
+      *proj_y     = 0;
+      proj_width  = gimp_image_get_width  (image);
+      proj_height = gimp_image_get_height (image);
+    }
+
+  if (x1 < *proj_x || x2 > *proj_x + proj_width ||
+      y1 < *proj_y || y2 > *proj_y + proj_height)
+    return NULL;
+
+  return projection;
+}
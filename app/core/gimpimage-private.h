@@ -38,6 +38,7 @@ struct _GimpImagePrivate
 
   GimpPlugInProcedure *load_proc;           /*  procedure used for loading   */
   GimpPlugInProcedure *save_proc;           /*  last save procedure used     */
+  gboolean           xcf_compression;       /*  XCF compression enabled      */
 
   gchar             *display_name;          /*  display basename             */
   gchar             *display_path;          /*  display full path            */
@@ -104,6 +105,9 @@ struct _GimpImagePrivate
 
   /*  Signal emission accumulator  */
   GimpImageFlushAccumulator  flush_accum;
+
+  /*  Deferred group layer updates  */
+  gint               suspend_group_updates;
 };
 
 #define GIMP_IMAGE_GET_PRIVATE(image) \
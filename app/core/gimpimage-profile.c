@@ -0,0 +1,345 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpimage-profile.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#ifdef HAVE_LCMS
+#include <lcms2.h>
+#endif
+
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "core-types.h"
+
+#include "gegl/gimp-gegl-apply-operation.h"
+
+#include "gimpdrawable.h"
+#include "gimperror.h"
+#include "gimpimage.h"
+#include "gimpimage-colormap.h"
+#include "gimpimage-profile.h"
+#include "gimpimage-undo.h"
+#include "gimpprogress.h"
+
+#include "gimp-intl.h"
+
+
+#ifdef HAVE_LCMS
+
+static cmsHPROFILE   gimp_image_profile_open (const guint8  *data,
+                                              gsize          length,
+                                              const gchar   *filename,
+                                              GError       **error);
+
+static void          gimp_image_profile_convert_colormap
+                                             (GimpImage     *image,
+                                              cmsHPROFILE    src_profile,
+                                              cmsHPROFILE    dest_profile,
+                                              GimpColorRenderingIntent intent,
+                                              gboolean       bpc);
+
+#endif /* HAVE_LCMS */
+
+
+/*  public functions  */
+
+/**
+ * gimp_image_convert_profile:
+ * @image:    a #GimpImage
+ * @filename: the ICC profile to convert to, or %NULL for sRGB
+ * @intent:   the rendering intent
+ * @bpc:      whether to use black point compensation
+ * @progress: a #GimpProgress, or %NULL
+ * @error:    return location for an error
+ *
+ * Converts the pixels of @image from its attached "icc-profile" (or
+ * sRGB if there is none) to @filename and attaches @filename as the
+ * new profile. This does in the core what the lcms plug-in's
+ * "plug-in-icc-profile-apply" does, without sending the pixels to a
+ * plug-in and back; the layers are converted by GEGL, which process
+ * their tiles in parallel.
+ *
+ * Unlike gimp_drawable_apply_operation() this ignores the selection,
+ * a profile conversion always applies to the whole image.
+ *
+ * Return value: %TRUE if the image was converted.
+ **/
+gboolean
+gimp_image_convert_profile (GimpImage                 *image,
+                            const gchar               *filename,
+                            GimpColorRenderingIntent   intent,
+                            gboolean                   bpc,
+                            GimpProgress              *progress,
+                            GError                   **error)
+{
+#ifdef HAVE_LCMS
+  const GimpParasite *parasite;
+  GimpParasite       *dest_parasite = NULL;
+  cmsHPROFILE         src_profile;
+  cmsHPROFILE         dest_profile;
+  const gchar        *undo_desc;
+
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), FALSE);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (gimp_image_get_base_type (image) == GIMP_GRAY)
+    {
+      g_set_error_literal (error, GIMP_ERROR, GIMP_FAILED,
+                           _("Can't apply color profile to grayscale image"));
+      return FALSE;
+    }
+
+  if (filename)
+    {
+      gchar *data;
+      gsize  length;
+
+      if (! g_file_get_contents (filename, &data, &length, error))
+        return FALSE;
+
+      dest_profile = gimp_image_profile_open ((const guint8 *) data, length,
+                                              filename, error);
+
+      if (! dest_profile)
+        {
+          g_free (data);
+          return FALSE;
+        }
+
+      dest_parasite = gimp_parasite_new ("icc-profile",
+                                         GIMP_PARASITE_PERSISTENT |
+                                         GIMP_PARASITE_UNDOABLE,
+                                         length, data);
+      g_free (data);
+    }
+  else
+    {
+      dest_profile = cmsCreate_sRGBProfile ();
+    }
+
+  parasite = gimp_image_parasite_find (image, "icc-profile");
+
+  /*  converting to the attached profile (or from sRGB to sRGB) is a
+   *  no-op
+   */
+  if ((! parasite && ! dest_parasite) ||
+      (parasite && dest_parasite &&
+       gimp_parasite_data_size (parasite) ==
+       gimp_parasite_data_size (dest_parasite) &&
+       memcmp (gimp_parasite_data (parasite),
+               gimp_parasite_data (dest_parasite),
+               gimp_parasite_data_size (parasite)) == 0))
+    {
+      if (dest_parasite)
+        gimp_parasite_free (dest_parasite);
+
+      cmsCloseProfile (dest_profile);
+
+      return TRUE;
+    }
+
+  if (parasite)
+    {
+      src_profile =
+        gimp_image_profile_open (gimp_parasite_data (parasite),
+                                 gimp_parasite_data_size (parasite),
+                                 NULL, NULL);
+
+      /*  like the plug-in, treat a broken attached profile as sRGB  */
+      if (! src_profile)
+        src_profile = cmsCreate_sRGBProfile ();
+    }
+  else
+    {
+      src_profile = cmsCreate_sRGBProfile ();
+    }
+
+  undo_desc = C_("undo-type", "Convert Image to Color Profile");
+
+  if (progress)
+    gimp_progress_start (progress, undo_desc, FALSE);
+
+  gimp_image_undo_group_start (image, GIMP_UNDO_GROUP_IMAGE_CONVERT,
+                               undo_desc);
+
+  if (gimp_image_get_base_type (image) == GIMP_INDEXED)
+    {
+      gimp_image_profile_convert_colormap (image, src_profile, dest_profile,
+                                           intent, bpc);
+    }
+  else
+    {
+      GeglNode *node;
+      GList    *layers;
+      GList    *list;
+
+      node = gegl_node_new_child (NULL,
+                                  "operation",    "gimp:profile-transform",
+                                  "src-profile",  src_profile,
+                                  "dest-profile", dest_profile,
+                                  "intent",       intent,
+                                  "bpc",          bpc,
+                                  NULL);
+
+      layers = gimp_image_get_layer_list (image);
+
+      for (list = layers; list; list = g_list_next (list))
+        {
+          GimpDrawable *drawable = list->data;
+          GeglBuffer   *buffer;
+
+          /*  group layers follow their children  */
+          if (gimp_viewable_get_children (GIMP_VIEWABLE (drawable)))
+            continue;
+
+          buffer =
+            gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                             gimp_item_get_width  (GIMP_ITEM (drawable)),
+                                             gimp_item_get_height (GIMP_ITEM (drawable))),
+                             gimp_drawable_get_format (drawable));
+
+          gimp_gegl_apply_operation (gimp_drawable_get_buffer (drawable),
+                                     progress, undo_desc,
+                                     node, buffer, NULL);
+
+          gimp_drawable_set_buffer (drawable, TRUE, undo_desc, buffer);
+          g_object_unref (buffer);
+        }
+
+      g_list_free (layers);
+      g_object_unref (node);
+    }
+
+  if (dest_parasite)
+    {
+      gimp_image_parasite_attach (image, dest_parasite);
+      gimp_parasite_free (dest_parasite);
+    }
+  else
+    {
+      gimp_image_parasite_detach (image, "icc-profile");
+    }
+
+  gimp_image_parasite_detach (image, "icc-profile-name");
+
+  gimp_image_undo_group_end (image);
+
+  cmsCloseProfile (src_profile);
+  cmsCloseProfile (dest_profile);
+
+  if (progress)
+    gimp_progress_end (progress);
+
+  return TRUE;
+
+#else /* ! HAVE_LCMS */
+
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), FALSE);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  g_set_error_literal (error, GIMP_ERROR, GIMP_FAILED,
+                       _("GIMP was built without color management support"));
+
+  return FALSE;
+
+#endif /* HAVE_LCMS */
+}
+
+
+/*  private functions  */
+
+#ifdef HAVE_LCMS
+
+static cmsHPROFILE
+gimp_image_profile_open (const guint8  *data,
+                         gsize          length,
+                         const gchar   *filename,
+                         GError       **error)
+{
+  cmsHPROFILE profile;
+
+  profile = cmsOpenProfileFromMem ((gpointer) data, length);
+
+  if (! profile)
+    {
+      if (filename)
+        g_set_error (error, GIMP_ERROR, GIMP_FAILED,
+                     _("'%s' does not appear to be an ICC color profile"),
+                     gimp_filename_to_utf8 (filename));
+
+      return NULL;
+    }
+
+  if (cmsGetColorSpace (profile) != cmsSigRgbData)
+    {
+      if (filename)
+        g_set_error (error, GIMP_ERROR, GIMP_FAILED,
+                     _("Color profile '%s' is not for RGB color space."),
+                     gimp_filename_to_utf8 (filename));
+
+      cmsCloseProfile (profile);
+
+      return NULL;
+    }
+
+  return profile;
+}
+
+static void
+gimp_image_profile_convert_colormap (GimpImage                *image,
+                                     cmsHPROFILE               src_profile,
+                                     cmsHPROFILE               dest_profile,
+                                     GimpColorRenderingIntent  intent,
+                                     gboolean                  bpc)
+{
+  cmsHTRANSFORM  transform;
+  guchar        *cmap;
+  gint           n_colors;
+
+  n_colors = gimp_image_get_colormap_size (image);
+
+  if (n_colors < 1)
+    return;
+
+  transform = cmsCreateTransform (src_profile,  TYPE_RGB_8,
+                                  dest_profile, TYPE_RGB_8,
+                                  intent,
+                                  cmsFLAGS_NOOPTIMIZE |
+                                  (bpc ? cmsFLAGS_BLACKPOINTCOMPENSATION : 0));
+
+  if (! transform)
+    return;
+
+  cmap = g_memdup (gimp_image_get_colormap (image), n_colors * 3);
+
+  cmsDoTransform (transform, cmap, cmap, n_colors);
+  cmsDeleteTransform (transform);
+
+  gimp_image_set_colormap (image, cmap, n_colors, TRUE);
+
+  g_free (cmap);
+}
+
+#endif /* HAVE_LCMS */
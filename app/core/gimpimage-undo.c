@@ -19,10 +19,14 @@
 
 #include <gegl.h>
 
+#include "libgimpconfig/gimpconfig.h"
+
 #include "core-types.h"
 
 #include "config/gimpcoreconfig.h"
 
+#include "gegl/gimpcompressedbuffer.h"
+
 #include "gimp.h"
 #include "gimp-utils.h"
 #include "gimpdrawableundo.h"
@@ -31,15 +35,29 @@
 #include "gimpimage-undo.h"
 #include "gimpitem.h"
 #include "gimplist.h"
+#include "gimpmaskundo.h"
 #include "gimpundostack.h"
 
 
+/*  the pixels of the newest undo steps stay in memory, the pixels of
+ *  older steps are moved to the swap directory in the background
+ */
+#define N_RESIDENT_UNDO_STEPS 2
+
+/*  swapped out pixels may take this many times undo-size on disk  */
+#define MAX_SWAP_UNDO_FACTOR  8
+
+
 /*  local function prototypes  */
 
 static void          gimp_image_undo_pop_stack       (GimpImage     *image,
                                                       GimpUndoStack *undo_stack,
                                                       GimpUndoStack *redo_stack,
                                                       GimpUndoMode   undo_mode);
+static void          gimp_image_undo_swap_out        (GimpImage     *image);
+static void          gimp_image_undo_swap_out_undo   (GimpUndo      *undo,
+                                                      const gchar   *swap_dir);
+static gint64        gimp_image_undo_get_swap_size   (GimpUndo      *undo);
 static void          gimp_image_undo_free_space      (GimpImage     *image);
 static void          gimp_image_undo_free_redo       (GimpImage     *image);
 
@@ -533,6 +551,90 @@ gimp_image_undo_pop_stack (GimpImage     *image,
   g_object_thaw_notify (G_OBJECT (image));
 }
 
+static void
+gimp_image_undo_swap_out (GimpImage *image)
+{
+  GimpImagePrivate *private = GIMP_IMAGE_GET_PRIVATE (image);
+  GimpGeglConfig   *config  = GIMP_GEGL_CONFIG (image->gimp->config);
+  GList            *list;
+  gchar            *swap_dir;
+
+  if (! config->swap_path || ! *config->swap_path)
+    return;
+
+  list = g_list_nth (GIMP_LIST (private->undo_stack->undos)->list,
+                     N_RESIDENT_UNDO_STEPS);
+
+  if (! list)
+    return;
+
+  swap_dir = gimp_config_path_expand (config->swap_path, TRUE, NULL);
+
+  if (! swap_dir)
+    return;
+
+  for (; list; list = g_list_next (list))
+    gimp_image_undo_swap_out_undo (list->data, swap_dir);
+
+  g_free (swap_dir);
+}
+
+static void
+gimp_image_undo_swap_out_undo (GimpUndo    *undo,
+                               const gchar *swap_dir)
+{
+  if (GIMP_IS_UNDO_STACK (undo))
+    {
+      GList *list;
+
+      for (list = GIMP_LIST (GIMP_UNDO_STACK (undo)->undos)->list;
+           list;
+           list = g_list_next (list))
+        {
+          gimp_image_undo_swap_out_undo (list->data, swap_dir);
+        }
+    }
+  else if (GIMP_IS_DRAWABLE_UNDO (undo))
+    {
+      gimp_compressed_buffer_swap_out (GIMP_DRAWABLE_UNDO (undo)->buffer,
+                                       swap_dir);
+    }
+  else if (GIMP_IS_MASK_UNDO (undo) && GIMP_MASK_UNDO (undo)->buffer)
+    {
+      gimp_compressed_buffer_swap_out (GIMP_MASK_UNDO (undo)->buffer,
+                                       swap_dir);
+    }
+}
+
+static gint64
+gimp_image_undo_get_swap_size (GimpUndo *undo)
+{
+  if (GIMP_IS_UNDO_STACK (undo))
+    {
+      GList  *list;
+      gint64  swap_size = 0;
+
+      for (list = GIMP_LIST (GIMP_UNDO_STACK (undo)->undos)->list;
+           list;
+           list = g_list_next (list))
+        {
+          swap_size += gimp_image_undo_get_swap_size (list->data);
+        }
+
+      return swap_size;
+    }
+  else if (GIMP_IS_DRAWABLE_UNDO (undo) && GIMP_DRAWABLE_UNDO (undo)->buffer)
+    {
+      return gimp_compressed_buffer_get_swap_size (GIMP_DRAWABLE_UNDO (undo)->buffer);
+    }
+  else if (GIMP_IS_MASK_UNDO (undo) && GIMP_MASK_UNDO (undo)->buffer)
+    {
+      return gimp_compressed_buffer_get_swap_size (GIMP_MASK_UNDO (undo)->buffer);
+    }
+
+  return 0;
+}
+
 static void
 gimp_image_undo_free_space (GimpImage *image)
 {
@@ -541,6 +643,8 @@ gimp_image_undo_free_space (GimpImage *image)
   gint              min_undo_levels;
   gint              max_undo_levels;
   gint64            undo_size;
+  gint64            swap_size = 0;
+  GList            *list;
 
   container = private->undo_stack->undos;
 
@@ -548,6 +652,14 @@ gimp_image_undo_free_space (GimpImage *image)
   max_undo_levels = 1024; /* FIXME */
   undo_size       = image->gimp->config->undo_size;
 
+  /*  swapped out pixels don't count against undo_size, but they are
+   *  limited to a multiple of it on disk
+   */
+  gimp_image_undo_swap_out (image);
+
+  for (list = GIMP_LIST (container)->list; list; list = g_list_next (list))
+    swap_size += gimp_image_undo_get_swap_size (list->data);
+
 #ifdef DEBUG_IMAGE_UNDO
   g_printerr ("undo_steps: %d    undo_bytes: %ld\n",
               gimp_container_get_n_children (container),
@@ -559,10 +671,18 @@ gimp_image_undo_free_space (GimpImage *image)
     return;
 
   while ((gimp_object_get_memsize (GIMP_OBJECT (container), NULL) > undo_size) ||
+         (swap_size > undo_size * MAX_SWAP_UNDO_FACTOR) ||
          (gimp_container_get_n_children (container) > max_undo_levels))
     {
-      GimpUndo *freed = gimp_undo_stack_free_bottom (private->undo_stack,
-                                                     GIMP_UNDO_MODE_UNDO);
+      GimpUndo *freed;
+
+      /*  freeing the step drops its pixels, look at them before  */
+      freed = GIMP_UNDO (gimp_container_get_last_child (container));
+
+      swap_size -= gimp_image_undo_get_swap_size (freed);
+
+      freed = gimp_undo_stack_free_bottom (private->undo_stack,
+                                           GIMP_UNDO_MODE_UNDO);
 
 #ifdef DEBUG_IMAGE_UNDO
       g_printerr ("freed one step: undo_steps: %d    undo_bytes: %ld\n",
@@ -42,6 +42,7 @@
 #include "gimpdrawablestack.h"
 #include "gimpgrid.h"
 #include "gimperror.h"
+#include "gimpgrouplayer.h"
 #include "gimpguide.h"
 #include "gimpidtable.h"
 #include "gimpimage.h"
@@ -208,6 +209,7 @@ static void     gimp_image_active_channel_notify (GimpItemTree      *tree,
 static void     gimp_image_active_vectors_notify (GimpItemTree      *tree,
                                                   const GParamSpec  *pspec,
                                                   GimpImage         *image);
+static void     gimp_image_update_layer_caches   (GimpImage         *image);
 
 
 G_DEFINE_TYPE_WITH_CODE (GimpImage, gimp_image, GIMP_TYPE_VIEWABLE,
@@ -1417,12 +1419,75 @@ gimp_image_active_layer_notify (GimpItemTree     *tree,
       private->layer_stack = g_slist_prepend (private->layer_stack, layer);
     }
 
+  gimp_image_update_layer_caches (image);
+
   g_signal_emit (image, gimp_image_signals[ACTIVE_LAYER_CHANGED], 0);
 
   if (layer && gimp_image_get_active_channel (image))
     gimp_image_set_active_channel (image, NULL);
 }
 
+/*  makes each layer stack on the way from the active layer up to the
+ *  image cache the composite below the active layer, or below the
+ *  group containing it, so painting only has to recomposite the
+ *  active layer and the layers above it
+ */
+static void
+gimp_image_update_layer_caches (GimpImage *image)
+{
+  GimpLayer *layer  = gimp_image_get_active_layer (image);
+  GList     *chain  = NULL;
+  GList     *stacks = NULL;
+  GList     *layers;
+  GList     *list;
+
+  if (layer)
+    {
+      GimpViewable *viewable;
+
+      for (viewable = GIMP_VIEWABLE (layer);
+           viewable;
+           viewable = gimp_viewable_get_parent (viewable))
+        {
+          chain = g_list_prepend (chain, viewable);
+        }
+    }
+
+  stacks = g_list_prepend (stacks, gimp_image_get_layers (image));
+
+  layers = gimp_image_get_layer_list (image);
+
+  for (list = layers; list; list = g_list_next (list))
+    {
+      if (GIMP_IS_GROUP_LAYER (list->data))
+        stacks = g_list_prepend (stacks,
+                                 gimp_viewable_get_children (list->data));
+    }
+
+  g_list_free (layers);
+
+  for (list = stacks; list; list = g_list_next (list))
+    {
+      GimpFilterStack *stack  = list->data;
+      GimpFilter      *filter = NULL;
+      GList           *iter;
+
+      for (iter = chain; iter; iter = g_list_next (iter))
+        {
+          if (gimp_item_get_container (iter->data) == GIMP_CONTAINER (stack))
+            {
+              filter = iter->data;
+              break;
+            }
+        }
+
+      gimp_filter_stack_set_cached_filter (stack, filter);
+    }
+
+  g_list_free (stacks);
+  g_list_free (chain);
+}
+
 static void
 gimp_image_active_channel_notify (GimpItemTree     *tree,
                                   const GParamSpec *pspec,
@@ -1966,6 +2031,23 @@ gimp_image_get_save_proc (const GimpImage *image)
   return GIMP_IMAGE_GET_PRIVATE (image)->save_proc;
 }
 
+void
+gimp_image_set_xcf_compression (GimpImage *image,
+                                gboolean   compression)
+{
+  g_return_if_fail (GIMP_IS_IMAGE (image));
+
+  GIMP_IMAGE_GET_PRIVATE (image)->xcf_compression = compression;
+}
+
+gboolean
+gimp_image_get_xcf_compression (const GimpImage *image)
+{
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), FALSE);
+
+  return GIMP_IMAGE_GET_PRIVATE (image)->xcf_compression;
+}
+
 void
 gimp_image_set_resolution (GimpImage *image,
                            gdouble    xresolution,
@@ -3845,6 +3927,7 @@ gimp_image_add_layers (GimpImage   *image,
   offset_y = y + (height - layers_height) / 2 - layers_y;
 
   gimp_image_undo_group_start (image, GIMP_UNDO_GROUP_LAYER_ADD, undo_desc);
+  gimp_image_suspend_group_updates (image);
 
   for (list = layers; list; list = g_list_next (list))
     {
@@ -3857,12 +3940,81 @@ gimp_image_add_layers (GimpImage   *image,
       position++;
     }
 
+  gimp_image_resume_group_updates (image);
+
   if (layers)
     gimp_image_set_active_layer (image, layers->data);
 
   gimp_image_undo_group_end (image);
 }
 
+/**
+ * gimp_image_suspend_group_updates:
+ * @image: a #GimpImage
+ *
+ * Starts a bulk edit of the image's layers.  Until the matching
+ * gimp_image_resume_group_updates(), the group layers of @image
+ * don't recompute their size or invalidate their projection when
+ * their children change, they only remember that they have to.
+ * Calls can be nested.
+ **/
+void
+gimp_image_suspend_group_updates (GimpImage *image)
+{
+  g_return_if_fail (GIMP_IS_IMAGE (image));
+
+  GIMP_IMAGE_GET_PRIVATE (image)->suspend_group_updates++;
+}
+
+/**
+ * gimp_image_resume_group_updates:
+ * @image: a #GimpImage
+ *
+ * Ends a bulk edit started with gimp_image_suspend_group_updates().
+ * When the outermost bulk edit ends, each group layer that changed
+ * is updated once, innermost groups first.
+ **/
+void
+gimp_image_resume_group_updates (GimpImage *image)
+{
+  GimpImagePrivate *private;
+
+  g_return_if_fail (GIMP_IS_IMAGE (image));
+
+  private = GIMP_IMAGE_GET_PRIVATE (image);
+
+  g_return_if_fail (private->suspend_group_updates > 0);
+
+  if (private->suspend_group_updates == 1)
+    {
+      GList *layers;
+      GList *list;
+
+      /*  stay suspended while flushing, so a group's update only marks
+       *  its parent, which comes later in the reversed list
+       */
+      layers = g_list_reverse (gimp_image_get_layer_list (image));
+
+      for (list = layers; list; list = g_list_next (list))
+        {
+          if (GIMP_IS_GROUP_LAYER (list->data))
+            gimp_group_layer_flush_updates (list->data);
+        }
+
+      g_list_free (layers);
+    }
+
+  private->suspend_group_updates--;
+}
+
+gboolean
+gimp_image_get_group_updates_suspended (const GimpImage *image)
+{
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), FALSE);
+
+  return GIMP_IMAGE_GET_PRIVATE (image)->suspend_group_updates > 0;
+}
+
 
 /*  channels  */
 
@@ -156,6 +156,9 @@ GimpPlugInProcedure * gimp_image_get_load_proc   (const GimpImage    *image);
 void            gimp_image_set_save_proc         (GimpImage          *image,
                                                   GimpPlugInProcedure *proc);
 GimpPlugInProcedure * gimp_image_get_save_proc   (const GimpImage    *image);
+void            gimp_image_set_xcf_compression   (GimpImage          *image,
+                                                  gboolean            compression);
+gboolean        gimp_image_get_xcf_compression   (const GimpImage    *image);
 void            gimp_image_saved                 (GimpImage          *image,
                                                   const gchar        *uri);
 void            gimp_image_exported              (GimpImage          *image,
@@ -391,6 +394,11 @@ void            gimp_image_add_layers            (GimpImage          *image,
                                                   gint                height,
                                                   const gchar        *undo_desc);
 
+void            gimp_image_suspend_group_updates (GimpImage          *image);
+void            gimp_image_resume_group_updates  (GimpImage          *image);
+gboolean        gimp_image_get_group_updates_suspended
+                                                 (const GimpImage    *image);
+
 gboolean        gimp_image_add_channel           (GimpImage          *image,
                                                   GimpChannel        *channel,
                                                   GimpChannel        *parent,
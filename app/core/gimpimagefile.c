@@ -69,10 +69,26 @@ struct _GimpImagefilePrivate
   GIcon         *icon;
   GCancellable  *icon_cancellable;
 
+  /*  the thumbnail preview, loaded in a worker thread  */
+  GCancellable  *thumb_cancellable;
+  GdkPixbuf     *thumb_pixbuf;
+  gint           thumb_width;
+  gint           thumb_height;
+  gboolean       thumb_loaded;
+
   gchar         *description;
   gboolean       static_desc;
 };
 
+typedef struct _GimpImagefileThumbData GimpImagefileThumbData;
+
+struct _GimpImagefileThumbData
+{
+  GimpThumbnail *thumbnail;
+  gint           width;
+  gint           height;
+};
+
 #define GET_PRIVATE(imagefile) G_TYPE_INSTANCE_GET_PRIVATE (imagefile, \
                                                             GIMP_TYPE_IMAGEFILE, \
                                                             GimpImagefilePrivate)
@@ -87,13 +103,27 @@ static void        gimp_imagefile_info_changed     (GimpImagefile  *imagefile);
 static void        gimp_imagefile_notify_thumbnail (GimpImagefile  *imagefile,
                                                     GParamSpec     *pspec);
 
+static void        gimp_imagefile_invalidate_preview
+                                                   (GimpViewable   *viewable);
 static GdkPixbuf * gimp_imagefile_get_new_pixbuf   (GimpViewable   *viewable,
                                                     GimpContext    *context,
                                                     gint            width,
                                                     gint            height);
-static GdkPixbuf * gimp_imagefile_load_thumb       (GimpImagefile  *imagefile,
+static GdkPixbuf * gimp_imagefile_load_thumb       (GimpThumbnail  *thumbnail,
                                                     gint            width,
-                                                    gint            height);
+                                                    gint            height,
+                                                    GError        **error);
+static void        gimp_imagefile_cancel_thumb     (GimpImagefile  *imagefile);
+static void        gimp_imagefile_thumb_thread     (GTask          *task,
+                                                    gpointer        source_object,
+                                                    gpointer        task_data,
+                                                    GCancellable   *cancellable);
+static void        gimp_imagefile_thumb_callback   (GObject        *source_object,
+                                                    GAsyncResult   *result,
+                                                    gpointer        data);
+static void        gimp_imagefile_thumb_data_free  (gpointer        data);
+static void        gimp_imagefile_copy_thumb_info  (GimpThumbnail  *dest,
+                                                    GimpThumbnail  *src);
 static gboolean    gimp_imagefile_save_thumb       (GimpImagefile  *imagefile,
                                                     GimpImage      *image,
                                                     gint            size,
@@ -148,6 +178,7 @@ gimp_imagefile_class_init (GimpImagefileClass *klass)
   gimp_object_class->name_changed     = gimp_imagefile_name_changed;
 
   viewable_class->name_changed_signal = "info-changed";
+  viewable_class->invalidate_preview  = gimp_imagefile_invalidate_preview;
   viewable_class->get_new_pixbuf      = gimp_imagefile_get_new_pixbuf;
   viewable_class->get_description     = gimp_imagefile_get_description;
 
@@ -187,6 +218,8 @@ gimp_imagefile_dispose (GObject *object)
       private->icon_cancellable = NULL;
     }
 
+  gimp_imagefile_cancel_thumb (GIMP_IMAGEFILE (object));
+
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
@@ -533,6 +566,8 @@ gimp_imagefile_name_changed (GimpObject *object)
   if (GIMP_OBJECT_CLASS (parent_class)->name_changed)
     GIMP_OBJECT_CLASS (parent_class)->name_changed (object);
 
+  gimp_imagefile_cancel_thumb (GIMP_IMAGEFILE (object));
+
   gimp_thumbnail_set_uri (private->thumbnail, gimp_object_get_name (object));
 }
 
@@ -563,18 +598,73 @@ gimp_imagefile_notify_thumbnail (GimpImagefile *imagefile,
     }
 }
 
+static void
+gimp_imagefile_invalidate_preview (GimpViewable *viewable)
+{
+  gimp_imagefile_cancel_thumb (GIMP_IMAGEFILE (viewable));
+
+  GIMP_VIEWABLE_CLASS (parent_class)->invalidate_preview (viewable);
+}
+
 static GdkPixbuf *
 gimp_imagefile_get_new_pixbuf (GimpViewable *viewable,
                                GimpContext  *context,
                                gint          width,
                                gint          height)
 {
-  GimpImagefile *imagefile = GIMP_IMAGEFILE (viewable);
+  GimpImagefile          *imagefile = GIMP_IMAGEFILE (viewable);
+  GimpImagefilePrivate   *private   = GET_PRIVATE (imagefile);
+  GimpImagefileThumbData *data;
+  GTask                  *task;
 
   if (! gimp_object_get_name (imagefile))
     return NULL;
 
-  return gimp_imagefile_load_thumb (imagefile, width, height);
+  if (private->thumb_width  == width &&
+      private->thumb_height == height)
+    {
+      if (private->thumb_pixbuf)
+        {
+          GdkPixbuf *pixbuf = private->thumb_pixbuf;
+
+          private->thumb_pixbuf = NULL;
+
+          return pixbuf;
+        }
+
+      /*  still loading, or there is no thumbnail  */
+      if (private->thumb_cancellable || private->thumb_loaded)
+        return NULL;
+    }
+
+  gimp_imagefile_cancel_thumb (imagefile);
+
+  /*  loading the thumbnail means looking it up in several places and
+   *  decoding a PNG, do that in a worker thread, using a thumbnail
+   *  object of its own, and show the icon meanwhile
+   */
+  data = g_slice_new0 (GimpImagefileThumbData);
+
+  data->thumbnail = gimp_thumbnail_new ();
+  data->width     = width;
+  data->height    = height;
+
+  gimp_thumbnail_set_uri (data->thumbnail, gimp_object_get_name (imagefile));
+
+  private->thumb_cancellable = g_cancellable_new ();
+  private->thumb_width       = width;
+  private->thumb_height      = height;
+
+  task = g_task_new (NULL, private->thumb_cancellable,
+                     gimp_imagefile_thumb_callback,
+                     imagefile);
+
+  g_task_set_task_data (task, data, gimp_imagefile_thumb_data_free);
+  g_task_run_in_thread (task, gimp_imagefile_thumb_thread);
+
+  g_object_unref (task);
+
+  return NULL;
 }
 
 static gchar *
@@ -817,20 +907,19 @@ gimp_imagefile_get_desc_string (GimpImagefile *imagefile)
   return (const gchar *) private->description;
 }
 
+/*  called from a worker thread, only touches @thumbnail  */
 static GdkPixbuf *
-gimp_imagefile_load_thumb (GimpImagefile *imagefile,
-                           gint           width,
-                           gint           height)
+gimp_imagefile_load_thumb (GimpThumbnail  *thumbnail,
+                           gint            width,
+                           gint            height,
+                           GError        **error)
 {
-  GimpImagefilePrivate *private   = GET_PRIVATE (imagefile);
-  GimpThumbnail        *thumbnail = private->thumbnail;
-  GdkPixbuf            *pixbuf    = NULL;
-  GError               *error     = NULL;
-  gint                  size      = MAX (width, height);
-  gint                  pixbuf_width;
-  gint                  pixbuf_height;
-  gint                  preview_width;
-  gint                  preview_height;
+  GdkPixbuf *pixbuf = NULL;
+  gint       size   = MAX (width, height);
+  gint       pixbuf_width;
+  gint       pixbuf_height;
+  gint       preview_width;
+  gint       preview_height;
 
   if (gimp_thumbnail_peek_thumb (thumbnail, size) < GIMP_THUMB_STATE_EXISTS)
     return NULL;
@@ -838,20 +927,10 @@ gimp_imagefile_load_thumb (GimpImagefile *imagefile,
   if (thumbnail->image_state == GIMP_THUMB_STATE_NOT_FOUND)
     return NULL;
 
-  pixbuf = gimp_thumbnail_load_thumb (thumbnail, size, &error);
+  pixbuf = gimp_thumbnail_load_thumb (thumbnail, size, error);
 
   if (! pixbuf)
-    {
-      if (error)
-        {
-          gimp_message (private->gimp, NULL, GIMP_MESSAGE_ERROR,
-                        _("Could not open thumbnail '%s': %s"),
-                        thumbnail->thumb_filename, error->message);
-          g_clear_error (&error);
-        }
-
-      return NULL;
-    }
+    return NULL;
 
   pixbuf_width  = gdk_pixbuf_get_width  (pixbuf);
   pixbuf_height = gdk_pixbuf_get_height (pixbuf);
@@ -897,6 +976,148 @@ gimp_imagefile_load_thumb (GimpImagefile *imagefile,
   return pixbuf;
 }
 
+static void
+gimp_imagefile_cancel_thumb (GimpImagefile *imagefile)
+{
+  GimpImagefilePrivate *private = GET_PRIVATE (imagefile);
+
+  if (private->thumb_cancellable)
+    {
+      g_cancellable_cancel (private->thumb_cancellable);
+      g_object_unref (private->thumb_cancellable);
+      private->thumb_cancellable = NULL;
+    }
+
+  if (private->thumb_pixbuf)
+    {
+      g_object_unref (private->thumb_pixbuf);
+      private->thumb_pixbuf = NULL;
+    }
+
+  private->thumb_width  = 0;
+  private->thumb_height = 0;
+  private->thumb_loaded = FALSE;
+}
+
+static void
+gimp_imagefile_thumb_thread (GTask        *task,
+                             gpointer      source_object,
+                             gpointer      task_data,
+                             GCancellable *cancellable)
+{
+  GimpImagefileThumbData *data   = task_data;
+  GdkPixbuf              *pixbuf;
+  GError                 *error  = NULL;
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  pixbuf = gimp_imagefile_load_thumb (data->thumbnail,
+                                      data->width, data->height,
+                                      &error);
+
+  if (error)
+    g_task_return_error (task, error);
+  else
+    g_task_return_pointer (task, pixbuf, g_object_unref);
+}
+
+static void
+gimp_imagefile_thumb_callback (GObject      *source_object,
+                               GAsyncResult *result,
+                               gpointer      data)
+{
+  GimpImagefile          *imagefile;
+  GimpImagefilePrivate   *private;
+  GimpImagefileThumbData *thumb_data;
+  GdkPixbuf              *pixbuf;
+  GError                 *error = NULL;
+
+  pixbuf = g_task_propagate_pointer (G_TASK (result), &error);
+
+  /*  we were cancelled because the imagefile changed or is gone,
+   *  bail out
+   */
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      g_clear_error (&error);
+      return;
+    }
+
+  imagefile  = GIMP_IMAGEFILE (data);
+  private    = GET_PRIVATE (imagefile);
+  thumb_data = g_task_get_task_data (G_TASK (result));
+
+  g_object_unref (private->thumb_cancellable);
+  private->thumb_cancellable = NULL;
+
+  if (error)
+    {
+      gimp_message (private->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    _("Could not open thumbnail '%s': %s"),
+                    thumb_data->thumbnail->thumb_filename, error->message);
+      g_clear_error (&error);
+    }
+
+  /*  pick up what loading the thumbnail found out about the image  */
+  gimp_imagefile_copy_thumb_info (private->thumbnail, thumb_data->thumbnail);
+
+  /*  this resets the thumbnail state, so do it first  */
+  if (pixbuf)
+    gimp_viewable_invalidate_preview (GIMP_VIEWABLE (imagefile));
+
+  private->thumb_pixbuf = pixbuf;
+  private->thumb_width  = thumb_data->width;
+  private->thumb_height = thumb_data->height;
+  private->thumb_loaded = TRUE;
+}
+
+static void
+gimp_imagefile_thumb_data_free (gpointer data)
+{
+  GimpImagefileThumbData *thumb_data = data;
+
+  g_object_unref (thumb_data->thumbnail);
+
+  g_slice_free (GimpImagefileThumbData, thumb_data);
+}
+
+static void
+gimp_imagefile_copy_thumb_info (GimpThumbnail *dest,
+                                GimpThumbnail *src)
+{
+  static const gchar *names[] = { "image-state",
+                                  "image-mtime",
+                                  "image-filesize",
+                                  "image-mimetype",
+                                  "image-width",
+                                  "image-height",
+                                  "image-type",
+                                  "image-num-layers",
+                                  "thumb-state" };
+  gint                i;
+
+  g_object_freeze_notify (G_OBJECT (dest));
+
+  for (i = 0; i < G_N_ELEMENTS (names); i++)
+    {
+      GParamSpec *pspec;
+      GValue      value = G_VALUE_INIT;
+
+      pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (src),
+                                            names[i]);
+
+      g_value_init (&value, G_PARAM_SPEC_VALUE_TYPE (pspec));
+
+      g_object_get_property (G_OBJECT (src),  names[i], &value);
+      g_object_set_property (G_OBJECT (dest), names[i], &value);
+
+      g_value_unset (&value);
+    }
+
+  g_object_thaw_notify (G_OBJECT (dest));
+}
+
 static gboolean
 gimp_imagefile_save_thumb (GimpImagefile  *imagefile,
                            GimpImage      *image,
@@ -49,6 +49,12 @@
 #include "gimpprogress.h"
 
 
+/*  pending updates are applied before the projection renders anything,
+ *  and before GTK+ redraws the dialog that caused them
+ */
+#define GIMP_IMAGE_MAP_APPLY_PRIORITY G_PRIORITY_HIGH_IDLE
+
+
 enum
 {
   FLUSH,
@@ -73,12 +79,22 @@ struct _GimpImageMap
   GeglNode           *translate;
   GeglNode           *crop;
   GimpApplicator     *applicator;
+
+  guint               apply_idle_id;
+  gboolean            apply_all;
+  GeglRectangle       apply_area;
 };
 
 
 static void       gimp_image_map_dispose         (GObject             *object);
 static void       gimp_image_map_finalize        (GObject             *object);
 
+static void       gimp_image_map_real_apply      (GimpImageMap        *image_map,
+                                                  const GeglRectangle *area);
+static gboolean   gimp_image_map_apply_idle      (GimpImageMap        *image_map);
+static void       gimp_image_map_flush_apply     (GimpImageMap        *image_map);
+static void       gimp_image_map_cancel_apply    (GimpImageMap        *image_map);
+
 static gboolean   gimp_image_map_add_filter      (GimpImageMap        *image_map);
 static gboolean   gimp_image_map_remove_filter   (GimpImageMap        *image_map);
 static void       gimp_image_map_update_drawable (GimpImageMap        *image_map,
@@ -122,6 +138,8 @@ gimp_image_map_dispose (GObject *object)
 {
   GimpImageMap *image_map = GIMP_IMAGE_MAP (object);
 
+  gimp_image_map_cancel_apply (image_map);
+
   if (image_map->drawable)
     gimp_viewable_preview_thaw (GIMP_VIEWABLE (image_map->drawable));
 
@@ -206,17 +224,82 @@ gimp_image_map_set_region (GimpImageMap       *image_map,
   image_map->region = region;
 }
 
+/*  Doesn't apply the changes right away, but merges them with the
+ *  other pending changes; a slider that is being dragged only causes
+ *  one update per main loop iteration.  The projection then renders
+ *  the visible part first, and the parts that haven't been rendered
+ *  yet when the next change arrives are only rendered once.
+ */
 void
 gimp_image_map_apply (GimpImageMap        *image_map,
                       const GeglRectangle *area)
+{
+  g_return_if_fail (GIMP_IS_IMAGE_MAP (image_map));
+
+  if (! area)
+    {
+      image_map->apply_all = TRUE;
+    }
+  else if (! image_map->apply_all)
+    {
+      if (gegl_rectangle_is_empty (&image_map->apply_area))
+        image_map->apply_area = *area;
+      else
+        gegl_rectangle_bounding_box (&image_map->apply_area,
+                                     &image_map->apply_area, area);
+    }
+
+  if (! image_map->apply_idle_id)
+    image_map->apply_idle_id =
+      g_idle_add_full (GIMP_IMAGE_MAP_APPLY_PRIORITY,
+                       (GSourceFunc) gimp_image_map_apply_idle,
+                       image_map, NULL);
+}
+
+void
+gimp_image_map_commit (GimpImageMap *image_map,
+                       GimpProgress *progress)
+{
+  g_return_if_fail (GIMP_IS_IMAGE_MAP (image_map));
+  g_return_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress));
+
+  gimp_image_map_flush_apply (image_map);
+
+  if (gimp_image_map_remove_filter (image_map))
+    {
+      gimp_drawable_merge_filter (image_map->drawable, image_map->filter,
+                                  progress,
+                                  image_map->undo_desc);
+
+      g_signal_emit (image_map, image_map_signals[FLUSH], 0);
+    }
+}
+
+void
+gimp_image_map_abort (GimpImageMap *image_map)
+{
+  g_return_if_fail (GIMP_IS_IMAGE_MAP (image_map));
+
+  gimp_image_map_cancel_apply (image_map);
+
+  if (gimp_image_map_remove_filter (image_map))
+    {
+      gimp_image_map_update_drawable (image_map, &image_map->filter_area);
+    }
+}
+
+
+/*  private functions  */
+
+static void
+gimp_image_map_real_apply (GimpImageMap        *image_map,
+                           const GeglRectangle *area)
 {
   GimpImage         *image;
   GimpChannel       *mask;
   GeglRectangle      update_area;
   GimpComponentMask  active_mask;
 
-  g_return_if_fail (GIMP_IS_IMAGE_MAP (image_map));
-
   /*  Make sure the drawable is still valid  */
   if (! gimp_item_is_attached (GIMP_ITEM (image_map->drawable)))
     {
@@ -406,36 +489,42 @@ gimp_image_map_apply (GimpImageMap        *image_map,
   gimp_image_map_update_drawable (image_map, &update_area);
 }
 
-void
-gimp_image_map_commit (GimpImageMap *image_map,
-                       GimpProgress *progress)
+static gboolean
+gimp_image_map_apply_idle (GimpImageMap *image_map)
 {
-  g_return_if_fail (GIMP_IS_IMAGE_MAP (image_map));
-  g_return_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress));
+  image_map->apply_idle_id = 0;
 
-  if (gimp_image_map_remove_filter (image_map))
-    {
-      gimp_drawable_merge_filter (image_map->drawable, image_map->filter,
-                                  progress,
-                                  image_map->undo_desc);
+  gimp_image_map_flush_apply (image_map);
 
-      g_signal_emit (image_map, image_map_signals[FLUSH], 0);
-    }
+  return FALSE;
 }
 
-void
-gimp_image_map_abort (GimpImageMap *image_map)
+/*  applies the pending changes right away  */
+static void
+gimp_image_map_flush_apply (GimpImageMap *image_map)
 {
-  g_return_if_fail (GIMP_IS_IMAGE_MAP (image_map));
+  GeglRectangle area    = image_map->apply_area;
+  gboolean      all     = image_map->apply_all;
+  gboolean      pending = all || ! gegl_rectangle_is_empty (&area);
 
-  if (gimp_image_map_remove_filter (image_map))
-    {
-      gimp_image_map_update_drawable (image_map, &image_map->filter_area);
-    }
+  gimp_image_map_cancel_apply (image_map);
+
+  if (pending)
+    gimp_image_map_real_apply (image_map, all ? NULL : &area);
 }
 
+static void
+gimp_image_map_cancel_apply (GimpImageMap *image_map)
+{
+  if (image_map->apply_idle_id)
+    {
+      g_source_remove (image_map->apply_idle_id);
+      image_map->apply_idle_id = 0;
+    }
 
-/*  private functions  */
+  image_map->apply_all = FALSE;
+  gegl_rectangle_set (&image_map->apply_area, 0, 0, 0, 0);
+}
 
 static gboolean
 gimp_image_map_add_filter (GimpImageMap *image_map)
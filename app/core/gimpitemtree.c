@@ -56,6 +56,9 @@ struct _GimpItemTreePrivate
   GimpItem   *active_item;
 
   GHashTable *name_hash;
+
+  /*  base name -> first number n for which "base #n" might be free  */
+  GHashTable *name_numbers;
 };
 
 #define GIMP_ITEM_TREE_GET_PRIVATE(object) \
@@ -83,6 +86,10 @@ static gint64   gimp_item_tree_get_memsize   (GimpObject   *object,
 static void     gimp_item_tree_uniquefy_name (GimpItemTree *tree,
                                               GimpItem     *item,
                                               const gchar  *new_name);
+static gchar  * gimp_item_tree_split_name    (const gchar  *name,
+                                              gint         *number);
+static void     gimp_item_tree_remove_name   (GimpItemTree *tree,
+                                              const gchar  *name);
 
 
 G_DEFINE_TYPE (GimpItemTree, gimp_item_tree, GIMP_TYPE_OBJECT)
@@ -138,7 +145,9 @@ gimp_item_tree_init (GimpItemTree *tree)
 {
   GimpItemTreePrivate *private = GIMP_ITEM_TREE_GET_PRIVATE (tree);
 
-  private->name_hash = g_hash_table_new (g_str_hash, g_str_equal);
+  private->name_hash    = g_hash_table_new (g_str_hash, g_str_equal);
+  private->name_numbers = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                 g_free, NULL);
 }
 
 static void
@@ -173,6 +182,12 @@ gimp_item_tree_finalize (GObject *object)
       private->name_hash = NULL;
     }
 
+  if (private->name_numbers)
+    {
+      g_hash_table_unref (private->name_numbers);
+      private->name_numbers = NULL;
+    }
+
   if (tree->container)
     {
       g_object_unref (tree->container);
@@ -476,8 +491,7 @@ gimp_item_tree_remove_item (GimpItemTree *tree,
 
   g_object_ref (item);
 
-  g_hash_table_remove (private->name_hash,
-                       gimp_object_get_name (item));
+  gimp_item_tree_remove_name (tree, gimp_object_get_name (item));
 
   children = gimp_viewable_get_children (GIMP_VIEWABLE (item));
 
@@ -487,8 +501,8 @@ gimp_item_tree_remove_item (GimpItemTree *tree,
 
       while (list)
         {
-          g_hash_table_remove (private->name_hash,
-                               gimp_object_get_name (list->data));
+          gimp_item_tree_remove_name (tree,
+                                      gimp_object_get_name (list->data));
 
           list = g_list_remove (list, list->data);
         }
@@ -639,8 +653,7 @@ gimp_item_tree_uniquefy_name (GimpItemTree *tree,
 
   if (new_name)
     {
-      g_hash_table_remove (private->name_hash,
-                           gimp_object_get_name (item));
+      gimp_item_tree_remove_name (tree, gimp_object_get_name (item));
 
       gimp_object_set_name (GIMP_OBJECT (item), new_name);
     }
@@ -648,31 +661,28 @@ gimp_item_tree_uniquefy_name (GimpItemTree *tree,
   if (g_hash_table_lookup (private->name_hash,
                            gimp_object_get_name (item)))
     {
-      gchar *name     = g_strdup (gimp_object_get_name (item));
-      gchar *ext      = strrchr (name, '#');
-      gchar *new_name = NULL;
-      gint   number   = 0;
-
-      if (ext)
-        {
-          gchar ext_str[8];
+      gchar    *new_name = NULL;
+      gchar    *name;
+      gint      number;
+      gint      first_free;
+      gboolean  contiguous = FALSE;
 
-          number = atoi (ext + 1);
+      name = gimp_item_tree_split_name (gimp_object_get_name (item), &number);
 
-          g_snprintf (ext_str, sizeof (ext_str), "%d", number);
-
-          /*  check if the extension really is of the form "#<n>"  */
-          if (! strcmp (ext_str, ext + 1))
-            {
-              if (ext > name && *(ext - 1) == ' ')
-                ext--;
+      /*  all numbers below first_free are taken, so don't try them
+       *  again when adding many items with the same name
+       */
+      first_free = GPOINTER_TO_INT (g_hash_table_lookup (private->name_numbers,
+                                                         name));
 
-              *ext = '\0';
-            }
-          else
-            {
-              number = 0;
-            }
+      if (number + 1 <= first_free)
+        {
+          number     = first_free - 1;
+          contiguous = TRUE;
+        }
+      else if (number == 0)
+        {
+          contiguous = TRUE;
         }
 
       do
@@ -685,6 +695,10 @@ gimp_item_tree_uniquefy_name (GimpItemTree *tree,
         }
       while (g_hash_table_lookup (private->name_hash, new_name));
 
+      if (contiguous)
+        g_hash_table_insert (private->name_numbers,
+                             g_strdup (name), GINT_TO_POINTER (number + 1));
+
       g_free (name);
 
       gimp_object_take_name (GIMP_OBJECT (item), new_name);
@@ -694,3 +708,66 @@ gimp_item_tree_uniquefy_name (GimpItemTree *tree,
                        (gpointer) gimp_object_get_name (item),
                        item);
 }
+
+/*  returns the name without a " #<n>" extension, and n in @number,
+ *  or 0 if there is no such extension
+ */
+static gchar *
+gimp_item_tree_split_name (const gchar *name,
+                           gint        *number)
+{
+  gchar *base = g_strdup (name);
+  gchar *ext  = strrchr (base, '#');
+
+  *number = 0;
+
+  if (ext)
+    {
+      gchar ext_str[8];
+
+      *number = atoi (ext + 1);
+
+      g_snprintf (ext_str, sizeof (ext_str), "%d", *number);
+
+      /*  check if the extension really is of the form "#<n>"  */
+      if (! strcmp (ext_str, ext + 1))
+        {
+          if (ext > base && *(ext - 1) == ' ')
+            ext--;
+
+          *ext = '\0';
+        }
+      else
+        {
+          *number = 0;
+        }
+    }
+
+  return base;
+}
+
+static void
+gimp_item_tree_remove_name (GimpItemTree *tree,
+                            const gchar  *name)
+{
+  GimpItemTreePrivate *private = GIMP_ITEM_TREE_GET_PRIVATE (tree);
+  gchar               *base;
+  gint                 number;
+
+  g_hash_table_remove (private->name_hash, name);
+
+  base = gimp_item_tree_split_name (name, &number);
+
+  /*  the number is free again  */
+  if (number > 0 &&
+      number < GPOINTER_TO_INT (g_hash_table_lookup (private->name_numbers,
+                                                     base)))
+    {
+      g_hash_table_insert (private->name_numbers,
+                           base, GINT_TO_POINTER (number));
+    }
+  else
+    {
+      g_free (base);
+    }
+}
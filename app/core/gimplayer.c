@@ -31,6 +31,7 @@
 #include "core-types.h"
 
 #include "gegl/gimp-gegl-apply-operation.h"
+#include "gegl/gimp-gegl-loops.h"
 #include "gegl/gimp-gegl-nodes.h"
 
 #include "gimpboundary.h"
@@ -1019,8 +1020,8 @@ gimp_layer_convert_type (GimpDrawable      *drawable,
 
   if (layer_dither_type == 0)
     {
-      gegl_buffer_copy (gimp_drawable_get_buffer (drawable), NULL,
-                        dest_buffer, NULL);
+      gimp_gegl_copy (gimp_drawable_get_buffer (drawable), NULL,
+                      dest_buffer, NULL);
     }
   else
     {
@@ -1546,7 +1547,7 @@ gimp_layer_create_mask (const GimpLayer *layer,
                               GEGL_RECTANGLE (copy_x - offset_x, copy_y - offset_y,
                                               0, 0));
 
-            GIMP_CHANNEL (mask)->bounds_known = FALSE;
+            gimp_channel_invalidate_bounds (GIMP_CHANNEL (mask), NULL);
           }
       }
       break;
@@ -1597,7 +1598,7 @@ gimp_layer_create_mask (const GimpLayer *layer,
         g_object_unref (src_buffer);
       }
 
-      GIMP_CHANNEL (mask)->bounds_known = FALSE;
+      gimp_channel_invalidate_bounds (GIMP_CHANNEL (mask), NULL);
       break;
     }
 
@@ -1669,13 +1670,21 @@ gimp_layer_apply_mask (GimpLayer         *layer,
                                  gimp_item_get_width  (item),
                                  gimp_item_get_height (item));
 
-      /*  Combine the current layer's alpha channel and the mask  */
+      /*  Combine the current layer's alpha channel and the mask,
+       *  in place, skipping the parts where the mask is opaque
+       */
       mask_buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (mask));
       dest_buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
 
-      gimp_gegl_apply_opacity (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
-                               NULL, NULL, dest_buffer,
-                               mask_buffer, 0, 0, 1.0);
+      gimp_gegl_apply_mask (mask_buffer,
+                            GEGL_RECTANGLE (0, 0,
+                                            gimp_item_get_width  (item),
+                                            gimp_item_get_height (item)),
+                            dest_buffer,
+                            GEGL_RECTANGLE (0, 0,
+                                            gimp_item_get_width  (item),
+                                            gimp_item_get_height (item)),
+                            1.0);
     }
 
   g_signal_handlers_disconnect_by_func (mask,
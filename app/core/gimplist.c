@@ -21,12 +21,13 @@
 #include "config.h"
 
 #include <stdlib.h>
-#include <string.h> /* strcmp */
+#include <string.h> /* memmove, strcmp */
 
 #include <glib-object.h>
 
 #include "core-types.h"
 
+#include "gimp-utils.h"
 #include "gimplist.h"
 
 
@@ -39,6 +40,7 @@ enum
 };
 
 
+static void         gimp_list_finalize           (GObject             *object);
 static void         gimp_list_set_property       (GObject             *object,
                                                   guint                property_id,
                                                   const GValue        *value,
@@ -71,6 +73,27 @@ static GimpObject * gimp_list_get_child_by_index (const GimpContainer *container
 static gint         gimp_list_get_child_index    (const GimpContainer *container,
                                                   const GimpObject    *object);
 
+static void         gimp_list_array_insert       (GimpList            *list,
+                                                  GimpObject          *object,
+                                                  gint                 index);
+static void         gimp_list_array_remove       (GimpList            *list,
+                                                  gint                 index);
+static void         gimp_list_array_rebuild      (GimpList            *list);
+static gint         gimp_list_get_position       (GimpList            *list,
+                                                  const GimpObject    *object);
+static gint         gimp_list_get_sort_position  (GimpList            *list,
+                                                  GimpObject          *object);
+
+static void         gimp_list_names_add          (GimpList            *list,
+                                                  GimpObject          *object);
+static void         gimp_list_names_remove       (GimpList            *list,
+                                                  GimpObject          *object);
+static void         gimp_list_names_invalidate   (GimpList            *list);
+static void         gimp_list_names_validate     (GimpList            *list);
+static gboolean     gimp_list_name_taken         (GimpList            *list,
+                                                  GimpObject          *object,
+                                                  const gchar         *name);
+
 static void         gimp_list_uniquefy_name      (GimpList            *gimp_list,
                                                   GimpObject          *object);
 static void         gimp_list_object_renamed     (GimpObject          *object,
@@ -89,6 +112,7 @@ gimp_list_class_init (GimpListClass *klass)
   GimpObjectClass    *gimp_object_class = GIMP_OBJECT_CLASS (klass);
   GimpContainerClass *container_class   = GIMP_CONTAINER_CLASS (klass);
 
+  object_class->finalize              = gimp_list_finalize;
   object_class->set_property          = gimp_list_set_property;
   object_class->get_property          = gimp_list_get_property;
 
@@ -128,10 +152,44 @@ gimp_list_class_init (GimpListClass *klass)
 static void
 gimp_list_init (GimpList *list)
 {
-  list->list         = NULL;
-  list->unique_names = FALSE;
-  list->sort_func    = NULL;
-  list->append       = FALSE;
+  list->list              = NULL;
+  list->unique_names      = FALSE;
+  list->sort_func         = NULL;
+  list->append            = FALSE;
+
+  list->array             = g_ptr_array_new ();
+  list->positions         = g_hash_table_new (g_direct_hash, g_direct_equal);
+  list->n_valid_positions = 0;
+  list->names             = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                                   g_free,
+                                                   (GDestroyNotify) g_slist_free);
+  list->names_valid       = TRUE;
+}
+
+static void
+gimp_list_finalize (GObject *object)
+{
+  GimpList *list = GIMP_LIST (object);
+
+  if (list->array)
+    {
+      g_ptr_array_free (list->array, TRUE);
+      list->array = NULL;
+    }
+
+  if (list->positions)
+    {
+      g_hash_table_unref (list->positions);
+      list->positions = NULL;
+    }
+
+  if (list->names)
+    {
+      g_hash_table_unref (list->names);
+      list->names = NULL;
+    }
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 static void
@@ -194,7 +252,10 @@ gimp_list_get_memsize (GimpObject *object,
   gint64    memsize = 0;
 
   memsize += (gimp_container_get_n_children (GIMP_CONTAINER (list)) *
-              sizeof (GList));
+              (sizeof (GList) + sizeof (gpointer)));
+
+  memsize += gimp_g_hash_table_get_memsize (list->positions, 0);
+  memsize += gimp_g_hash_table_get_memsize (list->names, sizeof (GSList));
 
   if (gimp_container_get_policy (GIMP_CONTAINER (list)) ==
       GIMP_CONTAINER_POLICY_STRONG)
@@ -214,21 +275,29 @@ gimp_list_add (GimpContainer *container,
                GimpObject    *object)
 {
   GimpList *list = GIMP_LIST (container);
+  gint      index;
 
   if (list->unique_names)
     gimp_list_uniquefy_name (list, object);
 
-  if (list->unique_names || list->sort_func)
-    g_signal_connect (object, "name-changed",
-                      G_CALLBACK (gimp_list_object_renamed),
-                      list);
+  g_signal_connect (object, "name-changed",
+                    G_CALLBACK (gimp_list_object_renamed),
+                    list);
 
   if (list->sort_func)
-    list->list = g_list_insert_sorted (list->list, object, list->sort_func);
+    index = gimp_list_get_sort_position (list, object);
   else if (list->append)
+    index = list->array->len;
+  else
+    index = 0;
+
+  if (index == list->array->len)
     list->list = g_list_append (list->list, object);
   else
-    list->list = g_list_prepend (list->list, object);
+    list->list = g_list_insert (list->list, object, index);
+
+  gimp_list_array_insert (list, object, index);
+  gimp_list_names_add (list, object);
 
   GIMP_CONTAINER_CLASS (parent_class)->add (container, object);
 }
@@ -239,10 +308,12 @@ gimp_list_remove (GimpContainer *container,
 {
   GimpList *list = GIMP_LIST (container);
 
-  if (list->unique_names || list->sort_func)
-    g_signal_handlers_disconnect_by_func (object,
-                                          gimp_list_object_renamed,
-                                          list);
+  g_signal_handlers_disconnect_by_func (object,
+                                        gimp_list_object_renamed,
+                                        list);
+
+  gimp_list_names_remove (list, object);
+  gimp_list_array_remove (list, gimp_list_get_position (list, object));
 
   list->list = g_list_remove (list->list, object);
 
@@ -256,13 +327,20 @@ gimp_list_reorder (GimpContainer *container,
 {
   GimpList *list = GIMP_LIST (container);
 
+  gimp_list_array_remove (list, gimp_list_get_position (list, object));
+
   list->list = g_list_remove (list->list, object);
 
   if (new_index == -1 ||
       new_index == gimp_container_get_n_children (container) - 1)
+    new_index = list->array->len;
+
+  if (new_index == list->array->len)
     list->list = g_list_append (list->list, object);
   else
     list->list = g_list_insert (list->list, object, new_index);
+
+  gimp_list_array_insert (list, object, new_index);
 }
 
 static void
@@ -280,7 +358,7 @@ gimp_list_have (const GimpContainer *container,
 {
   GimpList *list = GIMP_LIST (container);
 
-  return g_list_find (list->list, object) ? TRUE : FALSE;
+  return g_hash_table_lookup_extended (list->positions, object, NULL, NULL);
 }
 
 static void
@@ -297,18 +375,34 @@ static GimpObject *
 gimp_list_get_child_by_name (const GimpContainer *container,
                              const gchar         *name)
 {
-  GimpList *list = GIMP_LIST (container);
-  GList    *glist;
+  GimpList   *list = GIMP_LIST (container);
+  GSList     *objects;
+  GimpObject *first;
+  gint        first_index;
 
-  for (glist = list->list; glist; glist = g_list_next (glist))
+  gimp_list_names_validate (list);
+
+  objects = g_hash_table_lookup (list->names, name);
+
+  if (! objects)
+    return NULL;
+
+  /*  with duplicate names, return the one that comes first  */
+  first       = objects->data;
+  first_index = gimp_list_get_position (list, first);
+
+  for (objects = objects->next; objects; objects = g_slist_next (objects))
     {
-      GimpObject *object = glist->data;
+      gint index = gimp_list_get_position (list, objects->data);
 
-      if (! strcmp (gimp_object_get_name (object), name))
-        return object;
+      if (index < first_index)
+        {
+          first       = objects->data;
+          first_index = index;
+        }
     }
 
-  return NULL;
+  return first;
 }
 
 static GimpObject *
@@ -316,12 +410,9 @@ gimp_list_get_child_by_index (const GimpContainer *container,
                               gint                 index)
 {
   GimpList *list = GIMP_LIST (container);
-  GList    *glist;
-
-  glist = g_list_nth (list->list, index);
 
-  if (glist)
-    return (GimpObject *) glist->data;
+  if (index >= 0 && index < list->array->len)
+    return g_ptr_array_index (list->array, index);
 
   return NULL;
 }
@@ -332,7 +423,7 @@ gimp_list_get_child_index (const GimpContainer *container,
 {
   GimpList *list = GIMP_LIST (container);
 
-  return g_list_index (list->list, (gpointer) object);
+  return gimp_list_get_position (list, object);
 }
 
 /**
@@ -418,6 +509,7 @@ gimp_list_reverse (GimpList *list)
     {
       gimp_container_freeze (GIMP_CONTAINER (list));
       list->list = g_list_reverse (list->list);
+      gimp_list_array_rebuild (list);
       gimp_container_thaw (GIMP_CONTAINER (list));
     }
 }
@@ -482,6 +574,7 @@ gimp_list_sort (GimpList     *list,
     {
       gimp_container_freeze (GIMP_CONTAINER (list));
       list->list = g_list_sort (list->list, sort_func);
+      gimp_list_array_rebuild (list);
       gimp_container_thaw (GIMP_CONTAINER (list));
     }
 }
@@ -503,28 +596,228 @@ gimp_list_sort_by_name (GimpList *list)
 
 /*  private functions  */
 
+/*  The array holds the children in the same order as list->list.
+ *  list->positions maps every child to its index in the array, but
+ *  only the indices below n_valid_positions are known to be right,
+ *  the others are recomputed when one of them is needed.
+ */
 static void
-gimp_list_uniquefy_name (GimpList   *gimp_list,
-                         GimpObject *object)
+gimp_list_array_insert (GimpList   *list,
+                        GimpObject *object,
+                        gint        index)
 {
-  gchar *name = (gchar *) gimp_object_get_name (object);
-  GList *list;
+  GPtrArray *array = list->array;
 
-  if (! name)
+  g_ptr_array_add (array, NULL);
+
+  memmove (array->pdata + index + 1,
+           array->pdata + index,
+           (array->len - 1 - index) * sizeof (gpointer));
+
+  array->pdata[index] = object;
+
+  g_hash_table_insert (list->positions, object, GINT_TO_POINTER (index));
+
+  /*  the children after @index moved, their positions are stale now,
+   *  unless @object was appended
+   */
+  if (list->n_valid_positions == index && index == array->len - 1)
+    list->n_valid_positions = index + 1;
+  else
+    list->n_valid_positions = MIN (list->n_valid_positions, index);
+}
+
+static void
+gimp_list_array_remove (GimpList *list,
+                        gint      index)
+{
+  g_return_if_fail (index >= 0 && index < list->array->len);
+
+  g_hash_table_remove (list->positions,
+                       g_ptr_array_index (list->array, index));
+
+  g_ptr_array_remove_index (list->array, index);
+
+  list->n_valid_positions = MIN (list->n_valid_positions, index);
+}
+
+static void
+gimp_list_array_rebuild (GimpList *list)
+{
+  GList *glist;
+
+  g_ptr_array_set_size (list->array, 0);
+
+  for (glist = list->list; glist; glist = g_list_next (glist))
+    g_ptr_array_add (list->array, glist->data);
+
+  list->n_valid_positions = 0;
+}
+
+static gint
+gimp_list_get_position (GimpList         *list,
+                        const GimpObject *object)
+{
+  GPtrArray *array = list->array;
+  gpointer   value;
+  gint       index;
+
+  if (! g_hash_table_lookup_extended (list->positions, object, NULL, &value))
+    return -1;
+
+  index = GPOINTER_TO_INT (value);
+
+  if (index < list->n_valid_positions)
+    return index;
+
+  /*  an old index is often still right  */
+  if (index < array->len && array->pdata[index] == object)
+    return index;
+
+  for (index = list->n_valid_positions; index < array->len; index++)
+    g_hash_table_insert (list->positions,
+                         array->pdata[index], GINT_TO_POINTER (index));
+
+  list->n_valid_positions = array->len;
+
+  return GPOINTER_TO_INT (g_hash_table_lookup (list->positions, object));
+}
+
+/*  returns the index in front of the first child that doesn't sort
+ *  before @object, like g_list_insert_sorted() does
+ */
+static gint
+gimp_list_get_sort_position (GimpList   *list,
+                             GimpObject *object)
+{
+  gint lower = 0;
+  gint upper = list->array->len;
+
+  while (lower < upper)
+    {
+      gint middle = (lower + upper) / 2;
+
+      if (list->sort_func (object,
+                           g_ptr_array_index (list->array, middle)) > 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  return lower;
+}
+
+/*  list->names maps each name to the children that have it, it is
+ *  thrown away when a child is renamed and built again when needed
+ */
+static void
+gimp_list_names_add (GimpList   *list,
+                     GimpObject *object)
+{
+  const gchar *name = gimp_object_get_name (object);
+  GSList      *objects;
+
+  if (! list->names_valid || ! name)
     return;
 
-  for (list = gimp_list->list; list; list = g_list_next (list))
+  objects = g_hash_table_lookup (list->names, name);
+
+  /*  keep the first link, the table owns it  */
+  if (objects)
+    objects->next = g_slist_prepend (objects->next, object);
+  else
+    g_hash_table_insert (list->names,
+                         g_strdup (name), g_slist_prepend (NULL, object));
+}
+
+static void
+gimp_list_names_remove (GimpList   *list,
+                        GimpObject *object)
+{
+  const gchar *name = gimp_object_get_name (object);
+  GSList      *objects;
+
+  if (! list->names_valid || ! name)
+    return;
+
+  objects = g_hash_table_lookup (list->names, name);
+
+  if (! objects)
+    return;
+
+  if (objects->data != object)
+    {
+      objects->next = g_slist_remove (objects->next, object);
+    }
+  else if (objects->next)
     {
-      GimpObject  *object2 = list->data;
-      const gchar *name2   = gimp_object_get_name (object2);
+      GSList *next = objects->next;
 
-      if (object != object2 &&
-          name2             &&
-          ! strcmp (name, name2))
-        break;
+      objects->data = next->data;
+      objects->next = next->next;
+
+      g_slist_free_1 (next);
     }
+  else
+    {
+      g_hash_table_remove (list->names, name);
+    }
+}
 
-  if (list)
+static void
+gimp_list_names_invalidate (GimpList *list)
+{
+  if (list->names_valid)
+    {
+      g_hash_table_remove_all (list->names);
+      list->names_valid = FALSE;
+    }
+}
+
+static void
+gimp_list_names_validate (GimpList *list)
+{
+  GList *glist;
+
+  if (list->names_valid)
+    return;
+
+  list->names_valid = TRUE;
+
+  for (glist = list->list; glist; glist = g_list_next (glist))
+    gimp_list_names_add (list, glist->data);
+}
+
+static gboolean
+gimp_list_name_taken (GimpList    *list,
+                      GimpObject  *object,
+                      const gchar *name)
+{
+  GSList *objects;
+
+  gimp_list_names_validate (list);
+
+  for (objects = g_hash_table_lookup (list->names, name);
+       objects;
+       objects = g_slist_next (objects))
+    {
+      if (objects->data != object)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+static void
+gimp_list_uniquefy_name (GimpList   *gimp_list,
+                         GimpObject *object)
+{
+  gchar *name = (gchar *) gimp_object_get_name (object);
+
+  if (! name)
+    return;
+
+  if (gimp_list_name_taken (gimp_list, object, name))
     {
       gchar *ext;
       gchar *new_name   = NULL;
@@ -563,19 +856,8 @@ gimp_list_uniquefy_name (GimpList   *gimp_list,
           g_free (new_name);
 
           new_name = g_strdup_printf ("%s #%d", name, unique_ext);
-
-          for (list = gimp_list->list; list; list = g_list_next (list))
-            {
-              GimpObject  *object2 = list->data;
-              const gchar *name2   = gimp_object_get_name (object2);
-
-              if (object != object2 &&
-                  name2             &&
-                  ! strcmp (new_name, name2))
-                break;
-            }
         }
-      while (list);
+      while (gimp_list_name_taken (gimp_list, object, new_name));
 
       g_free (name);
 
@@ -587,6 +869,9 @@ static void
 gimp_list_object_renamed (GimpObject *object,
                           GimpList   *list)
 {
+  /*  the old name is gone, so look up the names again when needed  */
+  gimp_list_names_invalidate (list);
+
   if (list->unique_names)
     {
       g_signal_handlers_block_by_func (object,
@@ -598,6 +883,8 @@ gimp_list_object_renamed (GimpObject *object,
       g_signal_handlers_unblock_by_func (object,
                                          gimp_list_object_renamed,
                                          list);
+
+      gimp_list_names_invalidate (list);
     }
 
   if (list->sort_func)
@@ -606,7 +893,7 @@ gimp_list_object_renamed (GimpObject *object,
       gint   old_index;
       gint   new_index = 0;
 
-      old_index = g_list_index (list->list, object);
+      old_index = gimp_list_get_position (list, object);
 
       for (glist = list->list; glist; glist = g_list_next (glist))
         {
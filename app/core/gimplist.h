@@ -43,6 +43,15 @@ struct _GimpList
   gboolean       unique_names;
   GCompareFunc   sort_func;
   gboolean       append;
+
+  /*  private, the children of list in an array, their positions, and
+   *  the children by name
+   */
+  GPtrArray     *array;
+  GHashTable    *positions;
+  gint           n_valid_positions;
+  GHashTable    *names;
+  gboolean       names_valid;
 };
 
 struct _GimpListClass
@@ -22,6 +22,7 @@
 #include "core-types.h"
 
 #include "gegl/gimp-gegl-utils.h"
+#include "gegl/gimpcompressedbuffer.h"
 
 #include "gimp-utils.h"
 #include "gimpchannel.h"
@@ -106,14 +107,14 @@ gimp_mask_undo_constructed (GObject *object)
 
   if (gimp_channel_bounds (channel, &x1, &y1, &x2, &y2))
     {
-      mask_undo->buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
-                                                           x2 - x1, y2 - y1),
-                                           gimp_drawable_get_format (drawable));
+      GeglBuffer *buffer;
+
+      buffer = gimp_gegl_buffer_dup_rect (gimp_drawable_get_buffer (drawable),
+                                          GEGL_RECTANGLE (x1, y1,
+                                                          x2 - x1, y2 - y1));
 
-      gegl_buffer_copy (gimp_drawable_get_buffer (drawable),
-                        GEGL_RECTANGLE (x1, y1, x2 - x1, y2 - y1),
-                        mask_undo->buffer,
-                        GEGL_RECTANGLE (0, 0, 0, 0));
+      mask_undo->buffer = gimp_compressed_buffer_new (buffer);
+      g_object_unref (buffer);
 
       mask_undo->x = x1;
       mask_undo->y = y1;
@@ -169,7 +170,8 @@ gimp_mask_undo_get_memsize (GimpObject *object,
   GimpMaskUndo *mask_undo = GIMP_MASK_UNDO (object);
   gint64        memsize   = 0;
 
-  memsize += gimp_gegl_buffer_get_memsize (mask_undo->buffer);
+  if (mask_undo->buffer)
+    memsize += gimp_compressed_buffer_get_memsize (mask_undo->buffer);
 
   return memsize + GIMP_OBJECT_CLASS (parent_class)->get_memsize (object,
                                                                   gui_size);
@@ -193,13 +195,9 @@ gimp_mask_undo_pop (GimpUndo            *undo,
 
   if (gimp_channel_bounds (channel, &x1, &y1, &x2, &y2))
     {
-      new_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, x2 - x1, y2 - y1),
-                                    gimp_drawable_get_format (drawable));
-
-      gegl_buffer_copy (gimp_drawable_get_buffer (drawable),
-                        GEGL_RECTANGLE (x1, y1, x2 - x1, y2 - y1),
-                        new_buffer,
-                        GEGL_RECTANGLE (0, 0, 0, 0));
+      new_buffer =
+        gimp_gegl_buffer_dup_rect (gimp_drawable_get_buffer (drawable),
+                                   GEGL_RECTANGLE (x1, y1, x2 - x1, y2 - y1));
 
       gegl_buffer_clear (gimp_drawable_get_buffer (drawable),
                          GEGL_RECTANGLE (x1, y1, x2 - x1, y2 - y1));
@@ -227,15 +225,18 @@ gimp_mask_undo_pop (GimpUndo            *undo,
 
   if (mask_undo->buffer)
     {
-      width  = gegl_buffer_get_width  (mask_undo->buffer);
-      height = gegl_buffer_get_height (mask_undo->buffer);
+      GeglBuffer *buffer = gimp_compressed_buffer_decompress (mask_undo->buffer);
+
+      width  = gegl_buffer_get_width  (buffer);
+      height = gegl_buffer_get_height (buffer);
 
-      gegl_buffer_copy (mask_undo->buffer,
+      gegl_buffer_copy (buffer,
                         NULL,
                         gimp_drawable_get_buffer (drawable),
                         GEGL_RECTANGLE (mask_undo->x, mask_undo->y, 0, 0));
 
-      g_object_unref (mask_undo->buffer);
+      g_object_unref (buffer);
+      gimp_compressed_buffer_free (mask_undo->buffer);
     }
 
   /* invalidate the current bounds and boundary of the mask */
@@ -262,7 +263,16 @@ gimp_mask_undo_pop (GimpUndo            *undo,
   channel->bounds_known = TRUE;
 
   /*  set the new mask undo parameters  */
-  mask_undo->buffer = new_buffer;
+  if (new_buffer)
+    {
+      mask_undo->buffer = gimp_compressed_buffer_new (new_buffer);
+      g_object_unref (new_buffer);
+    }
+  else
+    {
+      mask_undo->buffer = NULL;
+    }
+
   mask_undo->x      = x1;
   mask_undo->y      = y1;
   mask_undo->format = format;
@@ -281,7 +291,7 @@ gimp_mask_undo_free (GimpUndo     *undo,
 
   if (mask_undo->buffer)
     {
-      g_object_unref (mask_undo->buffer);
+      gimp_compressed_buffer_free (mask_undo->buffer);
       mask_undo->buffer = NULL;
     }
 
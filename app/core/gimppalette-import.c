@@ -17,6 +17,7 @@
 
 #include "config.h"
 
+#include <stdlib.h>
 #include <string.h>
 
 #include <cairo.h>
@@ -28,6 +29,7 @@
 
 #include "core-types.h"
 
+#include "gimp-parallel.h"
 #include "gimpchannel.h"
 #include "gimpcontainer.h"
 #include "gimpcontext.h"
@@ -82,98 +84,170 @@ gimp_palette_import_from_gradient (GimpGradient *gradient,
 
 /*  create a palette from a non-indexed image  *******************************/
 
-typedef struct _ImgColors ImgColors;
+/*  The colors are counted in an open addressing hash table keyed by
+ *  the packed, thresholded color. Each thread fills its own table for
+ *  a band of rows, the tables are merged in band order afterwards.
+ */
+
+#define HISTOGRAM_MIN_SIZE 1024
+#define MIN_PARALLEL_ROWS  64
+
+typedef struct _ImgColors    ImgColors;
+typedef struct _ImgHistogram ImgHistogram;
 
 struct _ImgColors
 {
-  guint  count;
-  guint  r_adj;
-  guint  g_adj;
-  guint  b_adj;
-  guchar r;
-  guchar g;
-  guchar b;
+  guint32 key;     /*  the color with bit 24 set, 0 for a free slot  */
+  guint   count;
+  guint64 r_adj;   /*  the sums of what the threshold cut off        */
+  guint64 g_adj;
+  guint64 b_adj;
 };
 
-static gint count_color_entries = 0;
+struct _ImgHistogram
+{
+  ImgColors *colors;
+  gint       size;       /*  a power of two  */
+  gint       n_colors;
+};
 
-static GHashTable *
-gimp_palette_import_store_colors (GHashTable *table,
-                                  guchar     *colors,
-                                  guchar     *colors_real,
-                                  gint        n_colors)
+typedef struct
+{
+  GimpImage     *image;
+  GimpPickable  *pickable;
+  gint           pickable_off_x;
+  gint           pickable_off_y;
+  gboolean       selection_only;
+  GeglRectangle  rect;
+  gint           threshold;
+  ImgHistogram  *histograms;
+} ImgExtractData;
+
+
+#define HISTOGRAM_KEY(r, g, b) ((1 << 24) | ((r) << 16) | ((g) << 8) | (b))
+
+static inline guint
+gimp_palette_import_hash (guint32 key,
+                          gint    size)
 {
-  gpointer   found_color = NULL;
-  ImgColors *new_color;
-  guint      key_colors = colors[0] * 256 * 256 + colors[1] * 256 + colors[2];
+  return (key * 2654435769u) & (size - 1);
+}
 
-  if (table == NULL)
-    {
-      table = g_hash_table_new (g_direct_hash, g_direct_equal);
-      count_color_entries = 0;
-    }
-  else
-    {
-      found_color = g_hash_table_lookup (table, GUINT_TO_POINTER (key_colors));
-    }
+static void
+gimp_palette_import_histogram_init (ImgHistogram *histogram,
+                                    gint          size)
+{
+  histogram->colors   = g_new0 (ImgColors, size);
+  histogram->size     = size;
+  histogram->n_colors = 0;
+}
 
-  if (found_color == NULL)
+static void
+gimp_palette_import_histogram_free (ImgHistogram *histogram)
+{
+  g_free (histogram->colors);
+  histogram->colors = NULL;
+}
+
+static void
+gimp_palette_import_histogram_grow (ImgHistogram *histogram)
+{
+  ImgColors *old_colors = histogram->colors;
+  gint       old_size   = histogram->size;
+  gint       i;
+
+  gimp_palette_import_histogram_init (histogram, old_size * 2);
+
+  for (i = 0; i < old_size; i++)
     {
-      if (count_color_entries > MAX_IMAGE_COLORS)
+      if (old_colors[i].key)
         {
-          /* Don't add any more new ones */
-          return table;
+          guint j = gimp_palette_import_hash (old_colors[i].key,
+                                              histogram->size);
+
+          while (histogram->colors[j].key)
+            j = (j + 1) & (histogram->size - 1);
+
+          histogram->colors[j] = old_colors[i];
+          histogram->n_colors++;
         }
+    }
 
-      count_color_entries++;
+  g_free (old_colors);
+}
 
-      new_color = g_slice_new (ImgColors);
+/*  returns the entry for @key, or NULL if @key is new and the table
+ *  already holds MAX_IMAGE_COLORS colors
+ */
+static ImgColors *
+gimp_palette_import_histogram_lookup (ImgHistogram *histogram,
+                                      guint32       key)
+{
+  guint j = gimp_palette_import_hash (key, histogram->size);
 
-      new_color->count = 1;
-      new_color->r_adj = 0;
-      new_color->g_adj = 0;
-      new_color->b_adj = 0;
-      new_color->r     = colors[0];
-      new_color->g     = colors[1];
-      new_color->b     = colors[2];
+  while (histogram->colors[j].key)
+    {
+      if (histogram->colors[j].key == key)
+        return &histogram->colors[j];
 
-      g_hash_table_insert (table, GUINT_TO_POINTER (key_colors), new_color);
+      j = (j + 1) & (histogram->size - 1);
     }
-  else
+
+  if (histogram->n_colors > MAX_IMAGE_COLORS)
     {
-      new_color = found_color;
+      /* Don't add any more new ones */
+      return NULL;
+    }
 
-      if (new_color->count < (G_MAXINT - 1))
-        new_color->count++;
+  /*  keep the table at most half full  */
+  if (2 * (histogram->n_colors + 1) > histogram->size)
+    {
+      gimp_palette_import_histogram_grow (histogram);
 
-      /* Now do the adjustments ...*/
-      new_color->r_adj += (colors_real[0] - colors[0]);
-      new_color->g_adj += (colors_real[1] - colors[1]);
-      new_color->b_adj += (colors_real[2] - colors[2]);
+      return gimp_palette_import_histogram_lookup (histogram, key);
+    }
 
-      /* Boundary conditions */
-      if(new_color->r_adj > (G_MAXINT - 255))
-        new_color->r_adj /= new_color->count;
+  histogram->colors[j].key = key;
+  histogram->n_colors++;
 
-      if(new_color->g_adj > (G_MAXINT - 255))
-        new_color->g_adj /= new_color->count;
+  return &histogram->colors[j];
+}
 
-      if(new_color->b_adj > (G_MAXINT - 255))
-        new_color->b_adj /= new_color->count;
-    }
+static void
+gimp_palette_import_histogram_merge (ImgHistogram *histogram,
+                                     ImgHistogram *other)
+{
+  gint i;
 
-  return table;
+  for (i = 0; i < other->size; i++)
+    {
+      const ImgColors *src = &other->colors[i];
+      ImgColors       *dest;
+
+      if (! src->key)
+        continue;
+
+      dest = gimp_palette_import_histogram_lookup (histogram, src->key);
+
+      if (dest)
+        {
+          dest->count += src->count;
+          dest->r_adj += src->r_adj;
+          dest->g_adj += src->g_adj;
+          dest->b_adj += src->b_adj;
+        }
+    }
 }
 
-static void
-gimp_palette_import_create_list (gpointer key,
-                                 gpointer value,
-                                 gpointer user_data)
+static inline gboolean
+gimp_palette_import_color_before (const ImgColors *a,
+                                  const ImgColors *b)
 {
-  GSList    **list      = user_data;
-  ImgColors  *color_tab = value;
+  /*  more frequent colors first, the key makes the order stable  */
+  if (a->count != b->count)
+    return a->count > b->count;
 
-  *list = g_slist_prepend (*list, color_tab);
+  return a->key < b->key;
 }
 
 static gint
@@ -183,120 +257,152 @@ gimp_palette_import_sort_colors (gconstpointer a,
   const ImgColors *s1 = a;
   const ImgColors *s2 = b;
 
-  if(s1->count > s2->count)
+  if (gimp_palette_import_color_before (s1, s2))
     return -1;
-  if(s1->count < s2->count)
+  if (gimp_palette_import_color_before (s2, s1))
     return 1;
 
   return 0;
 }
 
+/*  moves the @n first colors in sort order to the start of @colors,
+ *  in no particular order
+ */
 static void
-gimp_palette_import_create_image_palette (gpointer data,
-                                          gpointer user_data)
+gimp_palette_import_select_colors (ImgColors *colors,
+                                   gint       n_colors,
+                                   gint       n)
 {
-  GimpPalette *palette   = user_data;
-  ImgColors   *color_tab = data;
-  gint         n_colors;
-  gchar       *lab;
-  GimpRGB      color;
+  gint left  = 0;
+  gint right = n_colors - 1;
 
-  n_colors = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (palette),
-                                                 "import-n-colors"));
+  while (left < right)
+    {
+      ImgColors pivot = colors[(left + right) / 2];
+      gint      i     = left;
+      gint      j     = right;
 
-  if (gimp_palette_get_n_colors (palette) >= n_colors)
-    return;
+      while (i <= j)
+        {
+          while (gimp_palette_import_color_before (&colors[i], &pivot))
+            i++;
 
-  lab = g_strdup_printf ("%s (occurs %u)", _("Untitled"), color_tab->count);
+          while (gimp_palette_import_color_before (&pivot, &colors[j]))
+            j--;
 
-  /* Adjust the colors to the mean of the the sample */
-  gimp_rgba_set_uchar
-    (&color,
-     (guchar) color_tab->r + (color_tab->r_adj / color_tab->count),
-     (guchar) color_tab->g + (color_tab->g_adj / color_tab->count),
-     (guchar) color_tab->b + (color_tab->b_adj / color_tab->count),
-     255);
+          if (i <= j)
+            {
+              ImgColors tmp = colors[i];
 
-  gimp_palette_add_entry (palette, -1, lab, &color);
+              colors[i++] = colors[j];
+              colors[j--] = tmp;
+            }
+        }
 
-  g_free (lab);
+      if (n - 1 <= j)
+        right = j;
+      else if (n - 1 >= i)
+        left = i;
+      else
+        break;
+    }
 }
 
 static GimpPalette *
-gimp_palette_import_make_palette (GHashTable  *table,
-                                  const gchar *palette_name,
-                                  GimpContext *context,
-                                  gint         n_colors)
+gimp_palette_import_make_palette (ImgHistogram *histogram,
+                                  const gchar  *palette_name,
+                                  GimpContext  *context,
+                                  gint          n_colors)
 {
   GimpPalette *palette;
-  GSList      *list = NULL;
-  GSList      *iter;
+  ImgColors   *colors;
+  gint         n;
+  gint         i;
 
   palette = GIMP_PALETTE (gimp_palette_new (context, palette_name));
 
-  if (! table)
+  if (! histogram)
     return palette;
 
-  g_hash_table_foreach (table, gimp_palette_import_create_list, &list);
-  list = g_slist_sort (list, gimp_palette_import_sort_colors);
+  /*  pack the used slots  */
+  colors = histogram->colors;
 
-  g_object_set_data (G_OBJECT (palette), "import-n-colors",
-                     GINT_TO_POINTER (n_colors));
+  for (i = 0, n = 0; i < histogram->size; i++)
+    {
+      if (colors[i].key)
+        colors[n++] = colors[i];
+    }
 
-  g_slist_foreach (list, gimp_palette_import_create_image_palette, palette);
+  /*  only the colors that make it into the palette need sorting  */
+  if (n > n_colors)
+    {
+      gimp_palette_import_select_colors (colors, n, n_colors);
+      n = n_colors;
+    }
 
-  g_object_set_data (G_OBJECT (palette), "import-n-colors", NULL);
+  qsort (colors, n, sizeof (ImgColors), gimp_palette_import_sort_colors);
 
-  /*  Free up used memory
-   *  Note the same structure is on both the hash list and the sorted
-   *  list. So only delete it once.
-   */
-  g_hash_table_destroy (table);
+  for (i = 0; i < n; i++)
+    {
+      const ImgColors *color_tab = &colors[i];
+      gchar           *lab;
+      GimpRGB          color;
+
+      lab = g_strdup_printf ("%s (occurs %u)", _("Untitled"), color_tab->count);
+
+      /* Adjust the colors to the mean of the the sample */
+      gimp_rgba_set_uchar
+        (&color,
+         ((color_tab->key >> 16) & 0xff) + (color_tab->r_adj / color_tab->count),
+         ((color_tab->key >>  8) & 0xff) + (color_tab->g_adj / color_tab->count),
+         ((color_tab->key >>  0) & 0xff) + (color_tab->b_adj / color_tab->count),
+         255);
 
-  for (iter = list; iter; iter = iter->next)
-    g_slice_free (ImgColors, iter->data);
+      gimp_palette_add_entry (palette, -1, lab, &color);
 
-  g_slist_free (list);
+      g_free (lab);
+    }
+
+  gimp_palette_import_histogram_free (histogram);
+  g_slice_free (ImgHistogram, histogram);
 
   return palette;
 }
 
-static GHashTable *
-gimp_palette_import_extract (GimpImage     *image,
-                             GimpPickable  *pickable,
-                             gint           pickable_off_x,
-                             gint           pickable_off_y,
-                             gboolean       selection_only,
-                             gint           x,
-                             gint           y,
-                             gint           width,
-                             gint           height,
-                             gint           n_colors,
-                             gint           threshold)
+static void
+gimp_palette_import_extract_band (gint            i,
+                                  gint            n,
+                                  ImgExtractData *data)
 {
+  ImgHistogram       *histogram = &data->histograms[i];
   GeglBuffer         *buffer;
   GeglBufferIterator *iter;
-  GeglRectangle      *mask_roi = NULL;
-  GeglRectangle       rect     = { x, y, width, height };
-  GHashTable         *colors   = NULL;
+  GeglRectangle      *mask_roi  = NULL;
+  GeglRectangle       rect      = data->rect;
   const Babl         *format;
+  gint                threshold = data->threshold;
   gint                bpp;
-  gint                mask_bpp = 0;
+  gint                mask_bpp  = 0;
+
+  rect.y      = data->rect.y + data->rect.height * i / n;
+  rect.height = data->rect.y + data->rect.height * (i + 1) / n - rect.y;
+
+  gimp_palette_import_histogram_init (histogram, HISTOGRAM_MIN_SIZE);
 
-  buffer = gimp_pickable_get_buffer (pickable);
+  buffer = gimp_pickable_get_buffer (data->pickable);
   format = babl_format ("R'G'B'A u8");
 
   iter = gegl_buffer_iterator_new (buffer, &rect, 0, format,
                                    GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
   bpp = babl_format_get_bytes_per_pixel (format);
 
-  if (selection_only &&
-      ! gimp_channel_is_empty (gimp_image_get_mask (image)))
+  if (data->selection_only &&
+      ! gimp_channel_is_empty (gimp_image_get_mask (data->image)))
     {
-      GimpDrawable *mask = GIMP_DRAWABLE (gimp_image_get_mask (image));
+      GimpDrawable *mask = GIMP_DRAWABLE (gimp_image_get_mask (data->image));
 
-      rect.x = x + pickable_off_x;
-      rect.y = y + pickable_off_y;
+      rect.x += data->pickable_off_x;
+      rect.y += data->pickable_off_y;
 
       buffer = gimp_drawable_get_buffer (mask);
       format = babl_format ("Y u8");
@@ -309,7 +415,7 @@ gimp_palette_import_extract (GimpImage     *image,
 
   while (gegl_buffer_iterator_next (iter))
     {
-      const guchar *data      = iter->data[0];
+      const guchar *pixel     = iter->data[0];
       const guchar *mask_data = NULL;
 
       if (mask_roi)
@@ -318,31 +424,88 @@ gimp_palette_import_extract (GimpImage     *image,
       while (iter->length--)
         {
           /*  ignore unselected, and completely transparent pixels  */
-          if ((! mask_data || *mask_data) && data[ALPHA])
+          if ((! mask_data || *mask_data) && pixel[ALPHA])
             {
-              guchar rgba[MAX_CHANNELS]     = { 0, };
-              guchar rgb_real[MAX_CHANNELS] = { 0, };
-
-              memcpy (rgba, data, 4);
-              memcpy (rgb_real, rgba, 4);
-
-              rgba[0] = (rgba[0] / threshold) * threshold;
-              rgba[1] = (rgba[1] / threshold) * threshold;
-              rgba[2] = (rgba[2] / threshold) * threshold;
-
-              colors = gimp_palette_import_store_colors (colors,
-                                                         rgba, rgb_real,
-                                                         n_colors);
+              guchar     r = (pixel[0] / threshold) * threshold;
+              guchar     g = (pixel[1] / threshold) * threshold;
+              guchar     b = (pixel[2] / threshold) * threshold;
+              ImgColors *color;
+
+              color = gimp_palette_import_histogram_lookup (histogram,
+                                                            HISTOGRAM_KEY (r, g, b));
+
+              if (color)
+                {
+                  color->count++;
+
+                  /* Now do the adjustments ...*/
+                  color->r_adj += pixel[0] - r;
+                  color->g_adj += pixel[1] - g;
+                  color->b_adj += pixel[2] - b;
+                }
             }
 
-          data += bpp;
+          pixel += bpp;
 
           if (mask_data)
             mask_data += mask_bpp;
         }
     }
+}
+
+static ImgHistogram *
+gimp_palette_import_extract (GimpImage     *image,
+                             GimpPickable  *pickable,
+                             gint           pickable_off_x,
+                             gint           pickable_off_y,
+                             gboolean       selection_only,
+                             gint           x,
+                             gint           y,
+                             gint           width,
+                             gint           height,
+                             gint           n_colors,
+                             gint           threshold)
+{
+  ImgExtractData  data;
+  ImgHistogram   *histogram;
+  gint            n_bands;
+  gint            i;
+
+  n_bands = MAX (height / MIN_PARALLEL_ROWS, 1);
+  n_bands = MIN (n_bands, gimp_parallel_get_n_threads ());
+
+  data.image          = image;
+  data.pickable       = pickable;
+  data.pickable_off_x = pickable_off_x;
+  data.pickable_off_y = pickable_off_y;
+  data.selection_only = selection_only;
+  data.rect           = *GEGL_RECTANGLE (x, y, width, height);
+  data.threshold      = threshold;
+  data.histograms     = g_new0 (ImgHistogram, n_bands);
+
+  /*  gimp_parallel_distribute() may split into fewer bands, the
+   *  histograms it didn't use stay empty
+   */
+  gimp_parallel_distribute (n_bands,
+                            (GimpParallelDistributeFunc)
+                            gimp_palette_import_extract_band,
+                            &data);
+
+  histogram = g_slice_new (ImgHistogram);
+  *histogram = data.histograms[0];
+
+  for (i = 1; i < n_bands; i++)
+    {
+      if (data.histograms[i].colors)
+        {
+          gimp_palette_import_histogram_merge (histogram, &data.histograms[i]);
+          gimp_palette_import_histogram_free (&data.histograms[i]);
+        }
+    }
+
+  g_free (data.histograms);
 
-  return colors;
+  return histogram;
 }
 
 GimpPalette *
@@ -354,7 +517,7 @@ gimp_palette_import_from_image (GimpImage   *image,
                                 gboolean     selection_only)
 {
   GimpProjection *projection;
-  GHashTable     *colors;
+  ImgHistogram   *colors;
   gint            x, y;
   gint            width, height;
 
@@ -448,10 +611,10 @@ gimp_palette_import_from_drawable (GimpDrawable *drawable,
                                    gint          threshold,
                                    gboolean      selection_only)
 {
-  GHashTable *colors = NULL;
-  gint        x, y;
-  gint        width, height;
-  gint        off_x, off_y;
+  ImgHistogram *colors = NULL;
+  gint          x, y;
+  gint          width, height;
+  gint          off_x, off_y;
 
   g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), NULL);
   g_return_val_if_fail (GIMP_IS_CONTEXT (context), NULL);
@@ -58,10 +58,98 @@
 #include "gimp-intl.h"
 
 
+static GList * gimp_pattern_load_file (const gchar  *filename,
+                                       gboolean      header_only,
+                                       GError      **error);
+
+
+/*  public functions  */
+
 GList *
 gimp_pattern_load (GimpContext  *context,
                    const gchar  *filename,
                    GError      **error)
+{
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (g_path_is_absolute (filename), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  return gimp_pattern_load_file (filename, FALSE, error);
+}
+
+/*  Only reads the pattern header and name, the returned pattern has
+ *  no mask and must be completed using gimp_pattern_load() before use.
+ */
+GList *
+gimp_pattern_load_header (GimpContext  *context,
+                          const gchar  *filename,
+                          GError      **error)
+{
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (g_path_is_absolute (filename), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  return gimp_pattern_load_file (filename, TRUE, error);
+}
+
+GList *
+gimp_pattern_load_pixbuf (GimpContext  *context,
+                          const gchar  *filename,
+                          GError      **error)
+{
+  GimpPattern *pattern;
+  GdkPixbuf   *pixbuf;
+  GeglBuffer  *src_buffer;
+  GeglBuffer  *dest_buffer;
+  gchar       *name;
+
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (g_path_is_absolute (filename), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  pixbuf = gdk_pixbuf_new_from_file (filename, error);
+
+  if (! pixbuf)
+    return NULL;
+
+  name = g_strdup (gdk_pixbuf_get_option (pixbuf, "tEXt::Title"));
+
+  if (! name)
+    name = g_strdup (gdk_pixbuf_get_option (pixbuf, "tEXt::Comment"));
+
+  if (! name)
+    name = g_filename_display_basename (filename);
+
+  pattern = g_object_new (GIMP_TYPE_PATTERN,
+                          "name",      name,
+                          "mime-type", NULL, /* FIXME!! */
+                          NULL);
+  g_free (name);
+
+  pattern->mask = gimp_temp_buf_new (gdk_pixbuf_get_width (pixbuf),
+                                     gdk_pixbuf_get_height (pixbuf),
+                                     gimp_pixbuf_get_format (pixbuf));
+
+  src_buffer  = gimp_pixbuf_create_buffer (pixbuf);
+  dest_buffer = gimp_temp_buf_create_buffer (pattern->mask);
+
+  gegl_buffer_copy (src_buffer, NULL, dest_buffer, NULL);
+
+  g_object_unref (src_buffer);
+  g_object_unref (dest_buffer);
+
+  g_object_unref (pixbuf);
+
+  return g_list_prepend (NULL, pattern);
+}
+
+
+/*  private functions  */
+
+static GList *
+gimp_pattern_load_file (const gchar  *filename,
+                        gboolean      header_only,
+                        GError      **error)
 {
   GimpPattern   *pattern = NULL;
   const Babl    *format  = NULL;
@@ -70,10 +158,6 @@ gimp_pattern_load (GimpContext  *context,
   gint           bn_size;
   gchar         *name    = NULL;
 
-  g_return_val_if_fail (filename != NULL, NULL);
-  g_return_val_if_fail (g_path_is_absolute (filename), NULL);
-  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
-
   fd = g_open (filename, O_RDONLY | _O_BINARY, 0);
   if (fd == -1)
     {
@@ -157,6 +241,13 @@ gimp_pattern_load (GimpContext  *context,
 
   g_free (name);
 
+  if (header_only)
+    {
+      close (fd);
+
+      return g_list_prepend (NULL, pattern);
+    }
+
   switch (header.bytes)
     {
     case 1: format = babl_format ("Y' u8");      break;
@@ -190,54 +281,3 @@ gimp_pattern_load (GimpContext  *context,
 
   return NULL;
 }
-
-GList *
-gimp_pattern_load_pixbuf (GimpContext  *context,
-                          const gchar  *filename,
-                          GError      **error)
-{
-  GimpPattern *pattern;
-  GdkPixbuf   *pixbuf;
-  GeglBuffer  *src_buffer;
-  GeglBuffer  *dest_buffer;
-  gchar       *name;
-
-  g_return_val_if_fail (filename != NULL, NULL);
-  g_return_val_if_fail (g_path_is_absolute (filename), NULL);
-  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
-
-  pixbuf = gdk_pixbuf_new_from_file (filename, error);
-
-  if (! pixbuf)
-    return NULL;
-
-  name = g_strdup (gdk_pixbuf_get_option (pixbuf, "tEXt::Title"));
-
-  if (! name)
-    name = g_strdup (gdk_pixbuf_get_option (pixbuf, "tEXt::Comment"));
-
-  if (! name)
-    name = g_filename_display_basename (filename);
-
-  pattern = g_object_new (GIMP_TYPE_PATTERN,
-                          "name",      name,
-                          "mime-type", NULL, /* FIXME!! */
-                          NULL);
-  g_free (name);
-
-  pattern->mask = gimp_temp_buf_new (gdk_pixbuf_get_width (pixbuf),
-                                     gdk_pixbuf_get_height (pixbuf),
-                                     gimp_pixbuf_get_format (pixbuf));
-
-  src_buffer  = gimp_pixbuf_create_buffer (pixbuf);
-  dest_buffer = gimp_temp_buf_create_buffer (pattern->mask);
-
-  gegl_buffer_copy (src_buffer, NULL, dest_buffer, NULL);
-
-  g_object_unref (src_buffer);
-  g_object_unref (dest_buffer);
-
-  g_object_unref (pixbuf);
-
-  return g_list_prepend (NULL, pattern);
-}
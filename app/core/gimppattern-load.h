@@ -25,6 +25,9 @@
 GList * gimp_pattern_load        (GimpContext  *context,
                                   const gchar  *filename,
                                   GError      **error);
+GList * gimp_pattern_load_header (GimpContext  *context,
+                                  const gchar  *filename,
+                                  GError      **error);
 GList * gimp_pattern_load_pixbuf (GimpContext  *context,
                                   const gchar  *filename,
                                   GError      **error);
@@ -51,6 +51,8 @@ static gchar       * gimp_pattern_get_description   (GimpViewable         *viewa
 
 static const gchar * gimp_pattern_get_extension     (GimpData             *data);
 static GimpData    * gimp_pattern_duplicate         (GimpData             *data);
+static void          gimp_pattern_copy              (GimpData             *data,
+                                                     GimpData             *src_data);
 
 static gchar       * gimp_pattern_get_checksum      (GimpTagged           *tagged);
 
@@ -81,6 +83,7 @@ gimp_pattern_class_init (GimpPatternClass *klass)
 
   data_class->get_extension        = gimp_pattern_get_extension;
   data_class->duplicate            = gimp_pattern_duplicate;
+  data_class->copy                 = gimp_pattern_copy;
 }
 
 static void
@@ -129,6 +132,8 @@ gimp_pattern_get_size (GimpViewable *viewable,
 {
   GimpPattern *pattern = GIMP_PATTERN (viewable);
 
+  gimp_data_ensure_loaded (GIMP_DATA (pattern));
+
   *width  = gimp_temp_buf_get_width  (pattern->mask);
   *height = gimp_temp_buf_get_height (pattern->mask);
 
@@ -148,6 +153,8 @@ gimp_pattern_get_new_preview (GimpViewable *viewable,
   gint         copy_width;
   gint         copy_height;
 
+  gimp_data_ensure_loaded (GIMP_DATA (pattern));
+
   copy_width  = MIN (width,  gimp_temp_buf_get_width  (pattern->mask));
   copy_height = MIN (height, gimp_temp_buf_get_height (pattern->mask));
 
@@ -172,6 +179,8 @@ gimp_pattern_get_description (GimpViewable  *viewable,
 {
   GimpPattern *pattern = GIMP_PATTERN (viewable);
 
+  gimp_data_ensure_loaded (GIMP_DATA (pattern));
+
   return g_strdup_printf ("%s (%d × %d)",
                           gimp_object_get_name (pattern),
                           gimp_temp_buf_get_width  (pattern->mask),
@@ -194,6 +203,19 @@ gimp_pattern_duplicate (GimpData *data)
   return GIMP_DATA (pattern);
 }
 
+static void
+gimp_pattern_copy (GimpData *data,
+                   GimpData *src_data)
+{
+  GimpPattern *pattern     = GIMP_PATTERN (data);
+  GimpPattern *src_pattern = GIMP_PATTERN (src_data);
+
+  if (pattern->mask)
+    gimp_temp_buf_unref (pattern->mask);
+
+  pattern->mask = gimp_temp_buf_copy (src_pattern->mask);
+}
+
 static gchar *
 gimp_pattern_get_checksum (GimpTagged *tagged)
 {
@@ -268,6 +290,8 @@ gimp_pattern_get_mask (const GimpPattern *pattern)
 {
   g_return_val_if_fail (GIMP_IS_PATTERN (pattern), NULL);
 
+  gimp_data_ensure_loaded ((GimpData *) pattern);
+
   return pattern->mask;
 }
 
@@ -276,5 +300,7 @@ gimp_pattern_create_buffer (const GimpPattern *pattern)
 {
   g_return_val_if_fail (GIMP_IS_PATTERN (pattern), NULL);
 
+  gimp_data_ensure_loaded ((GimpData *) pattern);
+
   return gimp_temp_buf_create_buffer (pattern->mask);
 }
@@ -1,20 +1,3 @@
-/* GIMP - The GNU Image Manipulation Program
- * Copyright (C) 1995 Spencer Kimball and Peter Mattis
- *
- * This program is free software: you can redistribute it and/or modify
- * it under the terms of the GNU General Public License as published by
- * the Free Software Foundation; either version 3 of the License, or
- * (at your option) any later version.
- *
- * This program is distributed in the hope that it will be useful,
- * but WITHOUT ANY WARRANTY; without even the implied warranty of
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- * GNU General Public License for more details.
- *
- * You should have received a copy of the GNU General Public License
- * along with this program.  If not, see <http://www.gnu.org/licenses/>.
- */
-
 #include "config.h"
 
 #include <string.h>
@@ -24,6 +7,7 @@
 #include "core-types.h"
 
 #include "gimp.h"
+#include "gimp-parallel.h"
 #include "gimpimage.h"
 #include "gimppickable.h"
 #include "gimppickable-auto-shrink.h"
@@ -36,23 +20,59 @@ typedef enum
   AUTO_SHRINK_COLOR   = 2
 } AutoShrinkType;
 
+typedef enum
+{
+  EDGE_TOP,
+  EDGE_BOTTOM,
+  EDGE_LEFT,
+  EDGE_RIGHT,
+  N_EDGES
+} AutoShrinkEdge;
+
+typedef struct
+{
+  GeglBuffer     *buffer;
+  AutoShrinkType  type;
+  const Babl     *format;
+  gint            bpp;
+  guint32         bgcolor;
+  GeglRectangle   area;
+  gint            tile_width;
+  gint            tile_height;
 
-typedef gboolean (* ColorsEqualFunc) (guchar *col1,
-                                      guchar *col2);
+  /*  the first or last row or column with content, per edge  */
+  gint            edge[N_EDGES];
+} AutoShrinkData;
 
 
 /*  local function prototypes  */
 
-static AutoShrinkType   gimp_pickable_guess_bgcolor (GimpPickable *pickable,
-                                                     guchar       *color,
-                                                     gint          x1,
-                                                     gint          x2,
-                                                     gint          y1,
-                                                     gint          y2);
-static gboolean         gimp_pickable_colors_equal  (guchar       *col1,
-                                                     guchar       *col2);
-static gboolean         gimp_pickable_colors_alpha  (guchar       *col1,
-                                                     guchar       *col2);
+static AutoShrinkType gimp_pickable_guess_bgcolor (GimpPickable   *pickable,
+                                                   guchar         *color,
+                                                   gint            x1,
+                                                   gint            x2,
+                                                   gint            y1,
+                                                   gint            y2);
+static gboolean       gimp_pickable_colors_equal  (guchar         *col1,
+                                                   guchar         *col2);
+
+static void   gimp_pickable_auto_shrink_edges    (gint                  i,
+                                                  gint                  n,
+                                                  AutoShrinkData       *data);
+static gint   gimp_pickable_auto_shrink_rows     (AutoShrinkData       *data,
+                                                  gboolean              reverse);
+static gint   gimp_pickable_auto_shrink_cols     (AutoShrinkData       *data,
+                                                  gboolean              reverse);
+
+static gboolean gimp_pickable_auto_shrink_is_bg  (const AutoShrinkData *data,
+                                                  const guchar         *buf,
+                                                  gint                  n);
+static gint   gimp_pickable_auto_shrink_first_fg (const AutoShrinkData *data,
+                                                  const guchar         *buf,
+                                                  gint                  n);
+static gint   gimp_pickable_auto_shrink_last_fg  (const AutoShrinkData *data,
+                                                  const guchar         *buf,
+                                                  gint                  n);
 
 
 /*  public functions  */
@@ -68,16 +88,11 @@ gimp_pickable_auto_shrink (GimpPickable *pickable,
                            gint         *shrunk_x2,
                            gint         *shrunk_y2)
 {
-  GeglBuffer      *buffer;
-  GeglRectangle    rect;
-  ColorsEqualFunc  colors_equal_func;
-  guchar           bgcolor[MAX_CHANNELS] = { 0, 0, 0, 0 };
-  guchar          *buf = NULL;
-  gint             x1, y1, x2, y2;
-  gint             width, height;
-  const Babl      *format;
-  gint             x, y, abort;
-  gboolean         retval = FALSE;
+  GeglBuffer     *buffer;
+  AutoShrinkData  data;
+  guchar          bgcolor[MAX_CHANNELS] = { 0, 0, 0, 0 };
+  gint            x1, y1, x2, y2;
+  gboolean        retval = FALSE;
 
   g_return_val_if_fail (GIMP_IS_PICKABLE (pickable), FALSE);
   g_return_val_if_fail (shrunk_x1 != NULL, FALSE);
@@ -102,103 +117,56 @@ gimp_pickable_auto_shrink (GimpPickable *pickable,
   x2 = MIN (start_x2, gegl_buffer_get_width  (buffer));
   y2 = MIN (start_y2, gegl_buffer_get_height (buffer));
 
-  format = babl_format ("R'G'B'A u8");
+  data.type = gimp_pickable_guess_bgcolor (pickable, bgcolor,
+                                           x1, x2 - 1, y1, y2 - 1);
 
-  switch (gimp_pickable_guess_bgcolor (pickable, bgcolor,
-                                       x1, x2 - 1, y1, y2 - 1))
+  switch (data.type)
     {
     case AUTO_SHRINK_ALPHA:
-      colors_equal_func = gimp_pickable_colors_alpha;
+      /*  only the alpha channel matters, fetch just that  */
+      data.format = babl_format ("A u8");
+      data.bpp    = 1;
       break;
     case AUTO_SHRINK_COLOR:
-      colors_equal_func = gimp_pickable_colors_equal;
+      data.format = babl_format ("R'G'B'A u8");
+      data.bpp    = 4;
       break;
     default:
       goto FINISH;
       break;
     }
 
-  width  = x2 - x1;
-  height = y2 - y1;
-
-  /* The following could be optimized further by processing
-   * the smaller side first instead of defaulting to width    --Sven
+  /* Instead of fetching one pixel line at a time, the edges are
+   * scanned in strips of one tile row or column, and the four edges
+   * are scanned in parallel.
    */
 
-  buf = g_malloc (MAX (width, height) * 4);
-
-  /* Check how many of the top lines are uniform/transparent. */
-  rect.x      = x1;
-  rect.y      = 0;
-  rect.width  = width;
-  rect.height = 1;
-
-  abort = FALSE;
-  for (y = y1; y < y2 && !abort; y++)
-    {
-      rect.y = y;
-      gegl_buffer_get (buffer, &rect, 1.0, format, buf,
-                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-      for (x = 0; x < width && !abort; x++)
-        abort = ! colors_equal_func (bgcolor, buf + x * 4);
-    }
-  if (y == y2 && !abort)
-    goto FINISH;
-  y1 = y - 1;
-
-  /* Check how many of the bottom lines are uniform/transparent. */
-  rect.x      = x1;
-  rect.y      = 0;
-  rect.width  = width;
-  rect.height = 1;
+  data.buffer      = buffer;
+  data.area.x      = x1;
+  data.area.y      = y1;
+  data.area.width  = x2 - x1;
+  data.area.height = y2 - y1;
 
-  abort = FALSE;
-  for (y = y2; y > y1 && !abort; y--)
-    {
-      rect.y = y - 1;
-      gegl_buffer_get (buffer, &rect, 1.0, format, buf,
-                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-      for (x = 0; x < width && !abort; x++)
-        abort = ! colors_equal_func  (bgcolor, buf + x * 4);
-    }
-  y2 = y + 1;
+  memcpy (&data.bgcolor, bgcolor, sizeof (data.bgcolor));
 
-  /* compute a new height for the next operations */
-  height = y2 - y1;
+  g_object_get (buffer,
+                "tile-width",  &data.tile_width,
+                "tile-height", &data.tile_height,
+                NULL);
 
-  /* Check how many of the left lines are uniform/transparent. */
-  rect.x      = 0;
-  rect.y      = y1;
-  rect.width  = 1;
-  rect.height = height;
+  gimp_parallel_distribute (N_EDGES,
+                            (GimpParallelDistributeFunc)
+                            gimp_pickable_auto_shrink_edges,
+                            &data);
 
-  abort = FALSE;
-  for (x = x1; x < x2 && !abort; x++)
-    {
-      rect.x = x;
-      gegl_buffer_get (buffer, &rect, 1.0, format, buf,
-                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-      for (y = 0; y < height && !abort; y++)
-        abort = ! colors_equal_func (bgcolor, buf + y * 4);
-    }
-  x1 = x - 1;
-
-  /* Check how many of the right lines are uniform/transparent. */
-  rect.x      = 0;
-  rect.y      = y1;
-  rect.width  = 1;
-  rect.height = height;
+  /* If no line had any content, the area is entirely uniform/transparent */
+  if (data.edge[EDGE_TOP] == y2)
+    goto FINISH;
 
-  abort = FALSE;
-  for (x = x2; x > x1 && !abort; x--)
-    {
-      rect.x = x - 1;
-      gegl_buffer_get (buffer, &rect, 1.0, format, buf,
-                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
-      for (y = 0; y < height && !abort; y++)
-        abort = ! colors_equal_func (bgcolor, buf + y * 4);
-    }
-  x2 = x + 1;
+  y1 = data.edge[EDGE_TOP];
+  y2 = data.edge[EDGE_BOTTOM] + 1;
+  x1 = data.edge[EDGE_LEFT];
+  x2 = data.edge[EDGE_RIGHT] + 1;
 
  FINISH:
 
@@ -213,7 +181,6 @@ gimp_pickable_auto_shrink (GimpPickable *pickable,
       retval = TRUE;
     }
 
-  g_free (buf);
   gimp_unset_busy (gimp_pickable_get_image (pickable)->gimp);
 
   return retval;
@@ -292,9 +259,266 @@ gimp_pickable_colors_equal (guchar *col1,
   return TRUE;
 }
 
+static void
+gimp_pickable_auto_shrink_edges (gint            i,
+                                 gint            n,
+                                 AutoShrinkData *data)
+{
+  gint edge;
+
+  for (edge = i; edge < N_EDGES; edge += n)
+    {
+      switch ((AutoShrinkEdge) edge)
+        {
+        case EDGE_TOP:
+          data->edge[edge] = gimp_pickable_auto_shrink_rows (data, FALSE);
+          break;
+        case EDGE_BOTTOM:
+          data->edge[edge] = gimp_pickable_auto_shrink_rows (data, TRUE);
+          break;
+        case EDGE_LEFT:
+          data->edge[edge] = gimp_pickable_auto_shrink_cols (data, FALSE);
+          break;
+        case EDGE_RIGHT:
+          data->edge[edge] = gimp_pickable_auto_shrink_cols (data, TRUE);
+          break;
+        default:
+          break;
+        }
+    }
+}
+
+/*  returns the first (or, if @reverse, the last) row with content, or
+ *  one past the area (before it, if @reverse) if there is none
+ */
+static gint
+gimp_pickable_auto_shrink_rows (AutoShrinkData *data,
+                                gboolean        reverse)
+{
+  const GeglRectangle *area   = &data->area;
+  gint                 stride = area->width * data->bpp;
+  gint                 y1     = area->y;
+  gint                 y2     = area->y + area->height;
+  gint                 result = reverse ? y1 - 1 : y2;
+  guchar              *buf;
+  gint                 done;
+
+  buf = g_malloc (data->tile_height * stride);
+
+  for (done = 0; done < area->height; )
+    {
+      GeglRectangle rect;
+      gint          row;
+
+      /*  read strips aligned to the tile grid  */
+      if (reverse)
+        {
+          gint y = y2 - done;
+
+          rect.height = y - MAX (y1, ((y - 1) / data->tile_height) *
+                                     data->tile_height);
+          rect.y      = y - rect.height;
+        }
+      else
+        {
+          gint y = y1 + done;
+
+          rect.y      = y;
+          rect.height = MIN (y2, (y / data->tile_height + 1) *
+                                 data->tile_height) - y;
+        }
+
+      rect.x     = area->x;
+      rect.width = area->width;
+
+      gegl_buffer_get (data->buffer, &rect, 1.0, data->format, buf,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      for (row = 0; row < rect.height; row++)
+        {
+          gint r = reverse ? rect.height - 1 - row : row;
+
+          if (! gimp_pickable_auto_shrink_is_bg (data, buf + r * stride,
+                                                 area->width))
+            {
+              result = rect.y + r;
+
+              goto finish;
+            }
+        }
+
+      done += rect.height;
+    }
+
+ finish:
+
+  g_free (buf);
+
+  return result;
+}
+
+/*  returns the first (or, if @reverse, the last) column with content,
+ *  or one past the area (before it, if @reverse) if there is none
+ */
+static gint
+gimp_pickable_auto_shrink_cols (AutoShrinkData *data,
+                                gboolean        reverse)
+{
+  const GeglRectangle *area   = &data->area;
+  gint                 x1     = area->x;
+  gint                 x2     = area->x + area->width;
+  gint                 result = reverse ? x1 - 1 : x2;
+  guchar              *buf;
+  gint                 done;
+
+  buf = g_malloc (data->tile_width * area->height * data->bpp);
+
+  for (done = 0; done < area->width; )
+    {
+      GeglRectangle rect;
+      gint          stride;
+      gint          found;
+      gint          row;
+
+      if (reverse)
+        {
+          gint x = x2 - done;
+
+          rect.width = x - MAX (x1, ((x - 1) / data->tile_width) *
+                                    data->tile_width);
+          rect.x     = x - rect.width;
+        }
+      else
+        {
+          gint x = x1 + done;
+
+          rect.x     = x;
+          rect.width = MIN (x2, (x / data->tile_width + 1) *
+                                data->tile_width) - x;
+        }
+
+      rect.y      = area->y;
+      rect.height = area->height;
+
+      stride = rect.width * data->bpp;
+
+      gegl_buffer_get (data->buffer, &rect, 1.0, data->format, buf,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      /*  the outermost column with content in this strip, searching
+       *  each row only up to the best column found so far
+       */
+      found = reverse ? -1 : rect.width;
+
+      for (row = 0; row < rect.height; row++)
+        {
+          const guchar *line = buf + row * stride;
+
+          if (reverse)
+            {
+              gint n = rect.width - (found + 1);
+              gint col;
+
+              if (n == 0)
+                break;
+
+              col = gimp_pickable_auto_shrink_last_fg (data,
+                                                       line + (found + 1) *
+                                                       data->bpp,
+                                                       n);
+              if (col >= 0)
+                found += 1 + col;
+            }
+          else
+            {
+              if (found == 0)
+                break;
+
+              found = gimp_pickable_auto_shrink_first_fg (data, line, found);
+            }
+        }
+
+      if (reverse ? found >= 0 : found < rect.width)
+        {
+          result = rect.x + found;
+
+          break;
+        }
+
+      done += rect.width;
+    }
+
+  g_free (buf);
+
+  return result;
+}
+
+/*  these loops have no early exit, so the compiler can vectorize them  */
+
 static gboolean
-gimp_pickable_colors_alpha (guchar *dummy,
-                            guchar *col)
+gimp_pickable_auto_shrink_is_bg (const AutoShrinkData *data,
+                                 const guchar         *buf,
+                                 gint                  n)
 {
-  return (col[ALPHA] == 0);
+  gint i;
+
+  if (data->bpp == 1)
+    {
+      guchar diff = 0;
+
+      for (i = 0; i < n; i++)
+        diff |= buf[i];
+
+      return diff == 0;
+    }
+  else
+    {
+      const guint32 *pixels = (const guint32 *) buf;
+      guint32        diff   = 0;
+
+      for (i = 0; i < n; i++)
+        diff |= pixels[i] ^ data->bgcolor;
+
+      return diff == 0;
+    }
+}
+
+static gint
+gimp_pickable_auto_shrink_first_fg (const AutoShrinkData *data,
+                                    const guchar         *buf,
+                                    gint                  n)
+{
+  const guint32 *pixels = (const guint32 *) buf;
+  gint           i;
+
+  if (gimp_pickable_auto_shrink_is_bg (data, buf, n))
+    return n;
+
+  for (i = 0; i < n; i++)
+    {
+      if (data->bpp == 1 ? buf[i] != 0 : pixels[i] != data->bgcolor)
+        break;
+    }
+
+  return i;
+}
+
+static gint
+gimp_pickable_auto_shrink_last_fg (const AutoShrinkData *data,
+                                   const guchar         *buf,
+                                   gint                  n)
+{
+  const guint32 *pixels = (const guint32 *) buf;
+  gint           i;
+
+  if (gimp_pickable_auto_shrink_is_bg (data, buf, n))
+    return -1;
+
+  for (i = n - 1; i >= 0; i--)
+    {
+      if (data->bpp == 1 ? buf[i] != 0 : pixels[i] != data->bgcolor)
+        break;
+    }
+
+  return i;
 }
@@ -217,22 +217,50 @@ gimp_pickable_pick_color (GimpPickable *pickable,
 
   if (sample_average)
     {
-      gint    count        = 0;
-      gdouble color_avg[4] = { 0.0, 0.0, 0.0, 0.0 };
-      gint    radius       = (gint) average_radius;
-      gint    i, j;
-
-      for (i = x - radius; i <= x + radius; i++)
-        for (j = y - radius; j <= y + radius; j++)
-          if (gimp_pickable_get_pixel_at (pickable, i, j, format, pixel))
-            {
-              count++;
+      GeglBuffer    *buffer       = gimp_pickable_get_buffer (pickable);
+      const Babl    *avg_format   = babl_format ("RGBA float");
+      gdouble        color_avg[4] = { 0.0, 0.0, 0.0, 0.0 };
+      gint           radius       = (gint) average_radius;
+      GeglRectangle  rect;
+      gfloat        *buf;
+      gint           rows;
+      gint           count;
+      gint           i, j;
+
+      /*  fetch the part of the square inside the pickable in large
+       *  chunks, instead of picking each pixel on its own
+       */
+      if (! gegl_rectangle_intersect (&rect,
+                                      GEGL_RECTANGLE (x - radius, y - radius,
+                                                      2 * radius + 1,
+                                                      2 * radius + 1),
+                                      gegl_buffer_get_extent (buffer)))
+        return FALSE;
+
+      rows = CLAMP (65536 / rect.width, 1, rect.height);
+      buf  = g_new (gfloat, rows * rect.width * 4);
+
+      for (j = 0; j < rect.height; j += rows)
+        {
+          GeglRectangle  strip = { rect.x, rect.y + j,
+                                   rect.width, MIN (rows, rect.height - j) };
+          const gfloat  *p     = buf;
 
-              color_avg[RED]   += pixel[RED];
-              color_avg[GREEN] += pixel[GREEN];
-              color_avg[BLUE]  += pixel[BLUE];
-              color_avg[ALPHA] += pixel[ALPHA];
+          gegl_buffer_get (buffer, &strip, 1.0, avg_format, buf,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          for (i = strip.width * strip.height; i; i--, p += 4)
+            {
+              color_avg[RED]   += p[RED];
+              color_avg[GREEN] += p[GREEN];
+              color_avg[BLUE]  += p[BLUE];
+              color_avg[ALPHA] += p[ALPHA];
             }
+        }
+
+      g_free (buf);
+
+      count = rect.width * rect.height;
 
       pixel[RED]   = color_avg[RED]   / count;
       pixel[GREEN] = color_avg[GREEN] / count;
@@ -84,13 +84,24 @@ static void        gimp_projection_flush_whenever        (GimpProjection  *proj,
                                                           gboolean         now);
 static void        gimp_projection_idle_render_init      (GimpProjection  *proj);
 static gboolean    gimp_projection_idle_render_callback  (gpointer         data);
+static void        gimp_projection_idle_render_requeue   (GimpProjection  *proj);
+static void        gimp_projection_idle_render_invalidate(GimpProjection  *proj);
 static gboolean    gimp_projection_idle_render_next_area (GimpProjection  *proj);
+static GimpArea *  gimp_projection_idle_render_pick_area (GimpProjection  *proj);
+static gboolean    gimp_projection_idle_render_next_chunk(GimpProjection  *proj,
+                                                          GeglRectangle   *chunk);
 static void        gimp_projection_paint_area            (GimpProjection  *proj,
                                                           gboolean         now,
                                                           gint             x,
                                                           gint             y,
                                                           gint             w,
                                                           gint             h);
+static void        gimp_projection_clamp_area            (GimpProjection  *proj,
+                                                          gint             x,
+                                                          gint             y,
+                                                          gint             w,
+                                                          gint             h,
+                                                          GeglRectangle   *rect);
 static void        gimp_projection_invalidate            (GimpProjection  *proj,
                                                           guint            x,
                                                           guint            y,
@@ -236,7 +247,11 @@ gimp_projection_pickable_flush (GimpPickable *pickable)
   /* create the buffer if it doesn't exist */
   gimp_projection_get_buffer (pickable);
 
-  gimp_projection_finish_draw (proj);
+  /*  gimp_projection_finish_draw() would get the same result chunk by
+   *  chunk, invalidate the pending areas in one go instead.  The tile
+   *  handler constructs the tiles that are actually read
+   */
+  gimp_projection_idle_render_invalidate (proj);
   gimp_projection_flush_now (proj);
 
   if (proj->invalidate_preview)
@@ -389,6 +404,83 @@ gimp_projection_finish_draw (GimpProjection *proj)
     }
 }
 
+/**
+ * gimp_projection_set_priority_rect:
+ * @proj: a #GimpProjection
+ * @x:    x coordinate of the rectangle, in image coordinates
+ * @y:    y coordinate of the rectangle, in image coordinates
+ * @w:    width of the rectangle
+ * @h:    height of the rectangle
+ *
+ * Sets the area of the projection which should be rendered first,
+ * usually the visible part of the image in the active display.
+ * Pending work of the idle renderer is reprioritized accordingly.
+ * Pass an empty rectangle to render in the order of updates.
+ **/
+void
+gimp_projection_set_priority_rect (GimpProjection *proj,
+                                   gint            x,
+                                   gint            y,
+                                   gint            w,
+                                   gint            h)
+{
+  GeglRectangle rect;
+
+  g_return_if_fail (GIMP_IS_PROJECTION (proj));
+
+  gegl_rectangle_set (&rect, x, y, MAX (w, 0), MAX (h, 0));
+
+  if (gegl_rectangle_equal (&rect, &proj->priority_rect))
+    return;
+
+  proj->priority_rect = rect;
+
+  if (proj->idle_render.idle_id)
+    {
+      gimp_projection_idle_render_requeue (proj);
+
+      gimp_projection_idle_render_next_area (proj);
+    }
+}
+
+/**
+ * gimp_projection_get_n_pending:
+ * @proj: a #GimpProjection
+ *
+ * Returns: the number of update areas that are not rendered yet,
+ *          including the one the idle renderer is working on.
+ **/
+gint
+gimp_projection_get_n_pending (GimpProjection *proj)
+{
+  gint n_pending;
+
+  g_return_val_if_fail (GIMP_IS_PROJECTION (proj), 0);
+
+  n_pending = (g_slist_length (proj->update_areas) +
+               g_slist_length (proj->idle_render.update_areas));
+
+  if (proj->idle_render.idle_id)
+    n_pending++;
+
+  return n_pending;
+}
+
+/**
+ * gimp_projection_get_n_rendered:
+ * @proj: a #GimpProjection
+ *
+ * Returns: the number of pixels the idle renderer has rendered since
+ *          @proj was created.
+ **/
+gint64
+gimp_projection_get_n_rendered (GimpProjection *proj)
+{
+  g_return_val_if_fail (GIMP_IS_PROJECTION (proj), 0);
+
+  return proj->n_rendered;
+}
+
 
 /*  private functions  */
 
@@ -511,16 +603,7 @@ gimp_projection_idle_render_init (GimpProjection *proj)
    */
   if (proj->idle_render.idle_id)
     {
-      GimpArea *area =
-        gimp_area_new (proj->idle_render.base_x,
-                       proj->idle_render.y,
-                       proj->idle_render.base_x + proj->idle_render.width,
-                       proj->idle_render.y + (proj->idle_render.height -
-                                               (proj->idle_render.y -
-                                                proj->idle_render.base_y)));
-
-      proj->idle_render.update_areas =
-        gimp_area_list_process (proj->idle_render.update_areas, area);
+      gimp_projection_idle_render_requeue (proj);
 
       gimp_projection_idle_render_next_area (proj);
     }
@@ -547,65 +630,143 @@ gimp_projection_idle_render_init (GimpProjection *proj)
  * them into bite-sized chunks which are chewed on in a low- priority
  * idle thread.  This greatly improves responsiveness for many GIMP
  * operations.  -- Adam
+ *
+ * The idle renderer handles one chunk per iteration, in the main
+ * thread: GEGL can't process the projection's graph from several
+ * threads at once.
  */
 static gboolean
 gimp_projection_idle_render_callback (gpointer data)
 {
   GimpProjection *proj = data;
-  gint            workx, worky;
-  gint            workw, workh;
+  GeglRectangle   chunk;
 
-  workw = GIMP_PROJECTION_IDLE_CHUNK_WIDTH;
-  workh = GIMP_PROJECTION_IDLE_CHUNK_HEIGHT;
-  workx = proj->idle_render.x;
-  worky = proj->idle_render.y;
+  if (gimp_projection_idle_render_next_chunk (proj, &chunk))
+    {
+      proj->n_rendered += (gint64) chunk.width * (gint64) chunk.height;
 
-  if (workx + workw > proj->idle_render.base_x + proj->idle_render.width)
+      gimp_projection_paint_area (proj, TRUE /* sic! */,
+                                  chunk.x,
+                                  chunk.y,
+                                  chunk.width,
+                                  chunk.height);
+    }
+  else
     {
-      workw = proj->idle_render.base_x + proj->idle_render.width - workx;
+      /* FINISHED */
+      proj->idle_render.idle_id = 0;
+
+      if (proj->invalidate_preview)
+        {
+          /* invalidate the preview here since it is constructed from
+           * the projection
+           */
+          proj->invalidate_preview = FALSE;
+
+          gimp_projectable_invalidate_preview (proj->projectable);
+        }
+
+      return FALSE;
     }
 
-  if (worky + workh > proj->idle_render.base_y + proj->idle_render.height)
+  /* Still work to do. */
+  return TRUE;
+}
+
+static gboolean
+gimp_projection_idle_render_next_chunk (GimpProjection *proj,
+                                        GeglRectangle  *chunk)
+{
+  GimpProjectionIdleRender *idle_render = &proj->idle_render;
+
+  if (idle_render->y >= idle_render->base_y + idle_render->height)
     {
-      workh = proj->idle_render.base_y + proj->idle_render.height - worky;
+      if (! gimp_projection_idle_render_next_area (proj))
+        return FALSE;
     }
 
-  gimp_projection_paint_area (proj, TRUE /* sic! */,
-                              workx, worky, workw, workh);
+  chunk->x      = idle_render->x;
+  chunk->y      = idle_render->y;
+  chunk->width  = MIN (GIMP_PROJECTION_IDLE_CHUNK_WIDTH,
+                       idle_render->base_x + idle_render->width -
+                       idle_render->x);
+  chunk->height = MIN (GIMP_PROJECTION_IDLE_CHUNK_HEIGHT,
+                       idle_render->base_y + idle_render->height -
+                       idle_render->y);
 
-  proj->idle_render.x += GIMP_PROJECTION_IDLE_CHUNK_WIDTH;
+  idle_render->x += GIMP_PROJECTION_IDLE_CHUNK_WIDTH;
 
-  if (proj->idle_render.x >=
-      proj->idle_render.base_x + proj->idle_render.width)
+  if (idle_render->x >= idle_render->base_x + idle_render->width)
     {
-      proj->idle_render.x = proj->idle_render.base_x;
-      proj->idle_render.y += GIMP_PROJECTION_IDLE_CHUNK_HEIGHT;
+      idle_render->x  = idle_render->base_x;
+      idle_render->y += GIMP_PROJECTION_IDLE_CHUNK_HEIGHT;
+    }
 
-      if (proj->idle_render.y >=
-          proj->idle_render.base_y + proj->idle_render.height)
-        {
-          if (! gimp_projection_idle_render_next_area (proj))
-            {
-              /* FINISHED */
-              proj->idle_render.idle_id = 0;
+  return TRUE;
+}
 
-              if (proj->invalidate_preview)
-                {
-                  /* invalidate the preview here since it is constructed from
-                   * the projection
-                   */
-                  proj->invalidate_preview = FALSE;
+/*  merges the unrendered remainder of the current area back into the
+ *  list of update areas
+ */
+static void
+gimp_projection_idle_render_requeue (GimpProjection *proj)
+{
+  GimpArea *area;
 
-                  gimp_projectable_invalidate_preview (proj->projectable);
-                }
+  if (proj->idle_render.y >= proj->idle_render.base_y + proj->idle_render.height)
+    return;
 
-              return FALSE;
-            }
+  area = gimp_area_new (proj->idle_render.base_x,
+                        proj->idle_render.y,
+                        proj->idle_render.base_x + proj->idle_render.width,
+                        proj->idle_render.y + (proj->idle_render.height -
+                                                (proj->idle_render.y -
+                                                 proj->idle_render.base_y)));
+
+  proj->idle_render.update_areas =
+    gimp_area_list_process (proj->idle_render.update_areas, area);
+
+  /*  mark the current area as done  */
+  proj->idle_render.y = proj->idle_render.base_y + proj->idle_render.height;
+}
+
+/*  stops the idle renderer and invalidates everything it didn't
+ *  render yet at once, without constructing any of it.  Like with the
+ *  idle renderer's chunks, the update signals only queue redraws, the
+ *  displays construct what is visible when they are exposed
+ */
+static void
+gimp_projection_idle_render_invalidate (GimpProjection *proj)
+{
+  GSList *list;
+
+  if (! proj->idle_render.idle_id)
+    return;
+
+  g_source_remove (proj->idle_render.idle_id);
+  proj->idle_render.idle_id = 0;
+
+  gimp_projection_idle_render_requeue (proj);
+
+  for (list = proj->idle_render.update_areas;
+       list;
+       list = g_slist_next (list))
+    {
+      GimpArea *area = list->data;
+
+      if ((area->x1 != area->x2) && (area->y1 != area->y2))
+        {
+          gimp_projection_paint_area (proj,
+                                      TRUE, /* sic! */
+                                      area->x1,
+                                      area->y1,
+                                      (area->x2 - area->x1),
+                                      (area->y2 - area->y1));
         }
     }
 
-  /* Still work to do. */
-  return TRUE;
+  gimp_area_list_free (proj->idle_render.update_areas);
+  proj->idle_render.update_areas = NULL;
 }
 
 static gboolean
@@ -616,10 +777,7 @@ gimp_projection_idle_render_next_area (GimpProjection *proj)
   if (! proj->idle_render.update_areas)
     return FALSE;
 
-  area = proj->idle_render.update_areas->data;
-
-  proj->idle_render.update_areas =
-    g_slist_remove (proj->idle_render.update_areas, area);
+  area = gimp_projection_idle_render_pick_area (proj);
 
   proj->idle_render.x      = proj->idle_render.base_x = area->x1;
   proj->idle_render.y      = proj->idle_render.base_y = area->y1;
@@ -631,6 +789,111 @@ gimp_projection_idle_render_next_area (GimpProjection *proj)
   return TRUE;
 }
 
+/*  removes the most urgent area from the idle render's update areas.
+ *  Without a priority rectangle, areas are rendered in insertion
+ *  order.  Otherwise, the area closest to the center of the priority
+ *  rectangle is picked, and if it only partially overlaps the
+ *  rectangle, the overlapping part is split off and rendered first.
+ */
+static GimpArea *
+gimp_projection_idle_render_pick_area (GimpProjection *proj)
+{
+  GimpArea *best = proj->idle_render.update_areas->data;
+  GSList   *list;
+  gint      off_x, off_y;
+  gint      px1, py1, px2, py2;
+  gint      cx, cy;
+  gint64    best_dist = G_MAXINT64;
+
+  if (gegl_rectangle_is_empty (&proj->priority_rect))
+    {
+      proj->idle_render.update_areas =
+        g_slist_remove (proj->idle_render.update_areas, best);
+
+      return best;
+    }
+
+  /*  the update areas are in tile-pyramid coordinates  */
+  gimp_projectable_get_offset (proj->projectable, &off_x, &off_y);
+
+  px1 = proj->priority_rect.x - off_x;
+  py1 = proj->priority_rect.y - off_y;
+  px2 = px1 + proj->priority_rect.width;
+  py2 = py1 + proj->priority_rect.height;
+
+  cx = (px1 + px2) / 2;
+  cy = (py1 + py2) / 2;
+
+  for (list = proj->idle_render.update_areas; list; list = g_slist_next (list))
+    {
+      GimpArea *area = list->data;
+      gint64    dx   = 0;
+      gint64    dy   = 0;
+      gint64    dist;
+
+      if (cx < area->x1)
+        dx = area->x1 - cx;
+      else if (cx >= area->x2)
+        dx = cx - area->x2 + 1;
+
+      if (cy < area->y1)
+        dy = area->y1 - cy;
+      else if (cy >= area->y2)
+        dy = cy - area->y2 + 1;
+
+      dist = dx * dx + dy * dy;
+
+      if (dist < best_dist)
+        {
+          best      = area;
+          best_dist = dist;
+        }
+    }
+
+  proj->idle_render.update_areas =
+    g_slist_remove (proj->idle_render.update_areas, best);
+
+  if (best->x1 < px2 && best->x2 > px1 &&
+      best->y1 < py2 && best->y2 > py1)
+    {
+      gint x1 = MAX (best->x1, px1);
+      gint y1 = MAX (best->y1, py1);
+      gint x2 = MIN (best->x2, px2);
+      gint y2 = MIN (best->y2, py2);
+
+      /*  queue the non-visible bands around the intersection; they
+       *  don't overlap, so bypass gimp_area_list_process(), which
+       *  would merge them right back
+       */
+      if (best->y1 < y1)
+        proj->idle_render.update_areas =
+          g_slist_prepend (proj->idle_render.update_areas,
+                           gimp_area_new (best->x1, best->y1, best->x2, y1));
+
+      if (best->y2 > y2)
+        proj->idle_render.update_areas =
+          g_slist_prepend (proj->idle_render.update_areas,
+                           gimp_area_new (best->x1, y2, best->x2, best->y2));
+
+      if (best->x1 < x1)
+        proj->idle_render.update_areas =
+          g_slist_prepend (proj->idle_render.update_areas,
+                           gimp_area_new (best->x1, y1, x1, y2));
+
+      if (best->x2 > x2)
+        proj->idle_render.update_areas =
+          g_slist_prepend (proj->idle_render.update_areas,
+                           gimp_area_new (x2, y1, best->x2, y2));
+
+      best->x1 = x1;
+      best->y1 = y1;
+      best->x2 = x2;
+      best->y2 = y2;
+    }
+
+  return best;
+}
+
 static void
 gimp_projection_paint_area (GimpProjection *proj,
                             gboolean        now,
@@ -639,20 +902,14 @@ gimp_projection_paint_area (GimpProjection *proj,
                             gint            w,
                             gint            h)
 {
-  gint off_x, off_y;
-  gint width, height;
-  gint x1, y1, x2, y2;
+  GeglRectangle rect;
+  gint          off_x, off_y;
 
   gimp_projectable_get_offset (proj->projectable, &off_x, &off_y);
-  gimp_projectable_get_size   (proj->projectable, &width, &height);
 
-  /*  Bounds check  */
-  x1 = CLAMP (x,     0, width);
-  y1 = CLAMP (y,     0, height);
-  x2 = CLAMP (x + w, 0, width);
-  y2 = CLAMP (y + h, 0, height);
+  gimp_projection_clamp_area (proj, x, y, w, h, &rect);
 
-  gimp_projection_invalidate (proj, x1, y1, x2 - x1, y2 - y1);
+  gimp_projection_invalidate (proj, rect.x, rect.y, rect.width, rect.height);
 
   /*  add the projectable's offsets because the list of update areas
    *  is in tile-pyramid coordinates, but our external API is always
@@ -660,10 +917,32 @@ gimp_projection_paint_area (GimpProjection *proj,
    */
   g_signal_emit (proj, projection_signals[UPDATE], 0,
                  now,
-                 x1 + off_x,
-                 y1 + off_y,
-                 x2 - x1,
-                 y2 - y1);
+                 rect.x + off_x,
+                 rect.y + off_y,
+                 rect.width,
+                 rect.height);
+}
+
+static void
+gimp_projection_clamp_area (GimpProjection *proj,
+                            gint            x,
+                            gint            y,
+                            gint            w,
+                            gint            h,
+                            GeglRectangle  *rect)
+{
+  gint width, height;
+  gint x1, y1, x2, y2;
+
+  gimp_projectable_get_size (proj->projectable, &width, &height);
+
+  /*  Bounds check  */
+  x1 = CLAMP (x,     0, width);
+  y1 = CLAMP (y,     0, height);
+  x2 = CLAMP (x + w, 0, width);
+  y2 = CLAMP (y + h, 0, height);
+
+  gegl_rectangle_set (rect, x1, y1, x2 - x1, y2 - y1);
 }
 
 static void
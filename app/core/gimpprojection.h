@@ -59,8 +59,12 @@ struct _GimpProjection
 
   GSList                   *update_areas;
   GimpProjectionIdleRender  idle_render;
+  GeglRectangle             priority_rect;
 
   gboolean                  invalidate_preview;
+
+  /*  pixels handed out by the idle renderer  */
+  gint64                    n_rendered;
 };
 
 struct _GimpProjectionClass
@@ -84,6 +88,16 @@ void             gimp_projection_flush            (GimpProjection    *proj);
 void             gimp_projection_flush_now        (GimpProjection    *proj);
 void             gimp_projection_finish_draw      (GimpProjection    *proj);
 
+void             gimp_projection_set_priority_rect
+                                                  (GimpProjection    *proj,
+                                                   gint               x,
+                                                   gint               y,
+                                                   gint               w,
+                                                   gint               h);
+
+gint             gimp_projection_get_n_pending    (GimpProjection    *proj);
+gint64           gimp_projection_get_n_rendered   (GimpProjection    *proj);
+
 gint64           gimp_projection_estimate_memsize (GimpImageBaseType  type,
                                                    GimpPrecision      precision,
                                                    gint               width,
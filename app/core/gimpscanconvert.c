@@ -28,10 +28,14 @@
 
 #include "core-types.h"
 
+#include "gimp-parallel.h"
 #include "gimpbezierdesc.h"
 #include "gimpscanconvert.h"
 
 
+#define MIN_PARALLEL_SUB_AREA (64 * 64)
+
+
 struct _GimpScanConvert
 {
   gdouble         ratio_xy;
@@ -54,6 +58,36 @@ struct _GimpScanConvert
   GArray         *path_data;
 };
 
+typedef struct
+{
+  GimpScanConvert *sc;
+  GeglBuffer      *buffer;
+  GeglRectangle    area;
+  gint             off_x;
+  gint             off_y;
+  gboolean         replace;
+  gboolean         antialias;
+  gdouble          value;
+  cairo_path_t     path;
+  gint             tile_height;
+  gint             shift_y;
+  gint             first_tile;
+  gint             n_tiles;
+} GimpScanConvertRenderData;
+
+
+static void   gimp_scan_convert_setup_cairo   (GimpScanConvert           *sc,
+                                               cairo_t                   *cr,
+                                               cairo_path_t              *path,
+                                               gboolean                   antialias);
+static void   gimp_scan_convert_get_bounds    (GimpScanConvert           *sc,
+                                               cairo_path_t              *path,
+                                               gboolean                   antialias,
+                                               GeglRectangle             *bounds);
+static void   gimp_scan_convert_render_stripe (gint                       i,
+                                               gint                       n,
+                                               GimpScanConvertRenderData *data);
+
 
 /*  public functions  */
 
@@ -448,47 +482,194 @@ gimp_scan_convert_render_full (GimpScanConvert *sc,
                                gboolean         antialias,
                                gdouble          value)
 {
-  const Babl         *format;
-  GeglBufferIterator *iter;
-  GeglRectangle      *roi;
-  cairo_t            *cr;
-  cairo_surface_t    *surface;
-  cairo_path_t        path;
-  gint                bpp;
-  gint                x, y;
-  gint                width, height;
+  GimpScanConvertRenderData  data;
+  const GeglRectangle       *extent;
+  GeglRectangle              area;
+  GeglRectangle              bounds;
+  gint                       n;
 
   g_return_if_fail (sc != NULL);
   g_return_if_fail (GEGL_IS_BUFFER (buffer));
 
-  x      = 0;
-  y      = 0;
-  width  = gegl_buffer_get_width  (buffer);
-  height = gegl_buffer_get_height (buffer);
+  extent = gegl_buffer_get_extent (buffer);
+  area   = *extent;
+
+  if (sc->clip && ! gegl_rectangle_intersect (&area, &area,
+                                              GEGL_RECTANGLE (sc->clip_x,
+                                                              sc->clip_y,
+                                                              sc->clip_w,
+                                                              sc->clip_h)))
+    return;
+
+  data.sc        = sc;
+  data.buffer    = buffer;
+  data.off_x     = off_x;
+  data.off_y     = off_y;
+  data.replace   = replace;
+  data.antialias = antialias;
+  data.value     = value;
+
+  data.path.status   = CAIRO_STATUS_SUCCESS;
+  data.path.data     = (cairo_path_data_t *) sc->path_data->data;
+  data.path.num_data = sc->path_data->len;
+
+  /*  only the tiles that the path touches need to be rendered, the
+   *  others are cleared at once if we replace
+   */
+  gimp_scan_convert_get_bounds (sc, &data.path, antialias, &bounds);
 
-  if (sc->clip && ! gimp_rectangle_intersect (x, y, width, height,
-                                              sc->clip_x, sc->clip_y,
-                                              sc->clip_w, sc->clip_h,
-                                              &x, &y, &width, &height))
+  bounds.x -= off_x;
+  bounds.y -= off_y;
+
+  if (replace)
+    gegl_buffer_clear (buffer, &area);
+
+  if (! gegl_rectangle_intersect (&data.area, &area, &bounds))
     return;
 
-  path.status   = CAIRO_STATUS_SUCCESS;
-  path.data     = (cairo_path_data_t *) sc->path_data->data;
-  path.num_data = sc->path_data->len;
+  g_object_get (buffer,
+                "tile-height", &data.tile_height,
+                "shift-y",     &data.shift_y,
+                NULL);
+
+  data.first_tile = floor ((gdouble) (data.area.y + data.shift_y) /
+                           data.tile_height);
+  data.n_tiles    = ceil ((gdouble) (data.area.y + data.area.height +
+                                     data.shift_y) /
+                          data.tile_height) - data.first_tile;
+
+  /*  render stripes of tile rows in parallel, each with its own
+   *  cairo contexts, so no two threads write to the same tile
+   */
+  n = ((gint64) data.area.width * data.area.height) / MIN_PARALLEL_SUB_AREA;
+  n = CLAMP (n, 1, data.n_tiles);
+
+  gimp_parallel_distribute (n,
+                            (GimpParallelDistributeFunc)
+                            gimp_scan_convert_render_stripe,
+                            &data);
+}
+
+
+/*  private functions  */
+
+/*  sets up @cr for filling or stroking the path, without changing
+ *  its target
+ */
+static void
+gimp_scan_convert_setup_cairo (GimpScanConvert *sc,
+                               cairo_t         *cr,
+                               cairo_path_t    *path,
+                               gboolean         antialias)
+{
+  cairo_append_path (cr, path);
+
+  cairo_set_antialias (cr, antialias ?
+                       CAIRO_ANTIALIAS_GRAY : CAIRO_ANTIALIAS_NONE);
+  cairo_set_miter_limit (cr, sc->miter);
+
+  if (sc->do_stroke)
+    {
+      cairo_set_line_cap (cr,
+                          sc->cap == GIMP_CAP_BUTT ? CAIRO_LINE_CAP_BUTT :
+                          sc->cap == GIMP_CAP_ROUND ? CAIRO_LINE_CAP_ROUND :
+                          CAIRO_LINE_CAP_SQUARE);
+      cairo_set_line_join (cr,
+                           sc->join == GIMP_JOIN_MITER ? CAIRO_LINE_JOIN_MITER :
+                           sc->join == GIMP_JOIN_ROUND ? CAIRO_LINE_JOIN_ROUND :
+                           CAIRO_LINE_JOIN_BEVEL);
+
+      cairo_set_line_width (cr, sc->width);
+
+      if (sc->dash_info)
+        cairo_set_dash (cr,
+                        (double *) sc->dash_info->data,
+                        sc->dash_info->len,
+                        sc->dash_offset);
+
+      cairo_scale (cr, 1.0, sc->ratio_xy);
+    }
+  else
+    {
+      cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
+    }
+}
+
+/*  returns the pixels that filling or stroking the path can touch,
+ *  in the coordinates of the path
+ */
+static void
+gimp_scan_convert_get_bounds (GimpScanConvert *sc,
+                              cairo_path_t    *path,
+                              gboolean         antialias,
+                              GeglRectangle   *bounds)
+{
+  cairo_surface_t *surface;
+  cairo_t         *cr;
+  gdouble          x1, y1;
+  gdouble          x2, y2;
+
+  surface = cairo_image_surface_create (CAIRO_FORMAT_A8, 1, 1);
+  cr = cairo_create (surface);
+
+  gimp_scan_convert_setup_cairo (sc, cr, path, antialias);
+
+  if (sc->do_stroke)
+    cairo_stroke_extents (cr, &x1, &y1, &x2, &y2);
+  else
+    cairo_fill_extents (cr, &x1, &y1, &x2, &y2);
+
+  cairo_user_to_device (cr, &x1, &y1);
+  cairo_user_to_device (cr, &x2, &y2);
+
+  cairo_destroy (cr);
+  cairo_surface_destroy (surface);
+
+  bounds->x      = floor (MIN (x1, x2)) - 1;
+  bounds->y      = floor (MIN (y1, y2)) - 1;
+  bounds->width  = ceil  (MAX (x1, x2)) + 1 - bounds->x;
+  bounds->height = ceil  (MAX (y1, y2)) + 1 - bounds->y;
+}
+
+static void
+gimp_scan_convert_render_stripe (gint                       i,
+                                 gint                       n,
+                                 GimpScanConvertRenderData *data)
+{
+  GeglBufferIterator *iter;
+  GeglRectangle      *roi;
+  GeglRectangle       stripe = data->area;
+  const Babl         *format;
+  gint                bpp;
+  gint                first;
+  gint                last;
+
+  first = data->first_tile + data->n_tiles * i       / n;
+  last  = data->first_tile + data->n_tiles * (i + 1) / n;
+
+  stripe.y      = MAX (first * data->tile_height - data->shift_y,
+                       data->area.y);
+  stripe.height = MIN (last  * data->tile_height - data->shift_y,
+                       data->area.y + data->area.height) - stripe.y;
+
+  if (stripe.height <= 0)
+    return;
 
   format = babl_format ("Y u8");
   bpp    = babl_format_get_bytes_per_pixel (format);
 
-  iter = gegl_buffer_iterator_new (buffer, NULL, 0, format,
+  iter = gegl_buffer_iterator_new (data->buffer, &stripe, 0, format,
                                    GEGL_BUFFER_READWRITE, GEGL_ABYSS_NONE);
   roi = &iter->roi[0];
 
   while (gegl_buffer_iterator_next (iter))
     {
-      guchar     *data    = iter->data[0];
-      guchar     *tmp_buf = NULL;
-      const gint  stride  = cairo_format_stride_for_width (CAIRO_FORMAT_A8,
-                                                           roi->width);
+      guchar          *data_ptr = iter->data[0];
+      guchar          *tmp_buf  = NULL;
+      cairo_t         *cr;
+      cairo_surface_t *surface;
+      const gint       stride   = cairo_format_stride_for_width (CAIRO_FORMAT_A8,
+                                                                 roi->width);
 
       /*  cairo rowstrides are always multiples of 4, whereas
        *  maskPR.rowstride can be anything, so to be able to create an
@@ -499,13 +680,13 @@ gimp_scan_convert_render_full (GimpScanConvert *sc,
         {
           tmp_buf = g_alloca (stride * roi->height);
 
-          if (! replace)
+          if (! data->replace)
             {
-              const guchar *src  = data;
+              const guchar *src  = data_ptr;
               guchar       *dest = tmp_buf;
-              gint          i;
+              gint          j;
 
-              for (i = 0; i < roi->height; i++)
+              for (j = 0; j < roi->height; j++)
                 {
                   memcpy (dest, src, roi->width * bpp);
 
@@ -516,57 +697,32 @@ gimp_scan_convert_render_full (GimpScanConvert *sc,
         }
 
       surface = cairo_image_surface_create_for_data (tmp_buf ?
-                                                     tmp_buf : data,
+                                                     tmp_buf : data_ptr,
                                                      CAIRO_FORMAT_A8,
                                                      roi->width, roi->height,
                                                      stride);
 
       cairo_surface_set_device_offset (surface,
-                                       -off_x - roi->x,
-                                       -off_y - roi->y);
+                                       -data->off_x - roi->x,
+                                       -data->off_y - roi->y);
       cr = cairo_create (surface);
       cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
 
-      if (replace)
+      if (data->replace)
         {
           cairo_set_source_rgba (cr, 0, 0, 0, 0);
           cairo_paint (cr);
         }
 
-      cairo_set_source_rgba (cr, 0, 0, 0, value);
-      cairo_append_path (cr, &path);
+      cairo_set_source_rgba (cr, 0, 0, 0, data->value);
 
-      cairo_set_antialias (cr, antialias ?
-                           CAIRO_ANTIALIAS_GRAY : CAIRO_ANTIALIAS_NONE);
-      cairo_set_miter_limit (cr, sc->miter);
+      gimp_scan_convert_setup_cairo (data->sc, cr, &data->path,
+                                     data->antialias);
 
-      if (sc->do_stroke)
-        {
-          cairo_set_line_cap (cr,
-                              sc->cap == GIMP_CAP_BUTT ? CAIRO_LINE_CAP_BUTT :
-                              sc->cap == GIMP_CAP_ROUND ? CAIRO_LINE_CAP_ROUND :
-                              CAIRO_LINE_CAP_SQUARE);
-          cairo_set_line_join (cr,
-                               sc->join == GIMP_JOIN_MITER ? CAIRO_LINE_JOIN_MITER :
-                               sc->join == GIMP_JOIN_ROUND ? CAIRO_LINE_JOIN_ROUND :
-                               CAIRO_LINE_JOIN_BEVEL);
-
-          cairo_set_line_width (cr, sc->width);
-
-          if (sc->dash_info)
-            cairo_set_dash (cr,
-                            (double *) sc->dash_info->data,
-                            sc->dash_info->len,
-                            sc->dash_offset);
-
-          cairo_scale (cr, 1.0, sc->ratio_xy);
-          cairo_stroke (cr);
-        }
+      if (data->sc->do_stroke)
+        cairo_stroke (cr);
       else
-        {
-          cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
-          cairo_fill (cr);
-        }
+        cairo_fill (cr);
 
       cairo_destroy (cr);
       cairo_surface_destroy (surface);
@@ -574,10 +730,10 @@ gimp_scan_convert_render_full (GimpScanConvert *sc,
       if (tmp_buf)
         {
           const guchar *src  = tmp_buf;
-          guchar       *dest = data;
-          gint          i;
+          guchar       *dest = data_ptr;
+          gint          j;
 
-          for (i = 0; i < roi->height; i++)
+          for (j = 0; j < roi->height; j++)
             {
               memcpy (dest, src, roi->width * bpp);
 
@@ -25,6 +25,7 @@
 
 #include "gegl/gimp-babl.h"
 #include "gegl/gimp-gegl-apply-operation.h"
+#include "gegl/gimp-gegl-utils.h"
 
 #include "gimp.h"
 #include "gimp-edit.h"
@@ -107,6 +108,7 @@ static gboolean   gimp_selection_is_empty      (GimpChannel         *channel);
 static void       gimp_selection_feather       (GimpChannel         *channel,
                                                 gdouble              radius_x,
                                                 gdouble              radius_y,
+                                                GimpProgress        *progress,
                                                 gboolean             push_undo);
 static void       gimp_selection_sharpen       (GimpChannel         *channel,
                                                 gboolean             push_undo);
@@ -469,13 +471,14 @@ gimp_selection_is_empty (GimpChannel *channel)
 }
 
 static void
-gimp_selection_feather (GimpChannel *channel,
-                        gdouble      radius_x,
-                        gdouble      radius_y,
-                        gboolean     push_undo)
+gimp_selection_feather (GimpChannel  *channel,
+                        gdouble       radius_x,
+                        gdouble       radius_y,
+                        GimpProgress *progress,
+                        gboolean      push_undo)
 {
   GIMP_CHANNEL_CLASS (parent_class)->feather (channel, radius_x, radius_y,
-                                              push_undo);
+                                              progress, push_undo);
 }
 
 static void
@@ -618,7 +621,7 @@ gimp_selection_load (GimpSelection *selection,
                     gimp_drawable_get_buffer (GIMP_DRAWABLE (selection)),
                     NULL);
 
-  GIMP_CHANNEL (selection)->bounds_known = FALSE;
+  gimp_channel_invalidate_bounds (GIMP_CHANNEL (selection), NULL);
 
   gimp_drawable_update (GIMP_DRAWABLE (selection),
                         0, 0, width, height);
@@ -733,13 +736,25 @@ gimp_selection_extract (GimpSelection *selection,
 
   src_buffer = gimp_pickable_get_buffer (pickable);
 
-  /*  Allocate the temp buffer  */
-  dest_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, x2 - x1, y2 - y1),
-                                 dest_format);
+  if (dest_format == gegl_buffer_get_format (src_buffer))
+    {
+      /*  Share the tiles with the source, they are only copied when
+       *  either buffer changes them
+       */
+      dest_buffer =
+        gimp_gegl_buffer_dup_rect (src_buffer,
+                                   GEGL_RECTANGLE (x1, y1, x2 - x1, y2 - y1));
+    }
+  else
+    {
+      /*  Allocate the temp buffer  */
+      dest_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, x2 - x1, y2 - y1),
+                                     dest_format);
 
-  /*  First, copy the pixels, possibly doing INDEXED->RGB and adding alpha  */
-  gegl_buffer_copy (src_buffer, GEGL_RECTANGLE (x1, y1, x2 - x1, y2 - y1),
-                    dest_buffer, GEGL_RECTANGLE (0, 0,0 ,0 ));
+      /*  Copy the pixels, possibly doing INDEXED->RGB and adding alpha  */
+      gegl_buffer_copy (src_buffer, GEGL_RECTANGLE (x1, y1, x2 - x1, y2 - y1),
+                        dest_buffer, GEGL_RECTANGLE (0, 0, 0, 0));
+    }
 
   if (non_empty)
     {
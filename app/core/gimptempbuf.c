@@ -26,6 +26,8 @@
 
 #include "core-types.h"
 
+#include "gegl/gimp-gegl-loops.h"
+
 #include "gimptempbuf.h"
 
 
@@ -110,6 +112,7 @@ gimp_temp_buf_scale (const GimpTempBuf *src,
                      gint               new_height)
 {
   GimpTempBuf  *dest;
+  GimpTempBuf  *reduced = NULL;
   const guchar *src_data;
   guchar       *dest_data;
   gdouble       x_ratio;
@@ -124,6 +127,37 @@ gimp_temp_buf_scale (const GimpTempBuf *src,
   if (new_width == src->width && new_height == src->height)
     return gimp_temp_buf_copy (src);
 
+  bytes = babl_format_get_bytes_per_pixel (src->format);
+
+  /*  reduce by more than 2 with box filters first, so the nearest
+   *  neighbor sampling below doesn't skip most of the pixels
+   */
+  while (new_width * 2 <= src->width && new_height * 2 <= src->height)
+    {
+      GimpTempBuf *half = gimp_temp_buf_new (src->width  / 2,
+                                             src->height / 2,
+                                             src->format);
+
+      if (! gimp_gegl_downscale_2x (src->format,
+                                    gimp_temp_buf_get_data (src),
+                                    src->width * bytes,
+                                    gimp_temp_buf_get_data (half),
+                                    half->width * bytes,
+                                    half->width, half->height))
+        {
+          gimp_temp_buf_unref (half);
+          break;
+        }
+
+      if (reduced)
+        gimp_temp_buf_unref (reduced);
+
+      src = reduced = half;
+    }
+
+  if (new_width == src->width && new_height == src->height)
+    return reduced;
+
   dest = gimp_temp_buf_new (new_width,
                             new_height,
                             src->format);
@@ -134,8 +168,6 @@ gimp_temp_buf_scale (const GimpTempBuf *src,
   x_ratio = (gdouble) src->width  / (gdouble) new_width;
   y_ratio = (gdouble) src->height / (gdouble) new_height;
 
-  bytes = babl_format_get_bytes_per_pixel (src->format);
-
   for (loop1 = 0 ; loop1 < new_height ; loop1++)
     {
       for (loop2 = 0 ; loop2 < new_width ; loop2++)
@@ -156,6 +188,9 @@ gimp_temp_buf_scale (const GimpTempBuf *src,
         }
     }
 
+  if (reduced)
+    gimp_temp_buf_unref (reduced);
+
   return dest;
 }
 
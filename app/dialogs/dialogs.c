@@ -315,6 +315,10 @@ static const GimpDialogFactoryEntry entries[] =
             N_("Pointer"), N_("Pointer Information"), GIMP_STOCK_CURSOR,
             GIMP_HELP_POINTER_INFO_DIALOG,
             dialogs_cursor_view_new, 0, TRUE),
+  DOCKABLE ("gimp-dashboard",
+            N_("Dashboard"), NULL, GIMP_STOCK_INFO,
+            GIMP_HELP_DASHBOARD_DIALOG,
+            dialogs_dashboard_new, 0, TRUE),
 
   /*  list & grid views  */
   LISTGRID (image, N_("Images"), NULL, GIMP_STOCK_IMAGES,
@@ -54,6 +54,14 @@
 #include "gimp-intl.h"
 
 
+typedef struct
+{
+  Gimp         *gimp;
+  GimpProgress *progress;
+  gchar        *uri;
+} FileSaveDialogAsync;
+
+
 /*  local function prototypes  */
 
 static GtkFileChooserConfirmation
@@ -77,6 +85,15 @@ static void      file_save_dialog_unknown_ext_msg           (GimpFileDialog
                                                              const gchar          *basename);
 static gboolean  file_save_dialog_use_extension             (GtkWidget            *save_dialog,
                                                              const gchar          *uri);
+static void      file_save_dialog_save_done                 (GimpImage            *image,
+                                                             GimpPDBStatusType     status,
+                                                             const GError         *error,
+                                                             gpointer              data);
+static void      file_save_dialog_save_failed               (Gimp                 *gimp,
+                                                             GimpProgress         *progress,
+                                                             const gchar          *uri,
+                                                             const GError         *error);
+static void      file_save_dialog_block_quit                (gboolean              block);
 
 
 /*  public functions  */
@@ -184,6 +201,16 @@ file_save_dialog_response (GtkWidget *save_dialog,
     {
       gimp_file_dialog_set_sensitive (dialog, FALSE);
 
+      if (dialog->compression_toggle)
+        {
+          GtkToggleButton *toggle;
+
+          toggle = GTK_TOGGLE_BUTTON (dialog->compression_toggle);
+
+          gimp_image_set_xcf_compression (dialog->image,
+                                          gtk_toggle_button_get_active (toggle));
+        }
+
       if (file_save_dialog_save_image (GIMP_PROGRESS (save_dialog),
                                        gimp,
                                        dialog->image,
@@ -623,15 +650,9 @@ file_save_dialog_save_image (GimpProgress        *progress,
 {
   GimpPDBStatusType  status;
   GError            *error   = NULL;
-  GList             *list;
   gboolean           success = FALSE;
 
-  for (list = gimp_action_groups_from_name ("file");
-       list;
-       list = g_list_next (list))
-    {
-      gimp_action_group_set_action_sensitive (list->data, "file-quit", FALSE);
-    }
+  file_save_dialog_block_quit (TRUE);
 
   status = file_save (gimp, image, progress, uri,
                       save_proc, run_mode,
@@ -652,23 +673,118 @@ file_save_dialog_save_image (GimpProgress        *progress,
       break;
 
     default:
-      {
-        gchar *filename = file_utils_uri_display_name (uri);
-
-        gimp_message (gimp, G_OBJECT (progress), GIMP_MESSAGE_ERROR,
-                      _("Saving '%s' failed:\n\n%s"), filename, error->message);
-        g_clear_error (&error);
-        g_free (filename);
-      }
+      file_save_dialog_save_failed (gimp, progress, uri, error);
+      g_clear_error (&error);
       break;
     }
 
+  file_save_dialog_block_quit (FALSE);
+
+  return success;
+}
+
+/**
+ * file_save_dialog_save_image_async:
+ * @progress:  the progress to show the save on
+ * @gimp:      a #Gimp
+ * @image:     the image to save
+ * @uri:       the URI to save to
+ * @save_proc: the save procedure
+ *
+ * Saves @image to @uri like file_save_dialog_save_image() would do
+ * with the last values, but in the background if @save_proc can do
+ * that, errors are shown when the save is done.
+ *
+ * Return value: %TRUE if the image was saved, or is being saved.
+ **/
+gboolean
+file_save_dialog_save_image_async (GimpProgress        *progress,
+                                   Gimp                *gimp,
+                                   GimpImage           *image,
+                                   const gchar         *uri,
+                                   GimpPlugInProcedure *save_proc)
+{
+  FileSaveDialogAsync *async;
+  GError              *error = NULL;
+
+  if (! file_save_can_async (uri, save_proc))
+    return file_save_dialog_save_image (progress, gimp, image, uri,
+                                        save_proc,
+                                        GIMP_RUN_WITH_LAST_VALS,
+                                        TRUE, FALSE, FALSE, TRUE);
+
+  async = g_slice_new0 (FileSaveDialogAsync);
+
+  async->gimp     = gimp;
+  async->progress = progress ? g_object_ref (progress) : NULL;
+  async->uri      = g_strdup (uri);
+
+  file_save_dialog_block_quit (TRUE);
+
+  if (! file_save_async (gimp, image, progress, uri, save_proc,
+                         file_save_dialog_save_done, async,
+                         &error))
+    {
+      file_save_dialog_save_done (image, GIMP_PDB_EXECUTION_ERROR,
+                                  error, async);
+      g_clear_error (&error);
+
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+static void
+file_save_dialog_save_done (GimpImage         *image,
+                            GimpPDBStatusType  status,
+                            const GError      *error,
+                            gpointer           data)
+{
+  FileSaveDialogAsync *async = data;
+
+  if (status != GIMP_PDB_SUCCESS)
+    file_save_dialog_save_failed (async->gimp, async->progress,
+                                  async->uri, error);
+
+  file_save_dialog_block_quit (FALSE);
+
+  if (async->progress)
+    g_object_unref (async->progress);
+
+  g_free (async->uri);
+
+  g_slice_free (FileSaveDialogAsync, async);
+}
+
+static void
+file_save_dialog_save_failed (Gimp         *gimp,
+                              GimpProgress *progress,
+                              const gchar  *uri,
+                              const GError *error)
+{
+  gchar *filename = file_utils_uri_display_name (uri);
+
+  gimp_message (gimp, G_OBJECT (progress), GIMP_MESSAGE_ERROR,
+                _("Saving '%s' failed:\n\n%s"), filename, error->message);
+
+  g_free (filename);
+}
+
+/*  quitting is not possible while an image is being saved  */
+static void
+file_save_dialog_block_quit (gboolean block)
+{
+  static gint  n_blocks = 0;
+  GList       *list;
+
+  n_blocks += block ? 1 : -1;
+
   for (list = gimp_action_groups_from_name ("file");
        list;
        list = g_list_next (list))
     {
-      gimp_action_group_set_action_sensitive (list->data, "file-quit", TRUE);
+      gimp_action_group_set_action_sensitive (list->data, "file-quit",
+                                              n_blocks == 0);
     }
-
-  return success;
 }
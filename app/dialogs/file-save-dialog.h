@@ -19,20 +19,24 @@
 #define __FILE_SAVE_DIALOG_H__
 
 
-GtkWidget * file_save_dialog_new        (Gimp                *gimp,
-                                         gboolean             export);
-
-gboolean    file_save_dialog_save_image (GimpProgress        *progress_and_handler,
-                                         Gimp                *gimp,
-                                         GimpImage           *image,
-                                         const gchar         *uri,
-                                         GimpPlugInProcedure *write_proc,
-                                         GimpRunMode          run_mode,
-                                         gboolean             save_a_copy,
-                                         gboolean             export_backward,
-                                         gboolean             export_forward,
-                                         gboolean             verbose_cancel);
+GtkWidget * file_save_dialog_new              (Gimp                *gimp,
+                                               gboolean             export);
 
+gboolean    file_save_dialog_save_image       (GimpProgress        *progress_and_handler,
+                                               Gimp                *gimp,
+                                               GimpImage           *image,
+                                               const gchar         *uri,
+                                               GimpPlugInProcedure *write_proc,
+                                               GimpRunMode          run_mode,
+                                               gboolean             save_a_copy,
+                                               gboolean             export_backward,
+                                               gboolean             export_forward,
+                                               gboolean             verbose_cancel);
+gboolean    file_save_dialog_save_image_async (GimpProgress        *progress,
+                                               Gimp                *gimp,
+                                               GimpImage           *image,
+                                               const gchar         *uri,
+                                               GimpPlugInProcedure *save_proc);
 
 
 #endif /* __FILE_SAVE_DIALOG_H__ */
@@ -1324,17 +1324,39 @@ prefs_dialog_new (Gimp       *gimp,
   prefs_memsize_entry_add (object, "undo-size",
                            _("Maximum undo _memory:"),
                            GTK_TABLE (table), 1, size_group);
-  prefs_memsize_entry_add (object, "tile-cache-size",
-                           _("Tile cache _size:"),
-                           GTK_TABLE (table), 2, size_group);
+  entry = prefs_memsize_entry_add (object, "tile-cache-size",
+                                   _("Tile cache _size:"),
+                                   GTK_TABLE (table), 2, size_group);
+  g_object_bind_property (object, "tile-cache-size-auto",
+                          entry,  "sensitive",
+                          G_BINDING_SYNC_CREATE |
+                          G_BINDING_INVERT_BOOLEAN);
+
   prefs_memsize_entry_add (object, "max-new-image-size",
                            _("Maximum _new image size:"),
                            GTK_TABLE (table), 3, size_group);
 
 #ifdef ENABLE_MP
-  prefs_spin_button_add (object, "num-processors", 1.0, 4.0, 0,
-                         _("Number of _processors to use:"),
-                         GTK_TABLE (table), 4, size_group);
+  button = prefs_spin_button_add (object, "num-processors", 1.0, 4.0, 0,
+                                  _("Number of _processors to use:"),
+                                  GTK_TABLE (table), 4, size_group);
+  g_object_bind_property (object, "num-processors-auto",
+                          button, "sensitive",
+                          G_BINDING_SYNC_CREATE |
+                          G_BINDING_INVERT_BOOLEAN);
+#endif /* ENABLE_MP */
+
+  prefs_check_button_add (object, "tile-cache-size-auto",
+                          _("Size the tile cache _automatically"),
+                          GTK_BOX (vbox2));
+  prefs_check_button_add (object, "swap-compression",
+                          _("Compress the s_wap"),
+                          GTK_BOX (vbox2));
+
+#ifdef ENABLE_MP
+  prefs_check_button_add (object, "num-processors-auto",
+                          _("Use all _online processors"),
+                          GTK_BOX (vbox2));
 #endif /* ENABLE_MP */
 
   /*  Hardware Acceleration  */
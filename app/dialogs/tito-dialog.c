@@ -435,6 +435,8 @@ tito_search_history_and_actions (const gchar *keyword)
   if(strcmp(keyword,"")==0)
     return;
 
+  gimp_ui_manager_ensure_action_groups (manager);
+
   for(i=0;i<cur_no_of_his_actions;i++)
   {
     if(history[i].history_action!=NULL)
@@ -509,6 +511,8 @@ static void tito_fill_history (void)
   int               i = 0;
   manager= gimp_ui_managers_from_name ("<Image>")->data;
 
+  gimp_ui_manager_ensure_action_groups (manager);
+
   for (list = gtk_ui_manager_get_action_groups (GTK_UI_MANAGER (manager));
        list;
        list = g_list_next (list))
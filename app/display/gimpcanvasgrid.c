@@ -35,6 +35,7 @@
 #include "gimpcanvas-style.h"
 #include "gimpcanvasgrid.h"
 #include "gimpdisplayshell.h"
+#include "gimpdisplayshell-transform.h"
 
 
 enum
@@ -191,6 +192,7 @@ gimp_canvas_grid_draw (GimpCanvasItem *item,
   GimpImage             *image   = gimp_canvas_item_get_image (item);
   gdouble                x, y;
   gdouble                dx1, dy1, dx2, dy2;
+  gdouble                ix1, iy1, ix2, iy2;
   gint                   x0, x1, x2, x3;
   gint                   y0, y1, y2, y3;
   gint                   x_real, y_real;
@@ -219,13 +221,36 @@ gimp_canvas_grid_draw (GimpCanvasItem *item,
   width  = gimp_image_get_width  (image);
   height = gimp_image_get_height (image);
 
+  /*  only generate the lines that cross the area being drawn, with
+   *  one line of margin for the crosshairs
+   */
+  gimp_display_shell_untransform_bounds (shell,
+                                         dx1, dy1, dx2, dy2,
+                                         &ix1, &iy1, &ix2, &iy2);
+
+  ix1 = MAX (ix1, 0) - private->grid->xspacing;
+  iy1 = MAX (iy1, 0) - private->grid->yspacing;
+  ix2 = MIN (ix2, width)  + private->grid->xspacing;
+  iy2 = MIN (iy2, height) + private->grid->yspacing;
+
   x_offset = private->grid->xoffset;
-  while (x_offset > 0)
-    x_offset -= private->grid->xspacing;
+  x_offset -= ceil (x_offset / private->grid->xspacing) *
+              private->grid->xspacing;
+
+  if (ix1 > x_offset)
+    x_offset += floor ((ix1 - x_offset) / private->grid->xspacing) *
+                private->grid->xspacing;
 
   y_offset = private->grid->yoffset;
-  while (y_offset > 0)
-    y_offset -= private->grid->yspacing;
+  y_offset -= ceil (y_offset / private->grid->yspacing) *
+              private->grid->yspacing;
+
+  if (iy1 > y_offset)
+    y_offset += floor ((iy1 - y_offset) / private->grid->yspacing) *
+                private->grid->yspacing;
+
+  width  = MIN (width,  ceil (ix2));
+  height = MIN (height, ceil (iy2));
 
   switch (private->grid->style)
     {
@@ -246,6 +246,8 @@ gimp_canvas_group_child_update (GimpCanvasItem  *item,
                                 cairo_region_t  *region,
                                 GimpCanvasGroup *group)
 {
+  _gimp_canvas_item_invalidate_extents (GIMP_CANVAS_ITEM (group));
+
   if (_gimp_canvas_item_needs_update (GIMP_CANVAS_ITEM (group)))
     _gimp_canvas_item_update (GIMP_CANVAS_ITEM (group), region);
 }
@@ -283,6 +285,8 @@ gimp_canvas_group_add_item (GimpCanvasGroup *group,
 
   private->items = g_list_append (private->items, g_object_ref (item));
 
+  _gimp_canvas_item_invalidate_extents (GIMP_CANVAS_ITEM (group));
+
   if (_gimp_canvas_item_needs_update (GIMP_CANVAS_ITEM (group)))
     {
       cairo_region_t *region = gimp_canvas_item_get_extents (item);
@@ -314,6 +318,8 @@ gimp_canvas_group_remove_item (GimpCanvasGroup *group,
 
   private->items = g_list_remove (private->items, item);
 
+  _gimp_canvas_item_invalidate_extents (GIMP_CANVAS_ITEM (group));
+
   if (private->group_stroking)
     gimp_canvas_item_resume_stroking (item);
 
@@ -20,6 +20,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <gegl.h>
 #include <gtk/gtk.h>
 
@@ -27,6 +29,7 @@
 
 #include "display-types.h"
 
+#include "core/gimpimage.h"
 #include "core/gimpmarshal.h"
 
 #include "gimpcanvas-style.h"
@@ -52,8 +55,23 @@ enum
 };
 
 
+typedef struct _GimpCanvasView        GimpCanvasView;
 typedef struct _GimpCanvasItemPrivate GimpCanvasItemPrivate;
 
+/*  what an item's extents depend on besides its own properties  */
+struct _GimpCanvasView
+{
+  gint    offset_x;
+  gint    offset_y;
+  gdouble scale_x;
+  gdouble scale_y;
+  gdouble rotate_angle;
+  gint    disp_width;
+  gint    disp_height;
+  gint    image_width;
+  gint    image_height;
+};
+
 struct _GimpCanvasItemPrivate
 {
   GimpDisplayShell *shell;
@@ -64,6 +82,9 @@ struct _GimpCanvasItemPrivate
   gint              suspend_filling;
   gint              change_count;
   cairo_region_t   *change_region;
+
+  cairo_region_t   *extents;
+  GimpCanvasView    extents_view;
 };
 
 #define GET_PRIVATE(item) \
@@ -75,6 +96,7 @@ struct _GimpCanvasItemPrivate
 /*  local function prototypes  */
 
 static void             gimp_canvas_item_constructed      (GObject         *object);
+static void             gimp_canvas_item_finalize         (GObject         *object);
 static void             gimp_canvas_item_set_property     (GObject         *object,
                                                            guint            property_id,
                                                            const GValue    *value,
@@ -98,6 +120,10 @@ static gboolean         gimp_canvas_item_real_hit         (GimpCanvasItem  *item
                                                            gdouble          x,
                                                            gdouble          y);
 
+static void             gimp_canvas_item_get_view         (GimpCanvasItem  *item,
+                                                           GimpCanvasView  *view);
+static cairo_region_t * gimp_canvas_item_peek_extents     (GimpCanvasItem  *item);
+
 
 G_DEFINE_TYPE (GimpCanvasItem, gimp_canvas_item,
                GIMP_TYPE_OBJECT)
@@ -113,6 +139,7 @@ gimp_canvas_item_class_init (GimpCanvasItemClass *klass)
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
   object_class->constructed                 = gimp_canvas_item_constructed;
+  object_class->finalize                    = gimp_canvas_item_finalize;
   object_class->set_property                = gimp_canvas_item_set_property;
   object_class->get_property                = gimp_canvas_item_get_property;
   object_class->dispatch_properties_changed = gimp_canvas_item_dispatch_properties_changed;
@@ -177,6 +204,7 @@ gimp_canvas_item_init (GimpCanvasItem *item)
   private->suspend_filling  = 0;
   private->change_count     = 1; /* avoid emissions during construction */
   private->change_region    = NULL;
+  private->extents          = NULL;
 }
 
 static void
@@ -191,6 +219,20 @@ gimp_canvas_item_constructed (GObject *object)
   G_OBJECT_CLASS (parent_class)->constructed (object);
 }
 
+static void
+gimp_canvas_item_finalize (GObject *object)
+{
+  GimpCanvasItemPrivate *private = GET_PRIVATE (object);
+
+  if (private->extents)
+    {
+      cairo_region_destroy (private->extents);
+      private->extents = NULL;
+    }
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gimp_canvas_item_set_property (GObject      *object,
                                guint         property_id,
@@ -256,6 +298,8 @@ gimp_canvas_item_dispatch_properties_changed (GObject     *object,
 {
   GimpCanvasItem *item = GIMP_CANVAS_ITEM (object);
 
+  _gimp_canvas_item_invalidate_extents (item);
+
   G_OBJECT_CLASS (parent_class)->dispatch_properties_changed (object,
                                                               n_pspecs,
                                                               pspecs);
@@ -325,6 +369,62 @@ gimp_canvas_item_real_hit (GimpCanvasItem *item,
   return FALSE;
 }
 
+static void
+gimp_canvas_item_get_view (GimpCanvasItem *item,
+                           GimpCanvasView *view)
+{
+  GimpCanvasItemPrivate *private = GET_PRIVATE (item);
+  GimpDisplayShell      *shell   = private->shell;
+  GimpImage             *image   = NULL;
+
+  /*  clear the padding too, views are compared with memcmp()  */
+  memset (view, 0, sizeof (GimpCanvasView));
+
+  if (shell->display)
+    image = gimp_display_get_image (shell->display);
+
+  view->offset_x     = shell->offset_x;
+  view->offset_y     = shell->offset_y;
+  view->scale_x      = shell->scale_x;
+  view->scale_y      = shell->scale_y;
+  view->rotate_angle = shell->rotate_angle;
+  view->disp_width   = shell->disp_width;
+  view->disp_height  = shell->disp_height;
+
+  if (image)
+    {
+      view->image_width  = gimp_image_get_width  (image);
+      view->image_height = gimp_image_get_height (image);
+    }
+}
+
+/*  returns the item's extents, computing them if the view changed
+ *  since they were cached.  The extents are owned by the item
+ */
+static cairo_region_t *
+gimp_canvas_item_peek_extents (GimpCanvasItem *item)
+{
+  GimpCanvasItemPrivate *private = GET_PRIVATE (item);
+  GimpCanvasView         view;
+
+  gimp_canvas_item_get_view (item, &view);
+
+  if (private->extents &&
+      memcmp (&view, &private->extents_view, sizeof (GimpCanvasView)))
+    {
+      _gimp_canvas_item_invalidate_extents (item);
+    }
+
+  if (! private->extents)
+    {
+      private->extents = GIMP_CANVAS_ITEM_GET_CLASS (item)->get_extents (item);
+
+      memcpy (&private->extents_view, &view, sizeof (GimpCanvasView));
+    }
+
+  return private->extents;
+}
+
 
 /*  public functions  */
 
@@ -377,6 +477,29 @@ gimp_canvas_item_draw (GimpCanvasItem *item,
 
   if (private->visible)
     {
+      cairo_region_t *extents = gimp_canvas_item_peek_extents (item);
+
+      /*  skip items outside of the area being drawn, items without
+       *  extents are always drawn
+       */
+      if (extents)
+        {
+          cairo_rectangle_int_t clip;
+          gdouble               x1, y1;
+          gdouble               x2, y2;
+
+          cairo_clip_extents (cr, &x1, &y1, &x2, &y2);
+
+          clip.x      = floor (x1);
+          clip.y      = floor (y1);
+          clip.width  = ceil (x2) - clip.x;
+          clip.height = ceil (y2) - clip.y;
+
+          if (cairo_region_contains_rectangle (extents, &clip) ==
+              CAIRO_REGION_OVERLAP_OUT)
+            return;
+        }
+
       cairo_save (cr);
       GIMP_CANVAS_ITEM_GET_CLASS (item)->draw (item, cr);
       cairo_restore (cr);
@@ -393,7 +516,12 @@ gimp_canvas_item_get_extents (GimpCanvasItem *item)
   private = GET_PRIVATE (item);
 
   if (private->visible)
-    return GIMP_CANVAS_ITEM_GET_CLASS (item)->get_extents (item);
+    {
+      cairo_region_t *extents = gimp_canvas_item_peek_extents (item);
+
+      if (extents)
+        return cairo_region_copy (extents);
+    }
 
   return NULL;
 }
@@ -664,6 +792,21 @@ _gimp_canvas_item_update (GimpCanvasItem *item,
                  region);
 }
 
+/*  drops the cached extents, for changes of an item's geometry that
+ *  don't go through its properties
+ */
+void
+_gimp_canvas_item_invalidate_extents (GimpCanvasItem *item)
+{
+  GimpCanvasItemPrivate *private = GET_PRIVATE (item);
+
+  if (private->extents)
+    {
+      cairo_region_destroy (private->extents);
+      private->extents = NULL;
+    }
+}
+
 gboolean
 _gimp_canvas_item_needs_update (GimpCanvasItem *item)
 {
@@ -710,3 +853,4 @@ _gimp_canvas_item_fill (GimpCanvasItem   *item,
       cairo_new_sub_path (cr);
     }
 }
+
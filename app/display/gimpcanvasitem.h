@@ -116,6 +116,8 @@ void             gimp_canvas_item_transform_xy_f   (GimpCanvasItem   *item,
 
 void             _gimp_canvas_item_update          (GimpCanvasItem   *item,
                                                     cairo_region_t   *region);
+void             _gimp_canvas_item_invalidate_extents
+                                                   (GimpCanvasItem   *item);
 gboolean         _gimp_canvas_item_needs_update    (GimpCanvasItem   *item);
 void             _gimp_canvas_item_stroke          (GimpCanvasItem   *item,
                                                     cairo_t          *cr);
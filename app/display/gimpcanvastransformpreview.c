@@ -30,6 +30,8 @@
 
 #include "display/display-types.h"
 
+#include "gegl/gimp-gegl-loops.h"
+
 #include "core/gimpchannel.h"
 #include "core/gimpimage.h"
 #include "core/gimp-transform-utils.h"
@@ -47,6 +49,10 @@
 #define MAX_SUB_COLS       6 /* number of columns and  */
 #define MAX_SUB_ROWS       6 /* rows to use in perspective preview subdivision */
 
+#define MAX_TEXTURE_LEVELS 8 /* number of mipmap levels of the texture       */
+
+#define TEXTURE_KEY        "gimp-canvas-transform-preview-texture"
+
 
 enum
 {
@@ -74,6 +80,15 @@ struct _GimpCanvasTransformPreviewPrivate
   gdouble            opacity;
 };
 
+/*  the texture's mipmap levels, attached to the drawable so they
+ *  survive the preview items, which are recreated on every redraw
+ */
+typedef struct
+{
+  GeglBuffer *buffer;                      /*  the drawable's buffer, level 0  */
+  GeglBuffer *levels[MAX_TEXTURE_LEVELS];  /*  from 1 on, each half the last   */
+} GimpTransformPreviewTexture;
+
 #define GET_PRIVATE(transform_preview) \
         G_TYPE_INSTANCE_GET_PRIVATE (transform_preview, \
                                      GIMP_TYPE_CANVAS_TRANSFORM_PREVIEW, \
@@ -95,6 +110,14 @@ static void             gimp_canvas_transform_preview_draw         (GimpCanvasIt
                                                                     cairo_t        *cr);
 static cairo_region_t * gimp_canvas_transform_preview_get_extents  (GimpCanvasItem *item);
 
+static gint         gimp_canvas_transform_preview_get_level    (const gint                  *x,
+                                                                const gint                  *y,
+                                                                const gfloat                *u,
+                                                                const gfloat                *v);
+static GeglBuffer * gimp_canvas_transform_preview_get_texture  (GimpDrawable                *drawable,
+                                                                gint                        *level);
+static void         gimp_canvas_transform_preview_texture_free (GimpTransformPreviewTexture *texture);
+
 static void   gimp_canvas_transform_preview_draw_quad         (GimpDrawable    *texture,
                                                                cairo_t         *cr,
                                                                GimpChannel     *mask,
@@ -105,7 +128,8 @@ static void   gimp_canvas_transform_preview_draw_quad         (GimpDrawable    *
                                                                gfloat          *u,
                                                                gfloat          *v,
                                                                guchar           opacity);
-static void   gimp_canvas_transform_preview_draw_tri          (GimpDrawable    *texture,
+static void   gimp_canvas_transform_preview_draw_tri          (GeglBuffer      *texture,
+                                                               gint             level,
                                                                cairo_t         *cr,
                                                                cairo_surface_t *area,
                                                                gint             area_offx,
@@ -118,7 +142,8 @@ static void   gimp_canvas_transform_preview_draw_tri          (GimpDrawable    *
                                                                gfloat          *u,
                                                                gfloat          *v,
                                                                guchar           opacity);
-static void   gimp_canvas_transform_preview_draw_tri_row      (GimpDrawable    *texture,
+static void   gimp_canvas_transform_preview_draw_tri_row      (GeglBuffer      *texture,
+                                                               gint             level,
                                                                cairo_t         *cr,
                                                                cairo_surface_t *area,
                                                                gint             area_offx,
@@ -131,7 +156,8 @@ static void   gimp_canvas_transform_preview_draw_tri_row      (GimpDrawable    *
                                                                gfloat           v2,
                                                                gint             y,
                                                                guchar           opacity);
-static void   gimp_canvas_transform_preview_draw_tri_row_mask (GimpDrawable    *texture,
+static void   gimp_canvas_transform_preview_draw_tri_row_mask (GeglBuffer      *texture,
+                                                               gint             level,
                                                                cairo_t         *cr,
                                                                cairo_surface_t *area,
                                                                gint             area_offx,
@@ -596,9 +622,126 @@ gimp_canvas_transform_preview_new (GimpDisplayShell  *shell,
                        NULL);
 }
 
+/**
+ * gimp_canvas_transform_preview_free_texture:
+ * @drawable: a #GimpDrawable
+ *
+ * Frees the mipmap levels the previews of @drawable keep attached to
+ * it between redraws.  Call it when the transform is done.
+ **/
+void
+gimp_canvas_transform_preview_free_texture (GimpDrawable *drawable)
+{
+  g_return_if_fail (GIMP_IS_DRAWABLE (drawable));
+
+  g_object_set_data (G_OBJECT (drawable), TEXTURE_KEY, NULL);
+}
+
 
 /*  private functions  */
 
+/*  Returns the mipmap level to sample the texture from, so that one
+ *  texture pixel of the level covers at least one screen pixel.  The
+ *  vertices are top-left, top-right, bottom-left and bottom-right.
+ */
+static gint
+gimp_canvas_transform_preview_get_level (const gint   *x,
+                                         const gint   *y,
+                                         const gfloat *u,
+                                         const gfloat *v)
+{
+  gdouble screen_area;
+  gdouble texture_area;
+  gdouble scale;
+  gint    level = 0;
+
+  /*  half the cross product of the diagonals  */
+  screen_area = fabs ((gdouble) (x[3] - x[0]) * (gdouble) (y[2] - y[1]) -
+                      (gdouble) (x[2] - x[1]) * (gdouble) (y[3] - y[0])) / 2.0;
+
+  texture_area = fabs ((u[1] - u[0]) * (v[2] - v[0]));
+
+  if (texture_area <= 0.0)
+    return 0;
+
+  scale = sqrt (screen_area / texture_area);
+
+  while (scale <= 0.5 && level < MAX_TEXTURE_LEVELS - 1)
+    {
+      scale *= 2.0;
+      level++;
+    }
+
+  return level;
+}
+
+/*  Returns the buffer of mipmap @level of @drawable, building the
+ *  missing levels by halving the previous one with box filters.
+ *  @level is lowered when the levels would get smaller than a pixel.
+ */
+static GeglBuffer *
+gimp_canvas_transform_preview_get_texture (GimpDrawable *drawable,
+                                           gint         *level)
+{
+  GimpTransformPreviewTexture *texture;
+  GeglBuffer                  *buffer = gimp_drawable_get_buffer (drawable);
+  gint                         i;
+
+  texture = g_object_get_data (G_OBJECT (drawable), TEXTURE_KEY);
+
+  if (! texture || texture->buffer != buffer)
+    {
+      texture = g_slice_new0 (GimpTransformPreviewTexture);
+
+      texture->buffer = g_object_ref (buffer);
+
+      g_object_set_data_full (G_OBJECT (drawable), TEXTURE_KEY, texture,
+                              (GDestroyNotify)
+                              gimp_canvas_transform_preview_texture_free);
+    }
+
+  for (i = 1; i <= *level; i++)
+    {
+      if (! texture->levels[i])
+        {
+          GeglBuffer *src    = i > 1 ? texture->levels[i - 1] : texture->buffer;
+          gint        width  = gegl_buffer_get_width  (src);
+          gint        height = gegl_buffer_get_height (src);
+
+          if (width < 2 || height < 2)
+            break;
+
+          texture->levels[i] =
+            gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                             (width  + 1) / 2,
+                                             (height + 1) / 2),
+                             babl_format ("R'aG'aB'aA u8"));
+
+          gimp_gegl_downscale_2x_buffer (src, texture->levels[i]);
+        }
+    }
+
+  *level = i - 1;
+
+  return *level > 0 ? texture->levels[*level] : texture->buffer;
+}
+
+static void
+gimp_canvas_transform_preview_texture_free (GimpTransformPreviewTexture *texture)
+{
+  gint i;
+
+  for (i = 1; i < MAX_TEXTURE_LEVELS; i++)
+    {
+      if (texture->levels[i])
+        g_object_unref (texture->levels[i]);
+    }
+
+  g_object_unref (texture->buffer);
+
+  g_slice_free (GimpTransformPreviewTexture, texture);
+}
+
 /**
  * gimp_canvas_transform_preview_draw_quad:
  * @texture:   the #GimpDrawable to be previewed
@@ -657,6 +800,12 @@ gimp_canvas_transform_preview_draw_quad (GimpDrawable *texture,
   if (minx <= maxx && miny <= maxy)
     {
       cairo_surface_t *area;
+      GeglBuffer      *buffer;
+      gint             level;
+
+      /*  sample the mipmap level that matches the quad's zoom  */
+      level  = gimp_canvas_transform_preview_get_level (x, y, u, v);
+      buffer = gimp_canvas_transform_preview_get_texture (texture, &level);
 
       area = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
                                          maxx - minx + 1,
@@ -664,10 +813,12 @@ gimp_canvas_transform_preview_draw_quad (GimpDrawable *texture,
 
       g_return_if_fail (area != NULL);
 
-      gimp_canvas_transform_preview_draw_tri (texture, cr, area, minx, miny,
+      gimp_canvas_transform_preview_draw_tri (buffer, level,
+                                              cr, area, minx, miny,
                                               mask, mask_offx, mask_offy,
                                               x, y, u, v, opacity);
-      gimp_canvas_transform_preview_draw_tri (texture, cr, area, minx, miny,
+      gimp_canvas_transform_preview_draw_tri (buffer, level,
+                                              cr, area, minx, miny,
                                               mask, mask_offx, mask_offy,
                                               x2, y2, u2, v2, opacity);
 
@@ -691,7 +842,8 @@ gimp_canvas_transform_preview_draw_quad (GimpDrawable *texture,
  * actual pixel changing.
  **/
 static void
-gimp_canvas_transform_preview_draw_tri (GimpDrawable    *texture,
+gimp_canvas_transform_preview_draw_tri (GeglBuffer      *texture,
+                                        gint             level,
                                         cairo_t         *cr,
                                         cairo_surface_t *area,
                                         gint             area_offx,
@@ -713,7 +865,7 @@ gimp_canvas_transform_preview_draw_tri (GimpDrawable    *texture,
   gfloat       dul, dvl, dur, dvr; /* left and right texture coord deltas  */
   gfloat       u_l, v_l, u_r, v_r; /* left and right texture coord pairs  */
 
-  g_return_if_fail (GIMP_IS_DRAWABLE (texture));
+  g_return_if_fail (GEGL_IS_BUFFER (texture));
   g_return_if_fail (area != NULL);
 
   g_return_if_fail (x != NULL && y != NULL && u != NULL && v != NULL);
@@ -765,7 +917,7 @@ gimp_canvas_transform_preview_draw_tri (GimpDrawable    *texture,
         for (ry = y[0]; ry < y[1]; ry++)
           {
             if (ry >= clip_y1 && ry < clip_y2)
-              gimp_canvas_transform_preview_draw_tri_row_mask (texture, cr,
+              gimp_canvas_transform_preview_draw_tri_row_mask (texture, level, cr,
                                                                area, area_offx, area_offy,
                                                                mask, mask_offx, mask_offy,
                                                                *left, u_l, v_l,
@@ -780,7 +932,7 @@ gimp_canvas_transform_preview_draw_tri (GimpDrawable    *texture,
         for (ry = y[0]; ry < y[1]; ry++)
           {
             if (ry >= clip_y1 && ry < clip_y2)
-              gimp_canvas_transform_preview_draw_tri_row (texture, cr,
+              gimp_canvas_transform_preview_draw_tri_row (texture, level, cr,
                                                           area, area_offx, area_offy,
                                                           *left, u_l, v_l,
                                                           *right, u_r, v_r,
@@ -806,7 +958,7 @@ gimp_canvas_transform_preview_draw_tri (GimpDrawable    *texture,
         for (ry = y[1]; ry < y[2]; ry++)
           {
             if (ry >= clip_y1 && ry < clip_y2)
-              gimp_canvas_transform_preview_draw_tri_row_mask (texture, cr,
+              gimp_canvas_transform_preview_draw_tri_row_mask (texture, level, cr,
                                                                area, area_offx, area_offy,
                                                                mask, mask_offx, mask_offy,
                                                                *left,  u_l, v_l,
@@ -821,7 +973,7 @@ gimp_canvas_transform_preview_draw_tri (GimpDrawable    *texture,
         for (ry = y[1]; ry < y[2]; ry++)
           {
             if (ry >= clip_y1 && ry < clip_y2)
-              gimp_canvas_transform_preview_draw_tri_row (texture, cr,
+              gimp_canvas_transform_preview_draw_tri_row (texture, level, cr,
                                                           area, area_offx, area_offy,
                                                           *left,  u_l, v_l,
                                                           *right, u_r, v_r,
@@ -849,7 +1001,8 @@ gimp_canvas_transform_preview_draw_tri (GimpDrawable    *texture,
  * (u2,v2) in texture.
  **/
 static void
-gimp_canvas_transform_preview_draw_tri_row (GimpDrawable    *texture,
+gimp_canvas_transform_preview_draw_tri_row (GeglBuffer      *texture,
+                                            gint             level,
                                             cairo_t         *cr,
                                             cairo_surface_t *area,
                                             gint             area_offx,
@@ -863,7 +1016,6 @@ gimp_canvas_transform_preview_draw_tri_row (GimpDrawable    *texture,
                                             gint             y,
                                             guchar           opacity)
 {
-  GeglBuffer *buffer;
   const Babl *format;
   guchar     *buf;
   guchar     *b;
@@ -877,7 +1029,7 @@ gimp_canvas_transform_preview_draw_tri_row (GimpDrawable    *texture,
   if (x2 == x1)
     return;
 
-  g_return_if_fail (GIMP_IS_DRAWABLE (texture));
+  g_return_if_fail (GEGL_IS_BUFFER (texture));
   g_return_if_fail (area != NULL);
   g_return_if_fail (cairo_image_surface_get_format (area) == CAIRO_FORMAT_ARGB32);
 
@@ -927,9 +1079,7 @@ gimp_canvas_transform_preview_draw_tri_row (GimpDrawable    *texture,
           + (y - area_offy) * cairo_image_surface_get_stride (area)
           + (x1 - area_offx) * 4);
 
-  buffer = gimp_drawable_get_buffer (texture);
-
-  format = gegl_buffer_get_format (buffer);
+  format = gegl_buffer_get_format (texture);
   bpp    = babl_format_get_bytes_per_pixel (format);
   buf    = g_alloca (bpp * dx);
 
@@ -938,8 +1088,8 @@ gimp_canvas_transform_preview_draw_tri_row (GimpDrawable    *texture,
 
   while (samples--)
     {
-      gegl_buffer_sample (buffer, (gint) u, (gint) v, NULL, b,
-                          format,
+      gegl_buffer_sample (texture, (gint) u >> level, (gint) v >> level,
+                          NULL, b, format,
                           GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
 
       b += bpp;
@@ -994,7 +1144,8 @@ gimp_canvas_transform_preview_draw_tri_row (GimpDrawable    *texture,
  * single row of a triangle onto dest, when there is a mask.
  **/
 static void
-gimp_canvas_transform_preview_draw_tri_row_mask (GimpDrawable    *texture,
+gimp_canvas_transform_preview_draw_tri_row_mask (GeglBuffer      *texture,
+                                                 gint             level,
                                                  cairo_t         *cr,
                                                  cairo_surface_t *area,
                                                  gint             area_offx,
@@ -1011,7 +1162,6 @@ gimp_canvas_transform_preview_draw_tri_row_mask (GimpDrawable    *texture,
                                                  gint             y,
                                                  guchar           opacity)
 {
-  GeglBuffer *buffer;
   GeglBuffer *mask_buffer;
   const Babl *format;
   const Babl *mask_format;
@@ -1031,7 +1181,7 @@ gimp_canvas_transform_preview_draw_tri_row_mask (GimpDrawable    *texture,
   if (x2 == x1)
     return;
 
-  g_return_if_fail (GIMP_IS_DRAWABLE (texture));
+  g_return_if_fail (GEGL_IS_BUFFER (texture));
   g_return_if_fail (GIMP_IS_CHANNEL (mask));
   g_return_if_fail (area != NULL);
   g_return_if_fail (cairo_image_surface_get_format (area) == CAIRO_FORMAT_ARGB32);
@@ -1085,10 +1235,9 @@ gimp_canvas_transform_preview_draw_tri_row_mask (GimpDrawable    *texture,
           + (y - area_offy) * cairo_image_surface_get_stride (area)
           + (x1 - area_offx) * 4);
 
-  buffer      = gimp_drawable_get_buffer (texture);
   mask_buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (mask));
 
-  format      = gegl_buffer_get_format (buffer);
+  format      = gegl_buffer_get_format (texture);
   mask_format = gegl_buffer_get_format (mask_buffer);
   bpp         = babl_format_get_bytes_per_pixel (format);
   mask_bpp    = babl_format_get_bytes_per_pixel (mask_format);
@@ -1101,8 +1250,8 @@ gimp_canvas_transform_preview_draw_tri_row_mask (GimpDrawable    *texture,
 
   while (samples--)
     {
-      gegl_buffer_sample (buffer, (gint) u, (gint) v, NULL, b,
-                          format,
+      gegl_buffer_sample (texture, (gint) u >> level, (gint) v >> level,
+                          NULL, b, format,
                           GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
       gegl_buffer_sample (mask_buffer, (gint) mu, (gint) mv, NULL, mask_b,
                           mask_format,
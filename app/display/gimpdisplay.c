@@ -45,6 +45,7 @@
 #include "gimpdisplayshell-expose.h"
 #include "gimpdisplayshell-handlers.h"
 #include "gimpdisplayshell-icon.h"
+#include "gimpdisplayshell-render.h"
 #include "gimpdisplayshell-transform.h"
 #include "gimpimagewindow.h"
 
@@ -771,10 +772,18 @@ gimp_display_update_area (GimpDisplay *display,
                           gint         h)
 {
   GimpDisplayPrivate *private;
+  GimpDisplayShell   *shell;
 
   g_return_if_fail (GIMP_IS_DISPLAY (display));
 
   private = GIMP_DISPLAY_GET_PRIVATE (display);
+  shell   = gimp_display_get_shell (display);
+
+  /*  drop the stale display tiles right away, not only when the
+   *  area is painted, so no expose in between can show them
+   */
+  if (shell)
+    gimp_display_shell_render_invalidate_area (shell, x, y, w, h);
 
   if (now)
     {
@@ -38,6 +38,7 @@
 #include "gimpdisplayshell-appearance.h"
 #include "gimpdisplayshell-callbacks.h"
 #include "gimpdisplayshell-draw.h"
+#include "gimpdisplayshell-render.h"
 #include "gimpdisplayshell-scale.h"
 #include "gimpdisplayshell-scroll.h"
 #include "gimpdisplayshell-selection.h"
@@ -111,6 +112,9 @@ gimp_display_shell_canvas_realize (GtkWidget        *canvas,
   gtk_widget_set_size_request (GTK_WIDGET (shell), 0, 0);
 
   shell->xfer = gimp_display_xfer_realize (GTK_WIDGET(shell));
+
+  /*  cached tiles may belong to a different screen  */
+  gimp_display_shell_render_invalidate_full (shell);
 }
 
 void
@@ -508,22 +508,37 @@ gimp_display_shell_drop_uri_list (GtkWidget *widget,
 
   open_as_layers = (image != NULL);
 
-  for (list = uri_list; list; list = g_list_next (list))
+  if (! open_as_layers)
     {
-      const gchar       *uri   = list->data;
-      GimpPDBStatusType  status;
-      GError            *error = NULL;
-      gboolean           warn  = FALSE;
-
+      /*  open all images at once, the first one goes to the empty
+       *  display, all others get new displays
+       */
+      file_open_multiple_with_display (shell->display->gimp, context,
+                                       GIMP_OBJECT (shell->display),
+                                       uri_list, FALSE);
+
+      /* It seems as if GIMP is being torn down for quitting. Bail out. */
       if (! shell->display)
-        {
-          /* It seems as if GIMP is being torn down for quitting. Bail out. */
-          return;
-        }
+        return;
 
-      if (open_as_layers)
+      image = gimp_display_get_image (shell->display);
+    }
+  else
+    {
+      for (list = uri_list; list; list = g_list_next (list))
         {
-          GList *new_layers;
+          const gchar       *uri   = list->data;
+          GimpPDBStatusType  status;
+          GError            *error = NULL;
+          GList             *new_layers;
+
+          if (! shell->display)
+            {
+              /* It seems as if GIMP is being torn down for quitting.
+               * Bail out.
+               */
+              return;
+            }
 
           new_layers = file_open_layers (shell->display->gimp, context,
                                          GIMP_PROGRESS (shell->display),
@@ -546,50 +561,24 @@ gimp_display_shell_drop_uri_list (GtkWidget *widget,
 
               g_list_free (new_layers);
             }
-          else if (status != GIMP_PDB_CANCEL)
+          else if (status != GIMP_PDB_CANCEL && shell->display)
             {
-              warn = TRUE;
-            }
-        }
-      else if (gimp_display_get_image (shell->display))
-        {
-          /*  open any subsequent images in a new display  */
-          GimpImage *new_image;
-
-          new_image = file_open_with_display (shell->display->gimp, context,
-                                              NULL,
-                                              uri, FALSE,
-                                              &status, &error);
-
-          if (! new_image && status != GIMP_PDB_CANCEL)
-            warn = TRUE;
-        }
-      else
-        {
-          /*  open the first image in the empty display  */
-          image = file_open_with_display (shell->display->gimp, context,
-                                          GIMP_PROGRESS (shell->display),
-                                          uri, FALSE,
-                                          &status, &error);
-
-          if (! image && status != GIMP_PDB_CANCEL)
-            warn = TRUE;
-        }
-
-      /* Something above might have run a few rounds of the main loop. Check
-       * that shell->display is still there, otherwise ignore this as the app
-       * is being torn down for quitting. */
-      if (warn && shell->display)
-        {
-          gchar *filename = file_utils_uri_display_name (uri);
+              /* Something above might have run a few rounds of the main
+               * loop. Check that shell->display is still there,
+               * otherwise ignore this as the app is being torn down for
+               * quitting.
+               */
+              gchar *filename = file_utils_uri_display_name (uri);
+
+              gimp_message (shell->display->gimp, G_OBJECT (shell->display),
+                            GIMP_MESSAGE_ERROR,
+                            _("Opening '%s' failed:\n\n%s"),
+                            filename, error->message);
 
-          gimp_message (shell->display->gimp, G_OBJECT (shell->display),
-                        GIMP_MESSAGE_ERROR,
-                        _("Opening '%s' failed:\n\n%s"),
-                        filename, error->message);
+              g_free (filename);
+            }
 
           g_clear_error (&error);
-          g_free (filename);
         }
     }
 
@@ -30,6 +30,7 @@
 #include "gimpdisplayshell.h"
 #include "gimpdisplayshell-expose.h"
 #include "gimpdisplayshell-filter.h"
+#include "gimpdisplayshell-render.h"
 
 
 /*  local function prototypes  */
@@ -124,6 +125,9 @@ static void
 gimp_display_shell_filter_changed (GimpColorDisplayStack *stack,
                                    GimpDisplayShell      *shell)
 {
+  /*  the cached tiles were rendered with the old filters  */
+  gimp_display_shell_render_invalidate_full (shell);
+
   if (shell->filter_idle_id)
     g_source_remove (shell->filter_idle_id);
 
@@ -38,6 +38,7 @@
 #include "core/gimpimage-sample-points.h"
 #include "core/gimpitem.h"
 #include "core/gimpitemstack.h"
+#include "core/gimpprojection.h"
 #include "core/gimpsamplepoint.h"
 #include "core/gimptreehandler.h"
 
@@ -59,6 +60,7 @@
 #include "gimpdisplayshell-expose.h"
 #include "gimpdisplayshell-handlers.h"
 #include "gimpdisplayshell-icon.h"
+#include "gimpdisplayshell-render.h"
 #include "gimpdisplayshell-scale.h"
 #include "gimpdisplayshell-scroll.h"
 #include "gimpdisplayshell-selection.h"
@@ -348,6 +350,10 @@ gimp_display_shell_connect (GimpDisplayShell *shell)
                     "notify::zoom-quality",
                     G_CALLBACK (gimp_display_shell_quality_notify_handler),
                     shell);
+  g_signal_connect (shell->display->config,
+                    "notify::accelerated-canvas",
+                    G_CALLBACK (gimp_display_shell_quality_notify_handler),
+                    shell);
 
   gimp_display_shell_invalidate_preview_handler (image, shell);
   gimp_display_shell_quick_mask_changed_handler (image, shell);
@@ -370,6 +376,8 @@ gimp_display_shell_disconnect (GimpDisplayShell *shell)
 
   g_return_if_fail (GIMP_IS_IMAGE (image));
 
+  gimp_display_shell_render_invalidate_full (shell);
+
   vectors = gimp_image_get_vectors (image);
 
   gimp_display_shell_icon_update_stop (shell);
@@ -501,6 +509,12 @@ gimp_display_shell_disconnect (GimpDisplayShell *shell)
   g_signal_handlers_disconnect_by_func (image,
                                         gimp_display_shell_clean_dirty_handler,
                                         shell);
+
+  /*  don't keep rendering first what this shell showed, the image's
+   *  other displays set their viewport again when they are scrolled
+   */
+  gimp_projection_set_priority_rect (gimp_image_get_projection (image),
+                                     0, 0, 0, 0);
 }
 
 
@@ -1043,5 +1057,6 @@ gimp_display_shell_quality_notify_handler (GObject          *config,
                                            GParamSpec       *param_spec,
                                            GimpDisplayShell *shell)
 {
+  gimp_display_shell_render_invalidate_full (shell);
   gimp_display_shell_expose_full (shell);
 }
@@ -20,6 +20,7 @@
 #include <gegl.h>
 #include <gtk/gtk.h>
 
+#include "libgimpmath/gimpmath.h"
 #include "libgimpcolor/gimpcolor.h"
 #include "libgimpwidgets/gimpwidgets.h"
 
@@ -43,6 +44,43 @@
 #include "gimpdisplayshell-scroll.h"
 #include "gimpdisplayxfer.h"
 
+#include "gimp-trace.h"
+
+
+/*  the size of the cached display tiles, in device pixels  */
+#define RENDER_CACHE_TILE_SIZE  256
+
+/*  at most this many tiles are kept per display, 256 KB each  */
+#define RENDER_CACHE_MAX_TILES  128
+
+
+typedef struct _GimpDisplayRenderTile GimpDisplayRenderTile;
+
+struct _GimpDisplayRenderTile
+{
+  gint64           key;
+  cairo_surface_t *surface;
+  GList           *link;      /*  the tile's link in the LRU queue  */
+};
+
+
+static cairo_surface_t * gimp_display_shell_render_get_tile  (GimpDisplayShell      *shell,
+                                                              cairo_surface_t       *target,
+                                                              GeglBuffer            *buffer,
+                                                              gint                   tile_x,
+                                                              gint                   tile_y,
+                                                              gdouble                window_scale);
+static void              gimp_display_shell_render_tile_free (GimpDisplayRenderTile *tile);
+static void              gimp_display_shell_render_filter    (GimpDisplayShell      *shell,
+                                                              guchar                *data,
+                                                              gint                   stride,
+                                                              gint                   width,
+                                                              gint                   height);
+static inline gint       floor_div                           (gint                   a,
+                                                              gint                   b);
+
+
+/*  public functions  */
 
 void
 gimp_display_shell_render (GimpDisplayShell *shell,
@@ -60,11 +98,11 @@ gimp_display_shell_render (GimpDisplayShell *shell,
   gint             viewport_offset_y;
   gint             viewport_width;
   gint             viewport_height;
-  cairo_surface_t *xfer;
-  gint             src_x;
-  gint             src_y;
-  gint             mask_src_x = 0;
-  gint             mask_src_y = 0;
+  gint             x1, y1, x2, y2;
+  gint             tile_x;
+  gint             tile_y;
+  gint             mask_src_x   = 0;
+  gint             mask_src_y   = 0;
   gint             stride;
   guchar          *data;
 
@@ -72,6 +110,8 @@ gimp_display_shell_render (GimpDisplayShell *shell,
   g_return_if_fail (cr != NULL);
   g_return_if_fail (w > 0 && h > 0);
 
+  GIMP_TRACE_BEGIN ("display-render");
+
   image      = gimp_display_get_image (shell->display);
   projection = gimp_image_get_projection (image);
   buffer     = gimp_pickable_get_buffer (GIMP_PICKABLE (projection));
@@ -88,48 +128,20 @@ gimp_display_shell_render (GimpDisplayShell *shell,
                                                  &viewport_offset_y,
                                                  &viewport_width,
                                                  &viewport_height);
-  if (shell->rotate_transform)
+  if (! shell->render_cache)
     {
-      xfer = cairo_surface_create_similar_image (cairo_get_target (cr),
-                                                 CAIRO_FORMAT_ARGB32,
-                                                 w * window_scale,
-                                                 h * window_scale);
-      cairo_surface_mark_dirty (xfer);
-      src_x = 0;
-      src_y = 0;
-    }
-  else
-    {
-      xfer = gimp_display_xfer_get_surface (shell->xfer,
-                                            w * window_scale,
-                                            h * window_scale,
-                                            &src_x, &src_y);
+      shell->render_cache =
+        g_hash_table_new_full (g_int64_hash, g_int64_equal, NULL,
+                               (GDestroyNotify) gimp_display_shell_render_tile_free);
+      shell->render_cache_lru = g_queue_new ();
     }
 
-  stride = cairo_image_surface_get_stride (xfer);
-  data = cairo_image_surface_get_data (xfer);
-  data += src_y * stride + src_x * 4;
-
-  gegl_buffer_get (buffer,
-                   GEGL_RECTANGLE ((x + viewport_offset_x) * window_scale,
-                                   (y + viewport_offset_y) * window_scale,
-                                   w * window_scale,
-                                   h * window_scale),
-                   shell->scale_x * window_scale,
-                   babl_format ("cairo-ARGB32"),
-		   data, stride,
-                   GEGL_ABYSS_NONE);
-
-  /*  apply filters to the rendered projection  */
-  if (shell->filter_stack)
+  /*  the cached tiles are only valid for one scale  */
+  if (shell->render_scale != shell->scale_x * window_scale)
     {
-      cairo_surface_t *image =
-	cairo_image_surface_create_for_data (data, CAIRO_FORMAT_ARGB32,
-					     w * window_scale,
-					     h * window_scale,
-					     stride);
-      gimp_color_display_stack_convert_surface (shell->filter_stack, image);
-      cairo_surface_destroy (image);
+      gimp_display_shell_render_invalidate_full (shell);
+
+      shell->render_scale = shell->scale_x * window_scale;
     }
 
   if (shell->mask)
@@ -183,29 +195,84 @@ gimp_display_shell_render (GimpDisplayShell *shell,
   /*  put it to the screen  */
   cairo_save (cr);
 
-  cairo_rectangle (cr, x, y, w, h);
-
   cairo_scale (cr, 1.0 / window_scale, 1.0 / window_scale);
 
-  cairo_set_source_surface (cr, xfer,
-                            (x - src_x) * window_scale,
-                            (y - src_y) * window_scale);
+  x1 = (x + viewport_offset_x) * window_scale;
+  y1 = (y + viewport_offset_y) * window_scale;
+  x2 = (x + w + viewport_offset_x) * window_scale;
+  y2 = (y + h + viewport_offset_y) * window_scale;
 
-  if (shell->rotate_transform)
+  if (! shell->rotate_transform)
     {
-      cairo_pattern_t *pattern;
+      cairo_rectangle (cr,
+                       x * window_scale, y * window_scale,
+                       w * window_scale, h * window_scale);
+      cairo_clip (cr);
+    }
+
+  /*  blit the cached tiles, rendering only the missing ones  */
+  for (tile_y = floor_div (y1, RENDER_CACHE_TILE_SIZE);
+       tile_y <= floor_div (y2 - 1, RENDER_CACHE_TILE_SIZE);
+       tile_y++)
+    {
+      for (tile_x = floor_div (x1, RENDER_CACHE_TILE_SIZE);
+           tile_x <= floor_div (x2 - 1, RENDER_CACHE_TILE_SIZE);
+           tile_x++)
+        {
+          cairo_surface_t *tile;
+          gint             tile_offset_x;
+          gint             tile_offset_y;
+
+          tile = gimp_display_shell_render_get_tile (shell,
+                                                     cairo_get_target (cr),
+                                                     buffer,
+                                                     tile_x, tile_y,
+                                                     window_scale);
 
-      pattern = cairo_get_source (cr);
-      cairo_pattern_set_extend (pattern, CAIRO_EXTEND_PAD);
+          tile_offset_x = (tile_x * RENDER_CACHE_TILE_SIZE -
+                           viewport_offset_x * window_scale);
+          tile_offset_y = (tile_y * RENDER_CACHE_TILE_SIZE -
+                           viewport_offset_y * window_scale);
 
-      cairo_set_line_width (cr, 1.0);
-      cairo_stroke_preserve (cr);
+          cairo_set_source_surface (cr, tile, tile_offset_x, tile_offset_y);
 
-      cairo_surface_destroy (xfer);
+          if (shell->rotate_transform)
+            {
+              gint rx1 = MAX (x1, tile_x * RENDER_CACHE_TILE_SIZE);
+              gint ry1 = MAX (y1, tile_y * RENDER_CACHE_TILE_SIZE);
+              gint rx2 = MIN (x2, (tile_x + 1) * RENDER_CACHE_TILE_SIZE);
+              gint ry2 = MIN (y2, (tile_y + 1) * RENDER_CACHE_TILE_SIZE);
+
+              /*  the rotated pieces are antialiased, so overdraw their
+               *  edges with the padded tile to hide the seams
+               */
+              cairo_pattern_set_extend (cairo_get_source (cr),
+                                        CAIRO_EXTEND_PAD);
+
+              cairo_rectangle (cr,
+                               rx1 - viewport_offset_x * window_scale,
+                               ry1 - viewport_offset_y * window_scale,
+                               rx2 - rx1,
+                               ry2 - ry1);
+
+              cairo_set_line_width (cr, 1.0);
+              cairo_stroke_preserve (cr);
+              cairo_fill (cr);
+            }
+          else
+            {
+              cairo_paint (cr);
+            }
+        }
     }
 
-  cairo_clip (cr);
-  cairo_paint (cr);
+  if (shell->rotate_transform && shell->mask)
+    {
+      cairo_rectangle (cr,
+                       x * window_scale, y * window_scale,
+                       w * window_scale, h * window_scale);
+      cairo_clip (cr);
+    }
 
   if (shell->mask)
     {
@@ -216,4 +283,230 @@ gimp_display_shell_render (GimpDisplayShell *shell,
     }
 
   cairo_restore (cr);
+
+  GIMP_TRACE_END ();
+}
+
+/**
+ * gimp_display_shell_render_invalidate_full:
+ * @shell: a #GimpDisplayShell
+ *
+ * Drops all cached display tiles, for example because the display
+ * filters changed.
+ **/
+void
+gimp_display_shell_render_invalidate_full (GimpDisplayShell *shell)
+{
+  g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
+
+  if (! shell->render_cache)
+    return;
+
+  /*  the tiles don't own their queue links  */
+  g_queue_clear (shell->render_cache_lru);
+  g_hash_table_remove_all (shell->render_cache);
+}
+
+/**
+ * gimp_display_shell_render_invalidate_area:
+ * @shell: a #GimpDisplayShell
+ * @x:     the x coordinate of the changed area, in image coordinates
+ * @y:     the y coordinate of the changed area, in image coordinates
+ * @w:     the width of the changed area
+ * @h:     the height of the changed area
+ *
+ * Drops the cached display tiles that show any part of the given
+ * image area.
+ **/
+void
+gimp_display_shell_render_invalidate_area (GimpDisplayShell *shell,
+                                           gint              x,
+                                           gint              y,
+                                           gint              w,
+                                           gint              h)
+{
+  GHashTableIter  iter;
+  gpointer        value;
+  gdouble         scale;
+  gint            margin;
+  gint            x1, y1, x2, y2;
+
+  g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
+
+  if (! shell->render_cache || ! g_hash_table_size (shell->render_cache))
+    return;
+
+  scale = shell->render_scale;
+
+  /*  when zoomed out, each display pixel is computed from a whole
+   *  block of image pixels, so grow the area by one such block
+   */
+  margin = ceil (1.0 / scale) + 1;
+
+  x1 = floor ((x - margin)     * scale) - 1;
+  y1 = floor ((y - margin)     * scale) - 1;
+  x2 = ceil  ((x + w + margin) * scale) + 1;
+  y2 = ceil  ((y + h + margin) * scale) + 1;
+
+  g_hash_table_iter_init (&iter, shell->render_cache);
+
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    {
+      GimpDisplayRenderTile *tile   = value;
+      gint                   tile_x = (gint) (tile->key >> 32);
+      gint                   tile_y = (gint) (gint32) (tile->key & 0xffffffff);
+
+      if (tile_x * RENDER_CACHE_TILE_SIZE                          < x2 &&
+          tile_x * RENDER_CACHE_TILE_SIZE + RENDER_CACHE_TILE_SIZE > x1 &&
+          tile_y * RENDER_CACHE_TILE_SIZE                          < y2 &&
+          tile_y * RENDER_CACHE_TILE_SIZE + RENDER_CACHE_TILE_SIZE > y1)
+        {
+          g_queue_delete_link (shell->render_cache_lru, tile->link);
+          g_hash_table_iter_remove (&iter);
+        }
+    }
+}
+
+
+/*  private functions  */
+
+/*  With "accelerated-canvas", the tiles are surfaces of the windowing
+ *  system, so blitting them is done by the server and possibly the
+ *  graphics hardware.  The projection is then rendered into one of the
+ *  pooled transfer surfaces and uploaded to the tile once.
+ */
+static cairo_surface_t *
+gimp_display_shell_render_get_tile (GimpDisplayShell *shell,
+                                    cairo_surface_t  *target,
+                                    GeglBuffer       *buffer,
+                                    gint              tile_x,
+                                    gint              tile_y,
+                                    gdouble           window_scale)
+{
+  GimpDisplayConfig     *config = shell->display->config;
+  GimpDisplayRenderTile *tile;
+  gint64                 key    = ((gint64) tile_x << 32) | (guint32) tile_y;
+  cairo_surface_t       *xfer;
+  gint                   src_x  = 0;
+  gint                   src_y  = 0;
+  gint                   stride;
+  guchar                *data;
+
+  tile = g_hash_table_lookup (shell->render_cache, &key);
+
+  if (tile)
+    {
+      /*  move the tile to the front of the LRU queue  */
+      g_queue_unlink (shell->render_cache_lru, tile->link);
+      g_queue_push_head_link (shell->render_cache_lru, tile->link);
+
+      return tile->surface;
+    }
+
+  if (g_queue_get_length (shell->render_cache_lru) >= RENDER_CACHE_MAX_TILES)
+    {
+      /*  reuse the least recently used tile  */
+      GList *link = g_queue_pop_tail_link (shell->render_cache_lru);
+
+      tile = link->data;
+
+      g_hash_table_steal (shell->render_cache, &tile->key);
+    }
+  else
+    {
+      tile = g_slice_new0 (GimpDisplayRenderTile);
+
+      if (config->accelerated_canvas)
+        tile->surface = cairo_surface_create_similar (target,
+                                                      CAIRO_CONTENT_COLOR_ALPHA,
+                                                      RENDER_CACHE_TILE_SIZE,
+                                                      RENDER_CACHE_TILE_SIZE);
+      else
+        tile->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                                    RENDER_CACHE_TILE_SIZE,
+                                                    RENDER_CACHE_TILE_SIZE);
+      tile->link       = g_list_alloc ();
+      tile->link->data = tile;
+    }
+
+  tile->key = key;
+
+  g_hash_table_insert (shell->render_cache, &tile->key, tile);
+  g_queue_push_head_link (shell->render_cache_lru, tile->link);
+
+  if (config->accelerated_canvas)
+    xfer = gimp_display_xfer_get_surface (shell->xfer,
+                                          RENDER_CACHE_TILE_SIZE,
+                                          RENDER_CACHE_TILE_SIZE,
+                                          &src_x, &src_y);
+  else
+    xfer = tile->surface;
+
+  cairo_surface_flush (xfer);
+
+  stride = cairo_image_surface_get_stride (xfer);
+  data   = cairo_image_surface_get_data (xfer);
+  data  += src_y * stride + src_x * 4;
+
+  gegl_buffer_get (buffer,
+                   GEGL_RECTANGLE (tile_x * RENDER_CACHE_TILE_SIZE,
+                                   tile_y * RENDER_CACHE_TILE_SIZE,
+                                   RENDER_CACHE_TILE_SIZE,
+                                   RENDER_CACHE_TILE_SIZE),
+                   shell->scale_x * window_scale,
+                   babl_format ("cairo-ARGB32"),
+                   data, stride,
+                   GEGL_ABYSS_NONE);
+
+  gimp_display_shell_render_filter (shell, data, stride,
+                                    RENDER_CACHE_TILE_SIZE,
+                                    RENDER_CACHE_TILE_SIZE);
+
+  cairo_surface_mark_dirty (xfer);
+
+  if (xfer != tile->surface)
+    {
+      cairo_t *tile_cr = cairo_create (tile->surface);
+
+      cairo_set_operator (tile_cr, CAIRO_OPERATOR_SOURCE);
+      cairo_set_source_surface (tile_cr, xfer, -src_x, -src_y);
+      cairo_paint (tile_cr);
+      cairo_destroy (tile_cr);
+    }
+
+  return tile->surface;
+}
+
+static void
+gimp_display_shell_render_tile_free (GimpDisplayRenderTile *tile)
+{
+  cairo_surface_destroy (tile->surface);
+
+  g_slice_free (GimpDisplayRenderTile, tile);
+}
+
+/*  apply the display filters to rendered projection pixels  */
+static void
+gimp_display_shell_render_filter (GimpDisplayShell *shell,
+                                  guchar           *data,
+                                  gint              stride,
+                                  gint              width,
+                                  gint              height)
+{
+  if (shell->filter_stack)
+    {
+      cairo_surface_t *image =
+        cairo_image_surface_create_for_data (data, CAIRO_FORMAT_ARGB32,
+                                             width, height, stride);
+
+      gimp_color_display_stack_convert_surface (shell->filter_stack, image);
+      cairo_surface_destroy (image);
+    }
+}
+
+static inline gint
+floor_div (gint a,
+           gint b)
+{
+  return (a >= 0) ? a / b : -((-a + b - 1) / b);
 }
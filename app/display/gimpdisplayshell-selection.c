@@ -17,9 +17,13 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <gegl.h>
 #include <gtk/gtk.h>
 
+#include "libgimpmath/gimpmath.h"
+
 #include "display-types.h"
 
 #include "config/gimpdisplayconfig.h"
@@ -39,10 +43,46 @@
 #include "gimpdisplayshell-transform.h"
 
 
+/*  the size of the spatial index cells, in image pixels  */
+#define SEGS_CELL_SIZE 128
+
+
+typedef struct _SelectionSegs SelectionSegs;
+
+struct _SelectionSegs
+{
+  GimpBoundSeg     *segs;             /*  boundary in image coordinates     */
+  gint              n_segs;
+
+  gint              n_cols;           /*  a grid of cells, each listing     */
+  gint              n_rows;           /*  the segments that touch it        */
+  gint             *cell_start;       /*  start of each cell in cell_segs   */
+  gint             *cell_segs;        /*  segment indices, cell by cell     */
+  guint8           *marks;            /*  to return each segment only once  */
+
+  GimpSegment      *zoomed;           /*  the segments zoomed, not scrolled */
+  gdouble           zoom_x;
+  gdouble           zoom_y;
+};
+
 struct _Selection
 {
   GimpDisplayShell *shell;            /*  shell that owns the selection     */
 
+  SelectionSegs     bound_in;         /*  the mask's boundary, kept until   */
+  SelectionSegs     bound_out;        /*  the mask changes                  */
+  gboolean          bound_valid;
+
+  gdouble           view_scale_x;     /*  the view the segments below and   */
+  gdouble           view_scale_y;     /*  the segs_in_mask were made for    */
+  gint              view_offset_x;
+  gint              view_offset_y;
+  gint              view_width;
+  gint              view_height;
+  gboolean          view_rotated;
+  cairo_matrix_t    view_rotate;
+  gboolean          view_valid;
+
   GimpSegment      *segs_in;          /*  gdk segments of area boundary     */
   gint              n_segs_in;        /*  number of segments in segs_in     */
 
@@ -68,12 +108,25 @@ static void      selection_undraw         (Selection          *selection);
 
 static void      selection_render_mask    (Selection          *selection);
 
-static void      selection_zoom_segs      (Selection          *selection,
-                                           const GimpBoundSeg *src_segs,
-                                           GimpSegment        *dest_segs,
-                                           gint                n_segs);
+static void      selection_segs_init      (SelectionSegs      *segs,
+                                           const GimpBoundSeg *bound_segs,
+                                           gint                n_bound_segs,
+                                           gint                width,
+                                           gint                height);
+static void      selection_segs_free      (SelectionSegs      *segs);
+static GimpSegment * selection_segs_get_visible
+                                          (Selection          *selection,
+                                           SelectionSegs      *segs,
+                                           gdouble             x1,
+                                           gdouble             y1,
+                                           gdouble             x2,
+                                           gdouble             y2,
+                                           gint               *n_visible);
+
+static gboolean  selection_view_changed   (Selection          *selection);
 static void      selection_generate_segs  (Selection          *selection);
 static void      selection_free_segs      (Selection          *selection);
+static void      selection_free_boundary  (Selection          *selection);
 
 static gboolean  selection_start_timeout  (Selection          *selection);
 static gboolean  selection_timeout        (Selection          *selection);
@@ -132,6 +185,7 @@ gimp_display_shell_selection_free (GimpDisplayShell *shell)
                                         selection);
 
   selection_free_segs (selection);
+  selection_free_boundary (selection);
 
   g_slice_free (Selection, selection);
 
@@ -144,6 +198,9 @@ gimp_display_shell_selection_undraw (GimpDisplayShell *shell)
   g_return_if_fail (GIMP_IS_DISPLAY_SHELL (shell));
   g_return_if_fail (shell->selection != NULL);
 
+  /*  the mask changed, or the image went away  */
+  selection_free_boundary (shell->selection);
+
   if (gimp_display_get_image (shell->display))
     {
       selection_undraw (shell->selection);
@@ -312,88 +369,319 @@ selection_render_mask (Selection *selection)
 }
 
 static void
-selection_zoom_segs (Selection          *selection,
-                     const GimpBoundSeg *src_segs,
-                     GimpSegment        *dest_segs,
-                     gint                n_segs)
+selection_segs_init (SelectionSegs      *segs,
+                     const GimpBoundSeg *bound_segs,
+                     gint                n_bound_segs,
+                     gint                width,
+                     gint                height)
 {
-  const gint xclamp = selection->shell->disp_width + 1;
-  const gint yclamp = selection->shell->disp_height + 1;
-  gint       i;
+  gint n_cells;
+  gint pass;
+  gint i;
+
+  memset (segs, 0, sizeof (SelectionSegs));
+
+  if (n_bound_segs == 0)
+    return;
+
+  segs->segs   = g_memdup (bound_segs, n_bound_segs * sizeof (GimpBoundSeg));
+  segs->n_segs = n_bound_segs;
+  segs->marks  = g_new0 (guint8, n_bound_segs);
+
+  /*  segments can lie on the right and bottom edge  */
+  segs->n_cols = width  / SEGS_CELL_SIZE + 1;
+  segs->n_rows = height / SEGS_CELL_SIZE + 1;
 
-  gimp_display_shell_zoom_segments (selection->shell,
-                                    src_segs, dest_segs, n_segs,
-                                    0.0, 0.0);
+  n_cells = segs->n_cols * segs->n_rows;
 
-  for (i = 0; i < n_segs; i++)
+  segs->cell_start = g_new0 (gint, n_cells + 1);
+
+  /*  first count the segments in each cell, then fill in their indices  */
+  for (pass = 0; pass < 2; pass++)
     {
-      dest_segs[i].x1 = CLAMP (dest_segs[i].x1, -1, xclamp);
-      dest_segs[i].y1 = CLAMP (dest_segs[i].y1, -1, yclamp);
-
-      dest_segs[i].x2 = CLAMP (dest_segs[i].x2, -1, xclamp);
-      dest_segs[i].y2 = CLAMP (dest_segs[i].y2, -1, yclamp);
-
-      /*  If this segment is a closing segment && the segments lie inside
-       *  the region, OR if this is an opening segment and the segments
-       *  lie outside the region...
-       *  we need to transform it by one display pixel
-       */
-      if (! src_segs[i].open)
+      gint *fill = NULL;
+
+      if (pass == 1)
         {
-          /*  If it is vertical  */
-          if (dest_segs[i].x1 == dest_segs[i].x2)
-            {
-              dest_segs[i].x1 -= 1;
-              dest_segs[i].x2 -= 1;
-            }
-          else
-            {
-              dest_segs[i].y1 -= 1;
-              dest_segs[i].y2 -= 1;
-            }
+          for (i = 0; i < n_cells; i++)
+            segs->cell_start[i + 1] += segs->cell_start[i];
+
+          segs->cell_segs = g_new (gint, segs->cell_start[n_cells]);
+
+          fill = g_memdup (segs->cell_start, n_cells * sizeof (gint));
         }
+
+      for (i = 0; i < n_bound_segs; i++)
+        {
+          const GimpBoundSeg *seg = bound_segs + i;
+          gint                col1, row1;
+          gint                col2, row2;
+          gint                col, row;
+
+          col1 = CLAMP (MIN (seg->x1, seg->x2) / SEGS_CELL_SIZE,
+                        0, segs->n_cols - 1);
+          col2 = CLAMP (MAX (seg->x1, seg->x2) / SEGS_CELL_SIZE,
+                        0, segs->n_cols - 1);
+          row1 = CLAMP (MIN (seg->y1, seg->y2) / SEGS_CELL_SIZE,
+                        0, segs->n_rows - 1);
+          row2 = CLAMP (MAX (seg->y1, seg->y2) / SEGS_CELL_SIZE,
+                        0, segs->n_rows - 1);
+
+          for (row = row1; row <= row2; row++)
+            for (col = col1; col <= col2; col++)
+              {
+                gint cell = row * segs->n_cols + col;
+
+                if (pass == 0)
+                  segs->cell_start[cell + 1]++;
+                else
+                  segs->cell_segs[fill[cell]++] = i;
+              }
+        }
+
+      g_free (fill);
     }
 }
 
 static void
-selection_generate_segs (Selection *selection)
+selection_segs_free (SelectionSegs *segs)
 {
-  GimpImage          *image = gimp_display_get_image (selection->shell->display);
-  const GimpBoundSeg *segs_in;
-  const GimpBoundSeg *segs_out;
+  g_free (segs->segs);
+  g_free (segs->cell_start);
+  g_free (segs->cell_segs);
+  g_free (segs->marks);
+  g_free (segs->zoomed);
 
-  /*  Ask the image for the boundary of its selected region...
-   *  Then transform that information into a new buffer of GimpSegments
-   */
-  gimp_channel_boundary (gimp_image_get_mask (image),
-                         &segs_in, &segs_out,
-                         &selection->n_segs_in, &selection->n_segs_out,
-                         0, 0, 0, 0);
+  memset (segs, 0, sizeof (SelectionSegs));
+}
 
-  if (selection->n_segs_in)
+/*  Returns the display segments of all boundary segments that touch
+ *  the given image area.  The zoomed segments are kept until the zoom
+ *  changes, so scrolling only has to offset the visible ones.
+ */
+static GimpSegment *
+selection_segs_get_visible (Selection     *selection,
+                            SelectionSegs *segs,
+                            gdouble        x1,
+                            gdouble        y1,
+                            gdouble        x2,
+                            gdouble        y2,
+                            gint          *n_visible)
+{
+  GimpDisplayShell *shell  = selection->shell;
+  const gint        xclamp = shell->disp_width + 1;
+  const gint        yclamp = shell->disp_height + 1;
+  GimpSegment      *dest;
+  gint              n_dest = 0;
+  gint              col1, row1;
+  gint              col2, row2;
+  gint              col, row;
+
+  *n_visible = 0;
+
+  if (segs->n_segs == 0 || x2 < x1 || y2 < y1)
+    return NULL;
+
+  if (! segs->zoomed ||
+      segs->zoom_x != shell->scale_x ||
+      segs->zoom_y != shell->scale_y)
     {
-      selection->segs_in = g_new (GimpSegment, selection->n_segs_in);
-      selection_zoom_segs (selection, segs_in,
-                           selection->segs_in, selection->n_segs_in);
+      gint i;
 
-      selection_render_mask (selection);
+      if (! segs->zoomed)
+        segs->zoomed = g_new (GimpSegment, segs->n_segs);
+
+      for (i = 0; i < segs->n_segs; i++)
+        {
+          segs->zoomed[i].x1 = SCALEX (shell, segs->segs[i].x1);
+          segs->zoomed[i].y1 = SCALEY (shell, segs->segs[i].y1);
+          segs->zoomed[i].x2 = SCALEX (shell, segs->segs[i].x2);
+          segs->zoomed[i].y2 = SCALEY (shell, segs->segs[i].y2);
+        }
+
+      segs->zoom_x = shell->scale_x;
+      segs->zoom_y = shell->scale_y;
     }
-  else
+
+  col1 = CLAMP (floor (x1 / SEGS_CELL_SIZE), 0, segs->n_cols - 1);
+  col2 = CLAMP (floor (x2 / SEGS_CELL_SIZE), 0, segs->n_cols - 1);
+  row1 = CLAMP (floor (y1 / SEGS_CELL_SIZE), 0, segs->n_rows - 1);
+  row2 = CLAMP (floor (y2 / SEGS_CELL_SIZE), 0, segs->n_rows - 1);
+
+  /*  a segment can be in more than one cell, count it once  */
+  for (row = row1; row <= row2; row++)
+    for (col = col1; col <= col2; col++)
+      {
+        gint cell = row * segs->n_cols + col;
+        gint i;
+
+        for (i = segs->cell_start[cell]; i < segs->cell_start[cell + 1]; i++)
+          {
+            gint index = segs->cell_segs[i];
+
+            if (! segs->marks[index])
+              {
+                segs->marks[index] = TRUE;
+                n_dest++;
+              }
+          }
+      }
+
+  if (n_dest == 0)
+    return NULL;
+
+  dest = g_new (GimpSegment, n_dest);
+  n_dest = 0;
+
+  for (row = row1; row <= row2; row++)
+    for (col = col1; col <= col2; col++)
+      {
+        gint cell = row * segs->n_cols + col;
+        gint i;
+
+        for (i = segs->cell_start[cell]; i < segs->cell_start[cell + 1]; i++)
+          {
+            gint         index = segs->cell_segs[i];
+            GimpSegment *seg;
+
+            if (! segs->marks[index])
+              continue;
+
+            /*  clear the mark so the segment is added only once  */
+            segs->marks[index] = FALSE;
+
+            seg = dest + n_dest++;
+
+            seg->x1 = CLAMP (segs->zoomed[index].x1 - shell->offset_x,
+                             -1, xclamp);
+            seg->y1 = CLAMP (segs->zoomed[index].y1 - shell->offset_y,
+                             -1, yclamp);
+            seg->x2 = CLAMP (segs->zoomed[index].x2 - shell->offset_x,
+                             -1, xclamp);
+            seg->y2 = CLAMP (segs->zoomed[index].y2 - shell->offset_y,
+                             -1, yclamp);
+
+            /*  If this segment is a closing segment && the segments lie
+             *  inside the region, OR if this is an opening segment and
+             *  the segments lie outside the region...
+             *  we need to transform it by one display pixel
+             */
+            if (! segs->segs[index].open)
+              {
+                /*  If it is vertical  */
+                if (seg->x1 == seg->x2)
+                  {
+                    seg->x1 -= 1;
+                    seg->x2 -= 1;
+                  }
+                else
+                  {
+                    seg->y1 -= 1;
+                    seg->y2 -= 1;
+                  }
+              }
+          }
+      }
+
+  *n_visible = n_dest;
+
+  return dest;
+}
+
+static gboolean
+selection_view_changed (Selection *selection)
+{
+  GimpDisplayShell *shell = selection->shell;
+
+  if (! selection->view_valid                          ||
+      selection->view_scale_x  != shell->scale_x       ||
+      selection->view_scale_y  != shell->scale_y       ||
+      selection->view_offset_x != shell->offset_x      ||
+      selection->view_offset_y != shell->offset_y      ||
+      selection->view_width    != shell->disp_width    ||
+      selection->view_height   != shell->disp_height   ||
+      selection->view_rotated  != (shell->rotate_transform != NULL))
+    return TRUE;
+
+  if (shell->rotate_transform &&
+      memcmp (&selection->view_rotate, shell->rotate_transform,
+              sizeof (cairo_matrix_t)))
+    return TRUE;
+
+  return FALSE;
+}
+
+static void
+selection_generate_segs (Selection *selection)
+{
+  GimpDisplayShell *shell = selection->shell;
+  GimpImage        *image = gimp_display_get_image (shell->display);
+  gdouble           x1, y1;
+  gdouble           x2, y2;
+
+  /*  Ask the image for the boundary of its selected region, and
+   *  index it, unless we did so since the mask last changed...
+   */
+  if (! selection->bound_valid)
     {
-      selection->segs_in = NULL;
+      const GimpBoundSeg *segs_in;
+      const GimpBoundSeg *segs_out;
+      gint                n_segs_in;
+      gint                n_segs_out;
+
+      gimp_channel_boundary (gimp_image_get_mask (image),
+                             &segs_in, &segs_out,
+                             &n_segs_in, &n_segs_out,
+                             0, 0, 0, 0);
+
+      selection_segs_init (&selection->bound_in, segs_in, n_segs_in,
+                           gimp_image_get_width  (image),
+                           gimp_image_get_height (image));
+      selection_segs_init (&selection->bound_out, segs_out, n_segs_out,
+                           gimp_image_get_width  (image),
+                           gimp_image_get_height (image));
+
+      selection->bound_valid = TRUE;
     }
 
+  /*  ...then transform the visible part into GimpSegments
+   */
+  gimp_display_shell_untransform_bounds (shell,
+                                         0, 0,
+                                         shell->disp_width, shell->disp_height,
+                                         &x1, &y1, &x2, &y2);
+
+  x1 -= 1.0;
+  y1 -= 1.0;
+  x2 += 1.0;
+  y2 += 1.0;
+
+  selection->segs_in = selection_segs_get_visible (selection,
+                                                   &selection->bound_in,
+                                                   x1, y1, x2, y2,
+                                                   &selection->n_segs_in);
+
+  if (selection->segs_in)
+    selection_render_mask (selection);
+
   /*  Possible secondary boundary representation  */
-  if (selection->n_segs_out)
-    {
-      selection->segs_out = g_new (GimpSegment, selection->n_segs_out);
-      selection_zoom_segs (selection, segs_out,
-                           selection->segs_out, selection->n_segs_out);
-    }
-  else
-    {
-      selection->segs_out = NULL;
-    }
+  selection->segs_out = selection_segs_get_visible (selection,
+                                                    &selection->bound_out,
+                                                    x1, y1, x2, y2,
+                                                    &selection->n_segs_out);
+
+  selection->view_scale_x  = shell->scale_x;
+  selection->view_scale_y  = shell->scale_y;
+  selection->view_offset_x = shell->offset_x;
+  selection->view_offset_y = shell->offset_y;
+  selection->view_width    = shell->disp_width;
+  selection->view_height   = shell->disp_height;
+  selection->view_rotated  = (shell->rotate_transform != NULL);
+
+  if (shell->rotate_transform)
+    selection->view_rotate = *shell->rotate_transform;
+
+  selection->view_valid = TRUE;
 }
 
 static void
@@ -418,18 +706,43 @@ selection_free_segs (Selection *selection)
       cairo_pattern_destroy (selection->segs_in_mask);
       selection->segs_in_mask = NULL;
     }
+
+  selection->view_valid = FALSE;
+}
+
+static void
+selection_free_boundary (Selection *selection)
+{
+  if (selection->bound_valid)
+    {
+      selection_segs_free (&selection->bound_in);
+      selection_segs_free (&selection->bound_out);
+
+      selection->bound_valid = FALSE;
+    }
+
+  selection->view_valid = FALSE;
 }
 
 static gboolean
 selection_start_timeout (Selection *selection)
 {
-  selection_free_segs (selection);
   selection->timeout = 0;
 
   if (! gimp_display_get_image (selection->shell->display))
-    return FALSE;
+    {
+      selection_free_segs (selection);
+      return FALSE;
+    }
 
-  selection_generate_segs (selection);
+  /*  every expose restarts the selection, only regenerate the
+   *  segments if the view actually changed
+   */
+  if (selection_view_changed (selection))
+    {
+      selection_free_segs (selection);
+      selection_generate_segs (selection);
+    }
 
   selection->index = 0;
 
@@ -170,6 +170,8 @@ static void   gimp_display_shell_transform_overlay (GimpDisplayShell *shell,
                                                     GtkWidget        *child,
                                                     gdouble          *x,
                                                     gdouble          *y);
+static void   gimp_display_shell_update_priority_rect
+                                                   (GimpDisplayShell *shell);
 
 
 G_DEFINE_TYPE_WITH_CODE (GimpDisplayShell, gimp_display_shell,
@@ -797,6 +799,17 @@ gimp_display_shell_dispose (GObject *object)
       shell->checkerboard = NULL;
     }
 
+  if (shell->render_cache)
+    {
+      gimp_display_shell_render_invalidate_full (shell);
+
+      g_hash_table_unref (shell->render_cache);
+      shell->render_cache = NULL;
+
+      g_queue_free (shell->render_cache_lru);
+      shell->render_cache_lru = NULL;
+    }
+
   if (shell->mask)
     {
       g_object_unref (shell->mask);
@@ -1114,6 +1127,27 @@ gimp_display_shell_remove_overlay (GtkWidget        *canvas,
   shell->children = g_list_remove (shell->children, child);
 }
 
+/*  tell the projection which part of the image is visible, so
+ *  pending rendering of that part is done first
+ */
+static void
+gimp_display_shell_update_priority_rect (GimpDisplayShell *shell)
+{
+  GimpImage *image = gimp_display_get_image (shell->display);
+
+  if (image)
+    {
+      gint x, y;
+      gint width, height;
+
+      gimp_display_shell_untransform_viewport (shell,
+                                               &x, &y, &width, &height);
+
+      gimp_projection_set_priority_rect (gimp_image_get_projection (image),
+                                         x, y, width, height);
+    }
+}
+
 static void
 gimp_display_shell_transform_overlay (GimpDisplayShell *shell,
                                       GtkWidget        *child,
@@ -1465,6 +1499,8 @@ gimp_display_shell_scaled (GimpDisplayShell *shell)
                                            child, x, y);
     }
 
+  gimp_display_shell_update_priority_rect (shell);
+
   g_signal_emit (shell, display_shell_signals[SCALED], 0);
 }
 
@@ -1488,6 +1524,8 @@ gimp_display_shell_scrolled (GimpDisplayShell *shell)
                                            child, x, y);
     }
 
+  gimp_display_shell_update_priority_rect (shell);
+
   g_signal_emit (shell, display_shell_signals[SCROLLED], 0);
 }
 
@@ -117,6 +117,10 @@ struct _GimpDisplayShell
   cairo_surface_t   *mask_surface;     /*  buffer for rendering the mask      */
   cairo_pattern_t   *checkerboard;     /*  checkerboard pattern               */
 
+  GHashTable        *render_cache;     /*  rendered display tiles             */
+  GQueue            *render_cache_lru; /*  cached tiles, most recent first    */
+  gdouble            render_scale;     /*  the scale of the cached tiles      */
+
   GimpCanvasItem    *canvas_item;      /*  items drawn on the canvas          */
   GimpCanvasItem    *unrotated_item;   /*  unrotated items for e.g. cursor    */
   GimpCanvasItem    *passe_partout;    /*  item for the highlight             */
@@ -325,6 +325,9 @@ gimp_image_window_constructed (GObject *object)
                            G_CALLBACK (gimp_image_window_update_ui_manager),
                            window, G_CONNECT_SWAPPED);
 
+  /*  shortcuts need the actions to exist before any menu is shown  */
+  gimp_ui_manager_ensure_action_groups (private->menubar_manager);
+
   gtk_window_add_accel_group (GTK_WINDOW (window),
                               gtk_ui_manager_get_accel_group (GTK_UI_MANAGER (private->menubar_manager)));
 
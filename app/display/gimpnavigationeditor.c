@@ -54,6 +54,7 @@
 
 
 #define UPDATE_DELAY 300 /* From GtkRange in GTK+ 2.22 */
+#define FRAME_RATE    30 /* updates per second of the preview while painting */
 
 
 static void        gimp_navigation_editor_docked_iface_init (GimpDockedInterface  *iface);
@@ -139,6 +140,12 @@ gimp_navigation_editor_init (GimpNavigationEditor *editor)
   gtk_container_add (GTK_CONTAINER (frame), editor->view);
   gtk_widget_show (editor->view);
 
+  /*  the image preview is invalidated on each projection flush, don't
+   *  scale the projection down more often than the frame rate
+   */
+  gimp_view_renderer_set_frame_rate (GIMP_VIEW (editor->view)->renderer,
+                                     FRAME_RATE);
+
   g_signal_connect (editor->view, "marker-changed",
                     G_CALLBACK (gimp_navigation_editor_marker_changed),
                     editor);
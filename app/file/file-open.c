@@ -44,16 +44,19 @@
 #include "libgimpconfig/gimpconfig.h"
 
 #include "core/core-types.h"
+#include "plug-in/plug-in-types.h"
 
 #include "config/gimpcoreconfig.h"
 
 #include "gegl/gimp-babl.h"
 
 #include "core/gimp.h"
+#include "core/gimp-parallel.h"
 #include "core/gimpcontext.h"
 #include "core/gimpdocumentlist.h"
 #include "core/gimpimage.h"
 #include "core/gimpimage-merge.h"
+#include "core/gimpimage-profile.h"
 #include "core/gimpimage-undo.h"
 #include "core/gimpimagefile.h"
 #include "core/gimplayer.h"
@@ -61,7 +64,10 @@
 #include "core/gimpprogress.h"
 
 #include "pdb/gimppdb.h"
+#include "pdb/gimppdbcontext.h"
+#include "pdb/gimpprocedure.h"
 
+#include "plug-in/gimpplugin.h"
 #include "plug-in/gimppluginmanager.h"
 #include "plug-in/gimppluginprocedure.h"
 #include "plug-in/gimppluginerror.h"
@@ -75,19 +81,91 @@
 #include "gimp-intl.h"
 
 
-static void     file_open_sanitize_image       (GimpImage                 *image,
-                                                gboolean                   as_new);
-static void     file_open_convert_items        (GimpImage                 *dest_image,
-                                                const gchar               *basename,
-                                                GList                     *items);
-static void     file_open_handle_color_profile (GimpImage                 *image,
-                                                GimpContext               *context,
-                                                GimpProgress              *progress,
-                                                GimpRunMode                run_mode);
-static GList *  file_open_get_layers           (const GimpImage           *image,
-                                                gboolean                   merge_visible,
-                                                gint                      *n_visible);
-static gboolean file_open_file_proc_is_import  (const GimpPlugInProcedure *file_proc);
+typedef struct _FileOpenItem  FileOpenItem;
+typedef struct _FileOpenQueue FileOpenQueue;
+
+struct _FileOpenItem
+{
+  gchar               *uri;
+  GimpPlugInProcedure *file_proc;
+  GimpContext         *context;
+  GimpValueArray      *return_vals;
+};
+
+struct _FileOpenQueue
+{
+  Gimp        *gimp;
+  GimpContext *context;
+  GimpObject  *display;
+  gboolean     as_new;
+
+  GList       *uris;
+  gint         n_jobs;
+
+  GList       *running;
+  GList       *done;
+  gint         n_opened;
+
+  guint        idle_id;
+  GMainLoop   *loop;
+};
+
+
+static gchar *        file_open_get_filename         (GimpPlugInProcedure       *file_proc,
+                                                      const gchar               *uri,
+                                                      GError                   **error);
+static GimpImage *    file_open_image_finish         (Gimp                      *gimp,
+                                                      GimpContext               *context,
+                                                      GimpProgress              *progress,
+                                                      const gchar               *uri,
+                                                      gboolean                   as_new,
+                                                      GimpPlugInProcedure       *file_proc,
+                                                      GimpRunMode                run_mode,
+                                                      GimpValueArray            *return_vals,
+                                                      GimpPDBStatusType         *status,
+                                                      const gchar              **mime_type,
+                                                      GError                   **error);
+static void           file_open_display_image        (Gimp                      *gimp,
+                                                      GimpImage                 *image,
+                                                      const gchar               *uri,
+                                                      gboolean                   as_new,
+                                                      GimpPlugInProcedure       *file_proc,
+                                                      const gchar               *mime_type);
+static void           file_open_sanitize_image       (GimpImage                 *image,
+                                                      gboolean                   as_new);
+static void           file_open_convert_items        (GimpImage                 *dest_image,
+                                                      const gchar               *basename,
+                                                      GList                     *items);
+static void           file_open_handle_color_profile (GimpImage                 *image,
+                                                      GimpContext               *context,
+                                                      GimpProgress              *progress,
+                                                      GimpRunMode                run_mode);
+static GList *        file_open_get_layers           (const GimpImage           *image,
+                                                      gboolean                   merge_visible,
+                                                      gint                      *n_visible);
+static gboolean       file_open_file_proc_is_import  (const GimpPlugInProcedure *file_proc);
+
+static void           file_open_queue_dispatch       (FileOpenQueue             *queue);
+static gboolean       file_open_queue_idle           (FileOpenQueue             *queue);
+static void           file_open_queue_start          (FileOpenQueue             *queue,
+                                                      const gchar               *uri);
+static void           file_open_queue_finish         (FileOpenQueue             *queue,
+                                                      FileOpenItem              *item);
+static void           file_open_queue_message        (FileOpenQueue             *queue,
+                                                      const gchar               *uri,
+                                                      const GError              *error);
+static FileOpenItem * file_open_queue_find_item      (FileOpenQueue             *queue,
+                                                      GimpContext               *context);
+static void           file_open_queue_item_done      (FileOpenQueue             *queue,
+                                                      FileOpenItem              *item);
+static void           file_open_queue_item_free      (FileOpenItem              *item);
+
+static void           file_open_queue_returned       (GimpPlugInManager         *manager,
+                                                      GimpPlugIn                *plug_in,
+                                                      FileOpenQueue             *queue);
+static void           file_open_queue_closed         (GimpPlugInManager         *manager,
+                                                      GimpPlugIn                *plug_in,
+                                                      FileOpenQueue             *queue);
 
 
 /*  public functions  */
@@ -107,7 +185,7 @@ file_open_image (Gimp                *gimp,
 {
   GimpValueArray *return_vals;
   gchar          *filename;
-  GimpImage      *image = NULL;
+  GimpImage      *image;
 
   g_return_val_if_fail (GIMP_IS_GIMP (gimp), NULL);
   g_return_val_if_fail (GIMP_IS_CONTEXT (context), NULL);
@@ -124,40 +202,10 @@ file_open_image (Gimp                *gimp,
   if (! file_proc)
     return NULL;
 
-  filename = file_utils_filename_from_uri (uri);
-
-  if (filename)
-    {
-      /* check if we are opening a file */
-      if (g_file_test (filename, G_FILE_TEST_EXISTS))
-        {
-          if (! g_file_test (filename, G_FILE_TEST_IS_REGULAR))
-            {
-              g_free (filename);
-              g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
-				   _("Not a regular file"));
-              return NULL;
-            }
-
-          if (g_access (filename, R_OK) != 0)
-            {
-              g_free (filename);
-              g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_ACCES,
-				   g_strerror (errno));
-              return NULL;
-            }
-        }
+  filename = file_open_get_filename (file_proc, uri, error);
 
-      if (file_proc->handles_uri)
-        {
-          g_free (filename);
-          filename = g_strdup (uri);
-        }
-    }
-  else
-    {
-      filename = g_strdup (uri);
-    }
+  if (! filename)
+    return NULL;
 
   return_vals =
     gimp_pdb_execute_procedure_by_name (gimp->pdb,
@@ -170,61 +218,12 @@ file_open_image (Gimp                *gimp,
 
   g_free (filename);
 
-  *status = g_value_get_enum (gimp_value_array_index (return_vals, 0));
-
-  if (*status == GIMP_PDB_SUCCESS)
-    {
-      image = gimp_value_get_image (gimp_value_array_index (return_vals, 1),
-                                    gimp);
-
-      if (image)
-        {
-          file_open_sanitize_image (image, as_new);
-
-          /* Only set the load procedure if it hasn't already been set. */
-          if (! gimp_image_get_load_proc (image))
-            gimp_image_set_load_proc (image, file_proc);
-
-          file_proc = gimp_image_get_load_proc (image);
-
-          if (mime_type)
-            *mime_type = file_proc->mime_type;
-        }
-      else
-        {
-          if (error && ! *error)
-            g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
-                         _("%s plug-in returned SUCCESS but did not "
-                           "return an image"),
-                         gimp_plug_in_procedure_get_label (file_proc));
-
-          *status = GIMP_PDB_EXECUTION_ERROR;
-        }
-    }
-  else if (*status != GIMP_PDB_CANCEL)
-    {
-      if (error && ! *error)
-        g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
-                     _("%s plug-In could not open image"),
-                     gimp_plug_in_procedure_get_label (file_proc));
-    }
+  image = file_open_image_finish (gimp, context, progress, uri, as_new,
+                                  file_proc, run_mode, return_vals,
+                                  status, mime_type, error);
 
   gimp_value_array_unref (return_vals);
 
-  if (image)
-    {
-      file_open_handle_color_profile (image, context, progress, run_mode);
-
-      if (file_open_file_proc_is_import (file_proc))
-        {
-          /* Remember the import source */
-          gimp_image_set_imported_uri (image, uri);
-
-          /* We shall treat this file as an Untitled file */
-          gimp_image_set_uri (image, NULL);
-        }
-    }
-
   return image;
 }
 
@@ -452,65 +451,7 @@ file_open_with_proc_and_display (Gimp                *gimp,
                            error);
 
   if (image)
-    {
-      /* If the file was imported we want to set the layer name to the
-       * file name. For now, assume that multi-layered imported images
-       * have named the layers already, so only rename the layer of
-       * single-layered imported files. Note that this will also
-       * rename already named layers from e.g. single-layered PSD
-       * files. To solve this properly, we would need new file plug-in
-       * API.
-       */
-      if (! file_proc)
-        file_proc = gimp_image_get_load_proc (image);
-
-      if (file_open_file_proc_is_import (file_proc) &&
-          gimp_image_get_n_layers (image) == 1)
-        {
-          GimpObject *layer    = gimp_image_get_layer_iter (image)->data;
-          gchar      *basename = file_utils_uri_display_basename (uri);
-
-          gimp_item_rename (GIMP_ITEM (layer), basename, NULL);
-          gimp_image_undo_free (image);
-          gimp_image_clean_all (image);
-
-          g_free (basename);
-        }
-
-      if (gimp_create_display (image->gimp, image, GIMP_UNIT_PIXEL, 1.0))
-        {
-          /*  the display owns the image now  */
-          g_object_unref (image);
-        }
-
-      if (! as_new)
-        {
-          GimpDocumentList *documents = GIMP_DOCUMENT_LIST (gimp->documents);
-          GimpImagefile    *imagefile;
-          const gchar      *any_uri;
-
-          imagefile = gimp_document_list_add_uri (documents, uri, mime_type);
-
-          /*  can only create a thumbnail if the passed uri and the
-           *  resulting image's uri match. Use any_uri() here so we
-           *  create thumbnails for both XCF and imported images.
-           */
-          any_uri = gimp_image_get_any_uri (image);
-
-          if (any_uri && ! strcmp (uri, any_uri))
-            {
-              /*  no need to save a thumbnail if there's a good one already  */
-              if (! gimp_imagefile_check_thumbnail (imagefile))
-                {
-                  gimp_imagefile_save_thumbnail (imagefile, mime_type, image,
-                                                 NULL);
-                }
-            }
-        }
-
-      /*  announce that we opened this image  */
-      gimp_image_opened (image->gimp, uri);
-    }
+    file_open_display_image (gimp, image, uri, as_new, file_proc, mime_type);
 
   return image;
 }
@@ -589,6 +530,84 @@ file_open_layers (Gimp                *gimp,
   return g_list_reverse (layers);
 }
 
+/**
+ * file_open_multiple_with_display:
+ * @gimp:    a #Gimp
+ * @context: the context to open the images in
+ * @display: the display to report errors on, or %NULL
+ * @uris:    a list of URIs
+ * @as_new:  whether to open the images as new, untitled images
+ *
+ * Opens all of @uris and creates a display for each image as soon as
+ * it is loaded.  Files that are loaded by plug-ins are opened in
+ * parallel, with up to one plug-in per configured thread running at
+ * the same time.  Returns when all files are opened.
+ *
+ * Return value: the number of images that were opened.
+ **/
+gint
+file_open_multiple_with_display (Gimp        *gimp,
+                                 GimpContext *context,
+                                 GimpObject  *display,
+                                 GList       *uris,
+                                 gboolean     as_new)
+{
+  GimpPlugInManager *manager;
+  FileOpenQueue      queue = { 0, };
+  gulong             returned_id;
+  gulong             closed_id;
+
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), 0);
+  g_return_val_if_fail (GIMP_IS_CONTEXT (context), 0);
+  g_return_val_if_fail (display == NULL || GIMP_IS_OBJECT (display), 0);
+
+  manager = gimp->plug_in_manager;
+
+  queue.gimp    = gimp;
+  queue.context = context;
+  queue.display = display;
+  queue.as_new  = as_new;
+  queue.uris    = uris;
+  queue.n_jobs  = gimp_parallel_get_n_threads ();
+
+  if (display)
+    g_object_add_weak_pointer (G_OBJECT (display),
+                               (gpointer) &queue.display);
+
+  returned_id = g_signal_connect (manager, "plug-in-returned",
+                                  G_CALLBACK (file_open_queue_returned),
+                                  &queue);
+  closed_id   = g_signal_connect (manager, "plug-in-closed",
+                                  G_CALLBACK (file_open_queue_closed),
+                                  &queue);
+
+  queue.loop = g_main_loop_new (NULL, FALSE);
+
+  file_open_queue_dispatch (&queue);
+
+  if (queue.running || queue.done)
+    {
+      gimp_threads_leave (gimp);
+      g_main_loop_run (queue.loop);
+      gimp_threads_enter (gimp);
+    }
+
+  g_main_loop_unref (queue.loop);
+  queue.loop = NULL;
+
+  g_signal_handler_disconnect (manager, returned_id);
+  g_signal_handler_disconnect (manager, closed_id);
+
+  if (queue.idle_id)
+    g_source_remove (queue.idle_id);
+
+  if (queue.display)
+    g_object_remove_weak_pointer (G_OBJECT (queue.display),
+                                  (gpointer) &queue.display);
+
+  return queue.n_opened;
+}
+
 
 /*  This function is called for filenames passed on the command-line
  *  or from the D-Bus service.
@@ -656,9 +675,241 @@ file_open_from_command_line (Gimp        *gimp,
   return success;
 }
 
+/*  This function is called for the list of filenames passed on the
+ *  command-line, it opens them in parallel.
+ */
+void
+file_open_from_command_line_multiple (Gimp         *gimp,
+                                      const gchar **filenames,
+                                      gboolean      as_new)
+{
+  GList *uris = NULL;
+  gint   i;
+
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+  g_return_if_fail (filenames != NULL);
+
+  for (i = 0; filenames[i]; i++)
+    {
+      GError *error = NULL;
+      gchar  *uri;
+
+      /* we accept URI or filename */
+      uri = file_utils_any_to_uri (gimp, filenames[i], &error);
+
+      if (uri)
+        {
+          uris = g_list_prepend (uris, uri);
+        }
+      else
+        {
+          g_printerr ("conversion filename -> uri failed: %s\n",
+                      error->message);
+          g_clear_error (&error);
+        }
+    }
+
+  uris = g_list_reverse (uris);
+
+  if (uris &&
+      file_open_multiple_with_display (gimp, gimp_get_user_context (gimp),
+                                       gimp_get_empty_display (gimp),
+                                       uris, as_new))
+    {
+      g_object_set_data_full (G_OBJECT (gimp), GIMP_FILE_OPEN_LAST_URI_KEY,
+                              g_strdup (g_list_last (uris)->data),
+                              (GDestroyNotify) g_free);
+    }
+
+  g_list_free_full (uris, (GDestroyNotify) g_free);
+}
+
 
 /*  private functions  */
 
+static gchar *
+file_open_get_filename (GimpPlugInProcedure  *file_proc,
+                        const gchar          *uri,
+                        GError              **error)
+{
+  gchar *filename;
+
+  filename = file_utils_filename_from_uri (uri);
+
+  if (filename)
+    {
+      /* check if we are opening a file */
+      if (g_file_test (filename, G_FILE_TEST_EXISTS))
+        {
+          if (! g_file_test (filename, G_FILE_TEST_IS_REGULAR))
+            {
+              g_free (filename);
+              g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+				   _("Not a regular file"));
+              return NULL;
+            }
+
+          if (g_access (filename, R_OK) != 0)
+            {
+              g_free (filename);
+              g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_ACCES,
+				   g_strerror (errno));
+              return NULL;
+            }
+        }
+
+      if (file_proc->handles_uri)
+        {
+          g_free (filename);
+          filename = g_strdup (uri);
+        }
+    }
+  else
+    {
+      filename = g_strdup (uri);
+    }
+
+  return filename;
+}
+
+static GimpImage *
+file_open_image_finish (Gimp                *gimp,
+                        GimpContext         *context,
+                        GimpProgress        *progress,
+                        const gchar         *uri,
+                        gboolean             as_new,
+                        GimpPlugInProcedure *file_proc,
+                        GimpRunMode          run_mode,
+                        GimpValueArray      *return_vals,
+                        GimpPDBStatusType   *status,
+                        const gchar        **mime_type,
+                        GError             **error)
+{
+  GimpImage *image = NULL;
+
+  *status = g_value_get_enum (gimp_value_array_index (return_vals, 0));
+
+  if (*status == GIMP_PDB_SUCCESS)
+    {
+      image = gimp_value_get_image (gimp_value_array_index (return_vals, 1),
+                                    gimp);
+
+      if (image)
+        {
+          file_open_sanitize_image (image, as_new);
+
+          /* Only set the load procedure if it hasn't already been set. */
+          if (! gimp_image_get_load_proc (image))
+            gimp_image_set_load_proc (image, file_proc);
+
+          file_proc = gimp_image_get_load_proc (image);
+
+          if (mime_type)
+            *mime_type = file_proc->mime_type;
+        }
+      else
+        {
+          if (error && ! *error)
+            g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                         _("%s plug-in returned SUCCESS but did not "
+                           "return an image"),
+                         gimp_plug_in_procedure_get_label (file_proc));
+
+          *status = GIMP_PDB_EXECUTION_ERROR;
+        }
+    }
+  else if (*status != GIMP_PDB_CANCEL)
+    {
+      if (error && ! *error)
+        g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                     _("%s plug-In could not open image"),
+                     gimp_plug_in_procedure_get_label (file_proc));
+    }
+
+  if (image)
+    {
+      file_open_handle_color_profile (image, context, progress, run_mode);
+
+      if (file_open_file_proc_is_import (file_proc))
+        {
+          /* Remember the import source */
+          gimp_image_set_imported_uri (image, uri);
+
+          /* We shall treat this file as an Untitled file */
+          gimp_image_set_uri (image, NULL);
+        }
+    }
+
+  return image;
+}
+
+static void
+file_open_display_image (Gimp                *gimp,
+                         GimpImage           *image,
+                         const gchar         *uri,
+                         gboolean             as_new,
+                         GimpPlugInProcedure *file_proc,
+                         const gchar         *mime_type)
+{
+  /* If the file was imported we want to set the layer name to the
+   * file name. For now, assume that multi-layered imported images
+   * have named the layers already, so only rename the layer of
+   * single-layered imported files. Note that this will also
+   * rename already named layers from e.g. single-layered PSD
+   * files. To solve this properly, we would need new file plug-in
+   * API.
+   */
+  if (! file_proc)
+    file_proc = gimp_image_get_load_proc (image);
+
+  if (file_open_file_proc_is_import (file_proc) &&
+      gimp_image_get_n_layers (image) == 1)
+    {
+      GimpObject *layer    = gimp_image_get_layer_iter (image)->data;
+      gchar      *basename = file_utils_uri_display_basename (uri);
+
+      gimp_item_rename (GIMP_ITEM (layer), basename, NULL);
+      gimp_image_undo_free (image);
+      gimp_image_clean_all (image);
+
+      g_free (basename);
+    }
+
+  if (gimp_create_display (image->gimp, image, GIMP_UNIT_PIXEL, 1.0))
+    {
+      /*  the display owns the image now  */
+      g_object_unref (image);
+    }
+
+  if (! as_new)
+    {
+      GimpDocumentList *documents = GIMP_DOCUMENT_LIST (gimp->documents);
+      GimpImagefile    *imagefile;
+      const gchar      *any_uri;
+
+      imagefile = gimp_document_list_add_uri (documents, uri, mime_type);
+
+      /*  can only create a thumbnail if the passed uri and the
+       *  resulting image's uri match. Use any_uri() here so we
+       *  create thumbnails for both XCF and imported images.
+       */
+      any_uri = gimp_image_get_any_uri (image);
+
+      if (any_uri && ! strcmp (uri, any_uri))
+        {
+          /*  no need to save a thumbnail if there's a good one already  */
+          if (! gimp_imagefile_check_thumbnail (imagefile))
+            {
+              gimp_imagefile_save_thumbnail (imagefile, mime_type, image,
+                                             NULL);
+            }
+        }
+    }
+
+  /*  announce that we opened this image  */
+  gimp_image_opened (image->gimp, uri);
+}
+
 static void
 file_open_sanitize_image (GimpImage *image,
                           gboolean   as_new)
@@ -769,6 +1020,39 @@ file_open_profile_apply_rgb (GimpImage    *image,
     }
 }
 
+static void
+file_open_profile_convert_rgb (GimpImage    *image,
+                               GimpContext  *context,
+                               GimpProgress *progress)
+{
+#ifdef HAVE_LCMS
+  GimpColorConfig          *config = image->gimp->config->color_management;
+  GimpColorRenderingIntent  intent = config->display_intent;
+  GError                   *error  = NULL;
+
+  if (gimp_image_get_base_type (image) == GIMP_GRAY)
+    return;
+
+  if (config->mode == GIMP_COLOR_MANAGEMENT_OFF)
+    return;
+
+  /*  there is nothing to ask, convert in the core instead of sending
+   *  all pixels to the lcms plug-in and back
+   */
+  if (! gimp_image_convert_profile (image, config->rgb_profile, intent,
+                                    intent == GIMP_COLOR_RENDERING_INTENT_RELATIVE_COLORIMETRIC,
+                                    progress, &error))
+    {
+      gimp_message_literal (image->gimp, G_OBJECT (progress),
+                            GIMP_MESSAGE_ERROR, error->message);
+      g_error_free (error);
+    }
+#else
+  file_open_profile_apply_rgb (image, context, progress,
+                               GIMP_RUN_NONINTERACTIVE);
+#endif
+}
+
 static void
 file_open_handle_color_profile (GimpImage    *image,
                                 GimpContext  *context,
@@ -791,8 +1075,7 @@ file_open_handle_color_profile (GimpImage    *image,
           break;
 
         case GIMP_COLOR_PROFILE_POLICY_CONVERT:
-          file_open_profile_apply_rgb (image, context, progress,
-                                       GIMP_RUN_NONINTERACTIVE);
+          file_open_profile_convert_rgb (image, context, progress);
           break;
         }
 
@@ -838,3 +1121,294 @@ file_open_file_proc_is_import (const GimpPlugInProcedure *file_proc)
            file_proc->mime_type &&
            strcmp (file_proc->mime_type, "image/xcf") == 0);
 }
+
+static void
+file_open_queue_dispatch (FileOpenQueue *queue)
+{
+  /*  finish the images that are loaded first, their displays should
+   *  appear before more plug-ins are started
+   */
+  while (queue->done)
+    {
+      FileOpenItem *item = queue->done->data;
+
+      queue->done = g_list_remove (queue->done, item);
+
+      file_open_queue_finish (queue, item);
+    }
+
+  while (queue->uris && g_list_length (queue->running) < queue->n_jobs)
+    {
+      const gchar *uri = queue->uris->data;
+
+      queue->uris = g_list_next (queue->uris);
+
+      file_open_queue_start (queue, uri);
+    }
+
+  if (! queue->running && ! queue->done && ! queue->uris &&
+      g_main_loop_is_running (queue->loop))
+    {
+      g_main_loop_quit (queue->loop);
+    }
+}
+
+static gboolean
+file_open_queue_idle (FileOpenQueue *queue)
+{
+  queue->idle_id = 0;
+
+  file_open_queue_dispatch (queue);
+
+  return FALSE;
+}
+
+static void
+file_open_queue_start (FileOpenQueue *queue,
+                       const gchar   *uri)
+{
+  Gimp                *gimp = queue->gimp;
+  GimpPlugInProcedure *file_proc;
+  FileOpenItem        *item;
+  GimpValueArray      *args;
+  gchar               *filename;
+  GSList              *list;
+  GError              *error = NULL;
+
+  file_proc = file_procedure_find (gimp->plug_in_manager->load_procs, uri,
+                                   &error);
+
+  if (! file_proc)
+    {
+      file_open_queue_message (queue, uri, error);
+      g_clear_error (&error);
+
+      return;
+    }
+
+  /*  only plug-ins run in their own processes, open everything else,
+   *  like XCF files, right here
+   */
+  if (GIMP_PROCEDURE (file_proc)->proc_type != GIMP_PLUGIN)
+    {
+      GimpPDBStatusType status;
+
+      if (file_open_with_proc_and_display (gimp, queue->context, NULL,
+                                           uri, uri, queue->as_new,
+                                           file_proc, &status, &error))
+        {
+          queue->n_opened++;
+        }
+      else if (status != GIMP_PDB_CANCEL)
+        {
+          file_open_queue_message (queue, uri, error);
+        }
+
+      g_clear_error (&error);
+
+      return;
+    }
+
+  filename = file_open_get_filename (file_proc, uri, &error);
+
+  if (! filename)
+    {
+      file_open_queue_message (queue, uri, error);
+      g_clear_error (&error);
+
+      return;
+    }
+
+  item = g_slice_new0 (FileOpenItem);
+
+  /*  every item gets its own context, which also tells the plug-ins
+   *  running them apart
+   */
+  item->uri       = g_strdup (uri);
+  item->file_proc = file_proc;
+  item->context   = gimp_pdb_context_new (gimp, queue->context, TRUE);
+
+  queue->running = g_list_append (queue->running, item);
+
+  args = gimp_procedure_get_arguments (GIMP_PROCEDURE (file_proc));
+
+  g_value_set_int    (gimp_value_array_index (args, 0), GIMP_RUN_INTERACTIVE);
+  g_value_take_string (gimp_value_array_index (args, 1), filename);
+  g_value_set_string (gimp_value_array_index (args, 2), uri);
+
+  gimp_procedure_execute_async (GIMP_PROCEDURE (file_proc), gimp,
+                                item->context, NULL, args, NULL, &error);
+
+  gimp_value_array_unref (args);
+
+  for (list = gimp->plug_in_manager->open_plug_ins;
+       list;
+       list = g_slist_next (list))
+    {
+      GimpPlugIn *plug_in = list->data;
+
+      if (plug_in->main_proc_frame.main_context == item->context)
+        break;
+    }
+
+  /*  the plug-in could not be started  */
+  if (! list)
+    {
+      queue->running = g_list_remove (queue->running, item);
+
+      if (! error)
+        g_set_error (&error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                     _("%s plug-In could not open image"),
+                     gimp_plug_in_procedure_get_label (file_proc));
+
+      file_open_queue_message (queue, uri, error);
+
+      file_open_queue_item_free (item);
+    }
+
+  g_clear_error (&error);
+}
+
+static void
+file_open_queue_finish (FileOpenQueue *queue,
+                        FileOpenItem  *item)
+{
+  GimpImage         *image     = NULL;
+  const gchar       *mime_type = NULL;
+  GimpPDBStatusType  status    = GIMP_PDB_EXECUTION_ERROR;
+  gboolean           reported  = FALSE;
+  GError            *error     = NULL;
+
+  if (item->return_vals)
+    {
+      image = file_open_image_finish (queue->gimp, queue->context, NULL,
+                                      item->uri, queue->as_new,
+                                      item->file_proc, GIMP_RUN_INTERACTIVE,
+                                      item->return_vals,
+                                      &status, &mime_type, &error);
+
+      /*  the error message of an asynchronously run plug-in has been
+       *  shown when it returned
+       */
+      reported = (status != GIMP_PDB_SUCCESS &&
+                  gimp_value_array_length (item->return_vals) > 1 &&
+                  G_VALUE_HOLDS_STRING (gimp_value_array_index (item->return_vals,
+                                                                1)));
+    }
+  else
+    {
+      g_set_error (&error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                   _("%s plug-In could not open image"),
+                   gimp_plug_in_procedure_get_label (item->file_proc));
+    }
+
+  if (image)
+    {
+      file_open_display_image (queue->gimp, image, item->uri, queue->as_new,
+                               item->file_proc, mime_type);
+
+      queue->n_opened++;
+    }
+  else if (status != GIMP_PDB_CANCEL && ! reported)
+    {
+      file_open_queue_message (queue, item->uri, error);
+    }
+
+  g_clear_error (&error);
+
+  file_open_queue_item_free (item);
+}
+
+static void
+file_open_queue_message (FileOpenQueue *queue,
+                         const gchar   *uri,
+                         const GError  *error)
+{
+  gchar *filename = file_utils_uri_display_name (uri);
+
+  gimp_message (queue->gimp, G_OBJECT (queue->display), GIMP_MESSAGE_ERROR,
+                _("Opening '%s' failed:\n\n%s"),
+                filename, error ? error->message : _("Unknown error"));
+
+  g_free (filename);
+}
+
+static FileOpenItem *
+file_open_queue_find_item (FileOpenQueue *queue,
+                           GimpContext   *context)
+{
+  GList *list;
+
+  for (list = queue->running; list; list = g_list_next (list))
+    {
+      FileOpenItem *item = list->data;
+
+      if (item->context == context)
+        return item;
+    }
+
+  return NULL;
+}
+
+static void
+file_open_queue_item_done (FileOpenQueue *queue,
+                           FileOpenItem  *item)
+{
+  queue->running = g_list_remove (queue->running, item);
+  queue->done    = g_list_append (queue->done, item);
+
+  /*  don't create the display from within the plug-in's message
+   *  handling
+   */
+  if (! queue->idle_id)
+    queue->idle_id = g_idle_add ((GSourceFunc) file_open_queue_idle, queue);
+}
+
+static void
+file_open_queue_item_free (FileOpenItem *item)
+{
+  if (item->return_vals)
+    gimp_value_array_unref (item->return_vals);
+
+  g_object_unref (item->context);
+  g_free (item->uri);
+
+  g_slice_free (FileOpenItem, item);
+}
+
+static void
+file_open_queue_returned (GimpPlugInManager *manager,
+                          GimpPlugIn        *plug_in,
+                          FileOpenQueue     *queue)
+{
+  GimpPlugInProcFrame *proc_frame = &plug_in->main_proc_frame;
+  FileOpenItem        *item;
+
+  item = file_open_queue_find_item (queue, proc_frame->main_context);
+
+  if (! item)
+    return;
+
+  if (proc_frame->return_vals &&
+      gimp_value_array_length (proc_frame->return_vals) > 0)
+    {
+      item->return_vals = gimp_value_array_ref (proc_frame->return_vals);
+    }
+
+  file_open_queue_item_done (queue, item);
+}
+
+static void
+file_open_queue_closed (GimpPlugInManager *manager,
+                        GimpPlugIn        *plug_in,
+                        FileOpenQueue     *queue)
+{
+  FileOpenItem *item;
+
+  /*  the plug-in went away without returning  */
+  item = file_open_queue_find_item (queue,
+                                    plug_in->main_proc_frame.main_context);
+
+  if (item)
+    file_open_queue_item_done (queue, item);
+}
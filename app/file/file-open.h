@@ -21,61 +21,70 @@
 #define __FILE_OPEN_H__
 
 
-GimpImage * file_open_image                 (Gimp                *gimp,
-                                             GimpContext         *context,
-                                             GimpProgress        *progress,
-                                             const gchar         *uri,
-                                             const gchar         *entered_filename,
-                                             gboolean             as_new,
-                                             GimpPlugInProcedure *file_proc,
-                                             GimpRunMode          run_mode,
-                                             GimpPDBStatusType   *status,
-                                             const gchar        **mime_type,
-                                             GError             **error);
+GimpImage * file_open_image                      (Gimp                *gimp,
+                                                  GimpContext         *context,
+                                                  GimpProgress        *progress,
+                                                  const gchar         *uri,
+                                                  const gchar         *entered_filename,
+                                                  gboolean             as_new,
+                                                  GimpPlugInProcedure *file_proc,
+                                                  GimpRunMode          run_mode,
+                                                  GimpPDBStatusType   *status,
+                                                  const gchar        **mime_type,
+                                                  GError             **error);
 
-GimpImage * file_open_thumbnail             (Gimp                *gimp,
-                                             GimpContext         *context,
-                                             GimpProgress        *progress,
-                                             const gchar         *uri,
-                                             gint                 size,
-                                             const gchar        **mime_type,
-                                             gint                *image_width,
-                                             gint                *image_height,
-                                             const Babl         **format,
-                                             gint                *num_layers,
-                                             GError             **error);
-GimpImage * file_open_with_display          (Gimp                *gimp,
-                                             GimpContext         *context,
-                                             GimpProgress        *progress,
-                                             const gchar         *uri,
-                                             gboolean             as_new,
-                                             GimpPDBStatusType   *status,
-                                             GError             **error);
+GimpImage * file_open_thumbnail                  (Gimp                *gimp,
+                                                  GimpContext         *context,
+                                                  GimpProgress        *progress,
+                                                  const gchar         *uri,
+                                                  gint                 size,
+                                                  const gchar        **mime_type,
+                                                  gint                *image_width,
+                                                  gint                *image_height,
+                                                  const Babl         **format,
+                                                  gint                *num_layers,
+                                                  GError             **error);
+GimpImage * file_open_with_display               (Gimp                *gimp,
+                                                  GimpContext         *context,
+                                                  GimpProgress        *progress,
+                                                  const gchar         *uri,
+                                                  gboolean             as_new,
+                                                  GimpPDBStatusType   *status,
+                                                  GError             **error);
 
-GimpImage * file_open_with_proc_and_display (Gimp                *gimp,
-                                             GimpContext         *context,
-                                             GimpProgress        *progress,
-                                             const gchar         *uri,
-                                             const gchar         *entered_filename,
-                                             gboolean             as_new,
-                                             GimpPlugInProcedure *file_proc,
-                                             GimpPDBStatusType   *status,
-                                             GError             **error);
+GimpImage * file_open_with_proc_and_display      (Gimp                *gimp,
+                                                  GimpContext         *context,
+                                                  GimpProgress        *progress,
+                                                  const gchar         *uri,
+                                                  const gchar         *entered_filename,
+                                                  gboolean             as_new,
+                                                  GimpPlugInProcedure *file_proc,
+                                                  GimpPDBStatusType   *status,
+                                                  GError             **error);
 
-GList     * file_open_layers                (Gimp                *gimp,
-                                             GimpContext         *context,
-                                             GimpProgress        *progress,
-                                             GimpImage           *dest_image,
-                                             gboolean             merge_visible,
-                                             const gchar         *uri,
-                                             GimpRunMode          run_mode,
-                                             GimpPlugInProcedure *file_proc,
-                                             GimpPDBStatusType   *status,
-                                             GError             **error);
+GList     * file_open_layers                     (Gimp                *gimp,
+                                                  GimpContext         *context,
+                                                  GimpProgress        *progress,
+                                                  GimpImage           *dest_image,
+                                                  gboolean             merge_visible,
+                                                  const gchar         *uri,
+                                                  GimpRunMode          run_mode,
+                                                  GimpPlugInProcedure *file_proc,
+                                                  GimpPDBStatusType   *status,
+                                                  GError             **error);
 
-gboolean    file_open_from_command_line     (Gimp                *gimp,
-                                             const gchar         *filename,
-                                             gboolean             as_new);
+gint        file_open_multiple_with_display      (Gimp                *gimp,
+                                                  GimpContext         *context,
+                                                  GimpObject          *display,
+                                                  GList               *uris,
+                                                  gboolean             as_new);
+
+gboolean    file_open_from_command_line          (Gimp                *gimp,
+                                                  const gchar         *filename,
+                                                  gboolean             as_new);
+void        file_open_from_command_line_multiple (Gimp                *gimp,
+                                                  const gchar        **filenames,
+                                                  gboolean             as_new);
 
 
 #endif /* __FILE_OPEN_H__ */
@@ -59,6 +59,8 @@
 
 #include "plug-in/gimppluginprocedure.h"
 
+#include "xcf/xcf.h"
+
 #include "file-save.h"
 #include "file-utils.h"
 #include "gimp-file.h"
@@ -66,6 +68,44 @@
 #include "gimp-intl.h"
 
 
+typedef struct
+{
+  GimpImage           *image;
+  gchar               *uri;
+  GimpPlugInProcedure *file_proc;
+  FileSaveCallback     callback;
+  gpointer             callback_data;
+
+  /*  the undo steps done and undone while the image is saved  */
+  gint                 n_changes;
+  gulong               dirty_id;
+  gulong               clean_id;
+} FileSaveAsync;
+
+
+static gchar * file_save_get_filename (const gchar          *uri,
+                                       GimpPlugInProcedure  *file_proc,
+                                       GError              **error);
+static void    file_save_saved        (GimpImage            *image,
+                                       const gchar          *uri,
+                                       GimpPlugInProcedure  *file_proc,
+                                       gboolean              change_saved_state,
+                                       gboolean              export_backward,
+                                       gboolean              export_forward,
+                                       gboolean              clean);
+
+static void    file_save_async_dirty  (GimpImage            *image,
+                                       GimpDirtyMask         dirty_mask,
+                                       FileSaveAsync        *async);
+static void    file_save_async_clean  (GimpImage            *image,
+                                       GimpDirtyMask         dirty_mask,
+                                       FileSaveAsync        *async);
+static void    file_save_async_done   (GimpImage            *image,
+                                       const GError         *error,
+                                       gpointer              data);
+static void    file_save_async_free   (FileSaveAsync        *async);
+
+
 /*  public functions  */
 
 GimpPDBStatusType
@@ -104,7 +144,172 @@ file_save (Gimp                *gimp,
   if (! drawable)
     return GIMP_PDB_EXECUTION_ERROR;
 
-  filename = file_utils_filename_from_uri (uri);
+  filename = file_save_get_filename (uri, file_proc, error);
+
+  if (! filename)
+    return GIMP_PDB_EXECUTION_ERROR;
+
+  /* ref the image, so it can't get deleted during save */
+  g_object_ref (image);
+
+  image_ID    = gimp_image_get_ID (image);
+  drawable_ID = gimp_item_get_ID (GIMP_ITEM (drawable));
+
+  return_vals =
+    gimp_pdb_execute_procedure_by_name (image->gimp->pdb,
+                                        gimp_get_user_context (gimp),
+                                        progress, error,
+                                        gimp_object_get_name (file_proc),
+                                        GIMP_TYPE_INT32,       run_mode,
+                                        GIMP_TYPE_IMAGE_ID,    image_ID,
+                                        GIMP_TYPE_DRAWABLE_ID, drawable_ID,
+                                        G_TYPE_STRING,         filename,
+                                        G_TYPE_STRING,         uri,
+                                        G_TYPE_NONE);
+
+  status = g_value_get_enum (gimp_value_array_index (return_vals, 0));
+
+  gimp_value_array_unref (return_vals);
+
+  if (status == GIMP_PDB_SUCCESS)
+    {
+      file_save_saved (image, uri, file_proc,
+                       change_saved_state, export_backward, export_forward,
+                       TRUE);
+    }
+  else if (status != GIMP_PDB_CANCEL)
+    {
+      if (error && *error == NULL)
+        {
+          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                       _("%s plug-in could not save image"),
+                       gimp_plug_in_procedure_get_label (file_proc));
+        }
+    }
+
+  gimp_image_flush (image);
+
+  g_object_unref (image);
+
+  g_free (filename);
+
+  return status;
+}
+
+/**
+ * file_save_can_async:
+ * @uri:       the URI to save to
+ * @file_proc: the save procedure
+ *
+ * Return value: %TRUE if file_save_async() can save to @uri with
+ *               @file_proc, which is the case for XCF files on disk.
+ **/
+gboolean
+file_save_can_async (const gchar         *uri,
+                     GimpPlugInProcedure *file_proc)
+{
+  gchar    *filename;
+  gboolean  can_async;
+
+  g_return_val_if_fail (uri != NULL, FALSE);
+  g_return_val_if_fail (GIMP_IS_PLUG_IN_PROCEDURE (file_proc), FALSE);
+
+  if (strcmp (gimp_object_get_name (file_proc), "gimp-xcf-save") ||
+      file_proc->handles_uri)
+    return FALSE;
+
+  filename  = file_utils_filename_from_uri (uri);
+  can_async = (filename != NULL);
+
+  g_free (filename);
+
+  return can_async;
+}
+
+/**
+ * file_save_async:
+ * @gimp:      a #Gimp
+ * @image:     the image to save
+ * @progress:  the progress to show the save on, or %NULL
+ * @uri:       the URI to save to
+ * @file_proc: a procedure file_save_can_async() accepts
+ * @callback:  called when the save is done
+ * @data:      data to pass to @callback
+ * @error:     return location for an error
+ *
+ * Works like file_save() with @change_saved_state set, but writes a
+ * snapshot of @image in the background. The image stays dirty until
+ * the save is done, and stays dirty afterwards if it was edited in
+ * the meantime.
+ *
+ * Return value: %TRUE if the save was started, @callback is only
+ *               called in that case.
+ **/
+gboolean
+file_save_async (Gimp                 *gimp,
+                 GimpImage            *image,
+                 GimpProgress         *progress,
+                 const gchar          *uri,
+                 GimpPlugInProcedure  *file_proc,
+                 FileSaveCallback      callback,
+                 gpointer              data,
+                 GError              **error)
+{
+  FileSaveAsync *async;
+  gchar         *filename;
+
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), FALSE);
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), FALSE);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress),
+                        FALSE);
+  g_return_val_if_fail (file_save_can_async (uri, file_proc), FALSE);
+  g_return_val_if_fail (callback != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  filename = file_save_get_filename (uri, file_proc, error);
+
+  if (! filename)
+    return FALSE;
+
+  async = g_slice_new0 (FileSaveAsync);
+
+  async->image         = g_object_ref (image);
+  async->uri           = g_strdup (uri);
+  async->file_proc     = g_object_ref (file_proc);
+  async->callback      = callback;
+  async->callback_data = data;
+
+  async->dirty_id = g_signal_connect (image, "dirty",
+                                      G_CALLBACK (file_save_async_dirty),
+                                      async);
+  async->clean_id = g_signal_connect (image, "clean",
+                                      G_CALLBACK (file_save_async_clean),
+                                      async);
+
+  if (! xcf_save_image_async (image, filename, progress,
+                              file_save_async_done, async,
+                              error))
+    {
+      file_save_async_free (async);
+      g_free (filename);
+
+      return FALSE;
+    }
+
+  g_free (filename);
+
+  return TRUE;
+}
+
+
+/*  private functions  */
+
+static gchar *
+file_save_get_filename (const gchar          *uri,
+                        GimpPlugInProcedure  *file_proc,
+                        GError              **error)
+{
+  gchar *filename = file_utils_filename_from_uri (uri);
 
   if (filename)
     {
@@ -115,16 +320,16 @@ file_save (Gimp                *gimp,
             {
               g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
 				   _("Not a regular file"));
-              status = GIMP_PDB_EXECUTION_ERROR;
-              goto out;
+              g_free (filename);
+              return NULL;
             }
 
           if (g_access (filename, W_OK) != 0)
             {
               g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_ACCES,
                                    g_strerror (errno));
-              status = GIMP_PDB_EXECUTION_ERROR;
-              goto out;
+              g_free (filename);
+              return NULL;
             }
         }
 
@@ -139,105 +344,136 @@ file_save (Gimp                *gimp,
       filename = g_strdup (uri);
     }
 
-  /* ref the image, so it can't get deleted during save */
-  g_object_ref (image);
+  return filename;
+}
 
-  image_ID    = gimp_image_get_ID (image);
-  drawable_ID = gimp_item_get_ID (GIMP_ITEM (drawable));
+static void
+file_save_saved (GimpImage           *image,
+                 const gchar         *uri,
+                 GimpPlugInProcedure *file_proc,
+                 gboolean             change_saved_state,
+                 gboolean             export_backward,
+                 gboolean             export_forward,
+                 gboolean             clean)
+{
+  GimpDocumentList *documents;
+  GimpImagefile    *imagefile;
 
-  return_vals =
-    gimp_pdb_execute_procedure_by_name (image->gimp->pdb,
-                                        gimp_get_user_context (gimp),
-                                        progress, error,
-                                        gimp_object_get_name (file_proc),
-                                        GIMP_TYPE_INT32,       run_mode,
-                                        GIMP_TYPE_IMAGE_ID,    image_ID,
-                                        GIMP_TYPE_DRAWABLE_ID, drawable_ID,
-                                        G_TYPE_STRING,         filename,
-                                        G_TYPE_STRING,         uri,
-                                        G_TYPE_NONE);
+  if (change_saved_state)
+    {
+      gimp_image_set_uri (image, uri);
+      gimp_image_set_save_proc (image, file_proc);
 
-  status = g_value_get_enum (gimp_value_array_index (return_vals, 0));
+      /* Forget the import source when we save. We interpret a
+       * save as that the user is not interested in being able
+       * to quickly export back to the original any longer
+       */
+      gimp_image_set_imported_uri (image, NULL);
 
-  gimp_value_array_unref (return_vals);
+      if (clean)
+        gimp_image_clean_all (image);
+    }
+  else if (export_backward)
+    {
+      /* We exported the image back to its imported source,
+       * change nothing about export/import flags, only set
+       * the export state to clean
+       */
+      gimp_image_export_clean_all (image);
 
-  if (status == GIMP_PDB_SUCCESS)
+      gimp_object_name_changed (GIMP_OBJECT (image));
+    }
+  else if (export_forward)
     {
-      GimpDocumentList *documents;
-      GimpImagefile    *imagefile;
+      /* Remember the last entered Export URI for the image. We
+       * only need to do this explicitly when exporting. It
+       * happens implicitly when saving since the GimpObject name
+       * of a GimpImage is the last-save URI
+       */
+      gimp_image_set_exported_uri (image, uri);
+
+      /* An image can not be considered both exported and imported
+       * at the same time, so stop consider it as imported now
+       * that we consider it exported.
+       */
+      gimp_image_set_imported_uri (image, NULL);
+
+      gimp_image_export_clean_all (image);
+    }
 
-      if (change_saved_state)
-        {
-          gimp_image_set_uri (image, uri);
-          gimp_image_set_save_proc (image, file_proc);
+  if (export_backward || export_forward)
+    gimp_image_exported (image, uri);
+  else
+    gimp_image_saved (image, uri);
 
-          /* Forget the import source when we save. We interpret a
-           * save as that the user is not interested in being able
-           * to quickly export back to the original any longer
-           */
-          gimp_image_set_imported_uri (image, NULL);
+  documents = GIMP_DOCUMENT_LIST (image->gimp->documents);
+  imagefile = gimp_document_list_add_uri (documents,
+                                          uri,
+                                          file_proc->mime_type);
 
-          gimp_image_clean_all (image);
-        }
-      else if (export_backward)
-        {
-          /* We exported the image back to its imported source,
-           * change nothing about export/import flags, only set
-           * the export state to clean
-           */
-          gimp_image_export_clean_all (image);
+  /* only save a thumbnail if we are saving as XCF, see bug #25272 */
+  if (GIMP_PROCEDURE (file_proc)->proc_type == GIMP_INTERNAL)
+    gimp_imagefile_save_thumbnail (imagefile, file_proc->mime_type, image,
+                                   NULL);
+}
 
-          gimp_object_name_changed (GIMP_OBJECT (image));
-        }
-      else if (export_forward)
-        {
-          /* Remember the last entered Export URI for the image. We
-           * only need to do this explicitly when exporting. It
-           * happens implicitly when saving since the GimpObject name
-           * of a GimpImage is the last-save URI
-           */
-          gimp_image_set_exported_uri (image, uri);
-
-          /* An image can not be considered both exported and imported
-           * at the same time, so stop consider it as imported now
-           * that we consider it exported.
-           */
-          gimp_image_set_imported_uri (image, NULL);
-
-          gimp_image_export_clean_all (image);
-        }
+static void
+file_save_async_dirty (GimpImage     *image,
+                       GimpDirtyMask  dirty_mask,
+                       FileSaveAsync *async)
+{
+  async->n_changes++;
+}
 
-      if (export_backward || export_forward)
-        gimp_image_exported (image, uri);
-      else
-        gimp_image_saved (image, uri);
+static void
+file_save_async_clean (GimpImage     *image,
+                       GimpDirtyMask  dirty_mask,
+                       FileSaveAsync *async)
+{
+  async->n_changes--;
+}
 
-      documents = GIMP_DOCUMENT_LIST (image->gimp->documents);
-      imagefile = gimp_document_list_add_uri (documents,
-                                              uri,
-                                              file_proc->mime_type);
+static void
+file_save_async_done (GimpImage    *image,
+                      const GError *error,
+                      gpointer      data)
+{
+  FileSaveAsync *async = data;
 
-      /* only save a thumbnail if we are saving as XCF, see bug #25272 */
-      if (GIMP_PROCEDURE (file_proc)->proc_type == GIMP_INTERNAL)
-        gimp_imagefile_save_thumbnail (imagefile, file_proc->mime_type, image,
-                                       NULL);
-    }
-  else if (status != GIMP_PDB_CANCEL)
+  g_signal_handler_disconnect (image, async->dirty_id);
+  g_signal_handler_disconnect (image, async->clean_id);
+  async->dirty_id = 0;
+  async->clean_id = 0;
+
+  if (! error)
     {
-      if (error && *error == NULL)
-        {
-          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
-                       _("%s plug-in could not save image"),
-                       gimp_plug_in_procedure_get_label (file_proc));
-        }
+      /*  the file has the image as it was when the save started  */
+      file_save_saved (image, async->uri, async->file_proc,
+                       TRUE, FALSE, FALSE,
+                       async->n_changes == 0);
+
+      gimp_image_flush (image);
     }
 
-  gimp_image_flush (image);
+  async->callback (image,
+                   error ? GIMP_PDB_EXECUTION_ERROR : GIMP_PDB_SUCCESS,
+                   error, async->callback_data);
 
-  g_object_unref (image);
+  file_save_async_free (async);
+}
 
- out:
-  g_free (filename);
+static void
+file_save_async_free (FileSaveAsync *async)
+{
+  if (async->dirty_id)
+    g_signal_handler_disconnect (async->image, async->dirty_id);
 
-  return status;
+  if (async->clean_id)
+    g_signal_handler_disconnect (async->image, async->clean_id);
+
+  g_object_unref (async->image);
+  g_object_unref (async->file_proc);
+  g_free (async->uri);
+
+  g_slice_free (FileSaveAsync, async);
 }
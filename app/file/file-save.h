@@ -21,6 +21,12 @@
 #define __FILE_SAVE_H__
 
 
+typedef void (* FileSaveCallback) (GimpImage         *image,
+                                   GimpPDBStatusType  status,
+                                   const GError      *error,
+                                   gpointer           data);
+
+
 GimpPDBStatusType   file_save (Gimp                 *gimp,
                                GimpImage            *image,
                                GimpProgress         *progress,
@@ -32,5 +38,16 @@ GimpPDBStatusType   file_save (Gimp                 *gimp,
                                gboolean              export_forward,
                                GError              **error);
 
+gboolean            file_save_can_async (const gchar          *uri,
+                                         GimpPlugInProcedure  *file_proc);
+gboolean            file_save_async     (Gimp                 *gimp,
+                                         GimpImage            *image,
+                                         GimpProgress         *progress,
+                                         const gchar          *uri,
+                                         GimpPlugInProcedure  *file_proc,
+                                         FileSaveCallback      callback,
+                                         gpointer              data,
+                                         GError              **error);
+
 
 #endif /* __FILE_SAVE_H__ */
@@ -20,6 +20,8 @@
 
 #include "config.h"
 
+#include <math.h>
+
 #include <gegl.h>
 
 #include "gimp-gegl-types.h"
@@ -29,6 +31,9 @@
 #include "gimp-intl.h"
 
 
+static void   gimp_babl_init_conversions (void);
+
+
 void
 gimp_babl_init (void)
 {
@@ -217,6 +222,220 @@ gimp_babl_init (void)
                    babl_type ("double"),
                    babl_component ("A"),
                    NULL);
+
+  gimp_babl_init_conversions ();
+}
+
+
+/*  Direct conversions for the pairs GIMP uses most, which babl would
+ *  otherwise do through its double reference path: layer storage to
+ *  the linear float used for compositing, and gamma float projections
+ *  to the display.
+ *
+ *  The gamma and half decoding is done by lookup tables, computed
+ *  with the same formulas as babl's reference conversions, so babl's
+ *  error check accepts them and picks them for being faster.
+ */
+
+static gfloat gimp_babl_u8_linear[256];     /*  Y' u8 to linear float   */
+static gfloat gimp_babl_u8_float[256];      /*  u8 to float (alpha)     */
+static gfloat gimp_babl_u16_linear[65536];  /*  Y' u16 to linear float  */
+static gfloat gimp_babl_u16_float[65536];   /*  u16 to float (alpha)    */
+static gfloat gimp_babl_half_linear[65536]; /*  Y' half to linear float */
+static gfloat gimp_babl_half_float[65536];  /*  half to float (alpha)   */
+
+static inline gdouble
+gimp_babl_gamma_to_linear (gdouble value)
+{
+  if (value > 0.04045)
+    return pow ((value + 0.055) / 1.055, 2.4);
+
+  return value / 12.92;
+}
+
+static gfloat
+gimp_babl_half_to_float (guint16 half)
+{
+  guint32 sign     = (half & 0x8000) << 16;
+  guint32 exponent = (half >> 10) & 0x1f;
+  guint32 mantissa = half & 0x3ff;
+  union
+  {
+    guint32 i;
+    gfloat  f;
+  } value;
+
+  if (exponent == 0)
+    {
+      if (mantissa == 0)
+        {
+          value.i = sign;
+        }
+      else
+        {
+          /*  denormal, normalize it  */
+          exponent = 127 - 15 + 1;
+
+          while (! (mantissa & 0x400))
+            {
+              mantissa <<= 1;
+              exponent--;
+            }
+
+          value.i = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+        }
+    }
+  else if (exponent == 0x1f)
+    {
+      /*  inf or nan  */
+      value.i = sign | 0x7f800000 | (mantissa << 13);
+    }
+  else
+    {
+      value.i = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+
+  return value.f;
+}
+
+#define GIMP_BABL_TO_RGBA_FLOAT(name, type, n_components, gamma_lut, alpha_lut) \
+static long                                                              \
+name (char *src,                                                         \
+      char *dest,                                                        \
+      long  n)                                                           \
+{                                                                        \
+  const type *s = (const type *) src;                                    \
+  gfloat     *d = (gfloat *) dest;                                       \
+  long        i;                                                         \
+                                                                         \
+  for (i = 0; i < n; i++)                                                \
+    {                                                                    \
+      d[0] = gamma_lut[s[0]];                                            \
+      d[1] = gamma_lut[s[1]];                                            \
+      d[2] = gamma_lut[s[2]];                                            \
+      d[3] = (n_components == 4) ? alpha_lut[s[3]] : 1.0f;               \
+                                                                         \
+      s += n_components;                                                 \
+      d += 4;                                                            \
+    }                                                                    \
+                                                                         \
+  return n;                                                              \
+}
+
+GIMP_BABL_TO_RGBA_FLOAT (gimp_babl_rgba_u8_to_rgba_float,
+                         guint8,  4, gimp_babl_u8_linear,   gimp_babl_u8_float)
+GIMP_BABL_TO_RGBA_FLOAT (gimp_babl_rgb_u8_to_rgba_float,
+                         guint8,  3, gimp_babl_u8_linear,   gimp_babl_u8_float)
+GIMP_BABL_TO_RGBA_FLOAT (gimp_babl_rgba_u16_to_rgba_float,
+                         guint16, 4, gimp_babl_u16_linear,  gimp_babl_u16_float)
+GIMP_BABL_TO_RGBA_FLOAT (gimp_babl_rgb_u16_to_rgba_float,
+                         guint16, 3, gimp_babl_u16_linear,  gimp_babl_u16_float)
+GIMP_BABL_TO_RGBA_FLOAT (gimp_babl_rgba_half_to_rgba_float,
+                         guint16, 4, gimp_babl_half_linear, gimp_babl_half_float)
+GIMP_BABL_TO_RGBA_FLOAT (gimp_babl_rgb_half_to_rgba_float,
+                         guint16, 3, gimp_babl_half_linear, gimp_babl_half_float)
+
+#undef GIMP_BABL_TO_RGBA_FLOAT
+
+static long
+gimp_babl_y_u8_to_rgba_float (char *src,
+                              char *dest,
+                              long  n)
+{
+  const guint8 *s = (const guint8 *) src;
+  gfloat       *d = (gfloat *) dest;
+  long          i;
+
+  for (i = 0; i < n; i++)
+    {
+      d[0] = d[1] = d[2] = gimp_babl_u8_linear[*s++];
+      d[3] = 1.0f;
+
+      d += 4;
+    }
+
+  return n;
+}
+
+static inline guint8
+gimp_babl_float_to_u8 (gfloat value)
+{
+  return (guint8) (CLAMP (value, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+static long
+gimp_babl_rgba_gamma_float_to_cairo (char *src,
+                                     char *dest,
+                                     long  n)
+{
+  const gfloat *s = (const gfloat *) src;
+  guint8       *d = (guint8 *) dest;
+  long          i;
+
+  for (i = 0; i < n; i++)
+    {
+      gfloat alpha = s[3];
+
+      /*  cairo-ARGB32 is premultiplied, native endian  */
+#if G_BYTE_ORDER == G_LITTLE_ENDIAN
+      d[0] = gimp_babl_float_to_u8 (s[2] * alpha);
+      d[1] = gimp_babl_float_to_u8 (s[1] * alpha);
+      d[2] = gimp_babl_float_to_u8 (s[0] * alpha);
+      d[3] = gimp_babl_float_to_u8 (alpha);
+#else
+      d[0] = gimp_babl_float_to_u8 (alpha);
+      d[1] = gimp_babl_float_to_u8 (s[0] * alpha);
+      d[2] = gimp_babl_float_to_u8 (s[1] * alpha);
+      d[3] = gimp_babl_float_to_u8 (s[2] * alpha);
+#endif
+
+      s += 4;
+      d += 4;
+    }
+
+  return n;
+}
+
+static void
+gimp_babl_init_conversions (void)
+{
+  const Babl *rgba_float = babl_format ("RGBA float");
+  gint        i;
+
+  for (i = 0; i < 256; i++)
+    {
+      gimp_babl_u8_float[i]  = i / 255.0;
+      gimp_babl_u8_linear[i] = gimp_babl_gamma_to_linear (i / 255.0);
+    }
+
+  for (i = 0; i < 65536; i++)
+    {
+      gdouble half = gimp_babl_half_to_float (i);
+
+      gimp_babl_u16_float[i]   = i / 65535.0;
+      gimp_babl_u16_linear[i]  = gimp_babl_gamma_to_linear (i / 65535.0);
+      gimp_babl_half_float[i]  = half;
+      gimp_babl_half_linear[i] = gimp_babl_gamma_to_linear (half);
+    }
+
+  babl_conversion_new (babl_format ("R'G'B'A u8"), rgba_float, "linear",
+                       gimp_babl_rgba_u8_to_rgba_float, NULL);
+  babl_conversion_new (babl_format ("R'G'B' u8"), rgba_float, "linear",
+                       gimp_babl_rgb_u8_to_rgba_float, NULL);
+  babl_conversion_new (babl_format ("R'G'B'A u16"), rgba_float, "linear",
+                       gimp_babl_rgba_u16_to_rgba_float, NULL);
+  babl_conversion_new (babl_format ("R'G'B' u16"), rgba_float, "linear",
+                       gimp_babl_rgb_u16_to_rgba_float, NULL);
+  babl_conversion_new (babl_format ("R'G'B'A half"), rgba_float, "linear",
+                       gimp_babl_rgba_half_to_rgba_float, NULL);
+  babl_conversion_new (babl_format ("R'G'B' half"), rgba_float, "linear",
+                       gimp_babl_rgb_half_to_rgba_float, NULL);
+  babl_conversion_new (babl_format ("Y' u8"), rgba_float, "linear",
+                       gimp_babl_y_u8_to_rgba_float, NULL);
+
+  babl_conversion_new (babl_format ("R'G'B'A float"),
+                       babl_format ("cairo-ARGB32"), "linear",
+                       gimp_babl_rgba_gamma_float_to_cairo, NULL);
 }
 
 static const struct
@@ -22,18 +22,96 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <gegl.h>
 
+#include "libgimpmath/gimpmath.h"
+
 #include "gimp-gegl-types.h"
 
+#include "core/gimp-parallel.h"
 #include "core/gimp-utils.h"
 #include "core/gimpprogress.h"
 
+#include "gimp-babl.h"
 #include "gimp-gegl-apply-operation.h"
+#include "gimp-gegl-loops.h"
+#include "gimp-gegl-mask.h"
 #include "gimp-gegl-nodes.h"
 #include "gegl/gimp-gegl-utils.h"
 
 
+/*  gimp_gegl_apply_feather() approximates the gaussian with this many
+ *  box blurs, and reads and writes stripes of this many lines at a time
+ */
+#define FEATHER_N_BOXES    3
+#define FEATHER_BLOCK_SIZE 64
+
+
+typedef GeglNode * (* GimpGeglApplyStripsNodeFunc) (GeglNode *parent,
+                                                     gpointer  user_data);
+
+typedef struct
+{
+  GeglBuffer                  *src_buffer;
+  GeglBuffer                  *dest_buffer;
+  GimpGeglApplyStripsNodeFunc  new_node;
+  gpointer                     user_data;
+  GeglRectangle                strip;
+  gint                         tile_height;
+} GimpGeglApplyStripsData;
+
+typedef struct
+{
+  GeglBuffer    *src_buffer;
+  GeglBuffer    *dest_buffer;
+  GeglRectangle  rect;
+  gboolean       vertical;
+  gint           radii[FEATHER_N_BOXES];
+  gint           support;
+  gint           first;
+  gboolean       cancelled;
+} GimpGeglApplyFeatherData;
+
+typedef struct
+{
+  GimpInterpolationType  interpolation_type;
+  gdouble                x;
+  gdouble                y;
+} GimpGeglApplyScaleData;
+
+typedef struct
+{
+  GimpInterpolationType  interpolation_type;
+  GimpMatrix3           *transform;
+} GimpGeglApplyTransformData;
+
+
+static gint      gimp_gegl_apply_feather_boxes  (gdouble                   std_dev,
+                                                 gint                     *radii);
+static void      gimp_gegl_apply_feather_line   (gfloat                   *line,
+                                                 gfloat                   *temp,
+                                                 gint                      length,
+                                                 const gint               *radii);
+static void      gimp_gegl_apply_feather_lines  (gsize                     offset,
+                                                 gsize                     size,
+                                                 GimpGeglApplyFeatherData *data);
+static gboolean  gimp_gegl_apply_feather_pass   (GimpGeglApplyFeatherData *data,
+                                                 GimpProgress             *progress,
+                                                 gint                      done,
+                                                 gint                      total);
+static void      gimp_gegl_apply_feather_cancel (GimpProgress             *progress,
+                                                 GimpGeglApplyFeatherData *data);
+
+static void   gimp_gegl_apply_strips     (GeglBuffer                  *src_buffer,
+                                          GimpProgress                *progress,
+                                          const gchar                 *undo_desc,
+                                          GeglBuffer                  *dest_buffer,
+                                          GimpGeglApplyStripsNodeFunc  new_node,
+                                          gpointer                     user_data);
+
+
 void
 gimp_gegl_apply_operation (GeglBuffer          *src_buffer,
                            GimpProgress        *progress,
@@ -184,7 +262,14 @@ gimp_gegl_apply_flatten (GeglBuffer    *src_buffer,
   g_object_unref (node);
 }
 
-void
+/*  Feathers the mask in @src_buffer into @dest_buffer with a cascade
+ *  of box blurs, a row and a column pass in parallel.  Only the mask's
+ *  bounds, grown by the blur's reach, are blurred; everything outside
+ *  them stays unselected.  The passes write into a buffer of their
+ *  own, so @dest_buffer may be @src_buffer, and it is only changed
+ *  when @progress wasn't cancelled.  Returns FALSE if it was.
+ */
+gboolean
 gimp_gegl_apply_feather (GeglBuffer   *src_buffer,
                          GimpProgress *progress,
                          const gchar  *undo_desc,
@@ -192,18 +277,110 @@ gimp_gegl_apply_feather (GeglBuffer   *src_buffer,
                          gdouble       radius_x,
                          gdouble       radius_y)
 {
-  g_return_if_fail (GEGL_IS_BUFFER (src_buffer));
-  g_return_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress));
-  g_return_if_fail (GEGL_IS_BUFFER (dest_buffer));
+  GimpGeglApplyFeatherData  data;
+  const GeglRectangle      *extent;
+  GeglBuffer               *temp_buffer;
+  gint                      radii_x[FEATHER_N_BOXES];
+  gint                      radii_y[FEATHER_N_BOXES];
+  gint                      support_x;
+  gint                      support_y;
+  gint                      x1, y1, x2, y2;
+  gboolean                  progress_active = FALSE;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (src_buffer), FALSE);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress), FALSE);
+  g_return_val_if_fail (GEGL_IS_BUFFER (dest_buffer), FALSE);
 
   /* 3.5 is completely magic and picked to visually match the old
    * gaussian_blur_region() on a crappy laptop display
    */
-  gimp_gegl_apply_gaussian_blur (src_buffer,
-                                 progress, undo_desc,
-                                 dest_buffer,
-                                 radius_x / 3.5,
-                                 radius_y / 3.5);
+  support_x = gimp_gegl_apply_feather_boxes (radius_x / 3.5, radii_x);
+  support_y = gimp_gegl_apply_feather_boxes (radius_y / 3.5, radii_y);
+
+  extent = gegl_buffer_get_extent (src_buffer);
+
+  if ((support_x == 0 && support_y == 0) ||
+      ! gimp_gegl_mask_bounds (src_buffer, &x1, &y1, &x2, &y2))
+    {
+      if (dest_buffer != src_buffer)
+        gimp_gegl_copy (src_buffer, NULL, dest_buffer, NULL);
+
+      return TRUE;
+    }
+
+  gegl_rectangle_set (&data.rect,
+                      x1 - support_x, y1 - support_y,
+                      x2 - x1 + 2 * support_x, y2 - y1 + 2 * support_y);
+  gegl_rectangle_intersect (&data.rect, &data.rect, extent);
+
+  /*  the passes read their source clamped to its extent, which is
+   *  right for the mask, and for the temp buffer as long as its edges
+   *  are the mask's, or unselected rows
+   */
+  temp_buffer = gegl_buffer_new (&data.rect, babl_format ("Y float"));
+
+  data.cancelled = FALSE;
+
+  if (progress)
+    {
+      progress_active = gimp_progress_is_active (progress);
+
+      if (progress_active)
+        {
+          if (undo_desc)
+            gimp_progress_set_text (progress, undo_desc);
+        }
+      else
+        {
+          gimp_progress_start (progress, undo_desc, TRUE);
+        }
+
+      g_signal_connect (progress, "cancel",
+                        G_CALLBACK (gimp_gegl_apply_feather_cancel),
+                        &data);
+    }
+
+  data.src_buffer  = src_buffer;
+  data.dest_buffer = temp_buffer;
+  data.vertical    = FALSE;
+  data.support     = support_x;
+  memcpy (data.radii, radii_x, sizeof (data.radii));
+
+  if (gimp_gegl_apply_feather_pass (&data, progress,
+                                    0, data.rect.height + data.rect.width))
+    {
+      data.src_buffer  = temp_buffer;
+      data.dest_buffer = temp_buffer;
+      data.vertical    = TRUE;
+      data.support     = support_y;
+      memcpy (data.radii, radii_y, sizeof (data.radii));
+
+      gimp_gegl_apply_feather_pass (&data, progress,
+                                    data.rect.height,
+                                    data.rect.height + data.rect.width);
+    }
+
+  if (progress)
+    {
+      g_signal_handlers_disconnect_by_func (progress,
+                                            gimp_gegl_apply_feather_cancel,
+                                            &data);
+
+      if (! progress_active)
+        gimp_progress_end (progress);
+    }
+
+  if (! data.cancelled)
+    {
+      if (dest_buffer != src_buffer)
+        gegl_buffer_clear (dest_buffer, NULL);
+
+      gimp_gegl_copy (temp_buffer, NULL, dest_buffer, &data.rect);
+    }
+
+  g_object_unref (temp_buffer);
+
+  return ! data.cancelled;
 }
 
 void
@@ -300,6 +477,24 @@ gimp_gegl_apply_opacity (GeglBuffer    *src_buffer,
   g_object_unref (node);
 }
 
+static GeglNode *
+gimp_gegl_apply_scale_new_node (GeglNode               *parent,
+                                GimpGeglApplyScaleData *data)
+{
+  return gegl_node_new_child (parent,
+                              "operation", "gegl:scale-ratio",
+                              "origin-x",  0.0,
+                              "origin-y",  0.0,
+                              "sampler",   data->interpolation_type,
+                              "x",         data->x,
+                              "y",         data->y,
+                              NULL);
+}
+
+/*  Scales in strips, see gimp_gegl_apply_strips().  Reductions by
+ *  more than 2 first halve the source with box filters, which is
+ *  faster and aliases less than sampling it directly.
+ */
 void
 gimp_gegl_apply_scale (GeglBuffer            *src_buffer,
                        GimpProgress          *progress,
@@ -309,24 +504,60 @@ gimp_gegl_apply_scale (GeglBuffer            *src_buffer,
                        gdouble                x,
                        gdouble                y)
 {
-  GeglNode *node;
+  GimpGeglApplyScaleData  data;
+  GeglBuffer             *reduced_buffer = NULL;
 
   g_return_if_fail (GEGL_IS_BUFFER (src_buffer));
   g_return_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress));
   g_return_if_fail (GEGL_IS_BUFFER (dest_buffer));
 
-  node = gegl_node_new_child (NULL,
-                              "operation", "gegl:scale-ratio",
-                              "origin-x",   0.0,
-                              "origin-y",   0.0,
-                              "sampler",    interpolation_type,
-                              "x",          x,
-                              "y",          y,
-                              NULL);
+  if (interpolation_type != GIMP_INTERPOLATION_NONE)
+    {
+      while (x <= 0.5 && y <= 0.5)
+        {
+          const Babl *format = gegl_buffer_get_format (src_buffer);
+          gint        width  = gegl_buffer_get_width  (src_buffer);
+          gint        height = gegl_buffer_get_height (src_buffer);
+          GeglBuffer *half_buffer;
+
+          /*  average premultiplied when there is alpha, and in float
+           *  for half, which the box filter doesn't support
+           */
+          if (babl_format_has_alpha (format) ||
+              gimp_babl_format_get_component_type (format) ==
+              GIMP_COMPONENT_TYPE_HALF)
+            {
+              format = babl_format ("RaGaBaA float");
+            }
+
+          half_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                                         (width  + 1) / 2,
+                                                         (height + 1) / 2),
+                                         format);
+
+          gimp_gegl_downscale_2x_buffer (src_buffer, half_buffer);
+
+          if (reduced_buffer)
+            g_object_unref (reduced_buffer);
+
+          src_buffer = reduced_buffer = half_buffer;
+
+          x *= 2.0;
+          y *= 2.0;
+        }
+    }
 
-  gimp_gegl_apply_operation (src_buffer, progress, undo_desc,
-                             node, dest_buffer, NULL);
-  g_object_unref (node);
+  data.interpolation_type = interpolation_type;
+  data.x                  = x;
+  data.y                  = y;
+
+  gimp_gegl_apply_strips (src_buffer, progress, undo_desc, dest_buffer,
+                          (GimpGeglApplyStripsNodeFunc)
+                          gimp_gegl_apply_scale_new_node,
+                          &data);
+
+  if (reduced_buffer)
+    g_object_unref (reduced_buffer);
 }
 
 void
@@ -375,6 +606,23 @@ gimp_gegl_apply_threshold (GeglBuffer    *src_buffer,
   g_object_unref (node);
 }
 
+static GeglNode *
+gimp_gegl_apply_transform_new_node (GeglNode                   *parent,
+                                    GimpGeglApplyTransformData *data)
+{
+  GeglNode *node;
+
+  node = gegl_node_new_child (parent,
+                              "operation", "gegl:transform",
+                              "sampler",   data->interpolation_type,
+                              NULL);
+
+  gimp_gegl_node_set_matrix (node, data->transform);
+
+  return node;
+}
+
+/*  Transforms in strips, see gimp_gegl_apply_strips()  */
 void
 gimp_gegl_apply_transform (GeglBuffer            *src_buffer,
                            GimpProgress          *progress,
@@ -383,20 +631,367 @@ gimp_gegl_apply_transform (GeglBuffer            *src_buffer,
                            GimpInterpolationType  interpolation_type,
                            GimpMatrix3           *transform)
 {
-  GeglNode *node;
+  GimpGeglApplyTransformData data;
 
   g_return_if_fail (GEGL_IS_BUFFER (src_buffer));
   g_return_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress));
   g_return_if_fail (GEGL_IS_BUFFER (dest_buffer));
+  g_return_if_fail (transform != NULL);
 
-  node = gegl_node_new_child (NULL,
-                              "operation", "gegl:transform",
-                              "sampler",   interpolation_type,
-                              NULL);
+  data.interpolation_type = interpolation_type;
+  data.transform          = transform;
 
-  gimp_gegl_node_set_matrix (node, transform);
+  gimp_gegl_apply_strips (src_buffer, progress, undo_desc, dest_buffer,
+                          (GimpGeglApplyStripsNodeFunc)
+                          gimp_gegl_apply_transform_new_node,
+                          &data);
+}
 
-  gimp_gegl_apply_operation (src_buffer, progress, undo_desc,
-                             node, dest_buffer, NULL);
-  g_object_unref (node);
+
+/*  private functions  */
+
+/*  renders the tile rows @i of @n of the current strip, with a graph
+ *  of its own, so the threads don't share any nodes or dest tiles
+ */
+static void
+gimp_gegl_apply_strips_rows (gint                     i,
+                             gint                     n,
+                             GimpGeglApplyStripsData *data)
+{
+  GeglNode      *gegl;
+  GeglNode      *src_node;
+  GeglNode      *op_node;
+  GeglNode      *dest_node;
+  GeglRectangle  rows = data->strip;
+  gint           n_tile_rows;
+  gint           first;
+  gint           last;
+
+  n_tile_rows = (data->strip.height + data->tile_height - 1) / data->tile_height;
+
+  first = n_tile_rows * i       / n;
+  last  = n_tile_rows * (i + 1) / n;
+
+  rows.y     += first * data->tile_height;
+  rows.height = MIN (last * data->tile_height, data->strip.height) -
+                first * data->tile_height;
+
+  if (rows.height <= 0)
+    return;
+
+  gegl = gegl_node_new ();
+
+  src_node = gegl_node_new_child (gegl,
+                                  "operation", "gegl:buffer-source",
+                                  "buffer",    data->src_buffer,
+                                  NULL);
+
+  op_node = data->new_node (gegl, data->user_data);
+
+  dest_node = gegl_node_new_child (gegl,
+                                   "operation", "gegl:write-buffer",
+                                   "buffer",    data->dest_buffer,
+                                   NULL);
+
+  gegl_node_link_many (src_node, op_node, dest_node, NULL);
+
+  gegl_node_blit (dest_node, 1.0, &rows,
+                  NULL, NULL, 0, GEGL_BLIT_DEFAULT);
+
+  g_object_unref (gegl);
+}
+
+/*  Renders @dest_buffer in strips of one tile row per thread, each
+ *  thread with the node returned by @new_node.  The strips are done
+ *  one after the other so the progress can be updated in between.
+ */
+static void
+gimp_gegl_apply_strips (GeglBuffer                  *src_buffer,
+                        GimpProgress                *progress,
+                        const gchar                 *undo_desc,
+                        GeglBuffer                  *dest_buffer,
+                        GimpGeglApplyStripsNodeFunc  new_node,
+                        gpointer                     user_data)
+{
+  GimpGeglApplyStripsData data;
+  GeglRectangle           rect;
+  gint                    n_threads;
+  gboolean                progress_active = FALSE;
+
+  rect = *GEGL_RECTANGLE (0, 0, gegl_buffer_get_width  (dest_buffer),
+                                gegl_buffer_get_height (dest_buffer));
+
+  if (rect.width <= 0 || rect.height <= 0)
+    return;
+
+  data.src_buffer  = src_buffer;
+  data.dest_buffer = dest_buffer;
+  data.new_node    = new_node;
+  data.user_data   = user_data;
+  data.strip       = rect;
+
+  g_object_get (dest_buffer,
+                "tile-height", &data.tile_height,
+                NULL);
+
+  n_threads = gimp_parallel_get_n_threads ();
+
+  if (progress)
+    {
+      progress_active = gimp_progress_is_active (progress);
+
+      if (progress_active)
+        {
+          if (undo_desc)
+            gimp_progress_set_text (progress, undo_desc);
+        }
+      else
+        {
+          gimp_progress_start (progress, undo_desc, FALSE);
+        }
+    }
+
+  while (data.strip.y < rect.y + rect.height)
+    {
+      data.strip.height = MIN (data.tile_height * n_threads,
+                               rect.y + rect.height - data.strip.y);
+
+      gimp_parallel_distribute (n_threads,
+                                (GimpParallelDistributeFunc)
+                                gimp_gegl_apply_strips_rows,
+                                &data);
+
+      data.strip.y += data.strip.height;
+
+      if (progress)
+        gimp_progress_set_value (progress,
+                                 (gdouble) (data.strip.y - rect.y) /
+                                 (gdouble) rect.height);
+    }
+
+  if (progress && ! progress_active)
+    gimp_progress_end (progress);
+}
+
+/*  Picks the radii of FEATHER_N_BOXES box blurs that together come
+ *  closest to a gaussian of @std_dev, after Kovesi's "Fast Almost-
+ *  Gaussian Filtering".  Returns their sum, the reach of the blur.
+ */
+static gint
+gimp_gegl_apply_feather_boxes (gdouble  std_dev,
+                               gint    *radii)
+{
+  gdouble variance = 12.0 * SQR (std_dev);
+  gint    lower;
+  gint    m;
+  gint    support  = 0;
+  gint    i;
+
+  lower = floor (sqrt (variance / FEATHER_N_BOXES + 1.0));
+
+  if (lower % 2 == 0)
+    lower--;
+
+  m = RINT ((variance -
+             FEATHER_N_BOXES * lower * lower -
+             4 * FEATHER_N_BOXES * lower -
+             3 * FEATHER_N_BOXES) /
+            (-4.0 * lower - 4.0));
+  m = CLAMP (m, 0, FEATHER_N_BOXES);
+
+  for (i = 0; i < FEATHER_N_BOXES; i++)
+    {
+      radii[i] = ((i < m ? lower : lower + 2) - 1) / 2;
+      support += radii[i];
+    }
+
+  return support;
+}
+
+/*  Blurs @line with the boxes of @radii, in place.  Each box leaves
+ *  its radius at both ends invalid, so of the @length values only
+ *  those after the first and before the last support are meaningful.
+ */
+static void
+gimp_gegl_apply_feather_line (gfloat     *line,
+                              gfloat     *temp,
+                              gint        length,
+                              const gint *radii)
+{
+  gfloat min = line[0];
+  gfloat max = line[0];
+  gint   start;
+  gint   end;
+  gint   i;
+
+  for (i = 1; i < length; i++)
+    {
+      min = MIN (min, line[i]);
+      max = MAX (max, line[i]);
+    }
+
+  /*  lines within or outside the selection don't change  */
+  if (min == max)
+    return;
+
+  start = 0;
+  end   = length;
+
+  for (i = 0; i < FEATHER_N_BOXES; i++)
+    {
+      gint    radius = radii[i];
+      gdouble scale  = 1.0 / (2 * radius + 1);
+      gdouble sum    = 0.0;
+      gint    x;
+
+      if (radius == 0)
+        continue;
+
+      for (x = start; x < start + 2 * radius; x++)
+        sum += line[x];
+
+      start += radius;
+      end   -= radius;
+
+      for (x = start; x < end; x++)
+        {
+          sum += line[x + radius];
+
+          temp[x] = sum * scale;
+
+          sum -= line[x - radius];
+        }
+
+      memcpy (line + start, temp + start, (end - start) * sizeof (gfloat));
+    }
+}
+
+/*  blurs the lines @offset to @offset + @size of the current batch,
+ *  in stripes of FEATHER_BLOCK_SIZE rows or columns
+ */
+static void
+gimp_gegl_apply_feather_lines (gsize                     offset,
+                               gsize                     size,
+                               GimpGeglApplyFeatherData *data)
+{
+  const GeglRectangle *rect    = &data->rect;
+  gint                 support = data->support;
+  gint                 length;
+  gfloat              *buf;
+  gfloat              *line;
+  gfloat              *temp;
+  gint                 end     = data->first + offset + size;
+  gint                 i;
+
+  length = (data->vertical ? rect->height : rect->width) + 2 * support;
+
+  buf  = g_new (gfloat, FEATHER_BLOCK_SIZE * length);
+  line = g_new (gfloat, length);
+  temp = g_new (gfloat, length);
+
+  for (i = data->first + offset; i < end; i += FEATHER_BLOCK_SIZE)
+    {
+      gint          n = MIN (FEATHER_BLOCK_SIZE, end - i);
+      GeglRectangle src_block;
+      GeglRectangle dest_block;
+      gint          j, k;
+
+      if (data->vertical)
+        {
+          gegl_rectangle_set (&src_block,
+                              rect->x + i, rect->y - support,
+                              n, length);
+          gegl_rectangle_set (&dest_block,
+                              rect->x + i, rect->y,
+                              n, rect->height);
+        }
+      else
+        {
+          gegl_rectangle_set (&src_block,
+                              rect->x - support, rect->y + i,
+                              length, n);
+          gegl_rectangle_set (&dest_block,
+                              rect->x, rect->y + i,
+                              rect->width, n);
+        }
+
+      gegl_buffer_get (data->src_buffer, &src_block, 1.0,
+                       babl_format ("Y float"), buf,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
+
+      if (data->vertical)
+        {
+          for (j = 0; j < n; j++)
+            {
+              for (k = 0; k < length; k++)
+                line[k] = buf[k * n + j];
+
+              gimp_gegl_apply_feather_line (line, temp, length, data->radii);
+
+              for (k = support; k < length - support; k++)
+                buf[k * n + j] = line[k];
+            }
+
+          gegl_buffer_set (data->dest_buffer, &dest_block, 0,
+                           babl_format ("Y float"), buf + support * n,
+                           n * sizeof (gfloat));
+        }
+      else
+        {
+          for (j = 0; j < n; j++)
+            gimp_gegl_apply_feather_line (buf + j * length, temp, length,
+                                          data->radii);
+
+          gegl_buffer_set (data->dest_buffer, &dest_block, 0,
+                           babl_format ("Y float"), buf + support,
+                           length * sizeof (gfloat));
+        }
+    }
+
+  g_free (buf);
+  g_free (line);
+  g_free (temp);
+}
+
+/*  Runs one pass in batches of a stripe per thread.  The progress is
+ *  updated between the batches, and the pass stops when it gets
+ *  cancelled.  Returns FALSE if it was.
+ */
+static gboolean
+gimp_gegl_apply_feather_pass (GimpGeglApplyFeatherData *data,
+                              GimpProgress             *progress,
+                              gint                      done,
+                              gint                      total)
+{
+  gint n_lines;
+  gint batch;
+
+  n_lines = data->vertical ? data->rect.width : data->rect.height;
+  batch   = FEATHER_BLOCK_SIZE * gimp_parallel_get_n_threads ();
+
+  for (data->first = 0;
+       data->first < n_lines && ! data->cancelled;
+       data->first += batch)
+    {
+      gimp_parallel_distribute_range (MIN (batch, n_lines - data->first),
+                                      FEATHER_BLOCK_SIZE,
+                                      (GimpParallelDistributeRangeFunc)
+                                      gimp_gegl_apply_feather_lines,
+                                      data);
+
+      if (progress)
+        gimp_progress_set_value (progress,
+                                 (gdouble) (done + MIN (data->first + batch,
+                                                        n_lines)) /
+                                 (gdouble) total);
+    }
+
+  return ! data->cancelled;
+}
+
+static void
+gimp_gegl_apply_feather_cancel (GimpProgress             *progress,
+                                GimpGeglApplyFeatherData *data)
+{
+  data->cancelled = TRUE;
 }
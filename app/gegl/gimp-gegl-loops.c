@@ -20,213 +20,1189 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <gegl.h>
 
 #include "libgimpmath/gimpmath.h"
 
 #include "gimp-gegl-types.h"
 
+#include "core/gimp-parallel.h"
+
 #include "gimp-babl.h"
 #include "gimp-gegl-loops.h"
 
 
-void
-gimp_gegl_convolve (GeglBuffer          *src_buffer,
-                    const GeglRectangle *src_rect,
-                    GeglBuffer          *dest_buffer,
-                    const GeglRectangle *dest_rect,
-                    const gfloat        *kernel,
-                    gint                 kernel_size,
-                    gdouble              divisor,
-                    GimpConvolutionType  mode,
-                    gboolean             alpha_weighting)
+/*  areas smaller than this are not worth spreading over threads  */
+#define GIMP_GEGL_LOOPS_MIN_SUB_AREA (64 * 64)
+
+/*  gimp_gegl_downscale_2x_buffer() works on blocks of this size  */
+#define DOWNSCALE_BLOCK_SIZE 128
+
+/*  gimp_gegl_distance_transform() works on stripes of this many
+ *  columns or rows, and uses this as the distance of unreachable pixels
+ */
+#define DISTANCE_BLOCK_SIZE  64
+#define DISTANCE_INFINITY    1e20
+
+/*  gimp_gegl_binary_morphology() gives each thread at least this many
+ *  rows, or twice the vertical radius
+ */
+#define MORPHOLOGY_MIN_ROWS  64
+
+
+typedef void (* GimpGeglLoopsFunc) (const GeglRectangle *area,
+                                    gpointer             user_data);
+
+typedef struct
 {
-  GeglBufferIterator *iter;
-  GeglRectangle      *src_roi;
-  GeglRectangle      *dest_roi;
-  const Babl         *src_format;
-  const Babl         *dest_format;
-  gint                src_components;
-  gint                dest_components;
+  GimpGeglLoopsFunc    func;
+  gpointer             user_data;
+  GeglRectangle        area;
+  gint                 shift_x;
+  gint                 shift_y;
+  gboolean             vertical;
+  gint                 tile_size;
+  gint                 first_tile;
+  gint                 n_tiles;
+} GimpGeglLoopsDistributeData;
+
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  const GeglRectangle *src_rect;
+  GeglBuffer          *dest_buffer;
+  const GeglRectangle *dest_rect;
+} GimpGeglCopyData;
 
-  src_format = gegl_buffer_get_format (src_buffer);
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  GeglBuffer          *temp_buffer;
+  GeglBuffer          *dest_buffer;
+  const GeglRectangle *rect;
+  GMutex               mutex;
+  gfloat               max;
+} GimpGeglDistanceData;
+
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  GeglBuffer          *dest_buffer;
+  const GeglRectangle *rect;
+  gint                 radius_x;
+  gint                 radius_y;
+  gboolean             erode;
+  gboolean             outside_seed;
+  gint                *reach;
+  gint                 tile_height;
+  gint                 tile_shift;
+  volatile gint        binary;
+} GimpGeglBinaryMorphologyData;
+
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  const GeglRectangle *src_rect;
+  GeglBuffer          *dest_buffer;
+  const GeglRectangle *dest_rect;
+  const Babl          *src_format;
+  const Babl          *dest_format;
+  const gfloat        *kernel;
+  gint                 kernel_size;
+  gdouble              divisor;
+  GimpConvolutionType  mode;
+  gfloat               offset;
+  gboolean             alpha_weighting;
+} GimpGeglConvolveData;
+
+typedef struct
+{
+  GeglBuffer          *src_buffer;
+  const GeglRectangle *src_rect;
+  GeglBuffer          *dest_buffer;
+  const GeglRectangle *dest_rect;
+  gdouble              exposure;
+  GimpTransferMode     mode;
+} GimpGeglDodgeBurnData;
+
+typedef struct
+{
+  GeglBuffer          *top_buffer;
+  const GeglRectangle *top_rect;
+  GeglBuffer          *bottom_buffer;
+  const GeglRectangle *bottom_rect;
+  GeglBuffer          *mask_buffer;
+  const GeglRectangle *mask_rect;
+  GeglBuffer          *dest_buffer;
+  const GeglRectangle *dest_rect;
+  GeglBuffer          *copy_buffer;
+  const GeglRectangle *copy_rect;
+  gdouble              blend;
+  gdouble              opacity;
+  gboolean             stipple;
+  const gboolean      *affect;
+} GimpGeglLoopsData;
+
+
+static void
+gimp_gegl_loops_distribute_func (gint                         i,
+                                 gint                         n,
+                                 GimpGeglLoopsDistributeData *data)
+{
+  GeglRectangle chunk = data->area;
+  gint          first = data->first_tile + data->n_tiles * i       / n;
+  gint          last  = data->first_tile + data->n_tiles * (i + 1) / n;
 
-  if (babl_format_is_palette (src_format))
-    src_format = gimp_babl_format (GIMP_RGB,
-                                   GIMP_PRECISION_FLOAT_LINEAR,
-                                   babl_format_has_alpha (src_format));
+  if (data->vertical)
+    {
+      chunk.y      = MAX (first * data->tile_size, data->area.y);
+      chunk.height = MIN (last  * data->tile_size,
+                          data->area.y + data->area.height) - chunk.y;
+
+      if (chunk.height <= 0)
+        return;
+    }
   else
-    src_format = gimp_babl_format (gimp_babl_format_get_base_type (src_format),
-                                   GIMP_PRECISION_FLOAT_LINEAR,
-                                   babl_format_has_alpha (src_format));
+    {
+      chunk.x     = MAX (first * data->tile_size, data->area.x);
+      chunk.width = MIN (last  * data->tile_size,
+                         data->area.x + data->area.width) - chunk.x;
 
-  dest_format = gegl_buffer_get_format (dest_buffer);
+      if (chunk.width <= 0)
+        return;
+    }
 
-  if (babl_format_is_palette (dest_format))
-    dest_format = gimp_babl_format (GIMP_RGB,
-                                    GIMP_PRECISION_FLOAT_LINEAR,
-                                    babl_format_has_alpha (dest_format));
+  chunk.x -= data->shift_x;
+  chunk.y -= data->shift_y;
+
+  data->func (&chunk, data->user_data);
+}
+
+/*  splits @area of @buffer into stripes that don't share any of
+ *  @buffer's tiles, and calls @func on them in parallel
+ */
+static void
+gimp_gegl_loops_distribute (GeglBuffer          *buffer,
+                            const GeglRectangle *area,
+                            GimpGeglLoopsFunc    func,
+                            gpointer             user_data)
+{
+  GimpGeglLoopsDistributeData data;
+  gint                        tile_width;
+  gint                        tile_height;
+  gint64                      n;
+
+  if (area->width <= 0 || area->height <= 0)
+    return;
+
+  g_object_get (buffer,
+                "tile-width",  &tile_width,
+                "tile-height", &tile_height,
+                "shift-x",     &data.shift_x,
+                "shift-y",     &data.shift_y,
+                NULL);
+
+  /*  work in the coordinates of the buffer's tile grid  */
+  data.area    = *area;
+  data.area.x += data.shift_x;
+  data.area.y += data.shift_y;
+
+  data.vertical = (area->height >= area->width);
+
+  if (data.vertical)
+    {
+      data.tile_size  = tile_height;
+      data.first_tile = floor ((gdouble) data.area.y / tile_height);
+      data.n_tiles    = ceil ((gdouble) (data.area.y + data.area.height) /
+                              tile_height) - data.first_tile;
+    }
   else
-    dest_format = gimp_babl_format (gimp_babl_format_get_base_type (dest_format),
-                                    GIMP_PRECISION_FLOAT_LINEAR,
-                                    babl_format_has_alpha (dest_format));
+    {
+      data.tile_size  = tile_width;
+      data.first_tile = floor ((gdouble) data.area.x / tile_width);
+      data.n_tiles    = ceil ((gdouble) (data.area.x + data.area.width) /
+                              tile_width) - data.first_tile;
+    }
 
-  src_components  = babl_format_get_n_components (src_format);
-  dest_components = babl_format_get_n_components (dest_format);
+  n = ((gint64) area->width * area->height) / GIMP_GEGL_LOOPS_MIN_SUB_AREA;
+  n = CLAMP (n, 1, data.n_tiles);
 
-  iter = gegl_buffer_iterator_new (src_buffer, src_rect, 0, src_format,
-                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
-  src_roi = &iter->roi[0];
+  if (n == 1)
+    {
+      func (area, user_data);
+      return;
+    }
 
-  gegl_buffer_iterator_add (iter, dest_buffer, dest_rect, 0, dest_format,
-                            GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
-  dest_roi = &iter->roi[1];
+  data.func      = func;
+  data.user_data = user_data;
 
-  while (gegl_buffer_iterator_next (iter))
+  gimp_parallel_distribute (n,
+                            (GimpParallelDistributeFunc)
+                            gimp_gegl_loops_distribute_func,
+                            &data);
+}
+
+/*  returns the part of @rect that corresponds to @area of @ref_rect  */
+static inline GeglRectangle
+gimp_gegl_loops_sub_rect (const GeglRectangle *area,
+                          const GeglRectangle *ref_rect,
+                          const GeglRectangle *rect)
+{
+  GeglRectangle sub = *area;
+
+  sub.x += rect->x - ref_rect->x;
+  sub.y += rect->y - ref_rect->y;
+
+  return sub;
+}
+
+/*  box-filters the pixels at @src, twice the size of @dest, down to
+ *  @dest.  This is the reduction step of the projection's tile pyramid,
+ *  returns FALSE if the component type of @format isn't supported.
+ */
+gboolean
+gimp_gegl_downscale_2x (const Babl   *format,
+                        const guchar *src,
+                        gint          src_stride,
+                        guchar       *dest,
+                        gint          dest_stride,
+                        gint          dest_width,
+                        gint          dest_height)
+{
+  gint n_components;
+  gint x, y, c;
+
+  g_return_val_if_fail (format != NULL, FALSE);
+  g_return_val_if_fail (src != NULL, FALSE);
+  g_return_val_if_fail (dest != NULL, FALSE);
+
+  n_components = babl_format_get_n_components (format);
+
+#define DOWNSCALE(type, wide_type)                                         \
+  G_STMT_START                                                             \
+    {                                                                      \
+      for (y = 0; y < dest_height; y++)                                    \
+        {                                                                  \
+          const guchar *s    = src + y * 2 * src_stride;                   \
+          const type   *row0 = (const type *) s;                           \
+          const type   *row1 = (const type *) (s + src_stride);            \
+          type         *d    = (type *) (dest + y * dest_stride);          \
+                                                                           \
+          for (x = 0; x < dest_width; x++)                                 \
+            {                                                              \
+              for (c = 0; c < n_components; c++)                           \
+                {                                                          \
+                  wide_type sum = ((wide_type) row0[c] +                   \
+                                   (wide_type) row0[c + n_components] +    \
+                                   (wide_type) row1[c] +                   \
+                                   (wide_type) row1[c + n_components]);    \
+                                                                           \
+                  *d++ = sum / 4;                                          \
+                }                                                          \
+                                                                           \
+              row0 += 2 * n_components;                                    \
+              row1 += 2 * n_components;                                    \
+            }                                                              \
+        }                                                                  \
+    }                                                                      \
+  G_STMT_END
+
+  switch (gimp_babl_format_get_component_type (format))
     {
-      /*  Convolve the src image using the convolution kernel, writing
-       *  to dest Convolve is not tile-enabled--use accordingly
-       */
-      const gfloat *src         = iter->data[0];
-      gfloat       *dest        = iter->data[1];
-      const gint    components  = src_components;
-      const gint    a_component = components - 1;
-      const gint    rowstride   = src_components * src_roi->width;
-      const gint    margin      = kernel_size / 2;
-      const gint    x1          = src_roi->x;
-      const gint    y1          = src_roi->y;
-      const gint    x2          = src_roi->x + src_roi->width  - 1;
-      const gint    y2          = src_roi->y + src_roi->height - 1;
-      gint          x, y;
-      gfloat        offset;
-
-      /*  If the mode is NEGATIVE_CONVOL, the offset should be 128  */
-      if (mode == GIMP_NEGATIVE_CONVOL)
+    case GIMP_COMPONENT_TYPE_U8:
+      DOWNSCALE (guint8, guint);
+      return TRUE;
+
+    case GIMP_COMPONENT_TYPE_U16:
+      DOWNSCALE (guint16, guint);
+      return TRUE;
+
+    case GIMP_COMPONENT_TYPE_U32:
+      DOWNSCALE (guint32, guint64);
+      return TRUE;
+
+    case GIMP_COMPONENT_TYPE_FLOAT:
+      DOWNSCALE (gfloat, gfloat);
+      return TRUE;
+
+    default:
+      break;
+    }
+
+#undef DOWNSCALE
+
+  return FALSE;
+}
+
+static void
+gimp_gegl_downscale_2x_buffer_area (const GeglRectangle *dest_area,
+                                    GimpGeglCopyData    *data)
+{
+  const Babl *format = gegl_buffer_get_format (data->dest_buffer);
+  gint        bpp    = babl_format_get_bytes_per_pixel (format);
+  guchar     *src_buf;
+  guchar     *dest_buf;
+  gint        x, y;
+
+  src_buf  = g_malloc (4 * DOWNSCALE_BLOCK_SIZE * DOWNSCALE_BLOCK_SIZE * bpp);
+  dest_buf = g_malloc (DOWNSCALE_BLOCK_SIZE * DOWNSCALE_BLOCK_SIZE * bpp);
+
+  for (y = dest_area->y; y < dest_area->y + dest_area->height;
+       y += DOWNSCALE_BLOCK_SIZE)
+    {
+      for (x = dest_area->x; x < dest_area->x + dest_area->width;
+           x += DOWNSCALE_BLOCK_SIZE)
         {
-          offset = 0.5;
-          mode = GIMP_NORMAL_CONVOL;
+          GeglRectangle block;
+          GeglRectangle src_block;
+
+          gegl_rectangle_set (&block,
+                              x, y,
+                              MIN (DOWNSCALE_BLOCK_SIZE,
+                                   dest_area->x + dest_area->width  - x),
+                              MIN (DOWNSCALE_BLOCK_SIZE,
+                                   dest_area->y + dest_area->height - y));
+
+          gegl_rectangle_set (&src_block,
+                              data->src_rect->x +
+                              2 * (block.x - data->dest_rect->x),
+                              data->src_rect->y +
+                              2 * (block.y - data->dest_rect->y),
+                              2 * block.width,
+                              2 * block.height);
+
+          /*  an odd last column or row is paired with itself  */
+          gegl_buffer_get (data->src_buffer, &src_block, 1.0,
+                           format, src_buf, src_block.width * bpp,
+                           GEGL_ABYSS_CLAMP);
+
+          gimp_gegl_downscale_2x (format,
+                                  src_buf,  src_block.width * bpp,
+                                  dest_buf, block.width * bpp,
+                                  block.width, block.height);
+
+          gegl_buffer_set (data->dest_buffer, &block, 0,
+                           format, dest_buf, block.width * bpp);
         }
-      else
+    }
+
+  g_free (src_buf);
+  g_free (dest_buf);
+}
+
+/*  box-filters @src_buffer down to @dest_buffer, which is half its
+ *  size rounded up and has a format gimp_gegl_downscale_2x() supports
+ */
+void
+gimp_gegl_downscale_2x_buffer (GeglBuffer *src_buffer,
+                               GeglBuffer *dest_buffer)
+{
+  GimpGeglCopyData data;
+
+  g_return_if_fail (GEGL_IS_BUFFER (src_buffer));
+  g_return_if_fail (GEGL_IS_BUFFER (dest_buffer));
+
+  data.src_buffer  = src_buffer;
+  data.src_rect    = gegl_buffer_get_extent (src_buffer);
+  data.dest_buffer = dest_buffer;
+  data.dest_rect   = gegl_buffer_get_extent (dest_buffer);
+
+  gimp_gegl_loops_distribute (dest_buffer, data.dest_rect,
+                              (GimpGeglLoopsFunc)
+                              gimp_gegl_downscale_2x_buffer_area,
+                              &data);
+}
+
+static void
+gimp_gegl_copy_area (const GeglRectangle *dest_area,
+                     GimpGeglCopyData    *data)
+{
+  GeglRectangle src_area;
+
+  src_area = gimp_gegl_loops_sub_rect (dest_area,
+                                       data->dest_rect, data->src_rect);
+
+  gegl_buffer_copy (data->src_buffer, &src_area,
+                    data->dest_buffer, dest_area);
+}
+
+/*  like gegl_buffer_copy(), but converts the pixels in parallel when
+ *  the buffers' formats differ
+ */
+void
+gimp_gegl_copy (GeglBuffer          *src_buffer,
+                const GeglRectangle *src_rect,
+                GeglBuffer          *dest_buffer,
+                const GeglRectangle *dest_rect)
+{
+  GimpGeglCopyData data;
+  GeglRectangle    dest_area;
+
+  g_return_if_fail (GEGL_IS_BUFFER (src_buffer));
+  g_return_if_fail (GEGL_IS_BUFFER (dest_buffer));
+
+  /*  without a conversion, gegl_buffer_copy() can share the tiles  */
+  if (gegl_buffer_get_format (src_buffer) ==
+      gegl_buffer_get_format (dest_buffer))
+    {
+      gegl_buffer_copy (src_buffer, src_rect, dest_buffer, dest_rect);
+      return;
+    }
+
+  if (! src_rect)
+    src_rect = gegl_buffer_get_extent (src_buffer);
+
+  if (! dest_rect)
+    dest_rect = gegl_buffer_get_extent (dest_buffer);
+
+  /*  like gegl_buffer_copy(), only use the position of @dest_rect  */
+  gegl_rectangle_set (&dest_area,
+                      dest_rect->x, dest_rect->y,
+                      src_rect->width, src_rect->height);
+
+  data.src_buffer  = src_buffer;
+  data.src_rect    = src_rect;
+  data.dest_buffer = dest_buffer;
+  data.dest_rect   = &dest_area;
+
+  gimp_gegl_loops_distribute (dest_buffer, &dest_area,
+                              (GimpGeglLoopsFunc) gimp_gegl_copy_area,
+                              &data);
+}
+
+/*  The one-dimensional squared distance transform of Felzenszwalb and
+ *  Huttenlocher: sets @d[q] to the minimum of (q - p)^2 + @f[p] over
+ *  all p, in linear time, using the lower envelope of the parabolas
+ *  rooted at the @f[p].  @v needs room for @n and @z for @n + 1 values.
+ */
+static void
+gimp_gegl_distance_transform_1d (const gdouble *f,
+                                 gint           n,
+                                 gdouble       *d,
+                                 gint          *v,
+                                 gdouble       *z)
+{
+  gint k = 0;
+  gint q;
+
+  v[0] = 0;
+  z[0] = -DISTANCE_INFINITY;
+  z[1] = +DISTANCE_INFINITY;
+
+  for (q = 1; q < n; q++)
+    {
+      gdouble s;
+
+      /*  z[0] is below any intersection, so this stops at k == 0  */
+      while (TRUE)
         {
-          offset = 0.0;
+          gint p = v[k];
+
+          s = ((f[q] + (gdouble) q * q) - (f[p] + (gdouble) p * p)) /
+              (2.0 * (q - p));
+
+          if (s > z[k])
+            break;
+
+          k--;
         }
 
-      for (y = 0; y < dest_roi->height; y++)
+      k++;
+      v[k]     = q;
+      z[k]     = s;
+      z[k + 1] = +DISTANCE_INFINITY;
+    }
+
+  k = 0;
+
+  for (q = 0; q < n; q++)
+    {
+      while (z[k + 1] < q)
+        k++;
+
+      d[q] = (gdouble) (q - v[k]) * (q - v[k]) + f[v[k]];
+    }
+}
+
+/*  the column pass, writes the squared distances within each column
+ *  to the temp buffer
+ */
+static void
+gimp_gegl_distance_transform_columns (gsize                 offset,
+                                      gsize                 size,
+                                      GimpGeglDistanceData *data)
+{
+  const GeglRectangle *rect   = data->rect;
+  gint                 height = rect->height;
+  guchar              *src;
+  gfloat              *dest;
+  gdouble             *f;
+  gdouble             *d;
+  gint                *v;
+  gdouble             *z;
+  gint                 end    = offset + size;
+  gint                 x;
+
+  src  = g_new (guchar,  DISTANCE_BLOCK_SIZE * height);
+  dest = g_new (gfloat,  DISTANCE_BLOCK_SIZE * height);
+  f    = g_new (gdouble, height + 2);
+  d    = g_new (gdouble, height + 2);
+  v    = g_new (gint,    height + 2);
+  z    = g_new (gdouble, height + 3);
+
+  for (x = offset; x < end; x += DISTANCE_BLOCK_SIZE)
+    {
+      GeglRectangle block;
+      gint          c, y;
+
+      gegl_rectangle_set (&block,
+                          rect->x + x, rect->y,
+                          MIN (DISTANCE_BLOCK_SIZE, end - x),
+                          height);
+
+      gegl_buffer_get (data->src_buffer, &block, 1.0,
+                       babl_format ("Y u8"), src,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      for (c = 0; c < block.width; c++)
         {
-          gfloat *d = dest;
+          /*  the pixels above and below the buffer are background  */
+          f[0]          = 0.0;
+          f[height + 1] = 0.0;
 
-          if (alpha_weighting)
+          for (y = 0; y < height; y++)
             {
-              for (x = 0; x < dest_roi->width; x++)
-                {
-                  const gfloat *m                = kernel;
-                  gdouble       total[4]         = { 0.0, 0.0, 0.0, 0.0 };
-                  gdouble       weighted_divisor = 0.0;
-                  gint          i, j, b;
+              guchar value = src[y * block.width + c];
 
-                  for (j = y - margin; j <= y + margin; j++)
-                    {
-                      for (i = x - margin; i <= x + margin; i++, m++)
-                        {
-                          gint          xx = CLAMP (i, x1, x2);
-                          gint          yy = CLAMP (j, y1, y2);
-                          const gfloat *s  = src + yy * rowstride + xx * components;
-                          const gfloat  a  = s[a_component];
+              /*  partially selected pixels are at a distance of their
+               *  value from the background
+               */
+              if (value == 255)
+                f[y + 1] = DISTANCE_INFINITY;
+              else
+                f[y + 1] = SQR (value / 255.0);
+            }
+
+          gimp_gegl_distance_transform_1d (f, height + 2, d, v, z);
+
+          for (y = 0; y < height; y++)
+            dest[y * block.width + c] = d[y + 1];
+        }
 
-                          if (a)
-                            {
-                              gdouble mult_alpha = *m * a;
+      gegl_buffer_set (data->temp_buffer, &block, 0,
+                       babl_format ("Y float"), dest,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
 
-                              weighted_divisor += mult_alpha;
+  g_free (src);
+  g_free (dest);
+  g_free (f);
+  g_free (d);
+  g_free (v);
+  g_free (z);
+}
 
-                              for (b = 0; b < a_component; b++)
-                                total[b] += mult_alpha * s[b];
+/*  the row pass, combines the column distances to the Euclidean
+ *  distances and keeps track of the largest one
+ */
+static void
+gimp_gegl_distance_transform_rows (gsize                 offset,
+                                   gsize                 size,
+                                   GimpGeglDistanceData *data)
+{
+  const GeglRectangle *rect  = data->rect;
+  gint                 width = rect->width;
+  gfloat              *buf;
+  gdouble             *f;
+  gdouble             *d;
+  gint                *v;
+  gdouble             *z;
+  gfloat               max   = 0.0;
+  gint                 end   = offset + size;
+  gint                 y;
+
+  buf = g_new (gfloat,  width * DISTANCE_BLOCK_SIZE);
+  f   = g_new (gdouble, width + 2);
+  d   = g_new (gdouble, width + 2);
+  v   = g_new (gint,    width + 2);
+  z   = g_new (gdouble, width + 3);
+
+  for (y = offset; y < end; y += DISTANCE_BLOCK_SIZE)
+    {
+      GeglRectangle block;
+      gint          r, x;
 
-                              total[a_component] += mult_alpha;
-                            }
-                        }
-                    }
+      gegl_rectangle_set (&block,
+                          rect->x, rect->y + y,
+                          width,
+                          MIN (DISTANCE_BLOCK_SIZE, end - y));
 
-                  if (weighted_divisor == 0.0)
-                    weighted_divisor = divisor;
+      gegl_buffer_get (data->temp_buffer, &block, 1.0,
+                       babl_format ("Y float"), buf,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
 
-                  for (b = 0; b < a_component; b++)
-                    total[b] /= weighted_divisor;
+      for (r = 0; r < block.height; r++)
+        {
+          gfloat *row = buf + r * width;
 
-                  total[a_component] /= divisor;
+          /*  the pixels left and right of the buffer are background  */
+          f[0]         = 0.0;
+          f[width + 1] = 0.0;
 
-                  for (b = 0; b < components; b++)
-                    {
-                      total[b] += offset;
+          for (x = 0; x < width; x++)
+            f[x + 1] = row[x];
 
-                      if (mode != GIMP_NORMAL_CONVOL && total[b] < 0.0)
-                        total[b] = - total[b];
+          gimp_gegl_distance_transform_1d (f, width + 2, d, v, z);
 
-                      *d++ = CLAMP (total[b], 0.0, 1.0);
-                    }
-                }
+          for (x = 0; x < width; x++)
+            {
+              row[x] = sqrt (d[x + 1]);
+
+              if (row[x] > max)
+                max = row[x];
             }
+        }
+
+      gegl_buffer_set (data->dest_buffer, &block, 0,
+                       babl_format ("Y float"), buf,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_mutex_lock (&data->mutex);
+  data->max = MAX (data->max, max);
+  g_mutex_unlock (&data->mutex);
+
+  g_free (buf);
+  g_free (f);
+  g_free (d);
+  g_free (v);
+  g_free (z);
+}
+
+/*  Writes the exact Euclidean distance of each pixel of @src_buffer
+ *  to the nearest background pixel to @dest_buffer, which must have
+ *  the same extent.  Pixels with a value of 0, and everything outside
+ *  the buffer, are background.  Runs a column and a row pass, each in
+ *  parallel and in linear time.  Returns the largest distance.
+ */
+gfloat
+gimp_gegl_distance_transform (GeglBuffer *src_buffer,
+                              GeglBuffer *dest_buffer)
+{
+  GimpGeglDistanceData data;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (src_buffer), 0.0);
+  g_return_val_if_fail (GEGL_IS_BUFFER (dest_buffer), 0.0);
+
+  data.src_buffer  = src_buffer;
+  data.dest_buffer = dest_buffer;
+  data.rect        = gegl_buffer_get_extent (src_buffer);
+  data.max         = 0.0;
+
+  if (data.rect->width <= 0 || data.rect->height <= 0)
+    return 0.0;
+
+  data.temp_buffer = gegl_buffer_new (data.rect, babl_format ("Y float"));
+
+  g_mutex_init (&data.mutex);
+
+  gimp_parallel_distribute_range (data.rect->width, DISTANCE_BLOCK_SIZE,
+                                  (GimpParallelDistributeRangeFunc)
+                                  gimp_gegl_distance_transform_columns,
+                                  &data);
+
+  gimp_parallel_distribute_range (data.rect->height, DISTANCE_BLOCK_SIZE,
+                                  (GimpParallelDistributeRangeFunc)
+                                  gimp_gegl_distance_transform_rows,
+                                  &data);
+
+  g_mutex_clear (&data.mutex);
+
+  g_object_unref (data.temp_buffer);
+
+  return data.max;
+}
+
+/*  the binary check, clears data->binary if @area contains partially
+ *  selected pixels
+ */
+static void
+gimp_gegl_binary_morphology_check_area (const GeglRectangle         *area,
+                                        GimpGeglBinaryMorphologyData *data)
+{
+  guchar *buf;
+  gint    n = area->width * area->height;
+  gint    i;
+
+  if (! g_atomic_int_get (&data->binary))
+    return;
+
+  buf = g_new (guchar, n);
+
+  gegl_buffer_get (data->src_buffer, area, 1.0,
+                   babl_format ("Y u8"), buf,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (i = 0; i < n; i++)
+    {
+      if (buf[i] != 0 && buf[i] != 255)
+        {
+          g_atomic_int_set (&data->binary, FALSE);
+          break;
+        }
+    }
+
+  g_free (buf);
+}
+
+/*  processes the rows of the tile rows @offset to @offset + @size of
+ *  the dest buffer.  A pixel is reached if one of the seed pixels lies
+ *  within the structuring element around it, which is the case if the
+ *  nearest seed pixel in some column is close enough: each column
+ *  reaches a horizontal interval whose width only depends on that
+ *  vertical distance.
+ */
+static void
+gimp_gegl_binary_morphology_rows (gsize                         offset,
+                                  gsize                         size,
+                                  GimpGeglBinaryMorphologyData *data)
+{
+  const GeglRectangle *rect     = data->rect;
+  gint                 width    = rect->width;
+  gint                 height   = rect->height;
+  gint                 radius_x = data->radius_x;
+  gint                 radius_y = data->radius_y;
+  guchar               seed     = data->erode ? 0 : 255;
+  gint                 y1, y2;
+  gint                 src_y1, src_y2;
+  guchar              *src;
+  gint                *dist;
+  gint                *count;
+  guchar              *out;
+  gint                 x, y;
+
+  /*  the rows of @rect covered by the tile rows  */
+  y1 = (gint) offset          * data->tile_height - data->tile_shift;
+  y2 = (gint) (offset + size) * data->tile_height - data->tile_shift;
+
+  y1 = CLAMP (y1, 0, height);
+  y2 = CLAMP (y2, 0, height);
+
+  if (y1 >= y2)
+    return;
+
+  src_y1 = MAX (y1 - radius_y, 0);
+  src_y2 = MIN (y2 + radius_y, height);
+
+  src   = g_new  (guchar,  width * (src_y2 - src_y1));
+  dist  = g_new  (gint,    width * (y2 - y1));
+  count = g_new  (gint,    width + 1);
+  out   = g_new  (guchar,  width);
+
+  gegl_buffer_get (data->src_buffer,
+                   GEGL_RECTANGLE (rect->x, rect->y + src_y1,
+                                   width, src_y2 - src_y1),
+                   1.0, babl_format ("Y u8"), src,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  /*  the vertical distance of each pixel to the nearest seed pixel in
+   *  its column, radius_y + 1 means out of reach
+   */
+  for (x = 0; x < width; x++)
+    {
+      gint d;
+
+      if (src_y1 == 0 && data->outside_seed)
+        d = 0;
+      else
+        d = radius_y + 1;
+
+      for (y = src_y1; y < y2; y++)
+        {
+          if (src[(y - src_y1) * width + x] == seed)
+            d = 0;
+          else if (d <= radius_y)
+            d++;
+
+          if (y >= y1)
+            dist[(y - y1) * width + x] = d;
+        }
+
+      if (src_y2 == height && data->outside_seed)
+        d = 0;
+      else
+        d = radius_y + 1;
+
+      for (y = src_y2 - 1; y >= y1; y--)
+        {
+          if (src[(y - src_y1) * width + x] == seed)
+            d = 0;
+          else if (d <= radius_y)
+            d++;
+
+          if (y < y2 && d < dist[(y - y1) * width + x])
+            dist[(y - y1) * width + x] = d;
+        }
+    }
+
+  for (y = y1; y < y2; y++)
+    {
+      const gint *row     = dist + (y - y1) * width;
+      gint        covered = 0;
+
+      memset (count, 0, (width + 1) * sizeof (gint));
+
+      /*  the columns outside @rect reach radius_x pixels into it  */
+      if (data->outside_seed)
+        {
+          count[0]++;
+          count[MIN (radius_x, width)]--;
+
+          count[MAX (width - radius_x, 0)]++;
+          count[width]--;
+        }
+
+      for (x = 0; x < width; x++)
+        {
+          if (row[x] <= radius_y)
+            {
+              gint reach = data->reach[row[x]];
+
+              count[MAX (x - reach, 0)]++;
+              count[MIN (x + reach + 1, width)]--;
+            }
+        }
+
+      for (x = 0; x < width; x++)
+        {
+          covered += count[x];
+
+          if (data->erode)
+            out[x] = covered ? 0 : 255;
           else
+            out[x] = covered ? 255 : 0;
+        }
+
+      gegl_buffer_set (data->dest_buffer,
+                       GEGL_RECTANGLE (rect->x, rect->y + y, width, 1),
+                       0, babl_format ("Y u8"), out,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_free (src);
+  g_free (dist);
+  g_free (count);
+  g_free (out);
+}
+
+/*  Grows (or, if @erode is TRUE, shrinks) the selection mask in @rect
+ *  of @src_buffer by the structuring element whose half-height at the
+ *  horizontal offsets -@radius_x to @radius_x is given by @circ, which
+ *  points to its center and must not increase away from it, and writes
+ *  the result to @rect of @dest_buffer.  Pixels outside @rect count as
+ *  selected if @outside_selected is TRUE.
+ *
+ *  This only works for masks without partially selected pixels, but
+ *  takes constant time per pixel regardless of the radius.  Returns
+ *  FALSE, without touching @dest_buffer, if @src_buffer isn't such a
+ *  mask.
+ */
+gboolean
+gimp_gegl_binary_morphology (GeglBuffer          *src_buffer,
+                             GeglBuffer          *dest_buffer,
+                             const GeglRectangle *rect,
+                             const gint16        *circ,
+                             gint                 radius_x,
+                             gint                 radius_y,
+                             gboolean             erode,
+                             gboolean             outside_selected)
+{
+  GimpGeglBinaryMorphologyData data;
+  gint                         n_tile_rows;
+  gint                         min_tile_rows;
+  gint                         d;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (src_buffer), FALSE);
+  g_return_val_if_fail (GEGL_IS_BUFFER (dest_buffer), FALSE);
+  g_return_val_if_fail (rect != NULL, FALSE);
+  g_return_val_if_fail (circ != NULL, FALSE);
+  g_return_val_if_fail (radius_x >= 0 && radius_y >= 0, FALSE);
+
+  if (rect->width <= 0 || rect->height <= 0)
+    return TRUE;
+
+  data.src_buffer = src_buffer;
+  data.binary     = TRUE;
+
+  gimp_gegl_loops_distribute (src_buffer, rect,
+                              (GimpGeglLoopsFunc)
+                              gimp_gegl_binary_morphology_check_area,
+                              &data);
+
+  if (! data.binary)
+    return FALSE;
+
+  data.dest_buffer  = dest_buffer;
+  data.rect         = rect;
+  data.radius_x     = radius_x;
+  data.radius_y     = radius_y;
+  data.erode        = erode;
+
+  /*  when shrinking, the unselected pixels are grown  */
+  data.outside_seed = erode ? ! outside_selected : outside_selected;
+
+  /*  how far a column reaches horizontally, given the vertical
+   *  distance of its nearest seed pixel
+   */
+  data.reach = g_new (gint, radius_y + 1);
+
+  for (d = 0; d <= radius_y; d++)
+    {
+      gint reach = -1;
+
+      while (reach < radius_x && circ[reach + 1] >= d)
+        reach++;
+
+      data.reach[d] = reach;
+    }
+
+  /*  don't let two threads write to the same tiles of @dest_buffer  */
+  g_object_get (dest_buffer,
+                "tile-height", &data.tile_height,
+                "shift-y",     &data.tile_shift,
+                NULL);
+
+  data.tile_shift = (rect->y + data.tile_shift) % data.tile_height;
+
+  if (data.tile_shift < 0)
+    data.tile_shift += data.tile_height;
+
+  n_tile_rows = (rect->height + data.tile_shift + data.tile_height - 1) /
+                data.tile_height;
+
+  /*  keep the rows read around each band small compared to the band  */
+  min_tile_rows = MAX (2 * radius_y, MORPHOLOGY_MIN_ROWS) / data.tile_height;
+
+  gimp_parallel_distribute_range (n_tile_rows, MAX (min_tile_rows, 1),
+                                  (GimpParallelDistributeRangeFunc)
+                                  gimp_gegl_binary_morphology_rows,
+                                  &data);
+
+  g_free (data.reach);
+
+  return TRUE;
+}
+
+static void
+gimp_gegl_convolve_area (const GeglRectangle  *dest_area,
+                         GimpGeglConvolveData *data)
+{
+  const GeglRectangle *src_rect        = data->src_rect;
+  const gint           components      = babl_format_get_n_components (data->src_format);
+  const gint           dest_components = babl_format_get_n_components (data->dest_format);
+  const gint           a_component     = components - 1;
+  const gint           margin          = data->kernel_size / 2;
+  const gint           x1              = src_rect->x;
+  const gint           y1              = src_rect->y;
+  const gint           x2              = src_rect->x + src_rect->width  - 1;
+  const gint           y2              = src_rect->y + src_rect->height - 1;
+  GeglRectangle        src_area;
+  GeglRectangle        src_roi;
+  gfloat              *src_data;
+  gfloat              *dest_data;
+  gint                 rowstride;
+  gint                 x, y;
+
+  /*  the source pixels needed for @dest_area, including the kernel's
+   *  margin, clipped to the source rectangle whose edge pixels are
+   *  extended
+   */
+  src_area = gimp_gegl_loops_sub_rect (dest_area, data->dest_rect, src_rect);
+
+  if (! gegl_rectangle_intersect (&src_roi,
+                                  GEGL_RECTANGLE (src_area.x - margin,
+                                                  src_area.y - margin,
+                                                  src_area.width  + 2 * margin,
+                                                  src_area.height + 2 * margin),
+                                  src_rect))
+    return;
+
+  rowstride = src_roi.width * components;
+
+  src_data  = g_new (gfloat, src_roi.height * rowstride);
+  dest_data = g_new (gfloat,
+                     dest_area->width * dest_area->height * dest_components);
+
+  gegl_buffer_get (data->src_buffer, &src_roi, 1.0, data->src_format,
+                   src_data, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (y = 0; y < dest_area->height; y++)
+    {
+      gfloat *d = dest_data + y * dest_area->width * dest_components;
+
+      for (x = 0; x < dest_area->width; x++)
+        {
+          const gint    sx               = src_area.x + x;
+          const gint    sy               = src_area.y + y;
+          const gfloat *m                = data->kernel;
+          gdouble       total[4]         = { 0.0, 0.0, 0.0, 0.0 };
+          gdouble       weighted_divisor = 0.0;
+          gint          i, j, b;
+
+          for (j = sy - margin; j <= sy + margin; j++)
             {
-              for (x = 0; x < dest_roi->width; x++)
+              for (i = sx - margin; i <= sx + margin; i++, m++)
                 {
-                  const gfloat *m        = kernel;
-                  gdouble       total[4] = { 0.0, 0.0, 0.0, 0.0 };
-                  gint          i, j, b;
+                  gint          xx = CLAMP (i, x1, x2) - src_roi.x;
+                  gint          yy = CLAMP (j, y1, y2) - src_roi.y;
+                  const gfloat *s  = src_data + yy * rowstride + xx * components;
 
-                  for (j = y - margin; j <= y + margin; j++)
+                  if (data->alpha_weighting)
                     {
-                      for (i = x - margin; i <= x + margin; i++, m++)
+                      const gfloat a = s[a_component];
+
+                      if (a)
                         {
-                          gint          xx = CLAMP (i, x1, x2);
-                          gint          yy = CLAMP (j, y1, y2);
-                          const gfloat *s  = src + yy * rowstride + xx * components;
+                          gdouble mult_alpha = *m * a;
 
-                          for (b = 0; b < components; b++)
-                            total[b] += *m * s[b];
+                          weighted_divisor += mult_alpha;
+
+                          for (b = 0; b < a_component; b++)
+                            total[b] += mult_alpha * s[b];
+
+                          total[a_component] += mult_alpha;
                         }
                     }
-
-                  for (b = 0; b < components; b++)
+                  else
                     {
-                      total[b] = total[b] / divisor + offset;
-
-                      if (mode != GIMP_NORMAL_CONVOL && total[b] < 0.0)
-                        total[b] = - total[b];
-
-                      total[b] = CLAMP (total[b], 0.0, 1.0);
+                      for (b = 0; b < components; b++)
+                        total[b] += *m * s[b];
                     }
                 }
             }
 
-          dest += dest_roi->width * dest_components;
+          if (data->alpha_weighting)
+            {
+              if (weighted_divisor == 0.0)
+                weighted_divisor = data->divisor;
+
+              for (b = 0; b < a_component; b++)
+                total[b] /= weighted_divisor;
+
+              total[a_component] /= data->divisor;
+            }
+          else
+            {
+              for (b = 0; b < components; b++)
+                total[b] /= data->divisor;
+            }
+
+          for (b = 0; b < components; b++)
+            {
+              total[b] += data->offset;
+
+              if (data->mode != GIMP_NORMAL_CONVOL && total[b] < 0.0)
+                total[b] = - total[b];
+
+              *d++ = CLAMP (total[b], 0.0, 1.0);
+            }
         }
     }
+
+  gegl_buffer_set (data->dest_buffer, dest_area, 0, data->dest_format,
+                   dest_data, GEGL_AUTO_ROWSTRIDE);
+
+  g_free (dest_data);
+  g_free (src_data);
 }
 
 void
-gimp_gegl_dodgeburn (GeglBuffer          *src_buffer,
-                     const GeglRectangle *src_rect,
-                     GeglBuffer          *dest_buffer,
-                     const GeglRectangle *dest_rect,
-                     gdouble              exposure,
-                     GimpDodgeBurnType    type,
-                     GimpTransferMode     mode)
+gimp_gegl_convolve (GeglBuffer          *src_buffer,
+                    const GeglRectangle *src_rect,
+                    GeglBuffer          *dest_buffer,
+                    const GeglRectangle *dest_rect,
+                    const gfloat        *kernel,
+                    gint                 kernel_size,
+                    gdouble              divisor,
+                    GimpConvolutionType  mode,
+                    gboolean             alpha_weighting)
+{
+  GimpGeglConvolveData data;
+  const Babl          *src_format;
+  const Babl          *dest_format;
+
+  src_format = gegl_buffer_get_format (src_buffer);
+
+  if (babl_format_is_palette (src_format))
+    src_format = gimp_babl_format (GIMP_RGB,
+                                   GIMP_PRECISION_FLOAT_LINEAR,
+                                   babl_format_has_alpha (src_format));
+  else
+    src_format = gimp_babl_format (gimp_babl_format_get_base_type (src_format),
+                                   GIMP_PRECISION_FLOAT_LINEAR,
+                                   babl_format_has_alpha (src_format));
+
+  dest_format = gegl_buffer_get_format (dest_buffer);
+
+  if (babl_format_is_palette (dest_format))
+    dest_format = gimp_babl_format (GIMP_RGB,
+                                    GIMP_PRECISION_FLOAT_LINEAR,
+                                    babl_format_has_alpha (dest_format));
+  else
+    dest_format = gimp_babl_format (gimp_babl_format_get_base_type (dest_format),
+                                    GIMP_PRECISION_FLOAT_LINEAR,
+                                    babl_format_has_alpha (dest_format));
+
+  data.src_buffer      = src_buffer;
+  data.src_rect        = src_rect;
+  data.dest_buffer     = dest_buffer;
+  data.dest_rect       = dest_rect;
+  data.src_format      = src_format;
+  data.dest_format     = dest_format;
+  data.kernel          = kernel;
+  data.kernel_size     = kernel_size;
+  data.divisor         = divisor;
+  data.alpha_weighting = alpha_weighting;
+
+  /*  If the mode is NEGATIVE_CONVOL, the offset should be 128  */
+  if (mode == GIMP_NEGATIVE_CONVOL)
+    {
+      data.offset = 0.5;
+      data.mode   = GIMP_NORMAL_CONVOL;
+    }
+  else
+    {
+      data.offset = 0.0;
+      data.mode   = mode;
+    }
+
+  gimp_gegl_loops_distribute (dest_buffer, dest_rect,
+                              (GimpGeglLoopsFunc) gimp_gegl_convolve_area,
+                              &data);
+}
+
+static void
+gimp_gegl_dodgeburn_area (const GeglRectangle   *dest_area,
+                          GimpGeglDodgeBurnData *data)
 {
   GeglBufferIterator *iter;
+  GeglRectangle       src_area;
+  gdouble             exposure = data->exposure;
 
-  if (type == GIMP_BURN)
-    exposure = -exposure;
+  src_area = gimp_gegl_loops_sub_rect (dest_area,
+                                       data->dest_rect, data->src_rect);
 
-  iter = gegl_buffer_iterator_new (src_buffer, src_rect, 0,
+  iter = gegl_buffer_iterator_new (data->src_buffer, &src_area, 0,
                                    babl_format ("R'G'B'A float"),
                                    GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
 
-  gegl_buffer_iterator_add (iter, dest_buffer, dest_rect, 0,
+  gegl_buffer_iterator_add (iter, data->dest_buffer, dest_area, 0,
                             babl_format ("R'G'B'A float"),
                             GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
 
-  switch (mode)
+  switch (data->mode)
     {
       gfloat factor;
 
@@ -322,12 +1298,178 @@ gimp_gegl_dodgeburn (GeglBuffer          *src_buffer,
     }
 }
 
+void
+gimp_gegl_dodgeburn (GeglBuffer          *src_buffer,
+                     const GeglRectangle *src_rect,
+                     GeglBuffer          *dest_buffer,
+                     const GeglRectangle *dest_rect,
+                     gdouble              exposure,
+                     GimpDodgeBurnType    type,
+                     GimpTransferMode     mode)
+{
+  GimpGeglDodgeBurnData data;
+  GeglRectangle         dest_area;
+
+  if (type == GIMP_BURN)
+    exposure = -exposure;
+
+  /*  like GEGL's iterators, take an empty @dest_rect's size from
+   *  @src_rect
+   */
+  dest_area = *dest_rect;
+
+  if (dest_area.width <= 0 || dest_area.height <= 0)
+    {
+      dest_area.width  = src_rect->width;
+      dest_area.height = src_rect->height;
+    }
+
+  data.src_buffer  = src_buffer;
+  data.src_rect    = src_rect;
+  data.dest_buffer = dest_buffer;
+  data.dest_rect   = &dest_area;
+  data.exposure    = exposure;
+  data.mode        = mode;
+
+  gimp_gegl_loops_distribute (dest_buffer, &dest_area,
+                              (GimpGeglLoopsFunc) gimp_gegl_dodgeburn_area,
+                              &data);
+}
+
+static inline void
+gimp_gegl_smudge_blend_pixels (const gfloat *top,
+                               const gfloat *bottom,
+                               gfloat       *dest,
+                               gfloat       *copy,
+                               gint          length,
+                               gfloat        blend)
+{
+  const gfloat blend1 = 1.0 - blend;
+  const gfloat blend2 = blend;
+
+  /*  this is bottom + (bottom * a1 + top * a2 - a * bottom) of the
+   *  original formula, with a = a1 + a2 folded in
+   */
+  while (length--)
+    {
+      const gfloat a1 = blend1 * bottom[3];
+      const gfloat a2 = blend2 * top[3];
+      const gfloat a  = a1 + a2;
+
+      if (a == 0)
+        {
+          dest[0] = dest[1] = dest[2] = dest[3] = 0;
+        }
+      else
+        {
+#if defined(__SSE__) && defined(__GNUC__) && __GNUC__ >= 4
+          typedef float v4sf __attribute__((vector_size(16)));
+          v4sf t   = { top[0],    top[1],    top[2],    top[3]    };
+          v4sf b   = { bottom[0], bottom[1], bottom[2], bottom[3] };
+          v4sf a2v = { a2, a2, a2, a2 };
+          union { v4sf v; gfloat f[4]; } d;
+
+          d.v = b + (t - b) * a2v;
+
+          dest[0] = d.f[0];
+          dest[1] = d.f[1];
+          dest[2] = d.f[2];
+#else
+          dest[0] = bottom[0] + (top[0] - bottom[0]) * a2;
+          dest[1] = bottom[1] + (top[1] - bottom[1]) * a2;
+          dest[2] = bottom[2] + (top[2] - bottom[2]) * a2;
+#endif
+          dest[3] = a;
+        }
+
+      if (copy)
+        {
+          copy[0] = dest[0];
+          copy[1] = dest[1];
+          copy[2] = dest[2];
+          copy[3] = dest[3];
+
+          copy += 4;
+        }
+
+      top    += 4;
+      bottom += 4;
+      dest   += 4;
+    }
+}
+
+static void
+gimp_gegl_smudge_blend_area (const GeglRectangle *dest_area,
+                             GimpGeglLoopsData   *data)
+{
+  GeglBufferIterator *iter;
+  GeglRectangle       top_area;
+  GeglRectangle       bottom_area;
+  gboolean            in_place;
+  gint                copy_index = 0;
+
+  top_area    = gimp_gegl_loops_sub_rect (dest_area,
+                                          data->dest_rect, data->top_rect);
+  bottom_area = gimp_gegl_loops_sub_rect (dest_area,
+                                          data->dest_rect, data->bottom_rect);
+
+  /*  the smudge accumulator is blended into itself, one iterator
+   *  reading and writing it avoids fetching its tiles twice
+   */
+  in_place = (data->top_buffer == data->dest_buffer &&
+              top_area.x == dest_area->x &&
+              top_area.y == dest_area->y);
+
+  iter = gegl_buffer_iterator_new (data->dest_buffer, dest_area, 0,
+                                   babl_format ("RGBA float"),
+                                   in_place ?
+                                   GEGL_BUFFER_READWRITE : GEGL_BUFFER_WRITE,
+                                   GEGL_ABYSS_NONE);
+
+  gegl_buffer_iterator_add (iter, data->bottom_buffer, &bottom_area, 0,
+                            babl_format ("RGBA float"),
+                            GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+
+  if (! in_place)
+    gegl_buffer_iterator_add (iter, data->top_buffer, &top_area, 0,
+                              babl_format ("RGBA float"),
+                              GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+
+  if (data->copy_buffer)
+    {
+      GeglRectangle copy_area;
+
+      copy_area = gimp_gegl_loops_sub_rect (dest_area,
+                                            data->dest_rect, data->copy_rect);
+
+      copy_index = gegl_buffer_iterator_add (iter, data->copy_buffer,
+                                             &copy_area, 0,
+                                             babl_format ("RGBA float"),
+                                             GEGL_BUFFER_WRITE,
+                                             GEGL_ABYSS_NONE);
+    }
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gfloat       *dest   = iter->data[0];
+      const gfloat *bottom = iter->data[1];
+      const gfloat *top    = in_place ? dest : iter->data[2];
+      gfloat       *copy   = copy_index ? iter->data[copy_index] : NULL;
+
+      gimp_gegl_smudge_blend_pixels (top, bottom, dest, copy,
+                                     iter->length, data->blend);
+    }
+}
+
 /*
  * blend_pixels patched 8-24-05 to fix bug #163721.  Note that this change
  * causes the function to treat src1 and src2 asymmetrically.  This gives the
  * right behavior for the smudge tool, which is the only user of this function
  * at the time of patching.  If you want to use the function for something
  * else, caveat emptor.
+ *
+ * If @copy_buffer is not %NULL, the result is also written to
+ * @copy_rect of it, which saves copying @dest_rect there afterwards.
  */
 void
 gimp_gegl_smudge_blend (GeglBuffer          *top_buffer,
@@ -336,55 +1478,94 @@ gimp_gegl_smudge_blend (GeglBuffer          *top_buffer,
                         const GeglRectangle *bottom_rect,
                         GeglBuffer          *dest_buffer,
                         const GeglRectangle *dest_rect,
+                        GeglBuffer          *copy_buffer,
+                        const GeglRectangle *copy_rect,
                         gdouble              blend)
 {
-  GeglBufferIterator *iter;
+  GimpGeglLoopsData data = { 0, };
+
+  data.top_buffer    = top_buffer;
+  data.top_rect      = top_rect;
+  data.bottom_buffer = bottom_buffer;
+  data.bottom_rect   = bottom_rect;
+  data.dest_buffer   = dest_buffer;
+  data.dest_rect     = dest_rect;
+  data.copy_buffer   = copy_buffer;
+  data.copy_rect     = copy_rect;
+  data.blend         = blend;
+
+  /*  the stripes of @dest_buffer don't line up with the tiles of
+   *  @copy_buffer, which usually is a single-tile paint buffer anyway
+   */
+  if (copy_buffer)
+    gimp_gegl_smudge_blend_area (dest_rect, &data);
+  else
+    gimp_gegl_loops_distribute (dest_buffer, dest_rect,
+                                (GimpGeglLoopsFunc) gimp_gegl_smudge_blend_area,
+                                &data);
+}
 
-  iter = gegl_buffer_iterator_new (top_buffer, top_rect, 0,
-                                   babl_format ("RGBA float"),
-                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+/*  processes the mask a chunk at a time: fully opaque chunks are
+ *  skipped, fully transparent ones are cleared, and only the chunks
+ *  in between are blended
+ */
+static void
+gimp_gegl_apply_mask_area (const GeglRectangle *dest_area,
+                           GimpGeglLoopsData   *data)
+{
+  GeglBufferIterator *iter;
+  GeglRectangle       mask_area;
 
-  gegl_buffer_iterator_add (iter, bottom_buffer, bottom_rect, 0,
-                            babl_format ("RGBA float"),
-                            GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+  mask_area = gimp_gegl_loops_sub_rect (dest_area,
+                                        data->dest_rect, data->mask_rect);
 
-  gegl_buffer_iterator_add (iter, dest_buffer, dest_rect, 0,
-                            babl_format ("RGBA float"),
-                            GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
+  iter = gegl_buffer_iterator_new (data->mask_buffer, &mask_area, 0,
+                                   babl_format ("Y float"),
+                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (iter))
     {
-      const gfloat *top    = iter->data[0];
-      const gfloat *bottom = iter->data[1];
-      gfloat       *dest   = iter->data[2];
-      const gfloat  blend1 = 1.0 - blend;
-      const gfloat  blend2 = blend;
+      const gfloat  *mask    = iter->data[0];
+      const gfloat   opacity = data->opacity;
+      GeglRectangle  dest_roi;
+      gfloat        *dest;
+      gint           i;
 
-      while (iter->length--)
+      dest_roi = gimp_gegl_loops_sub_rect (&iter->roi[0],
+                                           data->mask_rect, data->dest_rect);
+
+      for (i = 1; i < iter->length; i++)
         {
-          const gfloat a1 = blend1 * bottom[3];
-          const gfloat a2 = blend2 * top[3];
-          const gfloat a  = a1 + a2;
-          gint         b;
+          if (mask[i] != mask[0])
+            break;
+        }
 
-          if (a == 0)
+      if (i == iter->length)
+        {
+          if (mask[0] * opacity == 1.0)
+            continue;
+
+          if (mask[0] * opacity == 0.0)
             {
-              for (b = 0; b < 4; b++)
-                dest[b] = 0;
+              gegl_buffer_clear (data->dest_buffer, &dest_roi);
+              continue;
             }
-          else
-            {
-              for (b = 0; b < 3; b++)
-                dest[b] =
-                  bottom[b] + (bottom[b] * a1 + top[b] * a2 - a * bottom[b]);
+        }
 
-              dest[3] = a;
-            }
+      dest = g_new (gfloat, iter->length * 4);
 
-          top    += 4;
-          bottom += 4;
-          dest   += 4;
-        }
+      gegl_buffer_get (data->dest_buffer, &dest_roi, 1.0,
+                       babl_format ("RGBA float"), dest,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      for (i = 0; i < iter->length; i++)
+        dest[i * 4 + 3] *= mask[i] * opacity;
+
+      gegl_buffer_set (data->dest_buffer, &dest_roi, 0,
+                       babl_format ("RGBA float"), dest,
+                       GEGL_AUTO_ROWSTRIDE);
+
+      g_free (dest);
     }
 }
 
@@ -394,28 +1575,50 @@ gimp_gegl_apply_mask (GeglBuffer          *mask_buffer,
                       GeglBuffer          *dest_buffer,
                       const GeglRectangle *dest_rect,
                       gdouble              opacity)
+{
+  GimpGeglLoopsData data = { 0, };
+
+  data.mask_buffer = mask_buffer;
+  data.mask_rect   = mask_rect;
+  data.dest_buffer = dest_buffer;
+  data.dest_rect   = dest_rect;
+  data.opacity     = opacity;
+
+  gimp_gegl_loops_distribute (dest_buffer, dest_rect,
+                              (GimpGeglLoopsFunc) gimp_gegl_apply_mask_area,
+                              &data);
+}
+
+static void
+gimp_gegl_combine_mask_area (const GeglRectangle *dest_area,
+                             GimpGeglLoopsData   *data)
 {
   GeglBufferIterator *iter;
+  GeglRectangle       mask_area;
+
+  mask_area = gimp_gegl_loops_sub_rect (dest_area,
+                                        data->dest_rect, data->mask_rect);
 
-  iter = gegl_buffer_iterator_new (mask_buffer, mask_rect, 0,
+  iter = gegl_buffer_iterator_new (data->mask_buffer, &mask_area, 0,
                                    babl_format ("Y float"),
                                    GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
 
-  gegl_buffer_iterator_add (iter, dest_buffer, dest_rect, 0,
-                            babl_format ("RGBA float"),
+  gegl_buffer_iterator_add (iter, data->dest_buffer, dest_area, 0,
+                            babl_format ("Y float"),
                             GEGL_BUFFER_READWRITE, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (iter))
     {
-      const gfloat *mask = iter->data[0];
-      gfloat       *dest = iter->data[1];
+      const gfloat *mask    = iter->data[0];
+      gfloat       *dest    = iter->data[1];
+      const gfloat  opacity = data->opacity;
 
       while (iter->length--)
         {
-          dest[3] *= *mask * opacity;
+          *dest *= *mask * opacity;
 
           mask += 1;
-          dest += 4;
+          dest += 1;
         }
     }
 }
@@ -427,55 +1630,44 @@ gimp_gegl_combine_mask (GeglBuffer          *mask_buffer,
                         const GeglRectangle *dest_rect,
                         gdouble              opacity)
 {
-  GeglBufferIterator *iter;
-
-  iter = gegl_buffer_iterator_new (mask_buffer, mask_rect, 0,
-                                   babl_format ("Y float"),
-                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
-
-  gegl_buffer_iterator_add (iter, dest_buffer, dest_rect, 0,
-                            babl_format ("Y float"),
-                            GEGL_BUFFER_READWRITE, GEGL_ABYSS_NONE);
+  GimpGeglLoopsData data = { 0, };
 
-  while (gegl_buffer_iterator_next (iter))
-    {
-      const gfloat *mask = iter->data[0];
-      gfloat       *dest = iter->data[1];
-
-      while (iter->length--)
-        {
-          *dest *= *mask * opacity;
+  data.mask_buffer = mask_buffer;
+  data.mask_rect   = mask_rect;
+  data.dest_buffer = dest_buffer;
+  data.dest_rect   = dest_rect;
+  data.opacity     = opacity;
 
-          mask += 1;
-          dest += 1;
-        }
-    }
+  gimp_gegl_loops_distribute (dest_buffer, dest_rect,
+                              (GimpGeglLoopsFunc) gimp_gegl_combine_mask_area,
+                              &data);
 }
 
-void
-gimp_gegl_combine_mask_weird (GeglBuffer          *mask_buffer,
-                              const GeglRectangle *mask_rect,
-                              GeglBuffer          *dest_buffer,
-                              const GeglRectangle *dest_rect,
-                              gdouble              opacity,
-                              gboolean             stipple)
+static void
+gimp_gegl_combine_mask_weird_area (const GeglRectangle *dest_area,
+                                   GimpGeglLoopsData   *data)
 {
   GeglBufferIterator *iter;
+  GeglRectangle       mask_area;
+
+  mask_area = gimp_gegl_loops_sub_rect (dest_area,
+                                        data->dest_rect, data->mask_rect);
 
-  iter = gegl_buffer_iterator_new (mask_buffer, mask_rect, 0,
+  iter = gegl_buffer_iterator_new (data->mask_buffer, &mask_area, 0,
                                    babl_format ("Y float"),
                                    GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
 
-  gegl_buffer_iterator_add (iter, dest_buffer, dest_rect, 0,
+  gegl_buffer_iterator_add (iter, data->dest_buffer, dest_area, 0,
                             babl_format ("Y float"),
                             GEGL_BUFFER_READWRITE, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (iter))
     {
-      const gfloat *mask = iter->data[0];
-      gfloat       *dest = iter->data[1];
+      const gfloat *mask    = iter->data[0];
+      gfloat       *dest    = iter->data[1];
+      const gfloat  opacity = data->opacity;
 
-      if (stipple)
+      if (data->stipple)
         {
           while (iter->length--)
             {
@@ -500,41 +1692,67 @@ gimp_gegl_combine_mask_weird (GeglBuffer          *mask_buffer,
 }
 
 void
-gimp_gegl_replace (GeglBuffer          *top_buffer,
-                   const GeglRectangle *top_rect,
-                   GeglBuffer          *bottom_buffer,
-                   const GeglRectangle *bottom_rect,
-                   GeglBuffer          *mask_buffer,
-                   const GeglRectangle *mask_rect,
-                   GeglBuffer          *dest_buffer,
-                   const GeglRectangle *dest_rect,
-                   gdouble              opacity,
-                   const gboolean      *affect)
+gimp_gegl_combine_mask_weird (GeglBuffer          *mask_buffer,
+                              const GeglRectangle *mask_rect,
+                              GeglBuffer          *dest_buffer,
+                              const GeglRectangle *dest_rect,
+                              gdouble              opacity,
+                              gboolean             stipple)
 {
-  GeglBufferIterator *iter;
+  GimpGeglLoopsData data = { 0, };
+
+  data.mask_buffer = mask_buffer;
+  data.mask_rect   = mask_rect;
+  data.dest_buffer = dest_buffer;
+  data.dest_rect   = dest_rect;
+  data.opacity     = opacity;
+  data.stipple     = stipple;
+
+  gimp_gegl_loops_distribute (dest_buffer, dest_rect,
+                              (GimpGeglLoopsFunc) gimp_gegl_combine_mask_weird_area,
+                              &data);
+}
 
-  iter = gegl_buffer_iterator_new (top_buffer, top_rect, 0,
+static void
+gimp_gegl_replace_area (const GeglRectangle *dest_area,
+                        GimpGeglLoopsData   *data)
+{
+  GeglBufferIterator *iter;
+  GeglRectangle       top_area;
+  GeglRectangle       bottom_area;
+  GeglRectangle       mask_area;
+  const gboolean     *affect = data->affect;
+
+  top_area    = gimp_gegl_loops_sub_rect (dest_area,
+                                          data->dest_rect, data->top_rect);
+  bottom_area = gimp_gegl_loops_sub_rect (dest_area,
+                                          data->dest_rect, data->bottom_rect);
+  mask_area   = gimp_gegl_loops_sub_rect (dest_area,
+                                          data->dest_rect, data->mask_rect);
+
+  iter = gegl_buffer_iterator_new (data->top_buffer, &top_area, 0,
                                    babl_format ("RGBA float"),
                                    GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
 
-  gegl_buffer_iterator_add (iter, bottom_buffer, bottom_rect, 0,
+  gegl_buffer_iterator_add (iter, data->bottom_buffer, &bottom_area, 0,
                             babl_format ("RGBA float"),
                             GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
 
-  gegl_buffer_iterator_add (iter, mask_buffer, mask_rect, 0,
+  gegl_buffer_iterator_add (iter, data->mask_buffer, &mask_area, 0,
                             babl_format ("Y float"),
                             GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
 
-  gegl_buffer_iterator_add (iter, dest_buffer, dest_rect, 0,
+  gegl_buffer_iterator_add (iter, data->dest_buffer, dest_area, 0,
                             babl_format ("RGBA float"),
                             GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (iter))
     {
-      const gfloat *top    = iter->data[0];
-      const gfloat *bottom = iter->data[1];
-      const gfloat *mask   = iter->data[2];
-      gfloat       *dest   = iter->data[3];
+      const gfloat *top     = iter->data[0];
+      const gfloat *bottom  = iter->data[1];
+      const gfloat *mask    = iter->data[2];
+      gfloat       *dest    = iter->data[3];
+      const gdouble opacity = data->opacity;
 
       while (iter->length--)
         {
@@ -603,3 +1821,33 @@ gimp_gegl_replace (GeglBuffer          *top_buffer,
         }
     }
 }
+
+void
+gimp_gegl_replace (GeglBuffer          *top_buffer,
+                   const GeglRectangle *top_rect,
+                   GeglBuffer          *bottom_buffer,
+                   const GeglRectangle *bottom_rect,
+                   GeglBuffer          *mask_buffer,
+                   const GeglRectangle *mask_rect,
+                   GeglBuffer          *dest_buffer,
+                   const GeglRectangle *dest_rect,
+                   gdouble              opacity,
+                   const gboolean      *affect)
+{
+  GimpGeglLoopsData data = { 0, };
+
+  data.top_buffer    = top_buffer;
+  data.top_rect      = top_rect;
+  data.bottom_buffer = bottom_buffer;
+  data.bottom_rect   = bottom_rect;
+  data.mask_buffer   = mask_buffer;
+  data.mask_rect     = mask_rect;
+  data.dest_buffer   = dest_buffer;
+  data.dest_rect     = dest_rect;
+  data.opacity       = opacity;
+  data.affect        = affect;
+
+  gimp_gegl_loops_distribute (dest_buffer, dest_rect,
+                              (GimpGeglLoopsFunc) gimp_gegl_replace_area,
+                              &data);
+}
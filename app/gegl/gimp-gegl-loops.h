@@ -22,64 +22,93 @@
 #define __GIMP_GEGL_LOOPS_H__
 
 
-/*  this is a pretty stupid port of concolve_region() that only works
- *  on a linear source buffer
+gboolean gimp_gegl_downscale_2x        (const Babl          *format,
+                                        const guchar        *src,
+                                        gint                 src_stride,
+                                        guchar              *dest,
+                                        gint                 dest_stride,
+                                        gint                 dest_width,
+                                        gint                 dest_height);
+void     gimp_gegl_downscale_2x_buffer (GeglBuffer          *src_buffer,
+                                        GeglBuffer          *dest_buffer);
+
+void     gimp_gegl_copy                (GeglBuffer          *src_buffer,
+                                        const GeglRectangle *src_rect,
+                                        GeglBuffer          *dest_buffer,
+                                        const GeglRectangle *dest_rect);
+
+gfloat   gimp_gegl_distance_transform  (GeglBuffer          *src_buffer,
+                                        GeglBuffer          *dest_buffer);
+
+gboolean gimp_gegl_binary_morphology   (GeglBuffer          *src_buffer,
+                                        GeglBuffer          *dest_buffer,
+                                        const GeglRectangle *rect,
+                                        const gint16        *circ,
+                                        gint                 radius_x,
+                                        gint                 radius_y,
+                                        gboolean             erode,
+                                        gboolean             outside_selected);
+
+/*  this is a pretty stupid port of concolve_region(), the edge pixels
+ *  of @src_rect are extended
  */
-void   gimp_gegl_convolve           (GeglBuffer          *src_buffer,
-                                     const GeglRectangle *src_rect,
-                                     GeglBuffer          *dest_buffer,
-                                     const GeglRectangle *dest_rect,
-                                     const gfloat        *kernel,
-                                     gint                 kernel_size,
-                                     gdouble              divisor,
-                                     GimpConvolutionType  mode,
-                                     gboolean             alpha_weighting);
+void     gimp_gegl_convolve            (GeglBuffer          *src_buffer,
+                                        const GeglRectangle *src_rect,
+                                        GeglBuffer          *dest_buffer,
+                                        const GeglRectangle *dest_rect,
+                                        const gfloat        *kernel,
+                                        gint                 kernel_size,
+                                        gdouble              divisor,
+                                        GimpConvolutionType  mode,
+                                        gboolean             alpha_weighting);
 
-void   gimp_gegl_dodgeburn          (GeglBuffer          *src_buffer,
-                                     const GeglRectangle *src_rect,
-                                     GeglBuffer          *dest_buffer,
-                                     const GeglRectangle *dest_rect,
-                                     gdouble              exposure,
-                                     GimpDodgeBurnType    type,
-                                     GimpTransferMode     mode);
+void     gimp_gegl_dodgeburn           (GeglBuffer          *src_buffer,
+                                        const GeglRectangle *src_rect,
+                                        GeglBuffer          *dest_buffer,
+                                        const GeglRectangle *dest_rect,
+                                        gdouble              exposure,
+                                        GimpDodgeBurnType    type,
+                                        GimpTransferMode     mode);
 
-void   gimp_gegl_smudge_blend       (GeglBuffer          *top_buffer,
-                                     const GeglRectangle *top_rect,
-                                     GeglBuffer          *bottom_buffer,
-                                     const GeglRectangle *bottom_rect,
-                                     GeglBuffer          *dest_buffer,
-                                     const GeglRectangle *dest_rect,
-                                     gdouble              blend);
+void     gimp_gegl_smudge_blend        (GeglBuffer          *top_buffer,
+                                        const GeglRectangle *top_rect,
+                                        GeglBuffer          *bottom_buffer,
+                                        const GeglRectangle *bottom_rect,
+                                        GeglBuffer          *dest_buffer,
+                                        const GeglRectangle *dest_rect,
+                                        GeglBuffer          *copy_buffer,
+                                        const GeglRectangle *copy_rect,
+                                        gdouble              blend);
 
-void   gimp_gegl_apply_mask         (GeglBuffer          *mask_buffer,
-                                     const GeglRectangle *mask_rect,
-                                     GeglBuffer          *dest_buffer,
-                                     const GeglRectangle *dest_rect,
-                                     gdouble              opacity);
+void     gimp_gegl_apply_mask          (GeglBuffer          *mask_buffer,
+                                        const GeglRectangle *mask_rect,
+                                        GeglBuffer          *dest_buffer,
+                                        const GeglRectangle *dest_rect,
+                                        gdouble              opacity);
 
-void   gimp_gegl_combine_mask       (GeglBuffer          *mask_buffer,
-                                     const GeglRectangle *mask_rect,
-                                     GeglBuffer          *dest_buffer,
-                                     const GeglRectangle *dest_rect,
-                                     gdouble              opacity);
+void     gimp_gegl_combine_mask        (GeglBuffer          *mask_buffer,
+                                        const GeglRectangle *mask_rect,
+                                        GeglBuffer          *dest_buffer,
+                                        const GeglRectangle *dest_rect,
+                                        gdouble              opacity);
 
-void   gimp_gegl_combine_mask_weird (GeglBuffer          *mask_buffer,
-                                     const GeglRectangle *mask_rect,
-                                     GeglBuffer          *dest_buffer,
-                                     const GeglRectangle *dest_rect,
-                                     gdouble              opacity,
-                                     gboolean             stipple);
+void     gimp_gegl_combine_mask_weird  (GeglBuffer          *mask_buffer,
+                                        const GeglRectangle *mask_rect,
+                                        GeglBuffer          *dest_buffer,
+                                        const GeglRectangle *dest_rect,
+                                        gdouble              opacity,
+                                        gboolean             stipple);
 
-void   gimp_gegl_replace            (GeglBuffer          *top_buffer,
-                                     const GeglRectangle *top_rect,
-                                     GeglBuffer          *bottom_buffer,
-                                     const GeglRectangle *bottom_rect,
-                                     GeglBuffer          *mask_buffer,
-                                     const GeglRectangle *mask_rect,
-                                     GeglBuffer          *dest_buffer,
-                                     const GeglRectangle *dest_rect,
-                                     gdouble              opacity,
-                                     const gboolean      *affect);
+void     gimp_gegl_replace             (GeglBuffer          *top_buffer,
+                                        const GeglRectangle *top_rect,
+                                        GeglBuffer          *bottom_buffer,
+                                        const GeglRectangle *bottom_rect,
+                                        GeglBuffer          *mask_buffer,
+                                        const GeglRectangle *mask_rect,
+                                        GeglBuffer          *dest_buffer,
+                                        const GeglRectangle *dest_rect,
+                                        gdouble              opacity,
+                                        const gboolean      *affect);
 
 
 #endif /* __GIMP_GEGL_LOOPS_H__ */
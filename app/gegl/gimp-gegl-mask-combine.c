@@ -49,12 +49,19 @@ gimp_gegl_mask_combine_rect (GeglBuffer     *mask,
     return FALSE;
 
   if (op == GIMP_CHANNEL_OP_ADD || op == GIMP_CHANNEL_OP_REPLACE)
-    color = gegl_color_new ("#fff");
-  else
-    color = gegl_color_new ("#000");
+    {
+      color = gegl_color_new ("#fff");
 
-  gegl_buffer_set_color (mask, GEGL_RECTANGLE (x, y, w, h), color);
-  g_object_unref (color);
+      gegl_buffer_set_color (mask, GEGL_RECTANGLE (x, y, w, h), color);
+      g_object_unref (color);
+    }
+  else
+    {
+      /*  clearing lets GEGL drop the fully covered tiles instead of
+       *  filling them with zeros
+       */
+      gegl_buffer_clear (mask, GEGL_RECTANGLE (x, y, w, h));
+    }
 
   return TRUE;
 }
@@ -141,67 +148,27 @@ gimp_gegl_mask_combine_span (gfloat         *data,
     }
 }
 
-/**
- * gimp_gegl_mask_combine_ellipse_rect:
- * @mask:      the channel with which to combine the elliptic rect
- * @op:        whether to replace, add to, or subtract from the current
- *             contents
- * @x:         x coordinate of upper left corner of bounding rect
- * @y:         y coordinate of upper left corner of bounding rect
- * @w:         width of bounding rect
- * @h:         height of bounding rect
- * @a:         elliptic a-constant applied to corners
- * @b:         elliptic b-constant applied to corners
- * @antialias: if %TRUE, antialias the elliptic corners
- *
- * Used for rounded cornered rectangles and ellipses.  If @op is
- * %GIMP_CHANNEL_OP_REPLACE or %GIMP_CHANNEL_OP_ADD, sets pixels
- * within the ellipse to 255.  If @op is %GIMP_CHANNEL_OP_SUBTRACT,
- * sets pixels within to zero.  If @antialias is %TRUE, pixels that
- * impinge on the edge of the ellipse are set to intermediate values,
- * depending on how much they overlap.
- **/
-gboolean
-gimp_gegl_mask_combine_ellipse_rect (GeglBuffer     *mask,
-                                     GimpChannelOps  op,
-                                     gint            x,
-                                     gint            y,
-                                     gint            w,
-                                     gint            h,
-                                     gdouble         a,
-                                     gdouble         b,
-                                     gboolean        antialias)
+static void
+gimp_gegl_mask_combine_ellipse_band (GeglBuffer          *mask,
+                                     GimpChannelOps       op,
+                                     const GeglRectangle *band,
+                                     gint                 x,
+                                     gint                 y,
+                                     gint                 w,
+                                     gint                 h,
+                                     gdouble              a,
+                                     gdouble              b,
+                                     gboolean             antialias)
 {
   GeglBufferIterator *iter;
   GeglRectangle      *roi;
-  gdouble             a_sqr;
-  gdouble             b_sqr;
+  const gdouble       a_sqr = SQR (a);
+  const gdouble       b_sqr = SQR (b);
   gdouble             ellipse_center_x;
-  gint                x0, y0;
-  gint                width, height;
-
-  g_return_val_if_fail (GEGL_IS_BUFFER (mask), FALSE);
-  g_return_val_if_fail (a >= 0.0 && b >= 0.0, FALSE);
-  g_return_val_if_fail (op != GIMP_CHANNEL_OP_INTERSECT, FALSE);
-
-  /* Make sure the elliptic corners fit into the rect */
-  a = MIN (a, w / 2.0);
-  b = MIN (b, h / 2.0);
-
-  a_sqr = SQR (a);
-  b_sqr = SQR (b);
-
-  if (! gimp_rectangle_intersect (x, y, w, h,
-                                  0, 0,
-                                  gegl_buffer_get_width  (mask),
-                                  gegl_buffer_get_height (mask),
-                                  &x0, &y0, &width, &height))
-    return FALSE;
 
   ellipse_center_x = x + a;
 
-  iter = gegl_buffer_iterator_new (mask,
-                                   GEGL_RECTANGLE (x0, y0, width, height), 0,
+  iter = gegl_buffer_iterator_new (mask, band, 0,
                                    babl_format ("Y float"),
                                    GEGL_BUFFER_READWRITE, GEGL_ABYSS_NONE);
   roi = &iter->roi[0];
@@ -363,6 +330,87 @@ gimp_gegl_mask_combine_ellipse_rect (GeglBuffer     *mask,
         }
     }
 
+}
+
+/**
+ * gimp_gegl_mask_combine_ellipse_rect:
+ * @mask:      the channel with which to combine the elliptic rect
+ * @op:        whether to replace, add to, or subtract from the current
+ *             contents
+ * @x:         x coordinate of upper left corner of bounding rect
+ * @y:         y coordinate of upper left corner of bounding rect
+ * @w:         width of bounding rect
+ * @h:         height of bounding rect
+ * @a:         elliptic a-constant applied to corners
+ * @b:         elliptic b-constant applied to corners
+ * @antialias: if %TRUE, antialias the elliptic corners
+ *
+ * Used for rounded cornered rectangles and ellipses.  If @op is
+ * %GIMP_CHANNEL_OP_REPLACE or %GIMP_CHANNEL_OP_ADD, sets pixels
+ * within the ellipse to 255.  If @op is %GIMP_CHANNEL_OP_SUBTRACT,
+ * sets pixels within to zero.  If @antialias is %TRUE, pixels that
+ * impinge on the edge of the ellipse are set to intermediate values,
+ * depending on how much they overlap.
+ **/
+gboolean
+gimp_gegl_mask_combine_ellipse_rect (GeglBuffer     *mask,
+                                     GimpChannelOps  op,
+                                     gint            x,
+                                     gint            y,
+                                     gint            w,
+                                     gint            h,
+                                     gdouble         a,
+                                     gdouble         b,
+                                     gboolean        antialias)
+{
+  gint x0, y0;
+  gint width, height;
+  gint mid_y1, mid_y2;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (mask), FALSE);
+  g_return_val_if_fail (a >= 0.0 && b >= 0.0, FALSE);
+  g_return_val_if_fail (op != GIMP_CHANNEL_OP_INTERSECT, FALSE);
+
+  /* Make sure the elliptic corners fit into the rect */
+  a = MIN (a, w / 2.0);
+  b = MIN (b, h / 2.0);
+
+  if (! gimp_rectangle_intersect (x, y, w, h,
+                                  0, 0,
+                                  gegl_buffer_get_width  (mask),
+                                  gegl_buffer_get_height (mask),
+                                  &x0, &y0, &width, &height))
+    return FALSE;
+
+  /*  the rows between the rounded corners are covered completely,
+   *  fill them like a rectangle, which works on whole tiles, and run
+   *  the per-pixel code only on the rows above and below
+   */
+  mid_y1 = CLAMP ((gint) ceil (y + b),     y0, y0 + height);
+  mid_y2 = CLAMP ((gint) ceil (y + h - b), y0, y0 + height);
+
+  if (mid_y2 > mid_y1)
+    {
+      gimp_gegl_mask_combine_rect (mask, op,
+                                   x0, mid_y1, width, mid_y2 - mid_y1);
+
+      gimp_gegl_mask_combine_ellipse_band (mask, op,
+                                           GEGL_RECTANGLE (x0, y0, width,
+                                                           mid_y1 - y0),
+                                           x, y, w, h, a, b, antialias);
+      gimp_gegl_mask_combine_ellipse_band (mask, op,
+                                           GEGL_RECTANGLE (x0, mid_y2, width,
+                                                           y0 + height - mid_y2),
+                                           x, y, w, h, a, b, antialias);
+    }
+  else
+    {
+      gimp_gegl_mask_combine_ellipse_band (mask, op,
+                                           GEGL_RECTANGLE (x0, y0,
+                                                           width, height),
+                                           x, y, w, h, a, b, antialias);
+    }
+
   return TRUE;
 }
 
@@ -30,9 +30,39 @@ gimp_gegl_mask_bounds (GeglBuffer *buffer,
                        gint        *y1,
                        gint        *x2,
                        gint        *y2)
+{
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), FALSE);
+
+  return gimp_gegl_mask_area_bounds (buffer, NULL, x1, y1, x2, y2);
+}
+
+/**
+ * gimp_gegl_mask_area_bounds:
+ * @buffer: a mask buffer
+ * @area:   the area that contains all non-zero pixels of @buffer,
+ *          or %NULL for the whole buffer
+ * @x1:     return location for the left edge of the bounds
+ * @y1:     return location for the top edge of the bounds
+ * @x2:     return location for the right edge of the bounds
+ * @y2:     return location for the bottom edge of the bounds
+ *
+ * Like gimp_gegl_mask_bounds(), but only looks at the pixels in
+ * @area, which makes keeping the bounds of a mask up to date after
+ * a local change a lot cheaper than scanning the whole mask.
+ *
+ * Returns: %FALSE if the mask is empty
+ **/
+gboolean
+gimp_gegl_mask_area_bounds (GeglBuffer          *buffer,
+                            const GeglRectangle *area,
+                            gint                *x1,
+                            gint                *y1,
+                            gint                *x2,
+                            gint                *y2)
 {
   GeglBufferIterator *iter;
   GeglRectangle      *roi;
+  GeglRectangle       rect;
   gint                tx1, tx2, ty1, ty2;
 
   g_return_val_if_fail (GEGL_IS_BUFFER (buffer), FALSE);
@@ -41,13 +71,28 @@ gimp_gegl_mask_bounds (GeglBuffer *buffer,
   g_return_val_if_fail (x2 != NULL, FALSE);
   g_return_val_if_fail (y2 != NULL, FALSE);
 
+  if (! area)
+    area = gegl_buffer_get_extent (buffer);
+
+  gegl_rectangle_intersect (&rect, area, gegl_buffer_get_extent (buffer));
+
   /*  go through and calculate the bounds  */
-  tx1 = gegl_buffer_get_width  (buffer);
-  ty1 = gegl_buffer_get_height (buffer);
+  tx1 = rect.x + rect.width;
+  ty1 = rect.y + rect.height;
   tx2 = 0;
   ty2 = 0;
 
-  iter = gegl_buffer_iterator_new (buffer, NULL, 0, babl_format ("Y float"),
+  if (rect.width <= 0 || rect.height <= 0)
+    {
+      *x1 = 0;
+      *y1 = 0;
+      *x2 = gegl_buffer_get_width  (buffer);
+      *y2 = gegl_buffer_get_height (buffer);
+
+      return FALSE;
+    }
+
+  iter = gegl_buffer_iterator_new (buffer, &rect, 0, babl_format ("Y float"),
                                    GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
   roi = &iter->roi[0];
 
@@ -106,8 +151,8 @@ gimp_gegl_mask_bounds (GeglBuffer *buffer,
   tx2 = CLAMP (tx2 + 1, 0, gegl_buffer_get_width  (buffer));
   ty2 = CLAMP (ty2 + 1, 0, gegl_buffer_get_height (buffer));
 
-  if (tx1 == gegl_buffer_get_width  (buffer) &&
-      ty1 == gegl_buffer_get_height (buffer))
+  if (tx1 == rect.x + rect.width &&
+      ty1 == rect.y + rect.height)
     {
       *x1 = 0;
       *y1 = 0;
@@ -153,3 +198,58 @@ gimp_gegl_mask_is_empty (GeglBuffer *buffer)
 
   return TRUE;
 }
+
+/**
+ * gimp_gegl_mask_is_uniform:
+ * @buffer: a mask buffer
+ * @area:   the area to look at, or %NULL for the whole buffer
+ * @value:  return location for the value of the pixels
+ *
+ * Checks if all pixels in @area have the same value, which is the
+ * case for large parts of most layer masks.  The scan stops at the
+ * first pixel that differs, so it is much cheaper than processing a
+ * mixed area.
+ *
+ * Returns: %TRUE if @area is uniform
+ **/
+gboolean
+gimp_gegl_mask_is_uniform (GeglBuffer          *buffer,
+                           const GeglRectangle *area,
+                           gfloat              *value)
+{
+  GeglBufferIterator *iter;
+  gboolean            first = TRUE;
+  gfloat              v     = 0.0;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), FALSE);
+  g_return_val_if_fail (value != NULL, FALSE);
+
+  iter = gegl_buffer_iterator_new (buffer, area, 0, babl_format ("Y float"),
+                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gfloat *data = iter->data[0];
+      gint    i;
+
+      if (first)
+        {
+          v     = data[0];
+          first = FALSE;
+        }
+
+      for (i = 0; i < iter->length; i++)
+        {
+          if (data[i] != v)
+            {
+              gegl_buffer_iterator_stop (iter);
+
+              return FALSE;
+            }
+        }
+    }
+
+  *value = v;
+
+  return TRUE;
+}
@@ -19,12 +19,21 @@
 #define __GIMP_GEGL_MASK_H__
 
 
-gboolean   gimp_gegl_mask_bounds   (GeglBuffer *buffer,
-                                    gint        *x1,
-                                    gint        *y1,
-                                    gint        *x2,
-                                    gint        *y2);
-gboolean   gimp_gegl_mask_is_empty (GeglBuffer *buffer);
+gboolean   gimp_gegl_mask_bounds      (GeglBuffer          *buffer,
+                                       gint                *x1,
+                                       gint                *y1,
+                                       gint                *x2,
+                                       gint                *y2);
+gboolean   gimp_gegl_mask_area_bounds (GeglBuffer          *buffer,
+                                       const GeglRectangle *area,
+                                       gint                *x1,
+                                       gint                *y1,
+                                       gint                *x2,
+                                       gint                *y2);
+gboolean   gimp_gegl_mask_is_empty    (GeglBuffer          *buffer);
+gboolean   gimp_gegl_mask_is_uniform  (GeglBuffer          *buffer,
+                                       const GeglRectangle *area,
+                                       gfloat              *value);
 
 
 #endif /* __GIMP_GEGL_MASK_H__ */
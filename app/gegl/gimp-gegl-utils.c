@@ -124,3 +124,38 @@ gimp_gegl_progress_connect (GeglNode     *node,
 
   g_object_unref (operation);
 }
+
+/*  returns a copy of @rect of @buffer, with its origin at 0, 0.  the
+ *  copy's tile grid is shifted onto the one of @buffer, so the tiles
+ *  are shared copy-on-write instead of having their pixels copied
+ */
+GeglBuffer *
+gimp_gegl_buffer_dup_rect (GeglBuffer          *buffer,
+                           const GeglRectangle *rect)
+{
+  GeglBuffer *dup;
+  gint        shift_x;
+  gint        shift_y;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (rect != NULL, NULL);
+
+  g_object_get (buffer,
+                "shift-x", &shift_x,
+                "shift-y", &shift_y,
+                NULL);
+
+  dup = g_object_new (GEGL_TYPE_BUFFER,
+                      "format",  gegl_buffer_get_format (buffer),
+                      "x",       0,
+                      "y",       0,
+                      "width",   rect->width,
+                      "height",  rect->height,
+                      "shift-x", shift_x + rect->x,
+                      "shift-y", shift_y + rect->y,
+                      NULL);
+
+  gegl_buffer_copy (buffer, rect, dup, GEGL_RECTANGLE (0, 0, 0, 0));
+
+  return dup;
+}
@@ -31,5 +31,8 @@ void          gimp_gegl_progress_connect        (GeglNode              *node,
                                                  GimpProgress          *progress,
                                                  const gchar           *text);
 
+GeglBuffer  * gimp_gegl_buffer_dup_rect         (GeglBuffer            *buffer,
+                                                 const GeglRectangle   *rect);
+
 
 #endif /* __GIMP_GEGL_UTILS_H__ */
@@ -29,14 +29,30 @@
 #include "operations/gimp-operations.h"
 
 #include "core/gimp.h"
+#include "core/gimp-utils.h"
 
 #include "gimp-babl.h"
 #include "gimp-gegl.h"
 
 
-static void  gimp_gegl_notify_tile_cache_size (GimpGeglConfig *config);
-static void  gimp_gegl_notify_num_processors  (GimpGeglConfig *config);
-static void  gimp_gegl_notify_use_opencl      (GimpGeglConfig *config);
+/*  how often the automatic values are re-evaluated, in seconds  */
+#define AUTO_TUNE_INTERVAL   5
+
+/*  the smallest automatic tile cache  */
+#define AUTO_TUNE_MIN_CACHE  ((guint64) 256 << 20)
+
+
+static void      gimp_gegl_notify_tile_cache_size (GimpGeglConfig *config);
+static void      gimp_gegl_notify_num_processors  (GimpGeglConfig *config);
+static void      gimp_gegl_notify_use_opencl      (GimpGeglConfig *config);
+static void      gimp_gegl_notify_swap_compression (GimpGeglConfig *config);
+static void      gimp_gegl_notify_auto            (GimpGeglConfig *config);
+
+static gboolean  gimp_gegl_auto_tune              (GimpGeglConfig *config);
+static guint64   gimp_gegl_auto_tile_cache_size   (GimpGeglConfig *config);
+
+
+static guint auto_tune_id = 0;
 
 
 void
@@ -77,12 +93,40 @@ gimp_gegl_init (Gimp *gimp)
   g_signal_connect (config, "notify::use-opencl",
                     G_CALLBACK (gimp_gegl_notify_use_opencl),
                     NULL);
+  g_signal_connect (config, "notify::swap-compression",
+                    G_CALLBACK (gimp_gegl_notify_swap_compression),
+                    NULL);
+  g_signal_connect (config, "notify::tile-cache-size-auto",
+                    G_CALLBACK (gimp_gegl_notify_auto),
+                    NULL);
+  g_signal_connect (config, "notify::num-processors-auto",
+                    G_CALLBACK (gimp_gegl_notify_auto),
+                    NULL);
+
+  gimp_gegl_notify_swap_compression (config);
+  gimp_gegl_notify_auto (config);
 
   gimp_babl_init ();
 
   gimp_operations_init ();
 }
 
+void
+gimp_gegl_exit (Gimp *gimp)
+{
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  g_signal_handlers_disconnect_by_func (gimp->config,
+                                        gimp_gegl_notify_auto,
+                                        NULL);
+
+  if (auto_tune_id)
+    {
+      g_source_remove (auto_tune_id);
+      auto_tune_id = 0;
+    }
+}
+
 static void
 gimp_gegl_notify_tile_cache_size (GimpGeglConfig *config)
 {
@@ -108,3 +152,140 @@ gimp_gegl_notify_use_opencl (GimpGeglConfig *config)
                 "use-opencl", config->use_opencl,
                 NULL);
 }
+
+static void
+gimp_gegl_notify_swap_compression (GimpGeglConfig *config)
+{
+  GParamSpec *pspec;
+
+  /*  GEGL compresses the tiles it swaps out since 0.4.14, older
+   *  versions don't have the property
+   */
+  pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (gegl_config ()),
+                                        "swap-compression");
+
+  if (pspec && G_IS_PARAM_SPEC_STRING (pspec))
+    g_object_set (gegl_config (),
+                  "swap-compression",
+                  config->swap_compression ? "fast" : "none",
+                  NULL);
+}
+
+static void
+gimp_gegl_notify_auto (GimpGeglConfig *config)
+{
+  gboolean active = (config->tile_cache_size_auto ||
+                     config->num_processors_auto);
+
+  if (active)
+    {
+      gimp_gegl_auto_tune (config);
+
+      if (! auto_tune_id)
+        auto_tune_id = g_timeout_add_seconds (AUTO_TUNE_INTERVAL,
+                                              (GSourceFunc) gimp_gegl_auto_tune,
+                                              config);
+    }
+  else if (auto_tune_id)
+    {
+      g_source_remove (auto_tune_id);
+      auto_tune_id = 0;
+    }
+}
+
+/*  sets the automatic values on the config, the notify handlers
+ *  then apply them like values set by the user
+ */
+static gboolean
+gimp_gegl_auto_tune (GimpGeglConfig *config)
+{
+  if (config->tile_cache_size_auto)
+    {
+      guint64 size = gimp_gegl_auto_tile_cache_size (config);
+
+      if (size && size != config->tile_cache_size)
+        g_object_set (config,
+                      "tile-cache-size", size,
+                      NULL);
+    }
+
+  if (config->num_processors_auto)
+    {
+      GParamSpec *pspec;
+      guint       n_processors;
+
+      /*  processors can go on- and offline  */
+      pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (config),
+                                            "num-processors");
+
+      n_processors = CLAMP (g_get_num_processors (),
+                            G_PARAM_SPEC_UINT (pspec)->minimum,
+                            G_PARAM_SPEC_UINT (pspec)->maximum);
+
+      if (n_processors != config->num_processors)
+        g_object_set (config,
+                      "num-processors", n_processors,
+                      NULL);
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+/*  returns the new automatic tile cache size, or 0 to keep the
+ *  current one
+ */
+static guint64
+gimp_gegl_auto_tile_cache_size (GimpGeglConfig *config)
+{
+  GParamSpec *pspec;
+  guint64     physical;
+  guint64     available;
+  guint64     used;
+  guint64     reserve;
+  guint64     size;
+
+  physical = gimp_get_physical_memory_size ();
+
+  if (! physical)
+    return 0;
+
+  pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (config),
+                                        "tile-cache-size");
+
+  available = gimp_get_available_memory_size ();
+
+#ifdef HAVE_GEGL_STATS
+  g_object_get (gegl_stats (),
+                "tile-cache-total", &used,
+                NULL);
+#else
+  /*  assume the worst, a full cache  */
+  used = config->tile_cache_size;
+#endif
+
+  /*  never take the last eighth of the memory from the system  */
+  reserve = physical / 8;
+
+  /*  the cache may grow into what is available now, or has to give
+   *  back what the system is short of, but it never takes more than
+   *  three quarters of the memory
+   */
+  if (available)
+    size = MAX (used + available, reserve) - reserve;
+  else
+    size = physical / 2;
+
+  size = MIN (size, physical / 4 * 3);
+  size = MAX (size, AUTO_TUNE_MIN_CACHE);
+  size = MIN (size, G_PARAM_SPEC_UINT64 (pspec)->maximum);
+
+  /*  round to megabytes, and don't bother GEGL with small changes  */
+  size &= ~(((guint64) 1 << 20) - 1);
+
+  if (size > config->tile_cache_size - MIN (config->tile_cache_size,
+                                            physical / 32) &&
+      size < config->tile_cache_size + physical / 32)
+    return 0;
+
+  return size;
+}
@@ -24,9 +24,13 @@
 
 #include "gimp-gegl-types.h"
 
+#include "operations/gimplayermodefunctions.h"
+
 #include "gimp-gegl-nodes.h"
 #include "gimpapplicator.h"
 
+#include "gimp-trace.h"
+
 
 static void   gimp_applicator_finalize     (GObject      *object);
 static void   gimp_applicator_set_property (GObject      *object,
@@ -38,6 +42,9 @@ static void   gimp_applicator_get_property (GObject      *object,
                                             GValue       *value,
                                             GParamSpec   *pspec);
 
+static void   gimp_applicator_blit_direct  (GimpApplicator      *applicator,
+                                            const GeglRectangle *rect);
+
 
 G_DEFINE_TYPE (GimpApplicator, gimp_applicator, G_TYPE_OBJECT)
 
@@ -414,8 +421,24 @@ void
 gimp_applicator_blit (GimpApplicator      *applicator,
                       const GeglRectangle *rect)
 {
-  gegl_node_blit (applicator->dest_node, 1.0, rect,
-                  NULL, NULL, 0, GEGL_BLIT_DEFAULT);
+  GIMP_TRACE_BEGIN ("applicator-blit");
+
+  /*  when all inputs and the output are plain buffers, skip the graph
+   *  and run mode, opacity, mask and affect in a single pass
+   */
+  if (applicator->src_buffer   &&
+      applicator->dest_buffer  &&
+      applicator->apply_buffer)
+    {
+      gimp_applicator_blit_direct (applicator, rect);
+    }
+  else
+    {
+      gegl_node_blit (applicator->dest_node, 1.0, rect,
+                      NULL, NULL, 0, GEGL_BLIT_DEFAULT);
+    }
+
+  GIMP_TRACE_END ();
 }
 
 GeglBuffer *
@@ -457,3 +480,77 @@ gimp_applicator_dup_apply_buffer (GimpApplicator      *applicator,
 
   return buffer;
 }
+
+
+/*  private functions  */
+
+static void
+gimp_applicator_blit_direct (GimpApplicator      *applicator,
+                             const GeglRectangle *rect)
+{
+  GimpLayerModeFunction  apply_func;
+  const Babl            *format;
+  GeglBufferIterator    *iter;
+  GeglRectangle          apply_roi;
+  GeglRectangle          mask_roi;
+  GimpComponentMask      affect = applicator->affect;
+
+  apply_func = get_layer_mode_function (applicator->paint_mode);
+
+  if (applicator->linear)
+    format = babl_format ("RGBA float");
+  else
+    format = babl_format ("R'G'B'A float");
+
+  apply_roi = *rect;
+  apply_roi.x -= applicator->apply_offset_x;
+  apply_roi.y -= applicator->apply_offset_y;
+
+  mask_roi = *rect;
+  mask_roi.x -= applicator->mask_offset_x;
+  mask_roi.y -= applicator->mask_offset_y;
+
+  iter = gegl_buffer_iterator_new (applicator->dest_buffer, rect, 0,
+                                   format,
+                                   GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
+
+  gegl_buffer_iterator_add (iter, applicator->src_buffer, rect, 0,
+                            format,
+                            GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+
+  gegl_buffer_iterator_add (iter, applicator->apply_buffer, &apply_roi, 0,
+                            format,
+                            GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+
+  if (applicator->mask_buffer)
+    gegl_buffer_iterator_add (iter, applicator->mask_buffer, &mask_roi, 0,
+                              babl_format ("Y float"),
+                              GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      gfloat *out   = iter->data[0];
+      gfloat *in    = iter->data[1];
+      gfloat *aux   = iter->data[2];
+      gfloat *mask  = applicator->mask_buffer ? iter->data[3] : NULL;
+
+      apply_func (in, aux, mask, out,
+                  applicator->opacity, iter->length, &iter->roi[0], 0);
+
+      if (affect != GIMP_COMPONENT_ALL)
+        {
+          gint i;
+
+          for (i = 0; i < iter->length; i++)
+            {
+              if (! (affect & GIMP_COMPONENT_RED))   out[0] = in[0];
+              if (! (affect & GIMP_COMPONENT_GREEN)) out[1] = in[1];
+              if (! (affect & GIMP_COMPONENT_BLUE))  out[2] = in[2];
+              if (! (affect & GIMP_COMPONENT_ALPHA)) out[3] = in[3];
+
+              in  += 4;
+              out += 4;
+            }
+        }
+    }
+}
@@ -0,0 +1,692 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpcompressedbuffer.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+#include <gegl.h>
+
+#include "gimp-gegl-types.h"
+
+#include "core/gimp-parallel.h"
+
+#include "gimpcompressedbuffer.h"
+
+
+/*  a buffer's pixels, stored as separately deflated tiles.  before
+ *  compression, the bytes of each tile are split into planes (all
+ *  first bytes of the pixels, all second bytes, ...), and every plane
+ *  is delta-encoded, which turns the smooth gradients and mostly
+ *  constant high bytes of high bit depth data into runs of small
+ *  values.
+ *
+ *  the tile data can be moved to a file in the swap directory by a
+ *  background thread, and is read back from there when the buffer
+ *  is decompressed
+ */
+
+
+#define TILE_SIZE         64
+#define COMPRESSION_LEVEL 1
+
+
+typedef struct
+{
+  GeglRectangle  rect;
+  guint8        *data;
+  gsize          size;
+  goffset        offset;
+  gboolean       compressed;
+} GimpCompressedTile;
+
+struct _GimpCompressedBuffer
+{
+  gint                ref_count;
+
+  const Babl         *format;
+  gint                width;
+  gint                height;
+  gint                n_tiles_x;
+  gint                n_tiles;
+  GimpCompressedTile *tiles;
+
+  /*  protects the tile data against being swapped out while it is
+   *  decompressed
+   */
+  GMutex              mutex;
+  gboolean            swap_queued;
+  gchar              *swap_file;
+};
+
+typedef struct
+{
+  GimpCompressedBuffer *compressed;
+  GeglBuffer           *buffer;
+} GimpCompressedBufferData;
+
+typedef struct
+{
+  GimpCompressedBuffer *compressed;
+  gchar                *swap_dir;
+} GimpCompressedBufferSwap;
+
+
+/*  local function prototypes  */
+
+static void     gimp_compressed_buffer_unref            (GimpCompressedBuffer     *compressed);
+
+static void     gimp_compressed_buffer_swap_func        (GimpCompressedBufferSwap *swap,
+                                                         gpointer                  user_data);
+static gboolean gimp_compressed_buffer_write_tiles      (GimpCompressedBuffer     *compressed,
+                                                         const gchar              *filename);
+
+static void     gimp_compressed_buffer_compress_tiles   (gsize                     offset,
+                                                         gsize                     size,
+                                                         GimpCompressedBufferData *data);
+static void     gimp_compressed_buffer_decompress_tiles (gsize                     offset,
+                                                         gsize                     size,
+                                                         GimpCompressedBufferData *data);
+
+static void     gimp_compressed_buffer_filter           (const guint8             *src,
+                                                         guint8                   *dest,
+                                                         gint                      n_pixels,
+                                                         gint                      bpp);
+static void     gimp_compressed_buffer_unfilter         (const guint8             *src,
+                                                         guint8                   *dest,
+                                                         gint                      n_pixels,
+                                                         gint                      bpp);
+
+static guint8 * gimp_compressed_buffer_deflate          (const guint8             *src,
+                                                         gsize                     src_size,
+                                                         gsize                    *dest_size);
+static gboolean gimp_compressed_buffer_inflate          (const guint8             *src,
+                                                         gsize                     src_size,
+                                                         guint8                   *dest,
+                                                         gsize                     dest_size);
+
+
+/*  a single thread writes the buffers to disk one after the other,
+ *  so swapping out never competes with the painting and rendering
+ *  threads for more than one core
+ */
+static GThreadPool *swap_pool = NULL;
+
+
+/*  public functions  */
+
+GimpCompressedBuffer *
+gimp_compressed_buffer_new (GeglBuffer *buffer)
+{
+  GimpCompressedBuffer     *compressed;
+  GimpCompressedBufferData  data;
+  gint                      n_tiles_y;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+
+  compressed = g_slice_new0 (GimpCompressedBuffer);
+
+  compressed->ref_count = 1;
+
+  g_mutex_init (&compressed->mutex);
+
+  compressed->format    = gegl_buffer_get_format (buffer);
+  compressed->width     = gegl_buffer_get_width  (buffer);
+  compressed->height    = gegl_buffer_get_height (buffer);
+  compressed->n_tiles_x = (compressed->width + TILE_SIZE - 1) / TILE_SIZE;
+  n_tiles_y             = (compressed->height + TILE_SIZE - 1) / TILE_SIZE;
+  compressed->n_tiles   = compressed->n_tiles_x * n_tiles_y;
+  compressed->tiles     = g_new0 (GimpCompressedTile, compressed->n_tiles);
+
+  data.compressed = compressed;
+  data.buffer     = buffer;
+
+  gimp_parallel_distribute_range (compressed->n_tiles, 4,
+                                  (GimpParallelDistributeRangeFunc)
+                                  gimp_compressed_buffer_compress_tiles,
+                                  &data);
+
+  return compressed;
+}
+
+void
+gimp_compressed_buffer_free (GimpCompressedBuffer *compressed)
+{
+  g_return_if_fail (compressed != NULL);
+
+  /*  a pending swap out keeps its own reference  */
+  gimp_compressed_buffer_unref (compressed);
+}
+
+/*  queues the tile data to be written to a file in swap_dir, it is
+ *  dropped from memory once the write succeeded
+ */
+void
+gimp_compressed_buffer_swap_out (GimpCompressedBuffer *compressed,
+                                 const gchar          *swap_dir)
+{
+  GimpCompressedBufferSwap *swap;
+
+  g_return_if_fail (compressed != NULL);
+  g_return_if_fail (swap_dir != NULL);
+
+  g_mutex_lock (&compressed->mutex);
+
+  if (compressed->swap_queued || compressed->swap_file)
+    {
+      g_mutex_unlock (&compressed->mutex);
+      return;
+    }
+
+  compressed->swap_queued = TRUE;
+
+  g_mutex_unlock (&compressed->mutex);
+
+  if (! swap_pool)
+    swap_pool = g_thread_pool_new ((GFunc) gimp_compressed_buffer_swap_func,
+                                   NULL, 1, FALSE, NULL);
+
+  swap = g_slice_new (GimpCompressedBufferSwap);
+
+  swap->compressed = compressed;
+  swap->swap_dir   = g_strdup (swap_dir);
+
+  g_atomic_int_inc (&compressed->ref_count);
+
+  g_thread_pool_push (swap_pool, swap, NULL);
+}
+
+GeglBuffer *
+gimp_compressed_buffer_decompress (const GimpCompressedBuffer *compressed)
+{
+  GimpCompressedBufferData data;
+
+  g_return_val_if_fail (compressed != NULL, NULL);
+
+  data.compressed = (GimpCompressedBuffer *) compressed;
+  data.buffer     = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                                     compressed->width,
+                                                     compressed->height),
+                                     compressed->format);
+
+  g_mutex_lock (&data.compressed->mutex);
+
+  gimp_parallel_distribute_range (compressed->n_tiles, 4,
+                                  (GimpParallelDistributeRangeFunc)
+                                  gimp_compressed_buffer_decompress_tiles,
+                                  &data);
+
+  g_mutex_unlock (&data.compressed->mutex);
+
+  return data.buffer;
+}
+
+const Babl *
+gimp_compressed_buffer_get_format (const GimpCompressedBuffer *compressed)
+{
+  g_return_val_if_fail (compressed != NULL, NULL);
+
+  return compressed->format;
+}
+
+gint
+gimp_compressed_buffer_get_width (const GimpCompressedBuffer *compressed)
+{
+  g_return_val_if_fail (compressed != NULL, 0);
+
+  return compressed->width;
+}
+
+gint
+gimp_compressed_buffer_get_height (const GimpCompressedBuffer *compressed)
+{
+  g_return_val_if_fail (compressed != NULL, 0);
+
+  return compressed->height;
+}
+
+/*  tile data which is on disk doesn't count, but tile data which is
+ *  only queued to be written there is still in memory
+ */
+gint64
+gimp_compressed_buffer_get_memsize (const GimpCompressedBuffer *compressed)
+{
+  GimpCompressedBuffer *buffer = (GimpCompressedBuffer *) compressed;
+  gint64                memsize;
+
+  g_return_val_if_fail (compressed != NULL, 0);
+
+  memsize = (sizeof (GimpCompressedBuffer) +
+             compressed->n_tiles * sizeof (GimpCompressedTile));
+
+  g_mutex_lock (&buffer->mutex);
+
+  if (! buffer->swap_file)
+    {
+      gint i;
+
+      for (i = 0; i < compressed->n_tiles; i++)
+        memsize += compressed->tiles[i].size;
+    }
+
+  g_mutex_unlock (&buffer->mutex);
+
+  return memsize;
+}
+
+/*  returns the size of the swap file, or 0 if the tile data is in
+ *  memory
+ */
+gint64
+gimp_compressed_buffer_get_swap_size (const GimpCompressedBuffer *compressed)
+{
+  GimpCompressedBuffer *buffer    = (GimpCompressedBuffer *) compressed;
+  gint64                swap_size = 0;
+
+  g_return_val_if_fail (compressed != NULL, 0);
+
+  g_mutex_lock (&buffer->mutex);
+
+  if (buffer->swap_file)
+    {
+      gint i;
+
+      for (i = 0; i < compressed->n_tiles; i++)
+        swap_size += compressed->tiles[i].size;
+    }
+
+  g_mutex_unlock (&buffer->mutex);
+
+  return swap_size;
+}
+
+
+/*  private functions  */
+
+static void
+gimp_compressed_buffer_unref (GimpCompressedBuffer *compressed)
+{
+  gint i;
+
+  if (! g_atomic_int_dec_and_test (&compressed->ref_count))
+    return;
+
+  for (i = 0; i < compressed->n_tiles; i++)
+    g_free (compressed->tiles[i].data);
+
+  g_free (compressed->tiles);
+
+  if (compressed->swap_file)
+    {
+      g_unlink (compressed->swap_file);
+      g_free (compressed->swap_file);
+    }
+
+  g_mutex_clear (&compressed->mutex);
+
+  g_slice_free (GimpCompressedBuffer, compressed);
+}
+
+static void
+gimp_compressed_buffer_swap_func (GimpCompressedBufferSwap *swap,
+                                  gpointer                  user_data)
+{
+  GimpCompressedBuffer *compressed = swap->compressed;
+
+  /*  don't bother if the owner dropped the buffer meanwhile  */
+  if (g_atomic_int_get (&compressed->ref_count) > 1)
+    {
+      gchar *filename;
+      gint   fd;
+
+      filename = g_build_filename (swap->swap_dir, "gimp-undo-XXXXXX", NULL);
+
+      fd = g_mkstemp (filename);
+
+      if (fd != -1)
+        {
+          g_close (fd, NULL);
+
+          /*  the tile data never changes, so it can be written without
+           *  holding the lock
+           */
+          if (gimp_compressed_buffer_write_tiles (compressed, filename))
+            {
+              gint i;
+
+              g_mutex_lock (&compressed->mutex);
+
+              for (i = 0; i < compressed->n_tiles; i++)
+                {
+                  g_free (compressed->tiles[i].data);
+                  compressed->tiles[i].data = NULL;
+                }
+
+              compressed->swap_file = filename;
+              filename              = NULL;
+
+              g_mutex_unlock (&compressed->mutex);
+            }
+          else
+            {
+              g_unlink (filename);
+            }
+        }
+      else
+        {
+          g_printerr ("%s: cannot create swap file in '%s'\n",
+                      G_STRFUNC, swap->swap_dir);
+        }
+
+      g_free (filename);
+    }
+
+  g_mutex_lock (&compressed->mutex);
+  compressed->swap_queued = FALSE;
+  g_mutex_unlock (&compressed->mutex);
+
+  gimp_compressed_buffer_unref (compressed);
+
+  g_free (swap->swap_dir);
+  g_slice_free (GimpCompressedBufferSwap, swap);
+}
+
+static gboolean
+gimp_compressed_buffer_write_tiles (GimpCompressedBuffer *compressed,
+                                    const gchar          *filename)
+{
+  FILE    *file;
+  goffset  offset = 0;
+  gboolean success = TRUE;
+  gint     i;
+
+  file = g_fopen (filename, "wb");
+
+  if (! file)
+    return FALSE;
+
+  for (i = 0; i < compressed->n_tiles && success; i++)
+    {
+      GimpCompressedTile *tile = &compressed->tiles[i];
+
+      tile->offset = offset;
+
+      success = (fwrite (tile->data, 1, tile->size, file) == tile->size);
+
+      offset += tile->size;
+    }
+
+  if (fclose (file) != 0)
+    success = FALSE;
+
+  return success;
+}
+
+static void
+gimp_compressed_buffer_compress_tiles (gsize                     offset,
+                                       gsize                     size,
+                                       GimpCompressedBufferData *data)
+{
+  GimpCompressedBuffer *compressed = data->compressed;
+  const gint            bpp        = babl_format_get_bytes_per_pixel (compressed->format);
+  guint8               *pixels     = g_malloc (TILE_SIZE * TILE_SIZE * bpp);
+  guint8               *filtered   = g_malloc (TILE_SIZE * TILE_SIZE * bpp);
+  gsize                 i;
+
+  for (i = offset; i < offset + size; i++)
+    {
+      GimpCompressedTile *tile = &compressed->tiles[i];
+      gsize               raw_size;
+
+      tile->rect.x      = (i % compressed->n_tiles_x) * TILE_SIZE;
+      tile->rect.y      = (i / compressed->n_tiles_x) * TILE_SIZE;
+      tile->rect.width  = MIN (TILE_SIZE, compressed->width  - tile->rect.x);
+      tile->rect.height = MIN (TILE_SIZE, compressed->height - tile->rect.y);
+
+      raw_size = tile->rect.width * tile->rect.height * bpp;
+
+      gegl_buffer_get (data->buffer, &tile->rect, 1.0, compressed->format,
+                       pixels, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      gimp_compressed_buffer_filter (pixels, filtered,
+                                     tile->rect.width * tile->rect.height, bpp);
+
+      tile->data = gimp_compressed_buffer_deflate (filtered, raw_size,
+                                                   &tile->size);
+
+      if (tile->data)
+        {
+          tile->compressed = TRUE;
+        }
+      else
+        {
+          /*  incompressible, keep the plain pixels  */
+          tile->data       = g_memdup (pixels, raw_size);
+          tile->size       = raw_size;
+          tile->compressed = FALSE;
+        }
+    }
+
+  g_free (filtered);
+  g_free (pixels);
+}
+
+static void
+gimp_compressed_buffer_decompress_tiles (gsize                     offset,
+                                         gsize                     size,
+                                         GimpCompressedBufferData *data)
+{
+  GimpCompressedBuffer *compressed = data->compressed;
+  const gint            bpp        = babl_format_get_bytes_per_pixel (compressed->format);
+  guint8               *pixels     = g_malloc (TILE_SIZE * TILE_SIZE * bpp);
+  guint8               *filtered   = g_malloc (TILE_SIZE * TILE_SIZE * bpp);
+  guint8               *swapped    = NULL;
+  FILE                 *file       = NULL;
+  gsize                 i;
+
+  if (compressed->swap_file)
+    {
+      file = g_fopen (compressed->swap_file, "rb");
+
+      if (! file)
+        {
+          g_warning ("%s: cannot open swap file '%s'",
+                     G_STRFUNC, compressed->swap_file);
+          goto out;
+        }
+
+      swapped = g_malloc (TILE_SIZE * TILE_SIZE * bpp);
+    }
+
+  for (i = offset; i < offset + size; i++)
+    {
+      const GimpCompressedTile *tile     = &compressed->tiles[i];
+      const gint                n_pixels = tile->rect.width * tile->rect.height;
+      const guint8             *src      = tile->data;
+
+      if (file)
+        {
+          /*  compressed tiles are never larger than the plain pixels  */
+          if (fseek (file, tile->offset, SEEK_SET) != 0 ||
+              fread (swapped, 1, tile->size, file) != tile->size)
+            {
+              g_warning ("%s: cannot read tile at %d, %d from swap",
+                         G_STRFUNC, tile->rect.x, tile->rect.y);
+              continue;
+            }
+
+          src = swapped;
+        }
+
+      if (tile->compressed)
+        {
+          if (! gimp_compressed_buffer_inflate (src, tile->size,
+                                                filtered, n_pixels * bpp))
+            {
+              g_warning ("%s: corrupt tile at %d, %d",
+                         G_STRFUNC, tile->rect.x, tile->rect.y);
+              continue;
+            }
+
+          gimp_compressed_buffer_unfilter (filtered, pixels, n_pixels, bpp);
+
+          gegl_buffer_set (data->buffer, &tile->rect, 0, compressed->format,
+                           pixels, GEGL_AUTO_ROWSTRIDE);
+        }
+      else
+        {
+          gegl_buffer_set (data->buffer, &tile->rect, 0, compressed->format,
+                           src, GEGL_AUTO_ROWSTRIDE);
+        }
+    }
+
+  if (file)
+    fclose (file);
+
+  g_free (swapped);
+
+ out:
+  g_free (filtered);
+  g_free (pixels);
+}
+
+static void
+gimp_compressed_buffer_filter (const guint8 *src,
+                               guint8       *dest,
+                               gint          n_pixels,
+                               gint          bpp)
+{
+  gint b;
+
+  for (b = 0; b < bpp; b++)
+    {
+      const guint8 *s    = src + b;
+      guint8        prev = 0;
+      gint          i;
+
+      for (i = 0; i < n_pixels; i++, s += bpp)
+        {
+          *dest++ = *s - prev;
+          prev    = *s;
+        }
+    }
+}
+
+static void
+gimp_compressed_buffer_unfilter (const guint8 *src,
+                                 guint8       *dest,
+                                 gint          n_pixels,
+                                 gint          bpp)
+{
+  gint b;
+
+  for (b = 0; b < bpp; b++)
+    {
+      guint8 *d    = dest + b;
+      guint8  prev = 0;
+      gint    i;
+
+      for (i = 0; i < n_pixels; i++, d += bpp)
+        {
+          prev += *src++;
+          *d    = prev;
+        }
+    }
+}
+
+/*  returns NULL if the data doesn't get smaller  */
+static guint8 *
+gimp_compressed_buffer_deflate (const guint8 *src,
+                                gsize         src_size,
+                                gsize        *dest_size)
+{
+  GConverter      *converter;
+  GConverterResult result;
+  guint8          *dest      = g_malloc (src_size);
+  gsize            n_read    = 0;
+  gsize            n_written = 0;
+
+  converter = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW,
+                                                  COMPRESSION_LEVEL));
+
+  do
+    {
+      gsize bytes_read;
+      gsize bytes_written;
+
+      result = g_converter_convert (converter,
+                                    src  + n_read,    src_size - n_read,
+                                    dest + n_written, src_size - n_written,
+                                    G_CONVERTER_INPUT_AT_END,
+                                    &bytes_read, &bytes_written, NULL);
+
+      n_read    += bytes_read;
+      n_written += bytes_written;
+    }
+  while (result == G_CONVERTER_CONVERTED && n_written < src_size);
+
+  g_object_unref (converter);
+
+  if (result != G_CONVERTER_FINISHED)
+    {
+      g_free (dest);
+
+      return NULL;
+    }
+
+  *dest_size = n_written;
+
+  return g_realloc (dest, n_written);
+}
+
+static gboolean
+gimp_compressed_buffer_inflate (const guint8 *src,
+                                gsize         src_size,
+                                guint8       *dest,
+                                gsize         dest_size)
+{
+  GConverter      *converter;
+  GConverterResult result;
+  gsize            n_read    = 0;
+  gsize            n_written = 0;
+
+  converter = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_RAW));
+
+  do
+    {
+      gsize bytes_read;
+      gsize bytes_written;
+
+      result = g_converter_convert (converter,
+                                    src  + n_read,    src_size  - n_read,
+                                    dest + n_written, dest_size - n_written,
+                                    G_CONVERTER_INPUT_AT_END,
+                                    &bytes_read, &bytes_written, NULL);
+
+      n_read    += bytes_read;
+      n_written += bytes_written;
+    }
+  while (result == G_CONVERTER_CONVERTED);
+
+  g_object_unref (converter);
+
+  return result == G_CONVERTER_FINISHED && n_written == dest_size;
+}
@@ -0,0 +1,40 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpcompressedbuffer.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_COMPRESSED_BUFFER_H__
+#define __GIMP_COMPRESSED_BUFFER_H__
+
+
+GimpCompressedBuffer * gimp_compressed_buffer_new           (GeglBuffer                 *buffer);
+void                   gimp_compressed_buffer_free          (GimpCompressedBuffer       *compressed);
+
+void                   gimp_compressed_buffer_swap_out      (GimpCompressedBuffer       *compressed,
+                                                             const gchar                *swap_dir);
+
+GeglBuffer           * gimp_compressed_buffer_decompress    (const GimpCompressedBuffer *compressed);
+
+const Babl           * gimp_compressed_buffer_get_format    (const GimpCompressedBuffer *compressed);
+gint                   gimp_compressed_buffer_get_width     (const GimpCompressedBuffer *compressed);
+gint                   gimp_compressed_buffer_get_height    (const GimpCompressedBuffer *compressed);
+
+gint64                 gimp_compressed_buffer_get_memsize   (const GimpCompressedBuffer *compressed);
+gint64                 gimp_compressed_buffer_get_swap_size (const GimpCompressedBuffer *compressed);
+
+
+#endif /* __GIMP_COMPRESSED_BUFFER_H__ */
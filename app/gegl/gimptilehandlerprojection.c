@@ -17,13 +17,28 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <cairo.h>
 #include <gegl.h>
 
 #include "gimp-gegl-types.h"
 
+#include "gimp-babl.h"
+#include "gimp-gegl-loops.h"
 #include "gimptilehandlerprojection.h"
 
+#include "gimp-trace.h"
+
+
+/*  the dirty quadrants of pyramid tiles are kept in a hash table keyed
+ *  on the tile's coordinates, with one bit for each quadrant
+ */
+#define MIPMAP_KEY(x, y, z) (((gint64) (z) << 56)              | \
+                             ((gint64) ((x) & 0x0fffffff) << 28) | \
+                             ((gint64) ((y) & 0x0fffffff)))
+#define QUADRANT_BIT(qx, qy) (1 << ((qy) * 2 + (qx)))
+
 
 enum
 {
@@ -51,6 +66,18 @@ static gpointer gimp_tile_handler_projection_command      (GeglTileSource  *sour
                                                            gint             z,
                                                            gpointer         data);
 
+static GeglTile * gimp_tile_handler_projection_validate_mipmap
+                                                          (GeglTileSource  *source,
+                                                           GeglTile        *tile,
+                                                           gint             x,
+                                                           gint             y,
+                                                           gint             z);
+static gboolean gimp_tile_handler_projection_downscale    (GimpTileHandlerProjection *projection,
+                                                           guchar          *dest,
+                                                           const guchar    *src);
+static gboolean gimp_tile_handler_projection_can_downscale
+                                                          (GimpTileHandlerProjection *projection);
+
 static void     gimp_tile_handler_projection_update_max_z (GimpTileHandlerProjection *projection);
 
 
@@ -94,6 +121,9 @@ gimp_tile_handler_projection_init (GimpTileHandlerProjection *projection)
   source->command = gimp_tile_handler_projection_command;
 
   projection->dirty_region = cairo_region_create ();
+  projection->dirty_mipmap = g_hash_table_new_full (g_int64_hash,
+                                                    g_int64_equal,
+                                                    g_free, NULL);
 }
 
 static void
@@ -110,6 +140,9 @@ gimp_tile_handler_projection_finalize (GObject *object)
   cairo_region_destroy (projection->dirty_region);
   projection->dirty_region = NULL;
 
+  g_hash_table_unref (projection->dirty_mipmap);
+  projection->dirty_mipmap = NULL;
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -167,6 +200,10 @@ gimp_tile_handler_projection_get_property (GObject    *object,
     }
 }
 
+/*  GEGL fetches tiles with the buffer's tile storage locked, so the
+ *  graph is processed from one thread at a time here, even when the
+ *  projection is read from several threads
+ */
 static GeglTile *
 gimp_tile_handler_projection_validate (GeglTileSource *source,
                                        GeglTile       *tile,
@@ -202,11 +239,11 @@ gimp_tile_handler_projection_validate (GeglTileSource *source,
         tile = gegl_tile_handler_create_tile (GEGL_TILE_HANDLER (source),
                                               x, y, 0);
 
-      cairo_region_subtract_rectangle (projection->dirty_region, &tile_rect);
-
       tile_bpp    = babl_format_get_bytes_per_pixel (projection->format);
       tile_stride = tile_bpp * projection->tile_width;
 
+      GIMP_TRACE_BEGIN ("projection-render");
+
       gegl_tile_lock (tile);
 
       n_rects = cairo_region_num_rectangles (tile_region);
@@ -243,6 +280,13 @@ gimp_tile_handler_projection_validate (GeglTileSource *source,
         }
 
       gegl_tile_unlock (tile);
+
+      GIMP_TRACE_END ();
+      GIMP_TRACE_COUNT ("projection-pixels",
+                        projection->tile_width * projection->tile_height);
+
+      /*  only now, so the tile never counts as valid before it is  */
+      cairo_region_subtract (projection->dirty_region, tile_region);
     }
 
   cairo_region_destroy (tile_region);
@@ -250,6 +294,129 @@ gimp_tile_handler_projection_validate (GeglTileSource *source,
   return tile;
 }
 
+/*  re-validates the dirty quadrants of a pyramid tile from the four
+ *  tiles one level below, instead of throwing the whole tile away
+ */
+static GeglTile *
+gimp_tile_handler_projection_validate_mipmap (GeglTileSource *source,
+                                              GeglTile       *tile,
+                                              gint            x,
+                                              gint            y,
+                                              gint            z)
+{
+  GimpTileHandlerProjection *projection;
+  gint64                     key = MIPMAP_KEY (x, y, z);
+  gint                       dirty;
+  gint                       quad_width;
+  gint                       quad_height;
+  gint                       tile_bpp;
+  gint                       tile_stride;
+  guchar                    *quad_buf;
+  gint                       qx, qy;
+
+  projection = GIMP_TILE_HANDLER_PROJECTION (source);
+
+  dirty = GPOINTER_TO_INT (g_hash_table_lookup (projection->dirty_mipmap,
+                                                &key));
+
+  /*  if the tile doesn't exist, GEGL constructs it from scratch anyway  */
+  if (! dirty || ! tile)
+    {
+      if (dirty)
+        g_hash_table_remove (projection->dirty_mipmap, &key);
+
+      return tile;
+    }
+
+  quad_width  = projection->tile_width  / 2;
+  quad_height = projection->tile_height / 2;
+  tile_bpp    = babl_format_get_bytes_per_pixel (projection->format);
+  tile_stride = tile_bpp * projection->tile_width;
+
+  quad_buf = g_malloc (quad_width * quad_height * tile_bpp);
+
+  gegl_tile_lock (tile);
+
+  for (qy = 0; qy < 2; qy++)
+    for (qx = 0; qx < 2; qx++)
+      {
+        GeglTile *child;
+        guchar   *dest;
+        gint      row;
+
+        if (! (dirty & QUADRANT_BIT (qx, qy)))
+          continue;
+
+        /*  go through ourselves, so the child gets validated first  */
+        child = gegl_tile_source_get_tile (source,
+                                           x * 2 + qx, y * 2 + qy, z - 1);
+
+        if (child)
+          {
+            gimp_tile_handler_projection_downscale (projection, quad_buf,
+                                                    gegl_tile_get_data (child));
+            gegl_tile_unref (child);
+          }
+        else
+          {
+            memset (quad_buf, 0, quad_width * quad_height * tile_bpp);
+          }
+
+        dest = gegl_tile_get_data (tile) +
+               qy * quad_height * tile_stride +
+               qx * quad_width  * tile_bpp;
+
+        for (row = 0; row < quad_height; row++)
+          memcpy (dest + row * tile_stride,
+                  quad_buf + row * quad_width * tile_bpp,
+                  quad_width * tile_bpp);
+      }
+
+  gegl_tile_unlock (tile);
+
+  g_hash_table_remove (projection->dirty_mipmap, &key);
+
+  g_free (quad_buf);
+
+  return tile;
+}
+
+/*  box-filters a full tile into a quarter-sized buffer  */
+static gboolean
+gimp_tile_handler_projection_downscale (GimpTileHandlerProjection *projection,
+                                        guchar                    *dest,
+                                        const guchar              *src)
+{
+  gint tile_bpp = babl_format_get_bytes_per_pixel (projection->format);
+
+  return gimp_gegl_downscale_2x (projection->format,
+                                 src,  projection->tile_width * tile_bpp,
+                                 dest, projection->tile_width / 2 * tile_bpp,
+                                 projection->tile_width  / 2,
+                                 projection->tile_height / 2);
+}
+
+static gboolean
+gimp_tile_handler_projection_can_downscale (GimpTileHandlerProjection *projection)
+{
+  if (! projection->format                ||
+      projection->tile_width  % 2 != 0    ||
+      projection->tile_height % 2 != 0)
+    return FALSE;
+
+  switch (gimp_babl_format_get_component_type (projection->format))
+    {
+    case GIMP_COMPONENT_TYPE_U8:
+    case GIMP_COMPONENT_TYPE_U16:
+    case GIMP_COMPONENT_TYPE_U32:
+    case GIMP_COMPONENT_TYPE_FLOAT:
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
 static gpointer
 gimp_tile_handler_projection_command (GeglTileSource  *source,
                                       GeglTileCommand  command,
@@ -262,8 +429,14 @@ gimp_tile_handler_projection_command (GeglTileSource  *source,
 
   retval = gegl_tile_handler_source_command (source, command, x, y, z, data);
 
-  if (command == GEGL_TILE_GET && z == 0)
-    retval = gimp_tile_handler_projection_validate (source, retval, x, y);
+  if (command == GEGL_TILE_GET)
+    {
+      if (z == 0)
+        retval = gimp_tile_handler_projection_validate (source, retval, x, y);
+      else
+        retval = gimp_tile_handler_projection_validate_mipmap (source, retval,
+                                                               x, y, z);
+    }
 
   return retval;
 }
@@ -340,15 +513,52 @@ gimp_tile_handler_projection_invalidate (GimpTileHandlerProjection *projection,
       gint tile_x;
       gint tile_y;
 
+      if (! gimp_tile_handler_projection_can_downscale (projection))
+        {
+          for (tile_y = tile_y1; tile_y <= tile_y2; tile_y++)
+            {
+              for (tile_x = tile_x1; tile_x <= tile_x2; tile_x++)
+                {
+                  gimp_tile_handler_projection_void_pyramid (GEGL_TILE_SOURCE (projection),
+                                                             tile_x / 2,
+                                                             tile_y / 2,
+                                                             1,
+                                                             projection->max_z);
+                }
+            }
+
+          return;
+        }
+
+      /*  instead of voiding the pyramid above the dirty tiles, only
+       *  remember which quadrant of each parent tile became dirty, it
+       *  is recomputed from its children when the parent is fetched
+       */
       for (tile_y = tile_y1; tile_y <= tile_y2; tile_y++)
         {
           for (tile_x = tile_x1; tile_x <= tile_x2; tile_x++)
             {
-              gimp_tile_handler_projection_void_pyramid (GEGL_TILE_SOURCE (projection),
-                                                         tile_x / 2,
-                                                         tile_y / 2,
-                                                         1,
-                                                         projection->max_z);
+              gint z;
+
+              for (z = 1; z <= projection->max_z; z++)
+                {
+                  gint   child_x = tile_x >> (z - 1);
+                  gint   child_y = tile_y >> (z - 1);
+                  gint64 key     = MIPMAP_KEY (child_x / 2, child_y / 2, z);
+                  gint   bit     = QUADRANT_BIT (child_x & 1, child_y & 1);
+                  gint   dirty;
+
+                  dirty = GPOINTER_TO_INT (g_hash_table_lookup (projection->dirty_mipmap,
+                                                                &key));
+
+                  /*  all the levels above are already marked  */
+                  if (dirty & bit)
+                    break;
+
+                  g_hash_table_insert (projection->dirty_mipmap,
+                                       g_memdup (&key, sizeof (key)),
+                                       GINT_TO_POINTER (dirty | bit));
+                }
             }
         }
     }
@@ -44,6 +44,7 @@ struct _GimpTileHandlerProjection
 
   GeglNode        *graph;
   cairo_region_t  *dirty_region;
+  GHashTable      *dirty_mipmap;
   const Babl      *format;
   gint             tile_width;
   gint             tile_height;
@@ -0,0 +1,407 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-trace.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <glib-object.h>
+#include <glib/gstdio.h>
+
+#include "gimp-trace.h"
+
+
+#define TRACE_RING_SIZE (1 << 16)
+#define TRACE_MAX_DEPTH 64
+
+
+typedef struct
+{
+  const gchar *name;
+  gint64       time;
+  gint64       value;
+  gchar        phase;
+} GimpTraceEvent;
+
+typedef struct
+{
+  const gchar *name;
+  gint64       start;
+} GimpTraceScope;
+
+typedef struct
+{
+  gint64       count;
+  gint64       total;
+  gint64       max;
+  gboolean     counter;
+} GimpTraceStats;
+
+typedef struct
+{
+  gint            id;
+
+  /*  the last TRACE_RING_SIZE events, only when writing a trace file  */
+  GimpTraceEvent *events;
+  guint           n_events;
+
+  GimpTraceScope  scopes[TRACE_MAX_DEPTH];
+  gint            depth;
+
+  /*  name pointer => GimpTraceStats  */
+  GHashTable     *stats;
+} GimpTraceThread;
+
+
+static GimpTraceThread * gimp_trace_get_thread  (void);
+static void              gimp_trace_add_event   (GimpTraceThread *thread,
+                                                 const gchar     *name,
+                                                 gchar            phase,
+                                                 gint64           time,
+                                                 gint64           value);
+static GimpTraceStats  * gimp_trace_get_stats   (GHashTable      *stats,
+                                                 const gchar     *name);
+
+static void              gimp_trace_write_file  (const gchar     *filename);
+static void              gimp_trace_print_stats (void);
+
+
+gboolean         gimp_trace_active = FALSE;
+
+static gchar    *trace_filename    = NULL;
+static gint64    trace_start_time  = 0;
+
+static GMutex    trace_mutex;
+static GSList   *trace_threads     = NULL;
+static gint      trace_n_threads   = 0;
+static GPrivate  trace_thread;
+
+
+void
+gimp_trace_init (void)
+{
+#ifdef ENABLE_TRACE
+  const gchar *env_trace_val = g_getenv ("GIMP_TRACE");
+
+  if (env_trace_val && *env_trace_val)
+    {
+      if (strcmp (env_trace_val, "summary"))
+        trace_filename = g_strdup (env_trace_val);
+
+      trace_start_time  = g_get_monotonic_time ();
+      gimp_trace_active = TRUE;
+    }
+#endif
+}
+
+/*  must be called when no other thread records anything any longer,
+ *  the thread data isn't locked while it's written to
+ */
+void
+gimp_trace_exit (void)
+{
+  GSList *list;
+
+  if (! gimp_trace_active)
+    return;
+
+  gimp_trace_active = FALSE;
+
+  if (trace_filename)
+    gimp_trace_write_file (trace_filename);
+  else
+    gimp_trace_print_stats ();
+
+  for (list = trace_threads; list; list = g_slist_next (list))
+    {
+      GimpTraceThread *thread = list->data;
+
+      g_free (thread->events);
+      g_hash_table_unref (thread->stats);
+      g_slice_free (GimpTraceThread, thread);
+    }
+
+  g_slist_free (trace_threads);
+  trace_threads = NULL;
+
+  g_clear_pointer (&trace_filename, g_free);
+}
+
+void
+gimp_trace_begin (const gchar *name)
+{
+  GimpTraceThread *thread = gimp_trace_get_thread ();
+  gint64           time   = g_get_monotonic_time ();
+
+  if (thread->depth < TRACE_MAX_DEPTH)
+    {
+      thread->scopes[thread->depth].name  = name;
+      thread->scopes[thread->depth].start = time;
+    }
+
+  thread->depth++;
+
+  gimp_trace_add_event (thread, name, 'B', time, 0);
+}
+
+void
+gimp_trace_end (void)
+{
+  GimpTraceThread *thread = gimp_trace_get_thread ();
+  GimpTraceScope  *scope;
+  GimpTraceStats  *stats;
+  gint64           time;
+  gint64           duration;
+
+  /*  unbalanced, ignore it  */
+  if (thread->depth == 0)
+    return;
+
+  thread->depth--;
+
+  if (thread->depth >= TRACE_MAX_DEPTH)
+    return;
+
+  time     = g_get_monotonic_time ();
+  scope    = &thread->scopes[thread->depth];
+  duration = time - scope->start;
+
+  stats = gimp_trace_get_stats (thread->stats, scope->name);
+
+  stats->count++;
+  stats->total += duration;
+  stats->max    = MAX (stats->max, duration);
+
+  gimp_trace_add_event (thread, scope->name, 'E', time, 0);
+}
+
+void
+gimp_trace_count (const gchar *name,
+                  gint64       value)
+{
+  GimpTraceThread *thread = gimp_trace_get_thread ();
+  GimpTraceStats  *stats;
+
+  stats = gimp_trace_get_stats (thread->stats, name);
+
+  stats->counter = TRUE;
+  stats->count++;
+  stats->total  += value;
+  stats->max     = MAX (stats->max, value);
+
+  gimp_trace_add_event (thread, name, 'C', g_get_monotonic_time (), value);
+}
+
+
+/*  private functions  */
+
+static GimpTraceThread *
+gimp_trace_get_thread (void)
+{
+  GimpTraceThread *thread = g_private_get (&trace_thread);
+
+  if (! thread)
+    {
+      thread = g_slice_new0 (GimpTraceThread);
+
+      thread->stats = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                             NULL, g_free);
+
+      if (trace_filename)
+        thread->events = g_new (GimpTraceEvent, TRACE_RING_SIZE);
+
+      g_mutex_lock (&trace_mutex);
+
+      thread->id    = ++trace_n_threads;
+      trace_threads = g_slist_prepend (trace_threads, thread);
+
+      g_mutex_unlock (&trace_mutex);
+
+      g_private_set (&trace_thread, thread);
+    }
+
+  return thread;
+}
+
+static void
+gimp_trace_add_event (GimpTraceThread *thread,
+                      const gchar     *name,
+                      gchar            phase,
+                      gint64           time,
+                      gint64           value)
+{
+  GimpTraceEvent *event;
+
+  if (! thread->events)
+    return;
+
+  event = &thread->events[thread->n_events % TRACE_RING_SIZE];
+
+  event->name  = name;
+  event->time  = time;
+  event->value = value;
+  event->phase = phase;
+
+  thread->n_events++;
+}
+
+static GimpTraceStats *
+gimp_trace_get_stats (GHashTable  *stats,
+                      const gchar *name)
+{
+  GimpTraceStats *entry = g_hash_table_lookup (stats, name);
+
+  if (! entry)
+    {
+      entry = g_new0 (GimpTraceStats, 1);
+
+      g_hash_table_insert (stats, (gpointer) name, entry);
+    }
+
+  return entry;
+}
+
+static void
+gimp_trace_write_file (const gchar *filename)
+{
+  FILE     *file;
+  GSList   *list;
+  gboolean  first = TRUE;
+
+  file = g_fopen (filename, "w");
+
+  if (! file)
+    {
+      g_printerr ("Could not open '%s' for writing the trace: %s\n",
+                  filename, g_strerror (errno));
+      return;
+    }
+
+  fprintf (file, "{\"traceEvents\":[\n");
+
+  for (list = trace_threads; list; list = g_slist_next (list))
+    {
+      GimpTraceThread *thread = list->data;
+      guint            i      = 0;
+
+      /*  only the newest events are left in the ring  */
+      if (thread->n_events > TRACE_RING_SIZE)
+        i = thread->n_events - TRACE_RING_SIZE;
+
+      for (; i < thread->n_events; i++)
+        {
+          GimpTraceEvent *event = &thread->events[i % TRACE_RING_SIZE];
+
+          fprintf (file, "%s{\"name\":\"%s\",\"ph\":\"%c\","
+                   "\"ts\":%" G_GINT64_FORMAT ",\"pid\":1,\"tid\":%d",
+                   first ? "" : ",\n",
+                   event->name, event->phase,
+                   event->time - trace_start_time, thread->id);
+
+          if (event->phase == 'C')
+            fprintf (file, ",\"args\":{\"value\":%" G_GINT64_FORMAT "}",
+                     event->value);
+
+          fprintf (file, "}");
+
+          first = FALSE;
+        }
+    }
+
+  fprintf (file, "\n]}\n");
+
+  fclose (file);
+}
+
+static void
+gimp_trace_print_stats (void)
+{
+  GHashTable     *totals;
+  GList          *names;
+  GList          *list;
+  GSList         *threads;
+  GHashTableIter  iter;
+  gpointer        key;
+  gpointer        value;
+
+  /*  the same name can have different addresses in different
+   *  translation units, so merge the threads' stats by string
+   */
+  totals = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+
+  for (threads = trace_threads; threads; threads = g_slist_next (threads))
+    {
+      GimpTraceThread *thread = threads->data;
+
+      g_hash_table_iter_init (&iter, thread->stats);
+
+      while (g_hash_table_iter_next (&iter, &key, &value))
+        {
+          GimpTraceStats *stats = value;
+          GimpTraceStats *total = g_hash_table_lookup (totals, key);
+
+          if (! total)
+            {
+              total = g_new0 (GimpTraceStats, 1);
+
+              g_hash_table_insert (totals, key, total);
+            }
+
+          total->counter  = stats->counter;
+          total->count   += stats->count;
+          total->total   += stats->total;
+          total->max      = MAX (total->max, stats->max);
+        }
+    }
+
+  names = g_list_sort (g_hash_table_get_keys (totals),
+                       (GCompareFunc) strcmp);
+
+  g_printerr ("\n%-32s %10s %14s %12s %12s\n",
+              "Trace", "Count", "Total", "Mean", "Max");
+
+  for (list = names; list; list = g_list_next (list))
+    {
+      GimpTraceStats *total = g_hash_table_lookup (totals, list->data);
+
+      if (total->counter)
+        {
+          g_printerr ("%-32s %10" G_GINT64_FORMAT " %14" G_GINT64_FORMAT
+                      " %12.1f %12" G_GINT64_FORMAT "\n",
+                      (const gchar *) list->data,
+                      total->count, total->total,
+                      (gdouble) total->total / total->count,
+                      total->max);
+        }
+      else
+        {
+          g_printerr ("%-32s %10" G_GINT64_FORMAT " %11.3f ms"
+                      " %9.1f us %9" G_GINT64_FORMAT " us\n",
+                      (const gchar *) list->data,
+                      total->count, total->total / 1000.0,
+                      (gdouble) total->total / total->count,
+                      total->max);
+        }
+    }
+
+  g_list_free (names);
+  g_hash_table_unref (totals);
+}
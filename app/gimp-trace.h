@@ -0,0 +1,73 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-trace.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_TRACE_H__
+#define __GIMP_TRACE_H__
+
+
+/*  Timers and counters for the hot paths, compiled in with
+ *  --enable-trace and switched on at runtime by setting GIMP_TRACE to
+ *  "summary" or to the name of a Chrome trace file to write on exit.
+ *
+ *  The names must be string literals, they are stored as pointers.
+ */
+
+
+extern gboolean gimp_trace_active;
+
+
+void   gimp_trace_init  (void);
+void   gimp_trace_exit  (void);
+
+void   gimp_trace_begin (const gchar *name);
+void   gimp_trace_end   (void);
+void   gimp_trace_count (const gchar *name,
+                         gint64       value);
+
+
+#ifdef ENABLE_TRACE
+
+#define GIMP_TRACE_BEGIN(name) \
+        G_STMT_START { \
+        if (gimp_trace_active) \
+          gimp_trace_begin (name); \
+        } G_STMT_END
+
+#define GIMP_TRACE_END() \
+        G_STMT_START { \
+        if (gimp_trace_active) \
+          gimp_trace_end (); \
+        } G_STMT_END
+
+#define GIMP_TRACE_COUNT(name, value) \
+        G_STMT_START { \
+        if (gimp_trace_active) \
+          gimp_trace_count ((name), (value)); \
+        } G_STMT_END
+
+#else /* ! ENABLE_TRACE */
+
+#define GIMP_TRACE_BEGIN(name)        G_STMT_START { } G_STMT_END
+#define GIMP_TRACE_END()              G_STMT_START { } G_STMT_END
+#define GIMP_TRACE_COUNT(name, value) G_STMT_START { } G_STMT_END
+
+#endif /* ENABLE_TRACE */
+
+
+#endif /* __GIMP_TRACE_H__ */
@@ -29,6 +29,7 @@
 #include "gui-types.h"
 
 #include "config/gimpguiconfig.h"
+#include "config/gimprc-cache.h"
 
 #include "core/gimp.h"
 #include "core/gimpcontainer.h"
@@ -605,6 +606,9 @@ gui_exit_callback (Gimp     *gimp,
   gimp_tools_save (gimp, gui_config->save_tool_options, FALSE);
   gimp_tools_exit (gimp);
 
+  /*  snapshot the rc files that were just written for the next startup  */
+  gimp_rc_cache_save ();
+
   return FALSE; /* continue exiting */
 }
 
@@ -41,6 +41,7 @@
 
 #include "config/gimpconfig-file.h"
 #include "config/gimpguiconfig.h"
+#include "config/gimprc-cache.h"
 
 #include "core/gimp.h"
 
@@ -86,7 +87,7 @@ session_init (Gimp *gimp)
 
   filename = session_filename (gimp);
 
-  scanner = gimp_scanner_new_file (filename, &error);
+  scanner = gimp_rc_cache_scanner_new (filename, &error);
 
   if (! scanner && error->code == GIMP_CONFIG_ERROR_OPEN_ENOENT)
     {
@@ -73,6 +73,7 @@
 #endif
 
 #include "gimp-log.h"
+#include "gimp-trace.h"
 #include "gimp-intl.h"
 
 
@@ -115,6 +116,8 @@ static const gchar        *user_gimprc       = NULL;
 static const gchar        *session_name      = NULL;
 static const gchar        *batch_interpreter = NULL;
 static const gchar       **batch_commands    = NULL;
+static const gchar        *batch_procedure   = NULL;
+static gint                batch_jobs        = 0;
 static const gchar       **filenames         = NULL;
 static gboolean            as_new            = FALSE;
 static gboolean            no_interface      = FALSE;
@@ -222,6 +225,17 @@ static const GOptionEntry main_entries[] =
     G_OPTION_ARG_STRING, &batch_interpreter,
     N_("The procedure to process batch commands with"), "<proc>"
   },
+  {
+    "batch-procedure", 0, 0,
+    G_OPTION_ARG_STRING, &batch_procedure,
+    N_("Run a procedure on each file instead of opening it"), "<proc>"
+  },
+  {
+    "batch-jobs", 0, 0,
+    G_OPTION_ARG_INT, &batch_jobs,
+    N_("Number of files the batch procedure processes at the same time"),
+    "<number>"
+  },
   {
     "console-messages", 'c', 0,
     G_OPTION_ARG_NONE, &console_messages,
@@ -331,6 +345,7 @@ main (int    argc,
   gimp_env_init (FALSE);
 
   gimp_log_init ();
+  gimp_trace_init ();
 
   gimp_init_i18n ();
 
@@ -410,10 +425,12 @@ main (int    argc,
       app_exit (EXIT_FAILURE);
     }
 
-  if (no_interface || be_verbose || console_messages || batch_commands != NULL)
+  if (no_interface || be_verbose || console_messages ||
+      batch_commands != NULL || batch_procedure != NULL)
     gimp_open_console_window ();
 
-  if (no_interface)
+  /*  the files are meant for the batch procedure, don't pass them on  */
+  if (no_interface || batch_procedure)
     new_instance = TRUE;
 
 #ifndef GIMP_CONSOLE_COMPILATION
@@ -442,6 +459,8 @@ main (int    argc,
            session_name,
            batch_interpreter,
            batch_commands,
+           batch_procedure,
+           batch_jobs,
            as_new,
            no_interface,
            no_data,
@@ -36,6 +36,7 @@
 
 #include "config/gimpconfig-file.h"
 #include "config/gimpguiconfig.h"
+#include "config/gimprc-cache.h"
 
 #include "core/gimp.h"
 
@@ -408,7 +409,9 @@ menus_exit (Gimp *gimp)
 void
 menus_restore (Gimp *gimp)
 {
-  gchar *filename;
+  gchar       *filename;
+  const gchar *contents;
+  gsize        length;
 
   g_return_if_fail (GIMP_IS_GIMP (gimp));
 
@@ -417,7 +420,22 @@ menus_restore (Gimp *gimp)
   if (gimp->be_verbose)
     g_print ("Parsing '%s'\n", gimp_filename_to_utf8 (filename));
 
-  gtk_accel_map_load (filename);
+  contents = gimp_rc_cache_get_contents (filename, &length);
+
+  if (contents)
+    {
+      /*  this is what gtk_accel_map_load() does, minus the open()  */
+      GScanner *scanner = g_scanner_new (NULL);
+
+      g_scanner_input_text (scanner, contents, length);
+      gtk_accel_map_load_scanner (scanner);
+      g_scanner_destroy (scanner);
+    }
+  else
+    {
+      gtk_accel_map_load (filename);
+    }
+
   g_free (filename);
 }
 
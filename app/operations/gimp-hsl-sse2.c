@@ -0,0 +1,207 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-hsl-sse2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+
+#include "libgimpcolor/gimpcolor.h"
+
+#include "operations-types.h"
+
+#include "gimp-hsl.h"
+
+#if COMPILE_SSE2_INTRINISICS
+/* SSE2 */
+#include <emmintrin.h>
+
+
+/*  Both conversions work on four pixels at a time, transposed so each
+ *  vector holds one channel of all four.  The branches of the scalar
+ *  code become masks, and the remaining pixels take the scalar path.
+ */
+
+static inline __m128
+select_ps (__m128 mask,
+           __m128 a,
+           __m128 b)
+{
+  return _mm_or_ps (_mm_and_ps (mask, a), _mm_andnot_ps (mask, b));
+}
+
+void
+gimp_rgba_to_hsla_sse2 (const gfloat *src,
+                        gfloat       *dest,
+                        glong         samples)
+{
+  const __m128 zero  = _mm_setzero_ps ();
+  const __m128 half  = _mm_set1_ps (0.5f);
+  const __m128 one   = _mm_set1_ps (1.0f);
+  const __m128 two   = _mm_set1_ps (2.0f);
+  const __m128 four  = _mm_set1_ps (4.0f);
+  const __m128 sixth = _mm_set1_ps (1.0f / 6.0f);
+  const __m128 undef = _mm_set1_ps (GIMP_HSL_UNDEFINED);
+
+  for (; samples >= 4; samples -= 4)
+    {
+      __m128 r     = _mm_loadu_ps (src);
+      __m128 g     = _mm_loadu_ps (src + 4);
+      __m128 b     = _mm_loadu_ps (src + 8);
+      __m128 a     = _mm_loadu_ps (src + 12);
+      __m128 max, min, sum, delta;
+      __m128 h, s, l;
+      __m128 gray, r_max, g_max;
+
+      _MM_TRANSPOSE4_PS (r, g, b, a);
+
+      max   = _mm_max_ps (r, _mm_max_ps (g, b));
+      min   = _mm_min_ps (r, _mm_min_ps (g, b));
+      sum   = _mm_add_ps (max, min);
+      delta = _mm_sub_ps (max, min);
+      gray  = _mm_cmpeq_ps (delta, zero);
+
+      l = _mm_mul_ps (sum, half);
+
+      /*  keep the divisions of gray pixels finite, their results are
+       *  replaced below
+       */
+      delta = select_ps (gray, one, delta);
+
+      s = _mm_div_ps (delta,
+                      select_ps (_mm_cmple_ps (l, half),
+                                 sum, _mm_sub_ps (_mm_sub_ps (two, max), min)));
+
+      r_max = _mm_cmpeq_ps (r, max);
+      g_max = _mm_andnot_ps (r_max, _mm_cmpeq_ps (g, max));
+
+      h = select_ps (r_max,
+                     _mm_sub_ps (g, b),
+                     select_ps (g_max,
+                                _mm_sub_ps (b, r),
+                                _mm_sub_ps (r, g)));
+      h = _mm_div_ps (h, delta);
+      h = _mm_add_ps (h,
+                      select_ps (r_max,
+                                 zero,
+                                 select_ps (g_max, two, four)));
+      h = _mm_mul_ps (h, sixth);
+      h = _mm_add_ps (h, _mm_and_ps (_mm_cmplt_ps (h, zero), one));
+
+      h = select_ps (gray, undef, h);
+      s = select_ps (gray, zero,  s);
+
+      _MM_TRANSPOSE4_PS (h, s, l, a);
+
+      _mm_storeu_ps (dest,      h);
+      _mm_storeu_ps (dest + 4,  s);
+      _mm_storeu_ps (dest + 8,  l);
+      _mm_storeu_ps (dest + 12, a);
+
+      src  += 16;
+      dest += 16;
+    }
+
+  gimp_rgba_to_hsla_core (src, dest, samples);
+}
+
+static inline __m128
+gimp_hsl_value_sse2 (__m128 n1,
+                     __m128 n2,
+                     __m128 hue)
+{
+  const __m128 zero  = _mm_setzero_ps ();
+  const __m128 one   = _mm_set1_ps (1.0f);
+  const __m128 three = _mm_set1_ps (3.0f);
+  const __m128 four  = _mm_set1_ps (4.0f);
+  const __m128 six   = _mm_set1_ps (6.0f);
+  __m128       rise;
+  __m128       fall;
+
+  hue = _mm_sub_ps (hue, _mm_and_ps (_mm_cmpgt_ps (hue, six),  six));
+  hue = _mm_add_ps (hue, _mm_and_ps (_mm_cmplt_ps (hue, zero), six));
+
+  rise = _mm_add_ps (n1, _mm_mul_ps (_mm_sub_ps (n2, n1), hue));
+  fall = _mm_add_ps (n1, _mm_mul_ps (_mm_sub_ps (n2, n1),
+                                     _mm_sub_ps (four, hue)));
+
+  return select_ps (_mm_cmplt_ps (hue, one),
+                    rise,
+                    select_ps (_mm_cmplt_ps (hue, three),
+                               n2,
+                               select_ps (_mm_cmplt_ps (hue, four),
+                                          fall,
+                                          n1)));
+}
+
+void
+gimp_hsla_to_rgba_sse2 (const gfloat *src,
+                        gfloat       *dest,
+                        glong         samples)
+{
+  const __m128 zero = _mm_setzero_ps ();
+  const __m128 half = _mm_set1_ps (0.5f);
+  const __m128 one  = _mm_set1_ps (1.0f);
+  const __m128 two  = _mm_set1_ps (2.0f);
+  const __m128 six  = _mm_set1_ps (6.0f);
+
+  for (; samples >= 4; samples -= 4)
+    {
+      __m128 h = _mm_loadu_ps (src);
+      __m128 s = _mm_loadu_ps (src + 4);
+      __m128 l = _mm_loadu_ps (src + 8);
+      __m128 a = _mm_loadu_ps (src + 12);
+      __m128 m1, m2;
+      __m128 r, g, b;
+      __m128 gray;
+
+      _MM_TRANSPOSE4_PS (h, s, l, a);
+
+      gray = _mm_cmpeq_ps (s, zero);
+
+      m2 = select_ps (_mm_cmple_ps (l, half),
+                      _mm_mul_ps (l, _mm_add_ps (one, s)),
+                      _mm_sub_ps (_mm_add_ps (l, s), _mm_mul_ps (l, s)));
+      m1 = _mm_sub_ps (_mm_mul_ps (two, l), m2);
+
+      h = _mm_mul_ps (h, six);
+
+      r = gimp_hsl_value_sse2 (m1, m2, _mm_add_ps (h, two));
+      g = gimp_hsl_value_sse2 (m1, m2, h);
+      b = gimp_hsl_value_sse2 (m1, m2, _mm_sub_ps (h, two));
+
+      /*  achromatic case  */
+      r = select_ps (gray, l, r);
+      g = select_ps (gray, l, g);
+      b = select_ps (gray, l, b);
+
+      _MM_TRANSPOSE4_PS (r, g, b, a);
+
+      _mm_storeu_ps (dest,      r);
+      _mm_storeu_ps (dest + 4,  g);
+      _mm_storeu_ps (dest + 8,  b);
+      _mm_storeu_ps (dest + 12, a);
+
+      src  += 16;
+      dest += 16;
+    }
+
+  gimp_hsla_to_rgba_core (src, dest, samples);
+}
+
+#endif /* COMPILE_SSE2_INTRINISICS */
@@ -0,0 +1,160 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-hsl.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpcolor/gimpcolor.h"
+
+#include "operations-types.h"
+
+#include "gimp-hsl.h"
+
+
+GimpHSLFunction gimp_rgba_to_hsla = gimp_rgba_to_hsla_core;
+GimpHSLFunction gimp_hsla_to_rgba = gimp_hsla_to_rgba_core;
+
+
+void
+gimp_hsl_init (void)
+{
+#if COMPILE_SSE2_INTRINISICS
+  if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_SSE2)
+    {
+      gimp_rgba_to_hsla = gimp_rgba_to_hsla_sse2;
+      gimp_hsla_to_rgba = gimp_hsla_to_rgba_sse2;
+    }
+#endif /* COMPILE_SSE2_INTRINISICS */
+}
+
+void
+gimp_rgba_to_hsla_core (const gfloat *src,
+                        gfloat       *dest,
+                        glong         samples)
+{
+  while (samples--)
+    {
+      gfloat r   = src[RED];
+      gfloat g   = src[GREEN];
+      gfloat b   = src[BLUE];
+      gfloat max = MAX (r, MAX (g, b));
+      gfloat min = MIN (r, MIN (g, b));
+      gfloat h, s, l;
+
+      l = (max + min) / 2.0f;
+
+      if (max == min)
+        {
+          s = 0.0f;
+          h = GIMP_HSL_UNDEFINED;
+        }
+      else
+        {
+          gfloat delta = max - min;
+
+          if (l <= 0.5f)
+            s = delta / (max + min);
+          else
+            s = delta / (2.0f - max - min);
+
+          if (r == max)
+            h = (g - b) / delta;
+          else if (g == max)
+            h = 2.0f + (b - r) / delta;
+          else
+            h = 4.0f + (r - g) / delta;
+
+          h /= 6.0f;
+
+          if (h < 0.0f)
+            h += 1.0f;
+        }
+
+      dest[0]     = h;
+      dest[1]     = s;
+      dest[2]     = l;
+      dest[ALPHA] = src[ALPHA];
+
+      src  += 4;
+      dest += 4;
+    }
+}
+
+static inline gfloat
+gimp_hsl_value (gfloat n1,
+                gfloat n2,
+                gfloat hue)
+{
+  if (hue > 6.0f)
+    hue -= 6.0f;
+  else if (hue < 0.0f)
+    hue += 6.0f;
+
+  if (hue < 1.0f)
+    return n1 + (n2 - n1) * hue;
+  else if (hue < 3.0f)
+    return n2;
+  else if (hue < 4.0f)
+    return n1 + (n2 - n1) * (4.0f - hue);
+  else
+    return n1;
+}
+
+void
+gimp_hsla_to_rgba_core (const gfloat *src,
+                        gfloat       *dest,
+                        glong         samples)
+{
+  while (samples--)
+    {
+      gfloat h = src[0];
+      gfloat s = src[1];
+      gfloat l = src[2];
+
+      if (s == 0.0f)
+        {
+          /*  achromatic case  */
+          dest[RED]   = l;
+          dest[GREEN] = l;
+          dest[BLUE]  = l;
+        }
+      else
+        {
+          gfloat m1, m2;
+
+          if (l <= 0.5f)
+            m2 = l * (1.0f + s);
+          else
+            m2 = l + s - l * s;
+
+          m1 = 2.0f * l - m2;
+
+          dest[RED]   = gimp_hsl_value (m1, m2, h * 6.0f + 2.0f);
+          dest[GREEN] = gimp_hsl_value (m1, m2, h * 6.0f);
+          dest[BLUE]  = gimp_hsl_value (m1, m2, h * 6.0f - 2.0f);
+        }
+
+      dest[ALPHA] = src[ALPHA];
+
+      src  += 4;
+      dest += 4;
+    }
+}
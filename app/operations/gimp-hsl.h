@@ -0,0 +1,55 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimp-hsl.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_HSL_H__
+#define __GIMP_HSL_H__
+
+
+/*  These convert @samples pixels of 4 floats between RGBA and HSLA,
+ *  the same way gimp_rgb_to_hsl() and gimp_hsl_to_rgb() do, and copy
+ *  the alpha channel.  @src and @dest may be the same.
+ */
+
+typedef void (* GimpHSLFunction) (const gfloat *src,
+                                  gfloat       *dest,
+                                  glong         samples);
+
+
+extern GimpHSLFunction gimp_rgba_to_hsla;
+extern GimpHSLFunction gimp_hsla_to_rgba;
+
+
+void   gimp_hsl_init           (void);
+
+void   gimp_rgba_to_hsla_core  (const gfloat *src,
+                                gfloat       *dest,
+                                glong         samples);
+void   gimp_hsla_to_rgba_core  (const gfloat *src,
+                                gfloat       *dest,
+                                glong         samples);
+
+void   gimp_rgba_to_hsla_sse2  (const gfloat *src,
+                                gfloat       *dest,
+                                glong         samples);
+void   gimp_hsla_to_rgba_sse2  (const gfloat *src,
+                                gfloat       *dest,
+                                glong         samples);
+
+
+#endif /* __GIMP_HSL_H__ */
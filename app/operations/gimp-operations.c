@@ -25,6 +25,7 @@
 
 #include "core/gimp.h"
 
+#include "gimp-hsl.h"
 #include "gimp-operations.h"
 
 #include "gimpoperationborder.h"
@@ -40,6 +41,10 @@
 #include "gimpoperationshrink.h"
 #include "gimpoperationthresholdalpha.h"
 
+#ifdef HAVE_LCMS
+#include "gimpoperationprofiletransform.h"
+#endif
+
 #include "gimpoperationbrightnesscontrast.h"
 #include "gimpoperationcolorbalance.h"
 #include "gimpoperationcolorize.h"
@@ -82,6 +87,8 @@
 void
 gimp_operations_init (void)
 {
+  gimp_hsl_init ();
+
   g_type_class_ref (GIMP_TYPE_OPERATION_BORDER);
   g_type_class_ref (GIMP_TYPE_OPERATION_CAGE_COEF_CALC);
   g_type_class_ref (GIMP_TYPE_OPERATION_CAGE_TRANSFORM);
@@ -95,6 +102,10 @@ gimp_operations_init (void)
   g_type_class_ref (GIMP_TYPE_OPERATION_SHRINK);
   g_type_class_ref (GIMP_TYPE_OPERATION_THRESHOLD_ALPHA);
 
+#ifdef HAVE_LCMS
+  g_type_class_ref (GIMP_TYPE_OPERATION_PROFILE_TRANSFORM);
+#endif
+
   g_type_class_ref (GIMP_TYPE_OPERATION_BRIGHTNESS_CONTRAST);
   g_type_class_ref (GIMP_TYPE_OPERATION_COLOR_BALANCE);
   g_type_class_ref (GIMP_TYPE_OPERATION_COLORIZE);
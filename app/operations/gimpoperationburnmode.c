@@ -24,11 +24,16 @@
 
 #include <gegl-plugin.h>
 
+#include "libgimpbase/gimpbase.h"
+
 #include "operations-types.h"
 
 #include "gimpoperationburnmode.h"
 
 
+GimpLayerModeFunction gimp_operation_burn_mode_process_pixels = gimp_operation_burn_mode_process_pixels_core;
+
+
 static gboolean gimp_operation_burn_mode_process (GeglOperation       *operation,
                                                   void                *in_buf,
                                                   void                *aux_buf,
@@ -58,6 +63,11 @@ gimp_operation_burn_mode_class_init (GimpOperationBurnModeClass *klass)
                                  NULL);
 
   point_class->process = gimp_operation_burn_mode_process;
+
+#if COMPILE_SSE2_INTRINISICS
+  if (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_SSE2)
+    gimp_operation_burn_mode_process_pixels = gimp_operation_burn_mode_process_pixels_sse2;
+#endif /* COMPILE_SSE2_INTRINISICS */
 }
 
 static void
@@ -81,14 +91,14 @@ gimp_operation_burn_mode_process (GeglOperation       *operation,
 }
 
 gboolean
-gimp_operation_burn_mode_process_pixels (gfloat              *in,
-                                         gfloat              *layer,
-                                         gfloat              *mask,
-                                         gfloat              *out,
-                                         gfloat               opacity,
-                                         glong                samples,
-                                         const GeglRectangle *roi,
-                                         gint                 level)
+gimp_operation_burn_mode_process_pixels_core (gfloat              *in,
+                                              gfloat              *layer,
+                                              gfloat              *mask,
+                                              gfloat              *out,
+                                              gfloat               opacity,
+                                              glong                samples,
+                                              const GeglRectangle *roi,
+                                              gint                 level)
 {
   const gboolean has_mask = mask != NULL;
 
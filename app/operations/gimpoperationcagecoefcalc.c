@@ -19,18 +19,43 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <gegl.h>
 
 #include "libgimpmath/gimpmath.h"
 
 #include "operations-types.h"
 
+#include "core/gimp-parallel.h"
+
 #include "gimpoperationcagecoefcalc.h"
 #include "gimpcageconfig.h"
 
 #include "gimp-intl.h"
 
 
+#define MIN_PARALLEL_ROWS 4
+
+
+typedef struct
+{
+  GimpVector2 v1;    /*  first vertex  */
+  GimpVector2 a;     /*  from the first to the second vertex  */
+  gdouble     absa;  /*  length of a  */
+  gdouble     Q;     /*  squared length of a  */
+} GimpCageCoefCalcEdge;
+
+typedef struct
+{
+  GimpCageConfig       *config;
+  GimpCageCoefCalcEdge *edges;
+  gint                  n_cage_vertices;
+  const GeglRectangle  *roi;
+  gfloat               *coef;
+} GimpCageCoefCalcData;
+
+
 static void           gimp_operation_cage_coef_calc_finalize         (GObject              *object);
 static void           gimp_operation_cage_coef_calc_get_property     (GObject              *object,
                                                                       guint                 property_id,
@@ -47,6 +72,9 @@ static gboolean       gimp_operation_cage_coef_calc_process          (GeglOperat
                                                                       GeglBuffer           *output,
                                                                       const GeglRectangle  *roi,
                                                                       gint                  level);
+static void           gimp_operation_cage_coef_calc_rows             (gsize                 offset,
+                                                                      gsize                 size,
+                                                                      GimpCageCoefCalcData *data);
 
 
 G_DEFINE_TYPE (GimpOperationCageCoefCalc, gimp_operation_cage_coef_calc,
@@ -150,27 +178,6 @@ gimp_operation_cage_coef_calc_set_property (GObject      *object,
     }
 }
 
-static gboolean
-gimp_operation_cage_coef_calc_is_on_straight (GimpVector2 *d1,
-                                              GimpVector2 *d2,
-                                              GimpVector2 *p)
-{
-  GimpVector2 v1, v2;
-  gfloat      deter;
-
-  v1.x = p->x - d1->x;
-  v1.y = p->y - d1->y;
-  v2.x = d2->x - d1->x;
-  v2.y = d2->y - d1->y;
-
-  gimp_vector2_normalize (&v1);
-  gimp_vector2_normalize (&v2);
-
-  deter = v1.x * v2.y - v2.x * v1.y;
-
-  return (deter < 0.000000001) && (deter > -0.000000001);
-}
-
 static void
 gimp_operation_cage_coef_calc_prepare (GeglOperation *operation)
 {
@@ -200,59 +207,95 @@ gimp_operation_cage_coef_calc_process (GeglOperation       *operation,
 {
   GimpOperationCageCoefCalc *occc   = GIMP_OPERATION_CAGE_COEF_CALC (operation);
   GimpCageConfig            *config = GIMP_CAGE_CONFIG (occc->config);
-
-  const Babl *format;
-
-  GeglBufferIterator *it;
-  guint               n_cage_vertices;
-  GimpCagePoint      *current, *last;
+  GimpCageCoefCalcData       data;
+  const Babl                *format;
+  GeglBufferIterator        *it;
+  gint                       j;
 
   if (! config)
     return FALSE;
 
-  format = babl_format_n (babl_type ("float"), 2 * gimp_cage_config_get_n_points (config));
+  data.config          = config;
+  data.n_cage_vertices = gimp_cage_config_get_n_points (config);
+  data.edges           = g_new (GimpCageCoefCalcEdge, data.n_cage_vertices);
 
-  n_cage_vertices   = gimp_cage_config_get_n_points (config);
+  /*  everything that only depends on the cage, not on the pixel  */
+  for (j = 0; j < data.n_cage_vertices; j++)
+    {
+      GimpCageCoefCalcEdge *edge = &data.edges[j];
+      GimpCagePoint        *last;
+      GimpCagePoint        *current;
+
+      last    = &g_array_index (config->cage_points, GimpCagePoint, j);
+      current = &g_array_index (config->cage_points, GimpCagePoint,
+                                (j + 1) % data.n_cage_vertices);
+
+      edge->v1   = last->src_point;
+      edge->a.x  = current->src_point.x - last->src_point.x;
+      edge->a.y  = current->src_point.y - last->src_point.y;
+      edge->absa = gimp_vector2_length (&edge->a);
+      edge->Q    = edge->a.x * edge->a.x + edge->a.y * edge->a.y;
+    }
+
+  format = babl_format_n (babl_type ("float"), 2 * data.n_cage_vertices);
 
   it = gegl_buffer_iterator_new (output, roi, 0, format,
-                                 GEGL_BUFFER_READWRITE, GEGL_ABYSS_NONE);
+                                 GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
 
   while (gegl_buffer_iterator_next (it))
     {
-      /* iterate inside the roi */
-      gint  n_pixels = it->length;
-      gint  x = it->roi->x; /* initial x                   */
-      gint  y = it->roi->y; /*           and y coordinates */
-      gint  j;
+      data.roi  = it->roi;
+      data.coef = it->data[0];
+
+      /*  every pixel costs a few logarithms and arctangents per cage
+       *  vertex, so even the rows of a single tile are worth spreading
+       *  over the threads
+       */
+      gimp_parallel_distribute_range (it->roi->height, MIN_PARALLEL_ROWS,
+                                      (GimpParallelDistributeRangeFunc)
+                                      gimp_operation_cage_coef_calc_rows,
+                                      &data);
+    }
+
+  g_free (data.edges);
+
+  return TRUE;
+}
 
-      gfloat      *coef = it->data[0];
+static void
+gimp_operation_cage_coef_calc_rows (gsize                 offset,
+                                    gsize                 size,
+                                    GimpCageCoefCalcData *data)
+{
+  gint    n_cage_vertices = data->n_cage_vertices;
+  gint    n_components    = 2 * n_cage_vertices;
+  gfloat *coef;
+  gint    x, y;
 
-      while(n_pixels--)
+  coef = data->coef + offset * data->roi->width * n_components;
+
+  for (y = data->roi->y + offset; y < data->roi->y + offset + size; y++)
+    {
+      for (x = data->roi->x; x < data->roi->x + data->roi->width; x++)
         {
-          if (gimp_cage_config_point_inside(config, x, y))
-            {
-              last = &(g_array_index (config->cage_points, GimpCagePoint, 0));
+          gint j;
+
+          memset (coef, 0, n_components * sizeof (gfloat));
 
-              for( j = 0; j < n_cage_vertices; j++)
+          if (gimp_cage_config_point_inside (data->config, x, y))
+            {
+              for (j = 0; j < n_cage_vertices; j++)
                 {
-                  GimpVector2 v1,v2,a,b,p;
-                  gdouble BA,SRT,L0,L1,A0,A1,A10,L10, Q,S,R, absa;
-
-                  current = &(g_array_index (config->cage_points, GimpCagePoint, (j+1) % n_cage_vertices));
-                  v1 = last->src_point;
-                  v2 = current->src_point;
-                  p.x = x;
-                  p.y = y;
-                  a.x = v2.x - v1.x;
-                  a.y = v2.y - v1.y;
-                  absa = gimp_vector2_length (&a);
-
-                  b.x = v1.x - x;
-                  b.y = v1.y - y;
-                  Q = a.x * a.x + a.y * a.y;
+                  const GimpCageCoefCalcEdge *edge = &data->edges[j];
+                  GimpVector2                 b;
+                  gdouble                     BA,SRT,L0,L1,A0,A1,A10,L10, Q,S,R;
+
+                  Q = edge->Q;
+                  b.x = edge->v1.x - x;
+                  b.y = edge->v1.y - y;
                   S = b.x * b.x + b.y * b.y;
-                  R = 2.0 * (a.x * b.x + a.y * b.y);
-                  BA = b.x * a.y - b.y * a.x;
+                  R = 2.0 * (edge->a.x * b.x + edge->a.y * b.y);
+                  BA = b.x * edge->a.y - b.y * edge->a.x;
                   SRT = sqrt(4.0 * S * Q - R * R);
 
                   L0 = log(S);
@@ -263,35 +306,27 @@ gimp_operation_cage_coef_calc_process (GeglOperation       *operation,
                   L10 = L1 - L0;
 
                   /* edge coef */
-                  coef[j + n_cage_vertices] = (-absa / (4.0 * G_PI)) * ((4.0*S-(R*R)/Q) * A10 + (R / (2.0 * Q)) * L10 + L1 - 2.0);
+                  coef[j + n_cage_vertices] = (-edge->absa / (4.0 * G_PI)) * ((4.0*S-(R*R)/Q) * A10 + (R / (2.0 * Q)) * L10 + L1 - 2.0);
 
                   if (isnan(coef[j + n_cage_vertices]))
                     {
                       coef[j + n_cage_vertices] = 0.0;
                     }
 
-                  /* vertice coef */
-                  if (!gimp_operation_cage_coef_calc_is_on_straight (&v1, &v2, &p))
+                  /* vertice coef, unless the pixel is on the edge's
+                   * straight line, which is the case when the cross
+                   * product of the normalized edge and of the
+                   * normalized vector to the pixel vanishes
+                   */
+                  if (fabs (BA) > 0.000000001 * sqrt (S) * edge->absa)
                     {
                       coef[j] += (BA / (2.0 * G_PI)) * (L10 /(2.0*Q) - A10 * (2.0 + R / Q));
                       coef[(j+1)%n_cage_vertices] -= (BA / (2.0 * G_PI)) * (L10 / (2.0 * Q) - A10 * (R / Q));
                     }
-
-                  last = current;
                 }
             }
 
-          coef += 2 * n_cage_vertices;
-
-          /* update x and y coordinates */
-          x++;
-          if (x >= (it->roi->x + it->roi->width))
-            {
-              x = it->roi->x;
-              y++;
-            }
+          coef += n_components;
         }
     }
-
-  return TRUE;
 }
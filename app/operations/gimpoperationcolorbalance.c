@@ -29,10 +29,15 @@
 
 #include "operations-types.h"
 
+#include "gimp-hsl.h"
 #include "gimpcolorbalanceconfig.h"
 #include "gimpoperationcolorbalance.h"
 
 
+/*  the number of pixels converted to HSL at once  */
+#define BLOCK_SIZE 256
+
+
 static gboolean gimp_operation_color_balance_process (GeglOperation       *operation,
                                                       void                *in_buf,
                                                       void                *out_buf,
@@ -127,69 +132,62 @@ gimp_operation_color_balance_process (GeglOperation       *operation,
   GimpColorBalanceConfig   *config = GIMP_COLOR_BALANCE_CONFIG (point->config);
   gfloat                   *src    = in_buf;
   gfloat                   *dest   = out_buf;
+  glong                     i;
 
   if (! config)
     return FALSE;
 
-  while (samples--)
+  while (samples > 0)
     {
-      gfloat r = src[RED];
-      gfloat g = src[GREEN];
-      gfloat b = src[BLUE];
-      gfloat r_n;
-      gfloat g_n;
-      gfloat b_n;
+      gfloat lightness[BLOCK_SIZE];
+      glong  n = MIN (samples, BLOCK_SIZE);
 
-      GimpRGB rgb = { r, g, b};
-      GimpHSL hsl;
+      for (i = 0; i < n; i++)
+        {
+          gfloat r   = src[4 * i + RED];
+          gfloat g   = src[4 * i + GREEN];
+          gfloat b   = src[4 * i + BLUE];
+          gfloat max = MAX (r, MAX (g, b));
+          gfloat min = MIN (r, MIN (g, b));
 
-      gimp_rgb_to_hsl (&rgb, &hsl);
+          /*  remember the lightness, @src and @dest may be the same  */
+          lightness[i] = (max + min) / 2.0f;
 
-      r_n = gimp_operation_color_balance_map (r, hsl.l,
+          dest[4 * i + RED]   =
+            gimp_operation_color_balance_map (r, lightness[i],
                                               config->cyan_red[GIMP_SHADOWS],
                                               config->cyan_red[GIMP_MIDTONES],
                                               config->cyan_red[GIMP_HIGHLIGHTS]);
 
-      g_n = gimp_operation_color_balance_map (g, hsl.l,
+          dest[4 * i + GREEN] =
+            gimp_operation_color_balance_map (g, lightness[i],
                                               config->magenta_green[GIMP_SHADOWS],
                                               config->magenta_green[GIMP_MIDTONES],
                                               config->magenta_green[GIMP_HIGHLIGHTS]);
 
-      b_n = gimp_operation_color_balance_map (b, hsl.l,
+          dest[4 * i + BLUE]  =
+            gimp_operation_color_balance_map (b, lightness[i],
                                               config->yellow_blue[GIMP_SHADOWS],
                                               config->yellow_blue[GIMP_MIDTONES],
                                               config->yellow_blue[GIMP_HIGHLIGHTS]);
 
+          dest[4 * i + ALPHA] = src[4 * i + ALPHA];
+        }
+
       if (config->preserve_luminosity)
         {
-          GimpHSL hsl2;
+          /*  give the new colors the lightness of the old ones  */
+          gimp_rgba_to_hsla (dest, dest, n);
 
-          rgb.r = r_n;
-          rgb.g = g_n;
-          rgb.b = b_n;
-          gimp_rgb_to_hsl (&rgb, &hsl);
+          for (i = 0; i < n; i++)
+            dest[4 * i + 2] = lightness[i];
 
-          rgb.r = r;
-          rgb.g = g;
-          rgb.b = b;
-          gimp_rgb_to_hsl (&rgb, &hsl2);
-
-          hsl.l = hsl2.l;
-
-          gimp_hsl_to_rgb (&hsl, &rgb);
-
-          r_n = rgb.r;
-          g_n = rgb.g;
-          b_n = rgb.b;
+          gimp_hsla_to_rgba (dest, dest, n);
         }
 
-      dest[RED]   = r_n;
-      dest[GREEN] = g_n;
-      dest[BLUE]  = b_n;
-      dest[ALPHA] = src[ALPHA];
-
-      src  += 4;
-      dest += 4;
+      src     += 4 * n;
+      dest    += 4 * n;
+      samples -= n;
     }
 
   return TRUE;
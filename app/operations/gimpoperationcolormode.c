@@ -30,9 +30,14 @@
 
 #include "operations-types.h"
 
+#include "gimp-hsl.h"
 #include "gimpoperationcolormode.h"
 
 
+/*  the number of pixels converted to HSL at once  */
+#define BLOCK_SIZE 256
+
+
 static gboolean gimp_operation_color_mode_process (GeglOperation       *operation,
                                                    void                *in_buf,
                                                    void                *aux_buf,
@@ -96,58 +101,68 @@ gimp_operation_color_mode_process_pixels (gfloat              *in,
 {
   const gboolean has_mask = mask != NULL;
 
-  while (samples--)
+  while (samples > 0)
     {
-      GimpHSL layer_hsl, out_hsl;
-      GimpRGB layer_rgb = {layer[0], layer[1], layer[2]};
-      GimpRGB out_rgb   = {in[0], in[1], in[2]};
-      gfloat  comp_alpha, new_alpha;
-
-      comp_alpha = MIN (in[ALPHA], layer[ALPHA]) * opacity;
-      if (has_mask)
-        comp_alpha *= *mask;
+      gfloat layer_hsl[4 * BLOCK_SIZE];
+      gfloat comp[4 * BLOCK_SIZE];
+      glong  n = MIN (samples, BLOCK_SIZE);
+      glong  i;
+
+      /*  the hue and saturation of the layer with the lightness of
+       *  the input
+       */
+      gimp_rgba_to_hsla (layer, layer_hsl, n);
+      gimp_rgba_to_hsla (in,    comp,      n);
+
+      for (i = 0; i < n; i++)
+        {
+          comp[4 * i + 0] = layer_hsl[4 * i + 0];
+          comp[4 * i + 1] = layer_hsl[4 * i + 1];
+        }
 
-      new_alpha = in[ALPHA] + (1.0 - in[ALPHA]) * comp_alpha;
+      gimp_hsla_to_rgba (comp, comp, n);
 
-      if (comp_alpha && new_alpha)
+      for (i = 0; i < n; i++)
         {
-          gint   b;
-          gfloat ratio = comp_alpha / new_alpha;
-
-          gimp_rgb_to_hsl (&layer_rgb, &layer_hsl);
-          gimp_rgb_to_hsl (&out_rgb, &out_hsl);
+          gfloat comp_alpha, new_alpha;
 
-          out_hsl.h = layer_hsl.h;
-          out_hsl.s = layer_hsl.s;
-          gimp_hsl_to_rgb (&out_hsl, &out_rgb);
+          comp_alpha = MIN (in[ALPHA], layer[ALPHA]) * opacity;
+          if (has_mask)
+            comp_alpha *= *mask;
 
-          out[0] = out_rgb.r;
-          out[1] = out_rgb.g;
-          out[2] = out_rgb.b;
+          new_alpha = in[ALPHA] + (1.0 - in[ALPHA]) * comp_alpha;
 
-          for (b = RED; b < ALPHA; b++)
+          if (comp_alpha && new_alpha)
             {
-              out[b] = out[b] * ratio + in[b] * (1.0 - ratio);
-            }
-        }
-      else
-        {
-          gint b;
+              gint   b;
+              gfloat ratio = comp_alpha / new_alpha;
 
-          for (b = RED; b < ALPHA; b++)
+              for (b = RED; b < ALPHA; b++)
+                {
+                  out[b] = comp[4 * i + b] * ratio + in[b] * (1.0 - ratio);
+                }
+            }
+          else
             {
-              out[b] = in[b];
+              gint b;
+
+              for (b = RED; b < ALPHA; b++)
+                {
+                  out[b] = in[b];
+                }
             }
-        }
 
-      out[ALPHA] = in[ALPHA];
+          out[ALPHA] = in[ALPHA];
+
+          in    += 4;
+          layer += 4;
+          out   += 4;
 
-      in    += 4;
-      layer += 4;
-      out   += 4;
+          if (has_mask)
+            mask++;
+        }
 
-      if (has_mask)
-        mask++;
+      samples -= n;
     }
 
   return TRUE;
@@ -25,12 +25,17 @@
 
 #include <gegl-plugin.h>
 
+#include "libgimpmath/gimpmath.h"
+
 #include "operations-types.h"
 
 #include "gimpoperationdissolvemode.h"
 
 
-#define RANDOM_TABLE_SIZE 4096
+/*  the noise is keyed on the pixel position, so it comes out the same
+ *  whatever order or chunks GEGL processes the pixels in
+ */
+#define DISSOLVE_SEED 314159265
 
 
 static gboolean gimp_operation_dissolve_mode_process (GeglOperation       *operation,
@@ -46,16 +51,12 @@ static gboolean gimp_operation_dissolve_mode_process (GeglOperation       *opera
 G_DEFINE_TYPE (GimpOperationDissolveMode, gimp_operation_dissolve_mode,
                GIMP_TYPE_OPERATION_POINT_LAYER_MODE)
 
-static gint32 random_table[RANDOM_TABLE_SIZE];
-
 
 static void
 gimp_operation_dissolve_mode_class_init (GimpOperationDissolveModeClass *klass)
 {
   GeglOperationClass               *operation_class;
   GeglOperationPointComposer3Class *point_composer_class;
-  GRand                            *gr;
-  gint                              i;
 
   operation_class      = GEGL_OPERATION_CLASS (klass);
   point_composer_class = GEGL_OPERATION_POINT_COMPOSER3_CLASS (klass);
@@ -67,13 +68,6 @@ gimp_operation_dissolve_mode_class_init (GimpOperationDissolveModeClass *klass)
                                  NULL);
 
   point_composer_class->process = gimp_operation_dissolve_mode_process;
-
-  /* generate a table of random seeds */
-  gr = g_rand_new_with_seed (314159265);
-  for (i = 0; i < RANDOM_TABLE_SIZE; i++)
-    random_table[i] = g_rand_int (gr);
-
-  g_rand_free (gr);
 }
 
 static void
@@ -111,12 +105,6 @@ gimp_operation_dissolve_mode_process_pixels (gfloat              *in,
 
   for (y = result->y; y < result->y + result->height; y++)
     {
-      GRand *gr = g_rand_new_with_seed (random_table[y % RANDOM_TABLE_SIZE]);
-
-      /* fast forward through the rows pseudo random sequence */
-      for (x = 0; x < result->x; x++)
-        g_rand_int (gr);
-
       for (x = result->x; x < result->x + result->width; x++)
         {
           gfloat value = aux[ALPHA] * opacity * 255;
@@ -124,7 +112,7 @@ gimp_operation_dissolve_mode_process_pixels (gfloat              *in,
           if (has_mask)
             value *= *mask;
 
-          if (g_rand_int_range (gr, 0, 255) >= value)
+          if (gimp_random_int_range (DISSOLVE_SEED, x, y, 0, 0, 255) >= value)
             {
               out[0] = in[0];
               out[1] = in[1];
@@ -146,7 +134,6 @@ gimp_operation_dissolve_mode_process_pixels (gfloat              *in,
           if (has_mask)
             mask ++;
         }
-      g_rand_free (gr);
     }
 
   return TRUE;
@@ -29,6 +29,7 @@
 
 #include "operations-types.h"
 
+#include "gimp-hsl.h"
 #include "gimphuesaturationconfig.h"
 #include "gimpoperationhuesaturation.h"
 
@@ -141,15 +142,21 @@ gimp_operation_hue_saturation_process (GeglOperation       *operation,
   gfloat                   *src    = in_buf;
   gfloat                   *dest   = out_buf;
   gfloat                    overlap;
+  glong                     i;
 
   if (! config)
     return FALSE;
 
   overlap = config->overlap / 2.0;
 
-  while (samples--)
+  /*  convert all pixels to HSL at once, map them in place in @dest,
+   *  and convert them back
+   */
+  gimp_rgba_to_hsla (src, dest, samples);
+
+  for (i = 0; i < samples; i++)
     {
-      GimpRGB  rgb;
+      gfloat  *pixel               = dest + 4 * i;
       GimpHSL  hsl;
       gdouble  h;
       gint     hue_counter;
@@ -159,12 +166,9 @@ gimp_operation_hue_saturation_process (GeglOperation       *operation,
       gfloat   primary_intensity   = 0.0;
       gfloat   secondary_intensity = 0.0;
 
-      rgb.r = src[RED];
-      rgb.g = src[GREEN];
-      rgb.b = src[BLUE];
-      rgb.a = src[ALPHA];
-
-      gimp_rgb_to_hsl (&rgb, &hsl);
+      hsl.h = pixel[0];
+      hsl.s = pixel[1];
+      hsl.l = pixel[2];
 
       h = hsl.h * 6.0;
 
@@ -249,17 +253,13 @@ gimp_operation_hue_saturation_process (GeglOperation       *operation,
           hsl.l = map_lightness  (config, hue, hsl.l);
         }
 
-      gimp_hsl_to_rgb (&hsl, &rgb);
-
-      dest[RED]   = rgb.r;
-      dest[GREEN] = rgb.g;
-      dest[BLUE]  = rgb.b;
-      dest[ALPHA] = rgb.a;
-
-      src  += 4;
-      dest += 4;
+      pixel[0] = hsl.h;
+      pixel[1] = hsl.s;
+      pixel[2] = hsl.l;
     }
 
+  gimp_hsla_to_rgba (dest, dest, samples);
+
   return TRUE;
 }
 
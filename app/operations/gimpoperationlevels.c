@@ -20,6 +20,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <cairo.h>
 #include <gegl.h>
 
@@ -31,6 +33,14 @@
 #include "gimpoperationlevels.h"
 
 
+/*  the number of intervals of the lookup table; 8 and 16 bit values
+ *  fall exactly on its entries
+ */
+#define LUT_SIZE 65535
+
+
+static void     gimp_operation_levels_finalize (GObject             *object);
+
 static gboolean gimp_operation_levels_process (GeglOperation       *operation,
                                                void                *in_buf,
                                                void                *out_buf,
@@ -52,6 +62,7 @@ gimp_operation_levels_class_init (GimpOperationLevelsClass *klass)
   GeglOperationClass            *operation_class = GEGL_OPERATION_CLASS (klass);
   GeglOperationPointFilterClass *point_class     = GEGL_OPERATION_POINT_FILTER_CLASS (klass);
 
+  object_class->finalize       = gimp_operation_levels_finalize;
   object_class->set_property   = gimp_operation_point_filter_set_property;
   object_class->get_property   = gimp_operation_point_filter_get_property;
 
@@ -76,6 +87,20 @@ gimp_operation_levels_class_init (GimpOperationLevelsClass *klass)
 static void
 gimp_operation_levels_init (GimpOperationLevels *self)
 {
+  g_mutex_init (&self->lut_mutex);
+}
+
+static void
+gimp_operation_levels_finalize (GObject *object)
+{
+  GimpOperationLevels *self = GIMP_OPERATION_LEVELS (object);
+
+  g_free (self->lut);
+  self->lut = NULL;
+
+  g_mutex_clear (&self->lut_mutex);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 static inline gdouble
@@ -104,6 +129,82 @@ gimp_operation_levels_map (gdouble value,
   return value;
 }
 
+static inline gdouble
+gimp_operation_levels_map_channel (GimpLevelsConfig *config,
+                                   const gdouble    *inv_gamma,
+                                   gint              channel,
+                                   gdouble           value)
+{
+  value = gimp_operation_levels_map (value,
+                                     inv_gamma[channel + 1],
+                                     config->low_input[channel + 1],
+                                     config->high_input[channel + 1],
+                                     config->low_output[channel + 1],
+                                     config->high_output[channel + 1]);
+
+  /* don't apply the overall curve to the alpha channel */
+  if (channel != ALPHA)
+    value = gimp_operation_levels_map (value,
+                                       inv_gamma[0],
+                                       config->low_input[0],
+                                       config->high_input[0],
+                                       config->low_output[0],
+                                       config->high_output[0]);
+
+  return value;
+}
+
+/*  returns the lookup table of the channel mappings for the values
+ *  from 0.0 to 1.0, building it if @config changed since it was built
+ *  last
+ */
+static const gfloat *
+gimp_operation_levels_get_lut (GimpOperationLevels *self,
+                               GimpLevelsConfig    *config,
+                               const gdouble       *inv_gamma)
+{
+  const gfloat *lut;
+
+  g_mutex_lock (&self->lut_mutex);
+
+  if (! self->lut ||
+      memcmp (self->lut_gamma,       config->gamma,       sizeof (config->gamma))       ||
+      memcmp (self->lut_low_input,   config->low_input,   sizeof (config->low_input))   ||
+      memcmp (self->lut_high_input,  config->high_input,  sizeof (config->high_input))  ||
+      memcmp (self->lut_low_output,  config->low_output,  sizeof (config->low_output))  ||
+      memcmp (self->lut_high_output, config->high_output, sizeof (config->high_output)))
+    {
+      gint channel;
+      gint i;
+
+      if (! self->lut)
+        self->lut = g_new (gfloat, 4 * (LUT_SIZE + 1));
+
+      for (channel = 0; channel < 4; channel++)
+        {
+          gfloat *entries = self->lut + channel * (LUT_SIZE + 1);
+
+          for (i = 0; i <= LUT_SIZE; i++)
+            entries[i] = gimp_operation_levels_map_channel (config, inv_gamma,
+                                                            channel,
+                                                            (gdouble) i /
+                                                            LUT_SIZE);
+        }
+
+      memcpy (self->lut_gamma,       config->gamma,       sizeof (config->gamma));
+      memcpy (self->lut_low_input,   config->low_input,   sizeof (config->low_input));
+      memcpy (self->lut_high_input,  config->high_input,  sizeof (config->high_input));
+      memcpy (self->lut_low_output,  config->low_output,  sizeof (config->low_output));
+      memcpy (self->lut_high_output, config->high_output, sizeof (config->high_output));
+    }
+
+  lut = self->lut;
+
+  g_mutex_unlock (&self->lut_mutex);
+
+  return lut;
+}
+
 static gboolean
 gimp_operation_levels_process (GeglOperation       *operation,
                                void                *in_buf,
@@ -112,11 +213,13 @@ gimp_operation_levels_process (GeglOperation       *operation,
                                const GeglRectangle *roi,
                                gint                 level)
 {
+  GimpOperationLevels      *self   = GIMP_OPERATION_LEVELS (operation);
   GimpOperationPointFilter *point  = GIMP_OPERATION_POINT_FILTER (operation);
   GimpLevelsConfig         *config = GIMP_LEVELS_CONFIG (point->config);
   gfloat                   *src    = in_buf;
   gfloat                   *dest   = out_buf;
-  gfloat                    inv_gamma[5];
+  const gfloat             *lut;
+  gdouble                   inv_gamma[5];
   gint                      channel;
 
   if (! config)
@@ -129,29 +232,38 @@ gimp_operation_levels_process (GeglOperation       *operation,
       inv_gamma[channel] = 1.0 / config->gamma[channel];
     }
 
+  lut = gimp_operation_levels_get_lut (self, config, inv_gamma);
+
   while (samples--)
     {
       for (channel = 0; channel < 4; channel++)
         {
-          gdouble value;
-
-          value = gimp_operation_levels_map (src[channel],
-                                             inv_gamma[channel + 1],
-                                             config->low_input[channel + 1],
-                                             config->high_input[channel + 1],
-                                             config->low_output[channel + 1],
-                                             config->high_output[channel + 1]);
-
-          /* don't apply the overall curve to the alpha channel */
-          if (channel != ALPHA)
-            value = gimp_operation_levels_map (value,
-                                               inv_gamma[0],
-                                               config->low_input[0],
-                                               config->high_input[0],
-                                               config->low_output[0],
-                                               config->high_output[0]);
-
-          dest[channel] = value;
+          gfloat value = src[channel];
+
+          /*  interpolate the lookup table, and map the values it
+           *  doesn't cover, including NaN, directly
+           */
+          if (value >= 0.0f && value < 1.0f)
+            {
+              const gfloat *entries = lut + channel * (LUT_SIZE + 1);
+              gfloat        pos     = value * LUT_SIZE;
+              gint          index   = MIN ((gint) pos, LUT_SIZE - 1);
+              gfloat        f       = pos - index;
+
+              dest[channel] = entries[index] +
+                              f * (entries[index + 1] - entries[index]);
+            }
+          else if (value == 1.0f)
+            {
+              dest[channel] = lut[channel * (LUT_SIZE + 1) + LUT_SIZE];
+            }
+          else
+            {
+              dest[channel] = gimp_operation_levels_map_channel (config,
+                                                                 inv_gamma,
+                                                                 channel,
+                                                                 value);
+            }
         }
 
       src  += 4;
@@ -161,7 +273,6 @@ gimp_operation_levels_process (GeglOperation       *operation,
   return TRUE;
 }
 
-
 /*  public functions  */
 
 gdouble
@@ -39,6 +39,15 @@ typedef struct _GimpOperationLevelsClass GimpOperationLevelsClass;
 struct _GimpOperationLevels
 {
   GimpOperationPointFilter  parent_instance;
+
+  /*  the lookup table of the config values it was built for  */
+  GMutex                    lut_mutex;
+  gfloat                   *lut;
+  gdouble                   lut_gamma[5];
+  gdouble                   lut_low_input[5];
+  gdouble                   lut_high_input[5];
+  gdouble                   lut_low_output[5];
+  gdouble                   lut_high_output[5];
 };
 
 struct _GimpOperationLevelsClass
@@ -0,0 +1,312 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationpointlayermode-sse2.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl-plugin.h>
+
+#include "operations-types.h"
+
+#include "gimpoperationadditionmode.h"
+#include "gimpoperationburnmode.h"
+#include "gimpoperationdarkenonlymode.h"
+#include "gimpoperationdifferencemode.h"
+#include "gimpoperationdividemode.h"
+#include "gimpoperationdodgemode.h"
+#include "gimpoperationgrainextractmode.h"
+#include "gimpoperationgrainmergemode.h"
+#include "gimpoperationhardlightmode.h"
+#include "gimpoperationlightenonlymode.h"
+#include "gimpoperationmultiplymode.h"
+#include "gimpoperationoverlaymode.h"
+#include "gimpoperationscreenmode.h"
+#include "gimpoperationsoftlightmode.h"
+#include "gimpoperationsubtractmode.h"
+
+#if COMPILE_SSE2_INTRINISICS
+/* SSE2 */
+#include <emmintrin.h>
+
+
+/*  All the separable layer modes share the same compositing step: the
+ *  mode's blend result "comp" is mixed into the input by
+ *  comp_alpha / new_alpha, and the input's alpha is kept.  Only the
+ *  per-channel blend differs, so each mode just provides a function
+ *  computing it for one pixel at a time, and the loop is expanded for
+ *  each of them.
+ */
+
+typedef __m128 (* GimpLayerModeBlendSSE2) (__m128 in,
+                                           __m128 layer);
+
+
+static inline __m128
+clamp01 (__m128 v)
+{
+  return _mm_max_ps (_mm_min_ps (v, _mm_set1_ps (1.0f)), _mm_setzero_ps ());
+}
+
+static inline gboolean
+gimp_layer_mode_process_pixels_sse2 (gfloat                 *in,
+                                     gfloat                 *layer,
+                                     gfloat                 *mask,
+                                     gfloat                 *out,
+                                     gfloat                  opacity,
+                                     glong                   samples,
+                                     GimpLayerModeBlendSSE2  blend)
+{
+  const __m128 one      = _mm_set1_ps (1.0f);
+  const __m128 rgb_mask = _mm_castsi128_ps (_mm_set_epi32 (0, -1, -1, -1));
+
+  while (samples--)
+    {
+      __m128 v_in = _mm_loadu_ps (in);
+      gfloat comp_alpha;
+      gfloat new_alpha;
+
+      comp_alpha = MIN (in[ALPHA], layer[ALPHA]) * opacity;
+      if (mask)
+        comp_alpha *= *mask++;
+
+      new_alpha = in[ALPHA] + (1.0f - in[ALPHA]) * comp_alpha;
+
+      if (comp_alpha && new_alpha)
+        {
+          __m128 v_layer = _mm_loadu_ps (layer);
+          __m128 ratio   = _mm_set1_ps (comp_alpha / new_alpha);
+          __m128 comp;
+          __m128 v_out;
+
+          comp = blend (v_in, v_layer);
+
+          /* out = comp * ratio + in * (1.0 - ratio) */
+          v_out = _mm_add_ps (_mm_mul_ps (comp, ratio),
+                              _mm_mul_ps (v_in, _mm_sub_ps (one, ratio)));
+
+          /* keep the input's alpha */
+          v_out = _mm_or_ps (_mm_and_ps    (rgb_mask, v_out),
+                             _mm_andnot_ps (rgb_mask, v_in));
+
+          _mm_storeu_ps (out, v_out);
+        }
+      else
+        {
+          _mm_storeu_ps (out, v_in);
+        }
+
+      in    += 4;
+      layer += 4;
+      out   += 4;
+    }
+
+  return TRUE;
+}
+
+
+/*  the per-mode blend functions, see the _core () variants  */
+
+static inline __m128
+blend_multiply (__m128 in,
+                __m128 layer)
+{
+  return clamp01 (_mm_mul_ps (layer, in));
+}
+
+static inline __m128
+blend_screen (__m128 in,
+              __m128 layer)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+
+  return _mm_sub_ps (one, _mm_mul_ps (_mm_sub_ps (one, in),
+                                      _mm_sub_ps (one, layer)));
+}
+
+static inline __m128
+blend_overlay (__m128 in,
+               __m128 layer)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+  const __m128 two = _mm_set1_ps (2.0f);
+
+  return _mm_mul_ps (in,
+                     _mm_add_ps (in,
+                                 _mm_mul_ps (_mm_mul_ps (two, layer),
+                                             _mm_sub_ps (one, in))));
+}
+
+static inline __m128
+blend_difference (__m128 in,
+                  __m128 layer)
+{
+  const __m128 sign = _mm_set1_ps (-0.0f);
+
+  return _mm_andnot_ps (sign, _mm_sub_ps (in, layer));
+}
+
+static inline __m128
+blend_addition (__m128 in,
+                __m128 layer)
+{
+  return clamp01 (_mm_add_ps (in, layer));
+}
+
+static inline __m128
+blend_subtract (__m128 in,
+                __m128 layer)
+{
+  return _mm_max_ps (_mm_sub_ps (in, layer), _mm_setzero_ps ());
+}
+
+static inline __m128
+blend_darken_only (__m128 in,
+                   __m128 layer)
+{
+  return _mm_min_ps (in, layer);
+}
+
+static inline __m128
+blend_lighten_only (__m128 in,
+                    __m128 layer)
+{
+  return _mm_max_ps (layer, in);
+}
+
+static inline __m128
+blend_divide (__m128 in,
+              __m128 layer)
+{
+  __m128 comp;
+
+  comp = _mm_div_ps (_mm_mul_ps (_mm_set1_ps (256.0f / 255.0f), in),
+                     _mm_add_ps (_mm_set1_ps (1.0f / 255.0f), layer));
+
+  return _mm_min_ps (comp, _mm_set1_ps (1.0f));
+}
+
+static inline __m128
+blend_dodge (__m128 in,
+             __m128 layer)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+
+  return _mm_min_ps (_mm_div_ps (in, _mm_sub_ps (one, layer)), one);
+}
+
+static inline __m128
+blend_burn (__m128 in,
+            __m128 layer)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+
+  return clamp01 (_mm_sub_ps (one, _mm_div_ps (_mm_sub_ps (one, in), layer)));
+}
+
+static inline __m128
+blend_hardlight (__m128 in,
+                 __m128 layer)
+{
+  const __m128 one  = _mm_set1_ps (1.0f);
+  const __m128 two  = _mm_set1_ps (2.0f);
+  const __m128 half = _mm_set1_ps (0.5f);
+  __m128       screen;
+  __m128       multiply;
+  __m128       above;
+
+  /* layer > 0.5: 1.0 - (1.0 - in) * (1.0 - (layer - 0.5) * 2.0) */
+  screen = _mm_mul_ps (_mm_sub_ps (one, in),
+                       _mm_sub_ps (one, _mm_mul_ps (_mm_sub_ps (layer, half),
+                                                    two)));
+  screen = _mm_min_ps (_mm_sub_ps (one, screen), one);
+
+  /* layer <= 0.5: in * layer * 2.0 */
+  multiply = _mm_min_ps (_mm_mul_ps (in, _mm_mul_ps (layer, two)), one);
+
+  above = _mm_cmpgt_ps (layer, half);
+
+  return _mm_or_ps (_mm_and_ps (above, screen),
+                    _mm_andnot_ps (above, multiply));
+}
+
+static inline __m128
+blend_softlight (__m128 in,
+                 __m128 layer)
+{
+  const __m128 one = _mm_set1_ps (1.0f);
+  __m128       multiply;
+  __m128       screen;
+
+  multiply = _mm_mul_ps (in, layer);
+  screen   = _mm_sub_ps (one, _mm_mul_ps (_mm_sub_ps (one, in),
+                                          _mm_sub_ps (one, layer)));
+
+  return _mm_add_ps (_mm_mul_ps (_mm_sub_ps (one, in), multiply),
+                     _mm_mul_ps (in, screen));
+}
+
+static inline __m128
+blend_grain_extract (__m128 in,
+                     __m128 layer)
+{
+  return clamp01 (_mm_add_ps (_mm_sub_ps (in, layer), _mm_set1_ps (0.5f)));
+}
+
+static inline __m128
+blend_grain_merge (__m128 in,
+                   __m128 layer)
+{
+  return clamp01 (_mm_sub_ps (_mm_add_ps (in, layer), _mm_set1_ps (0.5f)));
+}
+
+
+#define DEFINE_LAYER_MODE_SSE2(name)                                            \
+gboolean                                                                        \
+gimp_operation_##name##_mode_process_pixels_sse2 (gfloat              *in,      \
+                                                  gfloat              *layer,   \
+                                                  gfloat              *mask,    \
+                                                  gfloat              *out,     \
+                                                  gfloat               opacity, \
+                                                  glong                samples, \
+                                                  const GeglRectangle *roi,     \
+                                                  gint                 level)   \
+{                                                                               \
+  return gimp_layer_mode_process_pixels_sse2 (in, layer, mask, out,             \
+                                              opacity, samples,                 \
+                                              blend_##name);                    \
+}
+
+DEFINE_LAYER_MODE_SSE2 (multiply)
+DEFINE_LAYER_MODE_SSE2 (screen)
+DEFINE_LAYER_MODE_SSE2 (overlay)
+DEFINE_LAYER_MODE_SSE2 (difference)
+DEFINE_LAYER_MODE_SSE2 (addition)
+DEFINE_LAYER_MODE_SSE2 (subtract)
+DEFINE_LAYER_MODE_SSE2 (darken_only)
+DEFINE_LAYER_MODE_SSE2 (lighten_only)
+DEFINE_LAYER_MODE_SSE2 (divide)
+DEFINE_LAYER_MODE_SSE2 (dodge)
+DEFINE_LAYER_MODE_SSE2 (burn)
+DEFINE_LAYER_MODE_SSE2 (hardlight)
+DEFINE_LAYER_MODE_SSE2 (softlight)
+DEFINE_LAYER_MODE_SSE2 (grain_extract)
+DEFINE_LAYER_MODE_SSE2 (grain_merge)
+
+#undef DEFINE_LAYER_MODE_SSE2
+
+#endif /* COMPILE_SSE2_INTRINISICS */
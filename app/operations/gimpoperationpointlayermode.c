@@ -29,6 +29,8 @@
 
 #include "operations-types.h"
 
+#include "gegl/gimp-gegl-mask.h"
+
 #include "gimpoperationpointlayermode.h"
 
 
@@ -174,10 +176,25 @@ gimp_operation_point_layer_mode_process (GeglOperation        *operation,
                                          gint                  level)
 {
   GimpOperationPointLayerMode *point;
+  GObject                     *mask;
+  gfloat                       mask_value;
+  gboolean                     masked_out = FALSE;
 
   point = GIMP_OPERATION_POINT_LAYER_MODE (operation);
 
-  if (point->opacity == 0.0 ||
+  mask = gegl_operation_context_get_object (context, "aux2");
+
+  /*  a layer mask that is fully transparent over the whole result,
+   *  as large parts of most masks are, hides the layer just like an
+   *  opacity of 0.0
+   */
+  if (GEGL_IS_BUFFER (mask) &&
+      gimp_gegl_mask_is_uniform (GEGL_BUFFER (mask), result, &mask_value))
+    {
+      masked_out = (mask_value == 0.0);
+    }
+
+  if (point->opacity == 0.0 || masked_out ||
       ! gegl_operation_context_get_object (context, "aux"))
     {
       GObject *input;
@@ -0,0 +1,256 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimpoperationprofiletransform.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <lcms2.h>
+
+#include <gegl.h>
+
+#include "operations-types.h"
+
+#include "gimpoperationprofiletransform.h"
+
+#include "gimp-intl.h"
+
+
+enum
+{
+  PROP_0,
+  PROP_SRC_PROFILE,
+  PROP_DEST_PROFILE,
+  PROP_INTENT,
+  PROP_BPC
+};
+
+
+static void       gimp_operation_profile_transform_finalize     (GObject             *object);
+static void       gimp_operation_profile_transform_get_property (GObject             *object,
+                                                                 guint                property_id,
+                                                                 GValue              *value,
+                                                                 GParamSpec          *pspec);
+static void       gimp_operation_profile_transform_set_property (GObject             *object,
+                                                                 guint                property_id,
+                                                                 const GValue        *value,
+                                                                 GParamSpec          *pspec);
+
+static void       gimp_operation_profile_transform_prepare      (GeglOperation       *operation);
+static gboolean   gimp_operation_profile_transform_process      (GeglOperation       *operation,
+                                                                 void                *in_buf,
+                                                                 void                *out_buf,
+                                                                 glong                samples,
+                                                                 const GeglRectangle *roi,
+                                                                 gint                 level);
+
+static void       gimp_operation_profile_transform_clear        (GimpOperationProfileTransform *self);
+
+
+G_DEFINE_TYPE (GimpOperationProfileTransform, gimp_operation_profile_transform,
+               GEGL_TYPE_OPERATION_POINT_FILTER)
+
+#define parent_class gimp_operation_profile_transform_parent_class
+
+
+static void
+gimp_operation_profile_transform_class_init (GimpOperationProfileTransformClass *klass)
+{
+  GObjectClass                  *object_class    = G_OBJECT_CLASS (klass);
+  GeglOperationClass            *operation_class = GEGL_OPERATION_CLASS (klass);
+  GeglOperationPointFilterClass *point_class     = GEGL_OPERATION_POINT_FILTER_CLASS (klass);
+
+  object_class->finalize     = gimp_operation_profile_transform_finalize;
+  object_class->set_property = gimp_operation_profile_transform_set_property;
+  object_class->get_property = gimp_operation_profile_transform_get_property;
+
+  gegl_operation_class_set_keys (operation_class,
+                                 "name",        "gimp:profile-transform",
+                                 "categories",  "color",
+                                 "description", _("Convert between two ICC color profiles"),
+                                 NULL);
+
+  operation_class->prepare = gimp_operation_profile_transform_prepare;
+
+  point_class->process     = gimp_operation_profile_transform_process;
+
+  g_object_class_install_property (object_class, PROP_SRC_PROFILE,
+                                   g_param_spec_pointer ("src-profile",
+                                                         "Source Profile",
+                                                         "The lcms profile to convert from",
+                                                         G_PARAM_READWRITE));
+
+  g_object_class_install_property (object_class, PROP_DEST_PROFILE,
+                                   g_param_spec_pointer ("dest-profile",
+                                                         "Destination Profile",
+                                                         "The lcms profile to convert to",
+                                                         G_PARAM_READWRITE));
+
+  g_object_class_install_property (object_class, PROP_INTENT,
+                                   g_param_spec_enum ("intent",
+                                                      "Intent",
+                                                      "The rendering intent",
+                                                      GIMP_TYPE_COLOR_RENDERING_INTENT,
+                                                      GIMP_COLOR_RENDERING_INTENT_PERCEPTUAL,
+                                                      G_PARAM_READWRITE |
+                                                      G_PARAM_CONSTRUCT));
+
+  g_object_class_install_property (object_class, PROP_BPC,
+                                   g_param_spec_boolean ("bpc",
+                                                         "Black Point Compensation",
+                                                         "Whether to use black point compensation",
+                                                         FALSE,
+                                                         G_PARAM_READWRITE |
+                                                         G_PARAM_CONSTRUCT));
+}
+
+static void
+gimp_operation_profile_transform_init (GimpOperationProfileTransform *self)
+{
+}
+
+static void
+gimp_operation_profile_transform_finalize (GObject *object)
+{
+  GimpOperationProfileTransform *self = GIMP_OPERATION_PROFILE_TRANSFORM (object);
+
+  gimp_operation_profile_transform_clear (self);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gimp_operation_profile_transform_get_property (GObject    *object,
+                                               guint       property_id,
+                                               GValue     *value,
+                                               GParamSpec *pspec)
+{
+  GimpOperationProfileTransform *self = GIMP_OPERATION_PROFILE_TRANSFORM (object);
+
+  switch (property_id)
+    {
+    case PROP_SRC_PROFILE:
+      g_value_set_pointer (value, self->src_profile);
+      break;
+
+    case PROP_DEST_PROFILE:
+      g_value_set_pointer (value, self->dest_profile);
+      break;
+
+    case PROP_INTENT:
+      g_value_set_enum (value, self->intent);
+      break;
+
+    case PROP_BPC:
+      g_value_set_boolean (value, self->bpc);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+    }
+}
+
+static void
+gimp_operation_profile_transform_set_property (GObject      *object,
+                                               guint         property_id,
+                                               const GValue *value,
+                                               GParamSpec   *pspec)
+{
+  GimpOperationProfileTransform *self = GIMP_OPERATION_PROFILE_TRANSFORM (object);
+
+  switch (property_id)
+    {
+    case PROP_SRC_PROFILE:
+      self->src_profile = g_value_get_pointer (value);
+      break;
+
+    case PROP_DEST_PROFILE:
+      self->dest_profile = g_value_get_pointer (value);
+      break;
+
+    case PROP_INTENT:
+      self->intent = g_value_get_enum (value);
+      break;
+
+    case PROP_BPC:
+      self->bpc = g_value_get_boolean (value);
+      break;
+
+   default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      return;
+    }
+
+  /*  any change invalidates the transform, prepare() makes a new one  */
+  gimp_operation_profile_transform_clear (self);
+}
+
+static void
+gimp_operation_profile_transform_prepare (GeglOperation *operation)
+{
+  GimpOperationProfileTransform *self = GIMP_OPERATION_PROFILE_TRANSFORM (operation);
+
+  gegl_operation_set_format (operation, "input",  babl_format ("R'G'B'A float"));
+  gegl_operation_set_format (operation, "output", babl_format ("R'G'B'A float"));
+
+  if (! self->transform && self->src_profile && self->dest_profile)
+    {
+      /*  process() runs in several threads at once, which lcms only
+       *  allows for transforms without the one-pixel cache
+       */
+      self->transform =
+        cmsCreateTransform (self->src_profile,  TYPE_RGBA_FLT,
+                            self->dest_profile, TYPE_RGBA_FLT,
+                            self->intent,
+                            cmsFLAGS_NOOPTIMIZE |
+                            cmsFLAGS_NOCACHE    |
+                            (self->bpc ? cmsFLAGS_BLACKPOINTCOMPENSATION : 0));
+    }
+}
+
+static gboolean
+gimp_operation_profile_transform_process (GeglOperation       *operation,
+                                          void                *in_buf,
+                                          void                *out_buf,
+                                          glong                samples,
+                                          const GeglRectangle *roi,
+                                          gint                 level)
+{
+  GimpOperationProfileTransform *self = GIMP_OPERATION_PROFILE_TRANSFORM (operation);
+
+  /*  lcms doesn't touch the alpha channel, copy it along  */
+  if (in_buf != out_buf)
+    memcpy (out_buf, in_buf, samples * 4 * sizeof (gfloat));
+
+  if (self->transform)
+    cmsDoTransform (self->transform, in_buf, out_buf, samples);
+
+  return TRUE;
+}
+
+static void
+gimp_operation_profile_transform_clear (GimpOperationProfileTransform *self)
+{
+  if (self->transform)
+    {
+      cmsDeleteTransform (self->transform);
+      self->transform = NULL;
+    }
+}
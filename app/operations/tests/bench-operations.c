@@ -0,0 +1,490 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <gegl.h>
+#include <gegl-plugin.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpconfig/gimpconfig.h"
+
+#include "app/operations/operations-types.h"
+
+#include "app/core/gimphistogram.h"
+
+#include "app/operations/gimp-operations.h"
+#include "app/operations/gimpcageconfig.h"
+
+
+/*  Times every gimp: operation on buffers of different sizes and
+ *  formats and prints megapixels per second.
+ *
+ *  The SSE variants of the operations are picked once, when their
+ *  class is initialized, so the scalar timings are taken by a second
+ *  instance of this program started with --no-cpu-accel.
+ */
+
+
+#define BENCH_N_FORMATS 4
+
+
+static const gchar *bench_formats[BENCH_N_FORMATS] =
+{
+  "R'G'B'A u8",
+  "RGBA u16",
+  "RGBA half",
+  "RGBA float"
+};
+
+static gint      bench_iterations = 3;
+static gchar    *bench_sizes      = NULL;
+static gchar    *bench_filter     = NULL;
+static gboolean  bench_no_accel   = FALSE;
+static gboolean  bench_raw        = FALSE;
+
+static const GOptionEntry bench_options[] =
+{
+  { "iterations", 0, 0, G_OPTION_ARG_INT, &bench_iterations,
+    "Number of runs of each operation, the fastest is reported", "N" },
+  { "sizes", 0, 0, G_OPTION_ARG_STRING, &bench_sizes,
+    "Comma separated buffer sizes (default: 256,1024)", "N,..." },
+  { "filter", 0, 0, G_OPTION_ARG_STRING, &bench_filter,
+    "Only time operations whose name contains STRING", "STRING" },
+  { "no-cpu-accel", 0, 0, G_OPTION_ARG_NONE, &bench_no_accel,
+    "Time the scalar code only", NULL },
+  { "raw", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_NONE, &bench_raw,
+    "Print tab separated results only", NULL },
+  { NULL }
+};
+
+
+static void
+bench_collect_operations (GType    type,
+                          GList  **names)
+{
+  GType *operations;
+  guint  count;
+  gint   i;
+
+  operations = g_type_children (type, &count);
+
+  for (i = 0; i < count; i++)
+    {
+      if (! G_TYPE_IS_ABSTRACT (operations[i]))
+        {
+          GeglOperationClass *operation_class;
+          const gchar        *name;
+
+          operation_class = g_type_class_ref (operations[i]);
+          name = gegl_operation_class_get_key (operation_class, "name");
+
+          if (name && g_str_has_prefix (name, "gimp:") &&
+              (! bench_filter || strstr (name, bench_filter)))
+            {
+              *names = g_list_prepend (*names, g_strdup (name));
+            }
+
+          g_type_class_unref (operation_class);
+        }
+
+      bench_collect_operations (operations[i], names);
+    }
+
+  g_free (operations);
+}
+
+static GeglBuffer *
+bench_create_buffer (const gchar *format,
+                     gint         size,
+                     gint         seed)
+{
+  GeglRectangle  rect   = { 0, 0, size, size };
+  GeglBuffer    *buffer = gegl_buffer_new (&rect, babl_format (format));
+  gfloat        *data   = g_new (gfloat, size * 4);
+  GRand         *rand   = g_rand_new_with_seed (seed);
+  gint           x, y;
+
+  /*  smooth gradients with some noise, and an alpha channel which
+   *  covers the whole range, so no code path is skipped
+   */
+  for (y = 0; y < size; y++)
+    {
+      gfloat *d = data;
+
+      for (x = 0; x < size; x++)
+        {
+          *d++ = (gfloat) x / size;
+          *d++ = (gfloat) y / size;
+          *d++ = g_rand_double (rand);
+          *d++ = 0.5 + 0.5 * sin ((x + y + seed) / 16.0);
+        }
+
+      gegl_buffer_set (buffer, GEGL_RECTANGLE (0, y, size, 1), 0,
+                       babl_format ("RGBA float"), data,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_rand_free (rand);
+  g_free (data);
+
+  return buffer;
+}
+
+static GimpCageConfig *
+bench_create_cage_config (gint size)
+{
+  GimpCageConfig *config = g_object_new (GIMP_TYPE_CAGE_CONFIG, NULL);
+  gint            i;
+
+  /*  an octagon around the center of the buffer  */
+  for (i = 0; i < 8; i++)
+    {
+      gdouble angle = i * G_PI / 4;
+
+      gimp_cage_config_add_cage_point (config,
+                                       size / 2 + size / 3 * cos (angle),
+                                       size / 2 + size / 3 * sin (angle));
+    }
+
+  gimp_cage_config_reverse_cage_if_needed (config);
+
+  return config;
+}
+
+/*  gives the operation's object properties something to work with,
+ *  an operation without its config object just passes its input through
+ */
+static void
+bench_set_properties (GeglNode    *node,
+                      const gchar *name,
+                      gint         size)
+{
+  GParamSpec **pspecs;
+  guint        n_pspecs;
+  gint         i;
+
+  pspecs = gegl_operation_list_properties (name, &n_pspecs);
+
+  for (i = 0; i < n_pspecs; i++)
+    {
+      GType    type   = G_PARAM_SPEC_VALUE_TYPE (pspecs[i]);
+      GObject *object = NULL;
+
+      if (! (pspecs[i]->flags & G_PARAM_WRITABLE) ||
+          ! g_type_is_a (type, G_TYPE_OBJECT))
+        continue;
+
+      if (g_type_is_a (type, GIMP_TYPE_HISTOGRAM))
+        object = G_OBJECT (gimp_histogram_new (FALSE));
+      else if (g_type_is_a (type, GIMP_TYPE_CAGE_CONFIG))
+        object = G_OBJECT (bench_create_cage_config (size));
+      else if (g_type_is_a (type, GIMP_TYPE_CONFIG) &&
+               ! G_TYPE_IS_ABSTRACT (type))
+        object = g_object_new (type, NULL);
+
+      if (object)
+        {
+          gegl_node_set (node, pspecs[i]->name, object, NULL);
+          g_object_unref (object);
+        }
+    }
+
+  g_free (pspecs);
+}
+
+static gdouble
+bench_operation (const gchar *name,
+                 GeglBuffer  *input,
+                 GeglBuffer  *aux,
+                 GeglBuffer  *output,
+                 gint         size)
+{
+  GTimer  *timer = g_timer_new ();
+  gdouble  best  = G_MAXDOUBLE;
+  gint     i;
+
+  for (i = 0; i < bench_iterations; i++)
+    {
+      GeglNode *graph = gegl_node_new ();
+      GeglNode *node;
+      GeglNode *sink;
+      gdouble   elapsed;
+
+      node = gegl_node_new_child (graph,
+                                  "operation", name,
+                                  NULL);
+
+      bench_set_properties (node, name, size);
+
+      if (gegl_node_has_pad (node, "input"))
+        {
+          GeglNode *source = gegl_node_new_child (graph,
+                                                  "operation", "gegl:buffer-source",
+                                                  "buffer",    input,
+                                                  NULL);
+
+          gegl_node_connect_to (source, "output", node, "input");
+        }
+
+      if (gegl_node_has_pad (node, "aux"))
+        {
+          GeglNode *source;
+
+          if (! strcmp (name, "gimp:cage-transform"))
+            {
+              GObject *config;
+
+              /*  the cage transform's aux are the cage coefficients  */
+              gegl_node_get (node, "config", &config, NULL);
+
+              source = gegl_node_new_child (graph,
+                                            "operation", "gimp:cage-coef-calc",
+                                            "config",    config,
+                                            NULL);
+
+              g_object_unref (config);
+            }
+          else
+            {
+              source = gegl_node_new_child (graph,
+                                            "operation", "gegl:buffer-source",
+                                            "buffer",    aux,
+                                            NULL);
+            }
+
+          gegl_node_connect_to (source, "output", node, "aux");
+        }
+
+      if (gegl_node_has_pad (node, "output"))
+        {
+          sink = gegl_node_new_child (graph,
+                                      "operation", "gegl:write-buffer",
+                                      "buffer",    output,
+                                      NULL);
+
+          gegl_node_connect_to (node, "output", sink, "input");
+        }
+      else
+        {
+          sink = node;
+        }
+
+      g_timer_start (timer);
+      gegl_node_process (sink);
+      elapsed = g_timer_elapsed (timer, NULL);
+
+      best = MIN (best, elapsed);
+
+      g_object_unref (graph);
+    }
+
+  g_timer_destroy (timer);
+
+  return (gdouble) size * size / 1000000.0 / MAX (best, 1e-9);
+}
+
+/*  runs this program again without CPU acceleration, and returns its
+ *  results as "operation format size" => "Mpx/s"
+ */
+static GHashTable *
+bench_run_scalar (const gchar *program)
+{
+  GHashTable  *results;
+  GPtrArray   *argv;
+  gchar       *output = NULL;
+  gchar      **lines;
+  gint         status;
+  GError      *error  = NULL;
+  gint         i;
+
+  results = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  argv = g_ptr_array_new_with_free_func (g_free);
+
+  g_ptr_array_add (argv, g_strdup (program));
+  g_ptr_array_add (argv, g_strdup ("--no-cpu-accel"));
+  g_ptr_array_add (argv, g_strdup ("--raw"));
+  g_ptr_array_add (argv, g_strdup_printf ("--iterations=%d",
+                                          bench_iterations));
+  g_ptr_array_add (argv, g_strdup_printf ("--sizes=%s", bench_sizes));
+
+  if (bench_filter)
+    g_ptr_array_add (argv, g_strdup_printf ("--filter=%s", bench_filter));
+
+  g_ptr_array_add (argv, NULL);
+
+  if (! g_spawn_sync (NULL, (gchar **) argv->pdata, NULL, 0, NULL, NULL,
+                      &output, NULL, &status, &error))
+    {
+      g_printerr ("Could not time the scalar code: %s\n", error->message);
+      g_clear_error (&error);
+      g_ptr_array_free (argv, TRUE);
+
+      return results;
+    }
+
+  g_ptr_array_free (argv, TRUE);
+
+  lines = g_strsplit (output, "\n", -1);
+
+  for (i = 0; lines[i]; i++)
+    {
+      gchar **fields = g_strsplit (lines[i], "\t", -1);
+
+      if (g_strv_length (fields) == 4)
+        {
+          g_hash_table_insert (results,
+                               g_strdup_printf ("%s %s %s",
+                                                fields[0], fields[1],
+                                                fields[2]),
+                               g_strdup (fields[3]));
+        }
+
+      g_strfreev (fields);
+    }
+
+  g_strfreev (lines);
+  g_free (output);
+
+  return results;
+}
+
+gint
+main (gint    argc,
+      gchar **argv)
+{
+  GOptionContext  *context;
+  GError          *error   = NULL;
+  GHashTable      *scalar  = NULL;
+  GList           *names   = NULL;
+  GList           *list;
+  gchar          **sizes;
+  gint             i;
+
+  context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, bench_options, NULL);
+
+  if (! g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  g_option_context_free (context);
+
+  bench_iterations = MAX (bench_iterations, 1);
+
+  if (! bench_sizes)
+    bench_sizes = g_strdup ("256,1024");
+
+  /*  must happen before any operation class is initialized  */
+  if (bench_no_accel)
+    gimp_cpu_accel_set_use (FALSE);
+
+  gegl_init (&argc, &argv);
+  gimp_operations_init ();
+
+  if (! bench_raw && gimp_cpu_accel_get_support () != GIMP_CPU_ACCEL_NONE)
+    scalar = bench_run_scalar (argv[0]);
+
+  bench_collect_operations (GEGL_TYPE_OPERATION, &names);
+  names = g_list_sort (names, (GCompareFunc) strcmp);
+
+  sizes = g_strsplit (bench_sizes, ",", -1);
+
+  if (! bench_raw)
+    g_print ("%-32s %-12s %6s %10s %10s %8s\n",
+             "Operation", "Format", "Size", "Mpx/s", "Scalar", "Speedup");
+
+  for (i = 0; sizes[i]; i++)
+    {
+      gint size = atoi (sizes[i]);
+      gint j;
+
+      if (size <= 0)
+        continue;
+
+      for (j = 0; j < BENCH_N_FORMATS; j++)
+        {
+          GeglBuffer *input  = bench_create_buffer (bench_formats[j], size, 1);
+          GeglBuffer *aux    = bench_create_buffer (bench_formats[j], size, 2);
+          GeglBuffer *output = bench_create_buffer (bench_formats[j], size, 3);
+
+          for (list = names; list; list = g_list_next (list))
+            {
+              const gchar *name = list->data;
+              gdouble      mpx;
+
+              mpx = bench_operation (name, input, aux, output, size);
+
+              if (bench_raw)
+                {
+                  g_print ("%s\t%s\t%d\t%.3f\n",
+                           name, bench_formats[j], size, mpx);
+                }
+              else
+                {
+                  const gchar *scalar_mpx = NULL;
+
+                  if (scalar)
+                    {
+                      gchar *key = g_strdup_printf ("%s %s %d",
+                                                    name, bench_formats[j],
+                                                    size);
+
+                      scalar_mpx = g_hash_table_lookup (scalar, key);
+                      g_free (key);
+                    }
+
+                  if (scalar_mpx && g_ascii_strtod (scalar_mpx, NULL) > 0.0)
+                    {
+                      gdouble scalar_value = g_ascii_strtod (scalar_mpx, NULL);
+
+                      g_print ("%-32s %-12s %6d %10.1f %10.1f %7.2fx\n",
+                               name, bench_formats[j], size,
+                               mpx, scalar_value, mpx / scalar_value);
+                    }
+                  else
+                    {
+                      g_print ("%-32s %-12s %6d %10.1f %10s %8s\n",
+                               name, bench_formats[j], size,
+                               mpx, "-", "-");
+                    }
+                }
+            }
+
+          g_object_unref (input);
+          g_object_unref (aux);
+          g_object_unref (output);
+        }
+    }
+
+  g_strfreev (sizes);
+  g_list_free_full (names, g_free);
+
+  if (scalar)
+    g_hash_table_unref (scalar);
+
+  gegl_exit ();
+
+  return EXIT_SUCCESS;
+}
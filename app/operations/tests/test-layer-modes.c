@@ -0,0 +1,206 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <math.h>
+
+#include <gegl.h>
+#include <gegl-plugin.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "app/operations/operations-types.h"
+
+#include "app/operations/gimpoperationadditionmode.h"
+#include "app/operations/gimpoperationburnmode.h"
+#include "app/operations/gimpoperationdarkenonlymode.h"
+#include "app/operations/gimpoperationdifferencemode.h"
+#include "app/operations/gimpoperationdividemode.h"
+#include "app/operations/gimpoperationdodgemode.h"
+#include "app/operations/gimpoperationgrainextractmode.h"
+#include "app/operations/gimpoperationgrainmergemode.h"
+#include "app/operations/gimpoperationhardlightmode.h"
+#include "app/operations/gimpoperationlightenonlymode.h"
+#include "app/operations/gimpoperationmultiplymode.h"
+#include "app/operations/gimpoperationoverlaymode.h"
+#include "app/operations/gimpoperationscreenmode.h"
+#include "app/operations/gimpoperationsoftlightmode.h"
+#include "app/operations/gimpoperationsubtractmode.h"
+
+
+/*  Runs the scalar and the SSE2 variant of each separable layer mode
+ *  on the same random input and checks that they agree.
+ */
+
+#define N_SAMPLES 4099 /* not a multiple of 4 on purpose */
+#define EPSILON   1e-5
+#define SEED      0x6c61796d
+
+
+#if COMPILE_SSE2_INTRINISICS
+
+typedef struct
+{
+  const gchar           *name;
+  GimpLayerModeFunction  core;
+  GimpLayerModeFunction  sse2;
+} LayerModeVariants;
+
+static const LayerModeVariants layer_modes[] =
+{
+#define LAYER_MODE(name) \
+  { #name, \
+    gimp_operation_##name##_mode_process_pixels_core, \
+    gimp_operation_##name##_mode_process_pixels_sse2 }
+
+  LAYER_MODE (multiply),
+  LAYER_MODE (screen),
+  LAYER_MODE (overlay),
+  LAYER_MODE (difference),
+  LAYER_MODE (addition),
+  LAYER_MODE (subtract),
+  LAYER_MODE (darken_only),
+  LAYER_MODE (lighten_only),
+  LAYER_MODE (divide),
+  LAYER_MODE (dodge),
+  LAYER_MODE (burn),
+  LAYER_MODE (hardlight),
+  LAYER_MODE (softlight),
+  LAYER_MODE (grain_extract),
+  LAYER_MODE (grain_merge)
+
+#undef LAYER_MODE
+};
+
+
+static void
+fill_random (GRand  *rand,
+             gfloat *buf,
+             glong   n_values)
+{
+  glong i;
+
+  for (i = 0; i < n_values; i++)
+    buf[i] = g_rand_double (rand);
+
+  /*  make sure both edge cases of the alpha test are hit  */
+  if (n_values >= 8)
+    {
+      buf[3] = 0.0;
+      buf[7] = 1.0;
+    }
+}
+
+static gboolean
+compare_values (gfloat a,
+                gfloat b)
+{
+  if (isnan (a) || isnan (b))
+    return isnan (a) && isnan (b);
+
+  return fabs (a - b) <= EPSILON * MAX (1.0, fabs (a));
+}
+
+static void
+test_layer_mode (gconstpointer data)
+{
+  const LayerModeVariants *mode = data;
+  GeglRectangle            roi  = { 0, 0, N_SAMPLES, 1 };
+  GRand                   *rand;
+  gfloat                  *in;
+  gfloat                  *layer;
+  gfloat                  *mask;
+  gfloat                  *out_core;
+  gfloat                  *out_sse2;
+  gint                     with_mask;
+
+  if (! (gimp_cpu_accel_get_support () & GIMP_CPU_ACCEL_X86_SSE2))
+    {
+      g_test_message ("SSE2 is not supported by this CPU, skipping");
+      return;
+    }
+
+  rand = g_rand_new_with_seed (SEED);
+
+  in       = g_new (gfloat, N_SAMPLES * 4);
+  layer    = g_new (gfloat, N_SAMPLES * 4);
+  mask     = g_new (gfloat, N_SAMPLES);
+  out_core = g_new (gfloat, N_SAMPLES * 4);
+  out_sse2 = g_new (gfloat, N_SAMPLES * 4);
+
+  fill_random (rand, in,    N_SAMPLES * 4);
+  fill_random (rand, layer, N_SAMPLES * 4);
+  fill_random (rand, mask,  N_SAMPLES);
+
+  for (with_mask = 0; with_mask < 2; with_mask++)
+    {
+      gfloat opacity = g_rand_double (rand);
+      glong  i;
+
+      mode->core (in, layer, with_mask ? mask : NULL, out_core,
+                  opacity, N_SAMPLES, &roi, 0);
+      mode->sse2 (in, layer, with_mask ? mask : NULL, out_sse2,
+                  opacity, N_SAMPLES, &roi, 0);
+
+      for (i = 0; i < N_SAMPLES * 4; i++)
+        {
+          if (! compare_values (out_core[i], out_sse2[i]))
+            g_error ("%s mode (%s mask): sample %ld channel %ld differs: "
+                     "scalar %.8f, SSE2 %.8f (in %.8f, layer %.8f)",
+                     mode->name, with_mask ? "with" : "without",
+                     i / 4, i % 4, out_core[i], out_sse2[i],
+                     in[i], layer[i]);
+        }
+    }
+
+  g_free (in);
+  g_free (layer);
+  g_free (mask);
+  g_free (out_core);
+  g_free (out_sse2);
+
+  g_rand_free (rand);
+}
+
+#endif /* COMPILE_SSE2_INTRINISICS */
+
+
+int
+main (gint    argc,
+      gchar **argv)
+{
+#if COMPILE_SSE2_INTRINISICS
+  gint i;
+#endif
+
+  g_test_init (&argc, &argv, NULL);
+
+#if COMPILE_SSE2_INTRINISICS
+  for (i = 0; i < G_N_ELEMENTS (layer_modes); i++)
+    {
+      gchar *path = g_strdup_printf ("/layer-modes/sse2/%s",
+                                     layer_modes[i].name);
+
+      g_test_add_data_func (path, &layer_modes[i], test_layer_mode);
+
+      g_free (path);
+    }
+#endif /* COMPILE_SSE2_INTRINISICS */
+
+  return g_test_run ();
+}
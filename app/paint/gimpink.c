@@ -134,6 +134,12 @@ gimp_ink_finalize (GObject *object)
       ink->last_blob = NULL;
     }
 
+  if (ink->paint_backing)
+    {
+      g_object_unref (ink->paint_backing);
+      ink->paint_backing = NULL;
+    }
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -188,6 +194,11 @@ gimp_ink_paint (GimpPaintCore    *paint_core,
       break;
 
     case GIMP_PAINT_STATE_FINISH:
+      if (ink->paint_backing)
+        {
+          g_object_unref (ink->paint_backing);
+          ink->paint_backing = NULL;
+        }
       break;
     }
 }
@@ -219,16 +230,42 @@ gimp_ink_get_paint_buffer (GimpPaintCore    *paint_core,
   /*  configure the canvas buffer  */
   if ((x2 - x1) && (y2 - y1))
     {
-      GimpTempBuf *temp_buf;
-      const Babl  *format;
+      const Babl *format;
 
       if (gimp_drawable_get_linear (drawable))
         format = babl_format ("RGBA float");
       else
         format = babl_format ("R'G'B'A float");
 
-      temp_buf = gimp_temp_buf_new ((x2 - x1), (y2 - y1),
-                                    format);
+      /*  the blobs change size with every motion event, so instead of
+       *  allocating a new buffer for each of them, hand out parts of
+       *  a buffer that only grows during the stroke
+       */
+      if (! ink->paint_backing                                     ||
+          gegl_buffer_get_width  (ink->paint_backing) <  (x2 - x1) ||
+          gegl_buffer_get_height (ink->paint_backing) <  (y2 - y1) ||
+          gegl_buffer_get_format (ink->paint_backing) != format)
+        {
+          GimpTempBuf *temp_buf;
+          gint         width  = x2 - x1;
+          gint         height = y2 - y1;
+
+          if (ink->paint_backing)
+            {
+              width  = MAX (width,
+                            gegl_buffer_get_width  (ink->paint_backing));
+              height = MAX (height,
+                            gegl_buffer_get_height (ink->paint_backing));
+
+              g_object_unref (ink->paint_backing);
+            }
+
+          temp_buf = gimp_temp_buf_new (width, height, format);
+
+          ink->paint_backing = gimp_temp_buf_create_buffer (temp_buf);
+
+          gimp_temp_buf_unref (temp_buf);
+        }
 
       *paint_buffer_x = x1;
       *paint_buffer_y = y1;
@@ -236,9 +273,10 @@ gimp_ink_get_paint_buffer (GimpPaintCore    *paint_core,
       if (paint_core->paint_buffer)
         g_object_unref (paint_core->paint_buffer);
 
-      paint_core->paint_buffer = gimp_temp_buf_create_buffer (temp_buf);
-
-      gimp_temp_buf_unref (temp_buf);
+      paint_core->paint_buffer =
+        gegl_buffer_create_sub_buffer (ink->paint_backing,
+                                       GEGL_RECTANGLE (0, 0,
+                                                       x2 - x1, y2 - y1));
 
       return paint_core->paint_buffer;
     }
@@ -41,6 +41,8 @@ struct _GimpInk
 
   GimpBlob      *cur_blob;     /*  current blob                   */
   GimpBlob      *last_blob;    /*  blob for last cursor position  */
+
+  GeglBuffer    *paint_backing; /*  the paint buffers' pixels      */
 };
 
 struct _GimpInkClass
@@ -0,0 +1,382 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "paint-types.h"
+
+#include "core/gimpdrawable.h"
+#include "core/gimperror.h"
+
+#include "gimppaintcore.h"
+#include "gimppaintcore-replay.h"
+#include "gimppaintoptions.h"
+
+#include "gimp-intl.h"
+
+
+/*  The event files are plain text, one event per line:
+ *
+ *    time x y pressure xtilt ytilt wheel velocity direction
+ *
+ *  Lines starting with '#' are comments.
+ */
+#define PAINT_EVENTS_HEADER "# GIMP paint events\n"
+#define PAINT_EVENTS_FIELDS 9
+
+
+static gint   gimp_paint_core_replay_compare (gconstpointer a,
+                                              gconstpointer b);
+
+
+/*  public functions  */
+
+/**
+ * gimp_paint_core_record_start:
+ * @core: a #GimpPaintCore
+ *
+ * Starts recording the coordinates passed to
+ * gimp_paint_core_interpolate(), until gimp_paint_core_record_stop()
+ * is called. The first point of a stroke isn't interpolated, the
+ * caller has to add it with gimp_paint_core_record().
+ **/
+void
+gimp_paint_core_record_start (GimpPaintCore *core)
+{
+  g_return_if_fail (GIMP_IS_PAINT_CORE (core));
+
+  if (core->recording)
+    g_array_set_size (core->recording, 0);
+  else
+    core->recording = g_array_new (FALSE, FALSE, sizeof (GimpPaintEvent));
+}
+
+/**
+ * gimp_paint_core_record_stop:
+ * @core:     a #GimpPaintCore
+ * @n_events: returns the number of recorded events
+ *
+ * Return value: the events recorded since
+ *               gimp_paint_core_record_start(), free them with g_free().
+ **/
+GimpPaintEvent *
+gimp_paint_core_record_stop (GimpPaintCore *core,
+                             gint          *n_events)
+{
+  GimpPaintEvent *events;
+
+  g_return_val_if_fail (GIMP_IS_PAINT_CORE (core), NULL);
+  g_return_val_if_fail (n_events != NULL, NULL);
+
+  if (! core->recording)
+    {
+      *n_events = 0;
+
+      return NULL;
+    }
+
+  *n_events = core->recording->len;
+
+  events = (GimpPaintEvent *) g_array_free (core->recording, FALSE);
+  core->recording = NULL;
+
+  return events;
+}
+
+void
+gimp_paint_core_record (GimpPaintCore    *core,
+                        const GimpCoords *coords,
+                        guint32           time)
+{
+  GimpPaintEvent event;
+
+  g_return_if_fail (GIMP_IS_PAINT_CORE (core));
+  g_return_if_fail (coords != NULL);
+
+  if (! core->recording)
+    return;
+
+  event.coords = *coords;
+  event.time   = time;
+
+  g_array_append_val (core->recording, event);
+}
+
+gboolean
+gimp_paint_events_save (const gchar           *filename,
+                        const GimpPaintEvent  *events,
+                        gint                   n_events,
+                        GError               **error)
+{
+  GString  *string;
+  gboolean  success;
+  gint      i;
+
+  g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (events != NULL || n_events == 0, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  string = g_string_new (PAINT_EVENTS_HEADER);
+
+  g_string_append (string,
+                   "# time x y pressure xtilt ytilt wheel "
+                   "velocity direction\n");
+
+  for (i = 0; i < n_events; i++)
+    {
+      const GimpCoords *coords = &events[i].coords;
+      const gdouble     values[] = { coords->x,
+                                     coords->y,
+                                     coords->pressure,
+                                     coords->xtilt,
+                                     coords->ytilt,
+                                     coords->wheel,
+                                     coords->velocity,
+                                     coords->direction };
+      gint              j;
+
+      g_string_append_printf (string, "%u", events[i].time);
+
+      for (j = 0; j < G_N_ELEMENTS (values); j++)
+        {
+          gchar buf[G_ASCII_DTOSTR_BUF_SIZE];
+
+          g_string_append_c (string, ' ');
+          g_string_append (string,
+                           g_ascii_formatd (buf, sizeof (buf), "%.6g",
+                                            values[j]));
+        }
+
+      g_string_append_c (string, '\n');
+    }
+
+  success = g_file_set_contents (filename, string->str, string->len, error);
+
+  g_string_free (string, TRUE);
+
+  return success;
+}
+
+GimpPaintEvent *
+gimp_paint_events_load (const gchar  *filename,
+                        gint         *n_events,
+                        GError      **error)
+{
+  GArray  *events;
+  gchar   *contents;
+  gchar  **lines;
+  gint     i;
+
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (n_events != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  *n_events = 0;
+
+  if (! g_file_get_contents (filename, &contents, NULL, error))
+    return NULL;
+
+  if (! g_str_has_prefix (contents, PAINT_EVENTS_HEADER))
+    {
+      g_set_error (error, GIMP_ERROR, GIMP_FAILED,
+                   _("'%s' is not a paint events file"),
+                   gimp_filename_to_utf8 (filename));
+      g_free (contents);
+
+      return NULL;
+    }
+
+  events = g_array_new (FALSE, FALSE, sizeof (GimpPaintEvent));
+  lines  = g_strsplit (contents, "\n", -1);
+
+  g_free (contents);
+
+  for (i = 0; lines[i]; i++)
+    {
+      GimpPaintEvent  event;
+      gdouble         values[PAINT_EVENTS_FIELDS];
+      gchar          *line = g_strstrip (lines[i]);
+      gint            j;
+
+      if (*line == '\0' || *line == '#')
+        continue;
+
+      for (j = 0; j < PAINT_EVENTS_FIELDS; j++)
+        {
+          gchar *end;
+
+          values[j] = g_ascii_strtod (line, &end);
+
+          if (end == line)
+            break;
+
+          line = end;
+        }
+
+      if (j < PAINT_EVENTS_FIELDS)
+        {
+          g_set_error (error, GIMP_ERROR, GIMP_FAILED,
+                       _("Error in line %d of '%s'"),
+                       i + 1, gimp_filename_to_utf8 (filename));
+          g_strfreev (lines);
+          g_array_free (events, TRUE);
+
+          return NULL;
+        }
+
+      event.time             = values[0];
+      event.coords.x         = values[1];
+      event.coords.y         = values[2];
+      event.coords.pressure  = values[3];
+      event.coords.xtilt     = values[4];
+      event.coords.ytilt     = values[5];
+      event.coords.wheel     = values[6];
+      event.coords.velocity  = values[7];
+      event.coords.direction = values[8];
+
+      g_array_append_val (events, event);
+    }
+
+  g_strfreev (lines);
+
+  *n_events = events->len;
+
+  return (GimpPaintEvent *) g_array_free (events, FALSE);
+}
+
+/**
+ * gimp_paint_core_replay:
+ * @core:          a #GimpPaintCore
+ * @drawable:      the drawable to paint on
+ * @paint_options: the paint options
+ * @events:        the events of one stroke
+ * @n_events:      the number of @events
+ * @push_undo:     whether to push an undo step
+ * @stats:         return location for the stroke's timings, or %NULL
+ * @error:         return location for an error
+ *
+ * Paints @events like #GimpPaintTool would have painted them, but
+ * as fast as possible and without a display. The events pass their
+ * recorded times on, so time-dependent dynamics paint the same.
+ *
+ * Return value: %TRUE if the stroke was painted.
+ **/
+gboolean
+gimp_paint_core_replay (GimpPaintCore         *core,
+                        GimpDrawable          *drawable,
+                        GimpPaintOptions      *paint_options,
+                        const GimpPaintEvent  *events,
+                        gint                   n_events,
+                        gboolean               push_undo,
+                        GimpPaintReplayStats  *stats,
+                        GError               **error)
+{
+  gdouble *latencies;
+  gint64   start_time;
+  gint64   time;
+  gint     i;
+
+  g_return_val_if_fail (GIMP_IS_PAINT_CORE (core), FALSE);
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), FALSE);
+  g_return_val_if_fail (gimp_item_is_attached (GIMP_ITEM (drawable)), FALSE);
+  g_return_val_if_fail (GIMP_IS_PAINT_OPTIONS (paint_options), FALSE);
+  g_return_val_if_fail (events != NULL, FALSE);
+  g_return_val_if_fail (n_events > 0, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (! gimp_paint_core_start (core, drawable, paint_options,
+                               &events[0].coords, error))
+    return FALSE;
+
+  latencies = g_new (gdouble, n_events);
+
+  start_time = g_get_monotonic_time ();
+
+  core->last_coords = events[0].coords;
+
+  gimp_paint_core_paint (core, drawable, paint_options,
+                         GIMP_PAINT_STATE_INIT, events[0].time);
+
+  gimp_paint_core_paint (core, drawable, paint_options,
+                         GIMP_PAINT_STATE_MOTION, events[0].time);
+
+  time = g_get_monotonic_time ();
+
+  latencies[0] = (time - start_time) / (gdouble) G_TIME_SPAN_SECOND;
+
+  for (i = 1; i < n_events; i++)
+    {
+      gint64 event_time = time;
+
+      gimp_paint_core_interpolate (core, drawable, paint_options,
+                                   &events[i].coords, events[i].time);
+
+      time = g_get_monotonic_time ();
+
+      latencies[i] = (time - event_time) / (gdouble) G_TIME_SPAN_SECOND;
+    }
+
+  gimp_paint_core_paint (core, drawable, paint_options,
+                         GIMP_PAINT_STATE_FINISH, events[n_events - 1].time);
+
+  gimp_paint_core_finish (core, drawable, push_undo);
+
+  if (stats)
+    {
+      stats->n_events = n_events;
+      stats->n_dabs   = core->n_dabs;
+      stats->total    = ((g_get_monotonic_time () - start_time) /
+                         (gdouble) G_TIME_SPAN_SECOND);
+
+      stats->dabs_per_second = (stats->total > 0.0 ?
+                                stats->n_dabs / stats->total : 0.0);
+
+      qsort (latencies, n_events, sizeof (gdouble),
+             gimp_paint_core_replay_compare);
+
+      stats->latency_median = latencies[n_events / 2];
+      stats->latency_90     = latencies[(n_events - 1) * 90 / 100];
+      stats->latency_99     = latencies[(n_events - 1) * 99 / 100];
+      stats->latency_max    = latencies[n_events - 1];
+    }
+
+  g_free (latencies);
+
+  gimp_paint_core_cleanup (core);
+
+  return TRUE;
+}
+
+
+/*  private functions  */
+
+static gint
+gimp_paint_core_replay_compare (gconstpointer a,
+                                gconstpointer b)
+{
+  gdouble x = *(const gdouble *) a;
+  gdouble y = *(const gdouble *) b;
+
+  return (x > y) - (x < y);
+}
@@ -0,0 +1,69 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_PAINT_CORE_REPLAY_H__
+#define __GIMP_PAINT_CORE_REPLAY_H__
+
+
+struct _GimpPaintEvent
+{
+  GimpCoords coords;  /*  drawable coordinates         */
+  guint32    time;    /*  event time, in milliseconds  */
+};
+
+struct _GimpPaintReplayStats
+{
+  gint       n_events;
+  gint       n_dabs;
+
+  gdouble    total;            /*  seconds for the whole stroke        */
+  gdouble    dabs_per_second;
+
+  /*  seconds spent painting a single event  */
+  gdouble    latency_median;
+  gdouble    latency_90;
+  gdouble    latency_99;
+  gdouble    latency_max;
+};
+
+
+void             gimp_paint_core_record_start (GimpPaintCore         *core);
+GimpPaintEvent * gimp_paint_core_record_stop  (GimpPaintCore         *core,
+                                               gint                  *n_events);
+void             gimp_paint_core_record       (GimpPaintCore         *core,
+                                               const GimpCoords      *coords,
+                                               guint32                time);
+
+gboolean         gimp_paint_events_save       (const gchar           *filename,
+                                               const GimpPaintEvent  *events,
+                                               gint                   n_events,
+                                               GError               **error);
+GimpPaintEvent * gimp_paint_events_load       (const gchar           *filename,
+                                               gint                  *n_events,
+                                               GError               **error);
+
+gboolean         gimp_paint_core_replay       (GimpPaintCore         *core,
+                                               GimpDrawable          *drawable,
+                                               GimpPaintOptions      *paint_options,
+                                               const GimpPaintEvent  *events,
+                                               gint                   n_events,
+                                               gboolean               push_undo,
+                                               GimpPaintReplayStats  *stats,
+                                               GError               **error);
+
+
+#endif  /*  __GIMP_PAINT_CORE_REPLAY_H__  */
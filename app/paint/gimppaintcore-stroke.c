@@ -67,6 +67,11 @@ gimp_paint_core_stroke (GimpPaintCore     *core,
     {
       gint i;
 
+      /*  nobody is watching the stroke being painted, so update the
+       *  drawable only once at the end, instead of after each segment
+       */
+      core->batch_updates = TRUE;
+
       core->last_coords = strokes[0];
 
       gimp_paint_core_paint (core, drawable, paint_options,
@@ -84,6 +89,9 @@ gimp_paint_core_stroke (GimpPaintCore     *core,
       gimp_paint_core_paint (core, drawable, paint_options,
                              GIMP_PAINT_STATE_FINISH, 0);
 
+      core->batch_updates = FALSE;
+      gimp_paint_core_flush_updates (core, drawable);
+
       gimp_paint_core_finish (core, drawable, push_undo);
 
       gimp_paint_core_cleanup (core);
@@ -178,6 +186,9 @@ gimp_paint_core_stroke_boundary (GimpPaintCore      *core,
 
           initialized = TRUE;
 
+          /*  see gimp_paint_core_stroke()  */
+          core->batch_updates = TRUE;
+
           core->cur_coords  = coords[0];
           core->last_coords = coords[0];
 
@@ -213,6 +224,9 @@ gimp_paint_core_stroke_boundary (GimpPaintCore      *core,
 
   if (initialized)
     {
+      core->batch_updates = FALSE;
+      gimp_paint_core_flush_updates (core, drawable);
+
       gimp_paint_core_finish (core, drawable, push_undo);
 
       gimp_paint_core_cleanup (core);
@@ -252,7 +266,7 @@ gimp_paint_core_stroke_vectors (GimpPaintCore     *core,
   off_x -= vectors_off_x;
   off_y -= vectors_off_y;
 
-  for (stroke = vectors->strokes; stroke; stroke = stroke->next)
+  for (stroke = vectors->strokes->head; stroke; stroke = stroke->next)
     {
       GArray   *coords;
       gboolean  closed;
@@ -281,6 +295,9 @@ gimp_paint_core_stroke_vectors (GimpPaintCore     *core,
             {
               initialized = TRUE;
 
+              /*  see gimp_paint_core_stroke()  */
+              core->batch_updates = TRUE;
+
               core->cur_coords  = g_array_index (coords, GimpCoords, 0);
               core->last_coords = g_array_index (coords, GimpCoords, 0);
 
@@ -319,6 +336,9 @@ gimp_paint_core_stroke_vectors (GimpPaintCore     *core,
 
   if (initialized)
     {
+      core->batch_updates = FALSE;
+      gimp_paint_core_flush_updates (core, drawable);
+
       gimp_paint_core_finish (core, drawable, push_undo);
 
       gimp_paint_core_cleanup (core);
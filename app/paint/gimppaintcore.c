@@ -44,10 +44,13 @@
 #include "gimppaintcore.h"
 #include "gimppaintcoreundo.h"
 #include "gimppaintcore-loops.h"
+#include "gimppaintcore-replay.h"
 #include "gimppaintoptions.h"
 
 #include "gimpairbrush.h"
 
+#include "gimp-trace.h"
+
 #include "gimp-intl.h"
 
 
@@ -108,6 +111,13 @@ static GimpUndo* gimp_paint_core_real_push_undo      (GimpPaintCore    *core,
                                                       GimpImage        *image,
                                                       const gchar      *undo_desc);
 
+static void      gimp_paint_core_update_drawable     (GimpPaintCore    *core,
+                                                      GimpDrawable     *drawable,
+                                                      gint              x,
+                                                      gint              y,
+                                                      gint              width,
+                                                      gint              height);
+
 
 G_DEFINE_TYPE (GimpPaintCore, gimp_paint_core, GIMP_TYPE_OBJECT)
 
@@ -162,6 +172,12 @@ gimp_paint_core_finalize (GObject *object)
       core->stroke_buffer = NULL;
     }
 
+  if (core->recording)
+    {
+      g_array_free (core->recording, TRUE);
+      core->recording = NULL;
+    }
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -309,6 +325,8 @@ gimp_paint_core_paint (GimpPaintCore    *core,
           /* Save coordinates for gimp_paint_core_interpolate() */
           core->last_paint.x = core->cur_coords.x;
           core->last_paint.y = core->cur_coords.y;
+
+          core->n_dabs++;
         }
 
       core_class->paint (core, drawable,
@@ -353,6 +371,8 @@ gimp_paint_core_start (GimpPaintCore     *core,
                                            sizeof (GimpCoords),
                                            STROKE_BUFFER_INIT_SIZE);
 
+  core->n_dabs = 0;
+
   /* remember the last stroke's endpoint for later undo */
   core->start_coords = core->last_coords;
 
@@ -540,13 +560,12 @@ gimp_paint_core_finish (GimpPaintCore *core,
 
       GIMP_PAINT_CORE_GET_CLASS (core)->push_undo (core, image, NULL);
 
-      buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height),
-                                gimp_drawable_get_format (drawable));
-
-      gegl_buffer_copy (core->undo_buffer,
-                        GEGL_RECTANGLE (x, y, width, height),
-                        buffer,
-                        GEGL_RECTANGLE (0, 0, 0, 0));
+      /*  shares the tiles the stroke didn't touch with
+       *  core->undo_buffer, and only copies the touched ones
+       */
+      buffer = gimp_gegl_buffer_dup_rect (core->undo_buffer,
+                                          GEGL_RECTANGLE (x, y,
+                                                          width, height));
 
       gimp_drawable_push_undo (drawable, NULL,
                                buffer, x, y, width, height);
@@ -658,8 +677,64 @@ gimp_paint_core_interpolate (GimpPaintCore    *core,
 
   core->cur_coords = *coords;
 
-  GIMP_PAINT_CORE_GET_CLASS (core)->interpolate (core, drawable,
-                                                 paint_options, time);
+  if (core->recording)
+    gimp_paint_core_record (core, coords, time);
+
+  if (core->batch_updates)
+    {
+      /*  the caller flushes the updates itself  */
+      GIMP_PAINT_CORE_GET_CLASS (core)->interpolate (core, drawable,
+                                                     paint_options, time);
+    }
+  else
+    {
+      /*  an interpolation can paint many dabs, update the drawable
+       *  only once for all of them
+       */
+      core->batch_updates = TRUE;
+
+      GIMP_PAINT_CORE_GET_CLASS (core)->interpolate (core, drawable,
+                                                     paint_options, time);
+
+      core->batch_updates = FALSE;
+
+      gimp_paint_core_flush_updates (core, drawable);
+    }
+}
+
+/**
+ * gimp_paint_core_flush_updates:
+ * @core:     a #GimpPaintCore
+ * @drawable: the drawable being painted on
+ *
+ * Emits the drawable update collected while @core->batch_updates was
+ * set. Set @core->batch_updates when painting from a thread other than
+ * the main thread, and flush the updates from the main thread.
+ *
+ * Return value: %TRUE if there was anything to update.
+ **/
+gboolean
+gimp_paint_core_flush_updates (GimpPaintCore *core,
+                               GimpDrawable  *drawable)
+{
+  g_return_val_if_fail (GIMP_IS_PAINT_CORE (core), FALSE);
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), FALSE);
+
+  if (core->update_rect.width > 0 && core->update_rect.height > 0)
+    {
+      gimp_drawable_update (drawable,
+                            core->update_rect.x,
+                            core->update_rect.y,
+                            core->update_rect.width,
+                            core->update_rect.height);
+
+      core->update_rect.width  = 0;
+      core->update_rect.height = 0;
+
+      return TRUE;
+    }
+
+  return FALSE;
 }
 
 void
@@ -804,6 +879,8 @@ gimp_paint_core_paste (GimpPaintCore            *core,
   gint width  = gegl_buffer_get_width  (core->paint_buffer);
   gint height = gegl_buffer_get_height (core->paint_buffer);
 
+  GIMP_TRACE_BEGIN ("paint-dab");
+
   if (core->applicator)
     {
       /*  If the mode is CONSTANT:
@@ -888,7 +965,10 @@ gimp_paint_core_paste (GimpPaintCore            *core,
       GeglBuffer  *src_buffer;
 
       if (! paint_buf)
-        return;
+        {
+          GIMP_TRACE_END ();
+          return;
+        }
 
       if (core->comp_buffer)
         dest_buffer = core->comp_buffer;
@@ -970,10 +1050,12 @@ gimp_paint_core_paste (GimpPaintCore            *core,
   core->y2 = MAX (core->y2, core->paint_buffer_y + height);
 
   /*  Update the drawable  */
-  gimp_drawable_update (drawable,
-                        core->paint_buffer_x,
-                        core->paint_buffer_y,
-                        width, height);
+  gimp_paint_core_update_drawable (core, drawable,
+                                   core->paint_buffer_x,
+                                   core->paint_buffer_y,
+                                   width, height);
+
+  GIMP_TRACE_END ();
 }
 
 /* This works similarly to gimp_paint_core_paste. However, instead of
@@ -1087,10 +1169,10 @@ gimp_paint_core_replace (GimpPaintCore            *core,
   core->y2 = MAX (core->y2, core->paint_buffer_y + height);
 
   /*  Update the drawable  */
-  gimp_drawable_update (drawable,
-                        core->paint_buffer_x,
-                        core->paint_buffer_y,
-                        width, height);
+  gimp_paint_core_update_drawable (core, drawable,
+                                   core->paint_buffer_x,
+                                   core->paint_buffer_y,
+                                   width, height);
 }
 
 /**
@@ -1159,3 +1241,29 @@ gimp_paint_core_smooth_coords (GimpPaintCore    *core,
         }
     }
 }
+
+
+/*  private functions  */
+
+static void
+gimp_paint_core_update_drawable (GimpPaintCore *core,
+                                 GimpDrawable  *drawable,
+                                 gint           x,
+                                 gint           y,
+                                 gint           width,
+                                 gint           height)
+{
+  if (core->batch_updates)
+    {
+      if (core->update_rect.width > 0 && core->update_rect.height > 0)
+        gegl_rectangle_bounding_box (&core->update_rect,
+                                     &core->update_rect,
+                                     GEGL_RECTANGLE (x, y, width, height));
+      else
+        gegl_rectangle_set (&core->update_rect, x, y, width, height);
+    }
+  else
+    {
+      gimp_drawable_update (drawable, x, y, width, height);
+    }
+}
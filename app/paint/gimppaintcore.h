@@ -53,6 +53,9 @@ struct _GimpPaintCore
   gint         x1, y1;            /*  undo extents in image coords        */
   gint         x2, y2;            /*  undo extents in image coords        */
 
+  gboolean     batch_updates;     /*  collect drawable updates            */
+  GeglRectangle update_rect;      /*  collected drawable update           */
+
   gboolean     use_saved_proj;    /*  keep the unmodified proj around     */
 
   GeglBuffer  *undo_buffer;       /*  pixels which have been modified     */
@@ -72,6 +75,9 @@ struct _GimpPaintCore
   GimpApplicator *applicator;
 
   GArray      *stroke_buffer;
+
+  GArray      *recording;         /*  recorded GimpPaintEvents, or NULL  */
+  gint         n_dabs;            /*  motion paints of the current stroke */
 };
 
 struct _GimpPaintCoreClass
@@ -145,6 +151,8 @@ void      gimp_paint_core_interpolate               (GimpPaintCore    *core,
                                                      GimpPaintOptions *paint_options,
                                                      const GimpCoords *coords,
                                                      guint32           time);
+gboolean  gimp_paint_core_flush_updates             (GimpPaintCore    *core,
+                                                     GimpDrawable     *drawable);
 
 void      gimp_paint_core_set_current_coords        (GimpPaintCore    *core,
                                                      const GimpCoords *coords);
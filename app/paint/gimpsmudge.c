@@ -140,11 +140,7 @@ gimp_smudge_paint (GimpPaintCore    *paint_core,
       break;
 
     case GIMP_PAINT_STATE_FINISH:
-      if (smudge->accum_buffer)
-        {
-          g_object_unref (smudge->accum_buffer);
-          smudge->accum_buffer = NULL;
-        }
+      /*  keep the accumulator around for the next stroke  */
       smudge->initialized = FALSE;
       break;
 
@@ -175,11 +171,23 @@ gimp_smudge_start (GimpPaintCore    *paint_core,
 
   gimp_smudge_accumulator_size (paint_options, &accum_size);
 
-  /*  Allocate the accumulation buffer */
-  smudge->accum_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
-                                                          accum_size,
-                                                          accum_size),
-                                          babl_format ("RGBA float"));
+  /*  Allocate the accumulation buffer, unless the last stroke's one
+   *  has the right size
+   */
+  if (smudge->accum_buffer &&
+      gegl_buffer_get_width (smudge->accum_buffer) != accum_size)
+    {
+      g_object_unref (smudge->accum_buffer);
+      smudge->accum_buffer = NULL;
+    }
+
+  if (smudge->accum_buffer)
+    gegl_buffer_clear (smudge->accum_buffer, NULL);
+  else
+    smudge->accum_buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                                            accum_size,
+                                                            accum_size),
+                                            babl_format ("RGBA float"));
 
   /*  adjust the x and y coordinates to the upper left corner of the
    *  accumulator
@@ -287,6 +295,8 @@ gimp_smudge_motion (GimpPaintCore    *paint_core,
    *  where I is the pixels under the current painthit.
    *  Then the paint area (paint_area) is built as
    *    (Accum,1) (if no alpha),
+   *  Accum is updated in place and written to the paint area in the
+   *  same pass.
    */
 
   gimp_gegl_smudge_blend (smudge->accum_buffer,
@@ -304,16 +314,12 @@ gimp_smudge_motion (GimpPaintCore    *paint_core,
                                           paint_buffer_y - y,
                                           paint_buffer_width,
                                           paint_buffer_height),
+                          paint_buffer,
+                          GEGL_RECTANGLE (0, 0,
+                                          paint_buffer_width,
+                                          paint_buffer_height),
                           rate);
 
-  gegl_buffer_copy (smudge->accum_buffer,
-                    GEGL_RECTANGLE (paint_buffer_x - x,
-                                    paint_buffer_y - y,
-                                    paint_buffer_width,
-                                    paint_buffer_height),
-                    paint_buffer,
-                    GEGL_RECTANGLE (0, 0, 0, 0));
-
   hardness = gimp_dynamics_get_linear_value (dynamics,
                                              GIMP_DYNAMICS_OUTPUT_HARDNESS,
                                              coords,
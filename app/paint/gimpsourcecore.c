@@ -237,11 +237,29 @@ gimp_source_core_start (GimpPaintCore     *paint_core,
           return FALSE;
         }
 
-      if (options->sample_merged &&
-          gimp_item_get_image (GIMP_ITEM (source_core->src_drawable)) ==
-          gimp_item_get_image (GIMP_ITEM (drawable)))
+      if (options->sample_merged)
         {
-          paint_core->use_saved_proj = TRUE;
+          GimpImage    *src_image;
+          GimpPickable *src_pickable;
+
+          src_image    = gimp_item_get_image (GIMP_ITEM (source_core->src_drawable));
+          src_pickable = GIMP_PICKABLE (gimp_image_get_projection (src_image));
+
+          if (src_image == gimp_item_get_image (GIMP_ITEM (drawable)))
+            paint_core->use_saved_proj = TRUE;
+
+          /*  the stroke reads either a copy of the projection taken
+           *  now, or another image's projection, which the stroke
+           *  doesn't change, so one flush per stroke is enough
+           */
+          gimp_pickable_flush (src_pickable);
+        }
+      else
+        {
+          /*  flush here and not for every dab, the dabs may be
+           *  painted on the paint tool's thread
+           */
+          gimp_pickable_flush (GIMP_PICKABLE (source_core->src_drawable));
         }
     }
 
@@ -399,8 +417,6 @@ gimp_source_core_motion (GimpSourceCore   *source_core,
           src_offset_x += off_x;
           src_offset_y += off_y;
         }
-
-      gimp_pickable_flush (src_pickable);
     }
 
   paint_buffer = gimp_paint_core_get_paint_buffer (paint_core, drawable,
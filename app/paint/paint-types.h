@@ -64,6 +64,12 @@ typedef struct _GimpPaintCoreUndo GimpPaintCoreUndo;
 typedef struct _GimpInkUndo       GimpInkUndo;
 
 
+/*  paint replay  */
+
+typedef struct _GimpPaintEvent       GimpPaintEvent;
+typedef struct _GimpPaintReplayStats GimpPaintReplayStats;
+
+
 /*  functions  */
 
 typedef void (* GimpPaintRegisterCallback) (Gimp        *gimp,
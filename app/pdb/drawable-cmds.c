@@ -44,6 +44,7 @@
 #include "plug-in/gimppluginmanager.h"
 
 #include "gimppdb.h"
+#include "gimppdberror.h"
 #include "gimppdb-utils.h"
 #include "gimpprocedure.h"
 #include "internal-procs.h"
@@ -692,6 +693,298 @@ drawable_set_pixel_invoker (GimpProcedure         *procedure,
                                            error ? *error : NULL);
 }
 
+static GimpValueArray *
+drawable_get_pixels_invoker (GimpProcedure         *procedure,
+                             Gimp                  *gimp,
+                             GimpContext           *context,
+                             GimpProgress          *progress,
+                             const GimpValueArray  *args,
+                             GError               **error)
+{
+  gboolean success = TRUE;
+  GimpValueArray *return_vals;
+  GimpDrawable *drawable;
+  gint32 num_coords;
+  const gint32 *coords;
+  gint32 num_bytes = 0;
+  guint8 *pixels = NULL;
+
+  drawable = gimp_value_get_drawable (gimp_value_array_index (args, 0), gimp);
+  num_coords = g_value_get_int (gimp_value_array_index (args, 1));
+  coords = gimp_value_get_int32array (gimp_value_array_index (args, 2));
+
+  if (success)
+    {
+      GeglBuffer *buffer = gimp_drawable_get_buffer (drawable);
+      const Babl *format = gimp_drawable_get_format (drawable);
+      gint        width  = gimp_item_get_width  (GIMP_ITEM (drawable));
+      gint        height = gimp_item_get_height (GIMP_ITEM (drawable));
+      gint        bpp;
+      gint        i;
+
+      if (! gimp->plug_in_manager->current_plug_in ||
+          ! gimp_plug_in_precision_enabled (gimp->plug_in_manager->current_plug_in))
+        {
+          format = gimp_babl_compat_u8_format (format);
+        }
+
+      bpp = babl_format_get_bytes_per_pixel (format);
+
+      if (num_coords % 2 != 0)
+        success = FALSE;
+
+      for (i = 0; success && i < num_coords; i += 2)
+        {
+          if (coords[i]     < 0 || coords[i]     >= width ||
+              coords[i + 1] < 0 || coords[i + 1] >= height)
+            success = FALSE;
+        }
+
+      if (success)
+        {
+          num_bytes = num_coords / 2 * bpp;
+          pixels    = g_new (guint8, num_bytes);
+
+          for (i = 0; i < num_coords; i += 2)
+            {
+              gegl_buffer_sample (buffer,
+                                  coords[i], coords[i + 1], NULL,
+                                  pixels + i / 2 * bpp, format,
+                                  GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+            }
+        }
+    }
+
+  return_vals = gimp_procedure_get_return_values (procedure, success,
+                                                  error ? *error : NULL);
+
+  if (success)
+    {
+      g_value_set_int (gimp_value_array_index (return_vals, 1), num_bytes);
+      gimp_value_take_int8array (gimp_value_array_index (return_vals, 2), pixels, num_bytes);
+    }
+
+  return return_vals;
+}
+
+static GimpValueArray *
+drawable_set_pixels_invoker (GimpProcedure         *procedure,
+                             Gimp                  *gimp,
+                             GimpContext           *context,
+                             GimpProgress          *progress,
+                             const GimpValueArray  *args,
+                             GError               **error)
+{
+  gboolean success = TRUE;
+  GimpDrawable *drawable;
+  gint32 num_coords;
+  const gint32 *coords;
+  gint32 num_bytes;
+  const guint8 *pixels;
+
+  drawable = gimp_value_get_drawable (gimp_value_array_index (args, 0), gimp);
+  num_coords = g_value_get_int (gimp_value_array_index (args, 1));
+  coords = gimp_value_get_int32array (gimp_value_array_index (args, 2));
+  num_bytes = g_value_get_int (gimp_value_array_index (args, 3));
+  pixels = gimp_value_get_int8array (gimp_value_array_index (args, 4));
+
+  if (success)
+    {
+      GeglBuffer *buffer = gimp_drawable_get_buffer (drawable);
+      const Babl *format = gimp_drawable_get_format (drawable);
+      gint        width  = gimp_item_get_width  (GIMP_ITEM (drawable));
+      gint        height = gimp_item_get_height (GIMP_ITEM (drawable));
+      gint        bpp;
+      gint        i;
+
+      if (! gimp->plug_in_manager->current_plug_in ||
+          ! gimp_plug_in_precision_enabled (gimp->plug_in_manager->current_plug_in))
+        {
+          format = gimp_babl_compat_u8_format (format);
+        }
+
+      bpp = babl_format_get_bytes_per_pixel (format);
+
+      if (! gimp_pdb_item_is_modifyable (GIMP_ITEM (drawable),
+                                         GIMP_PDB_ITEM_CONTENT, error) ||
+          ! gimp_pdb_item_is_not_group (GIMP_ITEM (drawable), error) ||
+          num_coords % 2 != 0 ||
+          num_bytes != num_coords / 2 * bpp)
+        success = FALSE;
+
+      for (i = 0; success && i < num_coords; i += 2)
+        {
+          if (coords[i]     < 0 || coords[i]     >= width ||
+              coords[i + 1] < 0 || coords[i + 1] >= height)
+            success = FALSE;
+        }
+
+      if (success)
+        {
+          for (i = 0; i < num_coords; i += 2)
+            {
+              gegl_buffer_set (buffer,
+                               GEGL_RECTANGLE (coords[i], coords[i + 1], 1, 1),
+                               0, format, pixels + i / 2 * bpp,
+                               GEGL_AUTO_ROWSTRIDE);
+            }
+        }
+    }
+
+  return gimp_procedure_get_return_values (procedure, success,
+                                           error ? *error : NULL);
+}
+
+static GimpValueArray *
+drawable_get_rect_invoker (GimpProcedure         *procedure,
+                           Gimp                  *gimp,
+                           GimpContext           *context,
+                           GimpProgress          *progress,
+                           const GimpValueArray  *args,
+                           GError               **error)
+{
+  gboolean success = TRUE;
+  GimpValueArray *return_vals;
+  GimpDrawable *drawable;
+  gint32 x;
+  gint32 y;
+  gint32 width;
+  gint32 height;
+  const gchar *format_name;
+  gint32 num_bytes = 0;
+  guint8 *data = NULL;
+
+  drawable = gimp_value_get_drawable (gimp_value_array_index (args, 0), gimp);
+  x = g_value_get_int (gimp_value_array_index (args, 1));
+  y = g_value_get_int (gimp_value_array_index (args, 2));
+  width = g_value_get_int (gimp_value_array_index (args, 3));
+  height = g_value_get_int (gimp_value_array_index (args, 4));
+  format_name = g_value_get_string (gimp_value_array_index (args, 5));
+
+  if (success)
+    {
+      const Babl *format = gimp_drawable_get_format (drawable);
+
+      if (format_name && *format_name)
+        {
+          if (babl_format_exists (format_name))
+            {
+              format = babl_format (format_name);
+            }
+          else
+            {
+              g_set_error (error, GIMP_PDB_ERROR, GIMP_PDB_ERROR_INVALID_ARGUMENT,
+                           _("'%s' is not a valid pixel format"), format_name);
+              success = FALSE;
+            }
+        }
+      else if (! gimp->plug_in_manager->current_plug_in ||
+               ! gimp_plug_in_precision_enabled (gimp->plug_in_manager->current_plug_in))
+        {
+          format = gimp_babl_compat_u8_format (format);
+        }
+
+      if (success &&
+          x + width  <= gimp_item_get_width  (GIMP_ITEM (drawable)) &&
+          y + height <= gimp_item_get_height (GIMP_ITEM (drawable)) &&
+          (gint64) width * height *
+          babl_format_get_bytes_per_pixel (format) <= G_MAXINT32)
+        {
+          num_bytes = width * height * babl_format_get_bytes_per_pixel (format);
+          data      = g_new (guint8, num_bytes);
+
+          gegl_buffer_get (gimp_drawable_get_buffer (drawable),
+                           GEGL_RECTANGLE (x, y, width, height), 1.0,
+                           format, data,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+        }
+      else
+        success = FALSE;
+    }
+
+  return_vals = gimp_procedure_get_return_values (procedure, success,
+                                                  error ? *error : NULL);
+
+  if (success)
+    {
+      g_value_set_int (gimp_value_array_index (return_vals, 1), num_bytes);
+      gimp_value_take_int8array (gimp_value_array_index (return_vals, 2), data, num_bytes);
+    }
+
+  return return_vals;
+}
+
+static GimpValueArray *
+drawable_set_rect_invoker (GimpProcedure         *procedure,
+                           Gimp                  *gimp,
+                           GimpContext           *context,
+                           GimpProgress          *progress,
+                           const GimpValueArray  *args,
+                           GError               **error)
+{
+  gboolean success = TRUE;
+  GimpDrawable *drawable;
+  gint32 x;
+  gint32 y;
+  gint32 width;
+  gint32 height;
+  const gchar *format_name;
+  gint32 num_bytes;
+  const guint8 *data;
+
+  drawable = gimp_value_get_drawable (gimp_value_array_index (args, 0), gimp);
+  x = g_value_get_int (gimp_value_array_index (args, 1));
+  y = g_value_get_int (gimp_value_array_index (args, 2));
+  width = g_value_get_int (gimp_value_array_index (args, 3));
+  height = g_value_get_int (gimp_value_array_index (args, 4));
+  format_name = g_value_get_string (gimp_value_array_index (args, 5));
+  num_bytes = g_value_get_int (gimp_value_array_index (args, 6));
+  data = gimp_value_get_int8array (gimp_value_array_index (args, 7));
+
+  if (success)
+    {
+      const Babl *format = gimp_drawable_get_format (drawable);
+
+      if (format_name && *format_name)
+        {
+          if (babl_format_exists (format_name))
+            {
+              format = babl_format (format_name);
+            }
+          else
+            {
+              g_set_error (error, GIMP_PDB_ERROR, GIMP_PDB_ERROR_INVALID_ARGUMENT,
+                           _("'%s' is not a valid pixel format"), format_name);
+              success = FALSE;
+            }
+        }
+      else if (! gimp->plug_in_manager->current_plug_in ||
+               ! gimp_plug_in_precision_enabled (gimp->plug_in_manager->current_plug_in))
+        {
+          format = gimp_babl_compat_u8_format (format);
+        }
+
+      if (success &&
+          gimp_pdb_item_is_modifyable (GIMP_ITEM (drawable),
+                                       GIMP_PDB_ITEM_CONTENT, error) &&
+          gimp_pdb_item_is_not_group (GIMP_ITEM (drawable), error) &&
+          x + width  <= gimp_item_get_width  (GIMP_ITEM (drawable)) &&
+          y + height <= gimp_item_get_height (GIMP_ITEM (drawable)) &&
+          num_bytes == ((gint64) width * height *
+                        babl_format_get_bytes_per_pixel (format)))
+        {
+          gegl_buffer_set (gimp_drawable_get_buffer (drawable),
+                           GEGL_RECTANGLE (x, y, width, height),
+                           0, format, data, GEGL_AUTO_ROWSTRIDE);
+        }
+      else
+        success = FALSE;
+    }
+
+  return gimp_procedure_get_return_values (procedure, success,
+                                           error ? *error : NULL);
+}
+
 static GimpValueArray *
 drawable_fill_invoker (GimpProcedure         *procedure,
                        Gimp                  *gimp,
@@ -1614,6 +1907,226 @@ register_drawable_procs (GimpPDB *pdb)
   gimp_pdb_register_procedure (pdb, procedure);
   g_object_unref (procedure);
 
+  /*
+   * gimp-drawable-get-pixels
+   */
+  procedure = gimp_procedure_new (drawable_get_pixels_invoker);
+  gimp_object_set_static_name (GIMP_OBJECT (procedure),
+                               "gimp-drawable-get-pixels");
+  gimp_procedure_set_static_strings (procedure,
+                                     "gimp-drawable-get-pixels",
+                                     "Gets the values of the pixels at a list of coordinates.",
+                                     "This procedure gets the values of a number of pixels at once, it works like calling 'gimp-drawable-get-pixel' for each of the pixels, but needs only a single procedure call. The coordinates are passed as x,y pairs, the pixel values are returned in the same order, each of them bytes-per-pixel bytes long.",
+                                     "Michael Natterer <mitch@gimp.org>",
+                                     "Michael Natterer",
+                                     "2017",
+                                     NULL);
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_drawable_id ("drawable",
+                                                            "drawable",
+                                                            "The drawable",
+                                                            pdb->gimp, FALSE,
+                                                            GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32 ("num-coords",
+                                                      "num coords",
+                                                      "The number of coordinates, twice the number of pixels",
+                                                      0, G_MAXINT32, 0,
+                                                      GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32_array ("coords",
+                                                            "coords",
+                                                            "The x and y coordinates of the pixels",
+                                                            GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   gimp_param_spec_int32 ("num-bytes",
+                                                          "num bytes",
+                                                          "The number of bytes of the pixel values",
+                                                          0, G_MAXINT32, 0,
+                                                          GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   gimp_param_spec_int8_array ("pixels",
+                                                               "pixels",
+                                                               "The pixel values",
+                                                               GIMP_PARAM_READWRITE));
+  gimp_pdb_register_procedure (pdb, procedure);
+  g_object_unref (procedure);
+
+  /*
+   * gimp-drawable-set-pixels
+   */
+  procedure = gimp_procedure_new (drawable_set_pixels_invoker);
+  gimp_object_set_static_name (GIMP_OBJECT (procedure),
+                               "gimp-drawable-set-pixels");
+  gimp_procedure_set_static_strings (procedure,
+                                     "gimp-drawable-set-pixels",
+                                     "Sets the values of the pixels at a list of coordinates.",
+                                     "This procedure sets the values of a number of pixels at once, it works like calling 'gimp-drawable-set-pixel' for each of the pixels, but needs only a single procedure call. The coordinates are passed as x,y pairs, the pixel values in the same order, each of them bytes-per-pixel bytes long. Note that this function is not undoable, you should use it only on drawables you just created yourself.",
+                                     "Michael Natterer <mitch@gimp.org>",
+                                     "Michael Natterer",
+                                     "2017",
+                                     NULL);
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_drawable_id ("drawable",
+                                                            "drawable",
+                                                            "The drawable",
+                                                            pdb->gimp, FALSE,
+                                                            GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32 ("num-coords",
+                                                      "num coords",
+                                                      "The number of coordinates, twice the number of pixels",
+                                                      0, G_MAXINT32, 0,
+                                                      GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32_array ("coords",
+                                                            "coords",
+                                                            "The x and y coordinates of the pixels",
+                                                            GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32 ("num-bytes",
+                                                      "num bytes",
+                                                      "The number of bytes of the pixel values",
+                                                      0, G_MAXINT32, 0,
+                                                      GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int8_array ("pixels",
+                                                           "pixels",
+                                                           "The pixel values",
+                                                           GIMP_PARAM_READWRITE));
+  gimp_pdb_register_procedure (pdb, procedure);
+  g_object_unref (procedure);
+
+  /*
+   * gimp-drawable-get-rect
+   */
+  procedure = gimp_procedure_new (drawable_get_rect_invoker);
+  gimp_object_set_static_name (GIMP_OBJECT (procedure),
+                               "gimp-drawable-get-rect");
+  gimp_procedure_set_static_strings (procedure,
+                                     "gimp-drawable-get-rect",
+                                     "Gets the pixels of a rectangle in a given format.",
+                                     "This procedure returns the pixels of a rectangle of the drawable, converted to the Babl format @format_name, like \"R'G'B'A u8\" or \"Y float\". Pass an empty string to get the pixels in the drawable's own format, see 'gimp-drawable-get-pixel'. The rows are returned top to bottom without any padding.",
+                                     "Michael Natterer <mitch@gimp.org>",
+                                     "Michael Natterer",
+                                     "2017",
+                                     NULL);
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_drawable_id ("drawable",
+                                                            "drawable",
+                                                            "The drawable",
+                                                            pdb->gimp, FALSE,
+                                                            GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32 ("x",
+                                                      "x",
+                                                      "The x coordinate of the rectangle",
+                                                      0, G_MAXINT32, 0,
+                                                      GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32 ("y",
+                                                      "y",
+                                                      "The y coordinate of the rectangle",
+                                                      0, G_MAXINT32, 0,
+                                                      GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32 ("width",
+                                                      "width",
+                                                      "The width of the rectangle",
+                                                      1, G_MAXINT32, 0,
+                                                      GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32 ("height",
+                                                      "height",
+                                                      "The height of the rectangle",
+                                                      1, G_MAXINT32, 0,
+                                                      GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_string ("format-name",
+                                                       "format name",
+                                                       "The Babl format of the pixels, or an empty string",
+                                                       FALSE, FALSE, FALSE,
+                                                       NULL,
+                                                       GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   gimp_param_spec_int32 ("num-bytes",
+                                                          "num bytes",
+                                                          "The number of bytes of the pixels",
+                                                          0, G_MAXINT32, 0,
+                                                          GIMP_PARAM_READWRITE));
+  gimp_procedure_add_return_value (procedure,
+                                   gimp_param_spec_int8_array ("data",
+                                                               "data",
+                                                               "The pixels of the rectangle",
+                                                               GIMP_PARAM_READWRITE));
+  gimp_pdb_register_procedure (pdb, procedure);
+  g_object_unref (procedure);
+
+  /*
+   * gimp-drawable-set-rect
+   */
+  procedure = gimp_procedure_new (drawable_set_rect_invoker);
+  gimp_object_set_static_name (GIMP_OBJECT (procedure),
+                               "gimp-drawable-set-rect");
+  gimp_procedure_set_static_strings (procedure,
+                                     "gimp-drawable-set-rect",
+                                     "Sets the pixels of a rectangle from a given format.",
+                                     "This procedure replaces the pixels of a rectangle of the drawable with @data, which is converted from the Babl format @format_name, like \"R'G'B'A u8\" or \"Y float\". Pass an empty string if @data is in the drawable's own format, see 'gimp-drawable-set-pixel'. The rows are passed top to bottom without any padding. Note that this function is not undoable, you should use it only on drawables you just created yourself.",
+                                     "Michael Natterer <mitch@gimp.org>",
+                                     "Michael Natterer",
+                                     "2017",
+                                     NULL);
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_drawable_id ("drawable",
+                                                            "drawable",
+                                                            "The drawable",
+                                                            pdb->gimp, FALSE,
+                                                            GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32 ("x",
+                                                      "x",
+                                                      "The x coordinate of the rectangle",
+                                                      0, G_MAXINT32, 0,
+                                                      GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32 ("y",
+                                                      "y",
+                                                      "The y coordinate of the rectangle",
+                                                      0, G_MAXINT32, 0,
+                                                      GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32 ("width",
+                                                      "width",
+                                                      "The width of the rectangle",
+                                                      1, G_MAXINT32, 0,
+                                                      GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32 ("height",
+                                                      "height",
+                                                      "The height of the rectangle",
+                                                      1, G_MAXINT32, 0,
+                                                      GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_string ("format-name",
+                                                       "format name",
+                                                       "The Babl format of the pixels, or an empty string",
+                                                       FALSE, FALSE, FALSE,
+                                                       NULL,
+                                                       GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int32 ("num-bytes",
+                                                      "num bytes",
+                                                      "The number of bytes of the pixels",
+                                                      0, G_MAXINT32, 0,
+                                                      GIMP_PARAM_READWRITE));
+  gimp_procedure_add_argument (procedure,
+                               gimp_param_spec_int8_array ("data",
+                                                           "data",
+                                                           "The pixels of the rectangle",
+                                                           GIMP_PARAM_READWRITE));
+  gimp_pdb_register_procedure (pdb, procedure);
+  g_object_unref (procedure);
+
   /*
    * gimp-drawable-fill
    */
@@ -26,6 +26,7 @@
 #include "core/gimp.h"
 #include "core/gimpbrushgenerated.h"
 #include "core/gimpcontainer.h"
+#include "core/gimpdata.h"
 #include "core/gimpdatafactory.h"
 #include "core/gimpdrawable.h"
 #include "core/gimpimage.h"
@@ -52,6 +53,10 @@ gimp_pdb_get_data_factory_item (GimpDataFactory *data_factory,
   if (! gimp_object)
     gimp_object = gimp_container_get_child_by_name (gimp_data_factory_get_container_obsolete (data_factory), name);
 
+  /*  procedures access the data's contents directly  */
+  if (gimp_object)
+    gimp_data_ensure_loaded (GIMP_DATA (gimp_object));
+
   return gimp_object;
 }
 
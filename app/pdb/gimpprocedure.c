@@ -61,6 +61,7 @@ static void       gimp_procedure_real_execute_async  (GimpProcedure   *procedure
                                                       GimpObject      *display);
 
 static void             gimp_procedure_free_strings  (GimpProcedure   *procedure);
+static gboolean         gimp_procedure_is_scalar     (GType            type);
 static gboolean         gimp_procedure_validate_args (GimpProcedure   *procedure,
                                                       GParamSpec     **param_specs,
                                                       gint             n_param_specs,
@@ -619,6 +620,31 @@ gimp_procedure_free_strings (GimpProcedure *procedure)
   procedure->static_strings = FALSE;
 }
 
+static gboolean
+gimp_procedure_is_scalar (GType type)
+{
+  switch (G_TYPE_FUNDAMENTAL (type))
+    {
+    case G_TYPE_CHAR:
+    case G_TYPE_UCHAR:
+    case G_TYPE_BOOLEAN:
+    case G_TYPE_INT:
+    case G_TYPE_UINT:
+    case G_TYPE_LONG:
+    case G_TYPE_ULONG:
+    case G_TYPE_INT64:
+    case G_TYPE_UINT64:
+    case G_TYPE_ENUM:
+    case G_TYPE_FLAGS:
+    case G_TYPE_FLOAT:
+    case G_TYPE_DOUBLE:
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
 static gboolean
 gimp_procedure_validate_args (GimpProcedure  *procedure,
                               GParamSpec    **param_specs,
@@ -668,17 +694,37 @@ gimp_procedure_validate_args (GimpProcedure  *procedure,
       else if (! (pspec->flags & GIMP_PARAM_NO_VALIDATE))
         {
           GValue string_value = { 0, };
+          GValue saved_value  = { 0, };
 
-          g_value_init (&string_value, G_TYPE_STRING);
-
-          if (g_value_type_transformable (arg_type, G_TYPE_STRING))
-            g_value_transform (arg, &string_value);
+          /*  validating changes the value, so keep the original for the
+           *  error message.  Scalars are copied cheaply and transformed
+           *  only when they are out of range
+           */
+          if (gimp_procedure_is_scalar (arg_type))
+            {
+              g_value_init (&saved_value, arg_type);
+              g_value_copy (arg, &saved_value);
+            }
           else
-            g_value_set_static_string (&string_value,
-                                       "<not transformable to string>");
+            {
+              g_value_init (&string_value, G_TYPE_STRING);
+
+              if (g_value_type_transformable (arg_type, G_TYPE_STRING))
+                g_value_transform (arg, &string_value);
+              else
+                g_value_set_static_string (&string_value,
+                                           "<not transformable to string>");
+            }
 
           if (g_param_value_validate (pspec, arg))
             {
+              if (G_IS_VALUE (&saved_value))
+                {
+                  g_value_init (&string_value, G_TYPE_STRING);
+                  g_value_transform (&saved_value, &string_value);
+                  g_value_unset (&saved_value);
+                }
+
               if (GIMP_IS_PARAM_SPEC_DRAWABLE_ID (pspec) &&
                   g_value_get_int (arg) == -1)
                 {
@@ -781,7 +827,10 @@ gimp_procedure_validate_args (GimpProcedure  *procedure,
               return FALSE;
             }
 
-          g_value_unset (&string_value);
+          if (G_IS_VALUE (&saved_value))
+            g_value_unset (&saved_value);
+          else
+            g_value_unset (&string_value);
         }
     }
 
@@ -331,7 +331,7 @@ selection_feather_invoker (GimpProcedure         *procedure,
   if (success)
     {
       gimp_channel_feather (gimp_image_get_mask (image),
-                            radius, radius, TRUE);
+                            radius, radius, progress, TRUE);
     }
 
   return gimp_procedure_get_return_values (procedure, success,
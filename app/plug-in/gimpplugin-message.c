@@ -45,9 +45,12 @@
 #include "gimpplugin-cleanup.h"
 #include "gimpplugin-message.h"
 #include "gimppluginmanager.h"
+#include "gimppluginmanager-persistent.h"
 #include "gimpplugindef.h"
 #include "gimppluginshm.h"
 #include "gimptemporaryprocedure.h"
+
+#include "gimp-trace.h"
 #include "plug-in-params.h"
 
 #include "gimp-intl.h"
@@ -62,6 +65,17 @@ static void gimp_plug_in_handle_tile_put         (GimpPlugIn      *plug_in,
                                                   GPTileReq       *request);
 static void gimp_plug_in_handle_tile_get         (GimpPlugIn      *plug_in,
                                                   GPTileReq       *request);
+static void gimp_plug_in_handle_region_req       (GimpPlugIn      *plug_in,
+                                                  GPRegionReq     *request);
+static void gimp_plug_in_handle_tiles_req        (GimpPlugIn      *plug_in,
+                                                  GPTilesReq      *request);
+static void gimp_plug_in_handle_tiles_data       (GimpPlugIn      *plug_in,
+                                                  GPTilesData     *tiles_data);
+static GeglBuffer *
+            gimp_plug_in_get_drawable_buffer     (GimpPlugIn      *plug_in,
+                                                  gint32           drawable_ID,
+                                                  gboolean         shadow,
+                                                  gboolean         put);
 static void gimp_plug_in_handle_proc_run         (GimpPlugIn      *plug_in,
                                                   GPProcRun       *proc_run);
 static void gimp_plug_in_handle_proc_return      (GimpPlugIn      *plug_in,
@@ -74,6 +88,7 @@ static void gimp_plug_in_handle_proc_uninstall   (GimpPlugIn      *plug_in,
                                                   GPProcUninstall *proc_uninstall);
 static void gimp_plug_in_handle_extension_ack    (GimpPlugIn      *plug_in);
 static void gimp_plug_in_handle_has_init         (GimpPlugIn      *plug_in);
+static void gimp_plug_in_handle_persist          (GimpPlugIn      *plug_in);
 
 
 /*  public functions  */
@@ -123,6 +138,31 @@ gimp_plug_in_handle_message (GimpPlugIn      *plug_in,
       gimp_plug_in_close (plug_in, TRUE);
       break;
 
+    case GP_REGION_REQ:
+      gimp_plug_in_handle_region_req (plug_in, msg->data);
+      break;
+
+    case GP_REGION_DATA:
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-In \"%s\"\n(%s)\n\n"
+                    "sent a REGION_DATA message.  This should not happen.",
+                    gimp_object_get_name (plug_in),
+                    gimp_filename_to_utf8 (plug_in->prog));
+      gimp_plug_in_close (plug_in, TRUE);
+      break;
+
+    case GP_TILES_REQ:
+      GIMP_TRACE_BEGIN ("plug-in-tiles-get");
+      gimp_plug_in_handle_tiles_req (plug_in, msg->data);
+      GIMP_TRACE_END ();
+      break;
+
+    case GP_TILES_DATA:
+      GIMP_TRACE_BEGIN ("plug-in-tiles-put");
+      gimp_plug_in_handle_tiles_data (plug_in, msg->data);
+      GIMP_TRACE_END ();
+      break;
+
     case GP_PROC_RUN:
       gimp_plug_in_handle_proc_run (plug_in, msg->data);
       break;
@@ -159,6 +199,10 @@ gimp_plug_in_handle_message (GimpPlugIn      *plug_in,
     case GP_HAS_INIT:
       gimp_plug_in_handle_has_init (plug_in);
       break;
+
+    case GP_PERSIST:
+      gimp_plug_in_handle_persist (plug_in);
+      break;
     }
 }
 
@@ -178,9 +222,17 @@ gimp_plug_in_handle_tile_request (GimpPlugIn *plug_in,
   g_return_if_fail (request != NULL);
 
   if (request->drawable_ID == -1)
-    gimp_plug_in_handle_tile_put (plug_in, request);
+    {
+      GIMP_TRACE_BEGIN ("plug-in-tile-put");
+      gimp_plug_in_handle_tile_put (plug_in, request);
+      GIMP_TRACE_END ();
+    }
   else
-    gimp_plug_in_handle_tile_get (plug_in, request);
+    {
+      GIMP_TRACE_BEGIN ("plug-in-tile-get");
+      gimp_plug_in_handle_tile_get (plug_in, request);
+      GIMP_TRACE_END ();
+    }
 }
 
 static void
@@ -468,6 +520,367 @@ gimp_plug_in_handle_tile_get (GimpPlugIn *plug_in,
   gimp_wire_destroy (&msg);
 }
 
+static void
+gimp_plug_in_handle_region_req (GimpPlugIn  *plug_in,
+                                GPRegionReq *request)
+{
+  GPRegionData     region_data;
+  GimpWireMessage  msg;
+  GeglBuffer      *buffer;
+  const Babl      *format;
+  GeglRectangle    rect;
+  gsize            size;
+
+  g_return_if_fail (request != NULL);
+
+  buffer = gimp_plug_in_get_drawable_buffer (plug_in,
+                                             request->drawable_ID,
+                                             request->shadow,
+                                             request->put);
+  if (! buffer)
+    return;
+
+  rect.x      = request->x;
+  rect.y      = request->y;
+  rect.width  = request->width;
+  rect.height = request->height;
+
+  if (rect.x < 0 || rect.y < 0 || rect.width < 1 || rect.height < 1 ||
+      rect.width  > gegl_buffer_get_width  (buffer) - rect.x ||
+      rect.height > gegl_buffer_get_height (buffer) - rect.y)
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-In \"%s\"\n(%s)\n\n"
+                    "requested invalid region (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_filename_to_utf8 (plug_in->prog));
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  format = gegl_buffer_get_format (buffer);
+
+  if (! gimp_plug_in_precision_enabled (plug_in))
+    {
+      format = gimp_babl_compat_u8_format (format);
+    }
+
+  size = ((gsize) babl_format_get_bytes_per_pixel (format) *
+          rect.width * rect.height);
+
+  region_data.drawable_ID = request->drawable_ID;
+  region_data.shadow      = request->shadow;
+  region_data.x           = rect.x;
+  region_data.y           = rect.y;
+  region_data.width       = rect.width;
+  region_data.height      = rect.height;
+  region_data.bpp         = babl_format_get_bytes_per_pixel (format);
+  region_data.shm_ID      = -1;
+  region_data.shm_size    = 0;
+
+  /*  regions are only transferred through shared memory, without it
+   *  the plug-in falls back to requesting single tiles
+   */
+  if (plug_in->manager->shm && size <= G_MAXUINT32)
+    {
+      if (plug_in->region_shm &&
+          gimp_plug_in_shm_get_size (plug_in->region_shm) < size)
+        {
+          gimp_plug_in_shm_free (plug_in->region_shm);
+          plug_in->region_shm = NULL;
+        }
+
+      if (! plug_in->region_shm)
+        plug_in->region_shm = gimp_plug_in_shm_new_region (size);
+
+      if (plug_in->region_shm)
+        {
+          region_data.shm_ID   = gimp_plug_in_shm_get_ID (plug_in->region_shm);
+          region_data.shm_size = gimp_plug_in_shm_get_size (plug_in->region_shm);
+        }
+    }
+
+  if (region_data.shm_ID != -1 && ! request->put)
+    {
+      gegl_buffer_get (buffer, &rect, 1.0, format,
+                       gimp_plug_in_shm_get_addr (plug_in->region_shm),
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+    }
+
+  if (! gp_region_data_write (plug_in->my_write, &region_data, plug_in))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  if (region_data.shm_ID == -1 || ! request->put)
+    return;
+
+  /*  wait for the plug-in to fill the segment  */
+  if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  if (msg.type != GP_REGION_DATA)
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "expected region data and received: %d", msg.type);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+
+  /*  a drawable ID of -1 means the plug-in could not map the segment  */
+  if (((GPRegionData *) msg.data)->drawable_ID != -1)
+    {
+      gegl_buffer_set (buffer, &rect, 0, format,
+                       gimp_plug_in_shm_get_addr (plug_in->region_shm),
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  gimp_wire_destroy (&msg);
+
+  if (! gp_tile_ack_write (plug_in->my_write, plug_in))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+      return;
+    }
+}
+
+static void
+gimp_plug_in_handle_tiles_req (GimpPlugIn *plug_in,
+                               GPTilesReq *request)
+{
+  GPTilesData    tiles_data;
+  GeglBuffer    *buffer;
+  const Babl    *format;
+  GeglRectangle *rects;
+  gint           bpp;
+  gsize          size = 0;
+  gint           i;
+
+  g_return_if_fail (request != NULL);
+
+  buffer = gimp_plug_in_get_drawable_buffer (plug_in,
+                                             request->drawable_ID,
+                                             request->shadow,
+                                             FALSE);
+  if (! buffer)
+    return;
+
+  format = gegl_buffer_get_format (buffer);
+
+  if (! gimp_plug_in_precision_enabled (plug_in))
+    {
+      format = gimp_babl_compat_u8_format (format);
+    }
+
+  bpp   = babl_format_get_bytes_per_pixel (format);
+  rects = g_new (GeglRectangle, request->n_tiles);
+
+  for (i = 0; i < request->n_tiles; i++)
+    {
+      if (! gimp_gegl_buffer_get_tile_rect (buffer,
+                                            GIMP_PLUG_IN_TILE_WIDTH,
+                                            GIMP_PLUG_IN_TILE_HEIGHT,
+                                            request->tile_nums[i],
+                                            &rects[i]))
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "Plug-In \"%s\"\n(%s)\n\n"
+                        "requested invalid tile (killing)",
+                        gimp_object_get_name (plug_in),
+                        gimp_filename_to_utf8 (plug_in->prog));
+          gimp_plug_in_close (plug_in, TRUE);
+          g_free (rects);
+          return;
+        }
+
+      size += (gsize) bpp * rects[i].width * rects[i].height;
+    }
+
+  tiles_data.drawable_ID = request->drawable_ID;
+  tiles_data.shadow      = request->shadow;
+  tiles_data.bpp         = bpp;
+  tiles_data.n_tiles     = request->n_tiles;
+  tiles_data.tile_nums   = request->tile_nums;
+  tiles_data.data_size   = size;
+  tiles_data.data        = g_malloc (size);
+
+  for (i = 0, size = 0; i < request->n_tiles; i++)
+    {
+      gegl_buffer_get (buffer, &rects[i], 1.0, format,
+                       tiles_data.data + size,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      size += (gsize) bpp * rects[i].width * rects[i].height;
+    }
+
+  g_free (rects);
+
+  /*  the plug-in may already have sent its next request, so we don't
+   *  wait for an acknowledgement here
+   */
+  if (! gp_tiles_data_write (plug_in->my_write, &tiles_data, plug_in))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "%s: ERROR", G_STRFUNC);
+      gimp_plug_in_close (plug_in, TRUE);
+    }
+
+  g_free (tiles_data.data);
+}
+
+static void
+gimp_plug_in_handle_tiles_data (GimpPlugIn  *plug_in,
+                                GPTilesData *tiles_data)
+{
+  GeglBuffer *buffer;
+  const Babl *format;
+  gsize       offset = 0;
+  gint        i;
+
+  g_return_if_fail (tiles_data != NULL);
+
+  buffer = gimp_plug_in_get_drawable_buffer (plug_in,
+                                             tiles_data->drawable_ID,
+                                             tiles_data->shadow,
+                                             TRUE);
+  if (! buffer)
+    return;
+
+  format = gegl_buffer_get_format (buffer);
+
+  if (! gimp_plug_in_precision_enabled (plug_in))
+    {
+      format = gimp_babl_compat_u8_format (format);
+    }
+
+  for (i = 0; i < tiles_data->n_tiles; i++)
+    {
+      GeglRectangle tile_rect;
+      gsize         size;
+
+      if (! gimp_gegl_buffer_get_tile_rect (buffer,
+                                            GIMP_PLUG_IN_TILE_WIDTH,
+                                            GIMP_PLUG_IN_TILE_HEIGHT,
+                                            tiles_data->tile_nums[i],
+                                            &tile_rect) ||
+          tiles_data->bpp != babl_format_get_bytes_per_pixel (format))
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "Plug-In \"%s\"\n(%s)\n\n"
+                        "requested invalid tile (killing)",
+                        gimp_object_get_name (plug_in),
+                        gimp_filename_to_utf8 (plug_in->prog));
+          gimp_plug_in_close (plug_in, TRUE);
+          return;
+        }
+
+      size = (gsize) tiles_data->bpp * tile_rect.width * tile_rect.height;
+
+      if (offset + size > tiles_data->data_size)
+        {
+          gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                        "Plug-In \"%s\"\n(%s)\n\n"
+                        "sent truncated tile data (killing)",
+                        gimp_object_get_name (plug_in),
+                        gimp_filename_to_utf8 (plug_in->prog));
+          gimp_plug_in_close (plug_in, TRUE);
+          return;
+        }
+
+      gegl_buffer_set (buffer, &tile_rect, 0, format,
+                       tiles_data->data + offset,
+                       GEGL_AUTO_ROWSTRIDE);
+
+      offset += size;
+    }
+}
+
+/*  looks up the buffer of drawable_ID the way the tile requests do,
+ *  killing the plug-in and returning NULL if it may not be accessed
+ */
+static GeglBuffer *
+gimp_plug_in_get_drawable_buffer (GimpPlugIn *plug_in,
+                                  gint32      drawable_ID,
+                                  gboolean    shadow,
+                                  gboolean    put)
+{
+  GimpDrawable *drawable;
+
+  drawable = (GimpDrawable *) gimp_item_get_by_ID (plug_in->manager->gimp,
+                                                   drawable_ID);
+
+  if (! GIMP_IS_DRAWABLE (drawable))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-In \"%s\"\n(%s)\n\n"
+                    "tried accessing invalid drawable %d (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_filename_to_utf8 (plug_in->prog),
+                    drawable_ID);
+      gimp_plug_in_close (plug_in, TRUE);
+      return NULL;
+    }
+  else if (gimp_item_is_removed (GIMP_ITEM (drawable)))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-In \"%s\"\n(%s)\n\n"
+                    "tried accessing drawable %d which was removed "
+                    "from the image (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_filename_to_utf8 (plug_in->prog),
+                    drawable_ID);
+      gimp_plug_in_close (plug_in, TRUE);
+      return NULL;
+    }
+
+  if (shadow)
+    {
+      /*  see gimp_plug_in_handle_tile_put() for why groups and locked
+       *  drawables are not checked here
+       */
+      GeglBuffer *buffer = gimp_drawable_get_shadow_buffer (drawable);
+
+      gimp_plug_in_cleanup_add_shadow (plug_in, drawable);
+
+      return buffer;
+    }
+
+  if (put && gimp_item_is_content_locked (GIMP_ITEM (drawable)))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-In \"%s\"\n(%s)\n\n"
+                    "tried writing to a locked drawable %d (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_filename_to_utf8 (plug_in->prog),
+                    drawable_ID);
+      gimp_plug_in_close (plug_in, TRUE);
+      return NULL;
+    }
+  else if (put && gimp_viewable_get_children (GIMP_VIEWABLE (drawable)))
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-In \"%s\"\n(%s)\n\n"
+                    "tried writing to a group layer %d (killing)",
+                    gimp_object_get_name (plug_in),
+                    gimp_filename_to_utf8 (plug_in->prog),
+                    drawable_ID);
+      gimp_plug_in_close (plug_in, TRUE);
+      return NULL;
+    }
+
+  return gimp_drawable_get_buffer (drawable);
+}
+
 static void
 gimp_plug_in_handle_proc_error (GimpPlugIn          *plug_in,
                                 GimpPlugInProcFrame *proc_frame,
@@ -665,6 +1078,18 @@ gimp_plug_in_handle_proc_return (GimpPlugIn   *plug_in,
                                                    proc_frame->return_vals);
     }
 
+  gimp_plug_in_manager_plug_in_returned (plug_in->manager, plug_in);
+
+  if (plug_in->persist)
+    {
+      if (gimp_plug_in_manager_add_persistent_plug_in (plug_in->manager,
+                                                       plug_in))
+        return;
+
+      /*  the plug-in waits for its next call, tell it there is none  */
+      gp_quit_write (plug_in->my_write, plug_in);
+    }
+
   gimp_plug_in_close (plug_in, FALSE);
 }
 
@@ -961,3 +1386,22 @@ gimp_plug_in_handle_has_init (GimpPlugIn *plug_in)
       gimp_plug_in_close (plug_in, TRUE);
     }
 }
+
+static void
+gimp_plug_in_handle_persist (GimpPlugIn *plug_in)
+{
+  if (plug_in->call_mode == GIMP_PLUG_IN_CALL_RUN)
+    {
+      plug_in->persist = TRUE;
+    }
+  else
+    {
+      gimp_message (plug_in->manager->gimp, NULL, GIMP_MESSAGE_ERROR,
+                    "Plug-In \"%s\"\n(%s)\n\n"
+                    "sent a PERSIST message while not in run().  "
+                    "This should not happen.",
+                    gimp_object_get_name (plug_in),
+                    gimp_filename_to_utf8 (plug_in->prog));
+      gimp_plug_in_close (plug_in, TRUE);
+    }
+}
@@ -81,6 +81,7 @@
 #include "gimpenvirontable.h"
 #include "gimpinterpreterdb.h"
 #include "gimpplugin.h"
+#include "gimpplugin-cleanup.h"
 #include "gimpplugin-message.h"
 #include "gimpplugin-progress.h"
 #include "gimpplugindebug.h"
@@ -88,6 +89,8 @@
 #include "gimppluginmanager.h"
 #include "gimppluginmanager-help-domain.h"
 #include "gimppluginmanager-locale-domain.h"
+#include "gimppluginmanager-persistent.h"
+#include "gimppluginshm.h"
 #include "gimptemporaryprocedure.h"
 #include "plug-in-params.h"
 
@@ -526,6 +529,12 @@ gimp_plug_in_close (GimpPlugIn *plug_in,
 
   gimp_wire_clear_error ();
 
+  if (plug_in->region_shm)
+    {
+      gimp_plug_in_shm_free (plug_in->region_shm);
+      plug_in->region_shm = NULL;
+    }
+
   while (plug_in->temp_proc_frames)
     {
       GimpPlugInProcFrame *proc_frame = plug_in->temp_proc_frames->data;
@@ -577,9 +586,60 @@ gimp_plug_in_close (GimpPlugIn *plug_in,
   while (plug_in->temp_procedures)
     gimp_plug_in_remove_temp_proc (plug_in, plug_in->temp_procedures->data);
 
+  gimp_plug_in_manager_remove_persistent_plug_in (plug_in->manager, plug_in);
+
   gimp_plug_in_manager_remove_open_plug_in (plug_in->manager, plug_in);
 }
 
+/*  finishes the main procedure of a plug-in that stays running for
+ *  the next call, like its finalization would do otherwise
+ */
+void
+gimp_plug_in_suspend (GimpPlugIn *plug_in)
+{
+  GimpPlugInProcFrame *proc_frame;
+
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+  g_return_if_fail (plug_in->open);
+
+  proc_frame = &plug_in->main_proc_frame;
+
+  if (proc_frame->progress)
+    {
+      gimp_plug_in_progress_end (plug_in, proc_frame);
+
+      if (proc_frame->progress)
+        {
+          g_object_unref (proc_frame->progress);
+          proc_frame->progress = NULL;
+        }
+    }
+
+  if (proc_frame->image_cleanups || proc_frame->item_cleanups)
+    gimp_plug_in_cleanup (plug_in, proc_frame);
+
+  plug_in->persist = FALSE;
+}
+
+void
+gimp_plug_in_reuse (GimpPlugIn          *plug_in,
+                    GimpContext         *context,
+                    GimpProgress        *progress,
+                    GimpPlugInProcedure *procedure)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+  g_return_if_fail (plug_in->open);
+  g_return_if_fail (GIMP_IS_PDB_CONTEXT (context));
+  g_return_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress));
+  g_return_if_fail (GIMP_IS_PLUG_IN_PROCEDURE (procedure));
+
+  gimp_plug_in_proc_frame_dispose (&plug_in->main_proc_frame, plug_in);
+  gimp_plug_in_proc_frame_init (&plug_in->main_proc_frame,
+                                context, progress, procedure);
+
+  plug_in->precision = FALSE;
+}
+
 static gboolean
 gimp_plug_in_recv_message (GIOChannel   *channel,
                            GIOCondition  cond,
@@ -48,6 +48,7 @@ struct _GimpPlugIn
   guint                open : 1;        /*  Is the plug-in open?              */
   guint                hup : 1;         /*  Did we receive a G_IO_HUP         */
   guint                precision : 1;   /*  True drawable precision enabled   */
+  guint                persist : 1;     /*  Offered to stay for the next call */
   GPid                 pid;             /*  Plug-in's process id              */
 
   GIOChannel          *my_read;         /*  App's read and write channels     */
@@ -69,6 +70,10 @@ struct _GimpPlugIn
   GList               *temp_proc_frames;
 
   GimpPlugInDef       *plug_in_def;     /*  Valid during query() and init()   */
+
+  GimpPlugInShm       *region_shm;      /*  For transferring whole regions    */
+
+  guint                persistent_id;   /*  Idle timeout while persistent     */
 };
 
 struct _GimpPlugInClass
@@ -91,6 +96,12 @@ gboolean      gimp_plug_in_open              (GimpPlugIn             *plug_in,
 void          gimp_plug_in_close             (GimpPlugIn             *plug_in,
                                               gboolean                kill_it);
 
+void          gimp_plug_in_suspend           (GimpPlugIn             *plug_in);
+void          gimp_plug_in_reuse             (GimpPlugIn             *plug_in,
+                                              GimpContext            *context,
+                                              GimpProgress           *progress,
+                                              GimpPlugInProcedure    *procedure);
+
 GimpPlugInProcFrame *
               gimp_plug_in_get_proc_frame    (GimpPlugIn             *plug_in);
 
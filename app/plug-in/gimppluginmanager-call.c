@@ -41,6 +41,7 @@
 #include "gimppluginmanager.h"
 #define __YES_I_NEED_GIMP_PLUG_IN_MANAGER_CALL__
 #include "gimppluginmanager-call.h"
+#include "gimppluginmanager-persistent.h"
 #include "gimppluginshm.h"
 #include "gimptemporaryprocedure.h"
 #include "plug-in-params.h"
@@ -149,7 +150,12 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
   g_return_val_if_fail (args != NULL, NULL);
   g_return_val_if_fail (display == NULL || GIMP_IS_OBJECT (display), NULL);
 
-  plug_in = gimp_plug_in_new (manager, context, progress, procedure, NULL);
+  plug_in = gimp_plug_in_manager_take_persistent_plug_in (manager, procedure);
+
+  if (plug_in)
+    gimp_plug_in_reuse (plug_in, context, progress, procedure);
+  else
+    plug_in = gimp_plug_in_new (manager, context, progress, procedure, NULL);
 
   if (plug_in)
     {
@@ -161,7 +167,8 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
       gint               display_ID;
       gint               monitor;
 
-      if (! gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_RUN, FALSE))
+      if (! plug_in->open &&
+          ! gimp_plug_in_open (plug_in, GIMP_PLUG_IN_CALL_RUN, FALSE))
         {
           const gchar *name  = gimp_object_get_name (plug_in);
           GError      *error = g_error_new (GIMP_PLUG_IN_ERROR,
@@ -204,6 +211,8 @@ gimp_plug_in_manager_call_run (GimpPlugInManager   *manager,
                                                        display_ID, &monitor);
       config.monitor_number   = monitor;
       config.timestamp        = gimp_get_user_time (manager->gimp);
+      config.tile_cache_size  = MIN (GIMP_GEGL_CONFIG (core_config)->tile_cache_size / 1024,
+                                     G_MAXUINT32);
 
       proc_run.name    = GIMP_PROCEDURE (procedure)->original_name;
       proc_run.nparams = gimp_value_array_length (args);
@@ -0,0 +1,241 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * gimppluginmanager-persistent.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpbase/gimpprotocol.h"
+
+#include "plug-in-types.h"
+
+#include "core/gimp.h"
+
+#include "gimpplugin.h"
+#include "gimppluginmanager.h"
+#include "gimppluginmanager-persistent.h"
+#include "gimppluginprocedure.h"
+
+
+/*  plug-ins that offered to stay running after their procedure
+ *  returned are kept for the next call of one of their procedures,
+ *  until they are idle for PERSISTENT_IDLE_TIMEOUT seconds
+ */
+#define PERSISTENT_IDLE_TIMEOUT  30
+#define PERSISTENT_MAX_PLUG_INS  8
+#define PERSISTENT_MAX_MEMSIZE   (256 * 1024 * 1024)
+
+
+static gint64   gimp_plug_in_get_resident_size       (GimpPlugIn        *plug_in);
+static void     gimp_plug_in_manager_quit_persistent (GimpPlugInManager *manager,
+                                                      GimpPlugIn        *plug_in);
+static gboolean gimp_plug_in_persistent_timeout      (gpointer           data);
+
+
+/*  public functions  */
+
+gboolean
+gimp_plug_in_manager_add_persistent_plug_in (GimpPlugInManager *manager,
+                                             GimpPlugIn        *plug_in)
+{
+  GimpProcedure *procedure;
+
+  g_return_val_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager), FALSE);
+  g_return_val_if_fail (GIMP_IS_PLUG_IN (plug_in), FALSE);
+  g_return_val_if_fail (plug_in->open, FALSE);
+
+  procedure = plug_in->main_proc_frame.procedure;
+
+  /*  only plug-ins that don't depend on anything installed or
+   *  started during the last call can simply be called again
+   */
+  if (plug_in->call_mode        != GIMP_PLUG_IN_CALL_RUN ||
+      plug_in->temp_procedures  != NULL                  ||
+      plug_in->temp_proc_frames != NULL                  ||
+      plug_in->ext_main_loop    != NULL                  ||
+      plug_in->hup                                       ||
+      manager->debug                                     ||
+      ! procedure                                        ||
+      procedure->proc_type      != GIMP_PLUGIN)
+    {
+      return FALSE;
+    }
+
+  if (gimp_plug_in_get_resident_size (plug_in) > PERSISTENT_MAX_MEMSIZE)
+    return FALSE;
+
+  g_return_val_if_fail (g_slist_find (manager->persistent_plug_ins,
+                                      plug_in) == NULL, FALSE);
+
+  /*  make room by quitting the one that is idle for the longest time  */
+  while (g_slist_length (manager->persistent_plug_ins) >=
+         PERSISTENT_MAX_PLUG_INS)
+    {
+      GSList *last = g_slist_last (manager->persistent_plug_ins);
+
+      gimp_plug_in_manager_quit_persistent (manager, last->data);
+    }
+
+  gimp_plug_in_suspend (plug_in);
+
+  plug_in->persistent_id =
+    g_timeout_add_seconds (PERSISTENT_IDLE_TIMEOUT,
+                           gimp_plug_in_persistent_timeout, plug_in);
+
+  manager->persistent_plug_ins = g_slist_prepend (manager->persistent_plug_ins,
+                                                  g_object_ref (plug_in));
+
+  if (manager->gimp->be_verbose)
+    g_print ("Keeping plug-in for the next call: '%s'\n",
+             gimp_filename_to_utf8 (plug_in->prog));
+
+  return TRUE;
+}
+
+void
+gimp_plug_in_manager_remove_persistent_plug_in (GimpPlugInManager *manager,
+                                                GimpPlugIn        *plug_in)
+{
+  GSList *list;
+
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+
+  list = g_slist_find (manager->persistent_plug_ins, plug_in);
+
+  if (! list)
+    return;
+
+  if (plug_in->persistent_id)
+    {
+      g_source_remove (plug_in->persistent_id);
+      plug_in->persistent_id = 0;
+    }
+
+  manager->persistent_plug_ins = g_slist_delete_link (manager->persistent_plug_ins,
+                                                      list);
+
+  g_object_unref (plug_in);
+}
+
+/*  returns a reference to a running plug-in that can be sent the
+ *  call of @procedure, or NULL if the plug-in has to be started
+ */
+GimpPlugIn *
+gimp_plug_in_manager_take_persistent_plug_in (GimpPlugInManager   *manager,
+                                              GimpPlugInProcedure *procedure)
+{
+  const gchar *prog;
+  GSList      *list;
+
+  g_return_val_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager), NULL);
+  g_return_val_if_fail (GIMP_IS_PLUG_IN_PROCEDURE (procedure), NULL);
+
+  prog = gimp_plug_in_procedure_get_progname (procedure);
+
+  for (list = manager->persistent_plug_ins; list; list = g_slist_next (list))
+    {
+      GimpPlugIn *plug_in = list->data;
+
+      if (plug_in->open && ! strcmp (plug_in->prog, prog))
+        {
+          g_object_ref (plug_in);
+
+          gimp_plug_in_manager_remove_persistent_plug_in (manager, plug_in);
+
+          return plug_in;
+        }
+    }
+
+  return NULL;
+}
+
+
+/*  private functions  */
+
+static gint64
+gimp_plug_in_get_resident_size (GimpPlugIn *plug_in)
+{
+  gint64 size = 0;
+
+#if defined(G_OS_UNIX) && defined(_SC_PAGESIZE)
+  gchar *filename;
+  gchar *contents;
+
+  filename = g_strdup_printf ("/proc/%d/statm", (gint) plug_in->pid);
+
+  if (g_file_get_contents (filename, &contents, NULL, NULL))
+    {
+      gchar  *resident;
+      gint64  pages;
+
+      /*  statm is "size resident shared ...", in pages  */
+      g_ascii_strtoll (contents, &resident, 10);
+      pages = g_ascii_strtoll (resident, NULL, 10);
+
+      size = pages * sysconf (_SC_PAGESIZE);
+
+      g_free (contents);
+    }
+
+  g_free (filename);
+#endif
+
+  return size;
+}
+
+static void
+gimp_plug_in_manager_quit_persistent (GimpPlugInManager *manager,
+                                      GimpPlugIn        *plug_in)
+{
+  g_object_ref (plug_in);
+
+  gimp_plug_in_manager_remove_persistent_plug_in (manager, plug_in);
+
+  /*  the plug-in waits for its next call in gimp_main(), so it
+   *  exits right away when asked to quit
+   */
+  if (plug_in->open)
+    {
+      gp_quit_write (plug_in->my_write, plug_in);
+      gimp_plug_in_close (plug_in, FALSE);
+    }
+
+  g_object_unref (plug_in);
+}
+
+static gboolean
+gimp_plug_in_persistent_timeout (gpointer data)
+{
+  GimpPlugIn *plug_in = data;
+
+  plug_in->persistent_id = 0;
+
+  gimp_plug_in_manager_quit_persistent (plug_in->manager, plug_in);
+
+  return FALSE;
+}
@@ -24,11 +24,13 @@
 #include <gegl.h>
 
 #include "libgimpbase/gimpbase.h"
+#include "libgimpbase/gimpwire.h"
 #include "libgimpconfig/gimpconfig.h"
 
 #include "plug-in-types.h"
 
 #include "config/gimpcoreconfig.h"
+#include "config/gimpgeglconfig.h"
 
 #include "core/gimp.h"
 
@@ -36,22 +38,36 @@
 #include "pdb/gimppdbcontext.h"
 
 #include "gimpinterpreterdb.h"
+#include "gimpplugin.h"
+#include "gimpplugin-message.h"
 #include "gimpplugindef.h"
 #include "gimppluginmanager.h"
-#define __YES_I_NEED_GIMP_PLUG_IN_MANAGER_CALL__
-#include "gimppluginmanager-call.h"
 #include "gimppluginmanager-help-domain.h"
 #include "gimppluginmanager-locale-domain.h"
 #include "gimppluginmanager-restore.h"
 #include "gimppluginprocedure.h"
 #include "plug-in-rc.h"
+#include "plug-in-rc-cache.h"
 
 #include "gimp-intl.h"
 
 
+/*  the maximum number of plug-ins queried or initialized at once  */
+#define MAX_PARALLEL_PLUG_INS 16
+
+
+static gchar * gimp_plug_in_manager_get_plug_in_path  (GimpPlugInManager      *manager);
 static void    gimp_plug_in_manager_search            (GimpPlugInManager      *manager,
+                                                       const gchar            *path,
                                                        GimpInitStatusFunc      status_callback);
 static gchar * gimp_plug_in_manager_get_pluginrc      (GimpPlugInManager      *manager);
+static GSList * gimp_plug_in_manager_read_cache       (GimpPlugInManager      *manager,
+                                                       const gchar            *cache,
+                                                       const gchar            *pluginrc,
+                                                       GList                  *dirs,
+                                                       const gint64           *dir_mtimes,
+                                                       gboolean               *up_to_date,
+                                                       GimpInitStatusFunc      status_callback);
 static void    gimp_plug_in_manager_read_pluginrc     (GimpPlugInManager      *manager,
                                                        const gchar            *pluginrc,
                                                        GimpInitStatusFunc      status_callback);
@@ -61,6 +77,14 @@ static void    gimp_plug_in_manager_query_new         (GimpPlugInManager      *m
 static void    gimp_plug_in_manager_init_plug_ins     (GimpPlugInManager      *manager,
                                                        GimpContext            *context,
                                                        GimpInitStatusFunc      status_callback);
+static void    gimp_plug_in_manager_call_parallel     (GimpPlugInManager      *manager,
+                                                       GimpContext            *context,
+                                                       GimpPlugInCallMode      call_mode,
+                                                       GList                  *plug_in_defs,
+                                                       GimpInitStatusFunc      status_callback);
+static gboolean gimp_plug_in_manager_parallel_recv    (GIOChannel             *channel,
+                                                       GIOCondition            cond,
+                                                       gpointer                data);
 static void    gimp_plug_in_manager_run_extensions    (GimpPlugInManager      *manager,
                                                        GimpContext            *context,
                                                        GimpInitStatusFunc      status_callback);
@@ -83,10 +107,17 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
                               GimpContext        *context,
                               GimpInitStatusFunc  status_callback)
 {
-  Gimp   *gimp;
-  gchar  *pluginrc;
-  GSList *list;
-  GError *error = NULL;
+  Gimp     *gimp;
+  gchar    *path;
+  GList    *dirs;
+  gint64   *dir_mtimes;
+  gchar    *pluginrc;
+  gchar    *cache;
+  GSList   *cache_defs;
+  gboolean  up_to_date;
+  gboolean  write_cache;
+  GSList   *list;
+  GError   *error = NULL;
 
   g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
   g_return_if_fail (GIMP_IS_CONTEXT (context));
@@ -97,13 +128,51 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
   /* need a GimpPDBContext for calling gimp_plug_in_manager_run_foo() */
   context = gimp_pdb_context_new (gimp, context, TRUE);
 
-  /* search for binaries in the plug-in directory path */
-  gimp_plug_in_manager_search (manager, status_callback);
+  path       = gimp_plug_in_manager_get_plug_in_path (manager);
+  dirs       = gimp_path_parse (path, 256, TRUE, NULL);
+  dir_mtimes = plug_in_rc_cache_get_dir_mtimes (dirs);
 
-  /* read the pluginrc file for cached data */
   pluginrc = gimp_plug_in_manager_get_pluginrc (manager);
+  cache    = g_strconcat (pluginrc, ".cache", NULL);
+
+  /* read the binary pluginrc cache */
+  cache_defs = gimp_plug_in_manager_read_cache (manager, cache, pluginrc,
+                                                dirs, dir_mtimes,
+                                                &up_to_date,
+                                                status_callback);
+
+  if (up_to_date)
+    {
+      /* none of the plug-in directories changed, so the cache lists
+       * exactly the plug-ins a search would find
+       */
+      manager->plug_in_defs = cache_defs;
+
+      write_cache = FALSE;
+    }
+  else
+    {
+      /* search for binaries in the plug-in directory path */
+      gimp_plug_in_manager_search (manager, path, status_callback);
+
+      /* use the cached data of the plug-ins that are still there,
+       * falling back to the pluginrc file
+       */
+      if (cache_defs)
+        {
+          for (list = cache_defs; list; list = g_slist_next (list))
+            gimp_plug_in_manager_add_from_rc (manager, list->data); /* consumes list->data */
 
-  gimp_plug_in_manager_read_pluginrc (manager, pluginrc, status_callback);
+          g_slist_free (cache_defs);
+        }
+      else
+        {
+          gimp_plug_in_manager_read_pluginrc (manager, pluginrc,
+                                              status_callback);
+        }
+
+      write_cache = TRUE;
+    }
 
   /* query any plug-ins that changed since we last wrote out pluginrc */
   gimp_plug_in_manager_query_new (manager, context, status_callback);
@@ -137,9 +206,33 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
         }
 
       manager->write_pluginrc = FALSE;
+
+      write_cache = TRUE;
+    }
+
+  /* write the binary pluginrc cache if necessary, it is only an
+   * optimization, so failing to write it is not an error
+   */
+  if (write_cache)
+    {
+      if (gimp->be_verbose)
+        g_print ("Writing '%s'\n", gimp_filename_to_utf8 (cache));
+
+      if (! plug_in_rc_cache_write (manager->plug_in_defs, cache, pluginrc,
+                                    dirs, dir_mtimes, &error))
+        {
+          if (gimp->be_verbose)
+            g_printerr ("%s\n", error->message);
+
+          g_clear_error (&error);
+        }
     }
 
+  g_free (cache);
   g_free (pluginrc);
+  g_free (dir_mtimes);
+  gimp_path_free (dirs);
+  g_free (path);
 
   /* create locale and help domain lists */
   for (list = manager->plug_in_defs; list; list = list->next)
@@ -196,12 +289,29 @@ gimp_plug_in_manager_restore (GimpPlugInManager  *manager,
 }
 
 
+static gchar *
+gimp_plug_in_manager_get_plug_in_path (GimpPlugInManager *manager)
+{
+  gchar *path;
+
+  /* Give automatic tests a chance to use plug-ins from the build
+   * dir
+   */
+  path = g_strdup(g_getenv("GIMP_TESTING_PLUGINDIRS"));
+
+  if (! path) 
+    path = gimp_config_path_expand (manager->gimp->config->plug_in_path,
+                                    TRUE, NULL);
+
+  return path;
+}
+
 /* search for binaries in the plug-in directory path */
 static void
 gimp_plug_in_manager_search (GimpPlugInManager  *manager,
+                             const gchar        *path,
                              GimpInitStatusFunc  status_callback)
 {
-  gchar       *path;
   const gchar *pathext = g_getenv ("PATHEXT");
 
   /*  If PATHEXT is set, we are likely on Windows and need to add
@@ -228,21 +338,10 @@ gimp_plug_in_manager_search (GimpPlugInManager  *manager,
 
   status_callback (_("Searching Plug-Ins"), "", 0.0);
 
-  /* Give automatic tests a chance to use plug-ins from the build
-   * dir
-   */
-  path = g_strdup(g_getenv("GIMP_TESTING_PLUGINDIRS"));
-
-  if (! path) 
-    path = gimp_config_path_expand (manager->gimp->config->plug_in_path,
-                                    TRUE, NULL);
-
   gimp_datafiles_read_directories (path,
                                    G_FILE_TEST_IS_EXECUTABLE,
                                    gimp_plug_in_manager_add_from_file,
                                    manager);
-
-  g_free (path);
 }
 
 static gchar *
@@ -272,6 +371,40 @@ gimp_plug_in_manager_get_pluginrc (GimpPlugInManager *manager)
   return pluginrc;
 }
 
+/* read the binary pluginrc cache */
+static GSList *
+gimp_plug_in_manager_read_cache (GimpPlugInManager  *manager,
+                                 const gchar        *cache,
+                                 const gchar        *pluginrc,
+                                 GList              *dirs,
+                                 const gint64       *dir_mtimes,
+                                 gboolean           *up_to_date,
+                                 GimpInitStatusFunc  status_callback)
+{
+  GSList *cache_defs;
+  GError *error = NULL;
+
+  status_callback (_("Resource configuration"),
+                   gimp_filename_to_utf8 (cache), 0.0);
+
+  if (manager->gimp->be_verbose)
+    g_print ("Reading '%s'\n", gimp_filename_to_utf8 (cache));
+
+  cache_defs = plug_in_rc_cache_read (manager->gimp, cache, pluginrc,
+                                      dirs, dir_mtimes, up_to_date, &error);
+
+  if (error)
+    {
+      if (manager->gimp->be_verbose &&
+          error->code != GIMP_CONFIG_ERROR_OPEN_ENOENT)
+        g_printerr ("%s\n", error->message);
+
+      g_clear_error (&error);
+    }
+
+  return cache_defs;
+}
+
 /* read the pluginrc file for cached data */
 static void
 gimp_plug_in_manager_read_pluginrc (GimpPlugInManager  *manager,
@@ -315,44 +448,29 @@ gimp_plug_in_manager_query_new (GimpPlugInManager  *manager,
                                 GimpInitStatusFunc  status_callback)
 {
   GSList *list;
-  gint    n_plugins;
+  GList  *plug_in_defs = NULL;
 
   status_callback (_("Querying new Plug-ins"), "", 0.0);
 
-  for (list = manager->plug_in_defs, n_plugins = 0; list; list = list->next)
+  for (list = manager->plug_in_defs; list; list = list->next)
     {
       GimpPlugInDef *plug_in_def = list->data;
 
       if (plug_in_def->needs_query)
-        n_plugins++;
+        plug_in_defs = g_list_prepend (plug_in_defs, plug_in_def);
     }
 
-  if (n_plugins)
+  if (plug_in_defs)
     {
-      gint nth;
-
       manager->write_pluginrc = TRUE;
 
-      for (list = manager->plug_in_defs, nth = 0; list; list = list->next)
-        {
-          GimpPlugInDef *plug_in_def = list->data;
-
-          if (plug_in_def->needs_query)
-            {
-              gchar *basename;
-
-              basename = g_filename_display_basename (plug_in_def->prog);
-              status_callback (NULL, basename,
-                               (gdouble) nth++ / (gdouble) n_plugins);
-              g_free (basename);
+      plug_in_defs = g_list_reverse (plug_in_defs);
 
-              if (manager->gimp->be_verbose)
-                g_print ("Querying plug-in: '%s'\n",
-                         gimp_filename_to_utf8 (plug_in_def->prog));
+      gimp_plug_in_manager_call_parallel (manager, context,
+                                          GIMP_PLUG_IN_CALL_QUERY,
+                                          plug_in_defs, status_callback);
 
-              gimp_plug_in_manager_call_query (manager, context, plug_in_def);
-            }
-        }
+      g_list_free (plug_in_defs);
     }
 
   status_callback (NULL, "", 1.0);
@@ -365,45 +483,158 @@ gimp_plug_in_manager_init_plug_ins (GimpPlugInManager  *manager,
                                     GimpInitStatusFunc  status_callback)
 {
   GSList *list;
-  gint    n_plugins;
+  GList  *plug_in_defs = NULL;
 
   status_callback (_("Initializing Plug-ins"), "", 0.0);
 
-  for (list = manager->plug_in_defs, n_plugins = 0; list; list = list->next)
+  for (list = manager->plug_in_defs; list; list = list->next)
     {
       GimpPlugInDef *plug_in_def = list->data;
 
       if (plug_in_def->has_init)
-        n_plugins++;
+        plug_in_defs = g_list_prepend (plug_in_defs, plug_in_def);
     }
 
-  if (n_plugins)
+  if (plug_in_defs)
     {
-      gint nth;
+      plug_in_defs = g_list_reverse (plug_in_defs);
+
+      gimp_plug_in_manager_call_parallel (manager, context,
+                                          GIMP_PLUG_IN_CALL_INIT,
+                                          plug_in_defs, status_callback);
 
-      for (list = manager->plug_in_defs, nth = 0; list; list = list->next)
+      g_list_free (plug_in_defs);
+    }
+
+  status_callback (NULL, "", 1.0);
+}
+
+/*  runs query() or init() of several plug-ins at the same time. All
+ *  their messages are handled here in the main thread, one at a time,
+ *  and each plug-in only adds to its own GimpPlugInDef, so the result
+ *  doesn't depend on the order in which they finish
+ */
+static void
+gimp_plug_in_manager_call_parallel (GimpPlugInManager  *manager,
+                                    GimpContext        *context,
+                                    GimpPlugInCallMode  call_mode,
+                                    GList              *plug_in_defs,
+                                    GimpInitStatusFunc  status_callback)
+{
+  GMainContext *main_context;
+  GList        *running   = NULL;
+  gint          n_running = 0;
+  gint          n_workers;
+  gint          n_plugins = g_list_length (plug_in_defs);
+  gint          nth       = 0;
+
+  n_workers = GIMP_GEGL_CONFIG (manager->gimp->config)->num_processors;
+  n_workers = CLAMP (n_workers, 1, MAX_PARALLEL_PLUG_INS);
+
+  /*  a plug-in that is being debugged gets the terminal for itself  */
+  if (manager->debug)
+    n_workers = 1;
+
+  main_context = g_main_context_new ();
+
+  while (plug_in_defs || running)
+    {
+      GList *list;
+
+      while (plug_in_defs && n_running < n_workers)
         {
-          GimpPlugInDef *plug_in_def = list->data;
+          GimpPlugInDef *plug_in_def = plug_in_defs->data;
+          GimpPlugIn    *plug_in;
+          gchar         *basename;
+
+          plug_in_defs = g_list_next (plug_in_defs);
+
+          basename = g_filename_display_basename (plug_in_def->prog);
+          status_callback (NULL, basename,
+                           (gdouble) nth++ / (gdouble) n_plugins);
+          g_free (basename);
+
+          if (manager->gimp->be_verbose)
+            g_print ("%s plug-in: '%s'\n",
+                     call_mode == GIMP_PLUG_IN_CALL_QUERY ?
+                     "Querying" : "Initializing",
+                     gimp_filename_to_utf8 (plug_in_def->prog));
 
-          if (plug_in_def->has_init)
+          plug_in = gimp_plug_in_new (manager, context, NULL,
+                                      NULL, plug_in_def->prog);
+
+          if (! plug_in)
+            continue;
+
+          plug_in->plug_in_def = plug_in_def;
+
+          if (gimp_plug_in_open (plug_in, call_mode, TRUE))
             {
-              gchar *basename;
+              GSource *source;
 
-              basename = g_filename_display_basename (plug_in_def->prog);
-              status_callback (NULL, basename,
-                               (gdouble) nth++ / (gdouble) n_plugins);
-              g_free (basename);
+              source = g_io_create_watch (plug_in->my_read,
+                                          G_IO_IN  | G_IO_PRI |
+                                          G_IO_ERR | G_IO_HUP);
 
-              if (manager->gimp->be_verbose)
-                g_print ("Initializing plug-in: '%s'\n",
-                         gimp_filename_to_utf8 (plug_in_def->prog));
+              /*  the source is removed once the plug-in is closed  */
+              g_source_set_callback (source,
+                                     (GSourceFunc) gimp_plug_in_manager_parallel_recv,
+                                     plug_in, NULL);
+              g_source_attach (source, main_context);
+              g_source_unref (source);
 
-              gimp_plug_in_manager_call_init (manager, context, plug_in_def);
+              running = g_list_prepend (running, plug_in);
+              n_running++;
+            }
+          else
+            {
+              g_object_unref (plug_in);
+            }
+        }
+
+      if (! running)
+        continue;
+
+      g_main_context_iteration (main_context, TRUE);
+
+      for (list = running; list; )
+        {
+          GimpPlugIn *plug_in = list->data;
+
+          list = g_list_next (list);
+
+          if (! plug_in->open)
+            {
+              running = g_list_remove (running, plug_in);
+              n_running--;
+
+              g_object_unref (plug_in);
             }
         }
     }
 
-  status_callback (NULL, "", 1.0);
+  g_main_context_unref (main_context);
+}
+
+static gboolean
+gimp_plug_in_manager_parallel_recv (GIOChannel   *channel,
+                                    GIOCondition  cond,
+                                    gpointer      data)
+{
+  GimpPlugIn      *plug_in = data;
+  GimpWireMessage  msg;
+
+  if (! gimp_wire_read_msg (plug_in->my_read, &msg, plug_in))
+    {
+      gimp_plug_in_close (plug_in, TRUE);
+    }
+  else
+    {
+      gimp_plug_in_handle_message (plug_in, &msg);
+      gimp_wire_destroy (&msg);
+    }
+
+  return plug_in->open;
 }
 
 /* run automatically started extensions */
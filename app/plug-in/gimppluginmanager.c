@@ -57,6 +57,7 @@ enum
 {
   PLUG_IN_OPENED,
   PLUG_IN_CLOSED,
+  PLUG_IN_RETURNED,
   MENU_BRANCH_ADDED,
   HISTORY_CHANGED,
   LAST_SIGNAL
@@ -105,6 +106,17 @@ gimp_plug_in_manager_class_init (GimpPlugInManagerClass *klass)
                   G_TYPE_NONE, 1,
                   GIMP_TYPE_PLUG_IN);
 
+  manager_signals[PLUG_IN_RETURNED] =
+    g_signal_new ("plug-in-returned",
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  G_STRUCT_OFFSET (GimpPlugInManagerClass,
+                                   plug_in_returned),
+                  NULL, NULL,
+                  gimp_marshal_VOID__OBJECT,
+                  G_TYPE_NONE, 1,
+                  GIMP_TYPE_PLUG_IN);
+
   manager_signals[MENU_BRANCH_ADDED] =
     g_signal_new ("menu-branch-added",
                   G_TYPE_FROM_CLASS (klass),
@@ -150,6 +162,7 @@ gimp_plug_in_manager_init (GimpPlugInManager *manager)
   manager->current_plug_in    = NULL;
   manager->open_plug_ins      = NULL;
   manager->plug_in_stack      = NULL;
+  manager->persistent_plug_ins = NULL;
   manager->history            = NULL;
 
   manager->shm                = NULL;
@@ -450,6 +463,20 @@ gimp_plug_in_manager_remove_open_plug_in (GimpPlugInManager *manager,
   g_object_unref (plug_in);
 }
 
+/*  emitted when the main procedure of @plug_in returned, while its
+ *  main_proc_frame still holds the context and the return values
+ */
+void
+gimp_plug_in_manager_plug_in_returned (GimpPlugInManager *manager,
+                                       GimpPlugIn        *plug_in)
+{
+  g_return_if_fail (GIMP_IS_PLUG_IN_MANAGER (manager));
+  g_return_if_fail (GIMP_IS_PLUG_IN (plug_in));
+
+  g_signal_emit (manager, manager_signals[PLUG_IN_RETURNED], 0,
+                 plug_in);
+}
+
 void
 gimp_plug_in_manager_plug_in_push (GimpPlugInManager *manager,
                                    GimpPlugIn        *plug_in)
@@ -55,6 +55,7 @@ struct _GimpPlugInManager
   GimpPlugIn        *current_plug_in;
   GSList            *open_plug_ins;
   GSList            *plug_in_stack;
+  GSList            *persistent_plug_ins;
   GSList            *history;
 
   GimpPlugInShm     *shm;
@@ -72,6 +73,8 @@ struct _GimpPlugInManagerClass
                               GimpPlugIn        *plug_in);
   void (* plug_in_closed)    (GimpPlugInManager *manager,
                               GimpPlugIn        *plug_in);
+  void (* plug_in_returned)  (GimpPlugInManager *manager,
+                              GimpPlugIn        *plug_in);
 
   void (* menu_branch_added) (GimpPlugInManager *manager,
                               const gchar       *prog_name,
@@ -106,6 +109,9 @@ void    gimp_plug_in_manager_add_open_plug_in     (GimpPlugInManager   *manager,
 void    gimp_plug_in_manager_remove_open_plug_in  (GimpPlugInManager   *manager,
                                                    GimpPlugIn          *plug_in);
 
+void    gimp_plug_in_manager_plug_in_returned     (GimpPlugInManager   *manager,
+                                                   GimpPlugIn          *plug_in);
+
 void    gimp_plug_in_manager_plug_in_push         (GimpPlugInManager   *manager,
                                                    GimpPlugIn          *plug_in);
 void    gimp_plug_in_manager_plug_in_pop          (GimpPlugInManager   *manager);
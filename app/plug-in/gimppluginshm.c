@@ -79,6 +79,8 @@ struct _GimpPlugInShm
 {
   gint    shm_ID;
   guchar *shm_addr;
+  gsize   shm_size;
+  gint    serial;
 
 #if defined(USE_WIN32_SHM)
   HANDLE  shm_handle;
@@ -86,6 +88,13 @@ struct _GimpPlugInShm
 };
 
 
+static GimpPlugInShm * gimp_plug_in_shm_create   (gsize          size,
+                                                   gint           serial);
+static void            gimp_plug_in_shm_get_name (GimpPlugInShm *shm,
+                                                  gchar         *name,
+                                                  gsize          name_size);
+
+
 GimpPlugInShm *
 gimp_plug_in_shm_new (void)
 {
@@ -94,15 +103,38 @@ gimp_plug_in_shm_new (void)
    *  we'll fall back on sending the data over the pipe.
    */
 
+  return gimp_plug_in_shm_create (TILE_MAP_SIZE, 0);
+}
+
+/* allocate a piece of shared memory of at least size bytes for use in
+ *  transporting a whole region to a plug-in.  The segment's name is
+ *  derived from the tile segment's ID and the returned ID.
+ */
+GimpPlugInShm *
+gimp_plug_in_shm_new_region (gsize size)
+{
+  static gint serial = 0;
+
+  g_return_val_if_fail (size > 0, NULL);
+
+  return gimp_plug_in_shm_create (size, ++serial);
+}
+
+static GimpPlugInShm *
+gimp_plug_in_shm_create (gsize size,
+                         gint  serial)
+{
   GimpPlugInShm *shm = g_slice_new0 (GimpPlugInShm);
 
-  shm->shm_ID = -1;
+  shm->shm_ID   = -1;
+  shm->shm_size = size;
+  shm->serial   = serial;
 
 #if defined(USE_SYSV_SHM)
 
   /* Use SysV shared memory mechanisms for transferring tile data. */
   {
-    shm->shm_ID = shmget (IPC_PRIVATE, TILE_MAP_SIZE, IPC_CREAT | 0600);
+    shm->shm_ID = shmget (IPC_PRIVATE, shm->shm_size, IPC_CREAT | 0600);
 
     if (shm->shm_ID != -1)
       {
@@ -132,19 +164,15 @@ gimp_plug_in_shm_new (void)
 
   /* Use Win32 shared memory mechanisms for transferring tile data. */
   {
-    gint  pid;
     gchar fileMapName[MAX_PATH];
 
-    /* Our shared memory id will be our process ID */
-    pid = GetCurrentProcessId ();
-
     /* From the id, derive the file map name */
-    g_snprintf (fileMapName, sizeof (fileMapName), "GIMP%d.SHM", pid);
+    gimp_plug_in_shm_get_name (shm, fileMapName, sizeof (fileMapName));
 
     /* Create the file mapping into paging space */
     shm->shm_handle = CreateFileMapping (INVALID_HANDLE_VALUE, NULL,
                                          PAGE_READWRITE, 0,
-                                         TILE_MAP_SIZE,
+                                         shm->shm_size,
                                          fileMapName);
 
     if (shm->shm_handle)
@@ -152,12 +180,12 @@ gimp_plug_in_shm_new (void)
         /* Map the shared memory into our address space for use */
         shm->shm_addr = (guchar *) MapViewOfFile (shm->shm_handle,
                                                   FILE_MAP_ALL_ACCESS,
-                                                  0, 0, TILE_MAP_SIZE);
+                                                  0, 0, shm->shm_size);
 
         /* Verify that we mapped our view */
         if (shm->shm_addr)
           {
-            shm->shm_ID = pid;
+            shm->shm_ID = serial ? serial : GetCurrentProcessId ();
           }
         else
           {
@@ -176,32 +204,28 @@ gimp_plug_in_shm_new (void)
 
   /* Use POSIX shared memory mechanisms for transferring tile data. */
   {
-    gint  pid;
     gchar shm_handle[32];
     gint  shm_fd;
 
-    /* Our shared memory id will be our process ID */
-    pid = gimp_get_pid ();
-
     /* From the id, derive the file map name */
-    g_snprintf (shm_handle, sizeof (shm_handle), "/gimp-shm-%d", pid);
+    gimp_plug_in_shm_get_name (shm, shm_handle, sizeof (shm_handle));
 
     /* Create the file mapping into paging space */
     shm_fd = shm_open (shm_handle, O_RDWR | O_CREAT, 0600);
 
     if (shm_fd != -1)
       {
-        if (ftruncate (shm_fd, TILE_MAP_SIZE) != -1)
+        if (ftruncate (shm_fd, shm->shm_size) != -1)
           {
             /* Map the shared memory into our address space for use */
-            shm->shm_addr = (guchar *) mmap (NULL, TILE_MAP_SIZE,
+            shm->shm_addr = (guchar *) mmap (NULL, shm->shm_size,
                                              PROT_READ | PROT_WRITE, MAP_SHARED,
                                              shm_fd, 0);
 
             /* Verify that we mapped our view */
             if (shm->shm_addr != MAP_FAILED)
               {
-                shm->shm_ID = pid;
+                shm->shm_ID = serial ? serial : gimp_get_pid ();
               }
             else
               {
@@ -261,6 +285,9 @@ gimp_plug_in_shm_free (GimpPlugInShm *shm)
 
 #elif defined(USE_WIN32_SHM)
 
+      if (shm->shm_addr)
+        UnmapViewOfFile (shm->shm_addr);
+
       if (shm->shm_handle)
         CloseHandle (shm->shm_handle);
 
@@ -268,10 +295,9 @@ gimp_plug_in_shm_free (GimpPlugInShm *shm)
 
       gchar shm_handle[32];
 
-      munmap (shm->shm_addr, TILE_MAP_SIZE);
+      munmap (shm->shm_addr, shm->shm_size);
 
-      g_snprintf (shm_handle, sizeof (shm_handle), "/gimp-shm-%d",
-                  shm->shm_ID);
+      gimp_plug_in_shm_get_name (shm, shm_handle, sizeof (shm_handle));
 
       shm_unlink (shm_handle);
 
@@ -298,3 +324,36 @@ gimp_plug_in_shm_get_addr (GimpPlugInShm *shm)
 
   return shm->shm_addr;
 }
+
+gsize
+gimp_plug_in_shm_get_size (GimpPlugInShm *shm)
+{
+  g_return_val_if_fail (shm != NULL, 0);
+
+  return shm->shm_size;
+}
+
+static void
+gimp_plug_in_shm_get_name (GimpPlugInShm *shm,
+                           gchar         *name,
+                           gsize          name_size)
+{
+  /* the tile segment is named after our process ID, region segments
+   *  after it and their serial number
+   */
+#if defined(USE_WIN32_SHM)
+  gint pid = GetCurrentProcessId ();
+
+  if (shm->serial)
+    g_snprintf (name, name_size, "GIMP%d-%d.SHM", pid, shm->serial);
+  else
+    g_snprintf (name, name_size, "GIMP%d.SHM", pid);
+#else
+  gint pid = gimp_get_pid ();
+
+  if (shm->serial)
+    g_snprintf (name, name_size, "/gimp-shm-%d-%d", pid, shm->serial);
+  else
+    g_snprintf (name, name_size, "/gimp-shm-%d", pid);
+#endif
+}
@@ -40,7 +40,7 @@ plug_in_params_to_args (GParamSpec **pspecs,
                         GPParam     *params,
                         gint         n_params,
                         gboolean     return_values,
-                        gboolean     full_copy)
+                        gboolean     take_data)
 {
   GimpValueArray *args;
   gint            i;
@@ -54,9 +54,9 @@ plug_in_params_to_args (GParamSpec **pspecs,
 
   for (i = 0; i < n_params; i++)
     {
-      GValue value = { 0, };
-      GType  type;
-      gint   count;
+      GValue *value;
+      GType   type;
+      gint    count;
 
       /*  first get the fallback compat GType that matches the pdb type  */
       type = gimp_pdb_compat_arg_type_to_gtype (params[i].type);
@@ -90,171 +90,193 @@ plug_in_params_to_args (GParamSpec **pspecs,
             }
         }
 
-      g_value_init (&value, type);
+      /*  initialize the value in place, appending a ready value
+       *  would copy its data once more
+       */
+      gimp_value_array_append (args, NULL);
+
+      value = gimp_value_array_index (args, i);
+
+      g_value_init (value, type);
 
       switch (gimp_pdb_compat_arg_type_from_gtype (type))
         {
         case GIMP_PDB_INT32:
-          if (G_VALUE_HOLDS_INT (&value))
-            g_value_set_int (&value, params[i].data.d_int32);
-          else if (G_VALUE_HOLDS_UINT (&value))
-            g_value_set_uint (&value, params[i].data.d_int32);
-          else if (G_VALUE_HOLDS_ENUM (&value))
-            g_value_set_enum (&value, params[i].data.d_int32);
-          else if (G_VALUE_HOLDS_BOOLEAN (&value))
-            g_value_set_boolean (&value, params[i].data.d_int32 ? TRUE : FALSE);
+          if (G_VALUE_HOLDS_INT (value))
+            g_value_set_int (value, params[i].data.d_int32);
+          else if (G_VALUE_HOLDS_UINT (value))
+            g_value_set_uint (value, params[i].data.d_int32);
+          else if (G_VALUE_HOLDS_ENUM (value))
+            g_value_set_enum (value, params[i].data.d_int32);
+          else if (G_VALUE_HOLDS_BOOLEAN (value))
+            g_value_set_boolean (value, params[i].data.d_int32 ? TRUE : FALSE);
           else
             {
               g_printerr ("%s: unhandled GIMP_PDB_INT32 type: %s\n",
-                          G_STRFUNC, g_type_name (G_VALUE_TYPE (&value)));
+                          G_STRFUNC, g_type_name (G_VALUE_TYPE (value)));
               g_return_val_if_reached (args);
             }
           break;
 
         case GIMP_PDB_INT16:
-          g_value_set_int (&value, params[i].data.d_int16);
+          g_value_set_int (value, params[i].data.d_int16);
           break;
 
         case GIMP_PDB_INT8:
-          g_value_set_uint (&value, params[i].data.d_int8);
+          g_value_set_uint (value, params[i].data.d_int8);
           break;
 
         case GIMP_PDB_FLOAT:
-          g_value_set_double (&value, params[i].data.d_float);
+          g_value_set_double (value, params[i].data.d_float);
           break;
 
         case GIMP_PDB_STRING:
-          if (full_copy)
-            g_value_set_string (&value, params[i].data.d_string);
+          if (take_data)
+            {
+              g_value_take_string (value, params[i].data.d_string);
+              params[i].data.d_string = NULL;
+            }
           else
-            g_value_set_static_string (&value, params[i].data.d_string);
+            g_value_set_static_string (value, params[i].data.d_string);
           break;
 
         case GIMP_PDB_INT32ARRAY:
           count = g_value_get_int (gimp_value_array_index (args, i - 1));
-          if (full_copy)
-            gimp_value_set_int32array (&value,
-                                       params[i].data.d_int32array,
-                                       count);
+          if (take_data)
+            {
+              gimp_value_take_int32array (value,
+                                          params[i].data.d_int32array,
+                                          count);
+              params[i].data.d_int32array = NULL;
+            }
           else
-            gimp_value_set_static_int32array (&value,
+            gimp_value_set_static_int32array (value,
                                               params[i].data.d_int32array,
                                               count);
           break;
 
         case GIMP_PDB_INT16ARRAY:
           count = g_value_get_int (gimp_value_array_index (args, i - 1));
-          if (full_copy)
-            gimp_value_set_int16array (&value,
-                                       params[i].data.d_int16array,
-                                       count);
+          if (take_data)
+            {
+              gimp_value_take_int16array (value,
+                                          params[i].data.d_int16array,
+                                          count);
+              params[i].data.d_int16array = NULL;
+            }
           else
-            gimp_value_set_static_int16array (&value,
+            gimp_value_set_static_int16array (value,
                                               params[i].data.d_int16array,
                                               count);
           break;
 
         case GIMP_PDB_INT8ARRAY:
           count = g_value_get_int (gimp_value_array_index (args, i - 1));
-          if (full_copy)
-            gimp_value_set_int8array (&value,
-                                      params[i].data.d_int8array,
-                                      count);
+          if (take_data)
+            {
+              gimp_value_take_int8array (value,
+                                         params[i].data.d_int8array,
+                                         count);
+              params[i].data.d_int8array = NULL;
+            }
           else
-            gimp_value_set_static_int8array (&value,
+            gimp_value_set_static_int8array (value,
                                              params[i].data.d_int8array,
                                              count);
           break;
 
         case GIMP_PDB_FLOATARRAY:
           count = g_value_get_int (gimp_value_array_index (args, i - 1));
-          if (full_copy)
-            gimp_value_set_floatarray (&value,
-                                       params[i].data.d_floatarray,
-                                       count);
+          if (take_data)
+            {
+              gimp_value_take_floatarray (value,
+                                          params[i].data.d_floatarray,
+                                          count);
+              params[i].data.d_floatarray = NULL;
+            }
           else
-            gimp_value_set_static_floatarray (&value,
+            gimp_value_set_static_floatarray (value,
                                               params[i].data.d_floatarray,
                                               count);
           break;
 
         case GIMP_PDB_STRINGARRAY:
           count = g_value_get_int (gimp_value_array_index (args, i - 1));
-          if (full_copy)
-            gimp_value_set_stringarray (&value,
+          if (take_data)
+            gimp_value_set_stringarray (value,
                                         (const gchar **) params[i].data.d_stringarray,
                                         count);
           else
-            gimp_value_set_static_stringarray (&value,
+            gimp_value_set_static_stringarray (value,
                                                (const gchar **) params[i].data.d_stringarray,
                                                count);
           break;
 
         case GIMP_PDB_COLOR:
-          gimp_value_set_rgb (&value, &params[i].data.d_color);
+          gimp_value_set_rgb (value, &params[i].data.d_color);
           break;
 
         case GIMP_PDB_ITEM:
-          g_value_set_int (&value, params[i].data.d_item);
+          g_value_set_int (value, params[i].data.d_item);
           break;
 
         case GIMP_PDB_DISPLAY:
-          g_value_set_int (&value, params[i].data.d_display);
+          g_value_set_int (value, params[i].data.d_display);
           break;
 
         case GIMP_PDB_IMAGE:
-          g_value_set_int (&value, params[i].data.d_image);
+          g_value_set_int (value, params[i].data.d_image);
           break;
 
         case GIMP_PDB_LAYER:
-          g_value_set_int (&value, params[i].data.d_layer);
+          g_value_set_int (value, params[i].data.d_layer);
           break;
 
         case GIMP_PDB_CHANNEL:
-          g_value_set_int (&value, params[i].data.d_channel);
+          g_value_set_int (value, params[i].data.d_channel);
           break;
 
         case GIMP_PDB_DRAWABLE:
-          g_value_set_int (&value, params[i].data.d_drawable);
+          g_value_set_int (value, params[i].data.d_drawable);
           break;
 
         case GIMP_PDB_SELECTION:
-          g_value_set_int (&value, params[i].data.d_selection);
+          g_value_set_int (value, params[i].data.d_selection);
           break;
 
         case GIMP_PDB_COLORARRAY:
           count = g_value_get_int (gimp_value_array_index (args, i - 1));
-          if (full_copy)
-            gimp_value_set_colorarray (&value,
-                                      params[i].data.d_colorarray,
-                                      count);
+          if (take_data)
+            {
+              gimp_value_take_colorarray (value,
+                                          params[i].data.d_colorarray,
+                                          count);
+              params[i].data.d_colorarray = NULL;
+            }
           else
-            gimp_value_set_static_colorarray (&value,
+            gimp_value_set_static_colorarray (value,
                                              params[i].data.d_colorarray,
                                              count);
           break;
 
         case GIMP_PDB_VECTORS:
-          g_value_set_int (&value, params[i].data.d_vectors);
+          g_value_set_int (value, params[i].data.d_vectors);
           break;
 
         case GIMP_PDB_PARASITE:
-          if (full_copy)
-            g_value_set_boxed (&value, &params[i].data.d_parasite);
+          if (take_data)
+            g_value_set_boxed (value, &params[i].data.d_parasite);
           else
-            g_value_set_static_boxed (&value, &params[i].data.d_parasite);
+            g_value_set_static_boxed (value, &params[i].data.d_parasite);
           break;
 
         case GIMP_PDB_STATUS:
-          g_value_set_enum (&value, params[i].data.d_status);
+          g_value_set_enum (value, params[i].data.d_status);
           break;
 
         case GIMP_PDB_END:
           break;
         }
-
-      gimp_value_array_append (args, &value);
-      g_value_unset (&value);
     }
 
   return args;
@@ -24,7 +24,7 @@ GimpValueArray * plug_in_params_to_args (GParamSpec     **pspecs,
                                          GPParam         *params,
                                          gint             n_params,
                                          gboolean         return_values,
-                                         gboolean         full_copy);
+                                         gboolean         take_data);
 GPParam     * plug_in_args_to_params    (GimpValueArray  *args,
                                          gboolean         full_copy);
 
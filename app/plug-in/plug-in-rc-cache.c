@@ -0,0 +1,905 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * plug-in-rc-cache.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <string.h>
+
+#include <glib-object.h>
+#include <glib/gstdio.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpbase/gimpprotocol.h"
+#include "libgimpconfig/gimpconfig.h"
+
+#include "plug-in-types.h"
+
+#include "core/gimp.h"
+
+#include "pdb/gimp-pdb-compat.h"
+
+#include "gimpplugindef.h"
+#include "gimppluginprocedure.h"
+#include "plug-in-rc-cache.h"
+
+#include "gimp-intl.h"
+
+
+/*  The binary pluginrc cache holds the same information as pluginrc,
+ *  in a form that is read straight from a mapped file. It also records
+ *  the modification times of the plug-in directories and the
+ *  modification time and size of each executable, so the search for
+ *  plug-ins can be skipped as long as none of them changed, and the
+ *  stamp of pluginrc, so removing pluginrc still causes all plug-ins
+ *  to be queried again. The executables are checked one by one,
+ *  because overwriting one in place doesn't change its directory.
+ *
+ *  All numbers are stored in host byte order, strings as their
+ *  length followed by their bytes, with a length of G_MAXUINT32
+ *  for NULL.
+ */
+
+#define PLUG_IN_RC_CACHE_MAGIC      "GIMPPRC"
+#define PLUG_IN_RC_CACHE_BYTE_ORDER 0x01020304
+#define PLUG_IN_RC_CACHE_VERSION    2
+
+#define NULL_STRING                 G_MAXUINT32
+
+
+enum
+{
+  PROC_FILE_PROC   = 1 << 0,
+  PROC_HANDLES_URI = 1 << 1
+};
+
+enum
+{
+  DEF_HAS_INIT     = 1 << 0
+};
+
+
+typedef struct
+{
+  const guchar *data;
+  gsize         length;
+  gsize         offset;
+} CacheReader;
+
+
+static gboolean  plug_in_rc_cache_get_stamp     (const gchar          *filename,
+                                                 gint64               *mtime,
+                                                 gint64               *size);
+
+static gboolean  cache_read_bytes               (CacheReader          *reader,
+                                                 gpointer              dest,
+                                                 gsize                 n_bytes);
+static gboolean  cache_read_uint32              (CacheReader          *reader,
+                                                 guint32              *value);
+static gboolean  cache_read_int32               (CacheReader          *reader,
+                                                 gint32               *value);
+static gboolean  cache_read_int64               (CacheReader          *reader,
+                                                 gint64               *value);
+static gboolean  cache_read_string              (CacheReader          *reader,
+                                                 gchar               **value);
+static GimpPlugInDef *
+                 cache_read_plug_in_def         (CacheReader          *reader,
+                                                 Gimp                 *gimp,
+                                                 gboolean             *changed);
+static GimpPlugInProcedure *
+                 cache_read_procedure           (CacheReader          *reader,
+                                                 Gimp                 *gimp,
+                                                 const gchar          *prog);
+static gboolean  cache_read_proc_arg            (CacheReader          *reader,
+                                                 Gimp                 *gimp,
+                                                 GimpProcedure        *procedure,
+                                                 gboolean              return_value);
+
+static void      cache_write_uint32             (GByteArray           *array,
+                                                 guint32               value);
+static void      cache_write_int32              (GByteArray           *array,
+                                                 gint32                value);
+static void      cache_write_int64              (GByteArray           *array,
+                                                 gint64                value);
+static void      cache_write_string             (GByteArray           *array,
+                                                 const gchar          *value);
+static void      cache_write_plug_in_def        (GByteArray           *array,
+                                                 GimpPlugInDef        *plug_in_def);
+static void      cache_write_procedure          (GByteArray           *array,
+                                                 GimpPlugInProcedure  *proc);
+static void      cache_write_proc_arg           (GByteArray           *array,
+                                                 GParamSpec           *pspec);
+
+
+/*  public functions  */
+
+/*  returns the modification times of @dirs, or -1 for directories
+ *  that can't be accessed
+ */
+gint64 *
+plug_in_rc_cache_get_dir_mtimes (GList *dirs)
+{
+  gint64 *mtimes;
+  GList  *list;
+  gint    i;
+
+  mtimes = g_new (gint64, MAX (1, g_list_length (dirs)));
+
+  for (list = dirs, i = 0; list; list = g_list_next (list), i++)
+    {
+      if (! plug_in_rc_cache_get_stamp (list->data, &mtimes[i], NULL))
+        mtimes[i] = -1;
+    }
+
+  return mtimes;
+}
+
+/*  reads the plug-in defs from the cache in @filename. *@up_to_date
+ *  is set when neither the plug-in directories nor any of the
+ *  executables changed since the cache was written, so the returned
+ *  plug-in defs are complete.
+ */
+GSList *
+plug_in_rc_cache_read (Gimp          *gimp,
+                       const gchar   *filename,
+                       const gchar   *pluginrc,
+                       GList         *dirs,
+                       const gint64  *dir_mtimes,
+                       gboolean      *up_to_date,
+                       GError       **error)
+{
+  GMappedFile *mapped;
+  CacheReader  reader;
+  GSList      *plug_in_defs = NULL;
+  gchar        magic[sizeof (PLUG_IN_RC_CACHE_MAGIC)];
+  guint32      byte_order;
+  guint32      version;
+  guint32      protocol_version;
+  guint32      n_dirs;
+  guint32      n_defs;
+  gint64       length;
+  gint64       rc_mtime;
+  gint64       rc_size;
+  gint64       mtime;
+  gint64       size;
+  gboolean     dirs_match;
+  GList       *list;
+  guint32      i;
+
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), NULL);
+  g_return_val_if_fail (filename != NULL, NULL);
+  g_return_val_if_fail (pluginrc != NULL, NULL);
+  g_return_val_if_fail (up_to_date != NULL, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  *up_to_date = FALSE;
+
+  mapped = g_mapped_file_new (filename, FALSE, NULL);
+
+  if (! mapped)
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_OPEN_ENOENT,
+                   _("Could not open '%s' for reading"),
+                   gimp_filename_to_utf8 (filename));
+      return NULL;
+    }
+
+  reader.data   = (const guchar *) g_mapped_file_get_contents (mapped);
+  reader.length = g_mapped_file_get_length (mapped);
+  reader.offset = 0;
+
+  if (! cache_read_bytes (&reader, magic, sizeof (magic))          ||
+      memcmp (magic, PLUG_IN_RC_CACHE_MAGIC, sizeof (magic))       ||
+      ! cache_read_uint32 (&reader, &byte_order)                   ||
+      byte_order != PLUG_IN_RC_CACHE_BYTE_ORDER                    ||
+      ! cache_read_uint32 (&reader, &version)                      ||
+      version != PLUG_IN_RC_CACHE_VERSION                          ||
+      ! cache_read_uint32 (&reader, &protocol_version)             ||
+      protocol_version != GIMP_PROTOCOL_VERSION)
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_VERSION,
+                   _("Skipping '%s': wrong pluginrc file format version."),
+                   gimp_filename_to_utf8 (filename));
+      goto error;
+    }
+
+  if (! cache_read_int64 (&reader, &length)   ||
+      length != (gint64) reader.length          ||
+      ! cache_read_int64 (&reader, &rc_mtime)   ||
+      ! cache_read_int64 (&reader, &rc_size)    ||
+      ! cache_read_uint32 (&reader, &n_dirs))
+    goto parse_error;
+
+  /*  the cache is only valid for the pluginrc it was written with  */
+  if (! plug_in_rc_cache_get_stamp (pluginrc, &mtime, &size) ||
+      mtime != rc_mtime || size != rc_size)
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_VERSION,
+                   _("Skipping '%s': it doesn't match '%s'."),
+                   gimp_filename_to_utf8 (filename),
+                   gimp_filename_to_utf8 (pluginrc));
+      goto error;
+    }
+
+  dirs_match = (n_dirs == g_list_length (dirs));
+
+  for (i = 0, list = dirs; i < n_dirs; i++)
+    {
+      gchar  *dirname;
+      gint64  dir_mtime;
+
+      if (! cache_read_string (&reader, &dirname) ||
+          ! cache_read_int64 (&reader, &dir_mtime))
+        {
+          g_free (dirname);
+          goto parse_error;
+        }
+
+      if (dirs_match)
+        {
+          dirs_match = (dirname                        &&
+                        ! strcmp (dirname, list->data) &&
+                        dir_mtime != -1                &&
+                        dir_mtime == dir_mtimes[i]);
+
+          list = g_list_next (list);
+        }
+
+      g_free (dirname);
+    }
+
+  if (! cache_read_uint32 (&reader, &n_defs))
+    goto parse_error;
+
+  for (i = 0; i < n_defs; i++)
+    {
+      GimpPlugInDef *plug_in_def;
+      gboolean       changed;
+
+      plug_in_def = cache_read_plug_in_def (&reader, gimp, &changed);
+
+      if (! plug_in_def)
+        goto parse_error;
+
+      if (changed)
+        dirs_match = FALSE;
+
+      plug_in_defs = g_slist_prepend (plug_in_defs, plug_in_def);
+    }
+
+  if (reader.offset != reader.length)
+    goto parse_error;
+
+  g_mapped_file_unref (mapped);
+
+  *up_to_date = dirs_match;
+
+  return g_slist_reverse (plug_in_defs);
+
+ parse_error:
+  g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_PARSE,
+               _("Error while parsing '%s'"),
+               gimp_filename_to_utf8 (filename));
+
+ error:
+  g_slist_free_full (plug_in_defs, (GDestroyNotify) g_object_unref);
+  g_mapped_file_unref (mapped);
+
+  return NULL;
+}
+
+gboolean
+plug_in_rc_cache_write (GSList        *plug_in_defs,
+                        const gchar   *filename,
+                        const gchar   *pluginrc,
+                        GList         *dirs,
+                        const gint64  *dir_mtimes,
+                        GError       **error)
+{
+  GByteArray *array;
+  GSList     *list;
+  GList      *dir;
+  gint64      rc_mtime;
+  gint64      rc_size;
+  gint64      length;
+  gsize       length_offset;
+  gboolean    success;
+  gint        i;
+
+  g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (pluginrc != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (! plug_in_rc_cache_get_stamp (pluginrc, &rc_mtime, &rc_size))
+    {
+      g_set_error (error, GIMP_CONFIG_ERROR, GIMP_CONFIG_ERROR_OPEN,
+                   _("Could not open '%s' for reading: %s"),
+                   gimp_filename_to_utf8 (pluginrc), g_strerror (errno));
+      return FALSE;
+    }
+
+  array = g_byte_array_new ();
+
+  g_byte_array_append (array,
+                       (const guint8 *) PLUG_IN_RC_CACHE_MAGIC,
+                       sizeof (PLUG_IN_RC_CACHE_MAGIC));
+  cache_write_uint32 (array, PLUG_IN_RC_CACHE_BYTE_ORDER);
+  cache_write_uint32 (array, PLUG_IN_RC_CACHE_VERSION);
+  cache_write_uint32 (array, GIMP_PROTOCOL_VERSION);
+
+  /*  filled in below  */
+  length_offset = array->len;
+  cache_write_int64 (array, 0);
+
+  cache_write_int64 (array, rc_mtime);
+  cache_write_int64 (array, rc_size);
+
+  cache_write_uint32 (array, g_list_length (dirs));
+
+  for (dir = dirs, i = 0; dir; dir = g_list_next (dir), i++)
+    {
+      cache_write_string (array, dir->data);
+      cache_write_int64 (array, dir_mtimes[i]);
+    }
+
+  cache_write_uint32 (array, g_slist_length (plug_in_defs));
+
+  for (list = plug_in_defs; list; list = g_slist_next (list))
+    cache_write_plug_in_def (array, list->data);
+
+  length = array->len;
+  memcpy (array->data + length_offset, &length, sizeof (length));
+
+  success = g_file_set_contents (filename,
+                                 (const gchar *) array->data, array->len,
+                                 error);
+
+  g_byte_array_free (array, TRUE);
+
+  return success;
+}
+
+
+/*  private functions  */
+
+static gboolean
+plug_in_rc_cache_get_stamp (const gchar *filename,
+                            gint64      *mtime,
+                            gint64      *size)
+{
+  GStatBuf st;
+
+  if (g_stat (filename, &st) != 0)
+    return FALSE;
+
+  if (mtime)
+    *mtime = st.st_mtime;
+
+  if (size)
+    *size = st.st_size;
+
+  return TRUE;
+}
+
+
+/*  reading  */
+
+static gboolean
+cache_read_bytes (CacheReader *reader,
+                  gpointer     dest,
+                  gsize        n_bytes)
+{
+  if (reader->length - reader->offset < n_bytes)
+    return FALSE;
+
+  if (dest)
+    memcpy (dest, reader->data + reader->offset, n_bytes);
+
+  reader->offset += n_bytes;
+
+  return TRUE;
+}
+
+static gboolean
+cache_read_uint32 (CacheReader *reader,
+                   guint32     *value)
+{
+  return cache_read_bytes (reader, value, sizeof (guint32));
+}
+
+static gboolean
+cache_read_int32 (CacheReader *reader,
+                  gint32      *value)
+{
+  return cache_read_bytes (reader, value, sizeof (gint32));
+}
+
+static gboolean
+cache_read_int64 (CacheReader *reader,
+                  gint64      *value)
+{
+  return cache_read_bytes (reader, value, sizeof (gint64));
+}
+
+static gboolean
+cache_read_string (CacheReader  *reader,
+                   gchar       **value)
+{
+  guint32 length;
+
+  *value = NULL;
+
+  if (! cache_read_uint32 (reader, &length))
+    return FALSE;
+
+  if (length == NULL_STRING)
+    return TRUE;
+
+  if (reader->length - reader->offset < length)
+    return FALSE;
+
+  *value = g_strndup ((const gchar *) reader->data + reader->offset, length);
+
+  reader->offset += length;
+
+  return TRUE;
+}
+
+static GimpPlugInDef *
+cache_read_plug_in_def (CacheReader *reader,
+                        Gimp        *gimp,
+                        gboolean    *changed)
+{
+  GimpPlugInDef *plug_in_def;
+  gchar         *prog;
+  gchar         *domain_name;
+  gchar         *domain_path;
+  gint64         mtime;
+  gint64         size;
+  gint64         file_mtime;
+  gint64         file_size;
+  guint32        flags;
+  guint32        n_procedures;
+  guint32        i;
+
+  if (! cache_read_string (reader, &prog) || ! prog)
+    return NULL;
+
+  plug_in_def = gimp_plug_in_def_new (prog);
+  g_free (prog);
+
+  if (! cache_read_int64 (reader, &mtime) ||
+      ! cache_read_int64 (reader, &size)  ||
+      ! cache_read_uint32 (reader, &flags))
+    goto error;
+
+  plug_in_def->mtime = mtime;
+
+  /*  one stat per executable, still a lot cheaper than scanning the
+   *  directories
+   */
+  *changed = (! plug_in_rc_cache_get_stamp (plug_in_def->prog,
+                                            &file_mtime, &file_size) ||
+              file_mtime != mtime                                  ||
+              file_size  != size);
+
+  /*  don't let the search reuse the entry of a changed executable,
+   *  even if only its size changed
+   */
+  if (*changed)
+    plug_in_def->mtime = 0;
+
+  if (flags & DEF_HAS_INIT)
+    gimp_plug_in_def_set_has_init (plug_in_def, TRUE);
+
+  if (! cache_read_string (reader, &domain_name))
+    goto error;
+
+  if (! cache_read_string (reader, &domain_path))
+    {
+      g_free (domain_name);
+      goto error;
+    }
+
+  if (domain_name)
+    gimp_plug_in_def_set_locale_domain (plug_in_def, domain_name, domain_path);
+
+  g_free (domain_name);
+  g_free (domain_path);
+
+  if (! cache_read_string (reader, &domain_name))
+    goto error;
+
+  if (! cache_read_string (reader, &domain_path))
+    {
+      g_free (domain_name);
+      goto error;
+    }
+
+  if (domain_name)
+    gimp_plug_in_def_set_help_domain (plug_in_def, domain_name, domain_path);
+
+  g_free (domain_name);
+  g_free (domain_path);
+
+  if (! cache_read_uint32 (reader, &n_procedures))
+    goto error;
+
+  for (i = 0; i < n_procedures; i++)
+    {
+      GimpPlugInProcedure *proc;
+
+      proc = cache_read_procedure (reader, gimp, plug_in_def->prog);
+
+      if (! proc)
+        goto error;
+
+      gimp_plug_in_def_add_procedure (plug_in_def, proc);
+      g_object_unref (proc);
+    }
+
+  return plug_in_def;
+
+ error:
+  g_object_unref (plug_in_def);
+
+  return NULL;
+}
+
+static GimpPlugInProcedure *
+cache_read_procedure (CacheReader *reader,
+                      Gimp        *gimp,
+                      const gchar *prog)
+{
+  GimpProcedure       *procedure;
+  GimpPlugInProcedure *proc;
+  gchar               *name;
+  gchar               *str;
+  gint32               proc_type;
+  gint32               icon_type;
+  gint32               icon_data_length;
+  guint32              flags;
+  guint32              n_menu_paths;
+  guint32              n_args;
+  guint32              n_return_vals;
+  guint32              i;
+
+  if (! cache_read_string (reader, &name) || ! name)
+    return NULL;
+
+  if (! cache_read_int32 (reader, &proc_type) ||
+      (proc_type != GIMP_PLUGIN && proc_type != GIMP_EXTENSION))
+    {
+      g_free (name);
+      return NULL;
+    }
+
+  procedure = gimp_plug_in_procedure_new (proc_type, prog);
+  proc      = GIMP_PLUG_IN_PROCEDURE (procedure);
+
+  gimp_object_take_name (GIMP_OBJECT (procedure),
+                         gimp_canonicalize_identifier (name));
+
+  procedure->original_name = name;
+
+  if (! cache_read_string (reader, &procedure->blurb)     ||
+      ! cache_read_string (reader, &procedure->help)      ||
+      ! cache_read_string (reader, &procedure->author)    ||
+      ! cache_read_string (reader, &procedure->copyright) ||
+      ! cache_read_string (reader, &procedure->date)      ||
+      ! cache_read_string (reader, &proc->menu_label)     ||
+      ! cache_read_uint32 (reader, &n_menu_paths))
+    goto error;
+
+  for (i = 0; i < n_menu_paths; i++)
+    {
+      if (! cache_read_string (reader, &str) || ! str)
+        goto error;
+
+      proc->menu_paths = g_list_prepend (proc->menu_paths, str);
+    }
+
+  proc->menu_paths = g_list_reverse (proc->menu_paths);
+
+  if (! cache_read_int32 (reader, &icon_type) ||
+      ! cache_read_int32 (reader, &icon_data_length))
+    goto error;
+
+  switch (icon_type)
+    {
+    case GIMP_ICON_TYPE_STOCK_ID:
+    case GIMP_ICON_TYPE_IMAGE_FILE:
+      if (! cache_read_string (reader, &str))
+        goto error;
+
+      proc->icon_data_length = -1;
+      proc->icon_data        = (guint8 *) str;
+      break;
+
+    case GIMP_ICON_TYPE_INLINE_PIXBUF:
+      if (icon_data_length < 0 ||
+          reader->length - reader->offset < (gsize) icon_data_length)
+        goto error;
+
+      proc->icon_data_length = icon_data_length;
+      proc->icon_data        = g_memdup (reader->data + reader->offset,
+                                         icon_data_length);
+
+      reader->offset += icon_data_length;
+      break;
+
+    default:
+      goto error;
+    }
+
+  proc->icon_type = icon_type;
+
+  if (! cache_read_uint32 (reader, &flags))
+    goto error;
+
+  if (flags & PROC_FILE_PROC)
+    {
+      proc->file_proc = TRUE;
+
+      if (! cache_read_string (reader, &proc->extensions) ||
+          ! cache_read_string (reader, &proc->prefixes)   ||
+          ! cache_read_string (reader, &proc->magics))
+        goto error;
+
+      if (! cache_read_string (reader, &str))
+        goto error;
+
+      if (str)
+        gimp_plug_in_procedure_set_mime_type (proc, str);
+      g_free (str);
+
+      if (! cache_read_string (reader, &str))
+        goto error;
+
+      if (str)
+        gimp_plug_in_procedure_set_thumb_loader (proc, str);
+      g_free (str);
+
+      if (flags & PROC_HANDLES_URI)
+        gimp_plug_in_procedure_set_handles_uri (proc);
+    }
+
+  if (! cache_read_string (reader, &str))
+    goto error;
+
+  gimp_plug_in_procedure_set_image_types (proc, str);
+  g_free (str);
+
+  if (! cache_read_uint32 (reader, &n_args) ||
+      ! cache_read_uint32 (reader, &n_return_vals))
+    goto error;
+
+  for (i = 0; i < n_args; i++)
+    if (! cache_read_proc_arg (reader, gimp, procedure, FALSE))
+      goto error;
+
+  for (i = 0; i < n_return_vals; i++)
+    if (! cache_read_proc_arg (reader, gimp, procedure, TRUE))
+      goto error;
+
+  return proc;
+
+ error:
+  g_object_unref (procedure);
+
+  return NULL;
+}
+
+static gboolean
+cache_read_proc_arg (CacheReader   *reader,
+                     Gimp          *gimp,
+                     GimpProcedure *procedure,
+                     gboolean       return_value)
+{
+  GParamSpec *pspec;
+  gint32      arg_type;
+  gchar      *name = NULL;
+  gchar      *desc = NULL;
+
+  if (! cache_read_int32 (reader, &arg_type) ||
+      ! cache_read_string (reader, &name)    || ! name ||
+      ! cache_read_string (reader, &desc))
+    {
+      g_free (name);
+      return FALSE;
+    }
+
+  pspec = gimp_pdb_compat_param_spec (gimp, arg_type, name, desc);
+
+  if (return_value)
+    gimp_procedure_add_return_value (procedure, pspec);
+  else
+    gimp_procedure_add_argument (procedure, pspec);
+
+  g_free (name);
+  g_free (desc);
+
+  return TRUE;
+}
+
+
+/*  writing  */
+
+static void
+cache_write_uint32 (GByteArray *array,
+                    guint32     value)
+{
+  g_byte_array_append (array, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+cache_write_int32 (GByteArray *array,
+                   gint32      value)
+{
+  g_byte_array_append (array, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+cache_write_int64 (GByteArray *array,
+                   gint64      value)
+{
+  g_byte_array_append (array, (const guint8 *) &value, sizeof (value));
+}
+
+static void
+cache_write_string (GByteArray  *array,
+                    const gchar *value)
+{
+  if (value)
+    {
+      guint32 length = strlen (value);
+
+      cache_write_uint32 (array, length);
+      g_byte_array_append (array, (const guint8 *) value, length);
+    }
+  else
+    {
+      cache_write_uint32 (array, NULL_STRING);
+    }
+}
+
+static void
+cache_write_plug_in_def (GByteArray    *array,
+                         GimpPlugInDef *plug_in_def)
+{
+  GSList *list;
+  guint32 n_procedures = 0;
+  gint64  mtime;
+  gint64  size;
+
+  for (list = plug_in_def->procedures; list; list = g_slist_next (list))
+    {
+      GimpPlugInProcedure *proc = list->data;
+
+      if (! proc->installed_during_init)
+        n_procedures++;
+    }
+
+  /*  if the executable changed since it was queried, record a size
+   *  that never matches, so it is queried again next time
+   */
+  if (! plug_in_rc_cache_get_stamp (plug_in_def->prog, &mtime, &size) ||
+      mtime != plug_in_def->mtime)
+    size = -1;
+
+  /*  unlike pluginrc, the cache also lists executables that didn't
+   *  install any procedures, so they are not queried at every start
+   */
+  cache_write_string (array, plug_in_def->prog);
+  cache_write_int64  (array, plug_in_def->mtime);
+  cache_write_int64  (array, size);
+  cache_write_uint32 (array, plug_in_def->has_init ? DEF_HAS_INIT : 0);
+
+  cache_write_string (array, plug_in_def->locale_domain_name);
+  cache_write_string (array, plug_in_def->locale_domain_path);
+  cache_write_string (array, plug_in_def->help_domain_name);
+  cache_write_string (array, plug_in_def->help_domain_uri);
+
+  cache_write_uint32 (array, n_procedures);
+
+  for (list = plug_in_def->procedures; list; list = g_slist_next (list))
+    {
+      GimpPlugInProcedure *proc = list->data;
+
+      if (! proc->installed_during_init)
+        cache_write_procedure (array, proc);
+    }
+}
+
+static void
+cache_write_procedure (GByteArray          *array,
+                       GimpPlugInProcedure *proc)
+{
+  GimpProcedure *procedure = GIMP_PROCEDURE (proc);
+  GList         *list;
+  guint32        flags     = 0;
+  gint           i;
+
+  cache_write_string (array, procedure->original_name);
+  cache_write_int32  (array, procedure->proc_type);
+  cache_write_string (array, procedure->blurb);
+  cache_write_string (array, procedure->help);
+  cache_write_string (array, procedure->author);
+  cache_write_string (array, procedure->copyright);
+  cache_write_string (array, procedure->date);
+  cache_write_string (array, proc->menu_label);
+
+  cache_write_uint32 (array, g_list_length (proc->menu_paths));
+
+  for (list = proc->menu_paths; list; list = g_list_next (list))
+    cache_write_string (array, list->data);
+
+  cache_write_int32 (array, proc->icon_type);
+  cache_write_int32 (array, proc->icon_data_length);
+
+  switch (proc->icon_type)
+    {
+    case GIMP_ICON_TYPE_STOCK_ID:
+    case GIMP_ICON_TYPE_IMAGE_FILE:
+      cache_write_string (array, (const gchar *) proc->icon_data);
+      break;
+
+    case GIMP_ICON_TYPE_INLINE_PIXBUF:
+      g_byte_array_append (array, proc->icon_data, proc->icon_data_length);
+      break;
+    }
+
+  if (proc->file_proc)
+    flags |= PROC_FILE_PROC;
+
+  if (proc->handles_uri)
+    flags |= PROC_HANDLES_URI;
+
+  cache_write_uint32 (array, flags);
+
+  if (proc->file_proc)
+    {
+      cache_write_string (array, proc->extensions);
+      cache_write_string (array, proc->prefixes);
+      cache_write_string (array, proc->magics);
+      cache_write_string (array, proc->mime_type);
+      cache_write_string (array, proc->thumb_loader);
+    }
+
+  cache_write_string (array, proc->image_types);
+
+  cache_write_uint32 (array, procedure->num_args);
+  cache_write_uint32 (array, procedure->num_values);
+
+  for (i = 0; i < procedure->num_args; i++)
+    cache_write_proc_arg (array, procedure->args[i]);
+
+  for (i = 0; i < procedure->num_values; i++)
+    cache_write_proc_arg (array, procedure->values[i]);
+}
+
+static void
+cache_write_proc_arg (GByteArray *array,
+                      GParamSpec *pspec)
+{
+  cache_write_int32  (array,
+                      gimp_pdb_compat_arg_type_from_gtype (G_PARAM_SPEC_VALUE_TYPE (pspec)));
+  cache_write_string (array, g_param_spec_get_name (pspec));
+  cache_write_string (array, g_param_spec_get_blurb (pspec));
+}
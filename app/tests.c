@@ -36,6 +36,7 @@
 
 #include "core/gimp.h"
 #include "core/gimp-contexts.h"
+#include "core/gimp-parallel.h"
 
 #include "gegl/gimp-gegl.h"
 
@@ -73,6 +74,7 @@ gimp_init_for_testing (void)
   gimp_load_config (gimp, NULL, NULL);
 
   gimp_gegl_init (gimp);
+  gimp_parallel_init (gimp);
   gimp_initialize (gimp, gimp_status_func_dummy);
   gimp_restore (gimp, gimp_status_func_dummy);
 
@@ -104,6 +106,7 @@ gimp_init_for_gui_testing_internal (gboolean     show_gui,
   units_init (gimp);
   gimp_load_config (gimp, gimprc, NULL);
   gimp_gegl_init (gimp);
+  gimp_parallel_init (gimp);
   gui_init (gimp, TRUE);
   gimp_initialize (gimp, gimp_status_func_dummy);
   gimp_restore (gimp, gimp_status_func_dummy);
@@ -0,0 +1,755 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+
+#include <gegl.h>
+
+#include <gtk/gtk.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "paint/paint-types.h"
+
+#include "core/gimp.h"
+#include "core/gimpchannel.h"
+#include "core/gimpchannel-select.h"
+#include "core/gimpcontainer.h"
+#include "core/gimpcontext.h"
+#include "core/gimpdrawable.h"
+#include "core/gimpdrawable-operation.h"
+#include "core/gimpimage.h"
+#include "core/gimpimage-convert-type.h"
+#include "core/gimpimage-duplicate.h"
+#include "core/gimplayer.h"
+#include "core/gimppaintinfo.h"
+#include "core/gimppickable.h"
+#include "core/gimpprojection.h"
+
+#include "paint/gimppaintcore.h"
+#include "paint/gimppaintcore-replay.h"
+#include "paint/gimppaintoptions.h"
+
+#include "file/file-open.h"
+#include "file/file-procedure.h"
+#include "file/file-save.h"
+
+#include "plug-in/gimppluginmanager.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+/*  Benchmarks of the core pipelines on synthetic images.  The content
+ *  of the images only depends on their size, so runs of different
+ *  GIMP, GEGL or babl versions can be compared.
+ *
+ *  Usage: bench-core [--size=N] [--iterations=N] [--stroke=FILE]
+ *                    [--output=FILE]
+ *
+ *  --stroke replays a stroke recorded with GIMP_RECORD_STROKES
+ *  instead of the built-in one.
+ */
+
+
+#define BENCH_N_LAYERS 8
+
+
+typedef void (* BenchFunc) (Gimp      *gimp,
+                            GimpImage *image,
+                            gpointer   data);
+
+typedef struct
+{
+  gchar   *name;
+  gint     n_runs;
+  gdouble  min;
+  gdouble  max;
+  gdouble  total;
+  gchar   *extra;  /*  more JSON members, or NULL  */
+} BenchResult;
+
+typedef struct
+{
+  const gchar          *src_format;
+  const gchar          *dest_format;
+  const Babl           *fish;
+  gpointer              src;
+  gpointer              dest;
+} BenchConversion;
+
+typedef struct
+{
+  GimpPaintEvent       *events;
+  gint                  n_events;
+  GimpPaintReplayStats  stats;
+} BenchStroke;
+
+
+static gint     bench_size       = 2048;
+static gint     bench_iterations = 3;
+static gchar   *bench_output     = NULL;
+static gchar   *bench_stroke     = NULL;
+
+static GList   *bench_results    = NULL;
+
+/*  the conversions gimp-babl.c has fast paths for  */
+static BenchConversion bench_conversions[] =
+{
+  { "R'G'B'A u8",    "RGBA float"   },
+  { "R'G'B' u8",     "RGBA float"   },
+  { "R'G'B'A u16",   "RGBA float"   },
+  { "R'G'B' u16",    "RGBA float"   },
+  { "R'G'B'A half",  "RGBA float"   },
+  { "R'G'B' half",   "RGBA float"   },
+  { "Y' u8",         "RGBA float"   },
+  { "R'G'B'A float", "cairo-ARGB32" }
+};
+
+static const GOptionEntry bench_options[] =
+{
+  { "size", 0, 0, G_OPTION_ARG_INT, &bench_size,
+    "Width and height of the synthetic images", "N" },
+  { "iterations", 0, 0, G_OPTION_ARG_INT, &bench_iterations,
+    "Number of runs of each benchmark", "N" },
+  { "stroke", 0, 0, G_OPTION_ARG_FILENAME, &bench_stroke,
+    "Replay the stroke recorded in FILE", "FILE" },
+  { "output", 0, 0, G_OPTION_ARG_FILENAME, &bench_output,
+    "Write the timings as JSON to FILE instead of stdout", "FILE" },
+  { NULL }
+};
+
+
+/**
+ * bench_fill:
+ * @drawable: the drawable to fill
+ * @seed:     a number to vary the content between drawables
+ *
+ * Fills @drawable with smooth waves plus a little noise, so that
+ * fuzzy select finds regions of a sensible size and indexed
+ * conversion has something to dither.
+ **/
+static void
+bench_fill (GimpDrawable *drawable,
+            gint          seed)
+{
+  GeglBuffer         *buffer = gimp_drawable_get_buffer (drawable);
+  GeglBufferIterator *iter;
+  GRand              *rand   = g_rand_new_with_seed (seed);
+
+  iter = gegl_buffer_iterator_new (buffer, NULL, 0,
+                                   babl_format ("R'G'B'A u8"),
+                                   GEGL_ACCESS_WRITE, GEGL_ABYSS_NONE);
+
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const GeglRectangle *roi  = &iter->roi[0];
+      guchar              *data = iter->data[0];
+      gint                 x, y;
+
+      for (y = roi->y; y < roi->y + roi->height; y++)
+        for (x = roi->x; x < roi->x + roi->width; x++)
+          {
+            gdouble wave = (sin ((x + seed * 31) / 97.0) *
+                            cos ((y + seed * 17) / 89.0));
+            gint    i;
+
+            for (i = 0; i < 3; i++)
+              {
+                gint value = (128 + 100 * wave * (i + 1) / 3.0 +
+                              g_rand_int_range (rand, -8, 8));
+
+                *data++ = CLAMP (value, 0, 255);
+              }
+
+            *data++ = 255 - (seed * 16) % 128;
+          }
+    }
+
+  g_rand_free (rand);
+
+  gimp_drawable_update (drawable, 0, 0,
+                        gimp_item_get_width  (GIMP_ITEM (drawable)),
+                        gimp_item_get_height (GIMP_ITEM (drawable)));
+}
+
+static GimpImage *
+bench_create_image (Gimp *gimp,
+                    gint  n_layers)
+{
+  GimpImage *image;
+  gint       i;
+
+  image = gimp_image_new (gimp, bench_size, bench_size,
+                          GIMP_RGB, GIMP_PRECISION_U8_GAMMA);
+
+  gimp_image_undo_disable (image);
+
+  for (i = 0; i < n_layers; i++)
+    {
+      GimpLayer *layer;
+      gchar     *name = g_strdup_printf ("layer%d", i);
+
+      layer = gimp_layer_new (image, bench_size, bench_size,
+                              babl_format ("R'G'B'A u8"),
+                              name, 0.8, GIMP_NORMAL_MODE);
+      g_free (name);
+
+      gimp_image_add_layer (image, layer, NULL, 0, FALSE);
+
+      bench_fill (GIMP_DRAWABLE (layer), i);
+    }
+
+  return image;
+}
+
+/*  makes the projection re-render everything at the next read  */
+static void
+bench_invalidate (GimpImage *image)
+{
+  gimp_image_invalidate (image, 0, 0,
+                         gimp_image_get_width  (image),
+                         gimp_image_get_height (image));
+
+  gimp_projection_flush_now (gimp_image_get_projection (image));
+}
+
+static void
+bench_render (GimpImage *image,
+              gdouble    scale)
+{
+  GimpPickable  *pickable = GIMP_PICKABLE (gimp_image_get_projection (image));
+  GeglRectangle  rect;
+  guchar        *data;
+
+  rect.x      = 0;
+  rect.y      = 0;
+  rect.width  = ceil (gimp_image_get_width  (image) * scale);
+  rect.height = ceil (gimp_image_get_height (image) * scale);
+
+  data = g_malloc ((gsize) rect.width * rect.height * 4);
+
+  gegl_buffer_get (gimp_pickable_get_buffer (pickable), &rect, scale,
+                   babl_format ("R'G'B'A u8"), data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  g_free (data);
+}
+
+static BenchResult *
+bench_run (const gchar *name,
+           Gimp        *gimp,
+           GimpImage   *image,
+           BenchFunc    setup,
+           BenchFunc    func,
+           gpointer     data)
+{
+  BenchResult *result = g_slice_new0 (BenchResult);
+  GTimer      *timer  = g_timer_new ();
+  gint         i;
+
+  result->name = g_strdup (name);
+  result->min  = G_MAXDOUBLE;
+
+  for (i = 0; i < bench_iterations; i++)
+    {
+      gdouble elapsed;
+
+      if (setup)
+        setup (gimp, image, data);
+
+      g_timer_start (timer);
+      func (gimp, image, data);
+      elapsed = g_timer_elapsed (timer, NULL);
+
+      result->n_runs++;
+      result->total += elapsed;
+      result->min    = MIN (result->min, elapsed);
+      result->max    = MAX (result->max, elapsed);
+    }
+
+  g_timer_destroy (timer);
+
+  g_printerr ("%-40s %10.4f s\n", name, result->min);
+
+  bench_results = g_list_append (bench_results, result);
+
+  return result;
+}
+
+
+/*  the benchmarks  */
+
+static void
+bench_projection_setup (Gimp      *gimp,
+                        GimpImage *image,
+                        gpointer   data)
+{
+  bench_invalidate (image);
+}
+
+static void
+bench_projection (Gimp      *gimp,
+                  GimpImage *image,
+                  gpointer   data)
+{
+  bench_render (image, *(gdouble *) data);
+}
+
+static void
+bench_layer_mode_setup (Gimp      *gimp,
+                        GimpImage *image,
+                        gpointer   data)
+{
+  GimpLayer *layer = gimp_image_get_layer_iter (image)->data;
+
+  gimp_layer_set_mode (layer, GPOINTER_TO_INT (data), FALSE);
+
+  bench_invalidate (image);
+}
+
+static void
+bench_layer_mode (Gimp      *gimp,
+                  GimpImage *image,
+                  gpointer   data)
+{
+  bench_render (image, 1.0);
+}
+
+static void
+bench_get_stroke (BenchStroke *stroke)
+{
+  gint i;
+
+  if (bench_stroke)
+    {
+      GError *error = NULL;
+
+      stroke->events = gimp_paint_events_load (bench_stroke,
+                                               &stroke->n_events, &error);
+
+      if (! stroke->events)
+        g_error ("%s", error->message);
+
+      return;
+    }
+
+  /*  a spiral across most of the image, getting faster and harder  */
+  stroke->n_events = 2000;
+  stroke->events   = g_new (GimpPaintEvent, stroke->n_events);
+
+  for (i = 0; i < stroke->n_events; i++)
+    {
+      static const GimpCoords  default_coords = GIMP_COORDS_DEFAULT_VALUES;
+      GimpPaintEvent          *event          = &stroke->events[i];
+      gdouble                  t              = i / (gdouble) stroke->n_events;
+      gdouble                  radius         = 0.45 * bench_size * t;
+
+      event->coords          = default_coords;
+      event->coords.x        = bench_size / 2 + radius * cos (t * 6 * G_PI);
+      event->coords.y        = bench_size / 2 + radius * sin (t * 6 * G_PI);
+      event->coords.pressure = 0.2 + 0.8 * t;
+      event->time            = i * 8;
+    }
+}
+
+static void
+bench_paintbrush (Gimp      *gimp,
+                  GimpImage *image,
+                  gpointer   data)
+{
+  BenchStroke      *stroke  = data;
+  GimpContext      *context = gimp_get_user_context (gimp);
+  GimpPaintInfo    *paint_info;
+  GimpPaintOptions *options;
+  GimpPaintCore    *core;
+
+  paint_info = (GimpPaintInfo *)
+    gimp_container_get_child_by_name (gimp->paint_info_list,
+                                      "gimp-paintbrush");
+
+  options = gimp_paint_options_new (paint_info);
+
+  gimp_context_define_properties (GIMP_CONTEXT (options),
+                                  GIMP_CONTEXT_PAINT_PROPS_MASK,
+                                  FALSE);
+  gimp_context_set_parent (GIMP_CONTEXT (options), context);
+
+  core = g_object_new (paint_info->paint_type, NULL);
+
+  gimp_paint_core_replay (core, gimp_image_get_active_drawable (image),
+                          options, stroke->events, stroke->n_events,
+                          FALSE, &stroke->stats, NULL);
+
+  g_object_unref (core);
+  g_object_unref (options);
+}
+
+static void
+bench_xcf_save (Gimp      *gimp,
+                GimpImage *image,
+                gpointer   data)
+{
+  const gchar         *uri = data;
+  GimpPlugInProcedure *proc;
+
+  proc = file_procedure_find (gimp->plug_in_manager->save_procs, uri, NULL);
+
+  file_save (gimp, image, NULL, uri, proc, GIMP_RUN_NONINTERACTIVE,
+             FALSE, FALSE, FALSE, NULL);
+}
+
+static void
+bench_xcf_load (Gimp      *gimp,
+                GimpImage *image,
+                gpointer   data)
+{
+  const gchar         *uri = data;
+  GimpPlugInProcedure *proc;
+  GimpImage           *loaded;
+  GimpPDBStatusType    status;
+
+  proc = file_procedure_find (gimp->plug_in_manager->load_procs, uri, NULL);
+
+  loaded = file_open_image (gimp, gimp_get_user_context (gimp), NULL,
+                            uri, uri, FALSE, proc, GIMP_RUN_NONINTERACTIVE,
+                            &status, NULL, NULL);
+
+  if (loaded)
+    g_object_unref (loaded);
+}
+
+static void
+bench_gaussian_blur (Gimp      *gimp,
+                     GimpImage *image,
+                     gpointer   data)
+{
+  GeglNode *node;
+
+  node = gegl_node_new_child (NULL,
+                              "operation", "gegl:gaussian-blur",
+                              "std-dev-x", 10.0,
+                              "std-dev-y", 10.0,
+                              NULL);
+
+  gimp_drawable_apply_operation (gimp_image_get_active_drawable (image),
+                                 NULL, "Gaussian Blur", node);
+
+  g_object_unref (node);
+}
+
+static void
+bench_indexed_setup (Gimp      *gimp,
+                     GimpImage *image,
+                     gpointer   data)
+{
+  GimpImage **copy = data;
+
+  if (*copy)
+    g_object_unref (*copy);
+
+  *copy = gimp_image_duplicate (image);
+}
+
+static void
+bench_indexed (Gimp      *gimp,
+               GimpImage *image,
+               gpointer   data)
+{
+  GimpImage **copy = data;
+
+  gimp_image_convert_type (*copy, GIMP_INDEXED,
+                           256, GIMP_FS_DITHER, FALSE, FALSE, FALSE,
+                           GIMP_MAKE_PALETTE, NULL, NULL, NULL);
+}
+
+static void
+bench_fuzzy_select (Gimp      *gimp,
+                    GimpImage *image,
+                    gpointer   data)
+{
+  gimp_channel_select_fuzzy (gimp_image_get_mask (image),
+                             gimp_image_get_active_drawable (image),
+                             FALSE,
+                             bench_size / 2, bench_size / 2,
+                             0.25, FALSE,
+                             GIMP_SELECT_CRITERION_COMPOSITE,
+                             GIMP_CHANNEL_OP_REPLACE,
+                             TRUE, FALSE, 0.0, 0.0);
+}
+
+static void
+bench_babl_conversion (Gimp      *gimp,
+                       GimpImage *image,
+                       gpointer   data)
+{
+  BenchConversion *conversion = data;
+
+  babl_process (conversion->fish, conversion->src, conversion->dest,
+                (glong) bench_size * bench_size);
+}
+
+static void
+bench_babl_conversions (Gimp *gimp)
+{
+  glong n_pixels = (glong) bench_size * bench_size;
+  gint  i;
+
+  for (i = 0; i < G_N_ELEMENTS (bench_conversions); i++)
+    {
+      BenchConversion *conversion  = &bench_conversions[i];
+      const Babl      *src_format  = babl_format (conversion->src_format);
+      const Babl      *dest_format = babl_format (conversion->dest_format);
+      gint             src_bpp     = babl_format_get_bytes_per_pixel (src_format);
+      gint             dest_bpp    = babl_format_get_bytes_per_pixel (dest_format);
+      BenchResult     *result;
+      gchar           *name;
+      gchar            mps[G_ASCII_DTOSTR_BUF_SIZE];
+      glong            j;
+
+      conversion->fish = babl_fish (src_format, dest_format);
+      conversion->src  = g_malloc (n_pixels * src_bpp);
+      conversion->dest = g_malloc (n_pixels * dest_bpp);
+
+      /*  float input needs values in range, for the integer and half
+       *  formats any bytes will do
+       */
+      if (babl_format_get_type (src_format, 0) == babl_type ("float"))
+        {
+          gfloat *src = conversion->src;
+
+          for (j = 0; j < n_pixels * 4; j++)
+            src[j] = (j % 255) / 255.0;
+        }
+      else
+        {
+          guchar *src = conversion->src;
+
+          for (j = 0; j < n_pixels * src_bpp; j++)
+            src[j] = j * 7;
+        }
+
+      name = g_strdup_printf ("babl-%s-to-%s",
+                              conversion->src_format,
+                              conversion->dest_format);
+
+      result = bench_run (name, gimp, NULL,
+                          NULL, bench_babl_conversion, conversion);
+
+      g_ascii_formatd (mps, sizeof (mps), "%.1f",
+                       n_pixels / result->min / 1000000.0);
+
+      result->extra = g_strdup_printf ("\"megapixels-per-second\": %s", mps);
+
+      g_free (name);
+      g_free (conversion->src);
+      g_free (conversion->dest);
+    }
+}
+
+
+/*  output  */
+
+static void
+bench_write_results (FILE *file)
+{
+  GList *list;
+
+  fprintf (file, "{\n");
+  fprintf (file, "  \"gimp-version\": \"%s\",\n", GIMP_VERSION);
+  fprintf (file, "  \"gegl-version\": \"%d.%d.%d\",\n",
+           GEGL_MAJOR_VERSION, GEGL_MINOR_VERSION, GEGL_MICRO_VERSION);
+  fprintf (file, "  \"size\": %d,\n", bench_size);
+  fprintf (file, "  \"benchmarks\": [\n");
+
+  for (list = bench_results; list; list = g_list_next (list))
+    {
+      BenchResult *result = list->data;
+      gchar        min[G_ASCII_DTOSTR_BUF_SIZE];
+      gchar        mean[G_ASCII_DTOSTR_BUF_SIZE];
+      gchar        max[G_ASCII_DTOSTR_BUF_SIZE];
+
+      /*  JSON wants a '.' whatever the locale  */
+      g_ascii_formatd (min,  sizeof (min),  "%.6f", result->min);
+      g_ascii_formatd (mean, sizeof (mean), "%.6f",
+                       result->total / result->n_runs);
+      g_ascii_formatd (max,  sizeof (max),  "%.6f", result->max);
+
+      fprintf (file,
+               "    { \"name\": \"%s\", \"runs\": %d, "
+               "\"min\": %s, \"mean\": %s, \"max\": %s%s%s }%s\n",
+               result->name, result->n_runs, min, mean, max,
+               result->extra ? ", " : "",
+               result->extra ? result->extra : "",
+               g_list_next (list) ? "," : "");
+    }
+
+  fprintf (file, "  ]\n");
+  fprintf (file, "}\n");
+}
+
+int
+main (int    argc,
+      char **argv)
+{
+  GOptionContext *context;
+  GError         *error = NULL;
+  Gimp           *gimp;
+  GimpImage      *image;
+  GimpImage      *copy  = NULL;
+  BenchStroke     stroke;
+  BenchResult    *result;
+  GEnumClass     *enum_class;
+  gchar          *uri;
+  static gdouble  scales[] = { 1.0, 0.5, 0.25, 0.125 };
+  gint            i;
+
+  context = g_option_context_new (NULL);
+  g_option_context_add_main_entries (context, bench_options, NULL);
+
+  if (! g_option_context_parse (context, &argc, &argv, &error))
+    {
+      g_printerr ("%s\n", error->message);
+      return EXIT_FAILURE;
+    }
+
+  g_option_context_free (context);
+
+  bench_iterations = MAX (bench_iterations, 1);
+  bench_size       = MAX (bench_size, 64);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  gimp = gimp_init_for_testing ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  image = bench_create_image (gimp, BENCH_N_LAYERS);
+
+  for (i = 0; i < G_N_ELEMENTS (scales); i++)
+    {
+      gchar *name = g_strdup_printf ("projection-render-%g", scales[i]);
+
+      bench_run (name, gimp, image,
+                 bench_projection_setup, bench_projection, &scales[i]);
+      g_free (name);
+    }
+
+  uri = g_build_filename (g_get_tmp_dir (), "gimp-bench.xcf", NULL);
+
+  bench_run ("xcf-save", gimp, image, NULL, bench_xcf_save, uri);
+  bench_run ("xcf-load", gimp, image, NULL, bench_xcf_load, uri);
+
+  g_unlink (uri);
+  g_free (uri);
+
+  g_object_unref (image);
+
+  /*  the remaining benchmarks work on two layers  */
+  image = bench_create_image (gimp, 2);
+
+  enum_class = g_type_class_ref (GIMP_TYPE_LAYER_MODE_EFFECTS);
+
+  for (i = 0; i < enum_class->n_values; i++)
+    {
+      GEnumValue *value = &enum_class->values[i];
+      gchar      *name  = g_strdup_printf ("layer-mode-%s", value->value_nick);
+
+      bench_run (name, gimp, image,
+                 bench_layer_mode_setup, bench_layer_mode,
+                 GINT_TO_POINTER (value->value));
+      g_free (name);
+    }
+
+  g_type_class_unref (enum_class);
+
+  gimp_layer_set_mode (gimp_image_get_layer_iter (image)->data,
+                       GIMP_NORMAL_MODE, FALSE);
+
+  bench_get_stroke (&stroke);
+  result = bench_run ("paintbrush-stroke", gimp, image, NULL,
+                      bench_paintbrush, &stroke);
+  g_free (stroke.events);
+
+  /*  the dab statistics of the last run  */
+  {
+    gchar dabs[G_ASCII_DTOSTR_BUF_SIZE];
+    gchar median[G_ASCII_DTOSTR_BUF_SIZE];
+    gchar p99[G_ASCII_DTOSTR_BUF_SIZE];
+
+    g_ascii_formatd (dabs,   sizeof (dabs),   "%.1f",
+                     stroke.stats.dabs_per_second);
+    g_ascii_formatd (median, sizeof (median), "%.6f",
+                     stroke.stats.latency_median);
+    g_ascii_formatd (p99,    sizeof (p99),    "%.6f",
+                     stroke.stats.latency_99);
+
+    result->extra = g_strdup_printf ("\"events\": %d, \"dabs\": %d, "
+                                     "\"dabs-per-second\": %s, "
+                                     "\"latency-median\": %s, "
+                                     "\"latency-99\": %s",
+                                     stroke.stats.n_events,
+                                     stroke.stats.n_dabs,
+                                     dabs, median, p99);
+  }
+
+  bench_run ("gaussian-blur", gimp, image, NULL, bench_gaussian_blur, NULL);
+
+  bench_run ("indexed-conversion", gimp, image,
+             bench_indexed_setup, bench_indexed, &copy);
+  g_object_unref (copy);
+
+  bench_run ("fuzzy-select", gimp, image, NULL, bench_fuzzy_select, NULL);
+
+  g_object_unref (image);
+
+  bench_babl_conversions (gimp);
+
+  if (bench_output)
+    {
+      FILE *file = g_fopen (bench_output, "w");
+
+      if (! file)
+        {
+          g_printerr ("Could not open '%s' for writing\n", bench_output);
+          return EXIT_FAILURE;
+        }
+
+      bench_write_results (file);
+      fclose (file);
+    }
+  else
+    {
+      bench_write_results (stdout);
+    }
+
+  /* Exit so we don't break script-fu plug-in wire */
+  gimp_exit (gimp, TRUE);
+
+  return EXIT_SUCCESS;
+}
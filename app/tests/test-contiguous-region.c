@@ -0,0 +1,246 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include <gegl.h>
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+#include "core/gimpdrawable.h"
+#include "core/gimpimage.h"
+#include "core/gimpimage-contiguous-region.h"
+#include "core/gimplayer.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+/*  Fills layers with two random colors and checks, for a few random
+ *  seed pixels, that gimp_image_contiguous_region_by_seed() selects
+ *  the 4-connected region a naive flood fill finds.
+ */
+
+#define WIDTH     300
+#define HEIGHT    200 /* several bands of rows */
+#define N_SEEDS   8
+#define THRESHOLD 0.5
+#define SEED      0x636f6e74
+
+
+typedef struct
+{
+  const gchar *name;
+  gint         n_white;  /* in 100 */
+} ContiguousCase;
+
+/*  close to the percolation threshold, so there are large regions
+ *  winding up and down through the bands
+ */
+static const ContiguousCase contiguous_cases[] =
+{
+  { "sparse",     40 },
+  { "winding",    59 },
+  { "dense",      80 },
+  { "uniform",   100 }
+};
+
+static Gimp *gimp = NULL;
+
+
+/*  the pixels of @src that have the color of (@x, @y) and are connected
+ *  to it, marked pixel by pixel
+ */
+static void
+contiguous_brute_force (const guchar *src,
+                        guchar       *dest,
+                        gint          x,
+                        gint          y)
+{
+  gint *queue = g_new (gint, WIDTH * HEIGHT);
+  gint  head  = 0;
+  gint  tail  = 0;
+
+  memset (dest, 0, WIDTH * HEIGHT);
+
+  dest[y * WIDTH + x] = TRUE;
+  queue[tail++] = y * WIDTH + x;
+
+  while (head < tail)
+    {
+      gint i          = queue[head++];
+      gint px         = i % WIDTH;
+      gint py         = i / WIDTH;
+      gint next[4][2] = { { px - 1, py }, { px + 1, py },
+                          { px, py - 1 }, { px, py + 1 } };
+      gint n;
+
+      for (n = 0; n < 4; n++)
+        {
+          gint nx = next[n][0];
+          gint ny = next[n][1];
+          gint j  = ny * WIDTH + nx;
+
+          if (nx < 0 || nx >= WIDTH || ny < 0 || ny >= HEIGHT)
+            continue;
+
+          if (! dest[j] && src[j] == src[y * WIDTH + x])
+            {
+              dest[j] = TRUE;
+              queue[tail++] = j;
+            }
+        }
+    }
+
+  g_free (queue);
+}
+
+static void
+test_contiguous_region (gconstpointer data)
+{
+  const ContiguousCase *test = data;
+  GimpImage            *image;
+  GimpLayer            *layer;
+  GRand                *rand;
+  guchar               *pixels;
+  guchar               *white;
+  guchar               *expected;
+  gfloat               *mask;
+  gint                  i;
+
+  rand = g_rand_new_with_seed (SEED);
+
+  image = gimp_image_new (gimp, WIDTH, HEIGHT,
+                          GIMP_RGB, GIMP_PRECISION_U8_GAMMA);
+
+  layer = gimp_layer_new (image, WIDTH, HEIGHT,
+                          babl_format ("R'G'B'A u8"),
+                          "contiguous",
+                          GIMP_OPACITY_OPAQUE,
+                          GIMP_NORMAL_MODE);
+
+  gimp_image_add_layer (image, layer, NULL, 0, FALSE /*push_undo*/);
+
+  pixels = g_new (guchar, WIDTH * HEIGHT * 4);
+  white  = g_new (guchar, WIDTH * HEIGHT);
+
+  for (i = 0; i < WIDTH * HEIGHT; i++)
+    {
+      white[i] = g_rand_int_range (rand, 0, 100) < test->n_white;
+
+      pixels[4 * i + 0] = white[i] ? 255 : 0;
+      pixels[4 * i + 1] = white[i] ? 255 : 0;
+      pixels[4 * i + 2] = white[i] ? 255 : 0;
+      pixels[4 * i + 3] = 255;
+    }
+
+  gegl_buffer_set (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
+                   GEGL_RECTANGLE (0, 0, WIDTH, HEIGHT), 0,
+                   babl_format ("R'G'B'A u8"), pixels,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  expected = g_new (guchar, WIDTH * HEIGHT);
+  mask     = g_new (gfloat, WIDTH * HEIGHT);
+
+  for (i = 0; i < N_SEEDS; i++)
+    {
+      GeglBuffer *mask_buffer;
+      gint        x = g_rand_int_range (rand, 0, WIDTH);
+      gint        y = g_rand_int_range (rand, 0, HEIGHT);
+      gint        j;
+
+      mask_buffer =
+        gimp_image_contiguous_region_by_seed (image, GIMP_DRAWABLE (layer),
+                                              FALSE /*sample_merged*/,
+                                              FALSE /*antialias*/,
+                                              THRESHOLD,
+                                              FALSE /*select_transparent*/,
+                                              GIMP_SELECT_CRITERION_COMPOSITE,
+                                              x, y);
+
+      gegl_buffer_get (mask_buffer, GEGL_RECTANGLE (0, 0, WIDTH, HEIGHT),
+                       1.0, babl_format ("Y float"), mask,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      contiguous_brute_force (white, expected, x, y);
+
+      for (j = 0; j < WIDTH * HEIGHT; j++)
+        {
+          if (mask[j] != (expected[j] ? 1.0 : 0.0))
+            g_error ("%s, seed %d, %d: pixel %d, %d differs: %.2f, "
+                     "brute force %d",
+                     test->name, x, y, j % WIDTH, j / WIDTH,
+                     mask[j], expected[j]);
+        }
+
+      g_object_unref (mask_buffer);
+    }
+
+  g_free (pixels);
+  g_free (white);
+  g_free (expected);
+  g_free (mask);
+
+  g_object_unref (image);
+
+  g_rand_free (rand);
+}
+
+
+int
+main (int    argc,
+      char **argv)
+{
+  gint result;
+  gint i;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /* We share the same application instance across all tests, it
+   * provides the worker threads
+   */
+  gimp = gimp_init_for_testing ();
+
+  for (i = 0; i < G_N_ELEMENTS (contiguous_cases); i++)
+    {
+      gchar *path = g_strdup_printf ("/contiguous-region/by-seed/%s",
+                                     contiguous_cases[i].name);
+
+      g_test_add_data_func (path, &contiguous_cases[i],
+                            test_contiguous_region);
+
+      g_free (path);
+    }
+
+  /* Run the tests */
+  result = g_test_run ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
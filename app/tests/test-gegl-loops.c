@@ -0,0 +1,439 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "core/core-types.h"
+
+#include "core/gimp.h"
+
+#include "gegl/gimp-gegl-loops.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+/*  Runs the parallel loops of gimp-gegl-loops.c on random input and
+ *  checks that they agree with a brute force version of what they
+ *  compute. The tests share a Gimp instance, so the loops are spread
+ *  over the configured number of threads.
+ */
+
+#define WIDTH  200
+#define HEIGHT 300 /* several tile rows, so the rows are split */
+#define SEED   0x6c6f6f70
+
+#define DISTANCE_EPSILON 1e-4
+
+
+typedef struct
+{
+  const gchar *name;
+  gint         radius_x;
+  gint         radius_y;
+  gboolean     erode;
+  gboolean     outside_selected;
+} MorphologyCase;
+
+static const MorphologyCase morphology_cases[] =
+{
+  { "grow-1x1",                 1,   1, FALSE, FALSE },
+  { "grow-3x7",                 3,   7, FALSE, FALSE },
+  { "grow-10x2",               10,   2, FALSE, FALSE },
+  { "grow-25x25",              25,  25, FALSE, FALSE },
+  { "grow-40x150",             40, 150, FALSE, FALSE },
+  { "grow-250x2",             250,   2, FALSE, FALSE },
+  { "grow-3x7-outside",         3,   7, FALSE, TRUE  },
+  { "shrink-1x1",               1,   1, TRUE,  FALSE },
+  { "shrink-3x7",               3,   7, TRUE,  FALSE },
+  { "shrink-25x25",            25,  25, TRUE,  FALSE },
+  { "shrink-3x7-edge-lock",     3,   7, TRUE,  TRUE  },
+  { "shrink-25x25-edge-lock",  25,  25, TRUE,  TRUE  }
+};
+
+typedef struct
+{
+  const gchar   *name;
+  GeglRectangle  extent;
+  gint           n_background; /* in 1000 */
+} DistanceCase;
+
+static const DistanceCase distance_cases[] =
+{
+  /*  more than two blocks wide or high, so the passes are split  */
+  { "sparse",        {   0,   0, 150, 100 },   5 },
+  { "dense",         {   0,   0, 150, 100 }, 200 },
+  { "offset",        { -37,  21, 150, 100 },  20 },
+  { "tall",          {   0,   0,  30, 200 },  20 },
+  { "no-background", {   0,   0, 150, 100 },   0 }
+};
+
+
+/*  the half heights of the structuring element, like compute_border()
+ *  in gimpoperationgrow.c and gimpoperationshrink.c, indexed from
+ *  -radius_x to radius_x
+ */
+static gint16 *
+morphology_circ_new (gint radius_x,
+                     gint radius_y)
+{
+  gint16 *circ = g_new (gint16, 2 * radius_x + 1);
+  gint    i;
+
+  for (i = 0; i < 2 * radius_x + 1; i++)
+    {
+      gdouble tmp;
+
+      if (i > radius_x)
+        tmp = (i - radius_x) - 0.5;
+      else if (i < radius_x)
+        tmp = (radius_x - i) - 0.5;
+      else
+        tmp = 0.0;
+
+      circ[i] = RINT (radius_y / (gdouble) radius_x *
+                      sqrt (SQR (radius_x) - SQR (tmp)));
+    }
+
+  return circ + radius_x;
+}
+
+/*  marks every pixel within the structuring element of a seed pixel,
+ *  the pixels outside the image are seeds if outside_seed is set
+ */
+static void
+morphology_brute_force (const guchar *src,
+                        guchar       *dest,
+                        const gint16 *circ,
+                        gint          radius_x,
+                        gboolean      erode,
+                        gboolean      outside_seed)
+{
+  guchar  seed    = erode ? 0 : 255;
+  guchar *covered = g_new0 (guchar, WIDTH * HEIGHT);
+  gint    x, y;
+
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < WIDTH; x++)
+      {
+        gint dx, dy;
+
+        if (src[y * WIDTH + x] != seed)
+          continue;
+
+        for (dx = MAX (-radius_x, -x); dx <= radius_x && x + dx < WIDTH; dx++)
+          {
+            gint h = circ[dx];
+
+            for (dy = MAX (-h, -y); dy <= h && y + dy < HEIGHT; dy++)
+              covered[(y + dy) * WIDTH + x + dx] = TRUE;
+          }
+      }
+
+  for (y = 0; y < HEIGHT; y++)
+    for (x = 0; x < WIDTH; x++)
+      {
+        /*  the nearest outside pixel is straight left, right, above
+         *  or below, and the element shrinks away from its center
+         */
+        if (outside_seed &&
+            (x + 1 <= radius_x || WIDTH - x <= radius_x ||
+             y + 1 <= circ[0]  || HEIGHT - y <= circ[0]))
+          covered[y * WIDTH + x] = TRUE;
+
+        if (erode)
+          dest[y * WIDTH + x] = covered[y * WIDTH + x] ? 0 : 255;
+        else
+          dest[y * WIDTH + x] = covered[y * WIDTH + x] ? 255 : 0;
+      }
+
+  g_free (covered);
+}
+
+static void
+test_binary_morphology (gconstpointer data)
+{
+  const MorphologyCase *test   = data;
+  GeglRectangle         extent = { 0, 0, WIDTH + 20, HEIGHT + 30 };
+  GeglRectangle         rect   = { 7, 13, WIDTH, HEIGHT };
+  GeglBuffer           *src_buffer;
+  GeglBuffer           *dest_buffer;
+  GRand                *rand;
+  guchar               *pixels;
+  guchar               *src;
+  guchar               *dest;
+  guchar               *expected;
+  gint16               *circ;
+  gint                  i;
+
+  rand = g_rand_new_with_seed (SEED);
+
+  /*  a few seed pixels in a binary mask, and different pixels around
+   *  rect which must not be looked at
+   */
+  pixels = g_new (guchar, extent.width * extent.height);
+
+  for (i = 0; i < extent.width * extent.height; i++)
+    {
+      gboolean seed = g_rand_int_range (rand, 0, 100) == 0;
+
+      pixels[i] = (seed == test->erode) ? 0 : 255;
+    }
+
+  src_buffer = gegl_buffer_new (&extent, babl_format ("Y u8"));
+  gegl_buffer_set (src_buffer, &extent, 0, babl_format ("Y u8"),
+                   pixels, GEGL_AUTO_ROWSTRIDE);
+
+  src = g_new (guchar, WIDTH * HEIGHT);
+  gegl_buffer_get (src_buffer, &rect, 1.0, babl_format ("Y u8"),
+                   src, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  /*  rect doesn't start at a tile boundary of dest_buffer  */
+  dest_buffer = gegl_buffer_new (&rect, babl_format ("Y u8"));
+
+  circ = morphology_circ_new (test->radius_x, test->radius_y);
+
+  if (! gimp_gegl_binary_morphology (src_buffer, dest_buffer, &rect, circ,
+                                     test->radius_x, test->radius_y,
+                                     test->erode, test->outside_selected))
+    g_error ("%s: the binary mask was not recognized as binary", test->name);
+
+  dest = g_new (guchar, WIDTH * HEIGHT);
+  gegl_buffer_get (dest_buffer, &rect, 1.0, babl_format ("Y u8"),
+                   dest, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  /*  when shrinking, the unselected pixels are grown  */
+  expected = g_new (guchar, WIDTH * HEIGHT);
+  morphology_brute_force (src, expected, circ,
+                          test->radius_x, test->erode,
+                          test->erode ?
+                          ! test->outside_selected : test->outside_selected);
+
+  for (i = 0; i < WIDTH * HEIGHT; i++)
+    {
+      if (dest[i] != expected[i])
+        g_error ("%s: pixel %d, %d differs: %d, brute force %d",
+                 test->name, i % WIDTH, i / WIDTH, dest[i], expected[i]);
+    }
+
+  g_free (circ - test->radius_x);
+  g_free (pixels);
+  g_free (src);
+  g_free (dest);
+  g_free (expected);
+
+  g_object_unref (src_buffer);
+  g_object_unref (dest_buffer);
+
+  g_rand_free (rand);
+}
+
+static void
+test_binary_morphology_partial (void)
+{
+  GeglRectangle  rect = { 0, 0, WIDTH, HEIGHT };
+  GeglBuffer    *src_buffer;
+  GeglBuffer    *dest_buffer;
+  gint16        *circ;
+
+  src_buffer  = gegl_buffer_new (&rect, babl_format ("Y u8"));
+  dest_buffer = gegl_buffer_new (&rect, babl_format ("Y u8"));
+
+  /*  a single partially selected pixel takes the slow path  */
+  gegl_buffer_set (src_buffer, GEGL_RECTANGLE (WIDTH - 1, HEIGHT - 1, 1, 1),
+                   0, babl_format ("Y u8"), (guchar []) { 128 },
+                   GEGL_AUTO_ROWSTRIDE);
+
+  circ = morphology_circ_new (3, 3);
+
+  g_assert (! gimp_gegl_binary_morphology (src_buffer, dest_buffer, &rect,
+                                           circ, 3, 3, FALSE, FALSE));
+
+  g_free (circ - 3);
+
+  g_object_unref (src_buffer);
+  g_object_unref (dest_buffer);
+}
+
+/*  the squared distance of each pixel to the nearest background pixel
+ *  around or inside the buffer, starting at the value of partially
+ *  selected pixels
+ */
+static gdouble
+distance_brute_force (const guchar *src,
+                      gint          width,
+                      gint          height,
+                      gint          x,
+                      gint          y)
+{
+  gdouble min;
+  gint    qx, qy;
+
+  /*  the nearest pixel around the buffer is straight left, right,
+   *  above or below
+   */
+  min = SQR (MIN (MIN (x + 1, width - x), MIN (y + 1, height - y)));
+
+  for (qy = 0; qy < height; qy++)
+    for (qx = 0; qx < width; qx++)
+      {
+        guchar value = src[qy * width + qx];
+
+        if (value != 255)
+          {
+            gdouble d = SQR (qx - x) + SQR (qy - y) + SQR (value / 255.0);
+
+            if (d < min)
+              min = d;
+          }
+      }
+
+  return min;
+}
+
+static void
+test_distance_transform (gconstpointer data)
+{
+  const DistanceCase  *test   = data;
+  const GeglRectangle *extent = &test->extent;
+  gint                 n      = extent->width * extent->height;
+  GeglBuffer          *src_buffer;
+  GeglBuffer          *dest_buffer;
+  GRand               *rand;
+  guchar              *src;
+  gfloat              *dest;
+  gfloat               max;
+  gdouble              expected_max = 0.0;
+  gint                 i;
+
+  rand = g_rand_new_with_seed (SEED);
+
+  /*  a selection with holes, a few of them with antialiased edges  */
+  src = g_new (guchar, n);
+
+  for (i = 0; i < n; i++)
+    {
+      if (g_rand_int_range (rand, 0, 1000) >= test->n_background)
+        src[i] = 255;
+      else if (g_rand_boolean (rand))
+        src[i] = 0;
+      else
+        src[i] = g_rand_int_range (rand, 1, 255);
+    }
+
+  src_buffer = gegl_buffer_new (extent, babl_format ("Y u8"));
+  gegl_buffer_set (src_buffer, extent, 0, babl_format ("Y u8"),
+                   src, GEGL_AUTO_ROWSTRIDE);
+
+  dest_buffer = gegl_buffer_new (extent, babl_format ("Y float"));
+
+  max = gimp_gegl_distance_transform (src_buffer, dest_buffer);
+
+  dest = g_new (gfloat, n);
+  gegl_buffer_get (dest_buffer, extent, 1.0, babl_format ("Y float"),
+                   dest, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  for (i = 0; i < n; i++)
+    {
+      gint    x        = i % extent->width;
+      gint    y        = i / extent->width;
+      gdouble expected = sqrt (distance_brute_force (src,
+                                                     extent->width,
+                                                     extent->height,
+                                                     x, y));
+
+      if (fabs (dest[i] - expected) > DISTANCE_EPSILON * MAX (1.0, expected))
+        g_error ("%s: pixel %d, %d (value %d) differs: %.6f, "
+                 "brute force %.6f",
+                 test->name, x, y, src[i], dest[i], expected);
+
+      expected_max = MAX (expected_max, expected);
+    }
+
+  if (fabs (max - expected_max) > DISTANCE_EPSILON * MAX (1.0, expected_max))
+    g_error ("%s: the largest distance differs: %.6f, brute force %.6f",
+             test->name, max, expected_max);
+
+  g_free (src);
+  g_free (dest);
+
+  g_object_unref (src_buffer);
+  g_object_unref (dest_buffer);
+
+  g_rand_free (rand);
+}
+
+
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  gint  result;
+  gint  i;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /* We share the same application instance across all tests, it
+   * provides the worker threads
+   */
+  gimp = gimp_init_for_testing ();
+
+  for (i = 0; i < G_N_ELEMENTS (morphology_cases); i++)
+    {
+      gchar *path = g_strdup_printf ("/gegl-loops/binary-morphology/%s",
+                                     morphology_cases[i].name);
+
+      g_test_add_data_func (path, &morphology_cases[i],
+                            test_binary_morphology);
+
+      g_free (path);
+    }
+
+  g_test_add_func ("/gegl-loops/binary-morphology/partial",
+                   test_binary_morphology_partial);
+
+  for (i = 0; i < G_N_ELEMENTS (distance_cases); i++)
+    {
+      gchar *path = g_strdup_printf ("/gegl-loops/distance-transform/%s",
+                                     distance_cases[i].name);
+
+      g_test_add_data_func (path, &distance_cases[i],
+                            test_distance_transform);
+
+      g_free (path);
+    }
+
+  /* Run the tests */
+  result = g_test_run ();
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
@@ -0,0 +1,337 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+
+#include "core/core-types.h"
+
+#include "core/gimplist.h"
+
+
+#define N_OBJECTS 16
+#define SEED      0x6c697374
+
+
+#define ADD_TEST(function) \
+  g_test_add ("/gimplist/" #function, \
+              GimpTestFixture, \
+              NULL, \
+              gimp_test_list_setup, \
+              function, \
+              gimp_test_list_teardown);
+
+
+typedef struct
+{
+  GimpContainer *container;
+  GimpObject    *objects[N_OBJECTS];
+} GimpTestFixture;
+
+
+static void
+gimp_test_list_setup (GimpTestFixture *fixture,
+                      gconstpointer    data)
+{
+  gint i;
+
+  fixture->container = gimp_list_new (GIMP_TYPE_OBJECT, FALSE);
+
+  for (i = 0; i < N_OBJECTS; i++)
+    {
+      gchar *name = g_strdup_printf ("object %02d", (i * 7) % N_OBJECTS);
+
+      fixture->objects[i] = g_object_new (GIMP_TYPE_OBJECT,
+                                          "name", name,
+                                          NULL);
+      g_free (name);
+    }
+}
+
+static void
+gimp_test_list_teardown (GimpTestFixture *fixture,
+                         gconstpointer    data)
+{
+  gint i;
+
+  g_object_unref (fixture->container);
+  fixture->container = NULL;
+
+  for (i = 0; i < N_OBJECTS; i++)
+    {
+      g_object_unref (fixture->objects[i]);
+      fixture->objects[i] = NULL;
+    }
+}
+
+/*  checks that the index, position and name lookups agree with the
+ *  GList, and that the objects not in the list aren't found
+ */
+static void
+check_list (GimpTestFixture *f)
+{
+  GimpList *list = GIMP_LIST (f->container);
+  GList    *glist;
+  gint      n_children;
+  gint      index;
+  gint      i;
+
+  n_children = gimp_container_get_n_children (f->container);
+
+  g_assert_cmpint (g_list_length (list->list), ==, n_children);
+
+  for (glist = list->list, index = 0;
+       glist;
+       glist = g_list_next (glist), index++)
+    {
+      GimpObject *object = glist->data;
+
+      g_assert (gimp_container_get_child_by_index (f->container,
+                                                   index) == object);
+      g_assert_cmpint (gimp_container_get_child_index (f->container,
+                                                       object), ==, index);
+      g_assert (gimp_container_have (f->container, object));
+      g_assert (gimp_container_get_child_by_name (f->container,
+                                                  gimp_object_get_name (object)) != NULL);
+    }
+
+  g_assert (gimp_container_get_child_by_index (f->container,
+                                               n_children) == NULL);
+
+  for (i = 0; i < N_OBJECTS; i++)
+    {
+      if (! g_list_find (list->list, f->objects[i]))
+        {
+          g_assert (! gimp_container_have (f->container, f->objects[i]));
+          g_assert_cmpint (gimp_container_get_child_index (f->container,
+                                                           f->objects[i]),
+                           ==, -1);
+        }
+    }
+}
+
+static void
+add_all (GimpTestFixture *f)
+{
+  gint i;
+
+  for (i = 0; i < N_OBJECTS; i++)
+    {
+      gimp_container_add (f->container, f->objects[i]);
+      check_list (f);
+    }
+}
+
+/*  removes every other object, then the rest, from the front  */
+static void
+remove_all (GimpTestFixture *f)
+{
+  gint i;
+
+  for (i = 0; i < N_OBJECTS; i += 2)
+    {
+      gimp_container_remove (f->container, f->objects[i]);
+      check_list (f);
+    }
+
+  for (i = 1; i < N_OBJECTS; i += 2)
+    {
+      gimp_container_remove (f->container, f->objects[i]);
+      check_list (f);
+    }
+
+  g_assert (gimp_container_is_empty (f->container));
+}
+
+/**
+ * prepend:
+ *
+ * Test inserting at the front, which is what the undo stack does, and
+ * removing children again.
+ **/
+static void
+prepend (GimpTestFixture *f,
+         gconstpointer    data)
+{
+  add_all (f);
+
+  g_assert (gimp_container_get_first_child (f->container) ==
+            f->objects[N_OBJECTS - 1]);
+  g_assert (gimp_container_get_last_child (f->container) ==
+            f->objects[0]);
+
+  remove_all (f);
+}
+
+/**
+ * prepend_remove_oldest:
+ *
+ * Test removing the oldest of three prepended children, and that the
+ * others are still found where they are.
+ **/
+static void
+prepend_remove_oldest (GimpTestFixture *f,
+                       gconstpointer    data)
+{
+  gimp_container_add (f->container, f->objects[0]);
+  gimp_container_add (f->container, f->objects[1]);
+  gimp_container_add (f->container, f->objects[2]);
+
+  gimp_container_remove (f->container, f->objects[0]);
+  check_list (f);
+
+  g_assert (gimp_container_get_child_by_index (f->container, 0) ==
+            f->objects[2]);
+  g_assert (gimp_container_get_child_by_index (f->container, 1) ==
+            f->objects[1]);
+}
+
+/**
+ * append:
+ *
+ * Test appending and removing children.
+ **/
+static void
+append (GimpTestFixture *f,
+        gconstpointer    data)
+{
+  g_object_set (f->container, "append", TRUE, NULL);
+
+  add_all (f);
+
+  g_assert (gimp_container_get_first_child (f->container) ==
+            f->objects[0]);
+  g_assert (gimp_container_get_last_child (f->container) ==
+            f->objects[N_OBJECTS - 1]);
+
+  remove_all (f);
+}
+
+/**
+ * sorted_insert:
+ *
+ * Test that sorted inserts keep the children sorted by name.
+ **/
+static void
+sorted_insert (GimpTestFixture *f,
+               gconstpointer    data)
+{
+  GList *glist;
+
+  gimp_list_set_sort_func (GIMP_LIST (f->container),
+                           (GCompareFunc) gimp_object_name_collate);
+
+  add_all (f);
+
+  for (glist = GIMP_LIST (f->container)->list;
+       glist && glist->next;
+       glist = g_list_next (glist))
+    {
+      g_assert_cmpint (gimp_object_name_collate (glist->data,
+                                                 glist->next->data), <, 0);
+    }
+
+  remove_all (f);
+}
+
+/**
+ * reorder:
+ *
+ * Test moving children to the front, to the end and into the middle.
+ **/
+static void
+reorder (GimpTestFixture *f,
+         gconstpointer    data)
+{
+  gint i;
+
+  add_all (f);
+
+  for (i = 0; i < N_OBJECTS; i++)
+    {
+      gimp_container_reorder (f->container, f->objects[i], 0);
+      check_list (f);
+
+      gimp_container_reorder (f->container, f->objects[i], -1);
+      check_list (f);
+
+      gimp_container_reorder (f->container, f->objects[i], N_OBJECTS / 2);
+      check_list (f);
+
+      gimp_container_reorder (f->container, f->objects[i], i);
+      check_list (f);
+    }
+
+  remove_all (f);
+}
+
+/**
+ * random_operations:
+ *
+ * Test a random mix of adds, removes and reorders.
+ **/
+static void
+random_operations (GimpTestFixture *f,
+                   gconstpointer    data)
+{
+  GRand *rand = g_rand_new_with_seed (SEED);
+  gint   i;
+
+  for (i = 0; i < 1000; i++)
+    {
+      GimpObject *object = f->objects[g_rand_int_range (rand, 0, N_OBJECTS)];
+
+      if (! gimp_container_have (f->container, object))
+        {
+          g_object_set (f->container,
+                        "append", g_rand_boolean (rand),
+                        NULL);
+
+          gimp_container_add (f->container, object);
+        }
+      else if (g_rand_boolean (rand))
+        {
+          gimp_container_remove (f->container, object);
+        }
+      else
+        {
+          gint n_children = gimp_container_get_n_children (f->container);
+
+          gimp_container_reorder (f->container, object,
+                                  g_rand_int_range (rand, -1, n_children));
+        }
+
+      check_list (f);
+    }
+
+  g_rand_free (rand);
+}
+
+int main(int argc, char **argv)
+{
+  g_test_init (&argc, &argv, NULL);
+
+  ADD_TEST (prepend);
+  ADD_TEST (prepend_remove_oldest);
+  ADD_TEST (append);
+  ADD_TEST (sorted_insert);
+  ADD_TEST (reorder);
+  ADD_TEST (random_operations);
+
+  return g_test_run ();
+}
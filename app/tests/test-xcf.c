@@ -0,0 +1,2058 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 2009 Martin Nordholts
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <glib/gstdio.h>
+
+#include <gegl.h>
+
+#include <gtk/gtk.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "widgets/widgets-types.h"
+
+#include "widgets/gimpuimanager.h"
+
+#include "core/gimp.h"
+#include "core/gimpchannel.h"
+#include "core/gimpchannel-select.h"
+#include "core/gimpdrawable.h"
+#include "core/gimpgrid.h"
+#include "core/gimpgrouplayer.h"
+#include "core/gimpguide.h"
+#include "core/gimpimage.h"
+#include "core/gimpimage-grid.h"
+#include "core/gimpimage-guides.h"
+#include "core/gimpimage-sample-points.h"
+#include "core/gimplayer.h"
+#include "core/gimpsamplepoint.h"
+#include "core/gimpselection.h"
+
+#include "vectors/gimpanchor.h"
+#include "vectors/gimpbezierstroke.h"
+#include "vectors/gimpvectors.h"
+
+#include "file/file-open.h"
+#include "file/file-procedure.h"
+#include "file/file-save.h"
+
+#include "plug-in/gimppluginmanager.h"
+
+#include "xcf/xcf-private.h"
+#include "xcf/xcf-save.h"
+#include "xcf/xcf-tile-handler.h"
+
+#include "tests.h"
+
+#include "gimp-app-test-utils.h"
+
+
+#define GIMP_MAINIMAGE_WIDTH            100
+#define GIMP_MAINIMAGE_HEIGHT           90
+#define GIMP_MAINIMAGE_TYPE             GIMP_RGB
+#define GIMP_MAINIMAGE_PRECISION        GIMP_PRECISION_U8_GAMMA
+
+#define GIMP_MAINIMAGE_LAYER1_NAME      "layer1"
+#define GIMP_MAINIMAGE_LAYER1_WIDTH     50
+#define GIMP_MAINIMAGE_LAYER1_HEIGHT    51
+#define GIMP_MAINIMAGE_LAYER1_FORMAT    babl_format ("R'G'B'A u8")
+#define GIMP_MAINIMAGE_LAYER1_OPACITY   1.0
+#define GIMP_MAINIMAGE_LAYER1_MODE      GIMP_NORMAL_MODE
+
+#define GIMP_MAINIMAGE_LAYER2_NAME      "layer2"
+#define GIMP_MAINIMAGE_LAYER2_WIDTH     25
+#define GIMP_MAINIMAGE_LAYER2_HEIGHT    251
+#define GIMP_MAINIMAGE_LAYER2_FORMAT    babl_format ("R'G'B' u8")
+#define GIMP_MAINIMAGE_LAYER2_OPACITY   0.0
+#define GIMP_MAINIMAGE_LAYER2_MODE      GIMP_MULTIPLY_MODE
+
+#define GIMP_MAINIMAGE_GROUP1_NAME      "group1"
+
+#define GIMP_MAINIMAGE_LAYER3_NAME      "layer3"
+
+#define GIMP_MAINIMAGE_LAYER4_NAME      "layer4"
+
+#define GIMP_MAINIMAGE_GROUP2_NAME      "group2"
+
+#define GIMP_MAINIMAGE_LAYER5_NAME      "layer5"
+
+#define GIMP_MAINIMAGE_VGUIDE1_POS      42
+#define GIMP_MAINIMAGE_VGUIDE2_POS      82
+#define GIMP_MAINIMAGE_HGUIDE1_POS      3
+#define GIMP_MAINIMAGE_HGUIDE2_POS      4
+
+#define GIMP_MAINIMAGE_SAMPLEPOINT1_X   10
+#define GIMP_MAINIMAGE_SAMPLEPOINT1_Y   12
+#define GIMP_MAINIMAGE_SAMPLEPOINT2_X   41
+#define GIMP_MAINIMAGE_SAMPLEPOINT2_Y   49
+
+#define GIMP_MAINIMAGE_RESOLUTIONX      400
+#define GIMP_MAINIMAGE_RESOLUTIONY      410
+
+#define GIMP_MAINIMAGE_PARASITE_NAME    "test-parasite"
+#define GIMP_MAINIMAGE_PARASITE_DATA    "foo"
+#define GIMP_MAINIMAGE_PARASITE_SIZE    4                /* 'f' 'o' 'o' '\0' */
+
+#define GIMP_MAINIMAGE_COMMENT          "Created with code from "\
+                                        "app/tests/test-xcf.c in the GIMP "\
+                                        "source tree, i.e. it was not created "\
+                                        "manually and may thus look weird if "\
+                                        "opened and inspected in GIMP."
+
+#define GIMP_MAINIMAGE_UNIT             GIMP_UNIT_PICA
+
+#define GIMP_MAINIMAGE_GRIDXSPACING     25.0
+#define GIMP_MAINIMAGE_GRIDYSPACING     27.0
+
+#define GIMP_MAINIMAGE_CHANNEL1_NAME    "channel1"
+#define GIMP_MAINIMAGE_CHANNEL1_WIDTH   GIMP_MAINIMAGE_WIDTH
+#define GIMP_MAINIMAGE_CHANNEL1_HEIGHT  GIMP_MAINIMAGE_HEIGHT
+#define GIMP_MAINIMAGE_CHANNEL1_COLOR   { 1.0, 0.0, 1.0, 1.0 }
+
+#define GIMP_MAINIMAGE_SELECTION_X      5
+#define GIMP_MAINIMAGE_SELECTION_Y      6
+#define GIMP_MAINIMAGE_SELECTION_W      7
+#define GIMP_MAINIMAGE_SELECTION_H      8
+
+#define GIMP_MAINIMAGE_VECTORS1_NAME    "vectors1"
+#define GIMP_MAINIMAGE_VECTORS1_COORDS  { { 11.0, 12.0, /* pad zeroes */ },\
+                                          { 21.0, 22.0, /* pad zeroes */ },\
+                                          { 31.0, 32.0, /* pad zeroes */ }, }
+
+#define GIMP_MAINIMAGE_VECTORS2_NAME    "vectors2"
+#define GIMP_MAINIMAGE_VECTORS2_COORDS  { { 911.0, 912.0, /* pad zeroes */ },\
+                                          { 921.0, 922.0, /* pad zeroes */ },\
+                                          { 931.0, 932.0, /* pad zeroes */ }, }
+
+#define GIMP_TILEIMAGE_WIDTH            300 /* not a multiple of the tile size */
+#define GIMP_TILEIMAGE_HEIGHT           200
+
+#define GIMP_TILEIMAGE_LAYER1_NAME      "tiles1"
+#define GIMP_TILEIMAGE_LAYER1_SEED      1
+
+#define GIMP_TILEIMAGE_LAYER2_NAME      "tiles2"
+#define GIMP_TILEIMAGE_LAYER2_SEED      2
+
+typedef struct
+{
+  gboolean          done;
+  GimpPDBStatusType status;
+} GimpTestAsyncSave;
+
+
+#define ADD_TEST(function) \
+  g_test_add_data_func ("/gimp-xcf/" #function, gimp, function);
+
+
+GimpImage        * gimp_test_load_image                        (Gimp            *gimp,
+                                                                const gchar     *uri);
+static void        gimp_write_and_read_file                    (Gimp            *gimp,
+                                                                gboolean         with_unusual_stuff,
+                                                                gboolean         compat_paths,
+                                                                gboolean         use_gimp_2_8_features);
+static GimpImage * gimp_create_mainimage                       (Gimp            *gimp,
+                                                                gboolean         with_unusual_stuff,
+                                                                gboolean         compat_paths,
+                                                                gboolean         use_gimp_2_8_features);
+static void        gimp_assert_mainimage                       (GimpImage       *image,
+                                                                gboolean         with_unusual_stuff,
+                                                                gboolean         compat_paths,
+                                                                gboolean         use_gimp_2_8_features);
+static void        gimp_write_and_read_tileimage               (Gimp            *gimp,
+                                                                GimpPrecision    precision,
+                                                                gboolean         zlib_compression);
+static GimpImage * gimp_create_tileimage                       (Gimp            *gimp,
+                                                                GimpPrecision    precision);
+static void        gimp_fill_tilelayer                         (GimpImage       *image,
+                                                                const gchar     *name,
+                                                                guint32          seed);
+static void        gimp_assert_tilelayer                       (GimpImage       *image,
+                                                                const gchar     *name,
+                                                                guint32          seed);
+static void        gimp_assert_tileimage                       (GimpImage       *image);
+static void        gimp_test_save_image                        (GimpImage       *image,
+                                                                const gchar     *uri);
+static void        gimp_test_save_xcf_version                  (GimpImage       *image,
+                                                                const gchar     *filename,
+                                                                gint             version);
+static void        gimp_assert_xcf_version                     (const gchar     *filename,
+                                                                gint             version);
+static gint        gimp_tilelayer_n_pending                    (GimpImage       *image,
+                                                                const gchar     *name);
+static void        gimp_read_tilelayer                         (GimpImage       *image,
+                                                                const gchar     *name);
+static GeglBuffer * gimp_tilelayer_buffer                      (GimpImage       *image,
+                                                                const gchar     *name);
+static void        gimp_test_truncate_file                     (const gchar     *filename);
+static gboolean    gimp_test_ignore_tile_warnings              (const gchar     *log_domain,
+                                                                GLogLevelFlags   log_level,
+                                                                const gchar     *message,
+                                                                gpointer         data);
+
+static void        gimp_test_save_image_async                  (GimpImage         *image,
+                                                                const gchar       *uri,
+                                                                GimpTestAsyncSave *save);
+static void        gimp_test_async_save_done                   (GimpImage         *image,
+                                                                GimpPDBStatusType  status,
+                                                                const GError      *error,
+                                                                gpointer           data);
+static void        gimp_test_wait_for_async_save               (GimpTestAsyncSave *save);
+
+
+/**
+ * write_and_read_gimp_2_6_format:
+ * @data:
+ *
+ * Do a write and read test on a file that could as well be
+ * constructed with GIMP 2.6.
+ **/
+static void
+write_and_read_gimp_2_6_format (gconstpointer data)
+{
+  Gimp *gimp = GIMP (data);
+
+  gimp_write_and_read_file (gimp,
+                            FALSE /*with_unusual_stuff*/,
+                            FALSE /*compat_paths*/,
+                            FALSE /*use_gimp_2_8_features*/);
+}
+
+/**
+ * write_and_read_gimp_2_6_format_unusual:
+ * @data:
+ *
+ * Do a write and read test on a file that could as well be
+ * constructed with GIMP 2.6, and make it unusual, like compatible
+ * vectors and with a floating selection.
+ **/
+static void
+write_and_read_gimp_2_6_format_unusual (gconstpointer data)
+{
+  Gimp *gimp = GIMP (data);
+
+  gimp_write_and_read_file (gimp,
+                            TRUE /*with_unusual_stuff*/,
+                            TRUE /*compat_paths*/,
+                            FALSE /*use_gimp_2_8_features*/);
+}
+
+/**
+ * load_gimp_2_6_file:
+ * @data:
+ *
+ * Loads a file created with GIMP 2.6 and makes sure it loaded as
+ * expected.
+ **/
+static void
+load_gimp_2_6_file (gconstpointer data)
+{
+  Gimp      *gimp  = GIMP (data);
+  GimpImage *image = NULL;
+  gchar     *uri   = NULL;
+
+  uri = g_build_filename (g_getenv ("GIMP_TESTING_ABS_TOP_SRCDIR"),
+                          "app/tests/files/gimp-2-6-file.xcf",
+                          NULL);
+
+  image = gimp_test_load_image (gimp, uri);
+
+  /* The image file was constructed by running
+   * gimp_write_and_read_file (FALSE, FALSE) in GIMP 2.6 by
+   * copy-pasting the code to GIMP 2.6 and adapting it to changes in
+   * the core API, so we can use gimp_assert_mainimage() to make sure
+   * the file was loaded successfully.
+   */
+  gimp_assert_mainimage (image,
+                         FALSE /*with_unusual_stuff*/,
+                         FALSE /*compat_paths*/,
+                         FALSE /*use_gimp_2_8_features*/);
+}
+
+/**
+ * write_and_read_gimp_2_8_format:
+ * @data:
+ *
+ * Writes an XCF file that uses GIMP 2.8 features such as layer
+ * groups, then reads the file and make sure no relevant information
+ * was lost.
+ **/
+static void
+write_and_read_gimp_2_8_format (gconstpointer data)
+{
+  Gimp *gimp = GIMP (data);
+
+  gimp_write_and_read_file (gimp,
+                            FALSE /*with_unusual_stuff*/,
+                            FALSE /*compat_paths*/,
+                            TRUE /*use_gimp_2_8_features*/);
+}
+
+/**
+ * write_and_read_rle_compression:
+ * @data:
+ *
+ * Writes an image with RLE compressed tiles, which can be read by
+ * any GIMP version, and makes sure the pixels survive.
+ **/
+static void
+write_and_read_rle_compression (gconstpointer data)
+{
+  Gimp *gimp = GIMP (data);
+
+  gimp_write_and_read_tileimage (gimp,
+                                 GIMP_PRECISION_U8_GAMMA,
+                                 FALSE /*zlib_compression*/);
+}
+
+/**
+ * write_and_read_zlib_compression:
+ * @data:
+ *
+ * Writes an image with zlib compressed tiles, which needs XCF
+ * version 6, and makes sure the pixels and the compression survive.
+ **/
+static void
+write_and_read_zlib_compression (gconstpointer data)
+{
+  Gimp *gimp = GIMP (data);
+
+  gimp_write_and_read_tileimage (gimp,
+                                 GIMP_PRECISION_U8_GAMMA,
+                                 TRUE /*zlib_compression*/);
+}
+
+/**
+ * write_and_read_zlib_compression_16_bit:
+ * @data:
+ *
+ * Like write_and_read_zlib_compression(), with two bytes per
+ * channel.
+ **/
+static void
+write_and_read_zlib_compression_16_bit (gconstpointer data)
+{
+  Gimp *gimp = GIMP (data);
+
+  gimp_write_and_read_tileimage (gimp,
+                                 GIMP_PRECISION_U16_LINEAR,
+                                 TRUE /*zlib_compression*/);
+}
+
+/**
+ * write_and_read_64_bit_offsets:
+ * @data:
+ *
+ * Writes an image as XCF version 7, which stores its offsets with 64
+ * bits, and makes sure the pixels survive. Only files beyond 4 GB
+ * need that version, so it is forced here.
+ **/
+static void
+write_and_read_64_bit_offsets (gconstpointer data)
+{
+  Gimp      *gimp         = GIMP (data);
+  GimpImage *image        = NULL;
+  GimpImage *loaded_image = NULL;
+  gchar     *uri          = NULL;
+
+  image = gimp_create_tileimage (gimp, GIMP_PRECISION_U8_GAMMA);
+
+  uri = g_build_filename (g_get_tmp_dir (), "gimp-test-offsets.xcf", NULL);
+  gimp_test_save_xcf_version (image, uri, 7);
+  gimp_assert_xcf_version (uri, 7);
+
+  loaded_image = gimp_test_load_image (gimp, uri);
+
+  g_assert (loaded_image != NULL);
+  gimp_assert_tileimage (loaded_image);
+
+  g_object_unref (loaded_image);
+  g_object_unref (image);
+
+  g_unlink (uri);
+  g_free (uri);
+}
+
+/**
+ * write_and_read_64_bit_offsets_unusual:
+ * @data:
+ *
+ * Like write_and_read_64_bit_offsets(), with the main image and its
+ * floating selection, channels and layer masks, which all have
+ * offsets of their own.
+ **/
+static void
+write_and_read_64_bit_offsets_unusual (gconstpointer data)
+{
+  Gimp      *gimp         = GIMP (data);
+  GimpImage *image        = NULL;
+  GimpImage *loaded_image = NULL;
+  gchar     *uri          = NULL;
+
+  image = gimp_create_mainimage (gimp,
+                                 TRUE /*with_unusual_stuff*/,
+                                 TRUE /*compat_paths*/,
+                                 FALSE /*use_gimp_2_8_features*/);
+
+  uri = g_build_filename (g_get_tmp_dir (), "gimp-test-offsets.xcf", NULL);
+  gimp_test_save_xcf_version (image, uri, 7);
+  gimp_assert_xcf_version (uri, 7);
+
+  loaded_image = gimp_test_load_image (gimp, uri);
+
+  gimp_assert_mainimage (loaded_image,
+                         TRUE /*with_unusual_stuff*/,
+                         TRUE /*compat_paths*/,
+                         FALSE /*use_gimp_2_8_features*/);
+
+  g_object_unref (loaded_image);
+  g_object_unref (image);
+
+  g_unlink (uri);
+  g_free (uri);
+}
+
+/**
+ * lazy_load_tiles:
+ * @data:
+ *
+ * Makes sure the tiles of a loaded XCF file are only read from the
+ * file when they are accessed, and that they are read correctly.
+ **/
+static void
+lazy_load_tiles (gconstpointer data)
+{
+  Gimp      *gimp         = GIMP (data);
+  GimpImage *image        = NULL;
+  GimpImage *loaded_image = NULL;
+  GimpLayer *layer        = NULL;
+  gchar     *uri          = NULL;
+  guchar     pixel[4];
+  gint       n_tiles      = 0;
+
+  image = gimp_create_tileimage (gimp, GIMP_PRECISION_U8_GAMMA);
+
+  uri = g_build_filename (g_get_tmp_dir (), "gimp-test-lazy.xcf", NULL);
+  gimp_test_save_image (image, uri);
+
+  loaded_image = gimp_test_load_image (gimp, uri);
+  g_assert (loaded_image != NULL);
+
+  /* Nothing has been read yet */
+  n_tiles = gimp_tilelayer_n_pending (loaded_image,
+                                      GIMP_TILEIMAGE_LAYER1_NAME);
+  g_assert_cmpint (n_tiles, >, 1);
+  g_assert_cmpint (gimp_tilelayer_n_pending (loaded_image,
+                                             GIMP_TILEIMAGE_LAYER2_NAME),
+                   ==, n_tiles);
+
+  /* Reading a pixel reads its tile only */
+  layer = gimp_image_get_layer_by_name (loaded_image,
+                                        GIMP_TILEIMAGE_LAYER1_NAME);
+  gegl_buffer_get (gimp_drawable_get_buffer (GIMP_DRAWABLE (layer)),
+                   GEGL_RECTANGLE (0, 0, 1, 1), 1.0,
+                   babl_format ("R'G'B'A u8"),
+                   pixel, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  g_assert_cmpint (gimp_tilelayer_n_pending (loaded_image,
+                                             GIMP_TILEIMAGE_LAYER1_NAME),
+                   ==, n_tiles - 1);
+  g_assert_cmpint (gimp_tilelayer_n_pending (loaded_image,
+                                             GIMP_TILEIMAGE_LAYER2_NAME),
+                   ==, n_tiles);
+
+  gimp_assert_tileimage (loaded_image);
+
+  g_assert_cmpint (gimp_tilelayer_n_pending (loaded_image,
+                                             GIMP_TILEIMAGE_LAYER1_NAME),
+                   ==, 0);
+  g_assert_cmpint (gimp_tilelayer_n_pending (loaded_image,
+                                             GIMP_TILEIMAGE_LAYER2_NAME),
+                   ==, 0);
+
+  g_object_unref (loaded_image);
+  g_object_unref (image);
+
+  g_unlink (uri);
+  g_free (uri);
+}
+
+/**
+ * lazy_load_save_over_source:
+ * @data:
+ *
+ * Saves a lazily loaded image over the file it was loaded from. The
+ * new file is renamed over the old one, so the tiles which weren't
+ * read yet must still come from the old contents.
+ **/
+static void
+lazy_load_save_over_source (gconstpointer data)
+{
+  Gimp              *gimp           = GIMP (data);
+  GimpImage         *image          = NULL;
+  GimpImage         *loaded_image   = NULL;
+  GimpImage         *reloaded_image = NULL;
+  gchar             *uri            = NULL;
+  GimpThumbnailSize  thumbnail_size = GIMP_THUMBNAIL_SIZE_NONE;
+
+  image = gimp_create_tileimage (gimp, GIMP_PRECISION_U8_GAMMA);
+
+  uri = g_build_filename (g_get_tmp_dir (), "gimp-test-lazy.xcf", NULL);
+  gimp_test_save_image (image, uri);
+
+  loaded_image = gimp_test_load_image (gimp, uri);
+  g_assert (loaded_image != NULL);
+
+  /* Rendering the thumbnail of the saved file would read all tiles */
+  g_object_get (gimp->config, "thumbnail-size", &thumbnail_size, NULL);
+  g_object_set (gimp->config,
+                "thumbnail-size", GIMP_THUMBNAIL_SIZE_NONE,
+                NULL);
+
+  gimp_test_save_image (loaded_image, uri);
+
+  g_object_set (gimp->config, "thumbnail-size", thumbnail_size, NULL);
+
+#ifndef G_OS_WIN32
+  g_assert_cmpint (gimp_tilelayer_n_pending (loaded_image,
+                                             GIMP_TILEIMAGE_LAYER1_NAME),
+                   >, 0);
+#endif
+
+  gimp_assert_tileimage (loaded_image);
+
+  reloaded_image = gimp_test_load_image (gimp, uri);
+  g_assert (reloaded_image != NULL);
+  gimp_assert_tileimage (reloaded_image);
+
+  g_object_unref (reloaded_image);
+  g_object_unref (loaded_image);
+  g_object_unref (image);
+
+  g_unlink (uri);
+  g_free (uri);
+}
+
+/**
+ * lazy_load_save_over_linked_source:
+ * @data:
+ *
+ * Saves a lazily loaded image over the file it was loaded from when
+ * that file has a second name. Renaming would break the link, so the
+ * file is overwritten in place, and xcf_tile_handler_load_all() has
+ * to read all remaining tiles first.
+ **/
+static void
+lazy_load_save_over_linked_source (gconstpointer data)
+{
+  Gimp      *gimp           = GIMP (data);
+  GimpImage *image          = NULL;
+  GimpImage *loaded_image   = NULL;
+  GimpImage *reloaded_image = NULL;
+  gchar     *uri            = NULL;
+  gchar     *link_uri       = NULL;
+
+  image = gimp_create_tileimage (gimp, GIMP_PRECISION_U8_GAMMA);
+
+  uri      = g_build_filename (g_get_tmp_dir (), "gimp-test-lazy.xcf", NULL);
+  link_uri = g_build_filename (g_get_tmp_dir (), "gimp-test-lazy-link.xcf",
+                               NULL);
+  gimp_test_save_image (image, uri);
+
+#ifndef G_OS_WIN32
+  g_unlink (link_uri);
+  g_assert_cmpint (link (uri, link_uri), ==, 0);
+#endif
+
+  loaded_image = gimp_test_load_image (gimp, uri);
+  g_assert (loaded_image != NULL);
+  g_assert_cmpint (gimp_tilelayer_n_pending (loaded_image,
+                                             GIMP_TILEIMAGE_LAYER1_NAME),
+                   >, 0);
+
+  gimp_test_save_image (loaded_image, uri);
+
+  g_assert_cmpint (gimp_tilelayer_n_pending (loaded_image,
+                                             GIMP_TILEIMAGE_LAYER1_NAME),
+                   ==, 0);
+  g_assert_cmpint (gimp_tilelayer_n_pending (loaded_image,
+                                             GIMP_TILEIMAGE_LAYER2_NAME),
+                   ==, 0);
+
+  gimp_assert_tileimage (loaded_image);
+
+  reloaded_image = gimp_test_load_image (gimp, uri);
+  g_assert (reloaded_image != NULL);
+  gimp_assert_tileimage (reloaded_image);
+
+  g_object_unref (reloaded_image);
+  g_object_unref (loaded_image);
+  g_object_unref (image);
+
+  g_unlink (link_uri);
+  g_unlink (uri);
+  g_free (link_uri);
+  g_free (uri);
+}
+
+/**
+ * lazy_load_all_before_truncation:
+ * @data:
+ *
+ * Makes sure xcf_tile_handler_load_all() reads all tiles of a lazily
+ * loaded image, so the file can be overwritten afterwards.
+ **/
+static void
+lazy_load_all_before_truncation (gconstpointer data)
+{
+  Gimp      *gimp         = GIMP (data);
+  GimpImage *image        = NULL;
+  GimpImage *loaded_image = NULL;
+  gchar     *uri          = NULL;
+
+  image = gimp_create_tileimage (gimp, GIMP_PRECISION_U8_GAMMA);
+
+  uri = g_build_filename (g_get_tmp_dir (), "gimp-test-lazy.xcf", NULL);
+  gimp_test_save_image (image, uri);
+
+  loaded_image = gimp_test_load_image (gimp, uri);
+  g_assert (loaded_image != NULL);
+
+  xcf_tile_handler_load_all (uri);
+
+  g_assert_cmpint (gimp_tilelayer_n_pending (loaded_image,
+                                             GIMP_TILEIMAGE_LAYER1_NAME),
+                   ==, 0);
+  g_assert_cmpint (gimp_tilelayer_n_pending (loaded_image,
+                                             GIMP_TILEIMAGE_LAYER2_NAME),
+                   ==, 0);
+
+  gimp_test_truncate_file (uri);
+
+  gimp_assert_tileimage (loaded_image);
+
+  g_object_unref (loaded_image);
+  g_object_unref (image);
+
+  g_unlink (uri);
+  g_free (uri);
+}
+
+/**
+ * lazy_load_truncated_file:
+ * @data:
+ *
+ * Truncates the file a lazily loaded image still reads its tiles
+ * from. The tiles can't be read any longer, but reading them must
+ * fail gracefully instead of crashing.
+ **/
+static void
+lazy_load_truncated_file (gconstpointer data)
+{
+  Gimp      *gimp         = GIMP (data);
+  GimpImage *image        = NULL;
+  GimpImage *loaded_image = NULL;
+  gchar     *uri          = NULL;
+
+  image = gimp_create_tileimage (gimp, GIMP_PRECISION_U8_GAMMA);
+
+  uri = g_build_filename (g_get_tmp_dir (), "gimp-test-lazy.xcf", NULL);
+  gimp_test_save_image (image, uri);
+
+  loaded_image = gimp_test_load_image (gimp, uri);
+  g_assert (loaded_image != NULL);
+
+  gimp_test_truncate_file (uri);
+
+  g_test_log_set_fatal_handler (gimp_test_ignore_tile_warnings, NULL);
+
+  gimp_read_tilelayer (loaded_image, GIMP_TILEIMAGE_LAYER1_NAME);
+  gimp_read_tilelayer (loaded_image, GIMP_TILEIMAGE_LAYER2_NAME);
+
+  g_test_log_set_fatal_handler (NULL, NULL);
+
+  g_assert_cmpint (gimp_tilelayer_n_pending (loaded_image,
+                                             GIMP_TILEIMAGE_LAYER1_NAME),
+                   ==, 0);
+  g_assert_cmpint (gimp_tilelayer_n_pending (loaded_image,
+                                             GIMP_TILEIMAGE_LAYER2_NAME),
+                   ==, 0);
+
+  g_object_unref (loaded_image);
+  g_object_unref (image);
+
+  g_unlink (uri);
+  g_free (uri);
+}
+
+/**
+ * reuse_unchanged_tiles:
+ * @data:
+ *
+ * Makes sure the tiles of a loaded or saved layer are copied from its
+ * file when it is saved again, but only as long as the layer doesn't
+ * change and uses the same compression, and that the copied tiles
+ * read back correctly.
+ **/
+static void
+reuse_unchanged_tiles (gconstpointer data)
+{
+  Gimp       *gimp           = GIMP (data);
+  GimpImage  *image          = NULL;
+  GimpImage  *loaded_image   = NULL;
+  GimpImage  *reloaded_image = NULL;
+  GeglBuffer *buffer1        = NULL;
+  GeglBuffer *buffer2        = NULL;
+  gchar      *uri            = NULL;
+  gchar      *copy_uri       = NULL;
+
+  image = gimp_create_tileimage (gimp, GIMP_PRECISION_U8_GAMMA);
+
+  uri      = g_build_filename (g_get_tmp_dir (), "gimp-test-records.xcf",
+                               NULL);
+  copy_uri = g_build_filename (g_get_tmp_dir (), "gimp-test-records-copy.xcf",
+                               NULL);
+  gimp_test_save_image (image, uri);
+
+  /* Saving records where the tiles went */
+  buffer1 = gimp_tilelayer_buffer (image, GIMP_TILEIMAGE_LAYER1_NAME);
+  g_assert (xcf_tile_record_get (buffer1, COMPRESS_RLE) != NULL);
+  g_assert (xcf_tile_record_get (buffer1, COMPRESS_ZLIB) == NULL);
+
+  /* So does loading */
+  loaded_image = gimp_test_load_image (gimp, uri);
+  g_assert (loaded_image != NULL);
+
+  buffer1 = gimp_tilelayer_buffer (loaded_image, GIMP_TILEIMAGE_LAYER1_NAME);
+  buffer2 = gimp_tilelayer_buffer (loaded_image, GIMP_TILEIMAGE_LAYER2_NAME);
+  g_assert (xcf_tile_record_get (buffer1, COMPRESS_RLE) != NULL);
+  g_assert (xcf_tile_record_get (buffer2, COMPRESS_RLE) != NULL);
+  g_assert (xcf_tile_records_use_file (uri));
+
+  /* A changed layer can't use its old tiles */
+  gimp_fill_tilelayer (loaded_image, GIMP_TILEIMAGE_LAYER1_NAME, 3);
+  g_assert (xcf_tile_record_get (buffer1, COMPRESS_RLE) == NULL);
+  g_assert (xcf_tile_record_get (buffer2, COMPRESS_RLE) != NULL);
+
+  /* The tiles of layer2 are copied, the ones of layer1 encoded */
+  gimp_test_save_image (loaded_image, copy_uri);
+  g_assert (xcf_tile_record_get (buffer1, COMPRESS_RLE) != NULL);
+  g_assert (xcf_tile_record_get (buffer2, COMPRESS_RLE) != NULL);
+  g_assert (xcf_tile_records_use_file (copy_uri));
+
+  reloaded_image = gimp_test_load_image (gimp, copy_uri);
+  g_assert (reloaded_image != NULL);
+  gimp_assert_tilelayer (reloaded_image, GIMP_TILEIMAGE_LAYER1_NAME, 3);
+  gimp_assert_tilelayer (reloaded_image,
+                         GIMP_TILEIMAGE_LAYER2_NAME,
+                         GIMP_TILEIMAGE_LAYER2_SEED);
+  g_object_unref (reloaded_image);
+
+  /* Tiles with another compression are encoded again */
+  gimp_image_set_xcf_compression (loaded_image, TRUE);
+  gimp_test_save_image (loaded_image, copy_uri);
+  gimp_assert_xcf_version (copy_uri, 6);
+  g_assert (xcf_tile_record_get (buffer2, COMPRESS_RLE) == NULL);
+  g_assert (xcf_tile_record_get (buffer2, COMPRESS_ZLIB) != NULL);
+
+  reloaded_image = gimp_test_load_image (gimp, copy_uri);
+  g_assert (reloaded_image != NULL);
+  gimp_assert_tilelayer (reloaded_image, GIMP_TILEIMAGE_LAYER1_NAME, 3);
+  gimp_assert_tilelayer (reloaded_image,
+                         GIMP_TILEIMAGE_LAYER2_NAME,
+                         GIMP_TILEIMAGE_LAYER2_SEED);
+  g_object_unref (reloaded_image);
+
+  g_object_unref (loaded_image);
+  g_object_unref (image);
+
+  g_unlink (copy_uri);
+  g_unlink (uri);
+  g_free (copy_uri);
+  g_free (uri);
+}
+
+/**
+ * save_async_snapshot:
+ * @data:
+ *
+ * Saves an image in the background and edits it while it is being
+ * saved. The file must have the image as it was when the save
+ * started, and the image must stay dirty.
+ **/
+static void
+save_async_snapshot (gconstpointer data)
+{
+  Gimp                *gimp         = GIMP (data);
+  GimpImage           *image        = NULL;
+  GimpImage           *loaded_image = NULL;
+  GimpPlugInProcedure *proc         = NULL;
+  gchar               *filename     = NULL;
+  gchar               *uri          = NULL;
+  GimpTestAsyncSave    save         = { 0, };
+  GimpTestAsyncSave    second_save  = { 0, };
+  GError              *error        = NULL;
+
+  image = gimp_create_tileimage (gimp, GIMP_PRECISION_U8_GAMMA);
+  gimp_image_clean_all (image);
+
+  filename = g_build_filename (g_get_tmp_dir (), "gimp-test-async.xcf", NULL);
+  uri      = g_filename_to_uri (filename, NULL, NULL);
+
+  gimp_test_save_image_async (image, uri, &save);
+
+  /* A second save has to wait for the first one */
+  proc = file_procedure_find (gimp->plug_in_manager->save_procs,
+                              uri,
+                              NULL /*error*/);
+  g_assert (! file_save_async (gimp,
+                               image,
+                               NULL /*progress*/,
+                               uri,
+                               proc,
+                               gimp_test_async_save_done,
+                               &second_save,
+                               &error));
+  g_assert (error != NULL);
+  g_clear_error (&error);
+
+  /* Edit while the snapshot is written */
+  gimp_fill_tilelayer (image, GIMP_TILEIMAGE_LAYER1_NAME, 3);
+  gimp_image_dirty (image, GIMP_DIRTY_DRAWABLE);
+
+  gimp_test_wait_for_async_save (&save);
+
+  g_assert_cmpint (save.status, ==, GIMP_PDB_SUCCESS);
+  g_assert (! second_save.done);
+  g_assert (gimp_image_is_dirty (image));
+
+  loaded_image = gimp_test_load_image (gimp, filename);
+  g_assert (loaded_image != NULL);
+  gimp_assert_tileimage (loaded_image);
+  g_object_unref (loaded_image);
+
+  /* Only the unchanged layer can copy its tiles from the new file */
+  g_assert (xcf_tile_record_get (gimp_tilelayer_buffer (image,
+                                                        GIMP_TILEIMAGE_LAYER1_NAME),
+                                 COMPRESS_RLE) == NULL);
+  g_assert (xcf_tile_record_get (gimp_tilelayer_buffer (image,
+                                                        GIMP_TILEIMAGE_LAYER2_NAME),
+                                 COMPRESS_RLE) != NULL);
+
+  /* Without edits, the save leaves the image clean */
+  gimp_test_save_image_async (image, uri, &save);
+  gimp_test_wait_for_async_save (&save);
+
+  g_assert_cmpint (save.status, ==, GIMP_PDB_SUCCESS);
+  g_assert (! gimp_image_is_dirty (image));
+
+  loaded_image = gimp_test_load_image (gimp, filename);
+  g_assert (loaded_image != NULL);
+  gimp_assert_tilelayer (loaded_image, GIMP_TILEIMAGE_LAYER1_NAME, 3);
+  gimp_assert_tilelayer (loaded_image,
+                         GIMP_TILEIMAGE_LAYER2_NAME,
+                         GIMP_TILEIMAGE_LAYER2_SEED);
+  g_object_unref (loaded_image);
+
+  g_object_unref (image);
+
+  g_unlink (filename);
+  g_free (filename);
+  g_free (uri);
+}
+
+GimpImage *
+gimp_test_load_image (Gimp        *gimp,
+                      const gchar *uri)
+{
+  GimpPlugInProcedure *proc     = NULL;
+  GimpImage           *image    = NULL;
+  GimpPDBStatusType    not_used = 0;
+
+  proc = file_procedure_find (gimp->plug_in_manager->load_procs,
+                              uri,
+                              NULL /*error*/);
+  image = file_open_image (gimp,
+                           gimp_get_user_context (gimp),
+                           NULL /*progress*/,
+                           uri,
+                           "irrelevant" /*entered_filename*/,
+                           FALSE /*as_new*/,
+                           proc,
+                           GIMP_RUN_NONINTERACTIVE,
+                           &not_used /*status*/,
+                           NULL /*mime_type*/,
+                           NULL /*error*/);
+
+  return image;
+}
+
+/**
+ * gimp_write_and_read_file:
+ *
+ * Constructs the main test image and asserts its state, writes it to
+ * a file, reads the image from the file, and asserts the state of the
+ * loaded file. The function takes various parameters so the same
+ * function can be used for different formats.
+ **/
+static void
+gimp_write_and_read_file (Gimp     *gimp,
+                          gboolean  with_unusual_stuff,
+                          gboolean  compat_paths,
+                          gboolean  use_gimp_2_8_features)
+{
+  GimpImage           *image        = NULL;
+  GimpImage           *loaded_image = NULL;
+  GimpPlugInProcedure *proc         = NULL;
+  gchar               *uri          = NULL;
+
+  /* Create the image */
+  image = gimp_create_mainimage (gimp,
+                                 with_unusual_stuff,
+                                 compat_paths,
+                                 use_gimp_2_8_features);
+
+  /* Assert valid state */
+  gimp_assert_mainimage (image,
+                         with_unusual_stuff,
+                         compat_paths,
+                         use_gimp_2_8_features);
+
+  /* Write to file */
+  uri  = g_build_filename (g_get_tmp_dir (), "gimp-test.xcf", NULL);
+  proc = file_procedure_find (image->gimp->plug_in_manager->save_procs,
+                              uri,
+                              NULL /*error*/);
+  file_save (gimp,
+             image,
+             NULL /*progress*/,
+             uri,
+             proc,
+             GIMP_RUN_NONINTERACTIVE,
+             FALSE /*change_saved_state*/,
+             FALSE /*export_backward*/,
+             FALSE /*export_forward*/,
+             NULL /*error*/);
+
+  /* Load from file */
+  loaded_image = gimp_test_load_image (image->gimp, uri);
+
+  /* Assert on the loaded file. If success, it means that there is no
+   * significant information loss when we wrote the image to a file
+   * and loaded it again
+   */
+  gimp_assert_mainimage (loaded_image,
+                         with_unusual_stuff,
+                         compat_paths,
+                         use_gimp_2_8_features);
+
+  g_unlink (uri);
+  g_free (uri);
+}
+
+/**
+ * gimp_write_and_read_tileimage:
+ *
+ * Writes the tile test image with the given precision and tile
+ * compression, checks the XCF version it needs, reads the file and
+ * asserts that no pixel changed.
+ **/
+static void
+gimp_write_and_read_tileimage (Gimp          *gimp,
+                               GimpPrecision  precision,
+                               gboolean       zlib_compression)
+{
+  GimpImage *image        = NULL;
+  GimpImage *loaded_image = NULL;
+  gchar     *uri          = NULL;
+  gint       version      = 0;
+
+  image = gimp_create_tileimage (gimp, precision);
+  gimp_image_set_xcf_compression (image, zlib_compression);
+
+  uri = g_build_filename (g_get_tmp_dir (), "gimp-test-tiles.xcf", NULL);
+  gimp_test_save_image (image, uri);
+
+  if (zlib_compression)
+    version = 6;
+  else if (precision != GIMP_PRECISION_U8_GAMMA)
+    version = 5;
+
+  gimp_assert_xcf_version (uri, version);
+
+  loaded_image = gimp_test_load_image (gimp, uri);
+
+  g_assert (loaded_image != NULL);
+  g_assert_cmpint (gimp_image_get_precision (loaded_image), ==, precision);
+  g_assert_cmpint (gimp_image_get_xcf_compression (loaded_image),
+                   ==,
+                   zlib_compression);
+  gimp_assert_tileimage (loaded_image);
+
+  g_object_unref (loaded_image);
+  g_object_unref (image);
+
+  g_unlink (uri);
+  g_free (uri);
+}
+
+/**
+ * gimp_create_mainimage:
+ *
+ * Creates the main test image, i.e. the image that we use for most of
+ * our XCF testing purposes.
+ *
+ * Returns: The #GimpImage
+ **/
+static GimpImage *
+gimp_create_mainimage (Gimp     *gimp,
+                       gboolean  with_unusual_stuff,
+                       gboolean  compat_paths,
+                       gboolean  use_gimp_2_8_features)
+{
+  GimpImage     *image             = NULL;
+  GimpLayer     *layer             = NULL;
+  GimpParasite  *parasite          = NULL;
+  GimpGrid      *grid              = NULL;
+  GimpChannel   *channel           = NULL;
+  GimpRGB        channel_color     = GIMP_MAINIMAGE_CHANNEL1_COLOR;
+  GimpChannel   *selection         = NULL;
+  GimpVectors   *vectors           = NULL;
+  GimpCoords     vectors1_coords[] = GIMP_MAINIMAGE_VECTORS1_COORDS;
+  GimpCoords     vectors2_coords[] = GIMP_MAINIMAGE_VECTORS2_COORDS;
+  GimpStroke    *stroke            = NULL;
+  GimpLayerMask *layer_mask        = NULL;
+
+  /* Image size and type */
+  image = gimp_image_new (gimp,
+                          GIMP_MAINIMAGE_WIDTH,
+                          GIMP_MAINIMAGE_HEIGHT,
+                          GIMP_MAINIMAGE_TYPE,
+                          GIMP_MAINIMAGE_PRECISION);
+
+  /* Layers */
+  layer = gimp_layer_new (image,
+                          GIMP_MAINIMAGE_LAYER1_WIDTH,
+                          GIMP_MAINIMAGE_LAYER1_HEIGHT,
+                          GIMP_MAINIMAGE_LAYER1_FORMAT,
+                          GIMP_MAINIMAGE_LAYER1_NAME,
+                          GIMP_MAINIMAGE_LAYER1_OPACITY,
+                          GIMP_MAINIMAGE_LAYER1_MODE);
+  gimp_image_add_layer (image,
+                        layer,
+                        NULL,
+                        0,
+                        FALSE/*push_undo*/);
+  layer = gimp_layer_new (image,
+                          GIMP_MAINIMAGE_LAYER2_WIDTH,
+                          GIMP_MAINIMAGE_LAYER2_HEIGHT,
+                          GIMP_MAINIMAGE_LAYER2_FORMAT,
+                          GIMP_MAINIMAGE_LAYER2_NAME,
+                          GIMP_MAINIMAGE_LAYER2_OPACITY,
+                          GIMP_MAINIMAGE_LAYER2_MODE);
+  gimp_image_add_layer (image,
+                        layer,
+                        NULL,
+                        0,
+                        FALSE /*push_undo*/);
+
+  /* Layer mask */
+  layer_mask = gimp_layer_create_mask (layer,
+                                       GIMP_ADD_BLACK_MASK,
+                                       NULL /*channel*/);
+  gimp_layer_add_mask (layer,
+                       layer_mask,
+                       FALSE /*push_undo*/,
+                       NULL /*error*/);
+
+  /* Image compression type
+   *
+   * We don't do any explicit test, only implicit when we read tile
+   * data in other tests
+   */
+
+  /* Guides, note we add them in reversed order */
+  gimp_image_add_hguide (image,
+                         GIMP_MAINIMAGE_HGUIDE2_POS,
+                         FALSE /*push_undo*/);
+  gimp_image_add_hguide (image,
+                         GIMP_MAINIMAGE_HGUIDE1_POS,
+                         FALSE /*push_undo*/);
+  gimp_image_add_vguide (image,
+                         GIMP_MAINIMAGE_VGUIDE2_POS,
+                         FALSE /*push_undo*/);
+  gimp_image_add_vguide (image,
+                         GIMP_MAINIMAGE_VGUIDE1_POS,
+                         FALSE /*push_undo*/);
+
+
+  /* Sample points */
+  gimp_image_add_sample_point_at_pos (image,
+                                      GIMP_MAINIMAGE_SAMPLEPOINT1_X,
+                                      GIMP_MAINIMAGE_SAMPLEPOINT1_Y,
+                                      FALSE /*push_undo*/);
+  gimp_image_add_sample_point_at_pos (image,
+                                      GIMP_MAINIMAGE_SAMPLEPOINT2_X,
+                                      GIMP_MAINIMAGE_SAMPLEPOINT2_Y,
+                                      FALSE /*push_undo*/);
+
+  /* Tatto
+   * We don't bother testing this, not yet at least
+   */
+
+  /* Resolution */
+  gimp_image_set_resolution (image,
+                             GIMP_MAINIMAGE_RESOLUTIONX,
+                             GIMP_MAINIMAGE_RESOLUTIONY);
+
+
+  /* Parasites */
+  parasite = gimp_parasite_new (GIMP_MAINIMAGE_PARASITE_NAME,
+                                GIMP_PARASITE_PERSISTENT,
+                                GIMP_MAINIMAGE_PARASITE_SIZE,
+                                GIMP_MAINIMAGE_PARASITE_DATA);
+  gimp_image_parasite_attach (image,
+                              parasite);
+  gimp_parasite_free (parasite);
+  parasite = gimp_parasite_new ("gimp-comment",
+                                GIMP_PARASITE_PERSISTENT,
+                                strlen (GIMP_MAINIMAGE_COMMENT) + 1,
+                                GIMP_MAINIMAGE_COMMENT);
+  gimp_image_parasite_attach (image, parasite);
+  gimp_parasite_free (parasite);
+
+
+  /* Unit */
+  gimp_image_set_unit (image,
+                       GIMP_MAINIMAGE_UNIT);
+
+  /* Grid */
+  grid = g_object_new (GIMP_TYPE_GRID,
+                       "xspacing", GIMP_MAINIMAGE_GRIDXSPACING,
+                       "yspacing", GIMP_MAINIMAGE_GRIDYSPACING,
+                       NULL);
+  gimp_image_set_grid (image,
+                       grid,
+                       FALSE /*push_undo*/);
+  g_object_unref (grid);
+
+  /* Channel */
+  channel = gimp_channel_new (image,
+                              GIMP_MAINIMAGE_CHANNEL1_WIDTH,
+                              GIMP_MAINIMAGE_CHANNEL1_HEIGHT,
+                              GIMP_MAINIMAGE_CHANNEL1_NAME,
+                              &channel_color);
+  gimp_image_add_channel (image,
+                          channel,
+                          NULL,
+                          -1,
+                          FALSE /*push_undo*/);
+
+  /* Selection */
+  selection = gimp_image_get_mask (image);
+  gimp_channel_select_rectangle (selection,
+                                 GIMP_MAINIMAGE_SELECTION_X,
+                                 GIMP_MAINIMAGE_SELECTION_Y,
+                                 GIMP_MAINIMAGE_SELECTION_W,
+                                 GIMP_MAINIMAGE_SELECTION_H,
+                                 GIMP_CHANNEL_OP_REPLACE,
+                                 FALSE /*feather*/,
+                                 0.0 /*feather_radius_x*/,
+                                 0.0 /*feather_radius_y*/,
+                                 FALSE /*push_undo*/);
+
+  /* Vectors 1 */
+  vectors = gimp_vectors_new (image,
+                              GIMP_MAINIMAGE_VECTORS1_NAME);
+  /* The XCF file can save vectors in two kind of ways, one old way
+   * and a new way. Parameterize the way so we can test both variants,
+   * i.e. gimp_vectors_compat_is_compatible() must return both TRUE
+   * and FALSE.
+   */
+  if (! compat_paths)
+    {
+      gimp_item_set_visible (GIMP_ITEM (vectors),
+                             TRUE,
+                             FALSE /*push_undo*/);
+    }
+  /* TODO: Add test for non-closed stroke. The order of the anchor
+   * points changes for open strokes, so it's boring to test
+   */
+  stroke = gimp_bezier_stroke_new_from_coords (vectors1_coords,
+                                               G_N_ELEMENTS (vectors1_coords),
+                                               TRUE /*closed*/);
+  gimp_vectors_stroke_add (vectors, stroke);
+  gimp_image_add_vectors (image,
+                          vectors,
+                          NULL /*parent*/,
+                          -1 /*position*/,
+                          FALSE /*push_undo*/);
+
+  /* Vectors 2 */
+  vectors = gimp_vectors_new (image,
+                              GIMP_MAINIMAGE_VECTORS2_NAME);
+
+  stroke = gimp_bezier_stroke_new_from_coords (vectors2_coords,
+                                               G_N_ELEMENTS (vectors2_coords),
+                                               TRUE /*closed*/);
+  gimp_vectors_stroke_add (vectors, stroke);
+  gimp_image_add_vectors (image,
+                          vectors,
+                          NULL /*parent*/,
+                          -1 /*position*/,
+                          FALSE /*push_undo*/);
+
+  /* Some of these things are pretty unusual, parameterize the
+   * inclusion of this in the written file so we can do our test both
+   * with and without
+   */
+  if (with_unusual_stuff)
+    {
+      /* Floating selection */
+      gimp_selection_float (GIMP_SELECTION (gimp_image_get_mask (image)),
+                            gimp_image_get_active_drawable (image),
+                            gimp_get_user_context (gimp),
+                            TRUE /*cut_image*/,
+                            0 /*off_x*/,
+                            0 /*off_y*/,
+                            NULL /*error*/);
+    }
+
+  /* Adds stuff like layer groups */
+  if (use_gimp_2_8_features)
+    {
+      GimpLayer *parent;
+
+      /* Add a layer group and some layers:
+       *
+       *  group1
+       *    layer3
+       *    layer4
+       *    group2
+       *      layer5
+       */
+
+      /* group1 */
+      layer = gimp_group_layer_new (image);
+      gimp_object_set_name (GIMP_OBJECT (layer), GIMP_MAINIMAGE_GROUP1_NAME);
+      gimp_image_add_layer (image,
+                            layer,
+                            NULL /*parent*/,
+                            -1 /*position*/,
+                            FALSE /*push_undo*/);
+      parent = layer;
+
+      /* layer3 */
+      layer = gimp_layer_new (image,
+                              GIMP_MAINIMAGE_LAYER1_WIDTH,
+                              GIMP_MAINIMAGE_LAYER1_HEIGHT,
+                              GIMP_MAINIMAGE_LAYER1_FORMAT,
+                              GIMP_MAINIMAGE_LAYER3_NAME,
+                              GIMP_MAINIMAGE_LAYER1_OPACITY,
+                              GIMP_MAINIMAGE_LAYER1_MODE);
+      gimp_image_add_layer (image,
+                            layer,
+                            parent,
+                            -1 /*position*/,
+                            FALSE /*push_undo*/);
+
+      /* layer4 */
+      layer = gimp_layer_new (image,
+                              GIMP_MAINIMAGE_LAYER1_WIDTH,
+                              GIMP_MAINIMAGE_LAYER1_HEIGHT,
+                              GIMP_MAINIMAGE_LAYER1_FORMAT,
+                              GIMP_MAINIMAGE_LAYER4_NAME,
+                              GIMP_MAINIMAGE_LAYER1_OPACITY,
+                              GIMP_MAINIMAGE_LAYER1_MODE);
+      gimp_image_add_layer (image,
+                            layer,
+                            parent,
+                            -1 /*position*/,
+                            FALSE /*push_undo*/);
+
+      /* group2 */
+      layer = gimp_group_layer_new (image);
+      gimp_object_set_name (GIMP_OBJECT (layer), GIMP_MAINIMAGE_GROUP2_NAME);
+      gimp_image_add_layer (image,
+                            layer,
+                            parent,
+                            -1 /*position*/,
+                            FALSE /*push_undo*/);
+      parent = layer;
+
+      /* layer5 */
+      layer = gimp_layer_new (image,
+                              GIMP_MAINIMAGE_LAYER1_WIDTH,
+                              GIMP_MAINIMAGE_LAYER1_HEIGHT,
+                              GIMP_MAINIMAGE_LAYER1_FORMAT,
+                              GIMP_MAINIMAGE_LAYER5_NAME,
+                              GIMP_MAINIMAGE_LAYER1_OPACITY,
+                              GIMP_MAINIMAGE_LAYER1_MODE);
+      gimp_image_add_layer (image,
+                            layer,
+                            parent,
+                            -1 /*position*/,
+                            FALSE /*push_undo*/);
+    }
+
+  /* Todo, should be tested somehow:
+   *
+   * - Color maps
+   * - Custom user units
+   * - Text layers
+   * - Layer parasites
+   * - Channel parasites
+   * - Different tile compression methods
+   */
+
+  return image;
+}
+
+static void
+gimp_assert_vectors (GimpImage   *image,
+                     const gchar *name,
+                     GimpCoords   coords[],
+                     gsize        coords_size,
+                     gboolean     visible)
+{
+  GimpVectors *vectors        = NULL;
+  GimpStroke  *stroke         = NULL;
+  GArray      *control_points = NULL;
+  gboolean     closed         = FALSE;
+  gint         i              = 0;
+
+  vectors = gimp_image_get_vectors_by_name (image, name);
+  stroke = gimp_vectors_stroke_get_next (vectors, NULL);
+  g_assert (stroke != NULL);
+  control_points = gimp_stroke_control_points_get (stroke,
+                                                   &closed);
+  g_assert (closed);
+  g_assert_cmpint (control_points->len,
+                   ==,
+                   coords_size);
+  for (i = 0; i < control_points->len; i++)
+    {
+      g_assert_cmpint (coords[i].x,
+                       ==,
+                       g_array_index (control_points,
+                                      GimpAnchor,
+                                      i).position.x);
+      g_assert_cmpint (coords[i].y,
+                       ==,
+                       g_array_index (control_points,
+                                      GimpAnchor,
+                                      i).position.y);
+    }
+
+  g_assert (gimp_item_get_visible (GIMP_ITEM (vectors)) ? TRUE : FALSE ==
+            visible ? TRUE : FALSE);
+}
+
+/**
+ * gimp_assert_mainimage:
+ * @image:
+ *
+ * Verifies that the passed #GimpImage contains all the information
+ * that was put in it by gimp_create_mainimage().
+ **/
+static void
+gimp_assert_mainimage (GimpImage *image,
+                       gboolean   with_unusual_stuff,
+                       gboolean   compat_paths,
+                       gboolean   use_gimp_2_8_features)
+{
+  const GimpParasite *parasite               = NULL;
+  GimpLayer          *layer                  = NULL;
+  GList              *iter                   = NULL;
+  GimpGuide          *guide                  = NULL;
+  GimpSamplePoint    *sample_point           = NULL;
+  gdouble             xres                   = 0.0;
+  gdouble             yres                   = 0.0;
+  GimpGrid           *grid                   = NULL;
+  gdouble             xspacing               = 0.0;
+  gdouble             yspacing               = 0.0;
+  GimpChannel        *channel                = NULL;
+  GimpRGB             expected_channel_color = GIMP_MAINIMAGE_CHANNEL1_COLOR;
+  GimpRGB             actual_channel_color   = { 0, };
+  GimpChannel        *selection              = NULL;
+  gint                x1                     = -1;
+  gint                y1                     = -1;
+  gint                x2                     = -1;
+  gint                y2                     = -1;
+  gint                w                      = -1;
+  gint                h                      = -1;
+  GimpCoords          vectors1_coords[]      = GIMP_MAINIMAGE_VECTORS1_COORDS;
+  GimpCoords          vectors2_coords[]      = GIMP_MAINIMAGE_VECTORS2_COORDS;
+
+  /* Image size and type */
+  g_assert_cmpint (gimp_image_get_width (image),
+                   ==,
+                   GIMP_MAINIMAGE_WIDTH);
+  g_assert_cmpint (gimp_image_get_height (image),
+                   ==,
+                   GIMP_MAINIMAGE_HEIGHT);
+  g_assert_cmpint (gimp_image_get_base_type (image),
+                   ==,
+                   GIMP_MAINIMAGE_TYPE);
+
+  /* Layers */
+  layer = gimp_image_get_layer_by_name (image,
+                                        GIMP_MAINIMAGE_LAYER1_NAME);
+  g_assert_cmpint (gimp_item_get_width (GIMP_ITEM (layer)),
+                   ==,
+                   GIMP_MAINIMAGE_LAYER1_WIDTH);
+  g_assert_cmpint (gimp_item_get_height (GIMP_ITEM (layer)),
+                   ==,
+                   GIMP_MAINIMAGE_LAYER1_HEIGHT);
+  g_assert_cmpstr (babl_get_name (gimp_drawable_get_format (GIMP_DRAWABLE (layer))),
+                   ==,
+                   babl_get_name (GIMP_MAINIMAGE_LAYER1_FORMAT));
+  g_assert_cmpstr (gimp_object_get_name (GIMP_DRAWABLE (layer)),
+                   ==,
+                   GIMP_MAINIMAGE_LAYER1_NAME);
+  g_assert_cmpfloat (gimp_layer_get_opacity (layer),
+                     ==,
+                     GIMP_MAINIMAGE_LAYER1_OPACITY);
+  g_assert_cmpint (gimp_layer_get_mode (layer),
+                   ==,
+                   GIMP_MAINIMAGE_LAYER1_MODE);
+  layer = gimp_image_get_layer_by_name (image,
+                                        GIMP_MAINIMAGE_LAYER2_NAME);
+  g_assert_cmpint (gimp_item_get_width (GIMP_ITEM (layer)),
+                   ==,
+                   GIMP_MAINIMAGE_LAYER2_WIDTH);
+  g_assert_cmpint (gimp_item_get_height (GIMP_ITEM (layer)),
+                   ==,
+                   GIMP_MAINIMAGE_LAYER2_HEIGHT);
+  g_assert_cmpstr (babl_get_name (gimp_drawable_get_format (GIMP_DRAWABLE (layer))),
+                   ==,
+                   babl_get_name (GIMP_MAINIMAGE_LAYER2_FORMAT));
+  g_assert_cmpstr (gimp_object_get_name (GIMP_DRAWABLE (layer)),
+                   ==,
+                   GIMP_MAINIMAGE_LAYER2_NAME);
+  g_assert_cmpfloat (gimp_layer_get_opacity (layer),
+                     ==,
+                     GIMP_MAINIMAGE_LAYER2_OPACITY);
+  g_assert_cmpint (gimp_layer_get_mode (layer),
+                   ==,
+                   GIMP_MAINIMAGE_LAYER2_MODE);
+
+  /* Guides, note that we rely on internal ordering */
+  iter = gimp_image_get_guides (image);
+  g_assert (iter != NULL);
+  guide = GIMP_GUIDE (iter->data);
+  g_assert_cmpint (gimp_guide_get_position (guide),
+                   ==,
+                   GIMP_MAINIMAGE_VGUIDE1_POS);
+  iter = g_list_next (iter);
+  g_assert (iter != NULL);
+  guide = GIMP_GUIDE (iter->data);
+  g_assert_cmpint (gimp_guide_get_position (guide),
+                   ==,
+                   GIMP_MAINIMAGE_VGUIDE2_POS);
+  iter = g_list_next (iter);
+  g_assert (iter != NULL);
+  guide = GIMP_GUIDE (iter->data);
+  g_assert_cmpint (gimp_guide_get_position (guide),
+                   ==,
+                   GIMP_MAINIMAGE_HGUIDE1_POS);
+  iter = g_list_next (iter);
+  g_assert (iter != NULL);
+  guide = GIMP_GUIDE (iter->data);
+  g_assert_cmpint (gimp_guide_get_position (guide),
+                   ==,
+                   GIMP_MAINIMAGE_HGUIDE2_POS);
+  iter = g_list_next (iter);
+  g_assert (iter == NULL);
+
+  /* Sample points, we rely on the same ordering as when we added
+   * them, although this ordering is not a necessaity
+   */
+  iter = gimp_image_get_sample_points (image);
+  g_assert (iter != NULL);
+  sample_point = (GimpSamplePoint *) iter->data;
+  g_assert_cmpint (sample_point->x,
+                   ==,
+                   GIMP_MAINIMAGE_SAMPLEPOINT1_X);
+  g_assert_cmpint (sample_point->y,
+                   ==,
+                   GIMP_MAINIMAGE_SAMPLEPOINT1_Y);
+  iter = g_list_next (iter);
+  g_assert (iter != NULL);
+  sample_point = (GimpSamplePoint *) iter->data;
+  g_assert_cmpint (sample_point->x,
+                   ==,
+                   GIMP_MAINIMAGE_SAMPLEPOINT2_X);
+  g_assert_cmpint (sample_point->y,
+                   ==,
+                   GIMP_MAINIMAGE_SAMPLEPOINT2_Y);
+  iter = g_list_next (iter);
+  g_assert (iter == NULL);
+
+  /* Resolution */
+  gimp_image_get_resolution (image, &xres, &yres);
+  g_assert_cmpint (xres,
+                   ==,
+                   GIMP_MAINIMAGE_RESOLUTIONX);
+  g_assert_cmpint (yres,
+                   ==,
+                   GIMP_MAINIMAGE_RESOLUTIONY);
+
+  /* Parasites */
+  parasite = gimp_image_parasite_find (image,
+                                       GIMP_MAINIMAGE_PARASITE_NAME);
+  g_assert_cmpint (gimp_parasite_data_size (parasite),
+                   ==,
+                   GIMP_MAINIMAGE_PARASITE_SIZE);
+  g_assert_cmpstr (gimp_parasite_data (parasite),
+                   ==,
+                   GIMP_MAINIMAGE_PARASITE_DATA);
+  parasite = gimp_image_parasite_find (image,
+                                       "gimp-comment");
+  g_assert_cmpint (gimp_parasite_data_size (parasite),
+                   ==,
+                   strlen (GIMP_MAINIMAGE_COMMENT) + 1);
+  g_assert_cmpstr (gimp_parasite_data (parasite),
+                   ==,
+                   GIMP_MAINIMAGE_COMMENT);
+
+  /* Unit */
+  g_assert_cmpint (gimp_image_get_unit (image),
+                   ==,
+                   GIMP_MAINIMAGE_UNIT);
+
+  /* Grid */
+  grid = gimp_image_get_grid (image);
+  g_object_get (grid,
+                "xspacing", &xspacing,
+                "yspacing", &yspacing,
+                NULL);
+  g_assert_cmpint (xspacing,
+                   ==,
+                   GIMP_MAINIMAGE_GRIDXSPACING);
+  g_assert_cmpint (yspacing,
+                   ==,
+                   GIMP_MAINIMAGE_GRIDYSPACING);
+
+
+  /* Channel */
+  channel = gimp_image_get_channel_by_name (image,
+                                            GIMP_MAINIMAGE_CHANNEL1_NAME);
+  gimp_channel_get_color (channel, &actual_channel_color);
+  g_assert_cmpint (gimp_item_get_width (GIMP_ITEM (channel)),
+                   ==,
+                   GIMP_MAINIMAGE_CHANNEL1_WIDTH);
+  g_assert_cmpint (gimp_item_get_height (GIMP_ITEM (channel)),
+                   ==,
+                   GIMP_MAINIMAGE_CHANNEL1_HEIGHT);
+  g_assert (memcmp (&expected_channel_color,
+                    &actual_channel_color,
+                    sizeof (GimpRGB)) == 0);
+
+  /* Selection, if the image contains unusual stuff it contains a
+   * floating select, and when floating a selection, the selection
+   * mask is cleared, so don't test for the presence of the selection
+   * mask in that case
+   */
+  if (! with_unusual_stuff)
+    {
+      selection = gimp_image_get_mask (image);
+      gimp_channel_bounds (selection, &x1, &y1, &x2, &y2);
+      w = x2 - x1;
+      h = y2 - y1;
+      g_assert_cmpint (x1,
+                       ==,
+                       GIMP_MAINIMAGE_SELECTION_X);
+      g_assert_cmpint (y1,
+                       ==,
+                       GIMP_MAINIMAGE_SELECTION_Y);
+      g_assert_cmpint (w,
+                       ==,
+                       GIMP_MAINIMAGE_SELECTION_W);
+      g_assert_cmpint (h,
+                       ==,
+                       GIMP_MAINIMAGE_SELECTION_H);
+    }
+
+  /* Vectors 1 */
+  gimp_assert_vectors (image,
+                       GIMP_MAINIMAGE_VECTORS1_NAME,
+                       vectors1_coords,
+                       G_N_ELEMENTS (vectors1_coords),
+                       ! compat_paths /*visible*/);
+
+  /* Vectors 2 (always visible FALSE) */
+  gimp_assert_vectors (image,
+                       GIMP_MAINIMAGE_VECTORS2_NAME,
+                       vectors2_coords,
+                       G_N_ELEMENTS (vectors2_coords),
+                       FALSE /*visible*/);
+
+  if (with_unusual_stuff)
+    g_assert (gimp_image_get_floating_selection (image) != NULL);
+  else /* if (! with_unusual_stuff) */
+    g_assert (gimp_image_get_floating_selection (image) == NULL);
+
+  if (use_gimp_2_8_features)
+    {
+      /* Only verify the parent relationships, the layer attributes
+       * are tested above
+       */
+      GimpItem *group1 = GIMP_ITEM (gimp_image_get_layer_by_name (image, GIMP_MAINIMAGE_GROUP1_NAME));
+      GimpItem *layer3 = GIMP_ITEM (gimp_image_get_layer_by_name (image, GIMP_MAINIMAGE_LAYER3_NAME));
+      GimpItem *layer4 = GIMP_ITEM (gimp_image_get_layer_by_name (image, GIMP_MAINIMAGE_LAYER4_NAME));
+      GimpItem *group2 = GIMP_ITEM (gimp_image_get_layer_by_name (image, GIMP_MAINIMAGE_GROUP2_NAME));
+      GimpItem *layer5 = GIMP_ITEM (gimp_image_get_layer_by_name (image, GIMP_MAINIMAGE_LAYER5_NAME));
+
+      g_assert (gimp_item_get_parent (group1) == NULL);
+      g_assert (gimp_item_get_parent (layer3) == group1);
+      g_assert (gimp_item_get_parent (layer4) == group1);
+      g_assert (gimp_item_get_parent (group2) == group1);
+      g_assert (gimp_item_get_parent (layer5) == group2);
+    }
+}
+
+
+/**
+ * gimp_create_tileimage:
+ *
+ * Creates an image with two layers that span several tiles, the
+ * first with and the second without alpha, for the tests that need
+ * pixels to check.
+ *
+ * Returns: The #GimpImage
+ **/
+static GimpImage *
+gimp_create_tileimage (Gimp          *gimp,
+                       GimpPrecision  precision)
+{
+  GimpImage *image = NULL;
+  GimpLayer *layer = NULL;
+
+  image = gimp_image_new (gimp,
+                          GIMP_TILEIMAGE_WIDTH,
+                          GIMP_TILEIMAGE_HEIGHT,
+                          GIMP_RGB,
+                          precision);
+
+  layer = gimp_layer_new (image,
+                          GIMP_TILEIMAGE_WIDTH,
+                          GIMP_TILEIMAGE_HEIGHT,
+                          gimp_image_get_layer_format (image, TRUE),
+                          GIMP_TILEIMAGE_LAYER1_NAME,
+                          GIMP_OPACITY_OPAQUE,
+                          GIMP_NORMAL_MODE);
+  gimp_image_add_layer (image,
+                        layer,
+                        NULL,
+                        0,
+                        FALSE /*push_undo*/);
+  layer = gimp_layer_new (image,
+                          GIMP_TILEIMAGE_WIDTH,
+                          GIMP_TILEIMAGE_HEIGHT,
+                          gimp_image_get_layer_format (image, FALSE),
+                          GIMP_TILEIMAGE_LAYER2_NAME,
+                          GIMP_OPACITY_OPAQUE,
+                          GIMP_NORMAL_MODE);
+  gimp_image_add_layer (image,
+                        layer,
+                        NULL,
+                        0,
+                        FALSE /*push_undo*/);
+
+  gimp_fill_tilelayer (image,
+                       GIMP_TILEIMAGE_LAYER1_NAME,
+                       GIMP_TILEIMAGE_LAYER1_SEED);
+  gimp_fill_tilelayer (image,
+                       GIMP_TILEIMAGE_LAYER2_NAME,
+                       GIMP_TILEIMAGE_LAYER2_SEED);
+
+  return image;
+}
+
+/*  the pixels of a tile image layer: runs in the upper half and
+ *  noise in the lower half, so both compress differently
+ */
+static guchar *
+gimp_tilelayer_pattern (GeglBuffer *buffer,
+                        guint32     seed)
+{
+  const Babl *format = gegl_buffer_get_format (buffer);
+  gint        width  = gegl_buffer_get_width (buffer);
+  gint        height = gegl_buffer_get_height (buffer);
+  gint        stride = width * babl_format_get_bytes_per_pixel (format);
+  guchar     *pixels = g_malloc (stride * height);
+  GRand      *rand   = g_rand_new_with_seed (seed);
+  gint        y;
+
+  for (y = 0; y < height; y++)
+    {
+      guchar *row = pixels + y * stride;
+      gint    i;
+
+      if (y < height / 2)
+        memset (row, (seed * 64 + y) & 0xff, stride);
+      else
+        for (i = 0; i < stride; i++)
+          row[i] = g_rand_int_range (rand, 0, 256);
+    }
+
+  g_rand_free (rand);
+
+  return pixels;
+}
+
+static void
+gimp_fill_tilelayer (GimpImage   *image,
+                     const gchar *name,
+                     guint32      seed)
+{
+  GimpLayer  *layer  = gimp_image_get_layer_by_name (image, name);
+  GeglBuffer *buffer = NULL;
+  guchar     *pixels = NULL;
+
+  g_assert (layer != NULL);
+
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  pixels = gimp_tilelayer_pattern (buffer, seed);
+
+  gegl_buffer_set (buffer, GEGL_RECTANGLE (0, 0,
+                                           gegl_buffer_get_width (buffer),
+                                           gegl_buffer_get_height (buffer)),
+                   0, gegl_buffer_get_format (buffer),
+                   pixels, GEGL_AUTO_ROWSTRIDE);
+
+  g_free (pixels);
+}
+
+static void
+gimp_assert_tilelayer (GimpImage   *image,
+                       const gchar *name,
+                       guint32      seed)
+{
+  GimpLayer  *layer    = gimp_image_get_layer_by_name (image, name);
+  GeglBuffer *buffer   = NULL;
+  guchar     *expected = NULL;
+  guchar     *actual   = NULL;
+  gsize       size     = 0;
+
+  g_assert (layer != NULL);
+
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+
+  g_assert_cmpint (gegl_buffer_get_width (buffer),  ==, GIMP_TILEIMAGE_WIDTH);
+  g_assert_cmpint (gegl_buffer_get_height (buffer), ==, GIMP_TILEIMAGE_HEIGHT);
+
+  expected = gimp_tilelayer_pattern (buffer, seed);
+
+  size   = (GIMP_TILEIMAGE_WIDTH * GIMP_TILEIMAGE_HEIGHT *
+            babl_format_get_bytes_per_pixel (gegl_buffer_get_format (buffer)));
+  actual = g_malloc (size);
+
+  gegl_buffer_get (buffer, GEGL_RECTANGLE (0, 0,
+                                           GIMP_TILEIMAGE_WIDTH,
+                                           GIMP_TILEIMAGE_HEIGHT),
+                   1.0, gegl_buffer_get_format (buffer),
+                   actual, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  g_assert (memcmp (expected, actual, size) == 0);
+
+  g_free (expected);
+  g_free (actual);
+}
+
+static void
+gimp_assert_tileimage (GimpImage *image)
+{
+  g_assert_cmpint (gimp_image_get_width (image),  ==, GIMP_TILEIMAGE_WIDTH);
+  g_assert_cmpint (gimp_image_get_height (image), ==, GIMP_TILEIMAGE_HEIGHT);
+
+  gimp_assert_tilelayer (image,
+                         GIMP_TILEIMAGE_LAYER1_NAME,
+                         GIMP_TILEIMAGE_LAYER1_SEED);
+  gimp_assert_tilelayer (image,
+                         GIMP_TILEIMAGE_LAYER2_NAME,
+                         GIMP_TILEIMAGE_LAYER2_SEED);
+}
+
+static void
+gimp_test_save_image (GimpImage   *image,
+                      const gchar *uri)
+{
+  GimpPlugInProcedure *proc   = NULL;
+  GimpPDBStatusType    status = 0;
+
+  proc   = file_procedure_find (image->gimp->plug_in_manager->save_procs,
+                                uri,
+                                NULL /*error*/);
+  status = file_save (image->gimp,
+                      image,
+                      NULL /*progress*/,
+                      uri,
+                      proc,
+                      GIMP_RUN_NONINTERACTIVE,
+                      FALSE /*change_saved_state*/,
+                      FALSE /*export_backward*/,
+                      FALSE /*export_forward*/,
+                      NULL /*error*/);
+
+  g_assert_cmpint (status, ==, GIMP_PDB_SUCCESS);
+}
+
+/*  saves image the way the XCF save procedure does, except that the
+ *  file gets at least the given version
+ */
+static void
+gimp_test_save_xcf_version (GimpImage   *image,
+                            const gchar *filename,
+                            gint         version)
+{
+  XcfInfo info = { 0, };
+
+  info.gimp        = image->gimp;
+  info.fp          = g_fopen (filename, "wb");
+  info.filename    = filename;
+  info.compression = COMPRESS_RLE;
+
+  g_assert (info.fp != NULL);
+
+  xcf_save_choose_format (&info, image);
+
+  info.file_version     = MAX (info.file_version, version);
+  info.bytes_per_offset = (info.file_version >= 7) ? 8 : 4;
+
+  g_assert (xcf_save_image (&info, image, NULL /*error*/));
+  g_assert_cmpint (fclose (info.fp), ==, 0);
+
+  g_list_free_full (info.tile_records,
+                    (GDestroyNotify) xcf_tile_record_free);
+}
+
+/*  checks the version tag at the start of an XCF file  */
+static void
+gimp_assert_xcf_version (const gchar *filename,
+                         gint         version)
+{
+  gchar  tag[14] = { 0, };
+  gchar *expected;
+  FILE  *fp;
+
+  fp = g_fopen (filename, "rb");
+  g_assert (fp != NULL);
+  g_assert_cmpint (fread (tag, 1, sizeof (tag), fp), ==, sizeof (tag));
+  fclose (fp);
+
+  if (version > 0)
+    expected = g_strdup_printf ("gimp xcf v%03d", version);
+  else
+    expected = g_strdup ("gimp xcf file");
+
+  g_assert_cmpstr (tag, ==, expected);
+
+  g_free (expected);
+}
+
+
+/*  returns how many tiles of a loaded layer are still only in the
+ *  file
+ */
+static gint
+gimp_tilelayer_n_pending (GimpImage   *image,
+                          const gchar *name)
+{
+  GimpLayer      *layer   = gimp_image_get_layer_by_name (image, name);
+  GeglBuffer     *buffer  = NULL;
+  XcfTileHandler *handler = NULL;
+
+  g_assert (layer != NULL);
+
+  buffer  = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  handler = g_object_get_data (G_OBJECT (buffer), "xcf-tile-handler");
+
+  g_assert (XCF_IS_TILE_HANDLER (handler));
+
+  return g_atomic_int_get (&handler->n_pending);
+}
+
+static void
+gimp_read_tilelayer (GimpImage   *image,
+                     const gchar *name)
+{
+  GimpLayer  *layer  = gimp_image_get_layer_by_name (image, name);
+  GeglBuffer *buffer = NULL;
+  guchar     *pixels = NULL;
+
+  g_assert (layer != NULL);
+
+  buffer = gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+  pixels = g_malloc (gegl_buffer_get_width (buffer) *
+                     gegl_buffer_get_height (buffer) *
+                     babl_format_get_bytes_per_pixel (gegl_buffer_get_format (buffer)));
+
+  gegl_buffer_get (buffer, NULL, 1.0, gegl_buffer_get_format (buffer),
+                   pixels, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  g_free (pixels);
+}
+
+static GeglBuffer *
+gimp_tilelayer_buffer (GimpImage   *image,
+                       const gchar *name)
+{
+  GimpLayer *layer = gimp_image_get_layer_by_name (image, name);
+
+  g_assert (layer != NULL);
+
+  return gimp_drawable_get_buffer (GIMP_DRAWABLE (layer));
+}
+
+static void
+gimp_test_save_image_async (GimpImage         *image,
+                            const gchar       *uri,
+                            GimpTestAsyncSave *save)
+{
+  GimpPlugInProcedure *proc = NULL;
+
+  proc = file_procedure_find (image->gimp->plug_in_manager->save_procs,
+                              uri,
+                              NULL /*error*/);
+
+  g_assert (file_save_can_async (uri, proc));
+
+  save->done   = FALSE;
+  save->status = GIMP_PDB_EXECUTION_ERROR;
+
+  g_assert (file_save_async (image->gimp,
+                             image,
+                             NULL /*progress*/,
+                             uri,
+                             proc,
+                             gimp_test_async_save_done,
+                             save,
+                             NULL /*error*/));
+}
+
+static void
+gimp_test_async_save_done (GimpImage         *image,
+                           GimpPDBStatusType  status,
+                           const GError      *error,
+                           gpointer           data)
+{
+  GimpTestAsyncSave *save = data;
+
+  save->status = status;
+  save->done   = TRUE;
+}
+
+/*  the save is finished from the main loop  */
+static void
+gimp_test_wait_for_async_save (GimpTestAsyncSave *save)
+{
+  while (! save->done)
+    g_main_context_iteration (NULL, TRUE);
+}
+
+/*  truncates a file in place, like another program rewriting it  */
+static void
+gimp_test_truncate_file (const gchar *filename)
+{
+  FILE *fp = g_fopen (filename, "wb");
+
+  g_assert (fp != NULL);
+  fclose (fp);
+}
+
+static gboolean
+gimp_test_ignore_tile_warnings (const gchar    *log_domain,
+                                GLogLevelFlags  log_level,
+                                const gchar    *message,
+                                gpointer        data)
+{
+  /* Tiles of a truncated file can't be read */
+  return ! (log_domain && ! strcmp (log_domain, "Gimp-XCF") &&
+            strstr (message, "could not read tile"));
+}
+
+
+/**
+ * main:
+ * @argc:
+ * @argv:
+ *
+ * These tests intend to
+ *
+ *  - Make sure that we are backwards compatible with files created by
+ *    older version of GIMP, i.e. that we can load files from earlier
+ *    version of GIMP
+ *
+ *  - Make sure that the information put into a #GimpImage is not lost
+ *    when the #GimpImage is written to a file and then read again
+ **/
+int
+main (int    argc,
+      char **argv)
+{
+  Gimp *gimp;
+  int   result;
+
+  g_test_init (&argc, &argv, NULL);
+
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_SRCDIR",
+                                       "app/tests/gimpdir");
+
+  /* We share the same application instance across all tests. We need
+   * the GUI variant for the file procs
+   */
+  gimp = gimp_init_for_testing ();
+
+  /* Add tests */
+  ADD_TEST (write_and_read_gimp_2_6_format);
+  ADD_TEST (write_and_read_gimp_2_6_format_unusual);
+  ADD_TEST (load_gimp_2_6_file);
+  ADD_TEST (write_and_read_gimp_2_8_format);
+  ADD_TEST (write_and_read_rle_compression);
+  ADD_TEST (write_and_read_zlib_compression);
+  ADD_TEST (write_and_read_zlib_compression_16_bit);
+  ADD_TEST (write_and_read_64_bit_offsets);
+  ADD_TEST (write_and_read_64_bit_offsets_unusual);
+  ADD_TEST (lazy_load_tiles);
+  ADD_TEST (lazy_load_save_over_source);
+  ADD_TEST (lazy_load_save_over_linked_source);
+  ADD_TEST (lazy_load_all_before_truncation);
+  ADD_TEST (lazy_load_truncated_file);
+  ADD_TEST (reuse_unchanged_tiles);
+  ADD_TEST (save_async_snapshot);
+
+  /* Don't write files to the source dir */
+  gimp_test_utils_set_gimp2_directory ("GIMP_TESTING_ABS_TOP_BUILDDIR",
+                                       "app/tests/gimpdir-output");
+
+  /* Run the tests */
+  result = g_test_run ();
+
+  /* Exit so we don't break script-fu plug-in wire */
+  gimp_exit (gimp, TRUE);
+
+  return result;
+}
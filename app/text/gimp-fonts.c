@@ -20,9 +20,12 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include <glib-object.h>
 
 #include <fontconfig/fontconfig.h>
+#include <pango/pangocairo.h>
 
 #include "libgimpbase/gimpbase.h"
 #include "libgimpconfig/gimpconfig.h"
@@ -32,18 +35,51 @@
 #include "config/gimpcoreconfig.h"
 
 #include "core/gimp.h"
+#include "core/gimpcontext.h"
+#include "core/gimp-startup.h"
 
 #include "gimp-fonts.h"
 #include "gimpfontlist.h"
+#include "gimptextlayout.h"
+
+#include "gimp-intl.h"
 
 
 #define CONF_FNAME "fonts.conf"
 
 
-static gboolean gimp_fonts_load_fonts_conf (FcConfig    *config,
-                                            gchar       *fonts_conf);
-static void     gimp_fonts_add_directories (FcConfig    *config,
-                                            const gchar *path_str);
+typedef struct
+{
+  gchar    *path;    /*  the expanded font path                        */
+  gboolean  reuse;   /*  add the font path to the current configuration */
+  gboolean  async;   /*  fill the font list from a thread               */
+  FcConfig *config;  /*  the newly built configuration, unless reuse    */
+} GimpFontsLoad;
+
+
+static GimpFontsLoad * gimp_fonts_load_new        (Gimp          *gimp);
+static void            gimp_fonts_load_prepare    (GimpFontsLoad *load);
+static void            gimp_fonts_load_finish     (Gimp          *gimp,
+                                                   GimpFontsLoad *load);
+static void            gimp_fonts_load_free       (GimpFontsLoad *load);
+
+static gboolean        gimp_fonts_load_fonts_conf (FcConfig      *config,
+                                                   gchar         *fonts_conf);
+static void            gimp_fonts_add_directories (FcConfig      *config,
+                                                   const gchar   *path_str);
+static void            gimp_fonts_read_caches     (const gchar   *path_str);
+
+static gpointer        gimp_fonts_startup_thread  (Gimp          *gimp,
+                                                   gpointer       user_data);
+static void            gimp_fonts_startup_main    (Gimp          *gimp,
+                                                   gpointer       result,
+                                                   gpointer       user_data);
+
+
+/*  whether the current configuration was built by us, rather than
+ *  being fontconfig's default configuration
+ */
+static gboolean gimp_fonts_own_config = FALSE;
 
 
 void
@@ -61,9 +97,7 @@ gimp_fonts_init (Gimp *gimp)
 void
 gimp_fonts_load (Gimp *gimp)
 {
-  FcConfig *config;
-  gchar    *fonts_conf;
-  gchar    *path;
+  GimpFontsLoad *load;
 
   g_return_if_fail (GIMP_IS_FONT_LIST (gimp->fonts));
 
@@ -72,52 +106,226 @@ gimp_fonts_load (Gimp *gimp)
   if (gimp->be_verbose)
     g_print ("Loading fonts\n");
 
-  gimp_container_freeze (GIMP_CONTAINER (gimp->fonts));
+  load = gimp_fonts_load_new (gimp);
+
+  gimp_fonts_load_prepare (load);
+  gimp_fonts_load_finish (gimp, load);
+
+  gimp_fonts_load_free (load);
+
+  gimp_unset_busy (gimp);
+}
+
+/**
+ * gimp_fonts_add_startup_task:
+ * @gimp:     a #Gimp
+ * @startup:  a #GimpStartup
+ * @required: whether the fonts must be loaded before the UI comes up
+ *
+ * Adds a startup task that prepares the fontconfig configuration in
+ * a worker thread, if fontconfig is thread-safe, and swaps it in on
+ * the main thread.  Unless @required, the font list is then filled
+ * incrementally, see gimp_font_list_restore_async().
+ **/
+void
+gimp_fonts_add_startup_task (Gimp        *gimp,
+                             GimpStartup *startup,
+                             gboolean     required)
+{
+  GimpFontsLoad *load;
+
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+  g_return_if_fail (startup != NULL);
+
+  if (gimp->be_verbose)
+    g_print ("Loading fonts\n");
+
+  load = gimp_fonts_load_new (gimp);
+
+  load->async = ! required;
+
+  gimp_startup_add_task (startup, "fonts", _("Fonts (this may take a while)"),
+                         required,
+#if FC_VERSION >= GIMP_FONTS_THREAD_SAFE_VERSION
+                         gimp_fonts_startup_thread,
+#else
+                         NULL,
+#endif
+                         gimp_fonts_startup_main,
+                         load,
+                         NULL);
+}
+
+void
+gimp_fonts_reset (Gimp *gimp)
+{
+  g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  if (gimp->no_fonts)
+    return;
 
-  gimp_container_clear (GIMP_CONTAINER (gimp->fonts));
+  /*  don't pull fontconfig away under the font list's thread  */
+  gimp_font_list_cancel_restore (GIMP_FONT_LIST (gimp->fonts));
+
+  /* Reinit the library with defaults. */
+  FcInitReinitialize ();
+  gimp_text_layout_reset_font_maps ();
+
+  gimp_fonts_own_config = FALSE;
+}
+
+
+/*  private functions  */
+
+static GimpFontsLoad *
+gimp_fonts_load_new (Gimp *gimp)
+{
+  GimpFontsLoad *load;
+  gchar         *personal_conf;
+  gchar         *system_conf;
+
+  load = g_slice_new0 (GimpFontsLoad);
+
+  load->path = gimp_config_path_expand (gimp->config->font_path, TRUE, NULL);
+
+  personal_conf = gimp_personal_rc_file (CONF_FNAME);
+  system_conf   = g_build_filename (gimp_sysconf_directory (), CONF_FNAME,
+                                    NULL);
+
+  /*  Without fonts.conf files of our own, the configuration we would
+   *  build is fontconfig's default configuration plus the font path.
+   *  Reuse the default configuration then, its fonts are already
+   *  known or come from fontconfig's caches, instead of building all
+   *  the fonts again.
+   */
+  load->reuse = (! gimp_fonts_own_config                         &&
+                 ! g_file_test (personal_conf, G_FILE_TEST_EXISTS) &&
+                 ! g_file_test (system_conf,   G_FILE_TEST_EXISTS));
+
+  g_free (personal_conf);
+  g_free (system_conf);
+
+  return load;
+}
+
+/*  doesn't change the current configuration, and may run in a thread
+ *  if fontconfig is thread-safe
+ */
+static void
+gimp_fonts_load_prepare (GimpFontsLoad *load)
+{
+  FcConfig *config;
+  gchar    *fonts_conf;
+
+  if (load->reuse)
+    {
+      /*  makes sure the default configuration is built, and that the
+       *  font path's caches are up to date, so adding the font path
+       *  in gimp_fonts_load_finish() is cheap
+       */
+      if (FcInit () && load->path)
+        gimp_fonts_read_caches (load->path);
+
+      return;
+    }
 
   config = FcInitLoadConfig ();
 
   if (! config)
-    goto cleanup;
+    return;
 
   fonts_conf = gimp_personal_rc_file (CONF_FNAME);
   if (! gimp_fonts_load_fonts_conf (config, fonts_conf))
-    goto cleanup;
+    return;
 
   fonts_conf = g_build_filename (gimp_sysconf_directory (), CONF_FNAME, NULL);
   if (! gimp_fonts_load_fonts_conf (config, fonts_conf))
-    goto cleanup;
+    return;
 
-  path = gimp_config_path_expand (gimp->config->font_path, TRUE, NULL);
-  gimp_fonts_add_directories (config, path);
-  g_free (path);
+  gimp_fonts_add_directories (config, load->path);
 
   if (! FcConfigBuildFonts (config))
     {
       FcConfigDestroy (config);
-      goto cleanup;
+      return;
+    }
+
+  load->config = config;
+}
+
+static void
+gimp_fonts_load_finish (Gimp          *gimp,
+                        GimpFontsLoad *load)
+{
+  GimpFontList *list   = GIMP_FONT_LIST (gimp->fonts);
+  gboolean      loaded = FALSE;
+
+  gimp_font_list_cancel_restore (list);
+
+  gimp_container_freeze (GIMP_CONTAINER (list));
+
+  gimp_container_clear (GIMP_CONTAINER (list));
+
+  if (load->reuse)
+    {
+      FcConfig *config = FcConfigGetCurrent ();
+
+      if (config)
+        {
+          FcConfigAppFontClear (config);
+
+          if (load->path)
+            gimp_fonts_add_directories (config, load->path);
+
+          gimp_text_layout_reset_font_maps ();
+
+          loaded = TRUE;
+        }
     }
+  else if (load->config)
+    {
+      FcConfigSetCurrent (load->config);
+      load->config = NULL;
 
-  FcConfigSetCurrent (config);
+      gimp_fonts_own_config = TRUE;
 
-  gimp_font_list_restore (GIMP_FONT_LIST (gimp->fonts));
+      gimp_text_layout_reset_font_maps ();
 
- cleanup:
-  gimp_container_thaw (GIMP_CONTAINER (gimp->fonts));
-  gimp_unset_busy (gimp);
+      loaded = TRUE;
+    }
+
+  if (loaded && ! load->async)
+    gimp_font_list_restore (list);
+
+  gimp_container_thaw (GIMP_CONTAINER (list));
+
+  if (loaded && load->async)
+    {
+      const gchar *preferred[3] = { NULL, };
+      gint         n_preferred  = 0;
+
+      /*  the fonts the contexts want are added first  */
+      if (gimp->config->default_font)
+        preferred[n_preferred++] = gimp->config->default_font;
+
+      if (gimp->user_context &&
+          gimp_context_get_font_name (gimp->user_context))
+        preferred[n_preferred++] =
+          gimp_context_get_font_name (gimp->user_context);
+
+      gimp_font_list_restore_async (list, preferred);
+    }
 }
 
-void
-gimp_fonts_reset (Gimp *gimp)
+static void
+gimp_fonts_load_free (GimpFontsLoad *load)
 {
-  g_return_if_fail (GIMP_IS_GIMP (gimp));
+  if (load->config)
+    FcConfigDestroy (load->config);
 
-  if (gimp->no_fonts)
-    return;
+  g_free (load->path);
 
-  /* Reinit the library with defaults. */
-  FcInitReinitialize ();
+  g_slice_free (GimpFontsLoad, load);
 }
 
 static gboolean
@@ -154,3 +362,59 @@ gimp_fonts_add_directories (FcConfig    *config,
 
   gimp_path_free (path);
 }
+
+static void
+gimp_fonts_read_caches (const gchar *path_str)
+{
+  GList *path;
+  GList *list;
+
+  path = gimp_path_parse (path_str, 256, TRUE, NULL);
+
+  /*  reading a directory's cache creates or updates it as needed  */
+  for (list = path; list; list = list->next)
+    {
+      FcCache *cache = FcDirCacheRead ((const FcChar8 *) list->data,
+                                       FcFalse, NULL);
+
+      if (cache)
+        FcDirCacheUnload (cache);
+    }
+
+  gimp_path_free (path);
+}
+
+static gpointer
+gimp_fonts_startup_thread (Gimp     *gimp,
+                           gpointer  user_data)
+{
+  gimp_fonts_load_prepare (user_data);
+
+  return user_data;
+}
+
+static void
+gimp_fonts_startup_main (Gimp     *gimp,
+                         gpointer  result,
+                         gpointer  user_data)
+{
+  GimpFontsLoad *load = user_data;
+  gchar         *path;
+
+#if FC_VERSION < GIMP_FONTS_THREAD_SAFE_VERSION
+  /*  without a thread part, do all the work here  */
+  gimp_fonts_load_prepare (load);
+#endif
+
+  path = gimp_config_path_expand (gimp->config->font_path, TRUE, NULL);
+
+  /*  if the font path was changed meanwhile, the fonts were already
+   *  reloaded by the "notify::font-path" handler
+   */
+  if (path && load->path && ! strcmp (path, load->path))
+    gimp_fonts_load_finish (gimp, load);
+
+  g_free (path);
+
+  gimp_fonts_load_free (load);
+}
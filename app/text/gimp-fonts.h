@@ -19,9 +19,16 @@
 #define __GIMP_FONTS_H__
 
 
-void   gimp_fonts_init  (Gimp *gimp);
-void   gimp_fonts_load  (Gimp *gimp);
-void   gimp_fonts_reset (Gimp *gimp);
+/*  fontconfig can only be used from more than one thread since 2.10.91  */
+#define GIMP_FONTS_THREAD_SAFE_VERSION 21091
+
+
+void   gimp_fonts_init             (Gimp        *gimp);
+void   gimp_fonts_load             (Gimp        *gimp);
+void   gimp_fonts_add_startup_task (Gimp        *gimp,
+                                    GimpStartup *startup,
+                                    gboolean     required);
+void   gimp_fonts_reset            (Gimp        *gimp);
 
 
 #endif  /* __GIMP_FONTS_H__ */
@@ -30,6 +30,7 @@
 
 #include "text-types.h"
 
+#include "gimp-fonts.h"
 #include "gimpfont.h"
 #include "gimpfontlist.h"
 
@@ -46,13 +47,45 @@
 #endif
 
 
-static void   gimp_font_list_add_font   (GimpFontList         *list,
-                                         PangoContext         *context,
-                                         PangoFontDescription *desc);
+/*  the number of fonts gimp_font_list_restore_async() adds per idle  */
+#define FONTS_PER_IDLE 256
 
-static void   gimp_font_list_load_names (GimpFontList         *list,
-                                         PangoFontMap         *fontmap,
-                                         PangoContext         *context);
+
+struct _GimpFontListLoad
+{
+  GimpFontList  *list;
+  PangoContext  *context;
+  gchar        **preferred;
+
+  GPtrArray     *names;
+  guint          index;
+  gboolean       preferred_added;
+  gboolean       cancelled;
+
+  GMutex         mutex;
+  GCond          cond;
+  gboolean       names_done;
+};
+
+
+static PangoContext * gimp_font_list_create_context (GimpFontList          *list);
+
+static void           gimp_font_list_add_font       (GimpFontList          *list,
+                                                     PangoContext          *context,
+                                                     const gchar           *name);
+static void           gimp_font_list_add_name       (GPtrArray             *names,
+                                                     PangoFontDescription  *desc);
+
+static void           gimp_font_list_load_names     (GPtrArray             *names,
+                                                     PangoFontMap          *fontmap);
+
+static gpointer       gimp_font_list_load_thread    (GimpFontListLoad      *load);
+static gboolean       gimp_font_list_load_idle      (GimpFontListLoad      *load);
+static void           gimp_font_list_load_free      (GimpFontListLoad      *load);
+static gboolean       gimp_font_list_is_preferred   (GimpFontListLoad      *load,
+                                                     const gchar           *name);
+static gint           gimp_font_list_name_collate   (const gchar          **name1,
+                                                     const gchar          **name2);
 
 
 G_DEFINE_TYPE (GimpFontList, gimp_font_list, GIMP_TYPE_LIST)
@@ -91,11 +124,120 @@ gimp_font_list_new (gdouble xresolution,
 void
 gimp_font_list_restore (GimpFontList *list)
 {
-  PangoFontMap *fontmap;
   PangoContext *context;
+  GPtrArray    *names;
+  guint         i;
+
+  g_return_if_fail (GIMP_IS_FONT_LIST (list));
+
+  gimp_font_list_cancel_restore (list);
+
+  context = gimp_font_list_create_context (list);
+
+  names = g_ptr_array_new_with_free_func (g_free);
+
+  gimp_font_list_load_names (names, pango_context_get_font_map (context));
+
+  gimp_container_freeze (GIMP_CONTAINER (list));
+
+  for (i = 0; i < names->len; i++)
+    gimp_font_list_add_font (list, context, g_ptr_array_index (names, i));
+
+  g_ptr_array_unref (names);
+  g_object_unref (context);
+
+  gimp_list_sort_by_name (GIMP_LIST (list));
+
+  gimp_container_thaw (GIMP_CONTAINER (list));
+}
+
+/**
+ * gimp_font_list_restore_async:
+ * @list:      a #GimpFontList
+ * @preferred: a %NULL-terminated array of font names to add first
+ *
+ * Like gimp_font_list_restore(), but the fonts are enumerated in a
+ * thread, if fontconfig is thread-safe, and added to @list from idle
+ * handlers, a few at a time.  The @preferred fonts are added first,
+ * so the contexts using them become usable as soon as possible.
+ *
+ * @list is frozen and thawed after adding the @preferred fonts and
+ * after adding all fonts, the fonts in between are added while @list
+ * is not frozen.
+ **/
+void
+gimp_font_list_restore_async (GimpFontList  *list,
+                              const gchar  **preferred)
+{
+  GimpFontListLoad *load;
 
   g_return_if_fail (GIMP_IS_FONT_LIST (list));
 
+  gimp_font_list_cancel_restore (list);
+
+  load = g_slice_new0 (GimpFontListLoad);
+
+  load->list      = g_object_ref (list);
+  load->context   = gimp_font_list_create_context (list);
+  load->preferred = g_strdupv ((gchar **) preferred);
+  load->names     = g_ptr_array_new_with_free_func (g_free);
+
+  g_mutex_init (&load->mutex);
+  g_cond_init (&load->cond);
+
+  list->load = load;
+
+#if defined (USE_FONTCONFIG_DIRECTLY) && \
+    FC_VERSION >= GIMP_FONTS_THREAD_SAFE_VERSION
+  g_thread_unref (g_thread_new ("font-list",
+                                (GThreadFunc) gimp_font_list_load_thread,
+                                load));
+#else
+  gimp_font_list_load_thread (load);
+#endif
+}
+
+/**
+ * gimp_font_list_cancel_restore:
+ * @list: a #GimpFontList
+ *
+ * Stops a running gimp_font_list_restore_async(), and waits until its
+ * thread doesn't use fontconfig any longer.  The fonts that were
+ * already added stay in @list.
+ **/
+void
+gimp_font_list_cancel_restore (GimpFontList *list)
+{
+  GimpFontListLoad *load;
+
+  g_return_if_fail (GIMP_IS_FONT_LIST (list));
+
+  load = list->load;
+
+  if (! load)
+    return;
+
+  list->load      = NULL;
+  load->cancelled = TRUE;
+
+  /*  the idle handler frees the load  */
+  g_mutex_lock (&load->mutex);
+
+  while (! load->names_done)
+    g_cond_wait (&load->cond, &load->mutex);
+
+  g_mutex_unlock (&load->mutex);
+}
+
+
+/*  private functions  */
+
+static PangoContext *
+gimp_font_list_create_context (GimpFontList *list)
+{
+  PangoFontMap *fontmap;
+  PangoContext *context;
+
   fontmap = pango_cairo_font_map_new_for_font_type (CAIRO_FONT_TYPE_FT);
   if (! fontmap)
     g_error ("You are using a Pango that has been built against a cairo "
@@ -106,19 +248,27 @@ gimp_font_list_restore (GimpFontList *list)
   context = pango_font_map_create_context (fontmap);
   g_object_unref (fontmap);
 
-  gimp_container_freeze (GIMP_CONTAINER (list));
+  return context;
+}
 
-  gimp_font_list_load_names (list, PANGO_FONT_MAP (fontmap), context);
-  g_object_unref (context);
+static void
+gimp_font_list_add_font (GimpFontList *list,
+                         PangoContext *context,
+                         const gchar  *name)
+{
+  GimpFont *font;
 
-  gimp_list_sort_by_name (GIMP_LIST (list));
+  font = g_object_new (GIMP_TYPE_FONT,
+                       "name",          name,
+                       "pango-context", context,
+                       NULL);
 
-  gimp_container_thaw (GIMP_CONTAINER (list));
+  gimp_container_add (GIMP_CONTAINER (list), GIMP_OBJECT (font));
+  g_object_unref (font);
 }
 
 static void
-gimp_font_list_add_font (GimpFontList         *list,
-                         PangoContext         *context,
+gimp_font_list_add_name (GPtrArray            *names,
                          PangoFontDescription *desc)
 {
   gchar *name;
@@ -129,30 +279,150 @@ gimp_font_list_add_font (GimpFontList         *list,
   name = pango_font_description_to_string (desc);
 
   if (g_utf8_validate (name, -1, NULL))
+    g_ptr_array_add (names, name);
+  else
+    g_free (name);
+}
+
+/*  runs in a thread if fontconfig is thread-safe, and must not touch
+ *  the list
+ */
+static gpointer
+gimp_font_list_load_thread (GimpFontListLoad *load)
+{
+  gimp_font_list_load_names (load->names,
+                             pango_context_get_font_map (load->context));
+
+  /*  adding the fonts in order keeps the final sort cheap  */
+  g_ptr_array_sort (load->names, (GCompareFunc) gimp_font_list_name_collate);
+
+  g_mutex_lock (&load->mutex);
+
+  load->names_done = TRUE;
+  g_cond_signal (&load->cond);
+
+  g_mutex_unlock (&load->mutex);
+
+  g_idle_add ((GSourceFunc) gimp_font_list_load_idle, load);
+
+  return NULL;
+}
+
+static gboolean
+gimp_font_list_load_idle (GimpFontListLoad *load)
+{
+  GimpContainer *container = GIMP_CONTAINER (load->list);
+  guint          end;
+
+  if (load->cancelled)
     {
-      GimpFont *font;
+      gimp_font_list_load_free (load);
+
+      return FALSE;
+    }
 
-      font = g_object_new (GIMP_TYPE_FONT,
-                           "name",          name,
-                           "pango-context", context,
-                           NULL);
+  if (! load->preferred_added)
+    {
+      gint i;
 
-      gimp_container_add (GIMP_CONTAINER (list), GIMP_OBJECT (font));
-      g_object_unref (font);
+      /*  the contexts look for their fonts again on thaw  */
+      gimp_container_freeze (container);
+
+      for (i = 0; load->preferred[i]; i++)
+        {
+          const gchar *name = load->preferred[i];
+          guint        j;
+
+          if (gimp_container_get_child_by_name (container, name))
+            continue;
+
+          for (j = 0; j < load->names->len; j++)
+            {
+              if (! strcmp (name, g_ptr_array_index (load->names, j)))
+                {
+                  gimp_font_list_add_font (load->list, load->context, name);
+                  break;
+                }
+            }
+        }
+
+      gimp_container_thaw (container);
+
+      load->preferred_added = TRUE;
+    }
+
+  end = MIN (load->index + FONTS_PER_IDLE, load->names->len);
+
+  for (; load->index < end; load->index++)
+    {
+      const gchar *name = g_ptr_array_index (load->names, load->index);
+
+      if (! gimp_font_list_is_preferred (load, name))
+        gimp_font_list_add_font (load->list, load->context, name);
+    }
+
+  if (load->index < load->names->len)
+    return TRUE;
+
+  /*  sort the preferred fonts into place, the thaw also lets the
+   *  contexts find fonts that were not there before
+   */
+  gimp_container_freeze (container);
+  gimp_list_sort_by_name (GIMP_LIST (load->list));
+  gimp_container_thaw (container);
+
+  load->list->load = NULL;
+
+  gimp_font_list_load_free (load);
+
+  return FALSE;
+}
+
+static void
+gimp_font_list_load_free (GimpFontListLoad *load)
+{
+  g_ptr_array_unref (load->names);
+  g_strfreev (load->preferred);
+
+  g_object_unref (load->context);
+  g_object_unref (load->list);
+
+  g_mutex_clear (&load->mutex);
+  g_cond_clear (&load->cond);
+
+  g_slice_free (GimpFontListLoad, load);
+}
+
+static gboolean
+gimp_font_list_is_preferred (GimpFontListLoad *load,
+                             const gchar      *name)
+{
+  gint i;
+
+  for (i = 0; load->preferred[i]; i++)
+    {
+      if (! strcmp (name, load->preferred[i]))
+        return TRUE;
     }
 
-  g_free (name);
+  return FALSE;
+}
+
+static gint
+gimp_font_list_name_collate (const gchar **name1,
+                             const gchar **name2)
+{
+  return g_utf8_collate (*name1, *name2);
 }
 
 #ifdef USE_FONTCONFIG_DIRECTLY
 /* We're really chummy here with the implementation. Oh well. */
 
 /* This is copied straight from make_alias_description in pango, plus
- * the gimp_font_list_add_font bits.
+ * the gimp_font_list_add_name bits.
  */
 static void
-gimp_font_list_make_alias (GimpFontList *list,
-                           PangoContext *context,
+gimp_font_list_make_alias (GPtrArray    *names,
                            const gchar  *family,
                            gboolean      bold,
                            gboolean      italic)
@@ -169,31 +439,29 @@ gimp_font_list_make_alias (GimpFontList *list,
                                      PANGO_WEIGHT_BOLD : PANGO_WEIGHT_NORMAL);
   pango_font_description_set_stretch (desc, PANGO_STRETCH_NORMAL);
 
-  gimp_font_list_add_font (list, context, desc);
+  gimp_font_list_add_name (names, desc);
 
   pango_font_description_free (desc);
 }
 
 static void
-gimp_font_list_load_aliases (GimpFontList *list,
-                             PangoContext *context)
+gimp_font_list_load_aliases (GPtrArray *names)
 {
   const gchar *families[] = { "Sans", "Serif", "Monospace" };
   gint         i;
 
   for (i = 0; i < 3; i++)
     {
-      gimp_font_list_make_alias (list, context, families[i], FALSE, FALSE);
-      gimp_font_list_make_alias (list, context, families[i], TRUE,  FALSE);
-      gimp_font_list_make_alias (list, context, families[i], FALSE, TRUE);
-      gimp_font_list_make_alias (list, context, families[i], TRUE,  TRUE);
+      gimp_font_list_make_alias (names, families[i], FALSE, FALSE);
+      gimp_font_list_make_alias (names, families[i], TRUE,  FALSE);
+      gimp_font_list_make_alias (names, families[i], FALSE, TRUE);
+      gimp_font_list_make_alias (names, families[i], TRUE,  TRUE);
     }
 }
 
 static void
-gimp_font_list_load_names (GimpFontList *list,
-                           PangoFontMap *fontmap,
-                           PangoContext *context)
+gimp_font_list_load_names (GPtrArray    *names,
+                           PangoFontMap *fontmap)
 {
   FcObjectSet *os;
   FcPattern   *pat;
@@ -216,13 +484,13 @@ gimp_font_list_load_names (GimpFontList *list,
       PangoFontDescription *desc;
 
       desc = pango_fc_font_description_from_pattern (fontset->fonts[i], FALSE);
-      gimp_font_list_add_font (list, context, desc);
+      gimp_font_list_add_name (names, desc);
       pango_font_description_free (desc);
     }
 
   /*  only create aliases if there is at least one font available  */
   if (fontset->nfont > 0)
-    gimp_font_list_load_aliases (list, context);
+    gimp_font_list_load_aliases (names);
 
   FcFontSetDestroy (fontset);
 }
@@ -230,9 +498,8 @@ gimp_font_list_load_names (GimpFontList *list,
 #else  /* ! USE_FONTCONFIG_DIRECTLY */
 
 static void
-gimp_font_list_load_names (GimpFontList *list,
-                           PangoFontMap *fontmap,
-                           PangoContext *context)
+gimp_font_list_load_names (GPtrArray    *names,
+                           PangoFontMap *fontmap)
 {
   PangoFontFamily **families;
   PangoFontFace   **faces;
@@ -251,7 +518,7 @@ gimp_font_list_load_names (GimpFontList *list,
           PangoFontDescription *desc;
 
           desc = pango_font_face_describe (faces[j]);
-          gimp_font_list_add_font (list, context, desc);
+          gimp_font_list_add_name (names, desc);
           pango_font_description_free (desc);
         }
     }
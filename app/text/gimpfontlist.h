@@ -35,13 +35,16 @@
 
 
 typedef struct _GimpFontListClass GimpFontListClass;
+typedef struct _GimpFontListLoad  GimpFontListLoad;
 
 struct _GimpFontList
 {
-  GimpList  parent_instance;
+  GimpList          parent_instance;
 
-  gdouble   xresolution;
-  gdouble   yresolution;
+  gdouble           xresolution;
+  gdouble           yresolution;
+
+  GimpFontListLoad *load;  /*  the running gimp_font_list_restore_async()  */
 };
 
 struct _GimpFontListClass
@@ -50,11 +53,14 @@ struct _GimpFontListClass
 };
 
 
-GType           gimp_font_list_get_type (void) G_GNUC_CONST;
+GType           gimp_font_list_get_type       (void) G_GNUC_CONST;
 
-GimpContainer * gimp_font_list_new      (gdouble       xresolution,
-                                         gdouble       yresolution);
-void            gimp_font_list_restore  (GimpFontList *list);
+GimpContainer * gimp_font_list_new            (gdouble        xresolution,
+                                               gdouble        yresolution);
+void            gimp_font_list_restore        (GimpFontList  *list);
+void            gimp_font_list_restore_async  (GimpFontList  *list,
+                                               const gchar  **preferred);
+void            gimp_font_list_cancel_restore (GimpFontList  *list);
 
 
 #endif  /*  __GIMP_FONT_LIST_H__  */
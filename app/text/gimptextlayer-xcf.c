@@ -93,6 +93,10 @@ gimp_text_layer_xcf_load_hack (GimpLayer **layer)
         text = gimp_text_from_gdyntext_parasite (parasite);
     }
 
+  /*  Note that this doesn't render the text, the layer keeps the
+   *  pixels that xcf_load_layer() reads after this, and the text is
+   *  only rendered again when it changes.
+   */
   if (text)
     {
       *layer = gimp_text_layer_from_layer (*layer, text);
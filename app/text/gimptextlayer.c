@@ -107,9 +107,17 @@ static void       gimp_text_layer_push_undo      (GimpDrawable      *drawable,
                                                   gint               height);
 
 static void       gimp_text_layer_text_changed   (GimpTextLayer     *layer);
+static GimpTextLayout *
+                  gimp_text_layer_get_layout     (GimpTextLayer     *layer,
+                                                  gdouble            xres,
+                                                  gdouble            yres);
+static void       gimp_text_layer_clear_layout   (GimpTextLayer     *layer);
 static gboolean   gimp_text_layer_render         (GimpTextLayer     *layer);
 static void       gimp_text_layer_render_layout  (GimpTextLayer     *layer,
-                                                  GimpTextLayout    *layout);
+                                                  GimpTextLayout    *layout,
+                                                  GimpTextLayout    *old_layout);
+static gboolean   gimp_text_layer_text_only_changed
+                                                 (GimpTextLayer     *layer);
 
 
 G_DEFINE_TYPE (GimpTextLayer, gimp_text_layer, GIMP_TYPE_LAYER)
@@ -185,6 +193,14 @@ gimp_text_layer_finalize (GObject *object)
 {
   GimpTextLayer *layer = GIMP_TEXT_LAYER (object);
 
+  gimp_text_layer_clear_layout (layer);
+
+  if (layer->render_text)
+    {
+      g_object_unref (layer->render_text);
+      layer->render_text = NULL;
+    }
+
   if (layer->text)
     {
       g_object_unref (layer->text);
@@ -357,6 +373,13 @@ gimp_text_layer_set_buffer (GimpDrawable *drawable,
   GimpTextLayer *layer = GIMP_TEXT_LAYER (drawable);
   GimpImage     *image = gimp_item_get_image (GIMP_ITEM (layer));
 
+  /*  the new pixels weren't rendered from render_text  */
+  if (layer->render_text)
+    {
+      g_object_unref (layer->render_text);
+      layer->render_text = NULL;
+    }
+
   if (push_undo && ! layer->modified)
     gimp_image_undo_group_start (image, GIMP_UNDO_GROUP_DRAWABLE_MOD,
                                  undo_desc);
@@ -388,6 +411,13 @@ gimp_text_layer_push_undo (GimpDrawable *drawable,
   GimpTextLayer *layer = GIMP_TEXT_LAYER (drawable);
   GimpImage     *image = gimp_item_get_image (GIMP_ITEM (layer));
 
+  /*  the pixels are about to be changed  */
+  if (layer->render_text)
+    {
+      g_object_unref (layer->render_text);
+      layer->render_text = NULL;
+    }
+
   if (! layer->modified)
     gimp_image_undo_group_start (image, GIMP_UNDO_GROUP_DRAWABLE, undo_desc);
 
@@ -457,6 +487,14 @@ gimp_text_layer_set_text (GimpTextLayer *layer,
   if (layer->text == text)
     return;
 
+  gimp_text_layer_clear_layout (layer);
+
+  if (layer->render_text)
+    {
+      g_object_unref (layer->render_text);
+      layer->render_text = NULL;
+    }
+
   if (layer->text)
     {
       g_signal_handlers_disconnect_by_func (layer->text,
@@ -603,6 +641,53 @@ gimp_text_layer_text_changed (GimpTextLayer *layer)
   gimp_text_layer_render (layer);
 }
 
+/*  returns a new reference to the layout of layer->text, which is
+ *  reused as long as nothing changed that would change the layout,
+ *  for example when only the format of the layer changes
+ */
+static GimpTextLayout *
+gimp_text_layer_get_layout (GimpTextLayer *layer,
+                            gdouble        xres,
+                            gdouble        yres)
+{
+  gchar *text;
+  gchar *key;
+
+  text = gimp_config_serialize_to_string (GIMP_CONFIG (layer->text), NULL);
+  key  = g_strdup_printf ("%f %f %s", xres, yres, text);
+  g_free (text);
+
+  if (layer->layout && ! strcmp (key, layer->layout_key))
+    {
+      g_free (key);
+
+      return g_object_ref (layer->layout);
+    }
+
+  gimp_text_layer_clear_layout (layer);
+
+  layer->layout     = gimp_text_layout_new (layer->text, xres, yres);
+  layer->layout_key = key;
+
+  return g_object_ref (layer->layout);
+}
+
+static void
+gimp_text_layer_clear_layout (GimpTextLayer *layer)
+{
+  if (layer->layout)
+    {
+      g_object_unref (layer->layout);
+      layer->layout = NULL;
+    }
+
+  if (layer->layout_key)
+    {
+      g_free (layer->layout_key);
+      layer->layout_key = NULL;
+    }
+}
+
 static gboolean
 gimp_text_layer_render (GimpTextLayer *layer)
 {
@@ -610,6 +695,7 @@ gimp_text_layer_render (GimpTextLayer *layer)
   GimpItem       *item;
   GimpImage      *image;
   GimpTextLayout *layout;
+  GimpTextLayout *old_layout = NULL;
   gdouble         xres;
   gdouble         yres;
   gint            width;
@@ -632,7 +718,10 @@ gimp_text_layer_render (GimpTextLayer *layer)
 
   gimp_image_get_resolution (image, &xres, &yres);
 
-  layout = gimp_text_layout_new (layer->text, xres, yres);
+  if (layer->layout)
+    old_layout = g_object_ref (layer->layout);
+
+  layout = gimp_text_layer_get_layout (layer, xres, yres);
 
   g_object_freeze_notify (G_OBJECT (drawable));
 
@@ -693,24 +782,33 @@ gimp_text_layer_render (GimpTextLayer *layer)
         }
     }
 
-  gimp_text_layer_render_layout (layer, layout);
+  gimp_text_layer_render_layout (layer, layout, old_layout);
 
   g_object_unref (layout);
 
+  if (old_layout)
+    g_object_unref (old_layout);
+
   g_object_thaw_notify (G_OBJECT (drawable));
 
   return (width > 0 && height > 0);
 }
 
+/*  renders @layout on the layer. If only the text was edited since
+ *  @old_layout was rendered, only the lines that changed are rendered
+ */
 static void
 gimp_text_layer_render_layout (GimpTextLayer  *layer,
-                               GimpTextLayout *layout)
+                               GimpTextLayout *layout,
+                               GimpTextLayout *old_layout)
 {
   GimpDrawable    *drawable = GIMP_DRAWABLE (layer);
   GimpItem        *item     = GIMP_ITEM (layer);
   GeglBuffer      *buffer;
   cairo_t         *cr;
   cairo_surface_t *surface;
+  gint             x = 0;
+  gint             y = 0;
   gint             width;
   gint             height;
 
@@ -719,21 +817,76 @@ gimp_text_layer_render_layout (GimpTextLayer  *layer,
   width  = gimp_item_get_width  (item);
   height = gimp_item_get_height (item);
 
-  surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, width, height);
+  if (old_layout && old_layout != layout &&
+      gimp_text_layer_text_only_changed (layer))
+    {
+      GeglRectangle area;
+
+      if (gimp_text_layout_get_changed_area (layout, old_layout, &area))
+        gimp_rectangle_intersect (0, 0, width, height,
+                                  area.x, area.y, area.width, area.height,
+                                  &x, &y, &width, &height);
+    }
+
+  if (width > 0 && height > 0)
+    {
+      surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                            width, height);
+
+      cr = cairo_create (surface);
+      cairo_translate (cr, -x, -y);
+      gimp_text_layout_render (layout, cr, layer->text->base_dir, FALSE);
+      cairo_destroy (cr);
+
+      cairo_surface_flush (surface);
 
-  cr = cairo_create (surface);
-  gimp_text_layout_render (layout, cr, layer->text->base_dir, FALSE);
-  cairo_destroy (cr);
+      buffer = gimp_cairo_surface_create_buffer (surface);
 
-  cairo_surface_flush (surface);
+      gegl_buffer_copy (buffer, NULL,
+                        gimp_drawable_get_buffer (drawable),
+                        GEGL_RECTANGLE (x, y, width, height));
 
-  buffer = gimp_cairo_surface_create_buffer (surface);
+      g_object_unref (buffer);
+      cairo_surface_destroy (surface);
+
+      gimp_drawable_update (drawable, x, y, width, height);
+    }
 
-  gegl_buffer_copy (buffer, NULL,
-                    gimp_drawable_get_buffer (drawable), NULL);
+  if (layer->render_text)
+    g_object_unref (layer->render_text);
+
+  layer->render_text =
+    GIMP_TEXT (gimp_config_duplicate (GIMP_CONFIG (layer->text)));
+}
+
+/*  whether the layer's pixels are the rendered render_text, and the
+ *  text was changed only in its "text" or "markup" since
+ */
+static gboolean
+gimp_text_layer_text_only_changed (GimpTextLayer *layer)
+{
+  GList    *diff;
+  GList    *list;
+  gboolean  text_only = TRUE;
+
+  if (! layer->render_text || layer->modified)
+    return FALSE;
+
+  diff = gimp_config_diff (G_OBJECT (layer->render_text),
+                           G_OBJECT (layer->text), 0);
+
+  for (list = diff; list; list = g_list_next (list))
+    {
+      GParamSpec *pspec = list->data;
+
+      if (strcmp (pspec->name, "text") && strcmp (pspec->name, "markup"))
+        {
+          text_only = FALSE;
+          break;
+        }
+    }
 
-  g_object_unref (buffer);
-  cairo_surface_destroy (surface);
+  g_list_free (diff);
 
-  gimp_drawable_update (drawable, 0, 0, width, height);
+  return text_only;
 }
@@ -48,6 +48,18 @@ struct _GimpTextLayer
   gboolean      modified;
 
   const Babl   *convert_format;
+
+  /*  the layout of the last render, reused while the text and the
+   *  resolution serialize to the same layout_key
+   */
+  GimpTextLayout *layout;
+  gchar          *layout_key;
+
+  /*  a copy of the text as it was last rendered, unset whenever the
+   *  pixels are changed otherwise, so that edits that only change the
+   *  text re-render only the lines that changed
+   */
+  GimpText       *render_text;
 };
 
 struct _GimpTextLayerClass
@@ -53,6 +53,12 @@ static void           gimp_text_layout_finalize   (GObject        *object);
 static void           gimp_text_layout_position   (GimpTextLayout *layout);
 static void           gimp_text_layout_set_markup (GimpTextLayout *layout);
 
+static gboolean       gimp_text_layout_line_equal (PangoLayoutIter *iter,
+                                                   PangoLayoutIter *other_iter);
+static void           gimp_text_layout_add_line   (PangoRectangle  *area,
+                                                   PangoLayoutIter *iter);
+
+static PangoFontMap * gimp_text_get_font_map      (gdouble         yres);
 static PangoContext * gimp_text_get_pango_context (GimpText       *text,
                                                    gdouble         xres,
                                                    gdouble         yres);
@@ -63,6 +69,12 @@ G_DEFINE_TYPE (GimpTextLayout, gimp_text_layout, G_TYPE_OBJECT)
 #define parent_class gimp_text_layout_parent_class
 
 
+/*  the font maps used for layouts, one per resolution, so the fonts
+ *  they loaded and the glyphs cairo rendered are shared by all layouts
+ */
+static GHashTable *font_maps = NULL;
+
+
 static void
 gimp_text_layout_class_init (GimpTextLayoutClass *klass)
 {
@@ -207,6 +219,20 @@ gimp_text_layout_new (GimpText  *text,
   return layout;
 }
 
+/**
+ * gimp_text_layout_reset_font_maps:
+ *
+ * Drops the font maps shared by the layouts, which must be done when
+ * the fontconfig configuration changes.  Existing layouts keep their
+ * font maps.
+ **/
+void
+gimp_text_layout_reset_font_maps (void)
+{
+  if (font_maps)
+    g_hash_table_remove_all (font_maps);
+}
+
 gboolean
 gimp_text_layout_get_size (GimpTextLayout *layout,
                            gint           *width,
@@ -267,6 +293,96 @@ gimp_text_layout_get_pango_layout (GimpTextLayout *layout)
   return layout->layout;
 }
 
+/**
+ * gimp_text_layout_get_changed_area:
+ * @layout:     a #GimpTextLayout
+ * @old_layout: a layout of the same text before it was edited
+ * @area:       returns the area that looks different in the two layouts
+ *
+ * Compares the lines of the two layouts, so that only the lines which
+ * changed need to be rendered again. This only works if both layouts
+ * are untransformed and at the same position.
+ *
+ * Return value: %TRUE if @area was set, %FALSE if everything has to
+ *               be rendered again.
+ **/
+gboolean
+gimp_text_layout_get_changed_area (GimpTextLayout *layout,
+                                   GimpTextLayout *old_layout,
+                                   GeglRectangle  *area)
+{
+  PangoLayoutIter *iter;
+  PangoLayoutIter *old_iter;
+  PangoRectangle   changed = { 0, };
+  cairo_matrix_t   trafo;
+  gboolean         more     = TRUE;
+  gboolean         old_more = TRUE;
+
+  g_return_val_if_fail (GIMP_IS_TEXT_LAYOUT (layout), FALSE);
+  g_return_val_if_fail (GIMP_IS_TEXT_LAYOUT (old_layout), FALSE);
+  g_return_val_if_fail (area != NULL, FALSE);
+
+  if (layout->xres      != old_layout->xres      ||
+      layout->yres      != old_layout->yres      ||
+      layout->extents.x != old_layout->extents.x ||
+      layout->extents.y != old_layout->extents.y)
+    return FALSE;
+
+  gimp_text_layout_get_transform (layout, &trafo);
+
+  if (trafo.xx != 1.0 || trafo.xy != 0.0 ||
+      trafo.yx != 0.0 || trafo.yy != 1.0)
+    return FALSE;
+
+  iter     = pango_layout_get_iter (layout->layout);
+  old_iter = pango_layout_get_iter (old_layout->layout);
+
+  while (more || old_more)
+    {
+      if (! more || ! old_more ||
+          ! gimp_text_layout_line_equal (iter, old_iter))
+        {
+          if (more)
+            gimp_text_layout_add_line (&changed, iter);
+
+          if (old_more)
+            gimp_text_layout_add_line (&changed, old_iter);
+        }
+
+      if (more)
+        more = pango_layout_iter_next_line (iter);
+
+      if (old_more)
+        old_more = pango_layout_iter_next_line (old_iter);
+    }
+
+  pango_layout_iter_free (iter);
+  pango_layout_iter_free (old_iter);
+
+  if (changed.width > 0 && changed.height > 0)
+    {
+      gint x1 = PANGO_PIXELS_FLOOR (changed.x);
+      gint y1 = PANGO_PIXELS_FLOOR (changed.y);
+      gint x2 = PANGO_PIXELS_CEIL (changed.x + changed.width);
+      gint y2 = PANGO_PIXELS_CEIL (changed.y + changed.height);
+
+      /*  leave room for antialiasing  */
+      area->x      = layout->extents.x + x1 - 1;
+      area->y      = layout->extents.y + y1 - 1;
+      area->width  = x2 - x1 + 2;
+      area->height = y2 - y1 + 2;
+    }
+  else
+    {
+      area->x      = 0;
+      area->y      = 0;
+      area->width  = 0;
+      area->height = 0;
+    }
+
+  return TRUE;
+}
+
 void
 gimp_text_layout_get_transform (GimpTextLayout *layout,
                                 cairo_matrix_t *matrix)
@@ -634,6 +750,93 @@ gimp_text_layout_position (GimpTextLayout *layout)
 #endif
 }
 
+/*  two lines look the same if they are at the same place and have the
+ *  same glyphs, in the same fonts and with the same attributes
+ */
+static gboolean
+gimp_text_layout_line_equal (PangoLayoutIter *iter,
+                             PangoLayoutIter *other_iter)
+{
+  PangoLayoutLine *line;
+  PangoLayoutLine *other_line;
+  PangoRectangle   rect;
+  PangoRectangle   other_rect;
+  GSList          *runs;
+  GSList          *other_runs;
+
+  pango_layout_iter_get_line_extents (iter,       NULL, &rect);
+  pango_layout_iter_get_line_extents (other_iter, NULL, &other_rect);
+
+  if (memcmp (&rect, &other_rect, sizeof (PangoRectangle)) ||
+      pango_layout_iter_get_baseline (iter) !=
+      pango_layout_iter_get_baseline (other_iter))
+    return FALSE;
+
+  line       = pango_layout_iter_get_line_readonly (iter);
+  other_line = pango_layout_iter_get_line_readonly (other_iter);
+
+  for (runs = line->runs, other_runs = other_line->runs;
+       runs && other_runs;
+       runs = g_slist_next (runs), other_runs = g_slist_next (other_runs))
+    {
+      PangoGlyphItem *run       = runs->data;
+      PangoGlyphItem *other_run = other_runs->data;
+      GSList         *attrs;
+      GSList         *other_attrs;
+
+      if (run->item->analysis.font  != other_run->item->analysis.font  ||
+          run->item->analysis.level != other_run->item->analysis.level ||
+          run->glyphs->num_glyphs   != other_run->glyphs->num_glyphs   ||
+          memcmp (run->glyphs->glyphs, other_run->glyphs->glyphs,
+                  run->glyphs->num_glyphs * sizeof (PangoGlyphInfo)))
+        return FALSE;
+
+      for (attrs = run->item->analysis.extra_attrs,
+             other_attrs = other_run->item->analysis.extra_attrs;
+           attrs && other_attrs;
+           attrs = g_slist_next (attrs), other_attrs = g_slist_next (other_attrs))
+        {
+          if (! pango_attribute_equal (attrs->data, other_attrs->data))
+            return FALSE;
+        }
+
+      if (attrs || other_attrs)
+        return FALSE;
+    }
+
+  return (! runs && ! other_runs);
+}
+
+static void
+gimp_text_layout_add_line (PangoRectangle  *area,
+                           PangoLayoutIter *iter)
+{
+  PangoRectangle ink;
+  PangoRectangle logical;
+  gint           x1, y1;
+  gint           x2, y2;
+
+  pango_layout_iter_get_line_extents (iter, &ink, &logical);
+
+  x1 = MIN (ink.x, logical.x);
+  y1 = MIN (ink.y, logical.y);
+  x2 = MAX (ink.x + ink.width,  logical.x + logical.width);
+  y2 = MAX (ink.y + ink.height, logical.y + logical.height);
+
+  if (area->width > 0 && area->height > 0)
+    {
+      x1 = MIN (x1, area->x);
+      y1 = MIN (y1, area->y);
+      x2 = MAX (x2, area->x + area->width);
+      y2 = MAX (y2, area->y + area->height);
+    }
+
+  area->x      = x1;
+  area->y      = y1;
+  area->width  = x2 - x1;
+  area->height = y2 - y1;
+}
+
 static cairo_font_options_t *
 gimp_text_get_font_options (GimpText *text)
 {
@@ -665,6 +868,34 @@ gimp_text_get_font_options (GimpText *text)
   return options;
 }
 
+static PangoFontMap *
+gimp_text_get_font_map (gdouble yres)
+{
+  PangoFontMap *fontmap;
+
+  if (! font_maps)
+    font_maps = g_hash_table_new_full (g_double_hash, g_double_equal,
+                                       g_free, g_object_unref);
+
+  fontmap = g_hash_table_lookup (font_maps, &yres);
+
+  if (! fontmap)
+    {
+      fontmap = pango_cairo_font_map_new_for_font_type (CAIRO_FONT_TYPE_FT);
+      if (! fontmap)
+        g_error ("You are using a Pango that has been built against a cairo "
+                 "that lacks the Freetype font backend");
+
+      pango_cairo_font_map_set_resolution (PANGO_CAIRO_FONT_MAP (fontmap),
+                                           yres);
+
+      g_hash_table_insert (font_maps, g_memdup (&yres, sizeof (gdouble)),
+                           fontmap);
+    }
+
+  return fontmap;
+}
+
 static PangoContext *
 gimp_text_get_pango_context (GimpText *text,
                              gdouble   xres,
@@ -674,15 +905,9 @@ gimp_text_get_pango_context (GimpText *text,
   PangoFontMap         *fontmap;
   cairo_font_options_t *options;
 
-  fontmap = pango_cairo_font_map_new_for_font_type (CAIRO_FONT_TYPE_FT);
-  if (! fontmap)
-    g_error ("You are using a Pango that has been built against a cairo "
-             "that lacks the Freetype font backend");
-
-  pango_cairo_font_map_set_resolution (PANGO_CAIRO_FONT_MAP (fontmap), yres);
+  fontmap = gimp_text_get_font_map (yres);
 
   context = pango_font_map_create_context (fontmap);
-  g_object_unref (fontmap);
 
   options = gimp_text_get_font_options (text);
   pango_cairo_context_set_font_options (context, options);
@@ -40,6 +40,8 @@ GType            gimp_text_layout_get_type             (void) G_GNUC_CONST;
 GimpTextLayout * gimp_text_layout_new                  (GimpText       *text,
                                                         gdouble         xres,
                                                         gdouble         yres);
+void             gimp_text_layout_reset_font_maps      (void);
+
 gboolean         gimp_text_layout_get_size             (GimpTextLayout *layout,
                                                         gint           *width,
                                                         gint           *heigth);
@@ -53,6 +55,10 @@ void             gimp_text_layout_get_resolution       (GimpTextLayout *layout,
 GimpText       * gimp_text_layout_get_text             (GimpTextLayout *layout);
 PangoLayout    * gimp_text_layout_get_pango_layout     (GimpTextLayout *layout);
 
+gboolean         gimp_text_layout_get_changed_area     (GimpTextLayout *layout,
+                                                        GimpTextLayout *old_layout,
+                                                        GeglRectangle  *area);
+
 void             gimp_text_layout_get_transform        (GimpTextLayout *layout,
                                                         cairo_matrix_t *matrix);
 
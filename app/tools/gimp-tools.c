@@ -26,6 +26,8 @@
 
 #include "tools-types.h"
 
+#include "config/gimprc-cache.h"
+
 #include "widgets/gimpwidgets-utils.h"
 
 #include "core/gimp.h"
@@ -179,9 +181,7 @@ gimp_tools_init (Gimp *gimp)
     /*  selection tools */
 
     gimp_foreground_select_tool_register,
-#if 0
     gimp_iscissors_tool_register,
-#endif
     gimp_by_color_select_tool_register,
     gimp_fuzzy_select_tool_register,
     gimp_free_select_tool_register,
@@ -270,8 +270,8 @@ gimp_tools_restore (Gimp *gimp)
   if (gimp->be_verbose)
     g_print ("Parsing '%s'\n", gimp_filename_to_utf8 (filename));
 
-  if (gimp_config_deserialize_file (GIMP_CONFIG (gimp_list), filename,
-                                    NULL, NULL))
+  if (gimp_rc_cache_deserialize (GIMP_CONFIG (gimp_list), filename,
+                                 NULL, NULL))
     {
       gint n = gimp_container_get_n_children (gimp->tool_info_list);
       gint i;
@@ -45,9 +45,26 @@
 #include "gimp-intl.h"
 
 
+static void   gimp_by_color_select_tool_finalize       (GObject               *object);
+
+static void   gimp_by_color_select_tool_button_press   (GimpTool              *tool,
+                                                        const GimpCoords      *coords,
+                                                        guint32                time,
+                                                        GdkModifierType        state,
+                                                        GimpButtonPressType    press_type,
+                                                        GimpDisplay           *display);
+static void   gimp_by_color_select_tool_button_release (GimpTool              *tool,
+                                                        const GimpCoords      *coords,
+                                                        guint32                time,
+                                                        GdkModifierType        state,
+                                                        GimpButtonReleaseType  release_type,
+                                                        GimpDisplay           *display);
+
 static GeglBuffer * gimp_by_color_select_tool_get_mask (GimpRegionSelectTool *region_select,
                                                         GimpDisplay          *display);
 
+static void   gimp_by_color_select_tool_clear          (GimpByColorSelectTool *by_color_select);
+
 
 G_DEFINE_TYPE (GimpByColorSelectTool, gimp_by_color_select_tool,
                GIMP_TYPE_REGION_SELECT_TOOL)
@@ -75,12 +92,19 @@ gimp_by_color_select_tool_register (GimpToolRegisterCallback  callback,
 static void
 gimp_by_color_select_tool_class_init (GimpByColorSelectToolClass *klass)
 {
+  GObjectClass              *object_class = G_OBJECT_CLASS (klass);
+  GimpToolClass             *tool_class   = GIMP_TOOL_CLASS (klass);
   GimpRegionSelectToolClass *region_class;
 
   region_class = GIMP_REGION_SELECT_TOOL_CLASS (klass);
 
-  region_class->undo_desc = C_("command", "Select by Color");
-  region_class->get_mask  = gimp_by_color_select_tool_get_mask;
+  object_class->finalize     = gimp_by_color_select_tool_finalize;
+
+  tool_class->button_press   = gimp_by_color_select_tool_button_press;
+  tool_class->button_release = gimp_by_color_select_tool_button_release;
+
+  region_class->undo_desc    = C_("command", "Select by Color");
+  region_class->get_mask     = gimp_by_color_select_tool_get_mask;
 }
 
 static void
@@ -91,10 +115,48 @@ gimp_by_color_select_tool_init (GimpByColorSelectTool *by_color_select)
   gimp_tool_control_set_tool_cursor (tool->control, GIMP_TOOL_CURSOR_HAND);
 }
 
+static void
+gimp_by_color_select_tool_finalize (GObject *object)
+{
+  gimp_by_color_select_tool_clear (GIMP_BY_COLOR_SELECT_TOOL (object));
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gimp_by_color_select_tool_button_press (GimpTool            *tool,
+                                        const GimpCoords    *coords,
+                                        guint32              time,
+                                        GdkModifierType      state,
+                                        GimpButtonPressType  press_type,
+                                        GimpDisplay         *display)
+{
+  /*  the image may have changed since the last click  */
+  gimp_by_color_select_tool_clear (GIMP_BY_COLOR_SELECT_TOOL (tool));
+
+  GIMP_TOOL_CLASS (parent_class)->button_press (tool, coords, time, state,
+                                                press_type, display);
+}
+
+static void
+gimp_by_color_select_tool_button_release (GimpTool              *tool,
+                                          const GimpCoords      *coords,
+                                          guint32                time,
+                                          GdkModifierType        state,
+                                          GimpButtonReleaseType  release_type,
+                                          GimpDisplay           *display)
+{
+  GIMP_TOOL_CLASS (parent_class)->button_release (tool, coords, time, state,
+                                                  release_type, display);
+
+  gimp_by_color_select_tool_clear (GIMP_BY_COLOR_SELECT_TOOL (tool));
+}
+
 static GeglBuffer *
 gimp_by_color_select_tool_get_mask (GimpRegionSelectTool *region_select,
                                     GimpDisplay          *display)
 {
+  GimpByColorSelectTool   *by_color    = GIMP_BY_COLOR_SELECT_TOOL (region_select);
   GimpTool                *tool        = GIMP_TOOL (region_select);
   GimpSelectionOptions    *sel_options = GIMP_SELECTION_TOOL_GET_OPTIONS (tool);
   GimpRegionSelectOptions *options     = GIMP_REGION_SELECT_TOOL_GET_OPTIONS (tool);
@@ -104,6 +166,12 @@ gimp_by_color_select_tool_get_mask (GimpRegionSelectTool *region_select,
   GimpRGB                  color;
   gint                     x, y;
 
+  /*  only the threshold changes while dragging, so reuse the distances  */
+  if (by_color->distance_buffer)
+    return gimp_image_contiguous_region_by_distance (by_color->distance_buffer,
+                                                     sel_options->antialias,
+                                                     options->threshold / 255.0);
+
   x = region_select->x;
   y = region_select->y;
 
@@ -125,14 +193,27 @@ gimp_by_color_select_tool_get_mask (GimpRegionSelectTool *region_select,
 
   gimp_pickable_flush (pickable);
 
-  if (gimp_pickable_get_color_at (pickable, x, y, &color))
-    return gimp_image_contiguous_region_by_color (image, drawable,
-                                                  options->sample_merged,
-                                                  sel_options->antialias,
-                                                  options->threshold / 255.0,
-                                                  options->select_transparent,
-                                                  options->select_criterion,
-                                                  &color);
+  if (! gimp_pickable_get_color_at (pickable, x, y, &color))
+    return NULL;
+
+  by_color->distance_buffer =
+    gimp_image_contiguous_region_distance_by_color (image, drawable,
+                                                    options->sample_merged,
+                                                    options->select_transparent,
+                                                    options->select_criterion,
+                                                    &color);
 
-  return NULL;
+  return gimp_image_contiguous_region_by_distance (by_color->distance_buffer,
+                                                   sel_options->antialias,
+                                                   options->threshold / 255.0);
+}
+
+static void
+gimp_by_color_select_tool_clear (GimpByColorSelectTool *by_color_select)
+{
+  if (by_color_select->distance_buffer)
+    {
+      g_object_unref (by_color_select->distance_buffer);
+      by_color_select->distance_buffer = NULL;
+    }
 }
@@ -38,6 +38,11 @@ typedef struct _GimpByColorSelectToolClass GimpByColorSelectToolClass;
 struct _GimpByColorSelectTool
 {
   GimpRegionSelectTool  parent_instance;
+
+  /*  the distances to the picked color, kept while the threshold
+   *  is changed by dragging
+   */
+  GeglBuffer           *distance_buffer;
 };
 
 struct _GimpByColorSelectToolClass
@@ -55,6 +55,12 @@
 #include "gimp-intl.h"
 
 
+/*  how far around the unknown pixels the matting still looks at the
+ *  known ones
+ */
+#define MATTING_MARGIN 32
+
+
 typedef struct
 {
   gint         width;
@@ -121,6 +127,9 @@ static void   gimp_foreground_select_tool_apply          (GimpForegroundSelectTo
                                                           GimpDisplay              *display);
 static void   gimp_foreground_select_tool_preview        (GimpForegroundSelectTool *fg_select,
                                                           GimpDisplay              *display);
+static gboolean gimp_foreground_select_tool_get_unknown_bounds
+                                                         (GeglBuffer               *trimap,
+                                                          GeglRectangle            *bounds);
 
 static void   gimp_foreground_select_options_notify      (GimpForegroundSelectOptions *options,
                                                           GParamSpec                  *pspec,
@@ -728,15 +737,7 @@ gimp_foreground_select_tool_preview (GimpForegroundSelectTool *fg_select,
   GimpDrawable                *drawable = gimp_image_get_active_drawable (image);
   GeglBuffer                  *trimap_buffer;
   GeglBuffer                  *drawable_buffer;
-  GeglNode                    *gegl;
-  GeglNode                    *matting_node;
-  GeglNode                    *input_image;
-  GeglNode                    *input_trimap;
-  GeglNode                    *output_mask;
-  GeglBuffer                  *buffer;
-  GimpProgress                *progress;
-  GeglProcessor               *processor;
-  gdouble                     value;
+  GeglRectangle                roi;
 
   if (fg_select->mask)
     {
@@ -744,70 +745,169 @@ gimp_foreground_select_tool_preview (GimpForegroundSelectTool *fg_select,
       fg_select->mask = NULL;
     }
 
-  progress = gimp_progress_start (GIMP_PROGRESS (fg_select),
-                                  _("Computing alpha of unknown pixels"),
-                                  FALSE);
-
   trimap_buffer   = fg_select->trimap;
   drawable_buffer = gimp_drawable_get_buffer (drawable);
 
-  gegl = gegl_node_new ();
-
-  input_trimap = gegl_node_new_child (gegl,
-                                      "operation", "gegl:buffer-source",
-                                      "buffer",    trimap_buffer,
-                                      NULL);
-  input_image = gegl_node_new_child (gegl,
-                                     "operation", "gegl:buffer-source",
-                                     "buffer",    drawable_buffer,
-                                     NULL);
-  output_mask = gegl_node_new_child (gegl,
-                                     "operation", "gegl:buffer-sink",
-                                     "buffer",    &buffer,
-                                     "format",    NULL,
-                                     NULL);
-
-  if (options->engine == GIMP_MATTING_ENGINE_GLOBAL)
-    {
-      matting_node = gegl_node_new_child (gegl,
-                                          "operation",  "gegl:matting-global",
-                                          "iterations", options->iterations,
-                                          NULL);
-    }
-  else
+  /*  the known pixels are their own alpha, so only the unknown ones,
+   *  and the known ones around them the matting samples, are run
+   *  through the matting engine
+   */
+  fg_select->mask = gegl_buffer_dup (trimap_buffer);
+
+  if (gimp_foreground_select_tool_get_unknown_bounds (trimap_buffer, &roi))
     {
-      matting_node = gegl_node_new_child (gegl,
-                                          "operation",     "gegl:matting-levin",
-                                          "levels",        options->levels,
-                                          "active_levels", options->active_levels,
+      GeglNode      *gegl;
+      GeglNode      *matting_node;
+      GeglNode      *input_image;
+      GeglNode      *input_trimap;
+      GeglNode      *crop_image;
+      GeglNode      *crop_trimap;
+      GeglNode      *output_mask;
+      GimpProgress  *progress;
+      GeglProcessor *processor;
+      gdouble        value;
+
+      roi.x      -= MATTING_MARGIN;
+      roi.y      -= MATTING_MARGIN;
+      roi.width  += 2 * MATTING_MARGIN;
+      roi.height += 2 * MATTING_MARGIN;
+
+      gegl_rectangle_intersect (&roi, &roi,
+                                gegl_buffer_get_extent (trimap_buffer));
+
+      progress = gimp_progress_start (GIMP_PROGRESS (fg_select),
+                                      _("Computing alpha of unknown pixels"),
+                                      FALSE);
+
+      gegl = gegl_node_new ();
+
+      input_trimap = gegl_node_new_child (gegl,
+                                          "operation", "gegl:buffer-source",
+                                          "buffer",    trimap_buffer,
                                           NULL);
-    }
+      input_image = gegl_node_new_child (gegl,
+                                         "operation", "gegl:buffer-source",
+                                         "buffer",    drawable_buffer,
+                                         NULL);
+      crop_trimap = gegl_node_new_child (gegl,
+                                         "operation", "gegl:crop",
+                                         "x",         (gdouble) roi.x,
+                                         "y",         (gdouble) roi.y,
+                                         "width",     (gdouble) roi.width,
+                                         "height",    (gdouble) roi.height,
+                                         NULL);
+      crop_image = gegl_node_new_child (gegl,
+                                        "operation", "gegl:crop",
+                                        "x",         (gdouble) roi.x,
+                                        "y",         (gdouble) roi.y,
+                                        "width",     (gdouble) roi.width,
+                                        "height",    (gdouble) roi.height,
+                                        NULL);
+      output_mask = gegl_node_new_child (gegl,
+                                         "operation", "gegl:write-buffer",
+                                         "buffer",    fg_select->mask,
+                                         NULL);
+
+      if (options->engine == GIMP_MATTING_ENGINE_GLOBAL)
+        {
+          matting_node = gegl_node_new_child (gegl,
+                                              "operation",  "gegl:matting-global",
+                                              "iterations", options->iterations,
+                                              NULL);
+        }
+      else
+        {
+          matting_node = gegl_node_new_child (gegl,
+                                              "operation",     "gegl:matting-levin",
+                                              "levels",        options->levels,
+                                              "active_levels", options->active_levels,
+                                              NULL);
+        }
 
-  gegl_node_connect_to (input_image,  "output",
-                        matting_node, "input");
-  gegl_node_connect_to (input_trimap, "output",
-                        matting_node, "aux");
-  gegl_node_connect_to (matting_node, "output",
-                        output_mask,  "input");
+      gegl_node_link (input_image,  crop_image);
+      gegl_node_link (input_trimap, crop_trimap);
 
-  processor = gegl_node_new_processor (output_mask, NULL);
+      gegl_node_connect_to (crop_image,   "output",
+                            matting_node, "input");
+      gegl_node_connect_to (crop_trimap,  "output",
+                            matting_node, "aux");
+      gegl_node_connect_to (matting_node, "output",
+                            output_mask,  "input");
+
+      processor = gegl_node_new_processor (output_mask, &roi);
+
+      while (gegl_processor_work (processor, &value))
+        {
+          if (progress)
+            gimp_progress_set_value (progress, value);
+        }
 
-  while (gegl_processor_work (processor, &value))
-    {
       if (progress)
-        gimp_progress_set_value (progress, value);
+        gimp_progress_end (progress);
+
+      g_object_unref (processor);
+      g_object_unref (gegl);
     }
 
-  if (progress)
-    gimp_progress_end (progress);
+  gimp_foreground_select_tool_set_preview (fg_select, display);
+}
 
-  g_object_unref (processor);
+/*  returns the bounds of the pixels that are neither foreground nor
+ *  background in @trimap
+ */
+static gboolean
+gimp_foreground_select_tool_get_unknown_bounds (GeglBuffer    *trimap,
+                                                GeglRectangle *bounds)
+{
+  GeglBufferIterator *iter;
+  gint                x1 = G_MAXINT;
+  gint                y1 = G_MAXINT;
+  gint                x2 = G_MININT;
+  gint                y2 = G_MININT;
 
-  fg_select->mask = buffer;
+  iter = gegl_buffer_iterator_new (trimap, NULL, 0, babl_format ("Y float"),
+                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
 
-  gimp_foreground_select_tool_set_preview (fg_select, display);
+  while (gegl_buffer_iterator_next (iter))
+    {
+      const gfloat *data = iter->data[0];
+      gint          x, y;
+
+      for (y = iter->roi->y; y < iter->roi->y + iter->roi->height; y++)
+        {
+          gint row_x1 = G_MAXINT;
+          gint row_x2 = G_MININT;
+
+          for (x = iter->roi->x; x < iter->roi->x + iter->roi->width; x++)
+            {
+              if (*data > 0.0 && *data < 1.0)
+                {
+                  row_x1 = MIN (row_x1, x);
+                  row_x2 = x;
+                }
+
+              data++;
+            }
+
+          if (row_x1 <= row_x2)
+            {
+              x1 = MIN (x1, row_x1);
+              x2 = MAX (x2, row_x2);
+              y1 = MIN (y1, y);
+              y2 = MAX (y2, y);
+            }
+        }
+    }
+
+  if (x1 > x2)
+    return FALSE;
+
+  bounds->x      = x1;
+  bounds->y      = y1;
+  bounds->width  = x2 - x1 + 1;
+  bounds->height = y2 - y1 + 1;
 
-  g_object_unref (gegl);
+  return TRUE;
 }
 
 static void
@@ -43,9 +43,26 @@
 #include "gimp-intl.h"
 
 
+static void   gimp_fuzzy_select_tool_finalize       (GObject               *object);
+
+static void   gimp_fuzzy_select_tool_button_press   (GimpTool              *tool,
+                                                     const GimpCoords      *coords,
+                                                     guint32                time,
+                                                     GdkModifierType        state,
+                                                     GimpButtonPressType    press_type,
+                                                     GimpDisplay           *display);
+static void   gimp_fuzzy_select_tool_button_release (GimpTool              *tool,
+                                                     const GimpCoords      *coords,
+                                                     guint32                time,
+                                                     GdkModifierType        state,
+                                                     GimpButtonReleaseType  release_type,
+                                                     GimpDisplay           *display);
+
 static GeglBuffer * gimp_fuzzy_select_tool_get_mask (GimpRegionSelectTool *region_select,
                                                      GimpDisplay          *display);
 
+static void   gimp_fuzzy_select_tool_clear          (GimpFuzzySelectTool  *fuzzy_select);
+
 
 G_DEFINE_TYPE (GimpFuzzySelectTool, gimp_fuzzy_select_tool,
                GIMP_TYPE_REGION_SELECT_TOOL)
@@ -73,12 +90,19 @@ gimp_fuzzy_select_tool_register (GimpToolRegisterCallback  callback,
 static void
 gimp_fuzzy_select_tool_class_init (GimpFuzzySelectToolClass *klass)
 {
+  GObjectClass              *object_class = G_OBJECT_CLASS (klass);
+  GimpToolClass             *tool_class   = GIMP_TOOL_CLASS (klass);
   GimpRegionSelectToolClass *region_class;
 
   region_class = GIMP_REGION_SELECT_TOOL_CLASS (klass);
 
-  region_class->undo_desc = C_("command", "Fuzzy Select");
-  region_class->get_mask  = gimp_fuzzy_select_tool_get_mask;
+  object_class->finalize     = gimp_fuzzy_select_tool_finalize;
+
+  tool_class->button_press   = gimp_fuzzy_select_tool_button_press;
+  tool_class->button_release = gimp_fuzzy_select_tool_button_release;
+
+  region_class->undo_desc    = C_("command", "Fuzzy Select");
+  region_class->get_mask     = gimp_fuzzy_select_tool_get_mask;
 }
 
 static void
@@ -90,10 +114,48 @@ gimp_fuzzy_select_tool_init (GimpFuzzySelectTool *fuzzy_select)
                                      GIMP_TOOL_CURSOR_FUZZY_SELECT);
 }
 
+static void
+gimp_fuzzy_select_tool_finalize (GObject *object)
+{
+  gimp_fuzzy_select_tool_clear (GIMP_FUZZY_SELECT_TOOL (object));
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gimp_fuzzy_select_tool_button_press (GimpTool            *tool,
+                                     const GimpCoords    *coords,
+                                     guint32              time,
+                                     GdkModifierType      state,
+                                     GimpButtonPressType  press_type,
+                                     GimpDisplay         *display)
+{
+  /*  the image may have changed since the last click  */
+  gimp_fuzzy_select_tool_clear (GIMP_FUZZY_SELECT_TOOL (tool));
+
+  GIMP_TOOL_CLASS (parent_class)->button_press (tool, coords, time, state,
+                                                press_type, display);
+}
+
+static void
+gimp_fuzzy_select_tool_button_release (GimpTool              *tool,
+                                       const GimpCoords      *coords,
+                                       guint32                time,
+                                       GdkModifierType        state,
+                                       GimpButtonReleaseType  release_type,
+                                       GimpDisplay           *display)
+{
+  GIMP_TOOL_CLASS (parent_class)->button_release (tool, coords, time, state,
+                                                  release_type, display);
+
+  gimp_fuzzy_select_tool_clear (GIMP_FUZZY_SELECT_TOOL (tool));
+}
+
 static GeglBuffer *
 gimp_fuzzy_select_tool_get_mask (GimpRegionSelectTool *region_select,
                                  GimpDisplay          *display)
 {
+  GimpFuzzySelectTool     *fuzzy       = GIMP_FUZZY_SELECT_TOOL (region_select);
   GimpTool                *tool        = GIMP_TOOL (region_select);
   GimpSelectionOptions    *sel_options = GIMP_SELECTION_TOOL_GET_OPTIONS (tool);
   GimpRegionSelectOptions *options     = GIMP_REGION_SELECT_TOOL_GET_OPTIONS (tool);
@@ -101,6 +163,12 @@ gimp_fuzzy_select_tool_get_mask (GimpRegionSelectTool *region_select,
   GimpDrawable            *drawable    = gimp_image_get_active_drawable (image);
   gint                     x, y;
 
+  /*  only the threshold changes while dragging, so reuse the levels  */
+  if (fuzzy->levels_buffer)
+    return gimp_image_contiguous_region_by_levels (fuzzy->levels_buffer,
+                                                   sel_options->antialias,
+                                                   options->threshold / 255.0);
+
   x = region_select->x;
   y = region_select->y;
 
@@ -114,11 +182,24 @@ gimp_fuzzy_select_tool_get_mask (GimpRegionSelectTool *region_select,
       y -= off_y;
     }
 
-  return gimp_image_contiguous_region_by_seed (image, drawable,
-                                               options->sample_merged,
-                                               sel_options->antialias,
-                                               options->threshold / 255.0,
-                                               options->select_transparent,
-                                               options->select_criterion,
-                                               x, y);
+  fuzzy->levels_buffer =
+    gimp_image_contiguous_region_levels_by_seed (image, drawable,
+                                                 options->sample_merged,
+                                                 options->select_transparent,
+                                                 options->select_criterion,
+                                                 x, y);
+
+  return gimp_image_contiguous_region_by_levels (fuzzy->levels_buffer,
+                                                 sel_options->antialias,
+                                                 options->threshold / 255.0);
+}
+
+static void
+gimp_fuzzy_select_tool_clear (GimpFuzzySelectTool *fuzzy_select)
+{
+  if (fuzzy_select->levels_buffer)
+    {
+      g_object_unref (fuzzy_select->levels_buffer);
+      fuzzy_select->levels_buffer = NULL;
+    }
 }
@@ -38,6 +38,11 @@ typedef struct _GimpFuzzySelectToolClass GimpFuzzySelectToolClass;
 struct _GimpFuzzySelectTool
 {
   GimpRegionSelectTool  parent_instance;
+
+  /*  the levels at which the pixels join the seed's region, kept
+   *  while the threshold is changed by dragging
+   */
+  GeglBuffer           *levels_buffer;
 };
 
 struct _GimpFuzzySelectToolClass
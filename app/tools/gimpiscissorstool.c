@@ -42,8 +42,6 @@
 
 /* Livewire boundary implementation done by Laramie Leavitt */
 
-#if 0
-
 #include "config.h"
 
 #include <stdlib.h>
@@ -57,18 +55,11 @@
 
 #include "tools-types.h"
 
-#include "base/pixel-region.h"
-#include "base/tile-manager.h"
-#include "base/tile.h"
-
-#include "paint-funcs/paint-funcs.h"
-
-#include "gegl/gimp-gegl-utils.h"
-
 #include "core/gimpchannel.h"
 #include "core/gimpchannel-select.h"
 #include "core/gimpimage.h"
 #include "core/gimppickable.h"
+#include "core/gimpprojection.h"
 #include "core/gimpscanconvert.h"
 #include "core/gimptempbuf.h"
 #include "core/gimptoolinfo.h"
@@ -80,17 +71,16 @@
 
 #include "gimpiscissorsoptions.h"
 #include "gimpiscissorstool.h"
+#include "gimptilehandleriscissors.h"
 #include "gimptoolcontrol.h"
 
 #include "gimp-intl.h"
 
 
 /*  defines  */
-#define  MAX_GRADIENT      179.606  /* == sqrt (127^2 + 127^2) */
 #define  GRADIENT_SEARCH   32  /* how far to look when snapping to an edge */
 #define  EXTEND_BY         0.2 /* proportion to expand cost map by */
 #define  FIXED             5   /* additional fixed size to expand cost map */
-#define  MIN_GRADIENT      63  /* gradients < this are directionless */
 
 #define  COST_WIDTH        2   /* number of bytes for each pixel in cost map  */
 
@@ -158,9 +148,9 @@ static void   gimp_iscissors_tool_draw           (GimpDrawTool          *draw_to
 
 static void          iscissors_convert         (GimpIscissorsTool *iscissors,
                                                 GimpDisplay       *display);
-static TileManager * gradient_map_new          (GimpImage         *image);
+static GeglBuffer  * gradient_map_new          (GimpImage         *image);
 
-static void          find_optimal_path         (TileManager       *gradient_map,
+static void          find_optimal_path         (const guint8      *gradient,
                                                 GimpTempBuf       *dp_buf,
                                                 gint               x1,
                                                 gint               y1,
@@ -232,38 +222,10 @@ static const gint move[8][2] =
  */
 
 
-/*  temporary convolution buffers --  */
-static guchar  maxgrad_conv0[TILE_WIDTH * TILE_HEIGHT * 4] = "";
-static guchar  maxgrad_conv1[TILE_WIDTH * TILE_HEIGHT * 4] = "";
-static guchar  maxgrad_conv2[TILE_WIDTH * TILE_HEIGHT * 4] = "";
-
-
-static const gfloat horz_deriv[9] =
-{
-   1,  0, -1,
-   2,  0, -2,
-   1,  0, -1,
-};
-
-static const gfloat vert_deriv[9] =
-{
-   1,  2,  1,
-   0,  0,  0,
-  -1, -2, -1,
-};
-
-static const gfloat blur_32[9] =
-{
-   1,  1,  1,
-   1, 24,  1,
-   1,  1,  1,
-};
-
 static gfloat  distance_weights[GRADIENT_SEARCH * GRADIENT_SEARCH];
 
 static gint    diagonal_weight[256];
 static gint    direction_value[256][4];
-static Tile   *cur_tile    = NULL;
 
 
 void
@@ -395,14 +357,7 @@ gimp_iscissors_tool_control (GimpTool       *tool,
       /* free the gradient map */
       if (iscissors->gradient_map)
         {
-          /* release any tile we were using */
-          if (cur_tile)
-            {
-              tile_release (cur_tile, FALSE);
-              cur_tile = NULL;
-            }
-
-          tile_manager_unref (iscissors->gradient_map);
+          g_object_unref (iscissors->gradient_map);
           iscissors->gradient_map = NULL;
         }
 
@@ -1340,14 +1295,26 @@ calculate_curve (GimpIscissorsTool *iscissors,
   /*  If the bounding box has width and height...  */
   if ((x2 - x1) && (y2 - y1))
     {
+      guint8 *gradient;
+
       width = (x2 - x1);
       height = (y2 - y1);
 
-      /* Initialise the gradient map tile manager for this image if we
+      /* Initialise the gradient map buffer for this image if we
        * don't already have one. */
       if (!iscissors->gradient_map)
           iscissors->gradient_map = gradient_map_new (image);
 
+      /*  fetch the gradients of the whole search area at once, instead
+       *  of looking up the tile of every pixel
+       */
+      gradient = g_new (guint8, width * height * COST_WIDTH);
+
+      gegl_buffer_get (iscissors->gradient_map,
+                       GEGL_RECTANGLE (x1, y1, width, height), 1.0,
+                       NULL, gradient,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
       /*  allocate the dynamic programming array  */
       if (iscissors->dp_buf)
         gimp_temp_buf_unref (iscissors->dp_buf);
@@ -1356,9 +1323,11 @@ calculate_curve (GimpIscissorsTool *iscissors,
                                              babl_format ("Y u32"));
 
       /*  find the optimal path of pixels from (x1, y1) to (x2, y2)  */
-      find_optimal_path (iscissors->gradient_map, iscissors->dp_buf,
+      find_optimal_path (gradient, iscissors->dp_buf,
                          x1, y1, x2, y2, xs, ys);
 
+      g_free (gradient);
+
       /*  get a list of the pixels in the optimal path  */
       curve->points = plot_pixels (iscissors, iscissors->dp_buf,
                                    x1, y1, xs, ys, xe, ye);
@@ -1392,57 +1361,22 @@ calculate_curve (GimpIscissorsTool *iscissors,
 }
 
 
-/* badly need to get a replacement - this is _way_ too expensive */
-static gboolean
-gradient_map_value (TileManager *map,
-                    gint         x,
-                    gint         y,
-                    guint8      *grad,
-                    guint8      *dir)
+static gint
+calculate_link (const guint8 *gradient,
+                gint          width,
+                gint          x,
+                gint          y,
+                guint32       pixel,
+                gint          link)
 {
-  static gint   cur_tilex;
-  static gint   cur_tiley;
+  gint          value = 0;
   const guint8 *p;
+  guint8        grad1, dir1, grad2, dir2;
 
-  if (! cur_tile ||
-      x / TILE_WIDTH != cur_tilex ||
-      y / TILE_HEIGHT != cur_tiley)
-    {
-      if (cur_tile)
-        tile_release (cur_tile, FALSE);
-
-      cur_tile = tile_manager_get_tile (map, x, y, TRUE, FALSE);
-
-      if (!cur_tile)
-        return FALSE;
-
-      cur_tilex = x / TILE_WIDTH;
-      cur_tiley = y / TILE_HEIGHT;
-    }
-
-  p = tile_data_pointer (cur_tile, x, y);
-
-  *grad = p[0];
-  *dir  = p[1];
-
-  return TRUE;
-}
+  p = gradient + (y * width + x) * COST_WIDTH;
 
-static gint
-calculate_link (TileManager *gradient_map,
-                gint         x,
-                gint         y,
-                guint32      pixel,
-                gint         link)
-{
-  gint   value = 0;
-  guint8 grad1, dir1, grad2, dir2;
-
-  if (!gradient_map_value (gradient_map, x, y, &grad1, &dir1))
-    {
-      grad1 = 0;
-      dir1 = 255;
-    }
+  grad1 = p[0];
+  dir1  = p[1];
 
   /* Convert the gradient into a cost: large gradients are good, and
    * so have low cost. */
@@ -1458,11 +1392,10 @@ calculate_link (TileManager *gradient_map,
   x += (gint8)(pixel & 0xff);
   y += (gint8)((pixel & 0xff00) >> 8);
 
-  if (!gradient_map_value (gradient_map, x, y, &grad2, &dir2))
-    {
-      grad2 = 0;
-      dir2 = 255;
-    }
+  p = gradient + (y * width + x) * COST_WIDTH;
+
+  grad2 = p[0];
+  dir2  = p[1];
 
   value +=
     (direction_value[dir1][link] + direction_value[dir2][link]) * OMEGA_D;
@@ -1521,14 +1454,14 @@ plot_pixels (GimpIscissorsTool *iscissors,
 
 
 static void
-find_optimal_path (TileManager *gradient_map,
-                   GimpTempBuf *dp_buf,
-                   gint         x1,
-                   gint         y1,
-                   gint         x2,
-                   gint         y2,
-                   gint         xs,
-                   gint         ys)
+find_optimal_path (const guint8 *gradient,
+                   GimpTempBuf  *dp_buf,
+                   gint          x1,
+                   gint          y1,
+                   gint          x2,
+                   gint          y2,
+                   gint          xs,
+                   gint          ys)
 {
   gint     i, j, k;
   gint     x, y;
@@ -1600,8 +1533,9 @@ find_optimal_path (TileManager *gradient_map,
           for (k = 0; k < 8; k ++)
             if (pixel[k])
               {
-                link_cost[k] = calculate_link (gradient_map,
-                                               xs + j*dirx, ys + i*diry,
+                link_cost[k] = calculate_link (gradient, dp_buf_width,
+                                               xs - x1 + j*dirx,
+                                               ys - y1 + i*diry,
                                                pixel [k],
                                                ((k > 3) ? k - 4 : k));
                 offset = OFFSET (pixel [k]);
@@ -1655,158 +1589,23 @@ find_optimal_path (TileManager *gradient_map,
 }
 
 
-/* Called to fill in a newly referenced tile in the gradient map */
-static void
-gradmap_tile_validate (TileManager *tm,
-                       Tile        *tile,
-                       GimpImage   *image)
-{
-  GimpPickable *pickable;
-  const Babl   *pickable_format;
-  GeglBuffer   *src_buffer;
-  Tile         *srctile;
-  PixelRegion   srcPR;
-  PixelRegion   destPR;
-  gint          x, y;
-  gint          dw, dh;
-  gint          sw, sh;
-  gint          i, j;
-  gint          b;
-  gfloat        gradient;
-  guint8       *tiledata;
-  guint8       *gradmap;
-
-  tile_manager_get_tile_coordinates (tm, tile, &x, &y);
-
-  dw = tile_ewidth (tile);
-  dh = tile_eheight (tile);
-
-  pickable = GIMP_PICKABLE (gimp_image_get_projection (image));
-
-  gimp_pickable_flush (pickable);
-
-  /* get corresponding tile in the image */
-  src_buffer = gimp_pickable_get_buffer (pickable);
-  srctile = tile_manager_get_tile (gimp_gegl_buffer_get_tiles (src_buffer),
-                                   x, y, TRUE, FALSE);
-  if (! srctile)
-    return;
-
-  sw = tile_ewidth (srctile);
-  sh = tile_eheight (srctile);
-
-  pickable_format = gimp_pickable_get_format (pickable);
-
-  pixel_region_init_data (&srcPR,
-                          tile_data_pointer (srctile, 0, 0),
-                          babl_format_get_bytes_per_pixel (pickable_format),
-                          babl_format_get_bytes_per_pixel (pickable_format) *
-                          MIN (dw, sw),
-                          0, 0, MIN (dw, sw), MIN (dh, sh));
-
-
-  /* XXX tile edges? */
-
-  /*  Blur the source to get rid of noise  */
-  pixel_region_init_data (&destPR, maxgrad_conv0, 4, TILE_WIDTH * 4,
-                          0, 0, srcPR.w, srcPR.h);
-  convolve_region (&srcPR, &destPR, blur_32, 3, 32, GIMP_NORMAL_CONVOL, FALSE);
-
-  /*  Use the blurred region as the new source pixel region  */
-  pixel_region_init_data (&srcPR, maxgrad_conv0, 4, TILE_WIDTH * 4,
-                          0, 0, srcPR.w, srcPR.h);
-
-  /*  Get the horizontal derivative  */
-  pixel_region_init_data (&destPR, maxgrad_conv1, 4, TILE_WIDTH * 4,
-                          0, 0, srcPR.w, srcPR.h);
-  convolve_region (&srcPR, &destPR, horz_deriv, 3, 1, GIMP_NEGATIVE_CONVOL,
-                   FALSE);
-
-  /*  Get the vertical derivative  */
-  pixel_region_init_data (&destPR, maxgrad_conv2, 4, TILE_WIDTH * 4,
-                          0, 0, srcPR.w, srcPR.h);
-  convolve_region (&srcPR, &destPR, vert_deriv, 3, 1, GIMP_NEGATIVE_CONVOL,
-                   FALSE);
-
-  /* calculate overall gradient */
-  tiledata = tile_data_pointer (tile, 0, 0);
-
-  for (i = 0; i < srcPR.h; i++)
-    {
-      const guint8 *datah = maxgrad_conv1 + srcPR.rowstride * i;
-      const guint8 *datav = maxgrad_conv2 + srcPR.rowstride * i;
-
-      gradmap = tiledata + tile_ewidth (tile) * COST_WIDTH * i;
-
-      for (j = 0; j < srcPR.w; j++)
-        {
-          gint8 hmax = datah[0] - 128;
-          gint8 vmax = datav[0] - 128;
-
-          for (b = 1; b < srcPR.bytes; b++)
-            {
-              if (abs (datah[b] - 128) > abs (hmax))
-                hmax = datah[b] - 128;
-
-              if (abs (datav[b] - 128) > abs (vmax))
-                vmax = datav[b] - 128;
-            }
-
-          if (i == 0 || j == 0 || i == srcPR.h-1 || j == srcPR.w-1)
-            {
-              gradmap[j * COST_WIDTH + 0] = 0;
-              gradmap[j * COST_WIDTH + 1] = 255;
-              goto contin;
-            }
-
-          /* 1 byte absolute magnitude first */
-          gradient = sqrt (SQR (hmax) + SQR (vmax));
-          gradmap[j * COST_WIDTH] = gradient * 255 / MAX_GRADIENT;
-
-          /* then 1 byte direction */
-          if (gradient > MIN_GRADIENT)
-            {
-              gfloat direction;
-
-              if (!hmax)
-                direction = (vmax > 0) ? G_PI_2 : -G_PI_2;
-              else
-                direction = atan ((gdouble) vmax / (gdouble) hmax);
-
-              /* Scale the direction from between 0 and 254,
-               *  corresponding to -PI/2, PI/2 255 is reserved for
-               *  d9irectionless pixels */
-              gradmap[j * COST_WIDTH + 1] =
-                (guint8) (254 * (direction + G_PI_2) / G_PI);
-            }
-          else
-            {
-              gradmap[j * COST_WIDTH + 1] = 255; /* reserved for weak gradient */
-            }
-
-        contin:
-          datah += srcPR.bytes;
-          datav += srcPR.bytes;
-        }
-    }
-
-  tile_release (srctile, FALSE);
-}
-
-static TileManager *
+static GeglBuffer *
 gradient_map_new (GimpImage *image)
 {
-  TileManager *tm;
+  GeglBuffer      *buffer;
+  GeglTileHandler *handler;
 
-  tm = tile_manager_new (gimp_image_get_width  (image),
-                         gimp_image_get_height (image),
-                         sizeof (guint8) * COST_WIDTH);
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0,
+                                            gimp_image_get_width  (image),
+                                            gimp_image_get_height (image)),
+                            babl_format_n (babl_type ("u8"), COST_WIDTH));
 
-  tile_manager_set_validate_proc (tm,
-                                  (TileValidateProc) gradmap_tile_validate,
-                                  image);
+  /*  the tiles are computed lazily, when they are first read  */
+  handler = gimp_tile_handler_iscissors_new (GIMP_PICKABLE (gimp_image_get_projection (image)));
+  gegl_buffer_add_handler (buffer, handler);
+  g_object_unref (handler);
 
-  return tm;
+  return buffer;
 }
 
 static void
@@ -1815,16 +1614,14 @@ find_max_gradient (GimpIscissorsTool *iscissors,
                    gint              *x,
                    gint              *y)
 {
-  PixelRegion  srcPR;
-  gint         radius;
-  gint         i, j;
-  gint         endx, endy;
-  gint         cx, cy;
-  gint         x1, y1, x2, y2;
-  gpointer     pr;
-  gfloat       max_gradient;
-
-  /* Initialise the gradient map tile manager for this image if we
+  guint8  gradient[GRADIENT_SEARCH * GRADIENT_SEARCH * COST_WIDTH];
+  gint    radius;
+  gint    i, j;
+  gint    cx, cy;
+  gint    x1, y1, x2, y2;
+  gfloat  max_gradient;
+
+  /* Initialise the gradient map buffer for this image if we
    * don't already have one. */
   if (! iscissors->gradient_map)
     iscissors->gradient_map = gradient_map_new (image);
@@ -1844,40 +1641,35 @@ find_max_gradient (GimpIscissorsTool *iscissors,
   *x = cx;
   *y = cy;
 
-  /*  Find the point of max gradient  */
-  pixel_region_init (&srcPR, iscissors->gradient_map,
-                     x1, y1, x2 - x1, y2 - y1, FALSE);
+  if (x2 <= x1 || y2 <= y1)
+    return;
 
-  /* this iterates over 1, 2 or 4 tiles only */
-  for (pr = pixel_regions_register (1, &srcPR);
-       pr != NULL;
-       pr = pixel_regions_process (pr))
+  /*  this touches 1, 2 or 4 tiles only  */
+  gegl_buffer_get (iscissors->gradient_map,
+                   GEGL_RECTANGLE (x1, y1, x2 - x1, y2 - y1), 1.0,
+                   NULL, gradient,
+                   GRADIENT_SEARCH * COST_WIDTH, GEGL_ABYSS_NONE);
+
+  /*  Find the point of max gradient  */
+  for (i = y1; i < y2; i++)
     {
-      endx = srcPR.x + srcPR.w;
-      endy = srcPR.y + srcPR.h;
+      const guint8 *p = gradient + (i - y1) * GRADIENT_SEARCH * COST_WIDTH;
 
-      for (i = srcPR.y; i < endy; i++)
+      for (j = x1; j < x2; j++)
         {
-          const guint8 *gradient = srcPR.data + srcPR.rowstride * (i - srcPR.y);
+          gfloat g = *p;
 
-          for (j = srcPR.x; j < endx; j++)
-            {
-              gfloat g = *gradient;
+          p += COST_WIDTH;
 
-              gradient += COST_WIDTH;
+          g *= distance_weights [(i-y1) * GRADIENT_SEARCH + (j-x1)];
 
-              g *= distance_weights [(i-y1) * GRADIENT_SEARCH + (j-x1)];
-
-              if (g > max_gradient)
-                {
-                  max_gradient = g;
+          if (g > max_gradient)
+            {
+              max_gradient = g;
 
-                  *x = j;
-                  *y = i;
-                }
+              *x = j;
+              *y = i;
             }
         }
     }
 }
-
-#endif
@@ -15,8 +15,6 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#if 0
-
 #ifndef __GIMP_ISCISSORS_TOOL_H__
 #define __GIMP_ISCISSORS_TOOL_H__
 
@@ -86,7 +84,7 @@ struct _GimpIscissorsTool
 
   /* XXX might be useful */
   GimpChannel    *mask;         /*  selection mask                        */
-  TileManager    *gradient_map; /*  lazily filled gradient map            */
+  GeglBuffer     *gradient_map; /*  lazily filled gradient map            */
 };
 
 struct _GimpIscissorsToolClass
@@ -102,5 +100,3 @@ GType   gimp_iscissors_tool_get_type (void) G_GNUC_CONST;
 
 
 #endif  /*  __GIMP_ISCISSORS_TOOL_H__  */
-
-#endif
@@ -0,0 +1,277 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+
+#include "tools-types.h"
+
+#include "core/gimpdrawable.h"
+#include "core/gimpimage.h"
+#include "core/gimpprojection.h"
+
+#include "paint/gimpairbrush.h"
+#include "paint/gimppaintcore.h"
+#include "paint/gimppaintoptions.h"
+
+#include "display/gimpdisplay.h"
+
+#include "gimppainttool.h"
+#include "gimppainttool-paint.h"
+
+
+/*  how often the painted area is pushed to the projection, in ms  */
+#define PAINT_FLUSH_INTERVAL 16
+
+
+typedef struct
+{
+  GimpPaintTool    *tool;
+  GimpPaintOptions *paint_options;
+  GimpCoords        coords;
+  guint32           time;
+} PaintItem;
+
+
+static gpointer   gimp_paint_tool_paint_thread  (gpointer  data);
+static gint       gimp_paint_tool_paint_poll    (GPollFD  *fds,
+                                                 guint     nfds,
+                                                 gint      timeout);
+static gboolean   gimp_paint_tool_paint_timeout (gpointer  data);
+
+
+/*  the paint thread consumes the motion events queued while a stroke
+ *  is active, so event handling never waits for the rendering of dabs
+ */
+static GThread       *paint_thread;
+
+/*  held by the paint thread while painting, and by the main thread
+ *  during a stroke, except while it waits for events in poll(). The
+ *  projection renderer, the brush outline and everything else that
+ *  reads the drawable or the paint core therefore never runs at the
+ *  same time as a dab.
+ */
+static GMutex         paint_mutex;
+static GPollFunc      paint_poll_func;
+
+static GMutex         paint_queue_mutex;
+static GCond          paint_queue_cond;
+static GQueue         paint_queue = G_QUEUE_INIT;
+static gboolean       paint_busy;
+
+static GimpPaintTool *paint_tool;
+static GimpDisplay   *paint_display;
+static GimpDrawable  *paint_drawable;
+static guint          paint_timeout_id;
+
+
+/*  public functions  */
+
+gboolean
+gimp_paint_tool_paint_start (GimpPaintTool *tool,
+                             GimpDisplay   *display,
+                             GimpDrawable  *drawable)
+{
+  g_return_val_if_fail (GIMP_IS_PAINT_TOOL (tool), FALSE);
+  g_return_val_if_fail (GIMP_IS_DISPLAY (display), FALSE);
+  g_return_val_if_fail (GIMP_IS_DRAWABLE (drawable), FALSE);
+  g_return_val_if_fail (paint_tool == NULL, FALSE);
+
+  /*  the airbrush paints from its own main loop timeout  */
+  if (GIMP_IS_AIRBRUSH (tool->core))
+    return FALSE;
+
+  if (! paint_thread)
+    paint_thread = g_thread_new ("paint",
+                                 gimp_paint_tool_paint_thread, NULL);
+
+  paint_tool     = tool;
+  paint_display  = display;
+  paint_drawable = drawable;
+
+  tool->core->batch_updates = TRUE;
+
+  g_mutex_lock (&paint_mutex);
+
+  paint_poll_func = g_main_context_get_poll_func (NULL);
+  g_main_context_set_poll_func (NULL, gimp_paint_tool_paint_poll);
+
+  paint_timeout_id = g_timeout_add (PAINT_FLUSH_INTERVAL,
+                                    gimp_paint_tool_paint_timeout, NULL);
+
+  return TRUE;
+}
+
+void
+gimp_paint_tool_paint_end (GimpPaintTool *tool)
+{
+  g_return_if_fail (GIMP_IS_PAINT_TOOL (tool));
+
+  if (tool != paint_tool)
+    return;
+
+  gimp_paint_tool_paint_sync (tool);
+
+  g_source_remove (paint_timeout_id);
+  paint_timeout_id = 0;
+
+  g_main_context_set_poll_func (NULL, paint_poll_func);
+  paint_poll_func = NULL;
+
+  g_mutex_unlock (&paint_mutex);
+
+  tool->core->batch_updates = FALSE;
+
+  gimp_paint_core_flush_updates (tool->core, paint_drawable);
+
+  paint_tool     = NULL;
+  paint_display  = NULL;
+  paint_drawable = NULL;
+}
+
+gboolean
+gimp_paint_tool_paint_is_active (GimpPaintTool *tool)
+{
+  g_return_val_if_fail (GIMP_IS_PAINT_TOOL (tool), FALSE);
+
+  return tool == paint_tool;
+}
+
+void
+gimp_paint_tool_paint_motion (GimpPaintTool    *tool,
+                              GimpPaintOptions *paint_options,
+                              const GimpCoords *coords,
+                              guint32           time)
+{
+  PaintItem *item;
+
+  g_return_if_fail (gimp_paint_tool_paint_is_active (tool));
+  g_return_if_fail (GIMP_IS_PAINT_OPTIONS (paint_options));
+  g_return_if_fail (coords != NULL);
+
+  item = g_slice_new (PaintItem);
+
+  item->tool          = tool;
+  item->paint_options = paint_options;
+  item->coords        = *coords;
+  item->time          = time;
+
+  g_mutex_lock (&paint_queue_mutex);
+
+  g_queue_push_tail (&paint_queue, item);
+  g_cond_broadcast (&paint_queue_cond);
+
+  g_mutex_unlock (&paint_queue_mutex);
+}
+
+/*  waits until all queued motion events are painted  */
+void
+gimp_paint_tool_paint_sync (GimpPaintTool *tool)
+{
+  g_return_if_fail (GIMP_IS_PAINT_TOOL (tool));
+
+  if (tool != paint_tool)
+    return;
+
+  /*  let the paint thread have the paint core until it's done  */
+  g_mutex_unlock (&paint_mutex);
+
+  g_mutex_lock (&paint_queue_mutex);
+
+  while (! g_queue_is_empty (&paint_queue) || paint_busy)
+    g_cond_wait (&paint_queue_cond, &paint_queue_mutex);
+
+  g_mutex_unlock (&paint_queue_mutex);
+
+  g_mutex_lock (&paint_mutex);
+}
+
+
+/*  private functions  */
+
+static gpointer
+gimp_paint_tool_paint_thread (gpointer data)
+{
+  g_mutex_lock (&paint_queue_mutex);
+
+  while (TRUE)
+    {
+      PaintItem *item;
+
+      while (g_queue_is_empty (&paint_queue))
+        g_cond_wait (&paint_queue_cond, &paint_queue_mutex);
+
+      item       = g_queue_pop_head (&paint_queue);
+      paint_busy = TRUE;
+
+      g_mutex_unlock (&paint_queue_mutex);
+
+      g_mutex_lock (&paint_mutex);
+
+      gimp_paint_core_interpolate (item->tool->core, paint_drawable,
+                                   item->paint_options,
+                                   &item->coords, item->time);
+
+      g_mutex_unlock (&paint_mutex);
+
+      g_slice_free (PaintItem, item);
+
+      g_mutex_lock (&paint_queue_mutex);
+
+      paint_busy = FALSE;
+
+      if (g_queue_is_empty (&paint_queue))
+        g_cond_broadcast (&paint_queue_cond);
+    }
+
+  return NULL;
+}
+
+static gint
+gimp_paint_tool_paint_poll (GPollFD *fds,
+                            guint    nfds,
+                            gint     timeout)
+{
+  gint result;
+
+  g_mutex_unlock (&paint_mutex);
+
+  result = paint_poll_func (fds, nfds, timeout);
+
+  g_mutex_lock (&paint_mutex);
+
+  return result;
+}
+
+static gboolean
+gimp_paint_tool_paint_timeout (gpointer data)
+{
+  /*  the main thread holds paint_mutex, the paint thread is between
+   *  two dabs
+   */
+  if (gimp_paint_core_flush_updates (paint_tool->core, paint_drawable))
+    {
+      GimpImage *image = gimp_item_get_image (GIMP_ITEM (paint_drawable));
+
+      gimp_projection_flush_now (gimp_image_get_projection (image));
+      gimp_display_flush_now (paint_display);
+    }
+
+  return TRUE;
+}
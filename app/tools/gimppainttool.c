@@ -35,6 +35,7 @@
 #include "core/gimptoolinfo.h"
 
 #include "paint/gimppaintcore.h"
+#include "paint/gimppaintcore-replay.h"
 #include "paint/gimppaintoptions.h"
 
 #include "widgets/gimpdevices.h"
@@ -46,6 +47,7 @@
 
 #include "gimpcoloroptions.h"
 #include "gimppainttool.h"
+#include "gimppainttool-paint.h"
 #include "gimptoolcontrol.h"
 
 #include "gimp-intl.h"
@@ -95,12 +97,20 @@ static void   gimp_paint_tool_hard_notify    (GimpPaintOptions      *options,
                                               const GParamSpec      *pspec,
                                               GimpTool              *tool);
 
+static void   gimp_paint_tool_save_recording (GimpPaintTool         *paint_tool,
+                                              GimpDisplay           *display);
+
 
 G_DEFINE_TYPE (GimpPaintTool, gimp_paint_tool, GIMP_TYPE_COLOR_TOOL)
 
 #define parent_class gimp_paint_tool_parent_class
 
 
+/*  the directory to record strokes to, from GIMP_RECORD_STROKES  */
+static const gchar *record_dir      = NULL;
+static gint         record_n_stroke = 0;
+
+
 static void
 gimp_paint_tool_class_init (GimpPaintToolClass *klass)
 {
@@ -120,6 +130,8 @@ gimp_paint_tool_class_init (GimpPaintToolClass *klass)
   tool_class->oper_update    = gimp_paint_tool_oper_update;
 
   draw_tool_class->draw      = gimp_paint_tool_draw;
+
+  record_dir = g_getenv ("GIMP_RECORD_STROKES");
 }
 
 static void
@@ -219,6 +231,7 @@ gimp_paint_tool_control (GimpTool       *tool,
       break;
 
     case GIMP_TOOL_ACTION_HALT:
+      gimp_paint_tool_paint_end (paint_tool);
       gimp_paint_core_cleanup (paint_tool->core);
       break;
     }
@@ -296,6 +309,9 @@ gimp_paint_tool_button_press (GimpTool            *tool,
       tool->display = display;
     }
 
+  if (record_dir)
+    gimp_paint_core_record_start (core);
+
   if (! gimp_paint_core_start (core, drawable, paint_options, &curr_coords,
                                &error))
     {
@@ -338,6 +354,9 @@ gimp_paint_tool_button_press (GimpTool            *tool,
   gimp_paint_core_paint (core, drawable, paint_options,
                          GIMP_PAINT_STATE_INIT, time);
 
+  /*  the stroke starts at the last coords, the rest is interpolated  */
+  gimp_paint_core_record (core, &core->last_coords, time);
+
   /*  Paint to the image  */
   if (paint_tool->draw_line)
     {
@@ -353,6 +372,9 @@ gimp_paint_tool_button_press (GimpTool            *tool,
   gimp_projection_flush_now (gimp_image_get_projection (image));
   gimp_display_flush_now (display);
 
+  /*  paint the rest of the stroke asynchronously  */
+  gimp_paint_tool_paint_start (paint_tool, display, drawable);
+
   gimp_draw_tool_start (draw_tool, display);
 }
 
@@ -371,6 +393,9 @@ gimp_paint_tool_button_release (GimpTool              *tool,
   GimpImage        *image         = gimp_display_get_image (display);
   GimpDrawable     *drawable      = gimp_image_get_active_drawable (image);
 
+  /*  wait for the queued motion to be painted  */
+  gimp_paint_tool_paint_end (paint_tool);
+
   if (gimp_color_tool_is_enabled (GIMP_COLOR_TOOL (tool)))
     {
       GIMP_TOOL_CLASS (parent_class)->button_release (tool, coords, time,
@@ -397,6 +422,11 @@ gimp_paint_tool_button_release (GimpTool              *tool,
   else
     gimp_paint_core_finish (core, drawable, TRUE);
 
+  if (core->recording)
+    gimp_paint_tool_save_recording (paint_tool,
+                                    release_type != GIMP_BUTTON_RELEASE_CANCEL ?
+                                    display : NULL);
+
   gimp_image_flush (image);
 
   gimp_draw_tool_resume (GIMP_DRAW_TOOL (tool));
@@ -434,10 +464,23 @@ gimp_paint_tool_motion (GimpTool         *tool,
   /*  don't paint while the Shift key is pressed for line drawing  */
   if (paint_tool->draw_line)
     {
+      gimp_paint_tool_paint_sync (paint_tool);
+
       gimp_paint_core_set_current_coords (core, &curr_coords);
       return;
     }
 
+  if (gimp_paint_tool_paint_is_active (paint_tool))
+    {
+      gimp_draw_tool_pause (GIMP_DRAW_TOOL (tool));
+
+      gimp_paint_tool_paint_motion (paint_tool, paint_options,
+                                    &curr_coords, time);
+
+      gimp_draw_tool_resume (GIMP_DRAW_TOOL (tool));
+      return;
+    }
+
   gimp_draw_tool_pause (GIMP_DRAW_TOOL (tool));
 
   gimp_paint_core_interpolate (core, drawable, paint_options,
@@ -763,3 +806,38 @@ gimp_paint_tool_hard_notify (GimpPaintOptions *options,
                                    GIMP_CURSOR_PRECISION_PIXEL_CENTER :
                                    GIMP_CURSOR_PRECISION_SUBPIXEL);
 }
+
+/*  saves the stroke recorded since the button press, or just drops
+ *  it if @display is NULL
+ */
+static void
+gimp_paint_tool_save_recording (GimpPaintTool *paint_tool,
+                                GimpDisplay   *display)
+{
+  GimpPaintEvent *events;
+  gint            n_events;
+
+  events = gimp_paint_core_record_stop (paint_tool->core, &n_events);
+
+  if (display && n_events > 0)
+    {
+      gchar  *basename;
+      gchar  *filename;
+      GError *error = NULL;
+
+      basename = g_strdup_printf ("stroke-%04d.txt", ++record_n_stroke);
+      filename = g_build_filename (record_dir, basename, NULL);
+      g_free (basename);
+
+      if (! gimp_paint_events_save (filename, events, n_events, &error))
+        {
+          gimp_tool_message_literal (GIMP_TOOL (paint_tool), display,
+                                     error->message);
+          g_clear_error (&error);
+        }
+
+      g_free (filename);
+    }
+
+  g_free (events);
+}
@@ -42,8 +42,6 @@
 #include "widgets/gimpclipboard.h"
 
 #include "display/gimpdisplay.h"
-#include "display/gimpdisplayshell.h"
-#include "display/gimpdisplayshell-transform.h"
 
 #include "gimpseamlessclonetool.h"
 #include "gimpseamlesscloneoptions.h"
@@ -676,8 +674,8 @@ gimp_seamless_clone_tool_render_node_update (GimpSeamlessCloneTool *sc)
   gimp_item_get_offset (GIMP_ITEM (bg), &off_x, &off_y);
 
   gegl_node_set (sc->sc_node,
-                 "xoff", (gint) sc->xoff - off_y,
-                 "yoff", (gint) sc->yoff - off_x,
+                 "xoff", (gint) sc->xoff - off_x,
+                 "yoff", (gint) sc->yoff - off_y,
                  NULL);
 }
 
@@ -695,6 +693,9 @@ gimp_seamless_clone_tool_create_image_map (GimpSeamlessCloneTool *sc,
 
   gimp_image_map_set_region (sc->image_map, GIMP_IMAGE_MAP_REGION_DRAWABLE);
 
+  sc->rendered.width  = 0;
+  sc->rendered.height = 0;
+
   g_signal_connect (sc->image_map, "flush",
                     G_CALLBACK (gimp_seamless_clone_tool_image_map_flush),
                     sc);
@@ -712,49 +713,47 @@ gimp_seamless_clone_tool_image_map_flush (GimpImageMap *image_map,
 static void
 gimp_seamless_clone_tool_image_map_update (GimpSeamlessCloneTool *sc)
 {
-  GimpTool         *tool  = GIMP_TOOL (sc);
-  GimpDisplayShell *shell = gimp_display_get_shell (tool->display);
-  GimpItem         *item  = GIMP_ITEM (tool->drawable);
-  gint              x, y;
-  gint              w, h;
-  gint              off_x, off_y;
-  GeglRectangle     visible;
-  GeglOperation    *op = NULL;
-
-  /* Find out at which x,y is the top left corner of the currently
-   * displayed part */
-  gimp_display_shell_untransform_viewport (shell, &x, &y, &w, &h);
+  GimpTool      *tool  = GIMP_TOOL (sc);
+  GimpItem      *item  = GIMP_ITEM (tool->drawable);
+  gint           off_x, off_y;
+  GeglRectangle  paste;
+  GeglRectangle  update;
+  GeglOperation *op = NULL;
 
   /* Find out where is our drawable positioned */
   gimp_item_get_offset (item, &off_x, &off_y);
 
-  /* Create a rectangle from the intersection of the currently displayed
-   * part with the drawable */
-  gimp_rectangle_intersect (x, y, w, h,
-                            off_x,
-                            off_y,
-                            gimp_item_get_width  (item),
-                            gimp_item_get_height (item),
-                            &visible.x,
-                            &visible.y,
-                            &visible.width,
-                            &visible.height);
-
-  /* Since the image_map_apply function receives a rectangle describing
-   * where it should update the preview, and since that rectangle should
-   * be relative to the drawable's location, we now offset back by the
-   * drawable's offsetts. */
-  visible.x -= off_x;
-  visible.y -= off_y;
+  /* The image map only changes pixels below the paste, so only the
+   * paste's previous and new location need to be rendered again.
+   * Since the image_map_apply function receives a rectangle relative
+   * to the drawable's location, we offset back by the drawable's
+   * offsets. */
+  paste.x      = sc->xoff - off_x;
+  paste.y      = sc->yoff - off_y;
+  paste.width  = sc->width;
+  paste.height = sc->height;
+
+  if (sc->rendered.width > 0 && sc->rendered.height > 0)
+    gegl_rectangle_bounding_box (&update, &sc->rendered, &paste);
+  else
+    update = paste;
+
+  sc->rendered = paste;
+
+  if (! gegl_rectangle_intersect (&update, &update,
+                                  GEGL_RECTANGLE (0, 0,
+                                                  gimp_item_get_width  (item),
+                                                  gimp_item_get_height (item))))
+    return;
 
   g_object_get (sc->sc_node, "gegl-operation", &op, NULL);
-  /* If any cache of the visible area was present, clear it!
+  /* If any cache of the updated area was present, clear it!
    * We need to clear the cache in the sc_node, since that is
    * where the previous paste was located
    */
-  gegl_operation_invalidate (op, &visible, TRUE);
+  gegl_operation_invalidate (op, &update, TRUE);
   g_object_unref (op);
 
   /* Now update the image map and show this area */
-  gimp_image_map_apply (sc->image_map, NULL);
+  gimp_image_map_apply (sc->image_map, &update);
 }
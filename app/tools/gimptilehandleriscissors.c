@@ -0,0 +1,391 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdlib.h>
+
+#include <gegl.h>
+
+#include "libgimpmath/gimpmath.h"
+
+#include "tools-types.h"
+
+#include "core/gimppickable.h"
+
+#include "gimptilehandleriscissors.h"
+
+
+#define MAX_GRADIENT  179.606  /* == sqrt (127^2 + 127^2) */
+#define MIN_GRADIENT  63       /* gradients < this are directionless */
+
+/*  the source pixels needed around a tile, one for the blur and
+ *  one for the derivatives
+ */
+#define BORDER        2
+
+
+enum
+{
+  PROP_0,
+  PROP_FORMAT,
+  PROP_TILE_WIDTH,
+  PROP_TILE_HEIGHT
+};
+
+
+static void     gimp_tile_handler_iscissors_finalize     (GObject         *object);
+static void     gimp_tile_handler_iscissors_set_property (GObject         *object,
+                                                          guint            property_id,
+                                                          const GValue    *value,
+                                                          GParamSpec      *pspec);
+static void     gimp_tile_handler_iscissors_get_property (GObject         *object,
+                                                          guint            property_id,
+                                                          GValue          *value,
+                                                          GParamSpec      *pspec);
+
+static gpointer gimp_tile_handler_iscissors_command      (GeglTileSource  *source,
+                                                          GeglTileCommand  command,
+                                                          gint             x,
+                                                          gint             y,
+                                                          gint             z,
+                                                          gpointer         data);
+
+
+G_DEFINE_TYPE (GimpTileHandlerIscissors, gimp_tile_handler_iscissors,
+               GEGL_TYPE_TILE_HANDLER)
+
+#define parent_class gimp_tile_handler_iscissors_parent_class
+
+
+static const gint horz_deriv[9] =
+{
+   1,  0, -1,
+   2,  0, -2,
+   1,  0, -1,
+};
+
+static const gint vert_deriv[9] =
+{
+   1,  2,  1,
+   0,  0,  0,
+  -1, -2, -1,
+};
+
+static const gint blur_32[9] =
+{
+   1,  1,  1,
+   1, 24,  1,
+   1,  1,  1,
+};
+
+
+static void
+gimp_tile_handler_iscissors_class_init (GimpTileHandlerIscissorsClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize     = gimp_tile_handler_iscissors_finalize;
+  object_class->set_property = gimp_tile_handler_iscissors_set_property;
+  object_class->get_property = gimp_tile_handler_iscissors_get_property;
+
+  g_object_class_install_property (object_class, PROP_FORMAT,
+                                   g_param_spec_pointer ("format", NULL, NULL,
+                                                         GIMP_PARAM_READWRITE));
+
+  g_object_class_install_property (object_class, PROP_TILE_WIDTH,
+                                   g_param_spec_int ("tile-width", NULL, NULL,
+                                                     1, G_MAXINT, 1,
+                                                     GIMP_PARAM_READWRITE |
+                                                     G_PARAM_CONSTRUCT));
+
+  g_object_class_install_property (object_class, PROP_TILE_HEIGHT,
+                                   g_param_spec_int ("tile-height", NULL, NULL,
+                                                     1, G_MAXINT, 1,
+                                                     GIMP_PARAM_READWRITE |
+                                                     G_PARAM_CONSTRUCT));
+}
+
+static void
+gimp_tile_handler_iscissors_init (GimpTileHandlerIscissors *iscissors)
+{
+  GeglTileSource *source = GEGL_TILE_SOURCE (iscissors);
+
+  source->command = gimp_tile_handler_iscissors_command;
+}
+
+static void
+gimp_tile_handler_iscissors_finalize (GObject *object)
+{
+  GimpTileHandlerIscissors *iscissors = GIMP_TILE_HANDLER_ISCISSORS (object);
+
+  if (iscissors->pickable)
+    {
+      g_object_unref (iscissors->pickable);
+      iscissors->pickable = NULL;
+    }
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+gimp_tile_handler_iscissors_set_property (GObject      *object,
+                                          guint         property_id,
+                                          const GValue *value,
+                                          GParamSpec   *pspec)
+{
+  GimpTileHandlerIscissors *iscissors = GIMP_TILE_HANDLER_ISCISSORS (object);
+
+  switch (property_id)
+    {
+    case PROP_FORMAT:
+      iscissors->format = g_value_get_pointer (value);
+      break;
+    case PROP_TILE_WIDTH:
+      iscissors->tile_width = g_value_get_int (value);
+      break;
+    case PROP_TILE_HEIGHT:
+      iscissors->tile_height = g_value_get_int (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+    }
+}
+
+static void
+gimp_tile_handler_iscissors_get_property (GObject    *object,
+                                          guint       property_id,
+                                          GValue     *value,
+                                          GParamSpec *pspec)
+{
+  GimpTileHandlerIscissors *iscissors = GIMP_TILE_HANDLER_ISCISSORS (object);
+
+  switch (property_id)
+    {
+    case PROP_FORMAT:
+      g_value_set_pointer (value, (gpointer) iscissors->format);
+      break;
+    case PROP_TILE_WIDTH:
+      g_value_set_int (value, iscissors->tile_width);
+      break;
+    case PROP_TILE_HEIGHT:
+      g_value_set_int (value, iscissors->tile_height);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+    }
+}
+
+/*  3x3 correlation of the four channels of @src, with the result of
+ *  each pixel at the position of the kernel's center, shrinking the
+ *  area by one pixel on every side
+ */
+static void
+gimp_tile_handler_iscissors_convolve (const guchar *src,
+                                      gint          width,
+                                      gint          height,
+                                      const gint   *kernel,
+                                      gint          divisor,
+                                      gint          bias,
+                                      guchar       *dest)
+{
+  gint x, y, b;
+
+  for (y = 1; y < height - 1; y++)
+    {
+      guchar *d = dest + ((y - 1) * (width - 2)) * 4;
+
+      for (x = 1; x < width - 1; x++)
+        {
+          for (b = 0; b < 4; b++)
+            {
+              const guchar *s     = src + ((y - 1) * width + (x - 1)) * 4 + b;
+              gint          total = 0;
+              gint          i, j;
+
+              for (i = 0; i < 3; i++)
+                for (j = 0; j < 3; j++)
+                  total += kernel[i * 3 + j] * s[(i * width + j) * 4];
+
+              total = (total + divisor / 2) / divisor;
+
+              *d++ = CLAMP (total + bias, 0, 255);
+            }
+        }
+    }
+}
+
+static void
+gimp_tile_handler_iscissors_validate (GimpTileHandlerIscissors *iscissors,
+                                      GeglTile                 *tile,
+                                      gint                      x,
+                                      gint                      y)
+{
+  GeglBuffer    *src_buffer;
+  GeglRectangle  rect;
+  gint           src_width;
+  gint           src_height;
+  guchar        *src;
+  guchar        *blur;
+  guchar        *horz;
+  guchar        *vert;
+  guint8        *gradmap;
+  gint           i, j, b;
+
+  rect.x      = x * iscissors->tile_width  - BORDER;
+  rect.y      = y * iscissors->tile_height - BORDER;
+  rect.width  = iscissors->tile_width  + 2 * BORDER;
+  rect.height = iscissors->tile_height + 2 * BORDER;
+
+  src_width  = rect.width;
+  src_height = rect.height;
+
+  src  = g_new (guchar, src_width * src_height * 4);
+  blur = g_new (guchar, (src_width - 2) * (src_height - 2) * 4);
+  horz = g_new (guchar, iscissors->tile_width * iscissors->tile_height * 4);
+  vert = g_new (guchar, iscissors->tile_width * iscissors->tile_height * 4);
+
+  gimp_pickable_flush (iscissors->pickable);
+
+  src_buffer = gimp_pickable_get_buffer (iscissors->pickable);
+
+  /*  read the tile with its border at once, so the gradient doesn't
+   *  have seams at the tile edges
+   */
+  gegl_buffer_get (src_buffer, &rect, 1.0, babl_format ("R'G'B'A u8"),
+                   src, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
+
+  /*  blur the source to get rid of noise  */
+  gimp_tile_handler_iscissors_convolve (src, src_width, src_height,
+                                        blur_32, 32, 0, blur);
+
+  /*  the horizontal and vertical derivatives  */
+  gimp_tile_handler_iscissors_convolve (blur, src_width - 2, src_height - 2,
+                                        horz_deriv, 1, 128, horz);
+  gimp_tile_handler_iscissors_convolve (blur, src_width - 2, src_height - 2,
+                                        vert_deriv, 1, 128, vert);
+
+  g_free (src);
+  g_free (blur);
+
+  gegl_tile_lock (tile);
+
+  gradmap = gegl_tile_get_data (tile);
+
+  /*  calculate overall gradient  */
+  for (i = 0; i < iscissors->tile_height; i++)
+    {
+      const guchar *datah = horz + i * iscissors->tile_width * 4;
+      const guchar *datav = vert + i * iscissors->tile_width * 4;
+
+      for (j = 0; j < iscissors->tile_width; j++)
+        {
+          gint8  hmax = datah[0] - 128;
+          gint8  vmax = datav[0] - 128;
+          gfloat gradient;
+
+          for (b = 1; b < 4; b++)
+            {
+              if (abs (datah[b] - 128) > abs (hmax))
+                hmax = datah[b] - 128;
+
+              if (abs (datav[b] - 128) > abs (vmax))
+                vmax = datav[b] - 128;
+            }
+
+          /* 1 byte absolute magnitude first */
+          gradient = sqrt (SQR (hmax) + SQR (vmax));
+          gradmap[0] = gradient * 255 / MAX_GRADIENT;
+
+          /* then 1 byte direction */
+          if (gradient > MIN_GRADIENT)
+            {
+              gfloat direction;
+
+              if (! hmax)
+                direction = (vmax > 0) ? G_PI_2 : -G_PI_2;
+              else
+                direction = atan ((gdouble) vmax / (gdouble) hmax);
+
+              /* Scale the direction from between 0 and 254,
+               * corresponding to -PI/2, PI/2 255 is reserved for
+               * directionless pixels
+               */
+              gradmap[1] = (guint8) (254 * (direction + G_PI_2) / G_PI);
+            }
+          else
+            {
+              gradmap[1] = 255; /* reserved for weak gradient */
+            }
+
+          gradmap += 2;
+          datah   += 4;
+          datav   += 4;
+        }
+    }
+
+  gegl_tile_unlock (tile);
+
+  g_free (horz);
+  g_free (vert);
+}
+
+static gpointer
+gimp_tile_handler_iscissors_command (GeglTileSource  *source,
+                                     GeglTileCommand  command,
+                                     gint             x,
+                                     gint             y,
+                                     gint             z,
+                                     gpointer         data)
+{
+  GimpTileHandlerIscissors *iscissors = GIMP_TILE_HANDLER_ISCISSORS (source);
+  gpointer                  retval;
+
+  retval = gegl_tile_handler_source_command (source, command, x, y, z, data);
+
+  /*  a tile that doesn't exist yet was never computed, tiles are
+   *  never invalidated because the tool starts over when the image
+   *  changes
+   */
+  if (command == GEGL_TILE_GET && ! retval && z == 0)
+    {
+      retval = gegl_tile_handler_create_tile (GEGL_TILE_HANDLER (source),
+                                              x, y, 0);
+
+      gimp_tile_handler_iscissors_validate (iscissors, retval, x, y);
+    }
+
+  return retval;
+}
+
+GeglTileHandler *
+gimp_tile_handler_iscissors_new (GimpPickable *pickable)
+{
+  GimpTileHandlerIscissors *iscissors;
+
+  g_return_val_if_fail (GIMP_IS_PICKABLE (pickable), NULL);
+
+  iscissors = g_object_new (GIMP_TYPE_TILE_HANDLER_ISCISSORS, NULL);
+
+  iscissors->pickable = g_object_ref (pickable);
+
+  return GEGL_TILE_HANDLER (iscissors);
+}
@@ -48,6 +48,9 @@
 
 #define STROKE_PERIOD 100
 
+/*  the coordinates a baked stroke overwrote, kept for undo  */
+#define SAVED_COORDS_KEY "gimp-warp-tool-saved-coords"
+
 
 static void       gimp_warp_tool_control            (GimpTool              *tool,
                                                      GimpToolAction         action,
@@ -101,6 +104,8 @@ static gboolean   gimp_warp_tool_stroke_timer       (GimpWarpTool          *wt);
 static void       gimp_warp_tool_create_graph       (GimpWarpTool          *wt);
 static void       gimp_warp_tool_create_image_map   (GimpWarpTool          *wt,
                                                      GimpDrawable          *drawable);
+static gboolean   gimp_warp_tool_get_stroke_bounds  (GeglNode              *node,
+                                                     GeglRectangle         *bbox);
 static void       gimp_warp_tool_update_stroke      (GimpWarpTool          *wt,
                                                      GeglNode              *node);
 static void       gimp_warp_tool_stroke_changed     (GeglPath              *stroke,
@@ -110,6 +115,12 @@ static void       gimp_warp_tool_image_map_flush    (GimpImageMap          *imag
                                                      GimpTool              *tool);
 static void       gimp_warp_tool_add_op             (GimpWarpTool          *wt,
                                                      GeglNode              *new_op);
+static GeglNode * gimp_warp_tool_get_live_op        (GimpWarpTool          *wt);
+static void       gimp_warp_tool_remove_live_op     (GimpWarpTool          *wt);
+static void       gimp_warp_tool_bake_op            (GimpWarpTool          *wt,
+                                                     GeglNode              *op);
+static void       gimp_warp_tool_set_coords         (GimpWarpTool          *wt,
+                                                     GeglBuffer            *src);
 
 
 G_DEFINE_TYPE (GimpWarpTool, gimp_warp_tool, GIMP_TYPE_DRAW_TOOL)
@@ -283,6 +294,16 @@ gimp_warp_tool_button_release (GimpTool              *tool,
     }
   else
     {
+      GeglNode *op = gimp_warp_tool_get_live_op (wt);
+
+      /*  bake the finished stroke into the coordinate buffer, so the
+       *  graph never holds more than the stroke being drawn and each
+       *  update only costs one warp, no matter how many strokes came
+       *  before
+       */
+      if (op)
+        gimp_warp_tool_bake_op (wt, op);
+
       if (wt->redo_stack)
         {
           /*  the redo stack becomes invalid by actually doing a stroke  */
@@ -424,16 +445,11 @@ gimp_warp_tool_get_undo_desc (GimpTool    *tool,
                               GimpDisplay *display)
 {
   GimpWarpTool *wt = GIMP_WARP_TOOL (tool);
-  GeglNode     *to_delete;
-  const gchar  *type;
 
   if (! wt->render_node)
     return NULL;
 
-  to_delete = gegl_node_get_producer (wt->render_node, "aux", NULL);
-  type = gegl_node_get_operation (to_delete);
-
-  if (strcmp (type, "gegl:warp"))
+  if (! wt->undo_stack && ! gimp_warp_tool_get_live_op (wt))
     return NULL;
 
   return _("Warp Tool Stroke");
@@ -457,27 +473,41 @@ gimp_warp_tool_undo (GimpTool    *tool,
 {
   GimpWarpTool *wt = GIMP_WARP_TOOL (tool);
   GeglNode     *to_delete;
-  GeglNode     *previous;
-  const gchar  *type;
 
   if (! wt->render_node)
     return FALSE;
 
-  to_delete = gegl_node_get_producer (wt->render_node, "aux", NULL);
-  type = gegl_node_get_operation (to_delete);
+  to_delete = gimp_warp_tool_get_live_op (wt);
 
-  if (strcmp (type, "gegl:warp"))
-    return FALSE;
+  if (to_delete)
+    {
+      /*  the stroke being drawn is still a node of the graph  */
+      g_object_ref (to_delete);
 
-  previous = gegl_node_get_producer (to_delete, "input", NULL);
+      gimp_warp_tool_remove_live_op (wt);
+    }
+  else if (wt->undo_stack)
+    {
+      GeglBuffer *saved;
 
-  gegl_node_disconnect (to_delete,       "input");
-  gegl_node_connect_to (previous,        "output",
-                        wt->render_node, "aux");
+      /*  a baked stroke, put back the coordinates it overwrote  */
+      to_delete = wt->undo_stack->data;
+
+      wt->undo_stack = g_list_remove_link (wt->undo_stack, wt->undo_stack);
+
+      saved = g_object_get_data (G_OBJECT (to_delete), SAVED_COORDS_KEY);
+
+      if (saved)
+        gimp_warp_tool_set_coords (wt, saved);
 
-  wt->redo_stack = g_list_prepend (wt->redo_stack, g_object_ref (to_delete));
+      g_object_set_data (G_OBJECT (to_delete), SAVED_COORDS_KEY, NULL);
+    }
+  else
+    {
+      return FALSE;
+    }
 
-  gegl_node_remove_child (wt->graph, to_delete);
+  wt->redo_stack = g_list_prepend (wt->redo_stack, to_delete);
 
   gimp_warp_tool_update_stroke (wt, to_delete);
 
@@ -496,11 +526,12 @@ gimp_warp_tool_redo (GimpTool    *tool,
 
   to_add = wt->redo_stack->data;
 
+  wt->redo_stack = g_list_remove_link (wt->redo_stack, wt->redo_stack);
+
   gimp_warp_tool_add_op (wt, to_add);
+  gimp_warp_tool_bake_op (wt, to_add);
   g_object_unref (to_add);
 
-  wt->redo_stack = g_list_remove_link (wt->redo_stack, wt->redo_stack);
-
   gimp_warp_tool_update_stroke (wt, to_add);
 
   return TRUE;
@@ -580,6 +611,12 @@ gimp_warp_tool_halt (GimpWarpTool *wt)
       gimp_image_flush (gimp_display_get_image (tool->display));
     }
 
+  if (wt->undo_stack)
+    {
+      g_list_free_full (wt->undo_stack, (GDestroyNotify) g_object_unref);
+      wt->undo_stack = NULL;
+    }
+
   if (wt->redo_stack)
     {
       g_list_free_full (wt->redo_stack, (GDestroyNotify) g_object_unref);
@@ -667,9 +704,9 @@ gimp_warp_tool_create_image_map (GimpWarpTool *wt,
                     wt);
 }
 
-static void
-gimp_warp_tool_update_stroke (GimpWarpTool *wt,
-                              GeglNode     *node)
+static gboolean
+gimp_warp_tool_get_stroke_bounds (GeglNode      *node,
+                                  GeglRectangle *bbox)
 {
   GeglPath *stroke;
   gdouble   size;
@@ -681,22 +718,33 @@ gimp_warp_tool_update_stroke (GimpWarpTool *wt,
 
   if (stroke)
     {
-      gdouble        min_x;
-      gdouble        max_x;
-      gdouble        min_y;
-      gdouble        max_y;
-      GeglRectangle  bbox;
+      gdouble min_x;
+      gdouble max_x;
+      gdouble min_y;
+      gdouble max_y;
 
       gegl_path_get_bounds (stroke, &min_x, &max_x, &min_y, &max_y);
       g_object_unref (stroke);
 
-      bbox.x      = min_x - size * 0.5;
-      bbox.y      = min_y - size * 0.5;
-      bbox.width  = max_x - min_x + size;
-      bbox.height = max_y - min_y + size;
+      bbox->x      = min_x - size * 0.5;
+      bbox->y      = min_y - size * 0.5;
+      bbox->width  = max_x - min_x + size;
+      bbox->height = max_y - min_y + size;
 
-      gimp_image_map_apply (wt->image_map, &bbox);
+      return TRUE;
     }
+
+  return FALSE;
+}
+
+static void
+gimp_warp_tool_update_stroke (GimpWarpTool *wt,
+                              GeglNode     *node)
+{
+  GeglRectangle bbox;
+
+  if (gimp_warp_tool_get_stroke_bounds (node, &bbox))
+    gimp_image_map_apply (wt->image_map, &bbox);
 }
 
 static void
@@ -748,3 +796,96 @@ gimp_warp_tool_add_op (GimpWarpTool *wt,
   gegl_node_connect_to (new_op,          "output",
                         wt->render_node, "aux");
 }
+
+/*  returns the warp op of the stroke that is not baked yet, if any  */
+static GeglNode *
+gimp_warp_tool_get_live_op (GimpWarpTool *wt)
+{
+  GeglNode    *op;
+  const gchar *type;
+
+  op   = gegl_node_get_producer (wt->render_node, "aux", NULL);
+  type = gegl_node_get_operation (op);
+
+  if (strcmp (type, "gegl:warp"))
+    return NULL;
+
+  return op;
+}
+
+static void
+gimp_warp_tool_remove_live_op (GimpWarpTool *wt)
+{
+  GeglNode *op;
+  GeglNode *previous;
+
+  op       = gegl_node_get_producer (wt->render_node, "aux", NULL);
+  previous = gegl_node_get_producer (op, "input", NULL);
+
+  gegl_node_disconnect (op,              "input");
+  gegl_node_connect_to (previous,        "output",
+                        wt->render_node, "aux");
+
+  gegl_node_remove_child (wt->graph, op);
+}
+
+/*  renders the live @op into the coordinate buffer within the stroke's
+ *  footprint, remembering the old coordinates for undo, and moves @op
+ *  from the graph to the undo stack
+ */
+static void
+gimp_warp_tool_bake_op (GimpWarpTool *wt,
+                        GeglNode     *op)
+{
+  GeglRectangle area;
+
+  g_return_if_fail (op == gimp_warp_tool_get_live_op (wt));
+
+  if (gimp_warp_tool_get_stroke_bounds (op, &area) &&
+      gegl_rectangle_intersect (&area, &area,
+                                gegl_buffer_get_extent (wt->coords_buffer)))
+    {
+      const Babl *format = gegl_buffer_get_format (wt->coords_buffer);
+      GeglBuffer *saved;
+      gfloat     *data;
+
+      saved = gegl_buffer_new (&area, format);
+      gegl_buffer_copy (wt->coords_buffer, &area, saved, &area);
+
+      g_object_set_data_full (G_OBJECT (op), SAVED_COORDS_KEY, saved,
+                              (GDestroyNotify) g_object_unref);
+
+      data = g_new (gfloat, 2 * area.width * area.height);
+
+      gegl_node_blit (op, 1.0, &area, format, data,
+                      GEGL_AUTO_ROWSTRIDE, GEGL_BLIT_DEFAULT);
+
+      /*  gegl_buffer_set() lets the buffer-source know about the change  */
+      gegl_buffer_set (wt->coords_buffer, &area, 0, format, data,
+                       GEGL_AUTO_ROWSTRIDE);
+
+      g_free (data);
+    }
+
+  wt->undo_stack = g_list_prepend (wt->undo_stack, g_object_ref (op));
+
+  gimp_warp_tool_remove_live_op (wt);
+}
+
+static void
+gimp_warp_tool_set_coords (GimpWarpTool *wt,
+                           GeglBuffer   *src)
+{
+  const GeglRectangle *area   = gegl_buffer_get_extent (src);
+  const Babl          *format = gegl_buffer_get_format (wt->coords_buffer);
+  gfloat              *data;
+
+  data = g_new (gfloat, 2 * area->width * area->height);
+
+  gegl_buffer_get (src, area, 1.0, format, data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  gegl_buffer_set (wt->coords_buffer, area, 0, format, data,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  g_free (data);
+}
@@ -54,6 +54,7 @@ struct _GimpWarpTool
 
   GimpImageMap   *image_map;
 
+  GList          *undo_stack;    /* Baked strokes, most recent first */
   GList          *redo_stack;
 };
 
@@ -53,6 +53,9 @@ static gdouble
                                             GimpCoords            *ret_point,
                                             gdouble               *ret_pos,
                                             gint                   depth);
+static gdouble
+    gimp_bezier_stroke_segment_bounds_dist (const GimpCoords      *beziercoords,
+                                            const GimpCoords      *coord);
 static gdouble
     gimp_bezier_stroke_nearest_tangent_get (const GimpStroke      *stroke,
                                             const GimpCoords      *coord1,
@@ -586,10 +589,20 @@ gimp_bezier_stroke_nearest_point_get (const GimpStroke     *stroke,
       if (count == 4)
         {
           segment_end = anchorlist->data;
-          dist = gimp_bezier_stroke_segment_nearest_point_get (segmentcoords,
-                                                               coord, precision,
-                                                               &point, &pos,
-                                                               10);
+
+          /*  the segment lies within the bounds of its control points,
+           *  skip it if they are farther away than the nearest point
+           */
+          if (min_dist >= 0 &&
+              gimp_bezier_stroke_segment_bounds_dist (segmentcoords,
+                                                      coord) >= min_dist)
+            dist = min_dist;
+          else
+            dist = gimp_bezier_stroke_segment_nearest_point_get (segmentcoords,
+                                                                 coord,
+                                                                 precision,
+                                                                 &point, &pos,
+                                                                 10);
 
           if (dist < min_dist || min_dist < 0)
             {
@@ -761,10 +774,15 @@ gimp_bezier_stroke_segment_nearest_point_get (const GimpCoords  *beziercoords,
                                                         &point1, &pos1,
                                                         depth - 1);
 
-  dist2 = gimp_bezier_stroke_segment_nearest_point_get (&(subdivided[3]),
-                                                        coord, precision,
-                                                        &point2, &pos2,
-                                                        depth - 1);
+  /*  the second half can't be nearer than its control points  */
+  if (gimp_bezier_stroke_segment_bounds_dist (&(subdivided[3]),
+                                              coord) >= dist1)
+    dist2 = dist1;
+  else
+    dist2 = gimp_bezier_stroke_segment_nearest_point_get (&(subdivided[3]),
+                                                          coord, precision,
+                                                          &point2, &pos2,
+                                                          depth - 1);
 
   if (dist1 <= dist2)
     {
@@ -781,6 +799,37 @@ gimp_bezier_stroke_segment_nearest_point_get (const GimpCoords  *beziercoords,
 }
 
 
+/*  returns the distance of @coord to the bounding box of the control
+ *  points in @beziercoords, which is a lower bound for its distance to
+ *  any point of the segment
+ */
+static gdouble
+gimp_bezier_stroke_segment_bounds_dist (const GimpCoords *beziercoords,
+                                        const GimpCoords *coord)
+{
+  gdouble x1, y1;
+  gdouble x2, y2;
+  gdouble dx, dy;
+  gint    i;
+
+  x1 = x2 = beziercoords[0].x;
+  y1 = y2 = beziercoords[0].y;
+
+  for (i = 1; i < 4; i++)
+    {
+      x1 = MIN (x1, beziercoords[i].x);
+      y1 = MIN (y1, beziercoords[i].y);
+      x2 = MAX (x2, beziercoords[i].x);
+      y2 = MAX (y2, beziercoords[i].y);
+    }
+
+  dx = MAX (MAX (x1 - coord->x, coord->x - x2), 0.0);
+  dy = MAX (MAX (y1 - coord->y, coord->y - y2), 0.0);
+
+  return sqrt (dx * dx + dy * dy);
+}
+
+
 static gdouble
 gimp_bezier_stroke_nearest_tangent_get (const GimpStroke  *stroke,
                                         const GimpCoords  *coord1,
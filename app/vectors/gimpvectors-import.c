@@ -80,6 +80,7 @@ struct _SvgHandler
   gdouble       height;
   gchar        *id;
   GList        *paths;
+  GList        *paths_tail;  /*  the last link of paths, if known  */
   GimpMatrix3  *transform;
 };
 
@@ -492,7 +493,27 @@ svg_parser_end_element (GMarkupParseContext  *context,
         }
 
       base = g_queue_peek_head (parser->stack);
-      base->paths = g_list_concat (base->paths, handler->paths);
+
+      /*  don't walk the parent's paths for every element, they can be
+       *  a lot for a big flat SVG
+       */
+      if (! handler->paths_tail)
+        handler->paths_tail = g_list_last (handler->paths);
+
+      if (! base->paths)
+        {
+          base->paths = handler->paths;
+        }
+      else
+        {
+          if (! base->paths_tail)
+            base->paths_tail = g_list_last (base->paths);
+
+          base->paths_tail->next = handler->paths;
+          handler->paths->prev   = base->paths_tail;
+        }
+
+      base->paths_tail = handler->paths_tail;
     }
 
   g_slice_free (SvgHandler, handler);
@@ -62,7 +62,7 @@ gimp_vectors_warp_point (const GimpVectors *vectors,
   GList      *list;
   GimpStroke *stroke;
 
-  for (list = vectors->strokes; list; list = g_list_next (list))
+  for (list = vectors->strokes->head; list; list = g_list_next (list))
     {
       stroke = list->data;
 
@@ -155,7 +155,7 @@ gimp_vectors_warp_vectors (const GimpVectors *vectors,
 {
   GList *list;
 
-  for (list = vectors_in->strokes; list; list = g_list_next (list))
+  for (list = vectors_in->strokes->head; list; list = g_list_next (list))
     {
       GimpStroke *stroke = list->data;
 
@@ -246,7 +246,8 @@ gimp_vectors_init (GimpVectors *vectors)
 {
   gimp_item_set_visible (GIMP_ITEM (vectors), FALSE, FALSE);
 
-  vectors->strokes        = NULL;
+  vectors->strokes        = g_queue_new ();
+  vectors->stroke_to_list = g_hash_table_new (g_direct_hash, g_direct_equal);
   vectors->last_stroke_ID = 0;
   vectors->freeze_count   = 0;
   vectors->precision      = 0.2;
@@ -266,9 +267,15 @@ gimp_vectors_finalize (GObject *object)
       vectors->bezier_desc = NULL;
     }
 
+  if (vectors->stroke_to_list)
+    {
+      g_hash_table_destroy (vectors->stroke_to_list);
+      vectors->stroke_to_list = NULL;
+    }
+
   if (vectors->strokes)
     {
-      g_list_free_full (vectors->strokes, (GDestroyNotify) g_object_unref);
+      g_queue_free_full (vectors->strokes, (GDestroyNotify) g_object_unref);
       vectors->strokes = NULL;
     }
 
@@ -285,7 +292,7 @@ gimp_vectors_get_memsize (GimpObject *object,
 
   vectors = GIMP_VECTORS (object);
 
-  for (list = vectors->strokes; list; list = g_list_next (list))
+  for (list = vectors->strokes->head; list; list = g_list_next (list))
     memsize += (gimp_object_get_memsize (GIMP_OBJECT (list->data), gui_size) +
                 sizeof (GList));
 
@@ -364,7 +371,7 @@ gimp_vectors_translate (GimpItem *item,
                                       _("Move Path"),
                                       vectors);
 
-  for (list = vectors->strokes; list; list = g_list_next (list))
+  for (list = vectors->strokes->head; list; list = g_list_next (list))
     {
       GimpStroke *stroke = list->data;
 
@@ -392,7 +399,7 @@ gimp_vectors_scale (GimpItem              *item,
   if (gimp_item_is_attached (item))
     gimp_image_undo_push_vectors_mod (image, NULL, vectors);
 
-  for (list = vectors->strokes; list; list = g_list_next (list))
+  for (list = vectors->strokes->head; list; list = g_list_next (list))
     {
       GimpStroke *stroke = list->data;
 
@@ -428,7 +435,7 @@ gimp_vectors_resize (GimpItem    *item,
   if (gimp_item_is_attached (item))
     gimp_image_undo_push_vectors_mod (image, NULL, vectors);
 
-  for (list = vectors->strokes; list; list = g_list_next (list))
+  for (list = vectors->strokes->head; list; list = g_list_next (list))
     {
       GimpStroke *stroke = list->data;
 
@@ -463,7 +470,7 @@ gimp_vectors_flip (GimpItem            *item,
                                     _("Flip Path"),
                                     vectors);
 
-  for (list = vectors->strokes; list; list = g_list_next (list))
+  for (list = vectors->strokes->head; list; list = g_list_next (list))
     {
       GimpStroke *stroke = list->data;
 
@@ -494,7 +501,7 @@ gimp_vectors_rotate (GimpItem         *item,
                                     _("Rotate Path"),
                                     vectors);
 
-  for (list = vectors->strokes; list; list = g_list_next (list))
+  for (list = vectors->strokes->head; list; list = g_list_next (list))
     {
       GimpStroke *stroke = list->data;
 
@@ -528,7 +535,7 @@ gimp_vectors_transform (GimpItem               *item,
   if (direction == GIMP_TRANSFORM_BACKWARD)
     gimp_matrix3_invert (&local_matrix);
 
-  for (list = vectors->strokes; list; list = g_list_next (list))
+  for (list = vectors->strokes->head; list; list = g_list_next (list))
     {
       GimpStroke *stroke = list->data;
 
@@ -549,7 +556,7 @@ gimp_vectors_stroke (GimpItem           *item,
   GimpVectors *vectors = GIMP_VECTORS (item);
   gboolean     retval  = FALSE;
 
-  if (! vectors->strokes)
+  if (g_queue_is_empty (vectors->strokes))
     {
       g_set_error_literal (error, GIMP_ERROR, GIMP_FAILED,
                            _("Not enough points to stroke"));
@@ -693,12 +700,10 @@ gimp_vectors_copy_strokes (const GimpVectors *src_vectors,
 
   gimp_vectors_freeze (dest_vectors);
 
-  if (dest_vectors->strokes)
-    {
-      g_list_free_full (dest_vectors->strokes, (GDestroyNotify) g_object_unref);
-    }
+  g_queue_free_full (dest_vectors->strokes, (GDestroyNotify) g_object_unref);
+  dest_vectors->strokes = g_queue_new ();
+  g_hash_table_remove_all (dest_vectors->stroke_to_list);
 
-  dest_vectors->strokes = NULL;
   dest_vectors->last_stroke_ID = 0;
 
   gimp_vectors_add_strokes (src_vectors, dest_vectors);
@@ -711,28 +716,31 @@ void
 gimp_vectors_add_strokes (const GimpVectors *src_vectors,
                           GimpVectors       *dest_vectors)
 {
-  GList *current_lstroke;
-  GList *strokes_copy;
+  GList *stroke;
 
   g_return_if_fail (GIMP_IS_VECTORS (src_vectors));
   g_return_if_fail (GIMP_IS_VECTORS (dest_vectors));
 
   gimp_vectors_freeze (dest_vectors);
 
-  strokes_copy = g_list_copy (src_vectors->strokes);
-  current_lstroke = strokes_copy;
-
-  while (current_lstroke)
+  for (stroke = src_vectors->strokes->head;
+       stroke != NULL;
+       stroke = g_list_next (stroke))
     {
-      current_lstroke->data = gimp_stroke_duplicate (current_lstroke->data);
+      GimpStroke *newstroke = gimp_stroke_duplicate (stroke->data);
+
+      g_queue_push_tail (dest_vectors->strokes, newstroke);
+
+      /* Also add to {stroke: GList node} map */
+      g_hash_table_insert (dest_vectors->stroke_to_list,
+                           newstroke,
+                           g_queue_peek_tail_link (dest_vectors->strokes));
+
       dest_vectors->last_stroke_ID ++;
-      gimp_stroke_set_ID (current_lstroke->data,
+      gimp_stroke_set_ID (newstroke,
                           dest_vectors->last_stroke_ID);
-      current_lstroke = g_list_next (current_lstroke);
     }
 
-  dest_vectors->strokes = g_list_concat (dest_vectors->strokes, strokes_copy);
-
   gimp_vectors_thaw (dest_vectors);
 }
 
@@ -757,10 +765,15 @@ gimp_vectors_real_stroke_add (GimpVectors *vectors,
 {
   /*  Don't g_list_prepend() here.  See ChangeLog 2003-05-21 --Mitch  */
 
-  vectors->strokes = g_list_append (vectors->strokes, stroke);
+  g_queue_push_tail (vectors->strokes, g_object_ref (stroke));
+
+  /* Also add to {stroke: GList node} map */
+  g_hash_table_insert (vectors->stroke_to_list,
+                       stroke,
+                       g_queue_peek_tail_link (vectors->strokes));
+
   vectors->last_stroke_ID ++;
   gimp_stroke_set_ID (stroke, vectors->last_stroke_ID);
-  g_object_ref (stroke);
 }
 
 void
@@ -783,11 +796,12 @@ gimp_vectors_real_stroke_remove (GimpVectors *vectors,
 {
   GList *list;
 
-  list = g_list_find (vectors->strokes, stroke);
+  list = g_hash_table_lookup (vectors->stroke_to_list, stroke);
 
   if (list)
     {
-      vectors->strokes = g_list_delete_link (vectors->strokes, list);
+      g_queue_delete_link (vectors->strokes, list);
+      g_hash_table_remove (vectors->stroke_to_list, stroke);
       g_object_unref (stroke);
     }
 }
@@ -797,7 +811,7 @@ gimp_vectors_get_n_strokes (const GimpVectors *vectors)
 {
   g_return_val_if_fail (GIMP_IS_VECTORS (vectors), 0);
 
-  return g_list_length (vectors->strokes);
+  return g_queue_get_length (vectors->strokes);
 }
 
 
@@ -818,7 +832,7 @@ gimp_vectors_real_stroke_get (const GimpVectors *vectors,
   gdouble     mindist   = G_MAXDOUBLE;
   GList      *list;
 
-  for (list = vectors->strokes; list; list = g_list_next (list))
+  for (list = vectors->strokes->head; list; list = g_list_next (list))
     {
       GimpStroke *stroke = list->data;
       GimpAnchor *anchor = gimp_stroke_anchor_get (stroke, coord);
@@ -847,7 +861,7 @@ gimp_vectors_stroke_get_by_ID (const GimpVectors *vectors,
 
   g_return_val_if_fail (GIMP_IS_VECTORS (vectors), NULL);
 
-  for (list = vectors->strokes; list; list = g_list_next (list))
+  for (list = vectors->strokes->head; list; list = g_list_next (list))
     {
       if (gimp_stroke_get_ID (list->data) == id)
         return list->data;
@@ -872,13 +886,13 @@ gimp_vectors_real_stroke_get_next (const GimpVectors *vectors,
 {
   if (! prev)
     {
-      return vectors->strokes ? vectors->strokes->data : NULL;
+      return g_queue_peek_head (vectors->strokes);
     }
   else
     {
       GList *stroke;
 
-      stroke = g_list_find (vectors->strokes, prev);
+      stroke = g_hash_table_lookup (vectors->stroke_to_list, prev);
 
       g_return_val_if_fail (stroke != NULL, NULL);
 
@@ -928,7 +942,7 @@ gimp_vectors_real_anchor_get (const GimpVectors *vectors,
   gdouble     mindist   = -1;
   GList      *list;
 
-  for (list = vectors->strokes; list; list = g_list_next (list))
+  for (list = vectors->strokes->head; list; list = g_list_next (list))
     {
       GimpStroke *stroke = list->data;
       GimpAnchor *anchor = gimp_stroke_anchor_get (stroke, coord);
@@ -979,7 +993,7 @@ gimp_vectors_anchor_select (GimpVectors *vectors,
 {
   GList *list;
 
-  for (list = vectors->strokes; list; list = g_list_next (list))
+  for (list = vectors->strokes->head; list; list = g_list_next (list))
     {
       GimpStroke *stroke = list->data;
 
@@ -882,10 +882,13 @@ gimp_clipboard_send_buffer (GtkClipboard     *clipboard,
 
   gimp_set_busy (gimp);
 
-  pixbuf = gimp_viewable_get_pixbuf (GIMP_VIEWABLE (gimp_clip->buffer),
-                                     gimp_get_user_context (gimp),
-                                     gimp_buffer_get_width (gimp_clip->buffer),
-                                     gimp_buffer_get_height (gimp_clip->buffer));
+  /*  the buffer is only converted when another application asks
+   *  for it, and the full-size pixbuf is not kept around as preview
+   */
+  pixbuf = gimp_viewable_get_new_pixbuf (GIMP_VIEWABLE (gimp_clip->buffer),
+                                         gimp_get_user_context (gimp),
+                                         gimp_buffer_get_width (gimp_clip->buffer),
+                                         gimp_buffer_get_height (gimp_clip->buffer));
 
   if (pixbuf)
     {
@@ -894,10 +897,12 @@ gimp_clipboard_send_buffer (GtkClipboard     *clipboard,
                     gimp_clip->target_entries[info].target);
 
       gtk_selection_data_set_pixbuf (selection_data, pixbuf);
+
+      g_object_unref (pixbuf);
     }
   else
     {
-      g_warning ("%s: gimp_viewable_get_pixbuf() failed", G_STRFUNC);
+      g_warning ("%s: gimp_viewable_get_new_pixbuf() failed", G_STRFUNC);
     }
 
   gimp_unset_busy (gimp);
@@ -72,6 +72,8 @@ static void   gimp_container_tree_store_get_property    (GObject
 
 static void   gimp_container_tree_store_set             (GimpContainerTreeStore *store,
                                                          GtkTreeIter            *iter,
+                                                         GtkTreeIter            *parent,
+                                                         gint                    index,
                                                          GimpViewable           *viewable);
 static void   gimp_container_tree_store_renderer_update (GimpViewRenderer       *renderer,
                                                          GimpContainerTreeStore *store);
@@ -283,12 +285,7 @@ gimp_container_tree_store_insert_item (GimpContainerTreeStore *store,
 
   g_return_val_if_fail (GIMP_IS_CONTAINER_TREE_STORE (store), NULL);
 
-  if (index == -1)
-    gtk_tree_store_append (GTK_TREE_STORE (store), &iter, parent);
-  else
-    gtk_tree_store_insert (GTK_TREE_STORE (store), &iter, parent, index);
-
-  gimp_container_tree_store_set (store, &iter, viewable);
+  gimp_container_tree_store_set (store, &iter, parent, index, viewable);
 
   return gtk_tree_iter_copy (&iter);
 }
@@ -538,9 +535,14 @@ gimp_container_tree_store_columns_add (GType *types,
   return *n_types - 1;
 }
 
+/*  inserts the row with its values, so the view gets one row-inserted
+ *  instead of an additional row-changed for each row
+ */
 static void
 gimp_container_tree_store_set (GimpContainerTreeStore *store,
                                GtkTreeIter            *iter,
+                               GtkTreeIter            *parent,
+                               gint                    index,
                                GimpViewable           *viewable)
 {
   GimpContainerTreeStorePrivate *private = GET_PRIVATE (store);
@@ -571,11 +573,12 @@ gimp_container_tree_store_set (GimpContainerTreeStore *store,
   else
     name = gimp_viewable_get_description (viewable, NULL);
 
-  gtk_tree_store_set (GTK_TREE_STORE (store), iter,
-                      GIMP_CONTAINER_TREE_STORE_COLUMN_RENDERER,       renderer,
-                      GIMP_CONTAINER_TREE_STORE_COLUMN_NAME,           name,
-                      GIMP_CONTAINER_TREE_STORE_COLUMN_NAME_SENSITIVE, TRUE,
-                      -1);
+  gtk_tree_store_insert_with_values (GTK_TREE_STORE (store), iter,
+                                     parent, index,
+                                     GIMP_CONTAINER_TREE_STORE_COLUMN_RENDERER,       renderer,
+                                     GIMP_CONTAINER_TREE_STORE_COLUMN_NAME,           name,
+                                     GIMP_CONTAINER_TREE_STORE_COLUMN_NAME_SENSITIVE, TRUE,
+                                     -1);
 
   if (! private->use_name)
     g_free (name);
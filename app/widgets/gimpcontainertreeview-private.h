@@ -40,6 +40,9 @@ struct _GimpContainerTreeViewPriv
   GdkScrollDirection  scroll_dir;
 
   gboolean            dnd_drop_to_empty;
+
+  gboolean            filling;
+  GimpViewable       *fill_selected;
 };
 
 
@@ -569,8 +569,36 @@ gimp_container_tree_view_set_container (GimpContainerView *view,
                         tree_view);
     }
 
+  /*  fill the store while it's detached from the view, so the view
+   *  doesn't update and measure its rows on every insertion; only the
+   *  visible rows get measured and rendered once it's attached again
+   */
+  tree_view->priv->filling       = TRUE;
+  tree_view->priv->fill_selected = NULL;
+
+  /*  changing the model emits "changed" on the selection  */
+  g_signal_handlers_block_by_func (tree_view->priv->selection,
+                                   gimp_container_tree_view_selection_changed,
+                                   tree_view);
+
+  gtk_tree_view_set_model (tree_view->view, NULL);
+
   parent_view_iface->set_container (view, container);
 
+  gtk_tree_view_set_model (tree_view->view, tree_view->model);
+
+  g_signal_handlers_unblock_by_func (tree_view->priv->selection,
+                                     gimp_container_tree_view_selection_changed,
+                                     tree_view);
+
+  tree_view->priv->filling = FALSE;
+
+  if (tree_view->priv->fill_selected)
+    {
+      gimp_container_view_select_item (view, tree_view->priv->fill_selected);
+      tree_view->priv->fill_selected = NULL;
+    }
+
   if (container)
     {
       gimp_container_tree_view_expand_rows (tree_view->model,
@@ -710,6 +738,16 @@ gimp_container_tree_view_select_item (GimpContainerView *view,
 {
   GimpContainerTreeView *tree_view = GIMP_CONTAINER_TREE_VIEW (view);
 
+  /*  the view has no model while the store is filled, select the item
+   *  once it has one
+   */
+  if (tree_view->priv->filling)
+    {
+      tree_view->priv->fill_selected = insert_data ? viewable : NULL;
+
+      return TRUE;
+    }
+
   if (viewable && insert_data)
     {
       GtkTreePath *path;
@@ -341,6 +341,8 @@ gimp_controllers_event_mapped (GimpControllerInfo        *info,
   GtkUIManager *ui_manager = GTK_UI_MANAGER (manager->ui_manager);
   GList        *list;
 
+  gimp_ui_manager_ensure_action_groups (manager->ui_manager);
+
   for (list = gtk_ui_manager_get_action_groups (ui_manager);
        list;
        list = g_list_next (list))
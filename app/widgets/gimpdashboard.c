@@ -0,0 +1,537 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995-1999 Spencer Kimball and Peter Mattis
+ *
+ * gimpdashboard.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef G_OS_WIN32
+#include <process.h>
+#define getpid _getpid
+#endif
+
+#include <gegl.h>
+#include <gtk/gtk.h>
+#include <glib/gstdio.h>
+
+#include "libgimpbase/gimpbase.h"
+#include "libgimpconfig/gimpconfig.h"
+#include "libgimpwidgets/gimpwidgets.h"
+
+#include "widgets-types.h"
+
+#include "config/gimpgeglconfig.h"
+
+#include "core/gimp.h"
+#include "core/gimp-parallel.h"
+#include "core/gimpimage.h"
+#include "core/gimpimage-undo.h"
+#include "core/gimpprojection.h"
+
+#include "gimpdashboard.h"
+
+#include "gimp-intl.h"
+
+
+/*  the statistics are cheap to collect, but there is no point in
+ *  updating them more often than a human can read them
+ */
+#define UPDATE_INTERVAL 1 /* seconds */
+
+
+enum
+{
+  PROP_0,
+  PROP_GIMP
+};
+
+
+static void        gimp_dashboard_constructed   (GObject       *object);
+static void        gimp_dashboard_dispose       (GObject       *object);
+static void        gimp_dashboard_set_property  (GObject       *object,
+                                                 guint          property_id,
+                                                 const GValue  *value,
+                                                 GParamSpec    *pspec);
+
+static void        gimp_dashboard_map           (GtkWidget     *widget);
+static void        gimp_dashboard_unmap         (GtkWidget     *widget);
+
+static GtkWidget * gimp_dashboard_add_section   (GimpDashboard *dashboard,
+                                                 const gchar   *title,
+                                                 gint           n_rows);
+static GtkWidget * gimp_dashboard_add_row       (GtkWidget     *table,
+                                                 gint           row,
+                                                 const gchar   *label);
+
+static gboolean    gimp_dashboard_update        (GimpDashboard *dashboard);
+static void        gimp_dashboard_update_cache  (GimpDashboard *dashboard);
+static void        gimp_dashboard_update_render (GimpDashboard *dashboard);
+static void        gimp_dashboard_update_undo   (GimpDashboard *dashboard);
+
+static guint64     gimp_dashboard_get_swap_size (GimpDashboard *dashboard);
+
+
+G_DEFINE_TYPE (GimpDashboard, gimp_dashboard, GIMP_TYPE_EDITOR)
+
+#define parent_class gimp_dashboard_parent_class
+
+
+static void
+gimp_dashboard_class_init (GimpDashboardClass *klass)
+{
+  GObjectClass   *object_class = G_OBJECT_CLASS (klass);
+  GtkWidgetClass *widget_class = GTK_WIDGET_CLASS (klass);
+
+  object_class->constructed  = gimp_dashboard_constructed;
+  object_class->dispose      = gimp_dashboard_dispose;
+  object_class->set_property = gimp_dashboard_set_property;
+
+  widget_class->map          = gimp_dashboard_map;
+  widget_class->unmap        = gimp_dashboard_unmap;
+
+  g_object_class_install_property (object_class, PROP_GIMP,
+                                   g_param_spec_object ("gimp", NULL, NULL,
+                                                        GIMP_TYPE_GIMP,
+                                                        GIMP_PARAM_WRITABLE |
+                                                        G_PARAM_CONSTRUCT_ONLY));
+}
+
+static void
+gimp_dashboard_init (GimpDashboard *dashboard)
+{
+  GtkWidget *table;
+
+  gtk_box_set_spacing (GTK_BOX (dashboard), 6);
+  gtk_container_set_border_width (GTK_CONTAINER (dashboard), 6);
+
+  table = gimp_dashboard_add_section (dashboard, _("Cache"), 2);
+
+  dashboard->cache_label = gimp_dashboard_add_row (table, 0, _("Tile cache:"));
+  dashboard->swap_label  = gimp_dashboard_add_row (table, 1, _("Swap:"));
+
+  table = gimp_dashboard_add_section (dashboard, _("Rendering"), 3);
+
+  dashboard->pending_label    = gimp_dashboard_add_row (table, 0,
+                                                        _("Pending areas:"));
+  dashboard->throughput_label = gimp_dashboard_add_row (table, 1,
+                                                        _("Idle rendering:"));
+  dashboard->threads_label    = gimp_dashboard_add_row (table, 2,
+                                                        _("Threads:"));
+
+  table = gimp_dashboard_add_section (dashboard, _("Undo Memory"), 1);
+
+  dashboard->undo_box = gtk_box_new (GTK_ORIENTATION_VERTICAL, 2);
+  gtk_table_attach (GTK_TABLE (table), dashboard->undo_box, 0, 2, 0, 1,
+                    GTK_EXPAND | GTK_FILL, GTK_FILL, 0, 0);
+  gtk_widget_show (dashboard->undo_box);
+}
+
+static void
+gimp_dashboard_constructed (GObject *object)
+{
+  GimpDashboard *dashboard = GIMP_DASHBOARD (object);
+
+  G_OBJECT_CLASS (parent_class)->constructed (object);
+
+  g_assert (GIMP_IS_GIMP (dashboard->gimp));
+}
+
+static void
+gimp_dashboard_dispose (GObject *object)
+{
+  GimpDashboard *dashboard = GIMP_DASHBOARD (object);
+
+  if (dashboard->timeout_id)
+    {
+      g_source_remove (dashboard->timeout_id);
+      dashboard->timeout_id = 0;
+    }
+
+  G_OBJECT_CLASS (parent_class)->dispose (object);
+}
+
+static void
+gimp_dashboard_set_property (GObject      *object,
+                             guint         property_id,
+                             const GValue *value,
+                             GParamSpec   *pspec)
+{
+  GimpDashboard *dashboard = GIMP_DASHBOARD (object);
+
+  switch (property_id)
+    {
+    case PROP_GIMP:
+      dashboard->gimp = g_value_get_object (value);
+      break;
+
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, property_id, pspec);
+      break;
+    }
+}
+
+/*  only collect statistics while somebody can see them  */
+static void
+gimp_dashboard_map (GtkWidget *widget)
+{
+  GimpDashboard *dashboard = GIMP_DASHBOARD (widget);
+
+  GTK_WIDGET_CLASS (parent_class)->map (widget);
+
+  if (! dashboard->timeout_id)
+    {
+      dashboard->last_time = 0;
+
+      gimp_dashboard_update (dashboard);
+
+      dashboard->timeout_id =
+        g_timeout_add_seconds (UPDATE_INTERVAL,
+                               (GSourceFunc) gimp_dashboard_update,
+                               dashboard);
+    }
+}
+
+static void
+gimp_dashboard_unmap (GtkWidget *widget)
+{
+  GimpDashboard *dashboard = GIMP_DASHBOARD (widget);
+
+  if (dashboard->timeout_id)
+    {
+      g_source_remove (dashboard->timeout_id);
+      dashboard->timeout_id = 0;
+    }
+
+  GTK_WIDGET_CLASS (parent_class)->unmap (widget);
+}
+
+
+/*  public functions  */
+
+GtkWidget *
+gimp_dashboard_new (Gimp *gimp)
+{
+  g_return_val_if_fail (GIMP_IS_GIMP (gimp), NULL);
+
+  return g_object_new (GIMP_TYPE_DASHBOARD,
+                       "gimp", gimp,
+                       NULL);
+}
+
+
+/*  private functions  */
+
+static GtkWidget *
+gimp_dashboard_add_section (GimpDashboard *dashboard,
+                            const gchar   *title,
+                            gint           n_rows)
+{
+  GtkWidget *frame;
+  GtkWidget *table;
+
+  frame = gimp_frame_new (title);
+  gtk_box_pack_start (GTK_BOX (dashboard), frame, FALSE, FALSE, 0);
+  gtk_widget_show (frame);
+
+  table = gtk_table_new (n_rows, 2, FALSE);
+  gtk_table_set_col_spacings (GTK_TABLE (table), 6);
+  gtk_table_set_row_spacings (GTK_TABLE (table), 2);
+  gtk_container_add (GTK_CONTAINER (frame), table);
+  gtk_widget_show (table);
+
+  return table;
+}
+
+static GtkWidget *
+gimp_dashboard_add_row (GtkWidget   *table,
+                        gint         row,
+                        const gchar *label)
+{
+  GtkWidget *widget;
+
+  widget = gtk_label_new (label);
+  gtk_misc_set_alignment (GTK_MISC (widget), 0.0, 0.5);
+  gtk_table_attach (GTK_TABLE (table), widget, 0, 1, row, row + 1,
+                    GTK_FILL, GTK_FILL, 0, 0);
+  gtk_widget_show (widget);
+
+  widget = gtk_label_new (NULL);
+  gtk_misc_set_alignment (GTK_MISC (widget), 1.0, 0.5);
+  gtk_table_attach (GTK_TABLE (table), widget, 1, 2, row, row + 1,
+                    GTK_EXPAND | GTK_FILL, GTK_FILL, 0, 0);
+  gtk_widget_show (widget);
+
+  return widget;
+}
+
+static gboolean
+gimp_dashboard_update (GimpDashboard *dashboard)
+{
+  gimp_dashboard_update_cache  (dashboard);
+  gimp_dashboard_update_render (dashboard);
+  gimp_dashboard_update_undo   (dashboard);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+gimp_dashboard_update_cache (GimpDashboard *dashboard)
+{
+  GimpGeglConfig *config = GIMP_GEGL_CONFIG (dashboard->gimp->config);
+  guint64         swap_size;
+  gchar          *limit;
+  gchar          *size;
+  gchar          *text;
+
+  limit = g_format_size_full (config->tile_cache_size,
+                              G_FORMAT_SIZE_IEC_UNITS);
+
+#ifdef HAVE_GEGL_STATS
+  {
+    guint64 tile_cache_total;
+
+    g_object_get (gegl_stats (),
+                  "tile-cache-total", &tile_cache_total,
+                  NULL);
+
+    size = g_format_size_full (tile_cache_total, G_FORMAT_SIZE_IEC_UNITS);
+    text = g_strdup_printf (_("%s of %s (%d%%)"), size, limit,
+                            (gint) (100.0 * tile_cache_total /
+                                    MAX (config->tile_cache_size, 1)));
+    g_free (size);
+  }
+#else
+  /*  this GEGL doesn't tell how much of its cache is in use  */
+  text = g_strdup_printf (_("%s limit"), limit);
+#endif
+
+  gtk_label_set_text (GTK_LABEL (dashboard->cache_label), text);
+  g_free (text);
+  g_free (limit);
+
+  swap_size = gimp_dashboard_get_swap_size (dashboard);
+
+  size = g_format_size_full (swap_size, G_FORMAT_SIZE_IEC_UNITS);
+  text = NULL;
+
+#ifdef HAVE_GEGL_STATS
+  /*  GEGL 0.4.14 compresses its swap and counts what the tiles would
+   *  have taken uncompressed
+   */
+  if (g_object_class_find_property (G_OBJECT_GET_CLASS (gegl_stats ()),
+                                    "swap-total-uncompressed"))
+    {
+      guint64 swap_uncompressed;
+
+      g_object_get (gegl_stats (),
+                    "swap-total-uncompressed", &swap_uncompressed,
+                    NULL);
+
+      if (swap_uncompressed > swap_size)
+        {
+          gchar *uncompressed;
+
+          uncompressed = g_format_size_full (swap_uncompressed,
+                                             G_FORMAT_SIZE_IEC_UNITS);
+          text = g_strdup_printf (_("%s (%s uncompressed)"),
+                                  size, uncompressed);
+          g_free (uncompressed);
+        }
+    }
+#endif
+
+  gtk_label_set_text (GTK_LABEL (dashboard->swap_label), text ? text : size);
+  g_free (text);
+  g_free (size);
+}
+
+static void
+gimp_dashboard_update_render (GimpDashboard *dashboard)
+{
+  GList  *images;
+  GList  *list;
+  gint64  n_rendered = 0;
+  gint64  now;
+  gint    n_pending  = 0;
+  gchar  *text;
+
+  images = gimp_get_image_iter (dashboard->gimp);
+
+  for (list = images; list; list = g_list_next (list))
+    {
+      GimpProjection *projection = gimp_image_get_projection (list->data);
+
+      n_pending  += gimp_projection_get_n_pending  (projection);
+      n_rendered += gimp_projection_get_n_rendered (projection);
+    }
+
+  text = g_strdup_printf ("%d", n_pending);
+  gtk_label_set_text (GTK_LABEL (dashboard->pending_label), text);
+  g_free (text);
+
+  now = g_get_monotonic_time ();
+
+  if (dashboard->last_time)
+    {
+      gdouble seconds = (now - dashboard->last_time) / (gdouble) G_USEC_PER_SEC;
+
+      /*  closing an image makes the sum go down, don't count that  */
+      gint64  delta   = MAX (n_rendered - dashboard->last_rendered, 0);
+
+      text = g_strdup_printf (_("%.2f Mpx/s"),
+                              delta / MAX (seconds, 0.001) / 1000000.0);
+      gtk_label_set_text (GTK_LABEL (dashboard->throughput_label), text);
+      g_free (text);
+    }
+
+  dashboard->last_rendered = n_rendered;
+  dashboard->last_time     = now;
+
+  text = g_strdup_printf ("%d", gimp_parallel_get_n_threads ());
+  gtk_label_set_text (GTK_LABEL (dashboard->threads_label), text);
+  g_free (text);
+}
+
+static void
+gimp_dashboard_update_undo (GimpDashboard *dashboard)
+{
+  GList *images;
+  GList *children;
+  GList *list;
+
+  children = gtk_container_get_children (GTK_CONTAINER (dashboard->undo_box));
+
+  for (list = children; list; list = g_list_next (list))
+    gtk_widget_destroy (list->data);
+
+  g_list_free (children);
+
+  images = gimp_get_image_iter (dashboard->gimp);
+
+  if (! images)
+    {
+      GtkWidget *label = gtk_label_new (_("No images"));
+
+      gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
+      gtk_box_pack_start (GTK_BOX (dashboard->undo_box), label,
+                          FALSE, FALSE, 0);
+      gtk_widget_show (label);
+
+      return;
+    }
+
+  for (list = images; list; list = g_list_next (list))
+    {
+      GimpImage     *image = list->data;
+      GimpUndoStack *undo_stack;
+      GimpUndoStack *redo_stack;
+      GtkWidget     *hbox;
+      GtkWidget     *label;
+      gint64         memsize;
+      gchar         *text;
+
+      undo_stack = gimp_image_get_undo_stack (image);
+      redo_stack = gimp_image_get_redo_stack (image);
+
+      memsize = (gimp_object_get_memsize (GIMP_OBJECT (undo_stack), NULL) +
+                 gimp_object_get_memsize (GIMP_OBJECT (redo_stack), NULL));
+
+      hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
+      gtk_box_pack_start (GTK_BOX (dashboard->undo_box), hbox,
+                          FALSE, FALSE, 0);
+      gtk_widget_show (hbox);
+
+      label = gtk_label_new (gimp_image_get_display_name (image));
+      gtk_misc_set_alignment (GTK_MISC (label), 0.0, 0.5);
+      gtk_label_set_ellipsize (GTK_LABEL (label), PANGO_ELLIPSIZE_MIDDLE);
+      gtk_box_pack_start (GTK_BOX (hbox), label, TRUE, TRUE, 0);
+      gtk_widget_show (label);
+
+      text = g_format_size_full (memsize, G_FORMAT_SIZE_IEC_UNITS);
+      label = gtk_label_new (text);
+      gtk_misc_set_alignment (GTK_MISC (label), 1.0, 0.5);
+      gtk_box_pack_end (GTK_BOX (hbox), label, FALSE, FALSE, 0);
+      gtk_widget_show (label);
+      g_free (text);
+    }
+}
+
+/*  sums up the sizes of this process' swap files in swap-path,
+ *  GEGL names them after the process id
+ */
+static guint64
+gimp_dashboard_get_swap_size (GimpDashboard *dashboard)
+{
+#ifdef HAVE_GEGL_STATS
+  guint64 swap_total;
+
+  g_object_get (gegl_stats (),
+                "swap-total", &swap_total,
+                NULL);
+
+  return swap_total;
+#else
+  GimpGeglConfig *config = GIMP_GEGL_CONFIG (dashboard->gimp->config);
+  gchar          *path;
+  gchar          *prefix;
+  GDir           *dir;
+  const gchar    *name;
+  guint64         size = 0;
+
+  if (! config->swap_path)
+    return 0;
+
+  path = gimp_config_path_expand (config->swap_path, TRUE, NULL);
+
+  if (! path)
+    return 0;
+
+  dir = g_dir_open (path, 0, NULL);
+
+  if (dir)
+    {
+      prefix = g_strdup_printf ("%d-", (gint) getpid ());
+
+      while ((name = g_dir_read_name (dir)))
+        {
+          if (g_str_has_prefix (name, prefix))
+            {
+              gchar     *filename = g_build_filename (path, name, NULL);
+              GStatBuf   info;
+
+              if (g_stat (filename, &info) == 0)
+                size += info.st_size;
+
+              g_free (filename);
+            }
+        }
+
+      g_free (prefix);
+      g_dir_close (dir);
+    }
+
+  g_free (path);
+
+  return size;
+#endif
+}
@@ -0,0 +1,68 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995-1999 Spencer Kimball and Peter Mattis
+ *
+ * gimpdashboard.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __GIMP_DASHBOARD_H__
+#define __GIMP_DASHBOARD_H__
+
+
+#include "gimpeditor.h"
+
+
+#define GIMP_TYPE_DASHBOARD            (gimp_dashboard_get_type ())
+#define GIMP_DASHBOARD(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), GIMP_TYPE_DASHBOARD, GimpDashboard))
+#define GIMP_DASHBOARD_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), GIMP_TYPE_DASHBOARD, GimpDashboardClass))
+#define GIMP_IS_DASHBOARD(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), GIMP_TYPE_DASHBOARD))
+#define GIMP_IS_DASHBOARD_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), GIMP_TYPE_DASHBOARD))
+#define GIMP_DASHBOARD_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), GIMP_TYPE_DASHBOARD, GimpDashboardClass))
+
+
+typedef struct _GimpDashboardClass GimpDashboardClass;
+
+struct _GimpDashboard
+{
+  GimpEditor  parent_instance;
+
+  Gimp       *gimp;
+
+  GtkWidget  *cache_label;
+  GtkWidget  *swap_label;
+  GtkWidget  *pending_label;
+  GtkWidget  *throughput_label;
+  GtkWidget  *threads_label;
+  GtkWidget  *undo_box;
+
+  guint       timeout_id;
+
+  /*  the idle renderer's pixel count at the last update  */
+  gint64      last_rendered;
+  gint64      last_time;
+};
+
+struct _GimpDashboardClass
+{
+  GimpEditorClass  parent_class;
+};
+
+
+GType       gimp_dashboard_get_type (void) G_GNUC_CONST;
+
+GtkWidget * gimp_dashboard_new      (Gimp *gimp);
+
+
+#endif  /*  __GIMP_DASHBOARD_H__  */
@@ -39,6 +39,8 @@
 
 #include "widgets-types.h"
 
+#include "config/gimprc-cache.h"
+
 #include "core/gimp.h"
 #include "core/gimpdatafactory.h"
 #include "core/gimpgradient.h"
@@ -128,10 +130,10 @@ gimp_devices_restore (Gimp *gimp)
   if (gimp->be_verbose)
     g_print ("Parsing '%s'\n", gimp_filename_to_utf8 (filename));
 
-  if (! gimp_config_deserialize_file (GIMP_CONFIG (manager),
-                                      filename,
-                                      gimp,
-                                      &error))
+  if (! gimp_rc_cache_deserialize (GIMP_CONFIG (manager),
+                                   filename,
+                                   gimp,
+                                   &error))
     {
       if (error->code != GIMP_CONFIG_ERROR_OPEN_ENOENT)
         gimp_message_literal (gimp, NULL, GIMP_MESSAGE_ERROR, error->message);
@@ -326,6 +326,8 @@ gimp_dock_window_constructed (GObject *object)
                                    dock_window->p->ui_manager_name,
                                    dock_window,
                                    config->tearoff_menus);
+  gimp_ui_manager_ensure_action_groups (dock_window->p->ui_manager);
+
   accel_group =
     gtk_ui_manager_get_accel_group (GTK_UI_MANAGER (dock_window->p->ui_manager));
   gtk_window_add_accel_group (GTK_WINDOW (dock_window), accel_group);
@@ -412,6 +412,23 @@ gimp_file_dialog_new (Gimp                  *gimp,
   gimp_file_dialog_add_proc_selection (dialog, gimp, file_procs, automatic,
                                        automatic_help_id);
 
+  if (action == GIMP_FILE_CHOOSER_ACTION_SAVE)
+    {
+      dialog->compression_toggle =
+        gtk_check_button_new_with_mnemonic (_("Save this XCF file with "
+                                              "better but slower "
+                                              "_compression"));
+      gimp_help_set_help_data (dialog->compression_toggle,
+                               _("Compress the image data with zlib.  The "
+                                 "file gets smaller, but takes longer to "
+                                 "save and can't be opened by older "
+                                 "versions of GIMP."),
+                               NULL);
+      gtk_box_pack_end (GTK_BOX (gtk_dialog_get_content_area (GTK_DIALOG (dialog))),
+                        dialog->compression_toggle, FALSE, FALSE, 0);
+      gtk_widget_show (dialog->compression_toggle);
+    }
+
   dialog->progress = gimp_progress_box_new ();
   gtk_box_pack_end (GTK_BOX (gtk_dialog_get_content_area (GTK_DIALOG (dialog))),
                     dialog->progress, FALSE, FALSE, 0);
@@ -509,6 +526,10 @@ gimp_file_dialog_set_save_image (GimpFileDialog *dialog,
 
   gimp_file_dialog_set_file_proc (dialog, NULL);
 
+  if (dialog->compression_toggle)
+    gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (dialog->compression_toggle),
+                                  gimp_image_get_xcf_compression (image));
+
   if (! export)
     {
       /*
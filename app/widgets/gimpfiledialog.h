@@ -50,6 +50,7 @@ struct _GimpFileDialog
   GtkWidget            *thumb_box;
   GtkWidget            *proc_expander;
   GtkWidget            *proc_view;
+  GtkWidget            *compression_toggle;
   GtkWidget            *progress;
 
   gboolean              busy;
@@ -35,6 +35,7 @@
 #include "core/gimp.h"
 #include "core/gimpmarshal.h"
 
+#include "gimpactionfactory.h"
 #include "gimpactiongroup.h"
 #include "gimphelp.h"
 #include "gimphelp-ids.h"
@@ -79,6 +80,9 @@ static GtkAction *gimp_ui_manager_get_action          (GtkUIManager   *manager,
                                                        const gchar    *path);
 static void       gimp_ui_manager_real_update         (GimpUIManager  *manager,
                                                        gpointer        update_data);
+static GimpActionGroup *
+                  gimp_ui_manager_create_action_group (GimpUIManager  *manager,
+                                                       const gchar    *name);
 static GimpUIManagerUIEntry *
                   gimp_ui_manager_entry_get           (GimpUIManager  *manager,
                                                        const gchar    *ui_path);
@@ -267,6 +271,12 @@ gimp_ui_manager_finalize (GObject *object)
   g_list_free (manager->registered_uis);
   manager->registered_uis = NULL;
 
+  g_list_free_full (manager->action_groups, (GDestroyNotify) g_free);
+  manager->action_groups = NULL;
+
+  g_list_free (manager->pending_groups);
+  manager->pending_groups = NULL;
+
   if (manager->name)
     {
       g_free (manager->name);
@@ -442,6 +452,64 @@ gimp_ui_manager_update (GimpUIManager *manager,
   g_signal_emit (manager, manager_signals[UPDATE], 0, update_data);
 }
 
+/**
+ * gimp_ui_manager_add_action_groups:
+ * @manager:       a #GimpUIManager
+ * @factory:       the #GimpActionFactory to create the groups with
+ * @group_names:   the identifiers of the groups, in order
+ * @callback_data: the data passed to the groups' callbacks
+ *
+ * Adds the action groups named @group_names to @manager. The groups
+ * are not created yet; a group is created the first time it is asked
+ * for, and all of them are created as soon as a menu is built, an
+ * action is looked up by name only, or
+ * gimp_ui_manager_ensure_action_groups() is called.
+ **/
+void
+gimp_ui_manager_add_action_groups (GimpUIManager     *manager,
+                                   GimpActionFactory *factory,
+                                   GList             *group_names,
+                                   gpointer           callback_data)
+{
+  GList *list;
+
+  g_return_if_fail (GIMP_IS_UI_MANAGER (manager));
+  g_return_if_fail (GIMP_IS_ACTION_FACTORY (factory));
+  g_return_if_fail (manager->action_factory == NULL);
+
+  manager->action_factory = factory;
+  manager->action_data    = callback_data;
+
+  for (list = group_names; list; list = g_list_next (list))
+    {
+      gchar *name = g_strdup (list->data);
+
+      manager->action_groups  = g_list_prepend (manager->action_groups, name);
+      manager->pending_groups = g_list_prepend (manager->pending_groups, name);
+    }
+
+  manager->action_groups  = g_list_reverse (manager->action_groups);
+  manager->pending_groups = g_list_reverse (manager->pending_groups);
+}
+
+/**
+ * gimp_ui_manager_ensure_action_groups:
+ * @manager: a #GimpUIManager
+ *
+ * Creates all action groups of @manager that haven't been created
+ * yet. Call this before @manager's accel group is used for
+ * keyboard shortcuts, or before iterating its action groups.
+ **/
+void
+gimp_ui_manager_ensure_action_groups (GimpUIManager *manager)
+{
+  g_return_if_fail (GIMP_IS_UI_MANAGER (manager));
+
+  while (manager->pending_groups)
+    gimp_ui_manager_create_action_group (manager,
+                                         manager->pending_groups->data);
+}
+
 GimpActionGroup *
 gimp_ui_manager_get_action_group (GimpUIManager *manager,
                                   const gchar   *name)
@@ -451,6 +519,12 @@ gimp_ui_manager_get_action_group (GimpUIManager *manager,
   g_return_val_if_fail (GIMP_IS_UI_MANAGER (manager), NULL);
   g_return_val_if_fail (name != NULL, NULL);
 
+  for (list = manager->pending_groups; list; list = g_list_next (list))
+    {
+      if (! strcmp (name, list->data))
+        return gimp_ui_manager_create_action_group (manager, list->data);
+    }
+
   for (list = gtk_ui_manager_get_action_groups (GTK_UI_MANAGER (manager));
        list;
        list = g_list_next (list))
@@ -487,6 +561,8 @@ gimp_ui_manager_find_action (GimpUIManager *manager,
     {
       GList *list;
 
+      gimp_ui_manager_ensure_action_groups (manager);
+
       for (list = gtk_ui_manager_get_action_groups (GTK_UI_MANAGER (manager));
            list;
            list = g_list_next (list))
@@ -646,6 +722,59 @@ gimp_ui_manager_ui_popup (GimpUIManager        *manager,
 
 /*  private functions  */
 
+static GimpActionGroup *
+gimp_ui_manager_create_action_group (GimpUIManager *manager,
+                                     const gchar   *name)
+{
+  GimpActionGroup *group;
+  GtkAccelGroup   *accel_group;
+  GList           *actions;
+  GList           *list;
+  gint             position = 0;
+
+  manager->pending_groups = g_list_remove (manager->pending_groups, name);
+
+  /*  keep the groups in registration order, find_action() depends on it  */
+  for (list = manager->action_groups;
+       list && strcmp (list->data, name);
+       list = g_list_next (list))
+    {
+      if (! g_list_find (manager->pending_groups, list->data))
+        position++;
+    }
+
+  group = gimp_action_factory_group_new (manager->action_factory, name,
+                                         manager->action_data);
+
+  accel_group = gtk_ui_manager_get_accel_group (GTK_UI_MANAGER (manager));
+
+  actions = gtk_action_group_list_actions (GTK_ACTION_GROUP (group));
+
+  for (list = actions; list; list = g_list_next (list))
+    {
+      GtkAction *action = list->data;
+
+      gtk_action_set_accel_group (action, accel_group);
+      gtk_action_connect_accelerator (action);
+    }
+
+  g_list_free (actions);
+
+  gtk_ui_manager_insert_action_group (GTK_UI_MANAGER (manager),
+                                      GTK_ACTION_GROUP (group),
+                                      position);
+
+  g_object_unref (group);
+
+  /*  the manager's updates so far went past this group, catch up
+   *  with the data the group was created for, which is what the
+   *  update functions are passed in all but a few places
+   */
+  gimp_action_group_update (group, manager->action_data);
+
+  return group;
+}
+
 static GimpUIManagerUIEntry *
 gimp_ui_manager_entry_get (GimpUIManager *manager,
                            const gchar   *ui_path)
@@ -727,6 +856,9 @@ gimp_ui_manager_entry_ensure (GimpUIManager *manager,
       return NULL;
     }
 
+  /*  menus can refer to the actions of any group  */
+  gimp_ui_manager_ensure_action_groups (manager);
+
   if (! entry->merge_id)
     {
       GError *error = NULL;
@@ -52,9 +52,15 @@ struct _GimpUIManager
 {
   GtkUIManager  parent_instance;
 
-  gchar        *name;
-  Gimp         *gimp;
-  GList        *registered_uis;
+  gchar             *name;
+  Gimp              *gimp;
+  GList             *registered_uis;
+
+  /*  action groups are only created when something looks at them  */
+  GimpActionFactory *action_factory;
+  gpointer           action_data;
+  GList             *action_groups;
+  GList             *pending_groups;
 };
 
 struct _GimpUIManagerClass
@@ -80,6 +86,13 @@ GList         * gimp_ui_managers_from_name  (const gchar            *name);
 
 void            gimp_ui_manager_update      (GimpUIManager          *manager,
                                              gpointer                update_data);
+
+void            gimp_ui_manager_add_action_groups    (GimpUIManager     *manager,
+                                                      GimpActionFactory *factory,
+                                                      GList             *group_names,
+                                                      gpointer           callback_data);
+void            gimp_ui_manager_ensure_action_groups (GimpUIManager     *manager);
+
 GimpActionGroup * gimp_ui_manager_get_action_group (GimpUIManager   *manager,
                                                     const gchar     *name);
 
@@ -158,6 +158,9 @@ gimp_view_renderer_init (GimpViewRenderer *renderer)
   renderer->size          = -1;
   renderer->needs_render  = TRUE;
   renderer->idle_id       = 0;
+
+  renderer->update_interval = 0;
+  renderer->last_update     = 0;
 }
 
 static void
@@ -526,11 +529,63 @@ gimp_view_renderer_set_background (GimpViewRenderer *renderer,
     }
 }
 
+/**
+ * gimp_view_renderer_set_frame_rate:
+ * @renderer:   a #GimpViewRenderer
+ * @frame_rate: the maximum number of updates per second, or 0.0
+ *
+ * Limits how often invalidating the renderer updates its view. While
+ * the viewable keeps changing, e.g. an image while it is painted on,
+ * the view is updated @frame_rate times a second instead of once the
+ * changes stop. A @frame_rate of 0.0 updates in an idle handler after
+ * each invalidation, which is the default.
+ **/
+void
+gimp_view_renderer_set_frame_rate (GimpViewRenderer *renderer,
+                                   gdouble           frame_rate)
+{
+  g_return_if_fail (GIMP_IS_VIEW_RENDERER (renderer));
+  g_return_if_fail (frame_rate >= 0.0);
+
+  if (frame_rate > 0.0)
+    renderer->update_interval = G_TIME_SPAN_SECOND / frame_rate;
+  else
+    renderer->update_interval = 0;
+}
+
 void
 gimp_view_renderer_invalidate (GimpViewRenderer *renderer)
 {
   g_return_if_fail (GIMP_IS_VIEW_RENDERER (renderer));
 
+  if (renderer->update_interval > 0)
+    {
+      GIMP_VIEW_RENDERER_GET_CLASS (renderer)->invalidate (renderer);
+
+      /*  keep a pending update instead of postponing it, so a stream
+       *  of invalidations updates the view at the frame rate
+       */
+      if (! renderer->idle_id)
+        {
+          gint64 delay = (renderer->last_update + renderer->update_interval -
+                          g_get_monotonic_time ());
+
+          if (delay > 0)
+            renderer->idle_id =
+              g_timeout_add_full (GIMP_VIEWABLE_PRIORITY_IDLE,
+                                  (delay + 999) / 1000,
+                                  (GSourceFunc) gimp_view_renderer_idle_update,
+                                  renderer, NULL);
+          else
+            renderer->idle_id =
+              g_idle_add_full (GIMP_VIEWABLE_PRIORITY_IDLE,
+                               (GSourceFunc) gimp_view_renderer_idle_update,
+                               renderer, NULL);
+        }
+
+      return;
+    }
+
   if (renderer->idle_id)
     {
       g_source_remove (renderer->idle_id);
@@ -653,7 +708,8 @@ gimp_view_renderer_draw (GimpViewRenderer *renderer,
 static gboolean
 gimp_view_renderer_idle_update (GimpViewRenderer *renderer)
 {
-  renderer->idle_id = 0;
+  renderer->idle_id     = 0;
+  renderer->last_update = g_get_monotonic_time ();
 
   gimp_view_renderer_update (renderer);
 
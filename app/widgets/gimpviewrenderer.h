@@ -64,6 +64,8 @@ struct _GimpViewRenderer
   gint                size;
   gboolean            needs_render;
   guint               idle_id;
+  gint64              update_interval;
+  gint64              last_update;
 };
 
 struct _GimpViewRendererClass
@@ -126,6 +128,8 @@ void   gimp_view_renderer_set_border_color (GimpViewRenderer   *renderer,
                                             const GimpRGB      *border_color);
 void   gimp_view_renderer_set_background   (GimpViewRenderer   *renderer,
                                             const gchar        *stock_id);
+void   gimp_view_renderer_set_frame_rate   (GimpViewRenderer   *renderer,
+                                            gdouble             frame_rate);
 
 void   gimp_view_renderer_invalidate       (GimpViewRenderer   *renderer);
 void   gimp_view_renderer_update           (GimpViewRenderer   *renderer);
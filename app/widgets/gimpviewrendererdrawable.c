@@ -36,8 +36,20 @@
 #include "gimpviewrendererdrawable.h"
 
 
-static void   gimp_view_renderer_drawable_render (GimpViewRenderer *renderer,
-                                                  GtkWidget        *widget);
+static void          gimp_view_renderer_drawable_dispose       (GObject                  *object);
+
+static void          gimp_view_renderer_drawable_invalidate    (GimpViewRenderer         *renderer);
+static void          gimp_view_renderer_drawable_render        (GimpViewRenderer         *renderer,
+                                                                GtkWidget                *widget);
+
+static GimpTempBuf * gimp_view_renderer_drawable_get_preview   (GimpViewRendererDrawable *renderdrawable,
+                                                                GimpDrawable             *drawable,
+                                                                const GeglRectangle      *src,
+                                                                gint                      dest_width,
+                                                                gint                      dest_height);
+static void          gimp_view_renderer_drawable_preview_ready (GimpTempBuf              *preview,
+                                                                GimpViewRendererDrawable *renderdrawable);
+static void          gimp_view_renderer_drawable_clear_preview (GimpViewRendererDrawable *renderdrawable);
 
 
 G_DEFINE_TYPE (GimpViewRendererDrawable, gimp_view_renderer_drawable,
@@ -49,9 +61,13 @@ G_DEFINE_TYPE (GimpViewRendererDrawable, gimp_view_renderer_drawable,
 static void
 gimp_view_renderer_drawable_class_init (GimpViewRendererDrawableClass *klass)
 {
+  GObjectClass          *object_class   = G_OBJECT_CLASS (klass);
   GimpViewRendererClass *renderer_class = GIMP_VIEW_RENDERER_CLASS (klass);
 
-  renderer_class->render = gimp_view_renderer_drawable_render;
+  object_class->dispose      = gimp_view_renderer_drawable_dispose;
+
+  renderer_class->invalidate = gimp_view_renderer_drawable_invalidate;
+  renderer_class->render     = gimp_view_renderer_drawable_render;
 }
 
 static void
@@ -59,23 +75,44 @@ gimp_view_renderer_drawable_init (GimpViewRendererDrawable *renderer)
 {
 }
 
+static void
+gimp_view_renderer_drawable_dispose (GObject *object)
+{
+  gimp_view_renderer_drawable_clear_preview (GIMP_VIEW_RENDERER_DRAWABLE (object));
+
+  G_OBJECT_CLASS (parent_class)->dispose (object);
+}
+
+static void
+gimp_view_renderer_drawable_invalidate (GimpViewRenderer *renderer)
+{
+  /*  a preview that is still being rendered is stale now  */
+  gimp_view_renderer_drawable_clear_preview (GIMP_VIEW_RENDERER_DRAWABLE (renderer));
+
+  GIMP_VIEW_RENDERER_CLASS (parent_class)->invalidate (renderer);
+}
+
 static void
 gimp_view_renderer_drawable_render (GimpViewRenderer *renderer,
                                     GtkWidget        *widget)
 {
-  GimpDrawable *drawable;
-  GimpItem     *item;
-  GimpImage    *image;
-  gint          offset_x;
-  gint          offset_y;
-  gint          width;
-  gint          height;
-  gint          view_width;
-  gint          view_height;
-  gdouble       xres       = 1.0;
-  gdouble       yres       = 1.0;
-  gboolean      scaling_up;
-  GimpTempBuf  *render_buf = NULL;
+  GimpViewRendererDrawable *renderdrawable;
+  GimpDrawable             *drawable;
+  GimpItem                 *item;
+  GimpImage                *image;
+  gint                      offset_x;
+  gint                      offset_y;
+  gint                      width;
+  gint                      height;
+  gint                      view_width;
+  gint                      view_height;
+  gdouble                   xres       = 1.0;
+  gdouble                   yres       = 1.0;
+  gboolean                  scaling_up;
+  gboolean                  pending    = FALSE;
+  GimpTempBuf              *render_buf = NULL;
+
+  renderdrawable = GIMP_VIEW_RENDERER_DRAWABLE (renderer);
 
   drawable = GIMP_DRAWABLE (renderer->viewable);
   item     = GIMP_ITEM (drawable);
@@ -156,10 +193,18 @@ gimp_view_renderer_drawable_render (GimpViewRenderer *renderer,
               if (dest_width  < 1) dest_width  = 1;
               if (dest_height < 1) dest_height = 1;
 
-              render_buf = gimp_drawable_get_sub_preview (drawable,
-                                                          src_x, src_y,
-                                                          src_width, src_height,
-                                                          dest_width, dest_height);
+              render_buf =
+                gimp_view_renderer_drawable_get_preview (renderdrawable,
+                                                         drawable,
+                                                         GEGL_RECTANGLE (src_x,
+                                                                         src_y,
+                                                                         src_width,
+                                                                         src_height),
+                                                         dest_width,
+                                                         dest_height);
+
+              if (! render_buf && renderdrawable->request)
+                pending = TRUE;
             }
           else
             {
@@ -188,10 +233,34 @@ gimp_view_renderer_drawable_render (GimpViewRenderer *renderer,
     }
   else
     {
-      render_buf = gimp_viewable_get_new_preview (renderer->viewable,
-                                                  renderer->context,
-                                                  view_width,
-                                                  view_height);
+      render_buf =
+        gimp_view_renderer_drawable_get_preview (renderdrawable,
+                                                 drawable,
+                                                 GEGL_RECTANGLE (0, 0,
+                                                                 gimp_item_get_width  (item),
+                                                                 gimp_item_get_height (item)),
+                                                 view_width,
+                                                 view_height);
+
+      if (! render_buf && renderdrawable->request)
+        pending = TRUE;
+    }
+
+  if (pending)
+    {
+      /*  keep showing the old preview until the new one arrives, or
+       *  the drawable's icon if there is none
+       */
+      if (! renderer->surface && ! renderer->pixbuf)
+        {
+          const gchar *stock_id;
+
+          stock_id = gimp_viewable_get_stock_id (renderer->viewable);
+
+          gimp_view_renderer_render_stock (renderer, widget, stock_id);
+        }
+
+      return;
     }
 
   if (render_buf)
@@ -244,3 +313,74 @@ gimp_view_renderer_drawable_render (GimpViewRenderer *renderer,
       gimp_view_renderer_render_stock (renderer, widget, stock_id);
     }
 }
+
+static GimpTempBuf *
+gimp_view_renderer_drawable_get_preview (GimpViewRendererDrawable *renderdrawable,
+                                         GimpDrawable             *drawable,
+                                         const GeglRectangle      *src,
+                                         gint                      dest_width,
+                                         gint                      dest_height)
+{
+  if (renderdrawable->preview || renderdrawable->request)
+    {
+      if (gegl_rectangle_equal (src, &renderdrawable->preview_src) &&
+          dest_width  == renderdrawable->preview_width             &&
+          dest_height == renderdrawable->preview_height)
+        {
+          GimpTempBuf *preview = renderdrawable->preview;
+
+          /*  either the finished preview, or NULL while it is rendered  */
+          renderdrawable->preview = NULL;
+
+          return preview;
+        }
+
+      gimp_view_renderer_drawable_clear_preview (renderdrawable);
+    }
+
+  renderdrawable->preview_src    = *src;
+  renderdrawable->preview_width  = dest_width;
+  renderdrawable->preview_height = dest_height;
+
+  renderdrawable->request =
+    gimp_drawable_get_sub_preview_async (drawable,
+                                         src->x, src->y,
+                                         src->width, src->height,
+                                         dest_width, dest_height,
+                                         (GimpPreviewRequestFunc)
+                                         gimp_view_renderer_drawable_preview_ready,
+                                         renderdrawable);
+
+  return NULL;
+}
+
+static void
+gimp_view_renderer_drawable_preview_ready (GimpTempBuf              *preview,
+                                           GimpViewRendererDrawable *renderdrawable)
+{
+  GimpViewRenderer *renderer = GIMP_VIEW_RENDERER (renderdrawable);
+
+  renderdrawable->request = NULL;
+  renderdrawable->preview = gimp_temp_buf_ref (preview);
+
+  /*  render again, without dropping the preview we just got  */
+  GIMP_VIEW_RENDERER_CLASS (parent_class)->invalidate (renderer);
+
+  gimp_view_renderer_update (renderer);
+}
+
+static void
+gimp_view_renderer_drawable_clear_preview (GimpViewRendererDrawable *renderdrawable)
+{
+  if (renderdrawable->request)
+    {
+      gimp_preview_request_cancel (renderdrawable->request);
+      renderdrawable->request = NULL;
+    }
+
+  if (renderdrawable->preview)
+    {
+      gimp_temp_buf_unref (renderdrawable->preview);
+      renderdrawable->preview = NULL;
+    }
+}
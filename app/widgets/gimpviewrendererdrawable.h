@@ -35,7 +35,14 @@ typedef struct _GimpViewRendererDrawableClass  GimpViewRendererDrawableClass;
 
 struct _GimpViewRendererDrawable
 {
-  GimpViewRenderer  parent_instance;
+  GimpViewRenderer    parent_instance;
+
+  /*< private >*/
+  GimpPreviewRequest *request;        /*  the preview being rendered  */
+  GimpTempBuf        *preview;        /*  the finished preview        */
+  GeglRectangle       preview_src;
+  gint                preview_width;
+  gint                preview_height;
 };
 
 struct _GimpViewRendererDrawableClass
@@ -66,6 +66,9 @@
 #include "xcf-load.h"
 #include "xcf-read.h"
 #include "xcf-seek.h"
+#include "xcf-tile-handler.h"
+
+#include "gimp-trace.h"
 
 #include "gimp-intl.h"
 
@@ -101,18 +104,12 @@ static GimpChannel   * xcf_load_channel       (XcfInfo       *info,
 static GimpLayerMask * xcf_load_layer_mask    (XcfInfo       *info,
                                                GimpImage     *image);
 static gboolean        xcf_load_buffer        (XcfInfo       *info,
-                                               GeglBuffer    *buffer);
+                                               GimpDrawable  *drawable);
 static gboolean        xcf_load_level         (XcfInfo       *info,
-                                               GeglBuffer    *buffer);
-static gboolean        xcf_load_tile          (XcfInfo       *info,
-                                               GeglBuffer    *buffer,
-                                               GeglRectangle *tile_rect,
-                                               const Babl    *format);
-static gboolean        xcf_load_tile_rle      (XcfInfo       *info,
-                                               GeglBuffer    *buffer,
-                                               GeglRectangle *tile_rect,
-                                               const Babl    *format,
-                                               gint           data_length);
+                                               GimpDrawable  *drawable);
+static guint            xcf_read_offset        (XcfInfo       *info,
+                                               goffset       *data,
+                                               gint           count);
 static GimpParasite  * xcf_load_parasite      (XcfInfo       *info);
 static gboolean        xcf_load_old_paths     (XcfInfo       *info,
                                                GimpImage     *image);
@@ -141,8 +138,8 @@ xcf_load_image (Gimp     *gimp,
 {
   GimpImage          *image = NULL;
   const GimpParasite *parasite;
-  guint32             saved_pos;
-  guint32             offset;
+  goffset             saved_pos;
+  goffset             offset;
   gint                width;
   gint                height;
   gint                image_type;
@@ -184,6 +181,9 @@ xcf_load_image (Gimp     *gimp,
 
   gimp_image_undo_disable (image);
 
+  /*  update the group layers once, after all layers are added  */
+  gimp_image_suspend_group_updates (image);
+
   xcf_progress_update (info);
 
   /* read the image properties */
@@ -217,7 +217,7 @@ xcf_load_image (Gimp     *gimp,
       GList     *item_path = NULL;
 
       /* read in the offset of the next layer */
-      info->cp += xcf_read_int32 (info->fp, &offset, 1);
+      info->cp += xcf_read_offset (info, &offset, 1);
 
       /* if the offset is 0 then we are at the end
        *  of the layer list.
@@ -301,7 +301,7 @@ xcf_load_image (Gimp     *gimp,
       GimpChannel *channel;
 
       /* read in the offset of the next channel */
-      info->cp += xcf_read_int32 (info->fp, &offset, 1);
+      info->cp += xcf_read_offset (info, &offset, 1);
 
       /* if the offset is 0 then we are at the end
        *  of the channel list.
@@ -357,6 +357,8 @@ xcf_load_image (Gimp     *gimp,
   if (info->tattoo_state > 0)
     gimp_image_set_tattoo_state (image, info->tattoo_state);
 
+  gimp_image_resume_group_updates (image);
+
   gimp_image_undo_enable (image);
 
   return image;
@@ -371,6 +373,8 @@ xcf_load_image (Gimp     *gimp,
 
   xcf_load_add_masks (image);
 
+  gimp_image_resume_group_updates (image);
+
   gimp_image_undo_enable (image);
 
   return image;
@@ -707,7 +711,7 @@ xcf_load_image_props (XcfInfo   *info,
 
         case PROP_VECTORS:
           {
-            guint32 base = info->cp;
+            goffset base = info->cp;
 
             if (xcf_load_vectors (info, image))
               {
@@ -715,7 +719,7 @@ xcf_load_image_props (XcfInfo   *info,
                   {
                     g_printerr ("Mismatch in PROP_VECTORS size: "
                                 "skipping %d bytes.\n",
-                                base + prop_size - info->cp);
+                                (gint) (base + prop_size - info->cp));
                     xcf_seek_pos (info, base + prop_size, NULL);
                   }
               }
@@ -773,9 +777,7 @@ xcf_load_layer_props (XcfInfo    *info,
 
         case PROP_FLOATING_SELECTION:
           info->floating_sel = *layer;
-          info->cp +=
-            xcf_read_int32 (info->fp,
-                            (guint32 *) &info->floating_sel_offset, 1);
+          info->cp += xcf_read_offset (info, &info->floating_sel_offset, 1);
           break;
 
         case PROP_OPACITY:
@@ -1139,8 +1141,8 @@ xcf_load_layer (XcfInfo    *info,
 {
   GimpLayer         *layer;
   GimpLayerMask     *layer_mask;
-  guint32            hierarchy_offset;
-  guint32            layer_mask_offset;
+  goffset            hierarchy_offset;
+  goffset            layer_mask_offset;
   gboolean           apply_mask = TRUE;
   gboolean           edit_mask  = FALSE;
   gboolean           show_mask  = FALSE;
@@ -1242,8 +1244,8 @@ xcf_load_layer (XcfInfo    *info,
     }
 
   /* read the hierarchy and layer mask offsets */
-  info->cp += xcf_read_int32 (info->fp, &hierarchy_offset, 1);
-  info->cp += xcf_read_int32 (info->fp, &layer_mask_offset, 1);
+  info->cp += xcf_read_offset (info, &hierarchy_offset, 1);
+  info->cp += xcf_read_offset (info, &layer_mask_offset, 1);
 
   /* read in the hierarchy (ignore it for group layers, both as an
    * optimization and because the hierarchy's extents don't match
@@ -1254,8 +1256,7 @@ xcf_load_layer (XcfInfo    *info,
       if (! xcf_seek_pos (info, hierarchy_offset, NULL))
         goto error;
 
-      if (! xcf_load_buffer (info,
-                             gimp_drawable_get_buffer (GIMP_DRAWABLE (layer))))
+      if (! xcf_load_buffer (info, GIMP_DRAWABLE (layer)))
         goto error;
 
       xcf_progress_update (info);
@@ -1310,7 +1311,7 @@ xcf_load_channel (XcfInfo   *info,
                   GimpImage *image)
 {
   GimpChannel *channel;
-  guint32      hierarchy_offset;
+  goffset      hierarchy_offset;
   gint         width;
   gint         height;
   gboolean     is_fs_drawable;
@@ -1340,14 +1341,13 @@ xcf_load_channel (XcfInfo   *info,
   xcf_progress_update (info);
 
   /* read the hierarchy and layer mask offsets */
-  info->cp += xcf_read_int32 (info->fp, &hierarchy_offset, 1);
+  info->cp += xcf_read_offset (info, &hierarchy_offset, 1);
 
   /* read in the hierarchy */
   if (!xcf_seek_pos (info, hierarchy_offset, NULL))
     goto error;
 
-  if (!xcf_load_buffer (info,
-                        gimp_drawable_get_buffer (GIMP_DRAWABLE (channel))))
+  if (!xcf_load_buffer (info, GIMP_DRAWABLE (channel)))
     goto error;
 
   xcf_progress_update (info);
@@ -1368,7 +1368,7 @@ xcf_load_layer_mask (XcfInfo   *info,
 {
   GimpLayerMask *layer_mask;
   GimpChannel   *channel;
-  guint32        hierarchy_offset;
+  goffset        hierarchy_offset;
   gint           width;
   gint           height;
   gboolean       is_fs_drawable;
@@ -1399,14 +1399,13 @@ xcf_load_layer_mask (XcfInfo   *info,
   xcf_progress_update (info);
 
   /* read the hierarchy and layer mask offsets */
-  info->cp += xcf_read_int32 (info->fp, &hierarchy_offset, 1);
+  info->cp += xcf_read_offset (info, &hierarchy_offset, 1);
 
   /* read in the hierarchy */
   if (! xcf_seek_pos (info, hierarchy_offset, NULL))
     goto error;
 
-  if (!xcf_load_buffer (info,
-                        gimp_drawable_get_buffer (GIMP_DRAWABLE (layer_mask))))
+  if (!xcf_load_buffer (info, GIMP_DRAWABLE (layer_mask)))
     goto error;
 
   xcf_progress_update (info);
@@ -1423,16 +1422,18 @@ xcf_load_layer_mask (XcfInfo   *info,
 }
 
 static gboolean
-xcf_load_buffer (XcfInfo    *info,
-                 GeglBuffer *buffer)
+xcf_load_buffer (XcfInfo      *info,
+                 GimpDrawable *drawable)
 {
+  GeglBuffer *buffer = gimp_drawable_get_buffer (drawable);
   const Babl *format;
-  guint32     saved_pos;
-  guint32     offset;
-  guint32     junk;
+  goffset     saved_pos;
+  goffset     offset;
+  goffset     junk;
   gint        width;
   gint        height;
   gint        bpp;
+  gboolean    success;
 
   format = gegl_buffer_get_format (buffer);
 
@@ -1453,13 +1454,13 @@ xcf_load_buffer (XcfInfo    *info,
    *  as the number of levels found in the file.
    */
 
-  info->cp += xcf_read_int32 (info->fp, &offset, 1); /* top level */
+  info->cp += xcf_read_offset (info, &offset, 1); /* top level */
 
   /* discard offsets for layers below first, if any.
    */
   do
     {
-      info->cp += xcf_read_int32 (info->fp, &junk, 1);
+      info->cp += xcf_read_offset (info, &junk, 1);
     }
   while (junk != 0);
 
@@ -1473,7 +1474,11 @@ xcf_load_buffer (XcfInfo    *info,
     return FALSE;
 
   /* read in the level */
-  if (!xcf_load_level (info, buffer))
+  GIMP_TRACE_BEGIN ("xcf-load-level");
+  success = xcf_load_level (info, drawable);
+  GIMP_TRACE_END ();
+
+  if (! success)
     return FALSE;
 
   /* restore the saved position so we'll be ready to
@@ -1487,20 +1492,22 @@ xcf_load_buffer (XcfInfo    *info,
 
 
 static gboolean
-xcf_load_level (XcfInfo    *info,
-                GeglBuffer *buffer)
+xcf_load_level (XcfInfo      *info,
+                GimpDrawable *drawable)
 {
-  const Babl *format;
-  gint        bpp;
-  guint32     saved_pos;
-  guint32     offset, offset2;
-  gint        n_tile_rows;
-  gint        n_tile_cols;
-  guint       ntiles;
-  gint        width;
-  gint        height;
-  gint        i;
-  gint        fail;
+  GeglBuffer      *buffer = gimp_drawable_get_buffer (drawable);
+  const Babl      *format;
+  GeglTileHandler *handler;
+  gint             bpp;
+  goffset         *offsets;
+  gint            *lengths;
+  goffset          offset, offset2;
+  gint             n_tile_rows;
+  gint             n_tile_cols;
+  guint            ntiles;
+  gint             width;
+  gint             height;
+  gint             i;
 
   format = gegl_buffer_get_format (buffer);
   bpp    = babl_format_get_bytes_per_pixel (format);
@@ -1516,249 +1523,122 @@ xcf_load_level (XcfInfo    *info,
    *  if it is '0', then this tile level is empty
    *  and we can simply return.
    */
-  info->cp += xcf_read_int32 (info->fp, &offset, 1);
+  info->cp += xcf_read_offset (info, &offset, 1);
   if (offset == 0)
     return TRUE;
 
+  if (info->compression == COMPRESS_FRACTAL)
+    g_error ("xcf: fractal compression unimplemented");
+
   n_tile_rows = gimp_gegl_buffer_get_n_tile_rows (buffer, XCF_TILE_HEIGHT);
   n_tile_cols = gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH);
 
   ntiles = n_tile_rows * n_tile_cols;
-  for (i = 0; i < ntiles; i++)
-    {
-      GeglRectangle rect;
 
-      fail = FALSE;
+  offsets = g_new (goffset, ntiles);
+  lengths = g_new (gint, ntiles);
 
+  /* only the tile offsets are read here, the tiles themselves are
+   * read and decoded by the tile handler when they are first used
+   */
+  for (i = 0; i < ntiles; i++)
+    {
       if (offset == 0)
         {
           gimp_message_literal (info->gimp, G_OBJECT (info->progress),
 				GIMP_MESSAGE_ERROR,
 				"not enough tiles found in level");
+          g_free (offsets);
+          g_free (lengths);
           return FALSE;
         }
 
-      /* save the current position as it is where the
-       *  next tile offset is stored.
-       */
-      saved_pos = info->cp;
-
       /* read in the offset of the next tile so we can calculate the amount
          of data needed for this tile*/
-      info->cp += xcf_read_int32 (info->fp, &offset2, 1);
+      info->cp += xcf_read_offset (info, &offset2, 1);
+
+      offsets[i] = offset;
 
       /* if the offset is 0 then we need to read in the maximum possible
          allowing for negative compression */
       if (offset2 == 0)
-        offset2 = offset + XCF_TILE_WIDTH * XCF_TILE_WIDTH * bpp * 1.5;
+        lengths[i] = XCF_TILE_WIDTH * XCF_TILE_WIDTH * bpp * 1.5;
                                         /* 1.5 is probably more
                                            than we need to allow */
+      else
+        lengths[i] = offset2 - offset;
 
-      /* seek to the tile offset */
-      if (! xcf_seek_pos (info, offset, NULL))
-        return FALSE;
-
-      /* get the tile from the tile manager */
-      gimp_gegl_buffer_get_tile_rect (buffer,
-                                      XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
-                                      i, &rect);
-
-      /* read in the tile */
-      switch (info->compression)
-        {
-        case COMPRESS_NONE:
-          if (!xcf_load_tile (info, buffer, &rect, format))
-            fail = TRUE;
-          break;
-        case COMPRESS_RLE:
-          if (!xcf_load_tile_rle (info, buffer, &rect, format,
-                                  offset2 - offset))
-            fail = TRUE;
-          break;
-        case COMPRESS_ZLIB:
-          g_error ("xcf: zlib compression unimplemented");
-          fail = TRUE;
-          break;
-        case COMPRESS_FRACTAL:
-          g_error ("xcf: fractal compression unimplemented");
-          fail = TRUE;
-          break;
-        }
-
-      if (fail)
-        return FALSE;
-
-      /* restore the saved position so we'll be ready to
-       *  read the next offset.
-       */
-      if (!xcf_seek_pos (info, saved_pos, NULL))
-        return FALSE;
-
-      /* read in the offset of the next tile */
-      info->cp += xcf_read_int32 (info->fp, &offset, 1);
+      offset = offset2;
     }
 
   if (offset != 0)
     {
       gimp_message (info->gimp, G_OBJECT (info->progress), GIMP_MESSAGE_ERROR,
-                    "encountered garbage after reading level: %d", offset);
+                    "encountered garbage after reading level: %"
+                    G_GINT64_FORMAT, (gint64) offset);
+      g_free (offsets);
+      g_free (lengths);
       return FALSE;
     }
 
-  return TRUE;
-}
-
-static gboolean
-xcf_load_tile (XcfInfo       *info,
-               GeglBuffer    *buffer,
-               GeglRectangle *tile_rect,
-               const Babl    *format)
-{
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-
-  info->cp += xcf_read_int8 (info->fp, tile_data, tile_size);
-
-  gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
-                   GEGL_AUTO_ROWSTRIDE);
-
-  return TRUE;
-}
+  handler = xcf_tile_handler_new (info->tile_file, info->compression,
+                                  format, width, height,
+                                  ntiles, offsets, lengths);
 
-static gboolean
-xcf_load_tile_rle (XcfInfo       *info,
-                   GeglBuffer    *buffer,
-                   GeglRectangle *tile_rect,
-                   const Babl    *format,
-                   gint           data_length)
-{
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-  gint    i;
-  gint    nmemb_read_successfully;
-  guchar *xcfdata;
-  guchar *xcfodata;
-  guchar *xcfdatalimit;
-
-  /* Workaround for bug #357809: avoid crashing on g_malloc() and skip
-   * this tile (return TRUE without storing data) as if it did not
-   * contain any data.  It is better than returning FALSE, which would
-   * skip the whole hierarchy while there may still be some valid
-   * tiles in the file.
+  /* the handler must see every tile of its buffer, so it is added to
+   * a new buffer which has never been accessed
    */
-  if (data_length <= 0)
-    return TRUE;
+  buffer = gegl_buffer_new (GEGL_RECTANGLE (0, 0, width, height), format);
 
-  xcfdata = xcfodata = g_alloca (data_length);
+  xcf_tile_handler_attach (XCF_TILE_HANDLER (handler), buffer);
 
-  /* we have to use fread instead of xcf_read_* because we may be
-   * reading past the end of the file here
+  /* the last tile's length is only an estimate, so saving the buffer
+   * again has to encode that one tile, all others can be copied
    */
-  nmemb_read_successfully = fread ((gchar *) xcfdata, sizeof (gchar),
-                                   data_length, info->fp);
-  info->cp += nmemb_read_successfully;
-
-  xcfdatalimit = &xcfodata[nmemb_read_successfully - 1];
-
-  for (i = 0; i < bpp; i++)
-    {
-      guchar *data  = tile_data + i;
-      gint    size  = tile_rect->width * tile_rect->height;
-      gint    count = 0;
-      guchar  val;
-      gint    length;
-      gint    j;
-
-      while (size > 0)
-        {
-          if (xcfdata > xcfdatalimit)
-            {
-              goto bogus_rle;
-            }
-
-          val = *xcfdata++;
+  lengths[ntiles - 1] = -1;
 
-          length = val;
-          if (length >= 128)
-            {
-              length = 255 - (length - 1);
-              if (length == 128)
-                {
-                  if (xcfdata >= xcfdatalimit)
-                    {
-                      goto bogus_rle;
-                    }
-
-                  length = (*xcfdata << 8) + xcfdata[1];
-                  xcfdata += 2;
-                }
-
-              count += length;
-              size -= length;
+  xcf_tile_record_attach (xcf_tile_record_new (buffer, info->compression,
+                                               ntiles, offsets, lengths),
+                          info->tile_file);
 
-              if (size < 0)
-                {
-                  goto bogus_rle;
-                }
+  g_free (offsets);
+  g_free (lengths);
 
-              if (&xcfdata[length-1] > xcfdatalimit)
-                {
-                  goto bogus_rle;
-                }
+  gimp_drawable_set_buffer (drawable, FALSE, NULL, buffer);
+  g_object_unref (buffer);
 
-              while (length-- > 0)
-                {
-                  *data = *xcfdata++;
-                  data += bpp;
-                }
-            }
-          else
-            {
-              length += 1;
-              if (length == 128)
-                {
-                  if (xcfdata >= xcfdatalimit)
-                    {
-                      goto bogus_rle;
-                    }
+  return TRUE;
+}
 
-                  length = (*xcfdata << 8) + xcfdata[1];
-                  xcfdata += 2;
-                }
+static guint
+xcf_read_offset (XcfInfo *info,
+                 goffset *data,
+                 gint     count)
+{
+  guint total = 0;
+  gint  i;
 
-              count += length;
-              size -= length;
+  for (i = 0; i < count; i++)
+    {
+      if (info->bytes_per_offset == 8)
+        {
+          guint64 value = 0;
 
-              if (size < 0)
-                {
-                  goto bogus_rle;
-                }
+          total += xcf_read_int64 (info->fp, &value, 1);
 
-              if (xcfdata > xcfdatalimit)
-                {
-                  goto bogus_rle;
-                }
+          data[i] = value;
+        }
+      else
+        {
+          guint32 value = 0;
 
-              val = *xcfdata++;
+          total += xcf_read_int32 (info->fp, &value, 1);
 
-              for (j = 0; j < length; j++)
-                {
-                  *data = val;
-                  data += bpp;
-                }
-            }
+          data[i] = value;
         }
     }
 
-  gegl_buffer_set (buffer, tile_rect, 0, format, tile_data,
-                   GEGL_AUTO_ROWSTRIDE);
-
-  return TRUE;
-
- bogus_rle:
-  return FALSE;
+  return total;
 }
 
 static GimpParasite *
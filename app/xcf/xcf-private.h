@@ -63,7 +63,7 @@ typedef enum
 {
   COMPRESS_NONE              =  0,
   COMPRESS_RLE               =  1,
-  COMPRESS_ZLIB              =  2,  /* unused */
+  COMPRESS_ZLIB              =  2,
   COMPRESS_FRACTAL           =  3   /* unused */
 } XcfCompressionType;
 
@@ -84,25 +84,33 @@ typedef enum
   XCF_GROUP_ITEM_EXPANDED      = 1
 } XcfGroupItemFlagsType;
 
-typedef struct _XcfInfo  XcfInfo;
+typedef struct _XcfInfo       XcfInfo;
+typedef struct _XcfTileFile   XcfTileFile;
+typedef struct _XcfTileRecord XcfTileRecord;
 
 struct _XcfInfo
 {
   Gimp               *gimp;
   GimpProgress       *progress;
+  gint               *async_progress;  /*  per mille, set when saving
+                                        *  from another thread
+                                        */
   FILE               *fp;
-  guint               cp;
+  goffset             cp;
   const gchar        *filename;
   GimpTattoo          tattoo_state;
   GimpLayer          *active_layer;
   GimpChannel        *active_channel;
   GimpDrawable       *floating_sel_drawable;
   GimpLayer          *floating_sel;
-  guint               floating_sel_offset;
+  goffset             floating_sel_offset;
   gint                swap_num;
   gint               *ref_count;
   XcfCompressionType  compression;
   gint                file_version;
+  gint                bytes_per_offset;
+  XcfTileFile        *tile_file;
+  GList              *tile_records;
 };
 
 
@@ -21,6 +21,7 @@
 #include <string.h>
 
 #include <cairo.h>
+#include <gio/gio.h>
 #include <gegl.h>
 #include <gdk-pixbuf/gdk-pixbuf.h>
 
@@ -33,6 +34,7 @@
 #include "gegl/gimp-gegl-tile-compat.h"
 
 #include "core/gimp.h"
+#include "core/gimp-parallel.h"
 #include "core/gimpcontainer.h"
 #include "core/gimpchannel.h"
 #include "core/gimpdrawable.h"
@@ -63,11 +65,40 @@
 #include "xcf-read.h"
 #include "xcf-save.h"
 #include "xcf-seek.h"
+#include "xcf-tile-handler.h"
 #include "xcf-write.h"
 
+#include "gimp-trace.h"
+
 #include "gimp-intl.h"
 
 
+/*  the number of tiles per thread which are encoded in parallel
+ *  before they are written
+ */
+#define XCF_SAVE_TILES_PER_THREAD 16
+
+
+typedef struct
+{
+  GeglBuffer         *buffer;
+  const Babl         *format;
+  XcfCompressionType  compression;
+  XcfTileRecord      *record;
+  gint                first_tile;
+  gsize               max_tile_size;
+  guchar             *tile_data;
+  gsize              *tile_size;
+} XcfSaveTilesData;
+
+
+static gint64   xcf_save_estimate_size (GimpImage         *image);
+
+static guint    xcf_write_offset       (XcfInfo           *info,
+                                        const goffset     *data,
+                                        gint               count,
+                                        GError           **error);
+
 static gboolean xcf_save_image_props   (XcfInfo           *info,
                                         GimpImage         *image,
                                         GError           **error);
@@ -98,17 +129,17 @@ static gboolean xcf_save_buffer        (XcfInfo           *info,
 static gboolean xcf_save_level         (XcfInfo           *info,
                                         GeglBuffer        *buffer,
                                         GError           **error);
-static gboolean xcf_save_tile          (XcfInfo           *info,
-                                        GeglBuffer        *buffer,
+static void     xcf_save_tiles         (gsize              offset,
+                                        gsize              size,
+                                        XcfSaveTilesData  *data);
+static gsize    xcf_save_tile_rle      (const guchar      *tile_data,
                                         GeglRectangle     *tile_rect,
-                                        const Babl        *format,
-                                        GError           **error);
-static gboolean xcf_save_tile_rle      (XcfInfo           *info,
-                                        GeglBuffer        *buffer,
-                                        GeglRectangle     *tile_rect,
-                                        const Babl        *format,
-                                        guchar            *rlebuf,
-                                        GError           **error);
+                                        gint               bpp,
+                                        guchar            *rlebuf);
+static gsize    xcf_save_tile_zlib     (const guchar      *tile_data,
+                                        gsize              tile_size,
+                                        guchar            *zlibbuf,
+                                        gsize              zlibbuf_size);
 static gboolean xcf_save_parasite      (XcfInfo           *info,
                                         GimpParasite      *parasite,
                                         GError           **error);
@@ -142,6 +173,15 @@ static gboolean xcf_save_vectors       (XcfInfo           *info,
     }                                                             \
   } G_STMT_END
 
+#define xcf_write_offset_check_error(info, data, count) G_STMT_START { \
+  info->cp += xcf_write_offset (info, data, count, &tmp_error);     \
+  if (tmp_error)                                                    \
+    {                                                               \
+      g_propagate_error (error, tmp_error);                         \
+      return FALSE;                                                 \
+    }                                                               \
+  } G_STMT_END
+
 #define xcf_write_float_check_error(info, data, count) G_STMT_START { \
   info->cp += xcf_write_float (info->fp, data, count, &tmp_error); \
   if (tmp_error)                                                   \
@@ -176,6 +216,9 @@ static gboolean xcf_save_vectors       (XcfInfo           *info,
     if (info->progress)                         \
       gimp_progress_set_value (info->progress,  \
                                (gdouble) progress / (gdouble) max_progress); \
+    else if (info->async_progress)              \
+      g_atomic_int_set (info->async_progress,   \
+                        progress * 1000 / max_progress); \
   } G_STMT_END
 
 
@@ -218,7 +261,16 @@ xcf_save_choose_format (XcfInfo   *info,
   if (gimp_image_get_precision (image) != GIMP_PRECISION_U8_GAMMA)
     save_version = MAX (5, save_version);
 
-  info->file_version = save_version;
+  /* need version 6 for zlib compression */
+  if (info->compression == COMPRESS_ZLIB)
+    save_version = MAX (6, save_version);
+
+  /* need version 7 for 64 bit offsets */
+  if (xcf_save_estimate_size (image) > G_MAXUINT32)
+    save_version = MAX (7, save_version);
+
+  info->file_version     = save_version;
+  info->bytes_per_offset = (save_version >= 7) ? 8 : 4;
 }
 
 gint
@@ -229,8 +281,8 @@ xcf_save_image (XcfInfo    *info,
   GList   *all_layers;
   GList   *all_channels;
   GList   *list;
-  guint32  saved_pos;
-  guint32  offset;
+  goffset  saved_pos;
+  goffset  offset;
   guint32  value;
   guint    n_layers;
   guint    n_channels;
@@ -298,7 +350,8 @@ xcf_save_image (XcfInfo    *info,
 
   /* seek to after the offset lists */
   xcf_check_error (xcf_seek_pos (info,
-                                 info->cp + (n_layers + n_channels + 2) * 4,
+                                 info->cp + (n_layers + n_channels + 2) *
+                                 info->bytes_per_offset,
                                  error));
 
   for (list = all_layers; list; list = g_list_next (list))
@@ -319,7 +372,7 @@ xcf_save_image (XcfInfo    *info,
        *  layer offset and write it out.
        */
       xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-      xcf_write_int32_check_error (info, &offset, 1);
+      xcf_write_offset_check_error (info, &offset, 1);
 
       /* increment the location we are to write out the
        *  next offset.
@@ -337,7 +390,7 @@ xcf_save_image (XcfInfo    *info,
    */
   offset = 0;
   xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_int32_check_error (info, &offset, 1);
+  xcf_write_offset_check_error (info, &offset, 1);
   saved_pos = info->cp;
   xcf_check_error (xcf_seek_end (info, error));
 
@@ -359,7 +412,7 @@ xcf_save_image (XcfInfo    *info,
        *  channel offset and write it out.
        */
       xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-      xcf_write_int32_check_error (info, &offset, 1);
+      xcf_write_offset_check_error (info, &offset, 1);
 
       /* increment the location we are to write out the
        *  next offset.
@@ -380,12 +433,84 @@ xcf_save_image (XcfInfo    *info,
    */
   offset = 0;
   xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_int32_check_error (info, &offset, 1);
+  xcf_write_offset_check_error (info, &offset, 1);
   saved_pos = info->cp;
 
   return !ferror (info->fp);
 }
 
+/*  an upper bound of the file size, from the size of the pixel data
+ *  of all drawables, allowing for negative compression
+ */
+static gint64
+xcf_save_estimate_size (GimpImage *image)
+{
+  GList  *drawables;
+  GList  *list;
+  gint64  size = 0;
+
+  drawables = g_list_concat (gimp_image_get_layer_list (image),
+                             gimp_image_get_channel_list (image));
+
+  drawables = g_list_prepend (drawables, gimp_image_get_mask (image));
+
+  for (list = drawables; list; list = g_list_next (list))
+    {
+      GimpDrawable *drawable = list->data;
+      gint          bpp;
+
+      bpp = babl_format_get_bytes_per_pixel (gimp_drawable_get_format (drawable));
+
+      size += ((gint64) gimp_item_get_width  (GIMP_ITEM (drawable)) *
+               (gint64) gimp_item_get_height (GIMP_ITEM (drawable)) *
+               bpp * 3 / 2);
+
+      if (GIMP_IS_LAYER (drawable) && gimp_layer_get_mask (list->data))
+        drawables = g_list_insert_before (drawables, list->next,
+                                          gimp_layer_get_mask (list->data));
+    }
+
+  g_list_free (drawables);
+
+  return size;
+}
+
+static guint
+xcf_write_offset (XcfInfo        *info,
+                  const goffset  *data,
+                  gint            count,
+                  GError        **error)
+{
+  guint total = 0;
+  gint  i;
+
+  for (i = 0; i < count; i++)
+    {
+      GError *tmp_error = NULL;
+
+      if (info->bytes_per_offset == 8)
+        {
+          guint64 value = data[i];
+
+          total += xcf_write_int64 (info->fp, &value, 1, &tmp_error);
+        }
+      else
+        {
+          guint32 value = data[i];
+
+          total += xcf_write_int32 (info->fp, &value, 1, &tmp_error);
+        }
+
+      if (tmp_error)
+        {
+          g_propagate_error (error, tmp_error);
+          break;
+        }
+    }
+
+  return total;
+}
+
 static gboolean
 xcf_save_image_props (XcfInfo    *info,
                       GimpImage  *image,
@@ -673,15 +798,15 @@ xcf_save_prop (XcfInfo    *info,
 
     case PROP_FLOATING_SELECTION:
       {
-        guint32 dummy;
+        goffset dummy;
 
         dummy = 0;
-        size = 4;
+        size = info->bytes_per_offset;
 
         xcf_write_prop_type_check_error (info, prop_type);
         xcf_write_int32_check_error (info, &size, 1);
         info->floating_sel_offset = info->cp;
-        xcf_write_int32_check_error (info, &dummy, 1);
+        xcf_write_offset_check_error (info, &dummy, 1);
       }
       break;
 
@@ -980,8 +1105,8 @@ xcf_save_prop (XcfInfo    *info,
 
         if (gimp_parasite_list_persistent_length (list) > 0)
           {
-            guint32 base, length;
-            long    pos;
+            goffset base, pos;
+            guint32 length;
 
             xcf_write_prop_type_check_error (info, prop_type);
 
@@ -1025,8 +1150,8 @@ xcf_save_prop (XcfInfo    *info,
 
     case PROP_PATHS:
       {
-        guint32 base, length;
-        glong   pos;
+        goffset base, pos;
+        guint32 length;
 
         xcf_write_prop_type_check_error (info, prop_type);
 
@@ -1091,8 +1216,8 @@ xcf_save_prop (XcfInfo    *info,
 
     case PROP_VECTORS:
       {
-        guint32 base, length;
-        glong   pos;
+        goffset base, pos;
+        guint32 length;
 
         xcf_write_prop_type_check_error (info, prop_type);
 
@@ -1180,8 +1305,8 @@ xcf_save_layer (XcfInfo    *info,
                 GimpLayer  *layer,
                 GError    **error)
 {
-  guint32      saved_pos;
-  guint32      offset;
+  goffset      saved_pos;
+  goffset      offset;
   guint32      value;
   const gchar *string;
   GError      *tmp_error = NULL;
@@ -1193,7 +1318,7 @@ xcf_save_layer (XcfInfo    *info,
     {
       saved_pos = info->cp;
       xcf_check_error (xcf_seek_pos (info, info->floating_sel_offset, error));
-      xcf_write_int32_check_error (info, &saved_pos, 1);
+      xcf_write_offset_check_error (info, &saved_pos, 1);
       xcf_check_error (xcf_seek_pos (info, saved_pos, error));
     }
 
@@ -1220,7 +1345,8 @@ xcf_save_layer (XcfInfo    *info,
   saved_pos = info->cp;
 
   /*  write out the layer tile hierarchy  */
-  xcf_check_error (xcf_seek_pos (info, info->cp + 8, error));
+  xcf_check_error (xcf_seek_pos (info, info->cp + 2 * info->bytes_per_offset,
+                                 error));
   offset = info->cp;
 
   xcf_check_error (xcf_save_buffer (info,
@@ -1228,7 +1354,7 @@ xcf_save_layer (XcfInfo    *info,
                                     error));
 
   xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_int32_check_error (info, &offset, 1);
+  xcf_write_offset_check_error (info, &offset, 1);
 
   /*  save the current position which is where the layer mask offset
    *  will be stored.
@@ -1250,7 +1376,7 @@ xcf_save_layer (XcfInfo    *info,
     offset = 0;
 
   xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_int32_check_error (info, &offset, 1);
+  xcf_write_offset_check_error (info, &offset, 1);
 
   return TRUE;
 }
@@ -1261,8 +1387,8 @@ xcf_save_channel (XcfInfo      *info,
                   GimpChannel  *channel,
                   GError      **error)
 {
-  guint32      saved_pos;
-  guint32      offset;
+  goffset      saved_pos;
+  goffset      offset;
   guint32      value;
   const gchar *string;
   GError      *tmp_error = NULL;
@@ -1274,7 +1400,7 @@ xcf_save_channel (XcfInfo      *info,
     {
       saved_pos = info->cp;
       xcf_check_error (xcf_seek_pos (info, info->floating_sel_offset, error));
-      xcf_write_int32_check_error (info, &saved_pos, 1);
+      xcf_write_offset_check_error (info, &saved_pos, 1);
       xcf_check_error (xcf_seek_pos (info, saved_pos, error));
     }
 
@@ -1298,7 +1424,8 @@ xcf_save_channel (XcfInfo      *info,
   saved_pos = info->cp;
 
   /* write out the channel tile hierarchy */
-  xcf_check_error (xcf_seek_pos (info, info->cp + 4, error));
+  xcf_check_error (xcf_seek_pos (info, info->cp + info->bytes_per_offset,
+                                 error));
   offset = info->cp;
 
   xcf_check_error (xcf_save_buffer (info,
@@ -1306,7 +1433,7 @@ xcf_save_channel (XcfInfo      *info,
                                     error));
 
   xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_int32_check_error (info, &offset, 1);
+  xcf_write_offset_check_error (info, &offset, 1);
   saved_pos = info->cp;
 
   return TRUE;
@@ -1335,8 +1462,8 @@ xcf_save_buffer (XcfInfo     *info,
                  GError     **error)
 {
   const Babl *format;
-  guint32     saved_pos;
-  guint32     offset;
+  goffset     saved_pos;
+  goffset     offset;
   guint32     width;
   guint32     height;
   guint32     bpp;
@@ -1361,7 +1488,10 @@ xcf_save_buffer (XcfInfo     *info,
   tmp2 = xcf_calc_levels (height, XCF_TILE_HEIGHT);
   nlevels = MAX (tmp1, tmp2);
 
-  xcf_check_error (xcf_seek_pos (info, info->cp + (1 + nlevels) * 4, error));
+  xcf_check_error (xcf_seek_pos (info,
+                                 info->cp + (1 + nlevels) *
+                                 info->bytes_per_offset,
+                                 error));
 
   for (i = 0; i < nlevels; i++)
     {
@@ -1369,8 +1499,14 @@ xcf_save_buffer (XcfInfo     *info,
 
       if (i == 0)
         {
+          gboolean success;
+
           /* write out the level. */
-          xcf_check_error (xcf_save_level (info, buffer, error));
+          GIMP_TRACE_BEGIN ("xcf-save-level");
+          success = xcf_save_level (info, buffer, error);
+          GIMP_TRACE_END ();
+
+          xcf_check_error (success);
         }
       else
         {
@@ -1387,7 +1523,7 @@ xcf_save_buffer (XcfInfo     *info,
        *  level offset and write it out.
        */
       xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-      xcf_write_int32_check_error (info, &offset, 1);
+      xcf_write_offset_check_error (info, &offset, 1);
 
       /* increment the location we are to write out the
        *  next offset.
@@ -1405,7 +1541,7 @@ xcf_save_buffer (XcfInfo     *info,
    */
   offset = 0;
   xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_int32_check_error (info, &offset, 1);
+  xcf_write_offset_check_error (info, &offset, 1);
 
   return TRUE;
 }
@@ -1415,18 +1551,20 @@ xcf_save_level (XcfInfo     *info,
                 GeglBuffer  *buffer,
                 GError     **error)
 {
-  const Babl *format;
-  guint32     saved_pos;
-  guint32     offset;
-  guint32     width;
-  guint32     height;
-  gint        bpp;
-  gint        n_tile_rows;
-  gint        n_tile_cols;
-  guint       ntiles;
-  gint        i;
-  guchar     *rlebuf;
-  GError     *tmp_error = NULL;
+  const Babl       *format;
+  XcfSaveTilesData  data;
+  goffset           saved_pos;
+  goffset          *offsets;
+  gint             *lengths;
+  guint32           width;
+  guint32           height;
+  gint              bpp;
+  gint              n_tile_rows;
+  gint              n_tile_cols;
+  guint             ntiles;
+  guint             n_batch_tiles;
+  guint             first;
+  GError           *tmp_error = NULL;
 
   format = gegl_buffer_get_format (buffer);
 
@@ -1439,114 +1577,185 @@ xcf_save_level (XcfInfo     *info,
 
   saved_pos = info->cp;
 
-  /* allocate a temporary buffer to store the rle data before it is
-   * written to disk
-   */
-  rlebuf = g_alloca (XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp * 1.5);
+  switch (info->compression)
+    {
+    case COMPRESS_NONE:
+    case COMPRESS_RLE:
+    case COMPRESS_ZLIB:
+      break;
+    case COMPRESS_FRACTAL:
+      g_error ("xcf: fractal compression unimplemented");
+      break;
+    }
 
   n_tile_rows = gimp_gegl_buffer_get_n_tile_rows (buffer, XCF_TILE_HEIGHT);
   n_tile_cols = gimp_gegl_buffer_get_n_tile_cols (buffer, XCF_TILE_WIDTH);
 
   ntiles = n_tile_rows * n_tile_cols;
-  xcf_check_error (xcf_seek_pos (info, info->cp + (ntiles + 1) * 4, error));
+  xcf_check_error (xcf_seek_pos (info,
+                                 info->cp + (ntiles + 1) *
+                                 info->bytes_per_offset,
+                                 error));
 
-  for (i = 0; i < ntiles; i++)
+  /*  the tiles are encoded in batches on all threads, and then
+   *  written one after the other in their original order, so the
+   *  file is the same as if they were saved one by one
+   */
+  n_batch_tiles = MIN (ntiles,
+                       gimp_parallel_get_n_threads () *
+                       XCF_SAVE_TILES_PER_THREAD);
+
+  data.buffer        = buffer;
+  data.format        = format;
+  data.compression   = info->compression;
+  /*  the tiles of an unchanged buffer are copied from its last file  */
+  data.record        = xcf_tile_record_get (buffer, info->compression);
+  /*  the rle and zlib data can be larger than the tile itself  */
+  data.max_tile_size = XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp * 1.5;
+  data.tile_data     = g_malloc (n_batch_tiles * data.max_tile_size);
+  data.tile_size     = g_new (gsize, n_batch_tiles);
+
+  offsets = g_new (goffset, ntiles + 1);
+  lengths = g_new (gint, ntiles);
+
+  for (first = 0; first < ntiles && ! tmp_error; first += n_batch_tiles)
     {
-      GeglRectangle rect;
+      guint n_tiles = MIN (n_batch_tiles, ntiles - first);
+      guint i;
 
-      /* save the start offset of where we are writing
-       *  out the next tile.
-       */
-      offset = info->cp;
+      data.first_tile = first;
 
-      gimp_gegl_buffer_get_tile_rect (buffer,
-                                      XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
-                                      i, &rect);
+      gimp_parallel_distribute_range (n_tiles, 1,
+                                      (GimpParallelDistributeRangeFunc)
+                                      xcf_save_tiles,
+                                      &data);
 
-      /* write out the tile. */
-      switch (info->compression)
+      for (i = 0; i < n_tiles && ! tmp_error; i++)
         {
-        case COMPRESS_NONE:
-          xcf_check_error (xcf_save_tile (info, buffer, &rect, format,
-                                          error));
-          break;
-        case COMPRESS_RLE:
-          xcf_check_error (xcf_save_tile_rle (info, buffer, &rect, format,
-                                              rlebuf, error));
-          break;
-        case COMPRESS_ZLIB:
-          g_error ("xcf: zlib compression unimplemented");
-          break;
-        case COMPRESS_FRACTAL:
-          g_error ("xcf: fractal compression unimplemented");
-          break;
+          /* save the start offset of where we are writing
+           *  out the tile.
+           */
+          offsets[first + i] = info->cp;
+          lengths[first + i] = data.tile_size[i];
+
+          info->cp += xcf_write_int8 (info->fp,
+                                      data.tile_data + i * data.max_tile_size,
+                                      data.tile_size[i], &tmp_error);
         }
+    }
 
-      /* seek back to where we are to write out the next
-       *  tile offset and write it out.
-       */
-      xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-      xcf_write_int32_check_error (info, &offset, 1);
+  g_free (data.tile_data);
+  g_free (data.tile_size);
 
-      /* increment the location we are to write out the
-       *  next offset.
-       */
-      saved_pos = info->cp;
+  /* a '0' offset position indicates the end of the tile offsets.
+   */
+  offsets[ntiles] = 0;
 
-      /* seek to the end of the file which is where
-       *  we will write out the next tile.
+  if (! tmp_error)
+    {
+      /* seek back to where the tile offsets go, and write them out.
        */
-      xcf_check_error (xcf_seek_end (info, error));
+      if (! xcf_seek_pos (info, saved_pos, error))
+        {
+          g_free (offsets);
+          return FALSE;
+        }
+
+      info->cp += xcf_write_offset (info, offsets, ntiles + 1, &tmp_error);
     }
 
-  /* write out a '0' offset position to indicate the end
-   *  of the level offsets.
+  /* the record is attached to the buffer once the file is complete,
+   * so the next save can copy the tiles from it
    */
-  offset = 0;
-  xcf_check_error (xcf_seek_pos (info, saved_pos, error));
-  xcf_write_int32_check_error (info, &offset, 1);
+  if (! tmp_error)
+    info->tile_records = g_list_prepend (info->tile_records,
+                                         xcf_tile_record_new (buffer,
+                                                              info->compression,
+                                                              ntiles,
+                                                              offsets,
+                                                              lengths));
+
+  g_free (offsets);
+  g_free (lengths);
+
+  if (tmp_error)
+    {
+      g_propagate_error (error, tmp_error);
+      return FALSE;
+    }
 
   return TRUE;
-
 }
 
-static gboolean
-xcf_save_tile (XcfInfo        *info,
-               GeglBuffer     *buffer,
-               GeglRectangle  *tile_rect,
-               const Babl     *format,
-               GError        **error)
+static void
+xcf_save_tiles (gsize             offset,
+                gsize             size,
+                XcfSaveTilesData *data)
 {
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-  GError *tmp_error = NULL;
+  gint    bpp       = babl_format_get_bytes_per_pixel (data->format);
+  guchar *tile_data = NULL;
+  gsize   i;
 
-  gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
-                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  if (data->compression != COMPRESS_NONE)
+    tile_data = g_malloc (XCF_TILE_WIDTH * XCF_TILE_HEIGHT * bpp);
 
-  xcf_write_int8_check_error (info, tile_data, tile_size);
+  for (i = offset; i < offset + size; i++)
+    {
+      guchar        *dest = data->tile_data + i * data->max_tile_size;
+      GeglRectangle  rect;
 
-  return TRUE;
+      if (data->record &&
+          xcf_tile_record_read (data->record, data->first_tile + i,
+                                dest, data->max_tile_size,
+                                &data->tile_size[i]))
+        continue;
+
+      gimp_gegl_buffer_get_tile_rect (data->buffer,
+                                      XCF_TILE_WIDTH, XCF_TILE_HEIGHT,
+                                      data->first_tile + i, &rect);
+
+      switch (data->compression)
+        {
+        case COMPRESS_NONE:
+          gegl_buffer_get (data->buffer, &rect, 1.0, data->format, dest,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          data->tile_size[i] = bpp * rect.width * rect.height;
+          break;
+
+        case COMPRESS_RLE:
+          gegl_buffer_get (data->buffer, &rect, 1.0, data->format, tile_data,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          data->tile_size[i] = xcf_save_tile_rle (tile_data, &rect, bpp, dest);
+          break;
+
+        case COMPRESS_ZLIB:
+          gegl_buffer_get (data->buffer, &rect, 1.0, data->format, tile_data,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          data->tile_size[i] = xcf_save_tile_zlib (tile_data,
+                                                   bpp * rect.width *
+                                                   rect.height,
+                                                   dest, data->max_tile_size);
+          break;
+
+        default:
+          g_return_if_reached ();
+        }
+    }
+
+  g_free (tile_data);
 }
 
-static gboolean
-xcf_save_tile_rle (XcfInfo        *info,
-                   GeglBuffer     *buffer,
-                   GeglRectangle  *tile_rect,
-                   const Babl     *format,
-                   guchar         *rlebuf,
-                   GError        **error)
+static gsize
+xcf_save_tile_rle (const guchar  *tile_data,
+                   GeglRectangle *tile_rect,
+                   gint           bpp,
+                   guchar        *rlebuf)
 {
-  gint    bpp       = babl_format_get_bytes_per_pixel (format);
-  gint    tile_size = bpp * tile_rect->width * tile_rect->height;
-  guchar *tile_data = g_alloca (tile_size);
-  gint    len       = 0;
-  gint    i, j;
-  GError *tmp_error  = NULL;
-
-  gegl_buffer_get (buffer, tile_rect, 1.0, format, tile_data,
-                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+  gsize len = 0;
+  gint  i, j;
 
   for (i = 0; i < bpp; i++)
     {
@@ -1641,12 +1850,51 @@ xcf_save_tile_rle (XcfInfo        *info,
         }
 
       if (count != (tile_rect->width * tile_rect->height))
-        g_message ("xcf: uh oh! xcf rle tile saving error: %d", count);
+        g_printerr ("xcf: uh oh! xcf rle tile saving error: %d\n", count);
+    }
+
+  return len;
+}
+
+/*  every tile is a separate zlib stream of the plain tile data  */
+static gsize
+xcf_save_tile_zlib (const guchar *tile_data,
+                    gsize         tile_size,
+                    guchar       *zlibbuf,
+                    gsize         zlibbuf_size)
+{
+  GConverter      *converter;
+  GConverterResult result;
+  gsize            n_read    = 0;
+  gsize            n_written = 0;
+
+  converter = G_CONVERTER (g_zlib_compressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB,
+                                                  -1));
+
+  do
+    {
+      gsize bytes_read;
+      gsize bytes_written;
+
+      result = g_converter_convert (converter,
+                                    tile_data + n_read,
+                                    tile_size - n_read,
+                                    zlibbuf + n_written,
+                                    zlibbuf_size - n_written,
+                                    G_CONVERTER_INPUT_AT_END,
+                                    &bytes_read, &bytes_written, NULL);
+
+      n_read    += bytes_read;
+      n_written += bytes_written;
     }
+  while (result == G_CONVERTER_CONVERTED);
 
-  xcf_write_int8_check_error (info, rlebuf, len);
+  g_object_unref (converter);
 
-  return TRUE;
+  if (result != G_CONVERTER_FINISHED)
+    g_printerr ("xcf: uh oh! xcf zlib tile saving error\n");
+
+  return n_written;
 }
 
 static gboolean
@@ -1886,7 +2134,7 @@ xcf_save_vectors (XcfInfo    *info,
       tattoo        = gimp_item_get_tattoo (GIMP_ITEM (vectors));
       parasites     = gimp_item_get_parasites (GIMP_ITEM (vectors));
       num_parasites = gimp_parasite_list_persistent_length (parasites);
-      num_strokes   = g_list_length (vectors->strokes);
+      num_strokes   = g_queue_get_length (vectors->strokes);
 
       xcf_write_string_check_error (info, (gchar **) &name, 1);
       xcf_write_int32_check_error  (info, &tattoo,          1);
@@ -1897,7 +2145,7 @@ xcf_save_vectors (XcfInfo    *info,
 
       xcf_check_error (xcf_save_parasite_list (info, parasites, error));
 
-      for (stroke_list = g_list_first (vectors->strokes);
+      for (stroke_list = vectors->strokes->head;
            stroke_list;
            stroke_list = g_list_next (stroke_list))
         {
@@ -29,15 +29,25 @@
 
 #include "gimp-intl.h"
 
+
+/*  the offsets of XCF files larger than 4 GB don't fit into a long
+ *  on all platforms
+ */
+#ifdef G_OS_WIN32
+#define fseeko _fseeki64
+#define ftello _ftelli64
+#endif
+
+
 gboolean
 xcf_seek_pos (XcfInfo  *info,
-              guint     pos,
+              goffset   pos,
               GError  **error)
 {
   if (info->cp != pos)
     {
       info->cp = pos;
-      if (fseek (info->fp, info->cp, SEEK_SET) == -1)
+      if (fseeko (info->fp, info->cp, SEEK_SET) == -1)
         {
           g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
                        _("Could not seek in XCF file: %s"),
@@ -54,7 +64,7 @@ gboolean
 xcf_seek_end (XcfInfo  *info,
               GError  **error)
 {
-  if (fseek (info->fp, 0, SEEK_END) == -1)
+  if (fseeko (info->fp, 0, SEEK_END) == -1)
     {
       g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
                    _("Could not seek in XCF file: %s"),
@@ -63,9 +73,9 @@ xcf_seek_end (XcfInfo  *info,
       return FALSE;
     }
 
-  info->cp = ftell (info->fp);
+  info->cp = ftello (info->fp);
 
-  if (fseek (info->fp, 0, SEEK_END) == -1)
+  if (fseeko (info->fp, 0, SEEK_END) == -1)
     {
       g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
                    _("Could not seek in XCF file: %s"),
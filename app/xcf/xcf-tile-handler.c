@@ -0,0 +1,1321 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#include <gegl.h>
+
+#include "libgimpbase/gimpbase.h"
+
+#include "core/core-types.h"
+
+#include "core/gimp-parallel.h"
+
+#include "xcf-private.h"
+#include "xcf-tile-handler.h"
+
+
+#ifdef G_OS_WIN32
+#define fseeko _fseeki64
+#endif
+
+/*  how far ahead of the last requested tile to look for tiles to
+ *  decode in the background
+ */
+#define XCF_READ_AHEAD_SCAN 64
+
+
+/*  the states of a buffer tile  */
+enum
+{
+  XCF_TILE_PENDING,   /*  only in the file                       */
+  XCF_TILE_QUEUED,    /*  queued for decoding ahead              */
+  XCF_TILE_DECODING,  /*  being decoded                          */
+  XCF_TILE_DECODED,   /*  decoded ahead, not fetched yet         */
+  XCF_TILE_LOADED     /*  in the buffer's own storage            */
+};
+
+typedef struct
+{
+  XcfTileHandler *handler;
+  gint            index;
+} XcfTileJob;
+
+
+/*  the file the tiles are read from, shared by all drawables of an
+ *  image.  It is read with stdio, not memory-mapped: it stays open as
+ *  long as any of its tiles are needed, and reading a mapping of a
+ *  file which another program truncated crashes with SIGBUS
+ */
+struct _XcfTileFile
+{
+  gint          ref_count;
+  gchar        *filename;
+  GStatBuf      stat;
+
+  FILE         *fp;
+  GMutex        fp_mutex;
+};
+
+/*  where the tiles of a buffer are in an XCF file, owned by the
+ *  buffer.  The record is dirty as soon as the buffer changes
+ */
+struct _XcfTileRecord
+{
+  GeglBuffer         *buffer;
+  XcfTileFile        *file;
+  XcfCompressionType  compression;
+  const Babl         *format;
+  gint                width;
+  gint                height;
+
+  gint                n_xcf_tiles;
+  goffset            *offsets;
+  gint               *lengths;   /*  -1 if not known  */
+
+  glong               changed_id;
+  gint                dirty;
+};
+
+
+static void       xcf_tile_handler_finalize  (GObject         *object);
+
+static gpointer   xcf_tile_handler_command   (GeglTileSource  *source,
+                                              GeglTileCommand  command,
+                                              gint             x,
+                                              gint             y,
+                                              gint             z,
+                                              gpointer         data);
+
+static GeglTile * xcf_tile_handler_validate  (XcfTileHandler  *handler,
+                                              GeglTile        *tile,
+                                              gint             x,
+                                              gint             y);
+static void       xcf_tile_handler_mark      (XcfTileHandler  *handler,
+                                              gint             x,
+                                              gint             y);
+static void       xcf_tile_handler_prefetch  (XcfTileHandler  *handler,
+                                              gint             index);
+static void       xcf_tile_handler_decode    (XcfTileJob      *job,
+                                              gpointer         data);
+static void       xcf_tile_handler_load_tile (XcfTileHandler  *handler,
+                                              guchar          *dest,
+                                              gint             x,
+                                              gint             y);
+static gboolean   xcf_tile_handler_read      (XcfTileHandler  *handler,
+                                              gint             i,
+                                              gint             n_pixels,
+                                              guchar          *xcf_tile,
+                                              guchar         **read_buf,
+                                              gsize           *read_buf_size);
+static void       xcf_tile_handler_complete  (XcfTileHandler  *handler);
+
+static gboolean   xcf_tile_file_matches      (XcfTileFile     *file,
+                                              const gchar     *filename,
+                                              const GStatBuf  *stat);
+static gboolean   xcf_tile_file_unchanged    (XcfTileFile     *file);
+
+static void       xcf_tile_record_changed    (GeglBuffer          *buffer,
+                                              const GeglRectangle *rect,
+                                              XcfTileRecord       *record);
+
+static gboolean   xcf_tile_decode_rle        (const guchar    *src,
+                                              gsize            src_length,
+                                              guchar          *dest,
+                                              gint             n_pixels,
+                                              gint             bpp);
+static gboolean   xcf_tile_decode_zlib       (const guchar    *src,
+                                              gsize            src_length,
+                                              guchar          *dest,
+                                              gint             n_pixels,
+                                              gint             bpp);
+
+
+G_DEFINE_TYPE (XcfTileHandler, xcf_tile_handler, GEGL_TYPE_TILE_HANDLER)
+
+#define parent_class xcf_tile_handler_parent_class
+
+
+/*  the handlers which still have tiles to read, so they can be
+ *  forced to read them before their file is overwritten
+ */
+static GList  *pending_handlers = NULL;
+static GMutex  pending_mutex;
+
+/*  the attached tile records, only used from the main thread  */
+static GList  *tile_records     = NULL;
+
+
+static void
+xcf_tile_handler_class_init (XcfTileHandlerClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = xcf_tile_handler_finalize;
+}
+
+static void
+xcf_tile_handler_init (XcfTileHandler *handler)
+{
+  GeglTileSource *source = GEGL_TILE_SOURCE (handler);
+
+  source->command = xcf_tile_handler_command;
+
+  g_mutex_init (&handler->mutex);
+  g_cond_init (&handler->cond);
+}
+
+static void
+xcf_tile_handler_finalize (GObject *object)
+{
+  XcfTileHandler *handler = XCF_TILE_HANDLER (object);
+
+  g_mutex_lock (&pending_mutex);
+  pending_handlers = g_list_remove (pending_handlers, handler);
+  g_mutex_unlock (&pending_mutex);
+
+  if (handler->buffer)
+    {
+      g_object_remove_weak_pointer (G_OBJECT (handler->buffer),
+                                    (gpointer) &handler->buffer);
+      handler->buffer = NULL;
+    }
+
+  if (handler->file)
+    {
+      xcf_tile_file_unref (handler->file);
+      handler->file = NULL;
+    }
+
+  if (handler->decoded)
+    {
+      gint i;
+
+      for (i = 0; i < handler->n_tile_cols * handler->n_tile_rows; i++)
+        g_free (handler->decoded[i]);
+
+      g_clear_pointer (&handler->decoded, g_free);
+    }
+
+  g_clear_pointer (&handler->offsets, g_free);
+  g_clear_pointer (&handler->lengths, g_free);
+  g_clear_pointer (&handler->state,   g_free);
+
+  g_cond_clear (&handler->cond);
+  g_mutex_clear (&handler->mutex);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static gpointer
+xcf_tile_handler_command (GeglTileSource  *source,
+                          GeglTileCommand  command,
+                          gint             x,
+                          gint             y,
+                          gint             z,
+                          gpointer         data)
+{
+  XcfTileHandler *handler = XCF_TILE_HANDLER (source);
+  gpointer        retval;
+
+  retval = gegl_tile_handler_source_command (source, command, x, y, z, data);
+
+  /*  mipmap levels are built from level 0 tiles which are requested
+   *  through the whole chain again, so only level 0 needs loading
+   */
+  if (z != 0 || g_atomic_int_get (&handler->n_pending) == 0)
+    return retval;
+
+  switch (command)
+    {
+    case GEGL_TILE_GET:
+      retval = xcf_tile_handler_validate (handler, retval, x, y);
+      break;
+
+    case GEGL_TILE_SET:
+    case GEGL_TILE_VOID:
+      /*  the tile's contents don't come from the file any longer  */
+      xcf_tile_handler_mark (handler, x, y);
+      break;
+
+    default:
+      break;
+    }
+
+  return retval;
+}
+
+static GeglTile *
+xcf_tile_handler_validate (XcfTileHandler *handler,
+                           GeglTile       *tile,
+                           gint            x,
+                           gint            y)
+{
+  gint index;
+
+  if (x < 0 || x >= handler->n_tile_cols ||
+      y < 0 || y >= handler->n_tile_rows)
+    return tile;
+
+  index = y * handler->n_tile_cols + x;
+
+  g_mutex_lock (&handler->mutex);
+
+  while (handler->state[index] == XCF_TILE_DECODING)
+    g_cond_wait (&handler->cond, &handler->mutex);
+
+  if (handler->state[index] != XCF_TILE_LOADED)
+    {
+      guchar *decoded = handler->decoded[index];
+      guchar *data;
+      gsize   size;
+
+      handler->decoded[index] = NULL;
+      handler->state[index]   = XCF_TILE_DECODING;
+
+      g_mutex_unlock (&handler->mutex);
+
+      /*  get the next tiles going while this one is decoded  */
+      xcf_tile_handler_prefetch (handler, index);
+
+      if (! tile)
+        tile = gegl_tile_handler_create_tile (GEGL_TILE_HANDLER (handler),
+                                              x, y, 0);
+
+      gegl_tile_lock (tile);
+
+      data = gegl_tile_get_data (tile);
+      size = handler->tile_width * handler->tile_height * handler->bpp;
+
+      if (decoded)
+        {
+          memcpy (data, decoded, size);
+          g_free (decoded);
+        }
+      else
+        {
+          memset (data, 0, size);
+
+          xcf_tile_handler_load_tile (handler, data, x, y);
+        }
+
+      gegl_tile_unlock (tile);
+
+      g_mutex_lock (&handler->mutex);
+
+      handler->state[index] = XCF_TILE_LOADED;
+      g_atomic_int_add (&handler->n_pending, -1);
+
+      g_cond_broadcast (&handler->cond);
+    }
+
+  g_mutex_unlock (&handler->mutex);
+
+  if (g_atomic_int_get (&handler->n_pending) == 0)
+    xcf_tile_handler_complete (handler);
+
+  return tile;
+}
+
+static void
+xcf_tile_handler_mark (XcfTileHandler *handler,
+                       gint            x,
+                       gint            y)
+{
+  gint index;
+
+  if (x < 0 || x >= handler->n_tile_cols ||
+      y < 0 || y >= handler->n_tile_rows)
+    return;
+
+  index = y * handler->n_tile_cols + x;
+
+  g_mutex_lock (&handler->mutex);
+
+  while (handler->state[index] == XCF_TILE_DECODING)
+    g_cond_wait (&handler->cond, &handler->mutex);
+
+  if (handler->state[index] != XCF_TILE_LOADED)
+    {
+      g_clear_pointer (&handler->decoded[index], g_free);
+
+      handler->state[index] = XCF_TILE_LOADED;
+      g_atomic_int_add (&handler->n_pending, -1);
+    }
+
+  g_mutex_unlock (&handler->mutex);
+
+  if (g_atomic_int_get (&handler->n_pending) == 0)
+    xcf_tile_handler_complete (handler);
+}
+
+/*  buffers are mostly read in tile order, so the pending tiles after
+ *  index are queued for decoding on the other threads, a few per
+ *  thread, while the caller decodes the tile it asked for
+ */
+static void
+xcf_tile_handler_prefetch (XcfTileHandler *handler,
+                           gint            index)
+{
+  static GThreadPool *pool = NULL;
+  gint                n_threads;
+  gint                n_tiles;
+  gint                n_ahead = 0;
+  gint                i;
+
+  n_threads = gimp_parallel_get_n_threads ();
+
+  if (n_threads < 2)
+    return;
+
+  if (g_once_init_enter (&pool))
+    {
+      GThreadPool *new_pool;
+
+      new_pool = g_thread_pool_new ((GFunc) xcf_tile_handler_decode,
+                                    NULL, n_threads - 1, FALSE, NULL);
+
+      g_once_init_leave (&pool, new_pool);
+    }
+
+  n_tiles = handler->n_tile_cols * handler->n_tile_rows;
+
+  g_mutex_lock (&handler->mutex);
+
+  for (i = index + 1;
+       i < n_tiles && i <= index + XCF_READ_AHEAD_SCAN &&
+       n_ahead < 2 * n_threads;
+       i++)
+    {
+      switch (handler->state[i])
+        {
+        case XCF_TILE_PENDING:
+          {
+            XcfTileJob *job = g_slice_new (XcfTileJob);
+
+            job->handler = g_object_ref (handler);
+            job->index   = i;
+
+            handler->state[i] = XCF_TILE_QUEUED;
+
+            g_thread_pool_push (pool, job, NULL);
+          }
+          /*  fall through  */
+
+        case XCF_TILE_QUEUED:
+        case XCF_TILE_DECODING:
+        case XCF_TILE_DECODED:
+          n_ahead++;
+          break;
+
+        default:
+          break;
+        }
+    }
+
+  g_mutex_unlock (&handler->mutex);
+}
+
+static void
+xcf_tile_handler_decode (XcfTileJob *job,
+                         gpointer    data)
+{
+  XcfTileHandler *handler = job->handler;
+  gint            index   = job->index;
+
+  g_mutex_lock (&handler->mutex);
+
+  /*  the tile may have been fetched or overwritten meanwhile  */
+  if (handler->state[index] == XCF_TILE_QUEUED)
+    {
+      guchar *decoded;
+
+      handler->state[index] = XCF_TILE_DECODING;
+
+      g_mutex_unlock (&handler->mutex);
+
+      decoded = g_malloc0 (handler->tile_width * handler->tile_height *
+                           handler->bpp);
+
+      xcf_tile_handler_load_tile (handler, decoded,
+                                  index % handler->n_tile_cols,
+                                  index / handler->n_tile_cols);
+
+      g_mutex_lock (&handler->mutex);
+
+      handler->decoded[index] = decoded;
+      handler->state[index]   = XCF_TILE_DECODED;
+
+      g_cond_broadcast (&handler->cond);
+    }
+
+  g_mutex_unlock (&handler->mutex);
+
+  g_object_unref (handler);
+
+  g_slice_free (XcfTileJob, job);
+}
+
+/*  decodes all XCF tiles overlapping the buffer tile at x, y  */
+static void
+xcf_tile_handler_load_tile (XcfTileHandler *handler,
+                            guchar         *dest,
+                            gint            x,
+                            gint            y)
+{
+  GeglRectangle  tile_rect;
+  guchar        *xcf_tile;
+  guchar        *read_buf      = NULL;
+  gsize          read_buf_size = 0;
+  gint           n_xcf_cols;
+  gint           dest_stride;
+  gint           col, row;
+
+  if (! gegl_rectangle_intersect (&tile_rect,
+                                  GEGL_RECTANGLE (x * handler->tile_width,
+                                                  y * handler->tile_height,
+                                                  handler->tile_width,
+                                                  handler->tile_height),
+                                  GEGL_RECTANGLE (0, 0,
+                                                  handler->width,
+                                                  handler->height)))
+    return;
+
+  n_xcf_cols  = (handler->width + XCF_TILE_WIDTH - 1) / XCF_TILE_WIDTH;
+  dest_stride = handler->tile_width * handler->bpp;
+
+  /*  tiles are decoded on several threads at once, so each call
+   *  has its own scratch buffers
+   */
+  xcf_tile = g_malloc (XCF_TILE_WIDTH * XCF_TILE_HEIGHT * handler->bpp);
+
+  for (row = tile_rect.y / XCF_TILE_HEIGHT;
+       row <= (tile_rect.y + tile_rect.height - 1) / XCF_TILE_HEIGHT;
+       row++)
+    {
+      for (col = tile_rect.x / XCF_TILE_WIDTH;
+           col <= (tile_rect.x + tile_rect.width - 1) / XCF_TILE_WIDTH;
+           col++)
+        {
+          GeglRectangle xcf_rect;
+          GeglRectangle rect;
+          gint          i = row * n_xcf_cols + col;
+          gint          xcf_stride;
+          gint          r;
+
+          xcf_rect.x      = col * XCF_TILE_WIDTH;
+          xcf_rect.y      = row * XCF_TILE_HEIGHT;
+          xcf_rect.width  = MIN (XCF_TILE_WIDTH,  handler->width  - xcf_rect.x);
+          xcf_rect.height = MIN (XCF_TILE_HEIGHT, handler->height - xcf_rect.y);
+
+          if (i >= handler->n_xcf_tiles ||
+              ! xcf_tile_handler_read (handler, i,
+                                       xcf_rect.width * xcf_rect.height,
+                                       xcf_tile, &read_buf, &read_buf_size))
+            {
+              g_warning ("%s: could not read tile %d of '%s'",
+                         G_STRFUNC, i,
+                         gimp_filename_to_utf8 (handler->file->filename));
+              continue;
+            }
+
+          gegl_rectangle_intersect (&rect, &xcf_rect, &tile_rect);
+
+          xcf_stride = xcf_rect.width * handler->bpp;
+
+          for (r = 0; r < rect.height; r++)
+            {
+              memcpy (dest +
+                      (rect.y - y * handler->tile_height + r) * dest_stride +
+                      (rect.x - x * handler->tile_width) * handler->bpp,
+                      xcf_tile +
+                      (rect.y - xcf_rect.y + r) * xcf_stride +
+                      (rect.x - xcf_rect.x) * handler->bpp,
+                      rect.width * handler->bpp);
+            }
+        }
+    }
+
+  g_free (xcf_tile);
+  g_free (read_buf);
+}
+
+/*  reads and decodes XCF tile i into xcf_tile  */
+static gboolean
+xcf_tile_handler_read (XcfTileHandler  *handler,
+                       gint             i,
+                       gint             n_pixels,
+                       guchar          *xcf_tile,
+                       guchar         **read_buf,
+                       gsize           *read_buf_size)
+{
+  XcfTileFile  *file   = handler->file;
+  goffset       offset = handler->offsets[i];
+  gsize         length = MAX (handler->lengths[i], 0);
+  const guchar *src;
+
+  /*  workaround for bug #357809, see xcf_load_level()  */
+  if (length == 0)
+    {
+      memset (xcf_tile, 0, n_pixels * handler->bpp);
+
+      return TRUE;
+    }
+
+  if (length > *read_buf_size)
+    {
+      *read_buf      = g_realloc (*read_buf, length);
+      *read_buf_size = length;
+    }
+
+  g_mutex_lock (&file->fp_mutex);
+
+  /*  another program may have rewritten the file meanwhile  */
+  if (! xcf_tile_file_unchanged (file))
+    length = 0;
+
+  /*  we have to use fread instead of xcf_read_* because we may be
+   *  reading past the end of the file here, the length of the last
+   *  tile is only an estimate
+   */
+  else if (fseeko (file->fp, offset, SEEK_SET) == 0)
+    length = fread (*read_buf, 1, length, file->fp);
+  else
+    length = 0;
+
+  g_mutex_unlock (&file->fp_mutex);
+
+  if (length == 0)
+    return FALSE;
+
+  src = *read_buf;
+
+  return xcf_tile_decode (handler->compression, src, length,
+                          xcf_tile, n_pixels, handler->bpp);
+}
+
+/*  once all tiles are read, the handler is a no-op and the file
+ *  isn't needed any longer
+ */
+static void
+xcf_tile_handler_complete (XcfTileHandler *handler)
+{
+  XcfTileFile *file;
+
+  g_mutex_lock (&pending_mutex);
+
+  if (! g_list_find (pending_handlers, handler))
+    {
+      g_mutex_unlock (&pending_mutex);
+
+      return;
+    }
+
+  pending_handlers = g_list_remove (pending_handlers, handler);
+
+  g_mutex_unlock (&pending_mutex);
+
+  g_mutex_lock (&handler->mutex);
+
+  file = handler->file;
+  handler->file = NULL;
+
+  g_clear_pointer (&handler->offsets, g_free);
+  g_clear_pointer (&handler->lengths, g_free);
+
+  g_mutex_unlock (&handler->mutex);
+
+  xcf_tile_file_unref (file);
+}
+
+
+/*  public functions  */
+
+XcfTileFile *
+xcf_tile_file_new (const gchar *filename)
+{
+  XcfTileFile *file;
+
+  g_return_val_if_fail (filename != NULL, NULL);
+
+  file = g_slice_new0 (XcfTileFile);
+
+  file->ref_count = 1;
+  file->filename  = g_strdup (filename);
+
+  g_mutex_init (&file->fp_mutex);
+
+  if (g_stat (filename, &file->stat) != 0)
+    memset (&file->stat, 0, sizeof (file->stat));
+
+  file->fp = g_fopen (filename, "rb");
+
+  if (! file->fp)
+    {
+      xcf_tile_file_unref (file);
+
+      return NULL;
+    }
+
+  return file;
+}
+
+XcfTileFile *
+xcf_tile_file_ref (XcfTileFile *file)
+{
+  g_return_val_if_fail (file != NULL, NULL);
+
+  g_atomic_int_inc (&file->ref_count);
+
+  return file;
+}
+
+void
+xcf_tile_file_unref (XcfTileFile *file)
+{
+  g_return_if_fail (file != NULL);
+
+  if (g_atomic_int_dec_and_test (&file->ref_count))
+    {
+      if (file->fp)
+        fclose (file->fp);
+
+      g_mutex_clear (&file->fp_mutex);
+
+      g_free (file->filename);
+
+      g_slice_free (XcfTileFile, file);
+    }
+}
+
+GeglTileHandler *
+xcf_tile_handler_new (XcfTileFile        *file,
+                      XcfCompressionType  compression,
+                      const Babl         *format,
+                      gint                width,
+                      gint                height,
+                      gint                n_xcf_tiles,
+                      const goffset      *offsets,
+                      const gint         *lengths)
+{
+  XcfTileHandler *handler;
+
+  g_return_val_if_fail (file != NULL, NULL);
+  g_return_val_if_fail (format != NULL, NULL);
+  g_return_val_if_fail (n_xcf_tiles > 0, NULL);
+  g_return_val_if_fail (offsets != NULL, NULL);
+  g_return_val_if_fail (lengths != NULL, NULL);
+
+  handler = g_object_new (XCF_TYPE_TILE_HANDLER, NULL);
+
+  handler->file        = xcf_tile_file_ref (file);
+  handler->compression = compression;
+  handler->format      = format;
+  handler->bpp         = babl_format_get_bytes_per_pixel (format);
+  handler->width       = width;
+  handler->height      = height;
+
+  handler->n_xcf_tiles = n_xcf_tiles;
+  handler->offsets     = g_memdup (offsets, n_xcf_tiles * sizeof (goffset));
+  handler->lengths     = g_memdup (lengths, n_xcf_tiles * sizeof (gint));
+
+  return GEGL_TILE_HANDLER (handler);
+}
+
+/*  adds the handler to a new, empty buffer, which keeps the handler
+ *  alive from then on
+ */
+void
+xcf_tile_handler_attach (XcfTileHandler *handler,
+                         GeglBuffer     *buffer)
+{
+  g_return_if_fail (XCF_IS_TILE_HANDLER (handler));
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+  g_return_if_fail (handler->buffer == NULL);
+
+  handler->buffer = buffer;
+  g_object_add_weak_pointer (G_OBJECT (buffer), (gpointer) &handler->buffer);
+
+  g_object_get (buffer,
+                "tile-width",  &handler->tile_width,
+                "tile-height", &handler->tile_height,
+                NULL);
+
+  handler->n_tile_cols = ((handler->width + handler->tile_width - 1) /
+                          handler->tile_width);
+  handler->n_tile_rows = ((handler->height + handler->tile_height - 1) /
+                          handler->tile_height);
+
+  handler->n_pending = handler->n_tile_cols * handler->n_tile_rows;
+  handler->state     = g_new0 (guchar, handler->n_pending);
+  handler->decoded   = g_new0 (guchar *, handler->n_pending);
+
+  gegl_buffer_add_handler (buffer, handler);
+
+  g_object_set_data_full (G_OBJECT (buffer), "xcf-tile-handler",
+                          handler, (GDestroyNotify) g_object_unref);
+
+  g_mutex_lock (&pending_mutex);
+  pending_handlers = g_list_prepend (pending_handlers, handler);
+  g_mutex_unlock (&pending_mutex);
+}
+
+/*  reads all tiles which are still in the file called filename,
+ *  this must be done before the file is overwritten
+ */
+void
+xcf_tile_handler_load_all (const gchar *filename)
+{
+  GStatBuf  stat;
+  GList    *handlers = NULL;
+  GList    *list;
+
+  g_return_if_fail (filename != NULL);
+
+  if (g_stat (filename, &stat) != 0)
+    memset (&stat, 0, sizeof (stat));
+
+  g_mutex_lock (&pending_mutex);
+
+  for (list = pending_handlers; list; list = g_list_next (list))
+    {
+      XcfTileHandler *handler = list->data;
+
+      if (handler->buffer &&
+          xcf_tile_file_matches (handler->file, filename, &stat))
+        {
+          handlers = g_list_prepend (handlers, g_object_ref (handler->buffer));
+        }
+    }
+
+  g_mutex_unlock (&pending_mutex);
+
+  for (list = handlers; list; list = g_list_next (list))
+    {
+      GeglBuffer     *buffer  = list->data;
+      XcfTileHandler *handler = g_object_get_data (G_OBJECT (buffer),
+                                                   "xcf-tile-handler");
+      guchar         *data;
+      gint            x, y;
+
+      if (! handler)
+        {
+          g_object_unref (buffer);
+          continue;
+        }
+
+      data = g_malloc (handler->tile_width * handler->tile_height *
+                       handler->bpp);
+
+      /*  reading a tile through the buffer stores it in the buffer's
+       *  own tile storage
+       */
+      for (y = 0; y < handler->n_tile_rows; y++)
+        for (x = 0; x < handler->n_tile_cols; x++)
+          {
+            GeglRectangle rect;
+
+            if (g_atomic_int_get (&handler->n_pending) == 0)
+              break;
+
+            if (handler->state[y * handler->n_tile_cols + x] ==
+                XCF_TILE_LOADED)
+              continue;
+
+            gegl_rectangle_intersect (&rect,
+                                      GEGL_RECTANGLE (x * handler->tile_width,
+                                                      y * handler->tile_height,
+                                                      handler->tile_width,
+                                                      handler->tile_height),
+                                      GEGL_RECTANGLE (0, 0,
+                                                      handler->width,
+                                                      handler->height));
+
+            gegl_buffer_get (buffer, &rect, 1.0, handler->format, data,
+                             GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+          }
+
+      g_free (data);
+
+      g_object_unref (buffer);
+    }
+
+  g_list_free (handlers);
+}
+
+gboolean
+xcf_tile_decode (XcfCompressionType  compression,
+                 const guchar       *src,
+                 gsize               src_length,
+                 guchar             *dest,
+                 gint                n_pixels,
+                 gint                bpp)
+{
+  g_return_val_if_fail (src != NULL, FALSE);
+  g_return_val_if_fail (dest != NULL, FALSE);
+
+  switch (compression)
+    {
+    case COMPRESS_NONE:
+      if (src_length < (gsize) n_pixels * bpp)
+        return FALSE;
+
+      memcpy (dest, src, n_pixels * bpp);
+      return TRUE;
+
+    case COMPRESS_RLE:
+      return xcf_tile_decode_rle (src, src_length, dest, n_pixels, bpp);
+
+    case COMPRESS_ZLIB:
+      return xcf_tile_decode_zlib (src, src_length, dest, n_pixels, bpp);
+
+    case COMPRESS_FRACTAL:
+      break;
+    }
+
+  return FALSE;
+}
+
+/*  records the tiles of buffer as stored at offsets with lengths,
+ *  the record keeps buffer alive until it is attached
+ */
+XcfTileRecord *
+xcf_tile_record_new (GeglBuffer         *buffer,
+                     XcfCompressionType  compression,
+                     gint                n_xcf_tiles,
+                     const goffset      *offsets,
+                     const gint         *lengths)
+{
+  XcfTileRecord *record;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+  g_return_val_if_fail (n_xcf_tiles > 0, NULL);
+  g_return_val_if_fail (offsets != NULL, NULL);
+  g_return_val_if_fail (lengths != NULL, NULL);
+
+  record = g_slice_new0 (XcfTileRecord);
+
+  record->buffer      = g_object_ref (buffer);
+  record->compression = compression;
+  record->format      = gegl_buffer_get_format (buffer);
+  record->width       = gegl_buffer_get_width (buffer);
+  record->height      = gegl_buffer_get_height (buffer);
+
+  record->n_xcf_tiles = n_xcf_tiles;
+  record->offsets     = g_memdup (offsets, n_xcf_tiles * sizeof (goffset));
+  record->lengths     = g_memdup (lengths, n_xcf_tiles * sizeof (gint));
+
+  return record;
+}
+
+/*  hands the record over to its buffer, replacing the buffer's
+ *  previous record, once the tiles are in file
+ */
+void
+xcf_tile_record_attach (XcfTileRecord *record,
+                        XcfTileFile   *file)
+{
+  GeglBuffer *buffer;
+
+  g_return_if_fail (record != NULL);
+  g_return_if_fail (record->file == NULL);
+  g_return_if_fail (file != NULL);
+
+  buffer = record->buffer;
+
+  record->file = xcf_tile_file_ref (file);
+
+  record->changed_id =
+    gegl_buffer_signal_connect (buffer, "changed",
+                                G_CALLBACK (xcf_tile_record_changed),
+                                record);
+
+  g_object_set_data_full (G_OBJECT (buffer), "xcf-tile-record",
+                          record, (GDestroyNotify) xcf_tile_record_free);
+
+  tile_records = g_list_prepend (tile_records, record);
+
+  /*  the buffer owns the record now  */
+  g_object_unref (buffer);
+}
+
+void
+xcf_tile_record_free (XcfTileRecord *record)
+{
+  g_return_if_fail (record != NULL);
+
+  if (record->file)
+    {
+      /*  the handler is already gone if the buffer is being finalized  */
+      if (g_signal_handler_is_connected (record->buffer, record->changed_id))
+        g_signal_handler_disconnect (record->buffer, record->changed_id);
+
+      tile_records = g_list_remove (tile_records, record);
+
+      xcf_tile_file_unref (record->file);
+    }
+  else
+    {
+      g_object_unref (record->buffer);
+    }
+
+  g_free (record->offsets);
+  g_free (record->lengths);
+
+  g_slice_free (XcfTileRecord, record);
+}
+
+GeglBuffer *
+xcf_tile_record_buffer (XcfTileRecord *record)
+{
+  g_return_val_if_fail (record != NULL, NULL);
+
+  return record->buffer;
+}
+
+/*  moves a record which isn't attached yet over to buffer, which
+ *  must have the same contents as the record's buffer
+ */
+void
+xcf_tile_record_move (XcfTileRecord *record,
+                      GeglBuffer    *buffer)
+{
+  g_return_if_fail (record != NULL);
+  g_return_if_fail (record->file == NULL);
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+  g_return_if_fail (gegl_buffer_get_format (buffer) == record->format);
+
+  g_object_ref (buffer);
+  g_object_unref (record->buffer);
+
+  record->buffer = buffer;
+}
+
+/*  gives copy, a copy of buffer, a record of its own with the tiles
+ *  of buffer's record, if buffer has a clean one
+ */
+void
+xcf_tile_record_share (GeglBuffer *buffer,
+                       GeglBuffer *copy)
+{
+  XcfTileRecord *record;
+  XcfTileRecord *copy_record;
+
+  g_return_if_fail (GEGL_IS_BUFFER (buffer));
+  g_return_if_fail (GEGL_IS_BUFFER (copy));
+
+  record = g_object_get_data (G_OBJECT (buffer), "xcf-tile-record");
+
+  if (! record || ! xcf_tile_record_get (buffer, record->compression))
+    return;
+
+  if (gegl_buffer_get_format (copy) != record->format ||
+      gegl_buffer_get_width (copy)  != record->width  ||
+      gegl_buffer_get_height (copy) != record->height)
+    return;
+
+  copy_record = xcf_tile_record_new (copy, record->compression,
+                                     record->n_xcf_tiles,
+                                     record->offsets, record->lengths);
+
+  xcf_tile_record_attach (copy_record, record->file);
+}
+
+/*  returns the record of buffer if the buffer and its file didn't
+ *  change since, and the tiles are compressed with compression
+ */
+XcfTileRecord *
+xcf_tile_record_get (GeglBuffer         *buffer,
+                     XcfCompressionType  compression)
+{
+  XcfTileRecord *record;
+
+  g_return_val_if_fail (GEGL_IS_BUFFER (buffer), NULL);
+
+  record = g_object_get_data (G_OBJECT (buffer), "xcf-tile-record");
+
+  if (record                                                &&
+      ! g_atomic_int_get (&record->dirty)                   &&
+      record->compression == compression                    &&
+      record->format      == gegl_buffer_get_format (buffer) &&
+      record->width       == gegl_buffer_get_width (buffer)  &&
+      record->height      == gegl_buffer_get_height (buffer) &&
+      xcf_tile_file_unchanged (record->file))
+    {
+      return record;
+    }
+
+  return NULL;
+}
+
+/*  copies the encoded XCF tile i to dest, which can be called from
+ *  any thread
+ */
+gboolean
+xcf_tile_record_read (XcfTileRecord *record,
+                      gint           i,
+                      guchar        *dest,
+                      gsize          max_length,
+                      gsize         *length)
+{
+  XcfTileFile *file;
+  goffset      offset;
+  gsize        n_bytes;
+  gboolean     success;
+
+  g_return_val_if_fail (record != NULL, FALSE);
+  g_return_val_if_fail (i >= 0 && i < record->n_xcf_tiles, FALSE);
+  g_return_val_if_fail (dest != NULL, FALSE);
+  g_return_val_if_fail (length != NULL, FALSE);
+
+  file    = record->file;
+  offset  = record->offsets[i];
+  n_bytes = record->lengths[i];
+
+  /*  the last tile's length isn't known for loaded files  */
+  if (record->lengths[i] < 0 || n_bytes > max_length)
+    return FALSE;
+
+  g_mutex_lock (&file->fp_mutex);
+
+  success = (fseeko (file->fp, offset, SEEK_SET) == 0 &&
+             fread (dest, 1, n_bytes, file->fp) == n_bytes);
+
+  g_mutex_unlock (&file->fp_mutex);
+
+  if (success)
+    *length = n_bytes;
+
+  return success;
+}
+
+/*  whether a clean record has its tiles in the file called filename  */
+gboolean
+xcf_tile_records_use_file (const gchar *filename)
+{
+  GStatBuf  stat;
+  GList    *list;
+
+  g_return_val_if_fail (filename != NULL, FALSE);
+
+  if (g_stat (filename, &stat) != 0)
+    return FALSE;
+
+  for (list = tile_records; list; list = g_list_next (list))
+    {
+      XcfTileRecord *record = list->data;
+
+      if (! g_atomic_int_get (&record->dirty) &&
+          xcf_tile_file_matches (record->file, filename, &stat))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+/*  marks the records with tiles in filename dirty, this must be done
+ *  before the file is overwritten in place
+ */
+void
+xcf_tile_records_forget_file (const gchar *filename)
+{
+  GStatBuf  stat;
+  GList    *list;
+
+  g_return_if_fail (filename != NULL);
+
+  if (g_stat (filename, &stat) != 0)
+    return;
+
+  for (list = tile_records; list; list = g_list_next (list))
+    {
+      XcfTileRecord *record = list->data;
+
+      if (xcf_tile_file_matches (record->file, filename, &stat))
+        g_atomic_int_set (&record->dirty, TRUE);
+    }
+}
+
+
+/*  private functions  */
+
+static gboolean
+xcf_tile_file_matches (XcfTileFile    *file,
+                       const gchar    *filename,
+                       const GStatBuf *stat)
+{
+  if (file->stat.st_ino != 0 && stat->st_ino != 0)
+    return (file->stat.st_dev == stat->st_dev &&
+            file->stat.st_ino == stat->st_ino);
+
+  return ! strcmp (file->filename, filename);
+}
+
+/*  a file which was replaced by renaming another file over it still
+ *  has its old contents, but one which was rewritten in place doesn't
+ */
+static gboolean
+xcf_tile_file_unchanged (XcfTileFile *file)
+{
+  GStatBuf stat;
+
+  if (g_stat (file->filename, &stat) != 0 ||
+      ! xcf_tile_file_matches (file, file->filename, &stat))
+    return file->stat.st_ino != 0;
+
+  return (stat.st_size  == file->stat.st_size &&
+          stat.st_mtime == file->stat.st_mtime);
+}
+
+static void
+xcf_tile_record_changed (GeglBuffer          *buffer,
+                         const GeglRectangle *rect,
+                         XcfTileRecord       *record)
+{
+  /*  buffers can change on any thread  */
+  g_atomic_int_set (&record->dirty, TRUE);
+}
+
+static gboolean
+xcf_tile_decode_rle (const guchar *src,
+                     gsize         src_length,
+                     guchar       *dest,
+                     gint          n_pixels,
+                     gint          bpp)
+{
+  const guchar *xcfdata      = src;
+  const guchar *xcfdatalimit = &src[src_length - 1];
+  gint          i;
+
+  for (i = 0; i < bpp; i++)
+    {
+      guchar *data  = dest + i;
+      gint    size  = n_pixels;
+      guchar  val;
+      gint    length;
+      gint    j;
+
+      while (size > 0)
+        {
+          if (xcfdata > xcfdatalimit)
+            return FALSE;
+
+          val = *xcfdata++;
+
+          length = val;
+          if (length >= 128)
+            {
+              length = 255 - (length - 1);
+              if (length == 128)
+                {
+                  if (xcfdata >= xcfdatalimit)
+                    return FALSE;
+
+                  length = (*xcfdata << 8) + xcfdata[1];
+                  xcfdata += 2;
+                }
+
+              size -= length;
+
+              if (size < 0)
+                return FALSE;
+
+              if (&xcfdata[length - 1] > xcfdatalimit)
+                return FALSE;
+
+              while (length-- > 0)
+                {
+                  *data = *xcfdata++;
+                  data += bpp;
+                }
+            }
+          else
+            {
+              length += 1;
+              if (length == 128)
+                {
+                  if (xcfdata >= xcfdatalimit)
+                    return FALSE;
+
+                  length = (*xcfdata << 8) + xcfdata[1];
+                  xcfdata += 2;
+                }
+
+              size -= length;
+
+              if (size < 0)
+                return FALSE;
+
+              if (xcfdata > xcfdatalimit)
+                return FALSE;
+
+              val = *xcfdata++;
+
+              for (j = 0; j < length; j++)
+                {
+                  *data = val;
+                  data += bpp;
+                }
+            }
+        }
+    }
+
+  return TRUE;
+}
+
+static gboolean
+xcf_tile_decode_zlib (const guchar *src,
+                      gsize         src_length,
+                      guchar       *dest,
+                      gint          n_pixels,
+                      gint          bpp)
+{
+  gsize             tile_size = n_pixels * bpp;
+  GConverter       *converter;
+  GConverterResult  result;
+  gsize             n_read    = 0;
+  gsize             n_written = 0;
+
+  converter = G_CONVERTER (g_zlib_decompressor_new (G_ZLIB_COMPRESSOR_FORMAT_ZLIB));
+
+  do
+    {
+      gsize bytes_read;
+      gsize bytes_written;
+
+      result = g_converter_convert (converter,
+                                    src + n_read,
+                                    src_length - n_read,
+                                    dest + n_written,
+                                    tile_size - n_written,
+                                    G_CONVERTER_INPUT_AT_END,
+                                    &bytes_read, &bytes_written, NULL);
+
+      n_read    += bytes_read;
+      n_written += bytes_written;
+    }
+  while (result == G_CONVERTER_CONVERTED);
+
+  g_object_unref (converter);
+
+  return (result == G_CONVERTER_FINISHED && n_written == tile_size);
+}
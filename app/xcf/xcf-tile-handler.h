@@ -0,0 +1,139 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __XCF_TILE_HANDLER_H__
+#define __XCF_TILE_HANDLER_H__
+
+#include <gegl-buffer-backend.h>
+
+/***
+ * XcfTileHandler is a GeglTileHandler that reads and decodes the
+ * tiles of a drawable from an XCF file the first time they are
+ * accessed.
+ *
+ * An XcfTileRecord remembers where the tiles of a buffer are stored
+ * in an XCF file, until the buffer changes, so saving the buffer
+ * again can copy the encoded tiles instead of encoding them.
+ */
+
+G_BEGIN_DECLS
+
+#define XCF_TYPE_TILE_HANDLER            (xcf_tile_handler_get_type ())
+#define XCF_TILE_HANDLER(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), XCF_TYPE_TILE_HANDLER, XcfTileHandler))
+#define XCF_TILE_HANDLER_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass),  XCF_TYPE_TILE_HANDLER, XcfTileHandlerClass))
+#define XCF_IS_TILE_HANDLER(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), XCF_TYPE_TILE_HANDLER))
+#define XCF_IS_TILE_HANDLER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass),  XCF_TYPE_TILE_HANDLER))
+#define XCF_TILE_HANDLER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj),  XCF_TYPE_TILE_HANDLER, XcfTileHandlerClass))
+
+
+typedef struct _XcfTileHandler      XcfTileHandler;
+typedef struct _XcfTileHandlerClass XcfTileHandlerClass;
+
+struct _XcfTileHandler
+{
+  GeglTileHandler     parent_instance;
+
+  XcfTileFile        *file;
+  XcfCompressionType  compression;
+  const Babl         *format;
+  gint                bpp;
+  gint                width;
+  gint                height;
+
+  /*  the XCF tiles, in file order  */
+  gint                n_xcf_tiles;
+  goffset            *offsets;
+  gint               *lengths;
+
+  /*  the tiles of the buffer we are attached to  */
+  GeglBuffer         *buffer;
+  gint                tile_width;
+  gint                tile_height;
+  gint                n_tile_cols;
+  gint                n_tile_rows;
+  guchar             *state;
+  guchar            **decoded;
+  gint                n_pending;
+
+  /*  tiles are decoded ahead on other threads, cond is signalled
+   *  whenever a tile stops being decoded
+   */
+  GMutex              mutex;
+  GCond               cond;
+};
+
+struct _XcfTileHandlerClass
+{
+  GeglTileHandlerClass  parent_class;
+};
+
+
+XcfTileFile     * xcf_tile_file_new         (const gchar        *filename);
+XcfTileFile     * xcf_tile_file_ref         (XcfTileFile        *file);
+void              xcf_tile_file_unref       (XcfTileFile        *file);
+
+GType             xcf_tile_handler_get_type (void) G_GNUC_CONST;
+GeglTileHandler * xcf_tile_handler_new      (XcfTileFile        *file,
+                                             XcfCompressionType  compression,
+                                             const Babl         *format,
+                                             gint                width,
+                                             gint                height,
+                                             gint                n_xcf_tiles,
+                                             const goffset      *offsets,
+                                             const gint         *lengths);
+
+void              xcf_tile_handler_attach   (XcfTileHandler     *handler,
+                                             GeglBuffer         *buffer);
+
+void              xcf_tile_handler_load_all (const gchar        *filename);
+
+XcfTileRecord   * xcf_tile_record_new       (GeglBuffer         *buffer,
+                                             XcfCompressionType  compression,
+                                             gint                n_xcf_tiles,
+                                             const goffset      *offsets,
+                                             const gint         *lengths);
+void              xcf_tile_record_attach    (XcfTileRecord      *record,
+                                             XcfTileFile        *file);
+void              xcf_tile_record_free      (XcfTileRecord      *record);
+GeglBuffer      * xcf_tile_record_buffer    (XcfTileRecord      *record);
+void              xcf_tile_record_move      (XcfTileRecord      *record,
+                                             GeglBuffer         *buffer);
+void              xcf_tile_record_share     (GeglBuffer         *buffer,
+                                             GeglBuffer         *copy);
+
+XcfTileRecord   * xcf_tile_record_get       (GeglBuffer         *buffer,
+                                             XcfCompressionType  compression);
+gboolean          xcf_tile_record_read      (XcfTileRecord      *record,
+                                             gint                i,
+                                             guchar             *dest,
+                                             gsize               max_length,
+                                             gsize              *length);
+
+gboolean          xcf_tile_records_use_file    (const gchar     *filename);
+void              xcf_tile_records_forget_file (const gchar     *filename);
+
+gboolean          xcf_tile_decode           (XcfCompressionType  compression,
+                                             const guchar       *src,
+                                             gsize               src_length,
+                                             guchar             *dest,
+                                             gint                n_pixels,
+                                             gint                bpp);
+
+
+G_END_DECLS
+
+#endif /* __XCF_TILE_HANDLER_H__ */
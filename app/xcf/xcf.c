@@ -20,6 +20,11 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/types.h>
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 #include <gegl.h>
 #include <glib/gstdio.h>
@@ -29,7 +34,12 @@
 #include "core/core-types.h"
 
 #include "core/gimp.h"
+#include "core/gimpchannel.h"
+#include "core/gimpcontainer.h"
 #include "core/gimpimage.h"
+#include "core/gimpimage-duplicate.h"
+#include "core/gimplayer.h"
+#include "core/gimplayermask.h"
 #include "core/gimpparamspecs.h"
 #include "core/gimpprogress.h"
 
@@ -41,6 +51,7 @@
 #include "xcf-load.h"
 #include "xcf-read.h"
 #include "xcf-save.h"
+#include "xcf-tile-handler.h"
 
 #include "gimp-intl.h"
 
@@ -49,19 +60,101 @@ typedef GimpImage * GimpXcfLoaderFunc (Gimp     *gimp,
                                        XcfInfo  *info,
                                        GError  **error);
 
+/*  a buffer of the image being saved, and its copy in the snapshot
+ *  which is saved instead
+ */
+typedef struct _XcfSaveBuffer XcfSaveBuffer;
+
+struct _XcfSaveBuffer
+{
+  GeglBuffer *buffer;
+  GeglBuffer *copy;
+  gulong      changed_id;
+  gint        changed;
+};
+
+typedef struct _XcfSaveData XcfSaveData;
 
-static GimpValueArray * xcf_load_invoker (GimpProcedure         *procedure,
-                                          Gimp                  *gimp,
-                                          GimpContext           *context,
-                                          GimpProgress          *progress,
-                                          const GimpValueArray  *args,
-                                          GError               **error);
-static GimpValueArray * xcf_save_invoker (GimpProcedure         *procedure,
-                                          Gimp                  *gimp,
-                                          GimpContext           *context,
-                                          GimpProgress          *progress,
-                                          const GimpValueArray  *args,
-                                          GError               **error);
+struct _XcfSaveData
+{
+  GimpImage       *image;
+  GimpImage       *snapshot;
+  GList           *buffers;
+  gchar           *filename;
+  gchar           *tmp_filename;
+  XcfInfo          info;
+
+  GimpProgress    *progress;
+  gint             progress_value;
+  guint            progress_id;
+
+  XcfSaveCallback  callback;
+  gpointer         callback_data;
+};
+
+
+static GimpValueArray * xcf_load_invoker          (GimpProcedure         *procedure,
+                                                   Gimp                  *gimp,
+                                                   GimpContext           *context,
+                                                   GimpProgress          *progress,
+                                                   const GimpValueArray  *args,
+                                                   GError               **error);
+static GimpValueArray * xcf_save_invoker          (GimpProcedure         *procedure,
+                                                   Gimp                  *gimp,
+                                                   GimpContext           *context,
+                                                   GimpProgress          *progress,
+                                                   const GimpValueArray  *args,
+                                                   GError               **error);
+
+static FILE           * xcf_save_open             (const gchar           *filename,
+                                                   gboolean               replace,
+                                                   gchar                **tmp_filename,
+                                                   GError               **error);
+#ifndef G_OS_WIN32
+static gchar          * xcf_save_open_tmp         (const gchar           *filename,
+                                                   FILE                 **fp);
+#endif
+static void             xcf_save_info_init        (XcfInfo               *info,
+                                                   Gimp                  *gimp,
+                                                   GimpImage             *image,
+                                                   FILE                  *fp,
+                                                   const gchar           *filename);
+static gboolean         xcf_save_stream           (XcfInfo               *info,
+                                                   GimpImage             *image,
+                                                   GError               **error);
+static gboolean         xcf_save_close            (XcfInfo               *info,
+                                                   const gchar           *tmp_filename,
+                                                   gboolean               success,
+                                                   GError               **error);
+static gboolean         xcf_save_busy             (GimpImage             *image,
+                                                   const gchar           *filename,
+                                                   GError               **error);
+
+static GimpImage      * xcf_save_snapshot         (GimpImage             *image,
+                                                   GList                **buffers);
+static void             xcf_save_snapshot_add     (GimpDrawable          *drawable,
+                                                   GimpDrawable          *copy,
+                                                   GList                **buffers);
+static void             xcf_save_snapshot_changed (GeglBuffer            *buffer,
+                                                   const GeglRectangle   *rect,
+                                                   XcfSaveBuffer         *save_buffer);
+
+static void             xcf_save_async_thread     (GTask                 *task,
+                                                   gpointer               source_object,
+                                                   gpointer               task_data,
+                                                   GCancellable          *cancellable);
+static void             xcf_save_async_callback   (GObject               *source_object,
+                                                   GAsyncResult          *result,
+                                                   gpointer               data);
+static gboolean         xcf_save_async_progress   (XcfSaveData           *save);
+static void             xcf_save_async_free       (XcfSaveData           *save);
+static gboolean         xcf_save_async_exit       (Gimp                  *gimp,
+                                                   gboolean               force,
+                                                   gpointer               data);
+
+
+/*  the XcfSaveData of the images being saved in the background  */
+static GList *xcf_async_saves = NULL;
 
 
 static GimpXcfLoaderFunc * const xcf_loaders[] =
@@ -71,7 +164,9 @@ static GimpXcfLoaderFunc * const xcf_loaders[] =
   xcf_load_image,   /* version 2 */
   xcf_load_image,   /* version 3 */
   xcf_load_image,   /* version 4 */
-  xcf_load_image    /* version 5 */
+  xcf_load_image,   /* version 5 */
+  xcf_load_image,   /* version 6 */
+  xcf_load_image    /* version 7 */
 };
 
 
@@ -222,12 +317,110 @@ xcf_init (Gimp *gimp)
                                                              GIMP_PARAM_READWRITE));
   gimp_plug_in_manager_add_procedure (gimp->plug_in_manager, proc);
   g_object_unref (procedure);
+
+  /*  connected before the GUI's handler, so the images being saved
+   *  are written before any display goes away
+   */
+  g_signal_connect (gimp, "exit",
+                    G_CALLBACK (xcf_save_async_exit),
+                    NULL);
 }
 
 void
 xcf_exit (Gimp *gimp)
 {
   g_return_if_fail (GIMP_IS_GIMP (gimp));
+
+  g_signal_handlers_disconnect_by_func (gimp, xcf_save_async_exit, NULL);
+}
+
+/**
+ * xcf_save_image_async:
+ * @image:    the image to save
+ * @filename: the file to save @image to
+ * @progress: the progress to show the save on, or %NULL
+ * @callback: called on the main thread when the save is done
+ * @data:     data to pass to @callback
+ * @error:    return location for an error
+ *
+ * Saves a snapshot of @image as XCF file from another thread. The
+ * snapshot shares the tiles of @image, so taking it is cheap, and
+ * @image can be edited while the snapshot is written. The new file
+ * is written next to @filename and renamed over it, so @filename
+ * stays intact until the save succeeded.
+ *
+ * Return value: %TRUE if the save was started, @callback is only
+ *               called in that case.
+ **/
+gboolean
+xcf_save_image_async (GimpImage        *image,
+                      const gchar      *filename,
+                      GimpProgress     *progress,
+                      XcfSaveCallback   callback,
+                      gpointer          data,
+                      GError          **error)
+{
+  XcfSaveData *save;
+  GTask       *task;
+  FILE        *fp;
+  gchar       *tmp_filename;
+
+  g_return_val_if_fail (GIMP_IS_IMAGE (image), FALSE);
+  g_return_val_if_fail (filename != NULL, FALSE);
+  g_return_val_if_fail (progress == NULL || GIMP_IS_PROGRESS (progress),
+                        FALSE);
+  g_return_val_if_fail (callback != NULL, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (xcf_save_busy (image, filename, error))
+    return FALSE;
+
+  fp = xcf_save_open (filename, TRUE, &tmp_filename, error);
+
+  if (! fp)
+    return FALSE;
+
+  save = g_slice_new0 (XcfSaveData);
+
+  save->image         = g_object_ref (image);
+  save->snapshot      = xcf_save_snapshot (image, &save->buffers);
+  save->filename      = g_strdup (filename);
+  save->tmp_filename  = tmp_filename;
+  save->callback      = callback;
+  save->callback_data = data;
+
+  xcf_save_info_init (&save->info, image->gimp, save->snapshot, fp,
+                      save->filename);
+
+  save->info.async_progress = &save->progress_value;
+
+  if (progress)
+    {
+      gchar *name = g_filename_display_name (filename);
+      gchar *msg  = g_strdup_printf (_("Saving '%s'"), name);
+
+      /*  don't take over a progress which is already in use  */
+      if (gimp_progress_start (progress, msg, FALSE))
+        {
+          save->progress    = g_object_ref (progress);
+          save->progress_id =
+            g_timeout_add (100, (GSourceFunc) xcf_save_async_progress, save);
+        }
+
+      g_free (msg);
+      g_free (name);
+    }
+
+  xcf_async_saves = g_list_prepend (xcf_async_saves, save);
+
+  task = g_task_new (NULL, NULL, xcf_save_async_callback, NULL);
+
+  g_task_set_task_data (task, save, NULL);
+  g_task_run_in_thread (task, xcf_save_async_thread);
+
+  g_object_unref (task);
+
+  return TRUE;
 }
 
 static GimpValueArray *
@@ -255,6 +448,7 @@ xcf_load_invoker (GimpProcedure         *procedure,
     {
       info.gimp                  = gimp;
       info.progress              = progress;
+      info.async_progress        = NULL;
       info.cp                    = 0;
       info.filename              = filename;
       info.tattoo_state          = 0;
@@ -266,6 +460,8 @@ xcf_load_invoker (GimpProcedure         *procedure,
       info.swap_num              = 0;
       info.ref_count             = NULL;
       info.compression           = COMPRESS_NONE;
+      info.tile_file             = xcf_tile_file_new (filename);
+      info.tile_records          = NULL;
 
       if (progress)
         {
@@ -282,7 +478,7 @@ xcf_load_invoker (GimpProcedure         *procedure,
 
       info.cp += xcf_read_int8 (info.fp, (guint8 *) id, 14);
 
-      if (! g_str_has_prefix (id, "gimp xcf "))
+      if (! info.tile_file || ! g_str_has_prefix (id, "gimp xcf "))
         {
           success = FALSE;
         }
@@ -301,6 +497,9 @@ xcf_load_invoker (GimpProcedure         *procedure,
 
       if (success)
         {
+          /* version 7 and newer use 64 bit offsets */
+          info.bytes_per_offset = (info.file_version >= 7) ? 8 : 4;
+
           if (info.file_version >= 0 &&
               info.file_version < G_N_ELEMENTS (xcf_loaders))
             {
@@ -308,6 +507,10 @@ xcf_load_invoker (GimpProcedure         *procedure,
 
               if (! image)
                 success = FALSE;
+              else
+                gimp_image_set_xcf_compression (image,
+                                                info.compression ==
+                                                COMPRESS_ZLIB);
             }
           else
             {
@@ -320,6 +523,10 @@ xcf_load_invoker (GimpProcedure         *procedure,
 
       fclose (info.fp);
 
+      /* the loaded drawables keep their own references */
+      if (info.tile_file)
+        xcf_tile_file_unref (info.tile_file);
+
       if (progress)
         gimp_progress_end (progress);
     }
@@ -355,29 +562,23 @@ xcf_save_invoker (GimpProcedure         *procedure,
   GimpValueArray *return_vals;
   GimpImage      *image;
   const gchar    *filename;
-  gboolean        success = FALSE;
+  gchar          *tmp_filename = NULL;
+  FILE           *fp           = NULL;
+  gboolean        success      = FALSE;
 
   gimp_set_busy (gimp);
 
   image    = gimp_value_get_image (gimp_value_array_index (args, 1), gimp);
   filename = g_value_get_string (gimp_value_array_index (args, 3));
 
-  info.fp = g_fopen (filename, "wb");
+  if (! xcf_save_busy (image, filename, error))
+    fp = xcf_save_open (filename, FALSE, &tmp_filename, error);
 
-  if (info.fp)
+  if (fp)
     {
-      info.gimp                  = gimp;
-      info.progress              = progress;
-      info.cp                    = 0;
-      info.filename              = filename;
-      info.active_layer          = NULL;
-      info.active_channel        = NULL;
-      info.floating_sel_drawable = NULL;
-      info.floating_sel          = NULL;
-      info.floating_sel_offset   = 0;
-      info.swap_num              = 0;
-      info.ref_count             = NULL;
-      info.compression           = COMPRESS_RLE;
+      xcf_save_info_init (&info, gimp, image, fp, filename);
+
+      info.progress = progress;
 
       if (progress)
         {
@@ -390,45 +591,472 @@ xcf_save_invoker (GimpProcedure         *procedure,
           g_free (name);
         }
 
-      xcf_save_choose_format (&info, image);
+      success = xcf_save_stream (&info, image, error);
+      success = xcf_save_close (&info, tmp_filename, success, error);
 
-      success = xcf_save_image (&info, image, error);
+      if (progress)
+        gimp_progress_end (progress);
+    }
 
-      if (success)
+  g_free (tmp_filename);
+
+  return_vals = gimp_procedure_get_return_values (procedure, success,
+                                                  error ? *error : NULL);
+
+  gimp_unset_busy (gimp);
+
+  return return_vals;
+}
+
+static FILE *
+xcf_save_open (const gchar  *filename,
+               gboolean      replace,
+               gchar       **tmp_filename,
+               GError      **error)
+{
+  FILE *fp = NULL;
+
+  *tmp_filename = NULL;
+
+#ifndef G_OS_WIN32
+  /* if unchanged tiles can be copied from the file we are about to
+   * overwrite, or if the file must stay intact until the new one is
+   * complete, the new file is written next to it and renamed over
+   * it, the old file stays readable through its open descriptors
+   */
+  if (replace || xcf_tile_records_use_file (filename))
+    *tmp_filename = xcf_save_open_tmp (filename, &fp);
+#endif
+
+  if (! *tmp_filename)
+    {
+      /* tiles which are still only in the file we are about to
+       * overwrite must be read now, and can't be copied from it
+       */
+      xcf_tile_handler_load_all (filename);
+      xcf_tile_records_forget_file (filename);
+
+      fp = g_fopen (filename, "wb");
+
+      if (! fp)
         {
-          if (fclose (info.fp) == EOF)
-            {
-              int save_errno = errno;
+          int save_errno = errno;
 
-              g_set_error (error, G_FILE_ERROR,
-                           g_file_error_from_errno (save_errno),
-                            _("Error saving XCF file: %s"),
-                           g_strerror (save_errno));
+          g_set_error (error, G_FILE_ERROR,
+                       g_file_error_from_errno (save_errno),
+                       _("Could not open '%s' for writing: %s"),
+                       gimp_filename_to_utf8 (filename),
+                       g_strerror (save_errno));
+        }
+    }
 
-              success = FALSE;
-            }
+  return fp;
+}
+
+#ifndef G_OS_WIN32
+static gchar *
+xcf_save_open_tmp (const gchar  *filename,
+                   FILE        **fp)
+{
+  GStatBuf  stat;
+  gchar    *tmp_filename;
+  gint      fd;
+
+  /* renaming over a link would replace it by a regular file */
+  if (g_lstat (filename, &stat) != 0 ||
+      ! S_ISREG (stat.st_mode)       ||
+      stat.st_nlink != 1)
+    return NULL;
+
+  tmp_filename = g_strconcat (filename, ".XXXXXX", NULL);
+
+  fd = g_mkstemp (tmp_filename);
+
+  if (fd == -1)
+    {
+      g_free (tmp_filename);
+      return NULL;
+    }
+
+  /* keep the permissions of the file we replace */
+  fchmod (fd, stat.st_mode & 07777);
+
+  *fp = fdopen (fd, "wb");
+
+  if (! *fp)
+    {
+      close (fd);
+      g_unlink (tmp_filename);
+      g_free (tmp_filename);
+      return NULL;
+    }
+
+  return tmp_filename;
+}
+#endif
+
+static void
+xcf_save_info_init (XcfInfo     *info,
+                    Gimp        *gimp,
+                    GimpImage   *image,
+                    FILE        *fp,
+                    const gchar *filename)
+{
+  info->gimp                  = gimp;
+  info->progress              = NULL;
+  info->async_progress        = NULL;
+  info->fp                    = fp;
+  info->cp                    = 0;
+  info->filename              = filename;
+  info->active_layer          = NULL;
+  info->active_channel        = NULL;
+  info->floating_sel_drawable = NULL;
+  info->floating_sel          = NULL;
+  info->floating_sel_offset   = 0;
+  info->swap_num              = 0;
+  info->ref_count             = NULL;
+  info->tile_file             = NULL;
+  info->tile_records          = NULL;
+  info->compression           = (gimp_image_get_xcf_compression (image) ?
+                                 COMPRESS_ZLIB : COMPRESS_RLE);
+}
+
+/*  writes image to info->fp and closes it, this doesn't touch
+ *  anything but image and can run on any thread
+ */
+static gboolean
+xcf_save_stream (XcfInfo    *info,
+                 GimpImage  *image,
+                 GError    **error)
+{
+  gboolean success;
+
+  xcf_save_choose_format (info, image);
+
+  success = xcf_save_image (info, image, error);
+
+  if (success)
+    {
+      if (fclose (info->fp) == EOF)
+        {
+          int save_errno = errno;
+
+          g_set_error (error, G_FILE_ERROR,
+                       g_file_error_from_errno (save_errno),
+                        _("Error saving XCF file: %s"),
+                       g_strerror (save_errno));
+
+          success = FALSE;
         }
-      else
+    }
+  else
+    {
+      fclose (info->fp);
+    }
+
+  info->fp = NULL;
+
+  return success;
+}
+
+/*  moves the written file into place and hands the tile records of
+ *  the saved buffers over to them
+ */
+static gboolean
+xcf_save_close (XcfInfo      *info,
+                const gchar  *tmp_filename,
+                gboolean      success,
+                GError      **error)
+{
+  if (success && tmp_filename && g_rename (tmp_filename, info->filename) != 0)
+    {
+      int save_errno = errno;
+
+      g_set_error (error, G_FILE_ERROR,
+                   g_file_error_from_errno (save_errno),
+                   _("Error saving XCF file: %s"),
+                   g_strerror (save_errno));
+
+      success = FALSE;
+    }
+
+  if (! success && tmp_filename)
+    g_unlink (tmp_filename);
+
+  if (success)
+    {
+      XcfTileFile *tile_file = xcf_tile_file_new (info->filename);
+      GList       *list;
+
+      for (list = info->tile_records; list; list = g_list_next (list))
         {
-          fclose (info.fp);
+          if (tile_file)
+            xcf_tile_record_attach (list->data, tile_file);
+          else
+            xcf_tile_record_free (list->data);
         }
 
-      if (progress)
-        gimp_progress_end (progress);
+      g_list_free (info->tile_records);
+
+      if (tile_file)
+        xcf_tile_file_unref (tile_file);
     }
   else
     {
-      int save_errno = errno;
+      g_list_free_full (info->tile_records,
+                        (GDestroyNotify) xcf_tile_record_free);
+    }
 
-      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (save_errno),
-                   _("Could not open '%s' for writing: %s"),
-                   gimp_filename_to_utf8 (filename), g_strerror (save_errno));
+  info->tile_records = NULL;
+
+  return success;
+}
+
+static gboolean
+xcf_save_busy (GimpImage    *image,
+               const gchar  *filename,
+               GError      **error)
+{
+  GList *list;
+
+  for (list = xcf_async_saves; list; list = g_list_next (list))
+    {
+      XcfSaveData *save = list->data;
+
+      if (save->image == image || ! strcmp (save->filename, filename))
+        {
+          g_set_error_literal (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                               _("The image is still being saved"));
+          return TRUE;
+        }
     }
 
-  return_vals = gimp_procedure_get_return_values (procedure, success,
-                                                  error ? *error : NULL);
+  return FALSE;
+}
 
-  gimp_unset_busy (gimp);
+/*  duplicates image, which only copies references to its tiles, and
+ *  pairs each buffer of image with its copy in the duplicate
+ */
+static GimpImage *
+xcf_save_snapshot (GimpImage  *image,
+                   GList     **buffers)
+{
+  GimpImage *snapshot;
+  GList     *drawables;
+  GList     *copies;
+  GList     *list;
+  GList     *copy_list;
 
-  return return_vals;
+  snapshot = gimp_image_duplicate (image);
+
+  /*  the snapshot is no image of its own  */
+  gimp_container_remove (image->gimp->images, GIMP_OBJECT (snapshot));
+
+  drawables = g_list_concat (gimp_image_get_layer_list (image),
+                             gimp_image_get_channel_list (image));
+  copies    = g_list_concat (gimp_image_get_layer_list (snapshot),
+                             gimp_image_get_channel_list (snapshot));
+
+  drawables = g_list_prepend (drawables, gimp_image_get_mask (image));
+  copies    = g_list_prepend (copies,    gimp_image_get_mask (snapshot));
+
+  for (list = drawables, copy_list = copies;
+       list && copy_list;
+       list = g_list_next (list), copy_list = g_list_next (copy_list))
+    {
+      /*  stop pairing if the duplicate doesn't mirror the image  */
+      if (G_TYPE_FROM_INSTANCE (list->data) !=
+          G_TYPE_FROM_INSTANCE (copy_list->data) ||
+          g_strcmp0 (gimp_object_get_name (list->data),
+                     gimp_object_get_name (copy_list->data)))
+        break;
+
+      xcf_save_snapshot_add (list->data, copy_list->data, buffers);
+
+      if (GIMP_IS_LAYER (list->data))
+        {
+          GimpLayerMask *mask      = gimp_layer_get_mask (list->data);
+          GimpLayerMask *copy_mask = gimp_layer_get_mask (copy_list->data);
+
+          if (mask && copy_mask)
+            xcf_save_snapshot_add (GIMP_DRAWABLE (mask),
+                                   GIMP_DRAWABLE (copy_mask), buffers);
+        }
+    }
+
+  g_list_free (drawables);
+  g_list_free (copies);
+
+  return snapshot;
+}
+
+static void
+xcf_save_snapshot_add (GimpDrawable  *drawable,
+                       GimpDrawable  *copy,
+                       GList        **buffers)
+{
+  XcfSaveBuffer *save_buffer;
+  GeglBuffer    *buffer      = gimp_drawable_get_buffer (drawable);
+  GeglBuffer    *copy_buffer = gimp_drawable_get_buffer (copy);
+
+  /*  the snapshot can copy the tiles its original can  */
+  xcf_tile_record_share (buffer, copy_buffer);
+
+  save_buffer = g_slice_new0 (XcfSaveBuffer);
+
+  save_buffer->buffer     = g_object_ref (buffer);
+  save_buffer->copy       = g_object_ref (copy_buffer);
+  save_buffer->changed_id =
+    gegl_buffer_signal_connect (buffer, "changed",
+                                G_CALLBACK (xcf_save_snapshot_changed),
+                                save_buffer);
+
+  *buffers = g_list_prepend (*buffers, save_buffer);
+}
+
+static void
+xcf_save_snapshot_changed (GeglBuffer          *buffer,
+                           const GeglRectangle *rect,
+                           XcfSaveBuffer       *save_buffer)
+{
+  /*  buffers can change on any thread  */
+  g_atomic_int_set (&save_buffer->changed, TRUE);
+}
+
+static void
+xcf_save_async_thread (GTask        *task,
+                       gpointer      source_object,
+                       gpointer      task_data,
+                       GCancellable *cancellable)
+{
+  XcfSaveData *save  = task_data;
+  GError      *error = NULL;
+
+  if (xcf_save_stream (&save->info, save->snapshot, &error))
+    g_task_return_boolean (task, TRUE);
+  else
+    g_task_return_error (task, error);
+}
+
+static void
+xcf_save_async_callback (GObject      *source_object,
+                         GAsyncResult *result,
+                         gpointer      data)
+{
+  XcfSaveData *save;
+  GHashTable  *copies;
+  GList       *list;
+  GList       *next;
+  GError      *error = NULL;
+  gboolean     success;
+
+  success = g_task_propagate_boolean (G_TASK (result), &error);
+  save    = g_task_get_task_data (G_TASK (result));
+
+  /*  the tiles written for a buffer of the snapshot are the tiles of
+   *  its original too, unless the original changed since
+   */
+  copies = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  for (list = save->buffers; list; list = g_list_next (list))
+    {
+      XcfSaveBuffer *save_buffer = list->data;
+
+      if (! g_atomic_int_get (&save_buffer->changed))
+        g_hash_table_insert (copies, save_buffer->copy, save_buffer->buffer);
+    }
+
+  for (list = save->info.tile_records; list; list = next)
+    {
+      XcfTileRecord *record = list->data;
+      GeglBuffer    *buffer;
+
+      next = g_list_next (list);
+
+      buffer = g_hash_table_lookup (copies,
+                                    xcf_tile_record_buffer (record));
+
+      if (buffer)
+        {
+          xcf_tile_record_move (record, buffer);
+        }
+      else
+        {
+          xcf_tile_record_free (record);
+          save->info.tile_records = g_list_delete_link (save->info.tile_records,
+                                                        list);
+        }
+    }
+
+  g_hash_table_unref (copies);
+
+  success = xcf_save_close (&save->info, save->tmp_filename, success,
+                            &error);
+
+  xcf_async_saves = g_list_remove (xcf_async_saves, save);
+
+  if (save->progress)
+    gimp_progress_end (save->progress);
+
+  save->callback (save->image, error, save->callback_data);
+
+  g_clear_error (&error);
+
+  xcf_save_async_free (save);
+}
+
+static gboolean
+xcf_save_async_progress (XcfSaveData *save)
+{
+  gimp_progress_set_value (save->progress,
+                           g_atomic_int_get (&save->progress_value) / 1000.0);
+
+  return TRUE;
+}
+
+static void
+xcf_save_async_free (XcfSaveData *save)
+{
+  GList *list;
+
+  for (list = save->buffers; list; list = g_list_next (list))
+    {
+      XcfSaveBuffer *save_buffer = list->data;
+
+      g_signal_handler_disconnect (save_buffer->buffer,
+                                   save_buffer->changed_id);
+
+      g_object_unref (save_buffer->buffer);
+      g_object_unref (save_buffer->copy);
+
+      g_slice_free (XcfSaveBuffer, save_buffer);
+    }
+
+  g_list_free (save->buffers);
+
+  if (save->progress_id)
+    g_source_remove (save->progress_id);
+
+  if (save->progress)
+    g_object_unref (save->progress);
+
+  g_object_unref (save->snapshot);
+  g_object_unref (save->image);
+
+  g_free (save->filename);
+  g_free (save->tmp_filename);
+
+  g_slice_free (XcfSaveData, save);
+}
+
+static gboolean
+xcf_save_async_exit (Gimp     *gimp,
+                     gboolean  force,
+                     gpointer  data)
+{
+  /*  let the saves that are still running finish first  */
+  while (xcf_async_saves)
+    g_main_context_iteration (NULL, TRUE);
+
+  return FALSE; /* continue exiting */
 }
@@ -19,8 +19,20 @@
 #define __XCF_H__
 
 
-void   xcf_init (Gimp *gimp);
-void   xcf_exit (Gimp *gimp);
+typedef void (* XcfSaveCallback) (GimpImage    *image,
+                                  const GError *error,
+                                  gpointer      data);
+
+
+void       xcf_init             (Gimp             *gimp);
+void       xcf_exit             (Gimp             *gimp);
+
+gboolean   xcf_save_image_async (GimpImage        *image,
+                                 const gchar      *filename,
+                                 GimpProgress     *progress,
+                                 XcfSaveCallback   callback,
+                                 gpointer          data,
+                                 GError          **error);
 
 
 #endif /* __XCF_H__ */
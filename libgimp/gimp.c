@@ -141,6 +141,9 @@ typedef enum
 void gimp_read_expect_msg   (GimpWireMessage *msg,
                              gint             type);
 
+G_GNUC_INTERNAL guchar * _gimp_shm_region_addr (gint  shm_ID,
+                                                gsize size);
+
 
 static void       gimp_close                   (void);
 static void       gimp_debug_stop              (void);
@@ -162,7 +165,7 @@ static gboolean   gimp_flush                   (GIOChannel      *channel,
                                                 gpointer         user_data);
 static void       gimp_loop                    (void);
 static void       gimp_config                  (GPConfig        *config);
-static void       gimp_proc_run                (GPProcRun       *proc_run);
+static gboolean   gimp_proc_run                (GPProcRun       *proc_run);
 static void       gimp_temp_proc_run           (GPProcRun       *proc_run);
 static void       gimp_process_message         (GimpWireMessage *msg);
 static void       gimp_single_message          (void);
@@ -173,18 +176,24 @@ static gboolean   gimp_extension_read          (GIOChannel      *channel,
 static void       gimp_set_pdb_error           (const GimpParam *return_vals,
                                                 gint             n_return_vals);
 
+static void       gimp_shm_region_detach       (void);
+
 
 static GIOChannel *_readchannel  = NULL;
 GIOChannel *_writechannel = NULL;
 
 #ifdef USE_WIN32_SHM
 static HANDLE shm_handle;
+static HANDLE region_shm_handle;
 #endif
 
 static gint           _tile_width        = -1;
 static gint           _tile_height       = -1;
 static gint           _shm_ID            = -1;
 static guchar        *_shm_addr          = NULL;
+static gint           _region_shm_ID     = -1;
+static guchar        *_region_shm_addr   = NULL;
+static gsize          _region_shm_size   = 0;
 static const gdouble  _gamma_val         = 2.2;
 static gboolean       _install_cmap      = FALSE;
 static gboolean       _show_tool_tips    = TRUE;
@@ -198,6 +207,7 @@ static gchar         *_display_name      = NULL;
 static gint           _monitor_number    = 0;
 static guint32        _timestamp         = 0;
 static const gchar   *progname           = NULL;
+static gboolean       _persistent        = FALSE;
 
 static gchar          write_buffer[WRITE_BUFFER_SIZE];
 static gulong         write_buffer_index = 0;
@@ -1174,6 +1184,85 @@ gimp_shm_addr (void)
   return _shm_addr;
 }
 
+/*  attaches the segment the core sized for a region request, the
+ *  mapping is kept until the core hands out a different segment
+ */
+guchar *
+_gimp_shm_region_addr (gint  shm_ID,
+                       gsize size)
+{
+  if (shm_ID == _region_shm_ID && size == _region_shm_size)
+    return _region_shm_addr;
+
+  gimp_shm_region_detach ();
+
+#if defined(USE_SYSV_SHM)
+
+  _region_shm_addr = (guchar *) shmat (shm_ID, NULL, 0);
+
+  if (_region_shm_addr == (guchar *) -1)
+    _region_shm_addr = NULL;
+
+#elif defined(USE_WIN32_SHM)
+
+  {
+    gchar fileMapName[128];
+
+    g_snprintf (fileMapName, sizeof (fileMapName), "GIMP%d-%d.SHM",
+                _shm_ID, shm_ID);
+
+    region_shm_handle = OpenFileMapping (FILE_MAP_ALL_ACCESS,
+                                         0, fileMapName);
+
+    if (region_shm_handle)
+      {
+        _region_shm_addr = (guchar *) MapViewOfFile (region_shm_handle,
+                                                     FILE_MAP_ALL_ACCESS,
+                                                     0, 0, size);
+
+        if (! _region_shm_addr)
+          {
+            CloseHandle (region_shm_handle);
+            region_shm_handle = NULL;
+          }
+      }
+  }
+
+#elif defined(USE_POSIX_SHM)
+
+  {
+    gchar map_file[32];
+    gint  shm_fd;
+
+    g_snprintf (map_file, sizeof (map_file), "/gimp-shm-%d-%d",
+                _shm_ID, shm_ID);
+
+    shm_fd = shm_open (map_file, O_RDWR, 0600);
+
+    if (shm_fd != -1)
+      {
+        _region_shm_addr = (guchar *) mmap (NULL, size,
+                                            PROT_READ | PROT_WRITE,
+                                            MAP_SHARED, shm_fd, 0);
+
+        if (_region_shm_addr == MAP_FAILED)
+          _region_shm_addr = NULL;
+
+        close (shm_fd);
+      }
+  }
+
+#endif
+
+  if (_region_shm_addr)
+    {
+      _region_shm_ID   = shm_ID;
+      _region_shm_size = size;
+    }
+
+  return _region_shm_addr;
+}
+
 /**
  * gimp_gamma:
  *
@@ -1392,6 +1481,26 @@ gimp_get_progname (void)
   return progname;
 }
 
+/**
+ * gimp_plugin_set_persistent:
+ * @persistent: whether the plug-in may be reused
+ *
+ * Offers to keep the plug-in process running after its procedure
+ * returned, so the next call of one of its procedures does not have
+ * to start and initialize a new process.
+ *
+ * Only plug-ins that don't keep any state between two calls should
+ * enable this. The main GIMP application may still decline the offer,
+ * and quits persistent plug-ins that are idle for a while.
+ *
+ * Since: 2.10
+ **/
+void
+gimp_plugin_set_persistent (gboolean persistent)
+{
+  _persistent = persistent ? TRUE : FALSE;
+}
+
 /**
  * gimp_extension_ack:
  *
@@ -1642,9 +1751,38 @@ gimp_close (void)
 
 #endif
 
+  gimp_shm_region_detach ();
+
   gp_quit_write (_writechannel, NULL);
 }
 
+static void
+gimp_shm_region_detach (void)
+{
+  if (! _region_shm_addr)
+    return;
+
+#if defined(USE_SYSV_SHM)
+
+  shmdt ((char *) _region_shm_addr);
+
+#elif defined(USE_WIN32_SHM)
+
+  UnmapViewOfFile (_region_shm_addr);
+  CloseHandle (region_shm_handle);
+  region_shm_handle = NULL;
+
+#elif defined(USE_POSIX_SHM)
+
+  munmap (_region_shm_addr, _region_shm_size);
+
+#endif
+
+  _region_shm_ID   = -1;
+  _region_shm_addr = NULL;
+  _region_shm_size = 0;
+}
+
 static void
 gimp_debug_stop (void)
 {
@@ -1855,6 +1993,7 @@ static void
 gimp_loop (void)
 {
   GimpWireMessage msg;
+  gboolean        persist;
 
   while (TRUE)
     {
@@ -1878,12 +2017,23 @@ gimp_loop (void)
         case GP_TILE_REQ:
         case GP_TILE_ACK:
         case GP_TILE_DATA:
+        case GP_REGION_REQ:
+        case GP_REGION_DATA:
+        case GP_TILES_REQ:
+        case GP_TILES_DATA:
           g_warning ("unexpected tile message received (should not happen)");
           break;
 
         case GP_PROC_RUN:
-          gimp_proc_run (msg.data);
+          persist = gimp_proc_run (msg.data);
           gimp_wire_destroy (&msg);
+
+          /*  a persistent plug-in waits for the next GP_CONFIG and
+           *  GP_PROC_RUN, or for GP_QUIT if GIMP declined the offer
+           */
+          if (persist)
+            continue;
+
           gimp_close ();
           return;
 
@@ -1906,6 +2056,10 @@ gimp_loop (void)
         case GP_HAS_INIT:
           g_warning ("unexpected has init message received (should not happen)");
           break;
+
+        case GP_PERSIST:
+          g_warning ("unexpected persist message received (should not happen)");
+          break;
         }
 
       gimp_wire_destroy (&msg);
@@ -1944,6 +2098,10 @@ gimp_config (GPConfig *config)
   _show_help_button = config->show_help_button ? TRUE : FALSE;
   _min_colors       = config->min_colors;
   _gdisp_ID         = config->gdisp_ID;
+
+  g_free (_wm_class);
+  g_free (_display_name);
+
   _wm_class         = g_strdup (config->wm_class);
   _display_name     = g_strdup (config->display_name);
   _monitor_number   = config->monitor_number;
@@ -1954,7 +2112,12 @@ gimp_config (GPConfig *config)
 
   gimp_cpu_accel_set_use (config->use_cpu_accel);
 
-  if (_shm_ID != -1)
+  _gimp_tile_cache_set_host_size ((guint64) config->tile_cache_size * 1024);
+
+  /*  a persistent plug-in is configured again for every call, the
+   *  tile shm segment is the same for the lifetime of the process
+   */
+  if (_shm_ID != -1 && ! _shm_addr)
     {
 #if defined(USE_SYSV_SHM)
 
@@ -2039,9 +2202,12 @@ gimp_config (GPConfig *config)
     }
 }
 
-static void
+/*  returns TRUE if the plug-in offered to stay running  */
+static gboolean
 gimp_proc_run (GPProcRun *proc_run)
 {
+  gboolean persist = FALSE;
+
   if (PLUG_IN_INFO.run_proc)
     {
       GPProcReturn  proc_return;
@@ -2057,9 +2223,19 @@ gimp_proc_run (GPProcRun *proc_run)
       proc_return.nparams = n_return_vals;
       proc_return.params  = (GPParam *) return_vals;
 
+      /*  the offer has to arrive before the return values, which
+       *  finish the call in the main GIMP application
+       */
+      persist = _persistent;
+
+      if (persist && ! gp_persist_write (_writechannel, NULL))
+        gimp_quit ();
+
       if (! gp_proc_return_write (_writechannel, &proc_return, NULL))
         gimp_quit ();
     }
+
+  return persist;
 }
 
 static void
@@ -2109,6 +2285,10 @@ gimp_process_message (GimpWireMessage *msg)
     case GP_TILE_REQ:
     case GP_TILE_ACK:
     case GP_TILE_DATA:
+    case GP_REGION_REQ:
+    case GP_REGION_DATA:
+    case GP_TILES_REQ:
+    case GP_TILES_DATA:
       g_warning ("unexpected tile message received (should not happen)");
       break;
     case GP_PROC_RUN:
@@ -2129,6 +2309,9 @@ gimp_process_message (GimpWireMessage *msg)
     case GP_HAS_INIT:
       g_warning ("unexpected has init message received (should not happen)");
       break;
+    case GP_PERSIST:
+      g_warning ("unexpected persist message received (should not happen)");
+      break;
     }
 }
 
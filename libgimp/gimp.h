@@ -38,6 +38,7 @@
 #include <libgimp/gimpbrushes.h>
 #include <libgimp/gimpbrushselect.h>
 #include <libgimp/gimpchannel.h>
+#include <libgimp/gimpdistort.h>
 #include <libgimp/gimpdrawable.h>
 #include <libgimp/gimpfontselect.h>
 #include <libgimp/gimpgimprc.h>
@@ -268,6 +269,10 @@ void           gimp_install_temp_proc   (const gchar        *name,
  */
 void           gimp_uninstall_temp_proc (const gchar        *name);
 
+/* Offer to keep the plug-in running for the next call
+ */
+void           gimp_plugin_set_persistent (gboolean       persistent);
+
 /* Notify the main GIMP application that the extension is ready to run
  */
 void           gimp_extension_ack       (void);
@@ -0,0 +1,417 @@
+/* LIBGIMP - The GIMP Library
+ * Copyright (C) 1995-1997 Peter Mattis and Spencer Kimball
+ *
+ * gimpdistort.c
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "gimp.h"
+
+
+/**
+ * SECTION: gimpdistort
+ * @title: gimpdistort
+ * @short_description: Functions for distorting drawables.
+ *
+ * These functions implement the common part of plug-ins that move
+ * pixels around: for each destination pixel a #GimpDistortFunc
+ * returns the source position, and the source is sampled there with
+ * one of GEGL's interpolation methods.  The source is copied into
+ * memory once, so random access doesn't go through the tile cache,
+ * and bands of rows are rendered in several threads.
+ **/
+
+
+#define GIMP_DISTORT_BAND_HEIGHT 32
+
+
+typedef struct _GimpDistortBand GimpDistortBand;
+
+struct _GimpDistort
+{
+  gint32           drawable_ID;
+  GeglBuffer      *source;
+  GeglSamplerType  interpolation;
+  GeglAbyssPolicy  abyss_policy;
+};
+
+struct _GimpDistortBand
+{
+  GimpDistort     *distort;
+  GeglRectangle    rect;
+  const Babl      *format;
+  guchar          *dest;
+  gint             rowstride;
+  GimpDistortFunc  func;
+  gpointer         data;
+  gboolean         done;
+};
+
+
+/*  local function prototypes  */
+
+static GeglBuffer  * gimp_distort_get_source (GimpDistort     *distort);
+static void          gimp_distort_band       (GimpDistortBand *band,
+                                              gpointer         data);
+static GThreadPool * gimp_distort_pool_new   (gint             n_bands);
+static void          gimp_distort_band_wait  (GimpDistortBand *band);
+
+
+static GMutex band_mutex;
+static GCond  band_cond;
+
+
+/*  public functions  */
+
+/**
+ * gimp_distort_new:
+ * @drawable_ID: the ID of the drawable to distort.
+ *
+ * Creates a #GimpDistort for the drawable, with linear interpolation
+ * and transparent pixels outside the drawable.  The drawable's pixels
+ * are read when they are first needed, and kept until
+ * gimp_distort_free(), so repeated previews don't read them again.
+ *
+ * Return value: a new #GimpDistort.
+ *
+ * Since: GIMP 2.10
+ **/
+GimpDistort *
+gimp_distort_new (gint32 drawable_ID)
+{
+  GimpDistort *distort;
+
+  g_return_val_if_fail (gimp_item_is_drawable (drawable_ID), NULL);
+
+  distort = g_slice_new0 (GimpDistort);
+
+  distort->drawable_ID   = drawable_ID;
+  distort->interpolation = GEGL_SAMPLER_LINEAR;
+  distort->abyss_policy  = GEGL_ABYSS_NONE;
+
+  return distort;
+}
+
+/**
+ * gimp_distort_free:
+ * @distort: a #GimpDistort.
+ *
+ * Frees @distort and its copy of the drawable's pixels.
+ *
+ * Since: GIMP 2.10
+ **/
+void
+gimp_distort_free (GimpDistort *distort)
+{
+  g_return_if_fail (distort != NULL);
+
+  if (distort->source)
+    g_object_unref (distort->source);
+
+  g_slice_free (GimpDistort, distort);
+}
+
+/**
+ * gimp_distort_set_interpolation:
+ * @distort:       a #GimpDistort.
+ * @interpolation: the #GeglSamplerType to sample the source with.
+ *
+ * Sets how the source is sampled between pixel centers.
+ * %GEGL_SAMPLER_NEAREST picks the pixel a source position falls into.
+ *
+ * Since: GIMP 2.10
+ **/
+void
+gimp_distort_set_interpolation (GimpDistort     *distort,
+                                GeglSamplerType  interpolation)
+{
+  g_return_if_fail (distort != NULL);
+
+  distort->interpolation = interpolation;
+}
+
+/**
+ * gimp_distort_set_abyss_policy:
+ * @distort:      a #GimpDistort.
+ * @abyss_policy: the #GeglAbyssPolicy for positions outside the drawable.
+ *
+ * Sets what source positions outside the drawable show:
+ * %GEGL_ABYSS_NONE makes them transparent, %GEGL_ABYSS_CLAMP repeats
+ * the edge pixels and %GEGL_ABYSS_LOOP tiles the drawable.
+ *
+ * Since: GIMP 2.10
+ **/
+void
+gimp_distort_set_abyss_policy (GimpDistort     *distort,
+                               GeglAbyssPolicy  abyss_policy)
+{
+  g_return_if_fail (distort != NULL);
+
+  distort->abyss_policy = abyss_policy;
+}
+
+/**
+ * gimp_distort_render:
+ * @distort:   a #GimpDistort.
+ * @rect:      the area of the drawable to render.
+ * @format:    the pixel format to render in.
+ * @dest:      the memory to render to.
+ * @rowstride: the rowstride of @dest, or %GEGL_AUTO_ROWSTRIDE.
+ * @func:      the function mapping destination pixels to the source.
+ * @data:      user data passed to @func.
+ *
+ * Renders the distorted pixels of @rect, for example for a preview.
+ * The drawable isn't changed.
+ *
+ * Since: GIMP 2.10
+ **/
+void
+gimp_distort_render (GimpDistort         *distort,
+                     const GeglRectangle *rect,
+                     const Babl          *format,
+                     guchar              *dest,
+                     gint                 rowstride,
+                     GimpDistortFunc      func,
+                     gpointer             data)
+{
+  GimpDistortBand *bands;
+  GThreadPool     *pool;
+  gint             n_bands;
+  gint             i;
+
+  g_return_if_fail (distort != NULL);
+  g_return_if_fail (rect != NULL);
+  g_return_if_fail (format != NULL);
+  g_return_if_fail (dest != NULL);
+  g_return_if_fail (func != NULL);
+
+  if (rect->width < 1 || rect->height < 1)
+    return;
+
+  if (rowstride == GEGL_AUTO_ROWSTRIDE)
+    rowstride = rect->width * babl_format_get_bytes_per_pixel (format);
+
+  gimp_distort_get_source (distort);
+
+  n_bands = ((rect->height + GIMP_DISTORT_BAND_HEIGHT - 1) /
+             GIMP_DISTORT_BAND_HEIGHT);
+
+  bands = g_new0 (GimpDistortBand, n_bands);
+  pool  = gimp_distort_pool_new (n_bands);
+
+  for (i = 0; i < n_bands; i++)
+    {
+      gint y = i * GIMP_DISTORT_BAND_HEIGHT;
+
+      bands[i].distort     = distort;
+      bands[i].rect.x      = rect->x;
+      bands[i].rect.y      = rect->y + y;
+      bands[i].rect.width  = rect->width;
+      bands[i].rect.height = MIN (GIMP_DISTORT_BAND_HEIGHT, rect->height - y);
+      bands[i].format      = format;
+      bands[i].dest        = dest + y * rowstride;
+      bands[i].rowstride   = rowstride;
+      bands[i].func        = func;
+      bands[i].data        = data;
+
+      g_thread_pool_push (pool, &bands[i], NULL);
+    }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+  g_free (bands);
+}
+
+/**
+ * gimp_distort_apply:
+ * @distort:       a #GimpDistort.
+ * @func:          the function mapping destination pixels to the source.
+ * @data:          user data passed to @func.
+ * @show_progress: whether to update the plug-in's progress.
+ *
+ * Distorts the selected area of the drawable.  The result is written
+ * to the shadow tiles and merged into the drawable, with undo.
+ *
+ * Since: GIMP 2.10
+ **/
+void
+gimp_distort_apply (GimpDistort     *distort,
+                    GimpDistortFunc  func,
+                    gpointer         data,
+                    gboolean         show_progress)
+{
+  GimpDistortBand *bands;
+  GThreadPool     *pool;
+  GeglBuffer      *shadow;
+  const Babl      *format;
+  gint             x, y, width, height;
+  gint             bpp;
+  gint             n_bands;
+  gint             n_queued;
+  gint             i;
+
+  g_return_if_fail (distort != NULL);
+  g_return_if_fail (func != NULL);
+
+  if (! gimp_drawable_mask_intersect (distort->drawable_ID,
+                                      &x, &y, &width, &height))
+    return;
+
+  gimp_distort_get_source (distort);
+
+  format = gimp_drawable_get_format (distort->drawable_ID);
+  bpp    = babl_format_get_bytes_per_pixel (format);
+  shadow = gimp_drawable_get_shadow_buffer (distort->drawable_ID);
+
+  n_bands = (height + GIMP_DISTORT_BAND_HEIGHT - 1) / GIMP_DISTORT_BAND_HEIGHT;
+
+  bands = g_new0 (GimpDistortBand, n_bands);
+  pool  = gimp_distort_pool_new (n_bands);
+
+  /*  keep a few bands per thread queued, so the threads never wait for
+   *  the main thread writing the finished ones
+   */
+  n_queued = 0;
+
+  for (i = 0; i < n_bands; i++)
+    {
+      while (n_queued < n_bands &&
+             n_queued < i + 4 * (gint) g_thread_pool_get_max_threads (pool))
+        {
+          GimpDistortBand *band = &bands[n_queued];
+          gint             row  = n_queued * GIMP_DISTORT_BAND_HEIGHT;
+
+          band->distort     = distort;
+          band->rect.x      = x;
+          band->rect.y      = y + row;
+          band->rect.width  = width;
+          band->rect.height = MIN (GIMP_DISTORT_BAND_HEIGHT, height - row);
+          band->format      = format;
+          band->rowstride   = width * bpp;
+          band->dest        = g_malloc (band->rect.height * band->rowstride);
+          band->func        = func;
+          band->data        = data;
+
+          g_thread_pool_push (pool, band, NULL);
+          n_queued++;
+        }
+
+      gimp_distort_band_wait (&bands[i]);
+
+      /*  only the main thread talks to the core  */
+      gegl_buffer_set (shadow, &bands[i].rect, 0,
+                       format, bands[i].dest, bands[i].rowstride);
+
+      g_free (bands[i].dest);
+
+      if (show_progress)
+        gimp_progress_update ((gdouble) (i + 1) / n_bands);
+    }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+  g_free (bands);
+
+  g_object_unref (shadow);
+
+  gimp_drawable_merge_shadow (distort->drawable_ID, TRUE);
+  gimp_drawable_update (distort->drawable_ID, x, y, width, height);
+}
+
+
+/*  private functions  */
+
+static GeglBuffer *
+gimp_distort_get_source (GimpDistort *distort)
+{
+  if (! distort->source)
+    {
+      GeglBuffer *buffer = gimp_drawable_get_buffer (distort->drawable_ID);
+
+      /*  the plug-in's buffers fetch their tiles over the wire, which
+       *  must happen in the main thread only
+       */
+      distort->source =
+        gegl_buffer_new (gegl_buffer_get_extent (buffer),
+                         gimp_drawable_get_format (distort->drawable_ID));
+
+      gegl_buffer_copy (buffer, NULL, GEGL_ABYSS_NONE,
+                        distort->source, NULL);
+
+      g_object_unref (buffer);
+    }
+
+  return distort->source;
+}
+
+static void
+gimp_distort_band (GimpDistortBand *band,
+                   gpointer         data)
+{
+  GimpDistort *distort = band->distort;
+  GeglSampler *sampler;
+  gint         bpp;
+  gint         x, y;
+
+  sampler = gegl_buffer_sampler_new (distort->source, band->format,
+                                     distort->interpolation);
+
+  bpp = babl_format_get_bytes_per_pixel (band->format);
+
+  for (y = 0; y < band->rect.height; y++)
+    {
+      guchar *d = band->dest + y * band->rowstride;
+
+      for (x = 0; x < band->rect.width; x++)
+        {
+          gdouble src_x, src_y;
+
+          band->func (band->rect.x + x, band->rect.y + y,
+                      &src_x, &src_y, band->data);
+
+          /*  GEGL's samplers have their pixel centers at +0.5  */
+          gegl_sampler_get (sampler, src_x + 0.5, src_y + 0.5, NULL,
+                            d, distort->abyss_policy);
+
+          d += bpp;
+        }
+    }
+
+  g_object_unref (sampler);
+
+  g_mutex_lock (&band_mutex);
+  band->done = TRUE;
+  g_cond_broadcast (&band_cond);
+  g_mutex_unlock (&band_mutex);
+}
+
+static GThreadPool *
+gimp_distort_pool_new (gint n_bands)
+{
+  gint n_threads = CLAMP (g_get_num_processors (), 1, MAX (n_bands, 1));
+
+  return g_thread_pool_new ((GFunc) gimp_distort_band, NULL,
+                            n_threads, FALSE, NULL);
+}
+
+static void
+gimp_distort_band_wait (GimpDistortBand *band)
+{
+  g_mutex_lock (&band_mutex);
+  while (! band->done)
+    g_cond_wait (&band_cond, &band_mutex);
+  g_mutex_unlock (&band_mutex);
+}
@@ -0,0 +1,77 @@
+/* LIBGIMP - The GIMP Library
+ * Copyright (C) 1995-1997 Peter Mattis and Spencer Kimball
+ *
+ * gimpdistort.h
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined (__GIMP_H_INSIDE__) && !defined (GIMP_COMPILATION)
+#error "Only <libgimp/gimp.h> can be included directly."
+#endif
+
+#ifndef __GIMP_DISTORT_H__
+#define __GIMP_DISTORT_H__
+
+G_BEGIN_DECLS
+
+/* For information look into the C source or the html documentation */
+
+
+/**
+ * GimpDistortFunc:
+ * @x:     the x coordinate of a destination pixel
+ * @y:     the y coordinate of a destination pixel
+ * @src_x: return location for the x coordinate to sample the source at
+ * @src_y: return location for the y coordinate to sample the source at
+ * @data:  the user data passed along with the function
+ *
+ * Maps a destination pixel to the source position it shows.  Integer
+ * coordinates are pixel centers.  The function is called from several
+ * threads at once, so it must not call the PDB or modify shared state.
+ **/
+typedef void (* GimpDistortFunc) (gint      x,
+                                  gint      y,
+                                  gdouble  *src_x,
+                                  gdouble  *src_y,
+                                  gpointer  data);
+
+
+typedef struct _GimpDistort GimpDistort;
+
+
+GimpDistort * gimp_distort_new                (gint32               drawable_ID);
+void          gimp_distort_free               (GimpDistort         *distort);
+
+void          gimp_distort_set_interpolation  (GimpDistort         *distort,
+                                               GeglSamplerType      interpolation);
+void          gimp_distort_set_abyss_policy   (GimpDistort         *distort,
+                                               GeglAbyssPolicy      abyss_policy);
+
+void          gimp_distort_render             (GimpDistort         *distort,
+                                               const GeglRectangle *rect,
+                                               const Babl          *format,
+                                               guchar              *dest,
+                                               gint                 rowstride,
+                                               GimpDistortFunc      func,
+                                               gpointer             data);
+void          gimp_distort_apply              (GimpDistort         *distort,
+                                               GimpDistortFunc      func,
+                                               gpointer             data,
+                                               gboolean             show_progress);
+
+G_END_DECLS
+
+#endif /* __GIMP_DISTORT_H__ */
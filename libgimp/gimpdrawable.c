@@ -117,32 +117,40 @@ gimp_drawable_detach (GimpDrawable *drawable)
 void
 gimp_drawable_flush (GimpDrawable *drawable)
 {
-  GimpTile *tiles;
-  gint      n_tiles;
-  gint      i;
+  GimpTile  *tiles;
+  GimpTile **dirty;
+  gint       n_tiles;
+  gint       n_dirty = 0;
+  gint       i;
 
   g_return_if_fail (drawable != NULL);
 
+  n_tiles = drawable->ntile_rows * drawable->ntile_cols;
+  dirty   = g_new (GimpTile *, 2 * n_tiles);
+
   if (drawable->tiles)
     {
-      tiles   = drawable->tiles;
-      n_tiles = drawable->ntile_rows * drawable->ntile_cols;
+      tiles = drawable->tiles;
 
       for (i = 0; i < n_tiles; i++)
         if ((tiles[i].ref_count > 0) && tiles[i].dirty)
-          gimp_tile_flush (&tiles[i]);
+          dirty[n_dirty++] = &tiles[i];
     }
 
   if (drawable->shadow_tiles)
     {
-      tiles   = drawable->shadow_tiles;
-      n_tiles = drawable->ntile_rows * drawable->ntile_cols;
+      tiles = drawable->shadow_tiles;
 
       for (i = 0; i < n_tiles; i++)
         if ((tiles[i].ref_count > 0) && tiles[i].dirty)
-          gimp_tile_flush (&tiles[i]);
+          dirty[n_dirty++] = &tiles[i];
     }
 
+  /*  write them back in batches instead of one at a time  */
+  _gimp_tiles_flush (dirty, n_dirty);
+
+  g_free (dirty);
+
   /*  nuke all references to this drawable from the cache  */
   _gimp_tile_cache_flush_drawable (drawable);
 }
@@ -799,3 +807,160 @@ gimp_drawable_get_format (gint32 drawable_ID)
 
   return format;
 }
+
+
+typedef struct
+{
+  GeglRectangle         rect;
+  const guchar         *src;
+  guchar               *dest;
+  GimpDrawableIterFunc  func;
+  gpointer              data;
+  gboolean              done;
+} GimpDrawableIterChunk;
+
+static GMutex iter_mutex;
+static GCond  iter_cond;
+
+static void
+gimp_drawable_iterate_chunk (GimpDrawableIterChunk *chunk,
+                             gpointer               data)
+{
+  chunk->func (&chunk->rect, chunk->src, chunk->dest, chunk->data);
+
+  g_mutex_lock (&iter_mutex);
+  chunk->done = TRUE;
+  g_cond_broadcast (&iter_cond);
+  g_mutex_unlock (&iter_mutex);
+}
+
+/**
+ * gimp_drawable_iterate:
+ * @drawable_ID:   the ID of the #GimpDrawable to process.
+ * @format:        the #Babl format to process the pixels in, or %NULL
+ *                 for the drawable's format.
+ * @func:          the function to call for each chunk of pixels.
+ * @data:          user data to pass to @func.
+ * @show_progress: whether to update the plug-in's progress.
+ *
+ * Processes the selected area of the drawable in bands of rows.  For
+ * each band, @func gets the source pixels and fills the destination
+ * pixels, both packed in @format without gaps between rows.  The
+ * result is written to the drawable's shadow buffer and merged into
+ * the drawable, with undo.
+ *
+ * The pixels are read and written in the main thread, while @func
+ * runs in a pool of worker threads, several bands at once.  It must
+ * not call the PDB or modify shared state.  Any @format can be
+ * requested, for example "R'G'B'A float" to process high bit depth
+ * drawables without loss.
+ *
+ * Since: GIMP 2.10
+ */
+void
+gimp_drawable_iterate (gint32                drawable_ID,
+                       const Babl           *format,
+                       GimpDrawableIterFunc  func,
+                       gpointer              data,
+                       gboolean              show_progress)
+{
+  GimpDrawableIterChunk *chunks;
+  GThreadPool           *pool;
+  GeglBuffer            *buffer;
+  GeglBuffer            *shadow;
+  gint                   x, y, width, height;
+  gint                   bpp;
+  gint                   n_threads;
+  gint                   n_chunks;
+  gint                   n_queued;
+  gint                   row;
+  gint                   i;
+
+  g_return_if_fail (func != NULL);
+
+  if (! gimp_drawable_mask_intersect (drawable_ID, &x, &y, &width, &height))
+    return;
+
+  if (! format)
+    format = gimp_drawable_get_format (drawable_ID);
+
+  bpp = babl_format_get_bytes_per_pixel (format);
+
+  buffer = gimp_drawable_get_buffer (drawable_ID);
+  shadow = gimp_drawable_get_shadow_buffer (drawable_ID);
+
+  /*  the bands end at tile rows, so each tile is transferred only once  */
+  n_chunks = (((y + height + TILE_HEIGHT - 1) / TILE_HEIGHT) -
+              (y / TILE_HEIGHT));
+
+  chunks = g_new0 (GimpDrawableIterChunk, n_chunks);
+
+  for (i = 0, row = y; i < n_chunks; i++)
+    {
+      gint next = MIN ((row / TILE_HEIGHT + 1) * TILE_HEIGHT, y + height);
+
+      chunks[i].rect.x      = x;
+      chunks[i].rect.y      = row;
+      chunks[i].rect.width  = width;
+      chunks[i].rect.height = next - row;
+      chunks[i].func        = func;
+      chunks[i].data        = data;
+
+      row = next;
+    }
+
+  n_threads = CLAMP (g_get_num_processors (), 1, n_chunks);
+
+  pool = g_thread_pool_new ((GFunc) gimp_drawable_iterate_chunk, NULL,
+                            n_threads, FALSE, NULL);
+
+  /*  read a few bands ahead, so the threads don't wait for the wire  */
+  n_queued = 0;
+
+  for (i = 0; i < n_chunks; i++)
+    {
+      GimpDrawableIterChunk *chunk = &chunks[i];
+
+      while (n_queued < n_chunks && n_queued < i + 2 * n_threads)
+        {
+          GimpDrawableIterChunk *next = &chunks[n_queued];
+          gsize                  size;
+          guchar                *src;
+
+          size = next->rect.width * next->rect.height * bpp;
+          src  = g_malloc (size);
+
+          gegl_buffer_get (buffer, &next->rect, 1.0, format, src,
+                           GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+          next->src  = src;
+          next->dest = g_malloc (size);
+
+          g_thread_pool_push (pool, next, NULL);
+          n_queued++;
+        }
+
+      g_mutex_lock (&iter_mutex);
+      while (! chunk->done)
+        g_cond_wait (&iter_cond, &iter_mutex);
+      g_mutex_unlock (&iter_mutex);
+
+      gegl_buffer_set (shadow, &chunk->rect, 0, format, chunk->dest,
+                       GEGL_AUTO_ROWSTRIDE);
+
+      g_free ((guchar *) chunk->src);
+      g_free (chunk->dest);
+
+      if (show_progress)
+        gimp_progress_update ((gdouble) (i + 1) / n_chunks);
+    }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+  g_free (chunks);
+
+  g_object_unref (buffer);
+  g_object_unref (shadow);
+
+  gimp_drawable_merge_shadow (drawable_ID, TRUE);
+  gimp_drawable_update (drawable_ID, x, y, width, height);
+}
@@ -29,6 +29,12 @@ G_BEGIN_DECLS
 
 /* For information look into the C source or the html documentation */
 
+typedef void (* GimpDrawableIterFunc) (const GeglRectangle *rect,
+                                       const guchar        *src,
+                                       guchar              *dest,
+                                       gpointer             data);
+
+
 struct _GimpDrawable
 {
   gint32    drawable_id;   /* drawable ID */
@@ -47,6 +53,12 @@ GeglBuffer   * gimp_drawable_get_shadow_buffer      (gint32         drawable_ID)
 
 const Babl   * gimp_drawable_get_format             (gint32         drawable_ID);
 
+void           gimp_drawable_iterate                (gint32                drawable_ID,
+                                                     const Babl           *format,
+                                                     GimpDrawableIterFunc  func,
+                                                     gpointer              data,
+                                                     gboolean              show_progress);
+
 GIMP_DEPRECATED_FOR(gimp_drawable_get_buffer)
 GimpDrawable * gimp_drawable_get                    (gint32         drawable_ID);
 GIMP_DEPRECATED
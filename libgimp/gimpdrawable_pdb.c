@@ -735,6 +735,225 @@ gimp_drawable_set_pixel (gint32        drawable_ID,
   return success;
 }
 
+/**
+ * gimp_drawable_get_pixels:
+ * @drawable_ID: The drawable.
+ * @num_coords: The number of coordinates, twice the number of pixels.
+ * @coords: The x and y coordinates of the pixels.
+ * @num_bytes: The number of bytes of the pixel values.
+ *
+ * Gets the values of the pixels at a list of coordinates.
+ *
+ * This procedure gets the values of a number of pixels at once, it
+ * works like calling gimp_drawable_get_pixel() for each of the pixels,
+ * but needs only a single procedure call. The coordinates are passed
+ * as x,y pairs, the pixel values are returned in the same order, each
+ * of them bytes-per-pixel bytes long.
+ *
+ * Returns: The pixel values.
+ *
+ * Since: GIMP 2.10
+ **/
+guint8 *
+gimp_drawable_get_pixels (gint32      drawable_ID,
+                          gint        num_coords,
+                          const gint *coords,
+                          gint       *num_bytes)
+{
+  GimpParam *return_vals;
+  gint nreturn_vals;
+  guint8 *pixels = NULL;
+
+  return_vals = gimp_run_procedure ("gimp-drawable-get-pixels",
+                                    &nreturn_vals,
+                                    GIMP_PDB_DRAWABLE, drawable_ID,
+                                    GIMP_PDB_INT32, num_coords,
+                                    GIMP_PDB_INT32ARRAY, coords,
+                                    GIMP_PDB_END);
+
+  *num_bytes = 0;
+
+  if (return_vals[0].data.d_status == GIMP_PDB_SUCCESS)
+    {
+      *num_bytes = return_vals[1].data.d_int32;
+      pixels = g_new (guint8, *num_bytes);
+      memcpy (pixels,
+              return_vals[2].data.d_int8array,
+              *num_bytes * sizeof (guint8));
+    }
+
+  gimp_destroy_params (return_vals, nreturn_vals);
+
+  return pixels;
+}
+
+/**
+ * gimp_drawable_set_pixels:
+ * @drawable_ID: The drawable.
+ * @num_coords: The number of coordinates, twice the number of pixels.
+ * @coords: The x and y coordinates of the pixels.
+ * @num_bytes: The number of bytes of the pixel values.
+ * @pixels: The pixel values.
+ *
+ * Sets the values of the pixels at a list of coordinates.
+ *
+ * This procedure sets the values of a number of pixels at once, it
+ * works like calling gimp_drawable_set_pixel() for each of the pixels,
+ * but needs only a single procedure call. The coordinates are passed
+ * as x,y pairs, the pixel values in the same order, each of them
+ * bytes-per-pixel bytes long. Note that this function is not undoable,
+ * you should use it only on drawables you just created yourself.
+ *
+ * Returns: TRUE on success.
+ *
+ * Since: GIMP 2.10
+ **/
+gboolean
+gimp_drawable_set_pixels (gint32        drawable_ID,
+                          gint          num_coords,
+                          const gint   *coords,
+                          gint          num_bytes,
+                          const guint8 *pixels)
+{
+  GimpParam *return_vals;
+  gint nreturn_vals;
+  gboolean success = TRUE;
+
+  return_vals = gimp_run_procedure ("gimp-drawable-set-pixels",
+                                    &nreturn_vals,
+                                    GIMP_PDB_DRAWABLE, drawable_ID,
+                                    GIMP_PDB_INT32, num_coords,
+                                    GIMP_PDB_INT32ARRAY, coords,
+                                    GIMP_PDB_INT32, num_bytes,
+                                    GIMP_PDB_INT8ARRAY, pixels,
+                                    GIMP_PDB_END);
+
+  success = return_vals[0].data.d_status == GIMP_PDB_SUCCESS;
+
+  gimp_destroy_params (return_vals, nreturn_vals);
+
+  return success;
+}
+
+/**
+ * gimp_drawable_get_rect:
+ * @drawable_ID: The drawable.
+ * @x: The x coordinate of the rectangle.
+ * @y: The y coordinate of the rectangle.
+ * @width: The width of the rectangle.
+ * @height: The height of the rectangle.
+ * @format_name: The Babl format of the pixels, or an empty string.
+ * @num_bytes: The number of bytes of the pixels.
+ *
+ * Gets the pixels of a rectangle in a given format.
+ *
+ * This procedure returns the pixels of a rectangle of the drawable,
+ * converted to the Babl format @format_name, like \"R'G'B'A u8\" or
+ * \"Y float\". Pass an empty string to get the pixels in the
+ * drawable's own format, see gimp_drawable_get_pixel(). The rows are
+ * returned top to bottom without any padding.
+ *
+ * Returns: The pixels of the rectangle.
+ *
+ * Since: GIMP 2.10
+ **/
+guint8 *
+gimp_drawable_get_rect (gint32       drawable_ID,
+                        gint         x,
+                        gint         y,
+                        gint         width,
+                        gint         height,
+                        const gchar *format_name,
+                        gint        *num_bytes)
+{
+  GimpParam *return_vals;
+  gint nreturn_vals;
+  guint8 *data = NULL;
+
+  return_vals = gimp_run_procedure ("gimp-drawable-get-rect",
+                                    &nreturn_vals,
+                                    GIMP_PDB_DRAWABLE, drawable_ID,
+                                    GIMP_PDB_INT32, x,
+                                    GIMP_PDB_INT32, y,
+                                    GIMP_PDB_INT32, width,
+                                    GIMP_PDB_INT32, height,
+                                    GIMP_PDB_STRING, format_name,
+                                    GIMP_PDB_END);
+
+  *num_bytes = 0;
+
+  if (return_vals[0].data.d_status == GIMP_PDB_SUCCESS)
+    {
+      *num_bytes = return_vals[1].data.d_int32;
+      data = g_new (guint8, *num_bytes);
+      memcpy (data,
+              return_vals[2].data.d_int8array,
+              *num_bytes * sizeof (guint8));
+    }
+
+  gimp_destroy_params (return_vals, nreturn_vals);
+
+  return data;
+}
+
+/**
+ * gimp_drawable_set_rect:
+ * @drawable_ID: The drawable.
+ * @x: The x coordinate of the rectangle.
+ * @y: The y coordinate of the rectangle.
+ * @width: The width of the rectangle.
+ * @height: The height of the rectangle.
+ * @format_name: The Babl format of the pixels, or an empty string.
+ * @num_bytes: The number of bytes of the pixels.
+ * @data: The pixels of the rectangle.
+ *
+ * Sets the pixels of a rectangle from a given format.
+ *
+ * This procedure replaces the pixels of a rectangle of the drawable
+ * with @data, which is converted from the Babl format @format_name,
+ * like \"R'G'B'A u8\" or \"Y float\". Pass an empty string if @data is
+ * in the drawable's own format, see gimp_drawable_set_pixel(). The
+ * rows are passed top to bottom without any padding. Note that this
+ * function is not undoable, you should use it only on drawables you
+ * just created yourself.
+ *
+ * Returns: TRUE on success.
+ *
+ * Since: GIMP 2.10
+ **/
+gboolean
+gimp_drawable_set_rect (gint32        drawable_ID,
+                        gint          x,
+                        gint          y,
+                        gint          width,
+                        gint          height,
+                        const gchar  *format_name,
+                        gint          num_bytes,
+                        const guint8 *data)
+{
+  GimpParam *return_vals;
+  gint nreturn_vals;
+  gboolean success = TRUE;
+
+  return_vals = gimp_run_procedure ("gimp-drawable-set-rect",
+                                    &nreturn_vals,
+                                    GIMP_PDB_DRAWABLE, drawable_ID,
+                                    GIMP_PDB_INT32, x,
+                                    GIMP_PDB_INT32, y,
+                                    GIMP_PDB_INT32, width,
+                                    GIMP_PDB_INT32, height,
+                                    GIMP_PDB_STRING, format_name,
+                                    GIMP_PDB_INT32, num_bytes,
+                                    GIMP_PDB_INT8ARRAY, data,
+                                    GIMP_PDB_END);
+
+  success = return_vals[0].data.d_status == GIMP_PDB_SUCCESS;
+
+  gimp_destroy_params (return_vals, nreturn_vals);
+
+  return success;
+}
+
 /**
  * gimp_drawable_fill:
  * @drawable_ID: The drawable.
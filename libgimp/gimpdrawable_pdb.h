@@ -75,6 +75,30 @@ gboolean                 gimp_drawable_set_pixel          (gint32
                                                            gint                        y_coord,
                                                            gint                        num_channels,
                                                            const guint8               *pixel);
+guint8*                  gimp_drawable_get_pixels         (gint32                      drawable_ID,
+                                                           gint                        num_coords,
+                                                           const gint                 *coords,
+                                                           gint                       *num_bytes);
+gboolean                 gimp_drawable_set_pixels         (gint32                      drawable_ID,
+                                                           gint                        num_coords,
+                                                           const gint                 *coords,
+                                                           gint                        num_bytes,
+                                                           const guint8               *pixels);
+guint8*                  gimp_drawable_get_rect           (gint32                      drawable_ID,
+                                                           gint                        x,
+                                                           gint                        y,
+                                                           gint                        width,
+                                                           gint                        height,
+                                                           const gchar                *format_name,
+                                                           gint                       *num_bytes);
+gboolean                 gimp_drawable_set_rect           (gint32                      drawable_ID,
+                                                           gint                        x,
+                                                           gint                        y,
+                                                           gint                        width,
+                                                           gint                        height,
+                                                           const gchar                *format_name,
+                                                           gint                        num_bytes,
+                                                           const guint8               *data);
 gboolean                 gimp_drawable_fill               (gint32                      drawable_ID,
                                                            GimpFillType                fill_type);
 gboolean                 gimp_drawable_offset             (gint32                      drawable_ID,
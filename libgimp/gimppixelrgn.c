@@ -41,6 +41,11 @@
 #define TILE_WIDTH  gimp_tile_width()
 #define TILE_HEIGHT gimp_tile_height()
 
+/*  rectangles of at least this many pixels are transferred through a
+ *  shared memory region in one go, smaller ones through the tile cache
+ */
+#define REGION_MIN_PIXELS (4 * TILE_WIDTH * TILE_HEIGHT)
+
 
 typedef struct _GimpPixelRgnHolder    GimpPixelRgnHolder;
 typedef struct _GimpPixelRgnIterator  GimpPixelRgnIterator;
@@ -70,6 +75,23 @@ static gint     gimp_get_portion_height   (GimpPixelRgnIterator *pri);
 static gpointer gimp_pixel_rgns_configure (GimpPixelRgnIterator *pri);
 static void     gimp_pixel_rgn_configure  (GimpPixelRgnHolder   *prh,
                                            GimpPixelRgnIterator *pri);
+static GimpTile ** gimp_pixel_rgn_get_tiles (GimpPixelRgn      *pr,
+                                             gint               x,
+                                             gint               y,
+                                             gint               width,
+                                             gint               height,
+                                             gint              *n_tiles);
+static GimpTile ** gimp_pixel_rgn_ref_tiles (GimpPixelRgn      *pr,
+                                             gint               x,
+                                             gint               y,
+                                             gint               width,
+                                             gint               height,
+                                             gint              *n_tiles);
+static void        gimp_pixel_rgn_prefetch  (GimpPixelRgn      *pr,
+                                             gint               x,
+                                             gint               y,
+                                             gint               width,
+                                             gint               height);
 
 /**
  * gimp_pixel_rgn_init:
@@ -242,6 +264,8 @@ gimp_pixel_rgn_get_row (GimpPixelRgn *pr,
   g_return_if_fail (y >= 0 && y < pr->drawable->height);
   g_return_if_fail (width >= 0);
 
+  gimp_pixel_rgn_prefetch (pr, x, y, width, 1);
+
   end = x + width;
 
   while (x < end)
@@ -299,6 +323,8 @@ gimp_pixel_rgn_get_col (GimpPixelRgn *pr,
   g_return_if_fail (y >= 0 && y + height <= pr->drawable->height);
   g_return_if_fail (height >= 0);
 
+  gimp_pixel_rgn_prefetch (pr, x, y, 1, height);
+
   end = y + height;
 
   while (y < end)
@@ -359,6 +385,8 @@ gimp_pixel_rgn_get_rect (GimpPixelRgn *pr,
   gint    yboundary;
   gint    xstep, ystep;
   gint    ty, bpp;
+  GimpTile **tiles;
+  gint       n_tiles;
 
   g_return_if_fail (pr != NULL && pr->drawable != NULL);
   g_return_if_fail (buf != NULL);
@@ -370,6 +398,19 @@ gimp_pixel_rgn_get_rect (GimpPixelRgn *pr,
   bpp = pr->bpp;
   bufstride = bpp * width;
 
+  if ((gint64) width * height >= REGION_MIN_PIXELS)
+    {
+      gint n_rows = _gimp_tile_get_region (pr->drawable, pr->shadow,
+                                           x, y, width, height, buf);
+
+      buf    += n_rows * bufstride;
+      y      += n_rows;
+      height -= n_rows;
+    }
+
+  /*  fetch all missing tiles at once, the loop below only uses them  */
+  tiles = gimp_pixel_rgn_ref_tiles (pr, x, y, width, height, &n_tiles);
+
   xstart = x;
   ystart = y;
   xend = x + width;
@@ -385,7 +426,6 @@ gimp_pixel_rgn_get_rect (GimpPixelRgn *pr,
           GimpTile *tile;
 
           tile = gimp_drawable_get_tile2 (pr->drawable, pr->shadow, x, y);
-          gimp_tile_ref (tile);
 
           xstep = tile->ewidth - (x % TILE_WIDTH);
           ystep = tile->eheight - (y % TILE_HEIGHT);
@@ -412,6 +452,8 @@ gimp_pixel_rgn_get_rect (GimpPixelRgn *pr,
 
       y += ystep;
     }
+
+  g_free (tiles);
 }
 
 /**
@@ -481,6 +523,8 @@ gimp_pixel_rgn_set_row (GimpPixelRgn *pr,
   g_return_if_fail (y >= 0 && y < pr->drawable->height);
   g_return_if_fail (width >= 0);
 
+  gimp_pixel_rgn_prefetch (pr, x, y, width, 1);
+
   end = x + width;
 
   while (x < end)
@@ -532,6 +576,8 @@ gimp_pixel_rgn_set_col (GimpPixelRgn *pr,
   g_return_if_fail (y >= 0 && y + height <= pr->drawable->height);
   g_return_if_fail (height >= 0);
 
+  gimp_pixel_rgn_prefetch (pr, x, y, 1, height);
+
   end = y + height;
 
   while (y < end)
@@ -593,6 +639,11 @@ gimp_pixel_rgn_set_rect (GimpPixelRgn *pr,
   gint    yboundary;
   gint    xstep, ystep;
   gint    ty, bpp;
+  GimpTile **tiles;
+  GimpTile **flush;
+  gint       n_tiles;
+  gint       n_flush = 0;
+  gint       i;
 
   g_return_if_fail (pr != NULL && pr->drawable != NULL);
   g_return_if_fail (buf != NULL);
@@ -604,6 +655,19 @@ gimp_pixel_rgn_set_rect (GimpPixelRgn *pr,
   bpp = pr->bpp;
   bufstride = bpp * width;
 
+  if ((gint64) width * height >= REGION_MIN_PIXELS)
+    {
+      gint n_rows = _gimp_tile_put_region (pr->drawable, pr->shadow,
+                                           x, y, width, height, buf);
+
+      buf    += n_rows * bufstride;
+      y      += n_rows;
+      height -= n_rows;
+    }
+
+  /*  fetch all missing tiles at once, the loop below only uses them  */
+  tiles = gimp_pixel_rgn_ref_tiles (pr, x, y, width, height, &n_tiles);
+
   xstart = x;
   ystart = y;
   xend = x + width;
@@ -619,7 +683,6 @@ gimp_pixel_rgn_set_rect (GimpPixelRgn *pr,
           GimpTile *tile;
 
           tile = gimp_drawable_get_tile2 (pr->drawable, pr->shadow, x, y);
-          gimp_tile_ref (tile);
 
           xstep = tile->ewidth - (x % TILE_WIDTH);
           ystep = tile->eheight - (y % TILE_HEIGHT);
@@ -640,12 +703,29 @@ gimp_pixel_rgn_set_rect (GimpPixelRgn *pr,
               memcpy (dest, src, (xboundary - x) * bpp);
             }
 
-          gimp_tile_unref (tile, TRUE);
+          tile->dirty = TRUE;
           x += xstep;
         }
 
       y += ystep;
     }
+
+  /*  write back the tiles the cache doesn't hold on to in one go,
+   *  instead of one at a time when they are unreferenced
+   */
+  flush = g_new (GimpTile *, n_tiles);
+
+  for (i = 0; i < n_tiles; i++)
+    if (tiles[i]->ref_count == 1 || ! _gimp_tile_cache_is_write_back ())
+      flush[n_flush++] = tiles[i];
+
+  _gimp_tiles_flush (flush, n_flush);
+
+  for (i = 0; i < n_tiles; i++)
+    gimp_tile_unref (tiles[i], FALSE);
+
+  g_free (flush);
+  g_free (tiles);
 }
 
 /**
@@ -940,6 +1020,13 @@ gimp_pixel_rgn_configure (GimpPixelRgnHolder   *prh,
       gint      offx;
       gint      offy;
 
+      /*  the iterator walks the region row by row, so fetch the rest
+       *  of a row of tiles when entering it
+       */
+      if (prh->pr->x == prh->startx)
+        gimp_pixel_rgn_prefetch (prh->pr, prh->startx, prh->pr->y,
+                                 pri->region_width, 1);
+
       tile = gimp_drawable_get_tile2 (prh->pr->drawable,
                                       prh->pr->shadow,
                                       prh->pr->x,
@@ -963,3 +1050,76 @@ gimp_pixel_rgn_configure (GimpPixelRgnHolder   *prh,
   prh->pr->w = pri->portion_width;
   prh->pr->h = pri->portion_height;
 }
+
+/*  returns the tiles covering the rectangle, row by row  */
+static GimpTile **
+gimp_pixel_rgn_get_tiles (GimpPixelRgn *pr,
+                          gint          x,
+                          gint          y,
+                          gint          width,
+                          gint          height,
+                          gint         *n_tiles)
+{
+  GimpTile **tiles;
+  gint       row, col;
+  gint       i = 0;
+
+  *n_tiles = 0;
+
+  if (width == 0 || height == 0)
+    return NULL;
+
+  *n_tiles = (((x + width  - 1) / TILE_WIDTH  - x / TILE_WIDTH  + 1) *
+              ((y + height - 1) / TILE_HEIGHT - y / TILE_HEIGHT + 1));
+
+  tiles = g_new (GimpTile *, *n_tiles);
+
+  for (row = y / TILE_HEIGHT; row <= (y + height - 1) / TILE_HEIGHT; row++)
+    for (col = x / TILE_WIDTH; col <= (x + width - 1) / TILE_WIDTH; col++)
+      tiles[i++] = gimp_drawable_get_tile (pr->drawable, pr->shadow, row, col);
+
+  return tiles;
+}
+
+static GimpTile **
+gimp_pixel_rgn_ref_tiles (GimpPixelRgn *pr,
+                          gint          x,
+                          gint          y,
+                          gint          width,
+                          gint          height,
+                          gint         *n_tiles)
+{
+  GimpTile **tiles = gimp_pixel_rgn_get_tiles (pr, x, y, width, height,
+                                               n_tiles);
+
+  _gimp_tile_cache_hint (*n_tiles);
+  _gimp_tiles_ref (tiles, *n_tiles);
+
+  return tiles;
+}
+
+/*  Makes room in the cache for the tiles covering the rectangle and
+ *  whatever the same access pattern touches next, that is the source
+ *  and destination tiles of neighbouring rows or columns, and fetches
+ *  the ones that are missing in one go.
+ */
+static void
+gimp_pixel_rgn_prefetch (GimpPixelRgn *pr,
+                         gint          x,
+                         gint          y,
+                         gint          width,
+                         gint          height)
+{
+  GimpTile **tiles;
+  gint       n_tiles;
+
+  tiles = gimp_pixel_rgn_get_tiles (pr, x, y, width, height, &n_tiles);
+
+  if (n_tiles > 1)
+    {
+      _gimp_tile_cache_hint (4 * n_tiles);
+      _gimp_tile_cache_prefetch (tiles, n_tiles);
+    }
+
+  g_free (tiles);
+}
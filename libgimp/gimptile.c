@@ -48,15 +48,70 @@
  */
 #define FREE_QUANTUM 0.1
 
+/*  Regions are transferred in bands of at most this many bytes, so
+ *  the shared memory segment the core creates for them stays bounded.
+ */
+#define REGION_MAX_SIZE (64 * 1024 * 1024)
+
+/*  Tiles are requested in batches of at most TILES_BATCH_SIZE tiles,
+ *  and up to TILES_MAX_PENDING batches are requested before waiting
+ *  for the first answer, so the core prepares the next batch while
+ *  we read the previous one.
+ */
+#define TILES_BATCH_SIZE  16
+#define TILES_MAX_PENDING 2
+
+/*  Unless the plug-in sets the cache size itself, the cache grows to
+ *  what the pixel regions being accessed need, but never beyond this
+ *  fraction of the core's tile cache size, or CACHE_MAX_SIZE if the
+ *  core didn't tell us its size.
+ */
+#define CACHE_HOST_FRACTION 4
+#define CACHE_MAX_SIZE      (64 * 1024 * 1024)
+
+#define TILE_WIDTH  gimp_tile_width()
+#define TILE_HEIGHT gimp_tile_height()
+
 
 void         gimp_read_expect_msg   (GimpWireMessage *msg,
                                      gint             type);
 
+G_GNUC_INTERNAL guchar * _gimp_shm_region_addr (gint  shm_ID,
+                                                gsize size);
+
 static void  gimp_tile_get          (GimpTile        *tile);
 static void  gimp_tile_put          (GimpTile        *tile);
 static void  gimp_tile_cache_insert (GimpTile        *tile);
 static void  gimp_tile_cache_flush  (GimpTile        *tile);
 
+static gint  gimp_tiles_batch_size  (GimpTile       **tiles,
+                                     gint             n_tiles);
+static void  gimp_tiles_get_request (GimpTile       **tiles,
+                                     gint             n_tiles);
+static void  gimp_tiles_get_receive (GimpTile       **tiles,
+                                     gint             n_tiles);
+static void  gimp_tiles_get         (GimpTile       **tiles,
+                                     gint             n_tiles);
+static void  gimp_tiles_put         (GimpTile       **tiles,
+                                     gint             n_tiles);
+
+static gint      gimp_tile_region_transfer (GimpDrawable *drawable,
+                                            gboolean      shadow,
+                                            gboolean      put,
+                                            gint          x,
+                                            gint          y,
+                                            gint          width,
+                                            gint          height,
+                                            guchar       *buf);
+static void      gimp_tile_region_sync     (GimpDrawable *drawable,
+                                            gboolean      shadow,
+                                            gboolean      put,
+                                            gint          x,
+                                            gint          y,
+                                            gint          width,
+                                            gint          height,
+                                            guchar       *buf);
+
 
 /*  private variables  */
 
@@ -66,6 +121,8 @@ static GList      * tile_list_tail  = NULL;
 static gulong       max_tile_size   = 0;
 static gulong       cur_cache_size  = 0;
 static gulong       max_cache_size  = 0;
+static gboolean     cache_size_set  = FALSE;
+static guint64      host_cache_size = 0;
 
 
 /*  public functions  */
@@ -115,6 +172,13 @@ gimp_tile_unref (GimpTile *tile,
       g_free (tile->data);
       tile->data = NULL;
     }
+  else if (tile->ref_count == 1 && ! _gimp_tile_cache_is_write_back ())
+    {
+      /*  a cache the plug-in didn't ask for keeps only clean tiles,
+       *  so plug-ins that don't flush their drawables keep working
+       */
+      gimp_tile_flush (tile);
+    }
 }
 
 void
@@ -136,11 +200,16 @@ gimp_tile_flush (GimpTile *tile)
  * Sets the size of the tile cache on the plug-in side. The tile cache
  * is used to reduce the number of tiles exchanged between the GIMP core
  * and the plug-in. See also gimp_tile_cache_ntiles().
+ *
+ * If this function is never called, the cache sizes itself to the
+ * pixel regions being accessed, limited by the core's tile cache size,
+ * and only keeps tiles that are not dirty.
  **/
 void
 gimp_tile_cache_size (gulong kilobytes)
 {
   max_cache_size = kilobytes * 1024;
+  cache_size_set = TRUE;
 }
 
 /**
@@ -184,9 +253,358 @@ _gimp_tile_cache_flush_drawable (GimpDrawable *drawable)
     }
 }
 
+void
+_gimp_tile_cache_set_host_size (guint64 size)
+{
+  host_cache_size = size;
+}
+
+/*  whether dirty tiles may stay in the cache, that is only if the
+ *  plug-in sized the cache itself
+ */
+gboolean
+_gimp_tile_cache_is_write_back (void)
+{
+  return cache_size_set;
+}
+
+/*  Grows the cache so it holds at least ntiles tiles, unless the
+ *  plug-in chose a cache size with gimp_tile_cache_size().  Returns
+ *  the number of tiles that can be added to the cache without evicting
+ *  any.
+ */
+gulong
+_gimp_tile_cache_hint (gulong ntiles)
+{
+  gulong tile_size = gimp_tile_width () * gimp_tile_height () * 4;
+
+  if (! cache_size_set)
+    {
+      guint64 limit = CACHE_MAX_SIZE;
+      guint64 size  = (guint64) ntiles * tile_size;
+
+      if (host_cache_size)
+        limit = host_cache_size / CACHE_HOST_FRACTION;
+
+      size = MIN (size, limit);
+
+      if (size > max_cache_size)
+        max_cache_size = size;
+    }
+
+  if (cur_cache_size + tile_size > max_cache_size)
+    return 0;
+
+  return (max_cache_size - cur_cache_size) / tile_size;
+}
+
+/*  Fetches those of the tiles that are not in memory yet into the
+ *  cache, as far as it has room for them without evicting other tiles.
+ */
+void
+_gimp_tile_cache_prefetch (GimpTile **tiles,
+                           gint       n_tiles)
+{
+  GimpTile **missing;
+  gulong     room;
+  gint       n_missing = 0;
+  gint       i;
+
+  g_return_if_fail (tiles != NULL || n_tiles == 0);
+
+  room = _gimp_tile_cache_hint (0);
+
+  if (room == 0)
+    return;
+
+  missing = g_new (GimpTile *, n_tiles);
+
+  for (i = 0; i < n_tiles && n_missing < room; i++)
+    {
+      if (! tiles[i]->data)
+        missing[n_missing++] = tiles[i];
+    }
+
+  _gimp_tiles_ref (missing, n_missing);
+
+  /*  the cache holds on to them  */
+  for (i = 0; i < n_missing; i++)
+    gimp_tile_unref (missing[i], FALSE);
+
+  g_free (missing);
+}
+
+/*  Reads the rectangle x, y, width, height of the drawable into buf
+ *  through a shared memory segment sized to the request, with one
+ *  message per band instead of one per tile.  Returns the number of
+ *  rows transferred, the caller has to read the remaining rows
+ *  through tiles.
+ */
+gint
+_gimp_tile_get_region (GimpDrawable *drawable,
+                       gboolean      shadow,
+                       gint          x,
+                       gint          y,
+                       gint          width,
+                       gint          height,
+                       guchar       *buf)
+{
+  g_return_val_if_fail (drawable != NULL, 0);
+  g_return_val_if_fail (buf != NULL, 0);
+
+  return gimp_tile_region_transfer (drawable, shadow, FALSE,
+                                    x, y, width, height, buf);
+}
+
+gint
+_gimp_tile_put_region (GimpDrawable *drawable,
+                       gboolean      shadow,
+                       gint          x,
+                       gint          y,
+                       gint          width,
+                       gint          height,
+                       const guchar *buf)
+{
+  g_return_val_if_fail (drawable != NULL, 0);
+  g_return_val_if_fail (buf != NULL, 0);
+
+  return gimp_tile_region_transfer (drawable, shadow, TRUE,
+                                    x, y, width, height, (guchar *) buf);
+}
+
+/*  References all tiles like gimp_tile_ref(), but fetches the ones
+ *  not in memory yet with a few batched, pipelined requests instead of
+ *  one round trip per tile.
+ */
+void
+_gimp_tiles_ref (GimpTile **tiles,
+                 gint       n_tiles)
+{
+  GimpTile **missing;
+  gint       n_missing = 0;
+  gint       i;
+
+  g_return_if_fail (tiles != NULL || n_tiles == 0);
+
+  missing = g_new (GimpTile *, n_tiles);
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      GimpTile *tile = tiles[i];
+
+      tile->ref_count++;
+
+      if (tile->ref_count == 1)
+        {
+          missing[n_missing++] = tile;
+          tile->dirty = FALSE;
+        }
+    }
+
+  gimp_tiles_get (missing, n_missing);
+
+  g_free (missing);
+
+  for (i = 0; i < n_tiles; i++)
+    gimp_tile_cache_insert (tiles[i]);
+}
+
+/*  Writes all dirty tiles back to the core like gimp_tile_flush(),
+ *  with one message per batch of tiles that is not acknowledged.
+ */
+void
+_gimp_tiles_flush (GimpTile **tiles,
+                   gint       n_tiles)
+{
+  GimpTile **dirty;
+  gint       n_dirty = 0;
+  gint       i;
+
+  g_return_if_fail (tiles != NULL || n_tiles == 0);
+
+  dirty = g_new (GimpTile *, n_tiles);
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      GimpTile *tile = tiles[i];
+
+      if (tile->data && tile->dirty)
+        {
+          dirty[n_dirty++] = tile;
+          tile->dirty = FALSE;
+        }
+    }
+
+  gimp_tiles_put (dirty, n_dirty);
+
+  g_free (dirty);
+}
+
 
 /*  private functions  */
 
+static gint
+gimp_tile_region_transfer (GimpDrawable *drawable,
+                           gboolean      shadow,
+                           gboolean      put,
+                           gint          x,
+                           gint          y,
+                           gint          width,
+                           gint          height,
+                           guchar       *buf)
+{
+  extern GIOChannel *_writechannel;
+
+  gsize stride = (gsize) width * drawable->bpp;
+  gint  band_height;
+  gint  band_y;
+
+  if (gimp_shm_ID () == -1 || width == 0 || height == 0)
+    return 0;
+
+  band_height = CLAMP (REGION_MAX_SIZE / stride, 1, height);
+
+  if (band_height * stride > REGION_MAX_SIZE)
+    return 0;
+
+  for (band_y = y; band_y < y + height; band_y += band_height)
+    {
+      GPRegionReq      region_req;
+      GPRegionData    *region_data;
+      GimpWireMessage  msg;
+      guchar          *band_buf;
+      guchar          *shm_addr = NULL;
+      gint             h;
+
+      h        = MIN (band_height, y + height - band_y);
+      band_buf = buf + (band_y - y) * stride;
+
+      /*  keep the tiles cached here consistent with the core  */
+      if (! put)
+        gimp_tile_region_sync (drawable, shadow, FALSE,
+                               x, band_y, width, h, band_buf);
+
+      region_req.drawable_ID = drawable->drawable_id;
+      region_req.shadow      = shadow;
+      region_req.put         = put;
+      region_req.x           = x;
+      region_req.y           = band_y;
+      region_req.width       = width;
+      region_req.height      = h;
+
+      if (! gp_region_req_write (_writechannel, &region_req, NULL))
+        gimp_quit ();
+
+      gimp_read_expect_msg (&msg, GP_REGION_DATA);
+
+      region_data = msg.data;
+
+      if (region_data->shm_ID != -1)
+        {
+          if (region_data->drawable_ID != drawable->drawable_id ||
+              region_data->x           != x                     ||
+              region_data->y           != band_y                ||
+              region_data->width       != width                 ||
+              region_data->height      != h                     ||
+              region_data->bpp         != drawable->bpp)
+            {
+              g_message ("received region info did not match "
+                         "computed region info");
+              gimp_quit ();
+            }
+
+          shm_addr = _gimp_shm_region_addr (region_data->shm_ID,
+                                            region_data->shm_size);
+        }
+
+      if (! put)
+        {
+          if (shm_addr)
+            memcpy (band_buf, shm_addr, h * stride);
+        }
+      else if (region_data->shm_ID != -1)
+        {
+          /*  the core waits for the segment to be filled  */
+          if (shm_addr)
+            memcpy (shm_addr, band_buf, h * stride);
+          else
+            region_data->drawable_ID = -1;
+
+          if (! gp_region_data_write (_writechannel, region_data, NULL))
+            gimp_quit ();
+
+          gimp_wire_destroy (&msg);
+
+          gimp_read_expect_msg (&msg, GP_TILE_ACK);
+        }
+
+      gimp_wire_destroy (&msg);
+
+      if (! shm_addr)
+        break;
+
+      if (put)
+        gimp_tile_region_sync (drawable, shadow, TRUE,
+                               x, band_y, width, h, band_buf);
+    }
+
+  return MIN (band_y, y + height) - y;
+}
+
+static void
+gimp_tile_region_sync (GimpDrawable *drawable,
+                       gboolean      shadow,
+                       gboolean      put,
+                       gint          x,
+                       gint          y,
+                       gint          width,
+                       gint          height,
+                       guchar       *buf)
+{
+  GimpTile *tiles  = shadow ? drawable->shadow_tiles : drawable->tiles;
+  gint      bpp    = drawable->bpp;
+  gsize     stride = (gsize) width * bpp;
+  gint      row, col;
+
+  if (! tiles)
+    return;
+
+  for (row = y / TILE_HEIGHT; row <= (y + height - 1) / TILE_HEIGHT; row++)
+    for (col = x / TILE_WIDTH; col <= (x + width - 1) / TILE_WIDTH; col++)
+      {
+        GimpTile *tile = &tiles[row * drawable->ntile_cols + col];
+        gint      tile_x;
+        gint      tile_y;
+        gint      x1, y1, x2, y2;
+        gint      ty;
+
+        if (! tile->data)
+          continue;
+
+        /*  dirty tiles must reach the core before it is read from  */
+        if (! put)
+          {
+            gimp_tile_flush (tile);
+            continue;
+          }
+
+        /*  and tiles we hold must see what was written around them  */
+        tile_x = col * TILE_WIDTH;
+        tile_y = row * TILE_HEIGHT;
+
+        x1 = MAX (x, tile_x);
+        y1 = MAX (y, tile_y);
+        x2 = MIN (x + width,  tile_x + tile->ewidth);
+        y2 = MIN (y + height, tile_y + tile->eheight);
+
+        for (ty = y1; ty < y2; ty++)
+          memcpy (tile->data +
+                  tile->bpp * (tile->ewidth * (ty - tile_y) + (x1 - tile_x)),
+                  buf + stride * (ty - y) + bpp * (x1 - x),
+                  (x2 - x1) * bpp);
+      }
+}
+
 static void
 gimp_tile_get (GimpTile *tile)
 {
@@ -283,6 +701,190 @@ gimp_tile_put (GimpTile *tile)
   gimp_wire_destroy (&msg);
 }
 
+/*  the number of tiles at the start of tiles that go into one batch,
+ *  all tiles of a batch belong to the same drawable
+ */
+static gint
+gimp_tiles_batch_size (GimpTile **tiles,
+                       gint       n_tiles)
+{
+  gint i;
+
+  for (i = 1; i < MIN (n_tiles, TILES_BATCH_SIZE); i++)
+    {
+      if (tiles[i]->drawable != tiles[0]->drawable ||
+          tiles[i]->shadow   != tiles[0]->shadow)
+        break;
+    }
+
+  return i;
+}
+
+static void
+gimp_tiles_get_request (GimpTile **tiles,
+                        gint       n_tiles)
+{
+  extern GIOChannel *_writechannel;
+
+  GPTilesReq  tiles_req;
+  guint32     tile_nums[TILES_BATCH_SIZE];
+  gint        i;
+
+  for (i = 0; i < n_tiles; i++)
+    tile_nums[i] = tiles[i]->tile_num;
+
+  tiles_req.drawable_ID = tiles[0]->drawable->drawable_id;
+  tiles_req.shadow      = tiles[0]->shadow;
+  tiles_req.n_tiles     = n_tiles;
+  tiles_req.tile_nums   = tile_nums;
+
+  if (! gp_tiles_req_write (_writechannel, &tiles_req, NULL))
+    gimp_quit ();
+}
+
+static void
+gimp_tiles_get_receive (GimpTile **tiles,
+                        gint       n_tiles)
+{
+  GPTilesData     *tiles_data;
+  GimpWireMessage  msg;
+  gsize            offset = 0;
+  gint             i;
+
+  gimp_read_expect_msg (&msg, GP_TILES_DATA);
+
+  tiles_data = msg.data;
+
+  if (tiles_data->drawable_ID != tiles[0]->drawable->drawable_id ||
+      tiles_data->shadow      != tiles[0]->shadow                ||
+      tiles_data->bpp         != tiles[0]->bpp                   ||
+      tiles_data->n_tiles     != n_tiles)
+    {
+      g_message ("received tile info did not match computed tile info");
+      gimp_quit ();
+    }
+
+  for (i = 0; i < n_tiles; i++)
+    {
+      GimpTile *tile = tiles[i];
+      gsize     size = tile->ewidth * tile->eheight * tile->bpp;
+
+      if (tiles_data->tile_nums[i] != tile->tile_num ||
+          offset + size > tiles_data->data_size)
+        {
+          g_message ("received tile info did not match computed tile info");
+          gimp_quit ();
+        }
+
+      tile->data = g_memdup (tiles_data->data + offset, size);
+      offset += size;
+    }
+
+  gimp_wire_destroy (&msg);
+}
+
+static void
+gimp_tiles_get (GimpTile **tiles,
+                gint       n_tiles)
+{
+  gint n_requested = 0;
+  gint n_received  = 0;
+  gint n_pending   = 0;
+
+  /*  a single tile doesn't benefit from batching  */
+  if (n_tiles == 1)
+    {
+      gimp_tile_get (tiles[0]);
+      return;
+    }
+
+  while (n_received < n_tiles)
+    {
+      gint n;
+
+      while (n_requested < n_tiles && n_pending < TILES_MAX_PENDING)
+        {
+          n = gimp_tiles_batch_size (tiles + n_requested,
+                                     n_tiles - n_requested);
+
+          gimp_tiles_get_request (tiles + n_requested, n);
+
+          n_requested += n;
+          n_pending++;
+        }
+
+      n = gimp_tiles_batch_size (tiles + n_received,
+                                 n_tiles - n_received);
+
+      gimp_tiles_get_receive (tiles + n_received, n);
+
+      n_received += n;
+      n_pending--;
+    }
+}
+
+static void
+gimp_tiles_put (GimpTile **tiles,
+                gint       n_tiles)
+{
+  extern GIOChannel *_writechannel;
+
+  gint i = 0;
+
+  if (n_tiles == 1)
+    {
+      gimp_tile_put (tiles[0]);
+      return;
+    }
+
+  while (i < n_tiles)
+    {
+      GPTilesData  tiles_data;
+      guint32      tile_nums[TILES_BATCH_SIZE];
+      gsize        size = 0;
+      guchar      *data;
+      gint         n;
+      gint         j;
+
+      n = gimp_tiles_batch_size (tiles + i, n_tiles - i);
+
+      for (j = 0; j < n; j++)
+        size += tiles[i + j]->ewidth * tiles[i + j]->eheight * tiles[i + j]->bpp;
+
+      data = g_malloc (size);
+      size = 0;
+
+      for (j = 0; j < n; j++)
+        {
+          GimpTile *tile      = tiles[i + j];
+          gsize     tile_size = tile->ewidth * tile->eheight * tile->bpp;
+
+          tile_nums[j] = tile->tile_num;
+
+          memcpy (data + size, tile->data, tile_size);
+          size += tile_size;
+        }
+
+      tiles_data.drawable_ID = tiles[i]->drawable->drawable_id;
+      tiles_data.shadow      = tiles[i]->shadow;
+      tiles_data.bpp         = tiles[i]->bpp;
+      tiles_data.n_tiles     = n;
+      tiles_data.tile_nums   = tile_nums;
+      tiles_data.data_size   = size;
+      tiles_data.data        = data;
+
+      /*  the core doesn't acknowledge batches, later messages are
+       *  only handled after the tiles are written
+       */
+      if (! gp_tiles_data_write (_writechannel, &tiles_data, NULL))
+        gimp_quit ();
+
+      g_free (data);
+
+      i += n;
+    }
+}
+
 /* This function is nearly identical to the function 'tile_cache_insert'
  *  in the file 'tile_cache.c' which is part of the main gimp application.
  */
@@ -63,6 +63,31 @@ void    gimp_tile_cache_ntiles (gulong     ntiles);
 /*  private function  */
 
 G_GNUC_INTERNAL void _gimp_tile_cache_flush_drawable (GimpDrawable *drawable);
+G_GNUC_INTERNAL void _gimp_tile_cache_set_host_size  (guint64       size);
+G_GNUC_INTERNAL gboolean _gimp_tile_cache_is_write_back (void);
+G_GNUC_INTERNAL gulong _gimp_tile_cache_hint         (gulong        ntiles);
+G_GNUC_INTERNAL void _gimp_tile_cache_prefetch       (GimpTile    **tiles,
+                                                      gint          n_tiles);
+
+G_GNUC_INTERNAL gint _gimp_tile_get_region (GimpDrawable *drawable,
+                                            gboolean      shadow,
+                                            gint          x,
+                                            gint          y,
+                                            gint          width,
+                                            gint          height,
+                                            guchar       *buf);
+G_GNUC_INTERNAL gint _gimp_tile_put_region (GimpDrawable *drawable,
+                                            gboolean      shadow,
+                                            gint          x,
+                                            gint          y,
+                                            gint          width,
+                                            gint          height,
+                                            const guchar *buf);
+
+G_GNUC_INTERNAL void _gimp_tiles_ref             (GimpTile     **tiles,
+                                                  gint           n_tiles);
+G_GNUC_INTERNAL void _gimp_tiles_flush           (GimpTile     **tiles,
+                                                  gint           n_tiles);
 
 
 G_END_DECLS
@@ -31,12 +31,23 @@
 #define TILE_WIDTH  gimp_tile_width()
 #define TILE_HEIGHT gimp_tile_width()
 
+/*  when a GEGL tile is missing, this many GEGL tiles along its row
+ *  are fetched with it
+ */
+#define READAHEAD_TILES    4
+
+/*  written GIMP tiles are sent to the core in groups of this many  */
+#define WRITE_BEHIND_TILES 32
+
 
 struct _GimpTileBackendPluginPrivate
 {
   GimpDrawable *drawable;
   gboolean      shadow;
   gint          mul;
+
+  GimpTile     *dirty_tiles[WRITE_BEHIND_TILES];
+  gint          n_dirty_tiles;
 };
 
 
@@ -77,6 +88,12 @@ static GeglTile * gimp_tile_read_mul (GimpTileBackendPlugin *backend_plugin,
                                       gint                   x,
                                       gint                   y);
 
+static void       gimp_tile_readahead (GimpTileBackendPlugin *backend_plugin,
+                                       gint                   x,
+                                       gint                   y);
+static void       gimp_tile_write_behind_flush
+                                      (GimpTileBackendPlugin *backend_plugin);
+
 
 G_DEFINE_TYPE (GimpTileBackendPlugin, _gimp_tile_backend_plugin,
                GEGL_TYPE_TILE_BACKEND)
@@ -113,6 +130,8 @@ gimp_tile_backend_plugin_finalize (GObject *object)
 {
   GimpTileBackendPlugin *backend = GIMP_TILE_BACKEND_PLUGIN (object);
 
+  gimp_tile_write_behind_flush (backend);
+
   if (backend->priv->drawable) /* This also causes a flush */
     gimp_drawable_detach (backend->priv->drawable);
 
@@ -140,6 +159,7 @@ gimp_tile_backend_plugin_command (GeglTileSource  *tile_store,
       break;
 
     case GEGL_TILE_FLUSH:
+      gimp_tile_write_behind_flush (backend_plugin);
       gimp_drawable_flush (backend_plugin->priv->drawable);
       break;
 
@@ -163,6 +183,8 @@ gimp_tile_read_mul (GimpTileBackendPlugin *backend_plugin,
   gint                          mul = priv->mul;
   guchar                       *tile_data;
 
+  gimp_tile_readahead (backend_plugin, x, y);
+
   x *= mul;
   y *= mul;
 
@@ -235,7 +257,9 @@ gimp_tile_write_mul (GimpTileBackendPlugin *backend_plugin,
           gimp_tile = gimp_drawable_get_tile (priv->drawable,
                                               priv->shadow,
                                               y+v, x+u);
-          gimp_tile_ref (gimp_tile);
+
+          /*  all of the tile is overwritten, don't fetch it  */
+          gimp_tile_ref_zero (gimp_tile);
 
           {
             gint ewidth           = gimp_tile->ewidth;
@@ -252,11 +276,82 @@ gimp_tile_write_mul (GimpTileBackendPlugin *backend_plugin,
                       gimp_tile_stride);
           }
 
-          gimp_tile_unref (gimp_tile, TRUE);
+          /*  keep our reference until the tile is written back  */
+          if (priv->n_dirty_tiles == WRITE_BEHIND_TILES)
+            gimp_tile_write_behind_flush (backend_plugin);
+
+          gimp_tile->dirty = TRUE;
+          priv->dirty_tiles[priv->n_dirty_tiles++] = gimp_tile;
         }
     }
 }
 
+/*  GEGL mostly walks buffers row by row, so when a GEGL tile isn't in
+ *  memory yet, fetch the GIMP tiles of the next few GEGL tiles along
+ *  its row with it, in batched requests
+ */
+static void
+gimp_tile_readahead (GimpTileBackendPlugin *backend_plugin,
+                     gint                   x,
+                     gint                   y)
+{
+  GimpTileBackendPluginPrivate *priv = backend_plugin->priv;
+  GimpTile                     *gimp_tile;
+  GimpTile                    **tiles;
+  gint                          mul  = priv->mul;
+  gint                          col1, col2;
+  gint                          row1, row2;
+  gint                          row, col;
+  gint                          n_tiles = 0;
+  gint                          i;
+
+  col1 = x * mul;
+  row1 = y * mul;
+  col2 = MIN ((x + READAHEAD_TILES) * mul, priv->drawable->ntile_cols);
+  row2 = MIN (row1 + mul, priv->drawable->ntile_rows);
+
+  if (col1 >= col2 || row1 >= row2)
+    return;
+
+  gimp_tile = gimp_drawable_get_tile (priv->drawable, priv->shadow,
+                                      row1, col1);
+
+  if (gimp_tile->data)
+    return;
+
+  tiles = g_new (GimpTile *, (col2 - col1) * (row2 - row1));
+
+  for (row = row1; row < row2; row++)
+    for (col = col1; col < col2; col++)
+      tiles[n_tiles++] = gimp_drawable_get_tile (priv->drawable, priv->shadow,
+                                                 row, col);
+
+  /*  the tile cache holds on to them  */
+  _gimp_tiles_ref (tiles, n_tiles);
+
+  for (i = 0; i < n_tiles; i++)
+    gimp_tile_unref (tiles[i], FALSE);
+
+  g_free (tiles);
+}
+
+/*  sends the written tiles to the core in one message that isn't
+ *  acknowledged, so we don't wait for the core to store them
+ */
+static void
+gimp_tile_write_behind_flush (GimpTileBackendPlugin *backend_plugin)
+{
+  GimpTileBackendPluginPrivate *priv = backend_plugin->priv;
+  gint                          i;
+
+  _gimp_tiles_flush (priv->dirty_tiles, priv->n_dirty_tiles);
+
+  for (i = 0; i < priv->n_dirty_tiles; i++)
+    gimp_tile_unref (priv->dirty_tiles[i], FALSE);
+
+  priv->n_dirty_tiles = 0;
+}
+
 GeglTileBackend *
 _gimp_tile_backend_plugin_new (GimpDrawable *drawable,
                                gint          shadow)
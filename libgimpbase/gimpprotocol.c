@@ -67,6 +67,38 @@ static void _gp_tile_data_write          (GIOChannel       *channel,
                                           gpointer          user_data);
 static void _gp_tile_data_destroy        (GimpWireMessage  *msg);
 
+static void _gp_region_req_read          (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_region_req_write         (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_region_req_destroy       (GimpWireMessage  *msg);
+
+static void _gp_region_data_read         (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_region_data_write        (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_region_data_destroy      (GimpWireMessage  *msg);
+
+static void _gp_tiles_req_read           (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_tiles_req_write          (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_tiles_req_destroy        (GimpWireMessage  *msg);
+
+static void _gp_tiles_data_read          (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_tiles_data_write         (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_tiles_data_destroy       (GimpWireMessage  *msg);
+
 static void _gp_proc_run_read            (GIOChannel       *channel,
                                           GimpWireMessage  *msg,
                                           gpointer          user_data);
@@ -140,6 +172,14 @@ static void _gp_has_init_write           (GIOChannel       *channel,
                                           gpointer          user_data);
 static void _gp_has_init_destroy         (GimpWireMessage  *msg);
 
+static void _gp_persist_read             (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_persist_write            (GIOChannel       *channel,
+                                          GimpWireMessage  *msg,
+                                          gpointer          user_data);
+static void _gp_persist_destroy          (GimpWireMessage  *msg);
+
 
 
 void
@@ -197,6 +237,26 @@ gp_init (void)
                       _gp_has_init_read,
                       _gp_has_init_write,
                       _gp_has_init_destroy);
+  gimp_wire_register (GP_REGION_REQ,
+                      _gp_region_req_read,
+                      _gp_region_req_write,
+                      _gp_region_req_destroy);
+  gimp_wire_register (GP_REGION_DATA,
+                      _gp_region_data_read,
+                      _gp_region_data_write,
+                      _gp_region_data_destroy);
+  gimp_wire_register (GP_TILES_REQ,
+                      _gp_tiles_req_read,
+                      _gp_tiles_req_write,
+                      _gp_tiles_req_destroy);
+  gimp_wire_register (GP_TILES_DATA,
+                      _gp_tiles_data_read,
+                      _gp_tiles_data_write,
+                      _gp_tiles_data_destroy);
+  gimp_wire_register (GP_PERSIST,
+                      _gp_persist_read,
+                      _gp_persist_write,
+                      _gp_persist_destroy);
 }
 
 gboolean
@@ -292,6 +352,82 @@ gp_tile_data_write (GIOChannel *channel,
   return TRUE;
 }
 
+gboolean
+gp_region_req_write (GIOChannel  *channel,
+                     GPRegionReq *region_req,
+                     gpointer     user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_REGION_REQ;
+  msg.data = region_req;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
+gboolean
+gp_region_data_write (GIOChannel   *channel,
+                      GPRegionData *region_data,
+                      gpointer      user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_REGION_DATA;
+  msg.data = region_data;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
+gboolean
+gp_tiles_req_write (GIOChannel *channel,
+                    GPTilesReq *tiles_req,
+                    gpointer    user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_TILES_REQ;
+  msg.data = tiles_req;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
+gboolean
+gp_tiles_data_write (GIOChannel  *channel,
+                     GPTilesData *tiles_data,
+                     gpointer     user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_TILES_DATA;
+  msg.data = tiles_data;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
 gboolean
 gp_proc_run_write (GIOChannel *channel,
                    GPProcRun  *proc_run,
@@ -442,6 +578,24 @@ gp_has_init_write (GIOChannel *channel,
   return TRUE;
 }
 
+gboolean
+gp_persist_write (GIOChannel *channel,
+                  gpointer    user_data)
+{
+  GimpWireMessage msg;
+
+  msg.type = GP_PERSIST;
+  msg.data = NULL;
+
+  if (! gimp_wire_write_msg (channel, &msg, user_data))
+    return FALSE;
+
+  if (! gimp_wire_flush (channel, user_data))
+    return FALSE;
+
+  return TRUE;
+}
+
 /*  quit  */
 
 static void
@@ -543,6 +697,9 @@ _gp_config_read (GIOChannel      *channel,
   if (! _gimp_wire_read_int32 (channel,
                                &config->timestamp, 1, user_data))
     goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &config->tile_cache_size, 1, user_data))
+    goto cleanup;
 
   msg->data = config;
   return;
@@ -639,6 +796,9 @@ _gp_config_write (GIOChannel      *channel,
                                 (const guint32 *) &config->timestamp, 1,
                                 user_data))
     return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &config->tile_cache_size, 1, user_data))
+    return;
 }
 
 static void
@@ -843,6 +1003,353 @@ _gp_tile_data_destroy (GimpWireMessage *msg)
     }
 }
 
+/*  region_req  */
+
+static void
+_gp_region_req_read (GIOChannel      *channel,
+                     GimpWireMessage *msg,
+                     gpointer         user_data)
+{
+  GPRegionReq *region_req = g_slice_new0 (GPRegionReq);
+
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &region_req->drawable_ID, 1,
+                               user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &region_req->shadow, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &region_req->put, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &region_req->x, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &region_req->y, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &region_req->width, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &region_req->height, 1, user_data))
+    goto cleanup;
+
+  msg->data = region_req;
+  return;
+
+ cleanup:
+  g_slice_free (GPRegionReq, region_req);
+  msg->data = NULL;
+}
+
+static void
+_gp_region_req_write (GIOChannel      *channel,
+                      GimpWireMessage *msg,
+                      gpointer         user_data)
+{
+  GPRegionReq *region_req = msg->data;
+
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &region_req->drawable_ID, 1,
+                                user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &region_req->shadow, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &region_req->put, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &region_req->x, 1,
+                                user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &region_req->y, 1,
+                                user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &region_req->width, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &region_req->height, 1, user_data))
+    return;
+}
+
+static void
+_gp_region_req_destroy (GimpWireMessage *msg)
+{
+  GPRegionReq *region_req = msg->data;
+
+  if (region_req)
+    g_slice_free (GPRegionReq, msg->data);
+}
+
+/*  region_data  */
+
+static void
+_gp_region_data_read (GIOChannel      *channel,
+                      GimpWireMessage *msg,
+                      gpointer         user_data)
+{
+  GPRegionData *region_data = g_slice_new0 (GPRegionData);
+
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &region_data->drawable_ID, 1,
+                               user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &region_data->shadow, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &region_data->x, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &region_data->y, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &region_data->width, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &region_data->height, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &region_data->bpp, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &region_data->shm_ID, 1,
+                               user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &region_data->shm_size, 1, user_data))
+    goto cleanup;
+
+  msg->data = region_data;
+  return;
+
+ cleanup:
+  g_slice_free (GPRegionData, region_data);
+  msg->data = NULL;
+}
+
+static void
+_gp_region_data_write (GIOChannel      *channel,
+                       GimpWireMessage *msg,
+                       gpointer         user_data)
+{
+  GPRegionData *region_data = msg->data;
+
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &region_data->drawable_ID, 1,
+                                user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &region_data->shadow, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &region_data->x, 1,
+                                user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &region_data->y, 1,
+                                user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &region_data->width, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &region_data->height, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &region_data->bpp, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &region_data->shm_ID, 1,
+                                user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &region_data->shm_size, 1, user_data))
+    return;
+}
+
+static void
+_gp_region_data_destroy (GimpWireMessage *msg)
+{
+  GPRegionData *region_data = msg->data;
+
+  if (region_data)
+    g_slice_free (GPRegionData, msg->data);
+}
+
+/*  tiles_req  */
+
+static void
+_gp_tiles_req_read (GIOChannel      *channel,
+                    GimpWireMessage *msg,
+                    gpointer         user_data)
+{
+  GPTilesReq *tiles_req = g_slice_new0 (GPTilesReq);
+
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &tiles_req->drawable_ID, 1,
+                               user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tiles_req->shadow, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tiles_req->n_tiles, 1, user_data))
+    goto cleanup;
+
+  tiles_req->tile_nums = g_new (guint32, tiles_req->n_tiles);
+
+  if (! _gimp_wire_read_int32 (channel,
+                               tiles_req->tile_nums, tiles_req->n_tiles,
+                               user_data))
+    goto cleanup;
+
+  msg->data = tiles_req;
+  return;
+
+ cleanup:
+  g_free (tiles_req->tile_nums);
+  g_slice_free (GPTilesReq, tiles_req);
+  msg->data = NULL;
+}
+
+static void
+_gp_tiles_req_write (GIOChannel      *channel,
+                     GimpWireMessage *msg,
+                     gpointer         user_data)
+{
+  GPTilesReq *tiles_req = msg->data;
+
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &tiles_req->drawable_ID, 1,
+                                user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tiles_req->shadow, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tiles_req->n_tiles, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                tiles_req->tile_nums, tiles_req->n_tiles,
+                                user_data))
+    return;
+}
+
+static void
+_gp_tiles_req_destroy (GimpWireMessage *msg)
+{
+  GPTilesReq *tiles_req = msg->data;
+
+  if (tiles_req)
+    {
+      g_free (tiles_req->tile_nums);
+      g_slice_free (GPTilesReq, tiles_req);
+    }
+}
+
+/*  tiles_data  */
+
+static void
+_gp_tiles_data_read (GIOChannel      *channel,
+                     GimpWireMessage *msg,
+                     gpointer         user_data)
+{
+  GPTilesData *tiles_data = g_slice_new0 (GPTilesData);
+
+  if (! _gimp_wire_read_int32 (channel,
+                               (guint32 *) &tiles_data->drawable_ID, 1,
+                               user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tiles_data->shadow, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tiles_data->bpp, 1, user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tiles_data->n_tiles, 1, user_data))
+    goto cleanup;
+
+  tiles_data->tile_nums = g_new (guint32, tiles_data->n_tiles);
+
+  if (! _gimp_wire_read_int32 (channel,
+                               tiles_data->tile_nums, tiles_data->n_tiles,
+                               user_data))
+    goto cleanup;
+  if (! _gimp_wire_read_int32 (channel,
+                               &tiles_data->data_size, 1, user_data))
+    goto cleanup;
+
+  tiles_data->data = g_new (guchar, tiles_data->data_size);
+
+  if (! _gimp_wire_read_int8 (channel,
+                              (guint8 *) tiles_data->data,
+                              tiles_data->data_size,
+                              user_data))
+    goto cleanup;
+
+  msg->data = tiles_data;
+  return;
+
+ cleanup:
+  g_free (tiles_data->tile_nums);
+  g_free (tiles_data->data);
+  g_slice_free (GPTilesData, tiles_data);
+  msg->data = NULL;
+}
+
+static void
+_gp_tiles_data_write (GIOChannel      *channel,
+                      GimpWireMessage *msg,
+                      gpointer         user_data)
+{
+  GPTilesData *tiles_data = msg->data;
+
+  if (! _gimp_wire_write_int32 (channel,
+                                (const guint32 *) &tiles_data->drawable_ID, 1,
+                                user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tiles_data->shadow, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tiles_data->bpp, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tiles_data->n_tiles, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                tiles_data->tile_nums, tiles_data->n_tiles,
+                                user_data))
+    return;
+  if (! _gimp_wire_write_int32 (channel,
+                                &tiles_data->data_size, 1, user_data))
+    return;
+  if (! _gimp_wire_write_int8 (channel,
+                               (const guint8 *) tiles_data->data,
+                               tiles_data->data_size,
+                               user_data))
+    return;
+}
+
+static void
+_gp_tiles_data_destroy (GimpWireMessage *msg)
+{
+  GPTilesData *tiles_data = msg->data;
+
+  if (tiles_data)
+    {
+      g_free (tiles_data->tile_nums);
+      g_free (tiles_data->data);
+      g_slice_free (GPTilesData, tiles_data);
+    }
+}
+
 /*  proc_run  */
 
 static void
@@ -1868,3 +2375,24 @@ static void
 _gp_has_init_destroy (GimpWireMessage *msg)
 {
 }
+
+/* persist */
+
+static void
+_gp_persist_read (GIOChannel      *channel,
+                  GimpWireMessage *msg,
+                  gpointer         user_data)
+{
+}
+
+static void
+_gp_persist_write (GIOChannel      *channel,
+                   GimpWireMessage *msg,
+                   gpointer         user_data)
+{
+}
+
+static void
+_gp_persist_destroy (GimpWireMessage *msg)
+{
+}
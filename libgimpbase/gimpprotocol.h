@@ -26,7 +26,7 @@ G_BEGIN_DECLS
 
 /* Increment every time the protocol changes
  */
-#define GIMP_PROTOCOL_VERSION  0x0014
+#define GIMP_PROTOCOL_VERSION  0x0018
 
 
 enum
@@ -43,7 +43,12 @@ enum
   GP_PROC_INSTALL,
   GP_PROC_UNINSTALL,
   GP_EXTENSION_ACK,
-  GP_HAS_INIT
+  GP_HAS_INIT,
+  GP_REGION_REQ,
+  GP_REGION_DATA,
+  GP_TILES_REQ,
+  GP_TILES_DATA,
+  GP_PERSIST
 };
 
 
@@ -51,6 +56,10 @@ typedef struct _GPConfig        GPConfig;
 typedef struct _GPTileReq       GPTileReq;
 typedef struct _GPTileAck       GPTileAck;
 typedef struct _GPTileData      GPTileData;
+typedef struct _GPRegionReq     GPRegionReq;
+typedef struct _GPRegionData    GPRegionData;
+typedef struct _GPTilesReq      GPTilesReq;
+typedef struct _GPTilesData     GPTilesData;
 typedef struct _GPParam         GPParam;
 typedef struct _GPParamDef      GPParamDef;
 typedef struct _GPProcRun       GPProcRun;
@@ -82,6 +91,7 @@ struct _GPConfig
   gchar   *display_name;
   gint32   monitor_number;
   guint32  timestamp;
+  guint32  tile_cache_size;    /*  the core's tile cache size, in kilobytes  */
 };
 
 struct _GPTileReq
@@ -103,6 +113,49 @@ struct _GPTileData
   guchar  *data;
 };
 
+struct _GPRegionReq
+{
+  gint32   drawable_ID;
+  guint32  shadow;
+  guint32  put;
+  gint32   x;
+  gint32   y;
+  guint32  width;
+  guint32  height;
+};
+
+struct _GPRegionData
+{
+  gint32   drawable_ID;
+  guint32  shadow;
+  gint32   x;
+  gint32   y;
+  guint32  width;
+  guint32  height;
+  guint32  bpp;
+  gint32   shm_ID;
+  guint32  shm_size;
+};
+
+struct _GPTilesReq
+{
+  gint32   drawable_ID;
+  guint32  shadow;
+  guint32  n_tiles;
+  guint32 *tile_nums;
+};
+
+struct _GPTilesData
+{
+  gint32   drawable_ID;
+  guint32  shadow;
+  guint32  bpp;
+  guint32  n_tiles;
+  guint32 *tile_nums;
+  guint32  data_size;
+  guchar  *data;    /*  the tiles' pixels, one tile after the other  */
+};
+
 struct _GPParam
 {
   guint32 type;
@@ -202,6 +255,18 @@ gboolean  gp_tile_ack_write         (GIOChannel      *channel,
 gboolean  gp_tile_data_write        (GIOChannel      *channel,
                                      GPTileData      *tile_data,
                                      gpointer         user_data);
+gboolean  gp_region_req_write       (GIOChannel      *channel,
+                                     GPRegionReq     *region_req,
+                                     gpointer         user_data);
+gboolean  gp_region_data_write      (GIOChannel      *channel,
+                                     GPRegionData    *region_data,
+                                     gpointer         user_data);
+gboolean  gp_tiles_req_write        (GIOChannel      *channel,
+                                     GPTilesReq      *tiles_req,
+                                     gpointer         user_data);
+gboolean  gp_tiles_data_write       (GIOChannel      *channel,
+                                     GPTilesData     *tiles_data,
+                                     gpointer         user_data);
 gboolean  gp_proc_run_write         (GIOChannel      *channel,
                                      GPProcRun       *proc_run,
                                      gpointer         user_data);
@@ -224,6 +289,8 @@ gboolean  gp_extension_ack_write    (GIOChannel      *channel,
                                      gpointer         user_data);
 gboolean  gp_has_init_write         (GIOChannel      *channel,
                                      gpointer         user_data);
+gboolean  gp_persist_write          (GIOChannel      *channel,
+                                     gpointer         user_data);
 
 void      gp_params_destroy         (GPParam         *params,
                                      gint             nparams);
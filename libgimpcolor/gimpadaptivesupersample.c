@@ -49,7 +49,13 @@
 /*********************************************************************/
 
 
-typedef struct _GimpSampleType GimpSampleType;
+/* The parallel variant renders the area in blocks of this size */
+#define BLOCK_SIZE 64
+
+
+typedef struct _GimpSampleType       GimpSampleType;
+typedef struct _GimpSupersampleRow   GimpSupersampleRow;
+typedef struct _GimpSupersampleBlock GimpSupersampleBlock;
 
 struct _GimpSampleType
 {
@@ -57,6 +63,33 @@ struct _GimpSampleType
   GimpRGB color;
 };
 
+/*  a row of blocks, rendered by the worker threads  */
+struct _GimpSupersampleRow
+{
+  gint                  x1, y1, x2, y2;
+  GimpRGB              *colors;
+  GimpSupersampleBlock *blocks;
+  gint                  n_blocks_left;
+  gulong                num_samples;
+};
+
+struct _GimpSupersampleBlock
+{
+  GimpSupersampleRow *row;
+  gint                x1, x2;
+};
+
+typedef struct
+{
+  gint            max_depth;
+  gdouble         threshold;
+  GimpRenderFunc  render_func;
+  gpointer        render_data;
+
+  GMutex          mutex;
+  GCond           cond;
+} GimpSupersampleContext;
+
 
 static gulong
 gimp_render_sub_pixel (gint             max_depth,
@@ -392,3 +425,205 @@ gimp_adaptive_supersample_area (gint              x1,
 
   return num_samples;
 }
+
+static void
+gimp_supersample_put_pixel (gint      x,
+                            gint      y,
+                            GimpRGB  *color,
+                            gpointer  data)
+{
+  GimpSupersampleRow *row   = data;
+  gint                width = row->x2 - row->x1 + 1;
+
+  row->colors[(y - row->y1) * width + (x - row->x1)] = *color;
+}
+
+static void
+gimp_supersample_render_block (GimpSupersampleBlock   *block,
+                               GimpSupersampleContext *context)
+{
+  GimpSupersampleRow *row = block->row;
+  gulong              num_samples;
+
+  num_samples = gimp_adaptive_supersample_area (block->x1, row->y1,
+                                                block->x2, row->y2,
+                                                context->max_depth,
+                                                context->threshold,
+                                                context->render_func,
+                                                context->render_data,
+                                                gimp_supersample_put_pixel,
+                                                row,
+                                                NULL, NULL);
+
+  g_mutex_lock (&context->mutex);
+
+  row->num_samples += num_samples;
+
+  if (--row->n_blocks_left == 0)
+    g_cond_broadcast (&context->cond);
+
+  g_mutex_unlock (&context->mutex);
+}
+
+static void
+gimp_supersample_start_row (GThreadPool        *pool,
+                            GimpSupersampleRow *row,
+                            gint                n_blocks)
+{
+  gint width = row->x2 - row->x1 + 1;
+  gint i;
+
+  row->colors        = g_new (GimpRGB, width * (row->y2 - row->y1 + 1));
+  row->blocks        = g_new (GimpSupersampleBlock, n_blocks);
+  row->n_blocks_left = n_blocks;
+
+  for (i = 0; i < n_blocks; i++)
+    {
+      row->blocks[i].row = row;
+      row->blocks[i].x1  = row->x1 + i * BLOCK_SIZE;
+      row->blocks[i].x2  = MIN (row->blocks[i].x1 + BLOCK_SIZE - 1, row->x2);
+
+      g_thread_pool_push (pool, &row->blocks[i], NULL);
+    }
+}
+
+/**
+ * gimp_adaptive_supersample_area_parallel:
+ * @x1:             left edge of the area
+ * @y1:             top edge of the area
+ * @x2:             right edge of the area, inclusive
+ * @y2:             bottom edge of the area, inclusive
+ * @max_depth:      maximum subdivision depth
+ * @threshold:      color distance above which a pixel is subdivided
+ * @render_func:    function rendering a sample, it must be thread-safe
+ * @render_data:    data for @render_func
+ * @put_pixel_func: function storing a rendered pixel
+ * @put_pixel_data: data for @put_pixel_func
+ * @progress_func:  function reporting the progress, or %NULL
+ * @progress_data:  data for @progress_func
+ *
+ * Like gimp_adaptive_supersample_area(), but the area is split into
+ * independent blocks which are rendered by a pool of worker threads,
+ * so @render_func is called from several threads at once. Each block
+ * caches the samples it shares between its pixels; the samples on the
+ * edges between blocks are rendered by both blocks, which gives the
+ * same pixels as gimp_adaptive_supersample_area().
+ *
+ * @put_pixel_func and @progress_func are only called from the calling
+ * thread, in the same order as gimp_adaptive_supersample_area() calls
+ * them: row by row, from left to right.
+ *
+ * Return value: the number of samples rendered.
+ *
+ * Since: GIMP 2.10
+ **/
+gulong
+gimp_adaptive_supersample_area_parallel (gint              x1,
+                                         gint              y1,
+                                         gint              x2,
+                                         gint              y2,
+                                         gint              max_depth,
+                                         gdouble           threshold,
+                                         GimpRenderFunc    render_func,
+                                         gpointer          render_data,
+                                         GimpPutPixelFunc  put_pixel_func,
+                                         gpointer          put_pixel_data,
+                                         GimpProgressFunc  progress_func,
+                                         gpointer          progress_data)
+{
+  GimpSupersampleContext  context;
+  GimpSupersampleRow     *rows;
+  GThreadPool            *pool;
+  gint                    n_threads;
+  gint                    n_rows;
+  gint                    n_blocks;
+  gint                    max_rows;
+  gint                    width;
+  gint                    i;
+  gulong                  num_samples = 0;
+
+  g_return_val_if_fail (render_func != NULL, 0);
+  g_return_val_if_fail (put_pixel_func != NULL, 0);
+
+  n_threads = g_get_num_processors ();
+
+  if (n_threads < 2 || x2 < x1 || y2 < y1)
+    return gimp_adaptive_supersample_area (x1, y1, x2, y2,
+                                           max_depth, threshold,
+                                           render_func, render_data,
+                                           put_pixel_func, put_pixel_data,
+                                           progress_func, progress_data);
+
+  width    = x2 - x1 + 1;
+  n_rows   = (y2 - y1 + BLOCK_SIZE) / BLOCK_SIZE;
+  n_blocks = (width + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+  /*  keep enough rows of blocks in flight to occupy the threads, but
+   *  not all of them, their colors are only freed once they are put
+   */
+  max_rows = MAX (2, (2 * n_threads + n_blocks - 1) / n_blocks);
+
+  context.max_depth   = max_depth;
+  context.threshold   = threshold;
+  context.render_func = render_func;
+  context.render_data = render_data;
+
+  g_mutex_init (&context.mutex);
+  g_cond_init (&context.cond);
+
+  rows = g_new0 (GimpSupersampleRow, n_rows);
+
+  for (i = 0; i < n_rows; i++)
+    {
+      rows[i].x1 = x1;
+      rows[i].y1 = y1 + i * BLOCK_SIZE;
+      rows[i].x2 = x2;
+      rows[i].y2 = MIN (rows[i].y1 + BLOCK_SIZE - 1, y2);
+    }
+
+  pool = g_thread_pool_new ((GFunc) gimp_supersample_render_block, &context,
+                            n_threads, FALSE, NULL);
+
+  for (i = 0; i < MIN (max_rows, n_rows); i++)
+    gimp_supersample_start_row (pool, &rows[i], n_blocks);
+
+  for (i = 0; i < n_rows; i++)
+    {
+      GimpSupersampleRow *row = &rows[i];
+      GimpRGB            *color;
+      gint                x, y;
+
+      g_mutex_lock (&context.mutex);
+      while (row->n_blocks_left > 0)
+        g_cond_wait (&context.cond, &context.mutex);
+      g_mutex_unlock (&context.mutex);
+
+      if (i + max_rows < n_rows)
+        gimp_supersample_start_row (pool, &rows[i + max_rows], n_blocks);
+
+      color = row->colors;
+
+      for (y = row->y1; y <= row->y2; y++)
+        {
+          for (x = row->x1; x <= row->x2; x++)
+            (* put_pixel_func) (x, y, color++, put_pixel_data);
+
+          if (progress_func != NULL)
+            (* progress_func) (y1, y2, y, progress_data);
+        }
+
+      num_samples += row->num_samples;
+
+      g_free (row->colors);
+      g_free (row->blocks);
+    }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  g_free (rows);
+
+  g_mutex_clear (&context.mutex);
+  g_cond_clear (&context.cond);
+
+  return num_samples;
+}
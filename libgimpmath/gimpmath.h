@@ -38,6 +38,7 @@
 
 #include <libgimpmath/gimpmatrix.h>
 #include <libgimpmath/gimpmd5.h>
+#include <libgimpmath/gimprandom.h>
 #include <libgimpmath/gimpvector.h>
 
 #undef __GIMP_MATH_H_INSIDE__
@@ -0,0 +1,148 @@
+/* LIBGIMP - The GIMP Library
+ * Copyright (C) 1995-1997 Peter Mattis and Spencer Kimball
+ *
+ * gimprandom.c
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include <glib-object.h>
+
+#include "gimpmath.h"
+
+
+/**
+ * SECTION: gimprandom
+ * @title: GimpRandom
+ * @short_description: Random numbers that don't depend on the order
+ *                     they are drawn in.
+ * @see_also: #GRand
+ *
+ * Unlike a #GRand, which returns the numbers of one stream in
+ * sequence, these functions are counter-based: each number is a hash
+ * of a seed, a pixel position and the index of the number for that
+ * pixel.  The numbers of any pixel can be computed on their own, so
+ * an image can be processed in any order, or by several threads at
+ * once, and still come out the same for the same seed.
+ **/
+
+
+/*  the 32 bit integer hash "lowbias32" by Chris Wellons, every bit of
+ *  the input affects all bits of the output
+ */
+static inline guint32
+gimp_random_mix (guint32 h)
+{
+  h ^= h >> 16;
+  h *= 0x7feb352d;
+  h ^= h >> 15;
+  h *= 0x846ca68b;
+  h ^= h >> 16;
+
+  return h;
+}
+
+
+/**
+ * gimp_random_uint32:
+ * @seed: the seed
+ * @x:    the pixel's x coordinate
+ * @y:    the pixel's y coordinate
+ * @n:    the index of the number for this pixel
+ *
+ * Returns the @n-th random number of the pixel at @x, @y.  The result
+ * only depends on the arguments, callers that need several numbers
+ * per pixel pass 0, 1, 2, ... as @n.
+ *
+ * Return value: a random number equally distributed over the
+ *               range [0..2^32-1].
+ *
+ * Since: GIMP 2.10
+ **/
+guint32
+gimp_random_uint32 (guint32 seed,
+                    gint    x,
+                    gint    y,
+                    guint   n)
+{
+  guint32 h;
+
+  h = gimp_random_mix (seed ^ 0x9e3779b9);
+  h = gimp_random_mix (h ^ (guint32) x);
+  h = gimp_random_mix (h ^ (guint32) y);
+  h = gimp_random_mix (h ^ n);
+
+  return h;
+}
+
+/**
+ * gimp_random_double:
+ * @seed: the seed
+ * @x:    the pixel's x coordinate
+ * @y:    the pixel's y coordinate
+ * @n:    the index of the number for this pixel
+ *
+ * Like gimp_random_uint32(), but returns a floating point number.
+ *
+ * Return value: a random number equally distributed over the
+ *               range [0..1).
+ *
+ * Since: GIMP 2.10
+ **/
+gdouble
+gimp_random_double (guint32 seed,
+                    gint    x,
+                    gint    y,
+                    guint   n)
+{
+  return gimp_random_uint32 (seed, x, y, n) * (1.0 / 4294967296.0);
+}
+
+/**
+ * gimp_random_int_range:
+ * @seed:  the seed
+ * @x:     the pixel's x coordinate
+ * @y:     the pixel's y coordinate
+ * @n:     the index of the number for this pixel
+ * @begin: lower closed bound of the interval
+ * @end:   upper open bound of the interval
+ *
+ * Like gimp_random_uint32(), but returns a number in the interval
+ * [@begin..@end-1], like g_rand_int_range() does.
+ *
+ * Return value: a random number equally distributed over the
+ *               range [@begin..@end-1].
+ *
+ * Since: GIMP 2.10
+ **/
+gint32
+gimp_random_int_range (guint32 seed,
+                       gint    x,
+                       gint    y,
+                       guint   n,
+                       gint32  begin,
+                       gint32  end)
+{
+  guint32 dist;
+
+  g_return_val_if_fail (end > begin, begin);
+
+  dist = (guint32) end - (guint32) begin;
+
+  return begin + (gint32) (((guint64) dist *
+                            gimp_random_uint32 (seed, x, y, n)) >> 32);
+}
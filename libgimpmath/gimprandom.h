@@ -0,0 +1,51 @@
+/* LIBGIMP - The GIMP Library
+ * Copyright (C) 1995-1997 Peter Mattis and Spencer Kimball
+ *
+ * gimprandom.h
+ *
+ * This library is free software: you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library.  If not, see
+ * <http://www.gnu.org/licenses/>.
+ */
+
+#if !defined (__GIMP_MATH_H_INSIDE__) && !defined (GIMP_MATH_COMPILATION)
+#error "Only <libgimpmath/gimpmath.h> can be included directly."
+#endif
+
+#ifndef __GIMP_RANDOM_H__
+#define __GIMP_RANDOM_H__
+
+G_BEGIN_DECLS
+
+/* For information look into the C source or the html documentation */
+
+
+guint32 gimp_random_uint32    (guint32 seed,
+                               gint    x,
+                               gint    y,
+                               guint   n);
+gdouble gimp_random_double    (guint32 seed,
+                               gint    x,
+                               gint    y,
+                               guint   n);
+gint32  gimp_random_int_range (guint32 seed,
+                               gint    x,
+                               gint    y,
+                               guint   n,
+                               gint32  begin,
+                               gint32  end);
+
+
+G_END_DECLS
+
+#endif  /* __GIMP_RANDOM_H__ */
@@ -59,7 +59,7 @@ static gint           gimp_thumb_size       (GimpThumbSize  size);
 static gchar        * gimp_thumb_png_lookup (const gchar   *name,
                                              const gchar   *basedir,
                                              GimpThumbSize *size) G_GNUC_MALLOC;
-static const gchar  * gimp_thumb_png_name   (const gchar   *uri);
+static gchar        * gimp_thumb_png_name   (const gchar   *uri) G_GNUC_MALLOC;
 static void           gimp_thumb_exit       (void);
 
 
@@ -365,6 +365,9 @@ gchar *
 gimp_thumb_name_from_uri (const gchar   *uri,
                           GimpThumbSize  size)
 {
+  gchar *name;
+  gchar *result;
+
   g_return_val_if_fail (gimp_thumb_initialized, NULL);
   g_return_val_if_fail (uri != NULL, NULL);
 
@@ -373,9 +376,12 @@ gimp_thumb_name_from_uri (const gchar   *uri,
 
   size = gimp_thumb_size (size);
 
-  return g_build_filename (thumb_subdirs[size],
-                           gimp_thumb_png_name (uri),
-                           NULL);
+  name   = gimp_thumb_png_name (uri);
+  result = g_build_filename (thumb_subdirs[size], name, NULL);
+
+  g_free (name);
+
+  return result;
 }
 
 /**
@@ -416,13 +422,15 @@ gimp_thumb_name_from_uri_local (const gchar   *uri,
       if (baseuri && baseuri[0] && baseuri[1])
         {
           gchar *dirname = g_path_get_dirname (filename);
+          gchar *name    = gimp_thumb_png_name (uri);
           gint   i       = gimp_thumb_size (size);
 
           result = g_build_filename (dirname,
                                      ".thumblocal", thumb_sizenames[i],
-                                     gimp_thumb_png_name (uri),
+                                     name,
                                      NULL);
 
+          g_free (name);
           g_free (dirname);
         }
 
@@ -457,6 +465,7 @@ gchar *
 gimp_thumb_find_thumb (const gchar   *uri,
                        GimpThumbSize *size)
 {
+  gchar *name;
   gchar *result;
 
   g_return_val_if_fail (gimp_thumb_initialized, NULL);
@@ -464,7 +473,10 @@ gimp_thumb_find_thumb (const gchar   *uri,
   g_return_val_if_fail (size != NULL, NULL);
   g_return_val_if_fail (*size > GIMP_THUMB_SIZE_FAIL, NULL);
 
-  result = gimp_thumb_png_lookup (gimp_thumb_png_name (uri), NULL, size);
+  name   = gimp_thumb_png_name (uri);
+  result = gimp_thumb_png_lookup (name, NULL, size);
+
+  g_free (name);
 
   if (! result)
     {
@@ -478,9 +490,10 @@ gimp_thumb_find_thumb (const gchar   *uri,
             {
               gchar *dirname = g_path_get_dirname (filename);
 
-              result = gimp_thumb_png_lookup (gimp_thumb_png_name (baseuri + 1),
-                                              dirname, size);
+              name   = gimp_thumb_png_name (baseuri + 1);
+              result = gimp_thumb_png_lookup (name, dirname, size);
 
+              g_free (name);
               g_free (dirname);
             }
 
@@ -816,33 +829,19 @@ gimp_thumb_png_lookup (const gchar   *name,
   return thumb_name;
 }
 
-static const gchar *
+/*  returns a newly allocated string, instead of using a static buffer,
+ *  so thumbnails can be looked up from more than one thread
+ */
+static gchar *
 gimp_thumb_png_name (const gchar *uri)
 {
-  static gchar name[40];
-
-  GChecksum *checksum;
-  guchar     digest[16];
-  gsize      len = sizeof (digest);
-  gsize      i;
+  gchar *checksum;
+  gchar *name;
 
-  checksum = g_checksum_new (G_CHECKSUM_MD5);
-  g_checksum_update (checksum, (const guchar *) uri, -1);
-  g_checksum_get_digest (checksum, digest, &len);
-  g_checksum_free (checksum);
-
-  for (i = 0; i < len; i++)
-    {
-      guchar n;
-
-      n = (digest[i] >> 4) & 0xF;
-      name[i * 2]     = (n > 9) ? 'a' + n - 10 : '0' + n;
-
-      n = digest[i] & 0xF;
-      name[i * 2 + 1] = (n > 9) ? 'a' + n - 10 : '0' + n;
-    }
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+  name     = g_strconcat (checksum, ".png", NULL);
 
-  strncpy (name + 32, ".png", 5);
+  g_free (checksum);
 
-  return (const gchar *) name;
+  return name;
 }
@@ -997,6 +997,9 @@ gimp_thumbnail_debug_notify (GObject    *object,
  * In order to verify if the preview is uptodate, you should check the
  * "thumb_state" property after calling this function.
  *
+ * This function can be called from any thread, as long as no other
+ * thread uses @thumbnail at the same time.
+ *
  * Return value: a preview pixbuf or %NULL if no thumbnail was found
  **/
 GdkPixbuf *
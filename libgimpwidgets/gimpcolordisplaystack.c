@@ -44,6 +44,10 @@
  **/
 
 
+/*  the number of grid points per channel of the baked lookup table  */
+#define LUT_SIZE 33
+
+
 enum
 {
   CHANGED,
@@ -54,7 +58,18 @@ enum
 };
 
 
+typedef struct
+{
+  guchar   *lut;        /*  LUT_SIZE^3 RGB triplets              */
+  gboolean  lut_valid;
+  gboolean  identity;   /*  no filter is enabled                 */
+} GimpColorDisplayStackPrivate;
+
+#define GIMP_COLOR_DISPLAY_STACK_GET_PRIVATE(obj) (G_TYPE_INSTANCE_GET_PRIVATE ((obj), GIMP_TYPE_COLOR_DISPLAY_STACK, GimpColorDisplayStackPrivate))
+
+
 static void   gimp_color_display_stack_dispose         (GObject               *object);
+static void   gimp_color_display_stack_finalize        (GObject               *object);
 
 static void   gimp_color_display_stack_display_changed (GimpColorDisplay      *display,
                                                         GimpColorDisplayStack *stack);
@@ -64,6 +79,10 @@ static void   gimp_color_display_stack_display_enabled (GimpColorDisplay      *d
 static void   gimp_color_display_stack_disconnect      (GimpColorDisplayStack *stack,
                                                         GimpColorDisplay      *display);
 
+static void   gimp_color_display_stack_bake_lut        (GimpColorDisplayStack *stack);
+static void   gimp_color_display_stack_apply_lut       (const guchar          *lut,
+                                                        cairo_surface_t       *surface);
+
 
 G_DEFINE_TYPE (GimpColorDisplayStack, gimp_color_display_stack, G_TYPE_OBJECT)
 
@@ -118,12 +137,15 @@ gimp_color_display_stack_class_init (GimpColorDisplayStackClass *klass)
                   GIMP_TYPE_COLOR_DISPLAY,
                   G_TYPE_INT);
 
-  object_class->dispose = gimp_color_display_stack_dispose;
+  object_class->dispose  = gimp_color_display_stack_dispose;
+  object_class->finalize = gimp_color_display_stack_finalize;
 
   klass->changed        = NULL;
   klass->added          = NULL;
   klass->removed        = NULL;
   klass->reordered      = NULL;
+
+  g_type_class_add_private (object_class, sizeof (GimpColorDisplayStackPrivate));
 }
 
 static void
@@ -156,6 +178,19 @@ gimp_color_display_stack_dispose (GObject *object)
   G_OBJECT_CLASS (parent_class)->dispose (object);
 }
 
+static void
+gimp_color_display_stack_finalize (GObject *object)
+{
+  GimpColorDisplayStackPrivate *private;
+
+  private = GIMP_COLOR_DISPLAY_STACK_GET_PRIVATE (object);
+
+  g_free (private->lut);
+  private->lut = NULL;
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 GimpColorDisplayStack *
 gimp_color_display_stack_new (void)
 {
@@ -190,6 +225,8 @@ gimp_color_display_stack_changed (GimpColorDisplayStack *stack)
 {
   g_return_if_fail (GIMP_IS_COLOR_DISPLAY_STACK (stack));
 
+  GIMP_COLOR_DISPLAY_STACK_GET_PRIVATE (stack)->lut_valid = FALSE;
+
   g_signal_emit (stack, stack_signals[CHANGED], 0);
 }
 
@@ -292,25 +329,35 @@ gimp_color_display_stack_reorder_down (GimpColorDisplayStack *stack,
  *
  * Runs all the stack's filters on all pixels in @surface.
  *
+ * The filters are not run on @surface directly.  When the stack
+ * changes, they are run once on a 33x33x33 grid of colors, and the
+ * result is applied to @surface with tetrahedral interpolation.  This
+ * relies on the filters converting each pixel independently of the
+ * others, which all color display filters do.
+ *
  * Since: GIMP 2.8
  **/
 void
 gimp_color_display_stack_convert_surface (GimpColorDisplayStack *stack,
                                           cairo_surface_t       *surface)
 {
-  GList *list;
+  GimpColorDisplayStackPrivate *private;
 
   g_return_if_fail (GIMP_IS_COLOR_DISPLAY_STACK (stack));
   g_return_if_fail (surface != NULL);
   g_return_if_fail (cairo_surface_get_type (surface) ==
                     CAIRO_SURFACE_TYPE_IMAGE);
 
-  for (list = stack->filters; list; list = g_list_next (list))
-    {
-      GimpColorDisplay *display = list->data;
+  if (cairo_image_surface_get_format (surface) != CAIRO_FORMAT_ARGB32)
+    return;
 
-      gimp_color_display_convert_surface (display, surface);
-    }
+  private = GIMP_COLOR_DISPLAY_STACK_GET_PRIVATE (stack);
+
+  if (! private->lut_valid)
+    gimp_color_display_stack_bake_lut (stack);
+
+  if (! private->identity)
+    gimp_color_display_stack_apply_lut (private->lut, surface);
 }
 
 /**
@@ -378,3 +425,199 @@ gimp_color_display_stack_disconnect (GimpColorDisplayStack *stack,
                                         gimp_color_display_stack_display_enabled,
                                         stack);
 }
+
+static void
+gimp_color_display_stack_bake_lut (GimpColorDisplayStack *stack)
+{
+  GimpColorDisplayStackPrivate *private;
+  cairo_surface_t              *grid;
+  GList                        *list;
+  guchar                       *data;
+  guchar                       *lut;
+  gint                          stride;
+  gint                          r, g, b;
+
+  private = GIMP_COLOR_DISPLAY_STACK_GET_PRIVATE (stack);
+
+  private->lut_valid = TRUE;
+  private->identity  = TRUE;
+
+  for (list = stack->filters; list; list = g_list_next (list))
+    {
+      GimpColorDisplay *display = list->data;
+
+      if (display->enabled)
+        private->identity = FALSE;
+    }
+
+  if (private->identity)
+    return;
+
+  /*  one row per red and green value, one column per blue value  */
+  grid = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                     LUT_SIZE, LUT_SIZE * LUT_SIZE);
+
+  stride = cairo_image_surface_get_stride (grid);
+  data   = cairo_image_surface_get_data (grid);
+
+  for (r = 0; r < LUT_SIZE; r++)
+    for (g = 0; g < LUT_SIZE; g++)
+      {
+        guchar *row = data + (r * LUT_SIZE + g) * stride;
+
+        for (b = 0; b < LUT_SIZE; b++)
+          GIMP_CAIRO_ARGB32_SET_PIXEL (row + 4 * b,
+                                       r * 255 / (LUT_SIZE - 1),
+                                       g * 255 / (LUT_SIZE - 1),
+                                       b * 255 / (LUT_SIZE - 1),
+                                       255);
+      }
+
+  cairo_surface_mark_dirty (grid);
+
+  for (list = stack->filters; list; list = g_list_next (list))
+    {
+      GimpColorDisplay *display = list->data;
+
+      gimp_color_display_convert_surface (display, grid);
+    }
+
+  cairo_surface_flush (grid);
+
+  if (! private->lut)
+    private->lut = g_new (guchar, LUT_SIZE * LUT_SIZE * LUT_SIZE * 3);
+
+  lut = private->lut;
+
+  for (r = 0; r < LUT_SIZE; r++)
+    for (g = 0; g < LUT_SIZE; g++)
+      {
+        const guchar *row = data + (r * LUT_SIZE + g) * stride;
+
+        for (b = 0; b < LUT_SIZE; b++)
+          {
+            guint lr, lg, lb, la;
+
+            GIMP_CAIRO_ARGB32_GET_PIXEL (row + 4 * b, lr, lg, lb, la);
+
+            *lut++ = lr;
+            *lut++ = lg;
+            *lut++ = lb;
+          }
+      }
+
+  cairo_surface_destroy (grid);
+}
+
+/*  Maps each pixel through the lookup table, using tetrahedral
+ *  interpolation in fixed point.  Fractions are in units of 1/255,
+ *  so the grid points themselves are reproduced exactly.
+ */
+static void
+gimp_color_display_stack_apply_lut (const guchar    *lut,
+                                    cairo_surface_t *surface)
+{
+  const gint  dr     = LUT_SIZE * LUT_SIZE * 3;
+  const gint  dg     = LUT_SIZE * 3;
+  const gint  db     = 3;
+  gint        width  = cairo_image_surface_get_width (surface);
+  gint        height = cairo_image_surface_get_height (surface);
+  gint        stride = cairo_image_surface_get_stride (surface);
+  guchar     *data   = cairo_image_surface_get_data (surface);
+  gint        y;
+
+  cairo_surface_flush (surface);
+
+  for (y = 0; y < height; y++, data += stride)
+    {
+      guchar *p = data;
+      gint    x;
+
+      for (x = 0; x < width; x++, p += 4)
+        {
+          const guchar *c000;
+          guint         r, g, b, a;
+          gint          fr, fg, fb;
+          gint          o1, o2;
+          gint          w0, w1, w2, w3;
+          gint          out[3];
+          gint          c;
+
+          GIMP_CAIRO_ARGB32_GET_PIXEL (p, r, g, b, a);
+
+          if (a == 0)
+            continue;
+
+          /*  the unpremultiplied values can exceed 255 slightly  */
+          r = MIN (r, 255) * (LUT_SIZE - 1);
+          g = MIN (g, 255) * (LUT_SIZE - 1);
+          b = MIN (b, 255) * (LUT_SIZE - 1);
+
+          fr = r % 255;
+          fg = g % 255;
+          fb = b % 255;
+
+          c000 = lut + (r / 255) * dr + (g / 255) * dg + (b / 255) * db;
+
+          /*  pick the tetrahedron the point is in, o1 and o2 are the
+           *  offsets of its second and third corner
+           */
+          if (fr >= fg)
+            {
+              if (fg >= fb)
+                {
+                  o1 = dr;      o2 = dr + dg;
+                  w1 = fr - fg; w2 = fg - fb; w3 = fb;
+                }
+              else if (fr >= fb)
+                {
+                  o1 = dr;      o2 = dr + db;
+                  w1 = fr - fb; w2 = fb - fg; w3 = fg;
+                }
+              else
+                {
+                  o1 = db;      o2 = dr + db;
+                  w1 = fb - fr; w2 = fr - fg; w3 = fg;
+                }
+            }
+          else
+            {
+              if (fb >= fg)
+                {
+                  o1 = db;      o2 = dg + db;
+                  w1 = fb - fg; w2 = fg - fr; w3 = fr;
+                }
+              else if (fb >= fr)
+                {
+                  o1 = dg;      o2 = dg + db;
+                  w1 = fg - fb; w2 = fb - fr; w3 = fr;
+                }
+              else
+                {
+                  o1 = dg;      o2 = dr + dg;
+                  w1 = fg - fr; w2 = fr - fb; w3 = fb;
+                }
+            }
+
+          w0 = 255 - w1 - w2 - w3;
+
+          /*  the last corner is always c111, but at the top grid
+           *  point the weights of the corners outside the table are 0
+           */
+          for (c = 0; c < 3; c++)
+            {
+              gint v = w0 * c000[c];
+
+              if (w1) v += w1 * c000[o1 + c];
+              if (w2) v += w2 * c000[o2 + c];
+              if (w3) v += w3 * c000[dr + dg + db + c];
+
+              out[c] = (v + 127) / 255;
+            }
+
+          GIMP_CAIRO_ARGB32_SET_PIXEL (p, out[0], out[1], out[2], a);
+        }
+    }
+
+  cairo_surface_mark_dirty (surface);
+}
@@ -105,6 +105,14 @@ typedef enum
 
 typedef struct _GimpColorSelectClass GimpColorSelectClass;
 
+typedef struct
+{
+  ColorSelectFillType  fill_type;
+  gint                 width;
+  gint                 height;
+  gdouble              value;
+} ColorSelectFillCache;
+
 struct _GimpColorSelect
 {
   GimpColorSelector    parent_instance;
@@ -119,6 +127,10 @@ struct _GimpColorSelect
   ColorSelectFillType  z_color_fill;
   ColorSelectFillType  xy_color_fill;
 
+  /*  what the color areas currently show  */
+  ColorSelectFillCache xy_cache;
+  ColorSelectFillCache z_cache;
+
   ColorSelectDragMode  drag_mode;
 };
 
@@ -192,6 +204,7 @@ static gboolean   gimp_color_select_z_events    (GtkWidget          *widet,
 
 static void   gimp_color_select_image_fill      (GtkWidget          *widget,
                                                  ColorSelectFillType fill_type,
+                                                 ColorSelectFillCache *cache,
                                                  const GimpHSV      *hsv,
                                                  const GimpRGB      *rgb);
 
@@ -466,6 +479,7 @@ gimp_color_select_update (GimpColorSelect       *select,
   if (update & UPDATE_XY_COLOR)
     {
       gimp_color_select_image_fill (select->xy_color, select->xy_color_fill,
+                                    &select->xy_cache,
                                     &selector->hsv, &selector->rgb);
       gtk_widget_queue_draw (select->xy_color);
     }
@@ -473,6 +487,7 @@ gimp_color_select_update (GimpColorSelect       *select,
   if (update & UPDATE_Z_COLOR)
     {
       gimp_color_select_image_fill (select->z_color, select->z_color_fill,
+                                    &select->z_cache,
                                     &selector->hsv, &selector->rgb);
       gtk_widget_queue_draw (select->z_color);
     }
@@ -842,16 +857,48 @@ gimp_color_select_z_events (GtkWidget       *widget,
 }
 
 static void
-gimp_color_select_image_fill (GtkWidget           *preview,
-                              ColorSelectFillType  fill_type,
-                              const GimpHSV       *hsv,
-                              const GimpRGB       *rgb)
+gimp_color_select_image_fill (GtkWidget            *preview,
+                              ColorSelectFillType   fill_type,
+                              ColorSelectFillCache *cache,
+                              const GimpHSV        *hsv,
+                              const GimpRGB        *rgb)
 {
   GtkAllocation   allocation;
   ColorSelectFill csf;
+  guchar         *buffer;
+  gdouble         value;
 
   gtk_widget_get_allocation (preview, &allocation);
 
+  /*  the strips don't depend on the color at all, and each plane only
+   *  on the one channel it doesn't show, so the area only needs to be
+   *  rendered again if that channel or the area's size changed
+   */
+  switch (fill_type)
+    {
+    case COLOR_SELECT_RED_GREEN:        value = rgb->b; break;
+    case COLOR_SELECT_RED_BLUE:         value = rgb->g; break;
+    case COLOR_SELECT_GREEN_BLUE:       value = rgb->r; break;
+    case COLOR_SELECT_HUE_SATURATION:   value = hsv->v; break;
+    case COLOR_SELECT_HUE_VALUE:        value = hsv->s; break;
+    case COLOR_SELECT_SATURATION_VALUE: value = hsv->h; break;
+    default:                            value = 0.0;    break;
+    }
+
+  if (cache->fill_type == fill_type         &&
+      cache->width     == allocation.width  &&
+      cache->height    == allocation.height &&
+      cache->value     == value)
+    return;
+
+  cache->fill_type = fill_type;
+  cache->width     = allocation.width;
+  cache->height    = allocation.height;
+  cache->value     = value;
+
+  if (allocation.width < 1 || allocation.height < 1)
+    return;
+
   csf.update = update_procs[fill_type];
 
   csf.width  = allocation.width;
@@ -859,20 +906,22 @@ gimp_color_select_image_fill (GtkWidget           *preview,
   csf.hsv    = *hsv;
   csf.rgb    = *rgb;
 
-  csf.buffer = g_alloca (csf.width * 3);
+  buffer = g_new (guchar, csf.width * csf.height * 3);
 
   for (csf.y = 0; csf.y < csf.height; csf.y++)
     {
-      {
-        if (csf.update)
-          (* csf.update) (&csf);
+      csf.buffer = buffer + csf.y * csf.width * 3;
 
-        gimp_preview_area_draw (GIMP_PREVIEW_AREA (preview),
-                                0, csf.y, csf.width, 1,
-                                GIMP_RGB_IMAGE,
-                                csf.buffer, csf.width * 3);
-      }
+      if (csf.update)
+        (* csf.update) (&csf);
     }
+
+  gimp_preview_area_draw (GIMP_PREVIEW_AREA (preview),
+                          0, 0, csf.width, csf.height,
+                          GIMP_RGB_IMAGE,
+                          buffer, csf.width * 3);
+
+  g_free (buffer);
 }
 
 static void
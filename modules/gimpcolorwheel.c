@@ -80,6 +80,13 @@ typedef struct
   DragMode mode;
 
   guint focus_on_ring : 1;
+
+  /* The ring and the triangle only change with the size and the
+   * hue, keep them around so moving the markers is just a blit
+   */
+  cairo_surface_t *ring_surface;
+  cairo_surface_t *triangle_surface;
+  gdouble          triangle_h;
 } GimpColorWheelPrivate;
 
 enum
@@ -89,6 +96,8 @@ enum
   LAST_SIGNAL
 };
 
+static void     gimp_color_wheel_finalize       (GObject            *object);
+
 static void     gimp_color_wheel_map            (GtkWidget          *widget);
 static void     gimp_color_wheel_unmap          (GtkWidget          *widget);
 static void     gimp_color_wheel_realize        (GtkWidget          *widget);
@@ -109,6 +118,7 @@ static gboolean gimp_color_wheel_grab_broken    (GtkWidget          *widget,
                                                  GdkEventGrabBroken *event);
 static gboolean gimp_color_wheel_focus          (GtkWidget          *widget,
                                                  GtkDirectionType    direction);
+static void     gimp_color_wheel_clear_cache    (GimpColorWheel     *wheel);
 static void     gimp_color_wheel_move           (GimpColorWheel     *wheel,
                                                  GtkDirectionType    dir);
 
@@ -134,6 +144,8 @@ gimp_color_wheel_class_init (GimpColorWheelClass *class)
   GimpColorWheelClass *wheel_class  = GIMP_COLOR_WHEEL_CLASS (class);
   GtkBindingSet       *binding_set;
 
+  object_class->finalize             = gimp_color_wheel_finalize;
+
   widget_class->map                  = gimp_color_wheel_map;
   widget_class->unmap                = gimp_color_wheel_unmap;
   widget_class->realize              = gimp_color_wheel_realize;
@@ -225,6 +237,14 @@ gimp_color_wheel_init (GimpColorWheel *wheel)
   priv->ring_width    = DEFAULT_RING_WIDTH;
 }
 
+static void
+gimp_color_wheel_finalize (GObject *object)
+{
+  gimp_color_wheel_clear_cache (GIMP_COLOR_WHEEL (object));
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gimp_color_wheel_map (GtkWidget *widget)
 {
@@ -338,6 +358,8 @@ gimp_color_wheel_size_allocate (GtkWidget     *widget,
 
   priv->ring_width = priv->size * priv->ring_fraction;
 
+  gimp_color_wheel_clear_cache (wheel);
+
   if (gtk_widget_get_realized (widget))
     gdk_window_move_resize (priv->window,
                             allocation->x,
@@ -784,60 +806,47 @@ gimp_color_wheel_motion (GtkWidget      *widget,
 
 /* Redrawing */
 
-/* Paints the hue ring */
-static void
-paint_ring (GimpColorWheel *wheel,
-            cairo_t        *cr,
-            gint            x,
-            gint            y,
-            gint            width,
-            gint            height)
+/* Renders the hue ring for the whole allocation */
+static cairo_surface_t *
+create_ring_surface (GimpColorWheel *wheel,
+                     gint            width,
+                     gint            height)
 {
-  GtkWidget             *widget = GTK_WIDGET (wheel);
-  GimpColorWheelPrivate *priv   = wheel->priv;
-  GtkAllocation          allocation;
+  GimpColorWheelPrivate *priv = wheel->priv;
+  cairo_surface_t       *surface;
+  guint32               *buf, *p;
   gint                   xx, yy;
   gdouble                dx, dy, dist;
   gdouble                center_x;
   gdouble                center_y;
   gdouble                inner, outer;
-  guint32               *buf, *p;
   gdouble                angle;
   gdouble                hue;
   gdouble                r, g, b;
-  cairo_surface_t       *source;
-  cairo_t               *source_cr;
   gint                   stride;
-  gint                   focus_width;
-  gint                   focus_pad;
 
-  gtk_widget_get_allocation (GTK_WIDGET (wheel), &allocation);
-
-  gtk_widget_style_get (widget,
-                        "focus-line-width", &focus_width,
-                        "focus-padding", &focus_pad,
-                        NULL);
-
-  center_x = allocation.width / 2.0;
-  center_y = allocation.height / 2.0;
+  center_x = width / 2.0;
+  center_y = height / 2.0;
 
   outer = priv->size / 2.0;
   inner = outer - priv->ring_width;
 
-  /* Create an image initialized with the ring colors */
+  surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, width, height);
+
+  cairo_surface_flush (surface);
 
-  stride = cairo_format_stride_for_width (CAIRO_FORMAT_RGB24, width);
-  buf = g_new (guint32, height * stride / 4);
+  buf    = (guint32 *) cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
 
   for (yy = 0; yy < height; yy++)
     {
-      p = buf + yy * width;
+      p = buf + yy * stride / 4;
 
-      dy = -(yy + y - center_y);
+      dy = -(yy - center_y);
 
       for (xx = 0; xx < width; xx++)
         {
-          dx = xx + x - center_x;
+          dx = xx - center_x;
 
           dist = dx * dx + dy * dy;
           if (dist < ((inner-1) * (inner-1)) || dist > ((outer+1) * (outer+1)))
@@ -863,14 +872,58 @@ paint_ring (GimpColorWheel *wheel,
         }
     }
 
-  source = cairo_image_surface_create_for_data ((unsigned char *)buf,
-                                                CAIRO_FORMAT_RGB24,
-                                                width, height, stride);
+  cairo_surface_mark_dirty (surface);
+
+  return surface;
+}
+
+/* Paints the hue ring */
+static void
+paint_ring (GimpColorWheel *wheel,
+            cairo_t        *cr,
+            gint            x,
+            gint            y,
+            gint            width,
+            gint            height)
+{
+  GimpColorWheelPrivate *priv = wheel->priv;
+  GtkAllocation          allocation;
+  gdouble                center_x;
+  gdouble                center_y;
+  gdouble                inner, outer;
+  gdouble                r, g, b;
+
+  gtk_widget_get_allocation (GTK_WIDGET (wheel), &allocation);
 
-  /* Now draw the value marker onto the source image, so that it
-   * will get properly clipped at the edges of the ring
+  center_x = allocation.width / 2.0;
+  center_y = allocation.height / 2.0;
+
+  outer = priv->size / 2.0;
+  inner = outer - priv->ring_width;
+
+  if (! priv->ring_surface)
+    priv->ring_surface = create_ring_surface (wheel,
+                                              allocation.width,
+                                              allocation.height);
+
+  cairo_save (cr);
+
+  /* Clip to the ring, so the value marker gets properly clipped at
+   * its edges
    */
-  source_cr = cairo_create (source);
+  cairo_new_path (cr);
+  cairo_arc (cr, center_x, center_y, outer, 0, 2 * G_PI);
+  cairo_new_sub_path (cr);
+  cairo_arc (cr, center_x, center_y, inner, 0, 2 * G_PI);
+  cairo_set_fill_rule (cr, CAIRO_FILL_RULE_EVEN_ODD);
+  cairo_clip (cr);
+
+  /* Draw the ring from the cached image */
+
+  cairo_set_source_surface (cr, priv->ring_surface, 0, 0);
+  cairo_paint (cr);
+
+  /* Now draw the value marker on top */
 
   r = priv->h;
   g = 1.0;
@@ -878,35 +931,17 @@ paint_ring (GimpColorWheel *wheel,
   hsv_to_rgb (&r, &g, &b);
 
   if (INTENSITY (r, g, b) > 0.5)
-    cairo_set_source_rgb (source_cr, 0., 0., 0.);
+    cairo_set_source_rgb (cr, 0., 0., 0.);
   else
-    cairo_set_source_rgb (source_cr, 1., 1., 1.);
-
-  cairo_move_to (source_cr, -x + center_x, - y + center_y);
-  cairo_line_to (source_cr,
-                 -x + center_x + cos (priv->h * 2.0 * G_PI) * priv->size / 2,
-                 -y + center_y - sin (priv->h * 2.0 * G_PI) * priv->size / 2);
-  cairo_stroke (source_cr);
-  cairo_destroy (source_cr);
-
-  /* Draw the ring using the source image */
-
-  cairo_save (cr);
+    cairo_set_source_rgb (cr, 1., 1., 1.);
 
-  cairo_set_source_surface (cr, source, x, y);
-  cairo_surface_destroy (source);
-
-  cairo_set_line_width (cr, priv->ring_width);
-  cairo_new_path (cr);
-  cairo_arc (cr,
-             center_x, center_y,
-             priv->size / 2. - priv->ring_width / 2.,
-             0, 2 * G_PI);
+  cairo_move_to (cr, center_x, center_y);
+  cairo_line_to (cr,
+                 center_x + cos (priv->h * 2.0 * G_PI) * priv->size / 2,
+                 center_y - sin (priv->h * 2.0 * G_PI) * priv->size / 2);
   cairo_stroke (cr);
 
   cairo_restore (cr);
-
-  g_free (buf);
 }
 
 /* Converts an HSV triplet to an integer RGB triplet */
@@ -936,17 +971,14 @@ get_color (gdouble  h,
  */
 #define PAD 3
 
-/* Paints the HSV triangle */
-static void
-paint_triangle (GimpColorWheel *wheel,
-                cairo_t        *cr,
-                gint            x,
-                gint            y,
-                gint            width,
-                gint            height)
+/* Renders the shading of the HSV triangle for the whole allocation */
+static cairo_surface_t *
+create_triangle_surface (GimpColorWheel *wheel,
+                         gint            width,
+                         gint            height)
 {
-  GtkWidget             *widget = GTK_WIDGET (wheel);
-  GimpColorWheelPrivate *priv   = wheel->priv;
+  GimpColorWheelPrivate *priv = wheel->priv;
+  cairo_surface_t       *surface;
   gint                   hx, hy, sx, sy, vx, vy; /* HSV vertices */
   gint                   x1, y1, r1, g1, b1; /* First vertex in scanline order */
   gint                   x2, y2, r2, g2, b2; /* Second vertex */
@@ -957,9 +989,6 @@ paint_triangle (GimpColorWheel *wheel,
   gint                   xx, yy;
   gint                   x_interp, y_interp;
   gint                   x_start, x_end;
-  cairo_surface_t       *source;
-  gdouble                r, g, b;
-  gchar                 *detail;
   gint                   stride;
 
   /* Compute triangle's vertices */
@@ -1007,16 +1036,20 @@ paint_triangle (GimpColorWheel *wheel,
 
   /* Shade the triangle */
 
-  stride = cairo_format_stride_for_width (CAIRO_FORMAT_RGB24, width);
-  buf = g_new (guint32, height * stride / 4);
+  surface = cairo_image_surface_create (CAIRO_FORMAT_RGB24, width, height);
+
+  cairo_surface_flush (surface);
+
+  buf    = (guint32 *) cairo_image_surface_get_data (surface);
+  stride = cairo_image_surface_get_stride (surface);
 
   for (yy = 0; yy < height; yy++)
     {
-      p = buf + yy * width;
+      p = buf + yy * stride / 4;
 
-      if (yy + y >= y1 - PAD && yy + y < y3 + PAD)
+      if (yy >= y1 - PAD && yy < y3 + PAD)
         {
-          y_interp = CLAMP (yy + y, y1, y3);
+          y_interp = CLAMP (yy, y1, y3);
 
           if (y_interp < y2)
             {
@@ -1049,13 +1082,13 @@ paint_triangle (GimpColorWheel *wheel,
               SWAP (bl, br, t);
             }
 
-          x_start = MAX (xl - PAD, x);
-          x_end = MIN (xr + PAD, x + width);
+          x_start = MAX (xl - PAD, 0);
+          x_end = MIN (xr + PAD, width);
           x_start = MIN (x_start, x_end);
 
           c = (rl << 16) | (gl << 8) | bl;
 
-          for (xx = x; xx < x_start; xx++)
+          for (xx = 0; xx < x_start; xx++)
             *p++ = c;
 
           for (; xx < x_end; xx++)
@@ -1069,28 +1102,64 @@ paint_triangle (GimpColorWheel *wheel,
 
           c = (rr << 16) | (gr << 8) | br;
 
-          for (; xx < x + width; xx++)
+          for (; xx < width; xx++)
             *p++ = c;
         }
     }
 
-  source = cairo_image_surface_create_for_data ((unsigned char *)buf,
-                                                CAIRO_FORMAT_RGB24,
-                                                width, height, stride);
+  cairo_surface_mark_dirty (surface);
+
+  return surface;
+}
+
+/* Paints the HSV triangle */
+static void
+paint_triangle (GimpColorWheel *wheel,
+                cairo_t        *cr,
+                gint            x,
+                gint            y,
+                gint            width,
+                gint            height)
+{
+  GtkWidget             *widget = GTK_WIDGET (wheel);
+  GimpColorWheelPrivate *priv   = wheel->priv;
+  gint                   hx, hy, sx, sy, vx, vy; /* HSV vertices */
+  gint                   xx, yy;
+  gdouble                r, g, b;
+  gchar                 *detail;
+
+  /* Compute triangle's vertices */
+
+  compute_triangle (wheel, &hx, &hy, &sx, &sy, &vx, &vy);
+
+  if (priv->triangle_surface && priv->triangle_h != priv->h)
+    {
+      cairo_surface_destroy (priv->triangle_surface);
+      priv->triangle_surface = NULL;
+    }
+
+  if (! priv->triangle_surface)
+    {
+      GtkAllocation allocation;
+
+      gtk_widget_get_allocation (widget, &allocation);
 
-  /* Draw a triangle with the image as a source */
+      priv->triangle_surface = create_triangle_surface (wheel,
+                                                        allocation.width,
+                                                        allocation.height);
+      priv->triangle_h       = priv->h;
+    }
 
-  cairo_set_source_surface (cr, source, x, y);
-  cairo_surface_destroy (source);
+  /* Draw a triangle with the cached image as a source */
 
-  cairo_move_to (cr, x1, y1);
-  cairo_line_to (cr, x2, y2);
-  cairo_line_to (cr, x3, y3);
+  cairo_set_source_surface (cr, priv->triangle_surface, 0, 0);
+
+  cairo_move_to (cr, hx, hy);
+  cairo_line_to (cr, sx, sy);
+  cairo_line_to (cr, vx, vy);
   cairo_close_path (cr);
   cairo_fill (cr);
 
-  g_free (buf);
-
   /* Draw value marker */
 
   xx = floor (sx + (vx - sx) * priv->v + (hx - vx) * priv->s * priv->v + 0.5);
@@ -1357,6 +1426,8 @@ gimp_color_wheel_set_ring_fraction (GimpColorWheel *hsv,
 
   priv->ring_fraction = CLAMP (fraction, 0.01, 0.99);
 
+  gimp_color_wheel_clear_cache (hsv);
+
   gtk_widget_queue_draw (GTK_WIDGET (hsv));
 }
 
@@ -1407,6 +1478,24 @@ gimp_color_wheel_is_adjusting (GimpColorWheel *wheel)
   return priv->mode != DRAG_NONE;
 }
 
+static void
+gimp_color_wheel_clear_cache (GimpColorWheel *wheel)
+{
+  GimpColorWheelPrivate *priv = wheel->priv;
+
+  if (priv->ring_surface)
+    {
+      cairo_surface_destroy (priv->ring_surface);
+      priv->ring_surface = NULL;
+    }
+
+  if (priv->triangle_surface)
+    {
+      cairo_surface_destroy (priv->triangle_surface);
+      priv->triangle_surface = NULL;
+    }
+}
+
 static void
 gimp_color_wheel_move (GimpColorWheel   *wheel,
                        GtkDirectionType  dir)
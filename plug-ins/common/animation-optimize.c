@@ -60,6 +60,52 @@ typedef enum
 } operatingMode;
 
 
+/* A source layer, with its pixels read at once */
+typedef struct
+{
+  gint32      layer_id;
+  GeglBuffer *buffer;
+  gint        x, y;
+  gint        width, height;
+  gint        bpp;
+  gboolean    has_alpha;
+} FrameLayer;
+
+/* The rows of a frame are composed and diffed in parallel bands,
+ * only the frames themselves depend on each other.
+ */
+#define BAND_HEIGHT 32
+
+typedef enum
+{
+  PASS_COMPOSE,
+  PASS_COMPRESS
+} FramePass;
+
+typedef struct
+{
+  FramePass         pass;
+  const FrameLayer *layer;
+  const guchar     *layer_data;
+  DisposeType       dispose;
+  gboolean          diff;
+  const guchar     *last_frame;
+  guchar           *this_frame;
+  guchar           *opti_frame;
+  const guchar     *back_frame;
+  gint32            bbox_top, bbox_bottom, bbox_left, bbox_right;
+} FrameContext;
+
+typedef struct
+{
+  gint      y1, y2;
+  gboolean  can_combine;
+  gint32    bbox_top, bbox_bottom, bbox_left, bbox_right;
+  gint32    rbox_top, rbox_bottom, rbox_left, rbox_right;
+  gboolean  done;
+} FrameBand;
+
+
 /* Declare local functions. */
 static  void query (void);
 static  void run   (const gchar      *name,
@@ -87,6 +133,31 @@ static  gboolean    is_ms_tag           (const gchar *str,
                                          gint        *duration,
                                          gint        *taglength);
 
+static  void        frame_layer_init    (FrameLayer       *layer,
+                                         gint32            layer_id);
+static  void        frame_layer_read    (const FrameLayer *layer,
+                                         gint              y1,
+                                         gint              y2,
+                                         guchar           *buf);
+static  void        frame_layer_clear   (FrameLayer       *layer);
+static  void        compose_rows        (const FrameLayer *layer,
+                                         const guchar     *layer_data,
+                                         gint              data_y,
+                                         DisposeType       dispose,
+                                         const guchar     *prev,
+                                         guchar           *dest,
+                                         gint              y1,
+                                         gint              y2);
+static  void        compose_band        (FrameBand        *band,
+                                         FrameContext     *context);
+static  void        compress_band       (FrameBand        *band,
+                                         FrameContext     *context);
+static  void        process_band        (FrameBand        *band,
+                                         FrameContext     *context);
+static  void        process_bands       (GThreadPool      *pool,
+                                         FrameBand        *bands,
+                                         gint              n_bands);
+
 
 const GimpPlugInInfo PLUG_IN_INFO =
 {
@@ -103,7 +174,6 @@ static  gint32            image_id;
 static  gint32            new_image_id;
 static  gint32            total_frames;
 static  gint32           *layers;
-static  GimpDrawable     *drawable;
 static  GimpImageBaseType imagetype;
 static  GimpImageType     drawabletype_alpha;
 static  guchar            pixelstep;
@@ -111,6 +181,9 @@ static  guchar           *palette;
 static  gint              ncolors;
 static  operatingMode     opmode;
 
+static  GMutex            band_mutex;
+static  GCond             band_cond;
+
 
 MAIN ()
 
@@ -240,6 +313,7 @@ run (const gchar      *name,
   run_mode = param[0].data.d_int32;
 
   INIT_I18N ();
+  gegl_init (NULL, NULL);
 
   if (run_mode == GIMP_RUN_NONINTERACTIVE && n_params != 3)
     {
@@ -298,95 +372,417 @@ total_alpha (guchar  *imdata,
 
 
 static void
-compose_row (gint          frame_num,
-             DisposeType   dispose,
-             gint          row_num,
-             guchar       *dest,
-             gint          dest_width,
-             GimpDrawable *drawable,
-             gboolean      cleanup)
+frame_layer_init (FrameLayer *layer,
+                  gint32      layer_id)
 {
-  static guchar *line_buf = NULL;
-  guchar        *srcptr;
-  GimpPixelRgn   pixel_rgn;
-  gint           rawx, rawy, rawbpp, rawwidth, rawheight;
-  gint           i;
-  gboolean       has_alpha;
+  layer->layer_id = layer_id;
+  layer->buffer   = gimp_drawable_get_buffer (layer_id);
 
-  if (cleanup)
-    {
-      if (line_buf)
-        {
-          g_free (line_buf);
-          line_buf = NULL;
-        }
+  gimp_drawable_offsets (layer_id, &layer->x, &layer->y);
 
-      return;
-    }
+  layer->width     = gimp_drawable_width (layer_id);
+  layer->height    = gimp_drawable_height (layer_id);
+  layer->bpp       = gimp_drawable_bpp (layer_id);
+  layer->has_alpha = gimp_drawable_has_alpha (layer_id);
+}
 
-  if (dispose == DISPOSE_REPLACE)
+/* Reads the layer's part of the image rows y1 to y2 - 1 into buf */
+static void
+frame_layer_read (const FrameLayer *layer,
+                  gint              y1,
+                  gint              y2,
+                  guchar           *buf)
+{
+  y1 = MAX (y1, layer->y) - layer->y;
+  y2 = MIN (y2, layer->y + layer->height) - layer->y;
+
+  if (y2 > y1)
+    gegl_buffer_get (layer->buffer,
+                     GEGL_RECTANGLE (0, y1, layer->width, y2 - y1), 1.0,
+                     NULL, buf,
+                     GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+}
+
+static void
+frame_layer_clear (FrameLayer *layer)
+{
+  if (layer->buffer)
     {
-      total_alpha (dest, dest_width, pixelstep);
+      g_object_unref (layer->buffer);
+      layer->buffer = NULL;
     }
+}
 
-  gimp_drawable_offsets (drawable->drawable_id,
-                         &rawx,
-                         &rawy);
+/* Composes the image rows y1 to y2 - 1 of a frame into dest, on top
+ * of prev (or of what is in dest already, if prev is NULL).
+ * layer_data holds the layer's rows, starting at image row data_y.
+ */
+static void
+compose_rows (const FrameLayer *layer,
+              const guchar     *layer_data,
+              gint              data_y,
+              DisposeType       dispose,
+              const guchar     *prev,
+              guchar           *dest,
+              gint              y1,
+              gint              y2)
+{
+  gint rowstride = width * pixelstep;
+  gint row_num;
 
-  rawheight = gimp_drawable_height (drawable->drawable_id);
+  for (row_num = y1; row_num < y2; row_num++)
+    {
+      guchar       *dest_row = dest + (row_num - y1) * rowstride;
+      const guchar *srcptr;
+      gint          i;
 
-  /* this frame has nothing to give us for this row; return */
-  if (row_num >= rawheight + rawy ||
-      row_num < rawy)
-    return;
+      if (dispose == DISPOSE_REPLACE)
+        total_alpha (dest_row, width, pixelstep);
+      else if (prev)
+        memcpy (dest_row, prev + (row_num - y1) * rowstride, rowstride);
 
-  rawbpp = gimp_drawable_bpp (drawable->drawable_id);
-  rawwidth = gimp_drawable_width (drawable->drawable_id);
-  has_alpha = gimp_drawable_has_alpha (drawable->drawable_id);
+      /* this frame has nothing to give us for this row */
+      if (row_num >= layer->height + layer->y ||
+          row_num < layer->y)
+        continue;
 
-  if (line_buf)
-    {
-      g_free (line_buf);
-      line_buf = NULL;
+      /* render... */
+
+      srcptr = layer_data + (row_num - data_y) * layer->width * layer->bpp;
+
+      for (i = layer->x; i < layer->width + layer->x; i++)
+        {
+          if (i >= 0 && i < width)
+            {
+              if ((! layer->has_alpha) ||
+                  ((*(srcptr + layer->bpp - 1)) & 128))
+                {
+                  gint pi;
+
+                  for (pi = 0; pi < pixelstep-1; pi++)
+                    {
+                      dest_row[i*pixelstep +pi] = *(srcptr + pi);
+                    }
+                  dest_row[i*pixelstep + pixelstep - 1] = 255;
+                }
+            }
+
+          srcptr += layer->bpp;
+        }
     }
-  line_buf = g_malloc (rawwidth * rawbpp);
+}
 
-  /* Initialise and fetch the raw new frame row */
 
-  gimp_pixel_rgn_init (&pixel_rgn,
-                       drawable,
-                       0, row_num - rawy,
-                       rawwidth, 1,
-                       FALSE,
-                       FALSE);
-  gimp_pixel_rgn_get_rect (&pixel_rgn,
-                           line_buf,
-                           0, row_num - rawy,
-                           rawwidth, 1);
+/* Optimizing Functions */
 
-  /* render... */
+/* Builds the rows of 'this' frame, and if asked to, diffs them against
+ * the 'last' frame, making pixels that didn't change transparent.
+ */
+static void
+compose_band (FrameBand    *band,
+              FrameContext *context)
+{
+  const guchar *last_frame = context->last_frame;
+  guchar       *this_frame = context->this_frame;
+  guchar       *opti_frame = context->opti_frame;
+  gint          xit, yit, byteit;
+
+  compose_rows (context->layer,
+                context->layer_data, context->layer->y,
+                context->dispose,
+                last_frame + band->y1 * width * pixelstep,
+                this_frame + band->y1 * width * pixelstep,
+                band->y1, band->y2);
+
+  if (opmode == OPFOREGROUND)
+    {
+      const guchar *back_frame = context->back_frame;
 
-  srcptr = line_buf;
+      for (yit=band->y1; yit<band->y2; yit++)
+        {
+          for (xit=0; xit<width; xit++)
+            {
+              for (byteit=0; byteit<pixelstep-1; byteit++)
+                {
+                  if (back_frame[yit*width*pixelstep + xit*pixelstep
+                                + byteit]
+                      !=
+                      this_frame[yit*width*pixelstep + xit*pixelstep
+                                + byteit])
+                    {
+                      goto enough;
+                    }
+                }
+              this_frame[yit*width*pixelstep + xit*pixelstep
+                        + pixelstep - 1] = 0;
+            enough:
+              /* nop */;
+            }
+        }
+    }
+
+  band->can_combine = TRUE;
+  band->bbox_left   = width;
+  band->bbox_top    = height;
+  band->bbox_right  = 0;
+  band->bbox_bottom = 0;
+  band->rbox_left   = width;
+  band->rbox_top    = height;
+  band->rbox_right  = 0;
+  band->rbox_bottom = 0;
+
+  if (! context->diff)
+    return;
+
+  /* copy 'this' frame into a buffer which we can safely molest */
+  memcpy (opti_frame + band->y1 * width * pixelstep,
+          this_frame + band->y1 * width * pixelstep,
+          (band->y2 - band->y1) * width * pixelstep);
+
+  /*
+   * SEARCH FOR BOUNDING BOX
+   */
+  for (yit=band->y1; yit<band->y2; yit++)
+    {
+      for (xit=0; xit<width; xit++)
+        {
+          gboolean keep_pix;
+          gboolean opaq_pix;
+
+          /* Check if 'this' and 'last' are transparent */
+          if (!(this_frame[yit*width*pixelstep + xit*pixelstep
+                          + pixelstep-1]&128)
+              &&
+              !(last_frame[yit*width*pixelstep + xit*pixelstep
+                          + pixelstep-1]&128))
+            {
+              keep_pix = FALSE;
+              opaq_pix = FALSE;
+              goto decided;
+            }
+          /* Check if just 'this' is transparent */
+          if ((last_frame[yit*width*pixelstep + xit*pixelstep
+                         + pixelstep-1]&128)
+              &&
+              !(this_frame[yit*width*pixelstep + xit*pixelstep
+                          + pixelstep-1]&128))
+            {
+              keep_pix = TRUE;
+              opaq_pix = FALSE;
+              band->can_combine = FALSE;
+              goto decided;
+            }
+          /* Check if just 'last' is transparent */
+          if (!(last_frame[yit*width*pixelstep + xit*pixelstep
+                          + pixelstep-1]&128)
+              &&
+              (this_frame[yit*width*pixelstep + xit*pixelstep
+                         + pixelstep-1]&128))
+            {
+              keep_pix = TRUE;
+              opaq_pix = TRUE;
+              goto decided;
+            }
+          /* If 'last' and 'this' are opaque, we have
+           *  to check if they're the same color - we
+           *  only have to keep the pixel if 'last' or
+           *  'this' are opaque and different.
+           */
+          keep_pix = FALSE;
+          opaq_pix = TRUE;
+          for (byteit=0; byteit<pixelstep-1; byteit++)
+            {
+              if ((last_frame[yit*width*pixelstep + xit*pixelstep
+                             + byteit]
+                   !=
+                   this_frame[yit*width*pixelstep + xit*pixelstep
+                             + byteit])
+                  )
+                {
+                  keep_pix = TRUE;
+                  goto decided;
+                }
+            }
+        decided:
+          if (opaq_pix)
+            {
+              if (xit<band->rbox_left) band->rbox_left=xit;
+              if (xit>band->rbox_right) band->rbox_right=xit;
+              if (yit<band->rbox_top) band->rbox_top=yit;
+              if (yit>band->rbox_bottom) band->rbox_bottom=yit;
+            }
+          if (keep_pix)
+            {
+              if (xit<band->bbox_left) band->bbox_left=xit;
+              if (xit>band->bbox_right) band->bbox_right=xit;
+              if (yit<band->bbox_top) band->bbox_top=yit;
+              if (yit>band->bbox_bottom) band->bbox_bottom=yit;
+            }
+          else
+            {
+              /* pixel didn't change this frame - make
+               *  it transparent in our optimized buffer!
+               */
+              opti_frame[yit*width*pixelstep + xit*pixelstep
+                        + pixelstep-1] = 0;
+            }
+        } /* xit */
+    } /* yit */
+}
 
-  for (i=rawx; i<rawwidth+rawx; i++)
+/* Try to optimize the pixel data for RLE or LZW compression
+ * by making some transparent pixels non-transparent if they
+ * would have the same color as the adjacent pixels.  This
+ * gives a better compression if the algorithm compresses
+ * the image line by line.
+ * See: http://bugzilla.gnome.org/show_bug.cgi?id=66367
+ * It may not be very efficient to add two additional passes
+ * over the pixels, but this hopefully makes the code easier
+ * to maintain and less error-prone.
+ */
+static void
+compress_band (FrameBand    *band,
+               FrameContext *context)
+{
+  const guchar *last_frame  = context->last_frame;
+  guchar       *opti_frame  = context->opti_frame;
+  gint32        bbox_left   = context->bbox_left;
+  gint32        bbox_right  = context->bbox_right;
+  gint          xit, yit, byteit;
+
+  for (yit = MAX (band->y1, context->bbox_top);
+       yit < MIN (band->y2, context->bbox_bottom);
+       yit++)
     {
-      if (i>=0 && i<dest_width)
+      /* Compare with previous pixels from left to right */
+      for (xit = bbox_left + 1; xit < bbox_right; xit++)
         {
-          if ((!has_alpha) || ((*(srcptr+rawbpp-1))&128))
+          if (!(opti_frame[yit*width*pixelstep
+                           + xit*pixelstep
+                           + pixelstep-1]&128)
+              && (opti_frame[yit*width*pixelstep
+                             + (xit-1)*pixelstep
+                             + pixelstep-1]&128)
+              && (last_frame[yit*width*pixelstep
+                             + xit*pixelstep
+                             + pixelstep-1]&128))
             {
-              gint pi;
+              for (byteit=0; byteit<pixelstep-1; byteit++)
+                {
+                  if (opti_frame[yit*width*pixelstep
+                                 + (xit-1)*pixelstep
+                                 + byteit]
+                      !=
+                      last_frame[yit*width*pixelstep
+                                 + xit*pixelstep
+                                 + byteit])
+                    {
+                      goto skip_right;
+                    }
+                }
+              /* copy the color and alpha */
+              for (byteit=0; byteit<pixelstep; byteit++)
+                {
+                  opti_frame[yit*width*pixelstep
+                             + xit*pixelstep
+                             + byteit]
+                    = last_frame[yit*width*pixelstep
+                                 + xit*pixelstep
+                                 + byteit];
+                }
+            }
+        skip_right:
+          /* nop */;
+        } /* xit */
 
-              for (pi = 0; pi < pixelstep-1; pi++)
+      /* Compare with next pixels from right to left */
+      for (xit = bbox_right - 2; xit >= bbox_left; xit--)
+        {
+          if (!(opti_frame[yit*width*pixelstep
+                           + xit*pixelstep
+                           + pixelstep-1]&128)
+              && (opti_frame[yit*width*pixelstep
+                             + (xit+1)*pixelstep
+                             + pixelstep-1]&128)
+              && (last_frame[yit*width*pixelstep
+                             + xit*pixelstep
+                             + pixelstep-1]&128))
+            {
+              for (byteit=0; byteit<pixelstep-1; byteit++)
                 {
-                  dest[i*pixelstep +pi] = *(srcptr + pi);
+                  if (opti_frame[yit*width*pixelstep
+                                 + (xit+1)*pixelstep
+                                 + byteit]
+                      !=
+                      last_frame[yit*width*pixelstep
+                                 + xit*pixelstep
+                                 + byteit])
+                    {
+                      goto skip_left;
+                    }
+                }
+              /* copy the color and alpha */
+              for (byteit=0; byteit<pixelstep; byteit++)
+                {
+                  opti_frame[yit*width*pixelstep
+                             + xit*pixelstep
+                             + byteit]
+                    = last_frame[yit*width*pixelstep
+                                 + xit*pixelstep
+                                 + byteit];
                 }
-              dest[i*pixelstep + pixelstep - 1] = 255;
             }
-        }
+        skip_left:
+          /* nop */;
+        } /* xit */
+    } /* yit */
+}
 
-      srcptr += rawbpp;
+static void
+process_band (FrameBand    *band,
+              FrameContext *context)
+{
+  switch (context->pass)
+    {
+    case PASS_COMPOSE:
+      compose_band (band, context);
+      break;
+
+    case PASS_COMPRESS:
+      compress_band (band, context);
+      break;
+    }
+
+  g_mutex_lock (&band_mutex);
+  band->done = TRUE;
+  g_cond_signal (&band_cond);
+  g_mutex_unlock (&band_mutex);
+}
+
+/* Runs the current pass on all bands and waits for them */
+static void
+process_bands (GThreadPool *pool,
+               FrameBand   *bands,
+               gint         n_bands)
+{
+  gint i;
+
+  for (i = 0; i < n_bands; i++)
+    {
+      bands[i].done = FALSE;
+
+      g_thread_pool_push (pool, &bands[i], NULL);
     }
 
+  g_mutex_lock (&band_mutex);
+
+  for (i = 0; i < n_bands; i++)
+    {
+      while (! bands[i].done)
+        g_cond_wait (&band_cond, &band_mutex);
+    }
+
+  g_mutex_unlock (&band_mutex);
 }
 
 
@@ -394,8 +790,9 @@ static gint32
 do_optimizations (GimpRunMode run_mode,
                   gboolean    diff_only)
 {
-  GimpPixelRgn   pixel_rgn;
-  static guchar *rawframe = NULL;
+  GeglBuffer    *buffer;
+  FrameLayer     layer;
+  guchar        *layer_data;
   guchar        *srcptr;
   guchar        *destptr;
   gint           row, this_frame_num;
@@ -477,13 +874,15 @@ do_optimizations (GimpRunMode run_mode,
     {
       /* iterate through all rows of all frames, find statistical
          mode for each pixel position. */
-      gint     i,j;
-      guchar **these_rows;
-      guchar **red;
-      guchar **green;
-      guchar **blue;
-      guint  **count;
-      guint   *num_colors;
+      gint         i,j;
+      guchar     **these_rows;
+      guchar     **red;
+      guchar     **green;
+      guchar     **blue;
+      guint      **count;
+      guint       *num_colors;
+      FrameLayer  *frame_layers;
+      gint         max_rowstride;
 
       these_rows = g_new (guchar *, total_frames);
       red =        g_new (guchar *, total_frames);
@@ -493,9 +892,21 @@ do_optimizations (GimpRunMode run_mode,
 
       num_colors = g_new (guint, width);
 
+      /* read the frames in bands of rows, each with a single call */
+      frame_layers = g_new (FrameLayer, total_frames);
+      max_rowstride = 0;
+
       for (this_frame_num=0; this_frame_num<total_frames; this_frame_num++)
         {
-          these_rows[this_frame_num] = g_malloc(width * pixelstep);
+          frame_layer_init (&frame_layers[this_frame_num],
+                            layers[total_frames-(this_frame_num+1)]);
+
+          max_rowstride = MAX (max_rowstride,
+                               frame_layers[this_frame_num].width *
+                               frame_layers[this_frame_num].bpp);
+
+          these_rows[this_frame_num] = g_malloc0 (BAND_HEIGHT *
+                                                  width * pixelstep);
 
           red[this_frame_num]   = g_new (guchar, width);
           green[this_frame_num] = g_new (guchar, width);
@@ -504,34 +915,47 @@ do_optimizations (GimpRunMode run_mode,
           count[this_frame_num] = g_new0(guint, width);
         }
 
+      layer_data = g_malloc (BAND_HEIGHT * max_rowstride);
+
       for (row = 0; row < height; row++)
         {
-          memset(num_colors, 0, width * sizeof(guint));
+          gint band_row = row % BAND_HEIGHT;
 
-          for (this_frame_num=0; this_frame_num<total_frames; this_frame_num++)
+          if (band_row == 0)
             {
-              drawable =
-                gimp_drawable_get (layers[total_frames-(this_frame_num+1)]);
+              gint band_end = MIN (row + BAND_HEIGHT, height);
+
+              for (this_frame_num=0;
+                   this_frame_num<total_frames;
+                   this_frame_num++)
+                {
+                  FrameLayer *frame_layer = &frame_layers[this_frame_num];
 
-              dispose = get_frame_disposal (this_frame_num);
+                  dispose = get_frame_disposal (this_frame_num);
 
-              compose_row(this_frame_num,
-                          dispose,
-                          row,
-                          these_rows[this_frame_num],
-                          width,
-                          drawable,
-                          FALSE
-                          );
+                  frame_layer_read (frame_layer, row, band_end, layer_data);
 
-              gimp_drawable_detach(drawable);
+                  compose_rows (frame_layer,
+                                layer_data, MAX (row, frame_layer->y),
+                                dispose,
+                                NULL,
+                                these_rows[this_frame_num],
+                                row, band_end);
+                }
+
+              gimp_progress_update ((gdouble) row / (gdouble) height);
             }
 
+          memset(num_colors, 0, width * sizeof(guint));
+
           for (this_frame_num=0; this_frame_num<total_frames; this_frame_num++)
             {
+              const guchar *this_row = (these_rows[this_frame_num] +
+                                        band_row * width * pixelstep);
+
               for (i=0; i<width; i++)
                 {
-                  if (these_rows[this_frame_num][i * pixelstep + pixelstep -1]
+                  if (this_row[i * pixelstep + pixelstep -1]
                       >= 128)
                     {
                       for (j=0; j<num_colors[i]; j++)
@@ -540,11 +964,11 @@ do_optimizations (GimpRunMode run_mode,
                           switch (pixelstep)
                             {
                             case 4:
-                              if (these_rows[this_frame_num][i * 4 +0] ==
+                              if (this_row[i * 4 +0] ==
                                   red[j][i] &&
-                                  these_rows[this_frame_num][i * 4 +1] ==
+                                  this_row[i * 4 +1] ==
                                   green[j][i] &&
-                                  these_rows[this_frame_num][i * 4 +2] ==
+                                  this_row[i * 4 +2] ==
                                   blue[j][i])
                                 {
                                   (count[j][i])++;
@@ -552,7 +976,7 @@ do_optimizations (GimpRunMode run_mode,
                                 }
                               break;
                             case 2:
-                              if (these_rows[this_frame_num][i * 2 +0] ==
+                              if (this_row[i * 2 +0] ==
                                   red[j][i])
                                 {
                                   (count[j][i])++;
@@ -567,13 +991,13 @@ do_optimizations (GimpRunMode run_mode,
 
                       count[num_colors[i]][i] = 1;
                       red[num_colors[i]][i] =
-                        these_rows[this_frame_num][i * pixelstep];
+                        this_row[i * pixelstep];
                       if (pixelstep == 4)
                         {
                           green[num_colors[i]][i] =
-                            these_rows[this_frame_num][i * 4 +1];
+                            this_row[i * 4 +1];
                           blue[num_colors[i]][i] =
-                            these_rows[this_frame_num][i * 4 +2];
+                            this_row[i * 4 +2];
                         }
                       num_colors[i]++;
                     }
@@ -619,6 +1043,8 @@ do_optimizations (GimpRunMode run_mode,
 
       for (this_frame_num=0; this_frame_num<total_frames; this_frame_num++)
         {
+          frame_layer_clear (&frame_layers[this_frame_num]);
+
           g_free (these_rows[this_frame_num]);
           g_free (red[this_frame_num]);
           g_free (green[this_frame_num]);
@@ -632,6 +1058,8 @@ do_optimizations (GimpRunMode run_mode,
       g_free (blue);
       g_free (count);
       g_free (num_colors);
+      g_free (frame_layers);
+      g_free (layer_data);
     }
 #endif
 
@@ -646,32 +1074,45 @@ do_optimizations (GimpRunMode run_mode,
 
       gimp_image_insert_layer (new_image_id, new_layer_id, -1, 0);
 
-      drawable = gimp_drawable_get (new_layer_id);
-
-      gimp_pixel_rgn_init (&pixel_rgn, drawable,
-                           0, 0,
-                           width, height,
-                           TRUE, FALSE);
-      gimp_pixel_rgn_set_rect (&pixel_rgn, back_frame,
-                               0, 0,
-                               width, height);
-      gimp_drawable_flush (drawable);
-      gimp_drawable_detach (drawable);
+      buffer = gimp_drawable_get_buffer (new_layer_id);
+
+      gegl_buffer_set (buffer, GEGL_RECTANGLE (0, 0, width, height), 0,
+                       NULL, back_frame, GEGL_AUTO_ROWSTRIDE);
+
+      g_object_unref (buffer);
     }
   else
     {
+      GThreadPool  *pool;
+      FrameContext  context;
+      FrameBand    *bands;
+      gint          n_bands;
+      gint          i;
+
+      n_bands = (height + BAND_HEIGHT - 1) / BAND_HEIGHT;
+      bands   = g_new0 (FrameBand, n_bands);
+
+      for (i = 0; i < n_bands; i++)
+        {
+          bands[i].y1 = i * BAND_HEIGHT;
+          bands[i].y2 = MIN (bands[i].y1 + BAND_HEIGHT, height);
+        }
+
+      pool = g_thread_pool_new ((GFunc) process_band, &context,
+                                g_get_num_processors (), FALSE, NULL);
+
       for (this_frame_num=0; this_frame_num<total_frames; this_frame_num++)
         {
+          guchar *tmp;
+
           /*
            * BUILD THIS FRAME into our 'this_frame' buffer.
            */
 
-          drawable =
-            gimp_drawable_get (layers[total_frames-(this_frame_num+1)]);
+          frame_layer_init (&layer, layers[total_frames-(this_frame_num+1)]);
 
           /* Image has been closed/etc since we got the layer list? */
-          /* FIXME - How do we tell if a gimp_drawable_get() fails? */
-          if (gimp_drawable_width (drawable->drawable_id) == 0)
+          if (layer.width == 0)
             {
               gimp_quit ();
             }
@@ -679,77 +1120,53 @@ do_optimizations (GimpRunMode run_mode,
           this_delay = get_frame_duration (this_frame_num);
           dispose    = get_frame_disposal (this_frame_num);
 
-          for (row = 0; row < height; row++)
-            {
-              compose_row (this_frame_num,
-                           dispose,
-                           row,
-                           &this_frame[pixelstep*width * row],
-                           width,
-                           drawable,
-                           FALSE
-                           );
-            }
-
-          /* clean up */
-          gimp_drawable_detach(drawable);
+          layer_data = g_malloc (layer.width * layer.height * layer.bpp);
 
+          frame_layer_read (&layer, layer.y, layer.y + layer.height,
+                            layer_data);
 
-          if (opmode == OPFOREGROUND)
-            {
-              gint xit, yit, byteit;
-
-              for (yit=0; yit<height; yit++)
-                {
-                  for (xit=0; xit<width; xit++)
-                    {
-                      for (byteit=0; byteit<pixelstep-1; byteit++)
-                        {
-                          if (back_frame[yit*width*pixelstep + xit*pixelstep
-                                        + byteit]
-                              !=
-                              this_frame[yit*width*pixelstep + xit*pixelstep
-                                        + byteit])
-                            {
-                              goto enough;
-                            }
-                        }
-                      this_frame[yit*width*pixelstep + xit*pixelstep
-                                + pixelstep - 1] = 0;
-                    enough:
-                      /* nop */;
-                    }
-                }
-            }
+          /* clean up */
+          frame_layer_clear (&layer);
 
           can_combine = FALSE;
           bbox_left   = 0;
           bbox_top    = 0;
           bbox_right  = width;
           bbox_bottom = height;
-          rbox_left   = 0;
-          rbox_top    = 0;
-          rbox_right  = width;
-          rbox_bottom = height;
 
-          /* copy 'this' frame into a buffer which we can safely molest */
-          memcpy (opti_frame, this_frame, frame_sizebytes);
+          /*
+           * Compose 'this' frame, on top of the 'last' one, and
+           * diff them
+           */
+          context.pass       = PASS_COMPOSE;
+          context.layer      = &layer;
+          context.layer_data = layer_data;
+          context.dispose    = dispose;
+          context.last_frame = last_frame;
+          context.this_frame = this_frame;
+          context.opti_frame = opti_frame;
+          context.back_frame = back_frame;
+
+          /* Can't delta bottom frame! */
+          context.diff = (this_frame_num != 0 && opmode == OPOPTIMIZE);
+
+          process_bands (pool, bands, n_bands);
+
+          g_free (layer_data);
+
           /*
            *
            * OPTIMIZE HERE!
            *
            */
-          if (
-              (this_frame_num != 0) /* Can't delta bottom frame! */
-              && (opmode == OPOPTIMIZE)
-              )
+          if (context.diff)
             {
               gint xit, yit, byteit;
 
               can_combine = TRUE;
 
               /*
-               * SEARCH FOR BOUNDING BOX
+               * MERGE THE BANDS' BOUNDING BOXES
                */
               bbox_left   = width;
               bbox_top    = height;
@@ -760,92 +1177,19 @@ do_optimizations (GimpRunMode run_mode,
               rbox_right  = 0;
               rbox_bottom = 0;
 
-              for (yit=0; yit<height; yit++)
+              for (i = 0; i < n_bands; i++)
                 {
-                  for (xit=0; xit<width; xit++)
-                    {
-                      gboolean keep_pix;
-                      gboolean opaq_pix;
-
-                      /* Check if 'this' and 'last' are transparent */
-                      if (!(this_frame[yit*width*pixelstep + xit*pixelstep
-                                      + pixelstep-1]&128)
-                          &&
-                          !(last_frame[yit*width*pixelstep + xit*pixelstep
-                                      + pixelstep-1]&128))
-                        {
-                          keep_pix = FALSE;
-                          opaq_pix = FALSE;
-                          goto decided;
-                        }
-                      /* Check if just 'this' is transparent */
-                      if ((last_frame[yit*width*pixelstep + xit*pixelstep
-                                     + pixelstep-1]&128)
-                          &&
-                          !(this_frame[yit*width*pixelstep + xit*pixelstep
-                                      + pixelstep-1]&128))
-                        {
-                          keep_pix = TRUE;
-                          opaq_pix = FALSE;
-                          can_combine = FALSE;
-                          goto decided;
-                        }
-                      /* Check if just 'last' is transparent */
-                      if (!(last_frame[yit*width*pixelstep + xit*pixelstep
-                                      + pixelstep-1]&128)
-                          &&
-                          (this_frame[yit*width*pixelstep + xit*pixelstep
-                                     + pixelstep-1]&128))
-                        {
-                          keep_pix = TRUE;
-                          opaq_pix = TRUE;
-                          goto decided;
-                        }
-                      /* If 'last' and 'this' are opaque, we have
-                       *  to check if they're the same color - we
-                       *  only have to keep the pixel if 'last' or
-                       *  'this' are opaque and different.
-                       */
-                      keep_pix = FALSE;
-                      opaq_pix = TRUE;
-                      for (byteit=0; byteit<pixelstep-1; byteit++)
-                        {
-                          if ((last_frame[yit*width*pixelstep + xit*pixelstep
-                                         + byteit]
-                               !=
-                               this_frame[yit*width*pixelstep + xit*pixelstep
-                                         + byteit])
-                              )
-                            {
-                              keep_pix = TRUE;
-                              goto decided;
-                            }
-                        }
-                    decided:
-                      if (opaq_pix)
-                        {
-                          if (xit<rbox_left) rbox_left=xit;
-                          if (xit>rbox_right) rbox_right=xit;
-                          if (yit<rbox_top) rbox_top=yit;
-                          if (yit>rbox_bottom) rbox_bottom=yit;
-                        }
-                      if (keep_pix)
-                        {
-                          if (xit<bbox_left) bbox_left=xit;
-                          if (xit>bbox_right) bbox_right=xit;
-                          if (yit<bbox_top) bbox_top=yit;
-                          if (yit>bbox_bottom) bbox_bottom=yit;
-                        }
-                      else
-                        {
-                          /* pixel didn't change this frame - make
-                           *  it transparent in our optimized buffer!
-                           */
-                          opti_frame[yit*width*pixelstep + xit*pixelstep
-                                    + pixelstep-1] = 0;
-                        }
-                    } /* xit */
-                } /* yit */
+                  can_combine = can_combine && bands[i].can_combine;
+
+                  bbox_left   = MIN (bbox_left,   bands[i].bbox_left);
+                  bbox_top    = MIN (bbox_top,    bands[i].bbox_top);
+                  bbox_right  = MAX (bbox_right,  bands[i].bbox_right);
+                  bbox_bottom = MAX (bbox_bottom, bands[i].bbox_bottom);
+                  rbox_left   = MIN (rbox_left,   bands[i].rbox_left);
+                  rbox_top    = MIN (rbox_top,    bands[i].rbox_top);
+                  rbox_right  = MAX (rbox_right,  bands[i].rbox_right);
+                  rbox_bottom = MAX (rbox_bottom, bands[i].rbox_bottom);
+                }
 
               if (!can_combine)
                 {
@@ -860,100 +1204,13 @@ do_optimizations (GimpRunMode run_mode,
 
               if (can_combine && !diff_only)
                 {
-                  /* Try to optimize the pixel data for RLE or LZW compression
-                   * by making some transparent pixels non-transparent if they
-                   * would have the same color as the adjacent pixels.  This
-                   * gives a better compression if the algorithm compresses
-                   * the image line by line.
-                   * See: http://bugzilla.gnome.org/show_bug.cgi?id=66367
-                   * It may not be very efficient to add two additional passes
-                   * over the pixels, but this hopefully makes the code easier
-                   * to maintain and less error-prone.
-                   */
-                  for (yit = bbox_top; yit < bbox_bottom; yit++)
-                    {
-                      /* Compare with previous pixels from left to right */
-                      for (xit = bbox_left + 1; xit < bbox_right; xit++)
-                        {
-                          if (!(opti_frame[yit*width*pixelstep
-                                           + xit*pixelstep
-                                           + pixelstep-1]&128)
-                              && (opti_frame[yit*width*pixelstep
-                                             + (xit-1)*pixelstep
-                                             + pixelstep-1]&128)
-                              && (last_frame[yit*width*pixelstep
-                                             + xit*pixelstep
-                                             + pixelstep-1]&128))
-                            {
-                              for (byteit=0; byteit<pixelstep-1; byteit++)
-                                {
-                                  if (opti_frame[yit*width*pixelstep
-                                                 + (xit-1)*pixelstep
-                                                 + byteit]
-                                      !=
-                                      last_frame[yit*width*pixelstep
-                                                 + xit*pixelstep
-                                                 + byteit])
-                                    {
-                                      goto skip_right;
-                                    }
-                                }
-                              /* copy the color and alpha */
-                              for (byteit=0; byteit<pixelstep; byteit++)
-                                {
-                                  opti_frame[yit*width*pixelstep
-                                             + xit*pixelstep
-                                             + byteit]
-                                    = last_frame[yit*width*pixelstep
-                                                 + xit*pixelstep
-                                                 + byteit];
-                                }
-                            }
-                        skip_right:
-                          /* nop */;
-                        } /* xit */
+                  context.pass        = PASS_COMPRESS;
+                  context.bbox_top    = bbox_top;
+                  context.bbox_bottom = bbox_bottom;
+                  context.bbox_left   = bbox_left;
+                  context.bbox_right  = bbox_right;
 
-                      /* Compare with next pixels from right to left */
-                      for (xit = bbox_right - 2; xit >= bbox_left; xit--)
-                        {
-                          if (!(opti_frame[yit*width*pixelstep
-                                           + xit*pixelstep
-                                           + pixelstep-1]&128)
-                              && (opti_frame[yit*width*pixelstep
-                                             + (xit+1)*pixelstep
-                                             + pixelstep-1]&128)
-                              && (last_frame[yit*width*pixelstep
-                                             + xit*pixelstep
-                                             + pixelstep-1]&128))
-                            {
-                              for (byteit=0; byteit<pixelstep-1; byteit++)
-                                {
-                                  if (opti_frame[yit*width*pixelstep
-                                                 + (xit+1)*pixelstep
-                                                 + byteit]
-                                      !=
-                                      last_frame[yit*width*pixelstep
-                                                 + xit*pixelstep
-                                                 + byteit])
-                                    {
-                                      goto skip_left;
-                                    }
-                                }
-                              /* copy the color and alpha */
-                              for (byteit=0; byteit<pixelstep; byteit++)
-                                {
-                                  opti_frame[yit*width*pixelstep
-                                             + xit*pixelstep
-                                             + byteit]
-                                    = last_frame[yit*width*pixelstep
-                                                 + xit*pixelstep
-                                                 + byteit];
-                                }
-                            }
-                        skip_left:
-                          /* nop */;
-                        } /* xit */
-                    } /* yit */
+                  process_bands (pool, bands, n_bands);
                 }
 
               /*
@@ -994,7 +1251,9 @@ do_optimizations (GimpRunMode run_mode,
            * REMEMBER THE ANIMATION STATUS TO DELTA AGAINST NEXT TIME
            *
            */
-          memcpy (last_frame, this_frame, frame_sizebytes);
+          tmp        = last_frame;
+          last_frame = this_frame;
+          this_frame = tmp;
 
 
           /*
@@ -1070,23 +1329,25 @@ do_optimizations (GimpRunMode run_mode,
 
               gimp_image_insert_layer (new_image_id, new_layer_id, -1, 0);
 
-              drawable = gimp_drawable_get (new_layer_id);
-
-              gimp_pixel_rgn_init (&pixel_rgn, drawable, 0, 0,
-                                   bbox_right-bbox_left,
-                                   bbox_bottom-bbox_top,
-                                   TRUE, FALSE);
-              gimp_pixel_rgn_set_rect (&pixel_rgn, opti_frame, 0, 0,
-                                       bbox_right-bbox_left,
-                                       bbox_bottom-bbox_top);
-              gimp_drawable_flush (drawable);
-              gimp_drawable_detach (drawable);
+              buffer = gimp_drawable_get_buffer (new_layer_id);
+
+              gegl_buffer_set (buffer,
+                               GEGL_RECTANGLE (0, 0,
+                                               bbox_right-bbox_left,
+                                               bbox_bottom-bbox_top), 0,
+                               NULL, opti_frame, GEGL_AUTO_ROWSTRIDE);
+
+              g_object_unref (buffer);
               gimp_layer_translate (new_layer_id, bbox_left, bbox_top);
             }
 
           gimp_progress_update (((gdouble) this_frame_num + 1.0) /
                                 ((gdouble) total_frames));
         }
+
+      g_thread_pool_free (pool, FALSE, TRUE);
+      g_free (bands);
+
       gimp_progress_update (1.0);
     }
 
@@ -1095,9 +1356,6 @@ do_optimizations (GimpRunMode run_mode,
   if (run_mode != GIMP_RUN_NONINTERACTIVE)
     gimp_display_new (new_image_id);
 
-  g_free (rawframe);
-  rawframe = NULL;
-
   g_free (last_frame);
   last_frame = NULL;
 
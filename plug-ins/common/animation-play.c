@@ -26,8 +26,6 @@
  * TODO:
  *  pdb interface - should we bother?
  *
- *  speedups (caching?  most bottlenecks seem to be in pixelrgns)
- *    -> do pixelrgns properly!
  */
 
 #include "config.h"
@@ -46,6 +44,9 @@
 #define PLUG_IN_ROLE   "gimp-animation-play"
 #define DITHERTYPE     GDK_RGB_DITHER_NORMAL
 
+/* Memory for frames fetched ahead of playback, at display size. */
+#define FRAME_CACHE_MAX_BYTES (256 << 20)
+
 
 typedef enum
 {
@@ -112,6 +113,16 @@ static gboolean    repaint_da                (GtkWidget       *darea,
 
 static void        init_frames               (void);
 static void        render_frame              (gint32           whichframe);
+static void        frame_cache_clear         (void);
+static void        frame_cache_get_size      (guint           *drawing_width,
+                                              guint           *drawing_height,
+                                              gdouble         *drawing_scale);
+static gint        frame_cache_distance      (gint32           whichframe);
+static guchar     *frame_cache_alloc         (gint             distance);
+static void        frame_cache_fetch         (gint32           whichframe,
+                                              guchar          *data);
+static guchar     *frame_cache_get           (gint32           whichframe);
+static gboolean    frame_cache_prefetch      (gpointer         data);
 static void        show_frame                (void);
 static void        total_alpha_preview       (void);
 static void        update_alpha_preview      (void);
@@ -178,7 +189,9 @@ static gchar             *shape_preview_mask        = NULL;
 
 static gint32             total_frames              = 0;
 static gint32            *frames                    = NULL;
-static guchar            *rawframe                  = NULL;
+static guchar           **frame_cache               = NULL;
+static gint               frame_cache_count         = 0;
+static guint              prefetch_idle             = 0;
 static guint32           *frame_durations           = NULL;
 static guint              frame_number              = 0;
 
@@ -355,9 +368,8 @@ da_size_callback (GtkWidget *widget,
           g_free (new_entry_text);
         }
 
-      /* Update the rawframe. */
-      g_free (rawframe);
-      rawframe = g_malloc ((unsigned long) drawing_area_width * drawing_area_height * 4);
+      /* The cached frames have the wrong size now. */
+      frame_cache_clear ();
 
       /* As we re-allocated the drawn data, let's render it again. */
       if (frame_number < total_frames)
@@ -407,9 +419,8 @@ sda_size_callback (GtkWidget *widget,
           g_free (new_entry_text);
         }
 
-      /* Update the rawframe. */
-      g_free (rawframe);
-      rawframe = g_malloc ((unsigned long) shape_drawing_area_width * shape_drawing_area_height * 4);
+      /* The cached frames have the wrong size now. */
+      frame_cache_clear ();
 
       if (frame_number < total_frames)
         render_frame (frame_number);
@@ -578,6 +589,9 @@ detach_callback (GtkToggleAction *action)
   else
     gtk_widget_hide (shape_window);
 
+  /* The frames are cached for the other drawing area. */
+  frame_cache_clear ();
+
   render_frame (frame_number);
 }
 
@@ -1003,9 +1017,11 @@ init_frames (void)
   DisposeType   disposal = settings.default_frame_disposal;
   gchar        *layer_name;
 
+  /* Cleanup before re-generation. */
+  frame_cache_clear ();
+
   total_frames = total_layers;
 
-  /* Cleanup before re-generation. */
   if (frames)
     {
       gimp_image_delete (frames_image_id);
@@ -1126,8 +1142,8 @@ initialize (void)
 static void
 render_frame (gint32 whichframe)
 {
-  GeglBuffer    *buffer;
   gint           i, j, k;
+  guchar        *rawframe;
   guchar        *srcptr;
   guchar        *destptr;
   GtkWidget     *da;
@@ -1157,12 +1173,8 @@ render_frame (gint32 whichframe)
       total_alpha_preview ();
     }
 
-  buffer = gimp_drawable_get_buffer (frames[whichframe]);
-
-  /* Fetch and scale the whole raw new frame */
-  gegl_buffer_get (buffer, GEGL_RECTANGLE (0, 0, drawing_width, drawing_height),
-                   drawing_scale, babl_format ("R'G'B'A u8"),
-                   rawframe, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
+  /* The whole raw new frame, scaled */
+  rawframe = frame_cache_get (whichframe);
 
   /* Number of pixels. */
   i = drawing_width * drawing_height;
@@ -1215,8 +1227,174 @@ render_frame (gint32 whichframe)
                        GDK_RGB_DITHER_MAX : DITHERTYPE),
                       preview_data, drawing_width * 3);
 
-  /* clean up */
+  /* Fetch the next frames while we wait for the timer. */
+  if (total_frames > 1 && ! prefetch_idle)
+    prefetch_idle = g_idle_add_full (G_PRIORITY_LOW,
+                                     frame_cache_prefetch, NULL, NULL);
+}
+
+/* The frame cache keeps frames fetched and scaled for the current
+ * drawing area. It is filled ahead of playback from an idle handler;
+ * libgimp can't be used from other threads.
+ */
+
+static void
+frame_cache_clear (void)
+{
+  if (prefetch_idle)
+    {
+      g_source_remove (prefetch_idle);
+      prefetch_idle = 0;
+    }
+
+  if (frame_cache)
+    {
+      gint i;
+
+      for (i = 0; i < total_frames; i++)
+        g_free (frame_cache[i]);
+
+      g_free (frame_cache);
+      frame_cache = NULL;
+    }
+
+  frame_cache_count = 0;
+}
+
+static void
+frame_cache_get_size (guint   *drawing_width,
+                      guint   *drawing_height,
+                      gdouble *drawing_scale)
+{
+  if (detached)
+    {
+      *drawing_width  = shape_drawing_area_width;
+      *drawing_height = shape_drawing_area_height;
+      *drawing_scale  = shape_scale;
+    }
+  else
+    {
+      *drawing_width  = drawing_area_width;
+      *drawing_height = drawing_area_height;
+      *drawing_scale  = scale;
+    }
+}
+
+/* How many frames after the current one a frame will be shown. */
+static gint
+frame_cache_distance (gint32 whichframe)
+{
+  return (whichframe - (gint) frame_number + total_frames) % total_frames;
+}
+
+/* Makes room for a frame shown after distance frames by dropping a
+ * frame that is shown later, if the cache is full. Returns NULL if
+ * there is no such frame.
+ */
+static guchar *
+frame_cache_alloc (gint distance)
+{
+  guint   drawing_width, drawing_height;
+  gdouble drawing_scale;
+  gsize   frame_bytes;
+  gint    farthest = -1;
+  gint    i;
+  guchar *data;
+
+  frame_cache_get_size (&drawing_width, &drawing_height, &drawing_scale);
+
+  frame_bytes = (gsize) drawing_width * drawing_height * 4;
+
+  if (frame_cache_count < MAX (1, FRAME_CACHE_MAX_BYTES / frame_bytes))
+    {
+      frame_cache_count++;
+
+      return g_malloc (frame_bytes);
+    }
+
+  for (i = 0; i < total_frames; i++)
+    {
+      if (frame_cache[i] &&
+          (farthest < 0 ||
+           frame_cache_distance (i) > frame_cache_distance (farthest)))
+        farthest = i;
+    }
+
+  if (farthest < 0 || frame_cache_distance (farthest) <= distance)
+    return NULL;
+
+  data = frame_cache[farthest];
+  frame_cache[farthest] = NULL;
+
+  return data;
+}
+
+static void
+frame_cache_fetch (gint32  whichframe,
+                   guchar *data)
+{
+  GeglBuffer *buffer;
+  guint       drawing_width, drawing_height;
+  gdouble     drawing_scale;
+
+  frame_cache_get_size (&drawing_width, &drawing_height, &drawing_scale);
+
+  buffer = gimp_drawable_get_buffer (frames[whichframe]);
+
+  /* Fetch and scale the whole raw new frame */
+  gegl_buffer_get (buffer, GEGL_RECTANGLE (0, 0, drawing_width, drawing_height),
+                   drawing_scale, babl_format ("R'G'B'A u8"),
+                   data, GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_CLAMP);
+
   g_object_unref (buffer);
+
+  frame_cache[whichframe] = data;
+}
+
+static guchar *
+frame_cache_get (gint32 whichframe)
+{
+  if (! frame_cache)
+    frame_cache = g_new0 (guchar *, total_frames);
+
+  /*  this frame is needed now, drop any other one if necessary  */
+  if (! frame_cache[whichframe])
+    frame_cache_fetch (whichframe, frame_cache_alloc (-1));
+
+  return frame_cache[whichframe];
+}
+
+static gboolean
+frame_cache_prefetch (gpointer data)
+{
+  gint distance;
+
+  if (frame_cache)
+    {
+      for (distance = 1; distance < total_frames; distance++)
+        {
+          gint32 whichframe = (frame_number + distance) % total_frames;
+
+          if (! frame_cache[whichframe])
+            {
+              guchar *frame_data = frame_cache_alloc (distance);
+
+              if (frame_data)
+                {
+                  /* one frame per idle, to keep the UI responsive */
+                  frame_cache_fetch (whichframe, frame_data);
+
+                  return TRUE;
+                }
+
+              break;
+            }
+        }
+    }
+
+  prefetch_idle = 0;
+
+  return FALSE;
 }
 
 static void
@@ -1320,6 +1498,8 @@ window_destroy (GtkWidget *widget)
   if (playing)
     remove_timer ();
 
+  frame_cache_clear ();
+
   if (shape_window)
     gtk_widget_destroy (GTK_WIDGET (shape_window));
 
@@ -202,6 +202,7 @@ run (const gchar      *name,
   run_mode = param[0].data.d_int32;
 
   INIT_I18N ();
+  gegl_init (NULL, NULL);
 
   *nreturn_vals = 1;
   *return_vals  = values;
@@ -318,24 +319,24 @@ cm_calculate_norm (CmParamsType  *mix,
   return fabs (1 / sum);
 }
 
-static inline guchar
+static inline gfloat
 cm_mix_pixel (CmChannelType *ch,
-              guchar         r,
-              guchar         g,
-              guchar         b,
+              gfloat         r,
+              gfloat         g,
+              gfloat         b,
               gdouble        norm)
 {
   gdouble c = ch->red_gain * r + ch->green_gain * g + ch->blue_gain * b;
 
   c *= norm;
 
-  return (guchar) CLAMP0255 (c);
+  return CLAMP (c, 0.0, 1.0);
 }
 
 static inline void
 cm_process_pixel (CmParamsType  *mix,
-                  const guchar  *s,
-                  guchar        *d,
+                  const gfloat  *s,
+                  gfloat        *d,
                   const gdouble  red_norm,
                   const gdouble  green_norm,
                   const gdouble  blue_norm,
@@ -354,84 +355,56 @@ cm_process_pixel (CmParamsType  *mix,
     }
 }
 
-static void
-channel_mixer (CmParamsType *mix,
-               GimpDrawable *drawable)
+typedef struct
 {
-  GimpPixelRgn  src_rgn, dest_rgn;
-  gpointer      pr;
-  gboolean      has_alpha;
-  gdouble       red_norm, green_norm, blue_norm, black_norm;
-  gint          i, total, processed = 0;
-  gint          x1, y1;
-  gint          width, height;
-
-  if (! gimp_drawable_mask_intersect (drawable->drawable_id,
-                                      &x1, &y1, &width, &height))
-    return;
-
-  red_norm   = cm_calculate_norm (mix, &mix->red);
-  green_norm = cm_calculate_norm (mix, &mix->green);
-  blue_norm  = cm_calculate_norm (mix, &mix->blue);
-  black_norm = cm_calculate_norm (mix, &mix->black);
-
-  has_alpha = gimp_drawable_has_alpha (drawable->drawable_id);
-
-  gimp_pixel_rgn_init (&src_rgn, drawable,
-                       x1, y1, width, height, FALSE, FALSE);
-  gimp_pixel_rgn_init (&dest_rgn, drawable,
-                       x1, y1, width, height, TRUE, TRUE);
+  CmParamsType *mix;
+  gdouble       red_norm;
+  gdouble       green_norm;
+  gdouble       blue_norm;
+  gdouble       black_norm;
+} CmIterData;
 
-  total = width * height;
+static void
+channel_mixer_func (const GeglRectangle *rect,
+                    const guchar        *src,
+                    guchar              *dest,
+                    gpointer             data)
+{
+  CmIterData   *iter  = data;
+  const gfloat *s     = (const gfloat *) src;
+  gfloat       *d     = (gfloat *) dest;
+  gint          count = rect->width * rect->height;
 
-  for (pr = gimp_pixel_rgns_register (2, &src_rgn, &dest_rgn), i = 0;
-       pr != NULL;
-       pr = gimp_pixel_rgns_process (pr), i++)
+  while (count--)
     {
-      const guchar *src  = src_rgn.data;
-      guchar       *dest = dest_rgn.data;
-      gint          x, y;
-
-      for (y = 0; y < src_rgn.h; y++)
-        {
-          const guchar *s = src;
-          guchar       *d = dest;
+      cm_process_pixel (iter->mix, s, d,
+                        iter->red_norm, iter->green_norm, iter->blue_norm,
+                        iter->black_norm);
+      d[3] = s[3];
 
-          if (has_alpha)
-            {
-              for (x = 0; x < src_rgn.w; x++, s += 4, d += 4)
-                {
-                  cm_process_pixel (mix, s, d,
-                                    red_norm, green_norm, blue_norm,
-                                    black_norm);
-                  d[3] = s[3];
-                }
-            }
-          else
-            {
-              for (x = 0; x < src_rgn.w; x++, s += 3, d += 3)
-                {
-                  cm_process_pixel (mix, s, d,
-                                    red_norm, green_norm, blue_norm,
-                                    black_norm);
-                }
-            }
+      s += 4;
+      d += 4;
+    }
+}
 
-          src += src_rgn.rowstride;
-          dest += dest_rgn.rowstride;
-        }
+static void
+channel_mixer (CmParamsType *mix,
+               GimpDrawable *drawable)
+{
+  CmIterData iter;
 
-      processed += src_rgn.w * src_rgn.h;
+  iter.mix        = mix;
+  iter.red_norm   = cm_calculate_norm (mix, &mix->red);
+  iter.green_norm = cm_calculate_norm (mix, &mix->green);
+  iter.blue_norm  = cm_calculate_norm (mix, &mix->blue);
+  iter.black_norm = cm_calculate_norm (mix, &mix->black);
 
-      if (i % 16 == 0)
-        gimp_progress_update ((gdouble) processed / (gdouble) total);
-    }
+  /*  work in floats, so high bit depth drawables keep their precision  */
+  gimp_drawable_iterate (drawable->drawable_id,
+                         babl_format ("R'G'B'A float"),
+                         channel_mixer_func, &iter, TRUE);
 
   gimp_progress_update (1.0);
-
-  gimp_drawable_flush (drawable);
-  gimp_drawable_merge_shadow (drawable->drawable_id, TRUE);
-  gimp_drawable_update (drawable->drawable_id, x1, y1, width, height);
 }
 
 static gboolean
@@ -803,10 +776,20 @@ cm_preview (CmParamsType *mix,
     {
       for (x = 0; x < width; x++, s += bpp, d += bpp)
         {
-          cm_process_pixel (mix, s, d,
+          gfloat sf[3];
+          gfloat df[3];
+          gint   b;
+
+          for (b = 0; b < 3; b++)
+            sf[b] = s[b] / 255.0;
+
+          cm_process_pixel (mix, sf, df,
                             red_norm, green_norm, blue_norm,
                             black_norm);
 
+          for (b = 0; b < 3; b++)
+            d[b] = ROUND (df[b] * 255.0);
+
           if (bpp == 4)
             d[3] = s[3];
         }
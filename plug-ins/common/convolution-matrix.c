@@ -46,7 +46,6 @@
 
 #define HALF_WINDOW   (MATRIX_SIZE/2)
 #define MATRIX_CELLS  (MATRIX_SIZE*MATRIX_SIZE)
-#define DEST_ROWS     (MATRIX_SIZE/2 + 1)
 #define CHANNELS      (5)
 #define BORDER_MODES  (3)
 
@@ -90,10 +89,11 @@ static void      convolve_image        (GimpDrawable  *drawable,
 
 static void      check_config          (GimpDrawable  *drawable);
 
-static gfloat    convolve_pixel        (guchar       **src_row,
-                                        gint           x_offset,
-                                        gint           channel,
-                                        GimpDrawable  *drawable);
+typedef struct _ConvolveContext ConvolveContext;
+typedef struct _ConvolveBand    ConvolveBand;
+
+static void      convolve_band         (ConvolveBand  *band,
+                                        gpointer       data);
 
 const GimpPlugInInfo PLUG_IN_INFO =
 {
@@ -164,6 +164,46 @@ static const config_struct default_config =
 
 static config_struct config;
 
+/*  A nonzero matrix entry  */
+typedef struct
+{
+  gint   x;
+  gint   y;
+  gfloat weight;
+} ConvolveTap;
+
+/*  What the threads convolving bands of rows share  */
+struct _ConvolveContext
+{
+  const guchar *src;              /* source rows, with HALF_WINDOW borders */
+  gint          src_rowstride;
+  guchar       *dest;
+  gint          width;
+  gint          bpp;
+  gint          alpha_channel;
+  gboolean      chanmask[CHANNELS - 1];
+  gfloat        matrixsum;
+
+  ConvolveTap   taps[MATRIX_CELLS];
+  gint          n_taps;
+
+  /*  a matrix of rank 1 is the product of a column and a row  */
+  gboolean      separable;
+  gfloat        h[MATRIX_SIZE];
+  gfloat        v[MATRIX_SIZE];
+};
+
+struct _ConvolveBand
+{
+  const ConvolveContext *context;
+  gint                   y1;
+  gint                   y2;      /* Rows y1 to y2 - 1 */
+  gboolean               done;
+};
+
+static GMutex band_mutex;
+static GCond  band_cond;
+
 struct
 {
   GtkWidget *matrix[MATRIX_SIZE][MATRIX_SIZE];
@@ -226,6 +266,7 @@ run (const gchar      *name,
   GimpDrawable      *drawable;
 
   INIT_I18N ();
+  gegl_init (NULL, NULL);
 
   *nreturn_vals = 1;
   *return_vals = values;
@@ -312,8 +353,6 @@ run (const gchar      *name,
           gimp_drawable_is_gray (drawable->drawable_id))
         {
           gimp_progress_init (_("Applying convolution"));
-          gimp_tile_cache_ntiles (2 * (drawable->width /
-                                  gimp_tile_width () + 1));
           convolve_image (drawable, NULL);
 
           if (run_mode != GIMP_RUN_NONINTERACTIVE)
@@ -335,203 +374,123 @@ run (const gchar      *name,
 }
 
 
-/*  A generic wrapper to gimp_pixel_rgn_get_row which handles unlimited
- *  wrapping or gives the transparent regions outside the image
- *  fills additional bytes before and after image row to provide border modes.
+/*  Finds the nonzero entries of the matrix, and whether applying it as
+ *  a horizontal and a vertical pass needs fewer multiplications.
  */
-
 static void
-my_get_row (GimpPixelRgn *PR,
-            guchar       *dest,
-            gint          x,
-            gint          y,
-            gint          w)
+convolve_setup (ConvolveContext *context)
 {
-  gint width, height, bpp;
-  gint i;
-
-  width  = PR->drawable->width;
-  height = PR->drawable->height;
-  bpp  = PR->drawable->bpp;
-
-  /* Y-wrappings */
-  switch (config.bmode)
-    {
-    case WRAP:
-      /* Wrapped, so we get the proper row from the other side */
-      while (y < 0) /* This is the _sure_ way to wrap. :) */
-        y += height;
-      while (y >= height)
-        y -= height;
-      break;
+  gfloat max   = 0.0;
+  gint   max_x = 0;
+  gint   max_y = 0;
+  gint   n_h   = 0;
+  gint   n_v   = 0;
+  gint   x, y;
 
-    case CLEAR:
-      /* Beyond borders, so set full transparent. */
-      if (y < 0 || y >= height)
-        {
-          memset (dest, 0, w * bpp);
-          return; /* Done, so back. */
-        }
+  context->matrixsum = 0.0;
+  context->n_taps    = 0;
+  context->separable = FALSE;
 
-    case EXTEND:
-      y = CLAMP (y , 0 , height - 1);
-      break;
-    }
+  for (y = 0; y < MATRIX_SIZE; y++)
+    for (x = 0; x < MATRIX_SIZE; x++)
+      {
+        gfloat weight = config.matrix[x][y];
 
+        context->matrixsum += ABS (weight);
 
-  /* X-wrappings */
-  switch (config.bmode)
-    {
-    case CLEAR:
-      if (x < 0)
-        {
-          i = MIN (w, -x);
-          memset (dest, 0, i * bpp);
-          dest += i * bpp;
-          w -= i;
-          x += i;
-        }
-      if (w)
-        {
-          i = MIN (w, width);
-          gimp_pixel_rgn_get_row (PR, dest, x, y, i);
-          dest += i * bpp;
-          w -= i;
-          x += i;
-        }
-      if (w)
-        memset (dest, 0, w * bpp);
-      break;
+        if (weight != 0.0)
+          {
+            context->taps[context->n_taps].x      = x;
+            context->taps[context->n_taps].y      = y;
+            context->taps[context->n_taps].weight = weight;
+            context->n_taps++;
+          }
 
-    case WRAP:
-      while (x < 0)
-        x += width;
-      i = MIN (w, width - x);
-      gimp_pixel_rgn_get_row (PR, dest, x, y, i);
-      w -= i;
-      dest += i * bpp;
-      x = 0;
-      while (w)
-        {
-          i = MIN (w, width);
-          gimp_pixel_rgn_get_row (PR, dest, x, y, i);
-          w -= i;
-          dest += i * bpp;
-        }
-      break;
+        if (ABS (weight) > max)
+          {
+            max   = ABS (weight);
+            max_x = x;
+            max_y = y;
+          }
+      }
 
-    case EXTEND:
-      if (x < 0)
-        {
-          gimp_pixel_rgn_get_pixel (PR, dest, 0, y);
-          x++;
-          w--;
-          dest += bpp;
+  if (max == 0.0)
+    return;
 
-          while (x < 0 && w)
-            {
-              for (i = 0; i < bpp; i++)
-                {
-                  *dest = *(dest - bpp);
-                  dest++;
-                }
-              x++;
-              w--;
-            }
-        }
-      if (w && width - x > 0)
-        {
-          i = MIN (w, width - x);
-          gimp_pixel_rgn_get_row (PR, dest, x, y, i);
-          w -= i;
-          dest += i * bpp;
-        }
-      while (w)
-        {
-          for (i = 0; i < bpp; i++)
-            {
-              *dest= *(dest - bpp);
-              dest++;
-            }
-          x++;
-          w--;
-        }
-      break;
+  for (x = 0; x < MATRIX_SIZE; x++)
+    {
+      context->h[x] = config.matrix[x][max_y];
 
+      if (context->h[x] != 0.0)
+        n_h++;
     }
-}
 
-static gfloat
-convolve_pixel (guchar       **src_row,
-                gint           x_offset,
-                gint           channel,
-                GimpDrawable  *drawable)
-{
-  static gfloat matrixsum = 0; /* FIXME: this certainly breaks the preview */
-  static gint bpp         = 0;
-
-  gfloat sum              = 0;
-  gfloat alphasum         = 0;
-  gint   x, y;
-  gint   alpha_channel;
-
-  if (!bpp)
+  for (y = 0; y < MATRIX_SIZE; y++)
     {
-      bpp = drawable->bpp;
+      context->v[y] = config.matrix[max_x][y] / config.matrix[max_x][max_y];
 
-      for (y = 0; y < MATRIX_SIZE; y++)
-        for (x = 0; x < MATRIX_SIZE; x++)
-          matrixsum += ABS (config.matrix[x][y]);
+      if (context->v[y] != 0.0)
+        n_v++;
     }
 
-  alpha_channel = bpp - 1;
-
   for (y = 0; y < MATRIX_SIZE; y++)
     for (x = 0; x < MATRIX_SIZE; x++)
       {
-        gfloat temp = config.matrix[x][y];
+        if (ABS (config.matrix[x][y] - context->h[x] * context->v[y]) >
+            max * 1e-5)
+          return;
+      }
 
-        if (channel != alpha_channel && config.alpha_weighting == 1)
-          {
-            temp *= src_row[y][x_offset + x * bpp + alpha_channel - channel];
-            alphasum += ABS (temp);
-          }
+  context->separable = (n_h + n_v < context->n_taps);
+}
 
-        temp *= src_row[y][x_offset + x * bpp];
-        sum += temp;
-      }
+/*  Applies the divisor, the alpha weighting and the offset to the sum
+ *  of the weighted pixels
+ */
+static inline guchar
+convolve_finish (const ConvolveContext *context,
+                 gfloat                 sum,
+                 gfloat                 alphasum,
+                 gboolean               weighted)
+{
+  gint result;
 
   sum /= config.divisor;
 
-  if (channel != alpha_channel && config.alpha_weighting == 1)
+  if (weighted)
     {
       if (alphasum != 0)
-        sum = sum * matrixsum / alphasum;
+        sum = sum * context->matrixsum / alphasum;
       else
         sum = 0;
     }
 
   sum += config.offset;
 
-  return sum;
+  result = ROUND (sum);
+
+  return CLAMP (result, 0, 255);
 }
 
 static void
 convolve_image (GimpDrawable *drawable,
                 GimpPreview  *preview)
 {
-  GimpPixelRgn  srcPR, destPR;
-  gint          width, height, row, col;
-  gint          src_w, src_row_w, src_h, i;
-  gint          src_x1, src_y1, src_x2, src_y2;
-  gint          x1, x2, y1, y2;
-  guchar       *dest_row[DEST_ROWS];
-  guchar       *src_row[MATRIX_SIZE];
-  guchar       *tmp_row;
-  gint          x_offset;
-  gboolean      chanmask[CHANNELS - 1];
-  gint          bpp;
-  gint          alpha_channel;
+  ConvolveContext  context;
+  GThreadPool     *pool;
+  ConvolveBand    *bands;
+  GeglBuffer      *buffer;
+  const Babl      *format;
+  GeglAbyssPolicy  abyss;
+  guchar          *src;
+  guchar          *dest;
+  gint             src_w, src_h;
+  gint             src_x1, src_y1, src_x2, src_y2;
+  gint             bpp;
+  gint             n_threads;
+  gint             n_bands;
+  gint             band_height;
+  gint             i;
 
   /* Get the input area. This is the bounding box of the selection in
    *  the image (or the entire image if there is no selection). Only
@@ -554,134 +513,302 @@ convolve_image (GimpDrawable *drawable,
       src_h = src_y2 - src_y1;
     }
 
-  /* Get the size of the input image. (This will/must be the same
-   *  as the size of the output image.
-   */
-  width  = drawable->width;
-  height = drawable->height;
-  bpp  = drawable->bpp;
-  alpha_channel = bpp - 1;
-
   if (gimp_drawable_is_rgb (drawable->drawable_id))
     {
-      for (i = 0; i < CHANNELS - 1; i++)
-        chanmask[i] = config.channels[i + 1];
+      if (gimp_drawable_has_alpha (drawable->drawable_id))
+        format = babl_format ("R'G'B'A u8");
+      else
+        format = babl_format ("R'G'B' u8");
     }
   else /* Grayscale */
     {
-      chanmask[0] = config.channels[0];
+      if (gimp_drawable_has_alpha (drawable->drawable_id))
+        format = babl_format ("Y'A u8");
+      else
+        format = babl_format ("Y' u8");
     }
 
-  if (gimp_drawable_has_alpha (drawable->drawable_id))
-    chanmask[alpha_channel] = config.channels[4];
-
-  src_row_w = src_w + HALF_WINDOW + HALF_WINDOW;
+  bpp = babl_format_get_bytes_per_pixel (format);
 
-  for (i = 0; i < MATRIX_SIZE; i++)
-    src_row[i] = g_new (guchar, src_row_w * bpp);
+  context.bpp           = bpp;
+  context.alpha_channel = bpp - 1;
+  context.width         = src_w;
 
-  for (i = 0; i < DEST_ROWS; i++)
-    dest_row[i]= g_new (guchar, src_w * bpp);
+  if (gimp_drawable_is_rgb (drawable->drawable_id))
+    {
+      for (i = 0; i < CHANNELS - 1; i++)
+        context.chanmask[i] = config.channels[i + 1];
+    }
+  else /* Grayscale */
+    {
+      context.chanmask[0] = config.channels[0];
+    }
 
-  /*  initialize the pixel regions  */
-  x1 = MAX (src_x1 - HALF_WINDOW, 0);
-  y1 = MAX (src_y1 - HALF_WINDOW, 0);
-  x2 = MIN (src_x2 + HALF_WINDOW, width);
-  y2 = MIN (src_y2 + HALF_WINDOW, height);
-  gimp_pixel_rgn_init (&srcPR, drawable,
-                       x1, y1, x2 - x1, y2 - y1, FALSE, FALSE);
-  gimp_pixel_rgn_init (&destPR, drawable,
-                       src_x1, src_y1, src_w, src_h,
-                       preview == NULL, TRUE);
+  if (gimp_drawable_has_alpha (drawable->drawable_id))
+    context.chanmask[context.alpha_channel] = config.channels[4];
 
-  /* initialize source arrays */
-  for (i = 0; i < MATRIX_SIZE; i++)
-    my_get_row (&srcPR, src_row[i], src_x1 - HALF_WINDOW,
-                src_y1 - HALF_WINDOW + i , src_row_w);
+  convolve_setup (&context);
 
-  for (row = src_y1; row < src_y2; row++)
+  /*  The border modes map to GEGL's abyss policies  */
+  switch (config.bmode)
     {
-      gint channel;
-
-      x_offset = 0;
+    case WRAP:
+      abyss = GEGL_ABYSS_LOOP;
+      break;
 
-      for (col = src_x1; col < src_x2; col++)
-        for (channel = 0; channel < bpp; channel++)
-          {
-            guchar d;
+    case CLEAR:
+      abyss = GEGL_ABYSS_NONE;
+      break;
 
-            if (chanmask[channel])
-              {
-                gint result;
+    case EXTEND:
+    default:
+      abyss = GEGL_ABYSS_CLAMP;
+      break;
+    }
 
-                result = ROUND (convolve_pixel (src_row,
-                                                x_offset, channel, drawable));
-                d = CLAMP (result, 0, 255);
-              }
-            else
-              {
-                /* copy unmodified pixel */
-                d = src_row[HALF_WINDOW][x_offset + HALF_WINDOW * bpp];
-              }
+  /*  read the input area and its borders at once  */
+  context.src_rowstride = (src_w + 2 * HALF_WINDOW) * bpp;
 
-            dest_row[HALF_WINDOW][x_offset] = d;
-            x_offset++;
-          }
+  src  = g_new (guchar, context.src_rowstride * (src_h + 2 * HALF_WINDOW));
+  dest = g_new (guchar, src_w * src_h * bpp);
 
-      if (row >= src_y1 + HALF_WINDOW)
-        gimp_pixel_rgn_set_row (&destPR,
-                                dest_row[0], src_x1, row - HALF_WINDOW, src_w);
+  buffer = gimp_drawable_get_buffer (drawable->drawable_id);
 
-      if (row < src_y2 - 1)
-        {
-          tmp_row = dest_row[0];
+  gegl_buffer_get (buffer,
+                   GEGL_RECTANGLE (src_x1 - HALF_WINDOW, src_y1 - HALF_WINDOW,
+                                   src_w + 2 * HALF_WINDOW,
+                                   src_h + 2 * HALF_WINDOW),
+                   1.0, format, src, context.src_rowstride, abyss);
 
-          for (i = 0; i < DEST_ROWS - 1; i++)
-            dest_row[i] = dest_row[i + 1];
+  context.src  = src;
+  context.dest = dest;
 
-          dest_row[DEST_ROWS - 1] = tmp_row;
+  n_threads   = g_get_num_processors ();
+  band_height = MAX (32, (src_h + 4 * n_threads - 1) / (4 * n_threads));
+  band_height = MIN (band_height, src_h);
+  band_height = MAX (band_height, 1);
+  n_bands     = (src_h + band_height - 1) / band_height;
 
-          tmp_row = src_row[0];
+  bands = g_new0 (ConvolveBand, n_bands);
+  pool  = g_thread_pool_new ((GFunc) convolve_band, NULL,
+                             n_threads, FALSE, NULL);
 
-          for (i = 0; i < MATRIX_SIZE - 1; i++)
-            src_row[i] = src_row[i + 1];
+  for (i = 0; i < n_bands; i++)
+    {
+      bands[i].context = &context;
+      bands[i].y1      = i * band_height;
+      bands[i].y2      = MIN ((i + 1) * band_height, src_h);
 
-          src_row[MATRIX_SIZE-1] = tmp_row;
+      g_thread_pool_push (pool, &bands[i], NULL);
+    }
 
-          my_get_row (&srcPR, src_row[MATRIX_SIZE - 1],
-                      src_x1 - HALF_WINDOW, row + HALF_WINDOW + 1, src_row_w);
-        }
+  for (i = 0; i < n_bands; i++)
+    {
+      g_mutex_lock (&band_mutex);
+      while (! bands[i].done)
+        g_cond_wait (&band_cond, &band_mutex);
+      g_mutex_unlock (&band_mutex);
 
-      if ((row % 10 == 0) && !preview)
-        gimp_progress_update ((double) (row - src_y1) / src_h);
+      if (! preview)
+        gimp_progress_update ((gdouble) bands[i].y2 / src_h);
     }
 
-  /* put the remaining rows in the buffer in place */
-  for (i = 1; i <  DEST_ROWS; i++)
-    gimp_pixel_rgn_set_row (&destPR, dest_row[i],
-                            src_x1, src_y2 + i - 1 - HALF_WINDOW, src_w);
-
+  g_thread_pool_free (pool, FALSE, TRUE);
+  g_free (bands);
 
   /*  update the region  */
   if (preview)
     {
-      gimp_drawable_preview_draw_region (GIMP_DRAWABLE_PREVIEW (preview),
-                                         &destPR);
+      gimp_preview_draw_buffer (preview, dest, src_w * bpp);
     }
   else
     {
+      GeglBuffer *shadow = gimp_drawable_get_shadow_buffer (drawable->drawable_id);
+
+      gegl_buffer_set (shadow,
+                       GEGL_RECTANGLE (src_x1, src_y1, src_w, src_h), 0,
+                       format, dest, GEGL_AUTO_ROWSTRIDE);
+      g_object_unref (shadow);
+
       gimp_progress_update (1.0);
-      gimp_drawable_flush (drawable);
       gimp_drawable_merge_shadow (drawable->drawable_id, TRUE);
       gimp_drawable_update (drawable->drawable_id,
                             src_x1, src_y1, src_x2 - src_x1, src_y2 - src_y1);
     }
 
-  for (i = 0; i < MATRIX_SIZE; i++)
-    g_free (src_row[i]);
+  g_object_unref (buffer);
+
+  g_free (src);
+  g_free (dest);
+}
+
+/*  Convolves the rows of one band, either with all nonzero entries of
+ *  the matrix for each pixel, or with a horizontal pass into float rows
+ *  followed by a vertical pass.
+ */
+static void
+convolve_band (ConvolveBand *band,
+               gpointer      data)
+{
+  const ConvolveContext *context  = band->context;
+  const gint             width    = context->width;
+  const gint             bpp      = context->bpp;
+  const gint             alpha    = context->alpha_channel;
+  const gint             stride   = context->src_rowstride;
+  const gboolean         weighing = (config.alpha_weighting == 1);
+  gint                   x, y, channel;
+
+  if (context->separable)
+    {
+      const gint  n_rows    = band->y2 - band->y1 + 2 * HALF_WINDOW;
+      gfloat     *h_sum     = g_new (gfloat, n_rows * width * bpp);
+      gfloat     *h_alpha   = NULL;
+      gint        r;
+
+      if (weighing)
+        h_alpha = g_new (gfloat, n_rows * width);
+
+      /*  horizontal pass  */
+      for (r = 0; r < n_rows; r++)
+        {
+          const guchar *row = context->src + (band->y1 + r) * stride;
+          gfloat       *out = h_sum + r * width * bpp;
+
+          for (x = 0; x < width; x++)
+            {
+              const guchar *s = row + x * bpp;
+              gint          i;
+
+              for (channel = 0; channel < bpp; channel++)
+                {
+                  gfloat sum = 0.0;
+
+                  if (weighing && channel != alpha)
+                    {
+                      for (i = 0; i < MATRIX_SIZE; i++)
+                        sum += (context->h[i] *
+                                s[i * bpp + alpha] * s[i * bpp + channel]);
+                    }
+                  else
+                    {
+                      for (i = 0; i < MATRIX_SIZE; i++)
+                        sum += context->h[i] * s[i * bpp + channel];
+                    }
+
+                  out[x * bpp + channel] = sum;
+                }
+
+              if (weighing)
+                {
+                  gfloat sum = 0.0;
+
+                  for (i = 0; i < MATRIX_SIZE; i++)
+                    sum += ABS (context->h[i]) * s[i * bpp + alpha];
+
+                  h_alpha[r * width + x] = sum;
+                }
+            }
+        }
+
+      /*  vertical pass  */
+      for (y = band->y1; y < band->y2; y++)
+        {
+          const gint  r    = y - band->y1;
+          guchar     *dest = context->dest + y * width * bpp;
+
+          for (x = 0; x < width; x++)
+            for (channel = 0; channel < bpp; channel++)
+              {
+                const gint offset = x * bpp + channel;
+
+                if (context->chanmask[channel])
+                  {
+                    gboolean weighted = weighing && channel != alpha;
+                    gfloat   sum      = 0.0;
+                    gfloat   alphasum = 0.0;
+                    gint     j;
+
+                    for (j = 0; j < MATRIX_SIZE; j++)
+                      sum += context->v[j] *
+                             h_sum[(r + j) * width * bpp + offset];
+
+                    if (weighted)
+                      for (j = 0; j < MATRIX_SIZE; j++)
+                        alphasum += ABS (context->v[j]) *
+                                    h_alpha[(r + j) * width + x];
+
+                    dest[offset] = convolve_finish (context,
+                                                    sum, alphasum, weighted);
+                  }
+                else
+                  {
+                    /* copy unmodified pixel */
+                    dest[offset] = context->src[(y + HALF_WINDOW) * stride +
+                                                (x + HALF_WINDOW) * bpp +
+                                                channel];
+                  }
+              }
+        }
+
+      g_free (h_alpha);
+      g_free (h_sum);
+    }
+  else
+    {
+      for (y = band->y1; y < band->y2; y++)
+        {
+          guchar *dest = context->dest + y * width * bpp;
+
+          for (x = 0; x < width; x++)
+            {
+              const guchar *window = context->src + y * stride + x * bpp;
+
+              for (channel = 0; channel < bpp; channel++)
+                {
+                  const gint offset = x * bpp + channel;
+
+                  if (context->chanmask[channel])
+                    {
+                      gboolean weighted = weighing && channel != alpha;
+                      gfloat   sum      = 0.0;
+                      gfloat   alphasum = 0.0;
+                      gint     i;
+
+                      for (i = 0; i < context->n_taps; i++)
+                        {
+                          const ConvolveTap *tap = &context->taps[i];
+                          const guchar      *s   = (window +
+                                                    tap->y * stride +
+                                                    tap->x * bpp);
+                          gfloat             temp = tap->weight;
+
+                          if (weighted)
+                            {
+                              temp *= s[alpha];
+                              alphasum += ABS (temp);
+                            }
+
+                          sum += temp * s[channel];
+                        }
+
+                      dest[offset] = convolve_finish (context,
+                                                      sum, alphasum, weighted);
+                    }
+                  else
+                    {
+                      /* copy unmodified pixel */
+                      dest[offset] = window[HALF_WINDOW * stride +
+                                            HALF_WINDOW * bpp + channel];
+                    }
+                }
+            }
+        }
+    }
 
-  for (i = 0; i < DEST_ROWS; i++)
-    g_free (dest_row[i]);
+  g_mutex_lock (&band_mutex);
+  band->done = TRUE;
+  g_cond_broadcast (&band_cond);
+  g_mutex_unlock (&band_mutex);
 }
 
 /***************************************************
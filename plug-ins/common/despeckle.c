@@ -23,6 +23,7 @@
 #include "config.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #include <libgimp/gimp.h>
 #include <libgimp/gimpui.h>
@@ -77,6 +78,24 @@ static gint                histrest; /* From min to max        */
 
 static DespeckleHistogram  histogram;
 
+/* A band of rows filtered by one thread of the plain median filter */
+typedef struct
+{
+  const guchar *src;
+  guchar       *dst;
+  const guchar *lum;    /* Luminance of the source pixels */
+  gint          width;
+  gint          height;
+  gint          bpp;
+  gint          radius;
+  gint          y1;
+  gint          y2;     /* Rows y1 to y2 - 1 */
+  gboolean      done;
+} DespeckleBand;
+
+static GMutex              band_mutex;
+static GCond               band_cond;
+
 
 /*
  * Local functions...
@@ -97,6 +116,15 @@ static void      despeckle_median          (guchar        *src,
                                             gint           bpp,
                                             gint           radius,
                                             gboolean       preview);
+static void      despeckle_median_bands    (guchar        *src,
+                                            guchar        *dst,
+                                            gint           width,
+                                            gint           height,
+                                            gint           bpp,
+                                            gint           radius,
+                                            gboolean       preview);
+static void      despeckle_band            (DespeckleBand *band,
+                                            gpointer       data);
 
 static gboolean  despeckle_dialog          (void);
 
@@ -864,13 +892,22 @@ despeckle_median (guchar   *src,
   gint   xmin;
   gint   xmax;
 
+  if (! preview)
+    gimp_progress_init(_("Despeckle"));
+
+  /* Without the adaptive and recursive filters, which carry state from
+   * pixel to pixel, every pixel only depends on the source image.
+   */
+  if (! (filter_type & (FILTER_ADAPTIVE | FILTER_RECURSIVE)))
+    {
+      despeckle_median_bands (src, dst, width, height, bpp, radius, preview);
+      return;
+    }
+
   memset (&histogram, 0, sizeof(histogram));
   progress     = 0;
   max_progress = width * height;
 
-  if (! preview)
-    gimp_progress_init(_("Despeckle"));
-
   adapt_radius = radius;
   for (y = 0; y < height; y++)
     {
@@ -941,3 +978,267 @@ despeckle_median (guchar   *src,
   if (! preview)
     gimp_progress_update (1.0);
 }
+
+/*
+ * 'despeckle_median_bands()' - Plain median filter, in bands of rows
+ * that are filtered in parallel.
+ *
+ * This follows Perreault and Hebert, "Median Filtering in Constant
+ * Time": each column keeps a histogram of the luminance of its pixels
+ * in the filter window, and moving the window one pixel adds and
+ * removes one whole column histogram.  The cost per pixel does not
+ * depend on the radius.
+ */
+
+static void
+despeckle_median_bands (guchar   *src,
+                        guchar   *dst,
+                        gint      width,
+                        gint      height,
+                        gint      bpp,
+                        gint      radius,
+                        gboolean  preview)
+{
+  GThreadPool   *pool;
+  DespeckleBand *bands;
+  guchar        *lum;
+  gint           n_threads;
+  gint           n_bands;
+  gint           band_height;
+  gint           i;
+
+  lum = g_new (guchar, width * height);
+
+  for (i = 0; i < width * height; i++)
+    lum[i] = pixel_luminance (src + i * bpp, bpp);
+
+  /* Each band starts with filling the column histograms, so make the
+   * bands a lot higher than the filter window.
+   */
+  n_threads   = g_get_num_processors ();
+  band_height = MAX (64, 8 * radius);
+  band_height = MIN (band_height, (height + n_threads - 1) / n_threads);
+  band_height = MAX (band_height, 1);
+  n_bands     = (height + band_height - 1) / band_height;
+
+  bands = g_new0 (DespeckleBand, n_bands);
+  pool  = g_thread_pool_new ((GFunc) despeckle_band, NULL,
+                             n_threads, FALSE, NULL);
+
+  for (i = 0; i < n_bands; i++)
+    {
+      bands[i].src    = src;
+      bands[i].dst    = dst;
+      bands[i].lum    = lum;
+      bands[i].width  = width;
+      bands[i].height = height;
+      bands[i].bpp    = bpp;
+      bands[i].radius = radius;
+      bands[i].y1     = i * band_height;
+      bands[i].y2     = MIN ((i + 1) * band_height, height);
+
+      g_thread_pool_push (pool, &bands[i], NULL);
+    }
+
+  for (i = 0; i < n_bands; i++)
+    {
+      g_mutex_lock (&band_mutex);
+      while (! bands[i].done)
+        g_cond_wait (&band_cond, &band_mutex);
+      g_mutex_unlock (&band_mutex);
+
+      if (! preview)
+        gimp_progress_update ((gdouble) bands[i].y2 / (gdouble) height);
+    }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  g_free (bands);
+  g_free (lum);
+
+  if (! preview)
+    gimp_progress_update (1.0);
+}
+
+static inline gboolean
+lum_in_range (guchar value)
+{
+  return value > black_level && value < white_level;
+}
+
+static inline void
+column_add (guint16       *hist,
+            guint16       *coarse,
+            const guint16 *col_hist,
+            const guint16 *col_coarse)
+{
+  gint i;
+
+  /* plain loops, so that the compiler can vectorize them */
+  for (i = 0; i < 256; i++)
+    hist[i] += col_hist[i];
+
+  for (i = 0; i < 16; i++)
+    coarse[i] += col_coarse[i];
+}
+
+static inline void
+column_sub (guint16       *hist,
+            guint16       *coarse,
+            const guint16 *col_hist,
+            const guint16 *col_coarse)
+{
+  gint i;
+
+  for (i = 0; i < 256; i++)
+    hist[i] -= col_hist[i];
+
+  for (i = 0; i < 16; i++)
+    coarse[i] -= col_coarse[i];
+}
+
+static void
+despeckle_band (DespeckleBand *band,
+                gpointer       data)
+{
+  const guchar *src    = band->src;
+  const guchar *lum    = band->lum;
+  const gint    width  = band->width;
+  const gint    height = band->height;
+  const gint    bpp    = band->bpp;
+  const gint    radius = band->radius;
+  guint16      *col_hist;
+  guint16      *col_coarse;
+  guint16       hist[256];
+  guint16       coarse[16];
+  gint          x, y;
+
+  col_hist   = g_new0 (guint16, width * 256);
+  col_coarse = g_new0 (guint16, width * 16);
+
+  /* the column histograms of the band's first row */
+  for (y = MAX (0, band->y1 - radius);
+       y <= MIN (height - 1, band->y1 + radius);
+       y++)
+    {
+      for (x = 0; x < width; x++)
+        {
+          const guchar value = lum[x + y * width];
+
+          if (lum_in_range (value))
+            {
+              col_hist[x * 256 + value]++;
+              col_coarse[x * 16 + (value >> 4)]++;
+            }
+        }
+    }
+
+  for (y = band->y1; y < band->y2; y++)
+    {
+      const gint ymin = MAX (0, y - radius);
+      const gint ymax = MIN (height - 1, y + radius);
+
+      /* move the column histograms down by one row */
+      if (y > band->y1)
+        {
+          for (x = 0; x < width; x++)
+            {
+              guchar value;
+
+              if (y - radius - 1 >= 0)
+                {
+                  value = lum[x + (y - radius - 1) * width];
+
+                  if (lum_in_range (value))
+                    {
+                      col_hist[x * 256 + value]--;
+                      col_coarse[x * 16 + (value >> 4)]--;
+                    }
+                }
+
+              if (y + radius < height)
+                {
+                  value = lum[x + (y + radius) * width];
+
+                  if (lum_in_range (value))
+                    {
+                      col_hist[x * 256 + value]++;
+                      col_coarse[x * 16 + (value >> 4)]++;
+                    }
+                }
+            }
+        }
+
+      memset (hist,   0, sizeof (hist));
+      memset (coarse, 0, sizeof (coarse));
+
+      for (x = 0; x <= MIN (radius - 1, width - 1); x++)
+        column_add (hist, coarse, col_hist + x * 256, col_coarse + x * 16);
+
+      for (x = 0; x < width; x++)
+        {
+          const gint    pos  = (x + y * width) * bpp;
+          const gint    xmin = MAX (0, x - radius);
+          const gint    xmax = MIN (width - 1, x + radius);
+          const guchar *pixel = src + pos;
+          gint          count = 0;
+          gint          i;
+
+          if (x + radius < width)
+            column_add (hist, coarse,
+                        col_hist + (x + radius) * 256,
+                        col_coarse + (x + radius) * 16);
+
+          if (x - radius - 1 >= 0)
+            column_sub (hist, coarse,
+                        col_hist + (x - radius - 1) * 256,
+                        col_coarse + (x - radius - 1) * 16);
+
+          for (i = 0; i < 16; i++)
+            count += coarse[i];
+
+          if (count)
+            {
+              gint sum = 0;
+              gint c   = 0;
+              gint m;
+              gint xi, yi;
+
+              count = (count + 1) / 2;
+
+              while (sum + coarse[c] < count)
+                sum += coarse[c++];
+
+              m = c * 16;
+              while ((sum += hist[m]) < count)
+                m++;
+
+              /* use a pixel of the window that has the median
+               * luminance, found through the column histograms
+               */
+              for (xi = xmin; xi <= xmax; xi++)
+                {
+                  if (col_hist[xi * 256 + m])
+                    {
+                      for (yi = ymin; yi <= ymax; yi++)
+                        if (lum[xi + yi * width] == m)
+                          break;
+
+                      pixel = src + (xi + yi * width) * bpp;
+                      break;
+                    }
+                }
+            }
+
+          pixel_copy (band->dst + pos, pixel, bpp);
+        }
+    }
+
+  g_free (col_coarse);
+  g_free (col_hist);
+
+  g_mutex_lock (&band_mutex);
+  band->done = TRUE;
+  g_cond_broadcast (&band_cond);
+  g_mutex_unlock (&band_mutex);
+}
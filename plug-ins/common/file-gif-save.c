@@ -102,7 +102,6 @@ static GimpRunMode   run_mode;
 static GimpParasite *comment_parasite   = NULL;
 static gboolean      comment_was_edited = FALSE;
 static gchar        *globalcomment      = NULL;
-static gint          Interlace; /* For compression code */
 
 
 const GimpPlugInInfo PLUG_IN_INFO =
@@ -338,9 +337,28 @@ run (const gchar      *name,
 #define MAXCOLORS 256
 
 /*
- * Pointer to function returning an int
+ * The number of frames that are read ahead of the one written, per
+ * encoding thread
  */
-typedef int (*ifunptr) (int, int);
+#define FRAMES_PER_THREAD 2
+
+
+typedef struct
+{
+  guchar     *pixels;
+  gint        cols;
+  gint        rows;
+  gint        offset_x;
+  gint        offset_y;
+  gint        interlace;
+  gint        bpp;
+  gint        transparent;
+  gint        disposal;
+  gint        delay;
+
+  GByteArray *data;       /* the compressed image data, set when done */
+  gboolean    done;
+} GifFrame;
 
 
 static gint find_unused_ia_color   (const guchar *pixels,
@@ -353,45 +371,34 @@ static void special_flatten_indexed_alpha (guchar *pixels,
                                            gint    numpixels);
 static gint colors_to_bpp  (int);
 static gint bpp_to_colors  (int);
-static gint get_pixel      (int, int);
-static gint gif_next_pixel (ifunptr);
-static void bump_pixel     (void);
 
 static void gif_encode_header              (FILE *, gboolean, int, int, int, int,
-                                            int *, int *, int *, ifunptr);
+                                            int *, int *, int *);
 static void gif_encode_graphic_control_ext (FILE *, int, int, int, int,
-                                            int, int, int, ifunptr);
-static void gif_encode_image_data          (FILE *, int, int, int, int,
-                                            ifunptr, gint, gint);
+                                            int, int, int);
+static void gif_encode_image_data          (FILE *, const GifFrame *);
 static void gif_encode_close               (FILE *);
 static void gif_encode_loop_ext            (FILE *, guint);
 static void gif_encode_comment_ext         (FILE *, const gchar *comment);
 
-static gint     rowstride;
-static guchar  *pixels;
-static gint     cur_progress;
-static gint     max_progress;
-
-static void compress        (int      init_bits,
-                             FILE    *outfile,
-                             ifunptr  ReadValue);
-static void no_compress     (int      init_bits,
-                             FILE    *outfile,
-                             ifunptr  ReadValue);
-static void rle_compress    (int      init_bits,
-                             FILE    *outfile,
-                             ifunptr  ReadValue);
-static void normal_compress (int      init_bits,
-                             FILE    *outfile,
-                             ifunptr  ReadValue);
+static void       gif_encode_frame  (GifFrame     *frame,
+                                     gpointer      data);
+static void       gif_write_frame   (FILE         *outfile,
+                                     GQueue       *frames,
+                                     gboolean      is_gif89,
+                                     gint          nlayers,
+                                     gint         *n_written);
+static GByteArray * gif_compress    (const guchar *pixels,
+                                     gint          width,
+                                     gint          height,
+                                     gint          interlace,
+                                     gint          init_bits);
 
 static void put_word        (int, FILE *);
-static void output          (gint);
-static void cl_block        (void);
-static void cl_hash         (glong);
-static void char_init       (void);
-static void char_out        (int);
-static void flush_char      (void);
+
+
+static GMutex frame_mutex;
+static GCond  frame_cond;
 
 
 static gint
@@ -629,6 +636,10 @@ save_image (const gchar *filename,
   gint           i;
   gint           transparent;
   gint           offset_x, offset_y;
+  GThreadPool   *pool;
+  GQueue        *frames;
+  gint           max_frames;
+  gint           n_written = 0;
 
   gint32        *layers;
   gint           nlayers;
@@ -793,9 +804,8 @@ save_image (const gchar *filename,
 
   cols = gimp_image_width (image_ID);
   rows = gimp_image_height (image_ID);
-  Interlace = gsvals.interlace;
   gif_encode_header (outfile, is_gif89, cols, rows, bgindex,
-                     BitsPerPixel, Red, Green, Blue, get_pixel);
+                     BitsPerPixel, Red, Green, Blue);
 
 
   /* If the image has multiple layers it'll be made into an
@@ -813,17 +823,26 @@ save_image (const gchar *filename,
   /*** Now for each layer in the image, save an image in a compound GIF ***/
   /************************************************************************/
 
-  cur_progress = 0;
-  max_progress = nlayers * rows;
+  /*  The layers are read here, but compressed by a pool of threads.
+   *  The frames are written in order as soon as they are done, and
+   *  only a few frames per thread are read ahead.
+   */
+  pool = g_thread_pool_new ((GFunc) gif_encode_frame, NULL,
+                            g_get_num_processors (), FALSE, NULL);
+
+  frames     = g_queue_new ();
+  max_frames = FRAMES_PER_THREAD * g_get_num_processors ();
 
-  for (i = nlayers - 1; i >= 0; i--, cur_progress = (nlayers - i) * rows)
+  for (i = nlayers - 1; i >= 0; i--)
     {
+      GifFrame *frame;
+      guchar   *pixels;
+
       drawable_type = gimp_drawable_type (layers[i]);
       buffer = gimp_drawable_get_buffer (layers[i]);
       gimp_drawable_offsets (layers[i], &offset_x, &offset_y);
       cols = gimp_drawable_width (layers[i]);
       rows = gimp_drawable_height (layers[i]);
-      rowstride = cols;
 
       pixels = g_new (guchar, (cols * rows *
                                (((drawable_type == GIMP_INDEXEDA_IMAGE) ||
@@ -876,6 +895,9 @@ save_image (const gchar *filename,
 
       useBPP = (BitsPerPixel > liberalBPP) ? BitsPerPixel : liberalBPP;
 
+      Disposal = 0;
+      Delay89  = 0;
+
       if (is_gif89)
         {
           if (i > 0 && ! gsvals.always_use_default_dispose)
@@ -911,26 +933,36 @@ save_image (const gchar *filename,
                 }
               Delay89 = 1;
             }
-
-          gif_encode_graphic_control_ext (outfile, Disposal, Delay89, nlayers,
-                                          cols, rows,
-                                          transparent,
-                                          useBPP,
-                                          get_pixel);
         }
 
-      gif_encode_image_data (outfile, cols, rows,
-                             (rows > 4) ? gsvals.interlace : 0,
-                             useBPP,
-                             get_pixel,
-                             offset_x, offset_y);
-      gimp_progress_update (1.0);
-
       g_object_unref (buffer);
 
-      g_free (pixels);
+      frame = g_slice_new0 (GifFrame);
+
+      frame->pixels      = pixels;
+      frame->cols        = cols;
+      frame->rows        = rows;
+      frame->offset_x    = offset_x;
+      frame->offset_y    = offset_y;
+      frame->interlace   = (rows > 4) ? gsvals.interlace : 0;
+      frame->bpp         = useBPP;
+      frame->transparent = transparent;
+      frame->disposal    = Disposal;
+      frame->delay       = Delay89;
+
+      g_queue_push_tail (frames, frame);
+      g_thread_pool_push (pool, frame, NULL);
+
+      while (g_queue_get_length (frames) >= max_frames)
+        gif_write_frame (outfile, frames, is_gif89, nlayers, &n_written);
     }
 
+  while (! g_queue_is_empty (frames))
+    gif_write_frame (outfile, frames, is_gif89, nlayers, &n_written);
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+  g_queue_free (frames);
+
   g_free(layers);
 
   gif_encode_close (outfile);
@@ -1246,115 +1278,12 @@ bpp_to_colors (int bpp)
 
 
 
-static int
-get_pixel (int x,
-           int y)
-{
-  return *(pixels + (rowstride * (long) y) + (long) x);
-}
-
-
 /*****************************************************************************
  *
  * GIFENCODE.C    - GIF Image compression interface
  *
- * GIFEncode( FName, GHeight, GWidth, GInterlace, Background, Transparent,
- *            BitsPerPixel, Red, Green, Blue, get_pixel )
- *
  *****************************************************************************/
 
-static gint  Width, Height;
-static gint  curx, cury;
-static glong CountDown;
-static gint  Pass = 0;
-
-/*
- * Bump the 'curx' and 'cury' to point to the next pixel
- */
-static void
-bump_pixel (void)
-{
-  /*
-   * Bump the current X position
-   */
-  curx++;
-
-  /*
-   * If we are at the end of a scan line, set curx back to the beginning
-   * If we are interlaced, bump the cury to the appropriate spot,
-   * otherwise, just increment it.
-   */
-  if (curx == Width)
-    {
-      cur_progress++;
-
-      if ((cur_progress % 20) == 0)
-        gimp_progress_update ((gdouble) cur_progress / (gdouble) max_progress);
-
-      curx = 0;
-
-      if (! Interlace)
-        ++cury;
-      else
-        {
-          switch (Pass)
-            {
-
-            case 0:
-              cury += 8;
-              if (cury >= Height)
-                {
-                  Pass++;
-                  cury = 4;
-                }
-              break;
-
-            case 1:
-              cury += 8;
-              if (cury >= Height)
-                {
-                  Pass++;
-                  cury = 2;
-                }
-              break;
-
-            case 2:
-              cury += 4;
-              if (cury >= Height)
-                {
-                  Pass++;
-                  cury = 1;
-                }
-              break;
-
-            case 3:
-              cury += 2;
-              break;
-            }
-        }
-    }
-}
-
-/*
- * Return the next pixel from the image
- */
-static int
-gif_next_pixel (ifunptr getpixel)
-{
-  int r;
-
-  if (CountDown == 0)
-    return EOF;
-
-  --CountDown;
-
-  r = (*getpixel) (curx, cury);
-
-  bump_pixel ();
-
-  return r;
-}
-
 /* public */
 
 static void
@@ -1366,8 +1295,7 @@ gif_encode_header (FILE     *fp,
                    int       BitsPerPixel,
                    int       Red[],
                    int       Green[],
-                   int       Blue[],
-                   ifunptr   get_pixel)
+                   int       Blue[])
 {
   int B;
   int RWidth, RHeight;
@@ -1377,26 +1305,11 @@ gif_encode_header (FILE     *fp,
 
   ColorMapSize = 1 << BitsPerPixel;
 
-  RWidth = Width = GWidth;
-  RHeight = Height = GHeight;
+  RWidth = GWidth;
+  RHeight = GHeight;
 
   Resolution = BitsPerPixel;
 
-  /*
-   * Calculate number of bits we are expecting
-   */
-  CountDown = (long) Width *(long) Height;
-
-  /*
-   * Indicate which pass we are on (if interlace)
-   */
-  Pass = 0;
-
-  /*
-   * Set up the current x and y position
-   */
-  curx = cury = 0;
-
   /*
    * Write the Magic header
    */
@@ -1458,27 +1371,8 @@ gif_encode_graphic_control_ext (FILE    *fp,
                                 int      GWidth,
                                 int      GHeight,
                                 int      Transparent,
-                                int      BitsPerPixel,
-                                ifunptr  get_pixel)
+                                int      BitsPerPixel)
 {
-  Width = GWidth;
-  Height = GHeight;
-
-  /*
-   * Calculate number of bits we are expecting
-   */
-  CountDown = (long) Width *(long) Height;
-
-  /*
-   * Indicate which pass we are on (if interlace)
-   */
-  Pass = 0;
-
-  /*
-   * Set up the current x and y position
-   */
-  curx = cury = 0;
-
   /*
    * Write out extension for transparent color index, if necessary.
    */
@@ -1513,47 +1407,18 @@ gif_encode_graphic_control_ext (FILE    *fp,
 
 
 static void
-gif_encode_image_data (FILE    *fp,
-                       int      GWidth,
-                       int      GHeight,
-                       int      GInterlace,
-                       int      BitsPerPixel,
-                       ifunptr  get_pixel,
-                       gint     offset_x,
-                       gint     offset_y)
+gif_encode_image_data (FILE           *fp,
+                       const GifFrame *frame)
 {
-  int LeftOfs, TopOfs;
   int InitCodeSize;
 
-  Interlace = GInterlace;
-
-  Width = GWidth;
-  Height = GHeight;
-  LeftOfs = (int) offset_x;
-  TopOfs = (int) offset_y;
-
-  /*
-   * Calculate number of bits we are expecting
-   */
-  CountDown = (long) Width * (long) Height;
-
-  /*
-   * Indicate which pass we are on (if interlace)
-   */
-  Pass = 0;
-
   /*
    * The initial code size
    */
-  if (BitsPerPixel <= 1)
+  if (frame->bpp <= 1)
     InitCodeSize = 2;
   else
-    InitCodeSize = BitsPerPixel;
-
-  /*
-   * Set up the current x and y position
-   */
-  curx = cury = 0;
+    InitCodeSize = frame->bpp;
 
   /*
    * Write an Image separator
@@ -1564,15 +1429,15 @@ gif_encode_image_data (FILE    *fp,
    * Write the Image header
    */
 
-  put_word (LeftOfs, fp);
-  put_word (TopOfs, fp);
-  put_word (Width, fp);
-  put_word (Height, fp);
+  put_word (frame->offset_x, fp);
+  put_word (frame->offset_y, fp);
+  put_word (frame->cols, fp);
+  put_word (frame->rows, fp);
 
   /*
    * Write out whether or not the image is interlaced
    */
-  if (Interlace)
+  if (frame->interlace)
     fputc (0x40, fp);
   else
     fputc (0x00, fp);
@@ -1583,36 +1448,17 @@ gif_encode_image_data (FILE    *fp,
   fputc (InitCodeSize, fp);
 
   /*
-   * Go and actually compress the data
+   * Write the compressed data, it is already split into packets
    */
-  compress (InitCodeSize + 1, fp, get_pixel);
+  fwrite (frame->data->data, 1, frame->data->len, fp);
 
   /*
    * Write out a Zero-length packet (to end the series)
    */
   fputc (0, fp);
 
-#if 0
-  /***************************/
-  Interlace = GInterlace;
-  Width = GWidth;
-  Height = GHeight;
-  LeftOfs = TopOfs = 0;
-
-  CountDown = (long) Width *(long) Height;
-  Pass = 0;
-  /*
-   * The initial code size
-   */
-  if (BitsPerPixel <= 1)
-    InitCodeSize = 2;
-  else
-    InitCodeSize = BitsPerPixel;
-  /*
-   * Set up the current x and y position
-   */
-  curx = cury = 0;
-#endif
+  if (ferror (fp))
+    g_message (_("Error writing output file."));
 }
 
 
@@ -1685,597 +1531,298 @@ put_word (int   w,
 
 /***************************************************************************
  *
- *  GIFCOMPR.C       - GIF Image compression routines
- *
- *  Lempel-Ziv compression based on 'compress'.  GIF modifications by
- *  David Rowley (mgardi@watdcsu.waterloo.edu)
+ *  Frame encoding
  *
  ***************************************************************************/
 
 /*
- * General DEFINEs
- */
-
-#define GIF_BITS    12
-
-#define HSIZE  5003                /* 80% occupancy */
-
-/*
- * GIF Image compression - modified 'compress'
- *
- * Based on: compress.c - File compression ala IEEE Computer, June 1984.
- *
- * By Authors:  Spencer W. Thomas       (decvax!harpo!utah-cs!utah-gr!thomas)
- *              Jim McKie               (decvax!mcvax!jim)
- *              Steve Davies            (decvax!vax135!petsd!peora!srd)
- *              Ken Turkowski           (decvax!decwrl!turtlevax!ken)
- *              James A. Woods          (decvax!ihnp4!ames!jaw)
- *              Joe Orost               (decvax!vax135!petsd!joe)
- *
- */
-
-static int n_bits;                /* number of bits/code */
-static int maxbits = GIF_BITS;        /* user settable max # bits/code */
-static gint maxcode;        /* maximum code, given n_bits */
-static gint maxmaxcode = (gint) 1 << GIF_BITS;        /* should NEVER generate this code */
-#ifdef COMPATIBLE                /* But wrong! */
-#define MAXCODE(Mn_bits)        ((gint) 1 << (Mn_bits) - 1)
-#else /*COMPATIBLE */
-#define MAXCODE(Mn_bits)        (((gint) 1 << (Mn_bits)) - 1)
-#endif /*COMPATIBLE */
-
-static glong htab[HSIZE];
-static unsigned short codetab[HSIZE];
-#define HashTabOf(i)       htab[i]
-#define CodeTabOf(i)    codetab[i]
-
-static const gint hsize = HSIZE; /* the original reason for this being
-                                    variable was "for dynamic table sizing",
-                                    but since it was never actually changed
-                                    I made it const   --Adam. */
-
-static gint free_ent = 0;        /* first unused entry */
-
-/*
- * block compression parameters -- after all codes are used up,
- * and compression rate changes, start over.
+ * Compress a frame, called from the thread pool
  */
-static int clear_flg = 0;
-
-static int offset;
-static long int in_count = 1;        /* length of input */
-static long int out_count = 0;        /* # of codes output (for debugging) */
-
-/*
- * compress stdin to stdout
- *
- * Algorithm:  use open addressing double hashing (no chaining) on the
- * prefix code / next character combination.  We do a variant of Knuth's
- * algorithm D (vol. 3, sec. 6.4) along with G. Knott's relatively-prime
- * secondary probe.  Here, the modular division first probe is gives way
- * to a faster exclusive-or manipulation.  Also do block compression with
- * an adaptive reset, whereby the code table is cleared when the compression
- * ratio decreases, but after the table fills.  The variable-length output
- * codes are re-sized at this point, and a special CLEAR code is generated
- * for the decompressor.  Late addition:  construct the table according to
- * file size for noticeable speed improvement on small files.  Please direct
- * questions about this implementation to ames!jaw.
- */
-
-static gint  g_init_bits;
-static FILE *g_outfile;
-
-static int ClearCode;
-static int EOFCode;
-
-
-static gulong cur_accum;
-static gint   cur_bits;
-
-static gulong masks[] =
-{
-  0x0000, 0x0001, 0x0003, 0x0007,
-  0x000F, 0x001F, 0x003F, 0x007F,
-  0x00FF, 0x01FF, 0x03FF, 0x07FF,
-  0x0FFF, 0x1FFF, 0x3FFF, 0x7FFF,
-  0xFFFF
-};
-
-
-static void
-compress (int      init_bits,
-          FILE    *outfile,
-          ifunptr  ReadValue)
-{
-  if (FALSE)
-    no_compress (init_bits, outfile, ReadValue);
-  else if (FALSE)
-    rle_compress (init_bits, outfile, ReadValue);
-  else
-    normal_compress (init_bits, outfile, ReadValue);
-}
-
 static void
-no_compress (int      init_bits,
-             FILE    *outfile,
-             ifunptr  ReadValue)
+gif_encode_frame (GifFrame *frame,
+                  gpointer  data)
 {
-  long fcode;
-  gint i /* = 0 */ ;
-  int c;
-  gint ent;
-  gint hsize_reg;
-  int hshift;
-
-
-  /*
-   * Set up the globals:  g_init_bits - initial number of bits
-   *                      g_outfile   - pointer to output file
-   */
-  g_init_bits = init_bits;
-  g_outfile = outfile;
-
-  cur_bits = 0;
-  cur_accum = 0;
-
-  /*
-   * Set up the necessary values
-   */
-  offset = 0;
-  out_count = 0;
-  clear_flg = 0;
-  in_count = 1;
-
-  ClearCode = (1 << (init_bits - 1));
-  EOFCode = ClearCode + 1;
-  free_ent = ClearCode + 2;
-
+  GByteArray *compressed;
 
-  /* Had some problems here... should be okay now.  --Adam */
-  n_bits = g_init_bits;
-  maxcode = MAXCODE (n_bits);
+  compressed = gif_compress (frame->pixels, frame->cols, frame->rows,
+                             frame->interlace,
+                             MAX (frame->bpp, 2) + 1);
 
+  g_free (frame->pixels);
+  frame->pixels = NULL;
 
-  char_init ();
-
-  ent = gif_next_pixel (ReadValue);
-
-  hshift = 0;
-  for (fcode = (long) hsize; fcode < 65536L; fcode *= 2L)
-    ++hshift;
-  hshift = 8 - hshift;                /* set hash code range bound */
-
-  hsize_reg = hsize;
-  cl_hash ((glong) hsize_reg);        /* clear hash table */
-
-  output ((gint) ClearCode);
-
-
-  while ((c = gif_next_pixel (ReadValue)) != EOF)
-    {
-      ++in_count;
-
-      fcode = (long) (((long) c << maxbits) + ent);
-      i = (((gint) c << hshift) ^ ent);        /* xor hashing */
-
-      output ((gint) ent);
-      ++out_count;
-      ent = c;
-
-      if (free_ent < maxmaxcode)
-        {
-          CodeTabOf (i) = free_ent++;        /* code -> hashtable */
-          HashTabOf (i) = fcode;
-        }
-      else
-        cl_block ();
-    }
-
-  /*
-   * Put out the final code.
-   */
-  output ((gint) ent);
-  ++out_count;
-  output ((gint) EOFCode);
+  g_mutex_lock (&frame_mutex);
+  frame->data = compressed;
+  frame->done = TRUE;
+  g_cond_broadcast (&frame_cond);
+  g_mutex_unlock (&frame_mutex);
 }
 
+/*
+ * Wait for the oldest frame to be compressed, and write it
+ */
 static void
-rle_compress (int      init_bits,
-              FILE    *outfile,
-              ifunptr  ReadValue)
+gif_write_frame (FILE     *outfile,
+                 GQueue   *frames,
+                 gboolean  is_gif89,
+                 gint      nlayers,
+                 gint     *n_written)
 {
-  long fcode;
-  gint i /* = 0 */ ;
-  int c, last;
-  gint ent;
-  gint disp;
-  gint hsize_reg;
-  int hshift;
+  GifFrame *frame = g_queue_pop_head (frames);
 
+  g_mutex_lock (&frame_mutex);
 
-  /*
-   * Set up the globals:  g_init_bits - initial number of bits
-   *                      g_outfile   - pointer to output file
-   */
-  g_init_bits = init_bits;
-  g_outfile = outfile;
-
-  cur_bits = 0;
-  cur_accum = 0;
-
-  /*
-   * Set up the necessary values
-   */
-  offset = 0;
-  out_count = 0;
-  clear_flg = 0;
-  in_count = 1;
-
-  ClearCode = (1 << (init_bits - 1));
-  EOFCode = ClearCode + 1;
-  free_ent = ClearCode + 2;
-
-
-  /* Had some problems here... should be okay now.  --Adam */
-  n_bits = g_init_bits;
-  maxcode = MAXCODE (n_bits);
-
+  while (! frame->done)
+    g_cond_wait (&frame_cond, &frame_mutex);
 
-  char_init ();
+  g_mutex_unlock (&frame_mutex);
 
-  last = ent = gif_next_pixel (ReadValue);
+  if (is_gif89)
+    gif_encode_graphic_control_ext (outfile, frame->disposal, frame->delay,
+                                    nlayers,
+                                    frame->cols, frame->rows,
+                                    frame->transparent,
+                                    frame->bpp);
 
-  hshift = 0;
-  for (fcode = (long) hsize; fcode < 65536L; fcode *= 2L)
-    ++hshift;
-  hshift = 8 - hshift;                /* set hash code range bound */
+  gif_encode_image_data (outfile, frame);
 
-  hsize_reg = hsize;
-  cl_hash ((glong) hsize_reg);        /* clear hash table */
+  g_byte_array_free (frame->data, TRUE);
+  g_slice_free (GifFrame, frame);
 
-  output ((gint) ClearCode);
-
-
-
-  while ((c = gif_next_pixel (ReadValue)) != EOF)
-    {
-      ++in_count;
-
-      fcode = (long) (((long) c << maxbits) + ent);
-      i = (((gint) c << hshift) ^ ent);        /* xor hashing */
-
-
-      if (last == c) {
-        if (HashTabOf (i) == fcode)
-          {
-            ent = CodeTabOf (i);
-            continue;
-          }
-        else if ((long) HashTabOf (i) < 0)        /* empty slot */
-          goto nomatch;
-        disp = hsize_reg - i;        /* secondary hash (after G. Knott) */
-        if (i == 0)
-          disp = 1;
-      probe:
-        if ((i -= disp) < 0)
-          i += hsize_reg;
-
-        if (HashTabOf (i) == fcode)
-          {
-            ent = CodeTabOf (i);
-            continue;
-          }
-        if ((long) HashTabOf (i) > 0)
-          goto probe;
-        }
-    nomatch:
-      output ((gint) ent);
-      ++out_count;
-      last = ent = c;
-      if (free_ent < maxmaxcode)
-        {
-          CodeTabOf (i) = free_ent++;        /* code -> hashtable */
-          HashTabOf (i) = fcode;
-        }
-      else
-        cl_block ();
-    }
+  (*n_written)++;
 
-  /*
-   * Put out the final code.
-   */
-  output ((gint) ent);
-  ++out_count;
-  output ((gint) EOFCode);
+  gimp_progress_update ((gdouble) *n_written / (gdouble) nlayers);
 }
 
-static void
-normal_compress (int      init_bits,
-                 FILE    *outfile,
-                 ifunptr  ReadValue)
-{
-  long fcode;
-  gint i /* = 0 */ ;
-  int c;
-  gint ent;
-  gint disp;
-  gint hsize_reg;
-  int hshift;
-
-
-  /*
-   * Set up the globals:  g_init_bits - initial number of bits
-   *                      g_outfile   - pointer to output file
-   */
-  g_init_bits = init_bits;
-  g_outfile = outfile;
-
-  cur_bits = 0;
-  cur_accum = 0;
-
-  /*
-   * Set up the necessary values
-   */
-  offset = 0;
-  out_count = 0;
-  clear_flg = 0;
-  in_count = 1;
 
-  ClearCode = (1 << (init_bits - 1));
-  EOFCode = ClearCode + 1;
-  free_ent = ClearCode + 2;
+/***************************************************************************
+ *
+ *  GIFCOMPR.C       - GIF Image compression routines
+ *
+ *  Lempel-Ziv compression based on 'compress'.  GIF modifications by
+ *  David Rowley (mgardi@watdcsu.waterloo.edu)
+ *
+ *  The string table is a flat array with one entry per prefix code
+ *  and pixel value, so extending the current string by a pixel is a
+ *  single lookup instead of a probe into a hash table. All state is
+ *  kept in a GifCompress, so frames can be compressed in parallel.
+ *
+ ***************************************************************************/
 
+#define GIF_BITS      12
+#define GIF_MAX_CODES (1 << GIF_BITS)   /* should NEVER generate this code */
 
-  /* Had some problems here... should be okay now.  --Adam */
-  n_bits = g_init_bits;
-  maxcode = MAXCODE (n_bits);
+#define MAXCODE(n_bits) (((gint) 1 << (n_bits)) - 1)
 
+typedef struct
+{
+  GByteArray *out;
 
-  char_init ();
+  guchar      packet[256];
+  gint        packet_len;
 
-  ent = gif_next_pixel (ReadValue);
+  guint32     accum;
+  gint        accum_bits;
 
-  hshift = 0;
-  for (fcode = (long) hsize; fcode < 65536L; fcode *= 2L)
-    ++hshift;
-  hshift = 8 - hshift;                /* set hash code range bound */
+  gint        init_bits;
+  gint        n_bits;
+  gint        maxcode;
+  gint        clear_code;
+  gint        eof_code;
+  gint        free_ent;
+  gboolean    clear_flg;
 
-  hsize_reg = hsize;
-  cl_hash ((glong) hsize_reg);        /* clear hash table */
+  guint16    *table;    /* (prefix code << 8 | pixel) -> code, 0 is empty */
+  gint       *used;     /* the table entries that are set */
+  gint        n_used;
+} GifCompress;
 
-  output ((gint) ClearCode);
 
+/*
+ * Add a character to the end of the current packet, and if it is 254
+ * characters, flush the packet
+ */
+static inline void
+gif_compress_char_out (GifCompress *comp,
+                       guchar       c)
+{
+  comp->packet[comp->packet_len++] = c;
 
-  while ((c = gif_next_pixel (ReadValue)) != EOF)
+  if (comp->packet_len >= 254)
     {
-      ++in_count;
+      guchar len = comp->packet_len;
 
-      fcode = (long) (((long) c << maxbits) + ent);
-      i = (((gint) c << hshift) ^ ent);        /* xor hashing */
+      g_byte_array_append (comp->out, &len, 1);
+      g_byte_array_append (comp->out, comp->packet, comp->packet_len);
 
-      if (HashTabOf (i) == fcode)
-        {
-          ent = CodeTabOf (i);
-          continue;
-        }
-      else if ((long) HashTabOf (i) < 0)        /* empty slot */
-        goto nomatch;
-      disp = hsize_reg - i;        /* secondary hash (after G. Knott) */
-      if (i == 0)
-        disp = 1;
-    probe:
-      if ((i -= disp) < 0)
-        i += hsize_reg;
-
-      if (HashTabOf (i) == fcode)
-        {
-          ent = CodeTabOf (i);
-          continue;
-        }
-      if ((long) HashTabOf (i) > 0)
-        goto probe;
-    nomatch:
-      output ((gint) ent);
-      ++out_count;
-      ent = c;
-      if (free_ent < maxmaxcode)
-        {
-          CodeTabOf (i) = free_ent++;        /* code -> hashtable */
-          HashTabOf (i) = fcode;
-        }
-      else
-        cl_block ();
+      comp->packet_len = 0;
     }
-
-  /*
-   * Put out the final code.
-   */
-  output ((gint) ent);
-  ++out_count;
-  output ((gint) EOFCode);
 }
 
-
-/*****************************************************************
- * TAG( output )
- *
- * Output the given code.
- * Inputs:
- *      code:   A n_bits-bit integer.  If == -1, then EOF.  This assumes
- *              that n_bits =< (long)wordsize - 1.
- * Outputs:
- *      Outputs code to the file.
- * Assumptions:
- *      Chars are 8 bits long.
- * Algorithm:
- *      Maintain a GIF_BITS character long buffer (so that 8 codes will
- * fit in it exactly).  Use the VAX insv instruction to insert each
- * code in turn.  When the buffer fills up empty it and start over.
+/*
+ * Output the given code, using the current code size
  */
-
 static void
-output (gint code)
+gif_compress_output (GifCompress *comp,
+                     gint         code)
 {
-  cur_accum &= masks[cur_bits];
-
-  if (cur_bits > 0)
-    cur_accum |= ((long) code << cur_bits);
-  else
-    cur_accum = code;
+  comp->accum      |= (guint32) code << comp->accum_bits;
+  comp->accum_bits += comp->n_bits;
 
-  cur_bits += n_bits;
-
-  while (cur_bits >= 8)
+  while (comp->accum_bits >= 8)
     {
-      char_out ((unsigned int) (cur_accum & 0xff));
-      cur_accum >>= 8;
-      cur_bits -= 8;
+      gif_compress_char_out (comp, comp->accum & 0xff);
+
+      comp->accum      >>= 8;
+      comp->accum_bits  -= 8;
     }
 
   /*
    * If the next entry is going to be too big for the code size,
    * then increase it, if possible.
    */
-  if (free_ent > maxcode || clear_flg)
+  if (comp->free_ent > comp->maxcode || comp->clear_flg)
     {
-      if (clear_flg)
+      if (comp->clear_flg)
         {
-
-          maxcode = MAXCODE (n_bits = g_init_bits);
-          clear_flg = 0;
-
+          comp->n_bits    = comp->init_bits;
+          comp->maxcode   = MAXCODE (comp->n_bits);
+          comp->clear_flg = FALSE;
         }
       else
         {
+          comp->n_bits++;
 
-          ++n_bits;
-          if (n_bits == maxbits)
-            maxcode = maxmaxcode;
+          if (comp->n_bits == GIF_BITS)
+            comp->maxcode = GIF_MAX_CODES;
           else
-            maxcode = MAXCODE (n_bits);
+            comp->maxcode = MAXCODE (comp->n_bits);
         }
     }
-
-  if (code == EOFCode)
-    {
-      /*
-       * At EOF, write the rest of the buffer.
-       */
-      while (cur_bits > 0)
-        {
-          char_out ((unsigned int) (cur_accum & 0xff));
-          cur_accum >>= 8;
-          cur_bits -= 8;
-        }
-
-      flush_char ();
-
-      fflush (g_outfile);
-
-      if (ferror (g_outfile))
-        g_message (_("Error writing output file."));
-    }
 }
 
 /*
- * Clear out the hash table
+ * Clear out the string table
  */
 static void
-cl_block (void)                        /* table clear for block compress */
+gif_compress_clear (GifCompress *comp)
 {
-  cl_hash ((glong) hsize);
-  free_ent = ClearCode + 2;
-  clear_flg = 1;
+  gint i;
+
+  for (i = 0; i < comp->n_used; i++)
+    comp->table[comp->used[i]] = 0;
+
+  comp->n_used    = 0;
+  comp->free_ent  = comp->clear_code + 2;
+  comp->clear_flg = TRUE;
 
-  output ((gint) ClearCode);
+  gif_compress_output (comp, comp->clear_code);
 }
 
-static void
-cl_hash (glong hsize)        /* reset code table */
+/*
+ * Compress the pixels, in the order of the interlace passes if
+ * @interlace is set, into the packets of a GIF image data block
+ */
+static GByteArray *
+gif_compress (const guchar *pixels,
+              gint          width,
+              gint          height,
+              gint          interlace,
+              gint          init_bits)
 {
+  static const gint interlace_start[] = { 0, 4, 2, 1 };
+  static const gint interlace_step[]  = { 8, 8, 4, 2 };
+  static const gint progressive_start[] = { 0 };
+  static const gint progressive_step[]  = { 1 };
+
+  GifCompress  comp  = { 0, };
+  const gint  *start = interlace ? interlace_start : progressive_start;
+  const gint  *step  = interlace ? interlace_step  : progressive_step;
+  gint         n_passes = interlace ? 4 : 1;
+  gint         ent      = -1;
+  gint         pass;
+  gint         x, y;
+
+  comp.out        = g_byte_array_new ();
+  comp.init_bits  = init_bits;
+  comp.n_bits     = init_bits;
+  comp.maxcode    = MAXCODE (init_bits);
+  comp.clear_code = 1 << (init_bits - 1);
+  comp.eof_code   = comp.clear_code + 1;
+  comp.free_ent   = comp.clear_code + 2;
+  comp.table      = g_new0 (guint16, GIF_MAX_CODES << 8);
+  comp.used       = g_new (gint, GIF_MAX_CODES);
+
+  gif_compress_output (&comp, comp.clear_code);
+
+  for (pass = 0; pass < n_passes; pass++)
+    {
+      for (y = start[pass]; y < height; y += step[pass])
+        {
+          const guchar *row = pixels + (gsize) y * width;
 
-  glong *htab_p = htab + hsize;
+          for (x = 0; x < width; x++)
+            {
+              gint c = row[x];
+              gint i;
 
-  long i;
-  long m1 = -1;
+              if (ent < 0)
+                {
+                  ent = c;
+                  continue;
+                }
 
-  i = hsize - 16;
-  do
-    {                                /* might use Sys V memset(3) here */
-      *(htab_p - 16) = m1;
-      *(htab_p - 15) = m1;
-      *(htab_p - 14) = m1;
-      *(htab_p - 13) = m1;
-      *(htab_p - 12) = m1;
-      *(htab_p - 11) = m1;
-      *(htab_p - 10) = m1;
-      *(htab_p - 9) = m1;
-      *(htab_p - 8) = m1;
-      *(htab_p - 7) = m1;
-      *(htab_p - 6) = m1;
-      *(htab_p - 5) = m1;
-      *(htab_p - 4) = m1;
-      *(htab_p - 3) = m1;
-      *(htab_p - 2) = m1;
-      *(htab_p - 1) = m1;
-      htab_p -= 16;
-    }
-  while ((i -= 16) >= 0);
+              i = (ent << 8) | c;
 
-  for (i += 16; i > 0; --i)
-    *--htab_p = m1;
-}
+              if (comp.table[i])
+                {
+                  ent = comp.table[i];
+                  continue;
+                }
 
+              gif_compress_output (&comp, ent);
 
-/******************************************************************************
- *
- * GIF Specific routines
- *
- ******************************************************************************/
+              if (comp.free_ent < GIF_MAX_CODES)
+                {
+                  comp.table[i] = comp.free_ent++;
+                  comp.used[comp.n_used++] = i;
+                }
+              else
+                {
+                  gif_compress_clear (&comp);
+                }
 
-/*
- * Number of characters so far in this 'packet'
- */
-static int a_count;
+              ent = c;
+            }
+        }
+    }
 
-/*
- * Set up the 'byte output' routine
- */
-static void
-char_init (void)
-{
-  a_count = 0;
-}
+  /*
+   * Put out the final code.
+   */
+  if (ent >= 0)
+    gif_compress_output (&comp, ent);
 
-/*
- * Define the storage for the packet accumulator
- */
-static char accum[256];
+  gif_compress_output (&comp, comp.eof_code);
 
-/*
- * Add a character to the end of the current packet, and if it is 254
- * characters, flush the packet to disk.
- */
-static void
-char_out (int c)
-{
-  accum[a_count++] = c;
-  if (a_count >= 254)
-    flush_char ();
-}
+  /*
+   * At EOF, write the rest of the buffer.
+   */
+  if (comp.accum_bits > 0)
+    gif_compress_char_out (&comp, comp.accum & 0xff);
 
-/*
- * Flush the packet to disk, and reset the accumulator
- */
-static void
-flush_char (void)
-{
-  if (a_count > 0)
+  if (comp.packet_len > 0)
     {
-      fputc (a_count, g_outfile);
-      fwrite (accum, 1, a_count, g_outfile);
-      a_count = 0;
+      guchar len = comp.packet_len;
+
+      g_byte_array_append (comp.out, &len, 1);
+      g_byte_array_append (comp.out, comp.packet, comp.packet_len);
     }
+
+  g_free (comp.table);
+  g_free (comp.used);
+
+  return comp.out;
 }
 
 
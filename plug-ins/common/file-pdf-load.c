@@ -837,6 +837,97 @@ render_page_to_pixbuf (PopplerPage *page,
 
 #endif
 
+/*  Pages are rendered by a few threads, each with its own
+ *  PopplerDocument, because a document can't be rendered from several
+ *  threads at once.  The layers are created on the main thread, in
+ *  page order, and only a few rendered pages are kept waiting for it.
+ */
+#define PAGES_PER_THREAD 2
+
+typedef struct
+{
+  gint             page_no;
+  gchar           *label;
+  gint             width;
+  gint             height;
+  cairo_surface_t *surface;
+  gboolean         done;
+} RenderPage;
+
+typedef struct
+{
+  RenderPage *pages;
+  gint        n_pages;
+  gdouble     scale;
+  gboolean    antialias;
+  gint        next_page;
+  gint        n_loaded;
+  gint        max_pages;
+} RenderData;
+
+typedef struct
+{
+  RenderData      *render;
+  PopplerDocument *document;
+  GThread         *thread;
+} RenderThread;
+
+static GMutex render_mutex;
+static GCond  render_cond;
+
+static gpointer
+render_thread (gpointer data)
+{
+  RenderThread *thread = data;
+  RenderData   *render = thread->render;
+
+  while (TRUE)
+    {
+      RenderPage      *page;
+      PopplerPage     *poppler_page;
+      cairo_surface_t *surface = NULL;
+
+      g_mutex_lock (&render_mutex);
+
+      while (render->next_page < render->n_pages &&
+             render->next_page >= render->n_loaded + render->max_pages)
+        g_cond_wait (&render_cond, &render_mutex);
+
+      if (render->next_page == render->n_pages)
+        {
+          g_mutex_unlock (&render_mutex);
+          break;
+        }
+
+      page = &render->pages[render->next_page++];
+
+      g_mutex_unlock (&render_mutex);
+
+      poppler_page = poppler_document_get_page (thread->document,
+                                                page->page_no);
+
+      if (poppler_page)
+        {
+          surface = render_page_to_surface (poppler_page,
+                                            page->width, page->height,
+                                            render->scale,
+                                            render->antialias);
+
+          g_object_unref (poppler_page);
+        }
+
+      g_mutex_lock (&render_mutex);
+
+      page->surface = surface;
+      page->done    = TRUE;
+
+      g_cond_broadcast (&render_cond);
+      g_mutex_unlock (&render_mutex);
+    }
+
+  return NULL;
+}
+
 static gint32
 load_image (PopplerDocument        *doc,
             const gchar            *filename,
@@ -846,11 +937,14 @@ load_image (PopplerDocument        *doc,
             gboolean                antialias,
             PdfSelectedPages       *pages)
 {
-  gint32   image_ID = 0;
-  gint32  *images   = NULL;
-  gint     i;
-  gdouble  scale;
-  gdouble  doc_progress = 0;
+  gint32        image_ID = 0;
+  gint32       *images   = NULL;
+  RenderData    render;
+  RenderThread *threads;
+  gint          n_threads;
+  gint          i;
+  gdouble       scale;
+  gdouble       doc_progress = 0;
 
   if (target == GIMP_PAGE_SELECTOR_TARGET_IMAGES)
     images = g_new0 (gint32, pages->n_pages);
@@ -860,57 +954,112 @@ load_image (PopplerDocument        *doc,
 
   scale = resolution / gimp_unit_get_factor (GIMP_UNIT_POINT);
 
-  /* read the file */
+  render.pages     = g_new0 (RenderPage, pages->n_pages);
+  render.n_pages   = pages->n_pages;
+  render.scale     = scale;
+  render.antialias = antialias;
+  render.next_page = 0;
+  render.n_loaded  = 0;
 
   for (i = 0; i < pages->n_pages; i++)
     {
-      PopplerPage *page;
-      gchar       *page_label;
-      gdouble      page_width;
-      gdouble      page_height;
+      RenderPage  *page = &render.pages[i];
+      PopplerPage *poppler_page;
+      gdouble      page_width  = 0.0;
+      gdouble      page_height = 0.0;
+
+      page->page_no = pages->pages[i];
+
+      poppler_page = poppler_document_get_page (doc, page->page_no);
+
+      if (poppler_page)
+        {
+          poppler_page_get_size (poppler_page, &page_width, &page_height);
 
-      cairo_surface_t *surface;
-      gint             width;
-      gint             height;
+          g_object_get (G_OBJECT (poppler_page), "label", &page->label, NULL);
+          g_object_unref (poppler_page);
+        }
 
-      page = poppler_document_get_page (doc, pages->pages[i]);
+      page->width  = page_width  * scale;
+      page->height = page_height * scale;
+    }
+
+  /* read the file */
 
-      poppler_page_get_size (page, &page_width, &page_height);
-      width  = page_width  * scale;
-      height = page_height * scale;
+  n_threads = CLAMP (g_get_num_processors (), 1, pages->n_pages);
 
-      g_object_get (G_OBJECT (page), "label", &page_label, NULL);
+  render.max_pages = PAGES_PER_THREAD * n_threads;
 
-      if (! image_ID)
+  threads = g_new0 (RenderThread, n_threads);
+
+  for (i = 0; i < n_threads; i++)
+    {
+      threads[i].render = &render;
+
+      /*  the first thread renders the document we were given, the
+       *  others can do without if the file can't be opened again
+       */
+      if (i == 0)
+        threads[i].document = g_object_ref (doc);
+      else
+        threads[i].document = open_document (filename, NULL);
+
+      if (threads[i].document)
+        threads[i].thread = g_thread_new ("render", render_thread,
+                                          &threads[i]);
+    }
+
+  for (i = 0; i < pages->n_pages; i++)
+    {
+      RenderPage *page = &render.pages[i];
+
+      g_mutex_lock (&render_mutex);
+
+      while (! page->done)
+        g_cond_wait (&render_cond, &render_mutex);
+
+      g_mutex_unlock (&render_mutex);
+
+      if (page->surface)
         {
-          gchar *name;
+          if (! image_ID)
+            {
+              gchar *name;
 
-          image_ID = gimp_image_new (width, height, GIMP_RGB);
-          gimp_image_undo_disable (image_ID);
+              image_ID = gimp_image_new (page->width, page->height, GIMP_RGB);
+              gimp_image_undo_disable (image_ID);
 
-          if (target == GIMP_PAGE_SELECTOR_TARGET_IMAGES)
-            name = g_strdup_printf (_("%s-%s"), filename, page_label);
-          else
-            name = g_strdup_printf (_("%s-pages"), filename);
+              if (target == GIMP_PAGE_SELECTOR_TARGET_IMAGES)
+                name = g_strdup_printf (_("%s-%s"), filename, page->label);
+              else
+                name = g_strdup_printf (_("%s-pages"), filename);
+
+              gimp_image_set_filename (image_ID, name);
+              g_free (name);
 
-          gimp_image_set_filename (image_ID, name);
-          g_free (name);
+              gimp_image_set_resolution (image_ID, resolution, resolution);
+            }
+
+          layer_from_surface (image_ID, page->label, i, page->surface,
+                              doc_progress, 1.0 / pages->n_pages);
 
-          gimp_image_set_resolution (image_ID, resolution, resolution);
+          cairo_surface_destroy (page->surface);
+          page->surface = NULL;
         }
 
-      surface = render_page_to_surface (page, width, height, scale, antialias);
+      g_free (page->label);
 
-      layer_from_surface (image_ID, page_label, i, surface,
-                          doc_progress, 1.0 / pages->n_pages);
+      g_mutex_lock (&render_mutex);
 
-      g_free (page_label);
-      cairo_surface_destroy (surface);
+      render.n_loaded++;
+
+      g_cond_broadcast (&render_cond);
+      g_mutex_unlock (&render_mutex);
 
       doc_progress = (double) (i + 1) / pages->n_pages;
       gimp_progress_update (doc_progress);
 
-      if (target == GIMP_PAGE_SELECTOR_TARGET_IMAGES)
+      if (target == GIMP_PAGE_SELECTOR_TARGET_IMAGES && image_ID)
         {
           images[i] = image_ID;
 
@@ -922,6 +1071,18 @@ load_image (PopplerDocument        *doc,
     }
   gimp_progress_update (1.0);
 
+  for (i = 0; i < n_threads; i++)
+    {
+      if (threads[i].thread)
+        g_thread_join (threads[i].thread);
+
+      if (threads[i].document)
+        g_object_unref (threads[i].document);
+    }
+
+  g_free (threads);
+  g_free (render.pages);
+
   if (image_ID)
     {
       gimp_image_undo_enable (image_ID);
@@ -936,7 +1097,8 @@ load_image (PopplerDocument        *doc,
            * displayed by GIMP itself
            */
           for (i = pages->n_pages - 1; i > 0; i--)
-            gimp_display_new (images[i]);
+            if (images[i])
+              gimp_display_new (images[i]);
         }
 
       image_ID = images[0];
@@ -41,6 +41,7 @@
 #include "config.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 #include <glib/gstdio.h>
@@ -49,6 +50,7 @@
 #include <libgimp/gimpui.h>
 
 #include <png.h>                /* PNG library definitions */
+#include <zlib.h>
 
 #include "libgimp/stdplugins-intl.h"
 
@@ -73,6 +75,8 @@
 
 #define PNG_DEFAULTS_PARASITE  "png-save-defaults"
 
+#define BAND_BYTES             (4 * 1024 * 1024)
+
 /*
  * Structures...
  */
@@ -119,6 +123,31 @@ typedef struct
 }
 PngGlobals;
 
+/* A band of rows that is filtered and compressed in a worker thread. */
+typedef struct
+{
+  guchar   *rows;        /* the row before the band, then the band's rows */
+  gint      n_rows;
+  gsize     stride;      /* the distance between rows in @rows        */
+  gsize     rowbytes;    /* the bytes of a row in the file            */
+  gint      pixelbytes;  /* the bytes of a pixel, for filtering       */
+  gboolean  swap;        /* swap 16-bit samples to big endian         */
+  gboolean  filter;      /* choose a filter per row, or use none      */
+  gint      level;
+  gboolean  last;
+
+  guchar   *out;         /* 2 bytes of room for the zlib header, then *
+                          * the deflated data, then room for the      *
+                          * zlib checksum                             */
+  gsize     out_len;
+  guint32   adler;
+  gsize     in_len;
+
+  gboolean  success;
+  gboolean  done;
+}
+PngBand;
+
 /*
  * Local functions...
  */
@@ -139,6 +168,33 @@ static gboolean  save_image                (const gchar      *filename,
                                             gint32            orig_image_ID,
                                             GError          **error);
 
+static void      fix_up_rows               (png_structp       pp,
+                                            png_infop         info,
+                                            guchar          **pixels,
+                                            gint              num,
+                                            gint              width,
+                                            gint              bpp,
+                                            const guchar     *remap);
+static gboolean  save_rows_parallel        (png_structp       pp,
+                                            png_infop         info,
+                                            GeglBuffer       *buffer,
+                                            const Babl       *file_format,
+                                            gint              bpp,
+                                            gint              bit_depth,
+                                            gint              color_type,
+                                            const guchar     *remap);
+static void      band_filter_row           (const PngBand    *band,
+                                            const guchar     *prev,
+                                            const guchar     *row,
+                                            gint              type,
+                                            guchar           *dest);
+static gint      band_choose_filter        (const PngBand    *band,
+                                            const guchar     *prev,
+                                            const guchar     *row);
+static void      band_compress             (PngBand          *band,
+                                            gpointer          data);
+static void      band_free                 (PngBand          *band);
+
 static int       respin_cmap               (png_structp       pp,
                                             png_infop         info,
                                             guchar           *remap,
@@ -192,6 +248,9 @@ static const PngSaveVals defaults =
 static PngSaveVals pngvals;
 static PngGlobals pngg;
 
+static GMutex band_mutex;
+static GCond  band_cond;
+
 
 /*
  * 'main()' - Main entry - just call gimp_main()...
@@ -1298,7 +1357,7 @@ save_image (const gchar  *filename,
             gint32        orig_image_ID,
             GError      **error)
 {
-  gint i, k,                    /* Looping vars */
+  gint i,                       /* Looping var */
     bpp = 0,                    /* Bytes per pixel */
     type,                       /* Type of drawable/layer */
     num_passes,                 /* Number of interlace passes in file */
@@ -1316,7 +1375,6 @@ save_image (const gchar  *filename,
   png_infop info;               /* PNG info pointer */
   gint offx, offy;              /* Drawable offsets from origin */
   guchar **pixels,              /* Pixel rows */
-   *fixed,                      /* Fixed-up pixel data */
    *pixel;                      /* Pixel data */
   gdouble xres, yres;           /* GIMP resolution (dpi) */
   png_color_16 background;      /* Background color */
@@ -1625,6 +1683,24 @@ save_image (const gchar  *filename,
       bit_depth < 8)
     png_set_packing (pp);
 
+  /*
+   * Without interlacing and bit packing, compress the image data in
+   * several threads, otherwise let libpng do it.
+   */
+
+  if (num_passes == 1 && bit_depth >= 8 && g_get_num_processors () > 1)
+    {
+      if (! save_rows_parallel (pp, info, buffer, file_format,
+                                bpp, bit_depth, color_type, remap))
+        png_error (pp, "Could not compress the image data");
+
+      gimp_progress_update (1.0);
+
+      png_destroy_write_struct (&pp, &info);
+
+      goto done;
+    }
+
   /*
    * Allocate memory for "tile_height" rows and save the image...
    */
@@ -1655,72 +1731,7 @@ save_image (const gchar  *filename,
                            GEGL_AUTO_ROWSTRIDE,
                            GEGL_ABYSS_NONE);
 
-          /* If we are with a RGBA image and have to pre-multiply the
-             alpha channel */
-          if (bpp == 4 && ! pngvals.save_transp_pixels)
-            {
-              for (i = 0; i < num; ++i)
-                {
-                  fixed = pixels[i];
-                  for (k = 0; k < width; ++k)
-                    {
-                      if (!fixed[3])
-                        fixed[0] = fixed[1] = fixed[2] = 0;
-                      fixed += bpp;
-                    }
-                }
-            }
-
-          if (bpp == 8 && ! pngvals.save_transp_pixels)
-            {
-              for (i = 0; i < num; ++i)
-                {
-                  fixed = pixels[i];
-                  for (k = 0; k < width; ++k)
-                    {
-                      if (!fixed[6] && !fixed[7])
-                        fixed[0] = fixed[1] = fixed[2] =
-                            fixed[3] = fixed[4] = fixed[5] = 0;
-                      fixed += bpp;
-                    }
-                }
-            }
-
-          /* If we're dealing with a paletted image with
-           * transparency set, write out the remapped palette */
-          if (png_get_valid (pp, info, PNG_INFO_tRNS))
-            {
-              guchar inverse_remap[256];
-
-              for (i = 0; i < 256; i++)
-                inverse_remap[ remap[i] ] = i;
-
-              for (i = 0; i < num; ++i)
-                {
-                  fixed = pixels[i];
-                  for (k = 0; k < width; ++k)
-                    {
-                      fixed[k] = (fixed[k*2+1] > 127) ?
-                                 inverse_remap[ fixed[k*2] ] :
-                                 0;
-                    }
-                }
-            }
-
-          /* Otherwise if we have a paletted image and transparency
-           * couldn't be set, we ignore the alpha channel */
-          else if (png_get_valid (pp, info, PNG_INFO_PLTE) &&
-                   bpp == 2)
-            {
-              for (i = 0; i < num; ++i)
-                {
-                  fixed = pixels[i];
-                  for (k = 0; k < width; ++k)
-                    {
-                      fixed[k] = fixed[k * 2];
-                    }
-                }
-            }
+          fix_up_rows (pp, info, pixels, num, width, bpp, remap);
 
           png_write_rows (pp, pixels, num);
 
@@ -1738,6 +1749,7 @@ save_image (const gchar  *filename,
   g_free (pixel);
   g_free (pixels);
 
+ done:
   /*
    * Done with the file...
    */
@@ -1756,6 +1768,442 @@ save_image (const gchar  *filename,
   return TRUE;
 }
 
+/*
+ * Fixes up the pixels of rows fetched from the drawable before they
+ * are written to the file.
+ */
+
+static void
+fix_up_rows (png_structp   pp,
+             png_infop     info,
+             guchar      **pixels,
+             gint          num,
+             gint          width,
+             gint          bpp,
+             const guchar *remap)
+{
+  guchar *fixed;
+  gint    i, k;
+
+  /* If we are with a RGBA image and have to pre-multiply the
+     alpha channel */
+  if (bpp == 4 && ! pngvals.save_transp_pixels)
+    {
+      for (i = 0; i < num; ++i)
+        {
+          fixed = pixels[i];
+          for (k = 0; k < width; ++k)
+            {
+              if (!fixed[3])
+                fixed[0] = fixed[1] = fixed[2] = 0;
+              fixed += bpp;
+            }
+        }
+    }
+
+  if (bpp == 8 && ! pngvals.save_transp_pixels)
+    {
+      for (i = 0; i < num; ++i)
+        {
+          fixed = pixels[i];
+          for (k = 0; k < width; ++k)
+            {
+              if (!fixed[6] && !fixed[7])
+                fixed[0] = fixed[1] = fixed[2] =
+                    fixed[3] = fixed[4] = fixed[5] = 0;
+              fixed += bpp;
+            }
+        }
+    }
+
+  /* If we're dealing with a paletted image with
+   * transparency set, write out the remapped palette */
+  if (png_get_valid (pp, info, PNG_INFO_tRNS))
+    {
+      guchar inverse_remap[256];
+
+      for (i = 0; i < 256; i++)
+        inverse_remap[ remap[i] ] = i;
+
+      for (i = 0; i < num; ++i)
+        {
+          fixed = pixels[i];
+          for (k = 0; k < width; ++k)
+            {
+              fixed[k] = (fixed[k*2+1] > 127) ?
+                         inverse_remap[ fixed[k*2] ] :
+                         0;
+            }
+        }
+    }
+
+  /* Otherwise if we have a paletted image and transparency
+   * couldn't be set, we ignore the alpha channel */
+  else if (png_get_valid (pp, info, PNG_INFO_PLTE) &&
+           bpp == 2)
+    {
+      for (i = 0; i < num; ++i)
+        {
+          fixed = pixels[i];
+          for (k = 0; k < width; ++k)
+            {
+              fixed[k] = fixed[k * 2];
+            }
+        }
+    }
+}
+
+/*
+ * Writes the image data the way pigz compresses files: bands of rows
+ * are filtered and deflated in a thread pool, while the next rows are
+ * fetched from the drawable.  Every band but the last ends with a sync
+ * flush, so the compressed bands simply join into the single zlib
+ * stream of the IDAT chunks.  The file is a standard PNG.
+ */
+
+static gboolean
+save_rows_parallel (png_structp   pp,
+                    png_infop     info,
+                    GeglBuffer   *buffer,
+                    const Babl   *file_format,
+                    gint          bpp,
+                    gint          bit_depth,
+                    gint          color_type,
+                    const guchar *remap)
+{
+  GThreadPool *pool;
+  GQueue       bands    = G_QUEUE_INIT;
+  guchar      *prev_row;
+  guint32      adler    = adler32 (0L, Z_NULL, 0);
+  gint         width    = gegl_buffer_get_width (buffer);
+  gint         height   = gegl_buffer_get_height (buffer);
+  gint         n_threads;
+  gint         tile_height;
+  gint         band_height;
+  gsize        stride;
+  gboolean     success  = TRUE;
+  gboolean     first    = TRUE;
+  gint         begin;
+  gint         i;
+
+  n_threads   = g_get_num_processors ();
+  tile_height = gimp_tile_height ();
+  stride      = (gsize) width * bpp;
+
+  /*  bands of a few megabytes compress nearly as well as one stream  */
+  band_height = MAX (BAND_BYTES / stride / tile_height, 1) * tile_height;
+
+  pool = g_thread_pool_new ((GFunc) band_compress, NULL,
+                            n_threads, FALSE, NULL);
+
+  prev_row = g_new0 (guchar, stride);
+
+  for (begin = 0;
+       (success && begin < height) || ! g_queue_is_empty (&bands); )
+    {
+      PngBand *band;
+
+      if (success && begin < height &&
+          g_queue_get_length (&bands) < 2 * n_threads)
+        {
+          guchar **pixels;
+
+          band = g_slice_new0 (PngBand);
+
+          band->n_rows     = MIN (band_height, height - begin);
+          band->stride     = stride;
+          band->rows       = g_new (guchar, (band->n_rows + 1) * stride);
+          band->swap       = (bit_depth == 16 &&
+                              G_BYTE_ORDER == G_LITTLE_ENDIAN);
+          band->level      = pngvals.compression_level;
+          band->last       = (begin + band->n_rows == height);
+
+          /*  the same filters libpng would use  */
+          if (color_type == PNG_COLOR_TYPE_PALETTE)
+            {
+              band->rowbytes   = width;
+              band->pixelbytes = 1;
+              band->filter     = FALSE;
+            }
+          else
+            {
+              band->rowbytes   = stride;
+              band->pixelbytes = bpp;
+              band->filter     = TRUE;
+            }
+
+          memcpy (band->rows, prev_row, stride);
+
+          gegl_buffer_get (buffer,
+                           GEGL_RECTANGLE (0, begin, width, band->n_rows),
+                           1.0,
+                           file_format,
+                           band->rows + stride,
+                           GEGL_AUTO_ROWSTRIDE,
+                           GEGL_ABYSS_NONE);
+
+          pixels = g_new (guchar *, band->n_rows);
+
+          for (i = 0; i < band->n_rows; i++)
+            pixels[i] = band->rows + (i + 1) * stride;
+
+          fix_up_rows (pp, info, pixels, band->n_rows, width, bpp, remap);
+
+          g_free (pixels);
+
+          memcpy (prev_row, band->rows + band->n_rows * stride, stride);
+
+          begin += band->n_rows;
+
+          g_queue_push_tail (&bands, band);
+          g_thread_pool_push (pool, band, NULL);
+
+          continue;
+        }
+
+      /*  write the oldest band when it's done  */
+      band = g_queue_pop_head (&bands);
+
+      g_mutex_lock (&band_mutex);
+      while (! band->done)
+        g_cond_wait (&band_cond, &band_mutex);
+      g_mutex_unlock (&band_mutex);
+
+      if (success && band->success)
+        {
+          guchar *data = band->out + 2;
+          gsize   len  = band->out_len;
+
+          if (first)
+            {
+              /*  the zlib header, with the level hint the way zlib
+               *  itself writes it
+               */
+              guint header = (Z_DEFLATED + ((MAX_WBITS - 8) << 4)) << 8;
+
+              if (band->level >= 7)
+                header |= 3 << 6;
+              else if (band->level == 6)
+                header |= 2 << 6;
+              else if (band->level >= 2)
+                header |= 1 << 6;
+
+              header += 31 - (header % 31);
+
+              data    -= 2;
+              len     += 2;
+              data[0]  = header >> 8;
+              data[1]  = header & 0xff;
+
+              first = FALSE;
+            }
+
+          adler = adler32_combine (adler, band->adler, band->in_len);
+
+          if (band->last)
+            {
+              data[len++] = (adler >> 24) & 0xff;
+              data[len++] = (adler >> 16) & 0xff;
+              data[len++] = (adler >>  8) & 0xff;
+              data[len++] =  adler        & 0xff;
+            }
+
+          png_write_chunk (pp, (png_bytep) "IDAT", data, len);
+        }
+      else
+        {
+          success = FALSE;
+        }
+
+      gimp_progress_update ((gdouble) begin / (gdouble) height);
+
+      band_free (band);
+    }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+  g_free (prev_row);
+
+  if (success)
+    png_write_chunk (pp, (png_bytep) "IEND", NULL, 0);
+
+  return success;
+}
+
+static inline guchar
+band_filter_byte (gint   type,
+                  guchar x,
+                  guchar a,
+                  guchar b,
+                  guchar c)
+{
+  gint p, pa, pb, pc;
+
+  switch (type)
+    {
+    case PNG_FILTER_VALUE_SUB:
+      return x - a;
+
+    case PNG_FILTER_VALUE_UP:
+      return x - b;
+
+    case PNG_FILTER_VALUE_AVG:
+      return x - ((a + b) >> 1);
+
+    case PNG_FILTER_VALUE_PAETH:
+      p  = a + b - c;
+      pa = abs (p - a);
+      pb = abs (p - b);
+      pc = abs (p - c);
+
+      if (pa <= pb && pa <= pc)
+        return x - a;
+      else if (pb <= pc)
+        return x - b;
+      else
+        return x - c;
+
+    default:
+      return x;
+    }
+}
+
+static void
+band_filter_row (const PngBand *band,
+                 const guchar  *prev,
+                 const guchar  *row,
+                 gint           type,
+                 guchar        *dest)
+{
+  gsize i;
+
+  for (i = 0; i < band->rowbytes; i++)
+    {
+      guchar a = i >= band->pixelbytes ? row[i - band->pixelbytes]  : 0;
+      guchar c = i >= band->pixelbytes ? prev[i - band->pixelbytes] : 0;
+
+      dest[i] = band_filter_byte (type, row[i], a, prev[i], c);
+    }
+}
+
+/*  Picks the filter with the smallest sum of absolute differences,
+ *  like libpng's adaptive filtering does.
+ */
+static gint
+band_choose_filter (const PngBand *band,
+                    const guchar  *prev,
+                    const guchar  *row)
+{
+  gint    best     = PNG_FILTER_VALUE_NONE;
+  guint64 best_sum = G_MAXUINT64;
+  gint    type;
+
+  for (type = PNG_FILTER_VALUE_NONE; type < PNG_FILTER_VALUE_LAST; type++)
+    {
+      guint64 sum = 0;
+      gsize   i;
+
+      for (i = 0; i < band->rowbytes && sum < best_sum; i++)
+        {
+          guchar a = i >= band->pixelbytes ? row[i - band->pixelbytes]  : 0;
+          guchar c = i >= band->pixelbytes ? prev[i - band->pixelbytes] : 0;
+          gint8  v = band_filter_byte (type, row[i], a, prev[i], c);
+
+          sum += ABS (v);
+        }
+
+      if (sum < best_sum)
+        {
+          best     = type;
+          best_sum = sum;
+        }
+    }
+
+  return best;
+}
+
+static void
+band_compress (PngBand  *band,
+               gpointer  data)
+{
+  z_stream  strm = { 0, };
+  guchar   *filtered;
+  gsize     size;
+  gint      i;
+
+  if (band->swap)
+    {
+      guint16 *samples = (guint16 *) band->rows;
+      gsize    n       = (band->n_rows + 1) * band->stride / 2;
+      gsize    j;
+
+      for (j = 0; j < n; j++)
+        samples[j] = GUINT16_TO_BE (samples[j]);
+    }
+
+  band->in_len = band->n_rows * (band->rowbytes + 1);
+  filtered     = g_new (guchar, band->in_len);
+
+  for (i = 0; i < band->n_rows; i++)
+    {
+      const guchar *prev = band->rows + i * band->stride;
+      const guchar *row  = prev + band->stride;
+      guchar       *dest = filtered + i * (band->rowbytes + 1);
+      gint          type = PNG_FILTER_VALUE_NONE;
+
+      if (band->filter)
+        type = band_choose_filter (band, prev, row);
+
+      dest[0] = type;
+      band_filter_row (band, prev, row, type, dest + 1);
+    }
+
+  g_free (band->rows);
+  band->rows = NULL;
+
+  band->adler = adler32 (adler32 (0L, Z_NULL, 0), filtered, band->in_len);
+
+  /*  raw deflate, the zlib header and checksum are written separately  */
+  if (deflateInit2 (&strm, band->level, Z_DEFLATED, -MAX_WBITS, 8,
+                    Z_DEFAULT_STRATEGY) == Z_OK)
+    {
+      /*  room for the zlib header, the sync flush and the checksum  */
+      size = deflateBound (&strm, band->in_len) + 2 + 16 + 4;
+
+      band->out = g_new (guchar, size);
+
+      strm.next_in   = filtered;
+      strm.avail_in  = band->in_len;
+      strm.next_out  = band->out + 2;
+      strm.avail_out = size - 2 - 4;
+
+      if (band->last)
+        band->success = (deflate (&strm, Z_FINISH) == Z_STREAM_END);
+      else
+        band->success = (deflate (&strm, Z_SYNC_FLUSH) == Z_OK &&
+                         strm.avail_in == 0);
+
+      band->out_len = strm.total_out;
+
+      deflateEnd (&strm);
+    }
+
+  g_free (filtered);
+
+  g_mutex_lock (&band_mutex);
+  band->done = TRUE;
+  g_cond_broadcast (&band_cond);
+  g_mutex_unlock (&band_mutex);
+}
+
+static void
+band_free (PngBand *band)
+{
+  g_free (band->rows);
+  g_free (band->out);
+
+  g_slice_free (PngBand, band);
+}
+
 static gboolean
 ia_has_transparent_pixels (GeglBuffer *buffer)
 {
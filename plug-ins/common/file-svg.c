@@ -42,6 +42,8 @@
 #define SVG_DEFAULT_RESOLUTION  90.0
 #define SVG_DEFAULT_SIZE        500
 #define SVG_PREVIEW_SIZE        128
+#define SVG_BAND_PIXELS         (1 << 22)
+#define SVG_BANDS_PER_THREAD    2
 
 
 typedef struct
@@ -72,9 +74,15 @@ static void  run   (const gchar      *name,
 
 static gint32              load_image        (const gchar  *filename,
                                               GError      **error);
+static RsvgHandle        * load_rsvg_handle  (const gchar  *filename,
+                                              SvgLoadVals  *vals,
+                                              GError      **error);
 static GdkPixbuf         * load_rsvg_pixbuf  (const gchar  *filename,
                                               SvgLoadVals  *vals,
                                              GError      **error);
+static void                load_set_size_callback (gint     *width,
+                                                   gint     *height,
+                                                   gpointer  data);
 static gboolean            load_rsvg_size    (const gchar  *filename,
                                               SvgLoadVals  *vals,
                                               GError      **error);
@@ -177,6 +185,7 @@ run (const gchar      *name,
   GError            *error  = NULL;
 
   INIT_I18N ();
+  gegl_init (NULL, NULL);
 
   run_mode = param[0].data.d_int32;
 
@@ -308,20 +317,114 @@ run (const gchar      *name,
   values[0].data.d_status = status;
 }
 
+/*  The image is rendered in bands of rows, so memory use doesn't
+ *  grow with the image size.  The bands are rendered by a few
+ *  threads, each with its own RsvgHandle, and copied into the layer
+ *  on the main thread, in order.
+ */
+typedef struct
+{
+  gint             y;
+  gint             height;
+  cairo_surface_t *surface;
+  gboolean         done;
+} SvgBand;
+
+typedef struct
+{
+  SvgBand  *bands;
+  gint      n_bands;
+  gint      width;
+  gdouble   scale_x;
+  gdouble   scale_y;
+  gint      next_band;
+  gint      n_copied;
+  gint      max_bands;
+} SvgRender;
+
+typedef struct
+{
+  SvgRender  *render;
+  RsvgHandle *handle;
+  GThread    *thread;
+} SvgRenderThread;
+
+static GMutex render_mutex;
+static GCond  render_cond;
+
+static gpointer
+load_render_thread (gpointer data)
+{
+  SvgRenderThread *thread = data;
+  SvgRender       *render = thread->render;
+
+  while (TRUE)
+    {
+      SvgBand         *band;
+      cairo_surface_t *surface;
+      cairo_t         *cr;
+
+      g_mutex_lock (&render_mutex);
+
+      while (render->next_band < render->n_bands &&
+             render->next_band >= render->n_copied + render->max_bands)
+        g_cond_wait (&render_cond, &render_mutex);
+
+      if (render->next_band == render->n_bands)
+        {
+          g_mutex_unlock (&render_mutex);
+          break;
+        }
+
+      band = &render->bands[render->next_band++];
+
+      g_mutex_unlock (&render_mutex);
+
+      surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                            render->width, band->height);
+      cr = cairo_create (surface);
+
+      cairo_translate (cr, 0.0, -band->y);
+      cairo_scale (cr, render->scale_x, render->scale_y);
+
+      rsvg_handle_render_cairo (thread->handle, cr);
+
+      cairo_destroy (cr);
+      cairo_surface_flush (surface);
+
+      g_mutex_lock (&render_mutex);
+
+      band->surface = surface;
+      band->done    = TRUE;
+
+      g_cond_broadcast (&render_cond);
+      g_mutex_unlock (&render_mutex);
+    }
+
+  return NULL;
+}
+
 static gint32
 load_image (const gchar  *filename,
             GError      **load_error)
 {
-  gint32        image;
-  gint32        layer;
-  GdkPixbuf    *pixbuf;
-  gint          width;
-  gint          height;
-  GError       *error = NULL;
-
-  pixbuf = load_rsvg_pixbuf (filename, &load_vals, &error);
-
-  if (! pixbuf)
+  gint32             image;
+  gint32             layer;
+  RsvgHandle        *handle;
+  RsvgDimensionData  dim;
+  SvgRender          render;
+  SvgRenderThread   *threads;
+  GeglBuffer        *buffer;
+  gint               width;
+  gint               height;
+  gint               band_height;
+  gint               n_threads;
+  gint               i;
+  GError            *error = NULL;
+
+  handle = load_rsvg_handle (filename, &load_vals, &error);
+
+  if (! handle)
     {
       /*  Do not rely on librsvg setting GError on failure!  */
       g_set_error (load_error,
@@ -336,8 +439,12 @@ load_image (const gchar  *filename,
 
   gimp_progress_init (_("Rendering SVG"));
 
-  width  = gdk_pixbuf_get_width (pixbuf);
-  height = gdk_pixbuf_get_height (pixbuf);
+  rsvg_handle_get_dimensions (handle, &dim);
+
+  width  = dim.width;
+  height = dim.height;
+
+  load_set_size_callback (&width, &height, &load_vals);
 
   image = gimp_image_new (width, height, GIMP_RGB);
   gimp_image_undo_disable (image);
@@ -346,16 +453,105 @@ load_image (const gchar  *filename,
   gimp_image_set_resolution (image,
                              load_vals.resolution, load_vals.resolution);
 
-  layer = gimp_layer_new_from_pixbuf (image, _("Rendered SVG"), pixbuf,
-                                      100, GIMP_NORMAL_MODE, 0.0, 1.0);
+  layer = gimp_layer_new (image, _("Rendered SVG"), width, height,
+                          GIMP_RGBA_IMAGE, 100, GIMP_NORMAL_MODE);
   gimp_image_insert_layer (image, layer, -1, 0);
 
+  band_height = CLAMP (SVG_BAND_PIXELS / width, 1, height);
+
+  render.n_bands   = (height + band_height - 1) / band_height;
+  render.bands     = g_new0 (SvgBand, render.n_bands);
+  render.width     = width;
+  render.scale_x   = dim.width  > 0 ? (gdouble) width  / dim.width  : 1.0;
+  render.scale_y   = dim.height > 0 ? (gdouble) height / dim.height : 1.0;
+  render.next_band = 0;
+  render.n_copied  = 0;
+
+  for (i = 0; i < render.n_bands; i++)
+    {
+      render.bands[i].y      = i * band_height;
+      render.bands[i].height = MIN (band_height, height - i * band_height);
+    }
+
+  n_threads = CLAMP (g_get_num_processors (), 1, render.n_bands);
+
+  render.max_bands = SVG_BANDS_PER_THREAD * n_threads;
+
+  threads = g_new0 (SvgRenderThread, n_threads);
+
+  for (i = 0; i < n_threads; i++)
+    {
+      threads[i].render = &render;
+
+      /*  the first thread renders the handle we already have, the
+       *  others can do without if the file can't be parsed again
+       */
+      if (i == 0)
+        threads[i].handle = g_object_ref (handle);
+      else
+        threads[i].handle = load_rsvg_handle (filename, &load_vals, NULL);
+
+      if (threads[i].handle)
+        threads[i].thread = g_thread_new ("render", load_render_thread,
+                                          &threads[i]);
+    }
+
+  buffer = gimp_drawable_get_buffer (layer);
+
+  for (i = 0; i < render.n_bands; i++)
+    {
+      SvgBand    *band = &render.bands[i];
+      GeglBuffer *src_buffer;
+
+      g_mutex_lock (&render_mutex);
+
+      while (! band->done)
+        g_cond_wait (&render_cond, &render_mutex);
+
+      g_mutex_unlock (&render_mutex);
+
+      src_buffer = gimp_cairo_surface_create_buffer (band->surface);
+
+      gegl_buffer_copy (src_buffer, NULL, buffer,
+                        GEGL_RECTANGLE (0, band->y, width, band->height));
+
+      g_object_unref (src_buffer);
+      cairo_surface_destroy (band->surface);
+      band->surface = NULL;
+
+      g_mutex_lock (&render_mutex);
+
+      render.n_copied++;
+
+      g_cond_broadcast (&render_cond);
+      g_mutex_unlock (&render_mutex);
+
+      gimp_progress_update ((gdouble) (i + 1) / render.n_bands);
+    }
+
+  g_object_unref (buffer);
+
+  for (i = 0; i < n_threads; i++)
+    {
+      if (threads[i].thread)
+        g_thread_join (threads[i].thread);
+
+      if (threads[i].handle)
+        g_object_unref (threads[i].handle);
+    }
+
+  g_free (threads);
+  g_free (render.bands);
+  g_object_unref (handle);
+
+  gimp_progress_update (1.0);
+
   gimp_image_undo_enable (image);
 
   return image;
 }
 
-/*  This is the callback used from load_rsvg_pixbuf().  */
+/*  This is the callback used from load_image() and load_rsvg_pixbuf().  */
 static void
 load_set_size_callback (gint     *width,
                         gint     *height,
@@ -403,13 +599,14 @@ load_set_size_callback (gint     *width,
     }
 }
 
-/*  This function renders a pixbuf from an SVG file according to vals.  */
-static GdkPixbuf *
-load_rsvg_pixbuf (const gchar  *filename,
+/*  This function parses an SVG file into a handle, using the
+ *  resolution from vals.
+ */
+static RsvgHandle *
+load_rsvg_handle (const gchar  *filename,
                   SvgLoadVals  *vals,
                   GError      **error)
 {
-  GdkPixbuf  *pixbuf  = NULL;
   RsvgHandle *handle;
   GIOChannel *io;
   gchar      *uri;
@@ -438,8 +635,6 @@ load_rsvg_pixbuf (const gchar  *filename,
       g_free (uri);
     }
 
-  rsvg_handle_set_size_callback (handle, load_set_size_callback, vals, NULL);
-
   while (success && status != G_IO_STATUS_EOF)
     {
       gchar  buf[8192];
@@ -466,8 +661,33 @@ load_rsvg_pixbuf (const gchar  *filename,
 
   g_io_channel_unref (io);
 
-  if (success)
-    pixbuf = rsvg_handle_get_pixbuf (handle);
+  if (! success)
+    {
+      g_object_unref (handle);
+
+      return NULL;
+    }
+
+  return handle;
+}
+
+/*  This function renders a pixbuf from an SVG file according to vals.  */
+static GdkPixbuf *
+load_rsvg_pixbuf (const gchar  *filename,
+                  SvgLoadVals  *vals,
+                  GError      **error)
+{
+  GdkPixbuf  *pixbuf;
+  RsvgHandle *handle;
+
+  handle = load_rsvg_handle (filename, vals, error);
+
+  if (! handle)
+    return NULL;
+
+  rsvg_handle_set_size_callback (handle, load_set_size_callback, vals, NULL);
+
+  pixbuf = rsvg_handle_get_pixbuf (handle);
 
   g_object_unref (handle);
 
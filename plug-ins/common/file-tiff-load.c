@@ -71,9 +71,10 @@
 #include "libgimp/stdplugins-intl.h"
 
 
-#define LOAD_PROC      "file-tiff-load"
-#define PLUG_IN_BINARY "file-tiff-load"
-#define PLUG_IN_ROLE   "gimp-file-tiff-load"
+#define LOAD_PROC       "file-tiff-load"
+#define LOAD_THUMB_PROC "file-tiff-load-thumb"
+#define PLUG_IN_BINARY  "file-tiff-load"
+#define PLUG_IN_ROLE    "gimp-file-tiff-load"
 
 
 typedef struct
@@ -99,6 +100,19 @@ typedef struct
   gint *pages;
 } TiffSelectedPages;
 
+/*  a strip or tile decoded by a worker thread, using one of the
+ *  TIFF handles in @handles, which are open on the same directory
+ */
+typedef struct
+{
+  GAsyncQueue *handles;
+  gboolean     tiled;
+  uint32       index;
+  guchar      *buffer;
+  gboolean     success;
+  gboolean     done;
+} TiffChunk;
+
 /* Declare some local functions.
  */
 static void   query     (void);
@@ -116,13 +130,41 @@ static gint32    load_image       (const gchar        *filename,
                                    TiffSelectedPages  *pages,
                                    GError            **error);
 
+static gint32         load_thumbnail_image (const gchar   *filename,
+                                            TIFF          *tif,
+                                            gint           size,
+                                            gint          *width,
+                                            gint          *height,
+                                            GimpImageType *type,
+                                            gint          *num_layers);
+static GimpImageType  tiff_get_layer_type  (TIFF          *tif);
+
 static void      load_rgba        (TIFF         *tif,
                                    channel_data *channel);
-static void      load_contiguous  (TIFF         *tif,
+static void      load_contiguous  (const gchar  *filename,
+                                   TIFF         *tif,
                                    channel_data *channel,
                                    gushort       bps,
                                    gushort       spp,
                                    gint          extra);
+static gboolean  load_contiguous_parallel
+                                  (const gchar  *filename,
+                                   TIFF         *tif,
+                                   channel_data *channel,
+                                   const Babl   *src_format,
+                                   gint          extra);
+static void      load_contiguous_chunk
+                                  (channel_data *channel,
+                                   const Babl   *src_format,
+                                   gint          extra,
+                                   guchar       *buffer,
+                                   gint          rowstride,
+                                   uint32        x,
+                                   uint32        y,
+                                   uint32        cols,
+                                   uint32        rows);
+static void      decode_chunk     (TiffChunk    *chunk,
+                                   gpointer      data);
 static void      load_separate    (TIFF         *tif,
                                    channel_data *channel,
                                    gushort       bps,
@@ -160,6 +202,9 @@ static TiffSaveVals tsvals =
 static GimpRunMode             run_mode      = GIMP_RUN_INTERACTIVE;
 static GimpPageSelectorTarget  target        = GIMP_PAGE_SELECTOR_TARGET_LAYERS;
 
+static GMutex                  chunk_mutex;
+static GCond                   chunk_cond;
+
 
 MAIN ()
 
@@ -177,6 +222,20 @@ query (void)
     { GIMP_PDB_IMAGE, "image", "Output image" }
   };
 
+  static const GimpParamDef thumb_args[] =
+  {
+    { GIMP_PDB_STRING, "filename",     "The name of the file to load"  },
+    { GIMP_PDB_INT32,  "thumb-size",   "Preferred thumbnail size"      }
+  };
+  static const GimpParamDef thumb_return_vals[] =
+  {
+    { GIMP_PDB_IMAGE,  "image",        "Thumbnail image"               },
+    { GIMP_PDB_INT32,  "image-width",  "Width of full-sized image"     },
+    { GIMP_PDB_INT32,  "image-height", "Height of full-sized image"    },
+    { GIMP_PDB_INT32,  "image-type",   "Type of the image"             },
+    { GIMP_PDB_INT32,  "num-layers",   "Number of pages"               }
+  };
+
   gimp_install_procedure (LOAD_PROC,
                           "loads files of the tiff file format",
                           "FIXME: write help for tiff_load",
@@ -195,6 +254,23 @@ query (void)
                                     "tif,tiff",
                                     "",
                                     "0,string,II*\\0,0,string,MM\\0*");
+
+  gimp_install_procedure (LOAD_THUMB_PROC,
+                          "Loads a thumbnail from a TIFF image",
+                          "Loads the smallest reduced-resolution version "
+                          "of a TIFF image that is at least thumb-size "
+                          "large (only if it exists)",
+                          "Spencer Kimball, Peter Mattis & Nick Lamb",
+                          "Nick Lamb <njl195@zepler.org.uk>",
+                          "2016",
+                          NULL,
+                          NULL,
+                          GIMP_PLUGIN,
+                          G_N_ELEMENTS (thumb_args),
+                          G_N_ELEMENTS (thumb_return_vals),
+                          thumb_args, thumb_return_vals);
+
+  gimp_register_thumbnail_loader (LOAD_PROC, LOAD_THUMB_PROC);
 }
 
 static void
@@ -204,7 +280,7 @@ run (const gchar      *name,
      gint             *nreturn_vals,
      GimpParam       **return_vals)
 {
-  static GimpParam   values[2];
+  static GimpParam   values[6];
   GimpPDBStatusType  status = GIMP_PDB_SUCCESS;
   GError            *error  = NULL;
   gint32             image;
@@ -213,8 +289,6 @@ run (const gchar      *name,
   INIT_I18N ();
   gegl_init (NULL, NULL);
 
-  run_mode = param[0].data.d_int32;
-
   *nreturn_vals = 1;
   *return_vals  = values;
 
@@ -227,7 +301,11 @@ run (const gchar      *name,
   if (strcmp (name, LOAD_PROC) == 0)
     {
       const gchar *filename = param[1].data.d_string;
-      TIFF        *tif      = tiff_open (filename, "r", &error);
+      TIFF        *tif;
+
+      run_mode = param[0].data.d_int32;
+
+      tif = tiff_open (filename, "r", &error);
 
       if (tif)
         {
@@ -302,6 +380,47 @@ run (const gchar      *name,
           status = GIMP_PDB_EXECUTION_ERROR;
         }
     }
+  else if (strcmp (name, LOAD_THUMB_PROC) == 0)
+    {
+      const gchar   *filename   = param[0].data.d_string;
+      gint           size       = param[1].data.d_int32;
+      gint           width      = 0;
+      gint           height     = 0;
+      gint           num_layers = 0;
+      GimpImageType  type       = GIMP_RGB_IMAGE;
+      TIFF          *tif;
+
+      run_mode = GIMP_RUN_NONINTERACTIVE;
+
+      tif   = tiff_open (filename, "r", &error);
+      image = -1;
+
+      if (tif)
+        {
+          image = load_thumbnail_image (filename, tif, size,
+                                        &width, &height, &type, &num_layers);
+          TIFFClose (tif);
+        }
+
+      if (image != -1)
+        {
+          *nreturn_vals = 6;
+          values[1].type         = GIMP_PDB_IMAGE;
+          values[1].data.d_image = image;
+          values[2].type         = GIMP_PDB_INT32;
+          values[2].data.d_int32 = width;
+          values[3].type         = GIMP_PDB_INT32;
+          values[3].data.d_int32 = height;
+          values[4].type         = GIMP_PDB_INT32;
+          values[4].data.d_int32 = type;
+          values[5].type         = GIMP_PDB_INT32;
+          values[5].data.d_int32 = num_layers;
+        }
+      else
+        {
+          status = GIMP_PDB_EXECUTION_ERROR;
+        }
+    }
   else
     {
       status = GIMP_PDB_CALLING_ERROR;
@@ -1061,7 +1180,7 @@ load_image (const gchar        *filename,
         }
       else if (planar == PLANARCONFIG_CONTIG)
         {
-          load_contiguous (tif, channel, bps, spp, extra);
+          load_contiguous (filename, tif, channel, bps, spp, extra);
         }
       else
         {
@@ -1186,6 +1305,175 @@ load_image (const gchar        *filename,
   return image;
 }
 
+/*  Looks for a reduced-resolution version of the first page that is at
+ *  least @size pixels large, either as a following directory or as a
+ *  SubIFD, and loads the smallest such version.  Returns -1 if there is
+ *  none, the core then loads the full image instead.
+ */
+static gint32
+load_thumbnail_image (const gchar   *filename,
+                      TIFF          *tif,
+                      gint           size,
+                      gint          *width,
+                      gint          *height,
+                      GimpImageType *type,
+                      gint          *num_layers)
+{
+  gint32      image;
+  gint32      layer;
+  GeglBuffer *buffer;
+  toff_t      best_offset = 0;
+  uint32      best_size   = G_MAXUINT32;
+  toff_t     *offsets     = NULL;
+  uint16      n_offsets   = 0;
+  uint32      cols, rows;
+  uint32     *pixels;
+  uint32      row;
+  gint        n_dirs;
+  gint        i;
+
+  if (! TIFFSetDirectory (tif, 0) ||
+      ! TIFFGetField (tif, TIFFTAG_IMAGEWIDTH,  &cols) ||
+      ! TIFFGetField (tif, TIFFTAG_IMAGELENGTH, &rows))
+    {
+      return -1;
+    }
+
+  *width  = cols;
+  *height = rows;
+  *type   = tiff_get_layer_type (tif);
+
+  if (TIFFGetField (tif, TIFFTAG_SUBIFD, &n_offsets, &offsets))
+    offsets = g_memdup (offsets, n_offsets * sizeof (toff_t));
+  else
+    n_offsets = 0;
+
+  n_dirs      = TIFFNumberOfDirectories (tif);
+  *num_layers = n_dirs;
+
+  /*  the candidates are the SubIFDs of the first page, followed by
+   *  the top-level directories marked as reduced images
+   */
+  for (i = 0; i < n_offsets + n_dirs - 1; i++)
+    {
+      uint32 subfile_type = 0;
+      toff_t offset;
+
+      if (i < n_offsets)
+        {
+          offset = offsets[i];
+
+          if (! TIFFSetSubDirectory (tif, offset))
+            continue;
+        }
+      else
+        {
+          if (! TIFFSetDirectory (tif, i - n_offsets + 1))
+            continue;
+
+          offset = TIFFCurrentDirOffset (tif);
+        }
+
+      TIFFGetField (tif, TIFFTAG_SUBFILETYPE, &subfile_type);
+
+      if (! (subfile_type & FILETYPE_REDUCEDIMAGE))
+        continue;
+
+      if (i >= n_offsets)
+        (*num_layers)--;
+
+      if (TIFFGetField (tif, TIFFTAG_IMAGEWIDTH,  &cols) &&
+          TIFFGetField (tif, TIFFTAG_IMAGELENGTH, &rows) &&
+          MAX (cols, rows) >= size                       &&
+          MAX (cols, rows) <  best_size)
+        {
+          best_offset = offset;
+          best_size   = MAX (cols, rows);
+        }
+    }
+
+  g_free (offsets);
+
+  if (! best_offset || ! TIFFSetSubDirectory (tif, best_offset))
+    return -1;
+
+  TIFFGetField (tif, TIFFTAG_IMAGEWIDTH,  &cols);
+  TIFFGetField (tif, TIFFTAG_IMAGELENGTH, &rows);
+
+  pixels = g_try_new (uint32, cols * rows);
+
+  if (! pixels || ! TIFFReadRGBAImage (tif, cols, rows, pixels, 0))
+    {
+      g_free (pixels);
+      return -1;
+    }
+
+  image = gimp_image_new (cols, rows, GIMP_RGB);
+  gimp_image_undo_disable (image);
+  gimp_image_set_filename (image, filename);
+
+  layer = gimp_layer_new (image, _("Background"), cols, rows,
+                          GIMP_RGBA_IMAGE, 100, GIMP_NORMAL_MODE);
+  gimp_image_insert_layer (image, layer, -1, 0);
+
+  buffer = gimp_drawable_get_buffer (layer);
+
+  /*  TIFFReadRGBAImage() returns the rows bottom-up  */
+  for (row = 0; row < rows; row++)
+    {
+#if G_BYTE_ORDER != G_LITTLE_ENDIAN
+      uint32 j;
+
+      for (j = row * cols; j < (row + 1) * cols; j++)
+        pixels[j] = GUINT32_TO_LE (pixels[j]);
+#endif
+
+      gegl_buffer_set (buffer,
+                       GEGL_RECTANGLE (0, rows - row - 1, cols, 1), 0,
+                       babl_format ("R'aG'aB'aA u8"),
+                       pixels + row * cols,
+                       GEGL_AUTO_ROWSTRIDE);
+    }
+
+  g_object_unref (buffer);
+  g_free (pixels);
+
+  return image;
+}
+
+/*  A rough idea of the layer type the first page loads as, for the
+ *  thumbnail metadata.
+ */
+static GimpImageType
+tiff_get_layer_type (TIFF *tif)
+{
+  gushort  photomet;
+  gushort  extra;
+  gushort *extra_types;
+  gboolean alpha;
+
+  if (! TIFFGetField (tif, TIFFTAG_EXTRASAMPLES, &extra, &extra_types))
+    extra = 0;
+
+  alpha = extra > 0;
+
+  if (! TIFFGetField (tif, TIFFTAG_PHOTOMETRIC, &photomet))
+    photomet = PHOTOMETRIC_RGB;
+
+  switch (photomet)
+    {
+    case PHOTOMETRIC_MINISBLACK:
+    case PHOTOMETRIC_MINISWHITE:
+      return alpha ? GIMP_GRAYA_IMAGE : GIMP_GRAY_IMAGE;
+
+    case PHOTOMETRIC_PALETTE:
+      return alpha ? GIMP_INDEXEDA_IMAGE : GIMP_INDEXED_IMAGE;
+
+    default:
+      return alpha ? GIMP_RGBA_IMAGE : GIMP_RGB_IMAGE;
+    }
+}
+
 static void
 load_rgba (TIFF         *tif,
            channel_data *channel)
@@ -1419,7 +1707,8 @@ load_paths (TIFF *tif, gint image)
 
 
 static void
-load_contiguous (TIFF         *tif,
+load_contiguous (const gchar  *filename,
+                 TIFF         *tif,
                  channel_data *channel,
                  gushort       bps,
                  gushort       spp,
@@ -1429,15 +1718,30 @@ load_contiguous (TIFF         *tif,
   uint32  tileWidth, tileLength;
   uint32  x, y, rows, cols;
   int bytes_per_pixel;
-  GeglBuffer *src_buf;
   const Babl *src_format;
-  GeglBufferIterator *iter;
   guchar *buffer;
   gdouble progress = 0.0, one_row;
   gint    i;
 
   g_printerr ("%s\n", __func__);
 
+  if (bps <= 8)
+    src_format = babl_format_n (babl_type ("u8"), spp);
+  else
+    src_format = babl_format_n (babl_type ("u16"), spp);
+
+  /* consistency check */
+  bytes_per_pixel = 0;
+  for (i = 0; i <= extra; i++)
+    bytes_per_pixel += babl_format_get_bytes_per_pixel (channel[i].format);
+
+  g_printerr ("bytes_per_pixel: %d, format: %d\n", bytes_per_pixel,
+              babl_format_get_bytes_per_pixel (src_format));
+
+  if ((bps == 8 || bps == 16) &&
+      load_contiguous_parallel (filename, tif, channel, src_format, extra))
+    return;
+
   TIFFGetField (tif, TIFFTAG_IMAGEWIDTH, &imageWidth);
   TIFFGetField (tif, TIFFTAG_IMAGELENGTH, &imageLength);
 
@@ -1458,25 +1762,10 @@ load_contiguous (TIFF         *tif,
 
   one_row = (gdouble) tileLength / (gdouble) imageLength;
 
-  if (bps <= 8)
-    src_format = babl_format_n (babl_type ("u8"), spp);
-  else
-    src_format = babl_format_n (babl_type ("u16"), spp);
-
-  /* consistency check */
-  bytes_per_pixel = 0;
-  for (i = 0; i <= extra; i++)
-    bytes_per_pixel += babl_format_get_bytes_per_pixel (channel[i].format);
-
-  g_printerr ("bytes_per_pixel: %d, format: %d\n", bytes_per_pixel,
-              babl_format_get_bytes_per_pixel (src_format));
-
   for (y = 0; y < imageLength; y += tileLength)
     {
       for (x = 0; x < imageWidth; x += tileWidth)
         {
-          int offset;
-
           gimp_progress_update (progress + one_row *
                                 ( (gdouble) x / (gdouble) imageWidth));
 
@@ -1488,55 +1777,257 @@ load_contiguous (TIFF         *tif,
           cols = MIN (imageWidth - x, tileWidth);
           rows = MIN (imageLength - y, tileLength);
 
-          src_buf = gegl_buffer_linear_new_from_data (buffer,
-                                                      src_format,
-                                                      GEGL_RECTANGLE (0, 0, cols, rows),
-                                                      GEGL_AUTO_ROWSTRIDE,
-                                                      NULL, NULL);
+          load_contiguous_chunk (channel, src_format, extra, buffer,
+                                 tileWidth *
+                                 babl_format_get_bytes_per_pixel (src_format),
+                                 x, y, cols, rows);
+        }
+
+      progress += one_row;
+    }
 
-          offset = 0;
+  g_free (buffer);
+}
 
-          for (i = 0; i <= extra; i++)
-            {
-              gint src_bpp, dest_bpp;
-
-              src_bpp = babl_format_get_bytes_per_pixel (src_format);
-              dest_bpp = babl_format_get_bytes_per_pixel (channel[i].format);
-
-              iter = gegl_buffer_iterator_new (src_buf,
-                                               GEGL_RECTANGLE (0, 0, cols, rows),
-                                               0, NULL,
-                                               GEGL_BUFFER_READ,
-                                               GEGL_ABYSS_NONE);
-              gegl_buffer_iterator_add (iter, channel[i].buffer,
-                                        GEGL_RECTANGLE (x, y, cols, rows),
-                                        0, channel[i].format,
-                                        GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
-
-              while (gegl_buffer_iterator_next (iter))
-                {
-                  guchar *s = iter->data[0];
-                  guchar *d = iter->data[1];
-                  gint length = iter->length;
+/*  Decodes whole strips or tiles in worker threads, each with its own
+ *  TIFF handle on the file, while the main thread copies the decoded
+ *  chunks to the drawables in file order.  Returns FALSE without
+ *  reading anything if the file doesn't qualify.
+ */
+static gboolean
+load_contiguous_parallel (const gchar  *filename,
+                          TIFF         *tif,
+                          channel_data *channel,
+                          const Babl   *src_format,
+                          gint          extra)
+{
+  GThreadPool *pool;
+  GAsyncQueue *handles;
+  GQueue       chunks   = G_QUEUE_INIT;
+  uint32       imageWidth, imageLength;
+  uint32       tileWidth, tileLength;
+  uint32       n_chunks;
+  uint32       across;
+  uint32       next;
+  uint32       done;
+  gsize        chunk_size;
+  gint         rowstride;
+  gint         n_threads;
+  guint16      compression;
+  gint         i;
+
+  n_threads = g_get_num_processors ();
+
+  TIFFGetFieldDefaulted (tif, TIFFTAG_COMPRESSION, &compression);
+
+  /*  the codecs whose strips don't depend on state kept in the handle  */
+  switch (compression)
+    {
+    case COMPRESSION_NONE:
+    case COMPRESSION_LZW:
+    case COMPRESSION_PACKBITS:
+    case COMPRESSION_DEFLATE:
+    case COMPRESSION_ADOBE_DEFLATE:
+      break;
+
+    default:
+      return FALSE;
+    }
 
-                  s += offset;
+  TIFFGetField (tif, TIFFTAG_IMAGEWIDTH, &imageWidth);
+  TIFFGetField (tif, TIFFTAG_IMAGELENGTH, &imageLength);
 
-                  while (length--)
-                    {
-                      memcpy (d, s, dest_bpp);
-                      d += dest_bpp;
-                      s += src_bpp;
-                    }
-                }
+  if (TIFFIsTiled (tif))
+    {
+      TIFFGetField (tif, TIFFTAG_TILEWIDTH, &tileWidth);
+      TIFFGetField (tif, TIFFTAG_TILELENGTH, &tileLength);
 
-              offset += dest_bpp;
-            }
+      n_chunks   = TIFFNumberOfTiles (tif);
+      chunk_size = TIFFTileSize (tif);
+    }
+  else
+    {
+      tileWidth = imageWidth;
+      TIFFGetFieldDefaulted (tif, TIFFTAG_ROWSPERSTRIP, &tileLength);
+      tileLength = MIN (tileLength, imageLength);
+
+      n_chunks   = TIFFNumberOfStrips (tif);
+      chunk_size = TIFFStripSize (tif);
+    }
+
+  if (n_threads < 2 || n_chunks < 2 || tileWidth == 0 || tileLength == 0)
+    return FALSE;
+
+  /*  one handle per thread, libtiff handles are not thread-safe  */
+  handles = g_async_queue_new_full ((GDestroyNotify) TIFFClose);
+
+  for (i = 0; i < n_threads; i++)
+    {
+      TIFF *handle = tiff_open (filename, "r", NULL);
+
+      if (! handle)
+        break;
 
-          g_object_unref (src_buf);
+      if (! TIFFSetDirectory (handle, TIFFCurrentDirectory (tif)))
+        {
+          TIFFClose (handle);
+          break;
         }
 
-      progress += one_row;
+      g_async_queue_push (handles, handle);
+    }
+
+  if (i < 2)
+    {
+      g_async_queue_unref (handles);
+      return FALSE;
+    }
+
+  n_threads = i;
+
+  pool = g_thread_pool_new ((GFunc) decode_chunk, NULL,
+                            n_threads, FALSE, NULL);
+
+  across    = (imageWidth + tileWidth - 1) / tileWidth;
+  rowstride = tileWidth * babl_format_get_bytes_per_pixel (src_format);
+
+  for (next = 0, done = 0; done < n_chunks; )
+    {
+      TiffChunk *chunk;
+
+      /*  keep a few chunks per thread in flight, to bound memory use  */
+      if (next < n_chunks && g_queue_get_length (&chunks) < 2 * n_threads)
+        {
+          chunk = g_slice_new0 (TiffChunk);
+
+          chunk->handles = handles;
+          chunk->tiled   = TIFFIsTiled (tif);
+          chunk->index   = next++;
+          chunk->buffer  = g_malloc0 (chunk_size);
+
+          g_queue_push_tail (&chunks, chunk);
+          g_thread_pool_push (pool, chunk, NULL);
+
+          continue;
+        }
+
+      chunk = g_queue_pop_head (&chunks);
+
+      g_mutex_lock (&chunk_mutex);
+      while (! chunk->done)
+        g_cond_wait (&chunk_cond, &chunk_mutex);
+      g_mutex_unlock (&chunk_mutex);
+
+      /*  a broken chunk stays transparent or black, like a failed
+       *  TIFFReadScanline() in the sequential loader
+       */
+      if (chunk->success)
+        {
+          uint32 x    = (chunk->index % across) * tileWidth;
+          uint32 y    = (chunk->index / across) * tileLength;
+          uint32 cols = MIN (imageWidth - x, tileWidth);
+          uint32 rows = MIN (imageLength - y, tileLength);
+
+          load_contiguous_chunk (channel, src_format, extra, chunk->buffer,
+                                 rowstride, x, y, cols, rows);
+        }
+
+      g_free (chunk->buffer);
+      g_slice_free (TiffChunk, chunk);
+
+      done++;
+
+      gimp_progress_update ((gdouble) done / (gdouble) n_chunks);
+    }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+  g_async_queue_unref (handles);
+
+  return TRUE;
+}
+
+static void
+load_contiguous_chunk (channel_data *channel,
+                       const Babl   *src_format,
+                       gint          extra,
+                       guchar       *buffer,
+                       gint          rowstride,
+                       uint32        x,
+                       uint32        y,
+                       uint32        cols,
+                       uint32        rows)
+{
+  GeglBuffer         *src_buf;
+  GeglBufferIterator *iter;
+  gint                offset;
+  gint                i;
+
+  src_buf = gegl_buffer_linear_new_from_data (buffer,
+                                              src_format,
+                                              GEGL_RECTANGLE (0, 0, cols, rows),
+                                              rowstride,
+                                              NULL, NULL);
+
+  offset = 0;
+
+  for (i = 0; i <= extra; i++)
+    {
+      gint src_bpp, dest_bpp;
+
+      src_bpp = babl_format_get_bytes_per_pixel (src_format);
+      dest_bpp = babl_format_get_bytes_per_pixel (channel[i].format);
+
+      iter = gegl_buffer_iterator_new (src_buf,
+                                       GEGL_RECTANGLE (0, 0, cols, rows),
+                                       0, NULL,
+                                       GEGL_BUFFER_READ,
+                                       GEGL_ABYSS_NONE);
+      gegl_buffer_iterator_add (iter, channel[i].buffer,
+                                GEGL_RECTANGLE (x, y, cols, rows),
+                                0, channel[i].format,
+                                GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
+
+      while (gegl_buffer_iterator_next (iter))
+        {
+          guchar *s = iter->data[0];
+          guchar *d = iter->data[1];
+          gint length = iter->length;
+
+          s += offset;
+
+          while (length--)
+            {
+              memcpy (d, s, dest_bpp);
+              d += dest_bpp;
+              s += src_bpp;
+            }
+        }
+
+      offset += dest_bpp;
     }
+
+  g_object_unref (src_buf);
+}
+
+static void
+decode_chunk (TiffChunk *chunk,
+              gpointer   data)
+{
+  TIFF    *handle = g_async_queue_pop (chunk->handles);
+  tsize_t  size;
+
+  if (chunk->tiled)
+    size = TIFFReadEncodedTile (handle, chunk->index, chunk->buffer, -1);
+  else
+    size = TIFFReadEncodedStrip (handle, chunk->index, chunk->buffer, -1);
+
+  g_async_queue_push (chunk->handles, handle);
+
+  g_mutex_lock (&chunk_mutex);
+  chunk->success = (size != -1);
+  chunk->done    = TRUE;
+  g_cond_broadcast (&chunk_cond);
+  g_mutex_unlock (&chunk_mutex);
 }
 
 
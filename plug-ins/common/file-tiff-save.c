@@ -76,14 +76,53 @@
 #define PLUG_IN_BINARY "file-tiff-save"
 #define PLUG_IN_ROLE   "gimp-file-tiff-save"
 
+#define TILE_SIZE      256
+
+/*  switch to BigTIFF when the uncompressed image data alone gets
+ *  close to the 4 GB limit of classic TIFF
+ */
+#define BIGTIFF_SIZE   ((guint64) 3 << 30)
+
 
 typedef struct
 {
   gint      compression;
   gint      fillorder;
   gboolean  save_transp_pixels;
+  gboolean  tiled;
+  gboolean  pyramid;
 } TiffSaveVals;
 
+typedef struct
+{
+  gboolean  tiled;
+  glong     rowsperstrip;
+  gushort   bitspersample;
+  gushort   samplesperpixel;
+  gushort   photometric;
+  gushort   compression;
+  gushort   predictor;
+  gushort   n_extra_samples;
+  gushort   extra_samples[1];
+} TiffLayout;
+
+typedef struct
+{
+  const TiffLayout *layout;
+  guint             index;
+  guchar           *pixels;
+  gsize             size;
+  GByteArray       *data;
+  gboolean          success;
+  gboolean          done;
+} TiffTile;
+
+typedef struct
+{
+  GByteArray *data;
+  toff_t      pos;
+} TiffMemory;
+
 typedef struct
 {
   gint32        ID;
@@ -112,6 +151,40 @@ static gboolean  save_image             (const gchar  *filename,
                                          gint32        orig_image,
                                          GError      **error);
 
+static void      tiff_set_layout        (TIFF             *tif,
+                                         const TiffLayout *layout,
+                                         gint              width,
+                                         gint              height);
+static gboolean  save_tiles             (TIFF             *tif,
+                                         const TiffLayout *layout,
+                                         GeglBuffer       *buffer,
+                                         const Babl       *format,
+                                         gdouble           scale,
+                                         gint              width,
+                                         gint              height,
+                                         gint             *tiles_done,
+                                         gint              n_tiles_total);
+static void      compress_tile          (TiffTile         *tile,
+                                         gpointer          data);
+
+static tsize_t   tiff_memory_read       (thandle_t     handle,
+                                         tdata_t       buffer,
+                                         tsize_t       size);
+static tsize_t   tiff_memory_write      (thandle_t     handle,
+                                         tdata_t       buffer,
+                                         tsize_t       size);
+static toff_t    tiff_memory_seek       (thandle_t     handle,
+                                         toff_t        offset,
+                                         gint          whence);
+static gint      tiff_memory_close      (thandle_t     handle);
+static toff_t    tiff_memory_size       (thandle_t     handle);
+static gint      tiff_memory_map        (thandle_t     handle,
+                                         tdata_t      *base,
+                                         toff_t       *size);
+static void      tiff_memory_unmap      (thandle_t     handle,
+                                         tdata_t       base,
+                                         toff_t        size);
+
 static gboolean  save_dialog            (gboolean      has_alpha,
                                          gboolean      is_monochrome);
 
@@ -150,6 +223,9 @@ static TiffSaveVals tsvals =
 static gchar       *image_comment = NULL;
 static GimpRunMode  run_mode      = GIMP_RUN_INTERACTIVE;
 
+static GMutex       tile_mutex;
+static GCond        tile_cond;
+
 
 MAIN ()
 
@@ -667,7 +743,8 @@ save_image (const gchar  *filename,
   gint           cols, col, rows, row, i;
   glong          rowsperstrip;
   gushort        compression;
-  gushort        extra_samples[1];
+  TiffLayout     layout;
+  gint           n_levels = 0;
   gboolean       alpha;
   gshort         predictor;
   gshort         photometric;
@@ -703,7 +780,13 @@ save_image (const gchar  *filename,
   tile_height = gimp_tile_height ();
   rowsperstrip = tile_height;
 
-  tif = tiff_open (filename, "w", error);
+#ifdef TIFF_BIGTIFF_VERSION
+  if ((guint64) gimp_drawable_width (layer) * gimp_drawable_height (layer) *
+      gimp_drawable_bpp (layer) >= BIGTIFF_SIZE)
+    tif = tiff_open (filename, "w8", error);
+  else
+#endif
+    tif = tiff_open (filename, "w", error);
 
   if (! tif)
     {
@@ -858,36 +941,55 @@ save_image (const gchar  *filename,
         }
     }
 
-  /* Set TIFF parameters. */
-  TIFFSetField (tif, TIFFTAG_SUBFILETYPE, 0);
-  TIFFSetField (tif, TIFFTAG_IMAGEWIDTH, cols);
-  TIFFSetField (tif, TIFFTAG_IMAGELENGTH, rows);
-  TIFFSetField (tif, TIFFTAG_BITSPERSAMPLE, bitspersample);
-  TIFFSetField (tif, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
-  TIFFSetField (tif, TIFFTAG_COMPRESSION, compression);
-
-  if ((compression == COMPRESSION_LZW || compression == COMPRESSION_DEFLATE)
-      && (predictor != 0))
-    {
-      TIFFSetField (tif, TIFFTAG_PREDICTOR, predictor);
-    }
+  layout.tiled           = tsvals.tiled && ! is_bw;
+  layout.rowsperstrip    = rowsperstrip;
+  layout.bitspersample   = bitspersample;
+  layout.samplesperpixel = samplesperpixel;
+  layout.photometric     = photometric;
+  layout.compression     = compression;
+  layout.predictor       = predictor;
+  layout.n_extra_samples = 0;
 
   if (alpha)
     {
       if (tsvals.save_transp_pixels)
-        extra_samples [0] = EXTRASAMPLE_UNASSALPHA;
+        layout.extra_samples[0] = EXTRASAMPLE_UNASSALPHA;
       else
-        extra_samples [0] = EXTRASAMPLE_ASSOCALPHA;
+        layout.extra_samples[0] = EXTRASAMPLE_ASSOCALPHA;
 
-      TIFFSetField (tif, TIFFTAG_EXTRASAMPLES, 1, extra_samples);
+      layout.n_extra_samples = 1;
     }
 
-  TIFFSetField (tif, TIFFTAG_PHOTOMETRIC, photometric);
+  /*  halve the image until it fits into one tile, indexed pixels
+   *  can't be scaled down
+   */
+  if (layout.tiled && tsvals.pyramid && drawable_type != GIMP_INDEXED_IMAGE)
+    {
+      gint width  = cols;
+      gint height = rows;
+
+      while (width > TILE_SIZE || height > TILE_SIZE)
+        {
+          width  = (width  + 1) / 2;
+          height = (height + 1) / 2;
+          n_levels++;
+        }
+    }
+
+  /* Set TIFF parameters. */
+  TIFFSetField (tif, TIFFTAG_SUBFILETYPE, 0);
+  tiff_set_layout (tif, &layout, cols, rows);
   TIFFSetField (tif, TIFFTAG_DOCUMENTNAME, filename);
-  TIFFSetField (tif, TIFFTAG_SAMPLESPERPIXEL, samplesperpixel);
-  TIFFSetField (tif, TIFFTAG_ROWSPERSTRIP, rowsperstrip);
   /* TIFFSetField( tif, TIFFTAG_STRIPBYTECOUNTS, rows / rowsperstrip ); */
-  TIFFSetField (tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+
+  /*  the reduced-resolution levels follow as SubIFDs  */
+  if (n_levels > 0)
+    {
+      toff_t *sub_ifds = g_new0 (toff_t, n_levels);
+
+      TIFFSetField (tif, TIFFTAG_SUBIFD, (uint16) n_levels, sub_ifds);
+      g_free (sub_ifds);
+    }
 
   /* resolution fields */
   {
@@ -995,6 +1097,49 @@ save_image (const gchar  *filename,
   if (!is_bw && drawable_type == GIMP_INDEXED_IMAGE)
     TIFFSetField (tif, TIFFTAG_COLORMAP, red, grn, blu);
 
+  if (layout.tiled)
+    {
+      gint n_tiles    = 0;
+      gint tiles_done = 0;
+      gint level;
+
+      for (level = 0; level <= n_levels; level++)
+        {
+          gint width  = (cols + (1 << level) - 1) >> level;
+          gint height = (rows + (1 << level) - 1) >> level;
+
+          n_tiles += (((width  + TILE_SIZE - 1) / TILE_SIZE) *
+                      ((height + TILE_SIZE - 1) / TILE_SIZE));
+        }
+
+      for (level = 0; level <= n_levels; level++)
+        {
+          gint width  = (cols + (1 << level) - 1) >> level;
+          gint height = (rows + (1 << level) - 1) >> level;
+
+          if (level > 0)
+            {
+              if (! TIFFWriteDirectory (tif))
+                goto tile_error;
+
+              TIFFSetField (tif, TIFFTAG_SUBFILETYPE, FILETYPE_REDUCEDIMAGE);
+              tiff_set_layout (tif, &layout, width, height);
+            }
+
+          if (! save_tiles (tif, &layout, buffer, format,
+                            1.0 / (1 << level), width, height,
+                            &tiles_done, n_tiles))
+            goto tile_error;
+        }
+
+      goto done;
+
+    tile_error:
+      g_message (_("Failed to write the tiles of '%s'"),
+                 gimp_filename_to_utf8 (filename));
+      goto out;
+    }
+
   /* array to rearrange data */
   src = g_new (guchar, bytesperrow * tile_height);
   data = g_new (guchar, bytesperrow);
@@ -1054,6 +1199,7 @@ save_image (const gchar  *filename,
         gimp_progress_update ((gdouble) row / (gdouble) rows);
     }
 
+ done:
   TIFFFlushData (tif);
   TIFFClose (tif);
 
@@ -1071,6 +1217,303 @@ save_image (const gchar  *filename,
   return status;
 }
 
+static void
+tiff_set_layout (TIFF             *tif,
+                 const TiffLayout *layout,
+                 gint              width,
+                 gint              height)
+{
+  TIFFSetField (tif, TIFFTAG_IMAGEWIDTH, width);
+  TIFFSetField (tif, TIFFTAG_IMAGELENGTH, height);
+  TIFFSetField (tif, TIFFTAG_BITSPERSAMPLE, layout->bitspersample);
+  TIFFSetField (tif, TIFFTAG_ORIENTATION, ORIENTATION_TOPLEFT);
+  TIFFSetField (tif, TIFFTAG_COMPRESSION, layout->compression);
+
+  if ((layout->compression == COMPRESSION_LZW ||
+       layout->compression == COMPRESSION_DEFLATE) &&
+      (layout->predictor != 0))
+    {
+      TIFFSetField (tif, TIFFTAG_PREDICTOR, layout->predictor);
+    }
+
+  if (layout->n_extra_samples)
+    TIFFSetField (tif, TIFFTAG_EXTRASAMPLES,
+                  layout->n_extra_samples, layout->extra_samples);
+
+  TIFFSetField (tif, TIFFTAG_PHOTOMETRIC, layout->photometric);
+  TIFFSetField (tif, TIFFTAG_SAMPLESPERPIXEL, layout->samplesperpixel);
+  TIFFSetField (tif, TIFFTAG_PLANARCONFIG, PLANARCONFIG_CONTIG);
+
+  if (layout->tiled)
+    {
+      TIFFSetField (tif, TIFFTAG_TILEWIDTH, TILE_SIZE);
+      TIFFSetField (tif, TIFFTAG_TILELENGTH, TILE_SIZE);
+    }
+  else
+    {
+      TIFFSetField (tif, TIFFTAG_ROWSPERSTRIP, layout->rowsperstrip);
+    }
+}
+
+/*  Writes the tiles of the current directory, reading them from
+ *  @buffer at @scale.  With the codecs that keep no state between
+ *  tiles, the tiles are compressed in worker threads and the main
+ *  thread writes them in order as raw tiles.
+ */
+static gboolean
+save_tiles (TIFF             *tif,
+            const TiffLayout *layout,
+            GeglBuffer       *buffer,
+            const Babl       *format,
+            gdouble           scale,
+            gint              width,
+            gint              height,
+            gint             *tiles_done,
+            gint              n_tiles_total)
+{
+  GThreadPool *pool     = NULL;
+  GQueue       tiles    = G_QUEUE_INIT;
+  gsize        tile_bytes;
+  gint         bpp;
+  gint         across;
+  gint         n_tiles;
+  gint         n_threads;
+  gint         next;
+  gboolean     success  = TRUE;
+
+  bpp        = babl_format_get_bytes_per_pixel (format);
+  tile_bytes = (gsize) TILE_SIZE * TILE_SIZE * bpp;
+  across     = (width  + TILE_SIZE - 1) / TILE_SIZE;
+  n_tiles    = (height + TILE_SIZE - 1) / TILE_SIZE * across;
+  n_threads  = g_get_num_processors ();
+
+  switch (layout->compression)
+    {
+    case COMPRESSION_NONE:
+    case COMPRESSION_LZW:
+    case COMPRESSION_PACKBITS:
+    case COMPRESSION_DEFLATE:
+    case COMPRESSION_ADOBE_DEFLATE:
+      if (n_threads > 1 && n_tiles > 1)
+        pool = g_thread_pool_new ((GFunc) compress_tile, NULL,
+                                  n_threads, FALSE, NULL);
+      break;
+
+    default:
+      break;
+    }
+
+  for (next = 0; (success && next < n_tiles) || ! g_queue_is_empty (&tiles); )
+    {
+      TiffTile *tile;
+
+      if (success && next < n_tiles &&
+          (! pool || g_queue_get_length (&tiles) < 2 * n_threads))
+        {
+          gint x = (next % across) * TILE_SIZE;
+          gint y = (next / across) * TILE_SIZE;
+
+          tile = g_slice_new0 (TiffTile);
+
+          tile->layout = layout;
+          tile->index  = next++;
+          tile->size   = tile_bytes;
+          tile->pixels = g_malloc0 (tile_bytes);
+
+          /*  edge tiles are padded with zeros  */
+          gegl_buffer_get (buffer,
+                           GEGL_RECTANGLE (x, y,
+                                           MIN (TILE_SIZE, width  - x),
+                                           MIN (TILE_SIZE, height - y)),
+                           scale,
+                           format,
+                           tile->pixels,
+                           TILE_SIZE * bpp,
+                           GEGL_ABYSS_NONE);
+
+          if (pool)
+            {
+              g_queue_push_tail (&tiles, tile);
+              g_thread_pool_push (pool, tile, NULL);
+
+              continue;
+            }
+
+          success = (TIFFWriteEncodedTile (tif, tile->index, tile->pixels,
+                                           tile->size) >= 0);
+        }
+      else
+        {
+          tile = g_queue_pop_head (&tiles);
+
+          g_mutex_lock (&tile_mutex);
+          while (! tile->done)
+            g_cond_wait (&tile_cond, &tile_mutex);
+          g_mutex_unlock (&tile_mutex);
+
+          if (success)
+            success = (tile->success &&
+                       TIFFWriteRawTile (tif, tile->index,
+                                         tile->data->data,
+                                         tile->data->len) >= 0);
+        }
+
+      if (tile->data)
+        g_byte_array_free (tile->data, TRUE);
+
+      g_free (tile->pixels);
+      g_slice_free (TiffTile, tile);
+
+      (*tiles_done)++;
+
+      if ((*tiles_done % 16) == 0)
+        gimp_progress_update ((gdouble) *tiles_done / (gdouble) n_tiles_total);
+    }
+
+  if (pool)
+    g_thread_pool_free (pool, FALSE, TRUE);
+
+  return success;
+}
+
+/*  Compresses one tile by writing it to a TIFF in memory with the same
+ *  layout, so the result is exactly what libtiff would write, and
+ *  picks the compressed bytes out again.
+ */
+static void
+compress_tile (TiffTile *tile,
+               gpointer  data)
+{
+  TiffMemory  memory = { NULL, 0 };
+  TIFF       *scratch;
+  gboolean    success = FALSE;
+
+  memory.data = g_byte_array_new ();
+
+  scratch = TIFFClientOpen ("tile", "wm", (thandle_t) &memory,
+                            tiff_memory_read, tiff_memory_write,
+                            tiff_memory_seek, tiff_memory_close,
+                            tiff_memory_size,
+                            tiff_memory_map, tiff_memory_unmap);
+
+  if (scratch)
+    {
+      toff_t *offsets;
+      toff_t *byte_counts;
+
+      tiff_set_layout (scratch, tile->layout, TILE_SIZE, TILE_SIZE);
+
+      if (TIFFWriteEncodedTile (scratch, 0, tile->pixels, tile->size) >= 0 &&
+          TIFFGetField (scratch, TIFFTAG_TILEOFFSETS,    &offsets)         &&
+          TIFFGetField (scratch, TIFFTAG_TILEBYTECOUNTS, &byte_counts)     &&
+          offsets[0] + byte_counts[0] <= memory.data->len)
+        {
+          tile->data = g_byte_array_sized_new (byte_counts[0]);
+          g_byte_array_append (tile->data,
+                               memory.data->data + offsets[0],
+                               byte_counts[0]);
+          success = TRUE;
+        }
+
+      TIFFClose (scratch);
+    }
+
+  g_byte_array_free (memory.data, TRUE);
+
+  g_mutex_lock (&tile_mutex);
+  tile->success = success;
+  tile->done    = TRUE;
+  g_cond_broadcast (&tile_cond);
+  g_mutex_unlock (&tile_mutex);
+}
+
+static tsize_t
+tiff_memory_read (thandle_t handle,
+                  tdata_t   buffer,
+                  tsize_t   size)
+{
+  TiffMemory *memory = handle;
+
+  if (memory->pos >= memory->data->len)
+    return 0;
+
+  size = MIN (size, memory->data->len - memory->pos);
+  memcpy (buffer, memory->data->data + memory->pos, size);
+  memory->pos += size;
+
+  return size;
+}
+
+static tsize_t
+tiff_memory_write (thandle_t handle,
+                   tdata_t   buffer,
+                   tsize_t   size)
+{
+  TiffMemory *memory = handle;
+
+  if (memory->pos + size > memory->data->len)
+    g_byte_array_set_size (memory->data, memory->pos + size);
+
+  memcpy (memory->data->data + memory->pos, buffer, size);
+  memory->pos += size;
+
+  return size;
+}
+
+static toff_t
+tiff_memory_seek (thandle_t handle,
+                  toff_t    offset,
+                  gint      whence)
+{
+  TiffMemory *memory = handle;
+
+  switch (whence)
+    {
+    case SEEK_SET:
+      memory->pos = offset;
+      break;
+
+    case SEEK_CUR:
+      memory->pos += offset;
+      break;
+
+    case SEEK_END:
+      memory->pos = memory->data->len + offset;
+      break;
+    }
+
+  return memory->pos;
+}
+
+static gint
+tiff_memory_close (thandle_t handle)
+{
+  return 0;
+}
+
+static toff_t
+tiff_memory_size (thandle_t handle)
+{
+  TiffMemory *memory = handle;
+
+  return memory->data->len;
+}
+
+static gint
+tiff_memory_map (thandle_t  handle,
+                 tdata_t   *base,
+                 toff_t    *size)
+{
+  return 0;
+}
+
+static void
+tiff_memory_unmap (thandle_t handle,
+                   tdata_t   base,
+                   toff_t    size)
+{
+}
+
 static gboolean
 save_dialog (gboolean has_alpha,
              gboolean is_monochrome)
@@ -1082,6 +1525,7 @@ save_dialog (gboolean has_alpha,
   GtkWidget *label;
   GtkWidget *entry;
   GtkWidget *toggle;
+  GtkWidget *pyramid;
   GtkWidget *g3;
   GtkWidget *g4;
   gboolean   run;
@@ -1137,6 +1581,28 @@ save_dialog (gboolean has_alpha,
                     G_CALLBACK (gimp_toggle_button_update),
                     &tsvals.save_transp_pixels);
 
+  /* Tiles and reduced-resolution levels */
+  toggle = gtk_check_button_new_with_mnemonic (_("Save as _tiles"));
+  gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (toggle), tsvals.tiled);
+  gtk_box_pack_start (GTK_BOX (vbox), toggle, FALSE, FALSE, 0);
+  gtk_widget_show (toggle);
+
+  pyramid = gtk_check_button_new_with_mnemonic
+    (_("Save reduced-resolution _pyramid"));
+  gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (pyramid), tsvals.pyramid);
+  gtk_widget_set_sensitive (pyramid, tsvals.tiled);
+  gtk_box_pack_start (GTK_BOX (vbox), pyramid, FALSE, FALSE, 0);
+  gtk_widget_show (pyramid);
+
+  g_object_set_data (G_OBJECT (toggle), "set_sensitive", pyramid);
+
+  g_signal_connect (toggle, "toggled",
+                    G_CALLBACK (gimp_toggle_button_update),
+                    &tsvals.tiled);
+  g_signal_connect (pyramid, "toggled",
+                    G_CALLBACK (gimp_toggle_button_update),
+                    &tsvals.pyramid);
+
   /* comment entry */
   hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 6);
   gtk_box_pack_start (GTK_BOX (vbox), hbox, FALSE, FALSE, 0);
@@ -77,6 +77,17 @@ typedef struct
   gboolean                 bpc;
 } LcmsValues;
 
+/*  the rows of a layer are transformed in bands, one per thread  */
+#define LCMS_BAND_HEIGHT 64
+
+typedef struct
+{
+  cmsHTRANSFORM  transform;
+  guchar        *data;
+  gint           n_pixels;
+  gboolean       done;
+} LcmsBand;
+
 
 static void  query (void);
 static void  run   (const gchar      *name,
@@ -128,6 +139,14 @@ static void         lcms_image_transform_indexed (gint32           image,
                                                   cmsHPROFILE      dest_profile,
                                                   GimpColorRenderingIntent intent,
                                                   gboolean          bpc);
+static cmsHTRANSFORM lcms_transform_lookup       (GHashTable      *transforms,
+                                                  cmsHPROFILE      src_profile,
+                                                  cmsHPROFILE      dest_profile,
+                                                  cmsUInt32Number  lcms_format,
+                                                  GimpColorRenderingIntent intent,
+                                                  gboolean         bpc);
+static void         lcms_transform_band          (LcmsBand        *band,
+                                                  gpointer         data);
 static void         lcms_sRGB_checksum           (guchar          *digest);
 
 static cmsHPROFILE  lcms_load_profile            (const gchar     *filename,
@@ -144,6 +163,9 @@ static GimpPDBStatusType  lcms_dialog            (GimpColorConfig *config,
                                                   LcmsValues      *values);
 
 
+static GMutex band_mutex;
+static GCond  band_cond;
+
 static const GimpParamDef set_args[] =
 {
   { GIMP_PDB_INT32,  "run-mode",     "The run mode { RUN-INTERACTIVE (0), RUN-NONINTERACTIVE (1) }"     },
@@ -979,12 +1001,26 @@ lcms_image_transform_rgb (gint32                    image,
 {
   cmsHTRANSFORM    transform   = NULL;
   cmsUInt32Number  lcms_format = 0;
+  GHashTable      *transforms;
+  GThreadPool     *pool;
+  LcmsBand        *bands;
+  gint             n_bands     = g_get_num_processors ();
+  guchar          *buf         = NULL;
+  gint             buf_size    = 0;
   gint            *layers;
   gint             num_layers;
   gint             i;
 
   layers = gimp_image_get_layers (image, &num_layers);
 
+  transforms = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+                                      NULL,
+                                      (GDestroyNotify) cmsDeleteTransform);
+
+  bands = g_new0 (LcmsBand, n_bands);
+  pool  = g_thread_pool_new ((GFunc) lcms_transform_band, NULL,
+                             n_bands, FALSE, NULL);
+
   for (i = 0; i < num_layers; i++)
     {
       gint32          layer_id     = layers[i];
@@ -993,6 +1029,8 @@ lcms_image_transform_rgb (gint32                    image,
       const Babl     *type         = babl_format_get_type (layer_format, 0);
       const Babl     *iter_format  = NULL;
 
+      lcms_format = 0;
+
       if (type == babl_type ("u8"))
         {
           if (has_alpha)
@@ -1054,77 +1092,151 @@ lcms_image_transform_rgb (gint32                    image,
         }
 
       if (lcms_format != 0)
+        transform = lcms_transform_lookup (transforms,
+                                           src_profile, dest_profile,
+                                           lcms_format, intent, bpc);
+      else
+        transform = NULL;
+
+      if (transform)
         {
-          transform = cmsCreateTransform (src_profile,  lcms_format,
-                                          dest_profile, lcms_format,
-                                          intent,
-                                          cmsFLAGS_NOOPTIMIZE |
-                                          bpc ? cmsFLAGS_BLACKPOINTCOMPENSATION : 0);
+          GeglBuffer *src_buffer;
+          GeglBuffer *dest_buffer;
+          gint        layer_width;
+          gint        layer_height;
+          gint        layer_bpp;
+          gint        band_rows;
+          gint        y;
+          gdouble     progress_start = (gdouble) i / num_layers;
+          gdouble     progress_end   = (gdouble) (i + 1) / num_layers;
+          gdouble     range          = progress_end - progress_start;
+
+          src_buffer   = gimp_drawable_get_buffer (layer_id);
+          dest_buffer  = gimp_drawable_get_shadow_buffer (layer_id);
+          layer_width  = gegl_buffer_get_width (src_buffer);
+          layer_height = gegl_buffer_get_height (src_buffer);
+          layer_bpp    = babl_format_get_bytes_per_pixel (iter_format);
+
+          band_rows = LCMS_BAND_HEIGHT * n_bands;
+
+          if (! buf || layer_width * layer_bpp * band_rows > buf_size)
+            {
+              g_free (buf);
 
-          if (transform)
+              buf_size = layer_width * layer_bpp * band_rows;
+              buf      = g_malloc (buf_size);
+            }
+
+          for (y = 0; y < layer_height; y += band_rows)
             {
-              GeglBuffer         *src_buffer;
-              GeglBuffer         *dest_buffer;
-              GeglBufferIterator *iter;
-              gint                layer_width;
-              gint                layer_height;
-              gint                layer_bpp;
-              gboolean            layer_alpha;
-              gdouble             progress_start = (gdouble) i / num_layers;
-              gdouble             progress_end   = (gdouble) (i + 1) / num_layers;
-              gdouble             range          = progress_end - progress_start;
-              gint                count          = 0;
-              gint                done           = 0;
-
-              src_buffer   = gimp_drawable_get_buffer (layer_id);
-              dest_buffer  = gimp_drawable_get_shadow_buffer (layer_id);
-              layer_width  = gegl_buffer_get_width (src_buffer);
-              layer_height = gegl_buffer_get_height (src_buffer);
-              layer_bpp    = babl_format_get_bytes_per_pixel (iter_format);
-              layer_alpha  = babl_format_has_alpha (iter_format);
-
-              iter = gegl_buffer_iterator_new (src_buffer, NULL, 0,
-                                               iter_format,
-                                               GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
-
-              gegl_buffer_iterator_add (iter, dest_buffer, NULL, 0,
-                                        iter_format,
-                                        GEGL_BUFFER_WRITE, GEGL_ABYSS_NONE);
-
-              while (gegl_buffer_iterator_next (iter))
+              gint rows = MIN (band_rows, layer_height - y);
+              gint j;
+
+              gegl_buffer_get (src_buffer,
+                               GEGL_RECTANGLE (0, y, layer_width, rows), 1.0,
+                               iter_format, buf,
+                               GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+              /*  lcms doesn't touch the alpha channel, so the pixels
+               *  can be transformed in place
+               */
+              for (j = 0; j < n_bands; j++)
                 {
-                  /*  lcms doesn't touch the alpha channel, simply
-                   *  copy everything to dest before the transform
-                   */
-                  if (layer_alpha)
-                    memcpy (iter->data[1], iter->data[0],
-                            iter->length * layer_bpp);
-
-                  cmsDoTransform (transform,
-                                  iter->data[0], iter->data[1], iter->length);
+                  gint band_y = j * LCMS_BAND_HEIGHT;
+
+                  bands[j].transform = transform;
+                  bands[j].data      = buf + band_y * layer_width * layer_bpp;
+                  bands[j].n_pixels  = (CLAMP (rows - band_y,
+                                               0, LCMS_BAND_HEIGHT) *
+                                        layer_width);
+                  bands[j].done      = FALSE;
+
+                  if (bands[j].n_pixels > 0)
+                    g_thread_pool_push (pool, &bands[j], NULL);
+                  else
+                    bands[j].done = TRUE;
                 }
 
-              g_object_unref (src_buffer);
-              g_object_unref (dest_buffer);
+              g_mutex_lock (&band_mutex);
 
-              gimp_drawable_merge_shadow (layer_id, TRUE);
-              gimp_drawable_update (layer_id, 0, 0, layer_width, layer_height);
+              for (j = 0; j < n_bands; j++)
+                while (! bands[j].done)
+                  g_cond_wait (&band_cond, &band_mutex);
 
-              if (count++ % 32 == 0)
-                {
-                  gimp_progress_update (progress_start +
-                                        (gdouble) done /
-                                        (layer_width * layer_height) * range);
-                }
+              g_mutex_unlock (&band_mutex);
+
+              gegl_buffer_set (dest_buffer,
+                               GEGL_RECTANGLE (0, y, layer_width, rows), 0,
+                               iter_format, buf, GEGL_AUTO_ROWSTRIDE);
 
-              cmsDeleteTransform (transform);
+              gimp_progress_update (progress_start +
+                                    (gdouble) (y + rows) / layer_height *
+                                    range);
             }
+
+          g_object_unref (src_buffer);
+          g_object_unref (dest_buffer);
+
+          gimp_drawable_merge_shadow (layer_id, TRUE);
+          gimp_drawable_update (layer_id, 0, 0, layer_width, layer_height);
         }
     }
 
+  g_thread_pool_free (pool, FALSE, TRUE);
+  g_free (bands);
+  g_free (buf);
+
+  g_hash_table_unref (transforms);
   g_free (layers);
 }
 
+/*  Returns the transform for lcms_format, creating it on first use.
+ *  Layers of the same format share their transform.
+ */
+static cmsHTRANSFORM
+lcms_transform_lookup (GHashTable               *transforms,
+                       cmsHPROFILE               src_profile,
+                       cmsHPROFILE               dest_profile,
+                       cmsUInt32Number           lcms_format,
+                       GimpColorRenderingIntent  intent,
+                       gboolean                  bpc)
+{
+  cmsHTRANSFORM transform;
+
+  transform = g_hash_table_lookup (transforms, GUINT_TO_POINTER (lcms_format));
+
+  if (! transform)
+    {
+      /*  the transform is shared by the threads, which needs NOCACHE  */
+      transform = cmsCreateTransform (src_profile,  lcms_format,
+                                      dest_profile, lcms_format,
+                                      intent,
+                                      cmsFLAGS_NOOPTIMIZE |
+                                      cmsFLAGS_NOCACHE    |
+                                      (bpc ? cmsFLAGS_BLACKPOINTCOMPENSATION : 0));
+
+      if (transform)
+        g_hash_table_insert (transforms,
+                             GUINT_TO_POINTER (lcms_format), transform);
+      else
+        g_warning ("cmsCreateTransform() failed!");
+    }
+
+  return transform;
+}
+
+static void
+lcms_transform_band (LcmsBand *band,
+                     gpointer  data)
+{
+  cmsDoTransform (band->transform, band->data, band->data, band->n_pixels);
+
+  g_mutex_lock (&band_mutex);
+  band->done = TRUE;
+  g_cond_signal (&band_cond);
+  g_mutex_unlock (&band_mutex);
+}
+
 static void
 lcms_image_transform_indexed (gint32                    image,
                               cmsHPROFILE               src_profile,
@@ -1143,7 +1255,7 @@ lcms_image_transform_indexed (gint32                    image,
                                   dest_profile, format,
                                   intent,
                                   cmsFLAGS_NOOPTIMIZE |
-                                  bpc ? cmsFLAGS_BLACKPOINTCOMPENSATION : 0);
+                                  (bpc ? cmsFLAGS_BLACKPOINTCOMPENSATION : 0));
 
   if (transform)
     {
@@ -50,13 +50,18 @@ static void     scatter_hsv_preview (GimpPreview      *preview);
 
 static void     scatter_hsv_scatter (guchar           *r,
                                      guchar           *g,
-                                     guchar           *b);
+                                     guchar           *b,
+                                     gint              x,
+                                     gint              y);
 
 static gint     randomize_value     (gint              now,
                                      gint              min,
                                      gint              max,
                                      gboolean          wraps_around,
-                                     gint              rand_max);
+                                     gint              rand_max,
+                                     gint              x,
+                                     gint              y,
+                                     guint            *n);
 
 
 const GimpPlugInInfo PLUG_IN_INFO =
@@ -83,6 +88,12 @@ static ValueType VALS =
   10
 };
 
+/*  the noise is keyed on it and on the pixel position, so the preview
+ *  shows exactly the noise the drawable gets
+ */
+static guint32 scatter_seed;
+
+
 MAIN ()
 
 static void
@@ -149,6 +160,8 @@ run (const gchar      *name,
   values[0].type          = GIMP_PDB_STATUS;
   values[0].data.d_status = status;
 
+  scatter_seed = g_random_int ();
+
   switch (run_mode)
     {
     case GIMP_RUN_INTERACTIVE:
@@ -189,7 +202,8 @@ static void
 scatter_hsv_func (const guchar *src,
                   guchar       *dest,
                   gint          bpp,
-                  gpointer      data)
+                  gint          x,
+                  gint          y)
 {
   guchar h, s, v;
 
@@ -197,7 +211,7 @@ scatter_hsv_func (const guchar *src,
   s = src[1];
   v = src[2];
 
-  scatter_hsv_scatter (&h, &s, &v);
+  scatter_hsv_scatter (&h, &s, &v, x, y);
 
   dest[0] = h;
   dest[1] = s;
@@ -210,36 +224,96 @@ scatter_hsv_func (const guchar *src,
 static void
 scatter_hsv (GimpDrawable *drawable)
 {
+  GimpPixelRgn  src_rgn, dest_rgn;
+  gint          x1, y1, x2, y2;
+  gpointer      pr;
+  gint          total_area;
+  gint          area_so_far = 0;
+  gint          count;
+
   gimp_tile_cache_ntiles (2 * (drawable->width / gimp_tile_width () + 1));
 
   gimp_progress_init (_("HSV Noise"));
 
-  gimp_rgn_iterate2 (drawable, 0 /* unused */, scatter_hsv_func, NULL);
+  gimp_drawable_mask_bounds (drawable->drawable_id, &x1, &y1, &x2, &y2);
+
+  total_area = (x2 - x1) * (y2 - y1);
+
+  if (total_area > 0)
+    {
+      gimp_pixel_rgn_init (&src_rgn, drawable,
+                           x1, y1, x2 - x1, y2 - y1, FALSE, FALSE);
+      gimp_pixel_rgn_init (&dest_rgn, drawable,
+                           x1, y1, x2 - x1, y2 - y1, TRUE, TRUE);
+
+      for (pr = gimp_pixel_rgns_register (2, &src_rgn, &dest_rgn), count = 0;
+           pr != NULL;
+           pr = gimp_pixel_rgns_process (pr), count++)
+        {
+          const guchar *src_row  = src_rgn.data;
+          guchar       *dest_row = dest_rgn.data;
+          gint          x, y;
+
+          for (y = 0; y < src_rgn.h; y++)
+            {
+              const guchar *s = src_row;
+              guchar       *d = dest_row;
+
+              for (x = 0; x < src_rgn.w; x++)
+                {
+                  scatter_hsv_func (s, d, src_rgn.bpp,
+                                    src_rgn.x + x, src_rgn.y + y);
+
+                  s += src_rgn.bpp;
+                  d += dest_rgn.bpp;
+                }
+
+              src_row  += src_rgn.rowstride;
+              dest_row += dest_rgn.rowstride;
+            }
+
+          area_so_far += src_rgn.w * src_rgn.h;
+
+          if ((count % 16) == 0)
+            gimp_progress_update ((gdouble) area_so_far /
+                                  (gdouble) total_area);
+        }
+
+      gimp_progress_update (1.0);
+
+      gimp_drawable_flush (drawable);
+      gimp_drawable_merge_shadow (drawable->drawable_id, TRUE);
+      gimp_drawable_update (drawable->drawable_id,
+                            x1, y1, x2 - x1, y2 - y1);
+    }
 
   gimp_drawable_detach (drawable);
 }
 
 static gint
-randomize_value (gint     now,
-                 gint     min,
-                 gint     max,
-                 gboolean wraps_around,
-                 gint     rand_max)
+randomize_value (gint      now,
+                 gint      min,
+                 gint      max,
+                 gboolean  wraps_around,
+                 gint      rand_max,
+                 gint      x,
+                 gint      y,
+                 guint    *n)
 {
   gint    flag, steps, index;
   gdouble rand_val, new;
 
   steps = max - min + 1;
-  rand_val = g_random_double ();
+  rand_val = gimp_random_double (scatter_seed, x, y, (*n)++);
 
   for (index = 1; index < VALS.holdness; index++)
     {
-      double tmp = g_random_double ();
+      double tmp = gimp_random_double (scatter_seed, x, y, (*n)++);
       if (tmp < rand_val)
         rand_val = tmp;
     }
 
-  if (g_random_double () < 0.5)
+  if (gimp_random_double (scatter_seed, x, y, (*n)++) < 0.5)
     flag = -1;
   else
     flag = 1;
@@ -268,9 +342,12 @@ randomize_value (gint     now,
 static void
 scatter_hsv_scatter (guchar *r,
                      guchar *g,
-                     guchar *b)
+                     guchar *b,
+                     gint    x,
+                     gint    y)
 {
-  gint h, s, v;
+  guint n = 0;
+  gint  h, s, v;
   gint h1, s1, v1;
   gint h2, s2, v2;
 
@@ -280,17 +357,18 @@ scatter_hsv_scatter (guchar *r,
 
   /* there is no need for scattering hue of desaturated pixels here */
   if ((VALS.hue_distance > 0) && (s > 0))
-    h = randomize_value (h, 0, 359, TRUE,  VALS.hue_distance);
+    h = randomize_value (h, 0, 359, TRUE,  VALS.hue_distance, x, y, &n);
 
   /* desaturated pixels get random hue before increasing saturation */
   if (VALS.saturation_distance > 0) {
     if (s == 0)
-      h = g_random_int_range (0, 360);
-    s = randomize_value (s, 0, 255, FALSE, VALS.saturation_distance);
+      h = gimp_random_int_range (scatter_seed, x, y, n++, 0, 360);
+    s = randomize_value (s, 0, 255, FALSE, VALS.saturation_distance,
+                         x, y, &n);
   }
 
   if (VALS.value_distance > 0)
-    v = randomize_value (v, 0, 255, FALSE, VALS.value_distance);
+    v = randomize_value (v, 0, 255, FALSE, VALS.value_distance, x, y, &n);
 
   h1 = h; s1 = s; v1 = v;
 
@@ -338,7 +416,8 @@ scatter_hsv_preview (GimpPreview *preview)
   gimp_pixel_rgn_get_rect (&src_rgn, src, x1, y1, width, height);
 
   for (i = 0; i < width * height; i++)
-    scatter_hsv_func (src + i * bpp, dst + i * bpp, bpp, NULL);
+    scatter_hsv_func (src + i * bpp, dst + i * bpp, bpp,
+                      x1 + i % width, y1 + i / width);
 
   gimp_preview_draw_buffer (preview, dst, width * bpp);
 
@@ -71,15 +71,19 @@ static void     run          (const gchar      *name,
                               GimpParam       **return_vals);
 
 
-static void     noisify_func (const guchar     *src,
-                              guchar           *dest,
-                              gint              bpp,
-                              gpointer          data);
+static void     noisify_func     (const guchar  *src,
+                                  guchar        *dest,
+                                  gint           bpp,
+                                  gint           x,
+                                  gint           y);
 
-static void     noisify      (GimpPreview      *preview);
+static void     noisify_drawable (GimpDrawable  *drawable);
+static void     noisify          (GimpPreview   *preview);
 
 
-static gdouble  gauss                            (GRand         *gr);
+static gdouble  gauss                            (gint           x,
+                                                  gint           y,
+                                                  guint         *n);
 
 static gboolean noisify_dialog                   (GimpDrawable  *drawable,
                                                   gint           channels);
@@ -108,7 +112,10 @@ static NoisifyInterface noise_int =
   { NULL, NULL, NULL, NULL }
 };
 
-static GRand *noise_gr ; /* Global random number object */
+/*  the noise is keyed on it and on the pixel position, so the preview
+ *  shows exactly the noise the drawable gets
+ */
+static guint32 noise_seed;
 
 MAIN ()
 
@@ -198,7 +205,7 @@ run (const gchar      *name,
   values[0].type          = GIMP_PDB_STATUS;
   values[0].data.d_status = status;
 
-  noise_gr = g_rand_new ();
+  noise_seed = g_random_int ();
 
   /*  Get the specified drawable  */
   drawable = gimp_drawable_get (param[2].data.d_drawable);
@@ -217,7 +224,6 @@ run (const gchar      *name,
       if (! noisify_dialog (drawable, drawable->bpp))
         {
           gimp_drawable_detach (drawable);
-          g_rand_free (noise_gr);
           return;
         }
       break;
@@ -283,7 +289,7 @@ run (const gchar      *name,
       gimp_progress_init (_("Adding noise"));
 
       /*  compute the luminosity which exceeds the luminosity threshold  */
-      gimp_rgn_iterate2 (drawable, 0 /* unused */, noisify_func, noise_gr);
+      noisify_drawable (drawable);
 
       if (run_mode != GIMP_RUN_NONINTERACTIVE)
         gimp_displays_flush ();
@@ -300,24 +306,24 @@ run (const gchar      *name,
   values[0].data.d_status = status;
 
   gimp_drawable_detach (drawable);
-  g_rand_free (noise_gr);
 }
 
 static void
 noisify_func (const guchar *src,
               guchar       *dest,
               gint          bpp,
-              gpointer      data)
+              gint          x,
+              gint          y)
 {
-  GRand   *gr    = data;
-  gdouble  noise = 0;
-  gint     b;
+  gdouble noise = 0;
+  guint   n     = 0;
+  gint    b;
 
   for (b = 0; b < bpp; b++)
     {
       if (b == 0 || nvals.independent ||
           (b == 1 && bpp == 2) || (b == 3 && bpp == 4))
-        noise = nvals.noise[b] * gauss (gr) * 127;
+        noise = nvals.noise[b] * gauss (x, y, &n) * 127;
 
       if (nvals.noise[b] > 0.0)
         {
@@ -341,6 +347,67 @@ noisify_func (const guchar *src,
     }
 }
 
+static void
+noisify_drawable (GimpDrawable *drawable)
+{
+  GimpPixelRgn  src_rgn, dest_rgn;
+  gint          x1, y1, x2, y2;
+  gpointer      pr;
+  gint          total_area;
+  gint          area_so_far = 0;
+  gint          count;
+
+  gimp_drawable_mask_bounds (drawable->drawable_id, &x1, &y1, &x2, &y2);
+
+  total_area = (x2 - x1) * (y2 - y1);
+
+  if (total_area <= 0)
+    return;
+
+  gimp_pixel_rgn_init (&src_rgn, drawable,
+                       x1, y1, x2 - x1, y2 - y1, FALSE, FALSE);
+  gimp_pixel_rgn_init (&dest_rgn, drawable,
+                       x1, y1, x2 - x1, y2 - y1, TRUE, TRUE);
+
+  for (pr = gimp_pixel_rgns_register (2, &src_rgn, &dest_rgn), count = 0;
+       pr != NULL;
+       pr = gimp_pixel_rgns_process (pr), count++)
+    {
+      const guchar *src_row  = src_rgn.data;
+      guchar       *dest_row = dest_rgn.data;
+      gint          x, y;
+
+      for (y = 0; y < src_rgn.h; y++)
+        {
+          const guchar *s = src_row;
+          guchar       *d = dest_row;
+
+          for (x = 0; x < src_rgn.w; x++)
+            {
+              noisify_func (s, d, src_rgn.bpp,
+                            src_rgn.x + x, src_rgn.y + y);
+
+              s += src_rgn.bpp;
+              d += dest_rgn.bpp;
+            }
+
+          src_row  += src_rgn.rowstride;
+          dest_row += dest_rgn.rowstride;
+        }
+
+      area_so_far += src_rgn.w * src_rgn.h;
+
+      if ((count % 16) == 0)
+        gimp_progress_update ((gdouble) area_so_far / (gdouble) total_area);
+    }
+
+  gimp_progress_update (1.0);
+
+  gimp_drawable_flush (drawable);
+  gimp_drawable_merge_shadow (drawable->drawable_id, TRUE);
+  gimp_drawable_update (drawable->drawable_id, x1, y1, x2 - x1, y2 - y1);
+}
+
 static void
 noisify (GimpPreview *preview)
 {
@@ -351,7 +418,6 @@ noisify (GimpPreview *preview)
   gint          x1, y1;
   gint          width, height;
   gint          bpp;
-  GRand        *gr = g_rand_copy (noise_gr);
 
   drawable =
     gimp_drawable_preview_get_drawable (GIMP_DRAWABLE_PREVIEW (preview));
@@ -370,13 +436,13 @@ noisify (GimpPreview *preview)
   gimp_pixel_rgn_get_rect (&src_rgn, src, x1, y1, width, height);
 
   for (i = 0; i < width * height; i++)
-    noisify_func (src + i * bpp, dst + i * bpp, bpp, gr);
+    noisify_func (src + i * bpp, dst + i * bpp, bpp,
+                  x1 + i % width, y1 + i / width);
 
   gimp_preview_draw_buffer (preview, dst, width * bpp);
 
   g_free (src);
   g_free (dst);
-  g_rand_free (gr);
 }
 
 static void
@@ -574,26 +640,30 @@ noisify_dialog (GimpDrawable *drawable,
  *
  * Ratio method (Kinderman-Monahan); see Knuth v2, 3rd ed, p130
  * K+M, ACM Trans Math Software 3 (1977) 257-260.
+ *
+ * The uniform numbers are the pixel's, starting with its *n-th.
 */
 static gdouble
-gauss (GRand *gr)
+gauss (gint   x,
+       gint   y,
+       guint *n)
 {
-  gdouble u, v, x;
+  gdouble u, v, r;
 
   do
     {
-      v = g_rand_double (gr);
+      v = gimp_random_double (noise_seed, x, y, (*n)++);
 
       do
-        u = g_rand_double (gr);
+        u = gimp_random_double (noise_seed, x, y, (*n)++);
       while (u == 0);
 
       /* Const 1.715... = sqrt(8/e) */
-      x = 1.71552776992141359295 * (v - 0.5) / u;
+      r = 1.71552776992141359295 * (v - 0.5) / u;
     }
-  while (x * x > -4.0 * log (u));
+  while (r * r > -4.0 * log (u));
 
-  return x;
+  return r;
 }
 
 static void
@@ -53,6 +53,31 @@ typedef struct
   gint     mode;
 } OilifyVals;
 
+/*  What the threads filtering bands of rows share  */
+typedef struct
+{
+  gint           width;
+  gint           height;
+  gint           bpp;
+  const guchar  *src_buf;
+  const guchar  *src_inten_buf;  /* NULL unless in intensity mode */
+  const guchar  *msmap_buf;      /* NULL unless using a mask-size map */
+  gint           msmap_bpp;
+  const guchar  *emap_buf;       /* NULL unless using an exponent map */
+  gint           emap_bpp;
+  const gdouble *weights;        /* NULL unless the exponent is constant */
+  gint           max_radius;
+  guchar        *dest_buf;
+} OilifyContext;
+
+typedef struct
+{
+  const OilifyContext *context;
+  gint                 y1;
+  gint                 y2;       /* Rows y1 to y2 - 1 */
+  gboolean             done;
+} OilifyBand;
+
 
 /* Declare local functions.
  */
@@ -65,6 +90,8 @@ static void      run            (const gchar      *name,
 
 static void      oilify         (GimpDrawable     *drawable,
                                  GimpPreview      *preview);
+static void      oilify_band    (OilifyBand       *band,
+                                 gpointer          data);
 
 static gboolean  oilify_dialog  (GimpDrawable     *drawable);
 
@@ -89,6 +116,10 @@ static OilifyVals ovals =
 };
 
 
+static GMutex band_mutex;
+static GCond  band_cond;
+
+
 MAIN ()
 
 static void
@@ -427,40 +458,110 @@ weighted_average_color (gint    hist[HISTSIZE],
     }
 }
 
+/*
+ * The same as weighted_average_value() and weighted_average_color(),
+ * with the weights for each number of occurrences looked up in a
+ * table.  The table holds (count / N)^exponent for some N not smaller
+ * than any count; dividing by hist_max instead would only scale all
+ * weights by the same factor, which cancels out.
+ */
+static inline guchar
+weighted_average_value_lut (const gint     hist[HISTSIZE],
+                            const gdouble *weights)
+{
+  gint    i;
+  gint    hist_max = 1;
+  gdouble sum = 0.0;
+  gdouble div;
+  gint    value;
+
+  for (i = 0; i < HISTSIZE; i++)
+    hist_max = MAX (hist_max, hist[i]);
+
+  div = 1.0e-6 * weights[hist_max];
+
+  for (i = 0; i < HISTSIZE; i++)
+    {
+      if (hist[i] > 0)
+        {
+          gdouble weight = weights[hist[i]];
+
+          sum += weight * (gdouble) i;
+          div += weight;
+        }
+    }
+
+  value = (gint) (sum / div);
+
+  return (guchar) CLAMP0255 (value);
+}
+
+static inline void
+weighted_average_color_lut (const gint     hist[HISTSIZE],
+                            const gint     hist_rgb[4][HISTSIZE],
+                            const gdouble *weights,
+                            guchar        *dest,
+                            gint           bpp)
+{
+  gint    i, b;
+  gint    hist_max = 1;
+  gdouble div;
+  gdouble color[4] = { 0.0, 0.0, 0.0, 0.0 };
+
+  for (i = 0; i < HISTSIZE; i++)
+    hist_max = MAX (hist_max, hist[i]);
+
+  div = 1.0e-6 * weights[hist_max];
+
+  for (i = 0; i < HISTSIZE; i++)
+    {
+      if (hist[i] > 0)
+        {
+          gdouble weight = weights[hist[i]] / (gdouble) hist[i];
+
+          for (b = 0; b < bpp; b++)
+            color[b] += weight * (gdouble) hist_rgb[b][i];
+
+          div += weights[hist[i]];
+        }
+    }
+
+  for (b = 0; b < bpp; b++)
+    {
+      gint c = (gint) (color[b] / div);
+
+      dest[b] = (guchar) CLAMP0255 (c);
+    }
+}
+
 /*
  * For all x and y as requested, replace the pixel at (x,y)
  * with a weighted average of the most frequently occurring
  * values in a circle of mask_size diameter centered at (x,y).
+ *
+ * The image is cut into bands of rows which are filtered in parallel.
  */
 static void
 oilify (GimpDrawable *drawable,
         GimpPreview  *preview)
 {
-  gboolean      use_inten;
-  gboolean      use_msmap = FALSE;
-  gboolean      use_emap = FALSE;
-  GimpDrawable *mask_size_map_drawable = NULL;
-  GimpDrawable *exponent_map_drawable = NULL;
-  GimpPixelRgn  mask_size_map_rgn;
-  GimpPixelRgn  exponent_map_rgn;
-  gint          msmap_bpp = 0;
-  gint          emap_bpp = 0;
-  GimpPixelRgn  dest_rgn;
-  GimpPixelRgn *regions[3];
-  gint          n_regions;
-  gint          bpp;
-  gint         *sqr_lut;
-  gint          x1, y1, x2, y2;
-  gint          width, height;
-  gint          Hist[HISTSIZE];
-  gint          Hist_rgb[4][HISTSIZE];
-  gpointer      pr;
-  gint          progress, max_progress;
-  guchar       *src_buf;
-  guchar       *src_inten_buf = NULL;
-  gint          i;
-
-  use_inten = (ovals.mode == MODE_INTEN);
+  OilifyContext  context = { 0, };
+  GThreadPool   *pool;
+  OilifyBand    *bands;
+  GimpPixelRgn   src_rgn;
+  guchar        *src_buf;
+  guchar        *src_inten_buf = NULL;
+  guchar        *msmap_buf = NULL;
+  guchar        *emap_buf = NULL;
+  guchar        *dest_buf;
+  gdouble       *weights = NULL;
+  gint           x1, y1, x2, y2;
+  gint           width, height;
+  gint           bpp;
+  gint           n_threads;
+  gint           n_bands;
+  gint           band_height;
+  gint           i;
 
   /*  Get the selection bounds  */
   if (preview)
@@ -478,265 +579,338 @@ oilify (GimpDrawable *drawable,
       height = y2 - y1;
     }
 
-  progress = 0;
-  max_progress = width * height;
-
   bpp = drawable->bpp;
 
+  gimp_pixel_rgn_init (&src_rgn, drawable,
+                       x1, y1, width, height, FALSE, FALSE);
+  src_buf = g_new (guchar, width * height * bpp);
+  gimp_pixel_rgn_get_rect (&src_rgn, src_buf, x1, y1, width, height);
+
   /*
-   * Look-up-table implementation of the square function, for use in the
-   * VERY TIGHT inner loops
+   * If we're working in intensity mode, then generate a separate intensity
+   * map of the source image. This way, we can avoid calculating the
+   * intensity of any given source pixel more than once.
    */
-  {
-    gint lut_size = (gint) ovals.mask_size / 2 + 1;
+  if (ovals.mode == MODE_INTEN)
+    {
+      guchar *src;
+      guchar *dest;
 
-    sqr_lut = g_new (gint, lut_size);
+      src_inten_buf = g_new (guchar, width * height);
 
-    for (i = 0; i < lut_size; i++)
-      sqr_lut[i] = SQR (i);
-  }
+      for (i = 0,
+           src = src_buf,
+           dest = src_inten_buf
+           ;
+           i < (width * height)
+           ;
+           i++,
+           src += bpp,
+           dest++)
+        {
+          *dest = (guchar) GIMP_RGB_LUMINANCE (src[0], src[1], src[2]);
+        }
+    }
 
-  /*  Get the map drawables, if applicable  */
+  /*  Read the map drawables, if applicable  */
 
   if (ovals.use_mask_size_map && ovals.mask_size_map >= 0)
     {
-      use_msmap = TRUE;
+      GimpDrawable *map = gimp_drawable_get (ovals.mask_size_map);
+      GimpPixelRgn  map_rgn;
 
-      mask_size_map_drawable = gimp_drawable_get (ovals.mask_size_map);
-      gimp_pixel_rgn_init (&mask_size_map_rgn, mask_size_map_drawable,
+      gimp_pixel_rgn_init (&map_rgn, map,
                            x1, y1, width, height, FALSE, FALSE);
+      msmap_buf = g_new (guchar, width * height * map->bpp);
+      gimp_pixel_rgn_get_rect (&map_rgn, msmap_buf, x1, y1, width, height);
 
-      msmap_bpp = mask_size_map_drawable->bpp;
+      context.msmap_bpp = map->bpp;
+
+      gimp_drawable_detach (map);
     }
 
   if (ovals.use_exponent_map && ovals.exponent_map >= 0)
     {
-      use_emap = TRUE;
+      GimpDrawable *map = gimp_drawable_get (ovals.exponent_map);
+      GimpPixelRgn  map_rgn;
 
-      exponent_map_drawable = gimp_drawable_get (ovals.exponent_map);
-      gimp_pixel_rgn_init (&exponent_map_rgn, exponent_map_drawable,
+      gimp_pixel_rgn_init (&map_rgn, map,
                            x1, y1, width, height, FALSE, FALSE);
+      emap_buf = g_new (guchar, width * height * map->bpp);
+      gimp_pixel_rgn_get_rect (&map_rgn, emap_buf, x1, y1, width, height);
 
-      emap_bpp = exponent_map_drawable->bpp;
-    }
-
-  gimp_pixel_rgn_init (&dest_rgn, drawable,
-                       x1, y1, width, height, (preview == NULL), TRUE);
+      context.emap_bpp = map->bpp;
 
-  {
-    GimpPixelRgn src_rgn;
+      gimp_drawable_detach (map);
+    }
 
-    gimp_pixel_rgn_init (&src_rgn, drawable,
-                         x1, y1, width, height, FALSE, FALSE);
-    src_buf = g_new (guchar, width * height * bpp);
-    gimp_pixel_rgn_get_rect (&src_rgn, src_buf, x1, y1, width, height);
-  }
+  /*  a mask-size map can round the radius up  */
+  context.max_radius = ROUND (0.5 * ovals.mask_size) + 1;
 
   /*
-   * If we're working in intensity mode, then generate a separate intensity
-   * map of the source image. This way, we can avoid calculating the
-   * intensity of any given source pixel more than once.
+   * With a constant exponent, tabulate the weights for every possible
+   * number of occurrences, unless the smallest ones would underflow.
    */
-  if (use_inten)
+  if (! emap_buf)
     {
-      guchar *src;
-      guchar *dest;
-
-      src_inten_buf = g_new (guchar, width * height);
+      gint n_max = SQR (2 * context.max_radius + 1);
 
-      for (i = 0,
-           src = src_buf,
-           dest = src_inten_buf
-           ;
-           i < (width * height)
-           ;
-           i++,
-           src += bpp,
-           dest++)
+      if (ovals.exponent * log10 (n_max) < 300.0)
         {
-          *dest = (guchar) GIMP_RGB_LUMINANCE (src[0], src[1], src[2]);
+          weights = g_new (gdouble, n_max + 1);
+
+          for (i = 0; i <= n_max; i++)
+            weights[i] = pow ((gdouble) i / (gdouble) n_max, ovals.exponent);
         }
     }
 
-  n_regions = 0;
-  regions[n_regions++] = &dest_rgn;
-  if (use_msmap)
-    regions[n_regions++] = &mask_size_map_rgn;
-  if (use_emap)
-    regions[n_regions++] = &exponent_map_rgn;
+  dest_buf = g_new (guchar, width * height * bpp);
+
+  context.width         = width;
+  context.height        = height;
+  context.bpp           = bpp;
+  context.src_buf       = src_buf;
+  context.src_inten_buf = src_inten_buf;
+  context.msmap_buf     = msmap_buf;
+  context.emap_buf      = emap_buf;
+  context.weights       = weights;
+  context.dest_buf      = dest_buf;
+
+  n_threads   = g_get_num_processors ();
+  band_height = MAX (16, context.max_radius * 2);
+  band_height = MIN (band_height, (height + n_threads - 1) / n_threads);
+  band_height = MAX (band_height, 1);
+  n_bands     = (height + band_height - 1) / band_height;
+
+  bands = g_new0 (OilifyBand, n_bands);
+  pool  = g_thread_pool_new ((GFunc) oilify_band, NULL,
+                             n_threads, FALSE, NULL);
+
+  for (i = 0; i < n_bands; i++)
+    {
+      bands[i].context = &context;
+      bands[i].y1      = i * band_height;
+      bands[i].y2      = MIN ((i + 1) * band_height, height);
 
-  for (pr = gimp_pixel_rgns_register2 (n_regions, regions);
-       pr != NULL;
-       pr = gimp_pixel_rgns_process (pr))
+      g_thread_pool_push (pool, &bands[i], NULL);
+    }
+
+  for (i = 0; i < n_bands; i++)
     {
-      gint    y;
-      guchar *dest_row;
-      guchar *src_msmap_row = NULL;
-      guchar *src_emap_row = NULL;
-
-      for (y = dest_rgn.y,
-           dest_row = dest_rgn.data,
-           src_msmap_row = mask_size_map_rgn.data,  /* valid iff use_msmap */
-           src_emap_row = exponent_map_rgn.data     /* valid iff use_emap */
-           ;
-           y < (gint) (dest_rgn.y + dest_rgn.h)
-           ;
-           y++,
-           dest_row += dest_rgn.rowstride,
-           src_msmap_row += mask_size_map_rgn.rowstride,  /* valid iff use_msmap */
-           src_emap_row += exponent_map_rgn.rowstride)    /* valid iff use_emap */
+      g_mutex_lock (&band_mutex);
+      while (! bands[i].done)
+        g_cond_wait (&band_cond, &band_mutex);
+      g_mutex_unlock (&band_mutex);
+
+      if (! preview)
+        gimp_progress_update ((gdouble) bands[i].y2 / (gdouble) height);
+    }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+  g_free (bands);
+
+  if (preview)
+    {
+      gimp_preview_draw_buffer (preview, dest_buf, width * bpp);
+    }
+  else
+    {
+      GimpPixelRgn dest_rgn;
+
+      gimp_pixel_rgn_init (&dest_rgn, drawable,
+                           x1, y1, width, height, TRUE, TRUE);
+      gimp_pixel_rgn_set_rect (&dest_rgn, dest_buf, x1, y1, width, height);
+
+      gimp_progress_update (1.0);
+      /*  Update the oil-painted region  */
+      gimp_drawable_flush (drawable);
+      gimp_drawable_merge_shadow (drawable->drawable_id, TRUE);
+      gimp_drawable_update (drawable->drawable_id, x1, y1, width, height);
+    }
+
+  g_free (dest_buf);
+  g_free (weights);
+  g_free (emap_buf);
+  g_free (msmap_buf);
+  g_free (src_inten_buf);
+  g_free (src_buf);
+}
+
+static inline void
+oilify_hist_add (const OilifyContext *context,
+                 gint                 hist[HISTSIZE],
+                 gint                 hist_rgb[4][HISTSIZE],
+                 gint                 offset,
+                 gint                 delta)
+{
+  const guchar *src = context->src_buf + offset * context->bpp;
+  gint          b;
+
+  if (context->src_inten_buf)
+    {
+      gint inten = context->src_inten_buf[offset];
+
+      hist[inten] += delta;
+      for (b = 0; b < context->bpp; b++)
+        hist_rgb[b][inten] += delta * src[b];
+    }
+  else
+    {
+      for (b = 0; b < context->bpp; b++)
+        hist_rgb[b][src[b]] += delta;
+    }
+}
+
+/*
+ * Filters the rows of one band.  Along each row the histograms of the
+ * circular mask are updated incrementally, by the pixels that enter
+ * and leave the circle's edge, as long as the radius stays the same.
+ */
+static void
+oilify_band (OilifyBand *band,
+             gpointer    data)
+{
+  const OilifyContext *context = band->context;
+  const gint           width   = context->width;
+  const gint           height  = context->height;
+  const gint           bpp     = context->bpp;
+  gint                 Hist[HISTSIZE];
+  gint                 Hist_rgb[4][HISTSIZE];
+  gint                *half_width;
+  gint                 hist_radius = -1;
+  gint                 y;
+
+  /*  half_width[dy + radius] is the half width of the circle at row dy  */
+  half_width = g_new (gint, 2 * context->max_radius + 1);
+
+  for (y = band->y1; y < band->y2; y++)
+    {
+      gboolean valid = FALSE;
+      gint     x;
+
+      for (x = 0; x < width; x++)
         {
-          gint    x;
-          guchar *dest;
-          guchar *src_msmap = NULL;
-          guchar *src_emap = NULL;
-
-          for (x = dest_rgn.x,
-               dest = dest_row,
-               src_msmap = src_msmap_row,  /* valid iff use_msmap */
-               src_emap = src_emap_row     /* valid iff use_emap */
-               ;
-               x < (gint) (dest_rgn.x + dest_rgn.w)
-               ;
-               x++,
-               dest += bpp,
-               src_msmap += msmap_bpp,  /* valid iff use_msmap */
-               src_emap += emap_bpp)    /* valid iff use_emap */
+          const gint  offset = x + y * width;
+          guchar     *dest   = context->dest_buf + offset * bpp;
+          gint        radius;
+          gfloat      exponent;
+          gint        dy;
+
+          if (context->msmap_buf)
             {
-              gint    radius, radius_squared;
-              gfloat  exponent;
-              gint    mask_x1, mask_y1;
-              gint    mask_x2, mask_y2;
-              gint    mask_y;
-              gint    src_offset;
-              guchar *src_row;
-              guchar *src_inten_row = NULL;
-
-              if (use_msmap)
-                {
-                  gfloat factor = get_map_value (src_msmap, msmap_bpp);
+              gfloat factor =
+                get_map_value (context->msmap_buf + offset * context->msmap_bpp,
+                               context->msmap_bpp);
 
-                  radius = ROUND (factor * (0.5 * ovals.mask_size));
-                }
-              else
+              radius = ROUND (factor * (0.5 * ovals.mask_size));
+            }
+          else
+            {
+              radius = (gint) ovals.mask_size / 2;
+            }
+
+          radius = MIN (radius, context->max_radius);
+
+          exponent = ovals.exponent;
+          if (context->emap_buf)
+            exponent *= get_map_value (context->emap_buf +
+                                       offset * context->emap_bpp,
+                                       context->emap_bpp);
+
+          if (radius != hist_radius)
+            {
+              for (dy = -radius; dy <= radius; dy++)
                 {
-                  radius = (gint) ovals.mask_size / 2;
-                }
+                  gint dx = 0;
+
+                  while (SQR (dx + 1) + SQR (dy) <= SQR (radius))
+                    dx++;
 
-              radius_squared = SQR (radius);
+                  half_width[dy + radius] = dx;
+                }
 
-              exponent = ovals.exponent;
-              if (use_emap)
-                exponent *= get_map_value (src_emap, emap_bpp);
+              hist_radius = radius;
+              valid       = FALSE;
+            }
 
-              if (use_inten)
+          if (! valid)
+            {
+              /*  collect the whole circle  */
+              if (context->src_inten_buf)
                 memset (Hist, 0, sizeof (Hist));
 
               memset (Hist_rgb, 0, sizeof (Hist_rgb));
 
-              mask_x1 = CLAMP ((x - radius), x1, x2);
-              mask_y1 = CLAMP ((y - radius), y1, y2);
-              mask_x2 = CLAMP ((x + radius + 1), x1, x2);
-              mask_y2 = CLAMP ((y + radius + 1), y1, y2);
-
-              src_offset = (mask_y1 - y1) * width + (mask_x1 - x1);
-
-              for (mask_y = mask_y1,
-                   src_row = src_buf + src_offset * bpp,
-                   src_inten_row = src_inten_buf + src_offset  /* valid iff use_inten */
-                   ;
-                   mask_y < mask_y2
-                   ;
-                   mask_y++,
-                   src_row += width * bpp,
-                   src_inten_row += width)  /* valid iff use_inten */
+              for (dy = -radius; dy <= radius; dy++)
                 {
-                  guchar *src;
-                  guchar *src_inten = NULL;
-                  gint    dy_squared = sqr_lut[ABS (mask_y - y)];
-                  gint    mask_x;
-
-                  for (mask_x = mask_x1,
-                       src = src_row,
-                       src_inten = src_inten_row  /* valid iff use_inten */
-                       ;
-                       mask_x < mask_x2
-                       ;
-                       mask_x++,
-                       src += bpp,
-                       src_inten++)  /* valid iff use_inten */
+                  const gint yy = y + dy;
+                  gint       xx;
+
+                  if (yy < 0 || yy >= height)
+                    continue;
+
+                  for (xx = MAX (0, x - half_width[dy + radius]);
+                       xx <= MIN (width - 1, x + half_width[dy + radius]);
+                       xx++)
                     {
-                      gint dx_squared = sqr_lut[ABS (mask_x - x)];
-                      gint b;
-
-                      /*  Stay inside a circular mask area  */
-                      if ((dx_squared + dy_squared) > radius_squared)
-                        continue;
-
-                      if (use_inten)
-                        {
-                          gint inten = *src_inten;
-                          ++Hist[inten];
-                          for (b = 0; b < bpp; b++)
-                            Hist_rgb[b][inten] += src[b];
-                        }
-                      else
-                        {
-                          for (b = 0; b < bpp; b++)
-                            ++Hist_rgb[b][src[b]];
-                        }
-
-                    } /* for mask_x */
-                } /* for mask_y */
-
-              if (use_inten)
-                {
-                  weighted_average_color (Hist, Hist_rgb, exponent, dest, bpp);
+                      oilify_hist_add (context, Hist, Hist_rgb,
+                                       xx + yy * width, 1);
+                    }
                 }
-              else
+
+              valid = TRUE;
+            }
+          else
+            {
+              /*  move the circle one pixel to the right  */
+              for (dy = -radius; dy <= radius; dy++)
                 {
-                  gint b;
+                  const gint yy = y + dy;
+                  const gint hw = half_width[dy + radius];
 
-                  for (b = 0; b < bpp; b++)
-                    dest[b] = weighted_average_value (Hist_rgb[b], exponent);
-                }
+                  if (yy < 0 || yy >= height)
+                    continue;
 
-            } /* for x */
-        } /* for y */
+                  if (x - hw - 1 >= 0)
+                    oilify_hist_add (context, Hist, Hist_rgb,
+                                     (x - hw - 1) + yy * width, -1);
 
-      if (preview)
-        {
-          gimp_drawable_preview_draw_region (GIMP_DRAWABLE_PREVIEW (preview),
-                                             &dest_rgn);
-        }
-      else
-        {
-          progress += dest_rgn.w * dest_rgn.h;
-          gimp_progress_update ((gdouble) progress / (gdouble) max_progress);
-        }
-    } /* for pr */
-
-  /*  Detach from the map drawables  */
-  if (mask_size_map_drawable)
-    gimp_drawable_detach (mask_size_map_drawable);
+                  if (x + hw < width)
+                    oilify_hist_add (context, Hist, Hist_rgb,
+                                     (x + hw) + yy * width, 1);
+                }
+            }
 
-  if (exponent_map_drawable)
-    gimp_drawable_detach (exponent_map_drawable);
+          if (context->src_inten_buf)
+            {
+              if (context->weights)
+                weighted_average_color_lut (Hist, Hist_rgb,
+                                            context->weights, dest, bpp);
+              else
+                weighted_average_color (Hist, Hist_rgb, exponent, dest, bpp);
+            }
+          else
+            {
+              gint b;
 
-  if (src_inten_buf)
-    g_free (src_inten_buf);
+              for (b = 0; b < bpp; b++)
+                {
+                  if (context->weights)
+                    dest[b] = weighted_average_value_lut (Hist_rgb[b],
+                                                          context->weights);
+                  else
+                    dest[b] = weighted_average_value (Hist_rgb[b], exponent);
+                }
+            }
+        }
+    }
 
-  g_free (src_buf);
-  g_free (sqr_lut);
+  g_free (half_width);
 
-  if (!preview)
-    {
-      gimp_progress_update (1.0);
-      /*  Update the oil-painted region  */
-      gimp_drawable_flush (drawable);
-      gimp_drawable_merge_shadow (drawable->drawable_id, TRUE);
-      gimp_drawable_update (drawable->drawable_id, x1, y1, width, height);
-    }
+  g_mutex_lock (&band_mutex);
+  band->done = TRUE;
+  g_cond_broadcast (&band_cond);
+  g_mutex_unlock (&band_mutex);
 }
 
 /*
@@ -1,17 +1,17 @@
 %plugins = (
     'align-layers' => { ui => 1 },
-    'animation-optimize' => {},
+    'animation-optimize' => { gegl => 1 },
     'animation-play' => { ui => 1, gegl => 1 },
     'antialias' => {},
     'apply-canvas' => { ui => 1 },
     'blinds' => { ui => 1 },
     'blur' => {},
-    'blur-gauss' => { ui => 1 },
+    'blur-gauss' => { ui => 1, gegl => 1 },
     'blur-gauss-selective' => { ui => 1, cflags => 'MMX_EXTRA_CFLAGS' },
     'border-average' => { ui => 1, gegl => 1 },
     'bump-map' => { ui => 1 },
     'cartoon' => { ui => 1 },
-    'channel-mixer' => { ui => 1 },
+    'channel-mixer' => { ui => 1, gegl => 1 },
     'checkerboard' => { ui => 1 },
     'cml-explorer' => { ui => 1 },
     'color-cube-analyze' => { ui => 1 },
@@ -24,7 +24,7 @@
     'contrast-retinex' => { ui => 1 },
     'contrast-stretch' => {},
     'contrast-stretch-hsv' => {},
-    'convolution-matrix' => { ui => 1 },
+    'convolution-matrix' => { ui => 1, gegl => 1 },
     'crop-zealous' => {},
     'curve-bend' => { ui => 1 },
     'decompose' => { ui => 1, gegl => 1 },
@@ -67,7 +67,7 @@
     'file-psp' => { ui => 1, gegl => 1, optional => 1, libs => 'Z_LIBS' },
     'file-raw' => { ui => 1 },
     'file-sunras' => { ui => 1 },
-    'file-svg' => { ui => 1, optional => 1, libs => 'SVG_LIBS', cflags => 'SVG_CFLAGS' },
+    'file-svg' => { ui => 1, gegl => 1, optional => 1, libs => 'SVG_LIBS', cflags => 'SVG_CFLAGS' },
     'file-tga' => { ui => 1, gegl => 1 },
     'file-tiff-load' => { ui => 1, gegl => 1, optional => 1, libs => 'TIFF_LIBS' },
     'file-tiff-save' => { ui => 1, gegl => 1, optional => 1, libs => 'TIFF_LIBS' },
@@ -106,7 +106,7 @@
     'plugin-browser' => { ui => 1 },
     'procedure-browser' => { ui => 1 },
     'qbist' => { ui => 1 },
-    'ripple' => { ui => 1 },
+    'ripple' => { ui => 1, gegl => 1 },
     'rotate' => {},
     'sample-colorize' => { ui => 1 },
     'screenshot' => { ui => 1, optional => 1, libs => 'SCREENSHOT_LIBS', cflags => 'XFIXES_CFLAGS', gegl => 1 },
@@ -124,7 +124,7 @@
     'unit-editor' => { ui => 1 },
     'unsharp-mask' => { ui => 1 },
     'value-propagate' => { ui => 1 },
-    'van-gogh-lic' => { ui => 1 },
+    'van-gogh-lic' => { ui => 1, gegl => 1 },
     'video' => { ui => 1 },
     'warp' => { ui => 1 },
     'web-browser' => { ui => 1 },
@@ -22,8 +22,6 @@
 
 #include "config.h"
 
-#include <string.h>
-
 #include <libgimp/gimp.h>
 #include <libgimp/gimpui.h>
 
@@ -36,7 +34,6 @@
 #define PLUG_IN_ROLE    "gimp-ripple"
 
 #define SCALE_WIDTH     200
-#define TILE_CACHE_SIZE  16
 
 #define SMEAR 0
 #define WRAP  1
@@ -73,11 +70,6 @@ static void      ripple             (GimpDrawable     *drawable,
 static gboolean  ripple_dialog      (GimpDrawable     *drawable);
 
 static gdouble   displace_amount    (gint              location);
-static void      average_two_pixels (guchar           *dest,
-                                     guchar            pixels[4][4],
-                                     gdouble           x,
-                                     gint              bpp,
-                                     gboolean          has_alpha);
 
 /***** Local vars *****/
 
@@ -101,6 +93,8 @@ static RippleValues rvals =
   0                            /* phase shift */
 };
 
+static GimpDistort *distort = NULL;
+
 /***** Functions *****/
 
 MAIN ()
@@ -152,13 +146,11 @@ run (const gchar      *name,
   run_mode = param[0].data.d_int32;
 
   INIT_I18N ();
+  gegl_init (NULL, NULL);
 
   /*  Get the specified drawable  */
   drawable = gimp_drawable_get (param[2].data.d_drawable);
 
-  /*  set the tile cache size  */
-  gimp_tile_cache_ntiles (TILE_CACHE_SIZE);
-
   *nreturn_vals = 1;
   *return_vals  = values;
 
@@ -241,162 +233,50 @@ run (const gchar      *name,
 
   values[0].data.d_status = status;
 
+  if (distort)
+    {
+      gimp_distort_free (distort);
+      distort = NULL;
+    }
+
   gimp_drawable_detach (drawable);
 }
 
-typedef struct
-{
-  GimpPixelFetcher *pft;
-  gint              width;
-  gint              height;
-  gboolean          has_alpha;
-} RippleParam_t;
-
 static void
 ripple_vertical (gint      x,
                  gint      y,
-                 guchar   *dest,
-                 gint      bpp,
+                 gdouble  *src_x,
+                 gdouble  *src_y,
                  gpointer  data)
 {
-  RippleParam_t    *param  = data;
-  GimpPixelFetcher *pft    = param->pft;
-  const gint        height = param->height;
-  guchar            pixel[2][4];
-  gdouble           needy;
-  gint              yi, yi_a;
-
-  needy = y + displace_amount (x);
-  yi = floor (needy);
-  yi_a = yi + 1;
-
-  if (rvals.edges == WRAP)
-    {
-      /* Tile the image. */
-
-      needy = fmod (needy, height);
-
-      if (needy < 0.0)
-        needy += height;
-
-      yi = yi % height;
-
-      if (yi < 0)
-        yi += height;
-
-      yi_a = yi_a % height;
-    }
-  else if (rvals.edges == SMEAR)
-    {
-      /* Smear out the edges of the image by repeating pixels. */
-
-      needy = CLAMP (needy, 0, height - 1);
-      yi    = CLAMP (yi,    0, height - 1);
-      yi_a  = CLAMP (yi_a,  0, height - 1);
-    }
-
-  if (rvals.antialias)
-    {
-      if (yi >= 0 && yi < height)
-        gimp_pixel_fetcher_get_pixel (pft, x, yi  , pixel[0]);
-      else
-        memset (pixel[0], 0, 4);
-
-      if (yi_a >= 0 && yi_a < height)
-        gimp_pixel_fetcher_get_pixel (pft, x, yi_a, pixel[1]);
-      else
-        memset (pixel[1], 0, 4);
-
-      average_two_pixels (dest, pixel, needy - yi, bpp, param->has_alpha);
-    }
-  else
-    {
-      if (yi >= 0 && yi < height)
-        gimp_pixel_fetcher_get_pixel (pft, x, yi, dest);
-      else
-        memset (dest, 0, bpp);
-    }
+  *src_x = x;
+  *src_y = y + displace_amount (x);
 }
 
 static void
 ripple_horizontal (gint      x,
                    gint      y,
-                   guchar   *dest,
-                   gint      bpp,
+                   gdouble  *src_x,
+                   gdouble  *src_y,
                    gpointer  data)
 {
-  RippleParam_t    *param = data;
-  GimpPixelFetcher *pft   = param->pft;
-  const gint        width = param->width;
-  guchar            pixel[2][4];
-  gdouble           needx;
-  gint              xi, xi_a;
-
-  needx = x + displace_amount (y);
-  xi = floor (needx);
-  xi_a = xi + 1;
-
-  if (rvals.edges == WRAP)
-    {
-      /* Tile the image. */
-
-      needx = fmod (needx, width);
-
-      while (needx < 0.0)
-        needx += width;
-
-      xi = (xi % width);
-
-      while (xi < 0)
-        xi += width;
-
-      xi_a = (xi+1) % width;
-    }
-  else if (rvals.edges == SMEAR)
-    {
-      /* Smear out the edges of the image by repeating pixels. */
-
-      needx = CLAMP (needx, 0, width - 1);
-      xi    = CLAMP (xi,    0, width - 1);
-      xi_a  = CLAMP (xi_a,  0, width - 1);
-    }
-
-  if (rvals.antialias)
-    {
-      if (xi >= 0 && xi < width)
-        gimp_pixel_fetcher_get_pixel (pft, xi,   y, pixel[0]);
-      else
-        memset (pixel[0], 0, 4);
-
-      if (xi_a >= 0 && xi_a < width)
-        gimp_pixel_fetcher_get_pixel (pft, xi_a, y, pixel[1]);
-      else
-        memset (pixel[1], 0, 4);
-
-      average_two_pixels (dest, pixel, needx - xi, bpp, param->has_alpha);
-    }
-
-  else
-    {
-      if (xi >= 0 && xi < width)
-        gimp_pixel_fetcher_get_pixel (pft, xi, y, dest);
-      else
-        memset (dest, 0, bpp);
-    }
+  *src_x = x + displace_amount (y);
+  *src_y = y;
 }
 
 static void
 ripple (GimpDrawable *drawable,
         GimpPreview  *preview)
 {
-  RippleParam_t param;
-  gint          edges;
-  gint          period;
+  GimpDistortFunc func;
+  gint            width  = drawable->width;
+  gint            height = drawable->height;
+  gint            edges;
+  gint            period;
 
-  param.pft       = gimp_pixel_fetcher_new (drawable, FALSE);
-  param.has_alpha = gimp_drawable_has_alpha (drawable->drawable_id);
-  param.width     = drawable->width;
-  param.height    = drawable->height;
+  /*  keep the copy of the source around for the next preview  */
+  if (! distort)
+    distort = gimp_distort_new (drawable->drawable_id);
 
   edges  = rvals.edges;
   period = rvals.period;
@@ -404,58 +284,85 @@ ripple (GimpDrawable *drawable,
   if (rvals.tile)
     {
       rvals.edges = WRAP;
-      rvals.period = (param.width / (param.width / rvals.period) *
+      rvals.period = (width / (width / rvals.period) *
                       (rvals.orientation == GIMP_ORIENTATION_HORIZONTAL) +
-                      param.height / (param.height / rvals.period) *
+                      height / (height / rvals.period) *
                       (rvals.orientation == GIMP_ORIENTATION_VERTICAL));
     }
 
+  gimp_distort_set_interpolation (distort,
+                                  rvals.antialias ?
+                                  GEGL_SAMPLER_LINEAR : GEGL_SAMPLER_NEAREST);
+
+  switch (rvals.edges)
+    {
+    case SMEAR:
+      /* Smear out the edges of the image by repeating pixels. */
+      gimp_distort_set_abyss_policy (distort, GEGL_ABYSS_CLAMP);
+      break;
+
+    case WRAP:
+      /* Tile the image. */
+      gimp_distort_set_abyss_policy (distort, GEGL_ABYSS_LOOP);
+      break;
+
+    case BLANK:
+      gimp_distort_set_abyss_policy (distort, GEGL_ABYSS_NONE);
+      break;
+    }
+
+  if (rvals.orientation == GIMP_ORIENTATION_VERTICAL)
+    func = ripple_vertical;
+  else
+    func = ripple_horizontal;
+
   if (preview)
     {
-      guchar *buffer, *d;
-      gint    bpp = gimp_drawable_bpp (drawable->drawable_id);
-      gint    width, height;
-      gint    x, y;
-      gint    x1, y1;
+      const Babl *format;
+      guchar     *buffer;
+      gint        x1, y1;
+
+      switch (gimp_drawable_type (drawable->drawable_id))
+        {
+        case GIMP_RGB_IMAGE:
+          format = babl_format ("R'G'B' u8");
+          break;
+
+        case GIMP_RGBA_IMAGE:
+          format = babl_format ("R'G'B'A u8");
+          break;
+
+        case GIMP_GRAY_IMAGE:
+          format = babl_format ("Y' u8");
+          break;
+
+        case GIMP_GRAYA_IMAGE:
+        default:
+          format = babl_format ("Y'A u8");
+          break;
+        }
 
       gimp_preview_get_position (preview, &x1, &y1);
       gimp_preview_get_size (preview, &width, &height);
 
-      d = buffer = g_new (guchar, width * height * bpp);
+      buffer = g_new (guchar,
+                      width * height * babl_format_get_bytes_per_pixel (format));
 
-      for (y = 0; y < height ; y++)
-        for (x = 0; x < width ; x++)
-          {
-            if (rvals.orientation == GIMP_ORIENTATION_VERTICAL)
-              ripple_vertical (x1 + x, y1 + y, d, bpp, &param);
-            else
-              ripple_horizontal (x1 + x, y1 + y, d, bpp, &param);
+      gimp_distort_render (distort, GEGL_RECTANGLE (x1, y1, width, height),
+                           format, buffer, GEGL_AUTO_ROWSTRIDE,
+                           func, NULL);
 
-            d += bpp;
-          }
-
-      gimp_preview_draw_buffer (preview, buffer, width * bpp);
+      gimp_preview_draw_buffer (preview, buffer,
+                                width * babl_format_get_bytes_per_pixel (format));
       g_free (buffer);
     }
   else
     {
-      GimpRgnIterator *iter;
-
-      iter = gimp_rgn_iterator_new (drawable, 0);
-
-      gimp_rgn_iterator_dest (iter,
-                              rvals.orientation == GIMP_ORIENTATION_VERTICAL ?
-                              ripple_vertical :
-                              ripple_horizontal,
-                              &param);
-
-      gimp_rgn_iterator_free (iter);
+      gimp_distort_apply (distort, func, NULL, TRUE);
     }
 
   rvals.edges  = edges;
   rvals.period = period;
-
-  gimp_pixel_fetcher_destroy (param.pft);
 }
 
 static gboolean
@@ -681,38 +588,6 @@ ripple_dialog (GimpDrawable *drawable)
   return run;
 }
 
-static void
-average_two_pixels (guchar   *dest,
-                    guchar    pixels[4][4],
-                    gdouble   x,
-                    gint      bpp,
-                    gboolean  has_alpha)
-{
-  gint b;
-
-  /* x = x - floor(x); */
-
-  if (has_alpha)
-    {
-      gdouble xa0 = pixels[0][bpp-1] * (1.0 - x);
-      gdouble xa1 = pixels[1][bpp-1] * x;
-      gdouble alpha;
-
-      alpha = xa0 + xa1;
-
-      if (alpha)
-        for (b = 0; b < bpp-1; b++)
-          dest[b] = (xa0 * pixels[0][b] + xa1 * pixels[1][b]) / alpha;
-
-      dest[bpp-1] = alpha;
-    }
-  else
-    {
-      for (b = 0; b < bpp; b++)
-        dest[b] = (1.0 - x) * pixels[0][b] + x * pixels[1][b];
-    }
-}
-
 static gdouble
 displace_amount (gint location)
 {
@@ -97,33 +97,38 @@ static gint    border_x1, border_y1, border_x2, border_y2;
 
 static GtkWidget *dialog;
 
-/************************/
-/* Convenience routines */
-/************************/
+/*  The pixels of the selection bounds, and the scalar field of the
+ *  effect image, kept around for the preview
+ */
+static gfloat  *source_pixels       = NULL;
+static guchar  *scalarfield         = NULL;
+static gint32   scalarfield_image   = -1;
+static gint     scalarfield_channel = -1;
 
-static void
-peek (GimpPixelRgn *src_rgn,
-      gint          x,
-      gint          y,
-      GimpRGB      *color)
+typedef struct
 {
-  static guchar data[4] = { 0, };
-
-  gimp_pixel_rgn_get_pixel (src_rgn, data, x, y);
-  gimp_rgba_set_uchar (color, data[0], data[1], data[2], data[3]);
-}
+  const gfloat  *src;       /* the selection bounds, R'G'B'A float       */
+  gint           width;
+  gint           height;
+  GeglRectangle  rect;      /* the part to render, relative to the above */
+  const gfloat  *field;     /* the normalized vectors in rect            */
+  gfloat        *dest;      /* the rendered pixels of rect               */
+} LicContext;
 
-static void
-poke (GimpPixelRgn *dest_rgn,
-      gint          x,
-      gint          y,
-      GimpRGB      *color)
+typedef struct
 {
-  static guchar data[4];
+  const LicContext *context;
+  gint              y1;
+  gint              y2;     /* Rows y1 to y2 - 1 of rect */
+  gboolean          done;
+} LicBand;
 
-  gimp_rgba_get_uchar (color, &data[0], &data[1], &data[2], &data[3]);
-  gimp_pixel_rgn_set_pixel (dest_rgn, data, x, y);
-}
+static GMutex band_mutex;
+static GCond  band_cond;
+
+/************************/
+/* Convenience routines */
+/************************/
 
 static gint
 peekmap (const guchar *image,
@@ -326,18 +331,26 @@ lic_noise (gint    x,
   return i;
 }
 
-static void
-getpixel (GimpPixelRgn *src_rgn,
-          GimpRGB      *p,
-          gdouble       u,
-          gdouble       v)
+static inline const gfloat *
+peek (const LicContext *context,
+      gint              x,
+      gint              y)
 {
-  register gint x1, y1, x2, y2;
-  gint width, height;
-  static GimpRGB pp[4];
+  return context->src + (y * context->width + x) * 4;
+}
 
-  width = src_rgn->w;
-  height = src_rgn->h;
+static void
+getpixel (const LicContext *context,
+          gfloat           *p,
+          gdouble           u,
+          gdouble           v)
+{
+  const gint    width  = context->width;
+  const gint    height = context->height;
+  const gfloat *pp[4];
+  gint          x1, y1, x2, y2;
+  gdouble       x, y, ix, iy;
+  gint          b;
 
   x1 = (gint)u;
   y1 = (gint)v;
@@ -355,30 +368,70 @@ getpixel (GimpPixelRgn *src_rgn,
   x2 = (x1 + 1) % width;
   y2 = (y1 + 1) % height;
 
-  peek (src_rgn, x1, y1, &pp[0]);
-  peek (src_rgn, x2, y1, &pp[1]);
-  peek (src_rgn, x1, y2, &pp[2]);
-  peek (src_rgn, x2, y2, &pp[3]);
+  pp[0] = peek (context, x1, y1);
+  pp[1] = peek (context, x2, y1);
+  pp[2] = peek (context, x1, y2);
+  pp[3] = peek (context, x2, y2);
+
+  /*  the same weights as gimp_bilinear_rgb() and gimp_bilinear_rgba()  */
+  x = fmod (u, 1.0);
+  y = fmod (v, 1.0);
+
+  if (x < 0)
+    x += 1.0;
+  if (y < 0)
+    y += 1.0;
+
+  ix = 1.0 - x;
+  iy = 1.0 - y;
 
   if (source_drw_has_alpha)
-    *p = gimp_bilinear_rgba (u, v, pp);
+    {
+      gdouble w0 = ix * iy * pp[0][3];
+      gdouble w1 = x  * iy * pp[1][3];
+      gdouble w2 = ix * y  * pp[2][3];
+      gdouble w3 = x  * y  * pp[3][3];
+      gdouble alpha = w0 + w1 + w2 + w3;
+
+      if (alpha > 0)
+        {
+          for (b = 0; b < 3; b++)
+            p[b] = (w0 * pp[0][b] + w1 * pp[1][b] +
+                    w2 * pp[2][b] + w3 * pp[3][b]) / alpha;
+        }
+      else
+        {
+          p[0] = p[1] = p[2] = 0.0;
+        }
+
+      p[3] = alpha;
+    }
   else
-    *p = gimp_bilinear_rgb (u, v, pp);
+    {
+      for (b = 0; b < 3; b++)
+        p[b] = (iy * (ix * pp[0][b] + x * pp[1][b]) +
+                y  * (ix * pp[2][b] + x * pp[3][b]));
+
+      p[3] = 1.0;
+    }
 }
 
 static void
-lic_image (GimpPixelRgn *src_rgn,
-           gint          x,
-           gint          y,
-           gdouble       vx,
-           gdouble       vy,
-           GimpRGB      *color)
+lic_image (const LicContext *context,
+           gint              x,
+           gint              y,
+           gdouble           vx,
+           gdouble           vy,
+           gfloat           *color)
 {
   gdouble u, step = 2.0 * l / isteps;
   gdouble xx = (gdouble) x, yy = (gdouble) y;
   gdouble c, s;
-  GimpRGB col = { 0, 0, 0, 0 };
-  GimpRGB col1, col2, col3;
+  gdouble col[4] = { 0, 0, 0, 0 };
+  gfloat  col1[4], col2[4];
+  gdouble f1, f2;
+  gint    n_channels = source_drw_has_alpha ? 4 : 3;
+  gint    b;
 
   /* Get vector at x,y */
   /* ================= */
@@ -389,129 +442,106 @@ lic_image (GimpPixelRgn *src_rgn,
   /* Calculate integral numerically */
   /* ============================== */
 
-  getpixel (src_rgn, &col1, xx + l * c, yy + l * s);
-  if (source_drw_has_alpha)
-    gimp_rgba_multiply (&col1, filter (-l));
-  else
-    gimp_rgb_multiply (&col1, filter (-l));
+  getpixel (context, col1, xx + l * c, yy + l * s);
+  f1 = filter (-l);
 
   for (u = -l + step; u <= l; u += step)
     {
-      getpixel (src_rgn, &col2, xx - u * c, yy - u * s);
-      if (source_drw_has_alpha)
-        {
-          gimp_rgba_multiply (&col2, filter (u));
+      getpixel (context, col2, xx - u * c, yy - u * s);
+      f2 = filter (u);
 
-          col3 = col1;
-          gimp_rgba_add (&col3, &col2);
-          gimp_rgba_multiply (&col3, 0.5 * step);
-          gimp_rgba_add (&col, &col3);
-        }
-      else
+      for (b = 0; b < n_channels; b++)
         {
-          gimp_rgb_multiply (&col2, filter (u));
-
-          col3 = col1;
-          gimp_rgb_add (&col3, &col2);
-          gimp_rgb_multiply (&col3, 0.5 * step);
-          gimp_rgb_add (&col, &col3);
+          col[b] += (f1 * col1[b] + f2 * col2[b]) * 0.5 * step;
+          col1[b] = col2[b];
         }
-      col1 = col2;
+
+      f1 = f2;
     }
-  if (source_drw_has_alpha)
-    gimp_rgba_multiply (&col, 1.0 / l);
-  else
-    gimp_rgb_multiply (&col, 1.0 / l);
-  gimp_rgb_clamp (&col);
 
-  *color = col;
+  for (b = 0; b < n_channels; b++)
+    color[b] = CLAMP (col[b] / l, 0.0, 1.0);
+
+  if (! source_drw_has_alpha)
+    color[3] = 1.0;
 }
 
-static guchar*
-rgb_to_hsl (GimpDrawable     *drawable,
+static guchar *
+rgb_to_hsl (gint32            effect_id,
             LICEffectChannel  effect_channel)
 {
-  guchar       *themap, data[4];
-  gint          x, y;
+  GeglBuffer   *buffer;
+  guchar       *pixels;
+  guchar       *themap;
+  const guchar *data;
   GimpRGB       color;
   GimpHSL       color_hsl;
   gdouble       val = 0.0;
-  glong         maxc, index = 0;
-  GimpPixelRgn  region;
+  glong         maxc, index;
   GRand        *gr;
 
   gr = g_rand_new ();
 
-  maxc = drawable->width * drawable->height;
+  maxc = effect_width * effect_height;
 
-  gimp_pixel_rgn_init (&region, drawable, border_x1, border_y1,
-                       border_x2 - border_x1, border_y2 - border_y1, FALSE, FALSE);
+  buffer = gimp_drawable_get_buffer (effect_id);
+  pixels = g_new (guchar, maxc * 4);
+
+  gegl_buffer_get (buffer, GEGL_RECTANGLE (0, 0, effect_width, effect_height),
+                   1.0, babl_format ("R'G'B'A u8"), pixels,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  g_object_unref (buffer);
 
   themap = g_new (guchar, maxc);
 
-  for (y = 0; y < region.h; y++)
+  for (index = 0, data = pixels; index < maxc; index++, data += 4)
     {
-      for (x = 0; x < region.w; x++)
-        {
-          data[3] = 255;
+      gimp_rgba_set_uchar (&color, data[0], data[1], data[2], data[3]);
+      gimp_rgb_to_hsl (&color, &color_hsl);
 
-          gimp_pixel_rgn_get_pixel (&region, data, x, y);
-          gimp_rgba_set_uchar (&color, data[0], data[1], data[2], data[3]);
-          gimp_rgb_to_hsl (&color, &color_hsl);
-
-          switch (effect_channel)
-            {
-            case LIC_HUE:
-              val = color_hsl.h * 255;
-              break;
-            case LIC_SATURATION:
-              val = color_hsl.s * 255;
-              break;
-            case LIC_BRIGHTNESS:
-              val = color_hsl.l * 255;
-              break;
-            }
+      switch (effect_channel)
+        {
+        case LIC_HUE:
+          val = color_hsl.h * 255;
+          break;
+        case LIC_SATURATION:
+          val = color_hsl.s * 255;
+          break;
+        case LIC_BRIGHTNESS:
+          val = color_hsl.l * 255;
+          break;
+        }
 
-          /* add some random to avoid unstructured areas. */
-          val += g_rand_double_range (gr, -1.0, 1.0);
+      /* add some random to avoid unstructured areas. */
+      val += g_rand_double_range (gr, -1.0, 1.0);
 
-          themap[index++] = (guchar) CLAMP0255 (RINT (val));
-        }
+      themap[index] = (guchar) CLAMP0255 (RINT (val));
     }
 
+  g_free (pixels);
   g_rand_free (gr);
 
   return themap;
 }
 
+/* Precomputes the normalized derivative of the scalar field in rect */
+/* ================================================================= */
 
-static void
-compute_lic (GimpDrawable *drawable,
-             const guchar *scalarfield,
-             gboolean      rotate)
+static gfloat *
+compute_field (const guchar        *scalarfield,
+               const GeglRectangle *rect,
+               gboolean             rotate)
 {
-  gint xcount, ycount;
-  GimpRGB color;
-  gdouble vx, vy, tmp;
-  GimpPixelRgn src_rgn, dest_rgn;
-
-  gimp_pixel_rgn_init (&src_rgn, drawable,
-                       border_x1, border_y1,
-                       border_x2 - border_x1,
-                       border_y2 - border_y1, FALSE, FALSE);
-
-  gimp_pixel_rgn_init (&dest_rgn, drawable,
-                       border_x1, border_y1,
-                       border_x2 - border_x1,
-                       border_y2 - border_y1, TRUE, TRUE);
-
-  for (ycount = 0; ycount < src_rgn.h; ycount++)
+  gfloat  *field = g_new (gfloat, rect->width * rect->height * 2);
+  gfloat  *f     = field;
+  gint     xcount, ycount;
+  gdouble  vx, vy, tmp;
+
+  for (ycount = rect->y; ycount < rect->y + rect->height; ycount++)
     {
-      for (xcount = 0; xcount < src_rgn.w; xcount++)
+      for (xcount = rect->x; xcount < rect->x + rect->width; xcount++)
         {
-          /* Get derivative at (x,y) and normalize it */
-          /* ============================================================== */
-
           vx = gradx (scalarfield, xcount, ycount);
           vy = grady (scalarfield, xcount, ycount);
 
@@ -531,43 +561,126 @@ compute_lic (GimpDrawable *drawable,
               vy *= tmp;
             }
 
+          *f++ = vx;
+          *f++ = vy;
+        }
+    }
+
+  return field;
+}
+
+static void
+lic_band (LicBand  *band,
+          gpointer  data)
+{
+  const LicContext *context = band->context;
+  gint              xcount, ycount;
+
+  for (ycount = band->y1; ycount < band->y2; ycount++)
+    {
+      const gint    y     = context->rect.y + ycount;
+      const gfloat *field = context->field + ycount * context->rect.width * 2;
+      gfloat       *dest  = context->dest  + ycount * context->rect.width * 4;
+
+      for (xcount = 0; xcount < context->rect.width; xcount++)
+        {
+          const gint x  = context->rect.x + xcount;
+          gdouble    vx = field[0];
+          gdouble    vy = field[1];
+
           /* Convolve with the LIC at (x,y) */
           /* ============================== */
 
           if (licvals.effect_convolve == 0)
             {
-              peek (&src_rgn, xcount, ycount, &color);
-              tmp = lic_noise (xcount, ycount, vx, vy);
-              if (source_drw_has_alpha)
-                gimp_rgba_multiply (&color, tmp);
-              else
-                gimp_rgb_multiply (&color, tmp);
+              const gfloat *color = peek (context, x, y);
+              gdouble       tmp   = lic_noise (x, y, vx, vy);
+
+              dest[0] = color[0] * tmp;
+              dest[1] = color[1] * tmp;
+              dest[2] = color[2] * tmp;
+              dest[3] = source_drw_has_alpha ? color[3] * tmp : 1.0;
             }
           else
             {
-              lic_image (&src_rgn, xcount, ycount, vx, vy, &color);
+              lic_image (context, x, y, vx, vy, dest);
             }
-          poke (&dest_rgn, xcount, ycount, &color);
-        }
 
-      gimp_progress_update ((gfloat) ycount / (gfloat) src_rgn.h);
+          field += 2;
+          dest  += 4;
+        }
     }
-  gimp_progress_update (1.0);
+
+  g_mutex_lock (&band_mutex);
+  band->done = TRUE;
+  g_cond_broadcast (&band_cond);
+  g_mutex_unlock (&band_mutex);
 }
 
+/* Renders rect of the filtered selection bounds into dest, filtering */
+/* bands of rows in several threads                                   */
+/* ================================================================== */
+
 static void
-compute_image (GimpDrawable *drawable)
+compute_lic (const GeglRectangle *rect,
+             gfloat              *dest,
+             gboolean             show_progress)
 {
-  GimpDrawable *effect;
-  guchar       *scalarfield = NULL;
+  LicContext   context;
+  LicBand     *bands;
+  GThreadPool *pool;
+  gint         n_threads;
+  gint         n_bands;
+  gint         band_height;
+  gint         i;
+
+  context.src    = source_pixels;
+  context.width  = border_x2 - border_x1;
+  context.height = border_y2 - border_y1;
+  context.rect   = *rect;
+  context.field  = compute_field (scalarfield, rect, licvals.effect_operator);
+  context.dest   = dest;
+
+  n_threads   = g_get_num_processors ();
+  band_height = MAX (1, MIN (16, rect->height / (4 * n_threads)));
+  n_bands     = (rect->height + band_height - 1) / band_height;
+
+  bands = g_new0 (LicBand, n_bands);
+  pool  = g_thread_pool_new ((GFunc) lic_band, NULL,
+                             n_threads, FALSE, NULL);
+
+  for (i = 0; i < n_bands; i++)
+    {
+      bands[i].context = &context;
+      bands[i].y1      = i * band_height;
+      bands[i].y2      = MIN ((i + 1) * band_height, rect->height);
 
-  /* Get some useful info on the input drawable */
-  /* ========================================== */
-  gimp_drawable_mask_bounds (drawable->drawable_id,
-                             &border_x1, &border_y1, &border_x2, &border_y2);
+      g_thread_pool_push (pool, &bands[i], NULL);
+    }
 
-  gimp_progress_init (_("Van Gogh (LIC)"));
+  for (i = 0; i < n_bands; i++)
+    {
+      g_mutex_lock (&band_mutex);
+      while (! bands[i].done)
+        g_cond_wait (&band_cond, &band_mutex);
+      g_mutex_unlock (&band_mutex);
+
+      if (show_progress)
+        gimp_progress_update ((gdouble) bands[i].y2 / rect->height);
+    }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+  g_free (bands);
+
+  g_free ((gfloat *) context.field);
+}
+
+/* Reads the source and the effect image, unless done before */
+/* ========================================================= */
 
+static void
+prepare_image (GimpDrawable *drawable)
+{
   if (licvals.effect_convolve == 0)
     generatevectors ();
 
@@ -580,34 +693,95 @@ compute_image (GimpDrawable *drawable)
   maxv = licvals.maxv / 10.0;
   isteps = licvals.intsteps;
 
-  source_drw_has_alpha = gimp_drawable_has_alpha (drawable->drawable_id);
+  if (! source_pixels)
+    {
+      GeglBuffer *buffer;
+
+      gimp_drawable_mask_bounds (drawable->drawable_id,
+                                 &border_x1, &border_y1,
+                                 &border_x2, &border_y2);
+
+      source_drw_has_alpha = gimp_drawable_has_alpha (drawable->drawable_id);
 
-  effect = gimp_drawable_get (licvals.effect_image_id);
+      source_pixels = g_new (gfloat, ((border_x2 - border_x1) *
+                                      (border_y2 - border_y1) * 4));
 
-  effect_width = effect->width;
-  effect_height = effect->height;
+      buffer = gimp_drawable_get_buffer (drawable->drawable_id);
 
-  switch (licvals.effect_channel)
+      gegl_buffer_get (buffer,
+                       GEGL_RECTANGLE (border_x1, border_y1,
+                                       border_x2 - border_x1,
+                                       border_y2 - border_y1),
+                       1.0, babl_format ("R'G'B'A float"), source_pixels,
+                       GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+      g_object_unref (buffer);
+    }
+
+  if (! scalarfield                                 ||
+      scalarfield_image   != licvals.effect_image_id ||
+      scalarfield_channel != licvals.effect_channel)
     {
-      case 0:
-        scalarfield = rgb_to_hsl (effect, LIC_HUE);
-        break;
-      case 1:
-        scalarfield = rgb_to_hsl (effect, LIC_SATURATION);
-        break;
-      case 2:
-        scalarfield = rgb_to_hsl (effect, LIC_BRIGHTNESS);
-        break;
+      g_free (scalarfield);
+
+      effect_width  = gimp_drawable_width (licvals.effect_image_id);
+      effect_height = gimp_drawable_height (licvals.effect_image_id);
+
+      switch (licvals.effect_channel)
+        {
+          case 0:
+            scalarfield = rgb_to_hsl (licvals.effect_image_id, LIC_HUE);
+            break;
+          case 1:
+            scalarfield = rgb_to_hsl (licvals.effect_image_id, LIC_SATURATION);
+            break;
+          case 2:
+          default:
+            scalarfield = rgb_to_hsl (licvals.effect_image_id, LIC_BRIGHTNESS);
+            break;
+        }
+
+      scalarfield_image   = licvals.effect_image_id;
+      scalarfield_channel = licvals.effect_channel;
     }
+}
 
-  compute_lic (drawable, scalarfield, licvals.effect_operator);
+static void
+compute_image (GimpDrawable *drawable)
+{
+  GeglBuffer    *shadow;
+  GeglRectangle  rect;
+  gfloat        *dest;
 
-  g_free (scalarfield);
+  gimp_progress_init (_("Van Gogh (LIC)"));
+
+  prepare_image (drawable);
+
+  rect.x      = 0;
+  rect.y      = 0;
+  rect.width  = border_x2 - border_x1;
+  rect.height = border_y2 - border_y1;
+
+  dest = g_new (gfloat, rect.width * rect.height * 4);
+
+  compute_lic (&rect, dest, TRUE);
+
+  shadow = gimp_drawable_get_shadow_buffer (drawable->drawable_id);
+
+  gegl_buffer_set (shadow,
+                   GEGL_RECTANGLE (border_x1, border_y1,
+                                   rect.width, rect.height), 0,
+                   babl_format ("R'G'B'A float"), dest,
+                   GEGL_AUTO_ROWSTRIDE);
+
+  g_object_unref (shadow);
+  g_free (dest);
+
+  gimp_progress_update (1.0);
 
   /* Update image */
   /* ============ */
 
-  gimp_drawable_flush (drawable);
   gimp_drawable_merge_shadow (drawable->drawable_id, TRUE);
   gimp_drawable_update (drawable->drawable_id, border_x1, border_y1,
                         border_x2 - border_x1, border_y2 - border_y1);
@@ -615,6 +789,55 @@ compute_image (GimpDrawable *drawable)
   gimp_displays_flush ();
 }
 
+/* Filters only the visible part of the preview */
+/* ============================================ */
+
+static void
+compute_preview (GimpDrawable *drawable,
+                 GimpPreview  *preview)
+{
+  GeglRectangle  rect;
+  const Babl    *format;
+  gfloat        *dest;
+  guchar        *buffer;
+  gint           x, y;
+  gint           width, height;
+
+  prepare_image (drawable);
+
+  gimp_preview_get_position (preview, &x, &y);
+  gimp_preview_get_size (preview, &width, &height);
+
+  rect.x      = CLAMP (x - border_x1, 0, border_x2 - border_x1);
+  rect.y      = CLAMP (y - border_y1, 0, border_y2 - border_y1);
+  rect.width  = MIN (width,  border_x2 - border_x1 - rect.x);
+  rect.height = MIN (height, border_y2 - border_y1 - rect.y);
+
+  if (rect.width < 1 || rect.height < 1)
+    return;
+
+  if (source_drw_has_alpha)
+    format = babl_format ("R'G'B'A u8");
+  else
+    format = babl_format ("R'G'B' u8");
+
+  dest   = g_new (gfloat, rect.width * rect.height * 4);
+  buffer = g_new (guchar, (rect.width * rect.height *
+                           babl_format_get_bytes_per_pixel (format)));
+
+  compute_lic (&rect, dest, FALSE);
+
+  babl_process (babl_fish (babl_format ("R'G'B'A float"), format),
+                dest, buffer, rect.width * rect.height);
+
+  gimp_preview_draw_buffer (preview, buffer,
+                            rect.width *
+                            babl_format_get_bytes_per_pixel (format));
+
+  g_free (buffer);
+  g_free (dest);
+}
+
 /**************************/
 /* Below is only UI stuff */
 /**************************/
@@ -628,15 +851,18 @@ effect_image_constrain (gint32    image_id,
 }
 
 static gboolean
-create_main_dialog (void)
+create_main_dialog (GimpDrawable *drawable)
 {
   GtkWidget *vbox;
   GtkWidget *hbox;
+  GtkWidget *preview;
   GtkWidget *frame;
   GtkWidget *table;
   GtkWidget *combo;
+  GtkWidget *buttons[7];
   GtkObject *scale_data;
   gint       row;
+  gint       i;
   gboolean   run;
 
   gimp_ui_init (PLUG_IN_BINARY, TRUE);
@@ -663,6 +889,14 @@ create_main_dialog (void)
                       vbox, TRUE, TRUE, 0);
   gtk_widget_show (vbox);
 
+  preview = gimp_drawable_preview_new (drawable, NULL);
+  gtk_box_pack_start (GTK_BOX (vbox), preview, TRUE, TRUE, 0);
+  gtk_widget_show (preview);
+
+  g_signal_connect_swapped (preview, "invalidated",
+                            G_CALLBACK (compute_preview),
+                            drawable);
+
   hbox = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 12);
   gtk_box_pack_start (GTK_BOX (vbox), hbox, FALSE, FALSE, 0);
   gtk_widget_show (hbox);
@@ -672,9 +906,9 @@ create_main_dialog (void)
                                     &licvals.effect_channel,
                                     licvals.effect_channel,
 
-                                    _("_Hue"),        0, NULL,
-                                    _("_Saturation"), 1, NULL,
-                                    _("_Brightness"), 2, NULL,
+                                    _("_Hue"),        0, &buttons[0],
+                                    _("_Saturation"), 1, &buttons[1],
+                                    _("_Brightness"), 2, &buttons[2],
 
                                     NULL);
   gtk_box_pack_start (GTK_BOX (hbox), frame, FALSE, FALSE, 0);
@@ -685,8 +919,8 @@ create_main_dialog (void)
                                     &licvals.effect_operator,
                                     licvals.effect_operator,
 
-                                    _("_Derivative"), 0, NULL,
-                                    _("_Gradient"),   1, NULL,
+                                    _("_Derivative"), 0, &buttons[3],
+                                    _("_Gradient"),   1, &buttons[4],
 
                                     NULL);
   gtk_box_pack_start (GTK_BOX (hbox), frame, FALSE, FALSE, 0);
@@ -697,13 +931,18 @@ create_main_dialog (void)
                                     &licvals.effect_convolve,
                                     licvals.effect_convolve,
 
-                                    _("_With white noise"),  0, NULL,
-                                    _("W_ith source image"), 1, NULL,
+                                    _("_With white noise"),  0, &buttons[5],
+                                    _("W_ith source image"), 1, &buttons[6],
 
                                     NULL);
   gtk_box_pack_start (GTK_BOX (hbox), frame, FALSE, FALSE, 0);
   gtk_widget_show (frame);
 
+  for (i = 0; i < G_N_ELEMENTS (buttons); i++)
+    g_signal_connect_swapped (buttons[i], "toggled",
+                              G_CALLBACK (gimp_preview_invalidate),
+                              preview);
+
   /* Effect image menu */
   table = gtk_table_new (1, 2, FALSE);
   gtk_table_set_col_spacings (GTK_TABLE (table), 6);
@@ -715,6 +954,9 @@ create_main_dialog (void)
                               licvals.effect_image_id,
                               G_CALLBACK (gimp_int_combo_box_get_active),
                               &licvals.effect_image_id);
+  g_signal_connect_swapped (combo, "changed",
+                            G_CALLBACK (gimp_preview_invalidate),
+                            preview);
 
   gimp_table_attach_aligned (GTK_TABLE (table), 0, 0,
                              _("_Effect image:"), 0.0, 0.5, combo, 2, TRUE);
@@ -735,6 +977,9 @@ create_main_dialog (void)
   g_signal_connect (scale_data, "value-changed",
                     G_CALLBACK (gimp_double_adjustment_update),
                     &licvals.filtlen);
+  g_signal_connect_swapped (scale_data, "value-changed",
+                            G_CALLBACK (gimp_preview_invalidate),
+                            preview);
 
   scale_data = gimp_scale_entry_new (GTK_TABLE (table), 0, row++,
                                      _("_Noise magnitude:"), 0, 6,
@@ -744,6 +989,9 @@ create_main_dialog (void)
   g_signal_connect (scale_data, "value-changed",
                     G_CALLBACK (gimp_double_adjustment_update),
                     &licvals.noisemag);
+  g_signal_connect_swapped (scale_data, "value-changed",
+                            G_CALLBACK (gimp_preview_invalidate),
+                            preview);
 
   scale_data = gimp_scale_entry_new (GTK_TABLE (table), 0, row++,
                                      _("In_tegration steps:"), 0, 6,
@@ -753,6 +1001,9 @@ create_main_dialog (void)
   g_signal_connect (scale_data, "value-changed",
                     G_CALLBACK (gimp_double_adjustment_update),
                     &licvals.intsteps);
+  g_signal_connect_swapped (scale_data, "value-changed",
+                            G_CALLBACK (gimp_preview_invalidate),
+                            preview);
 
   scale_data = gimp_scale_entry_new (GTK_TABLE (table), 0, row++,
                                      _("_Minimum value:"), 0, 6,
@@ -762,6 +1013,9 @@ create_main_dialog (void)
   g_signal_connect (scale_data, "value-changed",
                     G_CALLBACK (gimp_double_adjustment_update),
                     &licvals.minv);
+  g_signal_connect_swapped (scale_data, "value-changed",
+                            G_CALLBACK (gimp_preview_invalidate),
+                            preview);
 
   scale_data = gimp_scale_entry_new (GTK_TABLE (table), 0, row++,
                                      _("M_aximum value:"), 0, 6,
@@ -771,6 +1025,9 @@ create_main_dialog (void)
   g_signal_connect (scale_data, "value-changed",
                     G_CALLBACK (gimp_double_adjustment_update),
                     &licvals.maxv);
+  g_signal_connect_swapped (scale_data, "value-changed",
+                            G_CALLBACK (gimp_preview_invalidate),
+                            preview);
 
   gtk_widget_show (dialog);
 
@@ -839,6 +1096,7 @@ run (const gchar      *name,
   run_mode = param[0].data.d_int32;
 
   INIT_I18N ();
+  gegl_init (NULL, NULL);
 
   *nreturn_vals = 1;
   *return_vals  = values;
@@ -868,15 +1126,10 @@ run (const gchar      *name,
 
       if (gimp_drawable_is_rgb (drawable->drawable_id))
         {
-          /* Set the tile cache size */
-          /* ======================= */
-
-          gimp_tile_cache_ntiles (2*(drawable->width / gimp_tile_width () + 1));
-
           switch (run_mode)
             {
               case GIMP_RUN_INTERACTIVE:
-                if (create_main_dialog ())
+                if (create_main_dialog (drawable))
                   compute_image (drawable);
 
                 gimp_set_data (PLUG_IN_PROC, &licvals, sizeof (LicValues));
@@ -893,6 +1146,10 @@ run (const gchar      *name,
     }
 
   values[0].data.d_status = status;
+
+  g_free (source_pixels);
+  g_free (scalarfield);
+
   gimp_drawable_detach (drawable);
 }
 
@@ -93,6 +93,15 @@
 #include <lzma.h>
 
 
+/* The multi-threaded xz encoder was added in liblzma 5.2.0.  Each
+ * thread compresses its own block and needs memory for it, so don't
+ * use too many.
+ */
+#if LZMA_VERSION >= 50020002
+#define XZ_MAX_THREADS 4
+#endif
+
+
 /* Author 1: Josh MacDonald (url.c)          */
 /* Author 2: Daniel Risacher (gz.c)          */
 /* Author 3: Michael Natterer (compressor.c) */
@@ -906,10 +915,23 @@ xz_save (const char *infile,
   if (!out)
     goto out;
 
+#ifdef XZ_MAX_THREADS
+  {
+    lzma_mt mt = { 0, };
+
+    mt.threads = CLAMP (g_get_num_processors (), 1, XZ_MAX_THREADS);
+    mt.preset  = LZMA_PRESET_DEFAULT;
+    mt.check   = LZMA_CHECK_CRC64;
+
+    if (lzma_stream_encoder_mt (&strm, &mt) != LZMA_OK)
+      goto out;
+  }
+#else
   if (lzma_easy_encoder (&strm,
                          LZMA_PRESET_DEFAULT,
                          LZMA_CHECK_CRC64) != LZMA_OK)
     goto out;
+#endif
 
   strm.next_in = NULL;
   strm.avail_in = 0;
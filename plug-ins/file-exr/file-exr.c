@@ -25,6 +25,7 @@
 #include "openexr-wrapper.h"
 
 #define LOAD_PROC          "file-exr-load"
+#define LOAD_THUMB_PROC    "file-exr-load-thumb"
 #define PLUG_IN_BINARY     "file-exr"
 #define PLUG_IN_ROLE       "gimp-file-exr"
 #define PLUG_IN_VERSION    "0.0.0"
@@ -42,6 +43,9 @@ static void     run         (const gchar      *name,
 
 static gint32    load_image (const gchar      *filename,
                              gboolean          interactive,
+                             gint              size,
+                             gint             *full_width,
+                             gint             *full_height,
                              GError          **error);
 /*
  * Some global variables.
@@ -72,6 +76,20 @@ query (void)
     { GIMP_PDB_IMAGE, "image", "Output image" }
   };
 
+  static const GimpParamDef thumb_args[] =
+  {
+    { GIMP_PDB_STRING, "filename",     "The name of the file to load"  },
+    { GIMP_PDB_INT32,  "thumb-size",   "Preferred thumbnail size"      }
+  };
+  static const GimpParamDef thumb_return_vals[] =
+  {
+    { GIMP_PDB_IMAGE,  "image",        "Thumbnail image"               },
+    { GIMP_PDB_INT32,  "image-width",  "Width of full-sized image"     },
+    { GIMP_PDB_INT32,  "image-height", "Height of full-sized image"    },
+    { GIMP_PDB_INT32,  "image-type",   "Type of the image"             },
+    { GIMP_PDB_INT32,  "num-layers",   "Number of layers"              }
+  };
+
   gimp_install_procedure (LOAD_PROC,
                           "Loads files in the OpenEXR file format",
                           "This plug-in loads OpenEXR files. ",
@@ -90,6 +108,26 @@ query (void)
   gimp_register_file_handler_mime (LOAD_PROC, "image/x-exr");
   gimp_register_magic_load_handler (LOAD_PROC,
                                     "exr", "", "0,lelong,20000630");
+
+  gimp_install_procedure (LOAD_THUMB_PROC,
+                          "Loads a thumbnail from an OpenEXR image",
+                          "Loads the smallest mipmap level of a tiled "
+                          "OpenEXR image that is at least thumb-size "
+                          "large, or the full image if it has no "
+                          "mipmap levels",
+                          "Dominik Ernst <dernst@gmx.de>, "
+                          "Mukund Sivaraman <muks@banu.com>",
+                          "Dominik Ernst <dernst@gmx.de>, "
+                          "Mukund Sivaraman <muks@banu.com>",
+                          PLUG_IN_VERSION,
+                          NULL,
+                          NULL,
+                          GIMP_PLUGIN,
+                          G_N_ELEMENTS (thumb_args),
+                          G_N_ELEMENTS (thumb_return_vals),
+                          thumb_args, thumb_return_vals);
+
+  gimp_register_thumbnail_loader (LOAD_PROC, LOAD_THUMB_PROC);
 }
 
 static void
@@ -99,7 +137,7 @@ run (const gchar      *name,
      gint             *nreturn_vals,
      GimpParam       **return_vals)
 {
-  static GimpParam  values[2];
+  static GimpParam  values[6];
   GimpRunMode       run_mode;
   GimpPDBStatusType status = GIMP_PDB_SUCCESS;
   gint32            image_ID;
@@ -108,6 +146,8 @@ run (const gchar      *name,
   INIT_I18N ();
   gegl_init (NULL, NULL);
 
+  exr_set_n_threads (g_get_num_processors ());
+
   *nreturn_vals = 1;
   *return_vals  = values;
 
@@ -119,7 +159,8 @@ run (const gchar      *name,
       run_mode = param[0].data.d_int32;
 
       image_ID = load_image (param[1].data.d_string,
-                             run_mode == GIMP_RUN_INTERACTIVE, &error);
+                             run_mode == GIMP_RUN_INTERACTIVE,
+                             0, NULL, NULL, &error);
 
       if (image_ID != -1)
         {
@@ -132,6 +173,35 @@ run (const gchar      *name,
           status = GIMP_PDB_EXECUTION_ERROR;
         }
     }
+  else if (strcmp (name, LOAD_THUMB_PROC) == 0)
+    {
+      gint width  = 0;
+      gint height = 0;
+
+      image_ID = load_image (param[0].data.d_string, FALSE,
+                             param[1].data.d_int32, &width, &height,
+                             &error);
+
+      if (image_ID != -1)
+        {
+          *nreturn_vals = 6;
+          values[1].type         = GIMP_PDB_IMAGE;
+          values[1].data.d_image = image_ID;
+          values[2].type         = GIMP_PDB_INT32;
+          values[2].data.d_int32 = width;
+          values[3].type         = GIMP_PDB_INT32;
+          values[3].data.d_int32 = height;
+          values[4].type         = GIMP_PDB_INT32;
+          values[4].data.d_int32 =
+            gimp_drawable_type (gimp_image_get_active_drawable (image_ID));
+          values[5].type         = GIMP_PDB_INT32;
+          values[5].data.d_int32 = 1;
+        }
+      else
+        {
+          status = GIMP_PDB_EXECUTION_ERROR;
+        }
+    }
   else
     {
       status = GIMP_PDB_CALLING_ERROR;
@@ -147,9 +217,16 @@ run (const gchar      *name,
   values[0].data.d_status = status;
 }
 
+/*  When size is not 0, loads the smallest mipmap level that is at
+ *  least that large and returns the size of the full image in
+ *  full_width and full_height.
+ */
 static gint32
 load_image (const gchar  *filename,
             gboolean      interactive,
+            gint          size,
+            gint         *full_width,
+            gint         *full_height,
             GError      **error)
 {
   gint32 status = -1;
@@ -166,6 +243,7 @@ load_image (const gchar  *filename,
   GeglBuffer *buffer = NULL;
   int bpp;
   int tile_height;
+  int block_height;
   gchar *pixels = NULL;
   int begin;
   int end;
@@ -182,6 +260,26 @@ load_image (const gchar  *filename,
 
   width = exr_loader_get_width (loader);
   height = exr_loader_get_height (loader);
+
+  if (size > 0)
+    {
+      if (full_width)
+        *full_width = width;
+      if (full_height)
+        *full_height = height;
+
+      if (exr_loader_select_level (loader, size) < 0)
+        {
+          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                       _("Error reading pixel data from '%s'"),
+                       gimp_filename_to_utf8 (filename));
+          goto out;
+        }
+
+      width = exr_loader_get_width (loader);
+      height = exr_loader_get_height (loader);
+    }
+
   if ((width < 1) || (height < 1))
     {
       g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
@@ -250,28 +348,35 @@ load_image (const gchar  *filename,
   format = gimp_drawable_get_format (layer);
   bpp = babl_format_get_bytes_per_pixel (format);
 
+  /* Read whole compressed blocks, or rows of tiles, at a time, and
+   * enough blocks of a scanline file to keep OpenEXR's threads busy.
+   */
+  block_height = MAX (exr_loader_get_block_height (loader), 1);
   tile_height = gimp_tile_height ();
-  pixels = g_new0 (gchar, tile_height * width * bpp);
+
+  if (! exr_loader_is_tiled (loader))
+    tile_height = MAX (tile_height,
+                       block_height * (gint) g_get_num_processors ());
+
+  tile_height = MIN (((tile_height + block_height - 1) / block_height) *
+                     block_height, height);
+
+  pixels = g_new0 (gchar, (gsize) tile_height * width * bpp);
 
   for (begin = 0; begin < height; begin += tile_height)
     {
       int retval;
-      int i;
+
       end = MIN (begin + tile_height, height);
       num = end - begin;
 
-      for (i = 0; i < num; i++)
+      retval = exr_loader_read_pixel_rows (loader, pixels, bpp, begin, num);
+      if (retval < 0)
         {
-          retval = exr_loader_read_pixel_row (loader,
-                                              pixels + (i * width * bpp),
-                                              bpp, begin + i);
-          if (retval < 0)
-            {
-              g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
-                           _("Error reading pixel data from '%s'"),
-                           gimp_filename_to_utf8 (filename));
-              goto out;
-            }
+          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                       _("Error reading pixel data from '%s'"),
+                       gimp_filename_to_utf8 (filename));
+          goto out;
         }
 
       gegl_buffer_set (buffer, GEGL_RECTANGLE (0, begin, width, num),
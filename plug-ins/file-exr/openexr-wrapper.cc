@@ -3,11 +3,15 @@
 #include "openexr-wrapper.h"
 
 #include <ImfInputFile.h>
+#include <ImfTiledInputFile.h>
 #include <ImfChannelList.h>
 #include <ImfRgbaFile.h>
 #include <ImfRgbaYca.h>
 #include <ImfStandardAttributes.h>
+#include <ImfThreading.h>
 
+#include <algorithm>
+#include <cstddef>
 #include <string>
 
 using namespace Imf;
@@ -18,9 +22,13 @@ struct _EXRLoader
 {
   _EXRLoader(const char* filename) :
     refcount_(1),
+    filename_(filename),
     file_(filename),
     data_window_(file_.header().dataWindow()),
-    channels_(file_.header().channels())
+    channels_(file_.header().channels()),
+    tiled_(NULL),
+    level_(0),
+    level_window_(data_window_)
   {
     const Channel* chan;
 
@@ -89,50 +97,124 @@ struct _EXRLoader
       }
   }
 
-  int readPixelRow(char* pixels,
-                   int bpp,
-                   int row)
+  ~_EXRLoader()
   {
-    const int actual_row = data_window_.min.y + row;
+    delete tiled_;
+  }
+
+  // Reads num rows starting at row.  For tiled files, row must be at
+  // the top of a row of tiles and num must cover whole rows of tiles,
+  // except at the bottom of the image.
+  int readPixelRows(char* pixels,
+                    int bpp,
+                    int row,
+                    int num)
+  {
+    const int actual_row = level_window_.min.y + row;
+    const size_t stride = (size_t) bpp * getWidth();
     FrameBuffer fb;
     // This is necessary because OpenEXR expects the buffer to begin at
     // (0, 0). Though it probably results in some unmapped address,
     // hopefully OpenEXR will not make use of it. :/
-    char* base = pixels - (data_window_.min.x * bpp);
+    char* base = pixels - ((ptrdiff_t) level_window_.min.x * bpp)
+                        - ((ptrdiff_t) actual_row * (ptrdiff_t) stride);
 
     switch (image_type_)
       {
       case IMAGE_TYPE_GRAY:
-        fb.insert("Y", Slice(pt_, base, bpp, 0, 1, 1, 0.5));
+        fb.insert("Y", Slice(pt_, base, bpp, stride, 1, 1, 0.5));
         if (hasAlpha())
           {
-            fb.insert("A", Slice(pt_, base + bpc_, bpp, 0, 1, 1, 1.0));
+            fb.insert("A", Slice(pt_, base + bpc_, bpp, stride, 1, 1, 1.0));
           }
         break;
 
       case IMAGE_TYPE_RGB:
       default:
-        fb.insert("R", Slice(pt_, base + (bpc_ * 0), bpp, 0, 1, 1, 0.0));
-        fb.insert("G", Slice(pt_, base + (bpc_ * 1), bpp, 0, 1, 1, 0.0));
-        fb.insert("B", Slice(pt_, base + (bpc_ * 2), bpp, 0, 1, 1, 0.0));
+        fb.insert("R", Slice(pt_, base + (bpc_ * 0), bpp, stride, 1, 1, 0.0));
+        fb.insert("G", Slice(pt_, base + (bpc_ * 1), bpp, stride, 1, 1, 0.0));
+        fb.insert("B", Slice(pt_, base + (bpc_ * 2), bpp, stride, 1, 1, 0.0));
         if (hasAlpha())
           {
-            fb.insert("A", Slice(pt_, base + (bpc_ * 3), bpp, 0, 1, 1, 1.0));
+            fb.insert("A", Slice(pt_, base + (bpc_ * 3), bpp, stride, 1, 1, 1.0));
           }
       }
 
-    file_.setFrameBuffer(fb);
-    file_.readPixels(actual_row);
+    if (tiled_)
+      {
+        const int tile_height = tiled_->tileYSize();
+
+        tiled_->setFrameBuffer(fb);
+        tiled_->readTiles(0, tiled_->numXTiles(level_) - 1,
+                          row / tile_height, (row + num - 1) / tile_height,
+                          level_, level_);
+      }
+    else
+      {
+        // Reading all rows at once lets OpenEXR decompress the
+        // line buffers in its thread pool.
+        file_.setFrameBuffer(fb);
+        file_.readPixels(actual_row, actual_row + num - 1);
+      }
 
     return 0;
   }
 
+  // Selects the smallest mipmap level that is at least size pixels
+  // large, returns the selected level.
+  int selectLevel(int size)
+  {
+    if (! file_.header().hasTileDescription() ||
+        file_.header().tileDescription().mode == ONE_LEVEL)
+      return 0;
+
+    if (! tiled_)
+      tiled_ = new TiledInputFile(filename_.c_str());
+
+    int level = std::min(tiled_->numXLevels(), tiled_->numYLevels()) - 1;
+
+    while (level > 0 &&
+           std::max(tiled_->levelWidth(level),
+                    tiled_->levelHeight(level)) < size)
+      {
+        level--;
+      }
+
+    level_ = level;
+    level_window_ = tiled_->dataWindowForLevel(level, level);
+
+    return level_;
+  }
+
+  int getBlockHeight() const {
+    if (file_.header().hasTileDescription())
+      return file_.header().tileDescription().ySize;
+
+    // The number of scanlines OpenEXR compresses together.
+    switch (file_.header().compression())
+      {
+      case ZIP_COMPRESSION:
+      case PXR24_COMPRESSION:
+        return 16;
+      case PIZ_COMPRESSION:
+      case B44_COMPRESSION:
+      case B44A_COMPRESSION:
+        return 32;
+      default:
+        return 1;
+      }
+  }
+
+  int isTiled() const {
+    return file_.header().hasTileDescription() ? 1 : 0;
+  }
+
   int getWidth() const {
-    return data_window_.max.x - data_window_.min.x + 1;
+    return level_window_.max.x - level_window_.min.x + 1;
   }
 
   int getHeight() const {
-    return data_window_.max.y - data_window_.min.y + 1;
+    return level_window_.max.y - level_window_.min.y + 1;
   }
 
   EXRPrecision getPrecision() const {
@@ -163,9 +245,13 @@ struct _EXRLoader
   }
 
   size_t refcount_;
+  std::string filename_;
   InputFile file_;
   const Box2i data_window_;
   const ChannelList& channels_;
+  TiledInputFile* tiled_;
+  int level_;
+  Box2i level_window_;
   PixelType pt_;
   int bpc_;
   EXRImageType image_type_;
@@ -173,6 +259,19 @@ struct _EXRLoader
   std::string format_string_;
 };
 
+void
+exr_set_n_threads (int n_threads)
+{
+  // Don't let any exceptions propagate to the C layer.
+  try
+    {
+      setGlobalThreadCount(n_threads);
+    }
+  catch (...)
+    {
+    }
+}
+
 EXRLoader*
 exr_loader_new (const char *filename)
 {
@@ -263,16 +362,49 @@ exr_loader_has_alpha (EXRLoader *loader)
 }
 
 int
-exr_loader_read_pixel_row (EXRLoader *loader,
-                           char *pixels,
-                           int bpp,
-                           int row)
+exr_loader_is_tiled (EXRLoader *loader)
+{
+  // This does not throw.
+  return loader->isTiled();
+}
+
+int
+exr_loader_get_block_height (EXRLoader *loader)
+{
+  // This does not throw.
+  return loader->getBlockHeight();
+}
+
+int
+exr_loader_select_level (EXRLoader *loader,
+                         int size)
+{
+  int level;
+  // Don't let any exceptions propagate to the C layer.
+  try
+    {
+      level = loader->selectLevel(size);
+    }
+  catch (...)
+    {
+      level = -1;
+    }
+
+  return level;
+}
+
+int
+exr_loader_read_pixel_rows (EXRLoader *loader,
+                            char *pixels,
+                            int bpp,
+                            int row,
+                            int num)
 {
   int retval = -1;
   // Don't let any exceptions propagate to the C layer.
   try
     {
-      retval = loader->readPixelRow(pixels, bpp, row);
+      retval = loader->readPixelRows(pixels, bpp, row, num);
     }
   catch (...)
     {
@@ -24,6 +24,12 @@ typedef enum {
   IMAGE_TYPE_GRAY
 } EXRImageType;
 
+/* Sets the number of threads OpenEXR uses for decompression, for
+ * all loaders.
+ */
+void
+exr_set_n_threads (int n_threads);
+
 EXRLoader *
 exr_loader_new (const char *filename);
 
@@ -49,10 +55,25 @@ int
 exr_loader_has_alpha (EXRLoader *loader);
 
 int
-exr_loader_read_pixel_row (EXRLoader *loader,
-                           char *pixels,
-                           int bpp,
-                           int row);
+exr_loader_is_tiled (EXRLoader *loader);
+
+int
+exr_loader_get_block_height (EXRLoader *loader);
+
+/* Makes the loader read the smallest mipmap level of a tiled file
+ * that is at least size pixels large, the width and height are then
+ * those of the level.  Returns the level, or -1 on error.
+ */
+int
+exr_loader_select_level (EXRLoader *loader,
+                         int size);
+
+int
+exr_loader_read_pixel_rows (EXRLoader *loader,
+                            char *pixels,
+                            int bpp,
+                            int row,
+                            int num);
 
 #ifdef __cplusplus
 }
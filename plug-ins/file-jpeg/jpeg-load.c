@@ -43,6 +43,7 @@
 #include "jpeg-icc.h"
 #include "jpeg-settings.h"
 #include "jpeg-load.h"
+#include "jpeg-parallel.h"
 #ifdef HAVE_LIBEXIF
 #include "jpeg-exif.h"
 #include "gimpexif.h"
@@ -419,39 +420,51 @@ load_image (const gchar  *filename,
   buffer = gimp_drawable_get_buffer (layer_ID);
   format = babl_format (image_type == GIMP_RGB ? "R'G'B' u8" : "Y' u8");
 
-  while (cinfo.output_scanline < cinfo.output_height)
+  /* Step 6.1: decode baseline images with restart markers in stripes,
+   * in several threads, if possible.
+   */
+  if (jpeg_parallel_load_supported (&cinfo) &&
+      jpeg_parallel_load (&cinfo, filename, buffer, format, ! preview))
     {
-      start = cinfo.output_scanline;
-      end   = cinfo.output_scanline + tile_height;
-      end   = MIN (end, cinfo.output_height);
-
-      scanlines = end - start;
-
-      for (i = 0; i < scanlines; i++)
-        jpeg_read_scanlines (&cinfo, (JSAMPARRAY) &rowbuf[i], 1);
-
-      if (cinfo.out_color_space == JCS_CMYK)
-        jpeg_load_cmyk_to_rgb (buf, cinfo.output_width * scanlines,
-                               cmyk_transform);
-
-      gegl_buffer_set (buffer,
-                       GEGL_RECTANGLE (0, start, cinfo.output_width, scanlines),
-                       0,
-                       format,
-                       buf,
-                       GEGL_AUTO_ROWSTRIDE);
-
-      if (! preview && (cinfo.output_scanline % 32) == 0)
-        gimp_progress_update ((gdouble) cinfo.output_scanline /
-                              (gdouble) cinfo.output_height);
+      /* the stripes were decoded on their own, skip the scan */
+      jpeg_abort_decompress (&cinfo);
     }
+  else
+    {
+      while (cinfo.output_scanline < cinfo.output_height)
+        {
+          start = cinfo.output_scanline;
+          end   = cinfo.output_scanline + tile_height;
+          end   = MIN (end, cinfo.output_height);
+
+          scanlines = end - start;
+
+          for (i = 0; i < scanlines; i++)
+            jpeg_read_scanlines (&cinfo, (JSAMPARRAY) &rowbuf[i], 1);
+
+          if (cinfo.out_color_space == JCS_CMYK)
+            jpeg_load_cmyk_to_rgb (buf, cinfo.output_width * scanlines,
+                                   cmyk_transform);
+
+          gegl_buffer_set (buffer,
+                           GEGL_RECTANGLE (0, start,
+                                           cinfo.output_width, scanlines),
+                           0,
+                           format,
+                           buf,
+                           GEGL_AUTO_ROWSTRIDE);
+
+          if (! preview && (cinfo.output_scanline % 32) == 0)
+            gimp_progress_update ((gdouble) cinfo.output_scanline /
+                                  (gdouble) cinfo.output_height);
+        }
 
-  /* Step 7: Finish decompression */
-
-  jpeg_finish_decompress (&cinfo);
-  /* We can ignore the return value since suspension is not possible
-   * with the stdio data source.
-   */
+      /* Step 7: Finish decompression */
+      jpeg_finish_decompress (&cinfo);
+      /* We can ignore the return value since suspension is not possible
+       * with the stdio data source.
+       */
+    }
 
 #ifdef HAVE_LCMS
   if (cmyk_transform)
@@ -973,6 +986,205 @@ load_thumbnail_image (const gchar   *filename,
 
 #endif /* HAVE_LIBEXIF */
 
+/*  Loads a reduced version of the image that is at least @size pixels
+ *  large, letting libjpeg scale the DCT blocks down by 1/2, 1/4 or 1/8
+ *  instead of decoding the full image.  @width and @height are set to
+ *  the size of the full image.
+ */
+gint32
+load_scaled_image (const gchar   *filename,
+                   gint           size,
+                   gint          *width,
+                   gint          *height,
+                   GimpImageType *type,
+                   GError       **error)
+{
+  gint32 volatile  image_ID;
+  gint32           layer_ID;
+  struct jpeg_decompress_struct cinfo;
+  struct my_error_mgr           jerr;
+  FILE            *infile;
+  guchar * volatile   buf    = NULL;
+  guchar ** volatile  rowbuf = NULL;
+  GimpImageBaseType image_type;
+  GimpImageType    layer_type;
+  GeglBuffer * volatile buffer = NULL;
+  gint             tile_height;
+  gint             scanlines;
+  gint             i, start, end;
+  guint            scale_denom;
+#ifdef HAVE_LIBEXIF
+  ExifData        *exif_data;
+  gint             orientation = 0;
+#endif
+
+  cinfo.err = jpeg_std_error (&jerr.pub);
+  jerr.pub.error_exit     = my_error_exit;
+  jerr.pub.output_message = my_output_message;
+
+  if ((infile = g_fopen (filename, "rb")) == NULL)
+    {
+      g_set_error (error, G_FILE_ERROR, g_file_error_from_errno (errno),
+                   _("Could not open '%s' for reading: %s"),
+                   gimp_filename_to_utf8 (filename), g_strerror (errno));
+      return -1;
+    }
+
+  gimp_progress_init_printf (_("Opening thumbnail for '%s'"),
+                             gimp_filename_to_utf8 (filename));
+
+  image_ID = -1;
+
+  /* Establish the setjmp return context for my_error_exit to use. */
+  if (setjmp (jerr.setjmp_buffer))
+    {
+      /* If we get here, the JPEG code has signaled an error.  We
+       * need to clean up the JPEG object, close the input file,
+       * and return.
+       */
+      jpeg_destroy_decompress (&cinfo);
+      fclose (infile);
+
+      if (image_ID != -1)
+        gimp_image_delete (image_ID);
+
+      if (buffer)
+        g_object_unref (buffer);
+
+      g_free (rowbuf);
+      g_free (buf);
+
+      return -1;
+    }
+
+  jpeg_create_decompress (&cinfo);
+
+  jpeg_stdio_src (&cinfo, infile);
+
+  jpeg_read_header (&cinfo, TRUE);
+
+  *width  = cinfo.image_width;
+  *height = cinfo.image_height;
+
+  /* Pick the largest reduction that still gives at least @size pixels,
+   * and trade some quality for speed, the result is a thumbnail anyway.
+   */
+  for (scale_denom = 8; scale_denom > 1; scale_denom /= 2)
+    {
+      if (MAX (cinfo.image_width, cinfo.image_height) >= size * scale_denom)
+        break;
+    }
+
+  cinfo.scale_num           = 1;
+  cinfo.scale_denom         = scale_denom;
+  cinfo.dct_method          = JDCT_IFAST;
+  cinfo.do_fancy_upsampling = FALSE;
+
+  jpeg_start_decompress (&cinfo);
+
+  switch (cinfo.output_components)
+    {
+    case 1:
+      image_type = GIMP_GRAY;
+      layer_type = GIMP_GRAY_IMAGE;
+      break;
+
+    case 3:
+      image_type = GIMP_RGB;
+      layer_type = GIMP_RGB_IMAGE;
+      break;
+
+    case 4:
+      if (cinfo.out_color_space == JCS_CMYK)
+        {
+          image_type = GIMP_RGB;
+          layer_type = GIMP_RGB_IMAGE;
+          break;
+        }
+      /*fallthrough*/
+
+    default:
+      jpeg_destroy_decompress (&cinfo);
+      fclose (infile);
+
+      return -1;
+    }
+
+  tile_height = gimp_tile_height ();
+  buf = g_new (guchar,
+               tile_height * cinfo.output_width * cinfo.output_components);
+
+  rowbuf = g_new (guchar *, tile_height);
+
+  for (i = 0; i < tile_height; i++)
+    rowbuf[i] = buf + cinfo.output_width * cinfo.output_components * i;
+
+  image_ID = gimp_image_new (cinfo.output_width, cinfo.output_height,
+                             image_type);
+
+  gimp_image_undo_disable (image_ID);
+  gimp_image_set_filename (image_ID, filename);
+
+  layer_ID = gimp_layer_new (image_ID, _("Background"),
+                             cinfo.output_width,
+                             cinfo.output_height,
+                             layer_type, 100, GIMP_NORMAL_MODE);
+
+  buffer = gimp_drawable_get_buffer (layer_ID);
+
+  while (cinfo.output_scanline < cinfo.output_height)
+    {
+      start = cinfo.output_scanline;
+      end   = cinfo.output_scanline + tile_height;
+      end   = MIN (end, cinfo.output_height);
+      scanlines = end - start;
+
+      for (i = 0; i < scanlines; i++)
+        jpeg_read_scanlines (&cinfo, (JSAMPARRAY) &rowbuf[i], 1);
+
+      if (cinfo.out_color_space == JCS_CMYK)
+        jpeg_load_cmyk_to_rgb (buf, cinfo.output_width * scanlines, NULL);
+
+      gegl_buffer_set (buffer,
+                       GEGL_RECTANGLE (0, start, cinfo.output_width, scanlines),
+                       0,
+                       NULL,
+                       buf,
+                       GEGL_AUTO_ROWSTRIDE);
+
+      gimp_progress_update ((gdouble) cinfo.output_scanline /
+                            (gdouble) cinfo.output_height);
+    }
+
+  jpeg_finish_decompress (&cinfo);
+  jpeg_destroy_decompress (&cinfo);
+
+  fclose (infile);
+
+  g_object_unref (buffer);
+
+  g_free (rowbuf);
+  g_free (buf);
+
+  gimp_image_insert_layer (image_ID, layer_ID, -1, 0);
+
+#ifdef HAVE_LIBEXIF
+  exif_data = jpeg_exif_data_new_from_file (filename, NULL);
+
+  if (exif_data)
+    {
+      orientation = jpeg_exif_get_orientation (exif_data);
+      exif_data_unref (exif_data);
+    }
+
+  jpeg_exif_rotate (image_ID, orientation);
+#endif
+
+  *type = layer_type;
+
+  return image_ID;
+}
+
 
 static gpointer
 jpeg_load_cmyk_transform (guint8 *profile_data,
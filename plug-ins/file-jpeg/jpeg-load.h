@@ -23,6 +23,13 @@ gint32 load_image           (const gchar  *filename,
                              gboolean      preview,
                              GError      **error);
 
+gint32 load_scaled_image    (const gchar   *filename,
+                             gint           size,
+                             gint          *width,
+                             gint          *height,
+                             GimpImageType *type,
+                             GError       **error);
+
 
 #ifdef HAVE_LIBEXIF
 
@@ -0,0 +1,991 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * jpeg-parallel.c
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*  The entropy coder of a baseline JPEG file starts afresh after each
+ *  restart marker.  When the restart interval is a whole number of
+ *  MCU rows, the image is a sequence of stripes that can be coded
+ *  independently:
+ *
+ *  - when saving, every stripe is compressed as a JPEG file of its own,
+ *    with the same parameters.  The scans of these files are joined
+ *    with restart markers, behind the tables of the first one.  The
+ *    result is the same file the sequential encoder writes.
+ *
+ *  - when loading, the scan is split at the restart markers, and every
+ *    stripe is decoded as a JPEG file of its own, made of the tables
+ *    of the original file and the stripe's part of the scan.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <setjmp.h>
+
+#include <jpeglib.h>
+#include <jerror.h>
+
+#include <libgimp/gimp.h>
+
+#include "jpeg.h"
+#include "jpeg-parallel.h"
+
+
+/*  the approximate height of a stripe, in rows  */
+#define STRIPE_HEIGHT 256
+
+#define M_SOF0        0xc0
+#define M_SOF1        0xc1
+#define M_DHT         0xc4
+#define M_SOF15       0xcf
+#define M_SOI         0xd8
+#define M_SOS         0xda
+
+
+typedef struct
+{
+  struct jpeg_destination_mgr  pub;
+  GByteArray                  *data;
+} JpegMemDest;
+
+typedef struct
+{
+  gpointer     cinfo;          /*  the main (de)compressor, only read    */
+  gint         first_restart;  /*  the number of the stripe's first RST  */
+  gint         y;
+  gint         n_rows;
+  guchar      *pixels;
+  GByteArray  *jpeg;           /*  the stripe as a JPEG file of its own  */
+  gsize        scan_start;     /*  where its entropy-coded data starts   */
+  gsize        scan_end;       /*  and where it ends                     */
+  gboolean     success;
+  gboolean     done;
+} JpegStripe;
+
+
+static void      mem_dest_init          (j_compress_ptr             cinfo);
+static boolean   mem_dest_empty         (j_compress_ptr             cinfo);
+static void      mem_dest_term          (j_compress_ptr             cinfo);
+
+static void      mem_src                (j_decompress_ptr           cinfo,
+                                         const guchar              *data,
+                                         gsize                      len);
+static void      mem_src_init           (j_decompress_ptr           cinfo);
+static boolean   mem_src_fill           (j_decompress_ptr           cinfo);
+static void      mem_src_skip           (j_decompress_ptr           cinfo,
+                                         long                       num_bytes);
+static void      mem_src_term           (j_decompress_ptr           cinfo);
+
+static gint      get_mcu_height         (gint                       num_components,
+                                         const jpeg_component_info *comp_info,
+                                         gint                      *mcu_width);
+static gsize     parse_header           (const guchar              *data,
+                                         gsize                      len,
+                                         GByteArray                *tables,
+                                         gsize                     *sof);
+static gsize     find_restarts          (const guchar              *data,
+                                         gsize                      len,
+                                         gsize                      start,
+                                         GArray                    *restarts);
+static gint      renumber_restarts      (guchar                    *data,
+                                         gsize                      len,
+                                         gint                       next);
+static void      set_height             (guchar                    *sof,
+                                         gint                       height);
+
+static void      save_stripe            (JpegStripe                *stripe,
+                                         gpointer                   data);
+static void      load_stripe            (JpegStripe                *stripe,
+                                         gpointer                   data);
+
+static void      stripe_error_exit      (j_common_ptr               cinfo);
+static void      stripe_output_message  (j_common_ptr               cinfo);
+static void      stripe_done            (JpegStripe                *stripe,
+                                         gboolean                   success);
+static void      stripe_wait            (JpegStripe                *stripe);
+static void      stripe_free            (JpegStripe                *stripe);
+
+
+static GMutex stripe_mutex;
+static GCond  stripe_cond;
+
+
+/*  public functions  */
+
+/*  Makes @cinfo write to @data, which must stay around until the
+ *  compressor is destroyed.
+ */
+void
+jpeg_parallel_mem_dest (j_compress_ptr  cinfo,
+                        GByteArray     *data)
+{
+  JpegMemDest *dest;
+
+  dest = (JpegMemDest *)
+    (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+                                sizeof (JpegMemDest));
+
+  dest->pub.init_destination    = mem_dest_init;
+  dest->pub.empty_output_buffer = mem_dest_empty;
+  dest->pub.term_destination    = mem_dest_term;
+  dest->data                    = data;
+
+  cinfo->dest = &dest->pub;
+}
+
+/*  Returns whether @cinfo, with all parameters set but not started
+ *  yet, can be compressed in stripes.
+ */
+gboolean
+jpeg_parallel_save_supported (j_compress_ptr cinfo)
+{
+  gint mcu_width;
+  gint mcu_height;
+  gint interval_rows;
+
+  if (g_get_num_processors () < 2 ||
+      cinfo->optimize_coding      ||
+      cinfo->arith_code           ||
+      cinfo->scan_info            ||
+      cinfo->smoothing_factor     ||
+      cinfo->restart_interval     ||
+      cinfo->restart_in_rows <= 0)
+    return FALSE;
+
+  mcu_height = get_mcu_height (cinfo->num_components, cinfo->comp_info,
+                               &mcu_width);
+
+  /*  libjpeg clamps longer intervals, which would leave the restart
+   *  markers in the middle of MCU rows
+   */
+  if ((glong) ((cinfo->image_width + mcu_width - 1) / mcu_width) *
+      cinfo->restart_in_rows > 65535)
+    return FALSE;
+
+  interval_rows = cinfo->restart_in_rows * mcu_height;
+
+  return cinfo->image_height > MAX (STRIPE_HEIGHT, interval_rows);
+}
+
+/*  Writes the image as a sequence of separately compressed stripes.
+ *  @cinfo must write to a jpeg_parallel_mem_dest(), and it must be
+ *  started and have all markers written, the data written to it so
+ *  far is copied to @outfile first.  @cinfo must be aborted
+ *  afterwards.
+ */
+gboolean
+jpeg_parallel_save (j_compress_ptr  cinfo,
+                    GeglBuffer     *buffer,
+                    const Babl     *format,
+                    FILE           *outfile,
+                    gboolean        show_progress)
+{
+  static const guchar  eoi[2]  = { 0xff, JPEG_EOI };
+  JpegMemDest         *dest    = (JpegMemDest *) cinfo->dest;
+  GThreadPool         *pool;
+  GQueue               stripes = G_QUEUE_INIT;
+  gint                 n_threads;
+  gint                 height  = cinfo->image_height;
+  gint                 rowstride;
+  gint                 intervals;
+  gint                 stripe_height;
+  gint                 y;
+  gboolean             success = TRUE;
+
+  n_threads = g_get_num_processors ();
+  rowstride = cinfo->input_components * cinfo->image_width;
+
+  stripe_height = cinfo->restart_in_rows *
+                  get_mcu_height (cinfo->num_components, cinfo->comp_info,
+                                  NULL);
+  intervals     = MAX (STRIPE_HEIGHT / stripe_height, 1);
+  stripe_height *= intervals;
+
+  /*  the file header and the markers  */
+  fwrite (dest->data->data, 1,
+          dest->pub.next_output_byte - dest->data->data, outfile);
+
+  pool = g_thread_pool_new ((GFunc) save_stripe, NULL,
+                            n_threads, FALSE, NULL);
+
+  for (y = 0; (success && y < height) || ! g_queue_is_empty (&stripes); )
+    {
+      JpegStripe *stripe;
+
+      if (success && y < height &&
+          g_queue_get_length (&stripes) < 2 * n_threads)
+        {
+          stripe = g_slice_new0 (JpegStripe);
+
+          stripe->cinfo         = cinfo;
+          stripe->y             = y;
+          stripe->first_restart = (y / stripe_height) * intervals;
+          stripe->n_rows        = MIN (stripe_height, height - y);
+          stripe->pixels        = g_new (guchar, stripe->n_rows * rowstride);
+
+          gegl_buffer_get (buffer,
+                           GEGL_RECTANGLE (0, y,
+                                           cinfo->image_width, stripe->n_rows),
+                           1.0,
+                           format,
+                           stripe->pixels,
+                           GEGL_AUTO_ROWSTRIDE,
+                           GEGL_ABYSS_NONE);
+
+          y += stripe->n_rows;
+
+          g_queue_push_tail (&stripes, stripe);
+          g_thread_pool_push (pool, stripe, NULL);
+
+          continue;
+        }
+
+      /*  write the oldest stripe when it's done  */
+      stripe = g_queue_pop_head (&stripes);
+
+      stripe_wait (stripe);
+
+      if (success && stripe->success)
+        {
+          const guchar *data = stripe->jpeg->data;
+
+          if (stripe->first_restart == 0)
+            {
+              GByteArray *tables = g_byte_array_new ();
+              gsize       sof;
+
+              /*  the tables and headers of the first stripe, for the
+               *  height of the whole image
+               */
+              parse_header (data, stripe->jpeg->len, tables, &sof);
+              set_height (tables->data + sof, height);
+
+              fwrite (tables->data, 1, tables->len, outfile);
+
+              g_byte_array_free (tables, TRUE);
+            }
+          else
+            {
+              guchar rst[2];
+
+              rst[0] = 0xff;
+              rst[1] = JPEG_RST0 + ((stripe->first_restart - 1) & 7);
+
+              fwrite (rst, 1, 2, outfile);
+            }
+
+          fwrite (data + stripe->scan_start, 1,
+                  stripe->scan_end - stripe->scan_start, outfile);
+        }
+      else
+        {
+          success = FALSE;
+        }
+
+      stripe_free (stripe);
+
+      if (show_progress)
+        gimp_progress_update ((gdouble) y / (gdouble) height);
+    }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  if (success)
+    fwrite (eoi, 1, 2, outfile);
+
+  return success && ! ferror (outfile);
+}
+
+/*  Returns whether @cinfo, started with jpeg_start_decompress(), can
+ *  be decoded in stripes.
+ */
+gboolean
+jpeg_parallel_load_supported (j_decompress_ptr cinfo)
+{
+  gint interval_rows;
+  gint i;
+
+  if (g_get_num_processors () < 2                    ||
+      cinfo->progressive_mode                        ||
+      cinfo->arith_code                              ||
+      cinfo->quantize_colors                         ||
+      cinfo->out_color_space  == JCS_CMYK            ||
+      cinfo->output_width     != cinfo->image_width  ||
+      cinfo->output_height    != cinfo->image_height ||
+      cinfo->comps_in_scan    != cinfo->num_components ||
+      cinfo->restart_interval == 0                   ||
+      cinfo->restart_interval % cinfo->MCUs_per_row)
+    return FALSE;
+
+  /*  smooth upsampling blends rows of neighboring stripes  */
+  if (cinfo->do_fancy_upsampling)
+    {
+      for (i = 0; i < cinfo->num_components; i++)
+        {
+          if (cinfo->comp_info[i].v_samp_factor != cinfo->max_v_samp_factor)
+            return FALSE;
+        }
+    }
+
+  interval_rows = (cinfo->restart_interval / cinfo->MCUs_per_row) *
+                  get_mcu_height (cinfo->num_components, cinfo->comp_info,
+                                  NULL);
+
+  return cinfo->output_height > MAX (STRIPE_HEIGHT, interval_rows);
+}
+
+/*  Decodes the image of @cinfo in stripes into @buffer.  Returns FALSE
+ *  if the file's scan can't be split, or a stripe can't be decoded
+ *  cleanly, so the caller can still decode it in one piece.  @cinfo
+ *  must be aborted after success.
+ */
+gboolean
+jpeg_parallel_load (j_decompress_ptr  cinfo,
+                    const gchar      *filename,
+                    GeglBuffer       *buffer,
+                    const Babl       *format,
+                    gboolean          show_progress)
+{
+  static const guchar  soi[2]   = { 0xff, M_SOI };
+  static const guchar  eoi[2]   = { 0xff, JPEG_EOI };
+  gchar               *contents;
+  gsize                len;
+  GByteArray          *tables;
+  GArray              *restarts;
+  GThreadPool         *pool;
+  GQueue               stripes  = G_QUEUE_INIT;
+  gsize                sof      = 0;
+  gsize                scan_start;
+  gsize                scan_end = 0;
+  gint                 n_threads;
+  gint                 height   = cinfo->output_height;
+  gint                 interval_rows;
+  gint                 n_intervals;
+  gint                 intervals;
+  gint                 stripe_height;
+  gint                 y;
+  gboolean             success  = TRUE;
+
+  if (! g_file_get_contents (filename, &contents, &len, NULL))
+    return FALSE;
+
+  tables   = g_byte_array_new ();
+  restarts = g_array_new (FALSE, FALSE, sizeof (gsize));
+
+  g_byte_array_append (tables, soi, 2);
+
+  scan_start = parse_header ((const guchar *) contents, len, tables, &sof);
+
+  if (scan_start)
+    scan_end = find_restarts ((const guchar *) contents, len,
+                              scan_start, restarts);
+
+  interval_rows = (cinfo->restart_interval / cinfo->MCUs_per_row) *
+                  get_mcu_height (cinfo->num_components, cinfo->comp_info,
+                                  NULL);
+  n_intervals   = (height + interval_rows - 1) / interval_rows;
+
+  if (! scan_end || restarts->len != n_intervals - 1)
+    {
+      g_array_free (restarts, TRUE);
+      g_byte_array_free (tables, TRUE);
+      g_free (contents);
+
+      return FALSE;
+    }
+
+  n_threads     = g_get_num_processors ();
+  intervals     = MAX (STRIPE_HEIGHT / interval_rows, 1);
+  stripe_height = intervals * interval_rows;
+
+  pool = g_thread_pool_new ((GFunc) load_stripe, NULL,
+                            n_threads, FALSE, NULL);
+
+  for (y = 0; (success && y < height) || ! g_queue_is_empty (&stripes); )
+    {
+      JpegStripe *stripe;
+
+      if (success && y < height &&
+          g_queue_get_length (&stripes) < 2 * n_threads)
+        {
+          gint  first = (y / stripe_height) * intervals;
+          gint  last  = MIN (first + intervals, n_intervals) - 1;
+          gsize start;
+          gsize end;
+
+          start = first ? g_array_index (restarts, gsize, first - 1) + 2
+                        : scan_start;
+          end   = last < n_intervals - 1 ? g_array_index (restarts, gsize, last)
+                                         : scan_end;
+
+          stripe = g_slice_new0 (JpegStripe);
+
+          stripe->cinfo      = cinfo;
+          stripe->y          = y;
+          stripe->n_rows     = MIN (stripe_height, height - y);
+          stripe->jpeg       = g_byte_array_sized_new (tables->len +
+                                                       end - start + 2);
+          stripe->scan_start = tables->len;
+          stripe->scan_end   = tables->len + end - start;
+
+          g_byte_array_append (stripe->jpeg, tables->data, tables->len);
+          g_byte_array_append (stripe->jpeg,
+                               (const guchar *) contents + start, end - start);
+          g_byte_array_append (stripe->jpeg, eoi, 2);
+
+          set_height (stripe->jpeg->data + sof, stripe->n_rows);
+
+          y += stripe->n_rows;
+
+          g_queue_push_tail (&stripes, stripe);
+          g_thread_pool_push (pool, stripe, NULL);
+
+          continue;
+        }
+
+      stripe = g_queue_pop_head (&stripes);
+
+      stripe_wait (stripe);
+
+      if (success && stripe->success)
+        {
+          gegl_buffer_set (buffer,
+                           GEGL_RECTANGLE (0, stripe->y,
+                                           cinfo->output_width,
+                                           stripe->n_rows),
+                           0,
+                           format,
+                           stripe->pixels,
+                           GEGL_AUTO_ROWSTRIDE);
+
+          if (show_progress)
+            gimp_progress_update ((gdouble) (stripe->y + stripe->n_rows) /
+                                  (gdouble) height);
+        }
+      else
+        {
+          success = FALSE;
+        }
+
+      stripe_free (stripe);
+    }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  g_array_free (restarts, TRUE);
+  g_byte_array_free (tables, TRUE);
+  g_free (contents);
+
+  return success;
+}
+
+
+/*  private functions  */
+
+static void
+mem_dest_init (j_compress_ptr cinfo)
+{
+  JpegMemDest *dest = (JpegMemDest *) cinfo->dest;
+
+  g_byte_array_set_size (dest->data, 16384);
+
+  dest->pub.next_output_byte = dest->data->data;
+  dest->pub.free_in_buffer   = dest->data->len;
+}
+
+static boolean
+mem_dest_empty (j_compress_ptr cinfo)
+{
+  JpegMemDest *dest = (JpegMemDest *) cinfo->dest;
+  guint        len  = dest->data->len;
+
+  g_byte_array_set_size (dest->data, 2 * len);
+
+  dest->pub.next_output_byte = dest->data->data + len;
+  dest->pub.free_in_buffer   = len;
+
+  return TRUE;
+}
+
+static void
+mem_dest_term (j_compress_ptr cinfo)
+{
+  JpegMemDest *dest = (JpegMemDest *) cinfo->dest;
+
+  g_byte_array_set_size (dest->data,
+                         dest->data->len - dest->pub.free_in_buffer);
+}
+
+static void
+mem_src (j_decompress_ptr  cinfo,
+         const guchar     *data,
+         gsize             len)
+{
+  struct jpeg_source_mgr *src;
+
+  src = (struct jpeg_source_mgr *)
+    (*cinfo->mem->alloc_small) ((j_common_ptr) cinfo, JPOOL_PERMANENT,
+                                sizeof (struct jpeg_source_mgr));
+
+  src->init_source       = mem_src_init;
+  src->fill_input_buffer = mem_src_fill;
+  src->skip_input_data   = mem_src_skip;
+  src->resync_to_restart = jpeg_resync_to_restart;
+  src->term_source       = mem_src_term;
+  src->next_input_byte   = data;
+  src->bytes_in_buffer   = len;
+
+  cinfo->src = src;
+}
+
+static void
+mem_src_init (j_decompress_ptr cinfo)
+{
+}
+
+static boolean
+mem_src_fill (j_decompress_ptr cinfo)
+{
+  static const JOCTET eoi[2] = { 0xff, JPEG_EOI };
+
+  /*  the data is all there, so this is a truncated stream  */
+  WARNMS (cinfo, JWRN_JPEG_EOF);
+
+  cinfo->src->next_input_byte = eoi;
+  cinfo->src->bytes_in_buffer = 2;
+
+  return TRUE;
+}
+
+static void
+mem_src_skip (j_decompress_ptr cinfo,
+              long             num_bytes)
+{
+  struct jpeg_source_mgr *src = cinfo->src;
+
+  if (num_bytes <= 0)
+    return;
+
+  if ((gsize) num_bytes > src->bytes_in_buffer)
+    {
+      mem_src_fill (cinfo);
+    }
+  else
+    {
+      src->next_input_byte += num_bytes;
+      src->bytes_in_buffer -= num_bytes;
+    }
+}
+
+static void
+mem_src_term (j_decompress_ptr cinfo)
+{
+}
+
+static gint
+get_mcu_height (gint                       num_components,
+                const jpeg_component_info *comp_info,
+                gint                      *mcu_width)
+{
+  gint max_h = 1;
+  gint max_v = 1;
+  gint i;
+
+  /*  a single component is coded in single blocks  */
+  if (num_components > 1)
+    {
+      for (i = 0; i < num_components; i++)
+        {
+          max_h = MAX (max_h, comp_info[i].h_samp_factor);
+          max_v = MAX (max_v, comp_info[i].v_samp_factor);
+        }
+    }
+
+  if (mcu_width)
+    *mcu_width = max_h * DCTSIZE;
+
+  return max_v * DCTSIZE;
+}
+
+/*  Walks the marker segments of @data up to the first scan header, and
+ *  returns the offset of the entropy-coded data behind it, or 0 if the
+ *  file is not sequential and Huffman-coded.  All segments but APPn and
+ *  COM are appended to @tables, if given, and the offset of the frame
+ *  header in it is returned in @sof.
+ */
+static gsize
+parse_header (const guchar *data,
+              gsize         len,
+              GByteArray   *tables,
+              gsize        *sof)
+{
+  gboolean have_sof = FALSE;
+  gsize    pos      = 2;
+
+  if (len < 4 || data[0] != 0xff || data[1] != M_SOI)
+    return 0;
+
+  while (pos < len && data[pos] == 0xff)
+    {
+      guint marker;
+      gsize length;
+
+      /*  skip fill bytes  */
+      while (pos < len && data[pos] == 0xff)
+        pos++;
+
+      if (pos + 3 > len)
+        return 0;
+
+      marker = data[pos];
+      length = (data[pos + 1] << 8) | data[pos + 2];
+
+      if (length < 2 || pos + 1 + length > len)
+        return 0;
+
+      if (marker == M_SOF0 || marker == M_SOF1)
+        {
+          if (tables)
+            *sof = tables->len;
+
+          have_sof = TRUE;
+        }
+      else if (marker > M_SOF1 && marker <= M_SOF15 && marker != M_DHT)
+        {
+          /*  progressive, lossless, hierarchical or arithmetic  */
+          return 0;
+        }
+
+      if (tables &&
+          marker != JPEG_COM &&
+          (marker < JPEG_APP0 || marker > JPEG_APP0 + 15))
+        {
+          g_byte_array_append (tables, data + pos - 1, length + 2);
+        }
+
+      pos += 1 + length;
+
+      if (marker == M_SOS)
+        return have_sof ? pos : 0;
+    }
+
+  return 0;
+}
+
+/*  Collects the offsets of the restart markers in the entropy-coded
+ *  data starting at @start, and returns the offset of the EOI marker
+ *  that ends it, or 0 if it ends any other way.
+ */
+static gsize
+find_restarts (const guchar *data,
+               gsize         len,
+               gsize         start,
+               GArray       *restarts)
+{
+  gsize i;
+
+  for (i = start; i + 1 < len; i++)
+    {
+      guchar c;
+
+      if (data[i] != 0xff)
+        continue;
+
+      c = data[i + 1];
+
+      /*  stuffed zero bytes and fill bytes  */
+      if (c == 0x00 || c == 0xff)
+        continue;
+
+      if (c >= JPEG_RST0 && c <= JPEG_RST0 + 7)
+        {
+          g_array_append_val (restarts, i);
+          i++;
+
+          continue;
+        }
+
+      return c == JPEG_EOI ? i : 0;
+    }
+
+  return 0;
+}
+
+/*  Numbers the restart markers in @data consecutively, starting with
+ *  @next, and returns the number of the one that would follow.
+ */
+static gint
+renumber_restarts (guchar *data,
+                   gsize   len,
+                   gint    next)
+{
+  gsize i;
+
+  for (i = 0; i + 1 < len; i++)
+    {
+      if (data[i] == 0xff &&
+          data[i + 1] >= JPEG_RST0 && data[i + 1] <= JPEG_RST0 + 7)
+        {
+          data[++i] = JPEG_RST0 + (next++ & 7);
+        }
+    }
+
+  return next;
+}
+
+static void
+set_height (guchar *sof,
+            gint    height)
+{
+  /*  0xff, marker, length (2), precision, height (2), ...  */
+  sof[5] = (height >> 8) & 0xff;
+  sof[6] =  height       & 0xff;
+}
+
+static void
+save_stripe (JpegStripe *stripe,
+             gpointer    data)
+{
+  j_compress_ptr              parent = stripe->cinfo;
+  struct jpeg_compress_struct cinfo;
+  struct my_error_mgr         jerr;
+  gint                        rowstride;
+  gint                        i;
+
+  stripe->jpeg = g_byte_array_new ();
+
+  cinfo.err = jpeg_std_error (&jerr.pub);
+  jerr.pub.error_exit     = stripe_error_exit;
+  jerr.pub.output_message = stripe_output_message;
+
+  if (setjmp (jerr.setjmp_buffer))
+    {
+      jpeg_destroy_compress (&cinfo);
+      stripe_done (stripe, FALSE);
+
+      return;
+    }
+
+  jpeg_create_compress (&cinfo);
+  jpeg_parallel_mem_dest (&cinfo, stripe->jpeg);
+
+  cinfo.image_width      = parent->image_width;
+  cinfo.image_height     = stripe->n_rows;
+  cinfo.input_components = parent->input_components;
+  cinfo.in_color_space   = parent->in_color_space;
+
+  jpeg_set_defaults (&cinfo);
+  jpeg_set_colorspace (&cinfo, parent->jpeg_color_space);
+
+  for (i = 0; i < NUM_QUANT_TBLS; i++)
+    {
+      if (! parent->quant_tbl_ptrs[i])
+        continue;
+
+      if (! cinfo.quant_tbl_ptrs[i])
+        cinfo.quant_tbl_ptrs[i] = jpeg_alloc_quant_table ((j_common_ptr) &cinfo);
+
+      *cinfo.quant_tbl_ptrs[i] = *parent->quant_tbl_ptrs[i];
+    }
+
+  for (i = 0; i < NUM_HUFF_TBLS; i++)
+    {
+      if (parent->dc_huff_tbl_ptrs[i])
+        {
+          if (! cinfo.dc_huff_tbl_ptrs[i])
+            cinfo.dc_huff_tbl_ptrs[i] = jpeg_alloc_huff_table ((j_common_ptr) &cinfo);
+
+          *cinfo.dc_huff_tbl_ptrs[i] = *parent->dc_huff_tbl_ptrs[i];
+        }
+
+      if (parent->ac_huff_tbl_ptrs[i])
+        {
+          if (! cinfo.ac_huff_tbl_ptrs[i])
+            cinfo.ac_huff_tbl_ptrs[i] = jpeg_alloc_huff_table ((j_common_ptr) &cinfo);
+
+          *cinfo.ac_huff_tbl_ptrs[i] = *parent->ac_huff_tbl_ptrs[i];
+        }
+    }
+
+  for (i = 0; i < cinfo.num_components; i++)
+    {
+      cinfo.comp_info[i].h_samp_factor = parent->comp_info[i].h_samp_factor;
+      cinfo.comp_info[i].v_samp_factor = parent->comp_info[i].v_samp_factor;
+      cinfo.comp_info[i].quant_tbl_no  = parent->comp_info[i].quant_tbl_no;
+      cinfo.comp_info[i].dc_tbl_no     = parent->comp_info[i].dc_tbl_no;
+      cinfo.comp_info[i].ac_tbl_no     = parent->comp_info[i].ac_tbl_no;
+    }
+
+  cinfo.dct_method         = parent->dct_method;
+  cinfo.restart_in_rows    = parent->restart_in_rows;
+  cinfo.write_JFIF_header  = FALSE;
+  cinfo.write_Adobe_marker = FALSE;
+
+  jpeg_start_compress (&cinfo, TRUE);
+
+  rowstride = cinfo.input_components * cinfo.image_width;
+
+  while (cinfo.next_scanline < cinfo.image_height)
+    {
+      JSAMPROW row = stripe->pixels + cinfo.next_scanline * rowstride;
+
+      jpeg_write_scanlines (&cinfo, &row, 1);
+    }
+
+  jpeg_finish_compress (&cinfo);
+  jpeg_destroy_compress (&cinfo);
+
+  g_free (stripe->pixels);
+  stripe->pixels = NULL;
+
+  stripe->scan_start = parse_header (stripe->jpeg->data, stripe->jpeg->len,
+                                     NULL, NULL);
+  stripe->scan_end   = stripe->jpeg->len - 2;
+
+  if (stripe->scan_start == 0 || stripe->scan_start > stripe->scan_end)
+    {
+      stripe_done (stripe, FALSE);
+
+      return;
+    }
+
+  renumber_restarts (stripe->jpeg->data + stripe->scan_start,
+                     stripe->scan_end - stripe->scan_start,
+                     stripe->first_restart);
+
+  stripe_done (stripe, TRUE);
+}
+
+static void
+load_stripe (JpegStripe *stripe,
+             gpointer    data)
+{
+  j_decompress_ptr              parent = stripe->cinfo;
+  struct jpeg_decompress_struct cinfo;
+  struct my_error_mgr           jerr;
+  gint                          rowstride;
+  gboolean                      success;
+
+  rowstride = parent->output_width * parent->output_components;
+
+  stripe->pixels = g_new (guchar, stripe->n_rows * rowstride);
+
+  renumber_restarts (stripe->jpeg->data + stripe->scan_start,
+                     stripe->scan_end - stripe->scan_start, 0);
+
+  cinfo.err = jpeg_std_error (&jerr.pub);
+  jerr.pub.error_exit     = stripe_error_exit;
+  jerr.pub.output_message = stripe_output_message;
+
+  if (setjmp (jerr.setjmp_buffer))
+    {
+      jpeg_destroy_decompress (&cinfo);
+      stripe_done (stripe, FALSE);
+
+      return;
+    }
+
+  jpeg_create_decompress (&cinfo);
+  mem_src (&cinfo, stripe->jpeg->data, stripe->jpeg->len);
+
+  jpeg_read_header (&cinfo, TRUE);
+
+  cinfo.out_color_space     = parent->out_color_space;
+  cinfo.dct_method          = parent->dct_method;
+  cinfo.do_fancy_upsampling = parent->do_fancy_upsampling;
+
+  jpeg_start_decompress (&cinfo);
+
+  success = (cinfo.output_width      == parent->output_width      &&
+             cinfo.output_height     == stripe->n_rows            &&
+             cinfo.output_components == parent->output_components);
+
+  while (success && cinfo.output_scanline < cinfo.output_height)
+    {
+      JSAMPROW row = stripe->pixels + cinfo.output_scanline * rowstride;
+
+      jpeg_read_scanlines (&cinfo, &row, 1);
+    }
+
+  if (success)
+    jpeg_finish_decompress (&cinfo);
+
+  /*  leave damaged files to the sequential decoder, which reports it  */
+  if (jerr.pub.num_warnings > 0)
+    success = FALSE;
+
+  jpeg_destroy_decompress (&cinfo);
+
+  g_byte_array_free (stripe->jpeg, TRUE);
+  stripe->jpeg = NULL;
+
+  stripe_done (stripe, success);
+}
+
+static void
+stripe_error_exit (j_common_ptr cinfo)
+{
+  my_error_ptr myerr = (my_error_ptr) cinfo->err;
+
+  longjmp (myerr->setjmp_buffer, 1);
+}
+
+static void
+stripe_output_message (j_common_ptr cinfo)
+{
+  /*  g_message() is not safe in threads, and the failure is reported
+   *  by the caller
+   */
+}
+
+static void
+stripe_done (JpegStripe *stripe,
+             gboolean    success)
+{
+  g_mutex_lock (&stripe_mutex);
+
+  stripe->success = success;
+  stripe->done    = TRUE;
+
+  g_cond_broadcast (&stripe_cond);
+
+  g_mutex_unlock (&stripe_mutex);
+}
+
+static void
+stripe_wait (JpegStripe *stripe)
+{
+  g_mutex_lock (&stripe_mutex);
+
+  while (! stripe->done)
+    g_cond_wait (&stripe_cond, &stripe_mutex);
+
+  g_mutex_unlock (&stripe_mutex);
+}
+
+static void
+stripe_free (JpegStripe *stripe)
+{
+  g_free (stripe->pixels);
+
+  if (stripe->jpeg)
+    g_byte_array_free (stripe->jpeg, TRUE);
+
+  g_slice_free (JpegStripe, stripe);
+}
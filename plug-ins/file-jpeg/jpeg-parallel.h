@@ -0,0 +1,46 @@
+/* GIMP - The GNU Image Manipulation Program
+ * Copyright (C) 1995 Spencer Kimball and Peter Mattis
+ *
+ * jpeg-parallel.h
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __JPEG_PARALLEL_H__
+#define __JPEG_PARALLEL_H__
+
+/*  Baseline JPEG files with restart markers at the start of MCU rows
+ *  consist of independently coded stripes of rows.  These functions
+ *  encode and decode such stripes in several threads.
+ */
+
+void       jpeg_parallel_mem_dest        (j_compress_ptr    cinfo,
+                                          GByteArray       *data);
+
+gboolean   jpeg_parallel_save_supported  (j_compress_ptr    cinfo);
+gboolean   jpeg_parallel_save            (j_compress_ptr    cinfo,
+                                          GeglBuffer       *buffer,
+                                          const Babl       *format,
+                                          FILE             *outfile,
+                                          gboolean          show_progress);
+
+gboolean   jpeg_parallel_load_supported  (j_decompress_ptr  cinfo);
+gboolean   jpeg_parallel_load            (j_decompress_ptr  cinfo,
+                                          const gchar      *filename,
+                                          GeglBuffer       *buffer,
+                                          const Babl       *format,
+                                          gboolean          show_progress);
+
+
+#endif /* __JPEG_PARALLEL_H__ */
@@ -45,6 +45,7 @@
 #include "jpeg.h"
 #include "jpeg-icc.h"
 #include "jpeg-load.h"
+#include "jpeg-parallel.h"
 #include "jpeg-save.h"
 #include "jpeg-settings.h"
 #ifdef HAVE_LIBEXIF
@@ -260,7 +261,8 @@ save_image (const gchar  *filename,
   static struct jpeg_compress_struct cinfo;
   static struct my_error_mgr         jerr;
   JpegSubsampling             subsampling;
-  FILE     * volatile outfile;
+  FILE       * volatile outfile;
+  GByteArray * volatile header = NULL;
   guchar   *data;
   guchar   *src;
   gboolean  has_alpha;
@@ -293,6 +295,8 @@ save_image (const gchar  *filename,
       jpeg_destroy_compress (&cinfo);
       if (outfile)
         fclose (outfile);
+      if (header)
+        g_byte_array_free (header, TRUE);
       if (buffer)
         g_object_unref (buffer);
 
@@ -502,6 +506,17 @@ save_image (const gchar  *filename,
       }
   }
 
+  /* Step 3.1: with restart markers, baseline images can be compressed
+   * in stripes, in several threads.  The headers and markers are then
+   * collected in memory, and written by jpeg_parallel_save().
+   */
+  if (! preview && jpeg_parallel_save_supported (&cinfo))
+    {
+      header = g_byte_array_new ();
+
+      jpeg_parallel_mem_dest (&cinfo, header);
+    }
+
   /* Step 4: Start compressor */
 
   /* TRUE ensures that we will write a complete interchange-JPEG file.
@@ -635,6 +650,31 @@ save_image (const gchar  *filename,
       gimp_parasite_free (parasite);
     }
 
+  if (header)
+    {
+      gboolean success;
+
+      success = jpeg_parallel_save (&cinfo, buffer, format, outfile, TRUE);
+
+      jpeg_destroy_compress (&cinfo);
+      fclose (outfile);
+
+      g_byte_array_free (header, TRUE);
+      g_object_unref (buffer);
+
+      if (! success)
+        {
+          g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                       _("Could not write '%s'"),
+                       gimp_filename_to_utf8 (filename));
+          return FALSE;
+        }
+
+      gimp_progress_update (1.0);
+
+      return TRUE;
+    }
+
   /* Step 5: while (scan lines remain to be written) */
   /*           jpeg_write_scanlines(...); */
 
@@ -96,8 +96,6 @@ query (void)
     { GIMP_PDB_IMAGE,   "image",         "Output image" }
   };
 
-#ifdef HAVE_LIBEXIF
-
   static const GimpParamDef thumb_args[] =
   {
     { GIMP_PDB_STRING, "filename",     "The name of the file to load"  },
@@ -110,8 +108,6 @@ query (void)
     { GIMP_PDB_INT32,  "image-height", "Height of full-sized image"    }
   };
 
-#endif /* HAVE_LIBEXIF */
-
   static const GimpParamDef save_args[] =
   {
     { GIMP_PDB_INT32,    "run-mode",     "The run mode { RUN-INTERACTIVE (0), RUN-NONINTERACTIVE (1) }" },
@@ -149,11 +145,10 @@ query (void)
                                     "",
                                     "6,string,JFIF,6,string,Exif");
 
-#ifdef HAVE_LIBEXIF
-
   gimp_install_procedure (LOAD_THUMB_PROC,
                           "Loads a thumbnail from a JPEG image",
-                          "Loads a thumbnail from a JPEG image (only if it exists)",
+                          "Loads the EXIF thumbnail of a JPEG image, or "
+                          "a reduced version of the image itself",
                           "Mukund Sivaraman <muks@mukund.org>, Sven Neumann <sven@gimp.org>",
                           "Mukund Sivaraman <muks@mukund.org>, Sven Neumann <sven@gimp.org>",
                           "November 15, 2004",
@@ -166,8 +161,6 @@ query (void)
 
   gimp_register_thumbnail_loader (LOAD_PROC, LOAD_THUMB_PROC);
 
-#endif /* HAVE_LIBEXIF */
-
   gimp_install_procedure (SAVE_PROC,
                           "saves files in the JPEG file format",
                           "saves files in the lossy, widely supported JPEG format",
@@ -248,8 +241,6 @@ run (const gchar      *name,
 
     }
 
-#ifdef HAVE_LIBEXIF
-
   else if (strcmp (name, LOAD_THUMB_PROC) == 0)
     {
       if (nparams < 2)
@@ -259,12 +250,25 @@ run (const gchar      *name,
       else
         {
           const gchar  *filename = param[0].data.d_string;
+          gint          size     = param[1].data.d_int32;
           gint          width    = 0;
           gint          height   = 0;
           GimpImageType type     = -1;
 
+          image_ID = -1;
+
+#ifdef HAVE_LIBEXIF
           image_ID = load_thumbnail_image (filename, &width, &height, &type,
                                            &error);
+#endif
+
+          if (image_ID == -1)
+            {
+              g_clear_error (&error);
+
+              image_ID = load_scaled_image (filename, size,
+                                            &width, &height, &type, &error);
+            }
 
           if (image_ID != -1)
             {
@@ -286,9 +290,6 @@ run (const gchar      *name,
             }
         }
     }
-
-#endif /* HAVE_LIBEXIF */
-
   else if (strcmp (name, SAVE_PROC) == 0)
     {
       image_ID = orig_image_ID = param[1].data.d_int32;
@@ -38,6 +38,31 @@
 #define COMP_MODE_SIZE sizeof(guint16)
 
 
+/*  The channel data of a layer, read from the file in the main thread
+ *  and decoded in a worker thread
+ */
+typedef struct
+{
+  PSDlayer     *lyr_a;
+  PSDchannel  **lyr_chn;
+  gint          num_channels;
+  guint16       bps;
+  guint16      *comp_mode;
+  guint16     **rle_pack_len;
+  gchar       **raw_data;
+  gboolean      empty;
+  gboolean      empty_mask;
+  gboolean      alpha;
+  guint16       alpha_chn;
+  gboolean      user_mask;
+  guint16       user_mask_chn;
+  guint16       layer_channels;
+  guint16       channel_idx[MAX_CHANNELS];
+  guchar       *pixels;             /* interleaved layer pixels */
+  gboolean      done;
+} PSDlayerjob;
+
+
 /*  Local function prototypes  */
 static gint             read_header_block          (PSDimage     *img_a,
                                                     FILE         *f,
@@ -81,6 +106,16 @@ static gint             add_merged_image           (const gint32  image_id,
                                                     FILE         *f,
                                                     GError      **error);
 
+static PSDlayerjob    * read_layer_data            (PSDimage     *img_a,
+                                                    PSDlayer     *lyr_a,
+                                                    FILE         *f,
+                                                    GError      **error);
+
+static void             decode_layer_job           (PSDlayerjob  *job,
+                                                    gpointer      data);
+
+static void             free_layer_job             (PSDlayerjob  *job);
+
 /*  Local utility function prototypes  */
 static gchar          * get_psd_color_mode_name    (PSDColorMode  mode);
 
@@ -96,6 +131,19 @@ static gint             read_channel_data          (PSDchannel     *channel,
                                                     FILE           *f,
                                                     GError        **error);
 
+static gchar          * read_channel_raw_data      (PSDchannel     *channel,
+                                                    const guint16   bps,
+                                                    const guint16   compression,
+                                                    const guint16  *rle_pack_len,
+                                                    FILE           *f,
+                                                    GError        **error);
+
+static void             decode_channel_data        (PSDchannel     *channel,
+                                                    const guint16   bps,
+                                                    const guint16   compression,
+                                                    const guint16  *rle_pack_len,
+                                                    const gchar    *raw_data);
+
 static void             convert_16_bit             (const gchar *src,
                                                     gchar       *dst,
                                                     guint32      len);
@@ -106,6 +154,10 @@ static void             convert_1_bit              (const gchar *src,
                                                     guint32      columns);
 
 
+static GMutex layer_job_mutex;
+static GCond  layer_job_cond;
+
+
 /* Main file load function */
 gint32
 load_image (const gchar  *filename,
@@ -1012,15 +1064,13 @@ add_layers (const gint32  image_id,
             FILE         *f,
             GError      **error)
 {
+  PSDlayerjob         **jobs;
   PSDchannel          **lyr_chn;
+  GThreadPool          *pool;
   GArray               *parent_group_stack;
   gint32                parent_group_id = -1;
   guchar               *pixels;
-  guint16               alpha_chn;
-  guint16               user_mask_chn;
-  guint16               layer_channels;
-  guint16               channel_idx[MAX_CHANNELS];
-  guint16              *rle_pack_len;
+  GeglBuffer           *buffer;
   gint32                l_x;                   /* Layer x */
   gint32                l_y;                   /* Layer y */
   gint32                l_w;                   /* Layer width */
@@ -1033,16 +1083,13 @@ add_layers (const gint32  image_id,
   gint32                layer_id = -1;
   gint32                mask_id = -1;
   gint                  lidx;                  /* Layer index */
-  gint                  cidx;                  /* Channel index */
+  gint                  next;                  /* Next layer to read */
+  gint                  n_threads;
   gint                  rowi;                  /* Row index */
   gint                  coli;                  /* Column index */
   gint                  i;
-  gboolean              alpha;
-  gboolean              user_mask;
-  gboolean              empty;
-  gboolean              empty_mask;
+  gint                  ret = 0;
   GimpDrawable         *drawable;
-  GimpPixelRgn          pixel_rgn;
   GimpImageType         image_type;
   GimpLayerModeEffects  layer_mode;
 
@@ -1062,28 +1109,51 @@ add_layers (const gint32  image_id,
       return -1;
     }
 
+  /* The layer data is read in file order, a few layers ahead of the
+   * layer being added, and decoded in worker threads meanwhile.
+   */
+  n_threads = g_get_num_processors ();
+  pool = g_thread_pool_new ((GFunc) decode_layer_job, NULL,
+                            n_threads, FALSE, NULL);
+  jobs = g_new0 (PSDlayerjob *, img_a->num_layers);
+  next = 0;
+
   /* set the root of the group hierarchy */
   parent_group_stack = g_array_new (FALSE, FALSE, sizeof(gint32));
   g_array_append_val (parent_group_stack, parent_group_id);
 
   for (lidx = 0; lidx < img_a->num_layers; ++lidx)
     {
+      PSDlayerjob *job;
+
+      for (; next < img_a->num_layers && next <= lidx + 2 * n_threads; ++next)
+        {
+          jobs[next] = read_layer_data (img_a, lyr_a[next], f, error);
+
+          if (! jobs[next])
+            {
+              ret = -1;
+              goto out;
+            }
+
+          g_thread_pool_push (pool, jobs[next], NULL);
+        }
+
+      job = jobs[lidx];
+
+      g_mutex_lock (&layer_job_mutex);
+      while (! job->done)
+        g_cond_wait (&layer_job_cond, &layer_job_mutex);
+      g_mutex_unlock (&layer_job_mutex);
+
+      lyr_chn = job->lyr_chn;
+
       IFDBG(2) g_debug ("Process Layer No %d.", lidx);
 
       if (lyr_a[lidx]->drop)
         {
           IFDBG(2) g_debug ("Drop layer %d", lidx);
 
-          /* Step past layer data */
-          for (cidx = 0; cidx < lyr_a[lidx]->num_channels; ++cidx)
-            {
-              if (fseek (f, lyr_a[lidx]->chn_info[cidx].data_len, SEEK_CUR) < 0)
-                {
-                  psd_set_error (feof (f), errno, error);
-                  return -1;
-                }
-            }
-          g_free (lyr_a[lidx]->chn_info);
           g_free (lyr_a[lidx]->name);
         }
       else
@@ -1108,141 +1178,8 @@ add_layers (const gint32  image_id,
                 }
             }
 
-          /* Empty layer */
-          if (lyr_a[lidx]->bottom - lyr_a[lidx]->top == 0
-              || lyr_a[lidx]->right - lyr_a[lidx]->left == 0)
-              empty = TRUE;
-          else
-              empty = FALSE;
-
-          /* Empty mask */
-          if (lyr_a[lidx]->layer_mask.bottom - lyr_a[lidx]->layer_mask.top == 0
-              || lyr_a[lidx]->layer_mask.right - lyr_a[lidx]->layer_mask.left == 0)
-              empty_mask = TRUE;
-          else
-              empty_mask = FALSE;
-
-          IFDBG(3) g_debug ("Empty mask %d, size %d %d", empty_mask,
-                            lyr_a[lidx]->layer_mask.bottom - lyr_a[lidx]->layer_mask.top,
-                            lyr_a[lidx]->layer_mask.right - lyr_a[lidx]->layer_mask.left);
-
-          /* Load layer channel data */
-          IFDBG(2) g_debug ("Number of channels: %d", lyr_a[lidx]->num_channels);
-          /* Create pointer array for the channel records */
-          lyr_chn = g_new (PSDchannel *, lyr_a[lidx]->num_channels);
-          for (cidx = 0; cidx < lyr_a[lidx]->num_channels; ++cidx)
-            {
-              guint16 comp_mode = PSD_COMP_RAW;
-
-              /* Allocate channel record */
-              lyr_chn[cidx] = g_malloc (sizeof (PSDchannel) );
-
-              lyr_chn[cidx]->id = lyr_a[lidx]->chn_info[cidx].channel_id;
-              lyr_chn[cidx]->rows = lyr_a[lidx]->bottom - lyr_a[lidx]->top;
-              lyr_chn[cidx]->columns = lyr_a[lidx]->right - lyr_a[lidx]->left;
-
-              if (lyr_chn[cidx]->id == PSD_CHANNEL_MASK)
-                {
-                  /* Works around a bug in panotools psd files where the layer mask
-                     size is given as 0 but data exists. Set mask size to layer size.
-                  */
-                  if (empty_mask && lyr_a[lidx]->chn_info[cidx].data_len - 2 > 0)
-                    {
-                      empty_mask = FALSE;
-                      if (lyr_a[lidx]->layer_mask.top == lyr_a[lidx]->layer_mask.bottom)
-                        {
-                          lyr_a[lidx]->layer_mask.top = lyr_a[lidx]->top;
-                          lyr_a[lidx]->layer_mask.bottom = lyr_a[lidx]->bottom;
-                        }
-                      if (lyr_a[lidx]->layer_mask.right == lyr_a[lidx]->layer_mask.left)
-                        {
-                          lyr_a[lidx]->layer_mask.right = lyr_a[lidx]->right;
-                          lyr_a[lidx]->layer_mask.left = lyr_a[lidx]->left;
-                        }
-                    }
-                  lyr_chn[cidx]->rows = (lyr_a[lidx]->layer_mask.bottom -
-                                        lyr_a[lidx]->layer_mask.top);
-                  lyr_chn[cidx]->columns = (lyr_a[lidx]->layer_mask.right -
-                                           lyr_a[lidx]->layer_mask.left);
-                }
-
-              IFDBG(3) g_debug ("Channel id %d, %dx%d",
-                                lyr_chn[cidx]->id,
-                                lyr_chn[cidx]->columns,
-                                lyr_chn[cidx]->rows);
-
-              /* Only read channel data if there is any channel
-               * data. Note that the channel data can contain a
-               * compression method but no actual data.
-               */
-              if (lyr_a[lidx]->chn_info[cidx].data_len >= COMP_MODE_SIZE)
-                {
-                  if (fread (&comp_mode, COMP_MODE_SIZE, 1, f) < 1)
-                    {
-                      psd_set_error (feof (f), errno, error);
-                      return -1;
-                    }
-                  comp_mode = GUINT16_FROM_BE (comp_mode);
-                  IFDBG(3) g_debug ("Compression mode: %d", comp_mode);
-                }
-              if (lyr_a[lidx]->chn_info[cidx].data_len > COMP_MODE_SIZE)
-                {
-                  switch (comp_mode)
-                    {
-                      case PSD_COMP_RAW:        /* Planar raw data */
-                        IFDBG(3) g_debug ("Raw data length: %d",
-                                          lyr_a[lidx]->chn_info[cidx].data_len - 2);
-                        if (read_channel_data (lyr_chn[cidx], img_a->bps,
-                            PSD_COMP_RAW, NULL, f, error) < 1)
-                          return -1;
-                        break;
-
-                      case PSD_COMP_RLE:        /* Packbits */
-                        IFDBG(3) g_debug ("RLE channel length %d, RLE length data: %d, "
-                                          "RLE data block: %d",
-                                          lyr_a[lidx]->chn_info[cidx].data_len - 2,
-                                          lyr_chn[cidx]->rows * 2,
-                                          (lyr_a[lidx]->chn_info[cidx].data_len - 2 -
-                                           lyr_chn[cidx]->rows * 2));
-                        rle_pack_len = g_malloc (lyr_chn[cidx]->rows * 2);
-                        for (rowi = 0; rowi < lyr_chn[cidx]->rows; ++rowi)
-                          {
-                            if (fread (&rle_pack_len[rowi], 2, 1, f) < 1)
-                              {
-                                psd_set_error (feof (f), errno, error);
-                                g_free (rle_pack_len);
-                                return -1;
-                              }
-                            rle_pack_len[rowi] = GUINT16_FROM_BE (rle_pack_len[rowi]);
-                          }
-
-                        IFDBG(3) g_debug ("RLE decode - data");
-                        if (read_channel_data (lyr_chn[cidx], img_a->bps,
-                            PSD_COMP_RLE, rle_pack_len, f, error) < 1)
-                          return -1;
-
-                        g_free (rle_pack_len);
-                        break;
-
-                      case PSD_COMP_ZIP:                 /* ? */
-                      case PSD_COMP_ZIP_PRED:
-                      default:
-                        g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
-                                    _("Unsupported compression mode: %d"), comp_mode);
-                        return -1;
-                        break;
-                    }
-                }
-            }
-          g_free (lyr_a[lidx]->chn_info);
-
           /* Draw layer */
 
-          alpha = FALSE;
-          alpha_chn = -1;
-          user_mask = FALSE;
-          user_mask_chn = -1;
-          layer_channels = 0;
           l_x = 0;
           l_y = 0;
           l_w = img_a->columns;
@@ -1250,31 +1187,6 @@ add_layers (const gint32  image_id,
           parent_group_id = g_array_index (parent_group_stack, gint32,
                                            parent_group_stack->len-1);
 
-          IFDBG(3) g_debug ("Re-hash channel indices");
-          for (cidx = 0; cidx < lyr_a[lidx]->num_channels; ++cidx)
-            {
-              if (lyr_chn[cidx]->id == PSD_CHANNEL_MASK)
-                {
-                  user_mask = TRUE;
-                  user_mask_chn = cidx;
-                }
-              else if (lyr_chn[cidx]->id == PSD_CHANNEL_ALPHA)
-                {
-                  alpha = TRUE;
-                  alpha_chn = cidx;
-                }
-              else
-                {
-                  channel_idx[layer_channels] = cidx;   /* Assumes in sane order */
-                  layer_channels++;                     /* RGB, Lab, CMYK etc.   */
-                }
-            }
-          if (alpha)
-            {
-              channel_idx[layer_channels] = alpha_chn;
-              layer_channels++;
-            }
-
           if (lyr_a[lidx]->group_type != 0)
             {
               if (lyr_a[lidx]->group_type == 3)
@@ -1304,7 +1216,7 @@ add_layers (const gint32  image_id,
                   gimp_drawable_detach (drawable);
                 }
             }
-          else if (empty)
+          else if (job->empty)
             {
               IFDBG(2) g_debug ("Create blank layer");
               image_type = get_gimp_image_type (img_a->base_type, TRUE);
@@ -1331,17 +1243,8 @@ add_layers (const gint32  image_id,
               l_h = lyr_a[lidx]->bottom - lyr_a[lidx]->top;
 
               IFDBG(3) g_debug ("Draw layer");
-              image_type = get_gimp_image_type (img_a->base_type, alpha);
+              image_type = get_gimp_image_type (img_a->base_type, job->alpha);
               IFDBG(3) g_debug ("Layer type %d", image_type);
-              layer_size = l_w * l_h;
-              pixels = g_malloc (layer_size * layer_channels);
-              for (cidx = 0; cidx < layer_channels; ++cidx)
-                {
-                  IFDBG(3) g_debug ("Start channel %d", channel_idx[cidx]);
-                  for (i = 0; i < layer_size; ++i)
-                    pixels[(i * layer_channels) + cidx] = lyr_chn[channel_idx[cidx]]->data[i];
-                  g_free (lyr_chn[channel_idx[cidx]]->data);
-                }
 
               layer_mode = psd_to_gimp_blend_mode (lyr_a[lidx]->blend_mode);
               layer_id = gimp_layer_new (image_id, lyr_a[lidx]->name, l_w, l_h,
@@ -1352,23 +1255,19 @@ add_layers (const gint32  image_id,
               gimp_image_insert_layer (image_id, layer_id, parent_group_id, -1);
               gimp_layer_set_offsets (layer_id, l_x, l_y);
               gimp_layer_set_lock_alpha  (layer_id, lyr_a[lidx]->layer_flags.trans_prot);
-              drawable = gimp_drawable_get (layer_id);
-              gimp_pixel_rgn_init (&pixel_rgn, drawable, 0, 0,
-                                   drawable->width, drawable->height, TRUE, FALSE);
-              gimp_pixel_rgn_set_rect (&pixel_rgn, pixels,
-                                       0, 0, drawable->width, drawable->height);
-              gimp_item_set_visible (drawable->drawable_id, lyr_a[lidx]->layer_flags.visible);
+              buffer = gimp_drawable_get_buffer (layer_id);
+              gegl_buffer_set (buffer, GEGL_RECTANGLE (0, 0, l_w, l_h),
+                               0, NULL, job->pixels, GEGL_AUTO_ROWSTRIDE);
+              g_object_unref (buffer);
+              gimp_item_set_visible (layer_id, lyr_a[lidx]->layer_flags.visible);
               if (lyr_a[lidx]->id)
-                gimp_item_set_tattoo (drawable->drawable_id, lyr_a[lidx]->id);
-              gimp_drawable_flush (drawable);
-              gimp_drawable_detach (drawable);
-              g_free (pixels);
+                gimp_item_set_tattoo (layer_id, lyr_a[lidx]->id);
             }
 
           /* Layer mask */
-          if (user_mask && lyr_a[lidx]->group_type == 0)
+          if (job->user_mask && lyr_a[lidx]->group_type == 0)
             {
-              if (empty_mask)
+              if (job->empty_mask)
                 {
                   IFDBG(3) g_debug ("Create empty mask");
                   if (lyr_a[lidx]->layer_mask.def_color == 255)
@@ -1381,6 +1280,8 @@ add_layers (const gint32  image_id,
                 }
               else
                 {
+                  guint16 user_mask_chn = job->user_mask_chn;
+
                   /* Load layer mask data */
                   if (lyr_a[lidx]->layer_mask.mask_flags.relative_pos)
                     {
@@ -1400,7 +1301,7 @@ add_layers (const gint32  image_id,
                   IFDBG(3) g_debug ("Relative pos %d",
                                     lyr_a[lidx]->layer_mask.mask_flags.relative_pos);
                   layer_size = lm_w * lm_h;
-                  pixels = g_malloc (layer_size);
+                  pixels = g_malloc0 (layer_size);
                   IFDBG(3) g_debug ("Allocate Pixels %d", layer_size);
                   /* Crop mask at layer boundary */
                   IFDBG(3) g_debug ("Original Mask %d %d %d %d", lm_x, lm_y, lm_w, lm_h);
@@ -1445,9 +1346,8 @@ add_layers (const gint32  image_id,
                       if (lm_h + lm_y > l_h)
                         lm_h = l_h - lm_y;
                     }
-                  else
+                  else if (lyr_chn[user_mask_chn]->data)
                     memcpy (pixels, lyr_chn[user_mask_chn]->data, layer_size);
-                  g_free (lyr_chn[user_mask_chn]->data);
                   /* Draw layer mask data */
                   IFDBG(3) g_debug ("Layer %d %d %d %d", l_x, l_y, l_w, l_h);
                   IFDBG(3) g_debug ("Mask %d %d %d %d", lm_x, lm_y, lm_w, lm_h);
@@ -1459,28 +1359,321 @@ add_layers (const gint32  image_id,
 
                   IFDBG(3) g_debug ("New layer mask %d", mask_id);
                   gimp_layer_add_mask (layer_id, mask_id);
-                  drawable = gimp_drawable_get (mask_id);
-                  gimp_pixel_rgn_init (&pixel_rgn, drawable, 0 , 0,
-                                       drawable->width, drawable->height, TRUE, FALSE);
-                  gimp_pixel_rgn_set_rect (&pixel_rgn, pixels, lm_x, lm_y, lm_w, lm_h);
-                  gimp_drawable_flush (drawable);
-                  gimp_drawable_detach (drawable);
+                  if (lm_w > 0 && lm_h > 0)
+                    {
+                      buffer = gimp_drawable_get_buffer (mask_id);
+                      gegl_buffer_set (buffer,
+                                       GEGL_RECTANGLE (lm_x, lm_y, lm_w, lm_h),
+                                       0, NULL, pixels, GEGL_AUTO_ROWSTRIDE);
+                      g_object_unref (buffer);
+                    }
                   gimp_layer_set_apply_mask (layer_id,
                     ! lyr_a[lidx]->layer_mask.mask_flags.disabled);
                   g_free (pixels);
                 }
             }
-          for (cidx = 0; cidx < lyr_a[lidx]->num_channels; ++cidx)
-            if (lyr_chn[cidx])
-              g_free (lyr_chn[cidx]);
-          g_free (lyr_chn);
         }
+
+      free_layer_job (job);
+      jobs[lidx] = NULL;
       g_free (lyr_a[lidx]);
     }
   g_free (lyr_a);
+
+ out:
+  /* wait for the layers that were read ahead before an error */
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  for (lidx = 0; lidx < img_a->num_layers; ++lidx)
+    if (jobs[lidx])
+      free_layer_job (jobs[lidx]);
+
+  g_free (jobs);
   g_array_free (parent_group_stack, FALSE);
 
-  return 0;
+  return ret;
+}
+
+/* Reads the channel data of a layer, without decoding it yet */
+static PSDlayerjob *
+read_layer_data (PSDimage  *img_a,
+                 PSDlayer  *lyr_a,
+                 FILE      *f,
+                 GError   **error)
+{
+  PSDlayerjob  *job;
+  PSDchannel  **lyr_chn;
+  gint          cidx;
+  gint          rowi;
+
+  job = g_slice_new0 (PSDlayerjob);
+
+  job->lyr_a = lyr_a;
+  job->bps   = img_a->bps;
+
+  if (lyr_a->drop)
+    {
+      /* Step past layer data */
+      for (cidx = 0; cidx < lyr_a->num_channels; ++cidx)
+        {
+          if (fseek (f, lyr_a->chn_info[cidx].data_len, SEEK_CUR) < 0)
+            {
+              psd_set_error (feof (f), errno, error);
+              free_layer_job (job);
+              return NULL;
+            }
+        }
+      g_free (lyr_a->chn_info);
+      lyr_a->chn_info = NULL;
+
+      return job;
+    }
+
+  /* Empty layer */
+  if (lyr_a->bottom - lyr_a->top == 0
+      || lyr_a->right - lyr_a->left == 0)
+      job->empty = TRUE;
+  else
+      job->empty = FALSE;
+
+  /* Empty mask */
+  if (lyr_a->layer_mask.bottom - lyr_a->layer_mask.top == 0
+      || lyr_a->layer_mask.right - lyr_a->layer_mask.left == 0)
+      job->empty_mask = TRUE;
+  else
+      job->empty_mask = FALSE;
+
+  IFDBG(3) g_debug ("Empty mask %d, size %d %d", job->empty_mask,
+                    lyr_a->layer_mask.bottom - lyr_a->layer_mask.top,
+                    lyr_a->layer_mask.right - lyr_a->layer_mask.left);
+
+  /* Load layer channel data */
+  IFDBG(2) g_debug ("Number of channels: %d", lyr_a->num_channels);
+  /* Create pointer array for the channel records */
+  job->num_channels = lyr_a->num_channels;
+  job->lyr_chn      = lyr_chn = g_new0 (PSDchannel *, lyr_a->num_channels);
+  job->comp_mode    = g_new0 (guint16, lyr_a->num_channels);
+  job->rle_pack_len = g_new0 (guint16 *, lyr_a->num_channels);
+  job->raw_data     = g_new0 (gchar *, lyr_a->num_channels);
+
+  for (cidx = 0; cidx < lyr_a->num_channels; ++cidx)
+    {
+      guint16 comp_mode = PSD_COMP_RAW;
+
+      /* Allocate channel record */
+      lyr_chn[cidx] = g_new0 (PSDchannel, 1);
+
+      lyr_chn[cidx]->id = lyr_a->chn_info[cidx].channel_id;
+      lyr_chn[cidx]->rows = lyr_a->bottom - lyr_a->top;
+      lyr_chn[cidx]->columns = lyr_a->right - lyr_a->left;
+
+      if (lyr_chn[cidx]->id == PSD_CHANNEL_MASK)
+        {
+          /* Works around a bug in panotools psd files where the layer mask
+             size is given as 0 but data exists. Set mask size to layer size.
+          */
+          if (job->empty_mask && lyr_a->chn_info[cidx].data_len - 2 > 0)
+            {
+              job->empty_mask = FALSE;
+              if (lyr_a->layer_mask.top == lyr_a->layer_mask.bottom)
+                {
+                  lyr_a->layer_mask.top = lyr_a->top;
+                  lyr_a->layer_mask.bottom = lyr_a->bottom;
+                }
+              if (lyr_a->layer_mask.right == lyr_a->layer_mask.left)
+                {
+                  lyr_a->layer_mask.right = lyr_a->right;
+                  lyr_a->layer_mask.left = lyr_a->left;
+                }
+            }
+          lyr_chn[cidx]->rows = (lyr_a->layer_mask.bottom -
+                                lyr_a->layer_mask.top);
+          lyr_chn[cidx]->columns = (lyr_a->layer_mask.right -
+                                   lyr_a->layer_mask.left);
+        }
+
+      IFDBG(3) g_debug ("Channel id %d, %dx%d",
+                        lyr_chn[cidx]->id,
+                        lyr_chn[cidx]->columns,
+                        lyr_chn[cidx]->rows);
+
+      /* Only read channel data if there is any channel
+       * data. Note that the channel data can contain a
+       * compression method but no actual data.
+       */
+      if (lyr_a->chn_info[cidx].data_len >= COMP_MODE_SIZE)
+        {
+          if (fread (&comp_mode, COMP_MODE_SIZE, 1, f) < 1)
+            {
+              psd_set_error (feof (f), errno, error);
+              free_layer_job (job);
+              return NULL;
+            }
+          comp_mode = GUINT16_FROM_BE (comp_mode);
+          IFDBG(3) g_debug ("Compression mode: %d", comp_mode);
+        }
+      if (lyr_a->chn_info[cidx].data_len > COMP_MODE_SIZE)
+        {
+          guint16 *rle_pack_len = NULL;
+
+          switch (comp_mode)
+            {
+              case PSD_COMP_RAW:        /* Planar raw data */
+                IFDBG(3) g_debug ("Raw data length: %d",
+                                  lyr_a->chn_info[cidx].data_len - 2);
+                break;
+
+              case PSD_COMP_RLE:        /* Packbits */
+                IFDBG(3) g_debug ("RLE channel length %d, RLE length data: %d, "
+                                  "RLE data block: %d",
+                                  lyr_a->chn_info[cidx].data_len - 2,
+                                  lyr_chn[cidx]->rows * 2,
+                                  (lyr_a->chn_info[cidx].data_len - 2 -
+                                   lyr_chn[cidx]->rows * 2));
+                rle_pack_len = g_malloc (lyr_chn[cidx]->rows * 2);
+                job->rle_pack_len[cidx] = rle_pack_len;
+                for (rowi = 0; rowi < lyr_chn[cidx]->rows; ++rowi)
+                  {
+                    if (fread (&rle_pack_len[rowi], 2, 1, f) < 1)
+                      {
+                        psd_set_error (feof (f), errno, error);
+                        free_layer_job (job);
+                        return NULL;
+                      }
+                    rle_pack_len[rowi] = GUINT16_FROM_BE (rle_pack_len[rowi]);
+                  }
+                break;
+
+              case PSD_COMP_ZIP:                 /* ? */
+              case PSD_COMP_ZIP_PRED:
+              default:
+                g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
+                            _("Unsupported compression mode: %d"), comp_mode);
+                free_layer_job (job);
+                return NULL;
+                break;
+            }
+
+          job->comp_mode[cidx] = comp_mode;
+          job->raw_data[cidx]  = read_channel_raw_data (lyr_chn[cidx],
+                                                        img_a->bps,
+                                                        comp_mode,
+                                                        rle_pack_len,
+                                                        f, error);
+          if (! job->raw_data[cidx])
+            {
+              free_layer_job (job);
+              return NULL;
+            }
+        }
+    }
+  g_free (lyr_a->chn_info);
+  lyr_a->chn_info = NULL;
+
+  IFDBG(3) g_debug ("Re-hash channel indices");
+  for (cidx = 0; cidx < lyr_a->num_channels; ++cidx)
+    {
+      if (lyr_chn[cidx]->id == PSD_CHANNEL_MASK)
+        {
+          job->user_mask = TRUE;
+          job->user_mask_chn = cidx;
+        }
+      else if (lyr_chn[cidx]->id == PSD_CHANNEL_ALPHA)
+        {
+          job->alpha = TRUE;
+          job->alpha_chn = cidx;
+        }
+      else
+        {
+          job->channel_idx[job->layer_channels] = cidx;   /* Assumes in sane order */
+          job->layer_channels++;                          /* RGB, Lab, CMYK etc.   */
+        }
+    }
+  if (job->alpha)
+    {
+      job->channel_idx[job->layer_channels] = job->alpha_chn;
+      job->layer_channels++;
+    }
+
+  return job;
+}
+
+/* Decodes the channels of a layer and interleaves the layer pixels,
+ * runs in a worker thread
+ */
+static void
+decode_layer_job (PSDlayerjob *job,
+                  gpointer     data)
+{
+  PSDlayer *lyr_a = job->lyr_a;
+  gint      cidx;
+  gint      i;
+
+  for (cidx = 0; cidx < job->num_channels; ++cidx)
+    {
+      if (job->raw_data[cidx])
+        {
+          decode_channel_data (job->lyr_chn[cidx], job->bps,
+                               job->comp_mode[cidx],
+                               job->rle_pack_len[cidx],
+                               job->raw_data[cidx]);
+
+          g_free (job->raw_data[cidx]);
+          job->raw_data[cidx] = NULL;
+        }
+    }
+
+  if (! lyr_a->drop && lyr_a->group_type == 0 && ! job->empty)
+    {
+      gint32 layer_size = ((lyr_a->right - lyr_a->left) *
+                           (lyr_a->bottom - lyr_a->top));
+
+      job->pixels = g_malloc0 (layer_size * job->layer_channels);
+
+      for (cidx = 0; cidx < job->layer_channels; ++cidx)
+        {
+          PSDchannel *channel = job->lyr_chn[job->channel_idx[cidx]];
+
+          IFDBG(3) g_debug ("Start channel %d", job->channel_idx[cidx]);
+          if (channel->data)
+            {
+              for (i = 0; i < layer_size; ++i)
+                job->pixels[(i * job->layer_channels) + cidx] = channel->data[i];
+            }
+          g_free (channel->data);
+          channel->data = NULL;
+        }
+    }
+
+  g_mutex_lock (&layer_job_mutex);
+  job->done = TRUE;
+  g_cond_broadcast (&layer_job_cond);
+  g_mutex_unlock (&layer_job_mutex);
+}
+
+static void
+free_layer_job (PSDlayerjob *job)
+{
+  gint cidx;
+
+  for (cidx = 0; cidx < job->num_channels; ++cidx)
+    {
+      if (job->lyr_chn[cidx])
+        {
+          g_free (job->lyr_chn[cidx]->data);
+          g_free (job->lyr_chn[cidx]);
+        }
+      g_free (job->rle_pack_len[cidx]);
+      g_free (job->raw_data[cidx]);
+    }
+
+  g_free (job->lyr_chn);
+  g_free (job->comp_mode);
+  g_free (job->rle_pack_len);
+  g_free (job->raw_data);
+  g_free (job->pixels);
+
+  g_slice_free (PSDlayerjob, job);
 }
 
 static gint
@@ -1858,11 +2051,34 @@ read_channel_data (PSDchannel     *channel,
                    const guint16  *rle_pack_len,
                    FILE           *f,
                    GError        **error)
+{
+  gchar *raw_data;
+
+  raw_data = read_channel_raw_data (channel, bps, compression, rle_pack_len,
+                                    f, error);
+  if (! raw_data)
+    return -1;
+
+  decode_channel_data (channel, bps, compression, rle_pack_len, raw_data);
+  g_free (raw_data);
+
+  return 1;
+}
+
+/* Reads the channel data as stored in the file, the packed scanlines
+ * of RLE compressed channels are read as a single block
+ */
+static gchar *
+read_channel_raw_data (PSDchannel     *channel,
+                       const guint16   bps,
+                       const guint16   compression,
+                       const guint16  *rle_pack_len,
+                       FILE           *f,
+                       GError        **error)
 {
   gchar    *raw_data;
-  gchar    *src;
-  gchar    *dst;
   guint32   readline_len;
+  gsize     raw_len = 0;
   gint      i;
 
   if (bps == 1)
@@ -1879,46 +2095,72 @@ read_channel_data (PSDchannel     *channel,
     {
       g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_FAILED,
                    _("Unsupported or invalid channel size"));
-      return -1;
+      return NULL;
     }
 
-  raw_data = g_malloc (readline_len * channel->rows);
   switch (compression)
     {
       case PSD_COMP_RAW:
-        if (fread (raw_data, readline_len, channel->rows, f) < 1)
-          {
-            psd_set_error (feof (f), errno, error);
-            return -1;
-          }
+        raw_len = readline_len * channel->rows;
         break;
 
       case PSD_COMP_RLE:
         for (i = 0; i < channel->rows; ++i)
-          {
-            src = g_malloc (rle_pack_len[i]);
-            dst = g_malloc (readline_len);
+          raw_len += rle_pack_len[i];
+        break;
+    }
+
 /*      FIXME check for over-run
-            if (ftell (f) + rle_pack_len[i] > block_end)
-              {
-                psd_set_error (TRUE, errno, error);
-                return -1;
-              }
+  if (ftell (f) + raw_len > block_end)
+    {
+      psd_set_error (TRUE, errno, error);
+      return NULL;
+    }
 */
-            if (fread (src, rle_pack_len[i], 1, f) < 1)
-              {
-                psd_set_error (feof (f), errno, error);
-                g_free (src);
-                g_free (dst);
-                return -1;
-              }
-            /* FIXME check for errors returned from decode packbits */
-            decode_packbits (src, dst, rle_pack_len[i], readline_len);
-            g_free (src);
-            memcpy (raw_data + i * readline_len, dst, readline_len);
-            g_free (dst);
-          }
-        break;
+  raw_data = g_malloc (raw_len);
+  if (fread (raw_data, raw_len, 1, f) < 1)
+    {
+      psd_set_error (feof (f), errno, error);
+      g_free (raw_data);
+      return NULL;
+    }
+
+  return raw_data;
+}
+
+/* Decodes channel data read by read_channel_raw_data() into GIMP
+ * format, does no file or PDB access so it can run in any thread
+ */
+static void
+decode_channel_data (PSDchannel     *channel,
+                     const guint16   bps,
+                     const guint16   compression,
+                     const guint16  *rle_pack_len,
+                     const gchar    *raw_data)
+{
+  const gchar *src;
+  gchar       *unpacked = NULL;
+  guint32      readline_len;
+  gint         i;
+
+  if (bps == 1)
+    readline_len = ((channel->columns + 7) >> 3);
+  else
+    readline_len = (channel->columns * bps >> 3);
+
+  if (compression == PSD_COMP_RLE)
+    {
+      unpacked = g_malloc (readline_len * channel->rows);
+
+      for (i = 0, src = raw_data; i < channel->rows; ++i)
+        {
+          /* FIXME check for errors returned from decode packbits */
+          decode_packbits (src, unpacked + i * readline_len,
+                           rle_pack_len[i], readline_len);
+          src += rle_pack_len[i];
+        }
+
+      raw_data = unpacked;
     }
 
   /* Convert channel data to GIMP format */
@@ -1940,9 +2182,7 @@ read_channel_data (PSDchannel     *channel,
         break;
     }
 
-  g_free (raw_data);
-
-  return 1;
+  g_free (unpacked);
 }
 
 static void
@@ -168,6 +168,25 @@ uri_backend_map_image (const gchar  *uri,
   if (success)
     path = g_file_get_path (file);
 
+  /*  GVfs maps the files of mounted locations into its FUSE directory,
+   *  where the loaders and savers can read and write them directly, in
+   *  one pass and without a local copy.  The path is returned even if
+   *  the FUSE daemon isn't running, so only use it if the file's folder
+   *  is really there, and fall back to copying otherwise.
+   */
+  if (path && ! g_file_is_native (file))
+    {
+      gchar *dirname = g_path_get_dirname (path);
+
+      if (! g_file_test (dirname, G_FILE_TEST_IS_DIR))
+        {
+          g_free (path);
+          path = NULL;
+        }
+
+      g_free (dirname);
+    }
+
   g_object_unref (file);
 
   return path;
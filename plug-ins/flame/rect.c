@@ -66,6 +66,107 @@ typedef accum_t abucket[4];
    if (tt_ > dest) dest = tt_;                 \
 }
 
+/* the samples of a batch are generated by this many independent
+   streams at most, each with its own random numbers and histogram;
+   the histograms of all the streams together may use this much memory */
+#define MAX_STREAMS_MEMORY (1 << 29)
+
+
+typedef struct
+{
+  control_point *cp;
+  bucket        *cmap;
+  double        *bounds;
+  double        *size;
+  int            width;
+  int            height;
+  int            n_sub_batches;
+
+  GMutex         mutex;
+  GCond          cond;
+  int            n_done;
+} render_context;
+
+typedef struct
+{
+  render_context *context;
+  int             index;
+  int             n_streams;
+  GRand          *rand;
+  point          *points;
+  bucket         *buckets;
+} render_stream;
+
+
+/* generate every n_streams'th sub_batch of samples into
+   the stream's buckets */
+static void
+render_stream_run (render_stream *stream,
+                   gpointer       data)
+{
+  render_context *context       = stream->context;
+  control_point  *cp            = context->cp;
+  bucket         *cmap          = context->cmap;
+  double         *bounds        = context->bounds;
+  double         *size          = context->size;
+  int             width         = context->width;
+  int             height        = context->height;
+  int             n_sub_batches = context->n_sub_batches;
+  int             n_streams     = stream->n_streams;
+  point          *points        = stream->points;
+  bucket         *buckets       = stream->buckets;
+  int             sub_batch;
+  int             j;
+
+  for (sub_batch = stream->index;
+       sub_batch < n_sub_batches;
+       sub_batch += n_streams)
+    {
+      /* generate a sub_batch_size worth of samples */
+      points[0][0] = g_rand_double_range (stream->rand, -1, 1);
+      points[0][1] = g_rand_double_range (stream->rand, -1, 1);
+      points[0][2] = g_rand_double (stream->rand);
+      iterate (cp, SUB_BATCH_SIZE, FUSE, points, stream->rand);
+
+      /* merge them into buckets, looking up colors */
+      for (j = 0; j < SUB_BATCH_SIZE; j++)
+        {
+          int k, color_index;
+          double *p = points[j];
+          bucket *b;
+
+          /* Note that we must test if p[0] and p[1] is "within"
+           * the valid bounds rather than "not outside", because
+           * p[0] and p[1] might be NaN.
+           */
+          if (p[0] >= bounds[0] &&
+              p[1] >= bounds[1] &&
+              p[0] <= bounds[2] &&
+              p[1] <= bounds[3])
+            {
+              color_index = (int) (p[2] * CMAP_SIZE);
+
+              if (color_index < 0)
+                color_index = 0;
+              else if (color_index > CMAP_SIZE - 1)
+                color_index = CMAP_SIZE - 1;
+
+              b = buckets +
+                  (int) (width * (p[0] - bounds[0]) * size[0]) +
+                  width * (int) (height * (p[1] - bounds[1]) * size[1]);
+
+              for (k = 0; k < 4; k++)
+                bump_no_overflow(b[0][k], cmap[color_index][k], short);
+            }
+        }
+
+      g_mutex_lock (&context->mutex);
+      context->n_done++;
+      g_cond_signal (&context->cond);
+      g_mutex_unlock (&context->mutex);
+    }
+}
+
 /* sum of entries of vector to 1 */
 static void
 normalize_vector(double *v,
@@ -88,7 +189,7 @@ render_rectangle (frame_spec    *spec,
                   int            nchan,
                   int progress(double))
 {
-  int      i, j, k, nsamples, nbuckets, batch_size, batch_num, sub_batch;
+  int      i, j, k, nsamples, nbuckets, batch_size, batch_num;
   bucket  *buckets;
   abucket *accumulate;
   point   *points;
@@ -102,6 +203,10 @@ render_rectangle (frame_spec    *spec,
   bucket   cmap[CMAP_SIZE];
   int      gutter_width;
   int      sbc;
+  render_context  context;
+  render_stream  *streams;
+  GThreadPool    *pool;
+  int             n_streams, n_active;
 
   image_width = spec->cps[0].width;
   if (field)
@@ -187,6 +292,37 @@ render_rectangle (frame_spec    *spec,
       points = (point *)  (last_block + (sizeof (bucket) + sizeof (abucket)) * nbuckets);
     }
 
+  n_streams = MAX_STREAMS_MEMORY / ((gsize) sizeof (bucket) * nbuckets);
+  n_streams = CLAMP (n_streams, 1, g_get_num_processors ());
+
+  context.cmap   = cmap;
+  context.width  = width;
+  context.height = height;
+  g_mutex_init (&context.mutex);
+  g_cond_init (&context.cond);
+
+  streams = g_new0 (render_stream, n_streams);
+  for (i = 0; i < n_streams; i++)
+    {
+      streams[i].context = &context;
+      streams[i].index   = i;
+      streams[i].rand    = g_rand_new_with_seed (g_random_int ());
+
+      if (i == 0)
+        {
+          streams[i].points  = points;
+          streams[i].buckets = buckets;
+        }
+      else
+        {
+          streams[i].points  = g_new (point, SUB_BATCH_SIZE);
+          streams[i].buckets = g_new (bucket, nbuckets);
+        }
+    }
+
+  pool = g_thread_pool_new ((GFunc) render_stream_run, NULL,
+                            n_streams, FALSE, NULL);
+
   memset ((char *) accumulate, 0, sizeof (abucket) * nbuckets);
   for (batch_num = 0; batch_num < nbatches; batch_num++)
     {
@@ -254,50 +390,60 @@ render_rectangle (frame_spec    *spec,
                         (oversample * oversample));
       batch_size = nsamples / cp.nbatches;
 
+      /* let the streams generate the batch's samples, each into its
+         own histogram */
+      context.cp            = &cp;
+      context.bounds        = bounds;
+      context.size          = size;
+      context.n_sub_batches = ((batch_size + SUB_BATCH_SIZE - 1) /
+                               SUB_BATCH_SIZE);
+      context.n_done        = 0;
+
+      n_active = MIN (n_streams, context.n_sub_batches);
+
+      for (i = 0; i < n_active; i++)
+        {
+          if (i > 0)
+            memset ((char *) streams[i].buckets, 0, sizeof (bucket) * nbuckets);
+
+          streams[i].n_streams = n_active;
+
+          g_thread_pool_push (pool, &streams[i], NULL);
+        }
+
       sbc = 0;
-      for (sub_batch = 0;
-           sub_batch < batch_size;
-           sub_batch += SUB_BATCH_SIZE)
+      g_mutex_lock (&context.mutex);
+      while (context.n_done < context.n_sub_batches)
         {
-          if (progress && (sbc++ % 32) == 0)
-              (*progress)(0.5 * sub_batch / (double) batch_size);
-          /* generate a sub_batch_size worth of samples */
-          points[0][0] = random_uniform11 ();
-          points[0][1] = random_uniform11 ();
-          points[0][2] = random_uniform01 ();
-          iterate (&cp, SUB_BATCH_SIZE, FUSE, points);
-
-          /* merge them into buckets, looking up colors */
-          for (j = 0; j < SUB_BATCH_SIZE; j++)
+          int n_done;
+
+          if (progress && context.n_done >= sbc)
             {
-              int k, color_index;
-              double *p = points[j];
-              bucket *b;
+              n_done = context.n_done;
+              sbc = n_done + 32;
 
-              /* Note that we must test if p[0] and p[1] is "within"
-               * the valid bounds rather than "not outside", because
-               * p[0] and p[1] might be NaN.
-               */
-              if (p[0] >= bounds[0] &&
-                  p[1] >= bounds[1] &&
-                  p[0] <= bounds[2] &&
-                  p[1] <= bounds[3])
-                {
-                  color_index = (int) (p[2] * CMAP_SIZE);
+              g_mutex_unlock (&context.mutex);
+              (*progress)(0.5 * n_done * SUB_BATCH_SIZE / (double) batch_size);
+              g_mutex_lock (&context.mutex);
+              continue;
+            }
+
+          g_cond_wait (&context.cond, &context.mutex);
+        }
+      g_mutex_unlock (&context.mutex);
 
-                  if (color_index < 0)
-                    color_index = 0;
-                  else if (color_index > CMAP_SIZE - 1)
-                    color_index = CMAP_SIZE - 1;
+      /* merge the streams' histograms */
+      for (i = 1; i < n_active; i++)
+        {
+          bucket *s = streams[i].buckets;
 
-                  b = buckets +
-                      (int) (width * (p[0] - bounds[0]) * size[0]) +
-                      width * (int) (height * (p[1] - bounds[1]) * size[1]);
+          for (j = 0; j < nbuckets; j++)
+            for (k = 0; k < 4; k++)
+              {
+                int t = buckets[j][k] + s[j][k];
 
-                  for (k = 0; k < 4; k++)
-                    bump_no_overflow(b[0][k], cmap[color_index][k], short);
-                }
-            }
+                buckets[j][k] = MIN (t, G_MAXSHORT);
+              }
         }
 
       if (1)
@@ -391,6 +537,23 @@ render_rectangle (frame_spec    *spec,
         }
     }
 
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  for (i = 0; i < n_streams; i++)
+    {
+      g_rand_free (streams[i].rand);
+
+      if (i > 0)
+        {
+          g_free (streams[i].points);
+          g_free (streams[i].buckets);
+        }
+    }
+  g_free (streams);
+
+  g_mutex_clear (&context.mutex);
+  g_cond_clear (&context.cond);
+
   free (filter);
   free (temporal_filter);
   free (temporal_deltas);
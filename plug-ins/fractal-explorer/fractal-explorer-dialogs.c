@@ -97,6 +97,11 @@ static void create_save_file_chooser   (GtkWidget      *widget,
 static void cmap_preview_size_allocate (GtkWidget      *widget,
                                         GtkAllocation  *allocation);
 
+static void dialog_preview_band        (const guchar   *buf,
+                                        gint            row,
+                                        gint            n_rows,
+                                        gpointer        data);
+
 /**********************************************************************
  CALLBACKS
  *********************************************************************/
@@ -1220,12 +1225,19 @@ explorer_dialog (void)
  FUNCTION: dialog_update_preview
  *********************************************************************/
 
+static void
+dialog_preview_band (const guchar *buf,
+                     gint          row,
+                     gint          n_rows,
+                     gpointer      data)
+{
+  memcpy (wint.wimage + row * preview_width * 3, buf,
+          n_rows * preview_width * 3);
+}
+
 void
 dialog_update_preview (void)
 {
-  gint     ycoord;
-  guchar  *p_ul;
-
   if (NULL == wint.preview)
     return;
 
@@ -1240,17 +1252,8 @@ dialog_update_preview (void)
       xdiff = (xmax - xmin) / xbild;
       ydiff = (ymax - ymin) / ybild;
 
-      p_ul = wint.wimage;
-
-      for (ycoord = 0; ycoord < preview_height; ycoord++)
-        {
-          explorer_render_row (NULL,
-                               p_ul,
-                               ycoord,
-                               preview_width,
-                               3);
-          p_ul += preview_width * 3;
-        }
+      explorer_render (0, preview_height, preview_width, 3,
+                       dialog_preview_band, NULL);
 
       preview_redraw ();
     }
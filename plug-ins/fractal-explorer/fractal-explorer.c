@@ -134,6 +134,22 @@ explorer_vals_t wvals =
 fractalexplorerOBJ *current_obj   = NULL;
 static GtkWidget   *delete_dialog = NULL;
 
+/* The fractal is rendered in bands of rows, one per thread */
+#define BAND_HEIGHT 16
+
+typedef struct
+{
+  guchar   *buf;
+  gint      y1;
+  gint      y2;
+  gint      row_width;
+  gint      bpp;
+  gboolean  done;
+} RenderBand;
+
+static GMutex band_mutex;
+static GCond  band_cond;
+
 static void query (void);
 static void run   (const gchar      *name,
                    gint              nparams,
@@ -141,7 +157,13 @@ static void run   (const gchar      *name,
                    gint             *nreturn_vals,
                    GimpParam       **return_vals);
 
-static void explorer            (GimpDrawable *drawable);
+static void explorer             (GimpDrawable *drawable);
+static void explorer_write_band  (const guchar *buf,
+                                  gint          row,
+                                  gint          n_rows,
+                                  GimpPixelRgn *destPR);
+static void explorer_render_band (RenderBand   *band,
+                                  gpointer      data);
 
 /**********************************************************************
  Declare local functions
@@ -397,18 +419,14 @@ run (const gchar      *name,
 static void
 explorer (GimpDrawable * drawable)
 {
-  GimpPixelRgn  srcPR;
   GimpPixelRgn  destPR;
   gint          width;
   gint          height;
   gint          bpp;
-  gint          row;
   gint          x1;
   gint          y1;
   gint          x2;
   gint          y2;
-  guchar       *src_row;
-  guchar       *dest_row;
 
   /* Get the input area. This is the bounding box of the selection in
    *  the image (or the entire image if there is no selection). Only
@@ -425,13 +443,9 @@ explorer (GimpDrawable * drawable)
   height = drawable->height;
   bpp  = drawable->bpp;
 
-  /*  allocate row buffers  */
-  src_row  = g_new (guchar, bpp * (x2 - x1));
-  dest_row = g_new (guchar, bpp * (x2 - x1));
-
-  /*  initialize the pixel regions  */
-  gimp_pixel_rgn_init (&srcPR, drawable, 0, 0, width, height, FALSE, FALSE);
-  gimp_pixel_rgn_init (&destPR, drawable, 0, 0, width, height, TRUE, TRUE);
+  /*  initialize the pixel region  */
+  gimp_pixel_rgn_init (&destPR, drawable,
+                       x1, y1, x2 - x1, y2 - y1, TRUE, TRUE);
 
   xbild = width;
   ybild = height;
@@ -448,31 +462,142 @@ explorer (GimpDrawable * drawable)
                                             colormap[i].b);
     }
 
-  for (row = y1; row < y2; row++)
-    {
-      gimp_pixel_rgn_get_row (&srcPR, src_row, x1, row, (x2 - x1));
-
-      explorer_render_row (src_row,
-                           dest_row,
-                           row,
-                           (x2 - x1),
-                           bpp);
+  explorer_render (y1, y2, x2 - x1, bpp,
+                   (ExplorerRenderFunc) explorer_write_band, &destPR);
 
-      /*  store the dest  */
-      gimp_pixel_rgn_set_row (&destPR, dest_row, x1, row, (x2 - x1));
-
-      if ((row % 10) == 0)
-        gimp_progress_update ((double) row / (double) (y2 - y1));
-    }
   gimp_progress_update (1.0);
 
   /*  update the processed region  */
   gimp_drawable_flush (drawable);
   gimp_drawable_merge_shadow (drawable->drawable_id, TRUE);
   gimp_drawable_update (drawable->drawable_id, x1, y1, (x2 - x1), (y2 - y1));
+}
+
+static void
+explorer_write_band (const guchar *buf,
+                     gint          row,
+                     gint          n_rows,
+                     GimpPixelRgn *destPR)
+{
+  gimp_pixel_rgn_set_rect (destPR, buf,
+                           destPR->x, row, destPR->w, n_rows);
 
-  g_free (src_row);
-  g_free (dest_row);
+  gimp_progress_update ((gdouble) (row + n_rows - destPR->y) /
+                        (gdouble) destPR->h);
+}
+
+/**********************************************************************
+ FUNCTION: explorer_render
+ *********************************************************************/
+
+/* Renders the rows y1 to y2 - 1 in bands of BAND_HEIGHT rows, on all
+ * processors.  The bands are passed to func, in order, on the calling
+ * thread, so func may use libgimp or GTK+.
+ */
+void
+explorer_render (gint               y1,
+                 gint               y2,
+                 gint               row_width,
+                 gint               bpp,
+                 ExplorerRenderFunc func,
+                 gpointer           data)
+{
+  GThreadPool *pool;
+  RenderBand  *bands;
+  gint         n_threads = g_get_num_processors ();
+  gint         n_bands;
+  gint         n_slots;
+  gint         i;
+
+  if (y2 <= y1 || row_width <= 0)
+    return;
+
+  n_bands = (y2 - y1 + BAND_HEIGHT - 1) / BAND_HEIGHT;
+
+  /*  keep only a few bands in memory, final renders can be huge  */
+  n_slots = MIN (2 * n_threads, n_bands);
+
+  bands = g_new0 (RenderBand, n_slots);
+  pool  = g_thread_pool_new ((GFunc) explorer_render_band, NULL,
+                             n_threads, FALSE, NULL);
+
+  for (i = 0; i < n_slots; i++)
+    {
+      bands[i].buf       = g_new (guchar, BAND_HEIGHT * row_width * bpp);
+      bands[i].row_width = row_width;
+      bands[i].bpp       = bpp;
+    }
+
+  for (i = 0; i < n_bands + n_slots; i++)
+    {
+      /*  wait for the band pushed n_slots bands ago and hand it out  */
+      if (i >= n_slots)
+        {
+          RenderBand *band = &bands[(i - n_slots) % n_slots];
+
+          g_mutex_lock (&band_mutex);
+          while (! band->done)
+            g_cond_wait (&band_cond, &band_mutex);
+          g_mutex_unlock (&band_mutex);
+
+          func (band->buf, band->y1, band->y2 - band->y1, data);
+        }
+
+      if (i < n_bands)
+        {
+          RenderBand *band = &bands[i % n_slots];
+
+          band->y1   = y1 + i * BAND_HEIGHT;
+          band->y2   = MIN (band->y1 + BAND_HEIGHT, y2);
+          band->done = FALSE;
+
+          g_thread_pool_push (pool, band, NULL);
+        }
+    }
+
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  for (i = 0; i < n_slots; i++)
+    g_free (bands[i].buf);
+
+  g_free (bands);
+}
+
+static void
+explorer_render_band (RenderBand *band,
+                      gpointer    data)
+{
+  gint rowstride = band->row_width * band->bpp;
+  gint row;
+
+  for (row = band->y1; row < band->y2; row++)
+    explorer_render_row (NULL,
+                         band->buf + (row - band->y1) * rowstride,
+                         row,
+                         band->row_width,
+                         band->bpp);
+
+  g_mutex_lock (&band_mutex);
+  band->done = TRUE;
+  g_cond_signal (&band_cond);
+  g_mutex_unlock (&band_mutex);
+}
+
+/* Points in the main cardioid or in the period-2 bulb of the
+ * Mandelbrot set never escape.
+ */
+static inline gboolean
+explorer_mandelbrot_interior (gdouble a,
+                              gdouble b)
+{
+  gdouble q;
+
+  q = (a - 0.25) * (a - 0.25) + b * b;
+
+  if (q * (q + (a - 0.25)) <= 0.25 * b * b)
+    return TRUE;
+
+  return (a + 1.0) * (a + 1.0) + b * b <= 0.0625;
 }
 
 /**********************************************************************
@@ -510,6 +635,11 @@ explorer_render_row (const guchar *src_row,
   gint    iteration;
   gint    useloglog;
   gdouble log2;
+  gdouble periodx;
+  gdouble periody;
+  gint    period;
+  gint    period_len;
+  gint    check_period;
 
   cx = wvals.cx;
   cy = wvals.cy;
@@ -517,10 +647,17 @@ explorer_render_row (const guchar *src_row,
   iteration = wvals.iter;
   log2 = log (2.0);
 
+  /*  The orbits of these only depend on the last point, an orbit that
+   *  returns exactly to an earlier point will never escape.
+   */
+  check_period = (wvals.fractaltype == TYPE_MANDELBROT ||
+                  wvals.fractaltype == TYPE_JULIA);
+
+  b = ymin + (double) row * ydiff;
+
   for (col = 0; col < row_width; col++)
     {
       a = xmin + (double) col * xdiff;
-      b = ymin + (double) row * ydiff;
       if (wvals.fractaltype != 0)
         {
           tmpx = x = a;
@@ -532,7 +669,18 @@ explorer_render_row (const guchar *src_row,
           y = 0;
         }
 
-      for (counter = 0; counter < iteration; counter++)
+      periodx    = x;
+      periody    = y;
+      period     = 0;
+      period_len = 8;
+
+      if (wvals.fractaltype == TYPE_MANDELBROT &&
+          explorer_mandelbrot_interior (a, b))
+        counter = iteration;
+      else
+        counter = 0;
+
+      for (; counter < iteration; counter++)
         {
           oldx=x;
           oldy=y;
@@ -645,6 +793,23 @@ explorer_render_row (const guchar *src_row,
 
           if (((x * x) + (y * y)) >= 4.0)
             break;
+
+          if (check_period)
+            {
+              if (x == periodx && y == periody)
+                {
+                  counter = iteration;
+                  break;
+                }
+
+              if (++period == period_len)
+                {
+                  periodx    = x;
+                  periody    = y;
+                  period     = 0;
+                  period_len *= 2;
+                }
+            }
         }
 
       if (useloglog)
@@ -208,9 +208,20 @@ extern GimpDrawable   *drawable;
   Global functions
  *********************************************************************/
 
-void explorer_render_row (const guchar *src_row,
-                          guchar       *dest_row,
-                          gint          row,
-                          gint          row_width,
-                          gint          bpp);
+typedef void (* ExplorerRenderFunc) (const guchar *buf,
+                                     gint          row,
+                                     gint          n_rows,
+                                     gpointer      data);
+
+void explorer_render     (gint                y1,
+                          gint                y2,
+                          gint                row_width,
+                          gint                bpp,
+                          ExplorerRenderFunc  func,
+                          gpointer            data);
+void explorer_render_row (const guchar       *src_row,
+                          guchar             *dest_row,
+                          gint                row,
+                          gint                row_width,
+                          gint                bpp);
 #endif
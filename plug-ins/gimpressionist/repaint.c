@@ -36,8 +36,34 @@
 
 #include <libgimp/stdplugins-intl.h>
 
+/* A brush stroke, recorded before it is applied */
+typedef struct
+{
+  int n;          /* index of the brush */
+  int tx, ty;     /* top left corner    */
+  int r, g, b;    /* color              */
+} stamp_t;
+
+/* The strokes are applied in parallel, each thread applies all of
+ * them, in order, to its own band of rows.
+ */
+typedef struct
+{
+  const stamp_t *stamps;
+  int            num_stamps;
+  ppm_t         *brushes;
+  ppm_t         *shadows;
+  ppm_t         *p;
+  ppm_t         *a;
+  int            y1, y2;
+  gboolean       done;
+} stamp_band_t;
+
 static gimpressionist_vals_t runningvals;
 
+static GMutex band_mutex;
+static GCond  band_cond;
+
 static double
 get_siz_from_pcvals (double x, double y)
 {
@@ -224,11 +250,13 @@ choose_best_brush (ppm_t *p, ppm_t *a, int tx, int ty,
   return best;
 }
 
+/* Only the rows y1 to y2 - 1 of p and a are painted */
 static void
 apply_brush (ppm_t *brush,
              ppm_t *shadow,
              ppm_t *p, ppm_t *a,
-             int tx, int ty, int r, int g, int b)
+             int tx, int ty, int r, int g, int b,
+             int y1, int y2)
 {
   ppm_t  tmp;
   ppm_t  atmp;
@@ -255,9 +283,9 @@ apply_brush (ppm_t *brush,
         {
           guchar *row, *arow = NULL;
 
-          if ((sy + y) < 0)
+          if ((sy + y) < MAX (y1, 0))
             continue;
-          if ((sy + y) >= tmp.height)
+          if ((sy + y) >= MIN (y2, tmp.height))
             break;
           row = tmp.col + (sy + y) * tmp.width * 3;
 
@@ -288,7 +316,7 @@ apply_brush (ppm_t *brush,
         }
     }
 
-  for (y = 0; y < brush->height; y++)
+  for (y = MAX (0, y1 - ty); y < MIN (brush->height, y2 - ty); y++)
     {
       guchar *row = tmp.col + (ty + y) * tmp.width * 3;
       guchar *arow = NULL;
@@ -327,7 +355,7 @@ apply_brush (ppm_t *brush,
 
   if (relief > 0.001)
     {
-      for (y = 1; y < brush->height; y++)
+      for (y = MAX (1, y1 - ty); y < MIN (brush->height, y2 - ty); y++)
         {
           guchar *row = tmp.col + (ty + y) * tmp.width * 3;
 
@@ -346,6 +374,64 @@ apply_brush (ppm_t *brush,
     }
 }
 
+static void
+apply_stamps (stamp_band_t *band,
+              gpointer      data)
+{
+  int i;
+
+  for (i = 0; i < band->num_stamps; i++)
+    {
+      const stamp_t *stamp = &band->stamps[i];
+
+      apply_brush (&band->brushes[stamp->n],
+                   band->shadows ? &band->shadows[stamp->n] : NULL,
+                   band->p, band->a,
+                   stamp->tx, stamp->ty, stamp->r, stamp->g, stamp->b,
+                   band->y1, band->y2);
+    }
+
+  g_mutex_lock (&band_mutex);
+  band->done = TRUE;
+  g_cond_signal (&band_cond);
+  g_mutex_unlock (&band_mutex);
+}
+
+static void
+add_stamp (GArray *stamps,
+           int n, int tx, int ty, int r, int g, int b)
+{
+  stamp_t stamp;
+
+  stamp.n  = n;
+  stamp.tx = tx;
+  stamp.ty = ty;
+  stamp.r  = r;
+  stamp.g  = g;
+  stamp.b  = b;
+
+  g_array_append_val (stamps, stamp);
+}
+
+static void
+repaint_progress (double progress)
+{
+  if (runningvals.run)
+    {
+      gimp_progress_update (progress);
+    }
+  else
+    {
+      char tmps[40];
+
+      g_snprintf (tmps, sizeof (tmps), "%.1f %%", 100 * progress / 0.8);
+      preview_set_button_label (tmps);
+
+      while (gtk_events_pending ())
+        gtk_main_iteration ();
+    }
+}
+
 void
 repaint (ppm_t *p, ppm_t *a)
 {
@@ -357,7 +443,7 @@ repaint (ppm_t *p, ppm_t *a)
   int         num_brushes, maxbrushwidth, maxbrushheight;
   guchar      back[3] = {0, 0, 0};
   ppm_t      *brushes, *shadows;
-  ppm_t      *brush, *shadow = NULL;
+  ppm_t      *brush;
   double     *brushes_sum;
   int         cx, cy, maxdist;
   double      scale, relief, startangle, anglespan, density, bgamma;
@@ -367,6 +453,7 @@ repaint (ppm_t *p, ppm_t *a)
   ppm_t       sizmap = {0, 0, NULL};
   int        *xpos = NULL, *ypos = NULL;
   int         progstep;
+  GArray     *stamps;
   static int  running = 0;
 
   int dropshadow = pcvals.general_drop_shadow;
@@ -824,29 +911,16 @@ repaint (ppm_t *p, ppm_t *a)
         }
     }
 
+  /* Choose all the strokes first, then apply them */
+  stamps = g_array_sized_new (FALSE, FALSE, sizeof (stamp_t), i);
+
   for (; i; i--)
     {
       int n;
       double thissum;
 
       if (i % progstep == 0)
-        {
-          if(runningvals.run)
-            {
-              gimp_progress_update (0.8 - 0.8 * ((double)i / max_progress));
-            }
-          else
-            {
-              char tmps[40];
-
-              g_snprintf (tmps, sizeof (tmps),
-                          "%.1f %%", 100 * (1.0 - ((double)i / max_progress)));
-              preview_set_button_label (tmps);
-
-              while(gtk_events_pending())
-                gtk_main_iteration();
-            }
-        }
+        repaint_progress (0.4 - 0.4 * ((double)i / max_progress));
 
       if (runningvals.place_type == PLACEMENT_TYPE_RANDOM)
         {
@@ -971,8 +1045,6 @@ repaint (ppm_t *p, ppm_t *a)
       ty -= maxbrushheight/2;
 
       brush = &brushes[n];
-      if (dropshadow)
-        shadow = &shadows[n];
       thissum = brushes_sum[n];
 
       /* Calculate color - avg. of in-brush pixels */
@@ -1033,7 +1105,7 @@ repaint (ppm_t *p, ppm_t *a)
 #undef MYASSIGN
         }
 
-      apply_brush (brush, shadow, &tmp, &atmp, tx,ty, r,g,b);
+      add_stamp (stamps, n, tx, ty, r, g, b);
 
       if (runningvals.general_tileable && runningvals.general_paint_edges)
         {
@@ -1043,35 +1115,82 @@ repaint (ppm_t *p, ppm_t *a)
 
           if (tx < maxbrushwidth)
             {
-              apply_brush (brush, shadow, &tmp, &atmp, tx+orig_width,ty, r,g,b);
+              add_stamp (stamps, n, tx+orig_width,ty, r,g,b);
               dox = -1;
             }
           else if (tx > orig_width)
             {
-              apply_brush (brush, shadow, &tmp, &atmp, tx-orig_width,ty, r,g,b);
+              add_stamp (stamps, n, tx-orig_width,ty, r,g,b);
               dox = 1;
             }
           if (ty < maxbrushheight)
             {
-              apply_brush (brush, shadow, &tmp, &atmp, tx,ty+orig_height, r,g,b);
+              add_stamp (stamps, n, tx,ty+orig_height, r,g,b);
               doy = 1;
             }
           else if (ty > orig_height)
             {
-              apply_brush (brush, shadow, &tmp, &atmp, tx,ty-orig_height, r,g,b);
+              add_stamp (stamps, n, tx,ty-orig_height, r,g,b);
               doy = -1;
             }
           if (doy)
             {
               if (dox < 0)
-                apply_brush (brush, shadow, &tmp, &atmp,
-                             tx+orig_width, ty + doy * orig_height, r, g, b);
+                add_stamp (stamps, n,
+                           tx+orig_width, ty + doy * orig_height, r, g, b);
               if (dox > 0)
-                apply_brush (brush, shadow, &tmp, &atmp,
-                             tx-orig_width, ty + doy * orig_height, r, g, b);
+                add_stamp (stamps, n,
+                           tx-orig_width, ty + doy * orig_height, r, g, b);
             }
         }
     }
+
+  /* Apply the strokes, in parallel bands of rows */
+  {
+    GThreadPool  *pool;
+    stamp_band_t *bands;
+    int           n_threads = g_get_num_processors ();
+    int           n_bands;
+    int           band_height;
+
+    n_bands     = MIN (4 * n_threads, tmp.height);
+    band_height = (tmp.height + n_bands - 1) / n_bands;
+    n_bands     = (tmp.height + band_height - 1) / band_height;
+
+    bands = g_new0 (stamp_band_t, n_bands);
+    pool  = g_thread_pool_new ((GFunc) apply_stamps, NULL,
+                               n_threads, FALSE, NULL);
+
+    for (j = 0; j < n_bands; j++)
+      {
+        bands[j].stamps     = (const stamp_t *) stamps->data;
+        bands[j].num_stamps = stamps->len;
+        bands[j].brushes    = brushes;
+        bands[j].shadows    = shadows;
+        bands[j].p          = &tmp;
+        bands[j].a          = &atmp;
+        bands[j].y1         = j * band_height;
+        bands[j].y2         = MIN ((j + 1) * band_height, tmp.height);
+
+        g_thread_pool_push (pool, &bands[j], NULL);
+      }
+
+    for (j = 0; j < n_bands; j++)
+      {
+        g_mutex_lock (&band_mutex);
+        while (! bands[j].done)
+          g_cond_wait (&band_cond, &band_mutex);
+        g_mutex_unlock (&band_mutex);
+
+        repaint_progress (0.4 + 0.4 * (j + 1) / n_bands);
+      }
+
+    g_thread_pool_free (pool, FALSE, TRUE);
+    g_free (bands);
+  }
+
+  g_array_free (stamps, TRUE);
+
   for (i = 0; i < num_brushes; i++)
     {
       ppm_kill (&brushes[i]);
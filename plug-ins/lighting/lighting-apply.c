@@ -16,6 +16,59 @@
 #include "libgimp/stdplugins-intl.h"
 
 
+typedef struct
+{
+  get_ray_func  ray_func;
+  guchar       *dest_buf;
+  gint          obpp;
+  gboolean      has_alpha;
+  gint          y1, y2;
+  gboolean      done;
+} ComputeBand;
+
+
+static GMutex band_mutex;
+static GCond  band_cond;
+
+
+/*********************************************/
+/* Shade the rows y1 to y2 of a band, called */
+/* from the thread pool                      */
+/*********************************************/
+
+static void
+compute_band (ComputeBand *band,
+              gpointer     data)
+{
+  GimpRGB      color;
+  GimpVector3  p;
+  guchar      *dest;
+  gint         xcount, ycount;
+
+  dest = band->dest_buf + band->y1 * width * band->obpp;
+
+  for (ycount = band->y1; ycount < band->y2; ycount++)
+    {
+      for (xcount = 0; xcount < width; xcount++)
+	{
+	  p = int_to_pos (xcount, ycount);
+	  color = (* band->ray_func) (&p);
+
+	  *dest++ = (guchar) (color.r * 255.0);
+	  *dest++ = (guchar) (color.g * 255.0);
+	  *dest++ = (guchar) (color.b * 255.0);
+
+	  if (band->has_alpha)
+	    *dest++ = (guchar) (color.a * 255.0);
+	}
+    }
+
+  g_mutex_lock (&band_mutex);
+  band->done = TRUE;
+  g_cond_signal (&band_cond);
+  g_mutex_unlock (&band_mutex);
+}
+
 /*************/
 /* Main loop */
 /*************/
@@ -23,17 +76,18 @@
 void
 compute_image (void)
 {
-  gint         xcount, ycount;
-  GimpRGB       color;
-  glong        progress_counter = 0;
-  GimpVector3  p;
   gint32       new_image_id = -1;
   gint32       new_layer_id = -1;
-  gint32       index;
-  guchar      *row = NULL;
+  guchar      *dest_buf;
   guchar       obpp;
   gboolean     has_alpha;
   get_ray_func ray_func;
+  GThreadPool *pool;
+  ComputeBand *bands;
+  gint         n_threads;
+  gint         n_bands;
+  gint         band_height;
+  gint         i;
 
 
 
@@ -73,13 +127,10 @@ compute_image (void)
       output_drawable = gimp_drawable_get (new_layer_id);
     }
 
-  if (mapvals.bump_mapped == TRUE && mapvals.bumpmap_id != -1)
-    {
-      gimp_pixel_rgn_init (&bump_region, gimp_drawable_get (mapvals.bumpmap_id),
-			   0, 0, width, height, FALSE, FALSE);
-    }
+  /* The bump map normals are computed once for the whole image */
+  /* ========================================================== */
 
-  precompute_init (width, height);
+  precompute_normal_map (width, height);
 
   if (!mapvals.env_mapped || mapvals.envmap_id == -1)
     {
@@ -100,44 +151,59 @@ compute_image (void)
   obpp = gimp_drawable_bpp (output_drawable->drawable_id);
   has_alpha = gimp_drawable_has_alpha (output_drawable->drawable_id);
 
-  row = g_new (guchar, obpp * width);
-
   gimp_progress_init (_("Lighting Effects"));
 
-  /* Init the first row */
-  if (mapvals.bump_mapped == TRUE && mapvals.bumpmap_id != -1 && height >= 2)
-    interpol_row (0, width, 0);
+  /* Shade bands of rows in parallel */
+  /* =============================== */
 
-  for (ycount = 0; ycount < height; ycount++)
-    {
-      if (mapvals.bump_mapped == TRUE && mapvals.bumpmap_id != -1)
-	precompute_normals (0, width, ycount);
+  image_read_maps (ray_func == get_ray_color_ref);
 
-      index = 0;
+  dest_buf = g_new (guchar, obpp * width * height);
 
-      for (xcount = 0; xcount < width; xcount++)
-	{
-	  p = int_to_pos (xcount, ycount);
-	  color = (* ray_func) (&p);
+  n_threads   = g_get_num_processors ();
+  band_height = MIN (16, (height + n_threads - 1) / n_threads);
+  band_height = MAX (band_height, 1);
+  n_bands     = (height + band_height - 1) / band_height;
 
-	  row[index++] = (guchar) (color.r * 255.0);
-	  row[index++] = (guchar) (color.g * 255.0);
-	  row[index++] = (guchar) (color.b * 255.0);
+  bands = g_new0 (ComputeBand, n_bands);
+  pool  = g_thread_pool_new ((GFunc) compute_band, NULL,
+                             n_threads, FALSE, NULL);
 
-	  if (has_alpha)
-	    row[index++] = (guchar) (color.a * 255.0);
+  for (i = 0; i < n_bands; i++)
+    {
+      bands[i].ray_func  = ray_func;
+      bands[i].dest_buf  = dest_buf;
+      bands[i].obpp      = obpp;
+      bands[i].has_alpha = has_alpha;
+      bands[i].y1        = i * band_height;
+      bands[i].y2        = MIN ((i + 1) * band_height, height);
+
+      g_thread_pool_push (pool, &bands[i], NULL);
+    }
 
-	  if ((progress_counter++ % width) == 0)
-	    gimp_progress_update ((gdouble) progress_counter /
-				  (gdouble) maxcounter);
-	}
+  for (i = 0; i < n_bands; i++)
+    {
+      g_mutex_lock (&band_mutex);
+      while (! bands[i].done)
+        g_cond_wait (&band_cond, &band_mutex);
+      g_mutex_unlock (&band_mutex);
+
+      gimp_pixel_rgn_set_rect (&dest_region,
+                               dest_buf + bands[i].y1 * width * obpp,
+                               0, bands[i].y1,
+                               width, bands[i].y2 - bands[i].y1);
 
-      gimp_pixel_rgn_set_row (&dest_region, row, 0, ycount, width);
+      gimp_progress_update ((gdouble) bands[i].y2 / (gdouble) height);
     }
 
+  g_thread_pool_free (pool, FALSE, TRUE);
+  g_free (bands);
+
   gimp_progress_update (1.0);
 
-  g_free (row);
+  g_free (dest_buf);
+
+  image_free_maps ();
 
   /* Update image */
   /* ============ */
@@ -18,11 +18,14 @@ GimpDrawable *input_drawable,*output_drawable;
 GimpPixelRgn  source_region, dest_region;
 
 GimpDrawable *bump_drawable = NULL;
-GimpPixelRgn  bump_region;
 
 GimpDrawable *env_drawable = NULL;
 GimpPixelRgn  env_region;
 
+/* the source and environment map pixels, when read into memory */
+static guchar *source_data = NULL;
+static guchar *env_data    = NULL;
+
 guchar          *preview_rgb_data = NULL;
 gint             preview_rgb_stride;
 cairo_surface_t *preview_surface = NULL;
@@ -65,10 +68,14 @@ GimpRGB
 peek (gint x,
       gint y)
 {
-  guchar data[4];
+  guchar  buf[4];
+  guchar *data = buf;
   GimpRGB color;
 
-  gimp_pixel_rgn_get_pixel (&source_region,data, x, y);
+  if (source_data)
+    data = source_data + (x + y * width) * source_region.bpp;
+  else
+    gimp_pixel_rgn_get_pixel (&source_region, data, x, y);
 
   color.r = (gdouble) (data[0]) / 255.0;
   color.g = (gdouble) (data[1]) / 255.0;
@@ -93,7 +100,8 @@ GimpRGB
 peek_env_map (gint x,
 	      gint y)
 {
-  guchar data[4];
+  guchar  buf[4];
+  guchar *data = buf;
   GimpRGB color;
 
   if (x < 0)
@@ -105,7 +113,10 @@ peek_env_map (gint x,
   else if (y >= env_height)
     y = env_height - 1;
 
-  gimp_pixel_rgn_get_pixel (&env_region, data, x, y);
+  if (env_data)
+    data = env_data + (x + y * env_width) * env_region.bpp;
+  else
+    gimp_pixel_rgn_get_pixel (&env_region, data, x, y);
 
   color.r = (gdouble) (data[0]) / 255.0;
   color.g = (gdouble) (data[1]) / 255.0;
@@ -387,3 +398,36 @@ image_setup (GimpDrawable *drawable,
 
   return TRUE;
 }
+
+/*****************************************************/
+/* Read the source image and, if it is used, the     */
+/* environment map into memory, so that peek() and   */
+/* peek_env_map() can be called from several threads */
+/*****************************************************/
+
+void
+image_read_maps (gboolean env_mapped)
+{
+  image_free_maps ();
+
+  source_data = g_new (guchar, width * height * source_region.bpp);
+  gimp_pixel_rgn_get_rect (&source_region, source_data,
+                           0, 0, width, height);
+
+  if (env_mapped)
+    {
+      env_data = g_new (guchar, env_width * env_height * env_region.bpp);
+      gimp_pixel_rgn_get_rect (&env_region, env_data,
+                               0, 0, env_width, env_height);
+    }
+}
+
+void
+image_free_maps (void)
+{
+  g_free (source_data);
+  g_free (env_data);
+
+  source_data = NULL;
+  env_data    = NULL;
+}
@@ -8,7 +8,6 @@ extern GimpDrawable *input_drawable,*output_drawable;
 extern GimpPixelRgn  source_region, dest_region;
 
 extern GimpDrawable *bump_drawable;
-extern GimpPixelRgn  bump_region;
 
 extern GimpDrawable *env_drawable;
 extern GimpPixelRgn  env_region;
@@ -58,5 +57,7 @@ gdouble        get_map_value   (GimpPixelRgn *region,
 				gint         *inside);
 gint           image_setup     (GimpDrawable *drawable,
 				gint          interactive);
+void           image_read_maps (gboolean      env_mapped);
+void           image_free_maps (void);
 
 #endif  /* __LIGHTING_IMAGE_H__ */
@@ -86,7 +86,8 @@ compute_preview (gint startx, gint starty, gint w, gint h)
   for (ycnt = 0; ycnt < h; ycnt++)
     ypostab[ycnt] = (gdouble) height *((gdouble) ycnt / (gdouble) h);
 
-  precompute_init (width, height);
+  /* The preview samples a normal map of its own size */
+  precompute_normal_map (w, h);
 
   gimp_rgba_set (&lightcheck,
                  GIMP_CHECK_LIGHT, GIMP_CHECK_LIGHT, GIMP_CHECK_LIGHT,
@@ -94,13 +95,6 @@ compute_preview (gint startx, gint starty, gint w, gint h)
   gimp_rgba_set (&darkcheck, GIMP_CHECK_DARK, GIMP_CHECK_DARK,
                  GIMP_CHECK_DARK, 1.0);
 
-  if (mapvals.bump_mapped == TRUE && mapvals.bumpmap_id != -1)
-    {
-      gimp_pixel_rgn_init (&bump_region,
-                           gimp_drawable_get (mapvals.bumpmap_id),
-                           0, 0, width, height, FALSE, FALSE);
-    }
-
   imagey = 0;
 
   if (mapvals.previewquality)
@@ -137,14 +131,6 @@ compute_preview (gint startx, gint starty, gint w, gint h)
               imagey = ypostab[ycnt - starty];
               pos = int_to_posf (imagex, imagey);
 
-              if (mapvals.bump_mapped == TRUE &&
-                  mapvals.bumpmap_id != -1 &&
-                  xcnt == startx)
-                {
-                  pos_to_float (pos.x, pos.y, &imagex, &imagey);
-                  precompute_normals (0, width, RINT (imagey));
-                }
-
               color = (*ray_func) (&pos);
 
               if (color.a < 1.0)
@@ -11,14 +11,11 @@
 #include "lighting-shade.h"
 
 
-static GimpVector3 *triangle_normals[2] = { NULL, NULL };
-static GimpVector3 *vertex_normals[3]   = { NULL, NULL, NULL };
-static gdouble     *heights[3] = { NULL, NULL, NULL };
-static gdouble      xstep, ystep;
-static guchar      *bumprow = NULL;
-
-static gint pre_w = -1;
-static gint pre_h = -1;
+/* the bump map's normals and heights, 3 + 1 floats per map pixel */
+static gfloat *normal_map        = NULL;
+static gfloat *height_map        = NULL;
+static gint    normal_map_width  = 0;
+static gint    normal_map_height = 0;
 
 /*****************/
 /* Phong shading */
@@ -31,7 +28,8 @@ phong_shade (GimpVector3 *position,
              GimpVector3 *lightposition,
              GimpRGB      *diff_col,
              GimpRGB      *light_col,
-             LightType    light_type)
+             LightType    light_type,
+             gdouble      diffuse_int)
 {
   GimpRGB       diffuse_color, specular_color;
   gdouble      nl, rv, dist;
@@ -82,7 +80,7 @@ phong_shade (GimpVector3 *position,
       /* =================================================== */
 
       diffuse_color = *light_col;
-      gimp_rgb_multiply (&diffuse_color, mapvals.material.diffuse_int);
+      gimp_rgb_multiply (&diffuse_color, diffuse_int);
       diffuse_color.r *= diff_col->r;
       diffuse_color.g *= diff_col->g;
       diffuse_color.b *= diff_col->b;
@@ -107,92 +105,20 @@ phong_shade (GimpVector3 *position,
   return diffuse_color;
 }
 
-void
-precompute_init (gint w,
-                 gint h)
-{
-  gint n;
-  gint bpp=1;
-
-  xstep = 1.0 / (gdouble) width;
-  ystep = 1.0 / (gdouble) height;
-
-  pre_w = w;
-  pre_h = h;
-
-  for (n = 0; n < 3; n++)
-    {
-      if (vertex_normals[n] != NULL)
-        g_free (vertex_normals[n]);
-      if (heights[n] != NULL)
-        g_free (heights[n]);
-
-      heights[n] = g_new (gdouble, w);
-      vertex_normals[n] = g_new (GimpVector3, w);
-    }
-
-  for (n = 0; n < 2; n++)
-    if (triangle_normals[n] != NULL)
-      g_free (triangle_normals[n]);
-
-  if (bumprow != NULL)
-    {
-      g_free (bumprow);
-      bumprow = NULL;
-    }
-  if (mapvals.bumpmap_id != -1)
-    {
-      bpp = gimp_drawable_bpp(mapvals.bumpmap_id);
-    }
-
-  bumprow = g_new (guchar, w * bpp);
-
-  triangle_normals[0] = g_new (GimpVector3, (w << 1) + 2);
-  triangle_normals[1] = g_new (GimpVector3, (w << 1) + 2);
-
-  for (n = 0; n < (w << 1) + 1; n++)
-    {
-      gimp_vector3_set (&triangle_normals[0][n], 0.0, 0.0, 1.0);
-      gimp_vector3_set (&triangle_normals[1][n], 0.0, 0.0, 1.0);
-    }
-
-  for (n = 0; n < w; n++)
-    {
-      gimp_vector3_set (&vertex_normals[0][n], 0.0, 0.0, 1.0);
-      gimp_vector3_set (&vertex_normals[1][n], 0.0, 0.0, 1.0);
-      gimp_vector3_set (&vertex_normals[2][n], 0.0, 0.0, 1.0);
-      heights[0][n] = 0.0;
-      heights[1][n] = 0.0;
-      heights[2][n] = 0.0;
-    }
-}
-
-
-/* Interpol linearly height[2] and triangle_normals[1]
- * using the next row
- */
-void
-interpol_row (gint x1,
-              gint x2,
-              gint y)
+/* Compute the heights of map row y from the bump map */
+static void
+compute_heights (GimpPixelRgn *region,
+                 guchar       *bumprow,
+                 gint          bpp,
+                 gint          y,
+                 gfloat       *heights)
 {
-  GimpVector3   p1, p2, p3;
-  gint          n, i;
-  guchar        *map = NULL;
-  gint          bpp = 1;
-  guchar* bumprow1 = NULL;
-  guchar* bumprow2 = NULL;
-
-  if (mapvals.bumpmap_id != -1)
-    {
-      bpp = gimp_drawable_bpp(mapvals.bumpmap_id);
-    }
-
-  bumprow1 = g_new (guchar, pre_w * bpp);
-  bumprow2 = g_new (guchar, pre_w * bpp);
+  guchar *map = NULL;
+  gint    n;
 
-  gimp_pixel_rgn_get_row (&bump_region, bumprow1, x1, y, x2 - x1);
-  gimp_pixel_rgn_get_row (&bump_region, bumprow2, x1, y+1, x2 - x1);
+  gimp_pixel_rgn_get_row (region, bumprow, 0,
+                          (gint) ((gdouble) height * y / normal_map_height),
+                          width);
 
   if (mapvals.bumpmaptype > 0)
     {
@@ -210,230 +136,205 @@ interpol_row (gint x1,
         }
     }
 
-  for (n = 0; n < (x2 - x1); n++)
+  for (n = 0; n < normal_map_width; n++)
     {
-      gdouble diff;
-      guchar mapval;
-      guchar mapval1, mapval2;
+      guchar *src = bumprow + bpp * (gint) ((gdouble) width * n /
+                                            normal_map_width);
+      guchar  mapval;
 
-      if (bpp>1)
-        {
-          mapval1 = (guchar)((float)((bumprow1[n * bpp] +bumprow1[n * bpp +1] + bumprow1[n * bpp + 2])/3.0 )) ;
-          mapval2 = (guchar)((float)((bumprow2[n * bpp] +bumprow2[n * bpp +1] + bumprow2[n * bpp + 2])/3.0 )) ;
-        }
+      if (bpp > 1)
+        mapval = (guchar) ((float) ((src[0] + src[1] + src[2]) / 3.0));
       else
-        {
-          mapval1 = bumprow1[n * bpp];
-          mapval2 = bumprow2[n * bpp];
-        }
+        mapval = src[0];
 
-      diff =  mapval1 - mapval2;
-      mapval = (guchar) CLAMP (mapval1 + diff, 0.0, 255.0);
+      if (map)
+        mapval = map[mapval];
 
-      if (mapvals.bumpmaptype > 0)
-        {
-          heights[1][n] = (gdouble) mapvals.bumpmax * (gdouble) map[mapval1] / 255.0;
-          heights[2][n] = (gdouble) mapvals.bumpmax * (gdouble) map[mapval] / 255.0;
-        }
-      else
-        {
-          heights[1][n] = (gdouble) mapvals.bumpmax * (gdouble) mapval1 / 255.0;
-          heights[2][n] = (gdouble) mapvals.bumpmax * (gdouble) mapval / 255.0;
-        }
+      heights[n] = (gdouble) mapvals.bumpmax * (gdouble) mapval / 255.0;
     }
+}
+
+/* Compute the two triangle normals of each cell between two map rows */
+static void
+compute_triangle_normals (const gfloat *heights1,
+                          const gfloat *heights2,
+                          GimpVector3  *triangle_normals)
+{
+  GimpVector3 p1, p2, p3;
+  gdouble     xstep = 1.0 / (gdouble) normal_map_width;
+  gdouble     ystep = 1.0 / (gdouble) normal_map_height;
+  gint        n, i;
 
   i = 0;
-  for (n = 0; n < (x2 - x1 - 1); n++)
+  for (n = 0; n < normal_map_width - 1; n++)
     {
-      /* heights rows 1 and 2 are inverted */
       p1.x = 0.0;
       p1.y = ystep;
-      p1.z = heights[1][n] - heights[2][n];
+      p1.z = heights2[n] - heights1[n];
 
       p2.x = xstep;
       p2.y = ystep;
-      p2.z = heights[1][n+1] - heights[2][n];
+      p2.z = heights2[n+1] - heights1[n];
 
       p3.x = xstep;
       p3.y = 0.0;
-      p3.z = heights[2][n+1] - heights[2][n];
+      p3.z = heights1[n+1] - heights1[n];
 
-      triangle_normals[1][i] = gimp_vector3_cross_product (&p2, &p1);
-      triangle_normals[1][i+1] = gimp_vector3_cross_product (&p3, &p2);
+      triangle_normals[i]   = gimp_vector3_cross_product (&p2, &p1);
+      triangle_normals[i+1] = gimp_vector3_cross_product (&p3, &p2);
 
-      gimp_vector3_normalize (&triangle_normals[1][i]);
-      gimp_vector3_normalize (&triangle_normals[1][i+1]);
+      gimp_vector3_normalize (&triangle_normals[i]);
+      gimp_vector3_normalize (&triangle_normals[i+1]);
 
       i += 2;
     }
-
-  g_free (bumprow1);
-  g_free (bumprow2);
 }
 
-/********************************************/
-/* Compute triangle and then vertex normals */
-/********************************************/
-
+/*********************************************************/
+/* Compute the heights and vertex normals of the bump    */
+/* map once, sampled at map_width x map_height pixels.   */
+/* The preview uses a map of its own, smaller size.      */
+/*********************************************************/
 
 void
-precompute_normals (gint x1,
-                    gint x2,
-                    gint y)
+precompute_normal_map (gint map_width,
+                       gint map_height)
 {
-  GimpVector3 *tmpv, p1, p2, p3, normal;
-  gdouble     *tmpd;
-  gint         n, i, nv;
-  guchar      *map = NULL;
-  gint bpp = 1;
-  guchar mapval;
+  GimpDrawable *drawable;
+  GimpPixelRgn  region;
+  GimpVector3  *triangle_normals[2];
+  GimpVector3  *tmpv;
+  guchar       *bumprow;
+  gint          bpp;
+  gint          n_cells;
+  gint          x, y;
+
+  g_free (normal_map);
+  g_free (height_map);
+  normal_map = NULL;
+  height_map = NULL;
 
+  if (mapvals.bump_mapped == FALSE || mapvals.bumpmap_id == -1)
+    return;
 
-  /* First, compute the heights */
-  /* ========================== */
+  normal_map_width  = MAX (map_width, 1);
+  normal_map_height = MAX (map_height, 1);
 
-  tmpv                = triangle_normals[0];
-  triangle_normals[0] = triangle_normals[1];
-  triangle_normals[1] = tmpv;
+  normal_map = g_new (gfloat, 3 * normal_map_width * normal_map_height);
+  height_map = g_new (gfloat, normal_map_width * normal_map_height);
 
-  tmpv              = vertex_normals[0];
-  vertex_normals[0] = vertex_normals[1];
-  vertex_normals[1] = vertex_normals[2];
-  vertex_normals[2] = tmpv;
+  drawable = gimp_drawable_get (mapvals.bumpmap_id);
+  bpp      = drawable->bpp;
 
-  tmpd       = heights[0];
-  heights[0] = heights[1];
-  heights[1] = heights[2];
-  heights[2] = tmpd;
+  gimp_pixel_rgn_init (&region, drawable, 0, 0, width, height, FALSE, FALSE);
 
-  if (mapvals.bumpmap_id != -1)
-    {
-      bpp = gimp_drawable_bpp(mapvals.bumpmap_id);
-    }
+  bumprow = g_new (guchar, width * bpp);
 
-  gimp_pixel_rgn_get_row (&bump_region, bumprow, x1, y, x2 - x1);
+  for (y = 0; y < normal_map_height; y++)
+    compute_heights (&region, bumprow, bpp, y,
+                     height_map + y * normal_map_width);
 
-  if (mapvals.bumpmaptype > 0)
-    {
-      switch (mapvals.bumpmaptype)
-        {
-          case 1:
-            map = logmap;
-            break;
-          case 2:
-            map = sinemap;
-            break;
-          default:
-            map = spheremap;
-            break;
-        }
+  g_free (bumprow);
+  gimp_drawable_detach (drawable);
 
-      for (n = 0; n < (x2 - x1); n++)
-        {
-          if (bpp>1)
-            {
-              mapval = (guchar)((float)((bumprow[n * bpp] +bumprow[n * bpp +1] + bumprow[n * bpp + 2])/3.0 )) ;
-            }
-          else
-            {
-              mapval = bumprow[n * bpp];
-            }
+  /* Average the normals of the triangles around each vertex; */
+  /* triangle_normals[0] holds the cells above the row,       */
+  /* triangle_normals[1] the cells below it.                  */
 
-          heights[2][n] = (gdouble) mapvals.bumpmax * (gdouble) map[mapval] / 255.0;
-        }
-    }
-  else
-    {
-      for (n = 0; n < (x2 - x1); n++)
-        {
-          if (bpp>1)
-            {
-              mapval = (guchar)((float)((bumprow[n * bpp] +bumprow[n * bpp +1] + bumprow[n * bpp + 2])/3.0 )) ;
-            }
-          else
-            {
-              mapval = bumprow[n * bpp];
-            }
-          heights[2][n] = (gdouble) mapvals.bumpmax * (gdouble) mapval / 255.0;
-        }
-    }
+  n_cells = MAX (normal_map_width - 1, 1);
 
-  /* Compute triangle normals */
-  /* ======================== */
+  triangle_normals[0] = g_new (GimpVector3, 2 * n_cells);
+  triangle_normals[1] = g_new (GimpVector3, 2 * n_cells);
 
-  i = 0;
-  for (n = 0; n < (x2 - x1 - 1); n++)
+  for (y = 0; y < normal_map_height; y++)
     {
-      p1.x = 0.0;
-      p1.y = ystep;
-      p1.z = heights[2][n] - heights[1][n];
+      gfloat *dest = normal_map + 3 * y * normal_map_width;
 
-      p2.x = xstep;
-      p2.y = ystep;
-      p2.z = heights[2][n+1] - heights[1][n];
+      if (y < normal_map_height - 1)
+        compute_triangle_normals (height_map + y * normal_map_width,
+                                  height_map + (y + 1) * normal_map_width,
+                                  triangle_normals[1]);
 
-      p3.x = xstep;
-      p3.y = 0.0;
-      p3.z = heights[1][n+1] - heights[1][n];
+      for (x = 0; x < normal_map_width; x++)
+        {
+          GimpVector3 normal;
+          gint        nv = 0;
+          gint        c;
 
-      triangle_normals[1][i] = gimp_vector3_cross_product (&p2, &p1);
-      triangle_normals[1][i+1] = gimp_vector3_cross_product (&p3, &p2);
+          gimp_vector3_set (&normal, 0.0, 0.0, 0.0);
 
-      gimp_vector3_normalize (&triangle_normals[1][i]);
-      gimp_vector3_normalize (&triangle_normals[1][i+1]);
+          for (c = MAX (x - 1, 0); c <= MIN (x, normal_map_width - 2); c++)
+            {
+              if (y > 0)
+                {
+                  gimp_vector3_add (&normal, &normal,
+                                    &triangle_normals[0][2 * c]);
+                  gimp_vector3_add (&normal, &normal,
+                                    &triangle_normals[0][2 * c + 1]);
+                  nv += 2;
+                }
+
+              if (y < normal_map_height - 1)
+                {
+                  gimp_vector3_add (&normal, &normal,
+                                    &triangle_normals[1][2 * c]);
+                  gimp_vector3_add (&normal, &normal,
+                                    &triangle_normals[1][2 * c + 1]);
+                  nv += 2;
+                }
+            }
 
-      i += 2;
-    }
+          if (nv > 0)
+            gimp_vector3_normalize (&normal);
+          else
+            gimp_vector3_set (&normal, 0.0, 0.0, 1.0);
 
-  /* Compute vertex normals */
-  /* ====================== */
+          dest[3 * x]     = normal.x;
+          dest[3 * x + 1] = normal.y;
+          dest[3 * x + 2] = normal.z;
+        }
 
-  i = 0;
-  gimp_vector3_set (&normal, 0.0, 0.0, 0.0);
+      tmpv                = triangle_normals[0];
+      triangle_normals[0] = triangle_normals[1];
+      triangle_normals[1] = tmpv;
+    }
 
-  for (n = 0; n < (x2 - x1 - 1); n++)
-    {
-      nv = 0;
+  g_free (triangle_normals[0]);
+  g_free (triangle_normals[1]);
+}
 
-      if (n > 0)
-        {
-          if (y > 0)
-            {
-              gimp_vector3_add (&normal, &normal, &triangle_normals[0][i-1]);
-              gimp_vector3_add (&normal, &normal, &triangle_normals[0][i-2]);
-              nv += 2;
-            }
+/* Look up the normal map pixel at image position (xf, yf) */
+static gint
+normal_map_index (gdouble xf,
+                  gdouble yf)
+{
+  gint x = RINT (xf * normal_map_width / width);
+  gint y = RINT (yf * normal_map_height / height);
 
-          if (y < pre_h)
-            {
-              gimp_vector3_add (&normal, &normal, &triangle_normals[1][i-1]);
-              nv++;
-            }
-        }
+  x = CLAMP (x, 0, normal_map_width - 1);
+  y = CLAMP (y, 0, normal_map_height - 1);
 
-      if (n <pre_w)
-        {
-          if (y > 0)
-            {
-              gimp_vector3_add (&normal, &normal, &triangle_normals[0][i]);
-              gimp_vector3_add (&normal, &normal, &triangle_normals[0][i+1]);
-              nv += 2;
-            }
+  return x + y * normal_map_width;
+}
 
-          if (y < pre_h)
-            {
-              gimp_vector3_add (&normal, &normal, &triangle_normals[1][i]);
-              gimp_vector3_add (&normal, &normal, &triangle_normals[1][i+1]);
-              nv += 2;
-            }
-        }
+static void
+get_normal (gdouble      xf,
+            gdouble      yf,
+            GimpVector3 *normal)
+{
+  const gfloat *n = normal_map + 3 * normal_map_index (xf, yf);
 
-      gimp_vector3_mul (&normal, 1.0 / (gdouble) nv);
-      gimp_vector3_normalize (&normal);
-      vertex_normals[1][n] = normal;
+  gimp_vector3_set (normal, n[0], n[1], n[2]);
+}
 
-      i += 2;
-    }
+static gdouble
+get_height (gdouble xf,
+            gdouble yf)
+{
+  if (! height_map)
+    return 0.0;
+
+  return height_map[normal_map_index (xf, yf)];
 }
 
 /***********************************************************************/
@@ -467,8 +368,8 @@ sphere_to_image (GimpVector3 *normal,
                  gdouble     *u,
                  gdouble     *v)
 {
-  static gdouble     alpha, fac;
-  static GimpVector3 cross_prod;
+  gdouble            alpha, fac;
+  GimpVector3        cross_prod;
   static GimpVector3 firstaxis  = { 1.0, 0.0, 0.0 };
   static GimpVector3 secondaxis = { 0.0, 1.0, 0.0 };
 
@@ -512,16 +413,14 @@ get_ray_color (GimpVector3 *position)
   GimpRGB       color_int;
   GimpRGB       color_sum;
   GimpRGB       light_color;
-  gint          x, f;
+  gint          f;
   gdouble       xf, yf;
   GimpVector3   normal, *p;
   gint          k;
 
   pos_to_float (position->x, position->y, &xf, &yf);
 
-  x = RINT (xf);
-
-  if (mapvals.transparent_background && heights[1][x] == 0)
+  if (mapvals.transparent_background && get_height (xf, yf) == 0)
     {
       gimp_rgb_set_alpha (&color_sum, 0.0);
     }
@@ -553,11 +452,12 @@ get_ray_color (GimpVector3 *position)
                                          p,
                                          &color,
                                          &color_int,
-                                         mapvals.lightsource[k].type);
+                                         mapvals.lightsource[k].type,
+                                         mapvals.material.diffuse_int);
             }
           else
             {
-              normal = vertex_normals[1][(gint) RINT (xf)];
+              get_normal (xf, yf, &normal);
 
               light_color = phong_shade (position,
                                          &mapvals.viewpoint,
@@ -565,7 +465,8 @@ get_ray_color (GimpVector3 *position)
                                          p,
                                          &color,
                                          &color_int,
-                                         mapvals.lightsource[k].type);
+                                         mapvals.lightsource[k].type,
+                                         mapvals.material.diffuse_int);
             }
 
           gimp_rgb_add (&color_sum, &light_color);
@@ -583,23 +484,20 @@ get_ray_color_ref (GimpVector3 *position)
   GimpRGB      color_int;
   GimpRGB      light_color;
   GimpRGB      color, env_color;
-  gint         x, f;
+  gint         f;
   gdouble      xf, yf;
   GimpVector3  normal, *p, v, r;
   gint         k;
-  gdouble      tmpval;
 
   pos_to_float (position->x, position->y, &xf, &yf);
 
-  x = RINT (xf);
-
   if (mapvals.bump_mapped == FALSE || mapvals.bumpmap_id == -1)
     normal = mapvals.planenormal;
   else
-    normal = vertex_normals[1][(gint) RINT (xf)];
+    get_normal (xf, yf, &normal);
   gimp_vector3_normalize (&normal);
 
-  if (mapvals.transparent_background && heights[1][x] == 0)
+  if (mapvals.transparent_background && get_height (xf, yf) == 0)
     {
       gimp_rgb_set_alpha (&color_sum, 0.0);
     }
@@ -628,7 +526,8 @@ get_ray_color_ref (GimpVector3 *position)
                                      p,
                                      &color,
                                      &color_int,
-                                     mapvals.lightsource[0].type);
+                                     mapvals.lightsource[0].type,
+                                     mapvals.material.diffuse_int);
         }
 
       gimp_vector3_sub (&v, &mapvals.viewpoint, position);
@@ -643,18 +542,14 @@ get_ray_color_ref (GimpVector3 *position)
       env_color = peek_env_map (RINT (env_width * xf),
                                 RINT (env_height * yf));
 
-      tmpval = mapvals.material.diffuse_int;
-      mapvals.material.diffuse_int = 0.;
-
       light_color = phong_shade (position,
                                  &mapvals.viewpoint,
                                  &normal,
                                  &r,
                                  &color,
                                  &env_color,
-                                 DIRECTIONAL_LIGHT);
-
-      mapvals.material.diffuse_int = tmpval;
+                                 DIRECTIONAL_LIGHT,
+                                 0.0);
 
       gimp_rgb_add (&color_sum, &light_color);
     }
@@ -680,7 +575,7 @@ get_ray_color_no_bilinear (GimpVector3 *position)
 
   x = RINT (xf);
 
-  if (mapvals.transparent_background && heights[1][x] == 0)
+  if (mapvals.transparent_background && get_height (xf, yf) == 0)
     {
       gimp_rgb_set_alpha (&color_sum, 0.0);
     }
@@ -712,11 +607,12 @@ get_ray_color_no_bilinear (GimpVector3 *position)
                                          p,
                                          &color,
                                          &color_int,
-                                         mapvals.lightsource[k].type);
+                                         mapvals.lightsource[k].type,
+                                         mapvals.material.diffuse_int);
             }
           else
             {
-              normal = vertex_normals[1][x];
+              get_normal (xf, yf, &normal);
 
               light_color = phong_shade (position,
                                          &mapvals.viewpoint,
@@ -724,7 +620,8 @@ get_ray_color_no_bilinear (GimpVector3 *position)
                                          p,
                                          &color,
                                          &color_int,
-                                         mapvals.lightsource[k].type);
+                                         mapvals.lightsource[k].type,
+                                         mapvals.material.diffuse_int);
             }
 
           gimp_rgb_add (&color_sum, &light_color);
@@ -742,23 +639,19 @@ get_ray_color_no_bilinear_ref (GimpVector3 *position)
   GimpRGB      color_int;
   GimpRGB      light_color;
   GimpRGB      color, env_color;
-  gint         x;
   gdouble      xf, yf;
   GimpVector3  normal, *p, v, r;
   gint         k;
-  gdouble      tmpval;
 
   pos_to_float (position->x, position->y, &xf, &yf);
 
-  x = RINT (xf);
-
   if (mapvals.bump_mapped == FALSE || mapvals.bumpmap_id == -1)
     normal = mapvals.planenormal;
   else
-    normal = vertex_normals[1][(gint) RINT (xf)];
+    get_normal (xf, yf, &normal);
   gimp_vector3_normalize (&normal);
 
-  if (mapvals.transparent_background && heights[1][x] == 0)
+  if (mapvals.transparent_background && get_height (xf, yf) == 0)
     {
       gimp_rgb_set_alpha (&color_sum, 0.0);
     }
@@ -787,7 +680,8 @@ get_ray_color_no_bilinear_ref (GimpVector3 *position)
                                          p,
                                          &color,
                                          &color_int,
-                                         mapvals.lightsource[0].type);
+                                         mapvals.lightsource[0].type,
+                                     mapvals.material.diffuse_int);
         }
 
       gimp_vector3_sub (&v, &mapvals.viewpoint, position);
@@ -802,18 +696,14 @@ get_ray_color_no_bilinear_ref (GimpVector3 *position)
       env_color = peek_env_map (RINT (env_width * xf),
                                 RINT (env_height * yf));
 
-      tmpval = mapvals.material.diffuse_int;
-      mapvals.material.diffuse_int = 0.;
-
       light_color = phong_shade (position,
                                  &mapvals.viewpoint,
                                  &normal,
                                  &r,
                                  &color,
                                  &env_color,
-                                 DIRECTIONAL_LIGHT);
-
-      mapvals.material.diffuse_int = tmpval;
+                                 DIRECTIONAL_LIGHT,
+                                 0.0);
 
       gimp_rgb_add (&color_sum, &light_color);
     }
@@ -190,6 +190,19 @@ init_compute (void)
   max_depth = (gint) mapvals.maxdepth;
 }
 
+typedef struct
+{
+  guchar   *dest_buf;
+  gint      obpp;
+  gint      y1, y2;
+  gboolean  done;
+} ComputeBand;
+
+
+static GMutex band_mutex;
+static GCond  band_cond;
+
+
 static void
 render (gdouble   x,
         gdouble   y,
@@ -205,6 +218,20 @@ render (gdouble   x,
   *col = get_ray_color (&pos);
 }
 
+static void
+poke_band (gint      x,
+           gint      y,
+           GimpRGB  *color,
+           gpointer  data)
+{
+  ComputeBand *band = data;
+  guchar       col[4];
+
+  gimp_rgba_get_uchar (color, &col[0], &col[1], &col[2], &col[3]);
+
+  memcpy (band->dest_buf + (x + y * width) * band->obpp, col, band->obpp);
+}
+
 static void
 show_progress (gint     min,
                gint     max,
@@ -214,6 +241,35 @@ show_progress (gint     min,
   gimp_progress_update ((gdouble) curr / (gdouble) max);
 }
 
+/**********************************************/
+/* Render the rows y1 to y2 of a band, called */
+/* from the thread pool                       */
+/**********************************************/
+
+static void
+compute_band (ComputeBand *band,
+              gpointer     data)
+{
+  GimpRGB     color;
+  GimpVector3 p;
+  gint        xcount, ycount;
+
+  for (ycount = band->y1; ycount < band->y2; ycount++)
+    {
+      for (xcount = 0; xcount < width; xcount++)
+        {
+          p = int_to_pos (xcount, ycount);
+          color = (* get_ray_color) (&p);
+          poke_band (xcount, ycount, &color, band);
+        }
+    }
+
+  g_mutex_lock (&band_mutex);
+  band->done = TRUE;
+  g_cond_signal (&band_cond);
+  g_mutex_unlock (&band_mutex);
+}
+
 /**************************************************/
 /* Performs map-to-sphere on the whole input image */
 /* and updates or creates a new GIMP image.       */
@@ -222,13 +278,17 @@ show_progress (gint     min,
 void
 compute_image (void)
 {
-  gint         xcount, ycount;
-  GimpRGB      color;
-  glong        progress_counter = 0;
-  GimpVector3  p;
   gint32       new_image_id = -1;
   gint32       new_layer_id = -1;
   gboolean     insert_layer = FALSE;
+  guchar      *dest_buf;
+  gint         obpp;
+  GThreadPool *pool;
+  ComputeBand *bands;
+  gint         n_threads;
+  gint         n_bands;
+  gint         band_height;
+  gint         i;
 
   init_compute ();
 
@@ -282,35 +342,75 @@ compute_image (void)
         break;
     }
 
+  image_read_maps ();
+
+  obpp     = output_drawable->bpp;
+  dest_buf = g_new (guchar, obpp * width * height);
+
   if (mapvals.antialiasing == FALSE)
     {
-      for (ycount = 0; ycount < height; ycount++)
+      /* Render bands of rows in parallel */
+      /* ================================ */
+
+      n_threads   = g_get_num_processors ();
+      band_height = MIN (16, (height + n_threads - 1) / n_threads);
+      band_height = MAX (band_height, 1);
+      n_bands     = (height + band_height - 1) / band_height;
+
+      bands = g_new0 (ComputeBand, n_bands);
+      pool  = g_thread_pool_new ((GFunc) compute_band, NULL,
+                                 n_threads, FALSE, NULL);
+
+      for (i = 0; i < n_bands; i++)
+        {
+          bands[i].dest_buf = dest_buf;
+          bands[i].obpp     = obpp;
+          bands[i].y1       = i * band_height;
+          bands[i].y2       = MIN ((i + 1) * band_height, height);
+
+          g_thread_pool_push (pool, &bands[i], NULL);
+        }
+
+      for (i = 0; i < n_bands; i++)
         {
-          for (xcount = 0; xcount < width; xcount++)
-            {
-              p = int_to_pos (xcount, ycount);
-              color = (* get_ray_color) (&p);
-              poke (xcount, ycount, &color, NULL);
-
-              if ((progress_counter++ % width) == 0)
-                gimp_progress_update ((gdouble) progress_counter /
-                                      (gdouble) maxcounter);
-            }
+          g_mutex_lock (&band_mutex);
+          while (! bands[i].done)
+            g_cond_wait (&band_cond, &band_mutex);
+          g_mutex_unlock (&band_mutex);
+
+          gimp_pixel_rgn_set_rect (&dest_region,
+                                   dest_buf + bands[i].y1 * width * obpp,
+                                   0, bands[i].y1,
+                                   width, bands[i].y2 - bands[i].y1);
+
+          gimp_progress_update ((gdouble) bands[i].y2 / (gdouble) height);
         }
+
+      g_thread_pool_free (pool, FALSE, TRUE);
+      g_free (bands);
     }
   else
     {
-      gimp_adaptive_supersample_area (0, 0,
-                                      width - 1, height - 1,
-                                      max_depth,
-                                      mapvals.pixeltreshold,
-                                      render,
-                                      NULL,
-                                      poke,
-                                      NULL,
-                                      show_progress,
-                                      NULL);
+      ComputeBand band = { dest_buf, obpp, 0, height, FALSE };
+
+      gimp_adaptive_supersample_area_parallel (0, 0,
+                                               width - 1, height - 1,
+                                               max_depth,
+                                               mapvals.pixeltreshold,
+                                               render,
+                                               NULL,
+                                               poke_band,
+                                               &band,
+                                               show_progress,
+                                               NULL);
+
+      gimp_pixel_rgn_set_rect (&dest_region, dest_buf, 0, 0, width, height);
     }
+
+  g_free (dest_buf);
+
+  image_free_maps ();
+
   gimp_progress_update (1.0);
 
   /* Update the region */
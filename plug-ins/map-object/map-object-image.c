@@ -43,19 +43,40 @@ gdouble oldtreshold;
 
 gint border_x1, border_y1, border_x2, border_y2;
 
+/* The source and map images, when read into memory by image_read_maps() */
+static guchar   *source_data      = NULL;
+static guchar   *box_data[6]      = { NULL, };
+static gboolean  box_has_alpha[6];
+static guchar   *cylinder_data[2] = { NULL, };
+static gboolean  cylinder_has_alpha[2];
+
 /******************/
 /* Implementation */
 /******************/
 
+static guchar *
+read_region (GimpPixelRgn *region)
+{
+  guchar *data = g_new (guchar, region->w * region->h * region->bpp);
+
+  gimp_pixel_rgn_get_rect (region, data,
+                           region->x, region->y, region->w, region->h);
+
+  return data;
+}
+
 GimpRGB
 peek (gint x,
       gint y)
 {
-  static guchar data[4];
-
+  guchar  buf[4];
+  guchar *data = buf;
   GimpRGB color;
 
-  gimp_pixel_rgn_get_pixel (&source_region, data, x, y);
+  if (source_data)
+    data = source_data + (x + y * width) * source_region.bpp;
+  else
+    gimp_pixel_rgn_get_pixel (&source_region, data, x, y);
 
   color.r = (gdouble) (data[0]) / 255.0;
   color.g = (gdouble) (data[1]) / 255.0;
@@ -81,11 +102,23 @@ peek_box_image (gint image,
                 gint x,
                 gint y)
 {
-  static guchar data[4];
-
-  GimpRGB color;
+  guchar   buf[4];
+  guchar  *data = buf;
+  gboolean has_alpha;
+  GimpRGB  color;
 
-  gimp_pixel_rgn_get_pixel (&box_regions[image], data, x, y);
+  if (box_data[image])
+    {
+      data = box_data[image] + ((x + y * box_regions[image].w) *
+                                box_regions[image].bpp);
+      has_alpha = box_has_alpha[image];
+    }
+  else
+    {
+      gimp_pixel_rgn_get_pixel (&box_regions[image], data, x, y);
+      has_alpha = (box_drawables[image]->bpp == 4 &&
+                   gimp_drawable_has_alpha (box_drawables[image]->drawable_id));
+    }
 
   color.r = (gdouble) (data[0]) / 255.0;
   color.g = (gdouble) (data[1]) / 255.0;
@@ -93,7 +126,7 @@ peek_box_image (gint image,
 
   if (box_drawables[image]->bpp == 4)
     {
-      if (gimp_drawable_has_alpha (box_drawables[image]->drawable_id))
+      if (has_alpha)
         color.a = (gdouble) (data[3]) / 255.0;
       else
         color.a = 1.0;
@@ -111,11 +144,23 @@ peek_cylinder_image (gint image,
                      gint x,
                      gint y)
 {
-  static guchar data[4];
+  guchar   buf[4];
+  guchar  *data = buf;
+  gboolean has_alpha;
+  GimpRGB  color;
 
-  GimpRGB color;
-
-  gimp_pixel_rgn_get_pixel (&cylinder_regions[image],data, x, y);
+  if (cylinder_data[image])
+    {
+      data = cylinder_data[image] + ((x + y * cylinder_regions[image].w) *
+                                     cylinder_regions[image].bpp);
+      has_alpha = cylinder_has_alpha[image];
+    }
+  else
+    {
+      gimp_pixel_rgn_get_pixel (&cylinder_regions[image], data, x, y);
+      has_alpha = (cylinder_drawables[image]->bpp == 4 &&
+                   gimp_drawable_has_alpha (cylinder_drawables[image]->drawable_id));
+    }
 
   color.r = (gdouble) (data[0]) / 255.0;
   color.g = (gdouble) (data[1]) / 255.0;
@@ -123,7 +168,7 @@ peek_cylinder_image (gint image,
 
   if (cylinder_drawables[image]->bpp == 4)
     {
-      if (gimp_drawable_has_alpha (cylinder_drawables[image]->drawable_id))
+      if (has_alpha)
         color.a = (gdouble) (data[3]) / 255.0;
       else
         color.a = 1.0;
@@ -403,3 +448,60 @@ image_setup (GimpDrawable *drawable,
 
   return TRUE;
 }
+
+/*************************************************/
+/* Read the source image and the images used by  */
+/* the current map type into memory, so that the */
+/* peek functions can be called from any thread. */
+/* Call init_compute() first.                    */
+/*************************************************/
+
+void
+image_read_maps (void)
+{
+  gint i;
+
+  image_free_maps ();
+
+  source_data = read_region (&source_region);
+
+  if (mapvals.maptype == MAP_BOX)
+    {
+      for (i = 0; i < 6; i++)
+        {
+          box_data[i]      = read_region (&box_regions[i]);
+          box_has_alpha[i] =
+            gimp_drawable_has_alpha (box_drawables[i]->drawable_id);
+        }
+    }
+  else if (mapvals.maptype == MAP_CYLINDER)
+    {
+      for (i = 0; i < 2; i++)
+        {
+          cylinder_data[i]      = read_region (&cylinder_regions[i]);
+          cylinder_has_alpha[i] =
+            gimp_drawable_has_alpha (cylinder_drawables[i]->drawable_id);
+        }
+    }
+}
+
+void
+image_free_maps (void)
+{
+  gint i;
+
+  g_free (source_data);
+  source_data = NULL;
+
+  for (i = 0; i < 6; i++)
+    {
+      g_free (box_data[i]);
+      box_data[i] = NULL;
+    }
+
+  for (i = 0; i < 2; i++)
+    {
+      g_free (cylinder_data[i]);
+      cylinder_data[i] = NULL;
+    }
+}
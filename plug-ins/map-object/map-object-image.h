@@ -31,6 +31,8 @@ extern GimpTile *current_in_tile, *current_out_tile;
 
 extern gint        image_setup              (GimpDrawable *drawable,
                                              gint          interactive);
+extern void        image_read_maps          (void);
+extern void        image_free_maps          (void);
 extern glong       in_xy_to_index           (gint          x,
                                              gint          y);
 extern glong       out_xy_to_index          (gint          x,
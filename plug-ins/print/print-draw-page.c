@@ -28,29 +28,31 @@
 #include "libgimp/stdplugins-intl.h"
 
 
-static cairo_surface_t * print_surface_from_drawable (gint32  drawable_ID);
+/*  the image is sent in bands of about this size  */
+#define PRINT_BAND_BYTES (16 * 1024 * 1024)
 
-static void              print_draw_crop_marks       (GtkPrintContext *context,
-                                                      gdouble          x,
-                                                      gdouble          y,
-                                                      gdouble          w,
-                                                      gdouble          h);
+
+static void   print_draw_drawable   (cairo_t         *cr,
+                                     gint32           drawable_ID);
+
+static void   print_draw_crop_marks (GtkPrintContext *context,
+                                     gdouble          x,
+                                     gdouble          y,
+                                     gdouble          w,
+                                     gdouble          h);
 
 gboolean
 print_draw_page (GtkPrintContext *context,
                  PrintData       *data)
 {
-  cairo_t         *cr = gtk_print_context_get_cairo_context (context);
-  cairo_surface_t *surface;
-  gint             width;
-  gint             height;
-  gdouble          scale_x;
-  gdouble          scale_y;
-
-  surface = print_surface_from_drawable (data->drawable_id);
+  cairo_t *cr = gtk_print_context_get_cairo_context (context);
+  gint     width;
+  gint     height;
+  gdouble  scale_x;
+  gdouble  scale_y;
 
-  width  = cairo_image_surface_get_width (surface);
-  height = cairo_image_surface_get_height (surface);
+  width  = gimp_drawable_width  (data->drawable_id);
+  height = gimp_drawable_height (data->drawable_id);
 
   scale_x = gtk_print_context_get_dpi_x (context) / data->xres;
   scale_y = gtk_print_context_get_dpi_y (context) / data->yres;
@@ -62,74 +64,71 @@ print_draw_page (GtkPrintContext *context,
                            0, 0, width * scale_x, height * scale_y);
 
   cairo_scale (cr, scale_x, scale_y);
-  cairo_rectangle (cr, 0, 0, width, height);
-  cairo_set_source_surface (cr, surface, 0, 0);
-  cairo_fill (cr);
 
-  cairo_surface_destroy (surface);
+  print_draw_drawable (cr, data->drawable_id);
 
   return TRUE;
 }
 
-static cairo_surface_t *
-print_surface_from_drawable (gint32 drawable_ID)
+/*  Draws the drawable band by band, so that no surface of the whole
+ *  drawable is ever allocated.
+ */
+static void
+print_draw_drawable (cairo_t *cr,
+                     gint32   drawable_ID)
 {
-  GeglBuffer         *buffer   = gimp_drawable_get_buffer (drawable_ID);
-  const Babl         *format;
-  cairo_surface_t    *surface;
-  const gint          width    = gimp_drawable_width  (drawable_ID);
-  const gint          height   = gimp_drawable_height (drawable_ID);
-  GeglBufferIterator *iter;
-  guchar             *pixels;
-  gint                stride;
-  guint               count    = 0;
-  guint               done     = 0;
-
-  if (gimp_drawable_has_alpha (drawable_ID))
+  GeglBuffer      *buffer    = gimp_drawable_get_buffer (drawable_ID);
+  const gint       width     = gimp_drawable_width  (drawable_ID);
+  const gint       height    = gimp_drawable_height (drawable_ID);
+  const gboolean   has_alpha = gimp_drawable_has_alpha (drawable_ID);
+  const Babl      *format;
+  gint             band_height;
+  gint             y;
+
+  if (has_alpha)
     format = babl_format ("cairo-ARGB32");
   else
     format = babl_format ("cairo-RGB24");
 
-  surface = cairo_image_surface_create (gimp_drawable_has_alpha (drawable_ID) ?
-                                        CAIRO_FORMAT_ARGB32 :
-                                        CAIRO_FORMAT_RGB24,
-                                        width, height);
+  band_height = CLAMP (PRINT_BAND_BYTES / (width * 4), 1, height);
 
-  pixels = cairo_image_surface_get_data (surface);
-  stride = cairo_image_surface_get_stride (surface);
+  for (y = 0; y < height; y += band_height)
+    {
+      cairo_surface_t *surface;
+      gint             rows = MIN (band_height, height - y);
 
-  iter = gegl_buffer_iterator_new (buffer,
-                                   GEGL_RECTANGLE (0, 0, width, height), 0,
-                                   format,
-                                   GEGL_BUFFER_READ, GEGL_ABYSS_NONE);
+      /*  the print surface may keep the band until the page is done,
+       *  so every band gets its own surface
+       */
+      surface = cairo_image_surface_create (has_alpha ?
+                                            CAIRO_FORMAT_ARGB32 :
+                                            CAIRO_FORMAT_RGB24,
+                                            width, rows);
 
-  while (gegl_buffer_iterator_next (iter))
-    {
-      const guchar *src  = iter->data[0];
-      guchar       *dest = pixels + iter->roi->y * stride + iter->roi->x * 4;
-      gint          y;
+      gegl_buffer_get (buffer, GEGL_RECTANGLE (0, y, width, rows), 1.0,
+                       format,
+                       cairo_image_surface_get_data (surface),
+                       cairo_image_surface_get_stride (surface),
+                       GEGL_ABYSS_NONE);
+
+      cairo_surface_mark_dirty (surface);
+
+      cairo_rectangle (cr, 0, y, width, rows);
+      cairo_set_source_surface (cr, surface, 0, y);
 
-      for (y = 0; y < iter->roi->height; y++)
-        {
-          memcpy (dest, src, iter->roi->width * 4);
+      /*  don't let the bands' edges fade when the page is scaled  */
+      cairo_pattern_set_extend (cairo_get_source (cr), CAIRO_EXTEND_PAD);
 
-          src  += iter->roi->width * 4;
-          dest += stride;
-        }
+      cairo_fill (cr);
 
-      done += iter->roi->height * iter->roi->width;
+      cairo_surface_destroy (surface);
 
-      if (count++ % 16 == 0)
-        gimp_progress_update ((gdouble) done / (width * height));
+      gimp_progress_update ((gdouble) (y + rows) / height);
     }
 
   g_object_unref (buffer);
 
-  cairo_surface_mark_dirty (surface);
-
   gimp_progress_update (1.0);
-
-  return surface;
 }
 
 static void
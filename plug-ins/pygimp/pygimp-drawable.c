@@ -433,6 +433,172 @@ out:
 	return NULL;
 }
 
+static gint *
+drw_parse_coords(PyObject *seq, int *num_coords)
+{
+    gint *coords;
+    int num_pixels, i;
+
+    if (!PySequence_Check(seq)) {
+	PyErr_SetString(PyExc_TypeError,
+			"coordinates must be a sequence of (x, y) pairs");
+	return NULL;
+    }
+
+    num_pixels = PySequence_Length(seq);
+    coords = g_new(gint, 2 * num_pixels);
+
+    for (i = 0; i < num_pixels; i++) {
+	PyObject *item = PySequence_GetItem(seq, i);
+	gboolean  ok;
+
+	ok = PyArg_ParseTuple(item, "ii", &coords[2 * i], &coords[2 * i + 1]);
+	Py_XDECREF(item);
+
+	if (!ok) {
+	    PyErr_Clear();
+	    PyErr_SetString(PyExc_TypeError,
+			    "coordinates must be a sequence of (x, y) pairs");
+	    g_free(coords);
+	    return NULL;
+	}
+    }
+
+    *num_coords = 2 * num_pixels;
+
+    return coords;
+}
+
+static PyObject *
+drw_get_pixels(PyGimpDrawable *self, PyObject *args)
+{
+    PyObject *seq, *ret;
+    gint *coords;
+    int num_coords, num_bytes;
+    guint8 *pixels;
+
+    if (!PyArg_ParseTuple(args, "O:get_pixels", &seq))
+	return NULL;
+
+    coords = drw_parse_coords(seq, &num_coords);
+
+    if (!coords)
+	return NULL;
+
+    pixels = gimp_drawable_get_pixels(self->ID, num_coords, coords,
+				      &num_bytes);
+
+    g_free(coords);
+
+    if (!pixels && num_coords > 0) {
+	PyErr_Format(pygimp_error,
+		     "could not get %d pixels on drawable (ID %d)",
+		     num_coords / 2, self->ID);
+	return NULL;
+    }
+
+    ret = PyString_FromStringAndSize((char *)pixels, num_bytes);
+
+    g_free(pixels);
+
+    return ret;
+}
+
+static PyObject *
+drw_set_pixels(PyGimpDrawable *self, PyObject *args)
+{
+    PyObject *seq;
+    gint *coords;
+    int num_coords, num_bytes;
+    guint8 *pixels;
+    gboolean success;
+
+    if (!PyArg_ParseTuple(args, "Os#:set_pixels", &seq, &pixels, &num_bytes))
+	return NULL;
+
+    coords = drw_parse_coords(seq, &num_coords);
+
+    if (!coords)
+	return NULL;
+
+    success = gimp_drawable_set_pixels(self->ID, num_coords, coords,
+				       num_bytes, pixels);
+
+    g_free(coords);
+
+    if (!success) {
+	PyErr_Format(pygimp_error,
+		     "could not set %d pixels from %d bytes on drawable (ID %d)",
+		     num_coords / 2, num_bytes, self->ID);
+	return NULL;
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
+static PyObject *
+drw_get_rect(PyGimpDrawable *self, PyObject *args, PyObject *kwargs)
+{
+    int x, y, width, height, num_bytes;
+    char *format = "";
+    guint8 *data;
+    PyObject *ret;
+
+    static char *kwlist[] = { "x", "y", "width", "height", "format", NULL };
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs,
+				     "iiii|s:get_rect", kwlist,
+				     &x, &y, &width, &height, &format))
+	return NULL;
+
+    data = gimp_drawable_get_rect(self->ID, x, y, width, height, format,
+				  &num_bytes);
+
+    if (!data) {
+	PyErr_Format(pygimp_error,
+		     "could not get rectangle (%d, %d, %d, %d) on "
+		     "drawable (ID %d)",
+		     x, y, width, height, self->ID);
+	return NULL;
+    }
+
+    ret = PyString_FromStringAndSize((char *)data, num_bytes);
+
+    g_free(data);
+
+    return ret;
+}
+
+static PyObject *
+drw_set_rect(PyGimpDrawable *self, PyObject *args, PyObject *kwargs)
+{
+    int x, y, width, height, num_bytes;
+    char *format = "";
+    guint8 *data;
+
+    static char *kwlist[] = { "x", "y", "width", "height", "data", "format",
+			      NULL };
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs,
+				     "iiiis#|s:set_rect", kwlist,
+				     &x, &y, &width, &height,
+				     &data, &num_bytes, &format))
+	return NULL;
+
+    if (!gimp_drawable_set_rect(self->ID, x, y, width, height, format,
+				num_bytes, data)) {
+	PyErr_Format(pygimp_error,
+		     "could not set rectangle (%d, %d, %d, %d) from %d bytes on "
+		     "drawable (ID %d)",
+		     x, y, width, height, num_bytes, self->ID);
+	return NULL;
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 static PyObject *
 drw_mask_intersect(PyGimpDrawable *self)
 {
@@ -1005,6 +1171,10 @@ static PyMethodDef drw_methods[] = {
     {"parasite_list",     (PyCFunction)drw_parasite_list, METH_VARARGS},
     {"get_pixel",	(PyCFunction)drw_get_pixel, METH_VARARGS},
     {"set_pixel",	(PyCFunction)drw_set_pixel, METH_VARARGS},
+    {"get_pixels",	(PyCFunction)drw_get_pixels, METH_VARARGS},
+    {"set_pixels",	(PyCFunction)drw_set_pixels, METH_VARARGS},
+    {"get_rect",	(PyCFunction)drw_get_rect, METH_VARARGS | METH_KEYWORDS},
+    {"set_rect",	(PyCFunction)drw_set_rect, METH_VARARGS | METH_KEYWORDS},
     {"mask_intersect",	(PyCFunction)drw_mask_intersect, METH_NOARGS},
     {"transform_flip",	(PyCFunction)drw_transform_flip, METH_VARARGS | METH_KEYWORDS},
     {"transform_flip_simple",	(PyCFunction)drw_transform_flip_simple, METH_VARARGS | METH_KEYWORDS},
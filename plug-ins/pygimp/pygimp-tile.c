@@ -307,16 +307,45 @@ pr_resize(PyGimpPixelRgn *self, PyObject *args)
     if (!PyArg_ParseTuple(args, "iiii:resize", &x, &y, &w, &h))
 	return NULL;
 
+    if (self->n_exports > 0) {
+	PyErr_SetString(pygimp_error,
+			"can't resize a pixel region whose pixels are in use");
+	return NULL;
+    }
+
+    g_free(self->pixels);
+    self->pixels = NULL;
+
     gimp_pixel_rgn_resize(&(self->pr), x, y, w, h);
 
     Py_INCREF(Py_None);
     return Py_None;
 }
 
+static PyObject *
+pr_flush(PyGimpPixelRgn *self)
+{
+    GimpPixelRgn *pr = &(self->pr);
+
+    if (self->pixels) {
+	if (!pr->dirty) {
+	    PyErr_SetString(PyExc_TypeError, "pixel region is not writable");
+	    return NULL;
+	}
+
+	/* one bulk transfer for the whole region */
+	gimp_pixel_rgn_set_rect(pr, self->pixels, pr->x, pr->y, pr->w, pr->h);
+    }
+
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 
 
 static PyMethodDef pr_methods[] = {
     {"resize",	(PyCFunction)pr_resize,	METH_VARARGS},
+    {"flush",	(PyCFunction)pr_flush,	METH_NOARGS},
 
     {NULL,		NULL}		/* sentinel */
 };
@@ -355,6 +384,9 @@ pygimp_pixel_rgn_new(PyGimpDrawable *drawable, int x, int y,
     self->drawable = drawable;
     Py_INCREF(drawable);
 
+    self->pixels = NULL;
+    self->n_exports = 0;
+
     return (PyObject *)self;
 }
 
@@ -362,10 +394,141 @@ pygimp_pixel_rgn_new(PyGimpDrawable *drawable, int x, int y,
 static void
 pr_dealloc(PyGimpPixelRgn *self)
 {
+    g_free(self->pixels);
     Py_DECREF(self->drawable);
     PyObject_DEL(self);
 }
 
+/* Code to access pr objects as buffers.  The pixels of the whole
+ * region are fetched in one bulk transfer the first time the buffer
+ * is used, so that e.g. numpy.asarray(pr) wraps them without copying.
+ * Changes made through the buffer are written back by pr.flush().
+ */
+
+static int
+pr_fetch_pixels(PyGimpPixelRgn *self)
+{
+    GimpPixelRgn *pr = &(self->pr);
+
+    if (self->pixels)
+	return 0;
+
+    self->pixels = g_try_malloc((gsize) pr->w * pr->h * pr->bpp);
+
+    if (!self->pixels) {
+	PyErr_NoMemory();
+	return -1;
+    }
+
+    gimp_pixel_rgn_get_rect(pr, self->pixels, pr->x, pr->y, pr->w, pr->h);
+
+    return 0;
+}
+
+static Py_ssize_t
+pr_getreadbuf(PyGimpPixelRgn *self, Py_ssize_t segment, void **ptr)
+{
+    if (segment != 0) {
+	PyErr_SetString(PyExc_SystemError,
+			"accessing non-existent pixel region segment");
+	return -1;
+    }
+
+    if (pr_fetch_pixels(self) < 0)
+	return -1;
+
+    *ptr = self->pixels;
+
+    return (Py_ssize_t) self->pr.w * self->pr.h * self->pr.bpp;
+}
+
+static Py_ssize_t
+pr_getwritebuf(PyGimpPixelRgn *self, Py_ssize_t segment, void **ptr)
+{
+    if (!self->pr.dirty) {
+	PyErr_SetString(PyExc_TypeError, "pixel region is not writable");
+	return -1;
+    }
+
+    return pr_getreadbuf(self, segment, ptr);
+}
+
+static Py_ssize_t
+pr_getsegcount(PyGimpPixelRgn *self, Py_ssize_t *lenp)
+{
+    if (lenp)
+	*lenp = (Py_ssize_t) self->pr.w * self->pr.h * self->pr.bpp;
+
+    return 1;
+}
+
+#ifdef Py_TPFLAGS_HAVE_NEWBUFFER
+static int
+pr_getbuffer(PyGimpPixelRgn *self, Py_buffer *view, int flags)
+{
+    GimpPixelRgn *pr = &(self->pr);
+
+    if ((flags & PyBUF_WRITABLE) == PyBUF_WRITABLE && !pr->dirty) {
+	PyErr_SetString(PyExc_TypeError, "pixel region is not writable");
+	return -1;
+    }
+
+    if (pr_fetch_pixels(self) < 0)
+	return -1;
+
+    /* rows, columns and channels, like the region's pixel data */
+    self->shape[0] = pr->h;
+    self->shape[1] = pr->w;
+    self->shape[2] = pr->bpp;
+
+    self->strides[0] = (Py_ssize_t) pr->w * pr->bpp;
+    self->strides[1] = pr->bpp;
+    self->strides[2] = 1;
+
+    view->buf = self->pixels;
+    view->obj = (PyObject *)self;
+    view->len = (Py_ssize_t) pr->w * pr->h * pr->bpp;
+    view->readonly = !pr->dirty;
+    view->itemsize = 1;
+    view->format = (flags & PyBUF_FORMAT) ? "B" : NULL;
+
+    if ((flags & PyBUF_ND) == PyBUF_ND) {
+	view->ndim = 3;
+	view->shape = self->shape;
+    } else {
+	view->ndim = 1;
+	view->shape = NULL;
+    }
+
+    view->strides = ((flags & PyBUF_STRIDES) == PyBUF_STRIDES) ?
+	self->strides : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+
+    Py_INCREF(self);
+    self->n_exports++;
+
+    return 0;
+}
+
+static void
+pr_releasebuffer(PyGimpPixelRgn *self, Py_buffer *view)
+{
+    self->n_exports--;
+}
+#endif
+
+static PyBufferProcs pr_as_buffer = {
+    (readbufferproc)pr_getreadbuf,
+    (writebufferproc)pr_getwritebuf,
+    (segcountproc)pr_getsegcount,
+    (charbufferproc)0,
+#ifdef Py_TPFLAGS_HAVE_NEWBUFFER
+    (getbufferproc)pr_getbuffer,
+    (releasebufferproc)pr_releasebuffer,
+#endif
+};
+
 /* Code to access pr objects as mappings */
 
 static Py_ssize_t
@@ -717,8 +880,12 @@ PyTypeObject PyGimpPixelRgn_Type = {
     (reprfunc)0,                        /* tp_str */
     (getattrofunc)0,                    /* tp_getattro */
     (setattrofunc)0,                    /* tp_setattro */
-    0,					/* tp_as_buffer */
+    &pr_as_buffer,			/* tp_as_buffer */
+#ifdef Py_TPFLAGS_HAVE_NEWBUFFER
+    Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_NEWBUFFER, /* tp_flags */
+#else
     Py_TPFLAGS_DEFAULT,	                /* tp_flags */
+#endif
     NULL, /* Documentation string */
     (traverseproc)0,			/* tp_traverse */
     (inquiry)0,				/* tp_clear */
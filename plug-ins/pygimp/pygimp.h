@@ -98,6 +98,10 @@ typedef struct {
     PyObject_HEAD
     GimpPixelRgn pr;
     PyGimpDrawable *drawable; /* keep the drawable around */
+    guchar *pixels;           /* the region's pixels, for the buffer interface */
+    Py_ssize_t shape[3];
+    Py_ssize_t strides[3];
+    int n_exports;
 } PyGimpPixelRgn;
 
 extern PyTypeObject PyGimpPixelRgn_Type;
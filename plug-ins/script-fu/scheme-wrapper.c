@@ -49,6 +49,14 @@
 
 #undef cons
 
+typedef struct
+{
+  gint          nparams;
+  gint          nreturn_vals;
+  GimpParamDef *params;
+  GimpParamDef *return_vals;
+} ProcInfo;
+
 static void     ts_init_constants                (scheme    *sc);
 static void     ts_init_procedures               (scheme    *sc,
                                                   gboolean   register_scipts);
@@ -206,6 +214,9 @@ static const NamedConstant const old_constants[] =
   { NULL, 0 }
 };
 
+/*  procedure signatures by name, see script_fu_lookup_procedure()  */
+static GHashTable *proc_infos = NULL;
+
 
 static scheme sc;
 
@@ -320,6 +331,13 @@ ts_get_success_msg (void)
   return "Success";
 }
 
+void
+ts_flush_proc_cache (void)
+{
+  if (proc_infos)
+    g_hash_table_remove_all (proc_infos);
+}
+
 void
 ts_stdout_output_func (TsOutputType  type,
                        const char   *string,
@@ -508,64 +526,25 @@ ts_init_procedures (scheme   *sc,
   gimp_procedural_db_query (".*", ".*", ".*", ".*", ".*", ".*", ".*",
                             &num_procs, &proc_list);
 
-  /*  Register each procedure as a scheme func  */
+  /*  Register each procedure as a scheme func.  The number of
+   *  arguments is checked when the procedure is called, so there is
+   *  no need to look up every procedure here.
+   */
   for (i = 0; i < num_procs; i++)
     {
-      gchar           *proc_blurb;
-      gchar           *proc_help;
-      gchar           *proc_author;
-      gchar           *proc_copyright;
-      gchar           *proc_date;
-      GimpPDBProcType  proc_type;
-      gint             n_params;
-      gint             n_return_vals;
-      GimpParamDef    *params;
-      GimpParamDef    *return_vals;
-
-      /*  lookup the procedure  */
-      if (gimp_procedural_db_proc_info (proc_list[i],
-                                        &proc_blurb,
-                                        &proc_help,
-                                        &proc_author,
-                                        &proc_copyright,
-                                        &proc_date,
-                                        &proc_type,
-                                        &n_params, &n_return_vals,
-                                        &params, &return_vals))
-        {
-          gchar *buff;
+      gchar *buff;
 
-          /* Build a define that will call the foreign function.
-           * The Scheme statement was suggested by Simon Budig.
-           */
-          if (n_params == 0)
-            {
-              buff = g_strdup_printf (" (define (%s)"
-                                      " (gimp-proc-db-call \"%s\"))",
-                                      proc_list[i], proc_list[i]);
-            }
-          else
-            {
-              buff = g_strdup_printf (" (define %s (lambda x"
-                                      " (apply gimp-proc-db-call (cons \"%s\" x))))",
-                                      proc_list[i], proc_list[i]);
-            }
-
-          /*  Execute the 'define'  */
-          sc->vptr->load_string (sc, buff);
-
-          g_free (buff);
+      /* Build a define that will call the foreign function.
+       * The Scheme statement was suggested by Simon Budig.
+       */
+      buff = g_strdup_printf (" (define %s (lambda x"
+                              " (apply gimp-proc-db-call (cons \"%s\" x))))",
+                              proc_list[i], proc_list[i]);
 
-          /*  free the queried information  */
-          g_free (proc_blurb);
-          g_free (proc_help);
-          g_free (proc_author);
-          g_free (proc_copyright);
-          g_free (proc_date);
+      /*  Execute the 'define'  */
+      sc->vptr->load_string (sc, buff);
 
-          gimp_destroy_paramdefs (params, n_params);
-          gimp_destroy_paramdefs (return_vals, n_return_vals);
-        }
+      g_free (buff);
     }
 
   g_strfreev (proc_list);
@@ -605,6 +584,70 @@ convert_string (gchar *str)
     }
 }
 
+static void
+proc_info_free (ProcInfo *info)
+{
+  gimp_destroy_paramdefs (info->params,      info->nparams);
+  gimp_destroy_paramdefs (info->return_vals, info->nreturn_vals);
+
+  g_slice_free (ProcInfo, info);
+}
+
+/*  Procedure signatures don't change while a procedure is installed,
+ *  so look each one up only once instead of on every call.  Scripts
+ *  may change their signatures when they are refreshed, see
+ *  ts_flush_proc_cache().
+ */
+static const ProcInfo *
+script_fu_lookup_procedure (const gchar *proc_name)
+{
+  ProcInfo        *info;
+  gchar           *proc_blurb;
+  gchar           *proc_help;
+  gchar           *proc_author;
+  gchar           *proc_copyright;
+  gchar           *proc_date;
+  GimpPDBProcType  proc_type;
+
+  if (! proc_infos)
+    proc_infos = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                        g_free,
+                                        (GDestroyNotify) proc_info_free);
+
+  info = g_hash_table_lookup (proc_infos, proc_name);
+
+  if (info)
+    return info;
+
+  info = g_slice_new (ProcInfo);
+
+  if (! gimp_procedural_db_proc_info (proc_name,
+                                      &proc_blurb,
+                                      &proc_help,
+                                      &proc_author,
+                                      &proc_copyright,
+                                      &proc_date,
+                                      &proc_type,
+                                      &info->nparams, &info->nreturn_vals,
+                                      &info->params, &info->return_vals))
+    {
+      /*  don't cache failures, the procedure may be installed later  */
+      g_slice_free (ProcInfo, info);
+
+      return NULL;
+    }
+
+  g_free (proc_blurb);
+  g_free (proc_help);
+  g_free (proc_author);
+  g_free (proc_copyright);
+  g_free (proc_date);
+
+  g_hash_table_insert (proc_infos, g_strdup (proc_name), info);
+
+  return info;
+}
+
 /* This is called by the Scheme interpreter to allow calls to GIMP functions */
 static pointer
 script_fu_marshal_procedure_call (scheme  *sc,
@@ -614,12 +657,7 @@ script_fu_marshal_procedure_call (scheme  *sc,
   GimpParam       *values = NULL;
   gint             nvalues;
   gchar           *proc_name;
-  gchar           *proc_blurb;
-  gchar           *proc_help;
-  gchar           *proc_author;
-  gchar           *proc_copyright;
-  gchar           *proc_date;
-  GimpPDBProcType  proc_type;
+  const ProcInfo  *proc_info;
   gint             nparams;
   gint             nreturn_vals;
   GimpParamDef    *params;
@@ -669,15 +707,9 @@ script_fu_marshal_procedure_call (scheme  *sc,
   script_fu_interface_report_cc (proc_name);
 
   /*  Attempt to fetch the procedure from the database  */
-  if (! gimp_procedural_db_proc_info (proc_name,
-                                      &proc_blurb,
-                                      &proc_help,
-                                      &proc_author,
-                                      &proc_copyright,
-                                      &proc_date,
-                                      &proc_type,
-                                      &nparams, &nreturn_vals,
-                                      &params, &return_vals))
+  proc_info = script_fu_lookup_procedure (proc_name);
+
+  if (! proc_info)
     {
 #ifdef DEBUG_MARSHALL
       g_printerr ("  Invalid procedure name\n");
@@ -687,17 +719,10 @@ script_fu_marshal_procedure_call (scheme  *sc,
       return foreign_error (sc, error_str, 0);
     }
 
-  /* Free the name and the description which are of no use here.  */
-  for (i = 0; i < nparams; i++)
-    {
-      g_free (params[i].name);
-      g_free (params[i].description);
-    }
-  for (i = 0; i < nreturn_vals; i++)
-    {
-      g_free (return_vals[i].name);
-      g_free (return_vals[i].description);
-    }
+  nparams      = proc_info->nparams;
+  nreturn_vals = proc_info->nreturn_vals;
+  params       = proc_info->params;
+  return_vals  = proc_info->return_vals;
 
   /*  Check the supplied number of arguments  */
   if ((sc->vptr->list_length (sc, a) - 1) != nparams)
@@ -1616,15 +1641,6 @@ script_fu_marshal_procedure_call (scheme  *sc,
   /*  free up arguments and values  */
   script_fu_marshal_destroy_args (args, nparams);
 
-  /*  free the query information  */
-  g_free (proc_blurb);
-  g_free (proc_help);
-  g_free (proc_author);
-  g_free (proc_copyright);
-  g_free (proc_date);
-  g_free (params);
-  g_free (return_vals);
-
   /*  if we're in server mode, listen for additional commands for 10 ms  */
   if (script_fu_server_get_mode ())
     script_fu_server_listen (10);
@@ -30,6 +30,8 @@ void          ts_print_welcome        (void);
 
 const gchar * ts_get_success_msg      (void);
 
+void          ts_flush_proc_cache     (void);
+
 void          ts_interpret_stdin      (void);
 
 /* if the return value is 0, success. error otherwise. */
@@ -82,6 +82,13 @@ typedef short sa_family_t;	/* Not defined by winsock */
 #define RESPONSE_HEADER 4
 #define MAGIC           'G'
 
+#define READ_BUFFER_SIZE 4096
+
+/*  The environment variable overriding the request timeout when the
+ *  server is started non-interactively
+ */
+#define TIMEOUT_ENV     "SCRIPT_FU_SERVER_TIMEOUT"
+
 #ifndef HAVE_DIFFTIME
 #define difftime(a,b) (((gdouble)(a)) - ((gdouble)(b)))
 #endif
@@ -127,18 +134,27 @@ typedef short sa_family_t;	/* Not defined by winsock */
 
 typedef struct
 {
-  gchar *command;
-  gint   filedes;
-  gint   request_no;
+  gchar  *command;
+  gint    filedes;
+  gint    request_no;
+  gint64  queued;      /*  when the request was received  */
 } SFCommand;
 
+typedef struct
+{
+  gchar      *address;
+  GByteArray *input;   /*  received bytes not forming a command yet  */
+} SFClient;
+
 typedef struct
 {
   GtkWidget *port_entry;
   GtkWidget *log_entry;
+  GtkWidget *timeout_entry;
 
   gint       port;
   gchar     *logfile;
+  gint       timeout;
 
   gboolean   run;
 } ServerInterface;
@@ -157,9 +173,17 @@ typedef union
  */
 
 static void      server_start       (gint         port,
-                                     const gchar *logfile);
+                                     const gchar *logfile,
+                                     gint         timeout);
 static gboolean  execute_command    (SFCommand   *cmd);
+static gboolean  send_all           (gint          filedes,
+                                     const guchar *data,
+                                     gsize         len);
+static gboolean  send_response      (SFCommand   *cmd,
+                                     gboolean     error,
+                                     GString     *response);
 static gint      read_from_client   (gint         filedes);
+static void      client_free        (SFClient    *client);
 static gint      make_socket        (const struct addrinfo
                                                  *ai);
 static void      server_log         (const gchar *format,
@@ -186,14 +210,17 @@ static FILE        *server_log_file = NULL;
 static GHashTable  *clients         = NULL;
 static gboolean     script_fu_done  = FALSE;
 static gboolean     server_mode     = FALSE;
+static gint         server_timeout  = 0;
 
 static ServerInterface sint =
 {
   NULL,  /*  port entry widget    */
   NULL,  /*  log entry widget     */
+  NULL,  /*  timeout entry widget */
 
   10008, /*  default port number  */
   NULL,  /*  use stdout           */
+  0,     /*  no request timeout   */
 
   FALSE  /*  run                  */
 };
@@ -238,16 +265,21 @@ script_fu_server_run (const gchar      *name,
           server_mode = TRUE;
 
           /*  Start the server  */
-          server_start (sint.port, sint.logfile);
+          server_start (sint.port, sint.logfile, sint.timeout);
         }
       break;
 
     case GIMP_RUN_NONINTERACTIVE:
-      /*  Set server_mode to TRUE  */
-      server_mode = TRUE;
+      {
+        const gchar *timeout = g_getenv (TIMEOUT_ENV);
+
+        /*  Set server_mode to TRUE  */
+        server_mode = TRUE;
 
-      /*  Start the server  */
-      server_start (params[1].data.d_int32, params[2].data.d_string);
+        /*  Start the server  */
+        server_start (params[1].data.d_int32, params[2].data.d_string,
+                      timeout ? MAX (atoi (timeout), 0) : 0);
+      }
       break;
 
     case GIMP_RUN_WITH_LAST_VALS:
@@ -286,7 +318,8 @@ script_fu_server_read_fd (gpointer key,
         {
           GList *list;
 
-          server_log ("Server: disconnect from host %s.\n", (gchar *) value);
+          server_log ("Server: disconnect from host %s.\n",
+                      ((SFClient *) value)->address);
 
           CLOSESOCKET (fd);
 
@@ -294,7 +327,7 @@ script_fu_server_read_fd (gpointer key,
               from the disconnected client.  */
           for (list = command_queue; list; list = list->next)
             {
-              SFCommand *cmd = (SFCommand *) command_queue->data;
+              SFCommand *cmd = (SFCommand *) list->data;
 
               if (cmd->filedes == fd)
                 cmd->filedes = -1;
@@ -319,7 +352,7 @@ script_fu_server_listen (gint timeout)
   if (timeout)
     {
       tv.tv_sec  = timeout / 1000;
-      tv.tv_usec = timeout % 1000;
+      tv.tv_usec = (timeout % 1000) * 1000;
       tvp = &tv;
     }
 
@@ -372,8 +405,14 @@ script_fu_server_listen (gint timeout)
       (void) getnameinfo (&(client.sa), size, clientname, sizeof (clientname),
                           NULL, 0, NI_NUMERICHOST);
 
-      g_hash_table_insert (clients, GINT_TO_POINTER (new),
-                           g_strdup (clientname));
+      {
+        SFClient *sf_client = g_slice_new0 (SFClient);
+
+        sf_client->address = g_strdup (clientname);
+        sf_client->input   = g_byte_array_new ();
+
+        g_hash_table_insert (clients, GINT_TO_POINTER (new), sf_client);
+      }
 
       /* Determine port number */
       switch (client.family)
@@ -449,7 +488,8 @@ server_progress_uninstall (const gchar *progress)
 
 static void
 server_start (gint         port,
-              const gchar *logfile)
+              const gchar *logfile,
+              gint         timeout)
 {
   struct addrinfo *ai,
                   *ai_curr;
@@ -502,12 +542,18 @@ server_start (gint         port,
 
   /*  Set up the clientname hash table  */
   clients = g_hash_table_new_full (g_direct_hash, NULL,
-                                   NULL, (GDestroyNotify) g_free);
+                                   NULL, (GDestroyNotify) client_free);
+
+  server_timeout = timeout;
 
   progress = server_progress_install ();
 
   server_log ("Script-Fu server initialized and listening...\n");
 
+  if (server_timeout > 0)
+    server_log ("Requests waiting longer than %d seconds are rejected.\n",
+                server_timeout);
+
   /*  Loop until the server is finished  */
   while (! script_fu_done)
     {
@@ -515,10 +561,29 @@ server_start (gint         port,
 
       while (command_queue)
         {
-          SFCommand *cmd = (SFCommand *) command_queue->data;
+          SFCommand *cmd    = (SFCommand *) command_queue->data;
+          gint64     waited = g_get_monotonic_time () - cmd->queued;
 
-          /*  Process the command  */
-          execute_command (cmd);
+          /*  Process the command, unless it waited for too long  */
+          if (server_timeout > 0 && waited > server_timeout * G_USEC_PER_SEC)
+            {
+              GString *response;
+
+              response = g_string_new (NULL);
+              g_string_printf (response,
+                               "Request timed out after waiting %d seconds "
+                               "in the queue", server_timeout);
+
+              server_log ("Request #%d timed out after waiting %f seconds\n",
+                          cmd->request_no, (gdouble) waited / G_USEC_PER_SEC);
+
+              send_response (cmd, TRUE, response);
+              g_string_free (response, TRUE);
+            }
+          else
+            {
+              execute_command (cmd);
+            }
 
           /*  Remove the command from the list  */
           command_queue = g_list_remove (command_queue, cmd);
@@ -538,12 +603,10 @@ server_start (gint         port,
 static gboolean
 execute_command (SFCommand *cmd)
 {
-  guchar    buffer[RESPONSE_HEADER];
   GString  *response;
   time_t    clock1;
   time_t    clock2;
   gboolean  error;
-  gint      i;
 
   server_log ("Processing request #%d\n", cmd->request_no);
   time (&clock1);
@@ -570,48 +633,21 @@ execute_command (SFCommand *cmd)
                   cmd->request_no, difftime (clock2, clock1), ctime (&clock2));
     }
 
-  buffer[MAGIC_BYTE]     = MAGIC;
-  buffer[ERROR_BYTE]     = error ? TRUE : FALSE;
-  buffer[RSP_LEN_H_BYTE] = (guchar) (response->len >> 8);
-  buffer[RSP_LEN_L_BYTE] = (guchar) (response->len & 0xFF);
-
-  /*  Write the response to the client  */
-  for (i = 0; i < RESPONSE_HEADER; i++)
-    if (cmd->filedes > 0 && send (cmd->filedes, buffer + i, 1, 0) < 0)
-      {
-        /*  Write error  */
-        print_socket_api_error ("send");
-        return FALSE;
-      }
-
-  for (i = 0; i < response->len; i++)
-    if (cmd->filedes > 0 && send (cmd->filedes, response->str + i, 1, 0) < 0)
-      {
-        /*  Write error  */
-        print_socket_api_error ("send");
-        return FALSE;
-      }
+  send_response (cmd, error, response);
 
   g_string_free (response, TRUE);
 
   return FALSE;
 }
 
-static gint
-read_from_client (gint filedes)
+static gboolean
+send_all (gint          filedes,
+          const guchar *data,
+          gsize         len)
 {
-  SFCommand *cmd;
-  guchar     buffer[COMMAND_HEADER];
-  gchar     *command;
-  gchar     *clientaddr;
-  time_t     clock;
-  gint       command_len;
-  gint       nbytes;
-  gint       i;
-
-  for (i = 0; i < COMMAND_HEADER;)
+  while (len > 0)
     {
-      nbytes = recv (filedes, buffer + i, COMMAND_HEADER - i, 0);
+      gint nbytes = send (filedes, data, len, 0);
 
       if (nbytes < 0)
         {
@@ -619,67 +655,135 @@ read_from_client (gint filedes)
           if (errno == EINTR)
             continue;
 #endif
-          server_log ("Error reading command header.\n");
-          return -1;
+          /*  Write error  */
+          print_socket_api_error ("send");
+          return FALSE;
         }
 
-      if (nbytes == 0)
-        return -1;  /* EOF */
-
-      i += nbytes;
+      data += nbytes;
+      len  -= nbytes;
     }
 
-  if (buffer[MAGIC_BYTE] != MAGIC)
+  return TRUE;
+}
+
+static gboolean
+send_response (SFCommand *cmd,
+               gboolean   error,
+               GString   *response)
+{
+  guchar buffer[RESPONSE_HEADER];
+
+  /*  The client is gone  */
+  if (cmd->filedes <= 0)
+    return FALSE;
+
+  buffer[MAGIC_BYTE]     = MAGIC;
+  buffer[ERROR_BYTE]     = error ? TRUE : FALSE;
+  buffer[RSP_LEN_H_BYTE] = (guchar) (response->len >> 8);
+  buffer[RSP_LEN_L_BYTE] = (guchar) (response->len & 0xFF);
+
+  /*  Write the response to the client  */
+  return (send_all (cmd->filedes, buffer, RESPONSE_HEADER) &&
+          send_all (cmd->filedes, (const guchar *) response->str,
+                    response->len));
+}
+
+/*  Reads what the client sent and queues all complete commands.  It
+ *  reads only once, so a client sending a command slowly doesn't block
+ *  the server, and clients may send several commands without waiting
+ *  for the responses.
+ */
+static gint
+read_from_client (gint filedes)
+{
+  SFClient *client;
+  guchar    buffer[READ_BUFFER_SIZE];
+  gint      nbytes;
+
+  client = g_hash_table_lookup (clients, GINT_TO_POINTER (filedes));
+
+  nbytes = recv (filedes, buffer, sizeof (buffer), 0);
+
+  if (nbytes < 0)
     {
-      server_log ("Error in script-fu command transmission.\n");
+#ifndef G_OS_WIN32
+      if (errno == EINTR)
+        return 0;
+#endif
+      server_log ("Error reading command.\n");
       return -1;
     }
 
-  command_len = (buffer [CMD_LEN_H_BYTE] << 8) | buffer [CMD_LEN_L_BYTE];
-  command = g_new (gchar, command_len + 1);
+  if (nbytes == 0)
+    {
+      if (client->input->len > 0)
+        server_log ("Error reading command.  Read %d out of %d bytes.\n",
+                    client->input->len,
+                    client->input->len < COMMAND_HEADER ?
+                    COMMAND_HEADER :
+                    COMMAND_HEADER +
+                    ((client->input->data[CMD_LEN_H_BYTE] << 8) |
+                     client->input->data[CMD_LEN_L_BYTE]));
+
+      return -1;  /* EOF */
+    }
 
-  for (i = 0; i < command_len;)
+  g_byte_array_append (client->input, buffer, nbytes);
+
+  while (client->input->len >= COMMAND_HEADER)
     {
-      nbytes = recv (filedes, command + i, command_len - i, 0);
+      const guchar *data = client->input->data;
+      SFCommand    *cmd;
+      time_t        clock;
+      gint          command_len;
 
-      if (nbytes <= 0)
+      if (data[MAGIC_BYTE] != MAGIC)
         {
-#ifndef G_OS_WIN32
-          if (nbytes < 0 && errno == EINTR)
-            continue;
-#endif
-           server_log ("Error reading command.  Read %d out of %d bytes.\n",
-                       i, command_len);
-           g_free (command);
-           return -1;
+          server_log ("Error in script-fu command transmission.\n");
+          return -1;
         }
 
-      i += nbytes;
-    }
+      command_len = (data[CMD_LEN_H_BYTE] << 8) | data[CMD_LEN_L_BYTE];
+
+      if (client->input->len < COMMAND_HEADER + command_len)
+        break;
 
-  command[command_len] = '\0';
-  cmd = g_new (SFCommand, 1);
+      cmd = g_new (SFCommand, 1);
 
-  cmd->filedes    = filedes;
-  cmd->command    = command;
-  cmd->request_no = request_no ++;
+      cmd->filedes    = filedes;
+      cmd->command    = g_strndup ((const gchar *) data + COMMAND_HEADER,
+                                   command_len);
+      cmd->request_no = request_no ++;
+      cmd->queued     = g_get_monotonic_time ();
 
-  /*  Add the command to the queue  */
-  command_queue = g_list_append (command_queue, cmd);
-  queue_length ++;
+      g_byte_array_remove_range (client->input,
+                                 0, COMMAND_HEADER + command_len);
 
-  /*  Get the client address from the address/socket table  */
-  clientaddr = g_hash_table_lookup (clients, GINT_TO_POINTER (cmd->filedes));
-  time (&clock);
-  server_log ("Received request #%d from IP address %s: %s on %s,"
-              "[Request queue length: %d]",
-              cmd->request_no,
-                  clientaddr ? clientaddr : "<invalid>",
-                      cmd->command, ctime (&clock), queue_length);
+      /*  Add the command to the queue  */
+      command_queue = g_list_append (command_queue, cmd);
+      queue_length ++;
+
+      time (&clock);
+      server_log ("Received request #%d from IP address %s: %s on %s,"
+                  "[Request queue length: %d]",
+                  cmd->request_no,
+                  client->address,
+                  cmd->command, ctime (&clock), queue_length);
+    }
 
   return 0;
 }
 
+static void
+client_free (SFClient *client)
+{
+  g_free (client->address);
+  g_byte_array_free (client->input, TRUE);
+
+  g_slice_free (SFClient, client);
+}
+
 static gint
 make_socket (const struct addrinfo *ai)
 {
@@ -788,9 +892,10 @@ server_quit (void)
 
       g_free (cmd->command);
       g_free (cmd);
+
+      command_queue = g_list_delete_link (command_queue, command_queue);
     }
 
-  g_list_free (command_queue);
   command_queue = NULL;
   queue_length  = 0;
 
@@ -832,8 +937,8 @@ server_interface (void)
                     G_CALLBACK (gtk_main_quit),
                     NULL);
 
-  /*  The table to hold port & logfile entries  */
-  table = gtk_table_new (2, 2, FALSE);
+  /*  The table to hold port, logfile & timeout entries  */
+  table = gtk_table_new (3, 2, FALSE);
   gtk_table_set_col_spacings (GTK_TABLE (table), 6);
   gtk_table_set_row_spacings (GTK_TABLE (table), 6);
   gtk_container_set_border_width (GTK_CONTAINER (table), 12);
@@ -853,6 +958,17 @@ server_interface (void)
                              _("Server logfile:"), 0.0, 0.5,
                              sint.log_entry, 1, FALSE);
 
+  /*  The request timeout  */
+  sint.timeout_entry = gtk_entry_new ();
+  gtk_entry_set_text (GTK_ENTRY (sint.timeout_entry), "0");
+  gimp_help_set_help_data (sint.timeout_entry,
+                           _("Seconds a request may wait in the queue "
+                             "before it is rejected, 0 for no limit"),
+                           NULL);
+  gimp_table_attach_aligned (GTK_TABLE (table), 0, 2,
+                             _("Request timeout:"), 0.0, 0.5,
+                             sint.timeout_entry, 1, FALSE);
+
   gtk_widget_show (table);
   gtk_widget_show (dlg);
 
@@ -872,6 +988,7 @@ response_callback (GtkWidget *widget,
 
       sint.port    = atoi (gtk_entry_get_text (GTK_ENTRY (sint.port_entry)));
       sint.logfile = g_strdup (gtk_entry_get_text (GTK_ENTRY (sint.log_entry)));
+      sint.timeout = MAX (atoi (gtk_entry_get_text (GTK_ENTRY (sint.timeout_entry))), 0);
       sint.run     = TRUE;
     }
 
@@ -365,6 +365,8 @@ script_fu_refresh_proc (const gchar      *name,
       /*  Reload all of the available scripts  */
       gchar *path = script_fu_search_path ();
 
+      ts_flush_proc_cache ();
+
       script_fu_find_scripts (path);
 
       g_free (path);
@@ -867,13 +867,20 @@ pointer _cons(scheme *sc, pointer a, pointer b, int immutable) {
 
 /* ========== oblist implementation  ========== */
 
+/* Script-Fu interns a symbol for every PDB procedure, so the symbol
+ * table and the global frame hold a few thousand names.  Both sizes
+ * are primes.
+ */
+#define OBLIST_SIZE     4099
+#define GLOBAL_ENV_SIZE 4099
+
 #ifndef USE_OBJECT_LIST
 
 static int hash_fn(const char *key, int table_size);
 
 static pointer oblist_initial_value(scheme *sc)
 {
-  return mk_vector(sc, 461); /* probably should be bigger */
+  return mk_vector(sc, OBLIST_SIZE);
 }
 
 /* returns the new symbol */
@@ -2375,9 +2382,11 @@ static void new_frame_in_env(scheme *sc, pointer old_env)
 {
   pointer new_frame;
 
-  /* The interaction-environment has about 300 variables in it. */
+  /* The interaction-environment has about 300 variables in it,
+   * plus one for each PDB procedure in Script-Fu.
+   */
   if (old_env == sc->NIL) {
-    new_frame = mk_vector(sc, 461);
+    new_frame = mk_vector(sc, GLOBAL_ENV_SIZE);
   } else {
     new_frame = sc->NIL;
   }
@@ -148,6 +148,13 @@ typedef struct index_list
 #define INDEX_LIST_LENGTH(i_l)  ((i_l).length)
 #define GET_LAST_INDEX(i_l)  ((i_l).data[INDEX_LIST_LENGTH (i_l) - 1])
 
+/* One outline to fit, and the splines fitted to it.  */
+typedef struct outline_fit
+{
+  pixel_outline_type pixel_outline;
+  spline_list_type splines;
+} outline_fit_type;
+
 static void append_index (index_list_type *, unsigned);
 static void free_index_list (index_list_type *);
 static index_list_type new_index_list (void);
@@ -169,13 +176,14 @@ static void find_tangent (curve_type, boolean, boolean);
 static spline_type fit_one_spline (curve_type);
 static spline_list_type *fit_curve (curve_type);
 static spline_list_type fit_curve_list (curve_list_type);
+static void fit_pixel_outline (outline_fit_type *, gpointer);
 static spline_list_type *fit_with_least_squares (curve_type);
 static spline_list_type *fit_with_line (curve_type);
 static void remove_knee_points (curve_type, boolean);
 static boolean reparameterize (curve_type, spline_type);
 static void set_initial_parameter_values (curve_type);
 static boolean spline_linear_enough (spline_type *, curve_type);
-static curve_list_array_type split_at_corners (pixel_outline_list_type);
+static curve_list_type split_outline_at_corners (pixel_outline_type);
 static boolean test_subdivision_point (curve_type, unsigned, vector_type *);
 
 /* The top-level call that transforms the list of pixels in the outlines
@@ -188,21 +196,39 @@ fitted_splines (pixel_outline_list_type pixel_outline_list)
   unsigned this_list;
   unsigned total = 0;
   spline_list_array_type char_splines = new_spline_list_array ();
-  curve_list_array_type curve_array = split_at_corners (pixel_outline_list);
+  outline_fit_type *fits;
+  GThreadPool *pool;
+
+  if (O_LIST_LENGTH (pixel_outline_list) == 0)
+    return char_splines;
 
-  for (this_list = 0; this_list < CURVE_LIST_ARRAY_LENGTH (curve_array);
+  /* Each outline is split and fitted on its own, so we do them in
+     parallel.  Every outline has its own slot to keep the order.  */
+  fits = g_new (outline_fit_type, O_LIST_LENGTH (pixel_outline_list));
+
+  pool = g_thread_pool_new ((GFunc) fit_pixel_outline, NULL,
+                            g_get_num_processors (), FALSE, NULL);
+
+  for (this_list = 0; this_list < O_LIST_LENGTH (pixel_outline_list);
        this_list++)
     {
-      spline_list_type curve_list_splines;
-      curve_list_type curves = CURVE_LIST_ARRAY_ELT (curve_array, this_list);
+      fits[this_list].pixel_outline = O_LIST_OUTLINE (pixel_outline_list,
+                                                      this_list);
+      g_thread_pool_push (pool, &fits[this_list], NULL);
+    }
 
-      curve_list_splines = fit_curve_list (curves);
-      append_spline_list (&char_splines, curve_list_splines);
+  /* Wait for all of them.  */
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  for (this_list = 0; this_list < O_LIST_LENGTH (pixel_outline_list);
+       this_list++)
+    {
+      append_spline_list (&char_splines, fits[this_list].splines);
 
 /*       REPORT ("* "); */
     }
 
-  free_curve_list_array (&curve_array);
+  g_free (fits);
 
   for (this_list = 0; this_list < SPLINE_LIST_ARRAY_LENGTH (char_splines);
        this_list++)
@@ -214,6 +240,20 @@ fitted_splines (pixel_outline_list_type pixel_outline_list)
   return char_splines;
 }
 
+
+/* Split one outline at its corners and fit splines to the pieces.
+   This runs in a worker thread, so it must only touch FIT.  */
+
+static void
+fit_pixel_outline (outline_fit_type *fit, gpointer data)
+{
+  curve_list_type curves = split_outline_at_corners (fit->pixel_outline);
+
+  fit->splines = fit_curve_list (curves);
+
+  free_curve_list (&curves);
+}
+
 /* Set up the internal parameters from the external ones */
 
 void
@@ -308,7 +348,7 @@ fit_curve_list (curve_list_type curve_list)
      the tangents and t values, but it's worth it for the continuity.
      Of course we don't want to do this if the two points are already
      the same, as they are if the curve is cyclic.  (We don't append it
-     earlier, in `split_at_corners', because that confuses the
+     earlier, in `split_outline_at_corners', because that confuses the
      filtering.)  Finally, we can't append the point if the curve is
      exactly three points long, because we aren't adding any more data,
      and three points isn't enough to determine a spline.  Therefore,
@@ -387,11 +427,11 @@ fit_curve (curve_type curve)
 }
 
 /* As mentioned above, the first step is to find the corners in
-   PIXEL_LIST, the list of points.  (Presumably we can't fit a single
+   PIXEL_O, the list of points.  (Presumably we can't fit a single
    spline around a corner.)  The general strategy is to look through all
    the points, remembering which we want to consider corners.  Then go
    through that list, producing the curve_list.  This is dictated by the
-   fact that PIXEL_LIST does not necessarily start on a corner---it just
+   fact that PIXEL_O does not necessarily start on a corner---it just
    starts at the character's first outline pixel, going left-to-right,
    top-to-bottom.  But we want all our splines to start and end on real
    corners.
@@ -401,109 +441,93 @@ fit_curve (curve_type curve)
                      ***********
                   ******************
 
-   PIXEL_LIST will start at the pixel below the `x'.  If we considered
+   PIXEL_O will start at the pixel below the `x'.  If we considered
    this pixel a corner, we would wind up matching a very small segment
    from there to the end of the line, probably as a straight line, which
    is certainly not what we want.
 
-   PIXEL_LIST has one element for each closed outline on the character.
-   To preserve this information, we return an array of curve_lists, one
-   element (which in turn consists of several curves, one between each
-   pair of corners) for each element in PIXEL_LIST.  */
+   PIXEL_O is one closed outline on the character.  We return a
+   curve_list for it, which consists of several curves, one between
+   each pair of corners.  */
 
-static curve_list_array_type
-split_at_corners (pixel_outline_list_type pixel_list)
+static curve_list_type
+split_outline_at_corners (pixel_outline_type pixel_o)
 {
-  unsigned this_pixel_o;
-  curve_list_array_type curve_array = new_curve_list_array ();
-
-/*   LOG ("\nFinding corners:\n"); */
-
-  for (this_pixel_o = 0; this_pixel_o < O_LIST_LENGTH (pixel_list);
-       this_pixel_o++)
+  curve_type curve, first_curve;
+  index_list_type corner_list;
+  unsigned p, this_corner;
+  curve_list_type curve_list = new_curve_list ();
+
+  CURVE_LIST_CLOCKWISE (curve_list) = O_CLOCKWISE (pixel_o);
+
+  /* If the outline does not have enough points, we can't do
+     anything.  The endpoints of the outlines are automatically
+     corners.  We need at least `corner_surround' more pixels on
+     either side of a point before it is conceivable that we might
+     want another corner.  */
+  if (O_LENGTH (pixel_o) > corner_surround * 2 + 2)
     {
-      curve_type curve, first_curve;
-      index_list_type corner_list;
-      unsigned p, this_corner;
-      curve_list_type curve_list = new_curve_list ();
-      pixel_outline_type pixel_o = O_LIST_OUTLINE (pixel_list, this_pixel_o);
-
-      CURVE_LIST_CLOCKWISE (curve_list) = O_CLOCKWISE (pixel_o);
-
-/*       LOG1 ("#%u:", this_pixel_o); */
-
-      /* If the outline does not have enough points, we can't do
-         anything.  The endpoints of the outlines are automatically
-         corners.  We need at least `corner_surround' more pixels on
-         either side of a point before it is conceivable that we might
-         want another corner.  */
-      if (O_LENGTH (pixel_o) > corner_surround * 2 + 2)
-        {
-          corner_list = find_corners (pixel_o);
-        }
-      else
-        {
-          corner_list.data   = NULL;
-          corner_list.length = 0;
-        }
-
-      /* Remember the first curve so we can make it be the `next' of the
-         last one.  (And vice versa.)  */
-      first_curve = new_curve ();
-
-      curve = first_curve;
+      corner_list = find_corners (pixel_o);
+    }
+  else
+    {
+      corner_list.data   = NULL;
+      corner_list.length = 0;
+    }
 
-      if (corner_list.length == 0)
-        { /* No corners.  Use all of the pixel outline as the curve.  */
-          for (p = 0; p < O_LENGTH (pixel_o); p++)
-            append_pixel (curve, O_COORDINATE (pixel_o, p));
+  /* Remember the first curve so we can make it be the `next' of the
+     last one.  (And vice versa.)  */
+  first_curve = new_curve ();
 
-          /* This curve is cyclic.  */
-          CURVE_CYCLIC (curve) = true;
-        }
-      else
-        { /* Each curve consists of the points between (inclusive) each pair
-             of corners.  */
-          for (this_corner = 0; this_corner < corner_list.length - 1;
-               this_corner++)
-            {
-              curve_type previous_curve = curve;
-              unsigned corner = GET_INDEX (corner_list, this_corner);
-              unsigned next_corner = GET_INDEX (corner_list, this_corner + 1);
+  curve = first_curve;
 
-              for (p = corner; p <= next_corner; p++)
-                append_pixel (curve, O_COORDINATE (pixel_o, p));
+  if (corner_list.length == 0)
+    { /* No corners.  Use all of the pixel outline as the curve.  */
+      for (p = 0; p < O_LENGTH (pixel_o); p++)
+        append_pixel (curve, O_COORDINATE (pixel_o, p));
 
-              append_curve (&curve_list, curve);
-              curve = new_curve ();
-              NEXT_CURVE (previous_curve) = curve;
-              PREVIOUS_CURVE (curve) = previous_curve;
-            }
+      /* This curve is cyclic.  */
+      CURVE_CYCLIC (curve) = true;
+    }
+  else
+    { /* Each curve consists of the points between (inclusive) each pair
+         of corners.  */
+      for (this_corner = 0; this_corner < corner_list.length - 1;
+           this_corner++)
+        {
+          curve_type previous_curve = curve;
+          unsigned corner = GET_INDEX (corner_list, this_corner);
+          unsigned next_corner = GET_INDEX (corner_list, this_corner + 1);
 
-          /* The last curve is different.  It consists of the points
-             (inclusive) between the last corner and the end of the list,
-             and the beginning of the list and the first corner.  */
-          for (p = GET_LAST_INDEX (corner_list); p < O_LENGTH (pixel_o);
-               p++)
+          for (p = corner; p <= next_corner; p++)
             append_pixel (curve, O_COORDINATE (pixel_o, p));
 
-          for (p = 0; p <= GET_INDEX (corner_list, 0); p++)
-            append_pixel (curve, O_COORDINATE (pixel_o, p));
+          append_curve (&curve_list, curve);
+          curve = new_curve ();
+          NEXT_CURVE (previous_curve) = curve;
+          PREVIOUS_CURVE (curve) = previous_curve;
         }
 
-/*       LOG1 (" [%u].\n", corner_list.length); */
+      /* The last curve is different.  It consists of the points
+         (inclusive) between the last corner and the end of the list,
+         and the beginning of the list and the first corner.  */
+      for (p = GET_LAST_INDEX (corner_list); p < O_LENGTH (pixel_o);
+           p++)
+        append_pixel (curve, O_COORDINATE (pixel_o, p));
+
+      for (p = 0; p <= GET_INDEX (corner_list, 0); p++)
+        append_pixel (curve, O_COORDINATE (pixel_o, p));
+    }
 
-      /* Add `curve' to the end of the list, updating the pointers in
-         the chain.  */
-      append_curve (&curve_list, curve);
-      NEXT_CURVE (curve) = first_curve;
-      PREVIOUS_CURVE (first_curve) = curve;
+/*   LOG1 (" [%u].\n", corner_list.length); */
 
-      /* And now add the just-completed curve list to the array.  */
-      append_curve_list (&curve_array, curve_list);
-    }				/* End of considering each pixel outline.  */
+  /* Add `curve' to the end of the list, updating the pointers in
+     the chain.  */
+  append_curve (&curve_list, curve);
+  NEXT_CURVE (curve) = first_curve;
+  PREVIOUS_CURVE (first_curve) = curve;
 
-  return curve_array;
+  return curve_list;
 }
 
 
@@ -81,7 +81,7 @@ const GimpPlugInInfo PLUG_IN_INFO =
 static gint        sel_x1, sel_y1, sel_x2, sel_y2;
 static gint        has_sel, sel_width, sel_height;
 static SELVALS     selVals;
-static GeglBuffer *sel_buffer;
+static guchar     *sel_data;
 static gboolean    retVal = TRUE;  /* Toggle if cancle button clicked */
 
 MAIN ()
@@ -364,19 +364,17 @@ guchar
 sel_pixel_value (gint row,
                  gint col)
 {
-  guchar ret;
-
   if (col > sel_width || row > sel_height)
     {
       g_warning ("sel_pixel_value [%d,%d] out of bounds", col, row);
       return 0;
     }
 
-  gegl_buffer_sample (sel_buffer, col + sel_x1, row + sel_y1, NULL,
-                      &ret, babl_format ("Y u8"),
-                      GEGL_SAMPLER_NEAREST, GEGL_ABYSS_NONE);
+  /*  the selection is empty outside of its bounds  */
+  if (col < 0 || col >= sel_width || row < 0 || row >= sel_height)
+    return 0;
 
-  return ret;
+  return sel_data[row * sel_width + col];
 }
 
 gboolean
@@ -489,6 +487,7 @@ static gboolean
 sel2path (gint32 image_ID)
 {
   gint32                   selection_ID;
+  GeglBuffer              *sel_buffer;
   pixel_outline_list_type  olt;
   spline_list_array_type   splines;
 
@@ -507,13 +506,26 @@ sel2path (gint32 image_ID)
 
   sel_buffer = gimp_drawable_get_buffer (selection_ID);
 
+  /* The outlines look at every pixel several times, read them all at
+   * once instead of sampling the buffer for each.
+   */
+  sel_data = g_new (guchar, sel_width * sel_height);
+
+  gegl_buffer_get (sel_buffer,
+                   GEGL_RECTANGLE (sel_x1, sel_y1, sel_width, sel_height), 1.0,
+                   babl_format ("Y u8"), sel_data,
+                   GEGL_AUTO_ROWSTRIDE, GEGL_ABYSS_NONE);
+
+  g_object_unref (sel_buffer);
+
   olt = find_outline_pixels ();
 
   splines = fitted_splines (olt);
 
   do_points (splines, image_ID);
 
-  g_object_unref (sel_buffer);
+  g_free (sel_data);
+  sel_data = NULL;
 
   gimp_displays_flush ();
 